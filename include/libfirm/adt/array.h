@@ -72,6 +72,20 @@ FIRM_API void *ir_new_arr_f(size_t nelts, size_t elts_size);
  */
 FIRM_API void *ir_new_arr_d(struct obstack *obstack, size_t nelts, size_t elts_size);
 
+/**
+ * Creates a dynamic array in memory provided by the caller, typically as the
+ * tail of a larger object allocated on an obstack.
+ *
+ * @param mem    Memory for the array descriptor and the elements, at least
+ *               sizeof(ir_arr_descr) plus the size of the elements, aligned
+ *               like ir_arr_descr.
+ * @param nelts  The number of elements
+ *
+ * @return A pointer to the dynamic array (can be used as a pointer to the
+ *         first element of this array).
+ */
+FIRM_API void *ir_init_arr_d(void *mem, size_t nelts);
+
 /**
  * Resize a flexible array, allocate more data if needed but do NOT
  * reduce.
@@ -101,6 +115,34 @@ FIRM_API void *ir_arr_resize(void *elts, size_t nelts, size_t elts_size);
  */
 FIRM_API void *ir_arr_setlen(void *elts, size_t nelts, size_t elts_size);
 
+/**
+ * Resize a dynamic array on an obstack.  If the array needs more space, it is
+ * copied to a geometrically larger one on the obstack, the old memory is not
+ * reused until the obstack is freed.
+ *
+ * @param obstack  The obstack the array lives on.
+ * @param elts     The dynamic array (pointer to the first element).
+ * @param nelts    The new number of elements.
+ * @param eltsize  The size of the array elements.
+ *
+ * @return A resized dynamic array, possibly other address than
+ *         elts.
+ *
+ * @remark Helper function, use ARR_RESIZE_D() instead.
+ */
+FIRM_API void *ir_arr_resize_d(struct obstack *obstack, void *elts,
+                               size_t nelts, size_t eltsize);
+
+/**
+ * Creates an empty flexible array in a buffer provided by the caller.
+ *
+ * @param mem       Memory for the array descriptor and the elements.
+ * @param capacity  The number of elements fitting into @p mem.
+ *
+ * @remark Helper function, use NEW_ARR_A() instead.
+ */
+FIRM_API void *ir_init_arr_a(void *mem, size_t capacity);
+
 FIRM_API void ir_verify_arr(const void *elts);
 
 #define ARR_ELTS_OFFS offsetof(ir_arr_descr, elts)
@@ -155,6 +197,24 @@ static inline void ARR_SHRINKLEN(void *arr, size_t new_len)
 #define DUP_ARR_F(type, arr) \
   ((type*)memcpy(NEW_ARR_F(type, ARR_LEN((arr))), (arr), sizeof(type) * ARR_LEN((arr))))
 
+/**
+ * Creates an empty flexible array whose first @p capacity elements are
+ * stored in a buffer on the stack of the calling function.
+ *
+ * Use this for short-lived temporaries: the array can be used like any other
+ * flexible array, it is only moved to the heap if it outgrows the buffer.  It
+ * must be deleted with DEL_ARR_F() before the calling function returns and
+ * must not be created in a loop.
+ *
+ * @param type      The element type of the new array.
+ * @param capacity  The number of elements fitting into the stack buffer.
+ *
+ * @return A pointer to the flexible array (can be used as a pointer to the
+ *         first element of this array).
+ */
+#define NEW_ARR_A(type, capacity) \
+	((type*)ir_init_arr_a(alloca(ARR_ELTS_OFFS + sizeof(type) * (capacity)), (capacity)))
+
 /**
  * Delete a flexible array.
  * @param arr    The flexible array.
@@ -274,7 +334,57 @@ static inline size_t ARR_LEN(void const *const arr)
  * @param elt      The new element, must be of type (type).
  */
 #define ARR_APP1(type, arr, elt) \
-  (ARR_EXTEND(type, (arr), 1), (arr)[ARR_LEN((arr))-1] = (elt))
+  (ARR_DESCR((arr))->nelts < ARR_DESCR((arr))->allocated \
+   ? (void)++ARR_DESCR((arr))->nelts : (void)ARR_EXTEND(type, (arr), 1), \
+   (arr)[ARR_LEN((arr))-1] = (elt))
+
+/**
+ * Resize a dynamic array on an obstack, allocate more data if needed.
+ *
+ * @param type     The element type of the array.
+ * @param obstack  The obstack the array lives on.
+ * @param arr      The array, which must be an lvalue.
+ * @param n        The new size of the array.
+ *
+ * @remark  This macro may change arr, so update all references!
+ */
+#define ARR_RESIZE_D(type, obstack, arr, n) \
+  ((arr) = (type*) ir_arr_resize_d((obstack), (void *)(arr), (n), sizeof(type)))
+
+/**
+ * Append one element to a dynamic array on an obstack.
+ *
+ * @param type     The element type of the array.
+ * @param obstack  The obstack the array lives on.
+ * @param arr      The array, which must be an lvalue.
+ * @param elt      The new element, must be of type (type).
+ */
+#define ARR_APP1_D(type, obstack, arr, elt) \
+  (ARR_DESCR((arr))->nelts < ARR_DESCR((arr))->allocated \
+   ? (void)++ARR_DESCR((arr))->nelts \
+   : (void)ARR_RESIZE_D(type, (obstack), (arr), ARR_LEN((arr)) + 1), \
+   (arr)[ARR_LEN((arr))-1] = (elt))
+
+/**
+ * Statistics about the growth of flexible and dynamic arrays.
+ */
+typedef struct ir_arr_statistics_t {
+	size_t resizes;      /**< number of resizes which had to allocate memory */
+	size_t bytes_copied; /**< number of bytes moved by these resizes */
+} ir_arr_statistics_t;
+
+/**
+ * Returns the array statistics collected since the last call of
+ * ir_arr_reset_statistics().  Appends that fit into the allocated space are
+ * not counted, a breakpoint on ir_arr_resize() or ir_arr_resize_d() finds the
+ * sites that grow often.
+ */
+FIRM_API void ir_arr_get_statistics(ir_arr_statistics_t *stats);
+
+/**
+ * Resets the array statistics.
+ */
+FIRM_API void ir_arr_reset_statistics(void);
 
 /** @} */
 
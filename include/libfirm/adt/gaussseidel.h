@@ -37,6 +37,27 @@ FIRM_API double gs_matrix_get(const gs_matrix_t *m, unsigned row, unsigned col);
  */
 FIRM_API double gs_matrix_gauss_seidel(const gs_matrix_t *m, double *x);
 
+/**
+ * Converts the matrix into a compressed sparse row form, which makes the
+ * iteration steps faster. Call this after all entries are set: Changing an
+ * entry afterwards drops the compressed form again.
+ */
+FIRM_API void gs_matrix_freeze(gs_matrix_t *m);
+
+/**
+ * Iterates successive over-relaxation steps on m*x=0 until the sum of the
+ * absolute changes of @p x in one step is at most @p tolerance or
+ * @p max_iterations steps were done. The relaxation factor is adapted to
+ * the observed convergence rate. Freezes the matrix if necessary.
+ * @p m               The iteration matrix
+ * @p x               The iteration vector with the initial guess
+ * @p tolerance       Stop when a step changes x by at most this amount
+ * @p max_iterations  Maximum number of steps
+ * @return The number of steps performed
+ */
+FIRM_API unsigned gs_matrix_solve(gs_matrix_t *m, double *x, double tolerance,
+                                  unsigned max_iterations);
+
 FIRM_API unsigned gs_matrix_get_n_entries(const gs_matrix_t *m);
 
 /**
@@ -109,6 +109,21 @@ FIRM_API void hungarian_free(hungarian_problem_t *p);
 FIRM_API int hungarian_solve(hungarian_problem_t *p, unsigned *assignment,
                              unsigned *final_cost, unsigned cost_threshold);
 
+/**
+ * Computes the optimal assignment like hungarian_solve() with the shortest
+ * augmenting path method of Jonker and Volgenant, which keeps its dual
+ * potentials in 64 bit and needs no restart per stage. In contrast to
+ * hungarian_solve() the cost matrix is not modified and the threshold is
+ * compared against the unreduced costs.
+ * @param p              The hungarian object
+ * @param assignment     The final assignment
+ * @param final_cost     The final costs
+ * @param cost_threshold Matchings with costs >= this limit will be removed (if limit > 0)
+ * @return 0 on success, negative number otherwise
+ */
+FIRM_API int hungarian_solve_jv(hungarian_problem_t *p, unsigned *assignment,
+                                unsigned *final_cost, unsigned cost_threshold);
+
 /**
  * Print the cost matrix.
  * @param p          The hungarian object
@@ -201,6 +201,7 @@ FIRM_API int _obstack_begin_1 (struct obstack *, int, int,
                                void *(*) (void *, PTR_INT_TYPE),
                                void (*) (void *, void *), void *);
 FIRM_API PTR_INT_TYPE _obstack_memory_used (struct obstack *);
+FIRM_API PTR_INT_TYPE _obstack_chunk_count (struct obstack *);
 
 FIRM_API void obstack_free (struct obstack *obstack, void *block);
 
@@ -264,6 +265,8 @@ FIRM_API int obstack_exit_failure;
 
 #define obstack_memory_used(h) _obstack_memory_used (h)
 
+#define obstack_chunk_count(h) _obstack_chunk_count (h)
+
 #if defined __GNUC__ && defined __STDC__ && __STDC__
 /* NextStep 2.0 cc is really gcc 1.93 but it defines __GNUC__ = 2 and
    does not implement __extension__.  But that compiler doesn't define
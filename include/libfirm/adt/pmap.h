@@ -69,6 +69,9 @@ FIRM_API void *pmap_get(pmap const *map, void const *key);
 /** Return number of elements in the map */
 FIRM_API size_t pmap_count(pmap const *map);
 
+/** Return number of bytes allocated by the map */
+FIRM_API size_t pmap_memory_used(pmap *map);
+
 /**
  * Returns the first entry of a map if the map is not empty.
  */
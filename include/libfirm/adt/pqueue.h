@@ -48,6 +48,38 @@ FIRM_API void del_pqueue(pqueue_t *q);
  */
 FIRM_API void pqueue_put(pqueue_t *q, void *data, int priority);
 
+/** Handle value that never refers to an element of a priority queue. */
+#define PQUEUE_NO_HANDLE ((size_t)-1)
+
+/**
+ * Inserts a new element into a priority queue and returns a handle for it.
+ * The handle stays valid as long as the element is in the queue. Once the
+ * element has been removed, the handle may be returned for a later insertion.
+ * @param q         The priority queue the element should be inserted to.
+ * @param data      The actual data which should be stored in the queue.
+ * @param priority  The priority for the data.
+ * @return A handle for the element.
+ */
+FIRM_API size_t pqueue_insert(pqueue_t *q, void *data, int priority);
+
+/**
+ * Tests whether an element with the given handle is in the queue.
+ * As handles are reused, callers should forget the handle of a removed
+ * element, e.g. by setting it to PQUEUE_NO_HANDLE.
+ * @param q       The priority queue.
+ * @param handle  A handle returned by pqueue_insert() for this queue,
+ *                or PQUEUE_NO_HANDLE.
+ */
+FIRM_API int pqueue_contains(pqueue_t const *q, size_t handle);
+
+/**
+ * Changes the priority of an element in the queue.
+ * @param q         The priority queue.
+ * @param handle    The handle of the element, it must still be in the queue.
+ * @param priority  The new priority of the element.
+ */
+FIRM_API void pqueue_change_priority(pqueue_t *q, size_t handle, int priority);
+
 /**
  * Returns and removes the first element, i.e. that one with the highest priority, from the queue.
  * @param q   The priority queue.
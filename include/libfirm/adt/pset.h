@@ -102,6 +102,13 @@ FIRM_API void del_pset(pset *pset);
  */
 FIRM_API size_t pset_count(pset const *pset);
 
+/**
+ * Returns the number of bytes allocated by a pset.
+ *
+ * @param pset   the pset
+ */
+FIRM_API size_t pset_memory_used(pset *pset);
+
 /**
  * Searches an element pointer in a pset.
  *
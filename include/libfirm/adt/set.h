@@ -84,6 +84,13 @@ FIRM_API void del_set(set *set);
  */
 FIRM_API size_t set_count(set const *set);
 
+/**
+ * Returns the number of bytes allocated by a set.
+ *
+ * @param set   the set
+ */
+FIRM_API size_t set_memory_used(set *set);
+
 /**
  * Searches an element in a set.
  *
@@ -36,6 +36,58 @@
  * @{
  */
 
+/**
+ * Callbacks used by xmalloc() and friends to obtain memory from the host
+ * application.
+ */
+typedef struct ir_allocator_t {
+	/** Allocates @p size bytes, returns NULL on failure. */
+	void *(*allocate)(void *context, size_t size);
+	/** Resizes the block @p ptr to @p size bytes, returns NULL on failure. */
+	void *(*reallocate)(void *context, void *ptr, size_t size);
+	/** Releases the block @p ptr. */
+	void (*release)(void *context, void *ptr);
+	/** Passed as first argument to all callbacks. */
+	void *context;
+} ir_allocator_t;
+
+/**
+ * Function called when an allocation fails or exceeds the request limit.
+ * It must not return: It either terminates the program or leaves libFirm
+ * with longjmp().
+ */
+typedef void ir_out_of_memory_func(void);
+
+/**
+ * Installs the allocator used by xmalloc(), xrealloc() and xfree().
+ * Passing NULL restores the default allocator based on malloc().
+ * The allocator must only be changed while no memory obtained from the
+ * previous one is live, i.e. before ir_init() or after ir_finish().
+ */
+FIRM_API void ir_set_allocator(ir_allocator_t const *allocator);
+
+/**
+ * Installs the function called when memory is exhausted. Passing NULL
+ * restores the default handler, which prints a message and aborts.
+ */
+FIRM_API void ir_set_out_of_memory_handler(ir_out_of_memory_func *handler);
+
+/**
+ * Limits the total number of bytes requested from the allocator to @p limit
+ * and resets the counter of requested bytes. If the limit is exceeded the
+ * out of memory handler is called. A limit of 0 means no limit.
+ * The counter sums up the sizes of all requests and does not decrease when
+ * memory is freed, so it bounds the cumulative requests of a compilation,
+ * not the live memory. Set the limit at the start of each compilation.
+ */
+FIRM_API void ir_set_request_limit(size_t limit);
+
+/**
+ * Returns the total number of bytes requested since the last call to
+ * ir_set_request_limit(), including memory already freed again.
+ */
+FIRM_API size_t ir_get_requested_bytes(void);
+
 /**
  * Allocate @p size bytes on the heap.
  * This is a wrapper for malloc which calls panic() in case of errors, so no
@@ -48,6 +100,11 @@ FIRM_API void *xmalloc(size_t size);
  * error handling is required for code using it.
  */
 FIRM_API void *xrealloc(void *ptr, size_t size);
+/**
+ * Free memory allocated with xmalloc(), xrealloc() or xstrdup().
+ */
+FIRM_API void xfree(void *ptr);
+
 /**
  * Allocates memory and copies string @p str into it.
  * This is a wrapper for strdup which calls panic() in case of errors, so no
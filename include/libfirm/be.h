@@ -121,6 +121,17 @@ typedef struct backend_params {
 	/** Backend settings for if-conversion. */
 	arch_allow_ifconv_func allow_ifconv;
 
+	/**
+	 * Average number of cycles lost by a mispredicted conditional branch.
+	 * If-conversion weighs it against the cost of executing both arms if
+	 * branch probabilities are known. 0 if unknown, then the decision is left
+	 * to allow_ifconv alone.
+	 */
+	unsigned branch_mispredict_penalty;
+
+	/** Latency in cycles of a Mux which is not optimized away. */
+	unsigned mux_latency;
+
 	/** size of machine word in bits. This is usually the size of the general
 	 * purpose integer/address registers. */
 	unsigned machine_size;
@@ -154,6 +165,31 @@ typedef struct backend_params {
 
 	/** How this backend implements variadic functions. */
 	vararg_params vararg;
+
+	/**
+	 * Distance in bytes by which strided loads in loops should be prefetched
+	 * ahead. 0 if the backend does not support prefetching or it does not pay
+	 * off.
+	 */
+	unsigned prefetch_distance;
+
+	/**
+	 * Integer mode of the widest register the backend can load and store
+	 * without alignment restrictions. Small memory copies are split into
+	 * accesses of this size. NULL if nothing wider than the machine word is
+	 * available.
+	 */
+	ir_mode *mode_vector_move;
+
+	/**
+	 * Number of registers available for integer and reference values, not
+	 * counting stack and frame pointer. Loop optimizations use it to avoid
+	 * raising the register pressure beyond it. 0 if unknown.
+	 */
+	unsigned n_int_registers;
+
+	/** Number of registers available for floating point values, 0 if unknown. */
+	unsigned n_float_registers;
 } backend_params;
 
 /**
@@ -92,6 +92,22 @@ FIRM_API void compute_callgraph(void);
 /** Destruct the callgraph. */
 FIRM_API void free_callgraph(void);
 
+/**
+ * Brings the callgraph up to date.
+ *
+ * While a callgraph exists, creating or exchanging a Call node marks its graph
+ * as changed.  This only recomputes the callee edges of the changed graphs
+ * and of graphs created after the callgraph, instead of walking the whole
+ * program again.  Calls that merely become unreachable are kept until their
+ * graph changes otherwise.  If no callgraph exists or it was marked
+ * inconsistent (computing or freeing callee information does so), the
+ * callgraph is computed from scratch with compute_callgraph().
+ *
+ * The calltree (the backedge information of find_callgraph_recursions()) is
+ * invalid after the callgraph changed.
+ */
+FIRM_API void update_callgraph(void);
+
 
 /** A function type for functions passed to the callgraph walker. */
 typedef void callgraph_walk_func(ir_graph *g, void *env);
@@ -22,6 +22,14 @@
 /** Computes the control dependence graph for a graph. */
 FIRM_API void compute_cdep(ir_graph *irg);
 
+/**
+ * Prepares control dependence queries for a graph without computing them.
+ * The control dependences of a block are computed on its first query and
+ * memoized, so the cost scales with the number of queried blocks instead of
+ * the graph size. The control flow must not change while the info is used.
+ */
+FIRM_API void compute_cdep_lazy(ir_graph *irg);
+
 /** Frees the control dependence info. */
 FIRM_API void free_cdep(ir_graph *irg);
 
@@ -40,7 +40,10 @@
  *  caller of cgana().
  *
  *  cgana() sets the callee_info_state of each graph and the program to
- *  consistent.
+ *  consistent.  Graphs whose callee information is still consistent from an
+ *  earlier run are not analysed again, their callees and a summary of the
+ *  methods that get free through them are reused.  Creating Call, Address or
+ *  Member nodes in a graph marks its callee information as inconsistent.
  *
  *  The algorithm implements roughly Static Class Hierarchy Analysis
  *  as described in "Optimization of Object-Oriented Programs Using
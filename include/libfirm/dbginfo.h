@@ -140,6 +140,16 @@ typedef struct src_loc_t {
 	unsigned    column;  /**< column number (starting at 1; 0 if unknown) */
 } src_loc_t;
 
+/**
+ * Returns a debug info for the source location @p loc.
+ *
+ * Equal locations yield the same debug info, which refers to a compact entry
+ * in a table of the library; file names are stored only once.  The default
+ * retriever understands these debug infos, so they cannot be mixed with a
+ * retriever set by ir_set_debug_retrieve().  Columns above 65535 are dropped.
+ */
+FIRM_API dbg_info *ir_intern_src_loc(src_loc_t loc);
+
 /**
  * The type of the debug info retriever function.
  *  When given a dbg_info returns the name (usually the filename), line number
@@ -50,6 +50,9 @@ FIRM_API int heights_reachable_in_block(ir_heights_t *h, const ir_node *src,
 /**
  * Recomputes the height information for a certain block.
  * This can be used to recompute the height information of a block.
+ * The heights object adapts itself to added or rerouted edges, so this is
+ * only needed to get exact heights again after nodes were removed, or for
+ * blocks created after heights_new().
  * @param h     The heights object.
  * @param block The block
  * @return The maximum over all heights in the block.
@@ -58,7 +61,9 @@ FIRM_API unsigned heights_recompute_block(ir_heights_t *h, ir_node *block);
 
 /**
  * Creates a new heights object. This also computes the heights for each block
- * in the graph.
+ * in the graph.  While the object exists, changed edges in these blocks raise
+ * the heights of the affected nodes, so reachability checks stay correct when
+ * the graph is modified.
  * @param irg The graph.
  */
 FIRM_API ir_heights_t *heights_new(ir_graph *irg);
@@ -44,6 +44,19 @@ FIRM_API ident *new_id_from_str(const char *str);
  */
 FIRM_API ident *new_id_from_chars(const char *str, size_t len);
 
+/**
+ * Stores many strings at once and creates their idents.
+ *
+ * Equivalent to calling new_id_from_str() for each string, but takes the
+ * locks of the ident table only once per batch.
+ *
+ * @param n     the number of strings
+ * @param strs  the zero terminated strings which shall be stored
+ * @param ids   array of size @p n receiving the idents
+ */
+FIRM_API void new_ids_from_strs(size_t n, const char *const *strs,
+                                ident **ids);
+
 /**
  * Create an ident from a format string.
  *
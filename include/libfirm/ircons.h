@@ -688,6 +688,45 @@ FIRM_API void verify_new_node(ir_node *node);
 FIRM_API void ir_set_uninitialized_local_variable_func(
 		uninitialized_local_variable_func_t *func);
 
+/**
+ * Describes a node created by new_r_nodes().  Operands and blocks are given
+ * by their indices in the batch.
+ */
+typedef struct ir_node_desc {
+	ir_op      *op;    /**< opcode, NULL for a node passed in by the caller */
+	ir_mode    *mode;  /**< mode of the node */
+	dbg_info   *dbgi;  /**< debug info of the node */
+	int         block; /**< index of the block, -1 for Block nodes */
+	int         arity; /**< number of operands */
+	int const  *in;    /**< indices of the operands */
+} ir_node_desc;
+
+/**
+ * Creates the nodes described by the \p n_nodes entries of \p descs in
+ * \p irg at once and stores them in \p nodes.  Entries of \p descs without
+ * an opcode refer to an existing node, which the caller stores at the same
+ * index of \p nodes beforehand.  Operands may refer to later nodes of the
+ * batch, so cycles through Phi nodes can be created directly.
+ *
+ * The nodes are allocated contiguously and are neither optimized nor entered
+ * into the value table.  Blocks get a fixed set of predecessors and are
+ * mature.  Other attributes are zero and must be set with the setters of the
+ * nodes, before optimize_new_nodes() is called.  Start, End and Anchor nodes
+ * cannot be created this way.
+ */
+FIRM_API void new_r_nodes(ir_graph *irg, size_t n_nodes,
+                          ir_node_desc const *descs, ir_node **nodes);
+
+/**
+ * Verifies and locally optimizes the nodes created by new_r_nodes() from
+ * \p descs and enters them into the value table for common subexpression
+ * elimination.  The nodes are visited in the order of \p descs, so operands
+ * defined earlier in the batch are already optimized.  Entries of \p nodes
+ * are updated if a node was replaced.
+ */
+FIRM_API void optimize_new_nodes(size_t n_nodes, ir_node_desc const *descs,
+                                 ir_node **nodes);
+
 /** @} */
 
 #include "end.h"
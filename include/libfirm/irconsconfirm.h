@@ -37,6 +37,20 @@
  */
 FIRM_API void construct_confirms(ir_graph *irg);
 
+/**
+ * Inject Confirm nodes into a graph, but only where an optimization
+ * can use them.
+ *
+ * Unlike construct_confirms() a Confirm is only placed in front of
+ * consumers like Cmp nodes, array indices, address arithmetic and
+ * divisors which may be zero. At most @p budget Confirm nodes are
+ * created, which avoids node explosion in large switch-heavy graphs.
+ *
+ * @param irg     the graph
+ * @param budget  the maximum number of Confirm nodes to create
+ */
+FIRM_API void construct_confirms_budgeted(ir_graph *irg, unsigned budget);
+
 /**
  * Remove all Confirm nodes from a graph.
  *
@@ -168,6 +168,40 @@ FIRM_API void postdom_tree_walk_irg(ir_graph *irg, irg_walk_func *pre,
  */
 FIRM_API void compute_doms(ir_graph *irg);
 
+/**
+ * Updates the dominance information of the graph of @p block after a control
+ * flow edge from @p pred to @p block was added.
+ *
+ * The tree is updated incrementally if the block successor edges
+ * (EDGE_KIND_BLOCK) are active and both blocks were already reachable,
+ * otherwise the dominance information is marked inconsistent. Dominance
+ * frontiers are always invalidated and the graph pre order numbers of the
+ * blocks are not updated. Must be called after each single edge change.
+ */
+FIRM_API void dom_insert_edge(ir_node *pred, ir_node *block);
+
+/**
+ * Updates the dominance information of the graph of @p block after a control
+ * flow edge from @p pred to @p block was removed.
+ *
+ * Deletions which cannot change the dominator tree keep it consistent, all
+ * others mark the dominance information inconsistent.
+ */
+FIRM_API void dom_delete_edge(ir_node *pred, ir_node *block);
+
+/**
+ * Compares the dominance information of @p irg against a full recomputation,
+ * which replaces it afterwards.
+ * @returns 0 if a difference was found
+ */
+FIRM_API int verify_dominance(ir_graph *irg);
+
+/**
+ * Sets the dominance verification flag. If set, every incremental dominance
+ * update is checked with verify_dominance().
+ */
+FIRM_API void dom_init_dbg(int do_dbg);
+
 /** Computes the post dominance relation for all basic blocks of a given graph.
  *
  * Sets a flag in irg to "dom_consistent".
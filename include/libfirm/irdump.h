@@ -112,6 +112,44 @@ FIRM_API void ir_set_dump_filter(const char *name);
 /** Returns the prefix filter set with #ir_set_dump_filter */
 FIRM_API const char *ir_get_dump_filter(void);
 
+/**
+ * Restricts #dump_ir_graph_file to a part of the graph.
+ *
+ * @p filter is a comma separated list of opcode names and node numbers, for
+ * example "Load,Store" or "1234".  Only the matching nodes, all nodes of
+ * matching blocks and the nodes within the radius set with
+ * #ir_set_dump_radius around them are dumped, together with their direct
+ * operands.  The restricted dump ignores
+ * #ir_dump_flag_blocks_as_subgraphs and does not contain type information or
+ * out edges.  NULL or "" dumps whole graphs again.
+ */
+FIRM_API void ir_set_dump_node_filter(const char *filter);
+
+/** Returns the node filter set with #ir_set_dump_node_filter or "" */
+FIRM_API const char *ir_get_dump_node_filter(void);
+
+/**
+ * Sets how many edges the nodes dumped because of #ir_set_dump_node_filter
+ * may be away from a matching node.  Both operand and user edges count.
+ * The default is 0.
+ */
+FIRM_API void ir_set_dump_radius(unsigned radius);
+
+/** Returns the radius set with #ir_set_dump_radius */
+FIRM_API unsigned ir_get_dump_radius(void);
+
+/**
+ * Lets #dump_ir_graph_ext and #dump_ir_prog_ext write their files in a
+ * background thread.  The dumps are still produced immediately, but into
+ * memory, so the graphs may be changed right after the dumper returns.
+ * Use #ir_dump_wait before reading the files; ir_finish() waits as well.
+ * Without POSIX threads the files are written immediately.
+ */
+FIRM_API void ir_set_dump_async(int enable);
+
+/** Waits until all files of dumps made with #ir_set_dump_async are written. */
+FIRM_API void ir_dump_wait(void);
+
 /*@}*/
 
 /**
@@ -216,6 +254,12 @@ FIRM_API void dump_entity_to_file(FILE *out, const ir_entity *entity);
 /** Write the type and all its attributes to the file passed. */
 FIRM_API void dump_type_to_file(FILE *out, const ir_type *type);
 
+/**
+ * Write how often each analysis was computed, reused and invalidated and the
+ * time spent computing it to @p out.
+ */
+FIRM_API void dump_analysis_statistics(FILE *out);
+
 /** Verbosity for text dumpers */
 typedef enum {
 	dump_verbosity_onlynames         = 0x00000001,   /**< Only dump names. Turns off all other
@@ -135,6 +135,42 @@ FIRM_API void restore_optimization_state(const optimization_state_t *state);
  */
 FIRM_API void all_optimizations_off(void);
 
+/**
+ * Growth classes of the running time of super-linear passes, see
+ * get_irg_complexity().
+ */
+typedef enum ir_complexity_t {
+	IR_COMPLEXITY_NODES_SQUARED,  /**< quadratic in the number of nodes */
+	IR_COMPLEXITY_NODES_BLOCKS,   /**< nodes times blocks */
+	IR_COMPLEXITY_BLOCKS_SQUARED, /**< quadratic in the number of blocks */
+	IR_COMPLEXITY_BLOCKS_CUBED,   /**< cubic in the number of blocks */
+} ir_complexity_t;
+
+/**
+ * Sets the complexity budget: the number of steps a super-linear pass may
+ * spend on a single graph.  Passes exceeding it switch to a cheaper mode or
+ * are skipped, see ir_complexity_allows().  A budget <= 0 disables the
+ * throttling.  Default: 1e10, which lets quadratic passes run on graphs with
+ * up to 100000 nodes.
+ */
+FIRM_API void set_opt_complexity_budget(double budget);
+
+/** Returns the complexity budget. */
+FIRM_API double get_opt_complexity_budget(void);
+
+/**
+ * Returns the estimated number of steps of a pass with growth class
+ * @p complexity on @p irg, derived from its node and block counts.
+ */
+FIRM_API double get_irg_complexity(ir_graph *irg, ir_complexity_t complexity);
+
+/**
+ * Returns whether pass @p pass may spend @p cost steps on @p irg.  If not,
+ * the decision is reported as statistic event "throttled_<pass>" with the
+ * cost as value.
+ */
+FIRM_API int ir_complexity_allows(ir_graph *irg, const char *pass, double cost);
+
 /** @} */
 
 #include "end.h"
@@ -397,6 +397,8 @@ typedef enum ir_graph_properties_t {
 	IR_GRAPH_PROPERTY_CONSISTENT_ENTITY_USAGE        = 1U << 11,
 	/** graph contains as many returns as possible */
 	IR_GRAPH_PROPERTY_MANY_RETURNS                   = 1U << 12,
+	/** control flow successors of the blocks (irouts) are up to date */
+	IR_GRAPH_PROPERTY_CONSISTENT_BLOCK_OUTS          = 1U << 13,
 
 	/**
 	 * List of all graph properties that are only affected by control flow
@@ -409,7 +411,8 @@ typedef enum ir_graph_properties_t {
 		| IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO
 		| IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE
 		| IR_GRAPH_PROPERTY_CONSISTENT_POSTDOMINANCE
-		| IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE_FRONTIERS,
+		| IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE_FRONTIERS
+		| IR_GRAPH_PROPERTY_CONSISTENT_BLOCK_OUTS,
 
 	/**
 	 * List of all graph properties.
@@ -456,6 +459,83 @@ FIRM_API void assure_irg_properties(ir_graph *irg, ir_graph_properties_t props);
  */
 FIRM_API void confirm_irg_properties(ir_graph *irg, ir_graph_properties_t props);
 
+/**
+ * Analyses, whose (re)computation is recorded in the analysis statistics.
+ */
+typedef enum ir_analysis_t {
+	IR_ANALYSIS_OUT_EDGES,                  /**< out edges, see iredges.h */
+	IR_ANALYSIS_FIRST = IR_ANALYSIS_OUT_EDGES,
+	IR_ANALYSIS_OUTS,                       /**< def-use arrays, see irouts.h */
+	IR_ANALYSIS_BLOCK_OUTS,                 /**< block successors, see irouts.h */
+	IR_ANALYSIS_DOMINANCE,                  /**< dominator tree */
+	IR_ANALYSIS_POSTDOMINANCE,              /**< postdominator tree */
+	IR_ANALYSIS_DOMINANCE_FRONTIERS,        /**< dominance frontiers */
+	IR_ANALYSIS_LOOPINFO,                   /**< control flow loop tree */
+	IR_ANALYSIS_LIVENESS,                   /**< backend liveness sets */
+	IR_ANALYSIS_LAST = IR_ANALYSIS_LIVENESS,
+} ir_analysis_t;
+
+/** Returns a human readable name of @p analysis. */
+FIRM_API const char *get_ir_analysis_name(ir_analysis_t analysis);
+
+/** Returns how often @p analysis was computed (over all graphs). */
+FIRM_API unsigned ir_get_analysis_computations(ir_analysis_t analysis);
+
+/**
+ * Returns how often @p analysis was requested while a still valid result
+ * existed, so no computation was necessary.
+ */
+FIRM_API unsigned ir_get_analysis_reuses(ir_analysis_t analysis);
+
+/**
+ * Returns how often a valid result of @p analysis was discarded, usually
+ * because a transformation did not confirm that it preserves it.
+ */
+FIRM_API unsigned ir_get_analysis_invalidations(ir_analysis_t analysis);
+
+/**
+ * Returns the processor time in seconds spent computing @p analysis.  Time
+ * spent in other analyses computed on its behalf is not included.
+ */
+FIRM_API double ir_get_analysis_time(ir_analysis_t analysis);
+
+/** Resets all analysis statistics to zero. */
+FIRM_API void ir_clear_analysis_statistics(void);
+
+/**
+ * Categories of the memory held by a graph, see ir_graph_memory_usage().
+ */
+typedef enum ir_memory_category_t {
+	IR_MEMORY_NODES,      /**< graph obstack and node index map */
+	IR_MEMORY_FIRST = IR_MEMORY_NODES,
+	IR_MEMORY_EDGES,      /**< out edges, see iredges.h */
+	IR_MEMORY_OUTS,       /**< def-use arrays and block successors */
+	IR_MEMORY_ANALYSES,   /**< other analysis data like the value table,
+	                           dominance frontiers, bit and value range info,
+	                           the alias cache and cached walk orders */
+	IR_MEMORY_BACKEND,    /**< backend obstack with the register info */
+	IR_MEMORY_LIVENESS,   /**< backend liveness sets */
+	IR_MEMORY_LAST = IR_MEMORY_LIVENESS,
+} ir_memory_category_t;
+
+/** Bytes held per memory category. */
+typedef struct ir_memory_usage_t {
+	size_t bytes[IR_MEMORY_LAST + 1];
+} ir_memory_usage_t;
+
+/** Returns a human readable name of memory category @p category. */
+FIRM_API const char *get_ir_memory_category_name(ir_memory_category_t category);
+
+/**
+ * Stores the number of bytes held by @p irg and its analysis data in
+ * @p usage.  Memory shared by all graphs, like types and entities, is not
+ * included.
+ */
+FIRM_API void ir_graph_memory_usage(ir_graph *irg, ir_memory_usage_t *usage);
+
+/** Returns the sum of all categories of @p usage. */
+FIRM_API size_t ir_memory_usage_total(const ir_memory_usage_t *usage);
+
 /** @} */
 
 #include "end.h"
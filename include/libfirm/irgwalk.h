@@ -141,6 +141,25 @@ FIRM_API void irg_block_walk(ir_node *node, irg_walk_func *pre,
 FIRM_API void irg_block_walk_graph(ir_graph *irg, irg_walk_func *pre,
                                    irg_walk_func *post, void *env);
 
+/**
+ * Activates caching of the walk orders of irg_walk_graph() and
+ * irg_block_walk_graph() for a graph.
+ *
+ * The first walk records the order in which nodes are visited, later walks
+ * just replay it until an edge of the graph changes. While the cache is
+ * active, walker callbacks of these two walkers must not modify the graph.
+ *
+ * @param irg   the graph
+ */
+FIRM_API void irg_walk_cache_activate(ir_graph *irg);
+
+/**
+ * Deactivates caching of walk orders and frees the cached orders.
+ *
+ * @param irg   the graph
+ */
+FIRM_API void irg_walk_cache_deactivate(ir_graph *irg);
+
 /**
  * Walks over all code in const_code_irg.
  *
@@ -5,7 +5,7 @@
 
 /**
  * @file
- * @brief   Input/Output textual representation of firm.
+ * @brief   Input/Output textual and binary representation of firm.
  * @author  Moritz Kroll
  */
 #ifndef FIRM_IR_IRIO_H
@@ -38,8 +38,27 @@ FIRM_API int ir_export(const char *filename);
  */
 FIRM_API void ir_export_file(FILE *output);
 
+/**
+ * Exports the whole irp to the given file in the binary format.
+ * The binary format holds the same information as the textual one in a
+ * compact form: Symbols and strings are stored once in a string table,
+ * numbers as varints, and an index of the top-level sections allows
+ * ir_import_file_graph() to skip graphs without parsing them.
+ *
+ * @param filename  the name of the resulting file
+ * @return  0 if no errors occured, other values in case of errors
+ */
+FIRM_API int ir_export_binary(const char *filename);
+
+/**
+ * same as ir_export_binary but writes to a FILE*
+ * @note As with any FILE* errors are indicated by ferror(output)
+ */
+FIRM_API void ir_export_binary_file(FILE *output);
+
 /**
  * Imports the data stored in the given file.
+ * The file may be in the textual or in the binary format.
  * Imports any type graphs and ir graphs contained in the file.
  *
  * @param filename  the name of the file
@@ -52,6 +71,69 @@ FIRM_API int ir_import(const char *filename);
  */
 FIRM_API int ir_import_file(FILE *input, const char *inputname);
 
+/**
+ * same as ir_import_file but imports only the graph of the entity with the
+ * linker name @p ld_name, all other graphs are skipped.  Modes, types,
+ * entities and the rest of the program are imported as usual.
+ * Only supported for the binary format.
+ */
+FIRM_API int ir_import_file_graph(FILE *input, const char *inputname,
+                                  const char *ld_name);
+
+/**
+ * Imports a file in the binary format lazily: The file is mapped into
+ * memory, modes, types, entities and the rest of the program are imported
+ * right away, but a graph is only constructed when it is accessed first,
+ * i.e. by get_entity_irg() or by iterating over the graphs of the program.
+ * The mapping is released after all graphs have been constructed or when the
+ * program is freed.  Files in the textual format are imported as usual.
+ *
+ * @param filename  the name of the file to import
+ * @return 0 if no errors occurred, other values in case of errors, errors in
+ *         a graph are only reported when the graph is constructed
+ */
+FIRM_API int ir_import_mmap(const char *filename);
+
+/**
+ * State of merging several units into one program, see ir_lto_begin().
+ */
+typedef struct ir_lto_t ir_lto_t;
+
+/**
+ * Begins merging several units, exported with ir_export() or
+ * ir_export_binary(), into the current program for whole program
+ * optimization.  The units are imported one at a time by ir_lto_add():
+ * - Global entities with the same linker name are resolved into one entity.
+ *   A definition replaces declarations and weak definitions, multiple strong
+ *   definitions are an error.  The most constraining visibility wins.
+ * - Local entities whose linker name clashes with another global are
+ *   renamed.
+ * - Structurally identical types are merged into one type.
+ *
+ * Afterwards the program can be optimized as a whole, see
+ * optimize_whole_program().
+ */
+FIRM_API ir_lto_t *ir_lto_begin(void);
+
+/**
+ * Imports the unit in file @p filename, in the textual or the binary format,
+ * and merges it into the current program.
+ *
+ * @return 0 if no errors occurred, other values in case of errors
+ */
+FIRM_API int ir_lto_add(ir_lto_t *lto, const char *filename);
+
+/**
+ * same as ir_lto_add but imports from a FILE*
+ */
+FIRM_API int ir_lto_add_file(ir_lto_t *lto, FILE *input,
+                             const char *inputname);
+
+/**
+ * Finishes merging units and frees @p lto.
+ */
+FIRM_API void ir_lto_finish(ir_lto_t *lto);
+
 /** @} */
 
 #include "end.h"
@@ -52,7 +52,7 @@ FIRM_API void set_irg_loop(ir_graph *irg, ir_loop *l);
 /** Returns the root loop info (if exists) for an irg. */
 FIRM_API ir_loop *get_irg_loop(const ir_graph *irg);
 
-/** Returns the loop n is contained in.  NULL if node is in no loop. */
+/** Returns the loop block n is contained in.  NULL if block is in no loop. */
 FIRM_API ir_loop *get_irn_loop(const ir_node *n);
 
 /** Returns outer loop, itself if outermost. */
@@ -116,6 +116,27 @@ FIRM_API void free_loop_information(ir_graph *irg);
  * belongs to or in inner loops of this block. */
 FIRM_API int is_loop_invariant(const ir_node *n, const ir_node *block);
 
+/**
+ * Estimates the register pressure in a loop before code generation: The
+ * maximum number of values live at the same time anywhere in the loop or its
+ * inner loops.  Values defined outside of the loop and used inside are live
+ * through the whole loop, their number is reported separately.
+ * Requires consistent out edges and loop information.
+ *
+ * Compare the result with the register counts in backend_params to find out
+ * whether a transformation makes the loop spill.
+ *
+ * @param loop          the loop
+ * @param float_values  if non-zero count floating point values, otherwise
+ *                      integer and reference values
+ * @param invariant     if not NULL, receives the number of values live
+ *                      through the loop
+ * @return the estimated pressure including the invariant values
+ */
+FIRM_API unsigned get_loop_register_pressure(const ir_loop *loop,
+                                             int float_values,
+                                             unsigned *invariant);
+
 /** @} */
 
 #include "end.h"
@@ -48,6 +48,9 @@ typedef enum ir_disambiguator_options {
 	aa_opt_no_alias            = 1u << 3, /**< different addresses NEVER alias */
 	/**< internal flag: options from a graph are inherited from global */
 	aa_opt_inherited           = 1u << 4,
+	/**< classify all Load/Store/CopyB addresses once when a pass starts
+	 *   caching alias queries instead of for every query */
+	aa_opt_precompute_addresses = 1u << 5,
 } ir_disambiguator_options;
 ENUM_BITSET(ir_disambiguator_options)
 
@@ -113,6 +113,20 @@ FIRM_API ir_mode *new_float_mode(const char *name,
  */
 FIRM_API ir_mode *new_non_arithmetic_mode(const char *name, unsigned bit_size);
 
+/**
+ * Creates a new mode for vectors of @p n_lanes values of mode @p element_mode.
+ *
+ * Add, Sub, Mul and Minus operate lane-wise on vector values, And, Or, Eor
+ * and Not operate on the whole bit pattern. The arithmetic of vector modes is
+ * irma_none.
+ *
+ * @param name          the name of the mode to be created
+ * @param element_mode  mode of a single lane, an integer or float mode
+ * @param n_lanes       number of lanes
+ */
+FIRM_API ir_mode *new_vector_mode(const char *name, ir_mode *element_mode,
+                                  unsigned n_lanes);
+
 /** Returns the ident* of the mode */
 FIRM_API ident *get_mode_ident(const ir_mode *mode);
 
@@ -290,6 +304,9 @@ FIRM_API int mode_is_num(const ir_mode *mode);
  */
 FIRM_API int mode_is_data(const ir_mode *mode);
 
+/** Returns 1 if @p mode is a vector mode, 0 otherwise */
+FIRM_API int mode_is_vector(const ir_mode *mode);
+
 /**
  * Returns true if a value of mode @p sm can be converted to mode @p lm without
  * loss.
@@ -375,6 +392,16 @@ FIRM_API unsigned get_mode_mantissa_size(const ir_mode *mode);
  */
 FIRM_API unsigned get_mode_exponent_size(const ir_mode *mode);
 
+/**
+ * Returns the mode of a single lane of the vector mode @p mode.
+ */
+FIRM_API ir_mode *get_mode_vector_element_mode(const ir_mode *mode);
+
+/**
+ * Returns the number of lanes of the vector mode @p mode.
+ */
+FIRM_API unsigned get_mode_vector_n_lanes(const ir_mode *mode);
+
 /**
  * Returns semantic on float to integer conversion overflow.
  */
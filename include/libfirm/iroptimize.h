@@ -10,6 +10,8 @@
 #ifndef FIRM_IROPTIMIZE_H
 #define FIRM_IROPTIMIZE_H
 
+#include <stddef.h>
+
 #include "firm_types.h"
 #include "begin.h"
 
@@ -34,6 +36,11 @@ FIRM_API void optimize_cf(ir_graph *irg);
 /**
  * Perform path-sensitive jump threading on the given graph.
  *
+ * Jumps of Conds and Switches are threaded when a constant value on some path
+ * decides them.  The nodes duplicated for a path are weighed against the
+ * estimated execution frequency of the path and the total growth of the graph
+ * is limited, so rarely executed paths are not threaded.
+ *
  * @param irg  the graph
  */
 FIRM_API void opt_jumpthreading(ir_graph* irg);
@@ -83,6 +90,33 @@ typedef int (*check_alloc_entity_func)(ir_entity *ent);
  */
 FIRM_API void optimize_funccalls(void);
 
+/**
+ * Writes the additional properties of the methods of the current program
+ * which are visible to other translation units to a summary file.
+ *
+ * For every method the properties found by optimize_funccalls() or given
+ * by the frontend are written, which carry over to callers in other
+ * translation units: no_write, pure, noreturn, terminates, nothrow and
+ * malloc.  Methods with weak linkage are skipped, as another definition may
+ * be linked.
+ *
+ * @param filename  the name of the summary file
+ * @return  0 if no errors occurred, other values in case of errors
+ */
+FIRM_API int ir_export_method_summaries(const char *filename);
+
+/**
+ * Reads a summary file written by ir_export_method_summaries() and adds
+ * the properties of the methods to the entities of the current program with
+ * the same linker name, which have no graph.  Call this before
+ * optimize_funccalls(), so calls of these methods can be optimized.
+ * Several summary files may be read one after another.
+ *
+ * @param filename  the name of the summary file
+ * @return  0 if no errors occurred, other values in case of errors
+ */
+FIRM_API int ir_import_method_summaries(const char *filename);
+
 /**
  * Does Partial Redundancy Elimination combined with
  * Global Value Numbering.
@@ -115,6 +149,11 @@ typedef int (*arch_allow_ifconv_func)(ir_node *sel, ir_node *mux_false,
  *
  * Cannot handle blocks with Bad control predecessors, so call it after control
  * flow optimization.
+ *
+ * If the branch probabilities are known from a profile or a jump prediction,
+ * a diamond is only converted if executing both paths is cheaper than the
+ * expected cost of the branch including mispredictions, as given by the
+ * backend parameters.
  */
 FIRM_API void opt_if_conv(ir_graph *irg);
 
@@ -136,6 +175,17 @@ FIRM_API void opt_if_conv_cb(ir_graph *irg, arch_allow_ifconv_func callback);
  */
 FIRM_API void opt_parallelize_mem(ir_graph *irg);
 
+/**
+ * Inserts software prefetches for Loads in innermost loops which access
+ * memory with a constant stride.  The addresses are prefetched the distance
+ * given by the backend parameter prefetch_distance ahead; nothing is done if
+ * it is 0.  Best run after opt_osr(), which turns array indices into pointer
+ * induction variables.
+ *
+ * @param irg   the graph
+ */
+FIRM_API void insert_prefetches(ir_graph *irg);
+
 /**
  * Check if we can replace the load by a given const from
  * the const code irg.
@@ -190,13 +240,15 @@ FIRM_API void opt_ldst(ir_graph *irg);
 
 /**
  * Optimize the frame type of an irg by removing
- * never touched entities.
+ * never touched entities and by letting address taken locals whose
+ * contents are never live at the same time share one slot.
  *
  * @param irg  The graph whose frame type will be optimized
  *
- * This function did not change the graph, only its frame type.
+ * Shared locals become members of a union placed on the frame, so the
+ * graph changes only if slots were shared.
  * The layout state of the frame type will be set to layout_undefined
- * if entities were removed.
+ * if entities were removed or merged.
  */
 FIRM_API void opt_frame_irg(ir_graph *irg);
 
@@ -269,6 +321,11 @@ typedef enum osr_flags {
  * Note further that tests for equality can be handled some simpler (but are not
  * implemented yet).
  *
+ * Afterwards, induction variables of a loop which only differ by a constant
+ * from another one with the same increment are expressed by that one, so
+ * a loop walking over several arrays with the same index keeps only one
+ * induction variable alive.
+ *
  * This algorithm destroys the link field of nodes.
  */
 FIRM_API void opt_osr(ir_graph *irg, unsigned flags);
@@ -296,8 +353,10 @@ FIRM_API void remove_phi_cycles(ir_graph *irg);
  * @param threshold   the threshold for cloning
  *
  * The threshold is an estimation of how many instructions are saved
- * when executing a cloned method. If threshold is 0.0, every possible
- * call is cloned.
+ * when executing a cloned method, weighted with the estimated execution
+ * frequency of the calls. If threshold is 0.0, every possible call is cloned.
+ * A clone is made only once for every constant argument and reused by all
+ * calls with this argument, including the calls in other clones.
  */
 FIRM_API void proc_cloning(float threshold);
 
@@ -366,10 +425,28 @@ FIRM_API void normalize_n_returns(ir_graph *irg);
  * Replaces local compound entities (like structures and arrays)
  * with atomic values if possible. Does not handle classes yet.
  *
+ * The replacement is field sensitive: members which are only loaded and
+ * stored directly are replaced even if the address of another member is
+ * taken or another member is indexed with a variable.  At most 64 values
+ * are created for an entity, preferring the most accessed members.
+ *
  * @param irg  the graph which should be optimized
  */
 FIRM_API void scalar_replacement_opt(ir_graph *irg);
 
+/**
+ * Promotes heap allocations to the stack frame.
+ *
+ * Calls to malloc with a small constant size whose result does not escape
+ * the function, i.e. is only used as the address of Loads and Stores,
+ * compared or freed, are replaced by frame entities and the matching calls
+ * to free are removed.  Scalar replacement is run on the promoted
+ * allocations afterwards.
+ *
+ * @param irg  the graph which should be optimized
+ */
+FIRM_API void opt_heap_to_stack(ir_graph *irg);
+
 /**
  * Optimizes tail-recursion calls by converting them into loops.
  * Depends on the flag opt_tail_recursion.
@@ -404,6 +481,13 @@ typedef void (*opt_ptr)(ir_graph *irg);
  * Heuristic inliner. Calculates a benefice value for every call and inlines
  * those calls with a value higher than the threshold.
  *
+ * The graphs are processed level by level bottom-up in the callgraph, and the
+ * graphs of a level are optimized with after_inline_opt before they are
+ * inlined into the graphs of the next level.
+ *
+ * If a profile has been loaded, rarely executed calls are not inlined, hot
+ * calls may exceed maxsize and the total growth of the program is limited.
+ *
  * @param maxsize             Do not inline any calls if a method has more than
  *                            maxsize firm nodes.  It may reach this limit by
  *                            inlining.
@@ -414,6 +498,18 @@ typedef void (*opt_ptr)(ir_graph *irg);
 FIRM_API void inline_functions(unsigned maxsize, int inline_threshold,
                                opt_ptr after_inline_opt);
 
+/**
+ * Promotes indirect calls to a guarded direct call of their most frequent
+ * target with the indirect call as fallback, so the target can be inlined.
+ * Only calls whose targets are recorded in the loaded profile are promoted,
+ * if the most frequent target receives at least @p min_probability of the
+ * calls.
+ *
+ * @param irg              the graph to optimize
+ * @param min_probability  the minimal share of the most frequent target
+ */
+FIRM_API void promote_indirect_calls(ir_graph *irg, double min_probability);
+
 /**
  * Combines congruent blocks into one.
  *
@@ -450,6 +546,33 @@ FIRM_API void do_loop_peeling(ir_graph *irg);
  */
 FIRM_API void garbage_collect_entities(void);
 
+/**
+ * Removes all unused entities like garbage_collect_entities() and
+ * additionally all types which are neither referenced by the remaining
+ * entities, graphs and types nor primitive types.
+ *
+ * The frontend must not keep references to types it may use later, as the
+ * removed types are freed.
+ */
+FIRM_API void garbage_collect_types(void);
+
+/**
+ * Optimizes a program merged from several units, see ir_lto_begin(), as a
+ * whole: The definitions of all global entities except for the @p n_keep
+ * entities in @p keep become local to the program.  Then the callees are
+ * analysed with cgana(), unreachable graphs are removed with gc_irgs(),
+ * functions are inlined with inline_functions() and unused entities and
+ * types are removed with garbage_collect_types().
+ *
+ * @param n_keep            number of entities in @p keep
+ * @param keep              the entities which stay visible outside, e.g. main
+ * @param inline_maxsize    see inline_functions()
+ * @param inline_threshold  see inline_functions()
+ */
+FIRM_API void optimize_whole_program(size_t n_keep, ir_entity **keep,
+                                     unsigned inline_maxsize,
+                                     int inline_threshold);
+
 /**
  * Performs dead node elimination by copying the ir graph to a new obstack.
  *
@@ -465,7 +588,7 @@ FIRM_API void garbage_collect_entities(void);
  *  not be in state phase_building.  The outs data structure is freed,
  *  the outs state set to outs_none.  Backedge information is conserved.
  *  Removes old attributes of nodes.  Sets link field to NULL.
- *  Callee information must be freed (irg_callee_info_none).
+ *  Callee information is kept.
  *
  * @param irg  The graph to be optimized.
  */
@@ -484,15 +607,46 @@ FIRM_API void dead_node_elimination(ir_graph *irg);
  * Call remove_critical_cf_edges() before place_code().  This normalizes
  * the control flow graph so that for all operations a basic block exists
  * where they can be optimally placed.
+ *
+ * Nodes are hoisted into a dominating block only if its execution frequency
+ * is lower.  The frequencies are taken from the profile if one is loaded and
+ * estimated otherwise.
  */
 FIRM_API void place_code(ir_graph *irg);
 
+/**
+ * Limits the number of nodes place_code() hoists out of each loop.  Every
+ * hoisted node is live through the loop, so this bounds the additional
+ * register pressure.
+ *
+ * Without an explicit limit place_code() hoists values only while the
+ * estimated register pressure of the loop stays below the register counts of
+ * the backend (see get_loop_register_pressure()).
+ *
+ * @param limit  the maximum number of hoisted nodes per loop, 0 to derive the
+ *               limit from the register pressure (the default)
+ */
+FIRM_API void set_place_code_loop_pressure(unsigned limit);
+
 /**
  * This optimization finds values where the bits are either constant or irrelevant
  * and exchanges them for a corresponding constant.
  */
 FIRM_API void occult_consts(ir_graph*);
 
+/**
+ * Removes computations of bits which are irrelevant for the program.
+ *
+ * Based on the don't care bits and the known bits of the integer nodes,
+ * nodes whose relevant bits are all known become constants, and And, Or,
+ * Eor, Add and Sub nodes which do not change the relevant bits of their
+ * result are replaced by their operand.  Runs in a single walk after the
+ * analyses, so it is cheap enough to be run after larger transformations.
+ *
+ * @param irg  the graph to optimize
+ */
+FIRM_API void dead_bits_elimination(ir_graph *irg);
+
 /**
  * Returns true if the value @p n is known not be zero/null.
  *
@@ -77,6 +77,18 @@ FIRM_API void compute_irg_outs(ir_graph *irg);
 /** Recomputes out edges if necessary */
 FIRM_API void assure_irg_outs(ir_graph *irg);
 
+/**
+ * Computes only the control flow successors of the blocks, which is cheaper
+ * than computing all out edges.  Afterwards the get_Block_cfg_out() family
+ * and irg_out_block_walk() may be used.  Sets the
+ * IR_GRAPH_PROPERTY_CONSISTENT_BLOCK_OUTS property.  compute_irg_outs()
+ * computes the block successors as well.
+ */
+FIRM_API void compute_irg_block_outs(ir_graph *irg);
+
+/** Recomputes the control flow successors of the blocks if necessary */
+FIRM_API void assure_irg_block_outs(ir_graph *irg);
+
 /** Frees memory occupied by out edges data structures */
 FIRM_API void free_irg_outs(ir_graph *irg);
 
@@ -241,6 +241,12 @@ FIRM_API size_t get_irp_n_asms(void);
 /** Returns the global asm include at position pos. */
 FIRM_API ident *get_irp_asm(size_t pos);
 
+/**
+ * Stores the number of bytes held by all graphs of the program including the
+ * constant code graph in @p usage, see ir_graph_memory_usage().
+ */
+FIRM_API void ir_program_memory_usage(ir_memory_usage_t *usage);
+
 /** @} */
 
 #include "end.h"
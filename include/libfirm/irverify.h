@@ -43,6 +43,25 @@ FIRM_API int irg_verify(ir_graph *irg);
  */
 FIRM_API void irg_assert_verify(ir_graph *irg);
 
+/**
+ * Like irg_verify(), but only checks the nodes of @p irg which were created
+ * or got new inputs since the graph was verified last.  If out edges are
+ * active, the users of these nodes are checked, too.  Changes of modes and
+ * attributes are not noticed, neither are global properties like the
+ * control flow checked.  So the first call for a graph and every call after
+ * the interval set with ir_set_verify_full_interval() verify the whole graph.
+ * @param irg  the IR-graph to check
+ * @return NON-zero if no problems were found
+ */
+FIRM_API int irg_verify_changed(ir_graph *irg);
+
+/**
+ * Sets after how many calls irg_verify_changed() verifies the whole graph
+ * again.  0 disables the full verification after the first one, the
+ * default is 16.
+ */
+FIRM_API void ir_set_verify_full_interval(unsigned interval);
+
 /** @} */
 
 #include "end.h"
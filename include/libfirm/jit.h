@@ -10,6 +10,8 @@
 #ifndef FIRM_JIT_H
 #define FIRM_JIT_H
 
+#include <stddef.h>
+
 #include "firm_types.h"
 
 #include "begin.h"
@@ -34,6 +36,35 @@ typedef struct ir_jit_segment_t ir_jit_segment_t;
  */
 typedef struct ir_jit_function_t ir_jit_function_t;
 
+/**
+ * Persistent cache of jit compiled functions.
+ */
+typedef struct ir_jit_cache_t ir_jit_cache_t;
+
+/**
+ * Environment for lazily compiled functions which are recompiled when they
+ * are called often.
+ */
+typedef struct ir_jit_tiering_t ir_jit_tiering_t;
+
+/**
+ * Backend state shared by the functions compiled in a jit session.
+ */
+typedef struct ir_jit_session_t ir_jit_session_t;
+
+/**
+ * How a jit segment maps its executable memory.
+ */
+typedef enum ir_jit_memory_flags_t {
+	IR_JIT_MEMORY_DEFAULT      = 0,
+	/** back the code with huge pages if the host provides them */
+	IR_JIT_MEMORY_HUGE_PAGES   = 1u << 0,
+	/** map the code twice, once writable and once executable, instead of
+	 * changing the protection while code is installed */
+	IR_JIT_MEMORY_DUAL_MAPPING = 1u << 1,
+} ir_jit_memory_flags_t;
+ENUM_BITSET(ir_jit_memory_flags_t)
+
 /**
  * Create a new jit segment.
  */
@@ -62,6 +93,29 @@ FIRM_API void const *be_jit_get_entity_addr(ir_entity const *entity);
 FIRM_API ir_jit_function_t *be_jit_compile(ir_jit_segment_t *segment,
                                            ir_graph *irg);
 
+/**
+ * Begins a jit session.  The program is lowered for the target and the
+ * backend is initialized once, so compiling a function with
+ * be_jit_session_compile() only runs the per-function steps.  Data shared by
+ * the whole program, like entities of constants and PIC trampolines, is kept
+ * until the session is destroyed.  Only one session may be active at a time
+ * and no code may be generated with be_main() meanwhile.
+ */
+FIRM_API ir_jit_session_t *be_new_jit_session(void);
+
+/**
+ * Ends jit session \p session.  Functions compiled in the session stay valid.
+ */
+FIRM_API void be_destroy_jit_session(ir_jit_session_t *session);
+
+/**
+ * Like be_jit_compile(), but compiles \p irg in \p session.  \p irg must have
+ * been lowered for the target when the session began.
+ */
+FIRM_API ir_jit_function_t *be_jit_session_compile(ir_jit_session_t *session,
+                                                   ir_jit_segment_t *segment,
+                                                   ir_graph *irg);
+
 /**
  * Return the buffer size necessary to emit \p function with be_emit_function().
  */
@@ -72,6 +126,126 @@ FIRM_API unsigned be_get_function_size(ir_jit_function_t const *function);
  */
 FIRM_API void be_emit_function(char *buffer, ir_jit_function_t *function);
 
+/**
+ * Sets how \p segment maps its executable memory.  Must be called before
+ * the first function is installed in \p segment.
+ */
+FIRM_API void be_jit_set_memory_flags(ir_jit_segment_t *segment,
+                                      ir_jit_memory_flags_t flags);
+
+/**
+ * Copies the \p n_functions functions in \p functions into executable memory
+ * owned by \p segment, resolves their relocations and stores their addresses
+ * in \p addresses.  The memory is allocated from pooled chunks and the
+ * protection of a chunk changes at most twice per call, so installing
+ * functions in batches is cheaper than installing them one by one.  Code
+ * already installed in \p segment must not run while the protection is
+ * changed, unless the segment uses IR_JIT_MEMORY_DUAL_MAPPING.
+ */
+FIRM_API void be_jit_install_functions(ir_jit_segment_t *segment,
+                                       size_t n_functions,
+                                       ir_jit_function_t *const *functions,
+                                       void const **addresses);
+
+/**
+ * Releases the code at \p address installed by be_jit_install_functions().
+ */
+FIRM_API void be_jit_free_code(ir_jit_segment_t *segment, void const *address);
+
+/**
+ * Returns memory chunks of \p segment which contain no code anymore to the
+ * operating system.
+ */
+FIRM_API void be_jit_compact_memory(ir_jit_segment_t *segment);
+
+/**
+ * A site in jit compiled code, which refers to the address of an entity, like
+ * the target of a call or an address loaded into a register.
+ */
+typedef struct ir_jit_site_t {
+	unsigned   offset; /**< offset of the site from the start of the function */
+	ir_entity *entity; /**< entity the site refers to */
+	int        addend; /**< constant added to the address of the entity */
+} ir_jit_site_t;
+
+/**
+ * Returns the number of sites of \p function, which refer to entities.
+ */
+FIRM_API size_t be_jit_get_n_sites(ir_jit_function_t const *function);
+
+/**
+ * Stores the \p index-th site of \p function in \p site.
+ */
+FIRM_API void be_jit_get_site(ir_jit_function_t const *function, size_t index,
+                              ir_jit_site_t *site);
+
+/**
+ * Rewrites the \p index-th site of \p function, which was installed at
+ * \p code in \p segment, to refer to \p address instead of the address of
+ * its entity.  This allows to re-link calls to a recompiled function or to
+ * update an inline cache without compiling the function again.  Returns true
+ * if the site was written by a single atomic store, so threads executing the
+ * code concurrently see either the old or the new site.  Otherwise, the code
+ * must not run while it is patched.  Unless \p segment uses
+ * IR_JIT_MEMORY_DUAL_MAPPING, the protection of the code is changed while it
+ * is patched, so it must never run concurrently.
+ */
+FIRM_API int be_jit_patch_site(ir_jit_segment_t *segment, void const *code,
+                               ir_jit_function_t const *function, size_t index,
+                               void const *address);
+
+/**
+ * Opens the code cache stored in the file \p filename.  A missing or
+ * unusable file results in an empty cache.
+ */
+FIRM_API ir_jit_cache_t *be_jit_open_cache(char const *filename);
+
+/**
+ * Writes functions added to \p cache back to its file and closes it.
+ * Functions loaded from the cache stay valid.
+ */
+FIRM_API void be_jit_close_cache(ir_jit_cache_t *cache);
+
+/**
+ * Like be_jit_compile(), but looks up \p irg in \p cache first.  Functions
+ * are found by a structural fingerprint of the graph and the backend
+ * options, so the graph may be constructed again by a different process.
+ * On a hit the graph is left untouched, otherwise the compiled function is
+ * added to the cache.  Relocations to entities are resolved by their linker
+ * names when the function is loaded.  Graphs containing inline assembler are
+ * never cached.
+ */
+FIRM_API ir_jit_function_t *be_jit_compile_cached(ir_jit_cache_t *cache,
+                                                  ir_jit_segment_t *segment,
+                                                  ir_graph *irg);
+
+/**
+ * Creates a tiering environment.  Its functions are compiled with the
+ * linear scan register allocator on their first call and compiled again
+ * with the default pipeline after \p hot_threshold calls.  If \p optimize
+ * is not NULL, it is applied to the graph before the second compilation.
+ * The compilers run inside the calls of the functions, so they must not be
+ * called by several threads while code is compiled.
+ */
+FIRM_API ir_jit_tiering_t *be_new_jit_tiering(unsigned hot_threshold,
+                                              void (*optimize)(ir_graph *irg));
+
+/**
+ * Destroys \p tiering and the code of its functions.
+ */
+FIRM_API void be_destroy_jit_tiering(ir_jit_tiering_t *tiering);
+
+/**
+ * Adds \p irg to \p tiering and returns the address of a stub calling it.
+ * The stub compiles the function when needed, counts the calls and forwards
+ * them to the current code.  The stub is also set as the jit address of the
+ * entity of \p irg, so jit compiled callers use it.  The graph must stay
+ * alive until the function is compiled for the second time.  Returns NULL if
+ * the parameters or results of \p irg cannot be forwarded by a stub.
+ */
+FIRM_API void const *be_jit_add_lazy_function(ir_jit_tiering_t *tiering,
+                                              ir_graph *irg);
+
 /** @} */
 
 #include "end.h"
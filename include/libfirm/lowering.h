@@ -55,6 +55,10 @@
  * - 'medium': Nothing.
  * - 'large':  Replace it with a call to memcpy.
  *
+ * If misalignments are allowed, small CopyBs are copied in chunks of
+ * backend_params::mode_vector_move (or the machine word if it is NULL) and a
+ * remainder is copied by one access overlapping the previous chunk.
+ *
  * max_small_size and min_large_size allow for a flexible configuration.
  * For example, one backend could specify max_small_size == 0 and
  * min_large_size == 8192 to keep all CopyB nodes smaller than 8192 and get
@@ -80,7 +84,11 @@ FIRM_API void lower_CopyB(ir_graph *irg, unsigned max_small_size,
 
 /**
  * Lowers all Switches (Cond nodes with non-boolean mode) depending on spare_size.
- * They will either remain the same or be converted into if-cascades.
+ * They will either remain the same or be converted into a search tree.  The
+ * tree tests dense ranges of cases with smaller jump tables and ranges of
+ * cases with few targets with bit masks, the remaining cases are compared one
+ * by one.  The tree is balanced by the execution counts of the cases if a
+ * profile has been loaded, by the number of cases otherwise.
  *
  * @param irg        The ir graph to be lowered.
  * @param small_switch  If switch has <= cases then change it to an if-cascade.
@@ -366,6 +374,8 @@ FIRM_API int i_mapper_strlen(ir_node *call);
 
 /**
  * A mapper for the memcpy-Function: void pointer memcpy(void pointer d, void pointer s, inttype c);
+ * Copies of a constant size are replaced by a CopyB node, which lower_CopyB()
+ * expands to Loads/Stores or a memcpy call depending on the size.
  *
  * @return 1 if the memcpy call was removed, 0 else.
  */
@@ -380,15 +390,20 @@ FIRM_API int i_mapper_memmove(ir_node *call);
 
 /**
  * A mapper for the memset-Function: void pointer memset(void pointer d, inttype C, inttype len);
+ * Small constant sizes are expanded into Stores if the backend supports
+ * misaligned memory accesses.
  *
  * @return 1 if the memset call was removed, 0 else.
  */
 FIRM_API int i_mapper_memset(ir_node *call);
 
 /**
- * A mapper for the strncmp-Function: inttype memcmp(void pointer a, void pointer b, inttype len);
+ * A mapper for the memcmp-Function: inttype memcmp(void pointer a, void pointer b, inttype len);
+ * Small constant sizes whose result is only compared against zero for
+ * (in)equality are expanded into Loads if the backend supports misaligned
+ * memory accesses.
  *
- * @return 1 if the strncmp call was removed, 0 else.
+ * @return 1 if the memcmp call was removed, 0 else.
  */
 FIRM_API int i_mapper_memcmp(ir_node *call);
 
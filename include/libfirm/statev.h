@@ -60,6 +60,18 @@ FIRM_API void stat_ev(const char *name);
  */
 FIRM_API void stat_ev_begin(const char *filename_prefix, const char *filter);
 
+/**
+ * Initialize the stat ev machinery writing a binary event stream to
+ * @p filename_prefix with .evb appended.  The stream is written through a
+ * large buffer and is much cheaper to produce than the text format,
+ * scripts/statev_decode.py converts it back to text or to CSV.
+ * @param filename_prefix  The name of the file without extension.
+ *                         File will be truncated!
+ * @param filter           The filter as for stat_ev_begin().
+ */
+FIRM_API void stat_ev_begin_binary(const char *filename_prefix,
+                                   const char *filter);
+
 /**
  * Shuts down stat ev machinery
  */
@@ -10,6 +10,9 @@
 #ifndef FIRM_TIMING_H
 #define FIRM_TIMING_H
 
+#include <stdio.h>
+
+#include "firm_types.h"
 #include "begin.h"
 
 /**
@@ -114,6 +117,69 @@ FIRM_API unsigned long ir_timer_elapsed_usec(const ir_timer_t *timer);
  */
 FIRM_API double ir_timer_elapsed_sec(const ir_timer_t *timer);
 
+/**
+ * @defgroup ir_timing  Pass Profile
+ *
+ * A hierarchical profile of the compilation.  Passes open named scopes which
+ * nest into a tree.  For every scope the wallclock time, the consumed CPU
+ * time, the growth of the obstack and of the total memory of the graph it
+ * works on (see ir_graph_memory_usage()) and the number of nodes created are
+ * recorded.  The profile is written as Chrome trace events (viewable in
+ * chrome://tracing or Perfetto), which also show the memory held per category
+ * at the end of each scope, or as a flat per-name summary.
+ * @{
+ */
+
+/**
+ * Enables or disables recording of the pass profile.
+ * Enabling discards the scopes recorded so far, disabling keeps them so
+ * they can still be written.
+ */
+FIRM_API void ir_timing_enable(int enable);
+
+/**
+ * Returns non-zero if the pass profile is being recorded.
+ */
+FIRM_API int ir_timing_is_enabled(void);
+
+/**
+ * Opens a new scope nested into the currently open one.
+ * Does nothing if the profile is not enabled.
+ *
+ * @param name  The name of the scope, e.g. the pass or the graph.
+ * @param irg   The graph the scope works on; NULL to inherit the graph of
+ *              the enclosing scope.
+ */
+FIRM_API void ir_timing_scope_push(const char *name, ir_graph *irg);
+
+/**
+ * Closes the innermost open scope, which must be named @p name.
+ * Does nothing if the profile is not enabled.
+ */
+FIRM_API void ir_timing_scope_pop(const char *name);
+
+/**
+ * Adds @p value to the counter @p name of the innermost open scope.
+ * Passes use this to attach their own measurements, like the number of
+ * spills, to the scope; they are written as arguments of the trace event.
+ * Does nothing if the profile is not enabled.
+ */
+FIRM_API void ir_timing_scope_add(const char *name, double value);
+
+/**
+ * Writes the recorded scopes as a Chrome trace event JSON document.
+ * Scopes still open are written as ending now.
+ */
+FIRM_API void ir_timing_write_chrome_trace(FILE *out);
+
+/**
+ * Writes a flat summary of the recorded scopes, aggregated by name and
+ * sorted by the time spent in the scopes themselves without their children.
+ */
+FIRM_API void ir_timing_write_summary(FILE *out);
+
+/** @} */
+
 #include "end.h"
 
 #endif
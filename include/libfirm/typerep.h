@@ -263,7 +263,8 @@ FIRM_API int check_entity(const ir_entity *ent);
  * Create a new entity with attributes copied from an existing entity.
  *
  * Does not copy the overwrites/overwritte_by, visited an dusage fields, sets
- * a new name and inserts the entity into \p owner.
+ * a new name, which is the linker name, too, and inserts the entity into
+ * \p owner.
  */
 FIRM_API ir_entity *clone_entity(ir_entity const *old, ident *name,
                                  ir_type *owner);
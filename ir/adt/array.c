@@ -9,6 +9,7 @@
  * @author      Markus Armbruster
  */
 #include <stdlib.h>
+#include <string.h>
 
 #include "array.h"
 #include "util.h"
@@ -17,6 +18,12 @@
 
 #define ARR_D_MAGIC FOURCC('A','R','R','D')
 #define ARR_F_MAGIC FOURCC('A','R','R','F')
+#define ARR_A_MAGIC FOURCC('A','R','R','A')
+
+/** Smallest number of elements allocated when an array grows. */
+#define ARR_MIN_ALLOCATED 4
+
+static ir_arr_statistics_t statistics;
 
 /**
  * An empty dynamic array descriptor.
@@ -27,7 +34,8 @@ void ir_verify_arr(const void *arr)
 {
 #ifndef NDEBUG
 	ir_arr_descr *const descr = ARR_DESCR(arr);
-	assert(descr->magic == ARR_D_MAGIC || descr->magic == ARR_F_MAGIC);
+	assert(descr->magic == ARR_D_MAGIC || descr->magic == ARR_F_MAGIC
+	    || descr->magic == ARR_A_MAGIC);
 	assert(descr->allocated >= descr->nelts);
 #else
 	(void) arr;
@@ -45,12 +53,63 @@ void *ir_new_arr_d(struct obstack *obstack, size_t nelts, size_t elts_size)
 	return dp->elts;
 }
 
+void *ir_init_arr_d(void *mem, size_t nelts)
+{
+	ir_arr_descr *const dp = (ir_arr_descr*)mem;
+#ifndef NDEBUG
+	dp->magic = ARR_D_MAGIC;
+#endif
+	dp->allocated = dp->nelts = nelts;
+	return dp->elts;
+}
+
+void *ir_init_arr_a(void *mem, size_t capacity)
+{
+	ir_arr_descr *const dp = (ir_arr_descr*)mem;
+	/* the magic marks the buffer as not owned by the array, even in release
+	 * builds */
+	dp->magic     = ARR_A_MAGIC;
+	dp->allocated = capacity;
+	dp->nelts     = 0;
+	return dp->elts;
+}
+
+/**
+ * Returns the number of elements to allocate for an array growing from
+ * @p allocated to @p nelts elements.  Doubling keeps the number of
+ * reallocations logarithmic in the final length.
+ */
+static size_t grow_allocated(size_t allocated, size_t nelts)
+{
+	size_t n = MAX(ARR_MIN_ALLOCATED, allocated);
+	while (nelts > n)
+		n <<= 1;
+	return n;
+}
+
+/**
+ * Moves an array out of its stack buffer into a new flexible array with
+ * room for @p allocated elements.
+ */
+static ir_arr_descr *move_to_heap(ir_arr_descr const *const dp,
+                                  size_t allocated, size_t eltsize)
+{
+	size_t        const bytes = eltsize * MIN(dp->nelts, allocated);
+	ir_arr_descr *const res
+		= (ir_arr_descr*)xmalloc(sizeof(*res) + eltsize * allocated);
+	memcpy(res->elts, dp->elts, bytes);
+	res->magic     = ARR_F_MAGIC;
+	res->allocated = allocated;
+	++statistics.resizes;
+	statistics.bytes_copied += bytes;
+	return res;
+}
+
 void *ir_new_arr_f(size_t nelts, size_t elts_size)
 {
 	ir_arr_descr *const dp = (ir_arr_descr*)xmalloc(sizeof(*dp)+elts_size);
-#ifndef NDEBUG
+	/* always set, so stack buffer arrays can be told apart */
 	dp->magic = ARR_F_MAGIC;
-#endif
 	dp->allocated = dp->nelts = nelts;
 	return dp->elts;
 }
@@ -60,11 +119,16 @@ void DEL_ARR_F(void *elts)
 	ir_verify_arr(elts);
 
 	ir_arr_descr *const dp = ARR_DESCR(elts);
+	if (dp->magic == ARR_A_MAGIC) {
+		/* still in its stack buffer */
+		dp->magic = 0xdeadbeef;
+		return;
+	}
 	assert(dp->magic == ARR_F_MAGIC);
 #ifndef NDEBUG
 	dp->magic = 0xdeadbeef;
 #endif
-	free(dp);
+	xfree(dp);
 }
 
 void *ir_arr_setlen(void *elts, size_t nelts, size_t elts_size)
@@ -72,7 +136,16 @@ void *ir_arr_setlen(void *elts, size_t nelts, size_t elts_size)
 	ir_verify_arr(elts);
 
 	ir_arr_descr *dp = ARR_DESCR(elts);
+	if (dp->magic == ARR_A_MAGIC) {
+		if (nelts > dp->allocated)
+			dp = move_to_heap(dp, nelts, elts_size / nelts);
+		dp->nelts = nelts;
+		return dp->elts;
+	}
 	assert(dp->magic == ARR_F_MAGIC);
+	++statistics.resizes;
+	if (nelts > 0)
+		statistics.bytes_copied += MIN(dp->nelts, nelts) * (elts_size / nelts);
 	dp = (ir_arr_descr*)xrealloc(dp, sizeof(*dp)+elts_size);
 	dp->allocated = dp->nelts = nelts;
 	return dp->elts;
@@ -83,17 +156,29 @@ void *ir_arr_resize(void *elts, size_t nelts, size_t eltsize)
 	ir_verify_arr(elts);
 
 	ir_arr_descr *dp = ARR_DESCR(elts);
+	if (dp->magic == ARR_A_MAGIC) {
+		/* the stack buffer is never shrunk */
+		if (nelts > dp->allocated)
+			dp = move_to_heap(dp, grow_allocated(dp->allocated, nelts), eltsize);
+		dp->nelts = nelts;
+		return dp->elts;
+	}
 	assert(dp->magic == ARR_F_MAGIC);
 
-	/* @@@ lots of resizes for small nelts */
-	size_t n = MAX(1, dp->allocated);
-	while (nelts > n)
-		n <<= 1;
-	while (3*nelts < n)
-		n >>= 1;
+	/* Grow geometrically, but only shrink once less than a quarter is used,
+	 * so alternating appends and removals do not reallocate every time. */
+	size_t n = dp->allocated;
+	if (nelts > n) {
+		n = grow_allocated(n, nelts);
+	} else {
+		while (n > ARR_MIN_ALLOCATED && 4*nelts < n)
+			n >>= 1;
+	}
 	assert(n >= nelts);
 
 	if (n != dp->allocated) {
+		++statistics.resizes;
+		statistics.bytes_copied += eltsize * MIN(dp->nelts, n);
 		dp = (ir_arr_descr*)xrealloc(dp, sizeof(*dp) + eltsize*n);
 		dp->allocated = n;
 	}
@@ -102,6 +187,42 @@ void *ir_arr_resize(void *elts, size_t nelts, size_t eltsize)
 	return dp->elts;
 }
 
+void *ir_arr_resize_d(struct obstack *obstack, void *elts, size_t nelts,
+                      size_t eltsize)
+{
+	ir_verify_arr(elts);
+
+	ir_arr_descr *dp = ARR_DESCR(elts);
+	assert(dp->magic == ARR_D_MAGIC);
+	if (nelts > dp->allocated) {
+		size_t        const n     = grow_allocated(dp->allocated, nelts);
+		size_t        const bytes = eltsize * dp->nelts;
+		ir_arr_descr *const res
+			= (ir_arr_descr*)obstack_alloc(obstack, sizeof(*res) + eltsize*n);
+		memcpy(res->elts, dp->elts, bytes);
+#ifndef NDEBUG
+		res->magic = ARR_D_MAGIC;
+#endif
+		res->allocated = n;
+		++statistics.resizes;
+		statistics.bytes_copied += bytes;
+		dp = res;
+	}
+	dp->nelts = nelts;
+
+	return dp->elts;
+}
+
+void ir_arr_get_statistics(ir_arr_statistics_t *stats)
+{
+	*stats = statistics;
+}
+
+void ir_arr_reset_statistics(void)
+{
+	memset(&statistics, 0, sizeof(statistics));
+}
+
 #ifdef DEBUG_libfirm
 /* forward declarations to avoid warnings */
 size_t array_len(const void *arr);
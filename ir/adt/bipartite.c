@@ -36,8 +36,8 @@ bipartite_t *bipartite_new(unsigned const n_left, unsigned const n_right)
 void bipartite_free(bipartite_t *const gr)
 {
 	for (unsigned i = 0; i < gr->n_left; ++i)
-		free(gr->adj[i]);
-	free(gr);
+		xfree(gr->adj[i]);
+	xfree(gr);
 }
 
 void bipartite_add(bipartite_t *const gr, unsigned const i, unsigned const j)
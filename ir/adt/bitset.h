@@ -386,6 +386,42 @@ static inline void bitset_xor(bitset_t *tgt, bitset_t const *src)
 	rbitset_xor(tgt->data, src->data, src->size);
 }
 
+/**
+ * Perform tgt = tgt & src operation.
+ * @param tgt  The target bitset.
+ * @param src  The source bitset.
+ * @return true if tgt changed.
+ */
+static inline bool bitset_and_changed(bitset_t *tgt, bitset_t const *src)
+{
+	assert(tgt->size == src->size);
+	return rbitset_and_changed(tgt->data, src->data, src->size);
+}
+
+/**
+ * Perform tgt = tgt & ~src operation.
+ * @param tgt  The target bitset.
+ * @param src  The source bitset.
+ * @return true if tgt changed.
+ */
+static inline bool bitset_andnot_changed(bitset_t *tgt, bitset_t const *src)
+{
+	assert(tgt->size == src->size);
+	return rbitset_andnot_changed(tgt->data, src->data, src->size);
+}
+
+/**
+ * Perform Union, tgt = tgt u src operation.
+ * @param tgt  The target bitset.
+ * @param src  The source bitset.
+ * @return true if tgt changed.
+ */
+static inline bool bitset_or_changed(bitset_t *tgt, bitset_t const *src)
+{
+	assert(tgt->size == src->size);
+	return rbitset_or_changed(tgt->data, src->data, src->size);
+}
+
 /**
  * Copy a raw bitset into an bitset.
  */
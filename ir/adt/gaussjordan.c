@@ -109,7 +109,7 @@ int firm_gaussjordansolve(double *A, double *vec, unsigned nsize)
 
 	/* answer needs sorting */
 	for (unsigned i = nsize - 1; i-- > 0;) {
-		int sum = 0;
+		double sum = 0;
 		for (unsigned j = i+1; j < nsize; ++j)
 			sum += _A(i,j) * scramvec[j];
 		scramvec[i] = (vec[i] - sum) / _A(i,i);
@@ -121,8 +121,8 @@ int firm_gaussjordansolve(double *A, double *vec, unsigned nsize)
 	}
 
 end:
-	free(x);
-	free(scramvec);
+	xfree(x);
+	xfree(scramvec);
 
 	return res;
 }
@@ -18,12 +18,38 @@ typedef struct {
 	col_val_t *cols;
 } row_col_t;
 
+/**
+ * Compressed sparse row form of a matrix, created by gs_matrix_freeze().
+ * The off-diagonal entries of row r are at positions row_start[r] to
+ * row_start[r+1]-1 of cols and vals.
+ */
+typedef struct {
+	unsigned *row_start;
+	unsigned *cols;
+	double   *vals;
+	double   *diag;      /**< inverted diagonal */
+} csr_t;
+
 struct gs_matrix_t {
 	unsigned   c_rows;
 	unsigned   n_zero_entries; /**< Upper bound on number of 0 entries */
 	row_col_t *rows;
+	csr_t     *csr;            /**< frozen form, NULL if not frozen */
 };
 
+static void free_csr(gs_matrix_t *m)
+{
+	csr_t *csr = m->csr;
+	if (csr == NULL)
+		return;
+	xfree(csr->row_start);
+	xfree(csr->cols);
+	xfree(csr->vals);
+	xfree(csr->diag);
+	xfree(csr);
+	m->csr = NULL;
+}
+
 static void alloc_cols(row_col_t *row, unsigned c_cols)
 {
 	assert(c_cols > row->c_cols);
@@ -58,13 +84,14 @@ gs_matrix_t *gs_new_matrix(unsigned n_init_rows, unsigned n_init_cols)
 
 void gs_delete_matrix(gs_matrix_t *m)
 {
+	free_csr(m);
 	for (unsigned i = 0; i < m->c_rows; ++i) {
 		if (m->rows[i].c_cols)
-			free(m->rows[i].cols);
+			xfree(m->rows[i].cols);
 	}
 	if (m->c_rows)
-		free(m->rows);
-	free(m);
+		xfree(m->rows);
+	xfree(m);
 }
 
 unsigned gs_matrix_get_n_entries(const gs_matrix_t *m)
@@ -83,6 +110,7 @@ void gs_matrix_set(gs_matrix_t *m, unsigned row, unsigned col, double val)
 	assert(row < m->c_rows);
 	assert(col < m->c_rows);
 	row_col_t *the_row = &m->rows[row];
+	free_csr(m);
 
 	if (row == col) {
 		/* Note that we store the diagonal inverted to turn divisions to mults
@@ -155,6 +183,66 @@ double gs_matrix_get(const gs_matrix_t *m, unsigned row, unsigned col)
 	return the_row->cols[c].v;
 }
 
+void gs_matrix_freeze(gs_matrix_t *m)
+{
+	free_csr(m);
+
+	unsigned const n         = m->c_rows;
+	unsigned       n_entries = 0;
+	for (unsigned r = 0; r < n; ++r) {
+		n_entries += m->rows[r].n_cols;
+	}
+
+	csr_t *csr     = XMALLOC(csr_t);
+	csr->row_start = XMALLOCN(unsigned, n + 1);
+	csr->cols      = XMALLOCN(unsigned, n_entries);
+	csr->vals      = XMALLOCN(double, n_entries);
+	csr->diag      = XMALLOCN(double, n);
+
+	unsigned pos = 0;
+	for (unsigned r = 0; r < n; ++r) {
+		row_col_t const *row = &m->rows[r];
+		csr->row_start[r] = pos;
+		csr->diag[r]      = row->diag;
+		for (unsigned c = 0; c < row->n_cols; ++c) {
+			/* explicitly set zeros do not contribute */
+			if (row->cols[c].v == 0.0)
+				continue;
+			csr->cols[pos] = row->cols[c].col_idx;
+			csr->vals[pos] = row->cols[c].v;
+			++pos;
+		}
+	}
+	csr->row_start[n] = pos;
+	m->csr = csr;
+}
+
+/**
+ * One successive over-relaxation sweep on the frozen matrix.
+ * Returns the sum of the absolute changes of x.
+ */
+static double csr_sor(const csr_t *csr, unsigned n, double *x, double omega)
+{
+	unsigned const *const row_start = csr->row_start;
+	unsigned const *const cols      = csr->cols;
+	double   const *const vals      = csr->vals;
+
+	double res = 0.0;
+	for (unsigned r = 0; r < n; ++r) {
+		double sum = 0.0;
+		for (unsigned i = row_start[r], e = row_start[r + 1]; i < e; ++i) {
+			sum += vals[i] * x[cols[i]];
+		}
+
+		double old = x[r];
+		double gs  = -sum * csr->diag[r];
+		double nw  = old + omega * (gs - old);
+		res += fabs(old - nw);
+		x[r] = nw;
+	}
+	return res;
+}
+
 /* NOTE: You can slice out miss_rate and weights.
  * This does ONE step of gauss_seidel. Termination must be checked outside!
  * This solves m*x=0. You must add stuff for m*x=b. See wikipedia german and english article. Should be simple.
@@ -164,6 +252,9 @@ double gs_matrix_get(const gs_matrix_t *m, unsigned row, unsigned col)
  * */
 double gs_matrix_gauss_seidel(const gs_matrix_t *m, double *x)
 {
+	if (m->csr != NULL)
+		return csr_sor(m->csr, m->c_rows, x, 1.0);
+
 	double res = 0.0;
 	unsigned n = m->c_rows;
 
@@ -187,6 +278,65 @@ double gs_matrix_gauss_seidel(const gs_matrix_t *m, double *x)
 	return res;
 }
 
+/** Number of sweeps over which the convergence rate is measured. */
+#define SOR_ADAPT_SWEEPS 16
+/** Upper bound for the relaxation factor. */
+#define SOR_MAX_OMEGA    1.95
+
+unsigned gs_matrix_solve(gs_matrix_t *m, double *x, double tolerance,
+                         unsigned max_iterations)
+{
+	if (m->csr == NULL)
+		gs_matrix_freeze(m);
+
+	/* Start with Gauss-Seidel (omega = 1) and adapt omega after every
+	 * SOR_ADAPT_SWEEPS sweeps (Hageman and Young): The observed convergence
+	 * rate lambda of SOR with factor omega gives an estimate of the squared
+	 * spectral radius of the Jacobi iteration
+	 *   mu^2 = (lambda + omega - 1)^2 / (lambda * omega^2)
+	 * and thus of the optimal factor 2 / (1 + sqrt(1 - mu^2)). The factor
+	 * only grows, unless the iteration stops converging. */
+	double   omega  = 1.0;
+	double   window = 0.0;
+	double   prev   = HUGE_VAL;
+	bool     changed = false;
+	unsigned iter;
+	for (iter = 0; iter < max_iterations; ++iter) {
+		double const res = csr_sor(m->csr, m->c_rows, x, omega);
+		if (res <= tolerance)
+			return iter + 1;
+
+		/* The changes oscillate once omega > 1, so compare the sums over
+		 * whole windows of sweeps. */
+		window += res;
+		if ((iter + 1) % SOR_ADAPT_SWEEPS != 0)
+			continue;
+		double const rate = pow(window / prev, 1.0 / SOR_ADAPT_SWEEPS);
+		prev   = window;
+		window = 0.0;
+		/* the window after a change of omega shows transient effects */
+		if (changed) {
+			changed = false;
+			continue;
+		}
+		if (!(rate < 1.0)) {
+			changed = omega != 1.0;
+			omega   = 1.0;
+			continue;
+		}
+		double const d   = rate + omega - 1.0;
+		double const mu2 = d * d / (rate * omega * omega);
+		if (mu2 < 1.0) {
+			double const opt = MIN(2.0 / (1.0 + sqrt(1.0 - mu2)), SOR_MAX_OMEGA);
+			if (opt > omega) {
+				omega   = opt;
+				changed = true;
+			}
+		}
+	}
+	return iter;
+}
+
 void gs_matrix_dump(const gs_matrix_t *m, FILE *out)
 {
 	unsigned size  = m->c_rows;
@@ -213,5 +363,5 @@ void gs_matrix_dump(const gs_matrix_t *m, FILE *out)
 		fprintf(out, "\n");
 	}
 
-	free(elems);
+	xfree(elems);
 }
@@ -35,6 +35,12 @@
  *                             them on demand from the datavalues. (useful if
  *                             calculating the hash-values takes less time than
  *                             a memory access)</li>
+ *  <li><b>GROUP_PROBING</b>   Keep one control byte per bucket holding 7 bits
+ *                             of the hash value and probe groups of 16 buckets
+ *                             at once (SSE2 where available). Keys are only
+ *                             compared for buckets whose control byte matches,
+ *                             so probes rarely touch the entries. Must also be
+ *                             defined when including hashset.h.</li>
  * </ul>
  *
  * You can further fine tune your hashset by defining the following:
@@ -56,6 +62,17 @@
 
 #include "bitfiddle.h"
 
+#ifdef GROUP_PROBING
+#include <string.h>
+#include "xmalloc.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef HAVE_OWN_RESIZE
+#error "GROUP_PROBING does not support HAVE_OWN_RESIZE"
+#endif
+#endif /* GROUP_PROBING */
+
 /* quadratic probing */
 #ifndef JUMP
 #define JUMP(num_probes)      (num_probes)
@@ -80,7 +97,7 @@
 #ifndef Alloc
 #include "xmalloc.h"
 #define Alloc(size) XMALLOCN(HashSetEntry, (size))
-#define Free(ptr)      free(ptr)
+#define Free(ptr)      xfree(ptr)
 #endif /* Alloc */
 
 #ifdef ID_HASH
@@ -159,6 +176,60 @@
 
 #define ILLEGAL_POS       ((size_t)-1)
 
+#ifdef GROUP_PROBING
+/** number of buckets probed at once, the bucket count is a multiple of it */
+#define GROUP_SIZE        16
+/** control byte of an empty bucket */
+#define CTRL_EMPTY        ((unsigned char)0x80)
+/** control byte of a deleted bucket */
+#define CTRL_DELETED      ((unsigned char)0xFE)
+/** the 7 hash bits stored in the control byte of a used bucket */
+#define CtrlHash(hash)    ((unsigned char)(((hash) ^ ((hash) >> 7) ^ ((hash) >> 14) ^ ((hash) >> 21) ^ ((hash) >> 28)) & 0x7F))
+
+/**
+ * Returns a bitmask of the buckets in the group starting at @p ctrl whose
+ * control byte equals @p c.
+ * @internal
+ */
+static inline unsigned group_match(const unsigned char *ctrl, unsigned char c)
+{
+#ifdef __SSE2__
+	__m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+	return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)c)));
+#else
+	unsigned res = 0;
+	for (unsigned i = 0; i < GROUP_SIZE; ++i)
+		res |= (unsigned)(ctrl[i] == c) << i;
+	return res;
+#endif
+}
+
+/**
+ * Returns a bitmask of the empty or deleted buckets in the group starting at
+ * @p ctrl.
+ * @internal
+ */
+static inline unsigned group_match_free(const unsigned char *ctrl)
+{
+#ifdef __SSE2__
+	return (unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+#else
+	unsigned res = 0;
+	for (unsigned i = 0; i < GROUP_SIZE; ++i)
+		res |= (unsigned)(ctrl[i] >> 7) << i;
+	return res;
+#endif
+}
+
+#ifdef DO_REHASH
+#define GroupEntryMatches(self,entry,hash,key) \
+	KeysEqual(self, GetKey(EntryGetValue(entry)), key)
+#else
+#define GroupEntryMatches(self,entry,hash,key) \
+	(EntryGetHash(self, entry) == (hash) && KeysEqual(self, GetKey(EntryGetValue(entry)), key))
+#endif
+#endif /* GROUP_PROBING */
+
 #ifdef hashset_size
 /**
  * Returns the number of elements in the hashset
@@ -183,6 +254,44 @@ static inline size_t hashset_size(const HashSet *self)
  */
 static inline FindReturnValue insert_nogrow(HashSet *self, KeyType key)
 {
+#ifdef GROUP_PROBING
+	size_t        num_probes = 0;
+	size_t        groupmask  = self->num_buckets / GROUP_SIZE - 1;
+	unsigned      hash       = Hash(self, key);
+	unsigned char h2         = CtrlHash(hash);
+	size_t        group      = (hash / GROUP_SIZE) & groupmask;
+	size_t        insert_pos = ILLEGAL_POS;
+
+	for (;;) {
+		size_t               base = group * GROUP_SIZE;
+		const unsigned char *ctrl = &self->ctrl[base];
+
+		for (unsigned match = group_match(ctrl, h2); match != 0;
+		     match &= match - 1) {
+			HashSetEntry *entry = &self->entries[base + ntz(match)];
+			if (GroupEntryMatches(self, *entry, hash, key)) {
+				// Value already in the set, return it
+				return GetFindReturnValue(*entry, true);
+			}
+		}
+
+		unsigned free_slots = group_match_free(ctrl);
+		if (insert_pos == ILLEGAL_POS && free_slots != 0)
+			insert_pos = base + ntz(free_slots);
+		if (group_match(ctrl, CTRL_EMPTY) != 0) {
+			HashSetEntry *nentry = &self->entries[insert_pos];
+			InitData(self, EntryGetValue(*nentry), key);
+			EntrySetHash(*nentry, hash);
+			self->ctrl[insert_pos] = h2;
+			self->num_elements++;
+			return GetFindReturnValue(*nentry, false);
+		}
+
+		++num_probes;
+		group = (group + JUMP(num_probes)) & groupmask;
+		assert(num_probes <= groupmask);
+	}
+#else
 	size_t   num_probes  = 0;
 	size_t   num_buckets = self->num_buckets;
 	size_t   hashmask    = num_buckets - 1;
@@ -225,6 +334,7 @@ static inline FindReturnValue insert_nogrow(HashSet *self, KeyType key)
 		bucknum = (bucknum + JUMP(num_probes)) & hashmask;
 		assert(num_probes < num_buckets);
 	}
+#endif /* GROUP_PROBING */
 }
 
 /**
@@ -246,6 +356,30 @@ static inline void reset_thresholds(HashSet *self)
  */
 static void insert_new(HashSet *self, unsigned hash, ValueType value)
 {
+#ifdef GROUP_PROBING
+	size_t num_probes = 0;
+	size_t groupmask  = self->num_buckets / GROUP_SIZE - 1;
+	size_t group      = (hash / GROUP_SIZE) & groupmask;
+
+	for (;;) {
+		size_t   base       = group * GROUP_SIZE;
+		unsigned free_slots = group_match_free(&self->ctrl[base]);
+		if (free_slots != 0) {
+			size_t        p      = base + ntz(free_slots);
+			HashSetEntry *nentry = &self->entries[p];
+
+			EntryGetValue(*nentry) = value;
+			EntrySetHash(*nentry, hash);
+			self->ctrl[p] = CtrlHash(hash);
+			self->num_elements++;
+			return;
+		}
+
+		++num_probes;
+		group = (group + JUMP(num_probes)) & groupmask;
+		assert(num_probes <= groupmask);
+	}
+#else
 	size_t num_probes  = 0;
 	size_t num_buckets = self->num_buckets;
 	size_t hashmask    = num_buckets - 1;
@@ -279,6 +413,7 @@ static void insert_new(HashSet *self, unsigned hash, ValueType value)
 		bucknum = (bucknum + JUMP(num_probes)) & hashmask;
 		assert(num_probes < num_buckets);
 	}
+#endif /* GROUP_PROBING */
 }
 
 /**
@@ -295,6 +430,11 @@ static inline void resize(HashSet *self, size_t new_size)
 	/* allocate a new array with double size */
 	new_entries = Alloc(new_size);
 	SetRangeEmpty(new_entries, new_size);
+#ifdef GROUP_PROBING
+	unsigned char *old_ctrl = self->ctrl;
+	self->ctrl = XMALLOCN(unsigned char, new_size);
+	memset(self->ctrl, CTRL_EMPTY, new_size);
+#endif
 
 	/* use the new array */
 	self->entries      = new_entries;
@@ -317,6 +457,9 @@ static inline void resize(HashSet *self, size_t new_size)
 
 	/* now we can free the old array */
 	Free(old_entries);
+#ifdef GROUP_PROBING
+	xfree(old_ctrl);
+#endif
 }
 #else
 
@@ -372,6 +515,10 @@ static inline void maybe_shrink(HashSet *self)
 
 	if (resize_to < 4)
 		resize_to = 4;
+#ifdef GROUP_PROBING
+	if (resize_to < GROUP_SIZE)
+		resize_to = GROUP_SIZE;
+#endif
 
 	resize(self, resize_to);
 }
@@ -409,6 +556,33 @@ FindReturnValue hashset_insert(HashSet *self, KeyType key)
  */
 FindReturnValue hashset_find(const HashSet *self, ConstKeyType key)
 {
+#ifdef GROUP_PROBING
+	size_t        num_probes = 0;
+	size_t        groupmask  = self->num_buckets / GROUP_SIZE - 1;
+	unsigned      hash       = Hash(self, key);
+	unsigned char h2         = CtrlHash(hash);
+	size_t        group      = (hash / GROUP_SIZE) & groupmask;
+
+	for (;;) {
+		size_t               base = group * GROUP_SIZE;
+		const unsigned char *ctrl = &self->ctrl[base];
+
+		for (unsigned match = group_match(ctrl, h2); match != 0;
+		     match &= match - 1) {
+			HashSetEntry *entry = &self->entries[base + ntz(match)];
+			if (GroupEntryMatches(self, *entry, hash, key)) {
+				// found the value
+				return GetFindReturnValue(*entry, true);
+			}
+		}
+		if (group_match(ctrl, CTRL_EMPTY) != 0)
+			return NullReturnValue;
+
+		++num_probes;
+		group = (group + JUMP(num_probes)) & groupmask;
+		assert(num_probes <= groupmask);
+	}
+#else
 	size_t   num_probes  = 0;
 	size_t   num_buckets = self->num_buckets;
 	size_t   hashmask    = num_buckets - 1;
@@ -434,6 +608,7 @@ FindReturnValue hashset_find(const HashSet *self, ConstKeyType key)
 		bucknum = (bucknum + JUMP(num_probes)) & hashmask;
 		assert(num_probes < num_buckets);
 	}
+#endif /* GROUP_PROBING */
 }
 #endif
 
@@ -447,16 +622,47 @@ FindReturnValue hashset_find(const HashSet *self, ConstKeyType key)
  */
 void hashset_remove(HashSet *self, ConstKeyType key)
 {
+#ifndef NDEBUG
+	self->entries_version++;
+#endif
+
+#ifdef GROUP_PROBING
+	size_t        num_probes = 0;
+	size_t        groupmask  = self->num_buckets / GROUP_SIZE - 1;
+	unsigned      hash       = Hash(self, key);
+	unsigned char h2         = CtrlHash(hash);
+	size_t        group      = (hash / GROUP_SIZE) & groupmask;
+
+	for (;;) {
+		size_t               base = group * GROUP_SIZE;
+		const unsigned char *ctrl = &self->ctrl[base];
+
+		for (unsigned match = group_match(ctrl, h2); match != 0;
+		     match &= match - 1) {
+			size_t        p     = base + ntz(match);
+			HashSetEntry *entry = &self->entries[p];
+			if (GroupEntryMatches(self, *entry, hash, key)) {
+				EntrySetDeleted(*entry);
+				self->ctrl[p] = CTRL_DELETED;
+				self->num_deleted++;
+				self->consider_shrink = 1;
+				return;
+			}
+		}
+		if (group_match(ctrl, CTRL_EMPTY) != 0)
+			return;
+
+		++num_probes;
+		group = (group + JUMP(num_probes)) & groupmask;
+		assert(num_probes <= groupmask);
+	}
+#else
 	size_t   num_probes  = 0;
 	size_t   num_buckets = self->num_buckets;
 	size_t   hashmask    = num_buckets - 1;
 	unsigned hash        = Hash(self, key);
 	size_t   bucknum     = hash & hashmask;
 
-#ifndef NDEBUG
-	self->entries_version++;
-#endif
-
 	for (;;) {
 		HashSetEntry *entry = & self->entries[bucknum];
 
@@ -478,6 +684,7 @@ void hashset_remove(HashSet *self, ConstKeyType key)
 		bucknum = (bucknum + JUMP(num_probes)) & hashmask;
 		assert(num_probes < num_buckets);
 	}
+#endif /* GROUP_PROBING */
 }
 #endif
 
@@ -489,6 +696,12 @@ static inline void init_size(HashSet *self, size_t initial_size)
 {
 	if (initial_size < 4)
 		initial_size = 4;
+#ifdef GROUP_PROBING
+	if (initial_size < GROUP_SIZE)
+		initial_size = GROUP_SIZE;
+	self->ctrl            = XMALLOCN(unsigned char, initial_size);
+	memset(self->ctrl, CTRL_EMPTY, initial_size);
+#endif
 
 	self->entries         = Alloc(initial_size);
 	SetRangeEmpty(self->entries, initial_size);
@@ -528,6 +741,9 @@ void hashset_destroy(HashSet *self)
 	ADDITIONAL_TERM
 #endif
 	Free(self->entries);
+#ifdef GROUP_PROBING
+	xfree(self->ctrl);
+#endif
 #ifndef NDEBUG
 	self->entries = NULL;
 #endif
@@ -613,6 +829,9 @@ void hashset_remove_iterator(HashSet *self, const HashSetIterator *iter)
 		return;
 
 	EntrySetDeleted(*entry);
+#ifdef GROUP_PROBING
+	self->ctrl[entry - self->entries] = CTRL_DELETED;
+#endif
 	self->num_deleted++;
 	self->consider_shrink = 1;
 }
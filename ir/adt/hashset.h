@@ -27,6 +27,9 @@ typedef struct HashSetEntry {
 
 struct HashSet {
 	HashSetEntry *entries;
+#ifdef GROUP_PROBING
+	unsigned char *ctrl;
+#endif
 	size_t num_buckets;
 	size_t enlarge_threshold;
 	size_t shrink_threshold;
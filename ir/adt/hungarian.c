@@ -154,10 +154,10 @@ void hungarian_remove(hungarian_problem_t *p, unsigned left, unsigned right)
 
 void hungarian_free(hungarian_problem_t *const p)
 {
-	free(p->missing_left);
-	free(p->missing_right);
-	free(p->cost);
-	free(p);
+	xfree(p->missing_left);
+	xfree(p->missing_right);
+	xfree(p->cost);
+	xfree(p);
 }
 
 int hungarian_solve(hungarian_problem_t *const p, unsigned *const assignment,
@@ -423,14 +423,111 @@ ret:
 	if (final_cost != NULL)
 		*final_cost = res_cost;
 
-	free(col_mate);
-	free(row_mate);
-	free(parent_row);
-	free(unchosen_row);
-	free(row_dec);
-	free(col_inc);
-	free(slack);
-	free(slack_row);
+	xfree(col_mate);
+	xfree(row_mate);
+	xfree(parent_row);
+	xfree(unchosen_row);
+	xfree(row_dec);
+	xfree(col_inc);
+	xfree(slack);
+	xfree(slack_row);
 
 	return result;
 }
+
+int hungarian_solve_jv(hungarian_problem_t *const p,
+                       unsigned *const assignment, unsigned *const final_cost,
+                       unsigned const cost_threshold)
+{
+	unsigned  const n    = p->num_rows;
+	unsigned *const cost = p->cost;
+	assert(p->num_cols == n);
+
+	/* Shortest augmenting paths (Jonker and Volgenant): Rows are added one
+	 * at a time. A Dijkstra search over the reduced costs finds the cheapest
+	 * path from the new row to a free column, then the dual potentials are
+	 * updated so all reduced costs stay non-negative. Columns are numbered
+	 * from 1, column 0 is the virtual start of the search. */
+	typedef long long pot_t;
+	pot_t    *const row_pot = XMALLOCNZ(pot_t, n + 1);
+	pot_t    *const col_pot = XMALLOCNZ(pot_t, n + 1);
+	pot_t    *const min_to  = XMALLOCN(pot_t, n + 1);
+	unsigned *const matched = XMALLOCNZ(unsigned, n + 1); /* row + 1 of col */
+	unsigned *const way     = XMALLOCN(unsigned, n + 1);
+	unsigned *const used    = rbitset_malloc(n + 1);
+
+	for (unsigned r = 1; r <= n; ++r) {
+		matched[0] = r;
+		unsigned c0 = 0;
+		for (unsigned c = 0; c <= n; ++c)
+			min_to[c] = LLONG_MAX;
+		rbitset_clear_all(used, n + 1);
+
+		do {
+			rbitset_set(used, c0);
+			unsigned const r0    = matched[c0];
+			unsigned const *row  = &cost[(r0 - 1) * n];
+			pot_t          delta = LLONG_MAX;
+			unsigned       c1    = 0;
+			for (unsigned c = 1; c <= n; ++c) {
+				if (rbitset_is_set(used, c))
+					continue;
+				pot_t const cur = row[c - 1] - row_pot[r0] - col_pot[c];
+				if (cur < min_to[c]) {
+					min_to[c] = cur;
+					way[c]    = c0;
+				}
+				if (min_to[c] < delta) {
+					delta = min_to[c];
+					c1    = c;
+				}
+			}
+			for (unsigned c = 0; c <= n; ++c) {
+				if (rbitset_is_set(used, c)) {
+					row_pot[matched[c]] += delta;
+					col_pot[c]          -= delta;
+				} else {
+					min_to[c] -= delta;
+				}
+			}
+			c0 = c1;
+		} while (matched[c0] != 0);
+
+		/* augment along the path */
+		do {
+			unsigned const c1 = way[c0];
+			matched[c0] = matched[c1];
+			c0          = c1;
+		} while (c0 != 0);
+	}
+
+	unsigned res_cost = 0;
+	memset(assignment, -1, n * sizeof(assignment[0]));
+	for (unsigned c = 1; c <= n; ++c) {
+		unsigned const r        = matched[c] - 1;
+		unsigned const col      = c - 1;
+		unsigned const the_cost = cost[r * n + col];
+		res_cost += the_cost;
+
+		if (cost_threshold > 0 && the_cost >= cost_threshold)
+			continue;
+		/* In case of normal matching: remove impossible ones */
+		if (p->match_type == HUNGARIAN_MATCH_NORMAL
+		    && (rbitset_is_set(p->missing_left, r)
+		        || rbitset_is_set(p->missing_right, col)))
+			continue;
+		assignment[r] = col;
+	}
+	DBG((dbg, LEVEL_1, "Cost is %u\n", res_cost));
+
+	if (final_cost != NULL)
+		*final_cost = res_cost;
+
+	xfree(row_pot);
+	xfree(col_pot);
+	xfree(min_to);
+	xfree(matched);
+	xfree(way);
+	xfree(used);
+	return 0;
+}
@@ -0,0 +1,35 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Minimal portable mutex used to protect process wide tables and
+ *          thread local storage for caches in front of them.
+ */
+#ifndef FIRM_ADT_LOCK_H
+#define FIRM_ADT_LOCK_H
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+typedef CRITICAL_SECTION ir_lock_t;
+#define IR_THREAD_LOCAL       __declspec(thread)
+#define ir_lock_init(lock)    InitializeCriticalSection(lock)
+#define ir_lock_destroy(lock) DeleteCriticalSection(lock)
+#define ir_lock(lock)         EnterCriticalSection(lock)
+#define ir_unlock(lock)       LeaveCriticalSection(lock)
+#else
+#include <pthread.h>
+
+typedef pthread_mutex_t ir_lock_t;
+#define IR_THREAD_LOCAL       __thread
+#define ir_lock_init(lock)    pthread_mutex_init(lock, NULL)
+#define ir_lock_destroy(lock) pthread_mutex_destroy(lock)
+#define ir_lock(lock)         pthread_mutex_lock(lock)
+#define ir_unlock(lock)       pthread_mutex_unlock(lock)
+#endif
+
+#endif
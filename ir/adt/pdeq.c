@@ -20,18 +20,9 @@
 #include "xmalloc.h"
 
 #define PDEQ_MAGIC1 FOURCC('P','D','E','1')
-#define PDEQ_MAGIC2 FOURCC('P','D','E','2')
 
-/** Size of pdeq block cache. */
-#define TUNE_NSAVED_PDEQS 16
-
-/** A size handled efficiently by malloc(), at least 1K.  */
-#define PREF_MALLOC_SIZE 2048
-
-/**
- * Maximal number of data items in a pdeq chunk.
- */
-#define NDATA ((PREF_MALLOC_SIZE - offsetof(pdeq, data)) / sizeof(void *))
+/** Initial number of slots of the ring buffer, must be a power of two. */
+#define PDEQ_INITIAL_SIZE 32
 
 #ifdef NDEBUG
 # define VRFY(dq) ((void)0)
@@ -41,72 +32,52 @@
 
 /**
  * A pointer double ended queue.
- * This structure is used as a list chunk either.
+ * The elements are stored in a ring buffer whose size is a power of two, so
+ * wrapping around is a simple mask operation.
  */
 struct pdeq {
 #ifndef NDEBUG
 	unsigned magic;       /**< debug magic */
 #endif
-	pdeq *l_end, *r_end;  /**< left and right ends of the queue */
-	pdeq *l, *r;          /**< left and right neighbor */
-	size_t n;             /**< number of elements in the current chunk */
-	size_t p;             /**< the read/write pointer */
-	void const *data[];   /**< storage for elements */
+	size_t       mask;    /**< size of the ring buffer minus one */
+	size_t       head;    /**< slot of the leftmost element */
+	size_t       n;       /**< number of elements */
+	void const **data;    /**< the ring buffer */
 };
 
-
-/**
- * cache of unused, pdeq blocks to speed up new_pdeq and del_pdeq.
- */
-static pdeq *pdeq_block_cache[TUNE_NSAVED_PDEQS];
-
-/**
- * Number of pdeqs in pdeq_store.
- */
-static unsigned pdeqs_cached;
-
-/**
- * Free a pdeq chunk, put in into the cache if possible.
- *
- * @param p   The pdeq chunk.
- */
-static inline void free_pdeq_block(pdeq *p)
+/** Returns the slot of the i-th element from the left. */
+static inline size_t pdeq_slot(pdeq const *dq, size_t i)
 {
-#ifndef NDEBUG
-	p->magic = 0xbadf00d1;
-#endif
-	if (pdeqs_cached < TUNE_NSAVED_PDEQS) {
-		pdeq_block_cache[pdeqs_cached++] = p;
-	} else {
-		free(p);
-	}
+	return (dq->head + i) & dq->mask;
 }
 
 /**
- * Allocate a new pdeq chunk, get it from the cache if possible.
- *
- * @return A new pdeq chunk.
+ * Double the size of the ring buffer, unwrapping the elements to the start
+ * of the new buffer.
  */
-static inline pdeq *alloc_pdeq_block(void)
+static void pdeq_grow(pdeq *dq)
 {
-	pdeq *p;
-	if (pdeqs_cached > 0) {
-		p = pdeq_block_cache[--pdeqs_cached];
-	} else {
-		p = (pdeq*)xmalloc(PREF_MALLOC_SIZE);
-	}
-	return p;
+	size_t const size     = dq->mask + 1;
+	void const **new_data = XMALLOCN(void const*, size * 2);
+	size_t const first    = size - dq->head;
+	MEMCPY(new_data, &dq->data[dq->head], first);
+	MEMCPY(&new_data[first], dq->data, dq->head);
+	xfree(dq->data);
+	dq->data = new_data;
+	dq->mask = size * 2 - 1;
+	dq->head = 0;
 }
 
 pdeq *new_pdeq(void)
 {
-	pdeq *dq = alloc_pdeq_block();
+	pdeq *dq = XMALLOC(pdeq);
 #ifndef NDEBUG
 	dq->magic = PDEQ_MAGIC1;
 #endif
-	dq->l_end = dq->r_end = dq;
-	dq->l = dq->r = NULL;
-	dq->n = dq->p = 0;
+	dq->mask = PDEQ_INITIAL_SIZE - 1;
+	dq->head = 0;
+	dq->n    = 0;
+	dq->data = XMALLOCN(void const*, PDEQ_INITIAL_SIZE);
 
 	VRFY(dq);
 	return dq;
@@ -115,69 +86,32 @@ pdeq *new_pdeq(void)
 void del_pdeq(pdeq *dq)
 {
 	VRFY(dq);
-
-	pdeq *q = dq->l_end; /* left end of chain */
-	/* pdeq trunk empty, but !pdeq_empty() ==> trunk not in chain */
-	if (dq->n == 0 && dq->l_end != dq ) {
-		free_pdeq_block(dq);
-	}
-
-	/* Free all blocks in the pdeq chain */
-	pdeq *qq;
-	do {
-		qq = q->r;
-		free_pdeq_block(q);
-	} while ((q = qq) != NULL);
+#ifndef NDEBUG
+	dq->magic = 0xbadf00d1;
+#endif
+	xfree(dq->data);
+	xfree(dq);
 }
 
 int pdeq_empty(pdeq const *dq)
 {
 	VRFY(dq);
-	return dq->l_end->n == 0;
+	return dq->n == 0;
 }
 
 size_t pdeq_len(pdeq const *dq)
 {
 	VRFY(dq);
-
-	size_t      n = 0;
-	pdeq const *q = dq->l_end;
-	do {
-		n += q->n;
-		q = q->r;
-	}  while (q);
-
-	return n;
+	return dq->n;
 }
 
 pdeq *pdeq_putr(pdeq *dq, void const *x)
 {
 	VRFY(dq);
 
-	pdeq *rdq = dq->r_end;
-	if (rdq->n >= NDATA) {  /* tailblock full */
-		pdeq *ndq = dq;     /* try to reuse trunk, but ... */
-		if (dq->n) {        /* ... if trunk used */
-			/* allocate and init new block */
-			ndq = alloc_pdeq_block();
-#ifndef NDEBUG
-			ndq->magic = PDEQ_MAGIC2;
-#endif
-			ndq->l_end = ndq->r_end = NULL;
-		}
-
-		ndq->r = NULL;
-		ndq->l = rdq; rdq->r = ndq;
-		ndq->n = 0; ndq->p = 0;
-		dq->r_end = ndq;
-		rdq = ndq;
-	}
-
-	size_t n = rdq->n++ + rdq->p;
-	if (n >= NDATA)
-		n -= NDATA;
-
-	rdq->data[n] = x;
+	if (dq->n > dq->mask)
+		pdeq_grow(dq);
+	dq->data[pdeq_slot(dq, dq->n++)] = x;
 
 	VRFY(dq);
 	return dq;
@@ -187,32 +121,11 @@ pdeq *pdeq_putl(pdeq *dq, void const *x)
 {
 	VRFY(dq);
 
-	pdeq *ldq = dq->l_end;
-	if (ldq->n >= NDATA) {  /* headblock full */
-		pdeq *ndq = dq;     /* try to reuse trunk, but ... */
-		if (dq->n) {        /* ... if trunk used */
-			/* allocate and init new block */
-			ndq = alloc_pdeq_block();
-#ifndef NDEBUG
-			ndq->magic = PDEQ_MAGIC2;
-#endif
-			ndq->l_end = ndq->r_end = NULL;
-		}
-
-		ndq->l = NULL;
-		ndq->r = ldq; ldq->l = ndq;
-		ndq->n = 0; ndq->p = 0;
-		dq->l_end = ndq;
-		ldq = ndq;
-	}
-
-	ldq->n++;
-	size_t p = ldq->p;
-	if (p == 0)
-		p = NDATA;
-
-	ldq->data[--p] = x;
-	ldq->p         = p;
+	if (dq->n > dq->mask)
+		pdeq_grow(dq);
+	dq->head = (dq->head - 1) & dq->mask;
+	dq->data[dq->head] = x;
+	++dq->n;
 
 	VRFY(dq);
 	return dq;
@@ -221,55 +134,20 @@ pdeq *pdeq_putl(pdeq *dq, void const *x)
 void *pdeq_getr(pdeq *dq)
 {
 	VRFY(dq);
-	assert(dq->l_end->n);
-
-	pdeq  *const rdq = dq->r_end;
-	size_t       n   = rdq->p + --rdq->n;
-	if (n >= NDATA)
-		n -= NDATA;
-	void const *const x = rdq->data[n];
-
-	if (rdq->n == 0) {
-		if (rdq->l) {
-			dq->r_end = rdq->l;
-			rdq->l->r = NULL;
-			rdq->l = NULL;
-		} else {
-			dq->r_end = dq->l_end = dq;
-		}
-		if (dq != rdq)
-			free_pdeq_block(rdq);
-	}
+	assert(dq->n > 0);
 
-	VRFY(dq);
+	void const *const x = dq->data[pdeq_slot(dq, --dq->n)];
 	return (void *)x;
 }
 
 void *pdeq_getl(pdeq *dq)
 {
 	VRFY(dq);
-	assert(dq->l_end->n);
-
-	pdeq       *const ldq = dq->l_end;
-	size_t            p   = ldq->p;
-	void const *const x = ldq->data[p];
-	if (++p >= NDATA)
-		p = 0;
-	ldq->p = p;
-
-	if (--ldq->n == 0) {
-		if (ldq->r) {
-			dq->l_end = ldq->r;
-			ldq->r->l = NULL;
-			ldq->r = NULL;
-		} else {
-			dq->l_end = dq->r_end = dq;
-		}
-		if (dq != ldq)
-			free_pdeq_block(ldq);
-	}
+	assert(dq->n > 0);
 
-	VRFY(dq);
+	void const *const x = dq->data[dq->head];
+	dq->head = (dq->head + 1) & dq->mask;
+	--dq->n;
 	return (void *)x;
 }
 
@@ -277,28 +155,10 @@ int pdeq_contains(pdeq const *dq, void const *x)
 {
 	VRFY(dq);
 
-	pdeq const *q = dq->l_end;
-	do {
-		size_t p  = q->p;
-		size_t ep = p + q->n;
-
-		if (ep > NDATA) {
-			do {
-				if (q->data[p] == x)
-					return true;
-			} while (++p < NDATA);
-			p = 0;
-			ep -= NDATA;
-		}
-
-		while (p < ep) {
-			if (q->data[p++] == x)
-				return true;
-		}
-
-		q = q->r;
-	} while (q != NULL);
-
+	for (size_t i = 0, n = dq->n; i < n; ++i) {
+		if (dq->data[pdeq_slot(dq, i)] == x)
+			return true;
+	}
 	return false;
 }
 
@@ -306,28 +166,11 @@ void *pdeq_search(pdeq const *dq, cmp_fun cmp, void const *key)
 {
 	VRFY(dq);
 
-	pdeq const *q = dq->l_end;
-	do {
-		size_t p  = q->p;
-		size_t ep = p + q->n;
-
-		if (ep > NDATA) {
-			do {
-				if (!cmp(q->data[p], key))
-					return (void *)q->data[p-1];
-			} while (++p < NDATA);
-			p = 0;
-			ep -= NDATA;
-		}
-
-		while (p < ep) {
-			if (!cmp(q->data[p++], key))
-				return (void *)q->data[p-1];
-		}
-
-		q = q->r;
-	} while (q);
-
+	for (size_t i = 0, n = dq->n; i < n; ++i) {
+		void const *const x = dq->data[pdeq_slot(dq, i)];
+		if (!cmp(x, key))
+			return (void *)x;
+	}
 	return NULL;
 }
 
@@ -335,23 +178,11 @@ void **pdeq_copyl(pdeq const *dq, void const **dst)
 {
 	VRFY(dq);
 
-	void const **d = dst;
-	pdeq const  *q = dq->l_end;
-	while (q != NULL) {
-		size_t p = q->p;
-		size_t n = q->n;
-
-		if (n + p > NDATA) {
-			/* p is always < NDATA */
-			size_t nn = NDATA - p;
-			MEMCPY(d, &q->data[p], nn); d += nn;
-			p = 0; n -= nn;
-		}
-
-		MEMCPY(d, &q->data[p], n); d += n;
-
-		q = q->r;
-	}
+	/* copy the part up to the end of the buffer, then the wrapped part */
+	size_t const n     = dq->n;
+	size_t const first = MIN(n, dq->mask + 1 - dq->head);
+	MEMCPY(dst, &dq->data[dq->head], first);
+	MEMCPY(&dst[first], dq->data, n - first);
 
 	return (void **)dst;
 }
@@ -360,28 +191,9 @@ void **pdeq_copyr(pdeq const *dq, void const **dst)
 {
 	VRFY(dq);
 
-	pdeq const  *q = dq->r_end;
 	void const **d = dst;
-	while (q != NULL) {
-		size_t p = q->p;
-		size_t i = q->n + p - 1;
-		if (i >= NDATA) {
-			i -= NDATA;
-			for (;; --i) {
-				*d++ = q->data[i];
-				if (i == 0)
-					break;
-			}
-			i = NDATA - 1;
-		}
-
-		for (;; --i) {
-			*d++ = q->data[i];
-			if (i <= p)
-				break;
-		}
-
-		q = q->l;
+	for (size_t i = dq->n; i-- > 0;) {
+		*d++ = dq->data[pdeq_slot(dq, i)];
 	}
 
 	return (void **)dst;
@@ -77,7 +77,7 @@ void plist_free(plist_t *list)
 
 	if (! list->foreign_obstack) {
 		obstack_free(list->obst, NULL);
-		free(list);
+		xfree(list);
 	}
 }
 
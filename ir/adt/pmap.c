@@ -78,6 +78,11 @@ size_t pmap_count(pmap const *map)
 	return set_count(M2S(map));
 }
 
+size_t pmap_memory_used(pmap *map)
+{
+	return set_memory_used(M2S(map));
+}
+
 pmap_entry *pmap_first(pmap *map)
 {
 	return set_first(pmap_entry, M2S(map));
@@ -7,17 +7,12 @@
  * @file
  * Implements a heap.
  *
- * Implementation note: It might seem strange that we start indexing at 0
- * but use 2*i and 2*i+1 to find the left and right sucessor of an index.
- * The trick is that for index 0 the left successor is 0 again, and the
- * right successor is 1 in this scheme. For the right successor 1 everything
- * works like usual. We simply took care in the algorithms that they still
- * work with the left child of 0 being 0 again. This was possible without
- * any extra ifs or arithmetic.
- * Thus we can save the wastage of 1 array position you can see in other
- * implementations or the ugly (i+1)*2 - 1 and (i+1)*2 for calculating the
- * left and right child. (At the expense that stuff easily breaks when you make
- * changes and don't think that the left child of 0 is 0 :-/)
+ * The heap is 4-ary: The children of position i are at 4*i+1 to 4*i+4, so
+ * all children of a node share a cache line and the tree is half as deep
+ * as a binary heap. Elements inserted with pqueue_insert() get a handle, which
+ * stays valid until the element leaves the queue and allows changing its
+ * priority. Handles of removed elements are reused, so the handle table only
+ * grows with the maximum number of such elements in the queue at once.
  *
  * @author  Christian Wuerdig, Matthias Braun
  * @brief   Priority Queue implementation based on the heap data structure
@@ -27,40 +22,55 @@
 #include "array.h"
 #include "panic.h"
 
+#define PQUEUE_ARITY 4
+
 typedef struct pqueue_el_t {
-	void *data;
-	int   priority;
+	void  *data;
+	int    priority;
+	size_t handle;
 } pqueue_el_t;
 
 struct pqueue_t {
 	pqueue_el_t *elems;
+	size_t      *positions;    /**< heap position for each handle */
+	size_t      *free_handles; /**< handles not used by any element */
 };
 
+static void pqueue_set(pqueue_t *q, size_t pos, pqueue_el_t el)
+{
+	q->elems[pos] = el;
+	if (el.handle != PQUEUE_NO_HANDLE)
+		q->positions[el.handle] = pos;
+}
+
 /**
  * Enforces the heap characteristics if the queue
  * starting from element at position @p pos.
  */
 static void pqueue_heapify(pqueue_t *q, size_t pos)
 {
-	size_t len = ARR_LEN(q->elems);
-	while (pos * 2 < len) {
-		size_t exchange = pos;
-		if (q->elems[exchange].priority < q->elems[pos * 2].priority)
-			exchange = pos * 2;
-
-		if ((pos * 2 + 1) < len
-				&& q->elems[exchange].priority < q->elems[pos * 2 + 1].priority)
-			exchange = pos * 2 + 1;
-
-		if (exchange == pos)
+	size_t      len = ARR_LEN(q->elems);
+	pqueue_el_t el  = q->elems[pos];
+	for (;;) {
+		size_t first = pos * PQUEUE_ARITY + 1;
+		if (first >= len)
+			break;
+		size_t last = first + PQUEUE_ARITY;
+		if (last > len)
+			last = len;
+
+		size_t exchange = first;
+		for (size_t c = first + 1; c < last; ++c) {
+			if (q->elems[c].priority > q->elems[exchange].priority)
+				exchange = c;
+		}
+		if (q->elems[exchange].priority <= el.priority)
 			break;
 
-		pqueue_el_t tmp    = q->elems[pos];
-		q->elems[pos]      = q->elems[exchange];
-		q->elems[exchange] = tmp;
-
+		pqueue_set(q, pos, q->elems[exchange]);
 		pos = exchange;
 	}
+	pqueue_set(q, pos, el);
 }
 
 /**
@@ -68,57 +78,101 @@ static void pqueue_heapify(pqueue_t *q, size_t pos)
  */
 static void pqueue_sift_up(pqueue_t *q, size_t pos)
 {
-	while (q->elems[pos].priority > q->elems[pos / 2].priority) {
-		pqueue_el_t tmp   = q->elems[pos];
-		q->elems[pos]     = q->elems[pos / 2];
-		q->elems[pos / 2] = tmp;
-
-		pos /= 2;
+	pqueue_el_t el = q->elems[pos];
+	while (pos > 0) {
+		size_t parent = (pos - 1) / PQUEUE_ARITY;
+		if (q->elems[parent].priority >= el.priority)
+			break;
+		pqueue_set(q, pos, q->elems[parent]);
+		pos = parent;
 	}
+	pqueue_set(q, pos, el);
 }
 
 pqueue_t *new_pqueue(void)
 {
 	pqueue_t *res = XMALLOC(pqueue_t);
-	res->elems = NEW_ARR_F(pqueue_el_t, 0);
+	res->elems        = NEW_ARR_F(pqueue_el_t, 0);
+	res->positions    = NEW_ARR_F(size_t, 0);
+	res->free_handles = NEW_ARR_F(size_t, 0);
 	return res;
 }
 
 void del_pqueue(pqueue_t *q)
 {
+	DEL_ARR_F(q->free_handles);
+	DEL_ARR_F(q->positions);
 	DEL_ARR_F(q->elems);
-	free(q);
+	xfree(q);
 }
 
-void pqueue_put(pqueue_t *q, void *data, int priority)
+static void pqueue_add(pqueue_t *q, void *data, int priority, size_t handle)
 {
-	pqueue_el_t el = {
-		.data = data,
-		.priority = priority
+	pqueue_el_t const el = {
+		.data     = data,
+		.priority = priority,
+		.handle   = handle,
 	};
 	ARR_APP1(pqueue_el_t, q->elems, el);
-
 	pqueue_sift_up(q, ARR_LEN(q->elems) - 1);
 }
 
+size_t pqueue_insert(pqueue_t *q, void *data, int priority)
+{
+	size_t       handle;
+	size_t const n_free = ARR_LEN(q->free_handles);
+	if (n_free > 0) {
+		handle = q->free_handles[n_free - 1];
+		ARR_SHRINKLEN(q->free_handles, n_free - 1);
+	} else {
+		handle = ARR_LEN(q->positions);
+		ARR_APP1(size_t, q->positions, PQUEUE_NO_HANDLE);
+	}
+	pqueue_add(q, data, priority, handle);
+	return handle;
+}
+
+void pqueue_put(pqueue_t *q, void *data, int priority)
+{
+	pqueue_add(q, data, priority, PQUEUE_NO_HANDLE);
+}
+
+int pqueue_contains(pqueue_t const *q, size_t handle)
+{
+	return handle < ARR_LEN(q->positions)
+	    && q->positions[handle] != PQUEUE_NO_HANDLE;
+}
+
+void pqueue_change_priority(pqueue_t *q, size_t handle, int priority)
+{
+	assert(pqueue_contains(q, handle));
+	size_t       const pos = q->positions[handle];
+	pqueue_el_t *const el  = &q->elems[pos];
+	int          const old = el->priority;
+	el->priority = priority;
+	if (priority > old)
+		pqueue_sift_up(q, pos);
+	else
+		pqueue_heapify(q, pos);
+}
+
 void *pqueue_pop_front(pqueue_t *q)
 {
-	switch (ARR_LEN(q->elems)) {
-	case 0:
+	size_t const len = ARR_LEN(q->elems);
+	if (len == 0)
 		panic("attempt to retrieve element from empty priority queue");
-	case 1:
-		ARR_SHRINKLEN(q->elems, 0);
-		return q->elems[0].data;
-	default: {
-		void   *data = q->elems[0].data;
-		size_t len   = ARR_LEN(q->elems) - 1;
-
-		q->elems[0] = q->elems[len];
-		ARR_SHRINKLEN(q->elems, len);
-		pqueue_heapify(q, 0);
-		return data;
-	}
+
+	pqueue_el_t const front = q->elems[0];
+	if (front.handle != PQUEUE_NO_HANDLE) {
+		q->positions[front.handle] = PQUEUE_NO_HANDLE;
+		ARR_APP1(size_t, q->free_handles, front.handle);
 	}
+	if (len > 1)
+		pqueue_set(q, 0, q->elems[len - 1]);
+	ARR_SHRINKLEN(q->elems, len - 1);
+	if (len > 2)
+		pqueue_heapify(q, 0);
+	return front.data;
 }
 
 size_t pqueue_length(pqueue_t const *q)
@@ -427,6 +427,91 @@ static inline void rbitset_xor(unsigned *dst, const unsigned *src, size_t size)
 	}
 }
 
+/**
+ * Inplace Union of two sets, reporting whether dst changed. This fuses the
+ * union with the comparison against the old value, which dataflow fixpoint
+ * iterations otherwise do with a separate pass and a temporary copy.
+ *
+ * @param dst   the destination bitset and first operand
+ * @param src   the second bitset
+ * @param size  size of both bitsets in bits
+ * @return true if a bit was added to dst
+ */
+static inline bool rbitset_or_changed(unsigned *dst, const unsigned *src,
+                                      size_t size)
+{
+	unsigned changed = 0;
+	for (size_t i = 0, n = BITSET_SIZE_ELEMS(size); i < n; ++i) {
+		unsigned const old = dst[i];
+		unsigned const val = old | src[i];
+		changed |= old ^ val;
+		dst[i]   = val;
+	}
+	return changed != 0;
+}
+
+/**
+ * Inplace Intersection of two sets, reporting whether dst changed.
+ *
+ * @param dst   the destination bitset and first operand
+ * @param src   the second bitset
+ * @param size  size of both bitsets in bits
+ * @return true if a bit was removed from dst
+ */
+static inline bool rbitset_and_changed(unsigned *dst, const unsigned *src,
+                                       size_t size)
+{
+	unsigned changed = 0;
+	for (size_t i = 0, n = BITSET_SIZE_ELEMS(size); i < n; ++i) {
+		unsigned const old = dst[i];
+		unsigned const val = old & src[i];
+		changed |= old ^ val;
+		dst[i]   = val;
+	}
+	return changed != 0;
+}
+
+/**
+ * Remove all bits in src from dst, reporting whether dst changed.
+ *
+ * @param dst   the destination bitset and first operand
+ * @param src   the second bitset
+ * @param size  size of both bitsets in bits
+ * @return true if a bit was removed from dst
+ */
+static inline bool rbitset_andnot_changed(unsigned *dst, const unsigned *src,
+                                          size_t size)
+{
+	unsigned changed = 0;
+	for (size_t i = 0, n = BITSET_SIZE_ELEMS(size); i < n; ++i) {
+		unsigned const old = dst[i];
+		unsigned const val = old & ~src[i];
+		changed |= old ^ val;
+		dst[i]   = val;
+	}
+	return changed != 0;
+}
+
+/**
+ * Copy a raw bitset into another, reporting whether dst changed. Replaces
+ * the usual rbitsets_equal() followed by rbitset_copy() with a single pass.
+ *
+ * @param dst   the destination set
+ * @param src   the source set
+ * @param size  size of both bitsets in bits
+ * @return true if dst differed from src
+ */
+static inline bool rbitset_copy_changed(unsigned *dst, const unsigned *src,
+                                        size_t size)
+{
+	unsigned changed = 0;
+	for (size_t i = 0, n = BITSET_SIZE_ELEMS(size); i < n; ++i) {
+		changed |= dst[i] ^ src[i];
+		dst[i]   = src[i];
+	}
+	return changed != 0;
+}
+
 /**
  * Set bits in a range to zero or one
  * @param bitset   the bitset
@@ -117,7 +117,7 @@ SET *(PMANGLE(new))(MANGLEP(cmp_fun) cmp, size_t nslots)
 void PMANGLE(del)(SET *table)
 {
 	obstack_free(&table->obst, NULL);
-	free(table);
+	xfree(table);
 }
 
 size_t MANGLEP(count)(SET const *table)
@@ -125,6 +125,11 @@ size_t MANGLEP(count)(SET const *table)
 	return table->nkey;
 }
 
+size_t MANGLEP(memory_used)(SET *table)
+{
+	return sizeof(*table) + obstack_memory_used(&table->obst);
+}
+
 /**
  * do one iteration step, return 1
  * if still data in the set, 0 else
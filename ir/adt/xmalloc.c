@@ -15,16 +15,70 @@
 #include "funcattr.h"
 #include "xmalloc.h"
 
-static FIRM_NORETURN xnomem(void)
+static void *default_allocate(void *context, size_t size)
+{
+	(void)context;
+	return malloc(size);
+}
+
+static void *default_reallocate(void *context, void *ptr, size_t size)
+{
+	(void)context;
+	return realloc(ptr, size);
+}
+
+static void default_release(void *context, void *ptr)
+{
+	(void)context;
+	free(ptr);
+}
+
+static FIRM_NORETURN default_out_of_memory(void)
 {
 	/* Do not use panic() here, because it might try to allocate memory! */
 	fputs("out of memory", stderr);
 	abort();
 }
 
+static ir_allocator_t const default_allocator = {
+	.allocate   = default_allocate,
+	.reallocate = default_reallocate,
+	.release    = default_release,
+	.context    = NULL,
+};
+
+static ir_allocator_t allocator = {
+	.allocate   = default_allocate,
+	.reallocate = default_reallocate,
+	.release    = default_release,
+	.context    = NULL,
+};
+static ir_out_of_memory_func *out_of_memory = default_out_of_memory;
+/** Limit for requested_bytes, 0 means no limit. */
+static size_t                 request_limit;
+/** Sum of all sizes requested since the limit was set. It never decreases
+ * and is updated atomically, as memory is requested from several threads. */
+static size_t                 requested_bytes;
+
+static FIRM_NORETURN xnomem(void)
+{
+	out_of_memory();
+	/* the handler must not return */
+	abort();
+}
+
+static void count_request(size_t size)
+{
+	size_t const total
+		= __atomic_add_fetch(&requested_bytes, size, __ATOMIC_RELAXED);
+	if (request_limit != 0 && total > request_limit)
+		xnomem();
+}
+
 void *xmalloc(size_t size)
 {
-	void *res = malloc(size);
+	count_request(size);
+	void *res = allocator.allocate(allocator.context, size);
 
 	if (!res) xnomem();
 	return res;
@@ -32,13 +86,42 @@ void *xmalloc(size_t size)
 
 void *xrealloc(void *ptr, size_t size)
 {
+	count_request(size);
 	/* ANSI blesses realloc (0, x) but SunOS chokes on it */
-	void *res = ptr ? realloc (ptr, size) : malloc (size);
+	void *res = ptr ? allocator.reallocate(allocator.context, ptr, size)
+	                : allocator.allocate(allocator.context, size);
 
 	if (!res) xnomem();
 	return res;
 }
 
+void xfree(void *ptr)
+{
+	if (ptr != NULL)
+		allocator.release(allocator.context, ptr);
+}
+
+void ir_set_allocator(ir_allocator_t const *new_allocator)
+{
+	allocator = new_allocator != NULL ? *new_allocator : default_allocator;
+}
+
+void ir_set_out_of_memory_handler(ir_out_of_memory_func *handler)
+{
+	out_of_memory = handler != NULL ? handler : default_out_of_memory;
+}
+
+void ir_set_request_limit(size_t limit)
+{
+	request_limit = limit;
+	__atomic_store_n(&requested_bytes, 0, __ATOMIC_RELAXED);
+}
+
+size_t ir_get_requested_bytes(void)
+{
+	return __atomic_load_n(&requested_bytes, __ATOMIC_RELAXED);
+}
+
 char *xstrdup(const char *str)
 {
 	size_t len = strlen (str) + 1;
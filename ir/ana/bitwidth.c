@@ -0,0 +1,231 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Demanded and known widths of integer values.
+ *
+ * The demanded width of a node is the number of its low bits its users
+ * depend on.  It is computed backwards from the users to a fixpoint, so
+ * chains of arithmetic across Phis are handled as a whole: an Add whose
+ * result only flows into 8 bit stores demands only 8 bits of its operands,
+ * no matter how many users it has.
+ */
+#include "bitwidth.h"
+
+#include "constbits.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "pdeq.h"
+#include "raw_bitset.h"
+#include "tv_t.h"
+#include "util.h"
+#include "xmalloc.h"
+
+typedef struct width_info_t {
+	const ir_node *node;      /**< the node, the index may be reused */
+	unsigned char  demanded;  /**< low bits demanded by the users */
+	unsigned char  zero_from; /**< bits from here on are known zero */
+	unsigned char  sign_from; /**< bits from here on are known equal */
+} width_info_t;
+
+struct ir_widths {
+	unsigned      n_nodes;
+	width_info_t *infos;
+};
+
+typedef struct width_env_t {
+	ir_widths *widths;
+	pdeq      *worklist;
+	unsigned  *queued;
+} width_env_t;
+
+static unsigned get_mode_width(const ir_node *node)
+{
+	return get_mode_size_bits(get_irn_mode(node));
+}
+
+static width_info_t *get_width_info(const ir_widths *widths,
+                                    const ir_node *node)
+{
+	unsigned const idx = get_irn_idx(node);
+	if (idx >= widths->n_nodes)
+		return NULL;
+	width_info_t *const info = &widths->infos[idx];
+	return info->node == node ? info : NULL;
+}
+
+/**
+ * Returns the number of bits a shift by the constant @p count moves the
+ * bits of a value with @p width bits, or @p width if it is not known.
+ */
+static unsigned get_shift_distance(const ir_node *count, unsigned width)
+{
+	if (!is_Const(count) || !tarval_is_long(get_Const_tarval(count)))
+		return width;
+	long const distance = get_Const_long(count);
+	return distance >= 0 && distance < (long)width ? distance : width;
+}
+
+/**
+ * Returns the number of low bits of operand @p n of @p user needed to
+ * compute the @p demanded low bits of @p user.
+ */
+static unsigned get_operand_demand(const ir_node *user, int n,
+                                   unsigned demanded)
+{
+	ir_node  *const op    = get_irn_n(user, n);
+	unsigned  const width = get_mode_width(op);
+	if (!mode_is_int(get_irn_mode(user)))
+		return width;
+
+	switch (get_irn_opcode(user)) {
+	case iro_Add:
+	case iro_And:
+	case iro_Eor:
+	case iro_Minus:
+	case iro_Mul:
+	case iro_Not:
+	case iro_Or:
+	case iro_Phi:
+	case iro_Sub:
+		/* the low bits of the result only depend on the low bits */
+		return MIN(demanded, width);
+
+	case iro_Mux:
+		return n == n_Mux_sel ? width : MIN(demanded, width);
+
+	case iro_Shl:
+		return n == n_Shl_left ? MIN(demanded, width) : width;
+
+	case iro_Shr:
+	case iro_Shrs: {
+		if (n != (is_Shr(user) ? n_Shr_left : n_Shrs_left))
+			return width;
+		unsigned const distance
+			= get_shift_distance(get_binop_right(user), width);
+		return MIN(demanded + distance, width);
+	}
+
+	case iro_Conv:
+		/* truncations demand the low bits, extensions need the operand's
+		 * highest bit for the upper bits of the result */
+		return MIN(demanded, width);
+
+	default:
+		return width;
+	}
+}
+
+static void enqueue(width_env_t *env, ir_node *node)
+{
+	unsigned const idx = get_irn_idx(node);
+	if (!rbitset_is_set(env->queued, idx)) {
+		rbitset_set(env->queued, idx);
+		pdeq_putr(env->worklist, node);
+	}
+}
+
+static void init_width_info(ir_node *node, void *data)
+{
+	width_env_t  *const env  = (width_env_t*)data;
+	width_info_t *const info = &env->widths->infos[get_irn_idx(node)];
+	info->node = node;
+	enqueue(env, node);
+	if (!mode_is_int(get_irn_mode(node)))
+		return;
+
+	unsigned const width = get_mode_width(node);
+	info->zero_from = width;
+	info->sign_from = width - 1;
+	bitinfo const *const b = get_bitinfo(node);
+	if (b != NULL) {
+		int const zero_from = get_tarval_highest_bit(b->z) + 1;
+		info->zero_from = zero_from;
+		if (zero_from < (int)width) {
+			info->sign_from = zero_from;
+		} else if (tarval_get_bit(b->o, width - 1)) {
+			ir_tarval *const not_one = tarval_not(b->o);
+			info->sign_from = get_tarval_highest_bit(not_one) + 1;
+		}
+	}
+}
+
+/** Propagates the demand of @p user to its integer operands. */
+static void propagate_demand(width_env_t *env, ir_node *user)
+{
+	width_info_t const *const user_info = get_width_info(env->widths, user);
+	unsigned const demanded = user_info != NULL ? user_info->demanded : 0;
+	foreach_irn_in(user, i, op) {
+		if (!mode_is_int(get_irn_mode(op)))
+			continue;
+		width_info_t *const info = get_width_info(env->widths, op);
+		if (info == NULL)
+			continue;
+		unsigned const op_demand = get_operand_demand(user, i, demanded);
+		if (op_demand > info->demanded) {
+			info->demanded = op_demand;
+			enqueue(env, op);
+		}
+	}
+}
+
+ir_widths *compute_widths(ir_graph *irg)
+{
+	constbits_analyze(irg);
+
+	ir_widths *const widths = XMALLOC(ir_widths);
+	widths->n_nodes = get_irg_last_idx(irg);
+	widths->infos   = XMALLOCNZ(width_info_t, widths->n_nodes);
+
+	width_env_t env;
+	env.widths   = widths;
+	env.worklist = new_pdeq();
+	env.queued   = rbitset_malloc(widths->n_nodes);
+
+	irg_walk_anchors(irg, init_width_info, NULL, &env);
+	constbits_clear(irg);
+
+	/* Demands only grow, so a node is visited again whenever its users
+	 * demand more of it. */
+	while (!pdeq_empty(env.worklist)) {
+		ir_node *const node = (ir_node*)pdeq_getl(env.worklist);
+		rbitset_clear(env.queued, get_irn_idx(node));
+		propagate_demand(&env, node);
+	}
+
+	xfree(env.queued);
+	del_pdeq(env.worklist);
+	return widths;
+}
+
+void free_widths(ir_widths *widths)
+{
+	xfree(widths->infos);
+	xfree(widths);
+}
+
+unsigned get_demanded_width(const ir_widths *widths, const ir_node *node)
+{
+	width_info_t const *const info = get_width_info(widths, node);
+	return info != NULL ? info->demanded : get_mode_width(node);
+}
+
+bool is_zero_extended(const ir_widths *widths, const ir_node *node,
+                      unsigned bits)
+{
+	width_info_t const *const info = get_width_info(widths, node);
+	return info != NULL && mode_is_int(get_irn_mode(node))
+	    && info->zero_from <= bits;
+}
+
+bool is_sign_extended(const ir_widths *widths, const ir_node *node,
+                      unsigned bits)
+{
+	width_info_t const *const info = get_width_info(widths, node);
+	return info != NULL && mode_is_int(get_irn_mode(node)) && bits > 0
+	    && info->sign_from <= bits - 1;
+}
@@ -0,0 +1,56 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Demanded and known widths of integer values.
+ */
+#ifndef FIRM_ANA_BITWIDTH_H
+#define FIRM_ANA_BITWIDTH_H
+
+#include <stdbool.h>
+
+#include "firm_types.h"
+
+/**
+ * Width information for the integer nodes of a graph.
+ *
+ * For each node the analysis records how many low bits its users demand and,
+ * based on the constbits analysis, from which bit on the value is known to be
+ * zero or a copy of its sign bit.  Nodes created after the analysis get
+ * conservative answers.
+ */
+typedef struct ir_widths ir_widths;
+
+/**
+ * Computes the widths for all integer nodes of @p irg.
+ */
+ir_widths *compute_widths(ir_graph *irg);
+
+/**
+ * Frees the width information.
+ */
+void free_widths(ir_widths *widths);
+
+/**
+ * Returns the number of low bits of @p node any of its users depends on.
+ */
+unsigned get_demanded_width(const ir_widths *widths, const ir_node *node);
+
+/**
+ * Returns whether all bits of @p node from bit @p bits on are known to be
+ * zero, i.e. the value is a zero extension of its lower @p bits bits.
+ */
+bool is_zero_extended(const ir_widths *widths, const ir_node *node,
+                      unsigned bits);
+
+/**
+ * Returns whether all bits of @p node from bit @p bits - 1 on are known to be
+ * equal, i.e. the value is a sign extension of its lower @p bits bits.
+ */
+bool is_sign_extended(const ir_widths *widths, const ir_node *node,
+                      unsigned bits);
+
+#endif
@@ -23,11 +23,11 @@
 
 #include "array.h"
 #include "pmap.h"
-#include "hashptr.h"
 #include "raw_bitset.h"
 #include "panic.h"
 
 #include "irgwalk.h"
+#include "irhooks.h"
 
 static ir_visited_t master_cg_visited = 0;
 
@@ -160,57 +160,139 @@ size_t get_irg_callee_loop_depth(const ir_graph *irg, size_t pos)
 
 
 /**
- * Pre-Walker called by compute_callgraph(), analyses all Call nodes.
+ * Adds the call edge from the graph of Call n to the entity callee_e.
+ */
+static void add_call_edge(pmap *entries, ir_node *n, ir_entity *callee_e)
+{
+	ir_graph *callee = get_entity_linktime_irg(callee_e);
+	if (callee == NULL)
+		return;
+
+	cg_callee_entry *found = pmap_get(cg_callee_entry, entries, callee);
+	if (found == NULL) { /* New callee, add the edge in both directions. */
+		ir_graph *irg = get_irn_irg(n);
+		found = OALLOC(get_irg_obstack(irg), cg_callee_entry);
+		found->irg       = callee;
+		found->call_list = NEW_ARR_F(ir_node *, 0);
+		found->max_depth = 0;
+		pmap_insert(entries, callee, found);
+		ARR_APP1(cg_callee_entry *, irg->callees, found);
+		ARR_APP1(ir_graph *, callee->callers, irg);
+	}
+	/* add Call node to list, compute new nesting. */
+	ARR_APP1(ir_node *, found->call_list, n);
+	unsigned depth = get_loop_depth(get_irn_loop(get_nodes_block(n)));
+	found->max_depth = MAX(found->max_depth, depth);
+}
+
+/**
+ * Pre-Walker called by compute_callee_edges(), analyses all Call nodes.
  */
 static void ana_Call(ir_node *n, void *env)
 {
-	(void)env;
 	if (!is_Call(n))
 		return;
 
-	ir_graph *irg = get_irn_irg(n);
-	for (size_t i = 0, n_callees = cg_get_call_n_callees(n); i < n_callees;
-	     ++i) {
-		ir_entity *callee_e = cg_get_call_callee(n, i);
-		ir_graph  *callee   = get_entity_linktime_irg(callee_e);
-
-		if (callee) {
-			cg_callee_entry buf;
-			buf.irg = callee;
-			pset_insert((pset *)callee->callers, irg, hash_ptr(irg));
-			cg_callee_entry *found = (cg_callee_entry*) pset_find((pset *)irg->callees, &buf, hash_ptr(callee));
-			if (found) {  /* add Call node to list, compute new nesting. */
-				ir_node **arr = found->call_list;
-				ARR_APP1(ir_node *, arr, n);
-				found->call_list = arr;
-			} else { /* New node, add Call node and init nesting. */
-				found = OALLOC(get_irg_obstack(irg), cg_callee_entry);
-				found->irg = callee;
-				found->call_list = NEW_ARR_F(ir_node *, 1);
-				found->call_list[0] = n;
-				found->max_depth = 0;
-				pset_insert((pset *)irg->callees, found, hash_ptr(callee));
+	pmap *entries = (pmap *)env;
+	if (cg_call_has_callees(n)) {
+		for (size_t i = 0, n_callees = cg_get_call_n_callees(n);
+		     i < n_callees; ++i) {
+			add_call_edge(entries, n, cg_get_call_callee(n, i));
+		}
+	} else {
+		/* A Call created after the callee analysis. */
+		ir_entity *callee_e = get_Call_callee(n);
+		if (callee_e != NULL)
+			add_call_edge(entries, n, callee_e);
+	}
+}
+
+/**
+ * Computes the callee edges of irg and adds irg to the callers of its
+ * callees.
+ */
+static void compute_callee_edges(ir_graph *irg)
+{
+	assure_loopinfo(irg);   // We also find the maximal loop depth of a call.
+
+	pmap *entries = pmap_create();
+	irg_walk_graph(irg, ana_Call, NULL, entries);
+	pmap_destroy(entries);
+	irg->callees_dirty = false;
+}
+
+/**
+ * Removes the callee edges of irg and irg from the callers of its callees.
+ */
+static void remove_callee_edges(ir_graph *irg)
+{
+	for (size_t i = 0, n_callees = ARR_LEN(irg->callees); i < n_callees; ++i) {
+		cg_callee_entry *entry   = irg->callees[i];
+		ir_graph       **callers = entry->irg->callers;
+		for (size_t j = 0, n_callers = ARR_LEN(callers); j < n_callers; ++j) {
+			if (callers[j] == irg) {
+				callers[j] = callers[n_callers - 1];
+				ARR_SHRINKLEN(callers, n_callers - 1);
+				break;
 			}
-			unsigned depth = get_loop_depth(get_irn_loop(get_nodes_block(n)));
-			found->max_depth = MAX(found->max_depth, depth);
 		}
+		DEL_ARR_F(entry->call_list);
+	}
+	ARR_SHRINKLEN(irg->callees, 0);
+}
+
+/**
+ * reset the backedge information for all callers in all irgs
+ */
+static void reset_isbe(void)
+{
+	foreach_irp_irg(i, irg) {
+		xfree(irg->caller_isbe);
+		irg->caller_isbe = NULL;
+
+		xfree(irg->callee_isbe);
+		irg->callee_isbe = NULL;
 	}
 }
 
-/** compare two ir graphs in a cg_callee_entry */
-static int cg_callee_entry_cmp(const void *elt, const void *key)
+static hook_entry_t cg_new_node_hook;
+static hook_entry_t cg_replace_hook;
+
+/** Marks the graph of a new Call as changed. */
+static void cg_new_node(void *context, ir_node *node)
 {
-	const cg_callee_entry *e1 = (const cg_callee_entry*) elt;
-	const cg_callee_entry *e2 = (const cg_callee_entry*) key;
-	return e1->irg != e2->irg;
+	(void)context;
+	if (is_Call(node))
+		get_irn_irg(node)->callees_dirty = true;
 }
 
-/** compare two ir graphs for pointer identity */
-static int graph_cmp(const void *elt, const void *key)
+/** Marks the graph of an exchanged Call as changed. */
+static void cg_replace(void *context, ir_node *old_node, ir_node *new_node)
 {
-	const ir_graph *e1 = (const ir_graph*) elt;
-	const ir_graph *e2 = (const ir_graph*) key;
-	return e1 != e2;
+	(void)context;
+	(void)new_node;
+	if (is_Call(old_node))
+		get_irn_irg(old_node)->callees_dirty = true;
+}
+
+static void register_callgraph_hooks(void)
+{
+	if (cg_new_node_hook.hook._hook_new_node != NULL)
+		return;
+	cg_new_node_hook.hook._hook_new_node = cg_new_node;
+	register_hook(hook_new_node, &cg_new_node_hook);
+	cg_replace_hook.hook._hook_replace = cg_replace;
+	register_hook(hook_replace, &cg_replace_hook);
+}
+
+static void unregister_callgraph_hooks(void)
+{
+	if (cg_new_node_hook.hook._hook_new_node == NULL)
+		return;
+	unregister_hook(hook_new_node, &cg_new_node_hook);
+	cg_new_node_hook.hook._hook_new_node = NULL;
+	unregister_hook(hook_replace, &cg_replace_hook);
+	cg_replace_hook.hook._hook_replace = NULL;
 }
 
 void compute_callgraph(void)
@@ -220,56 +302,66 @@ void compute_callgraph(void)
 
 	foreach_irp_irg(i, irg) {
 		assert(get_irg_callee_info_state(irg) == irg_callee_info_consistent);
-		irg->callees = (cg_callee_entry **)new_pset(cg_callee_entry_cmp, 8);
-		irg->callers = (ir_graph **)new_pset(graph_cmp, 8);
-		//construct_cf_backedges(irg);
+		irg->callees = NEW_ARR_F(cg_callee_entry *, 0);
+		irg->callers = NEW_ARR_F(ir_graph *, 0);
 	}
 
 	/* Compute the call graph */
 	foreach_irp_irg(i, irg) {
-		construct_cf_backedges(irg);   // We also find the maximal loop depth of a call.
-		irg_walk_graph(irg, ana_Call, NULL, NULL);
+		compute_callee_edges(irg);
+	}
+	register_callgraph_hooks();
+	set_irp_callgraph_state(irp_callgraph_consistent);
+}
+
+void update_callgraph(void)
+{
+	irp_callgraph_state state = get_irp_callgraph_state();
+	if (state == irp_callgraph_none || state == irp_callgraph_inconsistent) {
+		compute_callgraph();
+		return;
+	}
+
+	/* graphs created after the callgraph have no edges yet */
+	foreach_irp_irg(i, irg) {
+		if (irg->callees != NULL)
+			continue;
+		irg->callees       = NEW_ARR_F(cg_callee_entry *, 0);
+		irg->callers       = NEW_ARR_F(ir_graph *, 0);
+		irg->callees_dirty = true;
 	}
 
-	/* Change the sets to arrays. */
+	bool changed = false;
 	foreach_irp_irg(i, irg) {
-		pset *callee_set = (pset *)irg->callees;
-		size_t count = pset_count(callee_set);
-		irg->callees = NEW_ARR_F(cg_callee_entry *, count);
-		irg->callee_isbe = NULL;
-		size_t j = 0;
-		foreach_pset(callee_set, cg_callee_entry, callee) {
-			irg->callees[j++] = callee;
-		}
-		del_pset(callee_set);
-		assert(j == count);
-
-		pset *caller_set = (pset *)irg->callers;
-		count = pset_count(caller_set);
-		irg->callers = NEW_ARR_F(ir_graph *, count);
-		irg->caller_isbe =  NULL;
-		j = 0;
-		foreach_pset(caller_set, ir_graph, c) {
-			irg->callers[j++] = c;
-		}
-		del_pset(caller_set);
-		assert(j == count);
+		if (!irg->callees_dirty)
+			continue;
+		remove_callee_edges(irg);
+		compute_callee_edges(irg);
+		changed = true;
+	}
+	if (changed) {
+		reset_isbe();
+		set_irp_callgraph_state(irp_callgraph_consistent);
 	}
-	set_irp_callgraph_state(irp_callgraph_consistent);
 }
 
 void free_callgraph(void)
 {
 	foreach_irp_irg(i, irg) {
-		if (irg->callees) DEL_ARR_F(irg->callees);
+		if (irg->callees) {
+			for (size_t j = 0, n = ARR_LEN(irg->callees); j < n; ++j)
+				DEL_ARR_F(irg->callees[j]->call_list);
+			DEL_ARR_F(irg->callees);
+		}
 		if (irg->callers) DEL_ARR_F(irg->callers);
-		if (irg->callee_isbe) free(irg->callee_isbe);
-		if (irg->caller_isbe) free(irg->caller_isbe);
+		if (irg->callee_isbe) xfree(irg->callee_isbe);
+		if (irg->caller_isbe) xfree(irg->caller_isbe);
 		irg->callees = NULL;
 		irg->callers = NULL;
 		irg->callee_isbe = NULL;
 		irg->caller_isbe = NULL;
 	}
+	unregister_callgraph_hooks();
 	set_irp_callgraph_state(irp_callgraph_none);
 }
 
@@ -685,7 +777,21 @@ static ir_graph *find_tail(const ir_graph *n)
 	return get_irg_callee(m, res_index);
 }
 
-static void cgscc(ir_graph *n)
+/** A graph whose callees are being visited by cgscc(). */
+typedef struct cgscc_frame {
+	ir_graph *irg;     /**< the graph */
+	size_t    pos;     /**< the callee visited next */
+	bool      pending; /**< callee pos was visited, its uplink is not
+	                        propagated yet */
+	ir_loop  *loop;    /**< loop opened for the SCC of irg, if any */
+} cgscc_frame;
+
+static cgscc_frame *frames;
+
+/**
+ * Initializes n and pushes it on the frame stack, if it was not visited.
+ */
+static void cgscc_enter(ir_graph *n)
 {
 	if (cg_irg_visited(n))
 		return;
@@ -697,73 +803,90 @@ static void cgscc(ir_graph *n)
 	++current_dfn;
 	push(n);
 
-	for (size_t i = 0, n_callees = get_irg_n_callees(n); i < n_callees; ++i) {
-		if (is_irg_callee_backedge(n, i))
-			continue;
-		ir_graph *m = get_irg_callee(n, i);
-
-		/** This marks the backedge, but does it guarantee a correct loop tree? */
-		//if (m == n) { set_irg_callee_backedge(n, i); continue; }
+	cgscc_frame frame = { n, 0, false, NULL };
+	ARR_APP1(cgscc_frame, frames, frame);
+}
 
-		cgscc(m);
-		if (irg_is_in_stack(m)) {
-			/* Uplink of m is smaller if n->m is a backedge.
-			   Propagate the uplink to mark the cfloop. */
-			if (get_irg_uplink(m) < get_irg_uplink(n))
-				set_irg_uplink(n, get_irg_uplink(m));
+/**
+ * Computes the SCCs and the loop tree starting at root.  This is the
+ * recursive Tarjan walk with an explicit stack of frames, so deep call
+ * chains cannot overflow the C stack.
+ */
+static void cgscc(ir_graph *root)
+{
+	size_t const base = ARR_LEN(frames);
+	cgscc_enter(root);
+
+	while (ARR_LEN(frames) > base) {
+		cgscc_frame *frame = &frames[ARR_LEN(frames) - 1];
+		ir_graph    *n     = frame->irg;
+
+		if (frame->pos < get_irg_n_callees(n)) {
+			size_t i = frame->pos;
+			if (frame->pending) {
+				frame->pending = false;
+				++frame->pos;
+				ir_graph *m = get_irg_callee(n, i);
+				if (irg_is_in_stack(m)) {
+					/* Uplink of m is smaller if n->m is a backedge.
+					   Propagate the uplink to mark the cfloop. */
+					if (get_irg_uplink(m) < get_irg_uplink(n))
+						set_irg_uplink(n, get_irg_uplink(m));
+				}
+			} else if (is_irg_callee_backedge(n, i)) {
+				++frame->pos;
+			} else {
+				/** This marks the backedge, but does it guarantee a correct loop tree? */
+				//if (m == n) { set_irg_callee_backedge(n, i); continue; }
+
+				frame->pending = true;
+				cgscc_enter(get_irg_callee(n, i));
+			}
+			continue;
 		}
-	}
-
-	if (get_irg_dfn(n) == get_irg_uplink(n)) {
-		/* This condition holds for
-		   1) the node with the incoming backedge.
-		   That is: We found a cfloop!
-		   2) Straight line code, because no uplink has been propagated, so the
-		   uplink still is the same as the dfn.
-
-		   But n might not be a proper cfloop head for the analysis. Proper cfloop
-		   heads are Block and Phi nodes. find_tail searches the stack for
-		   Block's and Phi's and takes those nodes as cfloop heads for the current
-		   cfloop instead and marks the incoming edge as backedge. */
-
-		ir_graph *tail = find_tail(n);
-		if (tail) {
-			/* We have a cfloop, that is no straight line code,
-			   because we found a cfloop head!
-			   Next actions: Open a new cfloop on the cfloop tree and
-			   try to find inner cfloops */
-			ir_loop *l = new_loop();
-
-			/* Remove the cfloop from the stack ... */
-			pop_scc_unmark_visit(n);
-
-			/* The current backedge has been marked, that is temporarily eliminated,
-			   by find tail. Start the scc algorithm
-			   anew on the subgraph thats left (the current cfloop without the backedge)
-			   in order to find more inner cfloops. */
-
-			cgscc(tail);
 
+		if (frame->loop != NULL) {
+			/* The inner loops of the SCC have been found. */
 			assert(cg_irg_visited(n));
-			close_loop(l);
-		} else {
-			pop_scc_to_loop(n);
+			close_loop(frame->loop);
+			ARR_SHRINKLEN(frames, ARR_LEN(frames) - 1);
+			continue;
 		}
-	}
-}
-
 
-/**
- * reset the backedge information for all callers in all irgs
- */
-static void reset_isbe(void)
-{
-	foreach_irp_irg(i, irg) {
-		free(irg->caller_isbe);
-		irg->caller_isbe = NULL;
-
-		free(irg->callee_isbe);
-		irg->callee_isbe = NULL;
+		if (get_irg_dfn(n) == get_irg_uplink(n)) {
+			/* This condition holds for
+			   1) the node with the incoming backedge.
+			   That is: We found a cfloop!
+			   2) Straight line code, because no uplink has been propagated, so the
+			   uplink still is the same as the dfn.
+
+			   But n might not be a proper cfloop head for the analysis. Proper cfloop
+			   heads are Block and Phi nodes. find_tail searches the stack for
+			   Block's and Phi's and takes those nodes as cfloop heads for the current
+			   cfloop instead and marks the incoming edge as backedge. */
+
+			ir_graph *tail = find_tail(n);
+			if (tail) {
+				/* We have a cfloop, that is no straight line code,
+				   because we found a cfloop head!
+				   Next actions: Open a new cfloop on the cfloop tree and
+				   try to find inner cfloops */
+				frame->loop = new_loop();
+
+				/* Remove the cfloop from the stack ... */
+				pop_scc_unmark_visit(n);
+
+				/* The current backedge has been marked, that is temporarily eliminated,
+				   by find tail. Start the scc algorithm
+				   anew on the subgraph thats left (the current cfloop without the backedge)
+				   in order to find more inner cfloops.  The frame stays until this
+				   is done and closes the loop then. */
+				cgscc_enter(tail);
+				continue;
+			}
+			pop_scc_to_loop(n);
+		}
+		ARR_SHRINKLEN(frames, ARR_LEN(frames) - 1);
 	}
 }
 
@@ -782,6 +905,7 @@ void find_callgraph_recursions(void)
 	struct obstack temp;
 	obstack_init(&temp);
 	init_scc(&temp);
+	frames = NEW_ARR_F(cgscc_frame, 0);
 
 	current_loop = NULL;
 	new_loop();  /* sets current_loop */
@@ -796,6 +920,8 @@ void find_callgraph_recursions(void)
 		if (!cg_irg_visited(irg))
 			cgscc(irg);
 	}
+	DEL_ARR_F(frames);
+	frames = NULL;
 	obstack_free(&temp, NULL);
 
 	irp->outermost_cg_loop = current_loop;
@@ -819,7 +945,7 @@ void analyse_loop_nesting_depth(void)
 		ir_entity **free_methods = NULL;
 
 		cgana(&free_methods);
-		free(free_methods);
+		xfree(free_methods);
 	}
 
 	if (irp_callgraph_consistent != get_irp_callgraph_state()) {
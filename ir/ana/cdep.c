@@ -20,14 +20,88 @@
 #include "cdep_t.h"
 #include "irprintf.h"
 #include "irdump.h"
+#include "irdom.h"
 
 typedef struct cdep_info {
 	pmap          *cdep_map; /**< A map to find the list of all control dependence nodes for a block. */
 	struct obstack obst;     /**< An obstack where all cdep data lives on. */
+	bool           lazy;     /**< Compute the dependences on first query. */
+	ir_node       *end_block; /**< The end block of the graph. */
 } cdep_info;
 
 static cdep_info *cdep_data;
 
+/** Marks blocks without control dependences in lazy mode. */
+static ir_cdep no_cdep;
+
+/**
+ * Returns the immediate postdominator of block. Firm does NOT add the
+ * phantom edge from Start to End, so the ipostdom of the start block is
+ * taken to be the end block here.
+ */
+static ir_node *get_cdep_ipostdom(ir_node *block)
+{
+	if (block == get_irg_start_block(get_irn_irg(block)))
+		return cdep_data->end_block;
+	return get_Block_ipostdom(block);
+}
+
+/**
+ * Environment for computing the control dependences of a single block.
+ */
+typedef struct lazy_env {
+	ir_node *block; /**< The queried block. */
+	ir_cdep *list;  /**< The dependences found so far. */
+} lazy_env;
+
+/**
+ * Adds dep_on to the dependence list of env if it is not already contained.
+ */
+static void add_lazy_cdep(lazy_env *env, ir_node *dep_on)
+{
+	for (ir_cdep *dep = env->list; dep != NULL; dep = dep->next) {
+		if (dep->node == dep_on)
+			return;
+	}
+	ir_cdep *newdep = OALLOC(&cdep_data->obst, ir_cdep);
+	newdep->node = dep_on;
+	newdep->next = env->list;
+	env->list    = newdep;
+}
+
+/**
+ * Post dominator tree walker: The queried block is control dependent on a
+ * predecessor of a block it postdominates, unless it strictly postdominates
+ * the predecessor itself.
+ */
+static void lazy_cdep_walker(ir_node *block, void *ctx)
+{
+	lazy_env *env = (lazy_env*)ctx;
+	for (int i = get_Block_n_cfgpreds(block); i-- > 0; ) {
+		ir_node *pred = get_Block_cfgpred_block(block, i);
+		if (pred == NULL)
+			continue;
+
+		ir_node *pdom = get_cdep_ipostdom(pred);
+		assert(pdom != NULL && !is_Bad(pdom));
+		if (block_strictly_postdominates(pdom, env->block))
+			add_lazy_cdep(env, pred);
+	}
+}
+
+/**
+ * Computes and memoizes the control dependences of block.
+ */
+static ir_cdep *compute_block_cdep(const ir_node *block)
+{
+	lazy_env env = { .block = (ir_node*)block, .list = NULL };
+	postdom_tree_walk(env.block, lazy_cdep_walker, NULL, &env);
+
+	ir_cdep *const cdep = env.list != NULL ? env.list : &no_cdep;
+	pmap_insert(cdep_data->cdep_map, block, cdep);
+	return cdep;
+}
+
 ir_node *(get_cdep_node)(const ir_cdep *cdep)
 {
 	return _get_cdep_node(cdep);
@@ -41,13 +115,18 @@ ir_cdep *(get_cdep_next)(const ir_cdep *cdep)
 ir_cdep *find_cdep(const ir_node *block)
 {
 	assert(is_Block(block));
-	return pmap_get(ir_cdep, cdep_data->cdep_map, block);
+	ir_cdep *cdep = pmap_get(ir_cdep, cdep_data->cdep_map, block);
+	if (cdep == NULL && cdep_data->lazy)
+		cdep = compute_block_cdep(block);
+	return cdep != &no_cdep ? cdep : NULL;
 }
 
 void exchange_cdep(ir_node *old, const ir_node *nw)
 {
 	ir_cdep *cdep = find_cdep(nw);
 	assert(is_Block(old));
+	if (cdep == NULL && cdep_data->lazy)
+		cdep = &no_cdep;
 	pmap_insert(cdep_data->cdep_map, old, cdep);
 }
 
@@ -93,9 +172,9 @@ static void cdep_pre(ir_node *node, void *ctx)
 		if (pred == NULL)
 			continue;
 
-		ir_node *pdom = get_Block_ipostdom(pred);
+		ir_node *pdom = get_cdep_ipostdom(pred);
 		for (ir_node *dependee = node; dependee != pdom;
-		     dependee = get_Block_ipostdom(dependee)) {
+		     dependee = get_cdep_ipostdom(dependee)) {
 			assert(!is_Bad(pdom));
 			add_cdep(dependee, pred);
 		}
@@ -117,31 +196,35 @@ static int cdep_edge_hook(FILE *F, ir_node *block)
 	return 0;
 }
 
-void compute_cdep(ir_graph *irg)
+/**
+ * Allocates the control dependence info and assures the post dominance
+ * info it is computed from.
+ */
+static void init_cdep(ir_graph *irg, bool lazy)
 {
 	free_cdep(irg);
 	cdep_data = XMALLOC(cdep_info);
 	obstack_init(&cdep_data->obst);
 
-	cdep_data->cdep_map = pmap_create();
+	cdep_data->cdep_map  = pmap_create();
+	cdep_data->lazy      = lazy;
+	cdep_data->end_block = get_irg_end_block(irg);
 
 	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_POSTDOMINANCE);
+}
+
+void compute_cdep_lazy(ir_graph *irg)
+{
+	init_cdep(irg, true);
+}
 
-	/* we must temporary change the post dominator relation:
-	   the ipdom of the startblock is the end block.
-	   Firm does NOT add the phantom edge from Start to End.
-	 */
-	ir_node *const start_block = get_irg_start_block(irg);
-	ir_node *const end_block   = get_irg_end_block(irg);
-	ir_node *const rem         = get_Block_ipostdom(start_block);
-	set_Block_ipostdom(start_block, end_block);
+void compute_cdep(ir_graph *irg)
+{
+	init_cdep(irg, false);
 
 	irg_block_walk_graph(irg, cdep_pre, NULL, NULL);
 
 	(void)cdep_edge_hook;
-
-	/* restore the post dominator relation */
-	set_Block_ipostdom(start_block, rem);
 }
 
 void free_cdep(ir_graph *irg)
@@ -150,7 +233,7 @@ void free_cdep(ir_graph *irg)
 	if (cdep_data != NULL) {
 		pmap_destroy(cdep_data->cdep_map);
 		obstack_free(&cdep_data->obst, NULL);
-		free(cdep_data);
+		xfree(cdep_data);
 		cdep_data = NULL;
 	}
 }
@@ -17,15 +17,18 @@
  *  the program directly, or they are visible external.
  */
 #include "cgana.h"
+#include "callgraph.h"
 #include "xmalloc.h"
 #include "irnode_t.h"
 #include "irmode_t.h"
 #include "irprog_t.h"
+#include "irgraph_t.h"
 #include "irgwalk.h"
 #include "ircons.h"
 #include "irgmod.h"
 #include "iropt.h"
 #include "irtools.h"
+#include "irhooks.h"
 
 #include "irflag_t.h"
 #include "dbginfo_t.h"
@@ -42,6 +45,8 @@ static void *MARK = &MARK;
 
 static pset *entities = NULL;
 
+static hook_entry_t new_node_hook;
+
 int cg_call_has_callees(const ir_node *node)
 {
 	assert(is_Call(node));
@@ -327,17 +332,27 @@ static void free_mark(ir_node *node, pset *set)
 	}
 }
 
+/** Environment of free_ana_walker(). */
+typedef struct free_ana_env_t {
+	pset     *free_set; /**< the methods made free by the graph */
+	ir_node **calls;    /**< all Call nodes of the graph */
+} free_ana_env_t;
+
 /**
- * post-walker. Find method addresses.
+ * post-walker. Find method addresses and collect the Call nodes.
  */
 static void free_ana_walker(ir_node *node, void *env)
 {
+	free_ana_env_t *const ana_env = (free_ana_env_t*)env;
+	if (is_Call(node))
+		ARR_APP1(ir_node*, ana_env->calls, node);
+
 	if (get_irn_link(node) == MARK) {
 		/* already visited */
 		return;
 	}
 
-	pset *set = (pset*) env;
+	pset *set = ana_env->free_set;
 	switch (get_irn_opcode(node)) {
 		/* special nodes */
 	case iro_Address:
@@ -441,7 +456,7 @@ static void add_method_address(ir_entity *ent, pset *set)
  * returns a list of 'free' methods, i.e., the methods that can be called
  * from external or via function pointers.
  *
- * the data structures for sel_methods must be constructed before calling
+ * All graphs must have been analysed by analyse_irg() before calling
  * get_free_methods().
  */
 static size_t get_free_methods(ir_entity ***free_methods)
@@ -453,11 +468,10 @@ static size_t get_free_methods(ir_entity ***free_methods)
 		if (entity_is_externally_visible(ent))
 			pset_insert_ptr(free_set, ent);
 
-		ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
-		/* Find all method entities that gets "visible" through this graphs,
-		 * for instance because their address is stored. */
-		irg_walk_graph(irg, firm_clear_link, free_ana_walker, free_set);
-		ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+		/* all method entities that get "visible" through this graph */
+		ir_entity **const escaped = irg->escaped_methods;
+		for (size_t j = 0, n = ARR_LEN(escaped); j < n; ++j)
+			pset_insert_ptr(free_set, escaped[j]);
 	}
 
 	/* insert all methods that are used in global variables initializers */
@@ -499,18 +513,17 @@ static void callee_ana_node(ir_node *node, pset *methods);
 static void callee_ana_proj(ir_node *node, unsigned n, pset *methods)
 {
 	assert(get_irn_mode(node) == mode_T);
-	if (get_irn_link(node) == MARK) {
+	if (irn_visited_else_mark(node)) {
 		/* already visited */
 		return;
 	}
-	set_irn_link(node, MARK);
 
 	switch (get_irn_opcode(node)) {
 	case iro_Proj: {
 		/* proj_proj: in a correct graph we now get an op_Tuple or a node
 		 * returning a free method. */
 		ir_node *pred = get_Proj_pred(node);
-		if (get_irn_link(pred) != MARK) {
+		if (!irn_visited(pred)) {
 			if (is_Tuple(pred)) {
 				callee_ana_proj(get_Tuple_pred(pred, get_Proj_num(node)), n, methods);
 			} else {
@@ -540,11 +553,10 @@ static void callee_ana_node(ir_node *node, pset *methods)
 {
 	assert(mode_is_reference(get_irn_mode(node)) || is_Bad(node));
 	/* Beware of recursion */
-	if (get_irn_link(node) == MARK) {
+	if (irn_visited_else_mark(node)) {
 		/* already visited */
 		return;
 	}
-	set_irn_link(node, MARK);
 
 	switch (get_irn_opcode(node)) {
 	case iro_Const:
@@ -607,15 +619,23 @@ static void callee_ana_node(ir_node *node, pset *methods)
 }
 
 /**
- * Walker: Analyses every Call node and calculates an array of possible
- * callees for that call.
+ * The callgraph is built from the callee information, it has to be computed
+ * anew once that changed.
  */
-static void callee_walker(ir_node *call, void *env)
+static void invalidate_callgraph(void)
 {
-	(void)env;
-	if (!is_Call(call))
-		return;
+	if (get_irp_callgraph_state() != irp_callgraph_none)
+		set_irp_callgraph_state(irp_callgraph_inconsistent);
+}
 
+/**
+ * Analyses a Call node and calculates an array of possible callees for that
+ * call.
+ */
+static void callee_ana_call(ir_node *call)
+{
+	/* each call walks its address computation anew, they may share nodes */
+	inc_irg_visited(get_irn_irg(call));
 	pset *methods = pset_new_ptr_default();
 	callee_ana_node(get_Call_ptr(call), methods);
 	ir_entity **arr = NEW_ARR_F(ir_entity*, pset_count(methods));
@@ -635,21 +655,55 @@ static void callee_walker(ir_node *call, void *env)
 }
 
 /**
- * Determine for every Call the set of possibly called methods and stores it
- * inside the Call (@see set_Call_callee()).
- * Uses the sel_methods set with much be already calculated.
+ * Analyses a graph: Optimizes its Member nodes, computes the summary of the
+ * methods that get free through it and determines for every Call the set of
+ * possibly called methods (@see set_Call_callee()).
  */
-static void callee_ana(void)
+static void analyse_irg(ir_graph *irg)
 {
-	/* analyse all graphs */
-	foreach_irp_irg(i, irg) {
-		assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_TUPLES);
-		ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
-		irg_walk_graph(irg, callee_walker, NULL, NULL);
-		ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
-		set_irg_callee_info_state(irg, irg_callee_info_consistent);
-	}
-	set_irp_callee_info_state(irg_callee_info_consistent);
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_TUPLES);
+	irg_walk_graph(irg, sel_methods_walker, NULL, NULL);
+
+	free_ana_env_t env;
+	env.free_set = pset_new_ptr_default();
+	env.calls    = NEW_ARR_F(ir_node*, 0);
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	irg_walk_graph(irg, firm_clear_link, free_ana_walker, &env);
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_VISITED);
+	for (size_t i = 0, n = ARR_LEN(env.calls); i < n; ++i)
+		callee_ana_call(env.calls[i]);
+	ir_free_resources(irg, IR_RESOURCE_IRN_VISITED);
+	DEL_ARR_F(env.calls);
+
+	if (irg->escaped_methods != NULL)
+		DEL_ARR_F(irg->escaped_methods);
+	ir_entity **escaped = NEW_ARR_F(ir_entity*, pset_count(env.free_set));
+	size_t      i       = 0;
+	foreach_pset(env.free_set, ir_entity, ent) {
+		escaped[i++] = ent;
+	}
+	del_pset(env.free_set);
+	irg->escaped_methods = escaped;
+
+	set_irg_callee_info_state(irg, irg_callee_info_consistent);
+}
+
+/**
+ * The callee information of graphs that are not changed since their last
+ * analysis is kept.  New Call, Address and Member nodes may add callees or
+ * free methods, so they mark the callee information of their graph as
+ * inconsistent.
+ */
+static void cgana_new_node(void *context, ir_node *node)
+{
+	(void)context;
+	if (!is_Call(node) && !is_Address(node) && !is_Member(node))
+		return;
+	ir_graph *irg = get_irn_irg(node);
+	if (get_irg_callee_info_state(irg) == irg_callee_info_consistent)
+		set_irg_callee_info_state(irg, irg_callee_info_inconsistent);
 }
 
 /*--------------------------------------------------------------------------*/
@@ -680,11 +734,28 @@ static void destruct_walker(ir_node *node, void *env)
 
 size_t cgana(ir_entity ***free_methods)
 {
-	/* Optimize Address/Member nodes and compute all methods that implement an
-	 * entity. */
-	sel_methods_init();
+	if (new_node_hook.hook._hook_new_node == NULL) {
+		new_node_hook.hook._hook_new_node = cgana_new_node;
+		register_hook(hook_new_node, &new_node_hook);
+	}
+
+	/* Only (re)analyse graphs whose callee information is not consistent,
+	 * the others keep their callees and free method summary. */
+	assert(entities == NULL);
+	entities = pset_new_ptr_default();
+	bool changed = false;
+	foreach_irp_irg(i, irg) {
+		if (get_irg_callee_info_state(irg) == irg_callee_info_consistent
+		    && irg->escaped_methods != NULL)
+			continue;
+		analyse_irg(irg);
+		changed = true;
+	}
+	set_irp_callee_info_state(irg_callee_info_consistent);
+	if (changed)
+		invalidate_callgraph();
+
 	size_t length = get_free_methods(free_methods);
-	callee_ana();
 	sel_methods_dispose();
 	return length;
 }
@@ -692,7 +763,12 @@ size_t cgana(ir_entity ***free_methods)
 void free_callee_info(ir_graph *irg)
 {
 	irg_walk_graph(irg, destruct_walker, NULL, NULL);
+	if (irg->escaped_methods != NULL) {
+		DEL_ARR_F(irg->escaped_methods);
+		irg->escaped_methods = NULL;
+	}
 	set_irg_callee_info_state(irg, irg_callee_info_none);
+	invalidate_callgraph();
 }
 
 void free_irp_callee_info(void)
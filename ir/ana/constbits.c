@@ -12,10 +12,12 @@
 
 #include <assert.h>
 
+#include "adt/array.h"
 #include "adt/pdeq.h"
 #include "debug.h"
 #include "iredges_t.h"
 #include "irgwalk.h"
+#include "irhooks.h"
 #include "irnode_t.h"
 #include "irnodemap.h"
 #include "iropt.h"
@@ -170,50 +172,37 @@ static bitinfo *get_bitinfo_direct(ir_node const *const irn)
 	return b;
 }
 
-static void calc_bitinfo(ir_node const *irn, bitinfo *b);
+static bitinfo *get_bitinfo_incremental(ir_node const *irn);
+static bitinfo *compute_new_bitinfo(ir_node const *irn);
+
+static bitinfo *(*get_bitinfo_func)(ir_node const*) = &get_bitinfo_null;
 
 /**
- * Get analysis information for node @p irn.
+ * Get analysis information for an operand of a transfer function.
  *
- * If it is not available, calculate it.
+ * After the analysis finished, nodes created by later transformations do not
+ * have information yet, so calculate it.
  */
-static bitinfo *get_bitinfo_recursive(ir_node const *const irn)
+static bitinfo *get_operand_bitinfo(ir_node const *const irn)
 {
-	ir_graph   *const irg = get_irn_irg(irn);
-	ir_nodemap *const map = &irg->bitinfo.map;
-	bitinfo          *b   = ir_nodemap_get(bitinfo, map, irn);
-	if (!b || b->state == BITINFO_INVALID || b->state == BITINFO_UNSTABLE) {
-		ir_mode *mode = get_irn_mode(irn);
-		if (mode == mode_BB || mode == mode_X) {
-			/* Blocks and jumps use a boolean domain. */
-			mode = mode_b;
-		} else if (!mode_is_intb(mode)) {
-			return NULL;
-		}
-
-		/* Insert bottom to break cycles. */
-		struct obstack *const obst = &irg->bitinfo.obst;
-		if (!b)
-			b = OALLOCZ(obst, bitinfo);
-		if (b->state == BITINFO_INVALID) {
-			b->z = get_mode_null(mode);
-			b->o = get_mode_all_one(mode);
-		}
-		ir_nodemap_insert(map, irn, b);
-
-		calc_bitinfo(irn, b);
-	}
+	bitinfo *const b = get_bitinfo_direct(irn);
+	if (!b && get_bitinfo_func == &get_bitinfo_incremental)
+		return compute_new_bitinfo(irn);
 	return b;
 }
 
-static bitinfo *(*get_bitinfo_func)(ir_node const*) = &get_bitinfo_null;
-
 bitinfo *get_bitinfo(ir_node const *const irn)
 {
 	return get_bitinfo_func(irn);
 }
 
-static bool transfer(ir_node const *const irn)
+/**
+ * Evaluate the transfer function of @p irn on the current information of its
+ * operands.
+ *
+ * @return false if @p irn cannot be analysed at all
+ */
+static bool compute_bitinfo(ir_node const *const irn, ir_tarval **const z_out, ir_tarval **const o_out)
 {
 	ir_tarval *const f = tarval_b_false;
 	ir_tarval *const t = tarval_b_true;
@@ -224,7 +213,7 @@ static bool transfer(ir_node const *const irn)
 	if (m == mode_X) {
 		DB((dbg, LEVEL_3, "transfer %+F\n", irn));
 
-		bitinfo *const b = get_bitinfo_recursive(get_nodes_block(irn));
+		bitinfo *const b = get_operand_bitinfo(get_nodes_block(irn));
 		if (b->z == f) {
 unreachable_X:
 			z = f;
@@ -239,7 +228,7 @@ unreachable_X:
 					goto result_unknown_X;
 				} else if (is_Cond(pred)) {
 					ir_node   *const selector = get_Cond_selector(pred);
-					bitinfo   *const b        = get_bitinfo_recursive(selector);
+					bitinfo   *const b        = get_operand_bitinfo(selector);
 					if (is_undefined(b))
 						goto unreachable_X;
 					if (b->z == b->o) {
@@ -253,7 +242,7 @@ unreachable_X:
 					}
 				} else if (is_Switch(pred)) {
 					ir_node *const selector = get_Switch_selector(pred);
-					bitinfo *const b        = get_bitinfo_recursive(selector);
+					bitinfo *const b        = get_operand_bitinfo(selector);
 					if (is_undefined(b))
 						goto unreachable_X;
 					/* TODO */
@@ -279,7 +268,7 @@ result_unknown_X:
 		DB((dbg, LEVEL_3, "transfer %+F\n", irn));
 		bool reachable = false;
 		foreach_irn_in(irn, i, pred_block) {
-			bitinfo *const b = get_bitinfo_recursive(pred_block);
+			bitinfo *const b = get_operand_bitinfo(pred_block);
 			if (b->z == t) {
 				reachable = true;
 				/* We need to iterate all operands to reach a global fix point.
@@ -307,32 +296,20 @@ result_unknown_X:
 		if (is_Phi(irn)) {
 			ir_node *const block = get_nodes_block(irn);
 
-repeatphi:
 			z = get_mode_null(m);
 			o = get_mode_all_one(m);
 			foreach_irn_in(block, i, pred_block) {
-				bitinfo *const b_cfg = get_bitinfo_recursive(pred_block);
+				bitinfo *const b_cfg = get_operand_bitinfo(pred_block);
 				if (b_cfg->z != f) {
-					bitinfo *const b = get_bitinfo_recursive(get_Phi_pred(irn, i));
+					bitinfo *const b = get_operand_bitinfo(get_Phi_pred(irn, i));
 					z = tarval_or( z, b->z);
 					o = tarval_and(o, b->o);
 				}
 			}
-			/* Computing bitinfo for operand 1 might render operand 0 unstable.
-			 * Thus, evaluate the operands until all of them are stable. */
-			foreach_irn_in(block, i, pred_block) {
-				bitinfo *const b_cfg = get_bitinfo_recursive(pred_block);
-				if (b_cfg->z != f) {
-					bitinfo *const b = get_bitinfo_direct(get_Phi_pred(irn, i));
-					if (b->state == BITINFO_UNSTABLE) {
-						goto repeatphi;
-					}
-				}
-			}
 		} else {
 			/* Undefined if any input is undefined. */
 			foreach_irn_in(irn, i, pred) {
-				bitinfo *const pred_b = get_bitinfo_recursive(pred);
+				bitinfo *const pred_b = get_operand_bitinfo(pred);
 				if (pred_b != NULL && is_undefined(pred_b))
 					goto undefined;
 			}
@@ -351,12 +328,12 @@ undefined:
 
 				case iro_Confirm: {
 					ir_node *const v = get_Confirm_value(irn);
-					bitinfo *const b = get_bitinfo_recursive(v);
+					bitinfo *const b = get_operand_bitinfo(v);
 					/* TODO Use bound and relation. */
 					z = b->z;
 					o = b->o;
 					if ((get_Confirm_relation(irn) & ~ir_relation_unordered) == ir_relation_equal) {
-						bitinfo *const bound_b = get_bitinfo_recursive(get_Confirm_bound(irn));
+						bitinfo *const bound_b = get_operand_bitinfo(get_Confirm_bound(irn));
 						z = tarval_and(z, bound_b->z);
 						o = tarval_or( o, bound_b->o);
 					}
@@ -365,8 +342,8 @@ undefined:
 
 				case iro_Shl: {
 					ir_node   *const right = get_Shl_right(irn);
-					bitinfo   *const l     = get_bitinfo_recursive(get_Shl_left(irn));
-					bitinfo   *const r     = get_bitinfo_recursive(right);
+					bitinfo   *const l     = get_operand_bitinfo(get_Shl_left(irn));
+					bitinfo   *const r     = get_operand_bitinfo(right);
 					ir_tarval *const lo    = l->o;
 					ir_tarval *const lz    = l->z;
 					ir_tarval *const ro    = r->o;
@@ -409,8 +386,8 @@ undefined:
 
 				case iro_Shr: {
 					ir_node   *const right = get_Shr_right(irn);
-					bitinfo   *const l     = get_bitinfo_recursive(get_Shr_left(irn));
-					bitinfo   *const r     = get_bitinfo_recursive(right);
+					bitinfo   *const l     = get_operand_bitinfo(get_Shr_left(irn));
+					bitinfo   *const r     = get_operand_bitinfo(right);
 					ir_tarval *const lz    = l->z;
 					ir_tarval *const lo    = l->o;
 					ir_tarval *const rz    = r->z;
@@ -453,8 +430,8 @@ undefined:
 
 				case iro_Shrs: {
 					ir_node   *const right = get_Shrs_right(irn);
-					bitinfo   *const l     = get_bitinfo_recursive(get_Shrs_left(irn));
-					bitinfo   *const r     = get_bitinfo_recursive(right);
+					bitinfo   *const l     = get_operand_bitinfo(get_Shrs_left(irn));
+					bitinfo   *const r     = get_operand_bitinfo(right);
 					ir_tarval *const lz    = l->z;
 					ir_tarval *const lo    = l->o;
 					ir_tarval *const rz    = r->z;
@@ -496,8 +473,8 @@ undefined:
 				}
 
 				case iro_Add: {
-					bitinfo   *const l   = get_bitinfo_recursive(get_Add_left(irn));
-					bitinfo   *const r   = get_bitinfo_recursive(get_Add_right(irn));
+					bitinfo   *const l   = get_operand_bitinfo(get_Add_left(irn));
+					bitinfo   *const r   = get_operand_bitinfo(get_Add_right(irn));
 					ir_tarval *const lz  = l->z;
 					ir_tarval *const lo  = l->o;
 					ir_tarval *const rz  = r->z;
@@ -514,8 +491,8 @@ undefined:
 				}
 
 				case iro_Sub: {
-					bitinfo *const l = get_bitinfo_recursive(get_Sub_left(irn));
-					bitinfo *const r = get_bitinfo_recursive(get_Sub_right(irn));
+					bitinfo *const l = get_operand_bitinfo(get_Sub_left(irn));
+					bitinfo *const r = get_operand_bitinfo(get_Sub_right(irn));
 					// might subtract pointers
 					if (l == NULL || r == NULL)
 						goto cannot_analyse;
@@ -536,8 +513,8 @@ undefined:
 				}
 
 				case iro_Mul: {
-					bitinfo   *const l  = get_bitinfo_recursive(get_Mul_left(irn));
-					bitinfo   *const r  = get_bitinfo_recursive(get_Mul_right(irn));
+					bitinfo   *const l  = get_operand_bitinfo(get_Mul_left(irn));
+					bitinfo   *const r  = get_operand_bitinfo(get_Mul_right(irn));
 					ir_tarval *      lz = l->z;
 					ir_tarval *      lo = l->o;
 					ir_tarval *      rz = r->z;
@@ -577,7 +554,7 @@ undefined:
 
 				case iro_Minus: {
 					/* -a = 0 - a */
-					bitinfo   *const b   = get_bitinfo_recursive(get_Minus_op(irn));
+					bitinfo   *const b   = get_operand_bitinfo(get_Minus_op(irn));
 					ir_tarval *const bz  = b->z;
 					ir_tarval *const bo  = b->o;
 					ir_tarval *const vz  = tarval_neg(bz);
@@ -592,24 +569,24 @@ undefined:
 				}
 
 				case iro_And: {
-					bitinfo *const l = get_bitinfo_recursive(get_And_left(irn));
-					bitinfo *const r = get_bitinfo_recursive(get_And_right(irn));
+					bitinfo *const l = get_operand_bitinfo(get_And_left(irn));
+					bitinfo *const r = get_operand_bitinfo(get_And_right(irn));
 					z = tarval_and(l->z, r->z);
 					o = tarval_and(l->o, r->o);
 					break;
 				}
 
 				case iro_Or: {
-					bitinfo *const l = get_bitinfo_recursive(get_Or_left(irn));
-					bitinfo *const r = get_bitinfo_recursive(get_Or_right(irn));
+					bitinfo *const l = get_operand_bitinfo(get_Or_left(irn));
+					bitinfo *const r = get_operand_bitinfo(get_Or_right(irn));
 					z = tarval_or(l->z, r->z);
 					o = tarval_or(l->o, r->o);
 					break;
 				}
 
 				case iro_Eor: {
-					bitinfo   *const l  = get_bitinfo_recursive(get_Eor_left(irn));
-					bitinfo   *const r  = get_bitinfo_recursive(get_Eor_right(irn));
+					bitinfo   *const l  = get_operand_bitinfo(get_Eor_left(irn));
+					bitinfo   *const r  = get_operand_bitinfo(get_Eor_right(irn));
 					ir_tarval *const lz = l->z;
 					ir_tarval *const lo = l->o;
 					ir_tarval *const rz = r->z;
@@ -620,14 +597,14 @@ undefined:
 				}
 
 				case iro_Not: {
-					bitinfo *const b = get_bitinfo_recursive(get_Not_op(irn));
+					bitinfo *const b = get_operand_bitinfo(get_Not_op(irn));
 					z = tarval_not(b->o);
 					o = tarval_not(b->z);
 					break;
 				}
 
 				case iro_Conv: {
-					bitinfo *const b = get_bitinfo_recursive(get_Conv_op(irn));
+					bitinfo *const b = get_operand_bitinfo(get_Conv_op(irn));
 					if (b == NULL) // Happens when converting from float values.
 						goto result_unknown;
 					z = tarval_convert_to(b->z, m);
@@ -636,9 +613,9 @@ undefined:
 				}
 
 				case iro_Mux: {
-					bitinfo *const bf = get_bitinfo_recursive(get_Mux_false(irn));
-					bitinfo *const bt = get_bitinfo_recursive(get_Mux_true(irn));
-					bitinfo *const c  = get_bitinfo_recursive(get_Mux_sel(irn));
+					bitinfo *const bf = get_operand_bitinfo(get_Mux_false(irn));
+					bitinfo *const bt = get_operand_bitinfo(get_Mux_true(irn));
+					bitinfo *const c  = get_operand_bitinfo(get_Mux_sel(irn));
 					if (c->o == t) {
 						z = bt->z;
 						o = bt->o;
@@ -653,8 +630,8 @@ undefined:
 				}
 
 				case iro_Cmp: {
-					bitinfo *const l = get_bitinfo_recursive(get_Cmp_left(irn));
-					bitinfo *const r = get_bitinfo_recursive(get_Cmp_right(irn));
+					bitinfo *const l = get_operand_bitinfo(get_Cmp_left(irn));
+					bitinfo *const r = get_operand_bitinfo(get_Cmp_right(irn));
 					if (l == NULL || r == NULL)
 						goto result_unknown; // Cmp compares something we cannot evaluate.
 					ir_tarval  *const lz       = l->z;
@@ -734,7 +711,7 @@ undefined:
 					if (is_Tuple(pred)) {
 						unsigned       pn = get_Proj_num(irn);
 						ir_node *const op = get_Tuple_pred(pred, pn);
-						bitinfo *const b  = get_bitinfo_recursive(op);
+						bitinfo *const b  = get_operand_bitinfo(op);
 						z = b->z;
 						o = b->o;
 						goto set_info;
@@ -756,15 +733,26 @@ result_unknown:
 		return false;
 	}
 
-set_info:;
+set_info:
+	*z_out = z;
+	*o_out = o;
+	return true;
+}
+
+static bool transfer(ir_node const *const irn)
+{
+	ir_tarval *z;
+	ir_tarval *o;
+	if (!compute_bitinfo(irn, &z, &o))
+		return false;
 	bool changed = set_bitinfo(irn, z, o);
 	DB((dbg, LEVEL_4, "finish transfer %+F\n", irn));
 	return changed;
 }
 
-static void trigger_users(ir_node const *irn);
+static void trigger_users(pdeq *worklist, ir_node const *irn);
 
-static void trigger(ir_node const *const irn, ir_node const *const operand)
+static void trigger(pdeq *const worklist, ir_node const *const irn, ir_node const *const operand)
 {
 	(void)operand;
 
@@ -772,13 +760,13 @@ static void trigger(ir_node const *const irn, ir_node const *const operand)
 	if (b && b->state == BITINFO_VALID) {
 		DB((dbg, LEVEL_5, "%+F triggers %+F\n", operand, irn));
 		b->state = BITINFO_UNSTABLE;
-		trigger_users(irn);
+		pdeq_putr(worklist, irn);
 	} else {
 		DB((dbg, LEVEL_5, "%+F does not trigger %+F\n", operand, irn));
 	}
 }
 
-static void trigger_users(ir_node const *const irn)
+static void trigger_users(pdeq *const worklist, ir_node const *const irn)
 {
 	if (is_Bad(irn))
 		return;
@@ -789,7 +777,7 @@ static void trigger_users(ir_node const *const irn)
 		foreach_out_edge(irn, e) {
 			ir_node *const src = get_edge_src_irn(e);
 			if (get_irn_mode(src) == mode_X)
-				trigger(src, irn);
+				trigger(worklist, src, irn);
 		}
 	} else if (get_irn_mode(irn) == mode_X) {
 		if (!is_End(irn)) {
@@ -799,11 +787,11 @@ static void trigger_users(ir_node const *const irn)
 			foreach_out_edge(irn, e) {
 				ir_node *const src = get_edge_src_irn(e);
 				if (is_Block(src)) {
-					trigger(src, irn);
+					trigger(worklist, src, irn);
 					foreach_out_edge(src, f) {
 						ir_node *const phi = get_edge_src_irn(f);
 						if (is_Phi(phi))
-							trigger(phi, irn);
+							trigger(worklist, phi, irn);
 					}
 				} else {
 					assert(is_Tuple(src) && get_nodes_block(src) == get_nodes_block(irn));
@@ -816,34 +804,152 @@ static void trigger_users(ir_node const *const irn)
 			if (get_irn_mode(src) == mode_T) {
 				/* Trigger Projs of tuple nodes.  They might contain analysis information,
 				 * but the tuple node does not. */
-				trigger_users(src);
+				trigger_users(worklist, src);
 			} else {
-				trigger(src, irn);
+				trigger(worklist, src, irn);
 			}
 		}
 	}
 }
 
-static void calc_bitinfo(ir_node const *const irn, bitinfo *const b)
+/**
+ * Start all analysable nodes at bottom.  The walk is in post order, so the
+ * worklist initially evaluates operands before their users.
+ */
+static void init_bitinfo_walker(ir_node *const n, void *const env)
+{
+	pdeq *const worklist = (pdeq*)env;
+
+	ir_mode *mode = get_irn_mode(n);
+	if (mode == mode_BB || mode == mode_X) {
+		/* Blocks and jumps use a boolean domain. */
+		mode = mode_b;
+	} else if (!mode_is_intb(mode)) {
+		return;
+	}
+
+	ir_graph       *const irg  = get_irn_irg(n);
+	struct obstack *const obst = &irg->bitinfo.obst;
+	bitinfo        *const b    = OALLOCZ(obst, bitinfo);
+	b->z     = get_mode_null(mode);
+	b->o     = get_mode_all_one(mode);
+	b->state = BITINFO_UNSTABLE;
+	ir_nodemap_insert(&irg->bitinfo.map, n, b);
+	pdeq_putr(worklist, n);
+}
+
+/**
+ * Calculate analysis information for a node, which was created after the
+ * analysis finished.  Phis and blocks get top: Their operands are often
+ * completed only after construction and they may be part of a cycle.
+ */
+static bitinfo *compute_new_bitinfo(ir_node const *const irn)
+{
+	ir_mode *mode = get_irn_mode(irn);
+	if (mode == mode_BB || mode == mode_X) {
+		mode = mode_b;
+	} else if (!mode_is_intb(mode)) {
+		return NULL;
+	}
+
+	ir_graph       *const irg  = get_irn_irg(irn);
+	struct obstack *const obst = &irg->bitinfo.obst;
+	bitinfo        *const b    = OALLOCZ(obst, bitinfo);
+	b->z     = get_mode_all_one(mode);
+	b->o     = get_mode_null(mode);
+	b->state = BITINFO_IN_FLIGHT;
+	ir_nodemap_insert(&irg->bitinfo.map, irn, b);
+
+	if (!is_Phi(irn) && !is_Block(irn)) {
+		ir_tarval *z;
+		ir_tarval *o;
+		if (compute_bitinfo(irn, &z, &o)) {
+			b->z = z;
+			b->o = o;
+		}
+	}
+	b->state = BITINFO_VALID;
+	DB((dbg, LEVEL_3, "New %+F: 0:%T 1:%T\n", irn, b->z, b->o));
+	return b;
+}
+
+/**
+ * Combine the information of @p irn with the result of its transfer function.
+ * Both describe the value of @p irn, so their meet does, too.
+ */
+static bool refine_bitinfo(ir_node const *const irn, bitinfo *const b)
 {
-	do {
-		b->state = BITINFO_IN_FLIGHT;
-		bool const changed = transfer(irn);
+	ir_tarval *z;
+	ir_tarval *o;
+	if (!compute_bitinfo(irn, &z, &o))
+		return false;
+
+	z = tarval_and(z, b->z);
+	o = tarval_or( o, b->o);
+	if (z == b->z && o == b->o)
+		return false;
+	/* Do not produce contradicting bits, the node is dead code then. */
+	if (!tarval_is_null(tarval_andnot(o, z)))
+		return false;
+
+	b->z = z;
+	b->o = o;
+	DB((dbg, LEVEL_3, "Refine %+F: 0:%T 1:%T\n", irn, z, o));
+	return true;
+}
+
+/**
+ * Revisit the users of nodes, which replaced other nodes since the last query.
+ * Only information reachable from the replacements changes.
+ */
+static void update_replaced(ir_graph *const irg)
+{
+	ir_node **const replaced = irg->bitinfo.replaced;
+	if (!edges_activated(irg)) {
+		ARR_SHRINKLEN(replaced, 0);
+		return;
+	}
+
+	pdeq *const worklist = new_pdeq();
+	for (size_t i = 0, n = ARR_LEN(replaced); i < n; ++i) {
+		ir_node *const nw = replaced[i];
+		if (!is_Deleted(nw) && get_operand_bitinfo(nw))
+			trigger_users(worklist, nw);
+	}
+	ARR_SHRINKLEN(replaced, 0);
+
+	while (!pdeq_empty(worklist)) {
+		ir_node const *const irn = (ir_node const*)pdeq_getl(worklist);
+		bitinfo       *const b   = get_bitinfo_direct(irn);
 		b->state = BITINFO_VALID;
-		if (changed)
-			trigger_users(irn);
-	} while (b->state != BITINFO_VALID);
+		if (refine_bitinfo(irn, b))
+			trigger_users(worklist, irn);
+	}
+	del_pdeq(worklist);
+}
+
+static bitinfo *get_bitinfo_incremental(ir_node const *const irn)
+{
+	ir_graph *const irg = get_irn_irg(irn);
+	if (ARR_LEN(irg->bitinfo.replaced) != 0)
+		update_replaced(irg);
+	return get_operand_bitinfo(irn);
 }
 
-static void calc_bitinfo_walker(ir_node *const n, void *const env)
+static void constbits_replace(void *const ctx, ir_node *const old, ir_node *const nw)
 {
-	(void)env;
+	(void)ctx;
+
+	if (get_bitinfo_func != &get_bitinfo_incremental || !nw || nw == old || is_Bad(nw))
+		return;
 
-	ir_mode *const mode = get_irn_mode(n);
-	if (mode_is_intb(mode) || mode == mode_BB || mode == mode_X)
-		get_bitinfo_recursive(n);
+	ir_graph *const irg = get_irn_irg(nw);
+	if (irg->bitinfo.map.data && mode_is_intb(get_irn_mode(nw)))
+		ARR_APP1(ir_node*, irg->bitinfo.replaced, nw);
 }
 
+static hook_entry_t replace_hook;
+
 #if VERIFY_CONSTBITS
 static void verify_constbits_walker(ir_node *const n, void *const env)
 {
@@ -879,20 +985,39 @@ void constbits_analyze(ir_graph *const irg)
 
 	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
 
+	if (replace_hook.hook._hook_replace == NULL) {
+		replace_hook.hook._hook_replace = constbits_replace;
+		register_hook(hook_replace, &replace_hook);
+	}
+
 	obstack_init(&irg->bitinfo.obst);
 	ir_nodemap_init(&irg->bitinfo.map, irg);
-	get_bitinfo_func = &get_bitinfo_recursive;
-	irg_walk_graph(irg, NULL, calc_bitinfo_walker, NULL);
+	irg->bitinfo.replaced = NEW_ARR_F(ir_node*, 0);
 	get_bitinfo_func = &get_bitinfo_direct;
 
+	pdeq *const worklist = new_pdeq();
+	irg_walk_graph(irg, NULL, init_bitinfo_walker, worklist);
+	while (!pdeq_empty(worklist)) {
+		ir_node const *const irn = (ir_node const*)pdeq_getl(worklist);
+		bitinfo       *const b   = get_bitinfo_direct(irn);
+		b->state = BITINFO_VALID;
+		if (transfer(irn))
+			trigger_users(worklist, irn);
+	}
+	del_pdeq(worklist);
+
 #if VERIFY_CONSTBITS
 	verify_constbits(irg);
 #endif
+
+	get_bitinfo_func = &get_bitinfo_incremental;
 }
 
 void constbits_clear(ir_graph *const irg)
 {
 	get_bitinfo_func = &get_bitinfo_null;
+	DEL_ARR_F(irg->bitinfo.replaced);
+	irg->bitinfo.replaced = NULL;
 	ir_nodemap_destroy(&irg->bitinfo.map);
 	obstack_free(&irg->bitinfo.obst, NULL);
 }
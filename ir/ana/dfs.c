@@ -176,9 +176,9 @@ void dfs_free(dfs_t *dfs)
 {
 	del_set(dfs->nodes);
 	del_set(dfs->edges);
-	free(dfs->pre_order);
-	free(dfs->post_order);
-	free(dfs);
+	xfree(dfs->pre_order);
+	xfree(dfs->post_order);
+	xfree(dfs);
 }
 
 static void dfs_dump_edge(const dfs_edge_t *edge, FILE *file)
@@ -241,5 +241,5 @@ void dfs_dump(const dfs_t *dfs, FILE *file)
 		dfs_dump_edge(edge, file);
 
 	ir_fprintf(file, "}\n");
-	free(nodes);
+	xfree(nodes);
 }
@@ -38,7 +38,7 @@ static inline ir_node *get_idom(ir_node *bl)
  */
 static ir_node **compute_df(ir_node *blk, ir_dom_front_info_t *info)
 {
-	ir_node **df_list = NEW_ARR_F(ir_node *, 0);
+	ir_node **df_list = NEW_ARR_A(ir_node*, 16);
 
 	/* Add local dominance frontiers */
 	foreach_block_succ(blk, edge) {
@@ -77,6 +77,7 @@ void ir_compute_dominance_frontiers(ir_graph *irg)
 {
 	ir_dom_front_info_t *info = &irg->domfront;
 
+	ir_analysis_start(IR_ANALYSIS_DOMINANCE_FRONTIERS);
 	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
 	                         | IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
 	obstack_init(&info->obst);
@@ -84,6 +85,7 @@ void ir_compute_dominance_frontiers(ir_graph *irg)
 	compute_df(get_irg_start_block(irg), info);
 
 	add_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE_FRONTIERS);
+	ir_analysis_stop(IR_ANALYSIS_DOMINANCE_FRONTIERS);
 }
 
 void ir_free_dominance_frontiers(ir_graph *irg)
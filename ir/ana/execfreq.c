@@ -24,7 +24,18 @@
  * no path to the end node, which produces undesired results (0, infinite
  * execution frequencies). We alleviate that by adding artificial edges from
  * kept blocks with a path to end.
+ *
+ * Small CFGs are solved exactly with a dense QR decomposition. This needs
+ * O(n^2) memory and O(n^3) time, so larger CFGs use a sparse estimator
+ * instead: For reducible CFGs the frequencies are propagated along the
+ * loop nest (see Wu, Larus: "Static Branch Frequency and Program Profile
+ * Analysis"), which gives the same solution in (almost) linear time.
+ * Only the retreating edges of irreducible loops remain as variables of a
+ * (usually very small) dense equation system.  Both solvers are bounded by the
+ * complexity budget: Beyond it the dense solver is replaced by the sparse one
+ * and the sparse one by frequencies derived from the loop depth only.
  */
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
@@ -35,9 +46,11 @@
 #include "hashptr.h"
 #include "dfs_t.h"
 #include "panic.h"
+#include "obst.h"
 #include "xmalloc.h"
 
 #include "irprog_t.h"
+#include "irflag.h"
 #include "irgraph_t.h"
 #include "irnode_t.h"
 #include "irloop.h"
@@ -47,6 +60,7 @@
 #include "util.h"
 #include "irhooks.h"
 #include "irnodehashmap.h"
+#include "irprofile.h"
 
 #include "execfreq_t.h"
 
@@ -56,6 +70,13 @@
 
 #define MAX_INT_FREQ 1000000
 
+/** CFGs with more blocks are handled by the sparse estimator. */
+#define DENSE_MAX_BLOCKS      256
+/** Maximum number of variables of the sparse estimator's equation system. */
+#define SPARSE_MAX_VARS       512
+/** Upper bound for the cyclic probability of a loop header. */
+#define MAX_CYCLIC_PROB       (1.0 - EPSILON)
+
 static hook_entry_t hook;
 
 typedef struct {
@@ -171,8 +192,8 @@ static void nullspace(square_matrix *a, double *result)
 	for (unsigned i = 0; i < n; i++) {
 		result[i] = getm(q, i, n-1);
 	}
-	free(qr);
-	free(q);
+	xfree(qr);
+	xfree(q);
 }
 
 double get_block_execfreq(const ir_node *block)
@@ -263,9 +284,19 @@ static double get_cf_probability(const ir_node *bb, int pos,
 	for (int d = depth; d < pred_depth; ++d) {
 		cur *= inv_loop_weight;
 	}
-	double sum = get_sum_succ_factors(pred, inv_loop_weight);
-
-	return cur/sum;
+	double sum  = get_sum_succ_factors(pred, inv_loop_weight);
+	double prob = cur/sum;
+
+	/* Use the profiled probability if there is one. The estimate serves as
+	 * prior, so edges which were never taken stay possible. Sampled counts
+	 * are not exactly consistent, so the probability is limited. */
+	uint32_t edge_count;
+	uint32_t pred_count;
+	if (ir_profile_find_edge_execcount(bb, pos, &edge_count)
+	    && ir_profile_find_block_execcount(pred, &pred_count))
+		prob = MIN((edge_count + prob) / (pred_count + 1.0), 1.0);
+
+	return prob;
 }
 
 static double *freqs;
@@ -393,22 +424,13 @@ static double mat_dot_vec_entry(square_matrix *mat, double *vec, int row)
 	return acc;
 }
 
-void ir_estimate_execfreq(ir_graph *irg)
+/**
+ * Solves the frequency equations with a dense matrix and assigns the
+ * results. Returns false if no valid solution was found.
+ */
+static bool estimate_dense(ir_graph *irg, dfs_t const *dfs,
+                           double inv_loop_weight)
 {
-	double loop_weight = 10.0;
-
-	assure_irg_properties(irg,
-		IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
-		| IR_GRAPH_PROPERTY_NO_BADS
-		| IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO
-		| IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE);
-
-	/* compute a DFS.
-	 * using a toposort on the CFG (without back edges) will propagate
-	 * the values better for the gauss/seidel iteration.
-	 * => they can "flow" from start to end. */
-	dfs_t *const dfs = dfs_new(irg);
-
 	unsigned       size   = dfs_get_n_nodes(dfs);
 	square_matrix *in_fac = mat_create(size);
 	for (unsigned r = 0; r < size; r++) {
@@ -417,32 +439,10 @@ void ir_estimate_execfreq(ir_graph *irg)
 		}
 	}
 
-
 	ir_node *const start_block = get_irg_start_block(irg);
 	ir_node *const end_block   = get_irg_end_block(irg);
 	const int      end_idx     = size - dfs_get_post_num(dfs, end_block) - 1;
 
-	ir_reserve_resources(irg, IR_RESOURCE_BLOCK_VISITED
-	                          | IR_RESOURCE_IRN_VISITED
-	                          | IR_RESOURCE_IRN_LINK);
-	inc_irg_block_visited(irg);
-
-	/* mark all blocks reachable from end_block as (block)visited
-	 * (so we can detect places like endless-loops/noreturn calls which
-	 *  do not reach the End block) */
-	block_walk_no_keeps(end_block);
-	/* mark all kept blocks as (node)visited */
-	inc_irg_visited(irg);
-	const ir_node *end          = get_irg_end(irg);
-	int const      n_keepalives = get_End_n_keepalives(end);
-	for (int k = n_keepalives - 1; k >= 0; --k) {
-		ir_node *keep = get_End_keepalive(end, k);
-		if (is_Block(keep)) {
-			mark_irn_visited(keep);
-		}
-	}
-
-	double const inv_loop_weight = 1.0 / loop_weight;
 	/* lgs_to_mat[i] is the index of the block represented by the
 	 * i-th row/column in the LGS matrix. */
 	int *lgs_to_mat = NEW_ARR_F(int, 0);
@@ -483,6 +483,8 @@ void ir_estimate_execfreq(ir_graph *irg)
 
 	/* add artifical edges from "kept blocks without a path to end"
 	 * to end */
+	const ir_node *end          = get_irg_end(irg);
+	int const      n_keepalives = get_End_n_keepalives(end);
 	for (unsigned k = n_keepalives; k-- > 0; ) {
 		ir_node *keep = get_End_keepalive(end, k);
 		if (!is_Block(keep) || has_path_to_end(keep))
@@ -585,6 +587,426 @@ void ir_estimate_execfreq(ir_graph *irg)
 	}
 
 	DEL_ARR_F(freqs);
+	DEL_ARR_F(lgs_to_mat);
+	DEL_ARR_F(mat_to_lgs);
+	xfree(in_fac);
+	xfree(lgs_matrix);
+	DEL_ARR_F(lgs_x);
+	return valid_freq;
+}
+
+/**
+ * A term of the linear combination describing a block frequency in the
+ * sparse estimator. Variable 0 is the frequency of the start block, variable
+ * i > 0 is the frequency of the source of the (i-1)-th irreducible
+ * retreating edge.
+ */
+typedef struct freq_term_t {
+	unsigned var;
+	double   fac;
+} freq_term_t;
+
+/** Per-block data of the sparse estimator. */
+typedef struct freq_info_t {
+	ir_node     *block;
+	double       freq;      /**< frequency relative to the region head */
+	double       cyclic;    /**< cyclic probability of a clean loop header */
+	freq_term_t *terms;     /**< frequency as linear combination */
+	unsigned     n_terms;   /**< number of entries in terms */
+	unsigned     rpo;       /**< reverse postorder number */
+	unsigned     region;    /**< rpo number of the current region head */
+	unsigned     var;       /**< variable number, 0 if none */
+	bool         is_header; /**< block is the target of a retreating edge */
+	bool         is_clean;  /**< loop of the header is solved by propagation */
+} freq_info_t;
+
+static freq_info_t *get_freq_info(ir_node const *block)
+{
+	return (freq_info_t*)get_irn_link(block);
+}
+
+static bool is_retreating(freq_info_t const *pred, freq_info_t const *info)
+{
+	return pred->rpo >= info->rpo;
+}
+
+static int cmp_freq_info_rpo(const void *a, const void *b)
+{
+	freq_info_t const *const ia = *(freq_info_t const *const*)a;
+	freq_info_t const *const ib = *(freq_info_t const *const*)b;
+	return QSORT_CMP(ia->rpo, ib->rpo);
+}
+
+/**
+ * Collects the natural loop of @p head into @p members (@p head first, the
+ * rest sorted by reverse postorder) and marks them as part of the region.
+ * Returns false if the loop cannot be solved by propagation, because
+ * @p head does not dominate it (the CFG is irreducible) or because it
+ * contains such a loop.
+ */
+static bool collect_loop(freq_info_t *head, freq_info_t ***members,
+                         freq_info_t ***worklist)
+{
+	ARR_SHRINKLEN(*members, 0);
+	ARR_SHRINKLEN(*worklist, 0);
+	head->region = head->rpo;
+	ARR_APP1(freq_info_t*, *members, head);
+
+	ir_node *const head_block = head->block;
+	for (int i = get_Block_n_cfgpreds(head_block); i-- > 0; ) {
+		ir_node *const pred = get_Block_cfgpred_block(head_block, i);
+		if (pred == NULL)
+			continue;
+		freq_info_t *const pred_info = get_freq_info(pred);
+		if (is_retreating(pred_info, head))
+			ARR_APP1(freq_info_t*, *worklist, pred_info);
+	}
+
+	bool clean = true;
+	while (ARR_LEN(*worklist) > 0) {
+		freq_info_t *const info = (*worklist)[ARR_LEN(*worklist) - 1];
+		ARR_SHRINKLEN(*worklist, ARR_LEN(*worklist) - 1);
+		if (info->region == head->rpo)
+			continue;
+		/* Every block dominated by head comes after it in reverse
+		 * postorder. */
+		if (info->rpo < head->rpo)
+			return false;
+		if (info->is_header && !info->is_clean)
+			clean = false;
+		info->region = head->rpo;
+		ARR_APP1(freq_info_t*, *members, info);
+
+		ir_node *const block = info->block;
+		for (int i = get_Block_n_cfgpreds(block); i-- > 0; ) {
+			ir_node *const pred = get_Block_cfgpred_block(block, i);
+			if (pred == NULL)
+				continue;
+			freq_info_t *const pred_info = get_freq_info(pred);
+			if (pred_info->region != head->rpo)
+				ARR_APP1(freq_info_t*, *worklist, pred_info);
+		}
+	}
+
+	QSORT(*members + 1, ARR_LEN(*members) - 1, cmp_freq_info_rpo);
+	return clean;
+}
+
+/**
+ * Propagates frequencies through a clean loop whose blocks are given in
+ * reverse postorder, starting with frequency 1 at its head, and computes
+ * the cyclic probability of the head. The effect of inner loops is captured
+ * by the cyclic probability of their headers.
+ */
+static void propagate_loop(freq_info_t **members, size_t n_members,
+                           double inv_loop_weight)
+{
+	freq_info_t *const head   = members[0];
+	unsigned     const region = head->region;
+	head->freq = 1.0;
+
+	for (size_t m = 1; m < n_members; ++m) {
+		freq_info_t *const info  = members[m];
+		ir_node     *const block = info->block;
+
+		double freq = 0.0;
+		for (int i = get_Block_n_cfgpreds(block); i-- > 0; ) {
+			ir_node *const pred = get_Block_cfgpred_block(block, i);
+			if (pred == NULL)
+				continue;
+			freq_info_t const *const pred_info = get_freq_info(pred);
+			if (pred_info->region != region || is_retreating(pred_info, info))
+				continue;
+			freq += pred_info->freq * get_cf_probability(block, i, inv_loop_weight);
+		}
+		if (info->is_header)
+			freq /= 1.0 - info->cyclic;
+		info->freq = freq;
+	}
+
+	ir_node *const head_block = head->block;
+	double         cyclic     = 0.0;
+	for (int i = get_Block_n_cfgpreds(head_block); i-- > 0; ) {
+		ir_node *const pred = get_Block_cfgpred_block(head_block, i);
+		if (pred == NULL)
+			continue;
+		freq_info_t const *const pred_info = get_freq_info(pred);
+		if (is_retreating(pred_info, head))
+			cyclic += pred_info->freq * get_cf_probability(head_block, i, inv_loop_weight);
+	}
+	head->cyclic = MIN(cyclic, MAX_CYCLIC_PROB);
+}
+
+/**
+ * Adds the terms of @p info scaled by @p fac to the accumulator @p acc.
+ * Variables not seen before are recorded in @p touched.
+ */
+static void add_terms(double *acc, unsigned **touched, freq_info_t const *info,
+                      double fac)
+{
+	for (unsigned t = 0; t < info->n_terms; ++t) {
+		freq_term_t const *const term = &info->terms[t];
+		if (acc[term->var] == 0.0)
+			ARR_APP1(unsigned, *touched, term->var);
+		acc[term->var] += term->fac * fac;
+	}
+}
+
+static int cmp_unsigned(const void *a, const void *b)
+{
+	return QSORT_CMP(*(unsigned const*)a, *(unsigned const*)b);
+}
+
+/**
+ * Estimates the frequencies without building a dense matrix and assigns the
+ * results. Returns false if no valid solution was found.
+ */
+static bool estimate_sparse(ir_graph *irg, dfs_t const *dfs,
+                            double inv_loop_weight)
+{
+	unsigned     const size  = dfs_get_n_nodes(dfs);
+	freq_info_t *const infos = XMALLOCNZ(freq_info_t, size);
+	for (unsigned idx = 0; idx < size; ++idx) {
+		ir_node     *const block = dfs_get_post_num_node(dfs, size - idx - 1);
+		freq_info_t *const info  = &infos[idx];
+		info->block  = block;
+		info->rpo    = idx;
+		info->region = UINT_MAX;
+		set_irn_link(block, info);
+	}
+
+	ir_node *const start_block = get_irg_start_block(irg);
+	ir_node *const end_block   = get_irg_end_block(irg);
+	for (unsigned idx = 0; idx < size; ++idx) {
+		freq_info_t *const info  = &infos[idx];
+		ir_node     *const block = info->block;
+		if (block == end_block)
+			continue;
+		for (int i = get_Block_n_cfgpreds(block); i-- > 0; ) {
+			ir_node *const pred = get_Block_cfgpred_block(block, i);
+			if (pred != NULL && is_retreating(get_freq_info(pred), info))
+				info->is_header = true;
+		}
+	}
+
+	/* Compute the cyclic probabilities of the loop headers, inner loops
+	 * first (inner headers come later in reverse postorder). The sources of
+	 * the retreating edges of loops which cannot be handled this way become
+	 * variables of a linear equation system. */
+	freq_info_t **members  = NEW_ARR_F(freq_info_t*, 0);
+	freq_info_t **worklist = NEW_ARR_F(freq_info_t*, 0);
+	unsigned      n_vars   = 1;
+	for (unsigned idx = size; idx-- > 0; ) {
+		freq_info_t *const info = &infos[idx];
+		if (!info->is_header)
+			continue;
+		info->is_clean = collect_loop(info, &members, &worklist);
+		if (info->is_clean) {
+			propagate_loop(members, ARR_LEN(members), inv_loop_weight);
+			continue;
+		}
+
+		ir_node *const block = info->block;
+		for (int i = get_Block_n_cfgpreds(block); i-- > 0; ) {
+			ir_node *const pred = get_Block_cfgpred_block(block, i);
+			if (pred == NULL)
+				continue;
+			freq_info_t *const pred_info = get_freq_info(pred);
+			if (is_retreating(pred_info, info) && pred_info->var == 0)
+				pred_info->var = n_vars++;
+		}
+	}
+	DEL_ARR_F(worklist);
+	DEL_ARR_F(members);
+
+	double const cost = (double)n_vars * n_vars * n_vars
+	                  + (double)n_vars * size;
+	if (n_vars > SPARSE_MAX_VARS
+	    || !ir_complexity_allows(irg, "execfreq_sparse", cost)) {
+		xfree(infos);
+		return false;
+	}
+
+	/* Express all frequencies as linear combinations of the variables by
+	 * propagating through the whole function. The end block is handled
+	 * afterwards when all the kept blocks are done. */
+	struct obstack obst;
+	obstack_init(&obst);
+	double   *const acc     = XMALLOCNZ(double, n_vars);
+	unsigned       *touched = NEW_ARR_F(unsigned, 0);
+	for (unsigned idx = 0; idx < size; ++idx) {
+		freq_info_t *const info  = &infos[idx];
+		ir_node     *const block = info->block;
+		if (block == end_block)
+			continue;
+
+		ARR_SHRINKLEN(touched, 0);
+		if (block == start_block) {
+			ARR_APP1(unsigned, touched, 0);
+			acc[0] = 1.0;
+		}
+		for (int i = get_Block_n_cfgpreds(block); i-- > 0; ) {
+			ir_node *const pred = get_Block_cfgpred_block(block, i);
+			if (pred == NULL)
+				continue;
+			freq_info_t const *const pred_info = get_freq_info(pred);
+			double const prob = get_cf_probability(block, i, inv_loop_weight);
+			if (!is_retreating(pred_info, info)) {
+				add_terms(acc, &touched, pred_info, prob);
+			} else if (!info->is_clean) {
+				unsigned const var = pred_info->var;
+				if (acc[var] == 0.0)
+					ARR_APP1(unsigned, touched, var);
+				acc[var] += prob;
+			}
+		}
+
+		double const fac = info->is_header && info->is_clean
+		                 ? 1.0 / (1.0 - info->cyclic) : 1.0;
+		size_t const n_touched = ARR_LEN(touched);
+		QSORT(touched, n_touched, cmp_unsigned);
+		info->terms   = OALLOCN(&obst, freq_term_t, n_touched);
+		info->n_terms = 0;
+		for (size_t t = 0; t < n_touched; ++t) {
+			unsigned const var = touched[t];
+			if (acc[var] != 0.0) {
+				freq_term_t *const term = &info->terms[info->n_terms++];
+				term->var = var;
+				term->fac = acc[var] * fac;
+			}
+			acc[var] = 0.0;
+		}
+	}
+	DEL_ARR_F(touched);
+	xfree(acc);
+
+	/* Solve the equations var_i = terms(source_i) for the variables. */
+	bool          valid_freq = true;
+	double *const values     = XMALLOCN(double, n_vars);
+	values[0] = 1.0;
+	if (n_vars > 1) {
+		unsigned const n   = n_vars - 1;
+		double  *const mat = XMALLOCNZ(double, n * n);
+		double  *const vec = XMALLOCNZ(double, n);
+		for (unsigned idx = 0; idx < size; ++idx) {
+			freq_info_t const *const info = &infos[idx];
+			if (info->var == 0)
+				continue;
+			unsigned const row = info->var - 1;
+			mat[row * n + row] += 1.0;
+			for (unsigned t = 0; t < info->n_terms; ++t) {
+				freq_term_t const *const term = &info->terms[t];
+				if (term->var == 0)
+					vec[row] += term->fac;
+				else
+					mat[row * n + term->var - 1] -= term->fac;
+			}
+		}
+		valid_freq = firm_gaussjordansolve(mat, vec, n) == 0;
+		for (unsigned v = 0; v < n; ++v) {
+			values[v + 1] = vec[v];
+		}
+		xfree(vec);
+		xfree(mat);
+	}
+
+	if (valid_freq) {
+		for (unsigned idx = 0; idx < size; ++idx) {
+			freq_info_t *const info = &infos[idx];
+			double             freq = 0.0;
+			for (unsigned t = 0; t < info->n_terms; ++t) {
+				freq += info->terms[t].fac * values[info->terms[t].var];
+			}
+			info->freq = freq;
+		}
+
+		double end_freq = 0.0;
+		for (int i = get_Block_n_cfgpreds(end_block); i-- > 0; ) {
+			ir_node *const pred = get_Block_cfgpred_block(end_block, i);
+			if (pred == NULL)
+				continue;
+			end_freq += get_freq_info(pred)->freq
+			          * get_cf_probability(end_block, i, inv_loop_weight);
+		}
+		/* add artifical edges from "kept blocks without a path to end"
+		 * to end */
+		const ir_node *end          = get_irg_end(irg);
+		int const      n_keepalives = get_End_n_keepalives(end);
+		for (unsigned k = n_keepalives; k-- > 0; ) {
+			ir_node *keep = get_End_keepalive(end, k);
+			if (!is_Block(keep) || has_path_to_end(keep))
+				continue;
+
+			double sum = get_sum_succ_factors(keep, inv_loop_weight);
+			end_freq += get_freq_info(keep)->freq * KEEP_FAC/sum;
+		}
+		get_freq_info(end_block)->freq = end_freq;
+
+		/* normalize to an execution frequency of 1.0 for the end block */
+		double const norm = end_freq != 0.0 ? 1.0 / end_freq : 1.0;
+		for (unsigned idx = 0; idx < size; ++idx) {
+			double const freq = infos[idx].freq * norm;
+			/* Check for inf, nan and negative values. */
+			if (isinf(freq) || !(freq >= 0)) {
+				valid_freq = false;
+				break;
+			}
+			set_block_execfreq(infos[idx].block, freq);
+		}
+	}
+
+	xfree(values);
+	obstack_free(&obst, NULL);
+	xfree(infos);
+	return valid_freq;
+}
+
+void ir_estimate_execfreq(ir_graph *irg)
+{
+	double loop_weight = 10.0;
+
+	assure_irg_properties(irg,
+		IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
+		| IR_GRAPH_PROPERTY_NO_BADS
+		| IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO
+		| IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE);
+
+	/* compute a DFS.
+	 * using a toposort on the CFG (without back edges) will propagate
+	 * the values better for the gauss/seidel iteration.
+	 * => they can "flow" from start to end. */
+	dfs_t *const dfs = dfs_new(irg);
+
+	unsigned const size      = dfs_get_n_nodes(dfs);
+	ir_node *const end_block = get_irg_end_block(irg);
+
+	ir_reserve_resources(irg, IR_RESOURCE_BLOCK_VISITED
+	                          | IR_RESOURCE_IRN_VISITED
+	                          | IR_RESOURCE_IRN_LINK);
+	inc_irg_block_visited(irg);
+
+	/* mark all blocks reachable from end_block as (block)visited
+	 * (so we can detect places like endless-loops/noreturn calls which
+	 *  do not reach the End block) */
+	block_walk_no_keeps(end_block);
+	/* mark all kept blocks as (node)visited */
+	inc_irg_visited(irg);
+	const ir_node *end          = get_irg_end(irg);
+	int const      n_keepalives = get_End_n_keepalives(end);
+	for (int k = n_keepalives - 1; k >= 0; --k) {
+		ir_node *keep = get_End_keepalive(end, k);
+		if (is_Block(keep)) {
+			mark_irn_visited(keep);
+		}
+	}
+
+	double const inv_loop_weight = 1.0 / loop_weight;
+	double const dense_cost      = (double)size * size * size;
+	bool   const dense           = size <= DENSE_MAX_BLOCKS
+		&& ir_complexity_allows(irg, "execfreq_dense", dense_cost);
+	bool valid_freq = dense
+		? estimate_dense(irg, dfs, inv_loop_weight)
+		: estimate_sparse(irg, dfs, inv_loop_weight);
 
 	/* Fallback solution: Use loop weight. */
 	if (!valid_freq) {
@@ -622,9 +1044,4 @@ void ir_estimate_execfreq(ir_graph *irg)
 	                       | IR_RESOURCE_IRN_LINK);
 
 	dfs_free(dfs);
-	DEL_ARR_F(lgs_to_mat);
-	DEL_ARR_F(mat_to_lgs);
-	free(in_fac);
-	free(lgs_matrix);
-	DEL_ARR_F(lgs_x);
 }
@@ -17,21 +17,27 @@
 
 #include "irdump.h"
 #include "irgwalk.h"
+#include "irhooks.h"
 #include "irnodemap.h"
 #include "iredges_t.h"
 #include "list.h"
+#include "array.h"
 #include "util.h"
 
 struct ir_heights_t {
 	ir_nodemap      data;
 	unsigned        visited;
+	ir_graph       *irg;
 	hook_entry_t   *dump_handle;
+	hook_entry_t    edge_hook;   /**< keeps the heights valid on edge changes */
 	struct obstack  obst;
 };
 
 typedef struct {
-	unsigned height;
-	unsigned visited;
+	unsigned       height;
+	unsigned       visited;
+	const ir_node *irn;   /**< the node, the backend transformation reuses
+	                           node indices for the new nodes */
 } irn_height_t;
 
 static irn_height_t *maybe_get_height_data(const ir_heights_t *heights,
@@ -46,11 +52,29 @@ static irn_height_t *get_height_data(ir_heights_t *heights, const ir_node *node)
 	irn_height_t *height = ir_nodemap_get(irn_height_t, &heights->data, node);
 	if (height == NULL) {
 		height = OALLOCZ(&heights->obst, irn_height_t);
+		height->irn = node;
 		ir_nodemap_insert(&heights->data, node, height);
 	}
 	return height;
 }
 
+/**
+ * Checks whether the data stored for the index of a node belongs to another
+ * node.
+ */
+static bool is_foreign(const ir_heights_t *heights, const ir_node *node)
+{
+	irn_height_t const *const height = maybe_get_height_data(heights, node);
+	return height != NULL && height->irn != node;
+}
+
+/** Checks whether the heights of a block are maintained. */
+static bool is_maintained(const ir_heights_t *heights, const ir_node *block)
+{
+	irn_height_t const *const height = maybe_get_height_data(heights, block);
+	return height != NULL && height->irn == block;
+}
+
 static void height_dump_cb(void *data, FILE *f, const ir_node *irn)
 {
 	const ir_heights_t *heights = (const ir_heights_t*) data;
@@ -79,12 +103,12 @@ static bool search(ir_heights_t *h, const ir_node *curr, const ir_node *tgt)
 		return false;
 
 	/* Check, if we have already been here. Coming more often won't help :-) */
-	irn_height_t *h_curr = maybe_get_height_data(h, curr);
+	irn_height_t *h_curr = get_height_data(h, curr);
 	if (h_curr->visited >= h->visited)
 		return false;
 
 	/* If we are too deep into the DAG we won't find the target either. */
-	irn_height_t *h_tgt = maybe_get_height_data(h, tgt);
+	irn_height_t *h_tgt = get_height_data(h, tgt);
 	if (h_curr->height > h_tgt->height)
 		return false;
 
@@ -104,11 +128,10 @@ int heights_reachable_in_block(ir_heights_t *h, const ir_node *n,
                                const ir_node *m)
 {
 	int           res = 0;
-	irn_height_t *hn  = maybe_get_height_data(h, n);
-	irn_height_t *hm  = maybe_get_height_data(h, m);
+	irn_height_t *hn  = get_height_data(h, n);
+	irn_height_t *hm  = get_height_data(h, m);
 
 	assert(get_nodes_block(n) == get_nodes_block(m));
-	assert(hn != NULL && hm != NULL);
 
 	if (hn->height <= hm->height) {
 		h->visited++;
@@ -149,6 +172,8 @@ static unsigned compute_height(ir_heights_t *h, ir_node *irn, const ir_node *bl)
 
 static unsigned compute_heights_in_block(ir_node *bl, ir_heights_t *h)
 {
+	/* the data of the block marks it as maintained by heights_edge_change() */
+	get_height_data(h, bl);
 	h->visited++;
 
 	int max_height = -1;
@@ -168,6 +193,110 @@ static void compute_heights_in_block_walker(ir_node *block, void *data)
 	compute_heights_in_block(block, h);
 }
 
+/**
+ * Collects the nodes in the block of irn whose height may grow when the height
+ * of irn grows by delta, in postorder (operands before their users).
+ */
+static void collect_raise_cone(ir_heights_t *h, ir_node *irn, unsigned delta,
+                               ir_node ***cone)
+{
+	irn_height_t *ih = get_height_data(h, irn);
+	ih->visited = h->visited;
+
+	if (!is_Phi(irn)) {
+		ir_node *const bl = get_nodes_block(irn);
+		foreach_irn_in(irn, i, op) {
+			if (is_Block(op) || get_nodes_block(op) != bl || is_foreign(h, op))
+				continue;
+			/* the height of op only grows if it is at most delta above irn */
+			irn_height_t *oh = get_height_data(h, op);
+			if (oh->visited < h->visited && oh->height <= ih->height + delta)
+				collect_raise_cone(h, op, delta, cone);
+		}
+	}
+	ARR_APP1(ir_node*, *cone, irn);
+}
+
+/**
+ * Raises the height of a node to at least height and the heights of its
+ * operands in the same block accordingly.  Only the nodes whose height can
+ * change are visited, each of them once.
+ */
+static void raise_height(ir_heights_t *h, ir_node *irn, unsigned height)
+{
+	irn_height_t *ih = get_height_data(h, irn);
+	if (ih->height >= height)
+		return;
+
+	ir_node **cone = NEW_ARR_F(ir_node*, 0);
+	h->visited++;
+	collect_raise_cone(h, irn, height - ih->height, &cone);
+	ih->height = height;
+
+	/* users are handled before their operands */
+	for (size_t i = ARR_LEN(cone); i-- > 0;) {
+		ir_node *const node = cone[i];
+		if (is_Phi(node))
+			continue;
+		unsigned const node_height = get_height_data(h, node)->height;
+		ir_node *const bl          = get_nodes_block(node);
+		foreach_irn_in(node, j, op) {
+			if (is_Block(op) || get_nodes_block(op) != bl || is_foreign(h, op))
+				continue;
+			irn_height_t *oh = get_height_data(h, op);
+			if (oh->visited == h->visited)
+				oh->height = MAX(oh->height, node_height + 1);
+		}
+	}
+	DEL_ARR_F(cone);
+}
+
+/**
+ * Keeps the heights valid when an edge is added: An operand must be higher
+ * than all of its users in the same block.  Heights are only ever raised, so
+ * after removing edges they may be larger than necessary, which keeps the
+ * reachability checks correct and only makes them prune less.
+ */
+static void heights_edge_change(void *context, ir_node *src, int pos,
+                                ir_node *tgt, ir_node *old_tgt)
+{
+	ir_heights_t *h = (ir_heights_t*)context;
+	if (tgt == NULL || tgt == old_tgt || is_Block(src)
+	    || get_irn_irg(src) != h->irg || is_foreign(h, src)
+	    || is_foreign(h, tgt))
+		return;
+
+	if (pos == -1) {
+		/* src is moved into block tgt, which src does not return yet */
+		if (!is_maintained(h, tgt))
+			return;
+		unsigned height = 0;
+		foreach_out_edge(src, edge) {
+			ir_node *dep = get_edge_src_irn(edge);
+			if (!is_Block(dep) && !is_Phi(dep) && get_nodes_block(dep) == tgt
+			    && !is_foreign(h, dep))
+				height = MAX(height, get_height_data(h, dep)->height + 1);
+		}
+		irn_height_t *ih = get_height_data(h, src);
+		ih->height = height;
+		if (is_Phi(src))
+			return;
+		foreach_irn_in(src, i, op) {
+			if (!is_Block(op) && get_nodes_block(op) == tgt
+			    && !is_foreign(h, op))
+				raise_height(h, op, height + 1);
+		}
+		return;
+	}
+
+	/* only blocks with computed heights are maintained */
+	ir_node *const bl = get_nodes_block(src);
+	if (is_Phi(src) || is_Block(tgt) || get_nodes_block(tgt) != bl
+	    || !is_maintained(h, bl))
+		return;
+	raise_height(h, tgt, get_height_data(h, src)->height + 1);
+}
+
 unsigned get_irn_height(const ir_heights_t *heights, const ir_node *irn)
 {
 	const irn_height_t *height = maybe_get_height_data(heights, irn);
@@ -184,10 +313,11 @@ unsigned heights_recompute_block(ir_heights_t *h, ir_node *block)
 	foreach_out_edge(block, edge) {
 		ir_node      *irn = get_edge_src_irn(edge);
 		irn_height_t *ih  = get_height_data(h, irn);
-		memset(ih, 0, sizeof(*ih));
+		ih->height  = 0;
+		ih->visited = 0;
+		ih->irn     = irn;
 	}
 
-	h->visited = 0;
 	return compute_heights_in_block(block, h);
 }
 
@@ -196,7 +326,11 @@ ir_heights_t *heights_new(ir_graph *irg)
 	ir_heights_t *res = XMALLOCZ(ir_heights_t);
 	ir_nodemap_init(&res->data, irg);
 	obstack_init(&res->obst);
+	res->irg         = irg;
 	res->dump_handle = dump_add_node_info_callback(height_dump_cb, res);
+	res->edge_hook.hook._hook_edge_change = heights_edge_change;
+	res->edge_hook.context                = res;
+	register_hook(hook_edge_change, &res->edge_hook);
 
 	assure_edges(irg);
 	irg_block_walk_graph(irg, compute_heights_in_block_walker, NULL, res);
@@ -207,7 +341,8 @@ ir_heights_t *heights_new(ir_graph *irg)
 void heights_free(ir_heights_t *h)
 {
 	dump_remove_node_info_callback(h->dump_handle);
+	unregister_hook(hook_edge_change, &h->edge_hook);
 	obstack_free(&h->obst, NULL);
 	ir_nodemap_destroy(&h->data);
-	free(h);
+	xfree(h);
 }
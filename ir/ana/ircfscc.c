@@ -572,7 +572,8 @@ static void reset_backedges(ir_node *n)
 static void loop_reset_node(ir_node *n, void *env)
 {
 	(void)env;
-	set_irn_loop(n, NULL);
+	if (is_Block(n))
+		set_irn_loop(n, NULL);
 	reset_backedges(n);
 }
 
@@ -586,6 +587,7 @@ void free_loop_information(ir_graph *irg)
 
 void construct_cf_backedges(ir_graph *irg)
 {
+	ir_analysis_start(IR_ANALYSIS_LOOPINFO);
 	outermost_ir_graph = irg;
 
 	struct obstack temp;
@@ -619,11 +621,14 @@ void construct_cf_backedges(ir_graph *irg)
 	mature_loops(current_loop, get_irg_obstack(irg));
 	set_irg_loop(irg, current_loop);
 	add_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+	ir_analysis_stop(IR_ANALYSIS_LOOPINFO);
 }
 
 void assure_loopinfo(ir_graph *irg)
 {
-	if (irg_has_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO))
+	if (irg_has_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO)) {
+		ir_analysis_reused(IR_ANALYSIS_LOOPINFO);
 		return;
+	}
 	construct_cf_backedges(irg);
 }
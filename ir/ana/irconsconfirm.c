@@ -11,11 +11,14 @@
  */
 #include "irconsconfirm.h"
 
+#include <limits.h>
+
 #include "irgraph_t.h"
 #include "irnode_t.h"
 #include "ircons_t.h"
 #include "irgmod.h"
 #include "iropt_dbg.h"
+#include "iropt_t.h"
 #include "iredges_t.h"
 #include "irgwalk.h"
 #include "irgopt.h"
@@ -23,6 +26,7 @@
 #include "array.h"
 #include "debug.h"
 #include "irflag.h"
+#include "statev_t.h"
 
 /**
  * Walker environment.
@@ -32,6 +36,9 @@ typedef struct env_t {
 	unsigned num_consts;    /**< Number of constants placed. */
 	unsigned num_eq;        /**< Number of equalities placed. */
 	unsigned num_non_null;  /**< Number of non-null Confirms. */
+	unsigned num_nodes;     /**< Number of created Confirm nodes. */
+	unsigned budget;        /**< Number of Confirm nodes still allowed. */
+	bool     demand_only;   /**< Only place Confirms in front of consumers. */
 } env_t;
 
 /** The debug handle. */
@@ -56,6 +63,27 @@ static ir_node *get_effective_use_block(ir_node *node, int pos)
 	return get_nodes_block(node);
 }
 
+/**
+ * Checks if a Confirm should be placed in front of input pos of user.
+ */
+static bool want_confirm(const env_t *env, const ir_node *user, int pos)
+{
+	return !env->demand_only || is_Confirm_consumer(user, pos);
+}
+
+/**
+ * Creates a new Confirm node if the budget allows it.
+ */
+static ir_node *new_budget_Confirm(env_t *env, ir_node *block, ir_node *value,
+                                   ir_node *bound, ir_relation relation)
+{
+	if (env->budget == 0)
+		return NULL;
+	--env->budget;
+	++env->num_nodes;
+	return new_r_Confirm(block, value, bound, relation);
+}
+
 static ir_node *get_case_value(ir_node *switchn, unsigned pn)
 {
 	ir_graph              *irg       = get_irn_irg(switchn);
@@ -332,14 +360,17 @@ static void handle_if(ir_node *block, ir_node *cmp, ir_relation rel, env_t *env)
 			int      pos  = get_edge_src_pos(edge);
 			ir_node *blk  = get_effective_use_block(succ, pos);
 
-			if (block_dominates(block, blk)) {
+			if (block_dominates(block, blk) && want_confirm(env, succ, pos)) {
 				/*
 				 * Ok, we found a usage of left in a block
 				 * dominated by the branch block.
 				 * We can replace the input with a Confirm(left, pnc, right).
 				 */
-				if (c == NULL)
-					c = new_r_Confirm(block, left, right, rel);
+				if (c == NULL) {
+					c = new_budget_Confirm(env, block, left, right, rel);
+					if (c == NULL)
+						return;
+				}
 
 				set_irn_n(succ, pos, c);
 				DB((dbg, LEVEL_2, "Replacing input %d of node %+F with %+F\n", pos, succ, c));
@@ -361,14 +392,17 @@ static void handle_if(ir_node *block, ir_node *cmp, ir_relation rel, env_t *env)
 				int      pos  = get_edge_src_pos(edge);
 				ir_node *blk  = get_effective_use_block(succ, pos);
 
-				if (block_dominates(block, blk)) {
+				if (block_dominates(block, blk) && want_confirm(env, succ, pos)) {
 					/*
 					 * Ok, we found a usage of right in a block
 					 * dominated by the branch block.
 					 * We can replace the input with a Confirm(right, rel^-1, left).
 					 */
-					if (rc == NULL)
-						rc = new_r_Confirm(block, right, left, rel);
+					if (rc == NULL) {
+						rc = new_budget_Confirm(env, block, right, left, rel);
+						if (rc == NULL)
+							return;
+					}
 
 					if (succ != rc) {
 						set_irn_n(succ, pos, rc);
@@ -475,8 +509,11 @@ static void insert_non_null(ir_node *ptr, ir_node *block, env_t *env)
 			if (c == NULL) {
 				ir_mode  *mode = get_irn_mode(ptr);
 				ir_graph *irg  = get_irn_irg(block);
-				c = new_r_Const_null(irg, mode);
-				c = new_r_Confirm(block, ptr, c, ir_relation_less_greater);
+				if (env->budget == 0)
+					return;
+				ir_node *null = new_r_Const_null(irg, mode);
+				c = new_budget_Confirm(env, block, ptr, null,
+				                       ir_relation_less_greater);
 			}
 
 			set_irn_n(succ, pos, c);
@@ -515,7 +552,15 @@ static void insert_Confirm(ir_node *node, void *data)
 	}
 }
 
-void construct_confirms(ir_graph *irg)
+/**
+ * Inserts Confirm nodes into irg.
+ *
+ * @param irg          the graph
+ * @param budget       maximum number of Confirm nodes to create
+ * @param demand_only  only place Confirms in front of consumers
+ */
+static void construct_confirms_env(ir_graph *irg, unsigned budget,
+                                   bool demand_only)
 {
 	FIRM_DBG_REGISTER(dbg, "firm.ana.confirm");
 
@@ -532,6 +577,9 @@ void construct_confirms(ir_graph *irg)
 	env.num_consts   = 0;
 	env.num_eq       = 0;
 	env.num_non_null = 0;
+	env.num_nodes    = 0;
+	env.budget       = budget;
+	env.demand_only  = demand_only;
 
 	if (get_opt_global_null_ptr_elimination()) {
 		/* do global NULL test elimination */
@@ -545,10 +593,22 @@ void construct_confirms(ir_graph *irg)
 	DB((dbg, LEVEL_1, "# Const replacements: %u\n", env.num_consts));
 	DB((dbg, LEVEL_1, "# node equalities   : %u\n", env.num_eq));
 	DB((dbg, LEVEL_1, "# non-null Confirms : %u\n", env.num_non_null));
+	stat_ev_int("confirms_inserted", env.num_nodes);
+	stat_ev_int("confirms_uses_replaced", env.num_confirms);
 
 	confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_CONTROL_FLOW);
 }
 
+void construct_confirms(ir_graph *irg)
+{
+	construct_confirms_env(irg, UINT_MAX, false);
+}
+
+void construct_confirms_budgeted(ir_graph *irg, unsigned budget)
+{
+	construct_confirms_env(irg, budget, true);
+}
+
 static void remove_confirm(ir_node *n, void *env)
 {
 	(void)env;
@@ -22,6 +22,10 @@
 #include "ircons_t.h"
 #include "array.h"
 #include "iredges_t.h"
+#include "irnodeset.h"
+#include "irprintf.h"
+#include "panic.h"
+#include "pqueue.h"
 
 static inline ir_dom_info *get_dom_info(ir_node *block)
 {
@@ -336,51 +340,138 @@ static void count_and_init_blocks_pdom(ir_node *block, void *env)
 	set_Block_postdom_depth(block, -1);
 }
 
-/** temporary type used while constructing the dominator / post dominator tree. */
-typedef struct tmp_dom_info {
-	ir_node *block;               /**< backlink */
-
-	struct tmp_dom_info *semi;    /**< semidominator */
-	struct tmp_dom_info *parent;
-	struct tmp_dom_info *label;   /**< used for LINK and EVAL */
-	struct tmp_dom_info *ancestor;/**< used for LINK and EVAL */
-	struct tmp_dom_info *dom;     /**< After step 3, if the semidominator of w
-	                                   is its immediate dominator, then w->dom
-	                                   is the immediate dominator of w.
-	                                   Otherwise w->dom is a vertex v whose
-	                                   number is smaller than w and whose
-	                                   immediate dominator is also w's
-	                                   immediate dominator. After step 4,
-	                                   w->dom is the immediate dominator of w.*/
-	struct tmp_dom_info *bucket;  /**< set of vertices with same semidominator */
-	int unreachable : 1; /**< node is not reachable by control flow edges */
-} tmp_dom_info;
+/**
+ * Temporary data used while constructing the dominator / post dominator
+ * tree. Blocks are numbered in depth first pre order and everything else is
+ * stored in arrays indexed by these numbers.
+ */
+typedef struct dom_graph {
+	ir_node **blocks;            /**< the blocks by depth first number */
+	int      *parent;            /**< depth first spanning tree parent */
+	int      *pred_start;        /**< start of the predecessors of each block
+	                                  in preds, with a sentinel at the end */
+	int      *preds;             /**< predecessor numbers, flexible array */
+	int      *idom;              /**< immediate dominator numbers */
+	int      *semi;              /**< semidominator numbers */
+	int      *label;             /**< used for LINK and EVAL */
+	int      *ancestor;          /**< used for LINK and EVAL */
+	int       n_blocks;          /**< number of numbered blocks */
+	int       first_unreachable; /**< first block only reachable over
+	                                  keep-alive edges (post dominance) */
+} dom_graph;
+
+static void init_dom_graph(dom_graph *g, int n_blocks)
+{
+	int *numbers = XMALLOCN(int, 7 * n_blocks + 1);
+	g->blocks            = XMALLOCN(ir_node*, n_blocks);
+	g->parent            = numbers;
+	g->idom              = numbers + n_blocks;
+	g->semi              = numbers + 2 * n_blocks;
+	g->label             = numbers + 3 * n_blocks;
+	g->ancestor          = numbers + 4 * n_blocks;
+	g->pred_start        = numbers + 5 * n_blocks;
+	g->preds             = NEW_ARR_F(int, 0);
+	g->n_blocks          = 0;
+	g->first_unreachable = n_blocks;
+}
+
+static void free_dom_graph(dom_graph *g)
+{
+	DEL_ARR_F(g->preds);
+	xfree(g->parent);
+	xfree(g->blocks);
+}
+
+static int add_dom_graph_block(dom_graph *g, ir_node *block, int parent)
+{
+	int num = g->n_blocks++;
+	g->blocks[num] = block;
+	g->parent[num] = parent;
+	return num;
+}
+
+static void compress_dom_path(dom_graph *g, int v)
+{
+	int a = g->ancestor[v];
+	if (g->ancestor[a] < 0)
+		return;
+	compress_dom_path(g, a);
+	if (g->semi[g->label[a]] < g->semi[g->label[v]])
+		g->label[v] = g->label[a];
+	g->ancestor[v] = g->ancestor[a];
+}
+
+/**
+ * if V is a root, return v, else return the vertex u, not being the
+ * root, with minimum semi[u] on the path from v to its root.
+ */
+static int eval_dom_path(dom_graph *g, int v)
+{
+	if (g->ancestor[v] < 0)
+		return v;
+	compress_dom_path(g, v);
+	return g->label[v];
+}
+
+/**
+ * Computes the immediate dominators of all numbered blocks with the
+ * Semi-NCA algorithm: the semidominators are computed as in Lengauer-Tarjan,
+ * the immediate dominator of a block is then the nearest common ancestor of
+ * its parent and its semidominator in the partially built dominator tree.
+ */
+static void compute_semi_nca(dom_graph *g)
+{
+	int const n_blocks = g->n_blocks;
+	for (int i = 0; i < n_blocks; ++i) {
+		g->semi[i]     = i;
+		g->label[i]    = i;
+		g->ancestor[i] = -1;
+	}
+
+	for (int w = n_blocks; w-- > 1; ) {  /* Don't iterate the root. */
+		for (int i = g->pred_start[w], e = g->pred_start[w + 1]; i < e; ++i) {
+			int u = eval_dom_path(g, g->preds[i]);
+			if (g->semi[u] < g->semi[w])
+				g->semi[w] = g->semi[u];
+		}
+		g->ancestor[w] = g->parent[w];
+	}
+
+	g->idom[0] = 0;
+	for (int w = 1; w < n_blocks; ++w) {
+		int idom = g->parent[w];
+		while (idom > g->semi[w])
+			idom = g->idom[idom];
+		g->idom[w] = idom;
+	}
+}
+
+/**
+ * Walker: count the number of blocks and clears the dominance info
+ */
+static void count_and_init_blocks_dom(ir_node *block, void *env)
+{
+	unsigned *n_blocks = (unsigned*)env;
+	(*n_blocks)++;
+
+	memset(get_dom_info(block), 0, sizeof(ir_dom_info));
+	set_Block_idom(block, NULL);
+	set_Block_dom_pre_num(block, -1);
+	set_Block_dom_depth(block, -1);
+}
 
 /**
  * Walks Blocks along the out data structure.  If recursion started with
  * Start block misses control dead blocks.
  */
-static void init_tmp_dom_info(ir_node *block, tmp_dom_info *parent,
-                              tmp_dom_info *tdi_list, int *used, int n_blocks)
+static void init_dom_graph_dom(ir_node *block, int parent, dom_graph *g)
 {
-	if (Block_block_visited(block)) {
+	if (Block_block_visited(block))
 		return;
-	}
 	mark_Block_block_visited(block);
-	set_Block_dom_pre_num(block, *used);
-
-	assert(*used < n_blocks);
-	tmp_dom_info *tdi = &tdi_list[*used];
-	++(*used);
 
-	tdi->block       = block;
-	tdi->semi        = tdi;
-	tdi->parent      = parent;
-	tdi->label       = tdi;
-	tdi->ancestor    = NULL;
-	tdi->dom         = NULL;
-	tdi->bucket      = NULL;
-	tdi->unreachable = 0;
+	int num = add_dom_graph_block(g, block, parent);
+	set_Block_dom_pre_num(block, num);
 
 	/* Iterate */
 	for (unsigned i = get_Block_n_cfg_outs_ka(block); i-- != 0;) {
@@ -389,303 +480,405 @@ static void init_tmp_dom_info(ir_node *block, tmp_dom_info *parent,
 		if (!is_Block(pred))
 			continue;
 
-		init_tmp_dom_info(pred, tdi, tdi_list, used, n_blocks);
+		init_dom_graph_dom(pred, num, g);
 	}
 }
 
 /**
- * Walks Blocks along the control flow.  If recursion started with
- * End block misses blocks in endless loops.
+ * Collects the control flow predecessors of all numbered blocks. Keep-alive
+ * edges are treated as edges to the End block.
  */
-static void init_tmp_pdom_info(ir_node *block, tmp_dom_info *parent,
-                               tmp_dom_info *tdi_list, int* used, int n_blocks,
-                               int unreachable)
+static void collect_dom_preds(dom_graph *g, const ir_graph *irg)
 {
-	if (Block_block_visited(block))
-		return;
-	mark_Block_block_visited(block);
-	set_Block_postdom_pre_num(block, *used);
-
-	assert(*used < n_blocks);
-	tmp_dom_info *tdi = &tdi_list[*used];
-	++(*used);
+	const ir_node *end_block = get_irg_end_block(irg);
+	for (int i = 0; i < g->n_blocks; ++i) {
+		const ir_node *block = g->blocks[i];
+		g->pred_start[i] = ARR_LEN(g->preds);
 
-	tdi->block       = block;
-	tdi->semi        = tdi;
-	tdi->parent      = parent;
-	tdi->label       = tdi;
-	tdi->ancestor    = NULL;
-	tdi->dom         = NULL;
-	tdi->bucket      = NULL;
-	tdi->unreachable = unreachable;
-
-	/* Iterate */
-	for (int i = get_Block_n_cfgpreds(block) - 1; i >= 0; --i) {
-		ir_node *pred = get_Block_cfgpred_block(block, i);
-		if (pred == NULL)
-			continue;
-		init_tmp_pdom_info(pred, tdi, tdi_list, used, n_blocks, unreachable);
-	}
+		for (int j = 0, arity = get_irn_arity(block); j < arity; j++) {
+			const ir_node *pred = get_Block_cfgpred(block, j);
+			if (is_Bad(pred))
+				continue;
+			int pre_num = get_Block_dom_pre_num(get_nodes_block(pred));
+			if (pre_num != -1)
+				ARR_APP1(int, g->preds, pre_num);
+		}
 
-	/* All remaining block keep-alives are edges to endless loops.
-	 * Mark the following unvisited blocks as unreachable.
-	 * Later, we will treat the keep-alive edges as normal control flow. */
-	const ir_graph *irg = get_irn_irg(block);
-	if (block == get_irg_end_block(irg)) {
-		foreach_irn_in_r(get_irg_end(irg), i, pred) {
-			if (is_Block(pred))
-				init_tmp_pdom_info(pred, tdi, tdi_list, used, n_blocks, 1);
+		if (block == end_block) {
+			foreach_irn_in(get_irg_end(irg), j, pred) {
+				if (is_Block(pred) && get_Block_dom_pre_num(pred) != -1)
+					ARR_APP1(int, g->preds, get_Block_dom_pre_num(pred));
+			}
 		}
 	}
+	g->pred_start[g->n_blocks] = ARR_LEN(g->preds);
 }
 
-static void dom_compress(tmp_dom_info *v)
+void compute_doms(ir_graph *irg)
 {
-	assert(v->ancestor);
-	if (v->ancestor->ancestor) {
-		dom_compress(v->ancestor);
-		if (v->ancestor->label->semi < v->label->semi) {
-			v->label = v->ancestor->label;
-		}
-		v->ancestor = v->ancestor->ancestor;
+	assert(!irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_CONSTRUCTION));
+	ir_analysis_start(IR_ANALYSIS_DOMINANCE);
+
+	/* We need the control flow successors of the blocks. */
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_BLOCK_OUTS
+	                         | IR_GRAPH_PROPERTY_NO_TUPLES);
+
+	/* Count the number of blocks in the graph. */
+	int n_blocks = 0;
+	irg_block_walk_graph(irg, count_and_init_blocks_dom, NULL, &n_blocks);
+
+	dom_graph g;
+	init_dom_graph(&g, n_blocks);
+
+	/* this with a standard walker as passing the parent to the sons isn't
+	   simple. */
+	ir_reserve_resources(irg, IR_RESOURCE_BLOCK_VISITED);
+	inc_irg_block_visited(irg);
+	init_dom_graph_dom(get_irg_start_block(irg), -1, &g);
+	ir_free_resources(irg, IR_RESOURCE_BLOCK_VISITED);
+	/* If not all blocks are reachable from Start by out edges this assertion
+	   fails. */
+	assert(g.n_blocks <= n_blocks);
+
+	collect_dom_preds(&g, irg);
+	compute_semi_nca(&g);
+
+	set_Block_idom(g.blocks[0], NULL);
+	set_Block_dom_depth(g.blocks[0], 1);
+	for (int i = 1; i < g.n_blocks; i++) {
+		ir_node *idom = g.blocks[g.idom[i]];
+		set_Block_idom(g.blocks[i], idom);
+		set_Block_dom_depth(g.blocks[i], get_Block_dom_depth(idom) + 1);
 	}
+
+	free_dom_graph(&g);
+
+	/* Do a walk over the tree and assign the tree pre orders. */
+	unsigned tree_pre_order = 0;
+	dom_tree_walk(get_irg_start_block(irg), assign_tree_dom_pre_order,
+	              assign_tree_dom_pre_order_max, &tree_pre_order);
+
+	add_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+	ir_analysis_stop(IR_ANALYSIS_DOMINANCE);
 }
 
 /**
- * if V is a root, return v, else return the vertex u, not being the
- * root, with minimum u->semi on the path from v to its root.
+ * If set, every incremental dominance update is checked against a full
+ * recomputation.
  */
-inline static tmp_dom_info *dom_eval(tmp_dom_info *v)
+static int dom_dbg = 0;
+
+void dom_init_dbg(int do_dbg)
 {
-	if (!v->ancestor)
-		return v;
-	dom_compress(v);
-	return v->label;
+	dom_dbg = do_dbg;
+}
+
+/**
+ * Removes @p block from the list of blocks immediately dominated by its
+ * immediate dominator.
+ */
+static void unlink_Block_idom(ir_node *block)
+{
+	ir_dom_info *bi = get_dom_info(block);
+	ir_node    **p  = &get_dom_info(bi->idom)->first;
+	while (*p != block)
+		p = &get_dom_info(*p)->next;
+	*p       = bi->next;
+	bi->next = NULL;
 }
 
-/** make V W's ancestor */
-inline static void dom_link(tmp_dom_info *v, tmp_dom_info *w)
+static void assign_tree_dom_depth_pre_order(ir_node *block, void *data)
 {
-	w->ancestor = v;
+	ir_node *idom = get_dom_info(block)->idom;
+	set_Block_dom_depth(block, idom != NULL ? get_Block_dom_depth(idom) + 1 : 1);
+	assign_tree_dom_pre_order(block, data);
 }
 
 /**
- * Walker: count the number of blocks and clears the dominance info
+ * Recomputes depths and tree pre orders after the dominator tree changed.
+ * The graph pre order numbers are not updated.
  */
-static void count_and_init_blocks_dom(ir_node *block, void *env)
+static void update_dom_tree_numbers(ir_graph *irg)
 {
-	unsigned *n_blocks = (unsigned*)env;
-	(*n_blocks)++;
+	unsigned tree_pre_order = 0;
+	dom_tree_walk(get_irg_start_block(irg), assign_tree_dom_depth_pre_order,
+	              assign_tree_dom_pre_order_max, &tree_pre_order);
+}
 
-	memset(get_dom_info(block), 0, sizeof(ir_dom_info));
-	set_Block_idom(block, NULL);
-	set_Block_dom_pre_num(block, -1);
-	set_Block_dom_depth(block, -1);
+static void check_dom_update(ir_graph *irg)
+{
+	if (dom_dbg && !verify_dominance(irg))
+		panic("incremental dominance update of %+F failed", irg);
 }
 
-void compute_doms(ir_graph *irg)
+typedef struct dom_insert_env {
+	ir_node    **stack;       /**< blocks still to be searched from the root */
+	pqueue_t    *queue;       /**< affected blocks, deepest first */
+	ir_nodeset_t kept;        /**< blocks kept alive by the End node */
+	int          nca_depth;   /**< depth of the new immediate dominator */
+	int          root_depth;  /**< depth of the current search root */
+} dom_insert_env;
+
+static void dom_insert_visit(dom_insert_env *env, ir_node *block)
 {
-	assert(!irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_CONSTRUCTION));
+	int depth = get_Block_dom_depth(block);
+	if (depth <= env->nca_depth + 1 || Block_block_visited(block))
+		return;
+	mark_Block_block_visited(block);
 
-	/* We need the out data structure. */
-	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUTS
-	                         | IR_GRAPH_PROPERTY_NO_TUPLES);
+	if (depth > env->root_depth)
+		ARR_APP1(ir_node*, env->stack, block);
+	else
+		pqueue_put(env->queue, block, depth);
+}
 
-	/* Count the number of blocks in the graph. */
-	int n_blocks = 0;
-	irg_block_walk_graph(irg, count_and_init_blocks_dom, NULL, &n_blocks);
+void dom_insert_edge(ir_node *pred, ir_node *block)
+{
+	ir_graph *irg = get_irn_irg(block);
+	if (!irg_has_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE))
+		return;
+	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE_FRONTIERS);
 
-	/* Memory for temporary information. */
-	tmp_dom_info *tdi_list = XMALLOCN(tmp_dom_info, n_blocks);
+	/* edges out of unreachable code do not change dominance */
+	int pred_depth  = get_Block_dom_depth(pred);
+	int block_depth = get_Block_dom_depth(block);
+	if (pred_depth < 0)
+		return;
+	/* Newly reachable or new blocks (depth 0) need a full recomputation, as
+	 * does a graph without block successor edges to search. */
+	if (pred_depth == 0 || block_depth <= 0
+	    || !edges_activated_kind(irg, EDGE_KIND_BLOCK)) {
+		clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+		return;
+	}
+
+	/* Depth based search (Georgiadis et al.): a block w gets the nearest
+	 * common dominator of pred and block as new immediate dominator iff w is
+	 * more than one level deeper than it and reachable from block over
+	 * blocks at least as deep as w. */
+	ir_node *nca = ir_deepest_common_dominator(pred, block);
+	dom_insert_env env;
+	env.nca_depth = get_Block_dom_depth(nca);
+	if (block_depth <= env.nca_depth + 1) {
+		check_dom_update(irg);
+		return;
+	}
+
+	env.stack = NEW_ARR_F(ir_node*, 0);
+	env.queue = new_pqueue();
+	ir_nodeset_init(&env.kept);
+	foreach_irn_in(get_irg_end(irg), i, ka) {
+		if (is_Block(ka))
+			ir_nodeset_insert(&env.kept, ka);
+	}
+	ir_node  *end_block = get_irg_end_block(irg);
+	ir_node **affected  = NEW_ARR_F(ir_node*, 0);
 
-	/* this with a standard walker as passing the parent to the sons isn't
-	   simple. */
 	ir_reserve_resources(irg, IR_RESOURCE_BLOCK_VISITED);
 	inc_irg_block_visited(irg);
-	int used = 0;
-	init_tmp_dom_info(get_irg_start_block(irg), NULL, tdi_list, &used, n_blocks);
+	mark_Block_block_visited(block);
+	pqueue_put(env.queue, block, block_depth);
+	while (!pqueue_empty(env.queue)) {
+		ir_node *root = (ir_node*)pqueue_pop_front(env.queue);
+		ARR_APP1(ir_node*, affected, root);
+		env.root_depth = get_Block_dom_depth(root);
+		ARR_APP1(ir_node*, env.stack, root);
+		while (ARR_LEN(env.stack) > 0) {
+			ir_node *b = env.stack[ARR_LEN(env.stack) - 1];
+			ARR_SHRINKLEN(env.stack, ARR_LEN(env.stack) - 1);
+			foreach_block_succ(b, edge) {
+				dom_insert_visit(&env, get_edge_src_irn(edge));
+			}
+			if (ir_nodeset_contains(&env.kept, b))
+				dom_insert_visit(&env, end_block);
+		}
+	}
 	ir_free_resources(irg, IR_RESOURCE_BLOCK_VISITED);
-	/* If not all blocks are reachable from Start by out edges this assertion
-	   fails. */
-	assert(used <= n_blocks);
-	n_blocks = used;
 
-	for (int i = n_blocks; i-- > 1; ) {  /* Don't iterate the root, it's done. */
-		tmp_dom_info  *w     = &tdi_list[i];
-		const ir_node *block = w->block;
+	for (size_t i = 0, n = ARR_LEN(affected); i < n; ++i) {
+		unlink_Block_idom(affected[i]);
+		set_Block_idom(affected[i], nca);
+	}
+	update_dom_tree_numbers(irg);
 
-		/* Step 2 */
-		for (int j = 0, arity = get_irn_arity(block); j < arity; j++) {
-			const ir_node *pred       = get_Block_cfgpred(block, j);
-			const ir_node *pred_block = get_nodes_block(pred);
+	DEL_ARR_F(affected);
+	ir_nodeset_destroy(&env.kept);
+	del_pqueue(env.queue);
+	DEL_ARR_F(env.stack);
+	check_dom_update(irg);
+}
 
-			if (is_Bad(pred) || get_Block_dom_pre_num(pred_block) == -1)
-				continue;    /* unreachable */
+void dom_delete_edge(ir_node *pred, ir_node *block)
+{
+	ir_graph *irg = get_irn_irg(block);
+	if (!irg_has_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE))
+		return;
+	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE_FRONTIERS);
 
-			const tmp_dom_info *u = dom_eval(&tdi_list[get_Block_dom_pre_num(pred_block)]);
-			if (u->semi < w->semi)
-				w->semi = u->semi;
+	int pred_depth  = get_Block_dom_depth(pred);
+	int block_depth = get_Block_dom_depth(block);
+	if (pred_depth == 0 || block_depth == 0) {
+		clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+		return;
+	}
+	/* edges out of unreachable code do not change dominance */
+	if (pred_depth < 0)
+		return;
+	/* another edge from pred to block remains */
+	for (int i = 0, n = get_Block_n_cfgpreds(block); i < n; ++i) {
+		if (get_Block_cfgpred_block(block, i) == pred) {
+			check_dom_update(irg);
+			return;
 		}
+	}
+	/* Every path over an edge to a dominator of pred can be shortened to one
+	 * without it, all other deletions are handled by recomputation. */
+	if (block_depth > 0 && block_dominates(block, pred)) {
+		check_dom_update(irg);
+		return;
+	}
+	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+}
 
-		/* handle keep-alives if we are at the end block */
-		if (block == get_irg_end_block(irg)) {
-			foreach_irn_in(get_irg_end(irg), j, pred) {
-				if (!is_Block(pred) || get_Block_dom_pre_num(pred) == -1)
-					continue;   /* unreachable */
+typedef struct dom_snapshot {
+	ir_node *block;
+	ir_node *idom;
+	int      depth;
+} dom_snapshot;
 
-				const tmp_dom_info *u = dom_eval(&tdi_list[get_Block_dom_pre_num(pred)]);
-				if (u->semi < w->semi)
-					w->semi = u->semi;
-			}
-		}
+static void snapshot_dom_walker(ir_node *block, void *data)
+{
+	dom_snapshot **blocks = (dom_snapshot**)data;
+	dom_snapshot   s      = {
+		block, get_dom_info(block)->idom, get_Block_dom_depth(block)
+	};
+	ARR_APP1(dom_snapshot, *blocks, s);
+}
 
-		/* Add w to w->semi's bucket.  w is in exactly one bucket, so
-		   buckets can been implemented as linked lists. */
-		w->bucket = w->semi->bucket;
-		w->semi->bucket = w;
-
-		dom_link(w->parent, w);
-
-		/* Step 3 */
-		while (w->parent->bucket) {
-			tmp_dom_info *v = w->parent->bucket;
-			/* remove v from w->parent->bucket */
-			w->parent->bucket = v->bucket;
-			v->bucket         = NULL;
-
-			tmp_dom_info *u = dom_eval(v);
-			if (u->semi < v->semi)
-				v->dom = u;
-			else
-				v->dom = w->parent;
+int verify_dominance(ir_graph *irg)
+{
+	dom_snapshot *blocks = NEW_ARR_F(dom_snapshot, 0);
+	irg_block_walk_graph(irg, NULL, snapshot_dom_walker, &blocks);
+	compute_doms(irg);
+
+	bool fine = true;
+	for (size_t i = 0, n = ARR_LEN(blocks); i < n; ++i) {
+		dom_snapshot const *const s     = &blocks[i];
+		ir_node            *const idom  = get_dom_info(s->block)->idom;
+		int                 const depth = get_Block_dom_depth(s->block);
+		if (s->depth < 0 && depth < 0)
+			continue;
+		if (s->idom != idom || s->depth != depth) {
+			ir_fprintf(stderr, "Dominance Verifier: %+F has idom %+F (depth %d), expected %+F (depth %d)\n",
+			           s->block, s->idom, s->depth, idom, depth);
+			fine = false;
 		}
 	}
-	/* Step 4 */
-	tdi_list[0].dom = NULL;
-	set_Block_idom(tdi_list[0].block, NULL);
-	set_Block_dom_depth(tdi_list[0].block, 1);
-	for (int i = 1; i < n_blocks; i++) {
-		tmp_dom_info *w = &tdi_list[i];
-		if (w->dom == NULL)
-			continue; /* control dead */
-
-		if (w->dom != w->semi)
-			w->dom = w->dom->dom;
-		set_Block_idom(w->block, w->dom->block);
-
-		/* blocks dominated by dead one's are still dead */
-		int depth = get_Block_dom_depth(w->dom->block);
-		if (depth > 0)
-			++depth;
-		set_Block_dom_depth(w->block, depth);
-	}
+	DEL_ARR_F(blocks);
+	return fine;
+}
 
-	/* clean up */
-	free(tdi_list);
+/**
+ * Walks Blocks along the control flow.  If recursion started with
+ * End block misses blocks in endless loops.
+ */
+static void init_dom_graph_pdom(ir_node *block, int parent, dom_graph *g)
+{
+	if (Block_block_visited(block))
+		return;
+	mark_Block_block_visited(block);
 
-	/* Do a walk over the tree and assign the tree pre orders. */
-	unsigned tree_pre_order = 0;
-	dom_tree_walk(get_irg_start_block(irg), assign_tree_dom_pre_order,
-	              assign_tree_dom_pre_order_max, &tree_pre_order);
+	int num = add_dom_graph_block(g, block, parent);
+	set_Block_postdom_pre_num(block, num);
 
-	add_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+	/* Iterate */
+	for (int i = get_Block_n_cfgpreds(block) - 1; i >= 0; --i) {
+		ir_node *pred = get_Block_cfgpred_block(block, i);
+		if (pred == NULL)
+			continue;
+		init_dom_graph_pdom(pred, num, g);
+	}
+
+	/* All remaining block keep-alives are edges to endless loops.
+	 * Mark the following unvisited blocks as unreachable.
+	 * Later, we will treat the keep-alive edges as normal control flow. */
+	const ir_graph *irg = get_irn_irg(block);
+	if (block == get_irg_end_block(irg)) {
+		g->first_unreachable = g->n_blocks;
+		foreach_irn_in_r(get_irg_end(irg), i, pred) {
+			if (is_Block(pred))
+				init_dom_graph_pdom(pred, num, g);
+		}
+	}
 }
 
-static void update_pdom_semi(tmp_dom_info *tdi_list, tmp_dom_info *w,
-                             ir_node *succ_block)
+static void add_pdom_pred(dom_graph *g, const ir_node *succ_block)
 {
 	assert(is_Block(succ_block));
-	const int           pre_num = get_Block_postdom_pre_num(succ_block);
+	const int pre_num = get_Block_postdom_pre_num(succ_block);
 	assert(pre_num != -1);
-	const tmp_dom_info *u       = dom_eval(&tdi_list[pre_num]);
-	if (u->semi < w->semi) {
-		w->semi = u->semi;
+	ARR_APP1(int, g->preds, pre_num);
+}
+
+/**
+ * Collects the control flow successors of all numbered blocks, which are
+ * their predecessors in the reverse graph.
+ */
+static void collect_pdom_preds(dom_graph *g, const ir_graph *irg)
+{
+	const ir_node *end_block = get_irg_end_block(irg);
+	for (int i = 0; i < g->n_blocks; ++i) {
+		const ir_node *block       = g->blocks[i];
+		bool           unreachable = i >= g->first_unreachable;
+		g->pred_start[i] = ARR_LEN(g->preds);
+
+		unsigned const n_outs = get_Block_n_cfg_outs(block);
+		for (unsigned j = 0; j < n_outs; ++j)
+			add_pdom_pred(g, get_Block_cfg_out(block, j));
+		/* Handle keep-alive edges to unreachable blocks as normal control
+		 * flow. */
+		if (unreachable && get_Block_n_cfg_outs_ka(block) > n_outs)
+			add_pdom_pred(g, end_block);
 	}
+	g->pred_start[g->n_blocks] = ARR_LEN(g->preds);
 }
 
 void compute_postdoms(ir_graph *irg)
 {
 	/* Update graph state */
 	assert(!irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_CONSTRUCTION));
+	ir_analysis_start(IR_ANALYSIS_POSTDOMINANCE);
 
-	/* We need the out data structure. */
-	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUTS);
+	/* We need the control flow successors of the blocks. */
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_BLOCK_OUTS);
 
 	/* Count the number of blocks in the graph. */
 	int n_blocks = 0;
 	irg_block_walk_graph(irg, count_and_init_blocks_pdom, NULL, &n_blocks);
 
-	/* memory for temporary information. */
-	tmp_dom_info *tdi_list = XMALLOCN(tmp_dom_info, n_blocks);
+	dom_graph g;
+	init_dom_graph(&g, n_blocks);
 
 	/* this with a standard walker as passing the parent to the sons isn't
 	   simple. */
 	ir_reserve_resources(irg, IR_RESOURCE_BLOCK_VISITED);
 	inc_irg_block_visited(irg);
-	int used = 0;
-	ir_node *end_block = get_irg_end_block(irg);
-	init_tmp_pdom_info(end_block, NULL, tdi_list, &used, n_blocks, 0);
+	init_dom_graph_pdom(get_irg_end_block(irg), -1, &g);
 	ir_free_resources(irg, IR_RESOURCE_BLOCK_VISITED);
-	assert(used <= n_blocks);
-	n_blocks = used;
-
-	for (int i = n_blocks; i-- > 1; ) {  /* Don't iterate the root, it's done. */
-		tmp_dom_info *w = &tdi_list[i];
+	assert(g.n_blocks <= n_blocks);
 
-		/* Step 2 */
-		ir_node  *block       = w->block;
-		bool      unreachable = w->unreachable;
-		foreach_irn_out(block, j, succ) {
-			if (get_irn_mode(succ) != mode_X || is_Bad(succ))
-				continue;
-			if (is_End(succ)) {
-				if (unreachable && end_block != block)
-					/* Handle keep-alive edges to unreachable
-					 * blocks as normal control flow. */
-					update_pdom_semi(tdi_list, w, end_block);
-				continue;
-			}
-			foreach_irn_out(succ, k, succ_block) {
-				update_pdom_semi(tdi_list, w, succ_block);
-			}
-		}
+	collect_pdom_preds(&g, irg);
+	compute_semi_nca(&g);
 
-		/* Add w to w->semi's bucket.  w is in exactly one bucket, so
-		   buckets can be implemented as linked lists. */
-		w->bucket = w->semi->bucket;
-		w->semi->bucket = w;
-
-		dom_link(w->parent, w);
-
-		/* Step 3 */
-		while (w->parent->bucket) {
-			tmp_dom_info *v = w->parent->bucket;
-			/* remove v from w->parent->bucket */
-			w->parent->bucket = v->bucket;
-			v->bucket         = NULL;
-
-			tmp_dom_info *u = dom_eval(v);
-			if (u->semi < v->semi)
-				v->dom = u;
-			else
-				v->dom = w->parent;
-		}
-	}
-	/* Step 4 */
-	tdi_list[0].dom = NULL;
-	set_Block_ipostdom(tdi_list[0].block, NULL);
-	set_Block_postdom_depth(tdi_list[0].block, 1);
-	for (int i = 1; i < n_blocks; i++) {
-		tmp_dom_info *w = &tdi_list[i];
-
-		if (w->dom != w->semi)
-			w->dom = w->dom->dom;
-		set_Block_ipostdom(w->block, w->dom->block);
-		set_Block_postdom_depth(w->block, get_Block_postdom_depth(w->dom->block) + 1);
+	set_Block_ipostdom(g.blocks[0], NULL);
+	set_Block_postdom_depth(g.blocks[0], 1);
+	for (int i = 1; i < g.n_blocks; i++) {
+		ir_node *ipostdom = g.blocks[g.idom[i]];
+		set_Block_ipostdom(g.blocks[i], ipostdom);
+		set_Block_postdom_depth(g.blocks[i], get_Block_postdom_depth(ipostdom) + 1);
 	}
 
-	/* clean up */
-	free(tdi_list);
+	free_dom_graph(&g);
 
 	/* Do a walk over the tree and assign the tree pre orders. */
 	unsigned tree_pre_order = 0;
@@ -693,4 +886,5 @@ void compute_postdoms(ir_graph *irg)
 	                  assign_tree_postdom_pre_order_max, &tree_pre_order);
 
 	add_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_POSTDOMINANCE);
+	ir_analysis_stop(IR_ANALYSIS_POSTDOMINANCE);
 }
@@ -243,186 +243,252 @@ void lv_chk_free(lv_chk_t *lv)
 	dfs_free(lv->dfs);
 	obstack_free(&lv->obst, NULL);
 	ir_nodemap_destroy(&lv->block_infos);
-	free(lv);
+	xfree(lv);
+}
+
+/**
+ * The uses of a value, gathered once for any number of queries.
+ */
+typedef struct lv_chk_uses_t {
+	const ir_node *var;      /**< The value. */
+	const ir_node *def_bl;   /**< The block of the definition. */
+	bitset_t      *uses;     /**< Ids of the blocks containing uses, Phi
+	                              uses count in the predecessor block. */
+	bitset_t      *phi_uses; /**< Ids of the blocks at whose end a Phi
+	                              uses the value. */
+} lv_chk_uses_t;
+
+/**
+ * Checks the liveness of a value in its definition block.  There, it only
+ * matters whether there are uses outside the block.
+ */
+static unsigned check_def_block(lv_chk_t *lv, const ir_node *var,
+                                const ir_node *def_bl)
+{
+	stat_ev("lv_chk_def_block");
+	DBG((lv->dbg, LEVEL_2, "lv check same block %+F in %+F\n", var, def_bl));
+	(void)lv;
+
+	unsigned res = 0;
+	foreach_out_edge(var, edge) {
+		ir_node *use = get_edge_src_irn(edge);
+		if (!is_liveness_node(use))
+			continue;
+
+		ir_node *use_bl = get_nodes_block(use);
+		if (is_Phi(use)) {
+			int pos = get_edge_src_pos(edge);
+			use_bl  = get_Block_cfgpred_block(use_bl, pos);
+
+			if (use_bl == def_bl) {
+				DBG((lv->dbg, LEVEL_2, "\tphi %+F in succ %+F,%d -> live end\n", use, use_bl, pos));
+				res |= lv_chk_state_end;
+			}
+		}
+
+		if (use_bl != def_bl)
+			return lv_chk_state_end | lv_chk_state_out;
+	}
+	return res;
+}
+
+/**
+ * Gathers the blocks using a value into uses, which must hold bitsets of
+ * n_blocks elements.
+ */
+static void collect_uses(lv_chk_t *lv, lv_chk_uses_t *uses)
+{
+	foreach_out_edge(uses->var, edge) {
+		ir_node *user = get_edge_src_irn(edge);
+
+		/* if the user is no liveness node, the use does not count */
+		if (!is_liveness_node(user))
+			continue;
+
+		/* if the user is a phi, the use is in the predecessor.
+		 * furthermore, remember it so that in the case where
+		 * the block in question coincides with a use, it
+		 * can be marked live_end there. */
+		ir_node *use_bl = get_nodes_block(user);
+		bool     is_phi = is_Phi(user);
+		if (is_phi) {
+			int pos = get_edge_src_pos(edge);
+			use_bl  = get_Block_cfgpred_block(use_bl, pos);
+			if (use_bl == NULL)
+				continue;
+		}
+
+		const bl_info_t *bi = get_block_info(lv, use_bl);
+		bitset_set(uses->uses, bi->id);
+		if (is_phi)
+			bitset_set(uses->phi_uses, bi->id);
+	}
+	DBG((lv->dbg, LEVEL_2, "\tuses: %B\n", uses->uses));
+}
+
+/**
+ * Checks the liveness of a value in a block, which is dominated by the
+ * definition block but differs from it.
+ */
+static unsigned check_block(lv_chk_t *lv, lv_chk_uses_t *uses,
+                            const ir_node *bl)
+{
+	const bl_info_t *bli = get_block_info(lv, bl);
+	DBG((lv->dbg, LEVEL_2,
+	     "lv check %+F (def in %+F) in different block %+F #%d\n",
+	     uses->var, uses->def_bl, bl, bli->id));
+
+	/* if the use block coincides with the query block, we
+	 * already have a little liveness information.
+	 * The variable is surely live there, since bl != def_bl. */
+	unsigned res = 0;
+	if (bitset_is_set(uses->uses, bli->id))
+		res |= lv_chk_state_in;
+	if (bitset_is_set(uses->phi_uses, bli->id))
+		res |= lv_chk_state_end;
+
+	/* get the dominance range which really matters. all uses outside
+	 * the definition's dominance range are not to consider. note,
+	 * that the definition itself is also not considered. The case
+	 * where bl == def_bl is considered above. */
+	unsigned min_dom = get_Block_dom_tree_pre_num(uses->def_bl) + 1;
+	unsigned max_dom = get_Block_dom_max_subtree_pre_num(uses->def_bl);
+
+	/* prepare a set with all reachable back edge targets.
+	 * this will determine our "looking points" from where
+	 * we will search/find the calculated uses. */
+	const bitset_t *Tq = bli->be_tgt_reach;
+
+	/* now, visit all viewing points in the temporary bitset lying
+	 * in the dominance range of the variable. Note that for reducible
+	 * flow-graphs the first iteration is sufficient and the loop
+	 * will be left. */
+	DBG((lv->dbg, LEVEL_2, "\tbe tgt reach: %B, dom span: [%u, %u]\n", Tq,
+	     min_dom, max_dom));
+	size_t i = bitset_next_set(Tq, min_dom);
+	while (i <= max_dom) {
+		const bl_info_t *ti                   = lv->map[i];
+		bool             use_in_current_block = bitset_is_set(uses->uses, ti->id);
+
+		/*
+		 * This is somewhat tricky. Since this routine handles both, live in
+		 * and end/out we have to handle all the border cases correctly.
+		 * Each node is in its own red_reachable set (see calculation
+		 * function above). That means, that in the case where bl == t, the
+		 * intersection check of uses and reachability below will always
+		 * find an intersection, namely t.
+		 *
+		 * However, if a block contains a use and the variable is dead
+		 * afterwards, it is not live end/out at that block. Besides
+		 * back-edge target. If a var is live-in at a back-edge target it
+		 * is also live out/end there since the variable is live in the
+		 * underlying loop. So in the case where t == bl and that is not
+		 * a back-edge target, we have to remove that use from consideration
+		 * to determine if the var is live out/end there.
+		 *
+		 * Note that the live in information has been calculated by the
+		 * uses iteration above.
+		 */
+		if (ti == bli && !bitset_is_set(lv->back_edge_tgt, ti->id)) {
+			DBG((lv->dbg, LEVEL_2, "\tlooking not from a back edge target and q == t. removing use: %d\n", ti->id));
+			bitset_clear(uses->uses, ti->id);
+		}
+
+		/* If we can reach a use, the variable is live there */
+		DBG((lv->dbg, LEVEL_2, "\tlooking from %d: seeing %B\n",
+		     ti->id, ti->red_reachable));
+		bool live = bitset_intersect(ti->red_reachable, uses->uses);
+
+		/*
+		 * if we deleted a use do to the commentary above, we have to
+		 * re-add it since it might be visible from further view points
+		 * (we only need that in the non-reducible case) and by further
+		 * queries.
+		 */
+		if (use_in_current_block)
+			bitset_set(uses->uses, ti->id);
+
+		if (live)
+			return res | lv_chk_state_in | lv_chk_state_out | lv_chk_state_end;
+
+		i = bitset_next_set(Tq, get_Block_dom_max_subtree_pre_num(ti->block) + 1);
+	}
+	return res;
 }
 
 unsigned lv_chk_bl_xxx(lv_chk_t *lv, const ir_node *bl, const ir_node *var)
 {
 	assert(is_Block(bl));
 	assert(is_liveness_node(var));
-	stat_ev_cnt_decl(uses);
-	stat_ev_cnt_decl(iter);
 
 	stat_ev_ctx_push_fmt("lv_chk", "%u", get_irn_idx(var));
 	stat_ev_tim_push();
 
 	/* If there is no dominance relation, go out, too */
-	int            res    = 0;
+	unsigned       res    = 0;
 	const ir_node *def_bl = get_nodes_block(var);
 	if (!block_dominates(def_bl, bl)) {
 		stat_ev("lv_chk_no_dom");
-		goto end;
-	}
-
-	/*
-	 * If the block in question is the same as the definition block,
-	 * the algorithm is simple. Just check for uses not inside this block.
-	 */
-	if (def_bl == bl) {
-		stat_ev("lv_chk_def_block");
-		DBG((lv->dbg, LEVEL_2, "lv check same block %+F in %+F\n", var, bl));
-		foreach_out_edge(var, edge) {
-			ir_node *use = get_edge_src_irn(edge);
-			if (!is_liveness_node(use))
-				continue;
-
-			stat_ev_cnt_inc(uses);
-			ir_node *use_bl = get_nodes_block(use);
-			if (is_Phi(use)) {
-				int pos = get_edge_src_pos(edge);
-				use_bl  = get_Block_cfgpred_block(use_bl, pos);
-
-				if (use_bl == bl) {
-					DBG((lv->dbg, LEVEL_2, "\tphi %+F in succ %+F,%d -> live end\n", use, use_bl, pos));
-					res |= lv_chk_state_end;
-				}
-			}
-
-			if (use_bl != def_bl) {
-				res = lv_chk_state_end | lv_chk_state_out;
-				goto end;
-			}
-		}
-
-		goto end;
+	} else if (def_bl == bl) {
+		/*
+		 * If the block in question is the same as the definition block,
+		 * the algorithm is simple. Just check for uses not inside this block.
+		 */
+		res = check_def_block(lv, var, def_bl);
 	} else {
 		/*
 		 * this is the more complicated case.
 		 * We try to gather as much information as possible during looking
 		 * at the uses.
-		 *
-		 * Note that we know for sure that bl != def_bl. That is sometimes
-		 * silently exploited below.
 		 */
-		const bl_info_t *bli = get_block_info(lv, bl);
-		const bl_info_t *def = get_block_info(lv, def_bl);
-		(void)def;
-		DBG((lv->dbg, LEVEL_2,
-		     "lv check %+F (def in %+F #%d) in different block %+F #%d\n",
-		     var, def_bl, def->id, bl, bli->id));
-
-		bitset_t *uses = bitset_alloca(lv->n_blocks);
-		foreach_out_edge(var, edge) {
-			ir_node *user = get_edge_src_irn(edge);
-
-			/* if the user is no liveness node, the use does not count */
-			if (!is_liveness_node(user))
-				continue;
-
-			stat_ev_cnt_inc(uses);
-
-			/* if the user is a phi, the use is in the predecessor
-			 * furthermore, prepare a mask so that in the case where
-			 * bl (the block in question) coincides with a use, it
-			 * can be marked live_end there. */
-			int      mask   = lv_chk_state_in;
-			ir_node *use_bl = get_nodes_block(user);
-			if (is_Phi(user)) {
-				int pos = get_edge_src_pos(edge);
-				use_bl  = get_Block_cfgpred_block(use_bl, pos);
-				if (use_bl == NULL)
-					continue;
-				mask   |= lv_chk_state_end;
-			}
+		lv_chk_uses_t uses;
+		uses.var      = var;
+		uses.def_bl   = def_bl;
+		uses.uses     = bitset_alloca(lv->n_blocks);
+		uses.phi_uses = bitset_alloca(lv->n_blocks);
+		collect_uses(lv, &uses);
+		res = check_block(lv, &uses, bl);
+	}
 
+	stat_ev_tim_pop("lv_chk_query_time");
+	stat_ev_ctx_pop("lv_chk");
 
-			/* if the use block coincides with the query block, we
-			 * already gather a little liveness information.
-			 * The variable is surely live there, since bl != def_bl
-			 * (that case is treated above). */
-			if (use_bl == bl)
-				res |= mask;
+	return res;
+}
 
-			const bl_info_t *bi = get_block_info(lv, use_bl);
-			bitset_set(uses, bi->id);
-		}
-		DBG((lv->dbg, LEVEL_2, "\tuses: %B\n", uses));
-
-		/* get the dominance range which really matters. all uses outside
-		 * the definition's dominance range are not to consider. note,
-		 * that the definition itself is also not considered. The case
-		 * where bl == def_bl is considered above. */
-		unsigned min_dom = get_Block_dom_tree_pre_num(def_bl) + 1;
-		unsigned max_dom = get_Block_dom_max_subtree_pre_num(def_bl);
-
-		/* prepare a set with all reachable back edge targets.
-		 * this will determine our "looking points" from where
-		 * we will search/find the calculated uses. */
-		const bitset_t *Tq = bli->be_tgt_reach;
-
-		/* now, visit all viewing points in the temporary bitset lying
-		 * in the dominance range of the variable. Note that for reducible
-		 * flow-graphs the first iteration is sufficient and the loop
-		 * will be left. */
-		DBG((lv->dbg, LEVEL_2, "\tbe tgt reach: %B, dom span: [%u, %u]\n", Tq,
-		     min_dom, max_dom));
-		size_t i = bitset_next_set(Tq, min_dom);
-		while (i <= max_dom) {
-			const bl_info_t *ti                   = lv->map[i];
-			bool             use_in_current_block = bitset_is_set(uses, ti->id);
-
-			stat_ev_cnt_inc(iter);
+void lv_chk_bls_xxx(lv_chk_t *lv, const ir_node *var, size_t n_blocks,
+                    const ir_node *const *blocks, unsigned *states)
+{
+	assert(is_liveness_node(var));
 
-			/*
-			 * This is somewhat tricky. Since this routine handles both, live in
-			 * and end/out we have to handle all the border cases correctly.
-			 * Each node is in its own red_reachable set (see calculation
-			 * function above). That means, that in the case where bl == t, the
-			 * intersection check of uses and reachability below will always
-			 * find an intersection, namely t.
-			 *
-			 * However, if a block contains a use and the variable is dead
-			 * afterwards, it is not live end/out at that block. Besides
-			 * back-edge target. If a var is live-in at a back-edge target it
-			 * is also live out/end there since the variable is live in the
-			 * underlying loop. So in the case where t == bl and that is not
-			 * a back-edge target, we have to remove that use from consideration
-			 * to determine if the var is live out/end there.
-			 *
-			 * Note that the live in information has been calculated by the
-			 * uses iteration above.
-			 */
-			if (ti == bli && !bitset_is_set(lv->back_edge_tgt, ti->id)) {
-				DBG((lv->dbg, LEVEL_2, "\tlooking not from a back edge target and q == t. removing use: %d\n", ti->id));
-				bitset_clear(uses, ti->id);
+	/* the uses are only collected when a query needs them */
+	const ir_node *def_bl    = get_nodes_block(var);
+	unsigned       def_state = 0;
+	bool           def_valid = false;
+	lv_chk_uses_t  uses;
+	uses.var      = var;
+	uses.def_bl   = def_bl;
+	uses.uses     = NULL;
+	uses.phi_uses = NULL;
+
+	for (size_t i = 0; i < n_blocks; ++i) {
+		const ir_node *bl = blocks[i];
+		assert(is_Block(bl));
+		if (!block_dominates(def_bl, bl)) {
+			states[i] = 0;
+		} else if (def_bl == bl) {
+			if (!def_valid) {
+				def_state = check_def_block(lv, var, def_bl);
+				def_valid = true;
 			}
-
-			/* If we can reach a use, the variable is live there and we say goodbye */
-			DBG((lv->dbg, LEVEL_2, "\tlooking from %d: seeing %B\n",
-			     ti->id, ti->red_reachable));
-			if (bitset_intersect(ti->red_reachable, uses)) {
-				res |= lv_chk_state_in | lv_chk_state_out | lv_chk_state_end;
-				goto end;
+			states[i] = def_state;
+		} else {
+			if (uses.uses == NULL) {
+				uses.uses     = bitset_alloca(lv->n_blocks);
+				uses.phi_uses = bitset_alloca(lv->n_blocks);
+				collect_uses(lv, &uses);
 			}
-
-			/*
-			 * if we deleted a use do to the commentary above, we have to
-			 * re-add it since it might be visible from further view points
-			 * (we only need that in the non-reducible case).
-			 */
-			if (use_in_current_block)
-				bitset_set(uses, ti->id);
-
-			i = bitset_next_set(Tq, get_Block_dom_max_subtree_pre_num(ti->block) + 1);
+			states[i] = check_block(lv, &uses, bl);
 		}
-
 	}
-
-end:
-	stat_ev_tim_pop("lv_chk_query_time");
-	stat_ev_cnt_done(uses, "lv_chk_uses");
-	stat_ev_cnt_done(iter, "lv_chk_iter");
-	stat_ev_ctx_pop("lv_chk");
-
-	return res;
 }
@@ -71,6 +71,20 @@ extern void lv_chk_free(lv_chk_t *lv);
  */
 extern unsigned lv_chk_bl_xxx(lv_chk_t *lv, const ir_node *bl, const ir_node *irn);
 
+/**
+ * Return liveness information for a node concerning several blocks.
+ * The uses of the node are only inspected once for all blocks, so this is
+ * cheaper than querying the blocks one by one.
+ * @param lv        The liveness environment.
+ * @param irn       The node to check for.
+ * @param n_blocks  The number of blocks to investigate.
+ * @param blocks    The blocks to investigate.
+ * @param states    Receives a bitmask of <code>lv_chk_state_t</code> for
+ *                  each block.
+ */
+extern void lv_chk_bls_xxx(lv_chk_t *lv, const ir_node *irn, size_t n_blocks,
+                           const ir_node *const *blocks, unsigned *states);
+
 #define lv_chk_bl_in(lv, bl, irn)  ((lv_chk_bl_xxx((lv), (bl), (irn)) & lv_chk_state_in)  != 0)
 #define lv_chk_bl_end(lv, bl, irn) ((lv_chk_bl_xxx((lv), (bl), (irn)) & lv_chk_state_end) != 0)
 #define lv_chk_bl_out(lv, bl, irn) ((lv_chk_bl_xxx((lv), (bl), (irn)) & lv_chk_state_out) != 0)
@@ -79,7 +79,8 @@ loop_element get_loop_element(const ir_loop *loop, size_t pos)
 
 void set_irn_loop(ir_node *n, ir_loop *loop)
 {
-	n->loop = loop;
+	assert(is_Block(n));
+	n->attr.block.loop = loop;
 }
 
 ir_loop *(get_irn_loop)(const ir_node *n)
@@ -0,0 +1,244 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief    Target independent register pressure estimation for loops.
+ *
+ * The backend only knows the register pressure of a loop after instruction
+ * selection (see beloopana).  The middle end uses this estimate to keep loop
+ * transformations from pushing a loop beyond the available registers.
+ *
+ * Liveness is computed per value by walking the control flow backwards from
+ * each use to the definition.  Only the liveness at block borders is
+ * recorded, values which die in the block they are defined in are not
+ * counted.
+ */
+#include <stdbool.h>
+
+#include "array.h"
+#include "iredges_t.h"
+#include "irgraph_t.h"
+#include "irloop_t.h"
+#include "irnode_t.h"
+#include "irnodemap.h"
+#include "irnodeset.h"
+#include "obst.h"
+#include "util.h"
+
+/** Liveness information of a block. */
+typedef struct block_live_t {
+	const ir_node *last_in;  /**< the value last counted in live_in */
+	const ir_node *last_out; /**< the value last counted in live_out */
+	unsigned       live_in;  /**< number of values live at the block entry */
+	unsigned       live_out; /**< number of values live at the block exit */
+	bool           in_loop;  /**< the block belongs to the loop */
+} block_live_t;
+
+typedef struct pressure_env_t {
+	const ir_loop  *loop;
+	bool            float_values; /**< count float instead of int values */
+	ir_nodemap      blocks;       /**< block_live_t of the visited blocks */
+	ir_nodeset_t    invariants;   /**< values live through the loop */
+	block_live_t  **loop_blocks;  /**< block_live_t of the loop blocks */
+	ir_node       **worklist;
+	struct obstack  obst;
+} pressure_env_t;
+
+/**
+ * Checks whether @p block is part of @p loop or one of its inner loops.
+ */
+static bool block_in_loop(const ir_node *block, const ir_loop *loop)
+{
+	for (ir_loop *l = get_irn_loop(block); l != NULL && get_loop_depth(l) > 0;
+	     l = get_loop_outer_loop(l)) {
+		if (l == loop)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Checks whether @p node produces a value which occupies a register of the
+ * class counted by @p env.  Constants are not counted, the backend
+ * rematerializes them instead of keeping them in registers.
+ */
+static bool is_counted_value(const pressure_env_t *env, const ir_node *node)
+{
+	if (is_irn_constlike(node))
+		return false;
+	ir_mode *const mode = get_irn_mode(node);
+	if (env->float_values)
+		return mode_is_float(mode);
+	return mode_is_int(mode) || mode_is_reference(mode);
+}
+
+static block_live_t *get_block_live(pressure_env_t *env, ir_node *block)
+{
+	block_live_t *live = ir_nodemap_get(block_live_t, &env->blocks, block);
+	if (live == NULL) {
+		live          = OALLOCZ(&env->obst, block_live_t);
+		live->in_loop = block_in_loop(block, env->loop);
+		ir_nodemap_insert(&env->blocks, block, live);
+		if (live->in_loop)
+			ARR_APP1(block_live_t*, env->loop_blocks, live);
+	}
+	return live;
+}
+
+static void mark_live_out(pressure_env_t *env, ir_node *block,
+                          const ir_node *value, ir_node *def_block)
+{
+	block_live_t *const live = get_block_live(env, block);
+	if (live->last_out != value) {
+		live->last_out = value;
+		++live->live_out;
+	}
+	if (block != def_block)
+		ARR_APP1(ir_node*, env->worklist, block);
+}
+
+/**
+ * Marks the blocks between the uses of @p value and its definition, in which
+ * @p value is live.
+ */
+static void compute_value_liveness(pressure_env_t *env, const ir_node *value)
+{
+	ir_node *const def_block = get_nodes_block(value);
+
+	foreach_out_edge(value, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		if (is_End(user))
+			continue;
+		if (is_Phi(user)) {
+			ir_node *const block = get_nodes_block(user);
+			ir_node *const pred  = get_Block_cfgpred_block(block, get_edge_src_pos(edge));
+			if (pred != NULL)
+				mark_live_out(env, pred, value, def_block);
+		} else {
+			ir_node *const block = get_nodes_block(user);
+			if (block != def_block)
+				ARR_APP1(ir_node*, env->worklist, block);
+		}
+	}
+
+	while (ARR_LEN(env->worklist) > 0) {
+		ir_node *const block = env->worklist[ARR_LEN(env->worklist) - 1];
+		ARR_SHRINKLEN(env->worklist, ARR_LEN(env->worklist) - 1);
+
+		block_live_t *const live = get_block_live(env, block);
+		if (live->last_in == value)
+			continue;
+		live->last_in = value;
+		++live->live_in;
+
+		for (int i = 0, n = get_Block_n_cfgpreds(block); i < n; ++i) {
+			ir_node *const pred = get_Block_cfgpred_block(block, i);
+			if (pred != NULL)
+				mark_live_out(env, pred, value, def_block);
+		}
+	}
+}
+
+/**
+ * Records the values used by @p node which are defined outside of the loop.
+ */
+static void collect_invariants(pressure_env_t *env, ir_node *node)
+{
+	ir_node *const block = get_nodes_block(node);
+	foreach_irn_in(node, i, pred) {
+		if (!is_counted_value(env, pred))
+			continue;
+		/* a Phi uses its operands at the end of the predecessor block */
+		if (is_Phi(node)) {
+			ir_node *const pred_block = get_Block_cfgpred_block(block, i);
+			if (pred_block == NULL || !block_in_loop(pred_block, env->loop))
+				continue;
+		}
+		if (!block_in_loop(get_nodes_block(pred), env->loop))
+			ir_nodeset_insert(&env->invariants, pred);
+	}
+}
+
+static void visit_node(pressure_env_t *env, ir_node *node)
+{
+	if (get_irn_mode(node) == mode_T) {
+		foreach_out_edge(node, edge) {
+			ir_node *const proj = get_edge_src_irn(edge);
+			if (is_Proj(proj))
+				visit_node(env, proj);
+		}
+	}
+
+	if (!is_Proj(node) && !is_Block(node))
+		collect_invariants(env, node);
+	if (is_counted_value(env, node))
+		compute_value_liveness(env, node);
+}
+
+static void visit_loop(pressure_env_t *env, const ir_loop *loop)
+{
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_loop) {
+			visit_loop(env, element.son);
+		} else if (is_Block(element.node)) {
+			foreach_out_edge(element.node, edge) {
+				ir_node *const node = get_edge_src_irn(edge);
+				if (!is_Block(node))
+					visit_node(env, node);
+			}
+		}
+	}
+}
+
+/**
+ * Returns a block of @p loop or one of its inner loops.
+ */
+static ir_node *get_loop_block(const ir_loop *loop)
+{
+	for (;;) {
+		loop_element const element = get_loop_element(loop, 0);
+		if (*element.kind != k_ir_loop)
+			return element.node;
+		loop = element.son;
+	}
+}
+
+unsigned get_loop_register_pressure(const ir_loop *loop, int float_values,
+                                    unsigned *invariant)
+{
+	ir_graph *const irg = get_irn_irg(get_loop_block(loop));
+	assert(irg_has_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
+	                              | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO));
+
+	pressure_env_t env;
+	env.loop         = loop;
+	env.float_values = float_values;
+	env.worklist     = NEW_ARR_F(ir_node*, 0);
+	env.loop_blocks  = NEW_ARR_F(block_live_t*, 0);
+	ir_nodemap_init(&env.blocks, irg);
+	ir_nodeset_init(&env.invariants);
+	obstack_init(&env.obst);
+
+	visit_loop(&env, loop);
+
+	unsigned max_live = 0;
+	for (size_t i = 0, n = ARR_LEN(env.loop_blocks); i < n; ++i) {
+		block_live_t const *const live = env.loop_blocks[i];
+		max_live = MAX(max_live, MAX(live->live_in, live->live_out));
+	}
+	unsigned const n_invariants = ir_nodeset_size(&env.invariants);
+
+	obstack_free(&env.obst, NULL);
+	ir_nodeset_destroy(&env.invariants);
+	ir_nodemap_destroy(&env.blocks);
+	DEL_ARR_F(env.loop_blocks);
+	DEL_ARR_F(env.worklist);
+
+	if (invariant != NULL)
+		*invariant = n_invariants;
+	return n_invariants + max_live;
+}
@@ -11,8 +11,10 @@
  */
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "adt/pmap.h"
+#include "adt/set.h"
 #include "irnode_t.h"
 #include "irgraph_t.h"
 #include "irprog_t.h"
@@ -23,9 +25,12 @@
 #include "irflag.h"
 #include "irouts_t.h"
 #include "irgwalk.h"
+#include "irhooks.h"
+#include "irnodemap.h"
 #include "irprintf.h"
 #include "debug.h"
 #include "panic.h"
+#include "statev_t.h"
 #include "typerep.h"
 #include "type_t.h"
 #include "util.h"
@@ -295,9 +300,88 @@ follow_ptr:
 	}
 }
 
+/** Everything the disambiguator derives from a single address. */
+typedef struct address_class {
+	address_info             info;
+	const ir_node           *base; /**< base address after skipping Sels and
+	                                    Members */
+	ir_entity               *ent;  /**< entity of the outermost Member */
+	ir_storage_class_class_t sc;   /**< storage class of the address */
+} address_class;
+
+static address_class get_address_class(const ir_node *addr)
+{
+	address_class res;
+	res.info = get_address_info(addr);
+	res.ent  = NULL;
+	res.base = find_base_addr(res.info.base, &res.ent);
+	res.sc   = classify_pointer(res.info.base, res.base);
+	return res;
+}
+
+/** A cached result of get_alias_relation(). */
+typedef struct alias_query {
+	const ir_node    *addr1;
+	const ir_type    *type1;
+	const ir_node    *addr2;
+	const ir_type    *type2;
+	unsigned          size1;
+	unsigned          size2;
+	ir_alias_relation rel;    /**< the result, not part of the key */
+} alias_query;
+
+/** The alias query cache of a graph. */
+struct ir_alias_cache {
+	ir_graph      *irg;
+	set           *queries;    /**< set of alias_query */
+	ir_nodemap     classes;    /**< maps addresses to their address_class */
+	struct obstack obst;       /**< holds the address classes */
+	bool           precompute; /**< address classes are memorized */
+	unsigned       n_queries;  /**< number of cached queries */
+	unsigned       n_hits;     /**< number of queries found in the cache */
+	unsigned       n_flushes;  /**< number of cache invalidations */
+};
+typedef struct ir_alias_cache ir_alias_cache;
+
+static const address_class *get_cached_address_class(ir_alias_cache *cache,
+                                                     const ir_node *addr)
+{
+	address_class *res = ir_nodemap_get(address_class, &cache->classes, addr);
+	if (res == NULL) {
+		res  = OALLOC(&cache->obst, address_class);
+		*res = get_address_class(addr);
+		ir_nodemap_insert(&cache->classes, addr, res);
+	}
+	return res;
+}
+
+ir_entity *get_unaliased_entity(const ir_node *addr)
+{
+	ir_graph *const irg     = get_irn_irg(addr);
+	unsigned  const options = get_irg_memory_disambiguator_options(irg);
+	if (options & aa_opt_always_alias)
+		return NULL;
+
+	ir_alias_cache      *const cache = irg->alias_cache;
+	address_class              buf;
+	const address_class       *ac;
+	if (cache != NULL && cache->precompute) {
+		ac = get_cached_address_class(cache, addr);
+	} else {
+		buf = get_address_class(addr);
+		ac  = &buf;
+	}
+	if (!(ac->sc & ir_sc_modifier_nottaken))
+		return NULL;
+	if (is_Address(ac->base))
+		return get_Address_entity(ac->base);
+	return get_Member_entity(ac->base);
+}
+
 static ir_alias_relation _get_alias_relation(
 	const ir_node *addr1, const ir_type *const objt1, unsigned size1,
-	const ir_node *addr2, const ir_type *const objt2, unsigned size2)
+	const ir_node *addr2, const ir_type *const objt2, unsigned size2,
+	ir_alias_cache *cache)
 {
 	if (addr1 == addr2)
 		return ir_sure_alias;
@@ -309,6 +393,20 @@ static ir_alias_relation _get_alias_relation(
 	if (options & aa_opt_no_alias)
 		return ir_no_alias;
 
+	address_class        class_buf1;
+	address_class        class_buf2;
+	const address_class *ac1;
+	const address_class *ac2;
+	if (cache != NULL && cache->precompute) {
+		ac1 = get_cached_address_class(cache, addr1);
+		ac2 = get_cached_address_class(cache, addr2);
+	} else {
+		class_buf1 = get_address_class(addr1);
+		class_buf2 = get_address_class(addr2);
+		ac1        = &class_buf1;
+		ac2        = &class_buf2;
+	}
+
 	/* do the addresses have constants offsets from the same base?
 	 *  Note: sub X, C is normalized to add X, -C */
 
@@ -317,8 +415,8 @@ static ir_alias_relation _get_alias_relation(
 	 * offset can be handled.  To extend this, change
 	 * sym_offset to be a set, and compare the sets.
 	 */
-	address_info const info1   = get_address_info(addr1);
-	address_info const info2   = get_address_info(addr2);
+	address_info const info1   = ac1->info;
+	address_info const info2   = ac2->info;
 	long               offset1 = info1.offset;
 	long               offset2 = info2.offset;
 	addr1 = info1.base;
@@ -346,10 +444,10 @@ static ir_alias_relation _get_alias_relation(
 	}
 
 	/* skip Sels/Members */
-	ir_entity     *ent1  = NULL;
-	ir_entity     *ent2  = NULL;
-	const ir_node *base1 = find_base_addr(addr1, &ent1);
-	const ir_node *base2 = find_base_addr(addr2, &ent2);
+	ir_entity     *const ent1  = ac1->ent;
+	ir_entity     *const ent2  = ac2->ent;
+	const ir_node *const base1 = ac1->base;
+	const ir_node *const base2 = ac2->base;
 
 	/* two struct accesses -> compare entities */
 	if (ent1 != NULL && ent2 != NULL) {
@@ -382,8 +480,8 @@ static ir_alias_relation _get_alias_relation(
 
 check_classes:;
 	/* no alias if 1 is a primitive object and the other a compound object */
-	const ir_storage_class_class_t mod1 = classify_pointer(addr1, base1);
-	const ir_storage_class_class_t mod2 = classify_pointer(addr2, base2);
+	const ir_storage_class_class_t mod1 = ac1->sc;
+	const ir_storage_class_class_t mod2 = ac2->sc;
 	if (((mod1 | mod2) & (ir_sc_modifier_obj_comp | ir_sc_modifier_obj_prim))
 	    == (ir_sc_modifier_obj_comp | ir_sc_modifier_obj_prim))
 		return ir_no_alias;
@@ -476,16 +574,162 @@ leave_type_based_alias:;
 	return ir_may_alias;
 }
 
+static int cmp_alias_query(const void *elt, const void *key, size_t size)
+{
+	(void)size;
+	const alias_query *q1 = (const alias_query*)elt;
+	const alias_query *q2 = (const alias_query*)key;
+	return q1->addr1 != q2->addr1 || q1->addr2 != q2->addr2
+	    || q1->type1 != q2->type1 || q1->type2 != q2->type2
+	    || q1->size1 != q2->size1 || q1->size2 != q2->size2;
+}
+
+static ir_alias_relation get_cached_alias_relation(ir_alias_cache *cache,
+	const ir_node *addr1, const ir_type *type1, unsigned size1,
+	const ir_node *addr2, const ir_type *type2, unsigned size2)
+{
+	++cache->n_queries;
+
+	/* the relation is symmetric, so order the key by node index */
+	alias_query key;
+	if (get_irn_idx(addr1) <= get_irn_idx(addr2)) {
+		key = (alias_query){ addr1, type1, addr2, type2, size1, size2,
+		                     ir_may_alias };
+	} else {
+		key = (alias_query){ addr2, type2, addr1, type1, size2, size1,
+		                     ir_may_alias };
+	}
+	unsigned hash = hash_combine(hash_combine(hash_ptr(key.addr1),
+	                                          hash_ptr(key.addr2)),
+	                             hash_combine(hash_ptr(key.type1) ^ key.size1,
+	                                          hash_ptr(key.type2) ^ key.size2));
+
+	alias_query *entry = set_find(alias_query, cache->queries, &key,
+	                              sizeof(key), hash);
+	if (entry != NULL) {
+		++cache->n_hits;
+		return entry->rel;
+	}
+
+	key.rel = _get_alias_relation(key.addr1, key.type1, key.size1,
+	                              key.addr2, key.type2, key.size2, cache);
+	(void)set_insert(alias_query, cache->queries, &key, sizeof(key), hash);
+	return key.rel;
+}
+
 ir_alias_relation get_alias_relation(
 	const ir_node *const addr1, const ir_type *const type1, unsigned size1,
 	const ir_node *const addr2, const ir_type *const type2, unsigned size2)
 {
-	ir_alias_relation rel = _get_alias_relation(addr1, type1, size1, addr2, type2, size2);
+	ir_alias_cache   *cache = get_irn_irg(addr1)->alias_cache;
+	ir_alias_relation rel   = cache != NULL
+		? get_cached_alias_relation(cache, addr1, type1, size1,
+		                            addr2, type2, size2)
+		: _get_alias_relation(addr1, type1, size1, addr2, type2, size2, NULL);
 	DB((dbg, LEVEL_1, "alias(%+F, %+F) = %s\n", addr1, addr2,
 	    get_ir_alias_relation_name(rel)));
 	return rel;
 }
 
+/**
+ * Drops all cached queries and address classes.
+ */
+static void flush_alias_cache(ir_alias_cache *cache)
+{
+	del_set(cache->queries);
+	cache->queries = new_set(cmp_alias_query, 64);
+	if (cache->precompute) {
+		ir_nodemap_destroy(&cache->classes);
+		ir_nodemap_init(&cache->classes, cache->irg);
+		obstack_free(&cache->obst, NULL);
+		obstack_init(&cache->obst);
+	}
+	++cache->n_flushes;
+}
+
+/**
+ * Walker: computes the address classes of all memory operations.
+ */
+static void precompute_address_class(ir_node *node, void *env)
+{
+	ir_alias_cache *cache = (ir_alias_cache*)env;
+	if (is_Load(node)) {
+		get_cached_address_class(cache, get_Load_ptr(node));
+	} else if (is_Store(node)) {
+		get_cached_address_class(cache, get_Store_ptr(node));
+	} else if (is_CopyB(node)) {
+		get_cached_address_class(cache, get_CopyB_src(node));
+		get_cached_address_class(cache, get_CopyB_dst(node));
+	}
+}
+
+void ir_init_alias_cache(ir_graph *irg)
+{
+	assert(irg->alias_cache == NULL);
+	ir_alias_cache *cache = XMALLOCZ(ir_alias_cache);
+	cache->irg     = irg;
+	cache->queries = new_set(cmp_alias_query, 64);
+
+	ir_disambiguator_options options = get_irg_memory_disambiguator_options(irg);
+	cache->precompute = (options & aa_opt_precompute_addresses) != 0;
+	if (cache->precompute) {
+		ir_nodemap_init(&cache->classes, irg);
+		obstack_init(&cache->obst);
+	}
+	irg->alias_cache = cache;
+
+	if (cache->precompute)
+		irg_walk_graph(irg, NULL, precompute_address_class, cache);
+}
+
+size_t get_alias_cache_memory_used(ir_graph *irg)
+{
+	ir_alias_cache *const cache = irg->alias_cache;
+	if (cache == NULL)
+		return 0;
+	size_t bytes = sizeof(*cache) + set_memory_used(cache->queries);
+	if (cache->precompute) {
+		bytes += ARR_LEN(cache->classes.data) * sizeof(*cache->classes.data)
+		       + obstack_memory_used(&cache->obst);
+	}
+	return bytes;
+}
+
+void ir_free_alias_cache(ir_graph *irg)
+{
+	ir_alias_cache *cache = irg->alias_cache;
+	stat_ev_int("alias_cache_queries", cache->n_queries);
+	stat_ev_int("alias_cache_hits", cache->n_hits);
+	stat_ev_int("alias_cache_flushes", cache->n_flushes);
+	if (cache->n_queries > 0)
+		stat_ev_dbl("alias_cache_hit_rate",
+		            (double)cache->n_hits / cache->n_queries);
+
+	del_set(cache->queries);
+	if (cache->precompute) {
+		ir_nodemap_destroy(&cache->classes);
+		obstack_free(&cache->obst, NULL);
+	}
+	xfree(cache);
+	irg->alias_cache = NULL;
+}
+
+/**
+ * Hook: exchanging a data node may change an address computation, so the
+ * cache of the graph is flushed.
+ */
+static void alias_cache_replace(void *context, ir_node *old_node,
+                                ir_node *new_node)
+{
+	(void)context;
+	(void)new_node;
+	ir_alias_cache *cache = get_irn_irg(old_node)->alias_cache;
+	if (cache != NULL && mode_is_data(get_irn_mode(old_node)))
+		flush_alias_cache(cache);
+}
+
+static hook_entry_t alias_cache_hook;
+
 /**
  * Check the mode of a Load/Store with the mode of the entity
  * that is accessed.
@@ -675,6 +919,10 @@ static void analyse_irg_entity_usage(ir_graph *irg)
 		set_entity_usage(entity, (ir_entity_usage) flags);
 	}
 
+	/* the storage classes depend on the usage flags */
+	if (irg->alias_cache != NULL)
+		flush_alias_cache(irg->alias_cache);
+
 	/* now computed */
 	add_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_ENTITY_USAGE);
 }
@@ -884,6 +1132,17 @@ void firm_init_memory_disambiguator(void)
 {
 	FIRM_DBG_REGISTER(dbg, "firm.ana.irmemory");
 	FIRM_DBG_REGISTER(dbgcall, "firm.opt.cc");
+
+	memset(&alias_cache_hook, 0, sizeof(alias_cache_hook));
+	alias_cache_hook.hook._hook_replace = alias_cache_replace;
+	register_hook(hook_replace, &alias_cache_hook);
+	firm_init_memssa();
+}
+
+void firm_finish_memory_disambiguator(void)
+{
+	firm_finish_memssa();
+	unregister_hook(hook_replace, &alias_cache_hook);
 }
 
 /** Maps method types to cloned method types. */
@@ -12,13 +12,90 @@
 #ifndef FIRM_ANA_IRMEMORY_T_H
 #define FIRM_ANA_IRMEMORY_T_H
 
+#include <stddef.h>
+
 /**
  * One-time inititialization of the memory< disambiguator.
  */
 void firm_init_memory_disambiguator(void);
 
+/**
+ * Frees the memory disambiguator.
+ */
+void firm_finish_memory_disambiguator(void);
+
+/**
+ * Starts caching the results of get_alias_relation() for addresses in
+ * @p irg until ir_free_alias_cache() is called.
+ *
+ * The cache is flushed when a data node of the graph is exchanged or the
+ * entity usage is recomputed. Other changes of address computations, for
+ * example with set_irn_n(), must not happen while the cache is active.
+ * With aa_opt_precompute_addresses the address classes of all memory
+ * operations are computed here as well.
+ */
+void ir_init_alias_cache(ir_graph *irg);
+
+/**
+ * Stops caching alias queries for @p irg and reports the cache statistics.
+ */
+void ir_free_alias_cache(ir_graph *irg);
+
+/**
+ * Returns the number of bytes held by the alias cache of @p irg.
+ */
+size_t get_alias_cache_memory_used(ir_graph *irg);
+
 bool is_partly_volatile(ir_node *ptr);
 
+/**
+ * Returns the entity @p addr points into if the address of the entity is
+ * never taken otherwise, NULL if @p addr may point to any escaped memory.
+ *
+ * The results partition the memory: addresses with different results never
+ * alias.  These are the alias classes of the memory SSA.
+ */
+ir_entity *get_unaliased_entity(const ir_node *addr);
+
+/**
+ * Computes the memory SSA of @p irg until ir_free_memssa() is called.
+ *
+ * The memory SSA splits the memory chains into the alias classes of
+ * get_unaliased_entity() and links each memory node to the nearest memory
+ * operation above it which accesses a class.  The links are computed lazily
+ * and memorized, so following a memory chain through long sequences of
+ * accesses to other classes takes amortized constant time.
+ *
+ * The links are dropped when a memory node is exchanged or killed.  Other
+ * changes of memory edges, for example with set_irn_n(), must not happen
+ * while the memory SSA is active.
+ */
+void ir_init_memssa(ir_graph *irg);
+
+/**
+ * Stops the memory SSA of @p irg.
+ */
+void ir_free_memssa(ir_graph *irg);
+
+/**
+ * Returns the nearest memory operation at or above the memory operation
+ * @p node which may access memory of the alias class @p cls.  Operations
+ * other than Loads, Stores and CopyBs as well as volatile accesses are
+ * considered to access all classes.
+ *
+ * Without an active memory SSA @p node is returned.
+ */
+ir_node *ir_memssa_skip(ir_node *node, const ir_entity *cls);
+
+/**
+ * Returns the number of bytes held by the memory SSA of @p irg.
+ */
+size_t get_memssa_memory_used(ir_graph *irg);
+
+void firm_init_memssa(void);
+
+void firm_finish_memssa(void);
+
 /**
  * Classify storage locations.
  * Except ir_sc_pointer they are all disjoint.
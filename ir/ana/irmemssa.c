@@ -0,0 +1,204 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief    Memory SSA: memory chains split by alias classes.
+ *
+ * For each memory operation and alias class the nearest operation above it
+ * which may access the class is memorized.  Queries walk the memory chain
+ * only up to the first node with a memorized link, so every node is passed
+ * at most once per class until the links are flushed.
+ */
+#include <stdbool.h>
+
+#include "debug.h"
+#include "hashptr.h"
+#include "irgraph_t.h"
+#include "irhooks.h"
+#include "irmemory_t.h"
+#include "irnode_t.h"
+#include "set.h"
+#include "statev_t.h"
+#include "xmalloc.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** A memorized link of the memory SSA. */
+typedef struct memssa_link_t {
+	const ir_node   *node; /**< the memory operation */
+	const ir_entity *cls;  /**< the alias class */
+	ir_node         *def;  /**< the access to cls at or above node, NULL
+	                            while it is being computed */
+} memssa_link_t;
+
+/** The memory SSA of a graph. */
+struct ir_memssa {
+	set     *links;     /**< set of memssa_link_t */
+	unsigned n_queries; /**< number of queries */
+	unsigned n_steps;   /**< number of memory nodes passed */
+	unsigned n_flushes; /**< number of invalidations */
+};
+typedef struct ir_memssa ir_memssa;
+
+static int cmp_memssa_link(const void *elt, const void *key, size_t size)
+{
+	(void)size;
+	const memssa_link_t *l1 = (const memssa_link_t*)elt;
+	const memssa_link_t *l2 = (const memssa_link_t*)key;
+	return l1->node != l2->node || l1->cls != l2->cls;
+}
+
+static unsigned hash_memssa_link(const ir_node *node, const ir_entity *cls)
+{
+	return hash_combine(hash_irn(node), hash_ptr(cls));
+}
+
+static memssa_link_t *find_link(ir_memssa *memssa, const ir_node *node,
+                                const ir_entity *cls)
+{
+	memssa_link_t key = { .node = node, .cls = cls };
+	return set_find(memssa_link_t, memssa->links, &key, sizeof(key),
+	                hash_memssa_link(node, cls));
+}
+
+static memssa_link_t *insert_link(ir_memssa *memssa, const ir_node *node,
+                                  const ir_entity *cls)
+{
+	memssa_link_t key = { .node = node, .cls = cls, .def = NULL };
+	return set_insert(memssa_link_t, memssa->links, &key, sizeof(key),
+	                  hash_memssa_link(node, cls));
+}
+
+/**
+ * Returns whether @p address lies in the alias class @p cls.
+ */
+static bool in_class(const ir_node *address, const ir_entity *cls)
+{
+	return get_unaliased_entity(address) == cls;
+}
+
+/**
+ * Returns whether the memory operation @p node may access memory of the
+ * alias class @p cls.
+ */
+static bool accesses_class(const ir_node *node, const ir_entity *cls)
+{
+	switch (get_irn_opcode(node)) {
+	case iro_Load:
+		return get_Load_volatility(node) == volatility_is_volatile
+		    || in_class(get_Load_ptr(node), cls);
+	case iro_Store:
+		return get_Store_volatility(node) == volatility_is_volatile
+		    || in_class(get_Store_ptr(node), cls);
+	case iro_CopyB:
+		return get_CopyB_volatility(node) == volatility_is_volatile
+		    || in_class(get_CopyB_src(node), cls)
+		    || in_class(get_CopyB_dst(node), cls);
+	default:
+		return true;
+	}
+}
+
+ir_node *ir_memssa_skip(ir_node *node, const ir_entity *cls)
+{
+	ir_memssa *const memssa = get_irn_irg(node)->memssa;
+	if (memssa == NULL)
+		return node;
+	++memssa->n_queries;
+
+	/* Walk up to the next access or memorized link, inserting the links of
+	 * the passed nodes.  An unfinished link marks a cycle, which can only
+	 * occur in unreachable code. */
+	ir_node *start = node;
+	ir_node *def;
+	for (;;) {
+		memssa_link_t *const link = find_link(memssa, node, cls);
+		if (link != NULL) {
+			def = link->def != NULL ? link->def : node;
+			break;
+		}
+		if (accesses_class(node, cls)) {
+			def = node;
+			break;
+		}
+		insert_link(memssa, node, cls);
+		++memssa->n_steps;
+		node = skip_Proj(get_memop_mem(node));
+	}
+
+	for (ir_node *n = start; n != node; n = skip_Proj(get_memop_mem(n))) {
+		find_link(memssa, n, cls)->def = def;
+	}
+	DB((dbg, LEVEL_2, "memssa(%+F, %+F) = %+F\n", start, cls, def));
+	return def;
+}
+
+static void flush_memssa(ir_memssa *memssa)
+{
+	del_set(memssa->links);
+	memssa->links = new_set(cmp_memssa_link, 64);
+	++memssa->n_flushes;
+}
+
+void ir_init_memssa(ir_graph *irg)
+{
+	assert(irg->memssa == NULL);
+	ir_memssa *const memssa = XMALLOCZ(ir_memssa);
+	memssa->links = new_set(cmp_memssa_link, 64);
+	irg->memssa   = memssa;
+}
+
+void ir_free_memssa(ir_graph *irg)
+{
+	ir_memssa *const memssa = irg->memssa;
+	stat_ev_int("memssa_queries", memssa->n_queries);
+	stat_ev_int("memssa_steps", memssa->n_steps);
+	stat_ev_int("memssa_flushes", memssa->n_flushes);
+
+	del_set(memssa->links);
+	xfree(memssa);
+	irg->memssa = NULL;
+}
+
+size_t get_memssa_memory_used(ir_graph *irg)
+{
+	ir_memssa *const memssa = irg->memssa;
+	if (memssa == NULL)
+		return 0;
+	return sizeof(*memssa) + set_memory_used(memssa->links);
+}
+
+/**
+ * Hook: exchanging or killing a memory node or a memory operation changes
+ * the memory chains and exchanging an address may change its alias class,
+ * so the links of the graph are flushed.
+ */
+static void memssa_replace(void *context, ir_node *old_node, ir_node *new_node)
+{
+	(void)context;
+	(void)new_node;
+	ir_memssa *const memssa = get_irn_irg(old_node)->memssa;
+	if (memssa == NULL)
+		return;
+	ir_mode *const mode = get_irn_mode(old_node);
+	if (mode == mode_M || mode == mode_T || mode_is_reference(mode))
+		flush_memssa(memssa);
+}
+
+static hook_entry_t memssa_hook;
+
+void firm_init_memssa(void)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.ana.memssa");
+
+	memssa_hook.hook._hook_replace = memssa_replace;
+	register_hook(hook_replace, &memssa_hook);
+}
+
+void firm_finish_memssa(void)
+{
+	unregister_hook(hook_replace, &memssa_hook);
+}
@@ -9,6 +9,8 @@
  * @author   Goetz Lindenmaier, Michael Beck
  * @date     1.2002
  */
+#include <string.h>
+
 #include "xmalloc.h"
 #include "irouts_t.h"
 #include "irnode_t.h"
@@ -19,123 +21,87 @@
 
 unsigned get_irn_n_outs(const ir_node *node)
 {
-	return node->o.out->n_edges;
+	unsigned n_outs;
+	get_irn_out_edges(node, &n_outs);
+	return n_outs;
 }
 
 ir_node *get_irn_out(const ir_node *def, unsigned pos)
 {
-	assert(pos < get_irn_n_outs(def));
-	return def->o.out->edges[pos].use;
+	unsigned               n_outs;
+	ir_def_use_edge *const edges = get_irn_out_edges(def, &n_outs);
+	assert(pos < n_outs);
+	return edges[pos].use;
 }
 
 ir_node *get_irn_out_ex(const ir_node *def, unsigned pos, int *in_pos)
 {
-	assert(pos < get_irn_n_outs(def));
-	*in_pos = def->o.out->edges[pos].pos;
-	return def->o.out->edges[pos].use;
+	unsigned               n_outs;
+	ir_def_use_edge *const edges = get_irn_out_edges(def, &n_outs);
+	assert(pos < n_outs);
+	*in_pos = edges[pos].pos;
+	return edges[pos].use;
+}
+
+/**
+ * Returns the control flow successors of a block.  The successors reached by
+ * keep-alive edges come last and have position -1.
+ */
+static ir_def_use_edge *get_block_out_edges(const ir_node *block,
+                                            unsigned *n_outs)
+{
+	assert(is_Block(block));
+	return get_outs_edges(&get_irn_irg(block)->block_outs, block, n_outs);
+}
+
+/** Returns the number of control flow successors without keep-alives. */
+static unsigned count_cfg_outs(const ir_def_use_edge *edges, unsigned n_outs)
+{
+	while (n_outs > 0 && edges[n_outs - 1].pos < 0)
+		--n_outs;
+	return n_outs;
 }
 
 unsigned get_Block_n_cfg_outs(const ir_node *bl)
 {
-	assert(is_Block(bl));
-	unsigned n_cfg_outs = 0;
-	foreach_irn_out(bl, i, succ) {
-		if (get_irn_mode(succ) != mode_X)
-			continue;
-		if (is_End(succ) || is_Bad(succ))
-			continue;
-		n_cfg_outs += get_irn_n_outs(succ);
-	}
-	return n_cfg_outs;
+	unsigned               n_outs;
+	ir_def_use_edge *const edges = get_block_out_edges(bl, &n_outs);
+	return count_cfg_outs(edges, n_outs);
 }
 
 unsigned get_Block_n_cfg_outs_ka(const ir_node *bl)
 {
-	assert(is_Block(bl));
-	unsigned n_cfg_outs = 0;
-	foreach_irn_out(bl, i, succ) {
-		if (get_irn_mode(succ) != mode_X)
-			continue;
-		if (is_Bad(succ))
-			continue;
-		if (is_End(succ)) {
-			ir_node *end_bl = get_nodes_block(succ);
-			if (end_bl == bl)
-				continue;
-			++n_cfg_outs;
-			continue;
-		}
-		n_cfg_outs += get_irn_n_outs(succ);
-	}
-	return n_cfg_outs;
+	unsigned n_outs;
+	get_block_out_edges(bl, &n_outs);
+	return n_outs;
 }
 
 ir_node *get_Block_cfg_out(const ir_node *bl, unsigned pos)
 {
-	assert(is_Block(bl));
-	foreach_irn_out(bl, i, succ) {
-		if (get_irn_mode(succ) != mode_X)
-			continue;
-		if (is_End(succ) || is_Bad(succ))
-			continue;
-
-		unsigned n_outs = get_irn_n_outs(succ);
-		if (pos < n_outs)
-			return get_irn_out(succ, pos);
-		else
-			pos -= n_outs;
-	}
-	return NULL;
+	unsigned               n_outs;
+	ir_def_use_edge *const edges = get_block_out_edges(bl, &n_outs);
+	if (pos >= count_cfg_outs(edges, n_outs))
+		return NULL;
+	return edges[pos].use;
 }
 
 ir_node *get_Block_cfg_out_ex(const ir_node *bl, unsigned pos, int *in_pos)
 {
-	assert(is_Block(bl));
-	foreach_irn_out(bl, i, succ) {
-		if (get_irn_mode(succ) != mode_X)
-			continue;
-		if (is_End(succ) || is_Bad(succ))
-			continue;
-
-		unsigned n_outs = get_irn_n_outs(succ);
-		if (pos < n_outs)
-			return get_irn_out_ex(succ, pos, in_pos);
-		else
-			pos -= n_outs;
-	}
-	return NULL;
+	unsigned               n_outs;
+	ir_def_use_edge *const edges = get_block_out_edges(bl, &n_outs);
+	if (pos >= count_cfg_outs(edges, n_outs))
+		return NULL;
+	*in_pos = edges[pos].pos;
+	return edges[pos].use;
 }
 
 ir_node *get_Block_cfg_out_ka(const ir_node *bl, unsigned pos)
 {
-	assert(is_Block(bl));
-	foreach_irn_out(bl, i, succ) {
-		if (get_irn_mode(succ) != mode_X)
-			continue;
-		if (is_Bad(succ))
-			continue;
-
-		if (is_End(succ)) {
-			ir_node *end_bl = get_nodes_block(succ);
-			if (end_bl == bl) {
-				/* ignore End if we are in the Endblock */
-				continue;
-			}
-			if (pos == 0) {
-				/* handle keep-alive here: return the Endblock instead of the End node */
-				return end_bl;
-			} else {
-				--pos;
-				continue;
-			}
-		}
-		unsigned n_outs = get_irn_n_outs(succ);
-		if (pos < n_outs)
-			return get_irn_out(succ, pos);
-		else
-			pos -= n_outs;
-	}
-	return NULL;
+	unsigned               n_outs;
+	ir_def_use_edge *const edges = get_block_out_edges(bl, &n_outs);
+	if (pos >= n_outs)
+		return NULL;
+	return edges[pos].use;
 }
 
 static void irg_out_walk_2(ir_node *node, irg_walk_func *pre,
@@ -210,134 +176,216 @@ void irg_out_block_walk(ir_node *node, irg_walk_func *pre, irg_walk_func *post,
 /*--------------------------------------------------------------------*/
 /** Building and Removing the out data structure                     **/
 /**                                                                  **/
-/** The outs of a graph are allocated in a single, large array.      **/
-/** This allows to allocate and deallocate the memory for the outs   **/
-/** on demand.  The large array is separated into many small ones    **/
-/** for each node.  Only a single field to reference the out array   **/
-/** is stored in each node and a field referencing the large out     **/
-/** array in irgraph.  The 0 field of each out array contains the    **/
-/** size of this array.  This saves memory in the irnodes themselves.**/
+/** The outs of a graph are stored in compressed sparse row form: a  **/
+/** single array holds the edges of all nodes, and a second array    **/
+/** indexed by node index holds where the edges of each node start.  **/
 /** The construction does two passes over the graph.  The first pass **/
-/** counts the overall number of outs and the outs of each node.  It **/
-/** stores the outs of each node in the out reference of the node.   **/
-/** Then the large array is allocated.  The second iteration chops   **/
-/** the large array into smaller parts, sets the out edges and       **/
-/** recounts the out edges.                                          **/
+/** counts the outs of each node, the prefix sum of the counts gives  **/
+/** the start offsets.  The second pass fills in the edges.  The      **/
+/** arrays are kept when the outs are invalidated and reused by the   **/
+/** next computation.                                                **/
 /*--------------------------------------------------------------------*/
 
+/**
+ * Prepares the arrays of outs for a graph with n_nodes node indices and
+ * clears the counters.  During counting, the number of outs of the node with
+ * index i is accumulated in start[i + 2].
+ */
+static void init_outs(ir_outs_info *outs, unsigned n_nodes)
+{
+	if (outs->start_size < n_nodes + 2) {
+		outs->start_size = n_nodes + 2 + n_nodes / 4;
+		outs->start      = XREALLOC(outs->start, unsigned, outs->start_size);
+	}
+	memset(outs->start, 0, (n_nodes + 2) * sizeof(*outs->start));
+	outs->n_nodes = 0;
+}
+
+/**
+ * Turns the counts into start offsets and makes room for the edges.
+ * Afterwards start[i + 1] is the position of the next edge of the node with
+ * index i.
+ */
+static void alloc_out_edges(ir_outs_info *outs, unsigned n_nodes)
+{
+	unsigned *const start = outs->start;
+	for (unsigned i = 2; i < n_nodes + 2; ++i)
+		start[i] += start[i - 1];
+
+	unsigned const n_edges = start[n_nodes + 1];
+	if (outs->edges_size < n_edges) {
+		outs->edges_size = n_edges + n_edges / 4;
+		outs->edges      = XREALLOC(outs->edges, ir_def_use_edge,
+		                            outs->edges_size);
+	}
+}
+
+static void add_out_edge(ir_outs_info *outs, const ir_node *def, ir_node *use,
+                         int pos)
+{
+	unsigned const i = outs->start[get_irn_idx(def) + 1]++;
+	outs->edges[i].use = use;
+	outs->edges[i].pos = pos;
+}
 
-/** Returns the amount of out edges for not yet visited successors. */
-static void count_outs_node(ir_node *n)
+static void count_outs_node(ir_outs_info *outs, ir_node *n)
 {
 	if (irn_visited_else_mark(n))
 		return;
 
-	/* initialize our counter */
-	n->o.n_outs = 0;
-
 	int start = is_Block(n) ? 0 : -1;
 	for (int i = start, irn_arity = get_irn_arity(n); i < irn_arity; ++i) {
 		ir_node *def = get_irn_n(n, i);
-		count_outs_node(def);
-		++def->o.n_outs;
+		count_outs_node(outs, def);
+		++outs->start[get_irn_idx(def) + 2];
 	}
 }
 
-
-/** Returns the amount of out edges for not yet visited successors.
- *  This version handles some special nodes like irg_frame, irg_args etc. */
-static void count_outs(ir_graph *irg)
-{
-	inc_irg_visited(irg);
-	count_outs_node(get_irg_end(irg));
-	foreach_irn_in(get_irg_anchor(irg), i, n) {
-		if (irn_visited_else_mark(n))
-			continue;
-		n->o.n_outs = 0;
-	}
-}
-
-static void set_out_edges_node(ir_node *node, struct obstack *obst)
+static void set_out_edges_node(ir_outs_info *outs, ir_node *node)
 {
 	if (irn_visited_else_mark(node))
 		return;
 
-	/* Allocate my array */
-	unsigned n_outs = node->o.n_outs;
-	node->o.out          = OALLOCF(obst, ir_def_use_edges, edges, n_outs);
-	node->o.out->n_edges = 0;
-
 	/* add def->use edges from my predecessors to me */
 	int start = is_Block(node) ? 0 : -1;
 	for (int i = start, irn_arity = get_irn_arity(node); i < irn_arity; ++i) {
 		ir_node *def = get_irn_n(node, i);
+		set_out_edges_node(outs, def);
+		add_out_edge(outs, def, node, i);
+	}
+}
+
+/** Returns the block of the control flow predecessor pos or NULL. */
+static ir_node *get_cfgpred_block(const ir_node *block, int pos)
+{
+	ir_node *const pred = get_Block_cfgpred(block, pos);
+	if (is_Bad(pred))
+		return NULL;
+	ir_node *const pred_block = get_nodes_block(pred);
+	return is_Block(pred_block) ? pred_block : NULL;
+}
 
-		/* recurse, ensures that out array of pred is already allocated */
-		set_out_edges_node(def, obst);
+static void count_block_outs_node(ir_outs_info *outs, ir_node *block)
+{
+	if (irn_visited_else_mark(block))
+		return;
 
-		/* Remember this Def-Use edge */
-		unsigned pos = def->o.out->n_edges++;
-		def->o.out->edges[pos].use = node;
-		def->o.out->edges[pos].pos = i;
+	for (int i = 0, arity = get_Block_n_cfgpreds(block); i < arity; ++i) {
+		ir_node *const pred_block = get_cfgpred_block(block, i);
+		if (pred_block == NULL)
+			continue;
+		count_block_outs_node(outs, pred_block);
+		++outs->start[get_irn_idx(pred_block) + 2];
 	}
 }
 
-static void set_out_edges(ir_graph *irg)
+static void set_block_out_edges_node(ir_outs_info *outs, ir_node *block)
 {
-	struct obstack *obst = &irg->out_obst;
-	obstack_init(obst);
-	irg->out_obst_allocated = true;
+	if (irn_visited_else_mark(block))
+		return;
+
+	for (int i = 0, arity = get_Block_n_cfgpreds(block); i < arity; ++i) {
+		ir_node *const pred_block = get_cfgpred_block(block, i);
+		if (pred_block == NULL)
+			continue;
+		set_block_out_edges_node(outs, pred_block);
+		add_out_edge(outs, pred_block, block, i);
+	}
+}
 
+static void compute_block_outs(ir_graph *irg)
+{
+	ir_outs_info *const outs      = &irg->block_outs;
+	unsigned      const n_nodes   = get_irg_last_idx(irg);
+	ir_node      *const end       = get_irg_end(irg);
+	ir_node      *const end_block = get_irg_end_block(irg);
+	init_outs(outs, n_nodes);
+
+	/* Blocks only reachable through keep-alive edges are successors of the
+	 * End block, these edges are counted extra and come last. */
 	inc_irg_visited(irg);
-	set_out_edges_node(get_irg_end(irg), obst);
-	foreach_irn_in(get_irg_anchor(irg), i, n) {
-		if (irn_visited_else_mark(n))
+	count_block_outs_node(outs, end_block);
+	foreach_irn_in(end, i, ka) {
+		if (!is_Block(ka))
 			continue;
-		n->o.out          = OALLOCF(obst, ir_def_use_edges, edges, 0);
-		n->o.out->n_edges = 0;
+		count_block_outs_node(outs, ka);
+		if (ka != end_block)
+			++outs->start[get_irn_idx(ka) + 2];
 	}
+
+	alloc_out_edges(outs, n_nodes);
+
+	inc_irg_visited(irg);
+	set_block_out_edges_node(outs, end_block);
+	foreach_irn_in(end, i, ka) {
+		if (is_Block(ka))
+			set_block_out_edges_node(outs, ka);
+	}
+	foreach_irn_in(end, i, ka) {
+		if (is_Block(ka) && ka != end_block)
+			add_out_edge(outs, ka, end_block, -1);
+	}
+	outs->n_nodes = n_nodes;
+
+	add_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_BLOCK_OUTS);
 }
 
 void compute_irg_outs(ir_graph *irg)
 {
-	free_irg_outs(irg);
+	ir_analysis_start(IR_ANALYSIS_OUTS);
 
-	/* This first iteration counts the overall number of out edges and the
-	   number of out edges for each node. */
-	count_outs(irg);
+	/* This first iteration counts the number of out edges for each node. */
+	ir_outs_info *const outs    = &irg->outs;
+	unsigned      const n_nodes = get_irg_last_idx(irg);
+	init_outs(outs, n_nodes);
+	inc_irg_visited(irg);
+	count_outs_node(outs, get_irg_end(irg));
 
-	/* The second iteration splits the irg->outs array into smaller arrays
-	   for each node and writes the back edges into this array. */
-	set_out_edges(irg);
+	/* The second iteration writes the edges of each node into its range of
+	   the edge array. */
+	alloc_out_edges(outs, n_nodes);
+	inc_irg_visited(irg);
+	set_out_edges_node(outs, get_irg_end(irg));
+	outs->n_nodes = n_nodes;
 
 	add_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUTS);
+	ir_analysis_stop(IR_ANALYSIS_OUTS);
+
+	compute_irg_block_outs(irg);
 }
 
 void assure_irg_outs(ir_graph *irg)
 {
 	if (!irg_has_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUTS))
 		compute_irg_outs(irg);
+	else
+		ir_analysis_reused(IR_ANALYSIS_OUTS);
 }
 
-#ifdef DEBUG_libfirm
-/** Clear the outs of a node */
-static void reset_outs(ir_node *node, void *unused)
+void compute_irg_block_outs(ir_graph *irg)
 {
-	(void)unused;
-	node->o.out = NULL;
+	ir_analysis_start(IR_ANALYSIS_BLOCK_OUTS);
+	compute_block_outs(irg);
+	ir_analysis_stop(IR_ANALYSIS_BLOCK_OUTS);
 }
-#endif
 
-void free_irg_outs(ir_graph *irg)
+void assure_irg_block_outs(ir_graph *irg)
 {
-	if (irg->out_obst_allocated) {
-		obstack_free(&irg->out_obst, NULL);
-		irg->out_obst_allocated = false;
-	}
+	if (!irg_has_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_BLOCK_OUTS))
+		compute_irg_block_outs(irg);
+	else
+		ir_analysis_reused(IR_ANALYSIS_BLOCK_OUTS);
+}
 
-#ifdef DEBUG_libfirm
-	/* when debugging, *always* reset all nodes' outs!  irg->outs might
-	   have been lying to us */
-	irg_walk_graph(irg, reset_outs, NULL, NULL);
-#endif
+static void free_outs(ir_outs_info *outs)
+{
+	xfree(outs->start);
+	xfree(outs->edges);
+	memset(outs, 0, sizeof(*outs));
+}
+
+void free_irg_outs(ir_graph *irg)
+{
+	free_outs(&irg->outs);
+	free_outs(&irg->block_outs);
 }
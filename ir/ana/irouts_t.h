@@ -6,8 +6,39 @@
 #ifndef FIRM_ANA_IROUTS_T_H
 #define FIRM_ANA_IROUTS_T_H
 
+#include "irgraph_t.h"
+#include "irnode_t.h"
 #include "irouts.h"
 
+/**
+ * Returns the edges of node in the outs and stores their number in n_outs.
+ * Nodes created after the outs have been computed have no edges.
+ */
+static inline ir_def_use_edge *get_outs_edges(const ir_outs_info *outs,
+                                              const ir_node *node,
+                                              unsigned *n_outs)
+{
+	assert(outs->n_nodes != 0 && "outs not computed");
+	unsigned const idx = get_irn_idx(node);
+	if (idx >= outs->n_nodes) {
+		*n_outs = 0;
+		return NULL;
+	}
+	unsigned const begin = outs->start[idx];
+	*n_outs = outs->start[idx + 1] - begin;
+	return &outs->edges[begin];
+}
+
+/**
+ * Returns the Def-Use edges of node and stores their number in n_outs.  The
+ * edges may be reordered, but not added or removed.
+ */
+static inline ir_def_use_edge *get_irn_out_edges(const ir_node *node,
+                                                 unsigned *n_outs)
+{
+	return get_outs_edges(&get_irn_irg(node)->outs, node, n_outs);
+}
+
 #define foreach_irn_out(irn, idx, succ) \
 	for (bool succ##__b = true; succ##__b;) \
 		for (ir_node const *const succ##__irn = (irn); succ##__b; succ##__b = false) \
@@ -28,9 +28,20 @@ DEBUG_ONLY(static firm_dbg_module_t *dbg;)
 typedef struct vrp_env_t {
 	pdeq        *workqueue;
 	bitset_t    *visited;
+	bitset_t    *queued;    /**< nodes currently in the workqueue */
 	ir_vrp_info *info;
 } vrp_env_t;
 
+/** Add @p node to the workqueue unless it is already waiting there. */
+static void vrp_enqueue(vrp_env_t *env, ir_node *node)
+{
+	unsigned idx = get_irn_idx(node);
+	if (!bitset_is_set(env->queued, idx)) {
+		bitset_set(env->queued, idx);
+		pdeq_putr(env->workqueue, node);
+	}
+}
+
 static vrp_attr *vrp_get_or_set_info(ir_vrp_info *info, const ir_node *node)
 {
 	vrp_attr *attr = ir_nodemap_get(vrp_attr, &info->infos, node);
@@ -474,7 +485,7 @@ static void vrp_first_pass(ir_node *n, void *e)
 	foreach_irn_out_r(n, i, succ) {
 		if (bitset_is_set(env->visited, get_irn_idx(succ))) {
 			/* we found a loop*/
-			pdeq_putr(env->workqueue, succ);
+			vrp_enqueue(env, succ);
 		}
 	}
 }
@@ -522,20 +533,23 @@ void set_vrp_data(ir_graph *irg)
 	env->info      = info;
 
 	env->visited = bitset_malloc(get_irg_last_idx(irg));
+	env->queued  = bitset_malloc(get_irg_last_idx(irg));
 	irg_walk_graph(irg, NULL, vrp_first_pass, env);
-	free(env->visited);
+	xfree(env->visited);
 
 	/* while there are entries in the worklist, continue*/
 	while (!pdeq_empty(env->workqueue)) {
 		ir_node *node = (ir_node*) pdeq_getl(env->workqueue);
+		bitset_clear(env->queued, get_irn_idx(node));
 
 		if (vrp_update_node(info, node)) {
 			/* if something changed, add successors to worklist*/
 			foreach_irn_out_r(node, i, succ) {
-				pdeq_putr(env->workqueue, succ);
+				vrp_enqueue(env, succ);
 			}
 		}
 	}
+	xfree(env->queued);
 	del_pdeq(env->workqueue);
 }
 
@@ -0,0 +1,131 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   calling convention helpers
+ */
+#include "aarch64_cconv.h"
+
+#include "bearch_aarch64_t.h"
+#include "becconv.h"
+#include "beirg.h"
+#include "bitfiddle.h"
+#include "irmode_t.h"
+#include "panic.h"
+#include "typerep.h"
+#include "util.h"
+#include "xmalloc.h"
+
+static const unsigned ignore_regs[] = {
+	REG_X16,
+	REG_X17,
+	REG_X18,
+	REG_SP,
+	REG_NZCV,
+};
+
+static const arch_register_t* const gp_param_regs[] = {
+	&aarch64_registers[REG_X0],
+	&aarch64_registers[REG_X1],
+	&aarch64_registers[REG_X2],
+	&aarch64_registers[REG_X3],
+	&aarch64_registers[REG_X4],
+	&aarch64_registers[REG_X5],
+	&aarch64_registers[REG_X6],
+	&aarch64_registers[REG_X7],
+};
+
+static const arch_register_t* const float_param_regs[] = {
+	&aarch64_registers[REG_V0],
+	&aarch64_registers[REG_V1],
+	&aarch64_registers[REG_V2],
+	&aarch64_registers[REG_V3],
+	&aarch64_registers[REG_V4],
+	&aarch64_registers[REG_V5],
+	&aarch64_registers[REG_V6],
+	&aarch64_registers[REG_V7],
+};
+
+calling_convention_t *aarch64_decide_calling_convention(const ir_graph *irg,
+                                                        ir_type *function_type)
+{
+	if (irg != NULL && is_method_variadic(function_type))
+		panic("aarch64: variadic functions not supported yet");
+
+	/* determine how parameters are passed */
+	unsigned            stack_offset = 0;
+	size_t const        n_params     = get_method_n_params(function_type);
+	size_t              gp_regnum    = 0;
+	size_t              float_regnum = 0;
+	reg_or_stackslot_t *params       = XMALLOCNZ(reg_or_stackslot_t, n_params);
+
+	for (size_t i = 0; i < n_params; ++i) {
+		ir_type            *param_type = get_method_param_type(function_type,i);
+		ir_mode            *mode       = get_type_mode(param_type);
+		reg_or_stackslot_t *param      = &params[i];
+		param->type = param_type;
+		if (mode == NULL)
+			panic("aarch64: compound parameters not supported yet");
+
+		if (mode_is_float(mode) && float_regnum < ARRAY_SIZE(float_param_regs)) {
+			param->reg = float_param_regs[float_regnum++];
+		} else if (!mode_is_float(mode)
+		           && gp_regnum < ARRAY_SIZE(gp_param_regs)) {
+			param->reg = gp_param_regs[gp_regnum++];
+		} else {
+			/* every stack argument occupies an 8 byte slot */
+			param->offset = stack_offset;
+			stack_offset += 8;
+		}
+	}
+	unsigned const n_param_regs_used = gp_regnum + float_regnum;
+
+	size_t              n_results = get_method_n_ress(function_type);
+	reg_or_stackslot_t *results   = XMALLOCNZ(reg_or_stackslot_t, n_results);
+	gp_regnum    = 0;
+	float_regnum = 0;
+	for (size_t i = 0; i < n_results; ++i) {
+		ir_type            *result_type = get_method_res_type(function_type, i);
+		ir_mode            *result_mode = get_type_mode(result_type);
+		reg_or_stackslot_t *result      = &results[i];
+
+		if (mode_is_float(result_mode)) {
+			if (float_regnum >= ARRAY_SIZE(float_param_regs))
+				panic("too many float results");
+			result->reg = float_param_regs[float_regnum++];
+		} else {
+			if (gp_regnum >= ARRAY_SIZE(gp_param_regs))
+				panic("too many results");
+			result->reg = gp_param_regs[gp_regnum++];
+		}
+	}
+
+	calling_convention_t *cconv = XMALLOCZ(calling_convention_t);
+	cconv->parameters       = params;
+	cconv->n_parameters     = n_params;
+	cconv->param_stack_size = round_up2(stack_offset, 16);
+	cconv->n_param_regs     = n_param_regs_used;
+	cconv->results          = results;
+
+	/* setup allocatable registers */
+	if (irg != NULL) {
+		be_irg_t *birg = be_birg_from_irg(irg);
+
+		assert(birg->allocatable_regs == NULL);
+		birg->allocatable_regs = be_cconv_alloc_all_regs(&birg->obst, N_AARCH64_REGISTERS);
+		be_cconv_rem_regs(birg->allocatable_regs, ignore_regs, ARRAY_SIZE(ignore_regs));
+		aarch64_get_irg_data(irg)->omit_fp = true;
+	}
+
+	return cconv;
+}
+
+void aarch64_free_calling_convention(calling_convention_t *cconv)
+{
+	xfree(cconv->parameters);
+	xfree(cconv->results);
+	xfree(cconv);
+}
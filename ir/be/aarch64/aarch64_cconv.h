@@ -0,0 +1,49 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   support functions for the AAPCS64 calling convention
+ */
+#ifndef FIRM_BE_AARCH64_AARCH64_CCONV_H
+#define FIRM_BE_AARCH64_AARCH64_CCONV_H
+
+#include "firm_types.h"
+#include "be_types.h"
+#include "gen_aarch64_regalloc_if.h"
+
+/** information about a single parameter or result */
+typedef struct reg_or_stackslot_t
+{
+	const arch_register_t *reg;    /**< if != NULL, register used for this parameter. */
+	ir_type               *type;   /**< indicates that an entity of the specific type is needed */
+	unsigned               offset; /**< if transmitted via stack, the offset for this parameter. */
+	ir_entity             *entity; /**< entity in frame type */
+} reg_or_stackslot_t;
+
+/** The calling convention info for one call site. */
+typedef struct calling_convention_t
+{
+	reg_or_stackslot_t *parameters;        /**< parameter info. */
+	unsigned            n_parameters;      /**< number of parameters */
+	unsigned            param_stack_size;  /**< needed stack size for parameters */
+	unsigned            n_param_regs;      /**< number of registers used for parameters */
+	reg_or_stackslot_t *results;           /**< result info. */
+} calling_convention_t;
+
+/**
+ * determine how function parameters and return values are passed.
+ * Decides what goes to register or to stack and what stack offsets/
+ * datatypes are used.
+ */
+calling_convention_t *aarch64_decide_calling_convention(const ir_graph *irg,
+                                                        ir_type *function_type);
+
+/**
+ * free memory used by a calling_convention_t
+ */
+void aarch64_free_calling_convention(calling_convention_t *cconv);
+
+#endif
@@ -0,0 +1,676 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   AArch64 emitter
+ */
+#include "aarch64_emitter.h"
+
+#include <inttypes.h>
+
+#include "aarch64_cconv.h"
+#include "aarch64_new_nodes.h"
+#include "be_t.h"
+#include "bearch_aarch64_t.h"
+#include "beblocksched.h"
+#include "beemithlp.h"
+#include "beemitter.h"
+#include "begnuas.h"
+#include "benode.h"
+#include "besched.h"
+#include "bestack.h"
+#include "debug.h"
+#include "gen_aarch64_emitter.h"
+#include "gen_aarch64_regalloc_if.h"
+#include "iredges_t.h"
+#include "panic.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
+
+/** Label of the jump table which is currently emitted. */
+static unsigned switch_label;
+
+static void aarch64_emit_register(const arch_register_t *reg, unsigned bits)
+{
+	if (reg->cls == &aarch64_reg_classes[CLASS_aarch64_gp]) {
+		if (reg->encoding == 31) {
+			be_emit_string(bits == 64 ? "sp" : "wsp");
+			return;
+		}
+		be_emit_char(bits == 64 ? 'x' : 'w');
+	} else if (reg->cls == &aarch64_reg_classes[CLASS_aarch64_neon]) {
+		be_emit_char(bits == 64 ? 'd' : 's');
+	} else {
+		be_emit_string(reg->name);
+		return;
+	}
+	be_emit_uint(reg->encoding);
+}
+
+/** Returns the operation width of @p node, be nodes work on 64bit. */
+static unsigned get_node_bits(const ir_node *node)
+{
+	if (!is_aarch64_irn(node))
+		return 64;
+	return get_aarch64_attr_const(node)->bits;
+}
+
+static void aarch64_emit_source_register(const ir_node *node, int pos,
+                                         unsigned bits)
+{
+	const arch_register_t *reg = arch_get_irn_register_in(node, pos);
+	aarch64_emit_register(reg, bits);
+}
+
+static void aarch64_emit_dest_register(const ir_node *node, int pos,
+                                       unsigned bits)
+{
+	const arch_register_t *reg = arch_get_irn_register_out(node, pos);
+	aarch64_emit_register(reg, bits);
+}
+
+static char const *get_shift_name(aarch64_shift_t shift)
+{
+	switch (shift) {
+	case AARCH64_SHIFT_LSL: return "lsl";
+	case AARCH64_SHIFT_LSR: return "lsr";
+	case AARCH64_SHIFT_ASR: return "asr";
+	case AARCH64_SHIFT_ROR: return "ror";
+	}
+	panic("invalid shift %d", (int)shift);
+}
+
+static void aarch64_emit_operand(const ir_node *node)
+{
+	const aarch64_shifter_attr_t *attr = get_aarch64_shifter_attr_const(node);
+	unsigned const bits = attr->base.bits;
+	switch (attr->kind) {
+	case AARCH64_OPERAND_REG:
+		aarch64_emit_source_register(node, 1, bits);
+		return;
+	case AARCH64_OPERAND_IMM:
+		be_emit_irprintf("#%" PRIu64, attr->immediate);
+		if (attr->amount != 0)
+			be_emit_irprintf(", lsl #%u", (unsigned)attr->amount);
+		return;
+	case AARCH64_OPERAND_REG_SHIFT:
+		aarch64_emit_source_register(node, 1, bits);
+		be_emit_irprintf(", %s #%u", get_shift_name(attr->shift),
+		                 (unsigned)attr->amount);
+		return;
+	}
+	panic("invalid operand kind while emitting %+F", node);
+}
+
+static void aarch64_emit_address(const ir_node *node)
+{
+	const aarch64_address_attr_t *attr = get_aarch64_address_attr_const(node);
+	be_gas_emit_entity(attr->entity);
+	if (attr->offset != 0)
+		be_emit_irprintf("%+" PRId32, attr->offset);
+}
+
+static char const *get_cond_name(aarch64_cond_t cond)
+{
+	static char const *const names[] = {
+		"eq", "ne", "hs", "lo", "mi", "pl", "vs", "vc",
+		"hi", "ls", "ge", "lt", "gt", "le", "al",
+	};
+	assert((unsigned)cond < ARRAY_SIZE(names));
+	return names[cond];
+}
+
+static void aarch64_emit_extension_suffix(const ir_node *node)
+{
+	const aarch64_conv_attr_t *attr = get_aarch64_conv_attr_const(node);
+	switch (attr->src_bits) {
+	case  8: be_emit_char('b'); return;
+	case 16: be_emit_char('h'); return;
+	case 32: be_emit_char('w'); return;
+	}
+	panic("invalid extension in %+F", node);
+}
+
+/**
+ * Emit the target label for a control flow node.
+ */
+static void aarch64_emit_cfop_target(const ir_node *irn)
+{
+	ir_node *block = be_emit_get_cfop_target(irn);
+	be_gas_emit_block_name(block);
+}
+
+void aarch64_emitf(const ir_node *node, const char *format, ...)
+{
+	va_list ap;
+	va_start(ap, format);
+	be_emit_char('\t');
+	for (;;) {
+		const char *start = format;
+		while (*format != '%' && *format != '\n'  && *format != '\0')
+			++format;
+		be_emit_string_len(start, format - start);
+
+		if (*format == '\0')
+			break;
+
+		if (*format == '\n') {
+			++format;
+			be_emit_char('\n');
+			be_emit_write_line();
+			be_emit_char('\t');
+			continue;
+		}
+
+		++format;
+
+		unsigned bits = get_node_bits(node);
+		switch (*format) {
+		case 'X': bits = 64; ++format; break;
+		case 'W': bits = 32; ++format; break;
+		case 'F':
+			bits = get_aarch64_conv_attr_const(node)->src_bits;
+			++format;
+			break;
+		}
+
+		switch (*format++) {
+		case '%':
+			be_emit_char('%');
+			break;
+
+		case 'S': {
+			if (!is_digit(*format))
+				goto unknown;
+			unsigned const pos = *format++ - '0';
+			aarch64_emit_source_register(node, pos, bits);
+			break;
+		}
+
+		case 'D': {
+			if (!is_digit(*format))
+				goto unknown;
+			unsigned const pos = *format++ - '0';
+			aarch64_emit_dest_register(node, pos, bits);
+			break;
+		}
+
+		case 'O':
+			aarch64_emit_operand(node);
+			break;
+
+		case 'I':
+			aarch64_emit_address(node);
+			break;
+
+		case 'C':
+			be_emit_string(get_cond_name(get_aarch64_cond_attr_const(node)->cond));
+			break;
+
+		case 'i':
+			be_emit_irprintf("%" PRIu64, get_aarch64_imm_attr_const(node)->imm);
+			break;
+
+		case 'M':
+			aarch64_emit_extension_suffix(node);
+			break;
+
+		case 'u': {
+			unsigned num = va_arg(ap, unsigned);
+			be_emit_uint(num);
+			break;
+		}
+
+		case 'd': {
+			int num = va_arg(ap, int);
+			be_emit_int(num);
+			break;
+		}
+
+		case 's': {
+			const char *string = va_arg(ap, const char *);
+			be_emit_string(string);
+			break;
+		}
+
+		case 'r': {
+			arch_register_t *reg = va_arg(ap, arch_register_t*);
+			aarch64_emit_register(reg, 64);
+			break;
+		}
+
+		case 't': {
+			const ir_node *n = va_arg(ap, const ir_node*);
+			aarch64_emit_cfop_target(n);
+			break;
+		}
+
+		default:
+unknown:
+			panic("unknown format conversion");
+		}
+	}
+	va_end(ap);
+	be_emit_finish_line_gas(node);
+}
+
+static void emit_aarch64_mov_imm(const ir_node *node)
+{
+	const aarch64_imm_attr_t *attr = get_aarch64_imm_attr_const(node);
+	aarch64_mov_seq_t seq;
+	aarch64_get_mov_sequence(attr->imm, attr->base.bits, &seq);
+	for (unsigned i = 0; i < seq.n_insns; ++i) {
+		const aarch64_mov_insn_t *insn = &seq.insns[i];
+		char const *mnemonic;
+		switch (insn->kind) {
+		case AARCH64_MOV_ORR: {
+			char const *const zr = attr->base.bits == 64 ? "xzr" : "wzr";
+			be_emit_cstring("\torr ");
+			aarch64_emit_dest_register(node, 0, attr->base.bits);
+			be_emit_irprintf(", %s, #0x%" PRIx64, zr, insn->imm);
+			be_emit_finish_line_gas(node);
+			continue;
+		}
+		case AARCH64_MOVZ: mnemonic = "movz"; break;
+		case AARCH64_MOVN: mnemonic = "movn"; break;
+		case AARCH64_MOVK: mnemonic = "movk"; break;
+		default: panic("invalid mov kind");
+		}
+		if (insn->hw == 0) {
+			aarch64_emitf(node, "%s %D0, #%u", mnemonic, (unsigned)insn->imm);
+		} else {
+			aarch64_emitf(node, "%s %D0, #%u, lsl #%u", mnemonic,
+			              (unsigned)insn->imm, 16 * (unsigned)insn->hw);
+		}
+	}
+}
+
+static void emit_aarch64_uxt(const ir_node *node)
+{
+	const aarch64_conv_attr_t *attr = get_aarch64_conv_attr_const(node);
+	if (attr->src_bits == 32) {
+		/* writing a W register clears the upper half */
+		aarch64_emitf(node, "mov %WD0, %WS0");
+	} else {
+		aarch64_emitf(node, "uxt%M %WD0, %WS0");
+	}
+}
+
+static void emit_aarch64_FrameAddr(const ir_node *node)
+{
+	const aarch64_address_attr_t *attr = get_aarch64_address_attr_const(node);
+	if (attr->offset < 0 || attr->offset >= (1 << 24))
+		panic("frame offset of %+F out of range", node);
+	unsigned const lo = attr->offset & 0xFFF;
+	unsigned const hi = attr->offset >> 12;
+	if (hi != 0) {
+		aarch64_emitf(node, "add %D0, %S0, #%u, lsl #12", hi);
+		if (lo != 0)
+			aarch64_emitf(node, "add %D0, %D0, #%u", lo);
+	} else {
+		aarch64_emitf(node, "add %D0, %S0, #%u", lo);
+	}
+}
+
+static void emit_load_store(const ir_node *node, bool is_load)
+{
+	const aarch64_load_store_attr_t *attr
+		= get_aarch64_load_store_attr_const(node);
+	ir_mode *const mode   = attr->ls_mode;
+	unsigned const size   = get_mode_size_bytes(mode);
+	int32_t  const offset = attr->offset;
+	bool     const scaled = offset >= 0 && offset % size == 0
+	                     && offset / size < 4096;
+	if (!scaled && (offset < -256 || offset >= 256))
+		panic("offset %" PRId32 " of %+F not encodable", offset, node);
+
+	char const *mnemonic = is_load ? (scaled ? "ldr" : "ldur")
+	                               : (scaled ? "str" : "stur");
+	char const *suffix   = "";
+	if (!is_aarch64_fldr(node) && !is_aarch64_fstr(node)) {
+		bool const is_signed = is_load && mode_is_signed(mode);
+		if (size == 1)
+			suffix = is_signed ? "sb" : "b";
+		else if (size == 2)
+			suffix = is_signed ? "sh" : "h";
+	}
+
+	if (is_load) {
+		if (size == 8)
+			aarch64_emitf(node, "%s%s %XD0, [%S0, #%d]", mnemonic, suffix, (int)offset);
+		else
+			aarch64_emitf(node, "%s%s %WD0, [%S0, #%d]", mnemonic, suffix, (int)offset);
+	} else {
+		if (size == 8)
+			aarch64_emitf(node, "%s%s %XS1, [%S0, #%d]", mnemonic, suffix, (int)offset);
+		else
+			aarch64_emitf(node, "%s%s %WS1, [%S0, #%d]", mnemonic, suffix, (int)offset);
+	}
+}
+
+static void emit_aarch64_load(const ir_node *node)
+{
+	emit_load_store(node, true);
+}
+
+static void emit_aarch64_store(const ir_node *node)
+{
+	emit_load_store(node, false);
+}
+
+static void emit_aarch64_b_cond(const ir_node *node)
+{
+	const ir_node *proj_true  = get_Proj_for_pn(node, pn_aarch64_b_cond_true);
+	const ir_node *proj_false = get_Proj_for_pn(node, pn_aarch64_b_cond_false);
+	aarch64_cond_t cond = get_aarch64_cond_attr_const(node)->cond;
+
+	ir_node const *const block       = get_nodes_block(node);
+	ir_node const *const true_target = be_emit_get_cfop_target(proj_true);
+	if (be_emit_get_prev_block(true_target) == block) {
+		/* exchange both proj's so the second one can be omitted */
+		const ir_node *t = proj_true;
+
+		proj_true  = proj_false;
+		proj_false = t;
+		cond       = aarch64_negate_cond(cond);
+	}
+
+	/* emit the true proj */
+	aarch64_emitf(node, "b.%s %t", get_cond_name(cond), proj_true);
+
+	ir_node const *const false_target = be_emit_get_cfop_target(proj_false);
+	if (be_emit_get_prev_block(false_target) == block) {
+		if (be_options.verbose_asm)
+			aarch64_emitf(node, "/* fallthrough to %t */", proj_false);
+	} else {
+		aarch64_emitf(node, "b %t", proj_false);
+	}
+}
+
+static void emit_aarch64_b(const ir_node *node)
+{
+	ir_node const *const block  = get_nodes_block(node);
+	ir_node const *const target = be_emit_get_cfop_target(node);
+	if (be_emit_get_prev_block(target) != block) {
+		aarch64_emitf(node, "b %t", node);
+	} else if (be_options.verbose_asm) {
+		aarch64_emitf(node, "/* fallthrough to %t */", node);
+	}
+}
+
+/**
+ * Returns a unique label. This number will not be used a second time.
+ */
+static unsigned get_unique_label(void)
+{
+	static unsigned id = 0;
+	return ++id;
+}
+
+static void emit_jumptable_target(ir_entity const *const table,
+                                  ir_node const *const proj_x)
+{
+	(void)table;
+	aarch64_emit_cfop_target(proj_x);
+	be_emit_irprintf(" - %sT%u", be_gas_get_private_prefix(), switch_label);
+}
+
+static void emit_aarch64_switch_jmp(const ir_node *node)
+{
+	/* the table holds the targets relative to its start */
+	char const *const prefix = be_gas_get_private_prefix();
+	switch_label = get_unique_label();
+	aarch64_emitf(node, "adr x16, %sT%u", prefix, switch_label);
+	aarch64_emitf(node, "ldrsw x17, [x16, %WS0, uxtw #2]");
+	aarch64_emitf(node, "add x16, x16, x17");
+	aarch64_emitf(node, "br x16");
+	be_emit_irprintf("%sT%u:\n", prefix, switch_label);
+	be_emit_write_line();
+
+	const aarch64_switch_jmp_attr_t *attr
+		= get_aarch64_switch_jmp_attr_const(node);
+	be_emit_jump_table(node, attr->table, NULL, mode_Iu, emit_jumptable_target);
+}
+
+static void emit_add_sub_imm(const ir_node *node, char const *op,
+                             unsigned value)
+{
+	if (value >= (1u << 24))
+		panic("offset of %+F out of range", node);
+	unsigned const lo = value & 0xFFF;
+	unsigned const hi = value >> 12;
+	if (hi != 0) {
+		aarch64_emitf(node, "%s %D0, %S0, #%u, lsl #12", op, hi);
+		if (lo != 0)
+			aarch64_emitf(node, "%s %D0, %D0, #%u", op, lo);
+	} else {
+		aarch64_emitf(node, "%s %D0, %S0, #%u", op, lo);
+	}
+}
+
+/** Emit an IncSP node */
+static void emit_be_IncSP(const ir_node *node)
+{
+	int const offset = be_get_IncSP_offset(node);
+	if (offset > 0)
+		emit_add_sub_imm(node, "sub", (unsigned)offset);
+	else if (offset < 0)
+		emit_add_sub_imm(node, "add", (unsigned)-offset);
+}
+
+static void emit_be_Copy(const ir_node *node)
+{
+	arch_register_t const *const out = arch_get_irn_register_out(node, 0);
+	if (arch_get_irn_register_in(node, 0) == out) {
+		/* omitted Copy */
+		return;
+	}
+
+	arch_register_class_t const *const cls = out->cls;
+	if (cls == &aarch64_reg_classes[CLASS_aarch64_gp]) {
+		aarch64_emitf(node, "mov %D0, %S0");
+	} else if (cls == &aarch64_reg_classes[CLASS_aarch64_neon]) {
+		aarch64_emitf(node, "fmov %D0, %S0");
+	} else {
+		panic("move not supported for this register class");
+	}
+}
+
+static void emit_be_Perm(const ir_node *node)
+{
+	arch_register_t const *const reg0 = arch_get_irn_register_out(node, 0);
+	arch_register_t const *const reg1 = arch_get_irn_register_out(node, 1);
+	if (reg0->cls == &aarch64_reg_classes[CLASS_aarch64_gp]) {
+		aarch64_emitf(node,
+			"eor %D0, %D0, %D1\n"
+			"eor %D1, %D0, %D1\n"
+			"eor %D0, %D0, %D1");
+	} else if (reg0->cls == &aarch64_reg_classes[CLASS_aarch64_neon]) {
+		unsigned const r0 = reg0->encoding;
+		unsigned const r1 = reg1->encoding;
+		aarch64_emitf(node,
+			"eor v%u.16b, v%u.16b, v%u.16b\n"
+			"eor v%u.16b, v%u.16b, v%u.16b\n"
+			"eor v%u.16b, v%u.16b, v%u.16b",
+			r0, r0, r1, r1, r0, r1, r0, r0, r1);
+	} else {
+		panic("unexpected register class in %+F", node);
+	}
+}
+
+int aarch64_get_MemPerm_entity_offset(const ir_node *node, ir_entity *entity)
+{
+	ir_graph          *irg       = get_irn_irg(node);
+	be_stack_layout_t *layout    = be_get_irg_stack_layout(irg);
+	ir_entity         *ent_ref   = be_get_MemPerm_in_entity(node, 0);
+	int const          off_ent   = be_get_stack_entity_offset(layout, entity, 0);
+	int const          off_ref   = be_get_stack_entity_offset(layout, ent_ref, 0);
+	return be_get_MemPerm_offset(node) + off_ent - off_ref;
+}
+
+static void emit_be_MemPerm(const ir_node *node)
+{
+	/* TODO: this implementation is slower than necessary.
+	   The longterm goal is however to avoid the memperm node completely */
+
+	int memperm_arity = be_get_MemPerm_entity_arity(node);
+	if (memperm_arity > 16)
+		panic("memperm with more than 16 inputs not supported yet");
+
+	int sp_change = 0;
+	for (int i = 0; i < memperm_arity; ++i) {
+		/* spill register */
+		aarch64_emitf(node, "str x%d, [sp, #-16]!", i);
+		sp_change += 16;
+		/* load from entity */
+		ir_entity *entity = be_get_MemPerm_in_entity(node, i);
+		int        offset = aarch64_get_MemPerm_entity_offset(node, entity)
+		                  + sp_change;
+		aarch64_emitf(node, "ldr x%d, [sp, #%d]", i, offset);
+	}
+
+	for (int i = memperm_arity; i-- > 0; ) {
+		/* store to new entity */
+		ir_entity *entity = be_get_MemPerm_out_entity(node, i);
+		int        offset = aarch64_get_MemPerm_entity_offset(node, entity)
+		                  + sp_change;
+		aarch64_emitf(node, "str x%d, [sp, #%d]", i, offset);
+		/* restore register */
+		aarch64_emitf(node, "ldr x%d, [sp], #16", i);
+		sp_change -= 16;
+	}
+	assert(sp_change == 0);
+}
+
+/**
+ * Enters the emitter functions for handled nodes into the generic
+ * pointer of an opcode.
+ */
+static void aarch64_register_emitters(void)
+{
+	be_init_emitters();
+
+	/* register all emitter functions defined in spec */
+	aarch64_register_spec_emitters();
+
+	/* custom emitter */
+	be_set_emitter(op_aarch64_b,          emit_aarch64_b);
+	be_set_emitter(op_aarch64_b_cond,     emit_aarch64_b_cond);
+	be_set_emitter(op_aarch64_fldr,       emit_aarch64_load);
+	be_set_emitter(op_aarch64_FrameAddr,  emit_aarch64_FrameAddr);
+	be_set_emitter(op_aarch64_fstr,       emit_aarch64_store);
+	be_set_emitter(op_aarch64_ldr,        emit_aarch64_load);
+	be_set_emitter(op_aarch64_mov_imm,    emit_aarch64_mov_imm);
+	be_set_emitter(op_aarch64_str,        emit_aarch64_store);
+	be_set_emitter(op_aarch64_switch_jmp, emit_aarch64_switch_jmp);
+	be_set_emitter(op_aarch64_uxt,        emit_aarch64_uxt);
+	be_set_emitter(op_be_Copy,            emit_be_Copy);
+	be_set_emitter(op_be_CopyKeep,        emit_be_Copy);
+	be_set_emitter(op_be_IncSP,           emit_be_IncSP);
+	be_set_emitter(op_be_MemPerm,         emit_be_MemPerm);
+	be_set_emitter(op_be_Perm,            emit_be_Perm);
+}
+
+/**
+ * emit the block label if needed.
+ */
+static void aarch64_emit_block_header(ir_node *block)
+{
+	int  n_cfgpreds = get_Block_n_cfgpreds(block);
+	bool need_label;
+	if (n_cfgpreds == 1) {
+		const ir_node *pred       = get_Block_cfgpred(block, 0);
+		const ir_node *pred_block = get_nodes_block(pred);
+
+		/* we don't need labels for fallthrough blocks, however switch-jmps
+		 * are no fallthroughs */
+		need_label =
+			pred_block != be_emit_get_prev_block(block) ||
+			(is_Proj(pred) && is_aarch64_switch_jmp(get_Proj_pred(pred)));
+	} else {
+		need_label = true;
+	}
+
+	be_gas_begin_block(block, need_label);
+}
+
+/**
+ * Walks over the nodes in a block connected by scheduling edges
+ * and emits code for each node.
+ */
+static void aarch64_gen_block(ir_node *block)
+{
+	aarch64_emit_block_header(block);
+	be_dwarf_location(get_irn_dbg_info(block));
+	sched_foreach(block, irn) {
+		be_emit_node(irn);
+	}
+}
+
+static parameter_dbg_info_t *construct_parameter_infos(ir_graph *irg)
+{
+	ir_entity            *entity   = get_irg_entity(irg);
+	ir_type              *type     = get_entity_type(entity);
+	calling_convention_t *cconv    = aarch64_decide_calling_convention(NULL, type);
+	size_t                n_params = cconv->n_parameters;
+	parameter_dbg_info_t *infos    = XMALLOCNZ(parameter_dbg_info_t, n_params);
+
+	for (size_t i = 0; i < n_params; ++i) {
+		const reg_or_stackslot_t *slot = &cconv->parameters[i];
+
+		assert(infos[i].entity == NULL && infos[i].reg == NULL);
+		if (slot->reg != NULL) {
+			infos[i].reg = slot->reg;
+		} else {
+			infos[i].entity = slot->entity;
+		}
+	}
+	aarch64_free_calling_convention(cconv);
+
+	return infos;
+}
+
+static void emit_function_text(ir_graph *irg)
+{
+	aarch64_register_emitters();
+
+	/* create the block schedule */
+	ir_node **blk_sched = be_create_block_schedule(irg);
+
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+
+	be_emit_init_cf_links(blk_sched);
+
+	for (size_t i = 0, n = ARR_LEN(blk_sched); i < n; ++i) {
+		ir_node *block = blk_sched[i];
+		aarch64_gen_block(block);
+	}
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+}
+
+void aarch64_emit_function(ir_graph *irg)
+{
+	ir_entity            *const entity = get_irg_entity(irg);
+	parameter_dbg_info_t *const infos  = construct_parameter_infos(irg);
+	be_gas_emit_function_prolog(entity, 4, infos);
+	xfree(infos);
+
+	if (aarch64_emit_machcode) {
+		/* For debugging we can jit the code and output it embedded into a
+		 * normal .s file with .inst directives etc. */
+		aarch64_emit_machcode_function(irg);
+	} else {
+		emit_function_text(irg);
+	}
+
+	be_gas_emit_function_epilog(entity);
+}
+
+void aarch64_init_emitter(void)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.be.aarch64.emit");
+}
@@ -0,0 +1,53 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   declarations for AArch64 emitter
+ */
+#ifndef FIRM_BE_AARCH64_AARCH64_EMITTER_H
+#define FIRM_BE_AARCH64_AARCH64_EMITTER_H
+
+#include "aarch64_encode.h"
+#include "bejit.h"
+#include "firm_types.h"
+
+/**
+ * emit assembler instructions with format string. Automatically indents
+ * instructions and adds debug comments at the end (in verbose-asm mode).
+ * Registers are printed with the width of the node, which can be overridden
+ * by a X (64bit), W (32bit) or F (width of the conversion source) modifier.
+ * Format specifiers:
+ *
+ * fmt  parameter               output
+ * ---- ----------------------  ---------------------------------------------
+ * %%                           %
+ * %r   const arch_register_t*  register (64bit)
+ * %Sx  <node>                  source register x
+ * %Dx  <node>                  destination register x
+ * %O   <node>                  second operand (register, immediate, shift)
+ * %I   <node>                  address entity and offset
+ * %C   <node>                  condition code
+ * %i   <node>                  immediate
+ * %M   <node>                  b/h/w suffix of an extension
+ * %t   const ir_node*          controlflow target
+ * %s   const char*             string
+ * %u   unsigned int            unsigned int
+ * %d   signed int              signed int
+ */
+void aarch64_emitf(const ir_node *node, const char *format, ...);
+
+/**
+ * Returns the stack pointer relative offset of @p entity accessed by the
+ * MemPerm @p node.
+ */
+int aarch64_get_MemPerm_entity_offset(const ir_node *node,
+                                      ir_entity *entity);
+
+void aarch64_emit_function(ir_graph *irg);
+
+void aarch64_init_emitter(void);
+
+#endif
@@ -0,0 +1,970 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       AArch64 binary encoding
+ */
+#include "aarch64_encode.h"
+
+#include <inttypes.h>
+#include <string.h>
+#include "aarch64_emitter.h"
+#include "aarch64_new_nodes.h"
+#include "bearch_aarch64_t.h"
+#include "beblocksched.h"
+#include "beemithlp.h"
+#include "beemitter.h"
+#include "begnuas.h"
+#include "bejit.h"
+#include "benode.h"
+#include "besched.h"
+#include "bitfiddle.h"
+#include "gen_aarch64_emitter.h"
+#include "gen_aarch64_regalloc_if.h"
+#include "iredges_t.h"
+#include "irnodehashmap.h"
+#include "panic.h"
+#include "tv.h"
+#include "util.h"
+
+static ir_nodehashmap_t block_fragmentnum;
+
+/** The sf bit selecting the 64bit variant of an instruction. */
+#define SF (UINT32_C(1) << 31)
+
+/** Register number of sp (or the zero register, depending on the field). */
+#define REG_31 31u
+
+/** Scratch registers, which are reserved for the backend. */
+#define REG_IP0 16u
+#define REG_IP1 17u
+
+static uint64_t get_bitmask(unsigned const bits)
+{
+	return bits == 64 ? ~UINT64_C(0) : (UINT64_C(1) << bits) - 1;
+}
+
+static uint64_t ror(uint64_t const value, unsigned const amount,
+                    unsigned const size)
+{
+	if (amount == 0)
+		return value;
+	return ((value >> amount) | (value << (size - amount))) & get_bitmask(size);
+}
+
+bool aarch64_encode_logical_imm(uint64_t value, unsigned const bits,
+                                uint32_t *const enc)
+{
+	if (bits == 32) {
+		value &= 0xFFFFFFFF;
+		value |= value << 32;
+	}
+	if (value == 0 || value == ~UINT64_C(0))
+		return false;
+
+	/* determine the smallest repeating element */
+	unsigned size = 64;
+	while (size > 2) {
+		unsigned const half = size / 2;
+		uint64_t const mask = get_bitmask(half);
+		if ((value & mask) != ((value >> half) & mask))
+			break;
+		size = half;
+	}
+
+	/* the element must be a rotated run of ones */
+	uint64_t const elem = value & get_bitmask(size);
+	for (unsigned r = 0; r < size; ++r) {
+		uint64_t const rotated = ror(elem, r, size);
+		/* a run of ones starting at bit 0 */
+		if ((rotated & (rotated + 1)) != 0)
+			continue;
+		unsigned const ones = popcount((uint32_t)rotated)
+		                    + popcount((uint32_t)(rotated >> 32));
+		uint32_t const immr = (size - r) % size;
+		uint32_t const imms = ((~(size - 1) << 1) | (ones - 1)) & 0x3F;
+		uint32_t const n    = size == 64;
+		*enc = n << 12 | immr << 6 | imms;
+		return true;
+	}
+	return false;
+}
+
+bool aarch64_encode_arith_imm(uint64_t const value, uint64_t *const imm,
+                              unsigned *const shift)
+{
+	if (value < 4096) {
+		*imm   = value;
+		*shift = 0;
+		return true;
+	}
+	if ((value & 0xFFF) == 0 && value < (UINT64_C(4096) << 12)) {
+		*imm   = value >> 12;
+		*shift = 12;
+		return true;
+	}
+	return false;
+}
+
+bool aarch64_is_load_store_offset(int64_t const offset, unsigned const size)
+{
+	if (offset >= 0 && offset % size == 0 && offset / size < 4096)
+		return true;
+	return -256 <= offset && offset < 256;
+}
+
+void aarch64_get_mov_sequence(uint64_t value, unsigned const bits,
+                              aarch64_mov_seq_t *const seq)
+{
+	value &= get_bitmask(bits);
+
+	unsigned const n_hw    = bits / 16;
+	unsigned       n_zero  = 0;
+	unsigned       n_ones  = 0;
+	for (unsigned hw = 0; hw < n_hw; ++hw) {
+		uint16_t const h = (uint16_t)(value >> (16 * hw));
+		if (h == 0)
+			++n_zero;
+		else if (h == 0xFFFF)
+			++n_ones;
+	}
+
+	seq->n_insns = 0;
+	uint32_t enc;
+	if (n_hw - MAX(n_zero, n_ones) > 1
+	 && aarch64_encode_logical_imm(value, bits, &enc)) {
+		seq->insns[seq->n_insns++] = (aarch64_mov_insn_t){
+			AARCH64_MOV_ORR, 0, value
+		};
+		return;
+	}
+
+	/* start with movn if that leaves fewer halfwords to patch */
+	bool     const inverted = n_ones > n_zero;
+	uint16_t const skip     = inverted ? 0xFFFF : 0;
+	for (unsigned hw = 0; hw < n_hw; ++hw) {
+		uint16_t const h = (uint16_t)(value >> (16 * hw));
+		if (h == skip)
+			continue;
+		aarch64_mov_insn_t insn;
+		if (seq->n_insns != 0)
+			insn = (aarch64_mov_insn_t){ AARCH64_MOVK, hw, h };
+		else if (inverted)
+			insn = (aarch64_mov_insn_t){ AARCH64_MOVN, hw, (uint16_t)~h };
+		else
+			insn = (aarch64_mov_insn_t){ AARCH64_MOVZ, hw, h };
+		seq->insns[seq->n_insns++] = insn;
+	}
+	if (seq->n_insns == 0) {
+		aarch64_mov_kind_t const kind = inverted ? AARCH64_MOVN : AARCH64_MOVZ;
+		seq->insns[seq->n_insns++] = (aarch64_mov_insn_t){ kind, 0, 0 };
+	}
+}
+
+static uint32_t get_sf(ir_node const *const node)
+{
+	return get_aarch64_attr_const(node)->bits == 64 ? SF : 0;
+}
+
+static uint32_t get_in(ir_node const *const node, unsigned const pos)
+{
+	return arch_get_irn_register_in(node, pos)->encoding;
+}
+
+static uint32_t get_out(ir_node const *const node, unsigned const pos)
+{
+	return arch_get_irn_register_out(node, pos)->encoding;
+}
+
+/** Returns the destination register, flag results use the zero register. */
+static uint32_t get_rd(ir_node const *const node)
+{
+	arch_register_t const *const reg = arch_get_irn_register_out(node, 0);
+	if (reg->cls == &aarch64_reg_classes[CLASS_aarch64_flags])
+		return REG_31;
+	return reg->encoding;
+}
+
+static void enc_mov_insn(aarch64_mov_insn_t const *const insn, uint32_t const sf,
+                         uint32_t const rd)
+{
+	switch (insn->kind) {
+	case AARCH64_MOV_ORR: {
+		uint32_t enc;
+		bool const ok = aarch64_encode_logical_imm(insn->imm, sf ? 64 : 32,
+		                                           &enc);
+		assert(ok);
+		(void)ok;
+		be_emit32(0x32000000 | sf | enc << 10 | REG_31 << 5 | rd);
+		return;
+	}
+	case AARCH64_MOVZ:
+	case AARCH64_MOVN:
+	case AARCH64_MOVK: {
+		static uint32_t const opcodes[] = {
+			[AARCH64_MOVZ] = 0x52800000,
+			[AARCH64_MOVN] = 0x12800000,
+			[AARCH64_MOVK] = 0x72800000,
+		};
+		be_emit32(opcodes[insn->kind] | sf | (uint32_t)insn->hw << 21
+		          | (uint32_t)insn->imm << 5 | rd);
+		return;
+	}
+	}
+	panic("invalid mov kind");
+}
+
+/** Encodes add or sub of an immediate, which may exceed 12 bits. */
+static void enc_add_sub_imm(uint32_t const opcode, uint32_t const rd,
+                            uint32_t const rn, uint32_t const value)
+{
+	if (value >= (UINT32_C(1) << 24))
+		panic("offset %"PRIu32" too large", value);
+	uint32_t const lo = value & 0xFFF;
+	uint32_t const hi = value >> 12;
+	if (hi != 0) {
+		be_emit32(opcode | 1u << 22 | hi << 10 | rn << 5 | rd);
+		if (lo == 0)
+			return;
+		be_emit32(opcode | lo << 10 | rd << 5 | rd);
+	} else {
+		be_emit32(opcode | lo << 10 | rn << 5 | rd);
+	}
+}
+
+void aarch64_enc_logical(ir_node const *const node, uint32_t const op_reg,
+                         uint32_t const op_imm)
+{
+	aarch64_shifter_attr_t const *const attr
+		= get_aarch64_shifter_attr_const(node);
+	uint32_t const sf = get_sf(node);
+	uint32_t const rd = get_rd(node);
+	uint32_t const rn = get_in(node, 0);
+	switch (attr->kind) {
+	case AARCH64_OPERAND_IMM: {
+		uint32_t enc;
+		if (!aarch64_encode_logical_imm(attr->immediate, attr->base.bits, &enc))
+			panic("invalid logical immediate in %+F", node);
+		be_emit32(op_imm | sf | enc << 10 | rn << 5 | rd);
+		return;
+	}
+	case AARCH64_OPERAND_REG:
+		be_emit32(op_reg | sf | get_in(node, 1) << 16 | rn << 5 | rd);
+		return;
+	case AARCH64_OPERAND_REG_SHIFT:
+		be_emit32(op_reg | sf | (uint32_t)attr->shift << 22
+		          | get_in(node, 1) << 16 | (uint32_t)attr->amount << 10
+		          | rn << 5 | rd);
+		return;
+	}
+	panic("invalid operand kind in %+F", node);
+}
+
+void aarch64_enc_dp2(ir_node const *const node, uint32_t const opcode)
+{
+	be_emit32(opcode | get_sf(node) | get_in(node, 1) << 16
+	          | get_in(node, 0) << 5 | get_rd(node));
+}
+
+void aarch64_enc_dp3(ir_node const *const node, uint32_t const opcode)
+{
+	uint32_t ra = 0;
+	if (get_irn_arity(node) > 2)
+		ra = get_in(node, 2) << 10;
+	be_emit32(opcode | get_sf(node) | get_in(node, 1) << 16 | ra
+	          | get_in(node, 0) << 5 | get_rd(node));
+}
+
+void aarch64_enc_unop(ir_node const *const node, uint32_t const opcode,
+                      unsigned const src_shift)
+{
+	be_emit32(opcode | get_sf(node) | get_in(node, 0) << src_shift
+	          | get_rd(node));
+}
+
+static uint32_t get_fp_type(unsigned const bits)
+{
+	return bits == 64 ? 1u << 22 : 0;
+}
+
+void aarch64_enc_fp(ir_node const *const node, uint32_t const opcode)
+{
+	uint32_t rm = 0;
+	if (get_irn_arity(node) > 1)
+		rm = get_in(node, 1) << 16;
+	be_emit32(opcode | get_fp_type(get_aarch64_attr_const(node)->bits) | rm
+	          | get_in(node, 0) << 5 | get_rd(node));
+}
+
+void aarch64_enc_fcvt_int(ir_node const *const node, uint32_t const opcode)
+{
+	aarch64_conv_attr_t const *const attr = get_aarch64_conv_attr_const(node);
+	arch_register_t     const *const out  = arch_get_irn_register_out(node, 0);
+	unsigned int_bits = attr->base.bits;
+	unsigned fp_bits  = attr->src_bits;
+	if (out->cls != &aarch64_reg_classes[CLASS_aarch64_gp]) {
+		int_bits = attr->src_bits;
+		fp_bits  = attr->base.bits;
+	}
+	uint32_t const sf = int_bits == 64 ? SF : 0;
+	be_emit32(opcode | sf | get_fp_type(fp_bits) | get_in(node, 0) << 5
+	          | out->encoding);
+}
+
+/**
+ * Encodes add, sub, cmp and cmn.  sp can only be used with immediates and the
+ * extended register form.
+ */
+static void enc_arith(ir_node const *const node, uint32_t const op_reg,
+                      uint32_t const op_imm)
+{
+	aarch64_shifter_attr_t const *const attr
+		= get_aarch64_shifter_attr_const(node);
+	uint32_t const sf = get_sf(node);
+	uint32_t const rd = get_rd(node);
+	uint32_t const rn = get_in(node, 0);
+	switch (attr->kind) {
+	case AARCH64_OPERAND_IMM: {
+		uint32_t const sh = attr->amount == 12 ? 1u << 22 : 0;
+		be_emit32(op_imm | sf | sh | (uint32_t)attr->immediate << 10
+		          | rn << 5 | rd);
+		return;
+	}
+	case AARCH64_OPERAND_REG: {
+		uint32_t const rm = get_in(node, 1);
+		bool const is_cmp = arch_get_irn_register_out(node, 0)->cls
+		                 == &aarch64_reg_classes[CLASS_aarch64_flags];
+		if (rn == REG_31 || (!is_cmp && rd == REG_31)) {
+			/* extended register with uxtx/uxtw */
+			uint32_t const option = sf ? 3 : 2;
+			be_emit32(op_reg | 0x00200000 | sf | rm << 16 | option << 13
+			          | rn << 5 | rd);
+		} else {
+			be_emit32(op_reg | sf | rm << 16 | rn << 5 | rd);
+		}
+		return;
+	}
+	case AARCH64_OPERAND_REG_SHIFT:
+		be_emit32(op_reg | sf | (uint32_t)attr->shift << 22
+		          | get_in(node, 1) << 16 | (uint32_t)attr->amount << 10
+		          | rn << 5 | rd);
+		return;
+	}
+	panic("invalid operand kind in %+F", node);
+}
+
+static void enc_add(ir_node const *const node)
+{
+	enc_arith(node, 0x0B000000, 0x11000000);
+}
+
+static void enc_sub(ir_node const *const node)
+{
+	enc_arith(node, 0x4B000000, 0x51000000);
+}
+
+static void enc_cmp(ir_node const *const node)
+{
+	enc_arith(node, 0x6B000000, 0x71000000);
+}
+
+static void enc_cmn(ir_node const *const node)
+{
+	enc_arith(node, 0x2B000000, 0x31000000);
+}
+
+/** Encodes a bitfield move, which implements shifts and extensions. */
+static void enc_bfm(ir_node const *const node, uint32_t const opcode,
+                    unsigned const bits, uint32_t const immr,
+                    uint32_t const imms)
+{
+	uint32_t const sf = bits == 64 ? SF | 1u << 22 : 0;
+	be_emit32(opcode | sf | immr << 16 | imms << 10 | get_in(node, 0) << 5
+	          | get_rd(node));
+}
+
+static void enc_lsl_imm(ir_node const *const node)
+{
+	aarch64_imm_attr_t const *const attr = get_aarch64_imm_attr_const(node);
+	unsigned const bits = attr->base.bits;
+	uint32_t const sh   = (uint32_t)attr->imm;
+	enc_bfm(node, 0x53000000, bits, (bits - sh) % bits, bits - 1 - sh);
+}
+
+static void enc_lsr_imm(ir_node const *const node)
+{
+	aarch64_imm_attr_t const *const attr = get_aarch64_imm_attr_const(node);
+	unsigned const bits = attr->base.bits;
+	enc_bfm(node, 0x53000000, bits, (uint32_t)attr->imm, bits - 1);
+}
+
+static void enc_asr_imm(ir_node const *const node)
+{
+	aarch64_imm_attr_t const *const attr = get_aarch64_imm_attr_const(node);
+	unsigned const bits = attr->base.bits;
+	enc_bfm(node, 0x13000000, bits, (uint32_t)attr->imm, bits - 1);
+}
+
+static void enc_ror_imm(ir_node const *const node)
+{
+	aarch64_imm_attr_t const *const attr = get_aarch64_imm_attr_const(node);
+	uint32_t const sf = attr->base.bits == 64 ? SF | 1u << 22 : 0;
+	uint32_t const rn = get_in(node, 0);
+	be_emit32(0x13800000 | sf | rn << 16 | (uint32_t)attr->imm << 10
+	          | rn << 5 | get_rd(node));
+}
+
+static void enc_rev(ir_node const *const node)
+{
+	if (get_aarch64_attr_const(node)->bits == 64)
+		aarch64_enc_unop(node, 0xDAC00C00, 5);
+	else
+		aarch64_enc_unop(node, 0x5AC00800, 5);
+}
+
+static void enc_sxt(ir_node const *const node)
+{
+	aarch64_conv_attr_t const *const attr = get_aarch64_conv_attr_const(node);
+	enc_bfm(node, 0x13000000, attr->base.bits, 0, attr->src_bits - 1);
+}
+
+static void enc_uxt(ir_node const *const node)
+{
+	aarch64_conv_attr_t const *const attr = get_aarch64_conv_attr_const(node);
+	if (attr->src_bits == 32) {
+		/* writing a W register clears the upper half */
+		be_emit32(0x2A0003E0 | get_in(node, 0) << 16 | get_rd(node));
+	} else {
+		enc_bfm(node, 0x53000000, 32, 0, attr->src_bits - 1);
+	}
+}
+
+static void enc_csel(ir_node const *const node)
+{
+	aarch64_cond_attr_t const *const attr = get_aarch64_cond_attr_const(node);
+	be_emit32(0x1A800000 | get_sf(node) | get_in(node, n_aarch64_csel_false_val) << 16
+	          | (uint32_t)attr->cond << 12
+	          | get_in(node, n_aarch64_csel_true_val) << 5 | get_rd(node));
+}
+
+static void enc_cset(ir_node const *const node)
+{
+	aarch64_cond_attr_t const *const attr = get_aarch64_cond_attr_const(node);
+	/* cset is an alias of csinc with the inverted condition */
+	uint32_t const cond = aarch64_negate_cond(attr->cond);
+	be_emit32(0x1A9F07E0 | get_sf(node) | cond << 12 | get_rd(node));
+}
+
+static void enc_mov_imm(ir_node const *const node)
+{
+	aarch64_imm_attr_t const *const attr = get_aarch64_imm_attr_const(node);
+	aarch64_mov_seq_t seq;
+	aarch64_get_mov_sequence(attr->imm, attr->base.bits, &seq);
+	uint32_t const sf = get_sf(node);
+	uint32_t const rd = get_rd(node);
+	for (unsigned i = 0; i < seq.n_insns; ++i)
+		enc_mov_insn(&seq.insns[i], sf, rd);
+}
+
+static void enc_address(ir_node const *const node)
+{
+	aarch64_address_attr_t const *const attr
+		= get_aarch64_address_attr_const(node);
+	be_emit_reloc_entity(16, AARCH64_RELOCATION_MOVADDR + get_rd(node),
+	                     attr->entity, attr->offset);
+}
+
+static void enc_FrameAddr(ir_node const *const node)
+{
+	aarch64_address_attr_t const *const attr
+		= get_aarch64_address_attr_const(node);
+	if (attr->offset < 0)
+		panic("negative frame offset in %+F", node);
+	enc_add_sub_imm(0x91000000, get_rd(node), get_in(node, 0),
+	                (uint32_t)attr->offset);
+}
+
+/** Returns the opcode of a load or store with a scaled unsigned offset. */
+static uint32_t get_load_store_opcode(ir_node const *const node)
+{
+	aarch64_load_store_attr_t const *const attr
+		= get_aarch64_load_store_attr_const(node);
+	ir_mode *const mode     = attr->ls_mode;
+	unsigned const size     = get_mode_size_bytes(mode);
+	bool     const is_load  = is_aarch64_ldr(node) || is_aarch64_fldr(node);
+	uint32_t const load_bit = is_load ? 0x00400000 : 0;
+	if (is_aarch64_fldr(node) || is_aarch64_fstr(node)) {
+		switch (size) {
+		case 4: return 0xBD000000 | load_bit;
+		case 8: return 0xFD000000 | load_bit;
+		}
+	} else {
+		uint32_t opcode;
+		switch (size) {
+		case 1: opcode = 0x39000000; break;
+		case 2: opcode = 0x79000000; break;
+		case 4: opcode = 0xB9000000; break;
+		case 8: opcode = 0xF9000000; break;
+		default: goto invalid;
+		}
+		/* sign extending loads into a W register */
+		if (is_load && size < 4 && mode_is_signed(mode))
+			return opcode | 0x00C00000;
+		return opcode | load_bit;
+	}
+invalid:
+	panic("invalid load/store mode %+F in %+F", mode, node);
+}
+
+static void enc_load_store(ir_node const *const node, uint32_t const rt)
+{
+	aarch64_load_store_attr_t const *const attr
+		= get_aarch64_load_store_attr_const(node);
+	uint32_t const opcode = get_load_store_opcode(node);
+	unsigned const size   = get_mode_size_bytes(attr->ls_mode);
+	int32_t  const offset = attr->offset;
+	uint32_t const rn     = get_in(node, 0);
+	if (offset >= 0 && offset % size == 0 && offset / size < 4096) {
+		be_emit32(opcode | (uint32_t)(offset / size) << 10 | rn << 5 | rt);
+	} else if (-256 <= offset && offset < 256) {
+		/* unscaled variant */
+		be_emit32((opcode & ~UINT32_C(0x01000000))
+		          | ((uint32_t)offset & 0x1FF) << 12 | rn << 5 | rt);
+	} else {
+		panic("offset %"PRId32" of %+F not encodable", offset, node);
+	}
+}
+
+static void enc_load(ir_node const *const node)
+{
+	enc_load_store(node, get_out(node, pn_aarch64_ldr_res));
+}
+
+static void enc_store(ir_node const *const node)
+{
+	enc_load_store(node, get_in(node, n_aarch64_str_val));
+}
+
+static unsigned get_block_fragment_num(ir_node const *const block)
+{
+	return PTR_TO_INT(ir_nodehashmap_get(void, &block_fragmentnum, block));
+}
+
+static void enc_jump_cond(uint8_t const be_kind, ir_node const *const proj)
+{
+	ir_node const *const target = be_emit_get_cfop_target(proj);
+	be_emit_reloc_fragment(4, be_kind, get_block_fragment_num(target), 0);
+}
+
+static void enc_b_cond(ir_node const *const node)
+{
+	ir_node const *proj_true  = get_Proj_for_pn(node, pn_aarch64_b_cond_true);
+	ir_node const *proj_false = get_Proj_for_pn(node, pn_aarch64_b_cond_false);
+	aarch64_cond_t cond = get_aarch64_cond_attr_const(node)->cond;
+
+	ir_node const *const block       = get_nodes_block(node);
+	ir_node const *const true_target = be_emit_get_cfop_target(proj_true);
+	if (be_emit_get_prev_block(true_target) == block) {
+		/* exchange both projs so the second one can be omitted */
+		ir_node const *const t = proj_true;
+		proj_true  = proj_false;
+		proj_false = t;
+		cond       = aarch64_negate_cond(cond);
+	}
+
+	enc_jump_cond(AARCH64_RELOCATION_BCOND + cond, proj_true);
+
+	ir_node const *const false_target = be_emit_get_cfop_target(proj_false);
+	if (be_emit_get_prev_block(false_target) != block)
+		enc_jump_cond(AARCH64_RELOCATION_B, proj_false);
+}
+
+static void enc_b(ir_node const *const node)
+{
+	ir_node const *const block  = get_nodes_block(node);
+	ir_node const *const target = be_emit_get_cfop_target(node);
+	if (be_emit_get_prev_block(target) != block)
+		enc_jump_cond(AARCH64_RELOCATION_B, node);
+}
+
+static void enc_switch_jmp(ir_node const *const node)
+{
+	/* the table follows the 4 instructions computing the target */
+	be_emit32(0x10000000 | (16u >> 2) << 5 | REG_IP0);       /* adr x16, .+16 */
+	be_emit32(0xB8A05800 | get_in(node, 0) << 16 | REG_IP0 << 5 | REG_IP1);
+	be_emit32(0x8B000000 | REG_IP1 << 16 | REG_IP0 << 5 | REG_IP0);
+	be_emit32(0xD61F0000 | REG_IP0 << 5);                    /* br x16 */
+
+	aarch64_switch_jmp_attr_t const *const attr
+		= get_aarch64_switch_jmp_attr_const(node);
+	unsigned        const n_outs  = arch_get_irn_n_outs(node);
+	ir_node const **const targets = XMALLOCNZ(ir_node const*, n_outs);
+	foreach_out_edge(node, edge) {
+		ir_node *const proj = get_edge_src_irn(edge);
+		targets[get_Proj_num(proj)] = proj;
+	}
+
+	ir_switch_table const *const table     = attr->table;
+	size_t                 const n_entries = ir_switch_table_get_n_entries(table);
+	unsigned long                length    = 0;
+	for (size_t e = 0; e < n_entries; ++e) {
+		ir_switch_table_entry const *const entry
+			= ir_switch_table_get_entry_const(table, e);
+		if (entry->pn == 0)
+			continue;
+		unsigned long const max = get_tarval_long(entry->max);
+		length = MAX(length, max + 1);
+	}
+
+	ir_node const **const labels = XMALLOCNZ(ir_node const*, length);
+	for (size_t e = 0; e < n_entries; ++e) {
+		ir_switch_table_entry const *const entry
+			= ir_switch_table_get_entry_const(table, e);
+		if (entry->pn == 0)
+			continue;
+		unsigned long const min = get_tarval_long(entry->min);
+		unsigned long const max = get_tarval_long(entry->max);
+		for (unsigned long i = min; i <= max; ++i)
+			labels[i] = targets[entry->pn];
+	}
+
+	for (unsigned long i = 0; i < length; ++i) {
+		ir_node const *const proj  = labels[i] ? labels[i] : targets[0];
+		ir_node const *const block = be_emit_get_cfop_target(proj);
+		be_emit_reloc_fragment(4, AARCH64_RELOCATION_SWITCH,
+		                       get_block_fragment_num(block),
+		                       (int32_t)(4 * i));
+	}
+
+	xfree(labels);
+	xfree(targets);
+}
+
+static void enc_bl(ir_node const *const node)
+{
+	aarch64_address_attr_t const *const attr
+		= get_aarch64_address_attr_const(node);
+	/* the callee may be anywhere in the address space */
+	be_emit_reloc_entity(16, AARCH64_RELOCATION_MOVADDR + REG_IP0,
+	                     attr->entity, attr->offset);
+	be_emit32(0xD63F0000 | REG_IP0 << 5);
+}
+
+static void enc_blr(ir_node const *const node)
+{
+	be_emit32(0xD63F0000 | get_in(node, n_aarch64_blr_callee) << 5);
+}
+
+static void enc_fcmp(ir_node const *const node)
+{
+	be_emit32(0x1E202000 | get_fp_type(get_aarch64_attr_const(node)->bits)
+	          | get_in(node, 1) << 16 | get_in(node, 0) << 5);
+}
+
+static void enc_fcvt(ir_node const *const node)
+{
+	aarch64_conv_attr_t const *const attr = get_aarch64_conv_attr_const(node);
+	uint32_t const opcode = attr->src_bits == 32 ? 0x1E22C000 : 0x1E624000;
+	be_emit32(opcode | get_in(node, 0) << 5 | get_rd(node));
+}
+
+static void enc_fmov_to_fp(ir_node const *const node)
+{
+	uint32_t const opcode = get_aarch64_attr_const(node)->bits == 64
+	                      ? 0x9E670000 : 0x1E270000;
+	be_emit32(opcode | get_in(node, 0) << 5 | get_rd(node));
+}
+
+static void enc_fmov_from_fp(ir_node const *const node)
+{
+	uint32_t const opcode = get_aarch64_attr_const(node)->bits == 64
+	                      ? 0x9E660000 : 0x1E260000;
+	be_emit32(opcode | get_in(node, 0) << 5 | get_rd(node));
+}
+
+static void enc_copy(ir_node const *const node)
+{
+	arch_register_t const *const in  = arch_get_irn_register_in(node, 0);
+	arch_register_t const *const out = arch_get_irn_register_out(node, 0);
+	if (in == out)
+		return;
+
+	if (out->cls == &aarch64_reg_classes[CLASS_aarch64_gp]) {
+		if (in->encoding == REG_31 || out->encoding == REG_31) {
+			/* mov to or from sp is an alias of add #0 */
+			be_emit32(0x91000000 | in->encoding << 5 | out->encoding);
+		} else {
+			be_emit32(0xAA0003E0 | in->encoding << 16 | out->encoding);
+		}
+	} else if (out->cls == &aarch64_reg_classes[CLASS_aarch64_neon]) {
+		be_emit32(0x1E604000 | in->encoding << 5 | out->encoding);
+	} else {
+		panic("move not supported for this register class");
+	}
+}
+
+static void enc_incsp(ir_node const *const node)
+{
+	int const offset = be_get_IncSP_offset(node);
+	if (offset == 0)
+		return;
+	if (offset > 0)
+		enc_add_sub_imm(0xD1000000, REG_31, REG_31, (uint32_t)offset);
+	else
+		enc_add_sub_imm(0x91000000, REG_31, REG_31, (uint32_t)-offset);
+}
+
+static void enc_perm(ir_node const *const node)
+{
+	arch_register_t const *const reg0 = arch_get_irn_register_out(node, 0);
+	uint32_t const r0 = reg0->encoding;
+	uint32_t const r1 = get_out(node, 1);
+	uint32_t opcode;
+	if (reg0->cls == &aarch64_reg_classes[CLASS_aarch64_gp])
+		opcode = 0xCA000000;
+	else if (reg0->cls == &aarch64_reg_classes[CLASS_aarch64_neon])
+		opcode = 0x6E201C00;
+	else
+		panic("unexpected register class in %+F", node);
+	be_emit32(opcode | r1 << 16 | r0 << 5 | r0);
+	be_emit32(opcode | r1 << 16 | r0 << 5 | r1);
+	be_emit32(opcode | r1 << 16 | r0 << 5 | r0);
+}
+
+static void enc_sp_ldr_str(uint32_t const opcode, uint32_t const rt,
+                           int const offset)
+{
+	if (offset < 0 || offset % 8 != 0 || offset / 8 >= 4096)
+		panic("MemPerm offset %d not encodable", offset);
+	be_emit32(opcode | (uint32_t)(offset / 8) << 10 | REG_31 << 5 | rt);
+}
+
+static void enc_memperm(ir_node const *const node)
+{
+	int const memperm_arity = be_get_MemPerm_entity_arity(node);
+	if (memperm_arity > 16)
+		panic("memperm with more than 16 inputs not supported yet");
+
+	int sp_change = 0;
+	for (int i = 0; i < memperm_arity; ++i) {
+		/* str xi, [sp, #-16]! */
+		be_emit32(0xF81F0FE0 | (uint32_t)i);
+		sp_change += 16;
+		ir_entity *const entity = be_get_MemPerm_in_entity(node, i);
+		int const offset
+			= aarch64_get_MemPerm_entity_offset(node, entity) + sp_change;
+		enc_sp_ldr_str(0xF9400000, (uint32_t)i, offset);
+	}
+
+	for (int i = memperm_arity; i-- > 0; ) {
+		ir_entity *const entity = be_get_MemPerm_out_entity(node, i);
+		int const offset
+			= aarch64_get_MemPerm_entity_offset(node, entity) + sp_change;
+		enc_sp_ldr_str(0xF9000000, (uint32_t)i, offset);
+		/* ldr xi, [sp], #16 */
+		be_emit32(0xF84107E0 | (uint32_t)i);
+		sp_change -= 16;
+	}
+	assert(sp_change == 0);
+}
+
+static void aarch64_register_binary_emitters(void)
+{
+	be_init_emitters();
+
+	aarch64_register_spec_binary_emitters();
+
+	be_set_emitter(op_aarch64_add,          enc_add);
+	be_set_emitter(op_aarch64_address,      enc_address);
+	be_set_emitter(op_aarch64_asr_imm,      enc_asr_imm);
+	be_set_emitter(op_aarch64_b,            enc_b);
+	be_set_emitter(op_aarch64_b_cond,       enc_b_cond);
+	be_set_emitter(op_aarch64_bl,           enc_bl);
+	be_set_emitter(op_aarch64_blr,          enc_blr);
+	be_set_emitter(op_aarch64_cmn,          enc_cmn);
+	be_set_emitter(op_aarch64_cmp,          enc_cmp);
+	be_set_emitter(op_aarch64_csel,         enc_csel);
+	be_set_emitter(op_aarch64_cset,         enc_cset);
+	be_set_emitter(op_aarch64_fcmp,         enc_fcmp);
+	be_set_emitter(op_aarch64_fcvt,         enc_fcvt);
+	be_set_emitter(op_aarch64_fldr,         enc_load);
+	be_set_emitter(op_aarch64_fmov_from_fp, enc_fmov_from_fp);
+	be_set_emitter(op_aarch64_fmov_to_fp,   enc_fmov_to_fp);
+	be_set_emitter(op_aarch64_FrameAddr,    enc_FrameAddr);
+	be_set_emitter(op_aarch64_fstr,         enc_store);
+	be_set_emitter(op_aarch64_ldr,          enc_load);
+	be_set_emitter(op_aarch64_lsl_imm,      enc_lsl_imm);
+	be_set_emitter(op_aarch64_lsr_imm,      enc_lsr_imm);
+	be_set_emitter(op_aarch64_mov_imm,      enc_mov_imm);
+	be_set_emitter(op_aarch64_rev,          enc_rev);
+	be_set_emitter(op_aarch64_ror_imm,      enc_ror_imm);
+	be_set_emitter(op_aarch64_str,          enc_store);
+	be_set_emitter(op_aarch64_sub,          enc_sub);
+	be_set_emitter(op_aarch64_switch_jmp,   enc_switch_jmp);
+	be_set_emitter(op_aarch64_sxt,          enc_sxt);
+	be_set_emitter(op_aarch64_uxt,          enc_uxt);
+
+	/* benode emitter */
+	be_set_emitter(op_be_Copy,              enc_copy);
+	be_set_emitter(op_be_CopyKeep,          enc_copy);
+	be_set_emitter(op_be_IncSP,             enc_incsp);
+	be_set_emitter(op_be_MemPerm,           enc_memperm);
+	be_set_emitter(op_be_Perm,              enc_perm);
+}
+
+static void gen_binary_block(ir_node *const block)
+{
+	unsigned fragment_num = be_begin_fragment(0, 0);
+	assert(fragment_num == get_block_fragment_num(block));
+	(void)fragment_num;
+
+	sched_foreach(block, node) {
+		be_emit_node(node);
+	}
+
+	be_finish_fragment();
+}
+
+ir_jit_function_t *aarch64_emit_jit(ir_jit_segment_t *const segment,
+                                    ir_graph *const irg)
+{
+	aarch64_register_binary_emitters();
+
+	ir_node **const blk_sched = be_create_block_schedule(irg);
+
+	be_jit_begin_function(segment);
+
+	/* we use links to point to target blocks */
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+
+	be_emit_init_cf_links(blk_sched);
+
+	ir_nodehashmap_init(&block_fragmentnum);
+	size_t const n = ARR_LEN(blk_sched);
+	for (size_t i = 0; i < n; ++i)
+		ir_nodehashmap_insert(&block_fragmentnum, blk_sched[i], INT_TO_PTR(i));
+	for (size_t i = 0; i < n; ++i)
+		gen_binary_block(blk_sched[i]);
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	ir_nodehashmap_destroy(&block_fragmentnum);
+
+	return be_jit_finish_function();
+}
+
+/** Returns the instruction word of a branch to a code fragment. */
+static uint32_t get_branch_insn(uint8_t const be_kind, int32_t const offset)
+{
+	if (be_kind == AARCH64_RELOCATION_B) {
+		if (offset < -(1 << 27) || offset >= (1 << 27))
+			panic("branch offset out of range");
+		return 0x14000000 | ((uint32_t)offset >> 2 & 0x3FFFFFF);
+	}
+	assert(AARCH64_RELOCATION_BCOND <= be_kind
+	    && be_kind < AARCH64_RELOCATION_MOVADDR);
+	if (offset < -(1 << 20) || offset >= (1 << 20))
+		panic("conditional branch offset out of range");
+	uint32_t const cond = be_kind - AARCH64_RELOCATION_BCOND;
+	return 0x54000000 | ((uint32_t)offset >> 2 & 0x7FFFF) << 5 | cond;
+}
+
+/** Returns the movz/movk setting halfword @p hw of a 64bit register. */
+static uint32_t get_movaddr_insn(unsigned const reg, unsigned const hw,
+                                 uint16_t const imm)
+{
+	uint32_t const opcode = hw == 0 ? 0xD2800000 : 0xF2800000;
+	return opcode | hw << 21 | (uint32_t)imm << 5 | reg;
+}
+
+unsigned aarch64_emit_jit_relocation(char *const buffer, uint8_t const be_kind,
+                                     ir_entity *const entity, int32_t const offset)
+{
+	if (entity == NULL) {
+		if (be_kind == AARCH64_RELOCATION_SWITCH) {
+			memcpy(buffer, &offset, 4);
+		} else {
+			uint32_t const insn = get_branch_insn(be_kind, offset);
+			memcpy(buffer, &insn, 4);
+		}
+		return 4;
+	}
+
+	if (be_kind < AARCH64_RELOCATION_MOVADDR
+	 || be_kind >= AARCH64_RELOCATION_SWITCH)
+		panic("relocation kind %u to %+F not supported in jit code",
+		      be_kind, entity);
+
+	intptr_t const entity_addr = (intptr_t)be_jit_get_entity_addr(entity);
+	if (entity_addr == (intptr_t)-1)
+		panic("Could not resolve address of entity %+F", entity);
+	uint64_t const addr = (uint64_t)(entity_addr + offset);
+	unsigned const reg  = be_kind - AARCH64_RELOCATION_MOVADDR;
+	for (unsigned hw = 0; hw < 4; ++hw) {
+		uint32_t const insn
+			= get_movaddr_insn(reg, hw, (uint16_t)(addr >> (16 * hw)));
+		memcpy(buffer + 4 * hw, &insn, 4);
+	}
+	return 16;
+}
+
+static void enc_nops(char *const buffer, unsigned const size)
+{
+	assert(size % 4 == 0);
+	uint32_t const nop = 0xD503201F;
+	for (unsigned i = 0; i < size; i += 4)
+		memcpy(buffer + i, &nop, 4);
+}
+
+void aarch64_emit_jit_function(char *buffer, ir_jit_function_t *const function)
+{
+	static const be_jit_emit_interface_t jit_emit_interface = {
+		.nops       = enc_nops,
+		.relocation = aarch64_emit_jit_relocation,
+	};
+	be_jit_emit_memory(buffer, function, &jit_emit_interface);
+}
+
+static unsigned emit_jit_entity_relocation_asm(char *const buffer,
+                                               uint8_t const be_kind,
+                                               ir_entity *const entity,
+                                               int32_t const offset)
+{
+	(void)buffer;
+	assert(buffer == NULL);
+	if (entity == NULL) {
+		if (be_kind == AARCH64_RELOCATION_SWITCH)
+			be_emit_irprintf("\t.word %"PRId32"\n", offset);
+		else
+			be_emit_irprintf("\t.inst 0x%08"PRIX32"\n",
+			                 get_branch_insn(be_kind, offset));
+		be_emit_write_line();
+		return 4;
+	}
+
+	/* the offset is the explicit addend of the relocations */
+	static char const *const names[] = {
+		"R_AARCH64_MOVW_UABS_G0_NC", "R_AARCH64_MOVW_UABS_G1_NC",
+		"R_AARCH64_MOVW_UABS_G2_NC", "R_AARCH64_MOVW_UABS_G3",
+	};
+	unsigned const reg = be_kind - AARCH64_RELOCATION_MOVADDR;
+	for (unsigned hw = 0; hw < 4; ++hw) {
+		be_emit_irprintf("\t.reloc ., %s, ", names[hw]);
+		be_gas_emit_entity(entity);
+		if (offset != 0)
+			be_emit_int_with_sign(offset);
+		be_emit_irprintf("\n\t.inst 0x%08"PRIX32"\n",
+		                 get_movaddr_insn(reg, hw, 0));
+		be_emit_write_line();
+	}
+	return 16;
+}
+
+void aarch64_emit_machcode_function(ir_graph *const irg)
+{
+	ir_jit_segment_t  *const segment  = be_new_jit_segment();
+	ir_jit_function_t *const function = aarch64_emit_jit(segment, irg);
+	be_jit_emit_as_asm(function, emit_jit_entity_relocation_asm);
+	be_destroy_jit_segment(segment);
+}
@@ -0,0 +1,115 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       AArch64 binary encoding
+ */
+#ifndef FIRM_BE_AARCH64_AARCH64_ENCODE_H
+#define FIRM_BE_AARCH64_AARCH64_ENCODE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "firm_types.h"
+#include "jit.h"
+
+/** Relocation kinds of the AArch64 backend. */
+enum {
+	/** b to a code fragment */
+	AARCH64_RELOCATION_B       = 128,
+	/** b.cond to a code fragment, the condition is added to the kind */
+	AARCH64_RELOCATION_BCOND   = AARCH64_RELOCATION_B + 1,
+	/**
+	 * movz/movk sequence materializing a 64bit address, the destination
+	 * register is added to the kind
+	 */
+	AARCH64_RELOCATION_MOVADDR = AARCH64_RELOCATION_BCOND + 16,
+	/** jump table entry relative to the start of the table */
+	AARCH64_RELOCATION_SWITCH  = AARCH64_RELOCATION_MOVADDR + 32,
+};
+
+/** Kinds of instructions used to materialize a constant. */
+typedef enum aarch64_mov_kind_t {
+	AARCH64_MOVZ,    /**< movz with a 16bit immediate */
+	AARCH64_MOVN,    /**< movn with a 16bit immediate */
+	AARCH64_MOVK,    /**< movk with a 16bit immediate */
+	AARCH64_MOV_ORR, /**< orr of the zero register with a bitmask */
+} aarch64_mov_kind_t;
+
+typedef struct aarch64_mov_insn_t {
+	aarch64_mov_kind_t kind;
+	uint8_t            hw;  /**< halfword position of the immediate */
+	uint64_t           imm; /**< 16bit immediate or the bitmask for orr */
+} aarch64_mov_insn_t;
+
+/** Instruction sequence materializing a constant. */
+typedef struct aarch64_mov_seq_t {
+	unsigned           n_insns;
+	aarch64_mov_insn_t insns[4];
+} aarch64_mov_seq_t;
+
+/**
+ * Computes the shortest instruction sequence which materializes @p value in a
+ * register of width @p bits.
+ */
+void aarch64_get_mov_sequence(uint64_t value, unsigned bits,
+                              aarch64_mov_seq_t *seq);
+
+/**
+ * Tries to encode @p value as bitmask immediate of a logical instruction of
+ * width @p bits.  On success the N:immr:imms fields are stored in @p enc.
+ */
+bool aarch64_encode_logical_imm(uint64_t value, unsigned bits, uint32_t *enc);
+
+/**
+ * Tries to encode @p value as immediate of an arithmetic instruction, which
+ * is 12 bits optionally shifted left by 12.
+ */
+bool aarch64_encode_arith_imm(uint64_t value, uint64_t *imm, unsigned *shift);
+
+/**
+ * Returns true if @p offset can be encoded into a load or store accessing
+ * @p size bytes, either scaled or unscaled.
+ */
+bool aarch64_is_load_store_offset(int64_t offset, unsigned size);
+
+ir_jit_function_t *aarch64_emit_jit(ir_jit_segment_t *segment, ir_graph *irg);
+
+void aarch64_emit_jit_function(char *buffer, ir_jit_function_t *function);
+
+unsigned aarch64_emit_jit_relocation(char *buffer, uint8_t be_kind,
+                                     ir_entity *entity, int32_t offset);
+
+/** Emits the machine code of @p irg as assembler directives. */
+void aarch64_emit_machcode_function(ir_graph *irg);
+
+/**
+ * Encodes a logical operation.  @p op_reg is used for register operands,
+ * @p op_imm for bitmask immediates.
+ */
+void aarch64_enc_logical(ir_node const *node, uint32_t op_reg, uint32_t op_imm);
+
+/** Encodes a data processing operation with two register sources. */
+void aarch64_enc_dp2(ir_node const *node, uint32_t opcode);
+
+/**
+ * Encodes a data processing operation with three register sources, a missing
+ * accumulator must already be part of @p opcode.
+ */
+void aarch64_enc_dp3(ir_node const *node, uint32_t opcode);
+
+/**
+ * Encodes an operation with a single register source, which is placed at
+ * bit @p src_shift.
+ */
+void aarch64_enc_unop(ir_node const *node, uint32_t opcode, unsigned src_shift);
+
+/** Encodes a scalar floating point operation. */
+void aarch64_enc_fp(ir_node const *node, uint32_t opcode);
+
+/** Encodes a conversion between integer and floating point registers. */
+void aarch64_enc_fcvt_int(ir_node const *node, uint32_t opcode);
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   AArch64 graph touchups before emitting
+ */
+#include "bearch_aarch64_t.h"
+
+#include "aarch64_new_nodes.h"
+#include "aarch64_optimize.h"
+#include "beirg.h"
+#include "benode.h"
+#include "besched.h"
+#include "bespillslots.h"
+#include "bestack.h"
+#include "be_types.h"
+#include "bitfiddle.h"
+#include "firm_types.h"
+#include "gen_aarch64_regalloc_if.h"
+#include "iredges_t.h"
+#include "irgwalk.h"
+#include "typerep.h"
+
+static bool is_frame_load(const ir_node *node)
+{
+	return is_aarch64_ldr(node) || is_aarch64_fldr(node);
+}
+
+static void aarch64_collect_frame_entity_nodes(ir_node *node, void *data)
+{
+	if (!is_frame_load(node))
+		return;
+
+	const aarch64_load_store_attr_t *attr
+		= get_aarch64_load_store_attr_const(node);
+	if (!attr->is_frame_entity)
+		return;
+	const ir_entity *entity = attr->entity;
+	if (entity != NULL)
+		return;
+	const ir_mode *mode = attr->ls_mode;
+	const ir_type *type = get_type_for_mode(mode);
+
+	be_fec_env_t *env = (be_fec_env_t*)data;
+	be_load_needs_frame_entity(env, node, type);
+}
+
+static void aarch64_set_frame_entity(ir_node *node, ir_entity *entity,
+                                     const ir_type *type)
+{
+	(void)type;
+	aarch64_load_store_attr_t *attr = get_aarch64_load_store_attr(node);
+	attr->entity = entity;
+}
+
+static void introduce_epilog(ir_node *ret)
+{
+	arch_register_t const *const sp_reg = &aarch64_registers[REG_SP];
+	assert(arch_get_irn_register_req_in(ret, n_aarch64_ret_sp) == sp_reg->single_req);
+
+	ir_node  *const sp         = get_irn_n(ret, n_aarch64_ret_sp);
+	ir_node  *const block      = get_nodes_block(ret);
+	ir_graph *const irg        = get_irn_irg(ret);
+	ir_type  *const frame_type = get_irg_frame_type(irg);
+	unsigned  const frame_size = get_type_size(frame_type);
+	ir_node  *const incsp      = be_new_IncSP(sp_reg, block, sp, -frame_size, 0);
+	set_irn_n(ret, n_aarch64_ret_sp, incsp);
+	sched_add_before(ret, incsp);
+}
+
+static void introduce_prolog_epilog(ir_graph *irg)
+{
+	/* introduce epilog for every return node */
+	foreach_irn_in(get_irg_end_block(irg), i, ret) {
+		assert(is_aarch64_ret(ret));
+		introduce_epilog(ret);
+	}
+
+	const arch_register_t *sp_reg     = &aarch64_registers[REG_SP];
+	ir_node               *start      = get_irg_start(irg);
+	ir_node               *block      = get_nodes_block(start);
+	ir_node               *initial_sp = be_get_Start_proj(irg, sp_reg);
+	ir_type               *frame_type = get_irg_frame_type(irg);
+	unsigned               frame_size = get_type_size(frame_type);
+
+	ir_node *const incsp = be_new_IncSP(sp_reg, block, initial_sp, frame_size, 0);
+	edges_reroute_except(initial_sp, incsp, incsp);
+	sched_add_after(start, incsp);
+}
+
+/**
+ * This function is called by the generic backend to correct offsets for
+ * nodes accessing the stack.
+ */
+static void aarch64_set_frame_offset(ir_node *irn, int bias)
+{
+	if (be_is_MemPerm(irn)) {
+		be_set_MemPerm_offset(irn, bias);
+	} else if (is_aarch64_FrameAddr(irn)) {
+		aarch64_address_attr_t *attr = get_aarch64_address_attr(irn);
+		attr->offset += bias;
+	} else {
+		aarch64_load_store_attr_t *attr = get_aarch64_load_store_attr(irn);
+		attr->offset += bias;
+	}
+}
+
+static int aarch64_get_sp_bias(const ir_node *node)
+{
+	(void)node;
+	return 0;
+}
+
+static ir_entity *aarch64_get_frame_entity(const ir_node *irn)
+{
+	if (be_is_MemPerm(irn))
+		return be_get_MemPerm_in_entity(irn, 0);
+	if (!is_aarch64_irn(irn))
+		return NULL;
+	if (is_aarch64_FrameAddr(irn)) {
+		const aarch64_address_attr_t *attr
+			= get_aarch64_address_attr_const(irn);
+		return attr->entity;
+	}
+	if (aarch64_has_load_store_attr(irn)) {
+		const aarch64_load_store_attr_t *attr
+			= get_aarch64_load_store_attr_const(irn);
+		if (attr->is_frame_entity)
+			return attr->entity;
+	}
+	return NULL;
+}
+
+void aarch64_finish_graph(ir_graph *irg)
+{
+	bool          omit_fp = aarch64_get_irg_data(irg)->omit_fp;
+	be_fec_env_t *fec_env = be_new_frame_entity_coalescer(irg);
+
+	irg_walk_graph(irg, NULL, aarch64_collect_frame_entity_nodes, fec_env);
+	be_assign_entities(fec_env, aarch64_set_frame_entity, omit_fp);
+	be_free_frame_entity_coalescer(fec_env);
+
+	/* the stack pointer has to stay 16 byte aligned */
+	ir_type *const frame_type = get_irg_frame_type(irg);
+	set_type_size(frame_type,
+	              round_up2(get_type_size(frame_type),
+	                        1u << AARCH64_PO2_STACK_ALIGNMENT));
+
+	introduce_prolog_epilog(irg);
+
+	/* fix stack entity offsets */
+	be_fix_stack_nodes(irg, &aarch64_registers[REG_SP]);
+	be_birg_from_irg(irg)->non_ssa_regs = NULL;
+	be_abi_fix_stack_bias(irg, aarch64_get_sp_bias, aarch64_set_frame_offset,
+	                      aarch64_get_frame_entity);
+
+	/* do peephole optimizations and fix stack offsets */
+	aarch64_peephole_optimization(irg);
+}
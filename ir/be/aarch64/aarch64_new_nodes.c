@@ -0,0 +1,381 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief  This file implements the creation of the architecture specific firm
+ *         opcodes and the corresponding node constructors for the AArch64
+ *         assembler irg.
+ */
+#include <inttypes.h>
+
+#include "aarch64_new_nodes_t.h"
+#include "aarch64_nodes_attr.h"
+#include "bearch_aarch64_t.h"
+#include "bedump.h"
+#include "irprintf.h"
+#include "obst.h"
+
+struct obstack aarch64_opcodes_obst;
+
+unsigned get_aarch64_latency(const ir_node *node)
+{
+	assert(is_aarch64_irn(node));
+	const ir_op             *op      = get_irn_op(node);
+	const aarch64_op_attr_t *op_attr = (const aarch64_op_attr_t*)get_op_attr(op);
+	return op_attr->latency;
+}
+
+static bool has_imm_attr(const ir_node *node)
+{
+	return is_aarch64_lsl_imm(node) || is_aarch64_lsr_imm(node)
+	    || is_aarch64_asr_imm(node) || is_aarch64_ror_imm(node)
+	    || is_aarch64_mov_imm(node) || is_aarch64_brk(node);
+}
+
+static bool has_cond_attr(const ir_node *node)
+{
+	return is_aarch64_csel(node) || is_aarch64_cset(node)
+	    || is_aarch64_b_cond(node);
+}
+
+static bool has_conv_attr(const ir_node *node)
+{
+	return is_aarch64_sxt(node) || is_aarch64_uxt(node)
+	    || is_aarch64_fcvt(node) || is_aarch64_scvtf(node)
+	    || is_aarch64_ucvtf(node) || is_aarch64_fcvtzs(node)
+	    || is_aarch64_fcvtzu(node);
+}
+
+static bool has_address_attr(const ir_node *node)
+{
+	return is_aarch64_address(node) || is_aarch64_FrameAddr(node)
+	    || is_aarch64_bl(node);
+}
+
+bool aarch64_has_shifter_attr(const ir_node *node)
+{
+	return is_aarch64_add(node) || is_aarch64_sub(node)
+	    || is_aarch64_and(node) || is_aarch64_orr(node)
+	    || is_aarch64_eor(node) || is_aarch64_bic(node)
+	    || is_aarch64_orn(node) || is_aarch64_eon(node)
+	    || is_aarch64_cmp(node) || is_aarch64_cmn(node)
+	    || is_aarch64_tst(node);
+}
+
+bool aarch64_has_load_store_attr(const ir_node *node)
+{
+	return is_aarch64_ldr(node) || is_aarch64_str(node)
+	    || is_aarch64_fldr(node) || is_aarch64_fstr(node);
+}
+
+static char const *get_shift_name(aarch64_shift_t const shift)
+{
+	switch (shift) {
+	case AARCH64_SHIFT_LSL: return "lsl";
+	case AARCH64_SHIFT_LSR: return "lsr";
+	case AARCH64_SHIFT_ASR: return "asr";
+	case AARCH64_SHIFT_ROR: return "ror";
+	}
+	return "invalid";
+}
+
+void aarch64_dump_node(FILE *F, const ir_node *n, dump_reason_t reason)
+{
+	switch (reason) {
+	case dump_node_opcode_txt:
+		fprintf(F, "%s", get_irn_opname(n));
+		if (has_address_attr(n)) {
+			const aarch64_address_attr_t *attr
+				= get_aarch64_address_attr_const(n);
+			if (attr->entity != NULL)
+				ir_fprintf(F, " %F", attr->entity);
+		}
+		break;
+
+	case dump_node_mode_txt:
+		/* mode isn't relevant in the backend */
+		break;
+
+	case dump_node_nodeattr_txt:
+		break;
+
+	case dump_node_info_txt: {
+		const aarch64_attr_t *attr = get_aarch64_attr_const(n);
+		fprintf(F, "bits = %u\n", (unsigned)attr->bits);
+		if (aarch64_has_shifter_attr(n)) {
+			const aarch64_shifter_attr_t *shifter
+				= get_aarch64_shifter_attr_const(n);
+			switch (shifter->kind) {
+			case AARCH64_OPERAND_REG:
+				break;
+			case AARCH64_OPERAND_IMM:
+				fprintf(F, "immediate = 0x%" PRIx64 " lsl %u\n",
+				        shifter->immediate, (unsigned)shifter->amount);
+				break;
+			case AARCH64_OPERAND_REG_SHIFT:
+				fprintf(F, "modifier = %s %u\n", get_shift_name(shifter->shift),
+				        (unsigned)shifter->amount);
+				break;
+			}
+		}
+		if (has_imm_attr(n)) {
+			const aarch64_imm_attr_t *imm = get_aarch64_imm_attr_const(n);
+			fprintf(F, "imm = 0x%" PRIx64 "\n", imm->imm);
+		}
+		if (has_cond_attr(n)) {
+			const aarch64_cond_attr_t *cond = get_aarch64_cond_attr_const(n);
+			fprintf(F, "cond = %d\n", (int)cond->cond);
+		}
+		if (has_conv_attr(n)) {
+			const aarch64_conv_attr_t *conv = get_aarch64_conv_attr_const(n);
+			fprintf(F, "src_bits = %u\n", (unsigned)conv->src_bits);
+		}
+		if (has_address_attr(n)) {
+			const aarch64_address_attr_t *address
+				= get_aarch64_address_attr_const(n);
+			ir_fprintf(F, "entity = %+F\n", address->entity);
+			fprintf(F, "offset = %" PRId32 "\n", address->offset);
+		}
+		if (aarch64_has_load_store_attr(n)) {
+			const aarch64_load_store_attr_t *ls
+				= get_aarch64_load_store_attr_const(n);
+			ir_fprintf(F, "ls_mode = %+F\n", ls->ls_mode);
+			ir_fprintf(F, "entity = %+F\n", ls->entity);
+			fprintf(F, "offset = %" PRId32 "\n", ls->offset);
+			fprintf(F, "is_frame_entity = %s\n",
+			        be_dump_yesno(ls->is_frame_entity));
+		}
+		break;
+	}
+	}
+}
+
+aarch64_attr_t *get_aarch64_attr(ir_node *node)
+{
+	assert(is_aarch64_irn(node));
+	return (aarch64_attr_t*)get_irn_generic_attr(node);
+}
+
+const aarch64_attr_t *get_aarch64_attr_const(const ir_node *node)
+{
+	assert(is_aarch64_irn(node));
+	return (const aarch64_attr_t*)get_irn_generic_attr_const(node);
+}
+
+aarch64_shifter_attr_t *get_aarch64_shifter_attr(ir_node *node)
+{
+	assert(aarch64_has_shifter_attr(node));
+	return (aarch64_shifter_attr_t*)get_irn_generic_attr(node);
+}
+
+const aarch64_shifter_attr_t *get_aarch64_shifter_attr_const(
+		const ir_node *node)
+{
+	assert(aarch64_has_shifter_attr(node));
+	return (const aarch64_shifter_attr_t*)get_irn_generic_attr_const(node);
+}
+
+aarch64_imm_attr_t *get_aarch64_imm_attr(ir_node *node)
+{
+	assert(has_imm_attr(node));
+	return (aarch64_imm_attr_t*)get_irn_generic_attr(node);
+}
+
+const aarch64_imm_attr_t *get_aarch64_imm_attr_const(const ir_node *node)
+{
+	assert(has_imm_attr(node));
+	return (const aarch64_imm_attr_t*)get_irn_generic_attr_const(node);
+}
+
+aarch64_cond_attr_t *get_aarch64_cond_attr(ir_node *node)
+{
+	assert(has_cond_attr(node));
+	return (aarch64_cond_attr_t*)get_irn_generic_attr(node);
+}
+
+const aarch64_cond_attr_t *get_aarch64_cond_attr_const(const ir_node *node)
+{
+	assert(has_cond_attr(node));
+	return (const aarch64_cond_attr_t*)get_irn_generic_attr_const(node);
+}
+
+aarch64_conv_attr_t *get_aarch64_conv_attr(ir_node *node)
+{
+	assert(has_conv_attr(node));
+	return (aarch64_conv_attr_t*)get_irn_generic_attr(node);
+}
+
+const aarch64_conv_attr_t *get_aarch64_conv_attr_const(const ir_node *node)
+{
+	assert(has_conv_attr(node));
+	return (const aarch64_conv_attr_t*)get_irn_generic_attr_const(node);
+}
+
+aarch64_address_attr_t *get_aarch64_address_attr(ir_node *node)
+{
+	assert(has_address_attr(node));
+	return (aarch64_address_attr_t*)get_irn_generic_attr(node);
+}
+
+const aarch64_address_attr_t *get_aarch64_address_attr_const(
+		const ir_node *node)
+{
+	assert(has_address_attr(node));
+	return (const aarch64_address_attr_t*)get_irn_generic_attr_const(node);
+}
+
+aarch64_load_store_attr_t *get_aarch64_load_store_attr(ir_node *node)
+{
+	assert(aarch64_has_load_store_attr(node));
+	return (aarch64_load_store_attr_t*)get_irn_generic_attr(node);
+}
+
+const aarch64_load_store_attr_t *get_aarch64_load_store_attr_const(
+		const ir_node *node)
+{
+	assert(aarch64_has_load_store_attr(node));
+	return (const aarch64_load_store_attr_t*)get_irn_generic_attr_const(node);
+}
+
+aarch64_switch_jmp_attr_t *get_aarch64_switch_jmp_attr(ir_node *node)
+{
+	assert(is_aarch64_switch_jmp(node));
+	return (aarch64_switch_jmp_attr_t*)get_irn_generic_attr(node);
+}
+
+const aarch64_switch_jmp_attr_t *get_aarch64_switch_jmp_attr_const(
+		const ir_node *node)
+{
+	assert(is_aarch64_switch_jmp(node));
+	return (const aarch64_switch_jmp_attr_t*)get_irn_generic_attr_const(node);
+}
+
+void init_aarch64_attributes(ir_node *node, arch_irn_flags_t flags,
+                             const arch_register_req_t **in_reqs, int n_res,
+                             unsigned bits)
+{
+	be_info_init_irn(node, flags, in_reqs, n_res);
+	aarch64_attr_t *const attr = get_aarch64_attr(node);
+	attr->bits = bits;
+}
+
+void init_aarch64_shifter_attributes(ir_node *res, aarch64_operand_kind_t kind,
+                                     aarch64_shift_t shift, unsigned amount,
+                                     uint64_t immediate)
+{
+	aarch64_shifter_attr_t *attr = get_aarch64_shifter_attr(res);
+	attr->kind      = kind;
+	attr->shift     = shift;
+	attr->amount    = amount;
+	attr->immediate = immediate;
+}
+
+void init_aarch64_address_attributes(ir_node *res, ir_entity *entity,
+                                     int32_t offset)
+{
+	aarch64_address_attr_t *attr = get_aarch64_address_attr(res);
+	attr->entity = entity;
+	attr->offset = offset;
+}
+
+void init_aarch64_load_store_attributes(ir_node *res, ir_mode *ls_mode,
+                                        ir_entity *entity, int32_t offset,
+                                        bool is_frame_entity)
+{
+	aarch64_load_store_attr_t *attr = get_aarch64_load_store_attr(res);
+	attr->ls_mode         = ls_mode;
+	attr->entity          = entity;
+	attr->offset          = offset;
+	attr->is_frame_entity = is_frame_entity;
+}
+
+void init_aarch64_switch_jmp_attributes(ir_node *res,
+                                        const ir_switch_table *table)
+{
+	aarch64_switch_jmp_attr_t *attr = get_aarch64_switch_jmp_attr(res);
+	attr->table = table;
+
+	be_foreach_out(res, o) {
+		arch_set_irn_register_req_out(res, o, arch_exec_req);
+	}
+}
+
+int aarch64_attrs_equal(const ir_node *a, const ir_node *b)
+{
+	const aarch64_attr_t *attr_a = get_aarch64_attr_const(a);
+	const aarch64_attr_t *attr_b = get_aarch64_attr_const(b);
+	return attr_a->bits == attr_b->bits;
+}
+
+int aarch64_shifter_attrs_equal(const ir_node *a, const ir_node *b)
+{
+	const aarch64_shifter_attr_t *attr_a = get_aarch64_shifter_attr_const(a);
+	const aarch64_shifter_attr_t *attr_b = get_aarch64_shifter_attr_const(b);
+	return aarch64_attrs_equal(a, b)
+	    && attr_a->kind == attr_b->kind
+	    && attr_a->shift == attr_b->shift
+	    && attr_a->amount == attr_b->amount
+	    && attr_a->immediate == attr_b->immediate;
+}
+
+int aarch64_imm_attrs_equal(const ir_node *a, const ir_node *b)
+{
+	const aarch64_imm_attr_t *attr_a = get_aarch64_imm_attr_const(a);
+	const aarch64_imm_attr_t *attr_b = get_aarch64_imm_attr_const(b);
+	return aarch64_attrs_equal(a, b) && attr_a->imm == attr_b->imm;
+}
+
+int aarch64_cond_attrs_equal(const ir_node *a, const ir_node *b)
+{
+	const aarch64_cond_attr_t *attr_a = get_aarch64_cond_attr_const(a);
+	const aarch64_cond_attr_t *attr_b = get_aarch64_cond_attr_const(b);
+	return aarch64_attrs_equal(a, b) && attr_a->cond == attr_b->cond;
+}
+
+int aarch64_conv_attrs_equal(const ir_node *a, const ir_node *b)
+{
+	const aarch64_conv_attr_t *attr_a = get_aarch64_conv_attr_const(a);
+	const aarch64_conv_attr_t *attr_b = get_aarch64_conv_attr_const(b);
+	return aarch64_attrs_equal(a, b) && attr_a->src_bits == attr_b->src_bits;
+}
+
+int aarch64_address_attrs_equal(const ir_node *a, const ir_node *b)
+{
+	const aarch64_address_attr_t *attr_a = get_aarch64_address_attr_const(a);
+	const aarch64_address_attr_t *attr_b = get_aarch64_address_attr_const(b);
+	return aarch64_attrs_equal(a, b)
+	    && attr_a->entity == attr_b->entity
+	    && attr_a->offset == attr_b->offset;
+}
+
+int aarch64_load_store_attrs_equal(const ir_node *a, const ir_node *b)
+{
+	const aarch64_load_store_attr_t *attr_a
+		= get_aarch64_load_store_attr_const(a);
+	const aarch64_load_store_attr_t *attr_b
+		= get_aarch64_load_store_attr_const(b);
+	return aarch64_attrs_equal(a, b)
+	    && attr_a->ls_mode == attr_b->ls_mode
+	    && attr_a->entity == attr_b->entity
+	    && attr_a->offset == attr_b->offset
+	    && attr_a->is_frame_entity == attr_b->is_frame_entity;
+}
+
+int aarch64_switch_jmp_attrs_equal(const ir_node *a, const ir_node *b)
+{
+	const aarch64_switch_jmp_attr_t *attr_a
+		= get_aarch64_switch_jmp_attr_const(a);
+	const aarch64_switch_jmp_attr_t *attr_b
+		= get_aarch64_switch_jmp_attr_const(b);
+	return aarch64_attrs_equal(a, b) && attr_a->table == attr_b->table;
+}
+
+void aarch64_init_op(ir_op *op, unsigned latency)
+{
+	aarch64_op_attr_t *attr = OALLOCZ(&aarch64_opcodes_obst, aarch64_op_attr_t);
+	attr->latency = latency;
+	set_op_attr(op, attr);
+}
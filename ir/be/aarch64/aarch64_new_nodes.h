@@ -0,0 +1,55 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Function prototypes for the assembler ir node constructors.
+ */
+#ifndef FIRM_BE_AARCH64_AARCH64_NEW_NODES_H
+#define FIRM_BE_AARCH64_AARCH64_NEW_NODES_H
+
+#include "aarch64_nodes_attr.h"
+
+aarch64_attr_t *get_aarch64_attr(ir_node *node);
+const aarch64_attr_t *get_aarch64_attr_const(const ir_node *node);
+
+aarch64_shifter_attr_t *get_aarch64_shifter_attr(ir_node *node);
+const aarch64_shifter_attr_t *get_aarch64_shifter_attr_const(const ir_node *node);
+
+aarch64_imm_attr_t *get_aarch64_imm_attr(ir_node *node);
+const aarch64_imm_attr_t *get_aarch64_imm_attr_const(const ir_node *node);
+
+aarch64_cond_attr_t *get_aarch64_cond_attr(ir_node *node);
+const aarch64_cond_attr_t *get_aarch64_cond_attr_const(const ir_node *node);
+
+aarch64_conv_attr_t *get_aarch64_conv_attr(ir_node *node);
+const aarch64_conv_attr_t *get_aarch64_conv_attr_const(const ir_node *node);
+
+aarch64_address_attr_t *get_aarch64_address_attr(ir_node *node);
+const aarch64_address_attr_t *get_aarch64_address_attr_const(const ir_node *node);
+
+aarch64_load_store_attr_t *get_aarch64_load_store_attr(ir_node *node);
+const aarch64_load_store_attr_t *get_aarch64_load_store_attr_const(const ir_node *node);
+
+aarch64_switch_jmp_attr_t *get_aarch64_switch_jmp_attr(ir_node *node);
+const aarch64_switch_jmp_attr_t *get_aarch64_switch_jmp_attr_const(const ir_node *node);
+
+extern struct obstack aarch64_opcodes_obst;
+
+/**
+ * Returns the latency of an AArch64 node as declared in the spec file.
+ */
+unsigned get_aarch64_latency(const ir_node *node);
+
+/** Returns true if @p node has a shifter operand. */
+bool aarch64_has_shifter_attr(const ir_node *node);
+
+/** Returns true if @p node is a load or store. */
+bool aarch64_has_load_store_attr(const ir_node *node);
+
+/* Include the generated headers */
+#include "gen_aarch64_new_nodes.h"
+
+#endif
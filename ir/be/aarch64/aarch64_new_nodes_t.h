@@ -0,0 +1,46 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Internal declarations used by gen_new_nodes.c
+ */
+#ifndef FIRM_BE_AARCH64_AARCH64_NEW_NODES_T_H
+#define FIRM_BE_AARCH64_AARCH64_NEW_NODES_T_H
+
+#include "aarch64_new_nodes.h"
+
+void init_aarch64_attributes(ir_node *node, arch_irn_flags_t flags,
+                             const arch_register_req_t **in_reqs, int n_res,
+                             unsigned bits);
+
+void init_aarch64_shifter_attributes(ir_node *res, aarch64_operand_kind_t kind,
+                                     aarch64_shift_t shift, unsigned amount,
+                                     uint64_t immediate);
+
+void init_aarch64_address_attributes(ir_node *res, ir_entity *entity,
+                                     int32_t offset);
+
+void init_aarch64_load_store_attributes(ir_node *res, ir_mode *ls_mode,
+                                        ir_entity *entity, int32_t offset,
+                                        bool is_frame_entity);
+
+void init_aarch64_switch_jmp_attributes(ir_node *res,
+                                        const ir_switch_table *table);
+
+int aarch64_attrs_equal(const ir_node *a, const ir_node *b);
+int aarch64_shifter_attrs_equal(const ir_node *a, const ir_node *b);
+int aarch64_imm_attrs_equal(const ir_node *a, const ir_node *b);
+int aarch64_cond_attrs_equal(const ir_node *a, const ir_node *b);
+int aarch64_conv_attrs_equal(const ir_node *a, const ir_node *b);
+int aarch64_address_attrs_equal(const ir_node *a, const ir_node *b);
+int aarch64_load_store_attrs_equal(const ir_node *a, const ir_node *b);
+int aarch64_switch_jmp_attrs_equal(const ir_node *a, const ir_node *b);
+
+void aarch64_dump_node(FILE *F, const ir_node *n, dump_reason_t reason);
+
+void aarch64_init_op(ir_op *op, unsigned latency);
+
+#endif
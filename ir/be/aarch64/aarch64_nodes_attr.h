@@ -0,0 +1,117 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   declarations for AArch64 node attributes
+ */
+#ifndef FIRM_BE_AARCH64_AARCH64_NODES_ATTR_H
+#define FIRM_BE_AARCH64_AARCH64_NODES_ATTR_H
+
+#include <stdint.h>
+
+#include "firm_types.h"
+#include "irnode_t.h"
+
+/** Kind of the second operand of a data processing instruction. */
+typedef enum aarch64_operand_kind_t {
+	AARCH64_OPERAND_REG,       /**< plain register */
+	AARCH64_OPERAND_IMM,       /**< immediate */
+	AARCH64_OPERAND_REG_SHIFT, /**< register shifted by an immediate */
+} aarch64_operand_kind_t;
+
+/** Shift types, the values match the instruction encoding. */
+typedef enum aarch64_shift_t {
+	AARCH64_SHIFT_LSL = 0,
+	AARCH64_SHIFT_LSR = 1,
+	AARCH64_SHIFT_ASR = 2,
+	AARCH64_SHIFT_ROR = 3,
+} aarch64_shift_t;
+
+/**
+ * Condition codes, the values match the instruction encoding. Flipping the
+ * lowest bit negates a condition.
+ */
+typedef enum aarch64_cond_t {
+	AARCH64_COND_EQ = 0,
+	AARCH64_COND_NE = 1,
+	AARCH64_COND_HS = 2,
+	AARCH64_COND_LO = 3,
+	AARCH64_COND_MI = 4,
+	AARCH64_COND_PL = 5,
+	AARCH64_COND_VS = 6,
+	AARCH64_COND_VC = 7,
+	AARCH64_COND_HI = 8,
+	AARCH64_COND_LS = 9,
+	AARCH64_COND_GE = 10,
+	AARCH64_COND_LT = 11,
+	AARCH64_COND_GT = 12,
+	AARCH64_COND_LE = 13,
+	AARCH64_COND_AL = 14,
+} aarch64_cond_t;
+
+static inline aarch64_cond_t aarch64_negate_cond(aarch64_cond_t const cond)
+{
+	return (aarch64_cond_t)(cond ^ 1);
+}
+
+typedef struct aarch64_op_attr_t {
+	unsigned latency;
+} aarch64_op_attr_t;
+
+/** Generic AArch64 node attributes. */
+typedef struct aarch64_attr_t {
+	except_attr exc;  /**< the exception attribute. MUST be the first one. */
+	uint8_t     bits; /**< operation width, 32 selects the W registers */
+} aarch64_attr_t;
+
+/**
+ * Second operand of a data processing instruction. Arithmetic immediates are
+ * 12 bits shifted by amount (0 or 12), logical immediates hold the bitmask.
+ */
+typedef struct aarch64_shifter_attr_t {
+	aarch64_attr_t         base;
+	aarch64_operand_kind_t kind;
+	aarch64_shift_t        shift;
+	uint8_t                amount;
+	uint64_t               immediate;
+} aarch64_shifter_attr_t;
+
+typedef struct aarch64_imm_attr_t {
+	aarch64_attr_t base;
+	uint64_t       imm;
+} aarch64_imm_attr_t;
+
+typedef struct aarch64_cond_attr_t {
+	aarch64_attr_t base;
+	aarch64_cond_t cond;
+} aarch64_cond_attr_t;
+
+/** Attributes of conversions, bits is the width of the result. */
+typedef struct aarch64_conv_attr_t {
+	aarch64_attr_t base;
+	uint8_t        src_bits;
+} aarch64_conv_attr_t;
+
+typedef struct aarch64_address_attr_t {
+	aarch64_attr_t base;
+	ir_entity     *entity;
+	int32_t        offset;
+} aarch64_address_attr_t;
+
+typedef struct aarch64_load_store_attr_t {
+	aarch64_attr_t base;
+	ir_mode       *ls_mode;
+	ir_entity     *entity;
+	int32_t        offset;
+	bool           is_frame_entity : 1;
+} aarch64_load_store_attr_t;
+
+typedef struct aarch64_switch_jmp_attr_t {
+	aarch64_attr_t         base;
+	const ir_switch_table *table;
+} aarch64_switch_jmp_attr_t;
+
+#endif
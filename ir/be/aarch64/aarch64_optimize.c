@@ -0,0 +1,70 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Implements several optimizations for AArch64.
+ */
+#include "aarch64_optimize.h"
+
+#include "aarch64_encode.h"
+#include "aarch64_new_nodes.h"
+#include "benode.h"
+#include "bepeephole.h"
+#include "besched.h"
+#include "gen_aarch64_regalloc_if.h"
+#include "irgmod.h"
+
+/**
+ * Fix an IncSP node if the offset gets too big
+ */
+static void peephole_be_IncSP(ir_node *node)
+{
+	/* optimize incsp->incsp combinations, big offsets are split by the
+	 * emitter */
+	be_peephole_IncSP_IncSP(node);
+}
+
+/**
+ * Fix stack pointer relative loads and stores if the offset gets too big.
+ * The address is computed in the reserved register x16.
+ */
+static void peephole_aarch64_load_store(ir_node *node)
+{
+	aarch64_load_store_attr_t *const attr   = get_aarch64_load_store_attr(node);
+	int32_t                    const offset = attr->offset;
+	unsigned                   const size   = get_mode_size_bytes(attr->ls_mode);
+	if (aarch64_is_load_store_offset(offset, size))
+		return;
+
+	arch_register_t const *const tmp_reg = &aarch64_registers[REG_X16];
+	dbg_info              *const dbgi    = get_irn_dbg_info(node);
+	ir_node               *const block   = get_nodes_block(node);
+	/* all loads and stores have the address as first input */
+	ir_node               *const base    = get_irn_n(node, n_aarch64_ldr_ptr);
+	ir_node               *const value   = new_bd_aarch64_mov_imm(dbgi, block, 64, (uint64_t)(int64_t)offset);
+	arch_set_irn_register(value, tmp_reg);
+	sched_add_before(node, value);
+	ir_node *const ptr = new_bd_aarch64_add_reg(dbgi, block, base, value, 64);
+	arch_set_irn_register(ptr, tmp_reg);
+	sched_add_before(node, ptr);
+
+	set_irn_n(node, n_aarch64_ldr_ptr, ptr);
+	attr->offset = 0;
+}
+
+/* Perform peephole-optimizations. */
+void aarch64_peephole_optimization(ir_graph *irg)
+{
+	/* register peephole optimizations */
+	ir_clear_opcodes_generic_func();
+	register_peephole_optimization(op_be_IncSP,     peephole_be_IncSP);
+	register_peephole_optimization(op_aarch64_ldr,  peephole_aarch64_load_store);
+	register_peephole_optimization(op_aarch64_fldr, peephole_aarch64_load_store);
+	register_peephole_optimization(op_aarch64_str,  peephole_aarch64_load_store);
+	register_peephole_optimization(op_aarch64_fstr, peephole_aarch64_load_store);
+
+	be_peephole_opt(irg);
+}
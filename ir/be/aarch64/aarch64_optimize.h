@@ -0,0 +1,22 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Implements several optimizations for AArch64.
+ */
+#ifndef FIRM_BE_AARCH64_AARCH64_OPTIMIZE_H
+#define FIRM_BE_AARCH64_AARCH64_OPTIMIZE_H
+
+#include "firm_types.h"
+
+/**
+ * Performs Peephole Optimizations an a graph.
+ *
+ * @param irg   the graph
+ */
+void aarch64_peephole_optimization(ir_graph *irg);
+
+#endif
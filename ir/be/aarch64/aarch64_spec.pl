@@ -0,0 +1,731 @@
+# AArch64 Architecture Specification
+
+$arch = "aarch64";
+
+$mode_gp    = "mode_Lu";
+$mode_flags = "aarch64_mode_flags";
+$mode_fp    = "mode_D";
+
+%reg_classes = (
+	gp => [
+		{ name => "x0",  encoding =>  0, dwarf =>  0 },
+		{ name => "x1",  encoding =>  1, dwarf =>  1 },
+		{ name => "x2",  encoding =>  2, dwarf =>  2 },
+		{ name => "x3",  encoding =>  3, dwarf =>  3 },
+		{ name => "x4",  encoding =>  4, dwarf =>  4 },
+		{ name => "x5",  encoding =>  5, dwarf =>  5 },
+		{ name => "x6",  encoding =>  6, dwarf =>  6 },
+		{ name => "x7",  encoding =>  7, dwarf =>  7 },
+		{ name => "x8",  encoding =>  8, dwarf =>  8 },
+		{ name => "x9",  encoding =>  9, dwarf =>  9 },
+		{ name => "x10", encoding => 10, dwarf => 10 },
+		{ name => "x11", encoding => 11, dwarf => 11 },
+		{ name => "x12", encoding => 12, dwarf => 12 },
+		{ name => "x13", encoding => 13, dwarf => 13 },
+		{ name => "x14", encoding => 14, dwarf => 14 },
+		{ name => "x15", encoding => 15, dwarf => 15 },
+		{ name => "x16", encoding => 16, dwarf => 16 },
+		{ name => "x17", encoding => 17, dwarf => 17 },
+		{ name => "x18", encoding => 18, dwarf => 18 },
+		{ name => "x19", encoding => 19, dwarf => 19 },
+		{ name => "x20", encoding => 20, dwarf => 20 },
+		{ name => "x21", encoding => 21, dwarf => 21 },
+		{ name => "x22", encoding => 22, dwarf => 22 },
+		{ name => "x23", encoding => 23, dwarf => 23 },
+		{ name => "x24", encoding => 24, dwarf => 24 },
+		{ name => "x25", encoding => 25, dwarf => 25 },
+		{ name => "x26", encoding => 26, dwarf => 26 },
+		{ name => "x27", encoding => 27, dwarf => 27 },
+		{ name => "x28", encoding => 28, dwarf => 28 },
+		{ name => "x29", encoding => 29, dwarf => 29 },
+		{ name => "x30", encoding => 30, dwarf => 30 },
+		{ name => "sp",  encoding => 31, dwarf => 31 },
+		{ mode => $mode_gp }
+	],
+	neon => [
+		{ name => "v0",  encoding =>  0, dwarf => 64 },
+		{ name => "v1",  encoding =>  1, dwarf => 65 },
+		{ name => "v2",  encoding =>  2, dwarf => 66 },
+		{ name => "v3",  encoding =>  3, dwarf => 67 },
+		{ name => "v4",  encoding =>  4, dwarf => 68 },
+		{ name => "v5",  encoding =>  5, dwarf => 69 },
+		{ name => "v6",  encoding =>  6, dwarf => 70 },
+		{ name => "v7",  encoding =>  7, dwarf => 71 },
+		{ name => "v8",  encoding =>  8, dwarf => 72 },
+		{ name => "v9",  encoding =>  9, dwarf => 73 },
+		{ name => "v10", encoding => 10, dwarf => 74 },
+		{ name => "v11", encoding => 11, dwarf => 75 },
+		{ name => "v12", encoding => 12, dwarf => 76 },
+		{ name => "v13", encoding => 13, dwarf => 77 },
+		{ name => "v14", encoding => 14, dwarf => 78 },
+		{ name => "v15", encoding => 15, dwarf => 79 },
+		{ name => "v16", encoding => 16, dwarf => 80 },
+		{ name => "v17", encoding => 17, dwarf => 81 },
+		{ name => "v18", encoding => 18, dwarf => 82 },
+		{ name => "v19", encoding => 19, dwarf => 83 },
+		{ name => "v20", encoding => 20, dwarf => 84 },
+		{ name => "v21", encoding => 21, dwarf => 85 },
+		{ name => "v22", encoding => 22, dwarf => 86 },
+		{ name => "v23", encoding => 23, dwarf => 87 },
+		{ name => "v24", encoding => 24, dwarf => 88 },
+		{ name => "v25", encoding => 25, dwarf => 89 },
+		{ name => "v26", encoding => 26, dwarf => 90 },
+		{ name => "v27", encoding => 27, dwarf => 91 },
+		{ name => "v28", encoding => 28, dwarf => 92 },
+		{ name => "v29", encoding => 29, dwarf => 93 },
+		{ name => "v30", encoding => 30, dwarf => 94 },
+		{ name => "v31", encoding => 31, dwarf => 95 },
+		{ mode => $mode_fp }
+	],
+	flags => [
+		{ name => "nzcv" },
+		{ mode => $mode_flags, flags => "manual_ra" }
+	],
+);
+
+%init_attr = (
+	aarch64_attr_t =>
+		"init_aarch64_attributes(res, irn_flags, in_reqs, n_res, bits);",
+	aarch64_shifter_attr_t =>
+		"init_aarch64_attributes(res, irn_flags, in_reqs, n_res, bits);",
+	aarch64_imm_attr_t =>
+		"init_aarch64_attributes(res, irn_flags, in_reqs, n_res, bits);\n".
+		"\tattr->imm = imm;",
+	aarch64_cond_attr_t =>
+		"init_aarch64_attributes(res, irn_flags, in_reqs, n_res, bits);\n".
+		"\tattr->cond = cond;",
+	aarch64_conv_attr_t =>
+		"init_aarch64_attributes(res, irn_flags, in_reqs, n_res, bits);\n".
+		"\tattr->src_bits = src_bits;",
+	aarch64_address_attr_t =>
+		"init_aarch64_attributes(res, irn_flags, in_reqs, n_res, bits);\n".
+		"\tinit_aarch64_address_attributes(res, entity, offset);",
+	aarch64_load_store_attr_t =>
+		"init_aarch64_attributes(res, irn_flags, in_reqs, n_res, bits);\n".
+		"\tinit_aarch64_load_store_attributes(res, ls_mode, entity, offset, is_frame_entity);",
+	aarch64_switch_jmp_attr_t =>
+		"init_aarch64_attributes(res, irn_flags, in_reqs, n_res, bits);\n".
+		"\tinit_aarch64_switch_jmp_attributes(res, table);",
+);
+
+my $binop = {
+	irn_flags    => [ "rematerializable" ],
+	attr_type    => "aarch64_shifter_attr_t",
+	out_reqs     => [ "gp" ],
+	constructors => {
+		reg => {
+			attr    => "unsigned bits",
+			init    => "init_aarch64_shifter_attributes(res, AARCH64_OPERAND_REG, AARCH64_SHIFT_LSL, 0, 0);",
+			in_reqs => [ "gp", "gp" ],
+			ins     => [ "left", "right" ],
+		},
+		imm => {
+			attr    => "unsigned bits, uint64_t immediate, unsigned amount",
+			init    => "init_aarch64_shifter_attributes(res, AARCH64_OPERAND_IMM, AARCH64_SHIFT_LSL, amount, immediate);",
+			in_reqs => [ "gp" ],
+			ins     => [ "left" ],
+		},
+		reg_shift => {
+			attr    => "unsigned bits, aarch64_shift_t shift, unsigned amount",
+			init    => "init_aarch64_shifter_attributes(res, AARCH64_OPERAND_REG_SHIFT, shift, amount, 0);",
+			in_reqs => [ "gp", "gp" ],
+			ins     => [ "left", "right" ],
+		},
+	},
+};
+
+my $binop_noimm = {
+	irn_flags    => [ "rematerializable" ],
+	attr_type    => "aarch64_shifter_attr_t",
+	out_reqs     => [ "gp" ],
+	constructors => {
+		reg => {
+			attr    => "unsigned bits",
+			init    => "init_aarch64_shifter_attributes(res, AARCH64_OPERAND_REG, AARCH64_SHIFT_LSL, 0, 0);",
+			in_reqs => [ "gp", "gp" ],
+			ins     => [ "left", "right" ],
+		},
+		reg_shift => {
+			attr    => "unsigned bits, aarch64_shift_t shift, unsigned amount",
+			init    => "init_aarch64_shifter_attributes(res, AARCH64_OPERAND_REG_SHIFT, shift, amount, 0);",
+			in_reqs => [ "gp", "gp" ],
+			ins     => [ "left", "right" ],
+		},
+	},
+};
+
+my $cmpop = {
+	%$binop,
+	irn_flags => [ "rematerializable", "modify_flags" ],
+	out_reqs  => [ "flags" ],
+};
+
+my $gp_binop = {
+	irn_flags => [ "rematerializable" ],
+	in_reqs   => [ "gp", "gp" ],
+	out_reqs  => [ "gp" ],
+	ins       => [ "left", "right" ],
+	attr      => "unsigned bits",
+};
+
+my $gp_triop = {
+	irn_flags => [ "rematerializable" ],
+	in_reqs   => [ "gp", "gp", "gp" ],
+	out_reqs  => [ "gp" ],
+	ins       => [ "left", "right", "acc" ],
+	attr      => "unsigned bits",
+};
+
+my $gp_unop = {
+	irn_flags => [ "rematerializable" ],
+	in_reqs   => [ "gp" ],
+	out_reqs  => [ "gp" ],
+	ins       => [ "val" ],
+	attr      => "unsigned bits",
+};
+
+my $shift_imm = {
+	irn_flags => [ "rematerializable" ],
+	in_reqs   => [ "gp" ],
+	out_reqs  => [ "gp" ],
+	ins       => [ "val" ],
+	attr_type => "aarch64_imm_attr_t",
+	attr      => "unsigned bits, uint64_t imm",
+};
+
+my $conv = {
+	irn_flags => [ "rematerializable" ],
+	ins       => [ "val" ],
+	attr_type => "aarch64_conv_attr_t",
+	attr      => "unsigned bits, unsigned src_bits",
+};
+
+my $fbinop = {
+	irn_flags => [ "rematerializable" ],
+	in_reqs   => [ "neon", "neon" ],
+	out_reqs  => [ "neon" ],
+	ins       => [ "left", "right" ],
+	attr      => "unsigned bits",
+};
+
+my $load = {
+	op_flags  => [ "uses_memory" ],
+	state     => "exc_pinned",
+	ins       => [ "ptr", "mem" ],
+	outs      => [ "res", "M" ],
+	attr_type => "aarch64_load_store_attr_t",
+	attr      => "ir_mode *ls_mode, ir_entity *entity, int32_t offset, bool is_frame_entity",
+	fixed     => "unsigned bits = 64;",
+};
+
+my $store = {
+	op_flags  => [ "uses_memory" ],
+	state     => "exc_pinned",
+	ins       => [ "ptr", "val", "mem" ],
+	outs      => [ "M" ],
+	out_reqs  => [ "mem" ],
+	attr_type => "aarch64_load_store_attr_t",
+	attr      => "ir_mode *ls_mode, ir_entity *entity, int32_t offset, bool is_frame_entity",
+	fixed     => "unsigned bits = 64;",
+};
+
+%nodes = (
+
+add => {
+	template => $binop,
+	emit     => 'add %D0, %S0, %O',
+},
+
+sub => {
+	template => $binop,
+	emit     => 'sub %D0, %S0, %O',
+},
+
+and => {
+	template => $binop,
+	emit     => 'and %D0, %S0, %O',
+	encode   => 'aarch64_enc_logical(node, 0x0A000000, 0x12000000)',
+},
+
+orr => {
+	template => $binop,
+	emit     => 'orr %D0, %S0, %O',
+	encode   => 'aarch64_enc_logical(node, 0x2A000000, 0x32000000)',
+},
+
+eor => {
+	template => $binop,
+	emit     => 'eor %D0, %S0, %O',
+	encode   => 'aarch64_enc_logical(node, 0x4A000000, 0x52000000)',
+},
+
+bic => {
+	template => $binop_noimm,
+	emit     => 'bic %D0, %S0, %O',
+	encode   => 'aarch64_enc_logical(node, 0x0A200000, 0)',
+},
+
+orn => {
+	template => $binop_noimm,
+	emit     => 'orn %D0, %S0, %O',
+	encode   => 'aarch64_enc_logical(node, 0x2A200000, 0)',
+},
+
+eon => {
+	template => $binop_noimm,
+	emit     => 'eon %D0, %S0, %O',
+	encode   => 'aarch64_enc_logical(node, 0x4A200000, 0)',
+},
+
+cmp => {
+	template => $cmpop,
+	emit     => 'cmp %S0, %O',
+},
+
+cmn => {
+	template => $cmpop,
+	emit     => 'cmn %S0, %O',
+},
+
+tst => {
+	template => $cmpop,
+	emit     => 'tst %S0, %O',
+	encode   => 'aarch64_enc_logical(node, 0x6A000000, 0x72000000)',
+},
+
+lslv => {
+	template => $gp_binop,
+	emit     => 'lsl %D0, %S0, %S1',
+	encode   => 'aarch64_enc_dp2(node, 0x1AC02000)',
+},
+
+lsrv => {
+	template => $gp_binop,
+	emit     => 'lsr %D0, %S0, %S1',
+	encode   => 'aarch64_enc_dp2(node, 0x1AC02400)',
+},
+
+asrv => {
+	template => $gp_binop,
+	emit     => 'asr %D0, %S0, %S1',
+	encode   => 'aarch64_enc_dp2(node, 0x1AC02800)',
+},
+
+rorv => {
+	template => $gp_binop,
+	emit     => 'ror %D0, %S0, %S1',
+	encode   => 'aarch64_enc_dp2(node, 0x1AC02C00)',
+},
+
+lsl_imm => {
+	template => $shift_imm,
+	emit     => 'lsl %D0, %S0, #%i',
+},
+
+lsr_imm => {
+	template => $shift_imm,
+	emit     => 'lsr %D0, %S0, #%i',
+},
+
+asr_imm => {
+	template => $shift_imm,
+	emit     => 'asr %D0, %S0, #%i',
+},
+
+ror_imm => {
+	template => $shift_imm,
+	emit     => 'ror %D0, %S0, #%i',
+},
+
+mul => {
+	template => $gp_binop,
+	emit     => 'mul %D0, %S0, %S1',
+	encode   => 'aarch64_enc_dp3(node, 0x1B007C00)',
+	latency  => 3,
+},
+
+madd => {
+	template => $gp_triop,
+	emit     => 'madd %D0, %S0, %S1, %S2',
+	encode   => 'aarch64_enc_dp3(node, 0x1B000000)',
+	latency  => 3,
+},
+
+msub => {
+	template => $gp_triop,
+	emit     => 'msub %D0, %S0, %S1, %S2',
+	encode   => 'aarch64_enc_dp3(node, 0x1B008000)',
+	latency  => 3,
+},
+
+smulh => {
+	template => $gp_binop,
+	emit     => 'smulh %D0, %S0, %S1',
+	encode   => 'aarch64_enc_dp3(node, 0x9B407C00)',
+	latency  => 5,
+},
+
+umulh => {
+	template => $gp_binop,
+	emit     => 'umulh %D0, %S0, %S1',
+	encode   => 'aarch64_enc_dp3(node, 0x9BC07C00)',
+	latency  => 5,
+},
+
+smull => {
+	template => $gp_binop,
+	emit     => 'smull %XD0, %WS0, %WS1',
+	encode   => 'aarch64_enc_dp3(node, 0x9B207C00)',
+	latency  => 3,
+},
+
+umull => {
+	template => $gp_binop,
+	emit     => 'umull %XD0, %WS0, %WS1',
+	encode   => 'aarch64_enc_dp3(node, 0x9BA07C00)',
+	latency  => 3,
+},
+
+sdiv => {
+	template => $gp_binop,
+	emit     => 'sdiv %D0, %S0, %S1',
+	encode   => 'aarch64_enc_dp2(node, 0x1AC00C00)',
+	latency  => 12,
+},
+
+udiv => {
+	template => $gp_binop,
+	emit     => 'udiv %D0, %S0, %S1',
+	encode   => 'aarch64_enc_dp2(node, 0x1AC00800)',
+	latency  => 12,
+},
+
+neg => {
+	template => $gp_unop,
+	emit     => 'neg %D0, %S0',
+	encode   => 'aarch64_enc_unop(node, 0x4B0003E0, 16)',
+},
+
+mvn => {
+	template => $gp_unop,
+	emit     => 'mvn %D0, %S0',
+	encode   => 'aarch64_enc_unop(node, 0x2A2003E0, 16)',
+},
+
+clz => {
+	template => $gp_unop,
+	emit     => 'clz %D0, %S0',
+	encode   => 'aarch64_enc_unop(node, 0x5AC01000, 5)',
+},
+
+rbit => {
+	template => $gp_unop,
+	emit     => 'rbit %D0, %S0',
+	encode   => 'aarch64_enc_unop(node, 0x5AC00000, 5)',
+},
+
+rev => {
+	template => $gp_unop,
+	emit     => 'rev %D0, %S0',
+},
+
+rev16 => {
+	template => $gp_unop,
+	emit     => 'rev16 %D0, %S0',
+	encode   => 'aarch64_enc_unop(node, 0x5AC00400, 5)',
+},
+
+sxt => {
+	template => $conv,
+	in_reqs  => [ "gp" ],
+	out_reqs => [ "gp" ],
+	emit     => 'sxt%M %D0, %WS0',
+},
+
+uxt => {
+	template => $conv,
+	in_reqs  => [ "gp" ],
+	out_reqs => [ "gp" ],
+},
+
+csel => {
+	in_reqs   => [ "gp", "gp", "flags" ],
+	out_reqs  => [ "gp" ],
+	ins       => [ "true_val", "false_val", "flags" ],
+	attr_type => "aarch64_cond_attr_t",
+	attr      => "unsigned bits, aarch64_cond_t cond",
+	emit      => 'csel %D0, %S0, %S1, %C',
+},
+
+cset => {
+	in_reqs   => [ "flags" ],
+	out_reqs  => [ "gp" ],
+	ins       => [ "flags" ],
+	attr_type => "aarch64_cond_attr_t",
+	attr      => "unsigned bits, aarch64_cond_t cond",
+	emit      => 'cset %D0, %C',
+},
+
+mov_imm => {
+	op_flags  => [ "constlike" ],
+	irn_flags => [ "rematerializable" ],
+	out_reqs  => [ "gp" ],
+	attr_type => "aarch64_imm_attr_t",
+	attr      => "unsigned bits, uint64_t imm",
+},
+
+address => {
+	op_flags  => [ "constlike" ],
+	irn_flags => [ "rematerializable" ],
+	out_reqs  => [ "gp" ],
+	attr_type => "aarch64_address_attr_t",
+	attr      => "ir_entity *entity, int32_t offset",
+	fixed     => "unsigned bits = 64;",
+	emit      => "adrp %D0, %I\n".
+	             "add %D0, %D0, :lo12:%I",
+},
+
+FrameAddr => {
+	op_flags  => [ "constlike" ],
+	irn_flags => [ "rematerializable" ],
+	in_reqs   => [ "gp" ],
+	out_reqs  => [ "gp" ],
+	ins       => [ "base" ],
+	attr_type => "aarch64_address_attr_t",
+	attr      => "ir_entity *entity, int32_t offset",
+	fixed     => "unsigned bits = 64;",
+},
+
+ldr => {
+	template => $load,
+	in_reqs  => [ "gp", "mem" ],
+	out_reqs => [ "gp", "mem" ],
+	latency  => 4,
+},
+
+str => {
+	template => $store,
+	in_reqs  => [ "gp", "gp", "mem" ],
+},
+
+fldr => {
+	template => $load,
+	in_reqs  => [ "gp", "mem" ],
+	out_reqs => [ "neon", "mem" ],
+	latency  => 5,
+},
+
+fstr => {
+	template => $store,
+	in_reqs  => [ "gp", "neon", "mem" ],
+},
+
+b_cond => {
+	op_flags  => [ "cfopcode", "forking" ],
+	state     => "pinned",
+	in_reqs   => [ "flags" ],
+	out_reqs  => [ "exec", "exec" ],
+	ins       => [ "flags" ],
+	outs      => [ "false", "true" ],
+	attr_type => "aarch64_cond_attr_t",
+	attr      => "aarch64_cond_t cond",
+	fixed     => "unsigned bits = 64;",
+},
+
+b => {
+	state     => "pinned",
+	op_flags  => [ "cfopcode" ],
+	irn_flags => [ "simple_jump" ],
+	out_reqs  => [ "exec" ],
+	fixed     => "unsigned bits = 64;",
+},
+
+switch_jmp => {
+	op_flags  => [ "cfopcode", "forking" ],
+	state     => "pinned",
+	in_reqs   => [ "gp" ],
+	out_reqs  => "...",
+	ins       => [ "selector" ],
+	attr_type => "aarch64_switch_jmp_attr_t",
+	attr      => "const ir_switch_table *table",
+	fixed     => "unsigned bits = 64;",
+},
+
+bl => {
+	state     => "exc_pinned",
+	irn_flags => [ "modify_flags" ],
+	in_reqs   => "...",
+	out_reqs  => "...",
+	ins       => [ "mem", "stack", "first_argument" ],
+	outs      => [ "M", "stack", "first_result" ],
+	attr_type => "aarch64_address_attr_t",
+	attr      => "ir_entity *entity, int32_t offset",
+	fixed     => "unsigned bits = 64;",
+	emit      => 'bl %I',
+},
+
+blr => {
+	state     => "exc_pinned",
+	irn_flags => [ "modify_flags" ],
+	in_reqs   => "...",
+	out_reqs  => "...",
+	ins       => [ "mem", "stack", "callee", "first_argument" ],
+	outs      => [ "M", "stack", "first_result" ],
+	fixed     => "unsigned bits = 64;",
+	emit      => 'blr %S2',
+},
+
+ret => {
+	state     => "pinned",
+	op_flags  => [ "cfopcode" ],
+	in_reqs   => "...",
+	ins       => [ "mem", "sp", "first_result" ],
+	out_reqs  => [ "exec" ],
+	fixed     => "unsigned bits = 64;",
+	emit      => 'ret',
+	encode    => 'be_emit32(0xD65F03C0)',
+},
+
+brk => {
+	state     => "pinned",
+	in_reqs   => [ "mem" ],
+	out_reqs  => [ "mem" ],
+	ins       => [ "mem" ],
+	attr_type => "aarch64_imm_attr_t",
+	attr      => "uint64_t imm",
+	fixed     => "unsigned bits = 64;",
+	emit      => 'brk #%i',
+	encode    => 'be_emit32(0xD4200000 | (uint32_t)get_aarch64_imm_attr_const(node)->imm << 5)',
+},
+
+fadd => {
+	template => $fbinop,
+	emit     => 'fadd %D0, %S0, %S1',
+	encode   => 'aarch64_enc_fp(node, 0x1E202800)',
+	latency  => 4,
+},
+
+fsub => {
+	template => $fbinop,
+	emit     => 'fsub %D0, %S0, %S1',
+	encode   => 'aarch64_enc_fp(node, 0x1E203800)',
+	latency  => 4,
+},
+
+fmul => {
+	template => $fbinop,
+	emit     => 'fmul %D0, %S0, %S1',
+	encode   => 'aarch64_enc_fp(node, 0x1E200800)',
+	latency  => 4,
+},
+
+fdiv => {
+	template => $fbinop,
+	emit     => 'fdiv %D0, %S0, %S1',
+	encode   => 'aarch64_enc_fp(node, 0x1E201800)',
+	latency  => 15,
+},
+
+fneg => {
+	irn_flags => [ "rematerializable" ],
+	in_reqs   => [ "neon" ],
+	out_reqs  => [ "neon" ],
+	ins       => [ "val" ],
+	attr      => "unsigned bits",
+	emit      => 'fneg %D0, %S0',
+	encode    => 'aarch64_enc_fp(node, 0x1E214000)',
+},
+
+fcmp => {
+	irn_flags => [ "rematerializable", "modify_flags" ],
+	in_reqs   => [ "neon", "neon" ],
+	out_reqs  => [ "flags" ],
+	ins       => [ "left", "right" ],
+	attr      => "unsigned bits",
+	emit      => 'fcmp %S0, %S1',
+},
+
+fcvt => {
+	template => $conv,
+	in_reqs  => [ "neon" ],
+	out_reqs => [ "neon" ],
+	emit     => 'fcvt %D0, %FS0',
+	latency  => 4,
+},
+
+scvtf => {
+	template => $conv,
+	in_reqs  => [ "gp" ],
+	out_reqs => [ "neon" ],
+	emit     => 'scvtf %D0, %FS0',
+	encode   => 'aarch64_enc_fcvt_int(node, 0x1E220000)',
+	latency  => 5,
+},
+
+ucvtf => {
+	template => $conv,
+	in_reqs  => [ "gp" ],
+	out_reqs => [ "neon" ],
+	emit     => 'ucvtf %D0, %FS0',
+	encode   => 'aarch64_enc_fcvt_int(node, 0x1E230000)',
+	latency  => 5,
+},
+
+fcvtzs => {
+	template => $conv,
+	in_reqs  => [ "neon" ],
+	out_reqs => [ "gp" ],
+	emit     => 'fcvtzs %D0, %FS0',
+	encode   => 'aarch64_enc_fcvt_int(node, 0x1E380000)',
+	latency  => 5,
+},
+
+fcvtzu => {
+	template => $conv,
+	in_reqs  => [ "neon" ],
+	out_reqs => [ "gp" ],
+	emit     => 'fcvtzu %D0, %FS0',
+	encode   => 'aarch64_enc_fcvt_int(node, 0x1E390000)',
+	latency  => 5,
+},
+
+fmov_to_fp => {
+	irn_flags => [ "rematerializable" ],
+	in_reqs   => [ "gp" ],
+	out_reqs  => [ "neon" ],
+	ins       => [ "val" ],
+	attr      => "unsigned bits",
+	emit      => 'fmov %D0, %S0',
+	latency   => 5,
+},
+
+fmov_from_fp => {
+	irn_flags => [ "rematerializable" ],
+	in_reqs   => [ "neon" ],
+	out_reqs  => [ "gp" ],
+	ins       => [ "val" ],
+	attr      => "unsigned bits",
+	emit      => 'fmov %D0, %S0',
+	latency   => 5,
+},
+
+);
+
+# Ops without an explicit latency are assumed to take a single cycle.
+foreach my $op (keys(%nodes)) {
+	my $node         = $nodes{$op};
+	my $op_attr_init = $node->{op_attr_init};
+
+	if (defined($op_attr_init)) {
+		$op_attr_init .= "\n\t";
+	} else {
+		$op_attr_init = "";
+	}
+
+	my $latency = $node->{latency} // 1;
+	$op_attr_init .= "aarch64_init_op(op, $latency);";
+
+	$node->{op_attr_init} = $op_attr_init;
+}
+
+print "";
@@ -0,0 +1,1697 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   code selection (transform FIRM into AArch64 FIRM)
+ */
+#include "aarch64_transform.h"
+
+#include "aarch64_cconv.h"
+#include "aarch64_encode.h"
+#include "aarch64_new_nodes.h"
+#include "bearch_aarch64_t.h"
+#include "beirg.h"
+#include "benode.h"
+#include "betranshlp.h"
+#include "debug.h"
+#include "gen_aarch64_regalloc_if.h"
+#include "ircons.h"
+#include "iredges_t.h"
+#include "irgraph_t.h"
+#include "irmode_t.h"
+#include "irnode_t.h"
+#include "panic.h"
+#include "tv_t.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
+
+static const arch_register_t *sp_reg = &aarch64_registers[REG_SP];
+static be_stack_env_t         stack_env;
+static calling_convention_t  *cconv = NULL;
+
+static const arch_register_t *const callee_saves[] = {
+	&aarch64_registers[REG_X19],
+	&aarch64_registers[REG_X20],
+	&aarch64_registers[REG_X21],
+	&aarch64_registers[REG_X22],
+	&aarch64_registers[REG_X23],
+	&aarch64_registers[REG_X24],
+	&aarch64_registers[REG_X25],
+	&aarch64_registers[REG_X26],
+	&aarch64_registers[REG_X27],
+	&aarch64_registers[REG_X28],
+	&aarch64_registers[REG_X29],
+	&aarch64_registers[REG_X30],
+	&aarch64_registers[REG_V8],
+	&aarch64_registers[REG_V9],
+	&aarch64_registers[REG_V10],
+	&aarch64_registers[REG_V11],
+	&aarch64_registers[REG_V12],
+	&aarch64_registers[REG_V13],
+	&aarch64_registers[REG_V14],
+	&aarch64_registers[REG_V15],
+};
+
+static const arch_register_t *const caller_saves[] = {
+	&aarch64_registers[REG_X0],
+	&aarch64_registers[REG_X1],
+	&aarch64_registers[REG_X2],
+	&aarch64_registers[REG_X3],
+	&aarch64_registers[REG_X4],
+	&aarch64_registers[REG_X5],
+	&aarch64_registers[REG_X6],
+	&aarch64_registers[REG_X7],
+	&aarch64_registers[REG_X8],
+	&aarch64_registers[REG_X9],
+	&aarch64_registers[REG_X10],
+	&aarch64_registers[REG_X11],
+	&aarch64_registers[REG_X12],
+	&aarch64_registers[REG_X13],
+	&aarch64_registers[REG_X14],
+	&aarch64_registers[REG_X15],
+	&aarch64_registers[REG_X30],
+
+	&aarch64_registers[REG_V0],
+	&aarch64_registers[REG_V1],
+	&aarch64_registers[REG_V2],
+	&aarch64_registers[REG_V3],
+	&aarch64_registers[REG_V4],
+	&aarch64_registers[REG_V5],
+	&aarch64_registers[REG_V6],
+	&aarch64_registers[REG_V7],
+	&aarch64_registers[REG_V16],
+	&aarch64_registers[REG_V17],
+	&aarch64_registers[REG_V18],
+	&aarch64_registers[REG_V19],
+	&aarch64_registers[REG_V20],
+	&aarch64_registers[REG_V21],
+	&aarch64_registers[REG_V22],
+	&aarch64_registers[REG_V23],
+	&aarch64_registers[REG_V24],
+	&aarch64_registers[REG_V25],
+	&aarch64_registers[REG_V26],
+	&aarch64_registers[REG_V27],
+	&aarch64_registers[REG_V28],
+	&aarch64_registers[REG_V29],
+	&aarch64_registers[REG_V30],
+	&aarch64_registers[REG_V31],
+};
+
+static ir_node *get_initial_sp(ir_graph *const irg)
+{
+	return be_get_Start_proj(irg, sp_reg);
+}
+
+/**
+ * Returns the width of the registers an operation in @p mode works on.
+ * Values smaller than 32 bits live in the W registers.
+ */
+static unsigned get_bits(ir_mode const *const mode)
+{
+	return get_mode_size_bits(mode) <= 32 ? 32 : 64;
+}
+
+/**
+ * Returns the bits of @p tv as they appear in a register of width @p bits.
+ * Small signed values are sign extended to 32 bits.
+ */
+static uint64_t get_tarval_register_value(ir_tarval *const tv,
+                                          unsigned const bits)
+{
+	ir_mode *const mode  = get_tarval_mode(tv);
+	unsigned const size  = get_mode_size_bits(mode);
+	uint64_t       value = 0;
+	for (unsigned i = 0; i < size / 8; ++i)
+		value |= (uint64_t)get_tarval_sub_bits(tv, i) << (8 * i);
+	if (mode_is_int(mode) && mode_is_signed(mode) && size < 64
+	 && (value >> (size - 1)) & 1)
+		value |= ~UINT64_C(0) << size;
+	if (bits == 32)
+		value &= UINT32_MAX;
+	return value;
+}
+
+static bool is_int_const(ir_node const *const node, unsigned const bits,
+                         uint64_t *const value)
+{
+	if (!is_Const(node))
+		return false;
+	ir_mode *const mode = get_irn_mode(node);
+	if (!mode_is_int(mode) && !mode_is_reference(mode))
+		return false;
+	*value = get_tarval_register_value(get_Const_tarval(node), bits);
+	return true;
+}
+
+/**
+ * Tries to encode @p node as immediate of an arithmetic instruction, if
+ * @p negate is set the negated value is encoded.
+ */
+static bool match_arith_imm(ir_node const *const node, unsigned const bits,
+                            bool const negate, uint64_t *const imm,
+                            unsigned *const amount)
+{
+	uint64_t value;
+	if (!is_int_const(node, bits, &value))
+		return false;
+	if (negate) {
+		value = -value;
+		if (bits == 32)
+			value &= UINT32_MAX;
+	}
+	return aarch64_encode_arith_imm(value, imm, amount);
+}
+
+/** Tries to encode @p node as bitmask immediate of a logical instruction. */
+static bool match_logical_imm(ir_node const *const node, unsigned const bits,
+                              uint64_t *const imm)
+{
+	uint64_t value;
+	uint32_t enc;
+	if (!is_int_const(node, bits, &value)
+	 || !aarch64_encode_logical_imm(value, bits, &enc))
+		return false;
+	*imm = value;
+	return true;
+}
+
+/**
+ * Checks whether @p node is a shift by a constant, which can be folded into
+ * the second operand of an instruction of width @p bits.
+ */
+static bool match_shifted_operand(ir_node const *const node,
+                                  unsigned const bits, ir_node **const value,
+                                  aarch64_shift_t *const shift,
+                                  unsigned *const amount)
+{
+	aarch64_shift_t kind;
+	switch (get_irn_opcode(node)) {
+	case iro_Shl:  kind = AARCH64_SHIFT_LSL; break;
+	case iro_Shr:  kind = AARCH64_SHIFT_LSR; break;
+	case iro_Shrs: kind = AARCH64_SHIFT_ASR; break;
+	default:       return false;
+	}
+
+	/* the lower bits of a left shift do not depend on the upper bits, right
+	 * shifts must have the width of the instruction */
+	ir_mode *const mode = get_irn_mode(node);
+	if (kind != AARCH64_SHIFT_LSL && get_mode_size_bits(mode) != bits)
+		return false;
+
+	ir_node *const right = get_binop_right(node);
+	if (!is_Const(right))
+		return false;
+	ir_tarval *const tv = get_Const_tarval(right);
+	if (!tarval_is_long(tv))
+		return false;
+	long const val = get_tarval_long(tv);
+	if (val < 0 || val >= (long)bits)
+		return false;
+
+	*value  = get_binop_left(node);
+	*shift  = kind;
+	*amount = (unsigned)val;
+	return true;
+}
+
+static ir_node *gen_extension(dbg_info *const dbgi, ir_node *const block,
+                              ir_node *const op, ir_mode *const orig_mode)
+{
+	unsigned const bits = get_mode_size_bits(orig_mode);
+	if (bits >= 32)
+		return op;
+
+	if (mode_is_signed(orig_mode)) {
+		return new_bd_aarch64_sxt(dbgi, block, op, 32, bits);
+	} else {
+		return new_bd_aarch64_uxt(dbgi, block, op, 32, bits);
+	}
+}
+
+/**
+ * Transforms @p node and makes sure that the upper bits of a value smaller
+ * than 32 bits are a proper extension.
+ */
+static ir_node *transform_extended(dbg_info *const dbgi, ir_node *const block,
+                                   ir_node *const node)
+{
+	ir_node *const new_node = be_transform_node(node);
+	ir_mode *const mode     = get_irn_mode(node);
+	if (get_mode_size_bits(mode) >= 32 || be_upper_bits_clean(node, mode))
+		return new_node;
+	return gen_extension(dbgi, block, new_node, mode);
+}
+
+typedef enum match_flags_t {
+	MATCH_NONE         = 0,
+	MATCH_COMMUTATIVE  = 1 << 0, /**< commutative operation */
+	MATCH_SIZE_NEUTRAL = 1 << 1, /**< lower bits of the result only depend on
+	                                  the lower bits of the operands */
+	MATCH_LOGICAL_IMM  = 1 << 2, /**< immediates are bitmasks */
+} match_flags_t;
+ENUM_BITSET(match_flags_t)
+
+/**
+ * possible binop constructors.
+ */
+typedef struct aarch64_binop_factory_t {
+	/** reg op reg operation */
+	ir_node *(*new_binop_reg)(dbg_info *dbgi, ir_node *block, ir_node *left, ir_node *right, unsigned bits);
+	/** reg op imm operation, may be NULL */
+	ir_node *(*new_binop_imm)(dbg_info *dbgi, ir_node *block, ir_node *left, unsigned bits, uint64_t immediate, unsigned amount);
+	/** reg op (reg shift imm) operation */
+	ir_node *(*new_binop_reg_shift)(dbg_info *dbgi, ir_node *block, ir_node *left, ir_node *right, unsigned bits, aarch64_shift_t shift, unsigned amount);
+} aarch64_binop_factory_t;
+
+static const aarch64_binop_factory_t add_factory = {
+	new_bd_aarch64_add_reg,
+	new_bd_aarch64_add_imm,
+	new_bd_aarch64_add_reg_shift,
+};
+
+static const aarch64_binop_factory_t sub_factory = {
+	new_bd_aarch64_sub_reg,
+	new_bd_aarch64_sub_imm,
+	new_bd_aarch64_sub_reg_shift,
+};
+
+static const aarch64_binop_factory_t and_factory = {
+	new_bd_aarch64_and_reg,
+	new_bd_aarch64_and_imm,
+	new_bd_aarch64_and_reg_shift,
+};
+
+static const aarch64_binop_factory_t bic_factory = {
+	new_bd_aarch64_bic_reg,
+	NULL,
+	new_bd_aarch64_bic_reg_shift,
+};
+
+static const aarch64_binop_factory_t orr_factory = {
+	new_bd_aarch64_orr_reg,
+	new_bd_aarch64_orr_imm,
+	new_bd_aarch64_orr_reg_shift,
+};
+
+static const aarch64_binop_factory_t orn_factory = {
+	new_bd_aarch64_orn_reg,
+	NULL,
+	new_bd_aarch64_orn_reg_shift,
+};
+
+static const aarch64_binop_factory_t eor_factory = {
+	new_bd_aarch64_eor_reg,
+	new_bd_aarch64_eor_imm,
+	new_bd_aarch64_eor_reg_shift,
+};
+
+static const aarch64_binop_factory_t eon_factory = {
+	new_bd_aarch64_eon_reg,
+	NULL,
+	new_bd_aarch64_eon_reg_shift,
+};
+
+static const aarch64_binop_factory_t tst_factory = {
+	new_bd_aarch64_tst_reg,
+	new_bd_aarch64_tst_imm,
+	new_bd_aarch64_tst_reg_shift,
+};
+
+/**
+ * Creates an integer operation of width @p bits, folding immediates and
+ * shifted operands into the second operand. If @p neg_factory is given, it
+ * is used for immediates which are only encodable when negated.
+ */
+static ir_node *gen_int_binop_ops(ir_node *const node, ir_node *op1,
+                                  ir_node *op2, unsigned const bits,
+                                  match_flags_t const flags,
+                                  aarch64_binop_factory_t const *const factory,
+                                  aarch64_binop_factory_t const *const neg_factory)
+{
+	ir_node  *const block = be_transform_nodes_block(node);
+	dbg_info *const dbgi  = get_irn_dbg_info(node);
+
+	if (flags & MATCH_SIZE_NEUTRAL) {
+		op1 = be_skip_downconv(op1, true);
+		op2 = be_skip_downconv(op2, true);
+	} else {
+		op1 = be_skip_sameconv(op1);
+		op2 = be_skip_sameconv(op2);
+	}
+
+	if ((flags & MATCH_COMMUTATIVE) && is_Const(op1)) {
+		ir_node *const tmp = op1;
+		op1 = op2;
+		op2 = tmp;
+	}
+
+	if (factory->new_binop_imm != NULL) {
+		uint64_t imm;
+		unsigned amount = 0;
+		bool     match;
+		if (flags & MATCH_LOGICAL_IMM) {
+			match = match_logical_imm(op2, bits, &imm);
+		} else {
+			match = match_arith_imm(op2, bits, false, &imm, &amount);
+		}
+		if (match) {
+			ir_node *const new_op1 = be_transform_node(op1);
+			return factory->new_binop_imm(dbgi, block, new_op1, bits, imm,
+			                              amount);
+		}
+		if (neg_factory != NULL
+		 && match_arith_imm(op2, bits, true, &imm, &amount)) {
+			ir_node *const new_op1 = be_transform_node(op1);
+			return neg_factory->new_binop_imm(dbgi, block, new_op1, bits, imm,
+			                                  amount);
+		}
+	}
+
+	ir_node        *shifted;
+	aarch64_shift_t shift;
+	unsigned        amount;
+	if (!match_shifted_operand(op2, bits, &shifted, &shift, &amount)) {
+		if (!(flags & MATCH_COMMUTATIVE)
+		 || !match_shifted_operand(op1, bits, &shifted, &shift, &amount)) {
+			ir_node *const new_op1 = be_transform_node(op1);
+			ir_node *const new_op2 = be_transform_node(op2);
+			return factory->new_binop_reg(dbgi, block, new_op1, new_op2, bits);
+		}
+		op1 = op2;
+	}
+	ir_node *const new_op1     = be_transform_node(op1);
+	ir_node *const new_shifted = be_transform_node(shifted);
+	return factory->new_binop_reg_shift(dbgi, block, new_op1, new_shifted,
+	                                    bits, shift, amount);
+}
+
+typedef ir_node *(*new_binop_func)(dbg_info *dbgi, ir_node *block,
+                                   ir_node *left, ir_node *right,
+                                   unsigned bits);
+
+static ir_node *gen_binop(ir_node *const node, ir_node *const op1,
+                          ir_node *const op2, new_binop_func const func)
+{
+	dbg_info *const dbgi    = get_irn_dbg_info(node);
+	ir_node  *const block   = be_transform_nodes_block(node);
+	ir_node  *const new_op1 = be_transform_node(op1);
+	ir_node  *const new_op2 = be_transform_node(op2);
+	unsigned  const bits    = get_mode_size_bits(get_irn_mode(node));
+	return func(dbgi, block, new_op1, new_op2, bits);
+}
+
+/**
+ * Checks whether the Mul @p node may be merged into the multiply-add
+ * @p user.
+ */
+static bool is_foldable_mul(ir_node const *const node,
+                            ir_node const *const user)
+{
+	return is_Mul(node) && get_irn_n_edges(node) == 1
+	    && get_nodes_block(node) == get_nodes_block(user)
+	    && get_bits(get_irn_mode(node)) == get_bits(get_irn_mode(user));
+}
+
+static ir_node *gen_rotl(ir_node *const node, ir_node *const op,
+                         ir_node *const amount)
+{
+	dbg_info *const dbgi   = get_irn_dbg_info(node);
+	ir_node  *const block  = be_transform_nodes_block(node);
+	ir_node  *const new_op = be_transform_node(op);
+	unsigned  const bits   = get_mode_size_bits(get_irn_mode(node));
+	if (is_Const(amount)) {
+		long const val = get_Const_long(amount);
+		return new_bd_aarch64_ror_imm(dbgi, block, new_op, bits,
+		                              (bits - val) % bits);
+	}
+	/* rotating left is rotating right by the negated amount */
+	ir_node *const new_amount = be_transform_node(amount);
+	ir_node *const neg        = new_bd_aarch64_neg(dbgi, block, new_amount,
+	                                               32);
+	return new_bd_aarch64_rorv(dbgi, block, new_op, neg, bits);
+}
+
+/**
+ * Matches a left rotation, which only exists for full width registers.
+ */
+static ir_node *match_rotl(ir_node *const node)
+{
+	ir_node *rotl_left;
+	ir_node *rotl_right;
+	ir_mode *const mode = get_irn_mode(node);
+	if (get_mode_size_bits(mode) == get_bits(mode)
+	 && be_pattern_is_rotl(node, &rotl_left, &rotl_right))
+		return gen_rotl(node, rotl_left, rotl_right);
+	return NULL;
+}
+
+static ir_node *gen_Add(ir_node *node)
+{
+	ir_mode *const mode  = get_irn_mode(node);
+	ir_node *const left  = get_Add_left(node);
+	ir_node *const right = get_Add_right(node);
+	if (mode_is_float(mode))
+		return gen_binop(node, left, right, new_bd_aarch64_fadd);
+
+	ir_node *const rotl = match_rotl(node);
+	if (rotl != NULL)
+		return rotl;
+
+	unsigned const bits = get_bits(mode);
+	ir_node       *mul;
+	ir_node       *other;
+	if (is_foldable_mul(left, node)) {
+		mul   = left;
+		other = right;
+	} else if (is_foldable_mul(right, node)) {
+		mul   = right;
+		other = left;
+	} else {
+		return gen_int_binop_ops(node, left, right, bits,
+		                         MATCH_COMMUTATIVE | MATCH_SIZE_NEUTRAL,
+		                         &add_factory, &sub_factory);
+	}
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const block     = be_transform_nodes_block(node);
+	ir_node  *const new_left  = be_transform_node(get_Mul_left(mul));
+	ir_node  *const new_right = be_transform_node(get_Mul_right(mul));
+	ir_node  *const new_other = be_transform_node(other);
+	return new_bd_aarch64_madd(dbgi, block, new_left, new_right, new_other,
+	                           bits);
+}
+
+static ir_node *gen_Sub(ir_node *node)
+{
+	ir_mode *const mode  = get_irn_mode(node);
+	ir_node *const left  = get_Sub_left(node);
+	ir_node *const right = get_Sub_right(node);
+	if (mode_is_float(mode))
+		return gen_binop(node, left, right, new_bd_aarch64_fsub);
+
+	unsigned const bits = get_bits(mode);
+	if (is_foldable_mul(right, node)) {
+		dbg_info *const dbgi      = get_irn_dbg_info(node);
+		ir_node  *const block     = be_transform_nodes_block(node);
+		ir_node  *const new_left  = be_transform_node(get_Mul_left(right));
+		ir_node  *const new_right = be_transform_node(get_Mul_right(right));
+		ir_node  *const new_acc   = be_transform_node(left);
+		return new_bd_aarch64_msub(dbgi, block, new_left, new_right, new_acc,
+		                           bits);
+	}
+	return gen_int_binop_ops(node, left, right, bits, MATCH_SIZE_NEUTRAL,
+	                         &sub_factory, &add_factory);
+}
+
+static ir_node *gen_logical(ir_node *const node,
+                            aarch64_binop_factory_t const *const factory,
+                            aarch64_binop_factory_t const *const not_factory)
+{
+	ir_node *left  = get_binop_left(node);
+	ir_node *right = get_binop_right(node);
+	if (is_Not(left) && !is_Not(right)) {
+		ir_node *const tmp = left;
+		left  = right;
+		right = tmp;
+	}
+
+	unsigned const bits = get_bits(get_irn_mode(node));
+	if (is_Not(right)) {
+		return gen_int_binop_ops(node, left, get_Not_op(right), bits,
+		                         MATCH_SIZE_NEUTRAL, not_factory, NULL);
+	}
+	return gen_int_binop_ops(node, left, right, bits,
+	                         MATCH_COMMUTATIVE | MATCH_SIZE_NEUTRAL
+	                         | MATCH_LOGICAL_IMM, factory, NULL);
+}
+
+static ir_node *gen_And(ir_node *node)
+{
+	return gen_logical(node, &and_factory, &bic_factory);
+}
+
+static ir_node *gen_Or(ir_node *node)
+{
+	ir_node *const rotl = match_rotl(node);
+	if (rotl != NULL)
+		return rotl;
+	return gen_logical(node, &orr_factory, &orn_factory);
+}
+
+static ir_node *gen_Eor(ir_node *node)
+{
+	return gen_logical(node, &eor_factory, &eon_factory);
+}
+
+static ir_node *gen_Mul(ir_node *node)
+{
+	ir_mode *const mode = get_irn_mode(node);
+	ir_node       *left = get_Mul_left(node);
+	ir_node       *right = get_Mul_right(node);
+	if (mode_is_float(mode))
+		return gen_binop(node, left, right, new_bd_aarch64_fmul);
+
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const block     = be_transform_nodes_block(node);
+	ir_node  *const new_left  = be_transform_node(be_skip_downconv(left, true));
+	ir_node  *const new_right = be_transform_node(be_skip_downconv(right, true));
+	return new_bd_aarch64_mul(dbgi, block, new_left, new_right, get_bits(mode));
+}
+
+static ir_node *gen_Mulh(ir_node *node)
+{
+	dbg_info *const dbgi   = get_irn_dbg_info(node);
+	ir_node  *const block  = be_transform_nodes_block(node);
+	ir_mode  *const mode   = get_irn_mode(node);
+	unsigned  const size   = get_mode_size_bits(mode);
+	bool      const sign   = mode_is_signed(mode);
+	ir_node  *const left   = get_Mulh_left(node);
+	ir_node  *const right  = get_Mulh_right(node);
+	if (size == 64) {
+		ir_node *const new_left  = be_transform_node(left);
+		ir_node *const new_right = be_transform_node(right);
+		return sign ? new_bd_aarch64_smulh(dbgi, block, new_left, new_right, 64)
+		            : new_bd_aarch64_umulh(dbgi, block, new_left, new_right, 64);
+	}
+
+	/* compute the full product in a 64bit register and extract the upper
+	 * half */
+	ir_node *const new_left  = transform_extended(dbgi, block, left);
+	ir_node *const new_right = transform_extended(dbgi, block, right);
+	if (sign) {
+		ir_node *const mul = new_bd_aarch64_smull(dbgi, block, new_left,
+		                                          new_right, 64);
+		return new_bd_aarch64_asr_imm(dbgi, block, mul, 64, size);
+	} else {
+		ir_node *const mul = new_bd_aarch64_umull(dbgi, block, new_left,
+		                                          new_right, 64);
+		return new_bd_aarch64_lsr_imm(dbgi, block, mul, 64, size);
+	}
+}
+
+static ir_node *gen_int_div(dbg_info *const dbgi, ir_node *const block,
+                            ir_node *const new_left, ir_node *const new_right,
+                            ir_mode *const mode)
+{
+	unsigned const bits = get_bits(mode);
+	if (mode_is_signed(mode)) {
+		return new_bd_aarch64_sdiv(dbgi, block, new_left, new_right, bits);
+	} else {
+		return new_bd_aarch64_udiv(dbgi, block, new_left, new_right, bits);
+	}
+}
+
+static ir_node *gen_Div(ir_node *node)
+{
+	ir_mode *const mode  = get_Div_resmode(node);
+	ir_node *const left  = get_Div_left(node);
+	ir_node *const right = get_Div_right(node);
+	if (mode_is_float(mode))
+		return gen_binop(node, left, right, new_bd_aarch64_fdiv);
+
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const block     = be_transform_nodes_block(node);
+	ir_node  *const new_left  = transform_extended(dbgi, block, left);
+	ir_node  *const new_right = transform_extended(dbgi, block, right);
+	return gen_int_div(dbgi, block, new_left, new_right, mode);
+}
+
+static ir_node *gen_Mod(ir_node *node)
+{
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const block     = be_transform_nodes_block(node);
+	ir_mode  *const mode      = get_Mod_resmode(node);
+	ir_node  *const new_left  = transform_extended(dbgi, block, get_Mod_left(node));
+	ir_node  *const new_right = transform_extended(dbgi, block, get_Mod_right(node));
+
+	/* left - (left / right) * right */
+	ir_node *const div = gen_int_div(dbgi, block, new_left, new_right, mode);
+	return new_bd_aarch64_msub(dbgi, block, div, new_right, new_left,
+	                           get_bits(mode));
+}
+
+typedef ir_node *(*new_shift_imm_func)(dbg_info *dbgi, ir_node *block,
+                                       ir_node *val, unsigned bits,
+                                       uint64_t imm);
+
+static ir_node *gen_shift(ir_node *const node, new_shift_imm_func const new_imm,
+                          new_binop_func const new_reg)
+{
+	dbg_info *const dbgi  = get_irn_dbg_info(node);
+	ir_node  *const block = be_transform_nodes_block(node);
+	ir_mode  *const mode  = get_irn_mode(node);
+	unsigned  const bits  = get_bits(mode);
+	ir_node  *const left  = get_binop_left(node);
+	ir_node  *const right = get_binop_right(node);
+
+	/* the lower bits of a left shift only depend on the lower bits of the
+	 * operand, right shifts need the value properly extended */
+	ir_node *new_left;
+	if (is_Shl(node)) {
+		new_left = be_transform_node(be_skip_downconv(left, true));
+	} else {
+		new_left = transform_extended(dbgi, block, left);
+	}
+
+	if (is_Const(right)) {
+		ir_tarval *const tv = get_Const_tarval(right);
+		if (tarval_is_long(tv)) {
+			unsigned const modulo = get_mode_modulo_shift(mode);
+			unsigned const val    = (unsigned long)get_tarval_long(tv) % modulo;
+			if (val < bits)
+				return new_imm(dbgi, block, new_left, bits, val);
+		}
+	}
+
+	ir_node *const new_right = be_transform_node(right);
+	return new_reg(dbgi, block, new_left, new_right, bits);
+}
+
+static ir_node *gen_Shl(ir_node *node)
+{
+	return gen_shift(node, new_bd_aarch64_lsl_imm, new_bd_aarch64_lslv);
+}
+
+static ir_node *gen_Shr(ir_node *node)
+{
+	return gen_shift(node, new_bd_aarch64_lsr_imm, new_bd_aarch64_lsrv);
+}
+
+static ir_node *gen_Shrs(ir_node *node)
+{
+	return gen_shift(node, new_bd_aarch64_asr_imm, new_bd_aarch64_asrv);
+}
+
+static ir_node *gen_Minus(ir_node *node)
+{
+	dbg_info *const dbgi   = get_irn_dbg_info(node);
+	ir_node  *const block  = be_transform_nodes_block(node);
+	ir_node  *const op     = get_Minus_op(node);
+	ir_mode  *const mode   = get_irn_mode(node);
+	if (mode_is_float(mode)) {
+		ir_node *const new_op = be_transform_node(op);
+		return new_bd_aarch64_fneg(dbgi, block, new_op,
+		                           get_mode_size_bits(mode));
+	}
+	ir_node *const new_op = be_transform_node(be_skip_downconv(op, true));
+	return new_bd_aarch64_neg(dbgi, block, new_op, get_bits(mode));
+}
+
+static ir_node *gen_Not(ir_node *node)
+{
+	dbg_info *const dbgi   = get_irn_dbg_info(node);
+	ir_node  *const block  = be_transform_nodes_block(node);
+	ir_node  *const op     = be_skip_downconv(get_Not_op(node), true);
+	ir_node  *const new_op = be_transform_node(op);
+	return new_bd_aarch64_mvn(dbgi, block, new_op,
+	                          get_bits(get_irn_mode(node)));
+}
+
+static ir_node *gen_Conv(ir_node *node)
+{
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const block     = be_transform_nodes_block(node);
+	ir_node  *const op        = get_Conv_op(node);
+	ir_mode  *const src_mode  = get_irn_mode(op);
+	ir_mode  *const dst_mode  = get_irn_mode(node);
+	unsigned  const src_bits  = get_mode_size_bits(src_mode);
+	unsigned  const dst_bits  = get_mode_size_bits(dst_mode);
+	bool      const src_float = mode_is_float(src_mode);
+	bool      const dst_float = mode_is_float(dst_mode);
+
+	if (src_mode == dst_mode)
+		return be_transform_node(op);
+
+	if (src_float && dst_float) {
+		ir_node *const new_op = be_transform_node(op);
+		return new_bd_aarch64_fcvt(dbgi, block, new_op, dst_bits, src_bits);
+	} else if (src_float) {
+		ir_node *const new_op = be_transform_node(op);
+		unsigned const bits   = get_bits(dst_mode);
+		if (mode_is_signed(dst_mode)) {
+			return new_bd_aarch64_fcvtzs(dbgi, block, new_op, bits, src_bits);
+		} else {
+			return new_bd_aarch64_fcvtzu(dbgi, block, new_op, bits, src_bits);
+		}
+	} else if (dst_float) {
+		ir_node *const new_op = transform_extended(dbgi, block, op);
+		unsigned const bits   = get_bits(src_mode);
+		if (mode_is_signed(src_mode)) {
+			return new_bd_aarch64_scvtf(dbgi, block, new_op, dst_bits, bits);
+		} else {
+			return new_bd_aarch64_ucvtf(dbgi, block, new_op, dst_bits, bits);
+		}
+	}
+
+	/* complete in gp registers, truncations are free */
+	if (src_bits >= dst_bits)
+		return be_transform_node(op);
+
+	if (dst_bits <= 32)
+		return transform_extended(dbgi, block, op);
+
+	ir_node *const new_op = be_transform_node(op);
+	if (mode_is_signed(src_mode)) {
+		return new_bd_aarch64_sxt(dbgi, block, new_op, 64, src_bits);
+	} else {
+		return new_bd_aarch64_uxt(dbgi, block, new_op, 64, src_bits);
+	}
+}
+
+static ir_node *gen_Bitcast(ir_node *node)
+{
+	dbg_info *const dbgi     = get_irn_dbg_info(node);
+	ir_node  *const block    = be_transform_nodes_block(node);
+	ir_node  *const op       = get_Bitcast_op(node);
+	ir_node  *const new_op   = be_transform_node(op);
+	ir_mode  *const dst_mode = get_irn_mode(node);
+	ir_mode  *const src_mode = get_irn_mode(op);
+	bool      const dst_float = mode_is_float(dst_mode);
+	bool      const src_float = mode_is_float(src_mode);
+	unsigned  const bits     = get_mode_size_bits(dst_mode);
+	if (src_float && !dst_float) {
+		return new_bd_aarch64_fmov_from_fp(dbgi, block, new_op, bits);
+	} else if (!src_float && dst_float) {
+		return new_bd_aarch64_fmov_to_fp(dbgi, block, new_op, bits);
+	}
+	return new_op;
+}
+
+static ir_node *gen_float_const(dbg_info *const dbgi, ir_node *const block,
+                                ir_tarval *const tv)
+{
+	/* materialize the bit pattern in a gp register and move it over */
+	unsigned const bits  = get_mode_size_bits(get_tarval_mode(tv));
+	uint64_t const value = get_tarval_register_value(tv, bits);
+	ir_node *const gp    = new_bd_aarch64_mov_imm(dbgi, block, bits, value);
+	return new_bd_aarch64_fmov_to_fp(dbgi, block, gp, bits);
+}
+
+static ir_node *gen_Const(ir_node *node)
+{
+	dbg_info  *const dbgi  = get_irn_dbg_info(node);
+	ir_node   *const block = be_transform_nodes_block(node);
+	ir_tarval *const tv    = get_Const_tarval(node);
+	ir_mode   *const mode  = get_irn_mode(node);
+	if (mode_is_float(mode))
+		return gen_float_const(dbgi, block, tv);
+
+	unsigned const bits = get_bits(mode);
+	return new_bd_aarch64_mov_imm(dbgi, block, bits,
+	                              get_tarval_register_value(tv, bits));
+}
+
+static ir_node *gen_Unknown(ir_node *node)
+{
+	dbg_info *const dbgi  = get_irn_dbg_info(node);
+	ir_node  *const block = be_transform_nodes_block(node);
+
+	/* just produce a 0 */
+	ir_mode *const mode = get_irn_mode(node);
+	if (mode_is_float(mode)) {
+		return gen_float_const(dbgi, block, get_mode_null(mode));
+	} else if (get_mode_arithmetic(mode) == irma_twos_complement) {
+		return new_bd_aarch64_mov_imm(dbgi, block, get_bits(mode), 0);
+	}
+	panic("unexpected Unknown mode");
+}
+
+static ir_node *gen_Address(ir_node *node)
+{
+	dbg_info  *const dbgi   = get_irn_dbg_info(node);
+	ir_node   *const block  = be_transform_nodes_block(node);
+	ir_entity *const entity = get_Address_entity(node);
+	return new_bd_aarch64_address(dbgi, block, entity, 0);
+}
+
+static ir_node *gen_Member(ir_node *node)
+{
+	dbg_info  *const dbgi    = get_irn_dbg_info(node);
+	ir_node   *const block   = be_transform_nodes_block(node);
+	ir_node   *const ptr     = get_Member_ptr(node);
+	ir_node   *const new_ptr = be_transform_node(ptr);
+	ir_entity *const entity  = get_Member_entity(node);
+
+	/* must be the frame pointer all other sels must have been lowered
+	 * already */
+	assert(is_Proj(ptr) && is_Start(get_Proj_pred(ptr)));
+
+	return new_bd_aarch64_FrameAddr(dbgi, block, new_ptr, entity, 0);
+}
+
+typedef struct aarch64_addr_t {
+	ir_node   *base;
+	ir_entity *entity;
+	int32_t    offset;
+	bool       is_frame_entity;
+} aarch64_addr_t;
+
+/**
+ * Folds constant offsets and frame entities into the address of a load or
+ * store accessing values of mode @p mode.
+ */
+static void match_address(ir_node *ptr, ir_mode *const mode,
+                          aarch64_addr_t *const addr)
+{
+	memset(addr, 0, sizeof(*addr));
+
+	if (is_Add(ptr)) {
+		ir_node *const right = get_Add_right(ptr);
+		if (is_Const(right)) {
+			ir_tarval *const tv   = get_Const_tarval(right);
+			unsigned   const size = get_mode_size_bytes(mode);
+			if (tarval_is_long(tv)
+			 && aarch64_is_load_store_offset(get_tarval_long(tv), size)) {
+				addr->offset = (int32_t)get_tarval_long(tv);
+				ptr          = get_Add_left(ptr);
+			}
+		}
+	}
+
+	if (is_Member(ptr)) {
+		ir_node *const member_ptr = get_Member_ptr(ptr);
+		if (is_Proj(member_ptr) && is_Start(get_Proj_pred(member_ptr))) {
+			addr->base            = be_transform_node(member_ptr);
+			addr->entity          = get_Member_entity(ptr);
+			addr->is_frame_entity = true;
+			return;
+		}
+	}
+	addr->base = be_transform_node(ptr);
+}
+
+static ir_node *gen_Load(ir_node *node)
+{
+	dbg_info *const dbgi    = get_irn_dbg_info(node);
+	ir_node  *const block   = be_transform_nodes_block(node);
+	ir_node  *const new_mem = be_transform_node(get_Load_mem(node));
+	ir_mode  *const mode    = get_Load_mode(node);
+
+	aarch64_addr_t addr;
+	match_address(get_Load_ptr(node), mode, &addr);
+
+	ir_node *new_load;
+	if (mode_is_float(mode)) {
+		new_load = new_bd_aarch64_fldr(dbgi, block, addr.base, new_mem, mode,
+		                               addr.entity, addr.offset,
+		                               addr.is_frame_entity);
+	} else {
+		assert(mode_is_data(mode) && "unsupported mode for Load");
+		new_load = new_bd_aarch64_ldr(dbgi, block, addr.base, new_mem, mode,
+		                              addr.entity, addr.offset,
+		                              addr.is_frame_entity);
+	}
+	set_irn_pinned(new_load, get_irn_pinned(node));
+
+	return new_load;
+}
+
+static ir_node *gen_Store(ir_node *node)
+{
+	dbg_info *const dbgi    = get_irn_dbg_info(node);
+	ir_node  *const block   = be_transform_nodes_block(node);
+	ir_node  *const new_mem = be_transform_node(get_Store_mem(node));
+	ir_node  *const val     = get_Store_value(node);
+	ir_mode  *const mode    = get_irn_mode(val);
+
+	aarch64_addr_t addr;
+	match_address(get_Store_ptr(node), mode, &addr);
+
+	ir_node *new_store;
+	if (mode_is_float(mode)) {
+		ir_node *const new_val = be_transform_node(val);
+		new_store = new_bd_aarch64_fstr(dbgi, block, addr.base, new_val,
+		                                new_mem, mode, addr.entity,
+		                                addr.offset, addr.is_frame_entity);
+	} else {
+		assert(mode_is_data(mode) && "unsupported mode for Store");
+		/* only the lower bits get stored */
+		ir_node *const new_val = be_transform_node(be_skip_downconv(val, false));
+		new_store = new_bd_aarch64_str(dbgi, block, addr.base, new_val,
+		                               new_mem, mode, addr.entity, addr.offset,
+		                               addr.is_frame_entity);
+	}
+	set_irn_pinned(new_store, get_irn_pinned(node));
+
+	return new_store;
+}
+
+static aarch64_cond_t get_float_cond(ir_relation const relation)
+{
+	switch (relation) {
+	case ir_relation_equal:                   return AARCH64_COND_EQ;
+	case ir_relation_less:                    return AARCH64_COND_MI;
+	case ir_relation_less_equal:              return AARCH64_COND_LS;
+	case ir_relation_greater:                 return AARCH64_COND_GT;
+	case ir_relation_greater_equal:           return AARCH64_COND_GE;
+	case ir_relation_less_equal_greater:      return AARCH64_COND_VC;
+	case ir_relation_unordered:               return AARCH64_COND_VS;
+	case ir_relation_unordered_less:          return AARCH64_COND_LT;
+	case ir_relation_unordered_less_equal:    return AARCH64_COND_LE;
+	case ir_relation_unordered_greater:       return AARCH64_COND_HI;
+	case ir_relation_unordered_greater_equal: return AARCH64_COND_PL;
+	case ir_relation_unordered_less_greater:  return AARCH64_COND_NE;
+	case ir_relation_true:                    return AARCH64_COND_AL;
+	default:
+		break;
+	}
+	panic("float relation %s not supported", get_relation_string(relation));
+}
+
+static aarch64_cond_t get_int_cond(ir_relation const relation,
+                                   bool const is_unsigned)
+{
+	switch (relation & ~ir_relation_unordered) {
+	case ir_relation_equal:
+		return AARCH64_COND_EQ;
+	case ir_relation_less_greater:
+		return AARCH64_COND_NE;
+	case ir_relation_less:
+		return is_unsigned ? AARCH64_COND_LO : AARCH64_COND_LT;
+	case ir_relation_less_equal:
+		return is_unsigned ? AARCH64_COND_LS : AARCH64_COND_LE;
+	case ir_relation_greater:
+		return is_unsigned ? AARCH64_COND_HI : AARCH64_COND_GT;
+	case ir_relation_greater_equal:
+		return is_unsigned ? AARCH64_COND_HS : AARCH64_COND_GE;
+	case ir_relation_less_equal_greater:
+		return AARCH64_COND_AL;
+	default:
+		break;
+	}
+	panic("invalid relation %s", get_relation_string(relation));
+}
+
+/** Returns the condition under which the Cmp @p cmp is true. */
+static aarch64_cond_t get_cmp_cond(ir_node const *const cmp)
+{
+	ir_relation const relation = get_Cmp_relation(cmp);
+	ir_mode    *const mode     = get_irn_mode(get_Cmp_left(cmp));
+	if (mode_is_float(mode))
+		return get_float_cond(relation);
+	return get_int_cond(relation, !mode_is_signed(mode));
+}
+
+static ir_node *gen_Cmp(ir_node *node)
+{
+	dbg_info *const dbgi     = get_irn_dbg_info(node);
+	ir_node  *const block    = be_transform_nodes_block(node);
+	ir_node  *const op1      = get_Cmp_left(node);
+	ir_node  *const op2      = get_Cmp_right(node);
+	ir_mode  *const cmp_mode = get_irn_mode(op1);
+	if (mode_is_float(cmp_mode)) {
+		ir_node *const new_op1 = be_transform_node(op1);
+		ir_node *const new_op2 = be_transform_node(op2);
+		return new_bd_aarch64_fcmp(dbgi, block, new_op1, new_op2,
+		                           get_mode_size_bits(cmp_mode));
+	}
+
+	assert(get_irn_mode(op2) == cmp_mode);
+	unsigned    const bits       = get_bits(cmp_mode);
+	bool        const full_width = get_mode_size_bits(cmp_mode) == bits;
+	ir_relation const relation   = get_Cmp_relation(node) & ~ir_relation_unordered;
+
+	/* test bits of an And against zero */
+	if (full_width && is_And(op1) && get_irn_n_edges(op1) == 1
+	 && is_Const(op2) && is_Const_null(op2)
+	 && (relation == ir_relation_equal || relation == ir_relation_less_greater)) {
+		return gen_int_binop_ops(node, get_And_left(op1), get_And_right(op1),
+		                         bits, MATCH_COMMUTATIVE | MATCH_LOGICAL_IMM,
+		                         &tst_factory, NULL);
+	}
+
+	ir_node *const new_op1 = transform_extended(dbgi, block, op1);
+	uint64_t       imm;
+	unsigned       amount;
+	if (match_arith_imm(op2, bits, false, &imm, &amount))
+		return new_bd_aarch64_cmp_imm(dbgi, block, new_op1, bits, imm, amount);
+	if (match_arith_imm(op2, bits, true, &imm, &amount))
+		return new_bd_aarch64_cmn_imm(dbgi, block, new_op1, bits, imm, amount);
+
+	ir_node        *shifted;
+	aarch64_shift_t shift;
+	if (full_width && match_shifted_operand(op2, bits, &shifted, &shift, &amount)) {
+		ir_node *const new_shifted = be_transform_node(shifted);
+		return new_bd_aarch64_cmp_reg_shift(dbgi, block, new_op1, new_shifted,
+		                                    bits, shift, amount);
+	}
+	ir_node *const new_op2 = transform_extended(dbgi, block, op2);
+	return new_bd_aarch64_cmp_reg(dbgi, block, new_op1, new_op2, bits);
+}
+
+static ir_node *gen_Cond(ir_node *node)
+{
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const block     = be_transform_nodes_block(node);
+	ir_node  *const selector  = get_Cond_selector(node);
+	ir_node  *const flag_node = be_transform_node(selector);
+	aarch64_cond_t const cond = get_cmp_cond(selector);
+	return new_bd_aarch64_b_cond(dbgi, block, flag_node, cond);
+}
+
+static ir_node *gen_Mux(ir_node *node)
+{
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const block     = be_transform_nodes_block(node);
+	ir_node  *const sel       = get_Mux_sel(node);
+	ir_node  *const flags     = be_transform_node(sel);
+	ir_node  *const val_true  = get_Mux_true(node);
+	ir_node  *const val_false = get_Mux_false(node);
+	unsigned  const bits      = get_bits(get_irn_mode(node));
+	aarch64_cond_t const cond = get_cmp_cond(sel);
+
+	if (is_Const(val_true) && is_Const(val_false)) {
+		if (is_Const_one(val_true) && is_Const_null(val_false))
+			return new_bd_aarch64_cset(dbgi, block, flags, bits, cond);
+		if (is_Const_null(val_true) && is_Const_one(val_false)) {
+			return new_bd_aarch64_cset(dbgi, block, flags, bits,
+			                           aarch64_negate_cond(cond));
+		}
+	}
+
+	ir_node *const new_true  = be_transform_node(val_true);
+	ir_node *const new_false = be_transform_node(val_false);
+	return new_bd_aarch64_csel(dbgi, block, new_true, new_false, flags, bits,
+	                           cond);
+}
+
+static ir_node *gen_Jmp(ir_node *node)
+{
+	dbg_info *const dbgi  = get_irn_dbg_info(node);
+	ir_node  *const block = be_transform_nodes_block(node);
+	return new_bd_aarch64_b(dbgi, block);
+}
+
+static ir_node *gen_Switch(ir_node *node)
+{
+	ir_graph              *irg      = get_irn_irg(node);
+	ir_node               *block    = be_transform_nodes_block(node);
+	ir_node               *selector = get_Switch_selector(node);
+	dbg_info              *dbgi     = get_irn_dbg_info(node);
+	ir_node               *new_op   = be_transform_node(selector);
+	const ir_switch_table *table    = get_Switch_table(node);
+	unsigned               n_outs   = get_Switch_n_outs(node);
+
+	table = ir_switch_table_duplicate(irg, table);
+
+	/* switch selector should be lowered to singled word already */
+	ir_mode *mode = get_irn_mode(selector);
+	if (get_mode_size_bits(mode) != 32)
+		panic("aarch64: unexpected switch selector mode");
+
+	return new_bd_aarch64_switch_jmp(dbgi, block, new_op, n_outs, table);
+}
+
+static ir_node *gen_Phi(ir_node *node)
+{
+	ir_mode                   *mode = get_irn_mode(node);
+	const arch_register_req_t *req;
+	if (get_mode_arithmetic(mode) == irma_twos_complement) {
+		req = aarch64_reg_classes[CLASS_aarch64_gp].class_req;
+	} else if (mode_is_float(mode)) {
+		req = aarch64_reg_classes[CLASS_aarch64_neon].class_req;
+	} else {
+		req = arch_memory_req;
+	}
+
+	return be_transform_phi(node, req);
+}
+
+static ir_node *gen_Builtin(ir_node *node)
+{
+	dbg_info       *const dbgi  = get_irn_dbg_info(node);
+	ir_node        *const block = be_transform_nodes_block(node);
+	ir_builtin_kind const kind  = get_Builtin_kind(node);
+	switch (kind) {
+	case ir_bk_trap:
+	case ir_bk_debugbreak: {
+		ir_node *const new_mem = be_transform_node(get_Builtin_mem(node));
+		/* use the immediates of the gcc and msvc builtins */
+		uint64_t const imm     = kind == ir_bk_trap ? 0x3E8 : 0xF000;
+		return new_bd_aarch64_brk(dbgi, block, new_mem, imm);
+	}
+	case ir_bk_clz:
+	case ir_bk_ctz:
+	case ir_bk_bswap: {
+		ir_node *const param  = get_Builtin_param(node, 0);
+		ir_node *const new_op = be_transform_node(param);
+		unsigned const size   = get_mode_size_bits(get_irn_mode(param));
+		unsigned const bits   = get_bits(get_irn_mode(param));
+		if (kind == ir_bk_clz) {
+			return new_bd_aarch64_clz(dbgi, block, new_op, bits);
+		} else if (kind == ir_bk_ctz) {
+			ir_node *const rbit = new_bd_aarch64_rbit(dbgi, block, new_op, bits);
+			return new_bd_aarch64_clz(dbgi, block, rbit, bits);
+		} else if (size == 16) {
+			return new_bd_aarch64_rev16(dbgi, block, new_op, bits);
+		} else {
+			return new_bd_aarch64_rev(dbgi, block, new_op, bits);
+		}
+	}
+	case ir_bk_return_address:
+	case ir_bk_frame_address:
+	case ir_bk_prefetch:
+	case ir_bk_ffs:
+	case ir_bk_parity:
+	case ir_bk_popcount:
+	case ir_bk_outport:
+	case ir_bk_inport:
+	case ir_bk_saturating_increment:
+	case ir_bk_compare_swap:
+	case ir_bk_may_alias:
+	case ir_bk_va_start:
+	case ir_bk_va_arg:
+		break;
+	}
+	panic("Builtin %s not implemented", get_builtin_kind_name(kind));
+}
+
+static ir_node *gen_Proj_Builtin(ir_node *proj)
+{
+	ir_node        *const node     = get_Proj_pred(proj);
+	ir_node        *const new_node = be_transform_node(node);
+	ir_builtin_kind const kind     = get_Builtin_kind(node);
+	switch (kind) {
+	case ir_bk_clz:
+	case ir_bk_ctz:
+	case ir_bk_bswap:
+		if (get_Proj_num(proj) == pn_Builtin_M)
+			return be_transform_node(get_Builtin_mem(node));
+		assert(get_Proj_num(proj) == pn_Builtin_max+1);
+		return new_node;
+	case ir_bk_trap:
+	case ir_bk_debugbreak:
+		assert(get_Proj_num(proj) == pn_Builtin_M);
+		return new_node;
+	default:
+		break;
+	}
+	panic("Builtin %s not implemented", get_builtin_kind_name(kind));
+}
+
+static ir_node *gen_Proj_Load(ir_node *node)
+{
+	ir_node  *load     = get_Proj_pred(node);
+	ir_node  *new_load = be_transform_node(load);
+	unsigned  pn       = get_Proj_num(node);
+
+	/* renumber the proj */
+	switch (get_aarch64_irn_opcode(new_load)) {
+	case iro_aarch64_ldr:
+		if (pn == pn_Load_res) {
+			return be_new_Proj(new_load, pn_aarch64_ldr_res);
+		} else if (pn == pn_Load_M) {
+			return be_new_Proj(new_load, pn_aarch64_ldr_M);
+		}
+		break;
+	case iro_aarch64_fldr:
+		if (pn == pn_Load_res) {
+			return be_new_Proj(new_load, pn_aarch64_fldr_res);
+		} else if (pn == pn_Load_M) {
+			return be_new_Proj(new_load, pn_aarch64_fldr_M);
+		}
+		break;
+	default:
+		break;
+	}
+	panic("unsupported Proj from Load");
+}
+
+static ir_node *gen_Proj_Store(ir_node *node)
+{
+	ir_node *pred = get_Proj_pred(node);
+	unsigned pn   = get_Proj_num(node);
+	switch ((pn_Store)pn) {
+	case pn_Store_M:
+		return be_transform_node(pred);
+	case pn_Store_X_regular:
+	case pn_Store_X_except:
+		break;
+	}
+	panic("unsupported Proj from Store");
+}
+
+static ir_node *gen_Proj_Div(ir_node *node)
+{
+	ir_node *pred = get_Proj_pred(node);
+	unsigned pn   = get_Proj_num(node);
+	switch ((pn_Div)pn) {
+	case pn_Div_M:
+		return be_transform_node(get_Div_mem(pred));
+	case pn_Div_res:
+		return be_transform_node(pred);
+	case pn_Div_X_regular:
+	case pn_Div_X_except:
+		break;
+	}
+	panic("unsupported Proj from Div");
+}
+
+static ir_node *gen_Proj_Mod(ir_node *node)
+{
+	ir_node *pred = get_Proj_pred(node);
+	unsigned pn   = get_Proj_num(node);
+	switch ((pn_Mod)pn) {
+	case pn_Mod_M:
+		return be_transform_node(get_Mod_mem(pred));
+	case pn_Mod_res:
+		return be_transform_node(pred);
+	case pn_Mod_X_regular:
+	case pn_Mod_X_except:
+		break;
+	}
+	panic("unsupported Proj from Mod");
+}
+
+static ir_node *gen_Proj_Start(ir_node *node)
+{
+	ir_graph *const irg = get_irn_irg(node);
+	unsigned pn = get_Proj_num(node);
+	switch ((pn_Start)pn) {
+	case pn_Start_M:
+		return be_get_Start_mem(irg);
+
+	case pn_Start_T_args:
+		return new_r_Bad(irg, mode_T);
+
+	case pn_Start_P_frame_base:
+		return get_initial_sp(irg);
+	}
+	panic("unexpected start proj: %u", pn);
+}
+
+static ir_node *gen_Proj_Proj_Start(ir_node *node)
+{
+	/* Proj->Proj->Start must be a method argument */
+	assert(get_Proj_num(get_Proj_pred(node)) == pn_Start_T_args);
+
+	ir_node                  *const new_block = be_transform_nodes_block(node);
+	ir_graph                 *const irg       = get_irn_irg(new_block);
+	unsigned                  const pn        = get_Proj_num(node);
+	reg_or_stackslot_t const *const param     = &cconv->parameters[pn];
+	if (param->reg != NULL) {
+		/* argument transmitted in register */
+		return be_get_Start_proj(irg, param->reg);
+	}
+
+	/* argument transmitted on stack */
+	ir_node *const fp   = get_irg_frame(irg);
+	ir_node *const mem  = be_get_Start_mem(irg);
+	ir_mode *const mode = get_type_mode(param->type);
+
+	ir_node *load;
+	ir_node *value;
+	if (mode_is_float(mode)) {
+		load  = new_bd_aarch64_fldr(NULL, new_block, fp, mem, mode,
+		                            param->entity, 0, true);
+		value = be_new_Proj(load, pn_aarch64_fldr_res);
+	} else {
+		load  = new_bd_aarch64_ldr(NULL, new_block, fp, mem, mode,
+		                           param->entity, 0, true);
+		value = be_new_Proj(load, pn_aarch64_ldr_res);
+	}
+	set_irn_pinned(load, false);
+
+	return value;
+}
+
+/**
+ * Finds number of output value of a mode_T node which is constrained to
+ * a single specific register.
+ */
+static int find_out_for_reg(ir_node *node, const arch_register_t *reg)
+{
+	be_foreach_out(node, o) {
+		const arch_register_req_t *req = arch_get_irn_register_req_out(node, o);
+		if (req == reg->single_req)
+			return o;
+	}
+	return -1;
+}
+
+static ir_node *gen_Proj_Proj_Call(ir_node *node)
+{
+	unsigned              pn            = get_Proj_num(node);
+	ir_node              *call          = get_Proj_pred(get_Proj_pred(node));
+	ir_node              *new_call      = be_transform_node(call);
+	ir_type              *function_type = get_Call_type(call);
+	calling_convention_t *cconv
+		= aarch64_decide_calling_convention(NULL, function_type);
+	const reg_or_stackslot_t *res = &cconv->results[pn];
+
+	assert(res->reg != NULL);
+	int regn = find_out_for_reg(new_call, res->reg);
+	if (regn < 0) {
+		panic("Internal error in calling convention for return %+F", node);
+	}
+
+	aarch64_free_calling_convention(cconv);
+
+	return be_new_Proj(new_call, regn);
+}
+
+static ir_node *gen_Proj_Call(ir_node *node)
+{
+	unsigned pn        = get_Proj_num(node);
+	ir_node *call      = get_Proj_pred(node);
+	ir_node *new_call  = be_transform_node(call);
+	switch ((pn_Call)pn) {
+	case pn_Call_M:
+		return be_new_Proj(new_call, pn_aarch64_bl_M);
+	case pn_Call_X_regular:
+	case pn_Call_X_except:
+	case pn_Call_T_result:
+		break;
+	}
+	panic("unexpected Call proj %u", pn);
+}
+
+static ir_node *gen_Proj_Proj(ir_node *node)
+{
+	ir_node *pred      = get_Proj_pred(node);
+	ir_node *pred_pred = get_Proj_pred(pred);
+	if (is_Call(pred_pred)) {
+		return gen_Proj_Proj_Call(node);
+	} else if (is_Start(pred_pred)) {
+		return gen_Proj_Proj_Start(node);
+	}
+	panic("code selection didn't expect Proj(Proj) after %+F", pred_pred);
+}
+
+/**
+ * Produces the type which sits between the stack args and the locals on the
+ * stack. The return address is passed in a register, so it is empty.
+ * @return The Firm type modeling the ABI between type.
+ */
+static ir_type *aarch64_get_between_type(void)
+{
+	static ir_type *between_type = NULL;
+	if (between_type == NULL) {
+		between_type = new_type_class(new_id_from_str("aarch64_between_type"));
+		set_type_size(between_type, 0);
+	}
+
+	return between_type;
+}
+
+static void create_stacklayout(ir_graph *irg)
+{
+	/* calling conventions must be decided by now */
+	assert(cconv != NULL);
+
+	/* construct argument type */
+	ir_entity *const entity      = get_irg_entity(irg);
+	ident     *const arg_type_id = new_id_fmt("%s_arg_type", get_entity_ident(entity));
+	ir_type   *const arg_type    = new_type_struct(arg_type_id);
+	for (unsigned p = 0, n_params = cconv->n_parameters; p < n_params; ++p) {
+		reg_or_stackslot_t *param = &cconv->parameters[p];
+		if (param->reg != NULL)
+			continue;
+
+		ident *const id = new_id_fmt("param_%u", p);
+		param->entity = new_entity(arg_type, id, param->type);
+		set_entity_offset(param->entity, param->offset);
+	}
+
+	be_stack_layout_t *const layout = be_get_irg_stack_layout(irg);
+	memset(layout, 0, sizeof(*layout));
+	layout->frame_type     = get_irg_frame_type(irg);
+	layout->between_type   = aarch64_get_between_type();
+	layout->arg_type       = arg_type;
+	layout->initial_offset = 0;
+	layout->initial_bias   = 0;
+	layout->sp_relative    = true;
+
+	assert(N_FRAME_TYPES == 3);
+	layout->order[0] = layout->frame_type;
+	layout->order[1] = layout->between_type;
+	layout->order[2] = layout->arg_type;
+}
+
+/**
+ * transform the start node to the prolog code
+ */
+static ir_node *gen_Start(ir_node *node)
+{
+	be_start_out outs[N_AARCH64_REGISTERS] = { [REG_SP] = BE_START_IGNORE };
+
+	/* function parameters in registers */
+	for (size_t i = 0, n = cconv->n_parameters; i != n; ++i) {
+		const arch_register_t *reg = cconv->parameters[i].reg;
+		if (reg)
+			outs[reg->global_index] = BE_START_REG;
+	}
+
+	/* callee save regs */
+	for (size_t i = 0; i < ARRAY_SIZE(callee_saves); ++i) {
+		outs[callee_saves[i]->global_index] = BE_START_REG;
+	}
+
+	ir_graph *const irg = get_irn_irg(node);
+	return be_new_Start(irg, outs);
+}
+
+/**
+ * transform a Return node into epilogue code + return statement
+ */
+static ir_node *gen_Return(ir_node *node)
+{
+	ir_node        *new_block      = be_transform_nodes_block(node);
+	dbg_info       *dbgi           = get_irn_dbg_info(node);
+	ir_node        *mem            = get_Return_mem(node);
+	ir_node        *new_mem        = be_transform_node(mem);
+	unsigned        n_callee_saves = ARRAY_SIZE(callee_saves);
+	unsigned        n_res          = get_Return_n_ress(node);
+	ir_graph       *irg            = get_irn_irg(node);
+
+	unsigned       p     = n_aarch64_ret_first_result;
+	unsigned const n_ins = p + n_res + n_callee_saves;
+
+	arch_register_req_t const **const reqs = be_allocate_in_reqs(irg, n_ins);
+	ir_node **in = ALLOCAN(ir_node*, n_ins);
+
+	in[n_aarch64_ret_mem]   = new_mem;
+	reqs[n_aarch64_ret_mem] = arch_memory_req;
+
+	in[n_aarch64_ret_sp]   = get_initial_sp(irg);
+	reqs[n_aarch64_ret_sp] = sp_reg->single_req;
+
+	/* result values */
+	for (size_t i = 0; i < n_res; ++i) {
+		ir_node               *res_value     = get_Return_res(node, i);
+		ir_node               *new_res_value = be_transform_node(res_value);
+		const arch_register_t *reg           = cconv->results[i].reg;
+		in[p]   = new_res_value;
+		reqs[p] = reg->single_req;
+		++p;
+	}
+	/* connect callee saves with their values at the function begin */
+	for (unsigned i = 0; i < n_callee_saves; ++i) {
+		arch_register_t const *const reg = callee_saves[i];
+		in[p]   = be_get_Start_proj(irg, reg);
+		reqs[p] = reg->single_req;
+		++p;
+	}
+	assert(p == n_ins);
+
+	ir_node *const ret = new_bd_aarch64_ret(dbgi, new_block, n_ins, in, reqs);
+	be_stack_record_chain(&stack_env, ret, n_aarch64_ret_sp, NULL);
+	return ret;
+}
+
+static ir_node *gen_Call(ir_node *node)
+{
+	ir_graph             *irg          = get_irn_irg(node);
+	ir_node              *callee       = get_Call_ptr(node);
+	ir_node              *new_block    = be_transform_nodes_block(node);
+	ir_node              *mem          = get_Call_mem(node);
+	ir_node              *new_mem      = be_transform_node(mem);
+	dbg_info             *dbgi         = get_irn_dbg_info(node);
+	ir_type              *type         = get_Call_type(node);
+	calling_convention_t *cconv        = aarch64_decide_calling_convention(NULL, type);
+	size_t                n_params     = get_Call_n_params(node);
+	size_t const          n_param_regs = cconv->n_param_regs;
+	/* max inputs: memory, stack, callee, register arguments */
+	size_t const          max_inputs   = 3 + n_param_regs;
+	ir_node             **in           = ALLOCAN(ir_node*, max_inputs);
+	ir_node             **sync_ins     = ALLOCAN(ir_node*, n_params);
+	arch_register_req_t const **const in_req = be_allocate_in_reqs(irg, max_inputs);
+	size_t                in_arity       = 0;
+	size_t                sync_arity     = 0;
+	size_t const          n_caller_saves = ARRAY_SIZE(caller_saves);
+	ir_entity            *entity         = NULL;
+
+	assert(n_params == cconv->n_parameters);
+
+	/* memory input */
+	int mem_pos     = in_arity++;
+	in_req[mem_pos] = arch_memory_req;
+	/* stack pointer (create parameter stackframe + align stack)
+	 * Note that we always need an IncSP to ensure stack alignment */
+	ir_node *const new_frame = get_initial_sp(irg);
+	ir_node *const callframe = be_new_IncSP(sp_reg, new_block, new_frame, cconv->param_stack_size, AARCH64_PO2_STACK_ALIGNMENT);
+	int sp_pos = in_arity++;
+	in_req[sp_pos] = sp_reg->single_req;
+	in[sp_pos]     = callframe;
+
+	/* callee */
+	if (is_Address(callee)) {
+		entity = get_Address_entity(callee);
+	} else {
+		in[in_arity]     = be_transform_node(callee);
+		in_req[in_arity] = aarch64_reg_classes[CLASS_aarch64_gp].class_req;
+		++in_arity;
+	}
+
+	/* parameters */
+	for (size_t p = 0; p < n_params; ++p) {
+		ir_node                  *value     = get_Call_param(node, p);
+		ir_node                  *new_value = be_transform_node(value);
+		const reg_or_stackslot_t *param     = &cconv->parameters[p];
+
+		/* put value into registers */
+		if (param->reg != NULL) {
+			in[in_arity]     = new_value;
+			in_req[in_arity] = param->reg->single_req;
+			++in_arity;
+			continue;
+		}
+
+		/* create a parameter frame if necessary */
+		ir_mode *const mode = get_type_mode(param->type);
+		ir_node *const str  = mode_is_float(mode) ?
+			new_bd_aarch64_fstr(dbgi, new_block, callframe, new_value, new_mem, mode, NULL, param->offset, false) :
+			new_bd_aarch64_str(dbgi, new_block, callframe, new_value, new_mem, mode, NULL, param->offset, false);
+		sync_ins[sync_arity++] = str;
+	}
+
+	/* construct memory input */
+	if (sync_arity == 0) {
+		in[mem_pos] = new_mem;
+	} else {
+		in[mem_pos] = be_make_Sync(new_block, sync_arity, sync_ins);
+	}
+	assert(sync_arity <= n_params);
+	assert(in_arity <= max_inputs);
+
+	/* Count outputs. */
+	unsigned const out_arity = pn_aarch64_bl_first_result + n_caller_saves;
+
+	ir_node *res;
+	if (entity != NULL) {
+		res = new_bd_aarch64_bl(dbgi, new_block, in_arity, in, in_req, out_arity, entity, 0);
+	} else {
+		res = new_bd_aarch64_blr(dbgi, new_block, in_arity, in, in_req, out_arity);
+	}
+
+	/* create output register reqs */
+	arch_set_irn_register_req_out(res, pn_aarch64_bl_M, arch_memory_req);
+	arch_copy_irn_out_info(res, pn_aarch64_bl_stack, callframe);
+
+	for (size_t o = 0; o < n_caller_saves; ++o) {
+		const arch_register_t *reg = caller_saves[o];
+		arch_set_irn_register_req_out(res, pn_aarch64_bl_first_result + o, reg->single_req);
+	}
+
+	/* copy pinned attribute */
+	set_irn_pinned(res, get_irn_pinned(node));
+
+	/* IncSP to destroy the call stackframe */
+	ir_node *const call_stack = be_new_Proj(res, pn_aarch64_bl_stack);
+	ir_node *const incsp      = be_new_IncSP(sp_reg, new_block, call_stack, -cconv->param_stack_size, 0);
+	be_stack_record_chain(&stack_env, callframe, n_be_IncSP_pred, incsp);
+
+	aarch64_free_calling_convention(cconv);
+	return res;
+}
+
+/**
+ * Enters all transform functions into the generic pointer
+ */
+static void aarch64_register_transformers(void)
+{
+	be_start_transform_setup();
+
+	be_set_transform_function(op_Add,     gen_Add);
+	be_set_transform_function(op_Address, gen_Address);
+	be_set_transform_function(op_And,     gen_And);
+	be_set_transform_function(op_Bitcast, gen_Bitcast);
+	be_set_transform_function(op_Builtin, gen_Builtin);
+	be_set_transform_function(op_Call,    gen_Call);
+	be_set_transform_function(op_Cmp,     gen_Cmp);
+	be_set_transform_function(op_Cond,    gen_Cond);
+	be_set_transform_function(op_Const,   gen_Const);
+	be_set_transform_function(op_Conv,    gen_Conv);
+	be_set_transform_function(op_Div,     gen_Div);
+	be_set_transform_function(op_Eor,     gen_Eor);
+	be_set_transform_function(op_Jmp,     gen_Jmp);
+	be_set_transform_function(op_Load,    gen_Load);
+	be_set_transform_function(op_Member,  gen_Member);
+	be_set_transform_function(op_Minus,   gen_Minus);
+	be_set_transform_function(op_Mod,     gen_Mod);
+	be_set_transform_function(op_Mul,     gen_Mul);
+	be_set_transform_function(op_Mulh,    gen_Mulh);
+	be_set_transform_function(op_Mux,     gen_Mux);
+	be_set_transform_function(op_Not,     gen_Not);
+	be_set_transform_function(op_Or,      gen_Or);
+	be_set_transform_function(op_Phi,     gen_Phi);
+	be_set_transform_function(op_Return,  gen_Return);
+	be_set_transform_function(op_Shl,     gen_Shl);
+	be_set_transform_function(op_Shr,     gen_Shr);
+	be_set_transform_function(op_Shrs,    gen_Shrs);
+	be_set_transform_function(op_Start,   gen_Start);
+	be_set_transform_function(op_Store,   gen_Store);
+	be_set_transform_function(op_Sub,     gen_Sub);
+	be_set_transform_function(op_Switch,  gen_Switch);
+	be_set_transform_function(op_Unknown, gen_Unknown);
+
+	be_set_transform_proj_function(op_Builtin, gen_Proj_Builtin);
+	be_set_transform_proj_function(op_Call,    gen_Proj_Call);
+	be_set_transform_proj_function(op_Cond,    be_duplicate_node);
+	be_set_transform_proj_function(op_Div,     gen_Proj_Div);
+	be_set_transform_proj_function(op_Load,    gen_Proj_Load);
+	be_set_transform_proj_function(op_Mod,     gen_Proj_Mod);
+	be_set_transform_proj_function(op_Proj,    gen_Proj_Proj);
+	be_set_transform_proj_function(op_Start,   gen_Proj_Start);
+	be_set_transform_proj_function(op_Store,   gen_Proj_Store);
+	be_set_transform_proj_function(op_Switch,  be_duplicate_node);
+}
+
+/**
+ * Transform a Firm graph into an AArch64 graph.
+ */
+void aarch64_transform_graph(ir_graph *irg)
+{
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_TUPLES
+	                         | IR_GRAPH_PROPERTY_NO_BADS
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
+
+	aarch64_register_transformers();
+
+	assert(cconv == NULL);
+	be_stack_init(&stack_env);
+	ir_entity *entity = get_irg_entity(irg);
+	cconv = aarch64_decide_calling_convention(irg, get_entity_type(entity));
+	create_stacklayout(irg);
+	be_add_parameter_entity_stores(irg);
+
+	be_transform_graph(irg, NULL);
+
+	be_stack_finish(&stack_env);
+
+	aarch64_free_calling_convention(cconv);
+	cconv = NULL;
+
+	ir_type *frame_type = get_irg_frame_type(irg);
+	if (get_type_state(frame_type) == layout_undefined) {
+		default_layout_compound_type(frame_type);
+	}
+}
+
+void aarch64_init_transform(void)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.be.aarch64.transform");
+}
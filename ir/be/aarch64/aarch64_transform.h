@@ -0,0 +1,22 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   declaration for the transform function (code selection)
+ */
+#ifndef FIRM_BE_AARCH64_AARCH64_TRANSFORM_H
+#define FIRM_BE_AARCH64_AARCH64_TRANSFORM_H
+
+#include "firm_types.h"
+
+/**
+ * Transform a Firm graph into an AArch64 graph.
+ */
+void aarch64_transform_graph(ir_graph *irg);
+
+void aarch64_init_transform(void);
+
+#endif
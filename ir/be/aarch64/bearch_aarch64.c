@@ -0,0 +1,322 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   The main AArch64 backend driver file.
+ */
+#include "aarch64_emitter.h"
+#include "aarch64_new_nodes.h"
+#include "aarch64_transform.h"
+#include "be_t.h"
+#include "bearch_aarch64_t.h"
+#include "beflags.h"
+#include "beirg.h"
+#include "bemodule.h"
+#include "benode.h"
+#include "bera.h"
+#include "besched.h"
+#include "betranshlp.h"
+#include "gen_aarch64_regalloc_if.h"
+#include "irarch_t.h"
+#include "irgopt.h"
+#include "irprog_t.h"
+#include "irtools.h"
+#include "lc_opts.h"
+#include "lower_builtins.h"
+#include "lower_calls.h"
+#include "lower_mode_b.h"
+#include "lowering.h"
+#include "util.h"
+
+#define AARCH64_MODULO_SHIFT 32
+#define AARCH64_MACHINE_SIZE 64
+
+ir_mode *aarch64_mode_flags;
+
+bool aarch64_emit_machcode;
+
+/**
+ * Transforms the standard Firm graph into an AArch64 firm graph.
+ */
+static void aarch64_select_instructions(ir_graph *irg)
+{
+	/* transform nodes into assembler instructions */
+	be_timer_push(T_CODEGEN);
+	aarch64_transform_graph(irg);
+	be_timer_pop(T_CODEGEN);
+	be_dump(DUMP_BE, irg, "code-selection");
+
+	/* do local optimizations (mainly CSE) */
+	local_optimize_graph(irg);
+
+	/* do code placement, to optimize the position of constants */
+	place_code(irg);
+}
+
+static bool is_neon_value(ir_node const *const value)
+{
+	return arch_get_irn_register_req(value)->cls
+	    == &aarch64_reg_classes[CLASS_aarch64_neon];
+}
+
+static ir_node *aarch64_new_reload(ir_node *value, ir_node *spill,
+                                   ir_node *before)
+{
+	ir_node  *block = get_block(before);
+	ir_graph *irg   = get_irn_irg(before);
+	ir_node  *frame = get_irg_frame(irg);
+
+	/* always reload the complete register */
+	ir_node *load;
+	ir_node *proj;
+	if (is_neon_value(value)) {
+		load = new_bd_aarch64_fldr(NULL, block, frame, spill, mode_D, NULL, 0,
+		                           true);
+		proj = be_new_Proj(load, pn_aarch64_fldr_res);
+	} else {
+		load = new_bd_aarch64_ldr(NULL, block, frame, spill, mode_Lu, NULL, 0,
+		                          true);
+		proj = be_new_Proj(load, pn_aarch64_ldr_res);
+	}
+	arch_add_irn_flags(load, arch_irn_flag_reload);
+	sched_add_before(before, load);
+	return proj;
+}
+
+static ir_node *aarch64_new_spill(ir_node *value, ir_node *after)
+{
+	ir_node  *block = get_block(after);
+	ir_graph *irg   = get_irn_irg(after);
+	ir_node  *frame = get_irg_frame(irg);
+	ir_node  *mem   = get_irg_no_mem(irg);
+
+	/* always spill the complete register */
+	ir_node *store;
+	if (is_neon_value(value)) {
+		store = new_bd_aarch64_fstr(NULL, block, frame, value, mem, mode_D,
+		                            NULL, 0, true);
+	} else {
+		store = new_bd_aarch64_str(NULL, block, frame, value, mem, mode_Lu,
+		                           NULL, 0, true);
+	}
+	arch_add_irn_flags(store, arch_irn_flag_spill);
+	sched_add_after(after, store);
+	return store;
+}
+
+static const regalloc_if_t aarch64_regalloc_if = {
+	.spill_cost  = 7,
+	.reload_cost = 5,
+	.new_spill   = aarch64_new_spill,
+	.new_reload  = aarch64_new_reload,
+};
+
+static bool lower_for_emit(ir_graph *const irg, unsigned *const sp_is_non_ssa)
+{
+	if (!be_step_first(irg))
+		return false;
+
+	struct obstack *obst = be_get_be_obst(irg);
+	be_birg_from_irg(irg)->isa_link = OALLOCZ(obst, aarch64_irg_data_t);
+
+	be_birg_from_irg(irg)->non_ssa_regs = sp_is_non_ssa;
+	aarch64_select_instructions(irg);
+
+	be_step_schedule(irg);
+
+	be_timer_push(T_RA_PREPARATION);
+	be_sched_fix_flags(irg, &aarch64_reg_classes[CLASS_aarch64_flags], NULL,
+	                   NULL, NULL);
+	be_timer_pop(T_RA_PREPARATION);
+
+	be_step_regalloc(irg, &aarch64_regalloc_if);
+
+	aarch64_finish_graph(irg);
+	return true;
+}
+
+static void aarch64_generate_code(FILE *output, const char *cup_name)
+{
+	be_begin(output, cup_name);
+	unsigned *const sp_is_non_ssa = rbitset_alloca(N_AARCH64_REGISTERS);
+	rbitset_set(sp_is_non_ssa, REG_SP);
+
+	foreach_irp_irg(i, irg) {
+		if (!lower_for_emit(irg, sp_is_non_ssa))
+			continue;
+
+		be_timer_push(T_EMIT);
+		aarch64_emit_function(irg);
+		be_timer_pop(T_EMIT);
+
+		be_step_last(irg);
+	}
+
+	be_finish();
+}
+
+static ir_jit_function_t *aarch64_jit_compile(ir_jit_segment_t *const segment,
+                                              ir_graph *const irg)
+{
+	unsigned *const sp_is_non_ssa = rbitset_alloca(N_AARCH64_REGISTERS);
+	rbitset_set(sp_is_non_ssa, REG_SP);
+
+	if (!lower_for_emit(irg, sp_is_non_ssa))
+		return NULL;
+
+	be_timer_push(T_EMIT);
+	ir_jit_function_t *const res = aarch64_emit_jit(segment, irg);
+	be_timer_pop(T_EMIT);
+
+	be_step_last(irg);
+	return res;
+}
+
+/**
+ * Allows or disallows the creation of Mux nodes for the given Phi nodes.
+ * Integer values are selected with csel.
+ * @return 1 if allowed, 0 otherwise
+ */
+static int aarch64_is_mux_allowed(ir_node *sel, ir_node *mux_false,
+                                  ir_node *mux_true)
+{
+	(void)sel;
+	(void)mux_false;
+	ir_mode *const mode = get_irn_mode(mux_true);
+	return get_mode_arithmetic(mode) == irma_twos_complement;
+}
+
+static void aarch64_lower_for_target(void)
+{
+	/* lower compound param handling */
+	lower_calls_with_compounds(LF_RETURN_HIDDEN, NULL);
+	be_after_irp_transform("lower-calls");
+
+	foreach_irp_irg(i, irg) {
+		lower_switch(irg, 4, 256, mode_Iu);
+		be_after_transform(irg, "lower-switch");
+	}
+
+	foreach_irp_irg(i, irg) {
+		/* lower for mode_b stuff */
+		ir_lower_mode_b(irg, mode_Iu);
+		be_after_transform(irg, "lower-modeb");
+	}
+
+	foreach_irp_irg(i, irg) {
+		/* Turn all small CopyBs into loads/stores and all bigger CopyBs into
+		 * memcpy calls. */
+		lower_CopyB(irg, 64, 65, true);
+		be_after_transform(irg, "lower-copyb");
+	}
+
+	ir_builtin_kind supported[5];
+	size_t s = 0;
+	supported[s++] = ir_bk_trap;
+	supported[s++] = ir_bk_debugbreak;
+	supported[s++] = ir_bk_clz;
+	supported[s++] = ir_bk_ctz;
+	supported[s++] = ir_bk_bswap;
+	assert(s <= ARRAY_SIZE(supported));
+	lower_builtins(s, supported);
+	be_after_irp_transform("lower-builtins");
+}
+
+static const ir_settings_arch_dep_t aarch64_arch_dep = {
+	.also_use_subs        = true,
+	.maximum_shifts       = 1,
+	.highest_shift_amount = 63,
+	.evaluate             = NULL,
+	.allow_mulhs          = true,
+	.allow_mulhu          = true,
+	.max_bits_for_mulh    = AARCH64_MACHINE_SIZE,
+};
+static backend_params aarch64_backend_params = {
+	.byte_order_big_endian         = false,
+	.pic_supported                 = false,
+	.unaligned_memaccess_supported = true,
+	.modulo_shift                  = AARCH64_MODULO_SHIFT,
+	.dep_param                     = &aarch64_arch_dep,
+	.allow_ifconv                  = aarch64_is_mux_allowed,
+	.branch_mispredict_penalty     = 13,
+	.mux_latency                   = 1,
+	.machine_size                  = AARCH64_MACHINE_SIZE,
+	.mode_float_arithmetic         = NULL,
+	.type_long_long                = NULL,
+	.type_unsigned_long_long       = NULL,
+	.type_long_double              = NULL,
+	.stack_param_align             = 8,
+	.float_int_overflow            = ir_overflow_min_max,
+	.vararg                        = {
+		.va_list_type = NULL,
+		.lower_va_arg = NULL,
+	},
+	.n_int_registers               = 28,
+	.n_float_registers             = 32,
+};
+
+static const backend_params *aarch64_get_libfirm_params(void)
+{
+	return &aarch64_backend_params;
+}
+
+static void aarch64_init(void)
+{
+	aarch64_mode_flags = new_non_arithmetic_mode("aarch64_flags", 32);
+
+	set_modeP(new_reference_mode("p64", irma_twos_complement, AARCH64_MACHINE_SIZE, AARCH64_MACHINE_SIZE));
+
+	aarch64_register_init();
+	obstack_init(&aarch64_opcodes_obst);
+	aarch64_create_opcodes();
+}
+
+static void aarch64_finish(void)
+{
+	aarch64_free_opcodes();
+	obstack_free(&aarch64_opcodes_obst, NULL);
+}
+
+static unsigned aarch64_get_op_estimated_cost(const ir_node *node)
+{
+	if (!is_aarch64_irn(node))
+		return 1;
+	return get_aarch64_latency(node);
+}
+
+static arch_isa_if_t const aarch64_isa_if = {
+	.n_registers           = N_AARCH64_REGISTERS,
+	.registers             = aarch64_registers,
+	.n_register_classes    = N_AARCH64_CLASSES,
+	.register_classes      = aarch64_reg_classes,
+	.init                  = aarch64_init,
+	.finish                = aarch64_finish,
+	.get_params            = aarch64_get_libfirm_params,
+	.generate_code         = aarch64_generate_code,
+	.lower_for_target      = aarch64_lower_for_target,
+	.is_valid_clobber      = be_default_is_valid_clobber,
+	.get_op_estimated_cost = aarch64_get_op_estimated_cost,
+	.jit_compile           = aarch64_jit_compile,
+	.emit_function         = aarch64_emit_jit_function,
+	.emit_jit_relocation   = aarch64_emit_jit_relocation,
+};
+
+BE_REGISTER_MODULE_CONSTRUCTOR(be_init_arch_aarch64)
+void be_init_arch_aarch64(void)
+{
+	aarch64_init_transform();
+	aarch64_init_emitter();
+
+	static const lc_opt_table_entry_t options[] = {
+		LC_OPT_ENT_BOOL("machcode", "output machine code instead of assembler", &aarch64_emit_machcode),
+		LC_OPT_LAST
+	};
+	lc_opt_entry_t *be_grp      = lc_opt_get_grp(firm_opt_get_root(), "be");
+	lc_opt_entry_t *aarch64_grp = lc_opt_get_grp(be_grp, "aarch64");
+	lc_opt_add_table(aarch64_grp, options);
+
+	be_register_isa_if("aarch64", &aarch64_isa_if);
+}
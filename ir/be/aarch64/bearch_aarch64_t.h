@@ -0,0 +1,36 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   declarations for AArch64 backend -- private header
+ */
+#ifndef FIRM_BE_AARCH64_BEARCH_AARCH64_T_H
+#define FIRM_BE_AARCH64_BEARCH_AARCH64_T_H
+
+#include <stdbool.h>
+
+#include "beirg.h"
+#include "firm_types.h"
+
+typedef struct aarch64_irg_data_t {
+	bool omit_fp;
+} aarch64_irg_data_t;
+
+/** power of two stack alignment required by AAPCS64 */
+#define AARCH64_PO2_STACK_ALIGNMENT 4
+
+extern ir_mode *aarch64_mode_flags;
+
+extern bool aarch64_emit_machcode; /**< emit machine code as .inst directives */
+
+static inline aarch64_irg_data_t *aarch64_get_irg_data(ir_graph const *const irg)
+{
+	return (aarch64_irg_data_t*)be_birg_from_irg(irg)->isa_link;
+}
+
+void aarch64_finish_graph(ir_graph *irg);
+
+#endif
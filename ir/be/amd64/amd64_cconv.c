@@ -113,15 +113,16 @@ x86_cconv_t *amd64_decide_calling_convention(ir_type *function_type,
 
 		ir_mode *mode = get_type_mode(param_type);
 		int      bits = get_mode_size_bits(mode);
+		bool     xmm  = mode_is_float(mode) || mode_is_vector(mode);
 		reg_or_stackslot_t *param = &params[i];
 
-		if (mode_is_float(mode) && float_param_regnum < n_float_param_regs
+		if (xmm && float_param_regnum < n_float_param_regs
 		    && mode != x86_mode_E) {
 			param->reg = float_param_regs[float_param_regnum++];
 			if (amd64_use_x64_abi) {
 				++param_regnum;
 			}
-		} else if (!mode_is_float(mode) && param_regnum < n_param_regs) {
+		} else if (!xmm && param_regnum < n_param_regs) {
 			param->reg = param_regs[param_regnum++];
 			if (amd64_use_x64_abi) {
 				++float_param_regnum;
@@ -180,7 +181,7 @@ x86_cconv_t *amd64_decide_calling_convention(ir_type *function_type,
 			if (res_x87_regnum >= n_x87_result_regs)
 				panic("too manu x87 floating point results");
 			reg = x87_result_regs[res_x87_regnum++];
-		} else if (mode_is_float(result_mode)) {
+		} else if (mode_is_float(result_mode) || mode_is_vector(result_mode)) {
 			if (res_float_regnum >= n_float_result_regs) {
 				panic("too many floating points results");
 			}
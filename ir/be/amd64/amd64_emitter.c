@@ -20,6 +20,7 @@
 #include "beemitter.h"
 #include "begnuas.h"
 #include "beirg.h"
+#include "bejit.h"
 #include "benode.h"
 #include "besched.h"
 #include "bestack.h"
@@ -28,6 +29,7 @@
 #include "bearch_amd64_t.h"
 #include "gen_amd64_emitter.h"
 #include "gen_amd64_regalloc_if.h"
+#include "irdom.h"
 #include "iredges_t.h"
 #include "irgwalk.h"
 #include "panic.h"
@@ -35,6 +37,7 @@
 static bool               omit_fp;
 static int                frame_type_size;
 static int                callframe_offset;
+static ir_node           *prologue_block;
 static be_stack_layout_t *layout;
 
 static bool fallthrough_possible(const ir_node *block, const ir_node *target)
@@ -87,6 +90,20 @@ static void amd64_emit_xmm_size_suffix(amd64_insn_size_t const size)
 	be_emit_char(get_xmm_size_suffix(size));
 }
 
+static char get_vector_int_size_suffix(amd64_insn_size_t const size)
+{
+	switch (size) {
+	case INSN_SIZE_8:  return 'b';
+	case INSN_SIZE_16: return 'w';
+	case INSN_SIZE_32: return 'd';
+	case INSN_SIZE_64: return 'q';
+	case INSN_SIZE_80:
+	case INSN_SIZE_128:
+		break;
+	}
+	panic("invalid insn mode");
+}
+
 static char get_x87_size_suffix(amd64_insn_size_t const size)
 {
 	switch (size) {
@@ -259,12 +276,13 @@ static void amd64_emit_immediate64(const amd64_imm64_t *const imm)
 {
 	if (imm->kind == X86_IMM_VALUE) {
 		assert(imm->entity == NULL);
-		be_emit_irprintf("0x%" PRIX64, imm->offset);
+		be_emit_cstring("0x");
+		be_emit_hex(imm->offset);
 		return;
 	}
 	emit_relocation_no_offset(imm->kind, imm->entity);
 	if (imm->offset != 0)
-		be_emit_irprintf("%+" PRId64, imm->offset);
+		be_emit_int_with_sign(imm->offset);
 }
 
 static void amd64_emit_immediate32(bool const prefix,
@@ -274,12 +292,12 @@ static void amd64_emit_immediate32(bool const prefix,
 		be_emit_char('$');
 	if (imm->kind == X86_IMM_VALUE) {
 		assert(imm->entity == NULL);
-		be_emit_irprintf("%" PRId32, imm->offset);
+		be_emit_int(imm->offset);
 		return;
 	}
 	emit_relocation_no_offset(imm->kind, imm->entity);
 	if (imm->offset != 0)
-		be_emit_irprintf("%+" PRId32, imm->offset);
+		be_emit_int_with_sign(imm->offset);
 }
 
 #ifndef NDEBUG
@@ -303,10 +321,10 @@ static void amd64_emit_addr(const ir_node *const node,
 		assert(!is_fp_relative(entity));
 		emit_relocation_no_offset(addr->immediate.kind, entity);
 		if (offset != 0)
-			be_emit_irprintf("%+" PRId32, offset);
+			be_emit_int_with_sign(offset);
 	} else if (offset != 0 || variant == X86_ADDR_JUST_IMM) {
 		assert(addr->immediate.kind == X86_IMM_VALUE);
-		be_emit_irprintf("%" PRId32, offset);
+		be_emit_int(offset);
 	}
 
 	if (variant != X86_ADDR_JUST_IMM) {
@@ -328,8 +346,10 @@ static void amd64_emit_addr(const ir_node *const node,
 				emit_register(reg);
 
 				unsigned scale = addr->log_scale;
-				if (scale > 0)
-					be_emit_irprintf(",%u", 1 << scale);
+				if (scale > 0) {
+					be_emit_char(',');
+					be_emit_uint(1u << scale);
+				}
 			}
 		}
 		be_emit_char(')');
@@ -417,7 +437,9 @@ static void emit_shiftop(const ir_node *const node)
 
 	switch (attr->base.op_mode) {
 	case AMD64_OP_SHIFT_IMM: {
-		be_emit_irprintf("$0x%X, ", attr->immediate);
+		be_emit_cstring("$0x");
+		be_emit_hex(attr->immediate);
+		be_emit_cstring(", ");
 		const arch_register_t *reg = arch_get_irn_register_in(node, 0);
 		emit_register_mode(reg, attr->size);
 		return;
@@ -626,6 +648,11 @@ emit_R:
 					amd64_addr_attr_t const *const attr
 						= get_amd64_addr_attr_const(node);
 					amd64_emit_xmm_size_suffix(attr->size);
+				} else if (*fmt == 'V') {
+					++fmt;
+					amd64_addr_attr_t const *const attr
+						= get_amd64_addr_attr_const(node);
+					be_emit_char(get_vector_int_size_suffix(attr->size));
 				} else {
 					amd64_addr_attr_t const *const attr
 						= get_amd64_addr_attr_const(node);
@@ -636,7 +663,7 @@ emit_R:
 
 			case 'd': {
 				int const num = va_arg(ap, int);
-				be_emit_irprintf("%d", num);
+				be_emit_int(num);
 				break;
 			}
 
@@ -648,7 +675,7 @@ emit_R:
 
 			case 'u': {
 				unsigned const num = va_arg(ap, unsigned);
-				be_emit_irprintf("%u", num);
+				be_emit_uint(num);
 				break;
 			}
 
@@ -749,7 +776,9 @@ static void emit_amd64_asm_operand(ir_node const *const node, char const modifie
 
 	case ASM_OP_MEMORY: {
 		arch_register_t const *const reg = arch_get_irn_register_in(node, op->inout_pos);
-		be_emit_irprintf("(%%%s)", reg->name);
+		be_emit_cstring("(%");
+		be_emit_string(reg->name);
+		be_emit_char(')');
 		return;
 	}
 
@@ -804,8 +833,8 @@ static void emit_amd64_jmp(const ir_node *node)
 	}
 }
 
-static void emit_jumptable_target(ir_entity const *const table,
-                                  ir_node const *const proj_x)
+void amd64_emit_jumptable_target(ir_entity const *const table,
+                                 ir_node const *const proj_x)
 {
 	ir_node const *const block = be_emit_get_cfop_target(proj_x);
 	be_gas_emit_block_name(block);
@@ -823,11 +852,11 @@ static void emit_amd64_jmp_switch(const ir_node *node)
 	ir_mode *entry_mode = be_options.pic_style != BE_PIC_NONE ? mode_Iu
 	                                                          : mode_Lu;
 	be_emit_jump_table(node, attr->table, attr->table_entity, entry_mode,
-	                   emit_jumptable_target);
+	                   amd64_emit_jumptable_target);
 }
 
-static x86_condition_code_t determine_final_cc(ir_node const *const flags,
-                                               x86_condition_code_t cc)
+x86_condition_code_t amd64_determine_final_cc(ir_node const *const flags,
+                                              x86_condition_code_t cc)
 {
 	if (is_amd64_fucomi(flags)) {
 		amd64_x87_attr_t const *const attr = get_amd64_x87_attr_const(flags);
@@ -848,7 +877,7 @@ static void emit_amd64_jcc(const ir_node *irn)
 
 	const ir_node         *flags = get_irn_n(irn, n_amd64_jcc_eflags);
 	const amd64_cc_attr_t *attr  = get_amd64_cc_attr_const(irn);
-	x86_condition_code_t   cc    = determine_final_cc(flags, attr->cc);
+	x86_condition_code_t   cc    = amd64_determine_final_cc(flags, attr->cc);
 
 	const ir_node *const target_true  = be_emit_get_cfop_target(proj_true);
 	if (fallthrough_possible(block, target_true)) {
@@ -986,32 +1015,75 @@ static void amd64_emit_node(ir_node *node)
 	be_emit_node(node);
 
 	if (omit_fp) {
-		int sp_change = amd64_get_sp_bias(node);
+		int sp_change = be_is_IncSP(node) ? be_get_IncSP_offset(node)
+		                                  : amd64_get_sp_bias(node);
 		if (sp_change != 0) {
 			assert(sp_change != SP_BIAS_RESET);
 			callframe_offset += sp_change;
 			be_dwarf_callframe_offset(callframe_offset);
 		}
+	} else if (get_nodes_block(node) == prologue_block
+	        && prologue_block != get_irg_start_block(get_irn_irg(node))) {
+		/* track the shrink-wrapped prologue; rbp is not allocatable, so
+		 * only the prologue pushes it and copies rsp into it */
+		arch_register_t const *const bp = &amd64_registers[REG_RBP];
+		if (is_amd64_push_reg(node)
+		 && arch_get_irn_register_in(node, n_amd64_push_reg_val) == bp) {
+			be_dwarf_callframe_offset(16);
+			be_dwarf_callframe_spilloffset(bp, -16);
+		} else if (be_is_Copy(node) && arch_get_irn_register(node) == bp) {
+			be_dwarf_callframe_register(bp);
+		}
 	}
 }
 
 /**
- * Walks over the nodes in a block connected by scheduling edges
- * and emits code for each node.
+ * Describe the call frame at the begin of a block outside of the region
+ * set up by a shrink-wrapped prologue (@p has_frame false) or inside it.
  */
-static void amd64_gen_block(ir_node *block)
+static void emit_block_callframe(ir_node const *const block, bool const has_frame)
 {
-	be_gas_begin_block(block, true);
-
 	if (omit_fp) {
-		ir_graph *irg = get_irn_irg(block);
 		callframe_offset = 8; /* 8 bytes for the return address */
 		/* ESP guessing, TODO perform a real RSP simulation */
-		if (block != get_irg_start_block(irg)) {
+		if (has_frame && block != prologue_block)
 			callframe_offset += frame_type_size;
-		}
 		be_dwarf_callframe_offset(callframe_offset);
+	} else if (prologue_block != get_irg_start_block(get_irn_irg(block))) {
+		arch_register_t const *const bp = &amd64_registers[REG_RBP];
+		if (has_frame && block != prologue_block) {
+			be_dwarf_callframe_register(bp);
+			be_dwarf_callframe_offset(16);
+			be_dwarf_callframe_spilloffset(bp, -16);
+		} else {
+			be_dwarf_callframe_register(&amd64_registers[REG_RSP]);
+			be_dwarf_callframe_offset(8);
+			be_dwarf_callframe_restore(bp);
+		}
 	}
+}
+
+bool amd64_should_align_block(ir_node const *const block)
+{
+	/* align blocks executed at least twice per call, if they are entered
+	 * by jumps twice as often as by falling through the padding */
+	return block != get_irg_end_block(get_irn_irg(block))
+	    && be_emit_should_align_block(block, 2.0, 2.0);
+}
+
+/**
+ * Walks over the nodes in a block connected by scheduling edges
+ * and emits code for each node.
+ */
+static void amd64_gen_block(ir_node *block)
+{
+	if (amd64_should_align_block(block)) {
+		amd64_emitf(NULL, ".p2align %u,,%u", AMD64_LABEL_ALIGNMENT,
+		            AMD64_LABEL_ALIGNMENT_MAX_SKIP);
+	}
+	be_gas_begin_block(block, true);
+
+	emit_block_callframe(block, block_dominates(prologue_block, block));
 
 	/* emit the contents of the block */
 	sched_foreach(block, node) {
@@ -1019,45 +1091,72 @@ static void amd64_gen_block(ir_node *block)
 	}
 }
 
-void amd64_emit_function(ir_graph *irg)
+static char const *get_relocation_name(uint8_t const be_kind)
 {
-	layout = be_get_irg_stack_layout(irg);
+	switch (be_kind) {
+	case X86_IMM_ADDR:            return "R_X86_64_32S";
+	case AMD64_RELOCATION_ADDR32: return "R_X86_64_32";
+	case X86_IMM_PCREL:           return "R_X86_64_PC32";
+	case X86_IMM_PLT:             return "R_X86_64_PLT32";
+	case X86_IMM_GOTPCREL:        return "R_X86_64_GOTPCREL";
+	}
+	panic("unexpected relocation kind %u", be_kind);
+}
 
-	/* register all emitter functions */
-	amd64_register_emitters();
+static unsigned emit_jit_entity_relocation_asm(char *const buffer,
+                                               uint8_t const be_kind,
+                                               ir_entity *const entity,
+                                               int32_t const offset)
+{
+	(void)buffer;
+	assert(buffer == NULL);
+	if (be_kind == AMD64_RELOCATION_RELJUMP) {
+		be_emit_irprintf("\t.long %"PRId32"\n", offset);
+		be_emit_write_line();
+		return 4;
+	}
+
+	/* the offset is the explicit addend of the relocation */
+	be_emit_irprintf("\t.reloc ., %s, ", get_relocation_name(be_kind));
+	be_gas_emit_entity(entity);
+	if (offset != 0)
+		be_emit_int_with_sign(offset);
+	be_emit_cstring("\n\t.long 0\n");
+	be_emit_write_line();
+	return 4;
+}
 
-	ir_node *const *const blk_sched = be_create_block_schedule(irg);
+static void emit_function_text(ir_graph *const irg)
+{
+	const ir_entity *const entity    = get_irg_entity(irg);
+	ir_node        **const blk_sched = be_create_block_schedule(irg);
+	size_t           const n_blocks  = ARR_LEN(blk_sched);
+	size_t           const n_hot     = be_gas_can_split_function(entity)
+		? be_split_cold_blocks(blk_sched) : n_blocks;
 
 	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
 
 	be_emit_init_cf_links(blk_sched);
+	/* the hot part never falls through into the cold part */
+	if (n_hot < n_blocks)
+		set_irn_link(blk_sched[n_hot], NULL);
 
-	const ir_entity *const entity = get_irg_entity(irg);
-	be_gas_emit_function_prolog(entity, 4, NULL);
 	if (be_options.exceptions) {
 		be_exc_init(entity, blk_sched);
 		be_exc_emit_function_prolog();
 	}
 
-	bool omit_fp = amd64_get_irg_data(irg)->omit_fp;
-	if (omit_fp) {
-		be_dwarf_callframe_register(&amd64_registers[REG_RSP]);
-	} else {
-		/* well not entirely correct here, we should emit this after the
-		 * "movl esp, ebp" */
-		be_dwarf_callframe_register(&amd64_registers[REG_RBP]);
-		/* TODO: do not hardcode the following */
-		be_dwarf_callframe_offset(16);
-		be_dwarf_callframe_spilloffset(&amd64_registers[REG_RBP], -16);
-	}
-
 	/* register all emitter functions */
 	amd64_register_emitters();
 
-	for (size_t i = 0, n = ARR_LEN(blk_sched); i < n; ++i) {
+	for (size_t i = 0; i < n_blocks; ++i) {
+		if (i == n_hot)
+			be_gas_begin_cold_part(entity);
 		ir_node *const block = blk_sched[i];
 		amd64_gen_block(block);
 	}
+	if (n_hot < n_blocks)
+		be_gas_end_cold_part(entity);
 
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
 
@@ -1065,6 +1164,49 @@ void amd64_emit_function(ir_graph *irg)
 		be_exc_emit_table();
 		be_exc_finish();
 	}
+}
+
+void amd64_emit_function(ir_graph *irg)
+{
+	if (amd64_emit_elf) {
+		amd64_emit_elf_function(irg);
+		return;
+	}
+
+	layout = be_get_irg_stack_layout(irg);
+
+	const ir_entity *const entity = get_irg_entity(irg);
+	be_gas_emit_function_prolog(entity, 4, NULL);
+
+	amd64_irg_data_t const *const irg_data = amd64_get_irg_data(irg);
+	omit_fp         = irg_data->omit_fp;
+	frame_type_size = get_type_size(get_irg_frame_type(irg));
+	prologue_block  = irg_data->prologue_block;
+	if (prologue_block != get_irg_start_block(irg))
+		assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+	if (omit_fp) {
+		be_dwarf_callframe_register(&amd64_registers[REG_RSP]);
+	} else if (prologue_block != get_irg_start_block(irg)) {
+		/* the blocks describe their call frame themselves */
+	} else {
+		/* well not entirely correct here, we should emit this after the
+		 * "movl esp, ebp" */
+		be_dwarf_callframe_register(&amd64_registers[REG_RBP]);
+		/* TODO: do not hardcode the following */
+		be_dwarf_callframe_offset(16);
+		be_dwarf_callframe_spilloffset(&amd64_registers[REG_RBP], -16);
+	}
+
+	if (amd64_emit_machcode) {
+		/* For debugging we can jit the code and output it embedded into a
+		 * normal .s file with .byte directives etc. */
+		ir_jit_segment_t *const segment = be_new_jit_segment();
+		ir_jit_function_t *const function = amd64_emit_jit(segment, irg);
+		be_jit_emit_as_asm(function, emit_jit_entity_relocation_asm);
+		be_destroy_jit_segment(segment);
+	} else {
+		emit_function_text(irg);
+	}
 
 	be_gas_emit_function_epilog(entity);
 }
@@ -10,7 +10,9 @@
 #ifndef FIRM_BE_AMD64_AMD64_EMITTER_H
 #define FIRM_BE_AMD64_AMD64_EMITTER_H
 
+#include "amd64_encode.h"
 #include "firm_types.h"
+#include "../ia32/x86_cc.h"
 
 /**
  * fmt  parameter               output
@@ -33,4 +35,25 @@ void amd64_emitf(ir_node const *node, char const *fmt, ...);
 
 void amd64_emit_function(ir_graph *irg);
 
+/** logarithm of the alignment of hot jump targets */
+#define AMD64_LABEL_ALIGNMENT          4
+/** maximum number of padding bytes to align hot jump targets */
+#define AMD64_LABEL_ALIGNMENT_MAX_SKIP 10
+
+/**
+ * Returns true if the label of @p block should be aligned.
+ * Requires a prior call to be_emit_init_cf_links().
+ */
+bool amd64_should_align_block(ir_node const *block);
+
+/**
+ * Returns the condition code to test for @p cc, which may be inverted by the
+ * node producing the flags @p flags.
+ */
+x86_condition_code_t amd64_determine_final_cc(ir_node const *flags,
+                                              x86_condition_code_t cc);
+
+void amd64_emit_jumptable_target(ir_entity const *table,
+                                 ir_node const *proj_x);
+
 #endif
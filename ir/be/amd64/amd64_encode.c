@@ -0,0 +1,1294 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       amd64 binary encoding
+ */
+#include "amd64_encode.h"
+
+#include <stdint.h>
+#include <string.h>
+#include "amd64_emitter.h"
+#include "amd64_new_nodes.h"
+#include "bearch_amd64_t.h"
+#include "beblocksched.h"
+#include "beelf.h"
+#include "beemithlp.h"
+#include "begnuas.h"
+#include "bejit.h"
+#include "besched.h"
+#include "gen_amd64_emitter.h"
+#include "gen_amd64_regalloc_if.h"
+#include "irnodehashmap.h"
+#include "panic.h"
+#include "../ia32/x86_encode.h"
+
+/* x86-64 relocation types of the System V ABI */
+#define R_X86_64_64       1
+#define R_X86_64_PC32     2
+#define R_X86_64_PLT32    4
+#define R_X86_64_GOTPCREL 9
+#define R_X86_64_32       10
+#define R_X86_64_32S      11
+
+static ir_nodehashmap_t block_fragmentnum;
+
+/** Bits of the REX prefix. */
+enum {
+	REX   = 0x40, /**< the prefix itself, needed for spl, bpl, sil and dil */
+	REX_W = 0x08, /**< 64bit operand size */
+	REX_R = 0x04, /**< extension of the ModR/M reg field */
+	REX_X = 0x02, /**< extension of the SIB index field */
+	REX_B = 0x01, /**< extension of the ModR/M r/m or SIB base field */
+	/** The ModR/M reg field holds a byte register. */
+	REX_BYTE_REG = 0x100,
+	/** The ModR/M r/m field holds a byte register. */
+	REX_BYTE_RM  = 0x200,
+};
+
+enum OpSize {
+	OP_8       = 0x00, /* 8bit operation. */
+	OP_16_32   = 0x01, /* 16/32/64bit operation. */
+	OP_MEM_SRC = 0x02, /* The memory operand is in the source position. */
+	OP_IMM8    = 0x02, /* 8bit immediate, which gets sign extended. */
+	OP_RAX     = 0x04, /* Short form of instruction with al/ax/eax/rax as operand. */
+};
+
+/** The mod encoding of the ModR/M */
+enum Mod {
+	MOD_IND          = 0x00, /**< [reg1] */
+	MOD_IND_BYTE_OFS = 0x40, /**< [reg1 + byte ofs] */
+	MOD_IND_WORD_OFS = 0x80, /**< [reg1 + word ofs] */
+	MOD_REG          = 0xC0  /**< reg1 */
+};
+
+/** create encoding for a ModR/M byte */
+static uint8_t ENC_MODRM(uint8_t mod, unsigned reg, unsigned rm)
+{
+	return mod | (reg & 7) << 3 | (rm & 7);
+}
+
+/** create encoding for a SIB byte */
+static uint8_t ENC_SIB(unsigned scale, unsigned index, unsigned base)
+{
+	return scale << 6 | (index & 7) << 3 | (base & 7);
+}
+
+static bool is_8bit_val(int32_t const val)
+{
+	return -128 <= val && val < 128;
+}
+
+/**
+ * Returns true if @p imm of an operation of size @p size fits a sign extended
+ * 8bit immediate.  16bit immediates may be stored zero extended.
+ */
+static bool is_8bit_imm(x86_imm32_t const *const imm,
+                        amd64_insn_size_t const size)
+{
+	if (imm->entity != NULL)
+		return false;
+	int32_t const val = size == INSN_SIZE_16 ? (int16_t)imm->offset
+	                                         : imm->offset;
+	return is_8bit_val(val);
+}
+
+static unsigned get_reg_encoding(ir_node const *const node, int const pos)
+{
+	return arch_get_irn_register_in(node, pos)->encoding;
+}
+
+static unsigned get_out_encoding(ir_node const *const node, unsigned const pos)
+{
+	return arch_get_irn_register_out(node, pos)->encoding;
+}
+
+/** Returns the operand size prefix for an operation of size @p size. */
+static uint8_t get_size_prefix(amd64_insn_size_t const size)
+{
+	return size == INSN_SIZE_16 ? 0x66 : 0;
+}
+
+/** Returns the REX bits for an operation of size @p size. */
+static unsigned get_size_rex(amd64_insn_size_t const size)
+{
+	switch (size) {
+	case INSN_SIZE_8:  return REX_BYTE_REG | REX_BYTE_RM;
+	case INSN_SIZE_64: return REX_W;
+	default:           return 0;
+	}
+}
+
+/** Returns the size of the immediate operand of an operation. */
+static unsigned get_imm_size(amd64_insn_size_t const size)
+{
+	switch (size) {
+	case INSN_SIZE_8:  return 1;
+	case INSN_SIZE_16: return 2;
+	case INSN_SIZE_32:
+	case INSN_SIZE_64: return 4;
+	default:           break;
+	}
+	panic("invalid immediate size");
+}
+
+/** Returns the SSE prefix selecting single or double precision. */
+static uint8_t get_scalar_prefix(amd64_insn_size_t const size)
+{
+	return size == INSN_SIZE_32 ? 0xF3 : 0xF2;
+}
+
+/** Returns the REX bit needed to address the byte register @p encoding. */
+static unsigned rex_byte_reg(unsigned const encoding)
+{
+	return 4 <= encoding && encoding < 8 ? REX : 0;
+}
+
+static void enc_prefix_rex(uint8_t const prefix, unsigned const rex)
+{
+	if (prefix != 0)
+		be_emit8(prefix);
+	if ((rex & 0xFF) != 0)
+		be_emit8(REX | (rex & 0x0F));
+}
+
+/** Emits a one to three byte opcode, the leading bytes come first. */
+static void enc_opcode(unsigned const opcode)
+{
+	if (opcode > 0xFFFF)
+		be_emit8(opcode >> 16);
+	if (opcode > 0xFF)
+		be_emit8(opcode >> 8);
+	be_emit8(opcode);
+}
+
+/**
+ * Emit address of an entity.  @p adjust is added to the offset of PC relative
+ * relocations, which are relative to the end of the instruction.
+ */
+static void enc_relocation(uint8_t const kind, x86_imm32_t const *const imm,
+                           int32_t const adjust)
+{
+	ir_entity *entity = imm->entity;
+	int32_t    offset = imm->offset;
+	if (entity == NULL) {
+		be_emit32(offset);
+		return;
+	}
+
+	be_emit_reloc_entity(4, kind, entity, offset + adjust);
+}
+
+/** Emits the immediate @p imm of an operation of size @p size. */
+static void enc_imm(x86_imm32_t const *const imm, amd64_insn_size_t const size)
+{
+	switch (size) {
+	case INSN_SIZE_8:
+		assert(imm->entity == NULL);
+		be_emit8(imm->offset);
+		return;
+	case INSN_SIZE_16:
+		assert(imm->entity == NULL);
+		be_emit16(imm->offset);
+		return;
+	case INSN_SIZE_32:
+		/* zero extended into the 64bit register */
+		enc_relocation(AMD64_RELOCATION_ADDR32, imm, 0);
+		return;
+	case INSN_SIZE_64:
+		enc_relocation(X86_IMM_ADDR, imm, 0);
+		return;
+	default:
+		break;
+	}
+	panic("invalid immediate size");
+}
+
+static void enc_jmp_destination(ir_node const *const cfop)
+{
+	assert(get_irn_mode(cfop) == mode_X);
+	ir_node const *const dest_block = be_emit_get_cfop_target(cfop);
+	unsigned const fragment_num
+		= PTR_TO_INT(ir_nodehashmap_get(void, &block_fragmentnum, dest_block));
+	be_emit_reloc_fragment(4, AMD64_RELOCATION_RELJUMP, fragment_num, -4);
+}
+
+/* end emit routines, all emitters following here should only use the functions
+   above. */
+
+/**
+ * Emits an instruction with the register @p rm in the r/m field.  @p reg is
+ * either a register or an opcode extension.
+ */
+static void enc_rr(uint8_t const prefix, unsigned rex, unsigned const opcode,
+                   unsigned const reg, unsigned const rm)
+{
+	if (rex & REX_BYTE_REG)
+		rex |= rex_byte_reg(reg);
+	if (rex & REX_BYTE_RM)
+		rex |= rex_byte_reg(rm);
+	if (reg & 8)
+		rex |= REX_R;
+	if (rm & 8)
+		rex |= REX_B;
+	enc_prefix_rex(prefix, rex);
+	enc_opcode(opcode);
+	be_emit8(ENC_MODRM(MOD_REG, reg, rm));
+}
+
+/**
+ * Emits an instruction with the operand @p addr of @p node in the r/m field.
+ * @p imm_size is the size of an immediate following the address, which is
+ * needed for RIP relative addresses.
+ */
+static void enc_am(ir_node const *const node, amd64_addr_t const *const addr,
+                   uint8_t const prefix, unsigned rex, unsigned const opcode,
+                   unsigned const reg, unsigned const imm_size)
+{
+	x86_addr_variant_t const variant = addr->variant;
+	if (variant == X86_ADDR_REG) {
+		unsigned const rm = get_reg_encoding(node, addr->base_input);
+		enc_rr(prefix, rex, opcode, reg, rm);
+		return;
+	}
+
+	if (rex & REX_BYTE_REG)
+		rex |= rex_byte_reg(reg);
+	if (reg & 8)
+		rex |= REX_R;
+
+	bool     const has_base  = x86_addr_variant_has_base(variant);
+	bool     const has_index = x86_addr_variant_has_index(variant);
+	unsigned const base      = has_base ? get_reg_encoding(node, addr->base_input) : 0;
+	unsigned const index     = has_index ? get_reg_encoding(node, addr->index_input) : 0x04;
+	if (base & 8)
+		rex |= REX_B;
+	if (index & 8)
+		rex |= REX_X;
+	enc_prefix_rex(prefix, rex);
+	enc_opcode(opcode);
+
+	x86_imm32_t const *const imm = &addr->immediate;
+	if (variant == X86_ADDR_RIP) {
+		be_emit8(ENC_MODRM(MOD_IND, reg, 0x05));
+		/* the CPU adds the address of the next instruction */
+		enc_relocation(imm->kind, imm, -4 - (int32_t)imm_size);
+		return;
+	}
+
+	if (!has_base) {
+		/* SIB without base register, always 32bit displacement */
+		unsigned const scale = has_index ? addr->log_scale : 0;
+		be_emit8(ENC_MODRM(MOD_IND, reg, 0x04));
+		be_emit8(ENC_SIB(scale, index, 0x05));
+		enc_relocation(X86_IMM_ADDR, imm, 0);
+		return;
+	}
+
+	int32_t const offset = imm->offset;
+	uint8_t       mod;
+	if (imm->entity != NULL) {
+		mod = MOD_IND_WORD_OFS;
+	} else if (offset == 0 && (base & 7) != 0x05) {
+		/* [rbp] and [r13] have no encoding without displacement */
+		mod = MOD_IND;
+	} else if (is_8bit_val(offset)) {
+		mod = MOD_IND_BYTE_OFS;
+	} else {
+		mod = MOD_IND_WORD_OFS;
+	}
+
+	if (has_index || (base & 7) == 0x04) {
+		/* rsp and r12 as base need a SIB byte */
+		unsigned const scale = has_index ? addr->log_scale : 0;
+		be_emit8(ENC_MODRM(mod, reg, 0x04));
+		be_emit8(ENC_SIB(scale, index, base));
+	} else {
+		be_emit8(ENC_MODRM(mod, reg, base));
+	}
+
+	if (mod == MOD_IND_BYTE_OFS) {
+		be_emit8(offset);
+	} else if (mod == MOD_IND_WORD_OFS) {
+		enc_relocation(X86_IMM_ADDR, imm, 0);
+	}
+}
+
+static void enc_alu_imm(ir_node const *const node,
+                        amd64_addr_t const *const addr,
+                        amd64_insn_size_t const size, uint8_t const ext,
+                        x86_imm32_t const *const imm)
+{
+	uint8_t  const prefix = get_size_prefix(size);
+	unsigned const rex    = get_size_rex(size) & ~REX_BYTE_REG;
+	if (size != INSN_SIZE_8 && is_8bit_imm(imm, size)) {
+		enc_am(node, addr, prefix, rex, 0x80 | OP_16_32 | OP_IMM8, ext, 1);
+		be_emit8(imm->offset);
+		return;
+	}
+
+	uint8_t const op = size == INSN_SIZE_8 ? OP_8 : OP_16_32;
+	if (addr->variant == X86_ADDR_REG
+	 && get_reg_encoding(node, addr->base_input) == 0) {
+		enc_prefix_rex(prefix, rex & REX_W);
+		be_emit8(ext << 3 | OP_RAX | op);
+	} else {
+		enc_am(node, addr, prefix, rex, 0x80 | op, ext, get_imm_size(size));
+	}
+	enc_imm(imm, size);
+}
+
+/** Emits an add or sub of the constant @p offset to @p reg. */
+static void enc_alu_reg_imm(arch_register_t const *const reg, uint8_t const ext,
+                            int32_t const offset)
+{
+	if (is_8bit_val(offset)) {
+		enc_rr(0, REX_W, 0x80 | OP_16_32 | OP_IMM8, ext, reg->encoding);
+		be_emit8(offset);
+	} else if (reg->encoding == 0) {
+		enc_prefix_rex(0, REX_W);
+		be_emit8(ext << 3 | OP_RAX | OP_16_32);
+		be_emit32(offset);
+	} else {
+		enc_rr(0, REX_W, 0x80 | OP_16_32, ext, reg->encoding);
+		be_emit32(offset);
+	}
+}
+
+static void enc_mov(arch_register_t const *const src,
+                    arch_register_t const *const dst)
+{
+	enc_rr(0, REX_W, 0x89, src->encoding, dst->encoding);
+}
+
+static void enc_copy(ir_node const *const node)
+{
+	arch_register_t const *const in  = arch_get_irn_register_in(node, 0);
+	arch_register_t const *const out = arch_get_irn_register_out(node, 0);
+	if (in == out)
+		return;
+
+	arch_register_class_t const *const cls = out->cls;
+	if (cls == &amd64_reg_classes[CLASS_amd64_gp]) {
+		enc_mov(in, out);
+	} else if (cls == &amd64_reg_classes[CLASS_amd64_xmm]) {
+		/* movapd */
+		enc_rr(0x66, 0, 0x0F28, out->encoding, in->encoding);
+	} else if (cls == &amd64_reg_classes[CLASS_amd64_x87]) {
+		/* nothing to do */
+	} else {
+		panic("move not supported for this register class");
+	}
+}
+
+static void enc_perm(ir_node const *const node)
+{
+	arch_register_t const *const reg0 = arch_get_irn_register_out(node, 0);
+	arch_register_t const *const reg1 = arch_get_irn_register_out(node, 1);
+
+	arch_register_class_t const *const cls = reg0->cls;
+	assert(cls == reg1->cls && "Register class mismatch at Perm");
+
+	if (cls == &amd64_reg_classes[CLASS_amd64_gp]) {
+		if (reg0->encoding == 0 || reg1->encoding == 0) {
+			/* short form of xchg with rax */
+			unsigned const other = reg0->encoding | reg1->encoding;
+			enc_prefix_rex(0, REX_W | (other & 8 ? REX_B : 0));
+			be_emit8(0x90 + (other & 7));
+		} else {
+			enc_rr(0, REX_W, 0x87, reg0->encoding, reg1->encoding);
+		}
+	} else if (cls == &amd64_reg_classes[CLASS_amd64_xmm]) {
+		/* pxor */
+		enc_rr(0x66, 0, 0x0FEF, reg1->encoding, reg0->encoding);
+		enc_rr(0x66, 0, 0x0FEF, reg0->encoding, reg1->encoding);
+		enc_rr(0x66, 0, 0x0FEF, reg1->encoding, reg0->encoding);
+	} else {
+		panic("unexpected register class in be_Perm (%+F)", node);
+	}
+}
+
+static void enc_incsp(ir_node const *const node)
+{
+	int offs = be_get_IncSP_offset(node);
+	if (offs == 0)
+		return;
+
+	uint8_t ext;
+	if (offs > 0) {
+		ext = 5; /* sub */
+	} else {
+		ext = 0; /* add */
+		offs = -offs;
+	}
+	enc_alu_reg_imm(arch_get_irn_register_out(node, 0), ext, offs);
+}
+
+void amd64_enc_simple(uint8_t const opcode)
+{
+	be_emit8(opcode);
+}
+
+void amd64_enc_mem(ir_node const *const node, unsigned const opcode,
+                   uint8_t const ext)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	enc_am(node, &attr->addr, 0, 0, opcode, ext, 0);
+}
+
+void amd64_enc_binop(ir_node const *const node, uint8_t const ext)
+{
+	amd64_binop_addr_attr_t const *const attr = get_amd64_binop_addr_attr_const(node);
+	amd64_addr_t            const *const addr = &attr->base.addr;
+	amd64_insn_size_t        const       size = attr->base.size;
+
+	uint8_t  const prefix = get_size_prefix(size);
+	unsigned const rex    = get_size_rex(size);
+	uint8_t  const op     = size == INSN_SIZE_8 ? OP_8 : OP_16_32;
+	switch ((amd64_op_mode_t)attr->base.base.op_mode) {
+	case AMD64_OP_REG_IMM:
+	case AMD64_OP_ADDR_IMM:
+		enc_alu_imm(node, addr, size, ext, &attr->u.immediate);
+		return;
+	case AMD64_OP_REG_REG:
+		enc_am(node, addr, prefix, rex, ext << 3 | op, get_reg_encoding(node, 1), 0);
+		return;
+	case AMD64_OP_ADDR_REG: {
+		unsigned const reg = get_reg_encoding(node, attr->u.reg_input);
+		enc_am(node, addr, prefix, rex, ext << 3 | op, reg, 0);
+		return;
+	}
+	case AMD64_OP_REG_ADDR: {
+		unsigned const reg = get_reg_encoding(node, attr->u.reg_input);
+		enc_am(node, addr, prefix, rex, ext << 3 | OP_MEM_SRC | op, reg, 0);
+		return;
+	}
+	default:
+		break;
+	}
+	panic("invalid op_mode for binop %+F", node);
+}
+
+void amd64_enc_test(ir_node const *const node)
+{
+	amd64_binop_addr_attr_t const *const attr = get_amd64_binop_addr_attr_const(node);
+	amd64_addr_t            const *const addr = &attr->base.addr;
+	amd64_insn_size_t        const       size = attr->base.size;
+
+	uint8_t  const prefix = get_size_prefix(size);
+	unsigned const rex    = get_size_rex(size);
+	uint8_t  const op     = size == INSN_SIZE_8 ? OP_8 : OP_16_32;
+	switch ((amd64_op_mode_t)attr->base.base.op_mode) {
+	case AMD64_OP_REG_IMM:
+	case AMD64_OP_ADDR_IMM:
+		/* there is no short form with a sign extended 8bit immediate */
+		if (addr->variant == X86_ADDR_REG
+		 && get_reg_encoding(node, addr->base_input) == 0) {
+			enc_prefix_rex(prefix, rex & REX_W);
+			be_emit8(0xA8 | op);
+		} else {
+			enc_am(node, addr, prefix, rex & ~REX_BYTE_REG, 0xF6 | op, 0,
+			       get_imm_size(size));
+		}
+		enc_imm(&attr->u.immediate, size);
+		return;
+	case AMD64_OP_REG_REG:
+		enc_am(node, addr, prefix, rex, 0x84 | op, get_reg_encoding(node, 1), 0);
+		return;
+	case AMD64_OP_ADDR_REG:
+	case AMD64_OP_REG_ADDR: {
+		/* test is symmetric, so both forms use the same encoding */
+		unsigned const reg = get_reg_encoding(node, attr->u.reg_input);
+		enc_am(node, addr, prefix, rex, 0x84 | op, reg, 0);
+		return;
+	}
+	default:
+		break;
+	}
+	panic("invalid op_mode for test %+F", node);
+}
+
+void amd64_enc_unop(ir_node const *const node, uint8_t const opcode,
+                    uint8_t const ext)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	amd64_insn_size_t  const       size = attr->size;
+	/* the 8bit variant has the operand size bit cleared */
+	uint8_t const op = size == INSN_SIZE_8 ? opcode & ~OP_16_32 : opcode;
+	enc_am(node, &attr->addr, get_size_prefix(size),
+	       get_size_rex(size) & ~REX_BYTE_REG, op, ext, 0);
+}
+
+void amd64_enc_unop_reg(ir_node const *const node, unsigned const opcode)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	amd64_insn_size_t  const       size = attr->size;
+	enc_am(node, &attr->addr, get_size_prefix(size), get_size_rex(size),
+	       opcode, get_out_encoding(node, 0), 0);
+}
+
+void amd64_enc_shiftop(ir_node const *const node, uint8_t const ext)
+{
+	amd64_shift_attr_t const *const attr = get_amd64_shift_attr_const(node);
+	amd64_insn_size_t  const       size = attr->size;
+
+	uint8_t  const prefix = get_size_prefix(size);
+	unsigned const rex    = get_size_rex(size) & ~REX_BYTE_REG;
+	uint8_t  const op     = size == INSN_SIZE_8 ? OP_8 : OP_16_32;
+	unsigned const reg    = get_reg_encoding(node, 0);
+	switch ((amd64_op_mode_t)attr->base.op_mode) {
+	case AMD64_OP_SHIFT_IMM:
+		if (attr->immediate == 1) {
+			enc_rr(prefix, rex, 0xD0 | op, ext, reg);
+		} else {
+			enc_rr(prefix, rex, 0xC0 | op, ext, reg);
+			be_emit8(attr->immediate);
+		}
+		return;
+	case AMD64_OP_SHIFT_REG:
+		enc_rr(prefix, rex, 0xD2 | op, ext, reg);
+		return;
+	default:
+		break;
+	}
+	panic("invalid op_mode for shiftop %+F", node);
+}
+
+static void enc_imul(ir_node const *const node)
+{
+	amd64_binop_addr_attr_t const *const attr = get_amd64_binop_addr_attr_const(node);
+	amd64_addr_t            const *const addr = &attr->base.addr;
+	amd64_insn_size_t        const       size = attr->base.size;
+
+	uint8_t  const prefix = get_size_prefix(size);
+	unsigned const rex    = get_size_rex(size);
+	switch ((amd64_op_mode_t)attr->base.base.op_mode) {
+	case AMD64_OP_REG_IMM: {
+		/* imul $imm, %reg is imul $imm, %reg, %reg */
+		x86_imm32_t const *const imm = &attr->u.immediate;
+		unsigned           const reg = get_reg_encoding(node, addr->base_input);
+		if (is_8bit_imm(imm, size)) {
+			enc_rr(prefix, rex, 0x6B, reg, reg);
+			be_emit8(imm->offset);
+		} else {
+			enc_rr(prefix, rex, 0x69, reg, reg);
+			enc_imm(imm, size);
+		}
+		return;
+	}
+	case AMD64_OP_REG_REG: {
+		unsigned const reg = get_reg_encoding(node, addr->base_input);
+		enc_rr(prefix, rex, 0x0FAF, reg, get_reg_encoding(node, 1));
+		return;
+	}
+	case AMD64_OP_REG_ADDR: {
+		unsigned const reg = get_reg_encoding(node, attr->u.reg_input);
+		enc_am(node, addr, prefix, rex, 0x0FAF, reg, 0);
+		return;
+	}
+	default:
+		break;
+	}
+	panic("invalid op_mode for imul %+F", node);
+}
+
+static void enc_xor0(ir_node const *const node)
+{
+	unsigned const reg = get_out_encoding(node, 0);
+	enc_rr(0, 0, 0x31, reg, reg);
+}
+
+static void enc_mov_imm(ir_node const *const node)
+{
+	amd64_movimm_attr_t const *const attr = get_amd64_movimm_attr_const(node);
+	amd64_imm64_t       const *const imm  = &attr->immediate;
+	unsigned             const       reg  = get_out_encoding(node, 0);
+	unsigned             const       rexb = reg & 8 ? REX_B : 0;
+	x86_imm32_t          const       imm32 = {
+		.kind   = imm->kind,
+		.entity = imm->entity,
+		.offset = (int32_t)imm->offset,
+	};
+	switch (attr->size) {
+	case INSN_SIZE_32:
+		enc_prefix_rex(0, rexb);
+		be_emit8(0xB8 + (reg & 7));
+		enc_imm(&imm32, INSN_SIZE_32);
+		return;
+	case INSN_SIZE_64:
+		if (imm->entity != NULL || imm->offset == imm32.offset) {
+			/* sign extended 32bit immediate */
+			enc_rr(0, REX_W, 0xC7, 0, reg);
+			enc_imm(&imm32, INSN_SIZE_64);
+		} else {
+			/* movabs */
+			enc_prefix_rex(0, REX_W | rexb);
+			be_emit8(0xB8 + (reg & 7));
+			be_emit32((uint32_t)imm->offset);
+			be_emit32((uint32_t)((uint64_t)imm->offset >> 32));
+		}
+		return;
+	default:
+		break;
+	}
+	panic("invalid size for mov_imm %+F", node);
+}
+
+static void enc_movs(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	unsigned opcode;
+	switch (attr->size) {
+	case INSN_SIZE_8:  opcode = 0x0FBE; break; /* movsbq */
+	case INSN_SIZE_16: opcode = 0x0FBF; break; /* movswq */
+	case INSN_SIZE_32: opcode = 0x63;   break; /* movslq */
+	default:           panic("invalid size for movs %+F", node);
+	}
+	enc_am(node, &attr->addr, 0, REX_W, opcode, get_out_encoding(node, 0), 0);
+}
+
+static void enc_mov_gp(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	amd64_addr_t      const *const addr = &attr->addr;
+	unsigned           const       out  = get_out_encoding(node, 0);
+	switch (attr->size) {
+	case INSN_SIZE_8:  /* movzbq */
+		enc_am(node, addr, 0, REX_W, 0x0FB6, out, 0);
+		return;
+	case INSN_SIZE_16: /* movzwq */
+		enc_am(node, addr, 0, REX_W, 0x0FB7, out, 0);
+		return;
+	case INSN_SIZE_32:
+	case INSN_SIZE_64: {
+		unsigned const rex = attr->size == INSN_SIZE_64 ? REX_W : 0;
+		if (addr->variant == X86_ADDR_REG) {
+			enc_rr(0, rex, 0x89, get_reg_encoding(node, addr->base_input), out);
+		} else {
+			enc_am(node, addr, 0, rex, 0x8B, out, 0);
+		}
+		return;
+	}
+	default:
+		break;
+	}
+	panic("invalid size for mov_gp %+F", node);
+}
+
+static void enc_mov_store(ir_node const *const node)
+{
+	amd64_binop_addr_attr_t const *const attr = get_amd64_binop_addr_attr_const(node);
+	amd64_addr_t            const *const addr = &attr->base.addr;
+	amd64_insn_size_t        const       size = attr->base.size;
+
+	uint8_t  const prefix = get_size_prefix(size);
+	unsigned const rex    = get_size_rex(size);
+	uint8_t  const op     = size == INSN_SIZE_8 ? OP_8 : OP_16_32;
+	switch ((amd64_op_mode_t)attr->base.base.op_mode) {
+	case AMD64_OP_ADDR_REG: {
+		unsigned const reg = get_reg_encoding(node, attr->u.reg_input);
+		enc_am(node, addr, prefix, rex, 0x88 | op, reg, 0);
+		return;
+	}
+	case AMD64_OP_ADDR_IMM:
+		enc_am(node, addr, prefix, rex & ~REX_BYTE_REG, 0xC6 | op, 0,
+		       get_imm_size(size));
+		enc_imm(&attr->u.immediate, size);
+		return;
+	default:
+		break;
+	}
+	panic("invalid op_mode for mov_store %+F", node);
+}
+
+static void enc_cmpxchg(ir_node const *const node)
+{
+	amd64_binop_addr_attr_t const *const attr = get_amd64_binop_addr_attr_const(node);
+	amd64_insn_size_t        const       size = attr->base.size;
+	assert(attr->base.base.op_mode == AMD64_OP_ADDR_REG);
+
+	uint8_t const prefix = get_size_prefix(size);
+	if (prefix != 0)
+		be_emit8(prefix);
+	be_emit8(0xF0); /* lock */
+	unsigned const reg = get_reg_encoding(node, attr->u.reg_input);
+	enc_am(node, &attr->base.addr, 0, get_size_rex(size),
+	       size == INSN_SIZE_8 ? 0x0FB0 : 0x0FB1, reg, 0);
+}
+
+static void enc_setcc(ir_node const *const node)
+{
+	amd64_cc_attr_t const *const attr = get_amd64_cc_attr_const(node);
+	enc_rr(0, REX_BYTE_RM, 0x0F90 | (attr->cc & 0x0F), 0,
+	       get_out_encoding(node, 0));
+}
+
+static void enc_push_reg(ir_node const *const node)
+{
+	unsigned const reg = get_reg_encoding(node, n_amd64_push_reg_val);
+	enc_prefix_rex(0, reg & 8 ? REX_B : 0);
+	be_emit8(0x50 + (reg & 7));
+}
+
+static void enc_sub_sp(ir_node const *const node)
+{
+	/* sub %in, %rsp */
+	amd64_enc_binop(node, 5);
+	/* mov %rsp, %out */
+	enc_mov(&amd64_registers[REG_RSP],
+	        arch_get_irn_register_out(node, pn_amd64_sub_sp_addr));
+}
+
+static bool fallthrough_possible(ir_node const *const block,
+                                 ir_node const *const target)
+{
+	return be_emit_get_prev_block(target) == block;
+}
+
+static void enc_jmp(ir_node const *const cfop)
+{
+	be_emit8(0xE9);
+	enc_jmp_destination(cfop);
+}
+
+static void enc_jump(ir_node const *const node)
+{
+	ir_node const *const block  = get_nodes_block(node);
+	ir_node const *const target = be_emit_get_cfop_target(node);
+	if (fallthrough_possible(block, target))
+		return;
+
+	enc_jmp(node);
+}
+
+static void enc_jcc(x86_condition_code_t const cc, ir_node const *const cfop)
+{
+	be_emit8(0x0F);
+	be_emit8(0x80 + (cc & 0x0F));
+	enc_jmp_destination(cfop);
+}
+
+static void enc_amd64_jcc(ir_node const *const node)
+{
+	ir_node const *const block      = get_nodes_block(node);
+	ir_node const *      proj_true  = get_Proj_for_pn(node, pn_Cond_true);
+	ir_node const *      proj_false = get_Proj_for_pn(node, pn_Cond_false);
+
+	ir_node         const *const flags = get_irn_n(node, n_amd64_jcc_eflags);
+	amd64_cc_attr_t const *const attr  = get_amd64_cc_attr_const(node);
+	x86_condition_code_t         cc    = amd64_determine_final_cc(flags, attr->cc);
+
+	ir_node const *const target_true = be_emit_get_cfop_target(proj_true);
+	if (fallthrough_possible(block, target_true)) {
+		/* exchange both proj's so the second one can be omitted */
+		ir_node const *const t = proj_true;
+		proj_true  = proj_false;
+		proj_false = t;
+		cc         = x86_negate_condition_code(cc);
+	}
+
+	if (cc & x86_cc_float_parity_cases) {
+		/* Some floating point comparisons require a test of the parity flag,
+		 * which indicates that the result is unordered */
+		enc_jcc(x86_cc_parity, cc & x86_cc_negated ? proj_true : proj_false);
+	}
+
+	enc_jcc(cc, proj_true);
+
+	ir_node const *const target_false = be_emit_get_cfop_target(proj_false);
+	if (!fallthrough_possible(block, target_false))
+		enc_jmp(proj_false);
+}
+
+static void enc_call(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	if (attr->base.op_mode == AMD64_OP_IMM32) {
+		x86_imm32_t const *const imm = &attr->addr.immediate;
+		assert(imm->kind == X86_IMM_PCREL || imm->kind == X86_IMM_PLT);
+		be_emit8(0xE8);
+		enc_relocation(imm->kind, imm, -4);
+	} else {
+		enc_am(node, &attr->addr, 0, 0, 0xFF, 2, 0);
+	}
+
+	if (is_cfop(node)) {
+		/* If the call throws we have to add a jump to its X_regular block. */
+		ir_node const *const x_regular_proj
+			= get_Proj_for_pn(node, node->op->pn_x_regular);
+		if (x_regular_proj != NULL)
+			enc_jump(x_regular_proj);
+	}
+}
+
+static void enc_tail_call(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	if (attr->base.op_mode == AMD64_OP_IMM32) {
+		x86_imm32_t const *const imm = &attr->addr.immediate;
+		assert(imm->kind == X86_IMM_PCREL || imm->kind == X86_IMM_PLT);
+		be_emit8(0xE9);
+		enc_relocation(imm->kind, imm, -4);
+	} else {
+		enc_am(node, &attr->addr, 0, 0, 0xFF, 4, 0);
+	}
+}
+
+static void enc_jmp_switch(ir_node const *const node)
+{
+	/* amd64_lower_for_target() lowers all switches for ELF output */
+	assert(!amd64_emit_elf);
+
+	amd64_switch_jmp_attr_t const *const attr
+		= get_amd64_switch_jmp_attr_const(node);
+	enc_am(node, &attr->base.addr, 0, 0, 0xFF, 4, 0);
+
+	ir_mode *const entry_mode = be_options.pic_style != BE_PIC_NONE
+	                          ? mode_Iu : mode_Lu;
+	be_emit_jump_table(node, attr->table, attr->table_entity, entry_mode,
+	                   amd64_emit_jumptable_target);
+}
+
+static void enc_movq(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	amd64_addr_t      const *const addr = &attr->addr;
+	unsigned           const       out  = get_out_encoding(node, 0);
+	if (addr->variant == X86_ADDR_REG
+	 && arch_get_irn_register_in(node, addr->base_input)->cls
+	    == &amd64_reg_classes[CLASS_amd64_gp]) {
+		enc_am(node, addr, 0x66, REX_W, 0x0F6E, out, 0);
+	} else {
+		enc_am(node, addr, 0xF3, 0, 0x0F7E, out, 0);
+	}
+}
+
+static void enc_movs_xmm(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	amd64_enc_sse_unop(node, get_scalar_prefix(attr->size), 0x0F10, false);
+}
+
+/** Encodes "op %S0, %A" for SSE stores. */
+static void enc_sse_store(ir_node const *const node, uint8_t const prefix,
+                          unsigned const opcode)
+{
+	amd64_binop_addr_attr_t const *const attr = get_amd64_binop_addr_attr_const(node);
+	enc_am(node, &attr->base.addr, prefix, 0, opcode,
+	       get_reg_encoding(node, 0), 0);
+}
+
+static void enc_movs_store_xmm(ir_node const *const node)
+{
+	amd64_binop_addr_attr_t const *const attr = get_amd64_binop_addr_attr_const(node);
+	enc_sse_store(node, get_scalar_prefix(attr->base.size), 0x0F11);
+}
+
+static void enc_movdqu_store(ir_node const *const node)
+{
+	enc_sse_store(node, 0xF3, 0x0F7F);
+}
+
+/** Encodes the packed operations, which select the precision by a prefix. */
+static void enc_sse_packed(ir_node const *const node, unsigned const opcode)
+{
+	amd64_binop_addr_attr_t const *const attr = get_amd64_binop_addr_attr_const(node);
+	amd64_enc_sse_binop(node, attr->base.size == INSN_SIZE_32 ? 0 : 0x66, opcode);
+}
+
+static void enc_ucomis(ir_node const *const node)
+{
+	enc_sse_packed(node, 0x0F2E);
+}
+
+static void enc_xorp(ir_node const *const node)
+{
+	enc_sse_packed(node, 0x0F57);
+}
+
+static void enc_xorpd_0(ir_node const *const node)
+{
+	unsigned const reg = get_out_encoding(node, 0);
+	enc_rr(0x66, 0, 0x0F57, reg, reg);
+}
+
+static void enc_movd_xmm_gp(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	unsigned const rex = attr->size == INSN_SIZE_64 ? REX_W : 0;
+	enc_rr(0x66, rex, 0x0F7E, get_reg_encoding(node, 0),
+	       get_out_encoding(node, 0));
+}
+
+static void enc_movd_gp_xmm(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	unsigned const rex = attr->size == INSN_SIZE_64 ? REX_W : 0;
+	enc_rr(0x66, rex, 0x0F6E, get_out_encoding(node, 0),
+	       get_reg_encoding(node, 0));
+}
+
+void amd64_enc_sse_scalar(ir_node const *const node, unsigned const opcode)
+{
+	amd64_binop_addr_attr_t const *const attr = get_amd64_binop_addr_attr_const(node);
+	amd64_enc_sse_binop(node, get_scalar_prefix(attr->base.size), opcode);
+}
+
+void amd64_enc_sse_binop(ir_node const *const node, uint8_t const prefix,
+                         unsigned const opcode)
+{
+	amd64_binop_addr_attr_t const *const attr = get_amd64_binop_addr_attr_const(node);
+	amd64_addr_t            const *const addr = &attr->base.addr;
+	switch ((amd64_op_mode_t)attr->base.base.op_mode) {
+	case AMD64_OP_REG_REG: {
+		unsigned const dst = get_reg_encoding(node, addr->base_input);
+		enc_rr(prefix, 0, opcode, dst, get_reg_encoding(node, 1));
+		return;
+	}
+	case AMD64_OP_REG_ADDR: {
+		unsigned const reg = get_reg_encoding(node, attr->u.reg_input);
+		enc_am(node, addr, prefix, 0, opcode, reg, 0);
+		return;
+	}
+	default:
+		break;
+	}
+	panic("invalid op_mode for SSE operation %+F", node);
+}
+
+void amd64_enc_sse_packed(ir_node const *const node, unsigned const opcode)
+{
+	amd64_binop_addr_attr_t const *const attr = get_amd64_binop_addr_attr_const(node);
+	amd64_enc_sse_binop(node, attr->base.size == INSN_SIZE_64 ? 0x66 : 0,
+	                    opcode);
+}
+
+void amd64_enc_sse_packed_int(ir_node const *const node,
+                              unsigned const opcode_8, unsigned const opcode_16,
+                              unsigned const opcode_32, unsigned const opcode_64)
+{
+	amd64_binop_addr_attr_t const *const attr = get_amd64_binop_addr_attr_const(node);
+	unsigned opcode;
+	switch ((amd64_insn_size_t)attr->base.size) {
+	case INSN_SIZE_8:  opcode = opcode_8;  break;
+	case INSN_SIZE_16: opcode = opcode_16; break;
+	case INSN_SIZE_32: opcode = opcode_32; break;
+	case INSN_SIZE_64: opcode = opcode_64; break;
+	default:
+		panic("invalid lane size for %+F", node);
+	}
+	amd64_enc_sse_binop(node, 0x66, opcode);
+}
+
+void amd64_enc_sse_unop(ir_node const *const node, uint8_t const prefix,
+                        unsigned const opcode, bool const int_size)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	unsigned const rex = int_size && attr->size == INSN_SIZE_64 ? REX_W : 0;
+	enc_am(node, &attr->addr, prefix, rex, opcode, get_out_encoding(node, 0), 0);
+}
+
+void amd64_enc_fsimple(uint8_t const opcode)
+{
+	be_emit8(0xD9);
+	be_emit8(opcode);
+}
+
+void amd64_enc_fbinop(ir_node const *const node, uint8_t const op_fwd,
+                      uint8_t const op_rev)
+{
+	x87_attr_t const *const x87 = amd64_get_x87_attr_const(node);
+	assert(!x87->pop || x87->res_in_reg);
+
+	uint8_t op0 = 0xD8;
+	if (x87->res_in_reg) op0 |= 0x04;
+	if (x87->pop)        op0 |= 0x02;
+	be_emit8(op0);
+
+	uint8_t const op = x87->reverse ? op_rev : op_fwd;
+	be_emit8(ENC_MODRM(MOD_REG, op, x87->reg->encoding));
+}
+
+void amd64_enc_fop_reg(ir_node const *const node, uint8_t const op0,
+                       uint8_t const op1)
+{
+	be_emit8(op0);
+	be_emit8(op1 + amd64_get_x87_attr_const(node)->reg->encoding);
+}
+
+static void enc_fld(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	switch (attr->size) {
+	case INSN_SIZE_32: amd64_enc_mem(node, 0xD9, 0); return; /* flds */
+	case INSN_SIZE_64: amd64_enc_mem(node, 0xDD, 0); return; /* fldl */
+	case INSN_SIZE_80: amd64_enc_mem(node, 0xDB, 5); return; /* fldt */
+	default:           break;
+	}
+	panic("invalid size for fld %+F", node);
+}
+
+static void enc_fild(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	switch (attr->size) {
+	case INSN_SIZE_16: amd64_enc_mem(node, 0xDF, 0); return; /* filds */
+	case INSN_SIZE_32: amd64_enc_mem(node, 0xDB, 0); return; /* fildl */
+	case INSN_SIZE_64: amd64_enc_mem(node, 0xDF, 5); return; /* fildll */
+	default:           break;
+	}
+	panic("invalid size for fild %+F", node);
+}
+
+static void enc_fisttp(ir_node const *const node)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	switch (attr->size) {
+	case INSN_SIZE_16: amd64_enc_mem(node, 0xDF, 1); return; /* fisttps */
+	case INSN_SIZE_32: amd64_enc_mem(node, 0xDB, 1); return; /* fisttpl */
+	case INSN_SIZE_64: amd64_enc_mem(node, 0xDD, 1); return; /* fisttpll */
+	default:           break;
+	}
+	panic("invalid size for fisttp %+F", node);
+}
+
+static void enc_fst_pop(ir_node const *const node, bool const pop)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	uint8_t const ext = pop ? 3 : 2;
+	switch (attr->size) {
+	case INSN_SIZE_32: amd64_enc_mem(node, 0xD9, ext); return; /* fst[p]s */
+	case INSN_SIZE_64: amd64_enc_mem(node, 0xDD, ext); return; /* fst[p]l */
+	case INSN_SIZE_80:
+		/* There is only a pop variant for long double store. */
+		assert(pop);
+		amd64_enc_mem(node, 0xDB, 7); /* fstpt */
+		return;
+	default:
+		break;
+	}
+	panic("invalid size for fst %+F", node);
+}
+
+static void enc_fst(ir_node const *const node)
+{
+	enc_fst_pop(node, amd64_get_x87_attr_const(node)->pop);
+}
+
+static void enc_fstp(ir_node const *const node)
+{
+	enc_fst_pop(node, true);
+}
+
+static void enc_fucomi(ir_node const *const node)
+{
+	x87_attr_t const *const attr = amd64_get_x87_attr_const(node);
+	be_emit8(attr->pop ? 0xDF : 0xDB); // fucom[p]i
+	be_emit8(0xE8 + attr->reg->encoding);
+}
+
+static void amd64_register_binary_emitters(void)
+{
+	be_init_emitters();
+
+	amd64_register_spec_binary_emitters();
+
+	/* benode emitter */
+	be_set_emitter(op_be_Copy,              enc_copy);
+	be_set_emitter(op_be_CopyKeep,          enc_copy);
+	be_set_emitter(op_be_IncSP,             enc_incsp);
+	be_set_emitter(op_be_Perm,              enc_perm);
+	be_set_emitter(op_amd64_call,           enc_call);
+	be_set_emitter(op_amd64_cmpxchg,        enc_cmpxchg);
+	be_set_emitter(op_amd64_fild,           enc_fild);
+	be_set_emitter(op_amd64_fisttp,         enc_fisttp);
+	be_set_emitter(op_amd64_fld,            enc_fld);
+	be_set_emitter(op_amd64_fst,            enc_fst);
+	be_set_emitter(op_amd64_fstp,           enc_fstp);
+	be_set_emitter(op_amd64_fucomi,         enc_fucomi);
+	be_set_emitter(op_amd64_imul,           enc_imul);
+	be_set_emitter(op_amd64_jcc,            enc_amd64_jcc);
+	be_set_emitter(op_amd64_jmp,            enc_jump);
+	be_set_emitter(op_amd64_jmp_switch,     enc_jmp_switch);
+	be_set_emitter(op_amd64_mov_gp,         enc_mov_gp);
+	be_set_emitter(op_amd64_mov_imm,        enc_mov_imm);
+	be_set_emitter(op_amd64_mov_store,      enc_mov_store);
+	be_set_emitter(op_amd64_movd_gp_xmm,    enc_movd_gp_xmm);
+	be_set_emitter(op_amd64_movd_xmm_gp,    enc_movd_xmm_gp);
+	be_set_emitter(op_amd64_movdqu_store,   enc_movdqu_store);
+	be_set_emitter(op_amd64_movq,           enc_movq);
+	be_set_emitter(op_amd64_movs,           enc_movs);
+	be_set_emitter(op_amd64_movs_store_xmm, enc_movs_store_xmm);
+	be_set_emitter(op_amd64_movs_xmm,       enc_movs_xmm);
+	be_set_emitter(op_amd64_push_reg,       enc_push_reg);
+	be_set_emitter(op_amd64_setcc,          enc_setcc);
+	be_set_emitter(op_amd64_sub_sp,         enc_sub_sp);
+	be_set_emitter(op_amd64_tail_call,      enc_tail_call);
+	be_set_emitter(op_amd64_ucomis,         enc_ucomis);
+	be_set_emitter(op_amd64_xor_0,          enc_xor0);
+	be_set_emitter(op_amd64_xorp,           enc_xorp);
+	be_set_emitter(op_amd64_xorpd_0,        enc_xorpd_0);
+}
+
+static void assign_block_fragment_num(ir_node *const block, unsigned const num)
+{
+	assert(ir_nodehashmap_get(void, &block_fragmentnum, block) == NULL);
+	ir_nodehashmap_insert(&block_fragmentnum, block, INT_TO_PTR(num));
+}
+
+static void gen_binary_block(ir_node *const block)
+{
+	uint8_t p2align  = 0;
+	uint8_t max_skip = 0;
+	if (amd64_should_align_block(block)) {
+		p2align  = AMD64_LABEL_ALIGNMENT;
+		max_skip = AMD64_LABEL_ALIGNMENT_MAX_SKIP;
+	}
+
+	unsigned fragment_num = be_begin_fragment(p2align, max_skip);
+	assert(fragment_num
+	       == (unsigned)PTR_TO_INT(ir_nodehashmap_get(void, &block_fragmentnum, block)));
+	(void)fragment_num;
+
+	/* emit the contents of the block */
+	sched_foreach(block, node) {
+		be_emit_node(node);
+	}
+
+	be_finish_fragment();
+}
+
+ir_jit_function_t *amd64_emit_jit(ir_jit_segment_t *const segment,
+                                  ir_graph *const irg)
+{
+	amd64_register_binary_emitters();
+
+	ir_node **const blk_sched = be_create_block_schedule(irg);
+
+	be_jit_begin_function(segment);
+
+	/* we use links to point to target blocks */
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+
+	be_emit_init_cf_links(blk_sched);
+
+	ir_nodehashmap_init(&block_fragmentnum);
+	size_t n = ARR_LEN(blk_sched);
+	for (size_t i = 0; i < n; ++i) {
+		ir_node *block = blk_sched[i];
+		assign_block_fragment_num(block, (unsigned)i);
+	}
+	for (size_t i = 0; i < n; ++i) {
+		ir_node *block = blk_sched[i];
+		gen_binary_block(block);
+	}
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	ir_nodehashmap_destroy(&block_fragmentnum);
+
+	return be_jit_finish_function();
+}
+
+unsigned amd64_emit_jit_relocation(char *const buffer, uint8_t const be_kind,
+                                   ir_entity *const entity, int32_t const offset)
+{
+	if (entity == NULL) {
+		assert(be_kind == AMD64_RELOCATION_RELJUMP);
+		memcpy(buffer, &offset, 4);
+		return 4;
+	}
+
+	intptr_t const entity_addr = (intptr_t)be_jit_get_entity_addr(entity);
+	if (entity_addr == (intptr_t)-1)
+		panic("Could not resolve address of entity %+F", entity);
+	intptr_t addr = entity_addr + offset;
+	switch (be_kind) {
+	case X86_IMM_ADDR:
+		break;
+	case AMD64_RELOCATION_ADDR32: {
+		uint32_t const value = (uint32_t)addr;
+		if ((intptr_t)value != addr)
+			panic("Overflow in relocation");
+		memcpy(buffer, &value, 4);
+		return 4;
+	}
+	case X86_IMM_PCREL:
+	case X86_IMM_PLT:
+		addr -= (intptr_t)be_jit_exec_address(buffer);
+		break;
+	default:
+		panic("relocation kind %u to %+F not supported in jit code",
+		      be_kind, entity);
+	}
+
+	int32_t const value = (int32_t)addr;
+	if ((intptr_t)value != addr)
+		panic("Overflow in relocation");
+	memcpy(buffer, &value, 4);
+	return 4;
+}
+
+void amd64_emit_jit_function(char *buffer, ir_jit_function_t *const function)
+{
+	static const be_jit_emit_interface_t jit_emit_interface = {
+		.nops       = x86_enc_nops,
+		.relocation = amd64_emit_jit_relocation,
+	};
+	be_jit_emit_memory(buffer, function, &jit_emit_interface);
+}
+
+static unsigned enc_elf_relocation_callback(char *const buffer,
+                                            uint8_t const be_kind,
+                                            ir_entity *const entity,
+                                            int32_t const offset)
+{
+	/* Intra function jumps are resolved already, everything else gets a
+	 * relocation with an explicit addend. */
+	if (entity == NULL) {
+		assert(be_kind == AMD64_RELOCATION_RELJUMP);
+		memcpy(buffer, &offset, 4);
+		return 4;
+	}
+
+	uint32_t type;
+	switch (be_kind) {
+	case X86_IMM_ADDR:            type = R_X86_64_32S;      break;
+	case AMD64_RELOCATION_ADDR32: type = R_X86_64_32;       break;
+	case X86_IMM_PCREL:           type = R_X86_64_PC32;     break;
+	case X86_IMM_PLT:             type = R_X86_64_PLT32;    break;
+	case X86_IMM_GOTPCREL:        type = R_X86_64_GOTPCREL; break;
+	default:
+		panic("relocation kind %u to %+F not supported in ELF object files",
+		      be_kind, entity);
+	}
+	memset(buffer, 0, 4);
+	be_elf_relocation(buffer, type, entity, offset);
+	return 4;
+}
+
+be_elf_target_t const amd64_elf_target = {
+	.machine   = 62, /* EM_X86_64 */
+	.elf64     = true,
+	.rela      = true,
+	.reloc_abs = R_X86_64_64,
+	.nops      = x86_enc_nops,
+};
+
+void amd64_emit_elf_function(ir_graph *const irg)
+{
+	ir_jit_segment_t  *const segment  = be_new_jit_segment();
+	ir_jit_function_t *const function = amd64_emit_jit(segment, irg);
+
+	char *const buffer
+		= be_elf_begin_function(get_irg_entity(irg), 4,
+		                        be_get_function_size(function));
+	static const be_jit_emit_interface_t elf_emit_interface = {
+		.nops       = x86_enc_nops,
+		.relocation = enc_elf_relocation_callback,
+	};
+	be_jit_emit_memory(buffer, function, &elf_emit_interface);
+
+	be_destroy_jit_segment(segment);
+}
@@ -0,0 +1,94 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       amd64 binary encoding
+ */
+#ifndef FIRM_BE_AMD64_AMD64_ENCODE_H
+#define FIRM_BE_AMD64_AMD64_ENCODE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "beelf.h"
+#include "firm_types.h"
+#include "jit.h"
+
+/**
+ * Relocation kinds besides the x86_immediate_kind_t ones.  X86_IMM_ADDR is a
+ * sign extended 32bit address.
+ */
+enum {
+	AMD64_RELOCATION_RELJUMP = 128, /**< relative jump to a code fragment */
+	AMD64_RELOCATION_ADDR32,        /**< zero extended 32bit address */
+};
+
+ir_jit_function_t *amd64_emit_jit(ir_jit_segment_t *segment, ir_graph *irg);
+
+void amd64_emit_jit_function(char *buffer, ir_jit_function_t *function);
+
+unsigned amd64_emit_jit_relocation(char *buffer, uint8_t be_kind,
+                                   ir_entity *entity, int32_t offset);
+
+/** Target description to write x86-64 ELF object files. */
+extern be_elf_target_t const amd64_elf_target;
+
+/** Encodes the function @p irg into the ELF object file. */
+void amd64_emit_elf_function(ir_graph *irg);
+
+void amd64_enc_simple(uint8_t opcode);
+
+/** Encodes a memory operation without operand size, like push and pop. */
+void amd64_enc_mem(ir_node const *node, unsigned opcode, uint8_t ext);
+
+/** Encodes an arithmetic operation with the group 1 opcode extension @p ext. */
+void amd64_enc_binop(ir_node const *node, uint8_t ext);
+
+/** Encodes a test, which has no group 1 opcode extension. */
+void amd64_enc_test(ir_node const *node);
+
+void amd64_enc_unop(ir_node const *node, uint8_t opcode, uint8_t ext);
+
+/** Encodes "op %AM, %D0" with the result register in the reg field. */
+void amd64_enc_unop_reg(ir_node const *node, unsigned opcode);
+
+void amd64_enc_shiftop(ir_node const *node, uint8_t ext);
+
+/**
+ * Encodes a SSE operation on scalar floats, the size of @p node selects the
+ * single or double precision variant.
+ */
+void amd64_enc_sse_scalar(ir_node const *node, unsigned opcode);
+
+void amd64_enc_sse_binop(ir_node const *node, uint8_t prefix, unsigned opcode);
+
+/**
+ * Encodes a packed SSE operation on floats, the size of @p node is the size of
+ * a lane and selects the single or double precision variant.
+ */
+void amd64_enc_sse_packed(ir_node const *node, unsigned opcode);
+
+/**
+ * Encodes a packed SSE operation on integers, the size of @p node is the size
+ * of a lane and selects one of the opcodes.
+ */
+void amd64_enc_sse_packed_int(ir_node const *node, unsigned opcode_8,
+                              unsigned opcode_16, unsigned opcode_32,
+                              unsigned opcode_64);
+
+/**
+ * Encodes "op %AM, %D0" for SSE operations.  If @p int_size is set, the size
+ * of @p node is the one of the general purpose register operand.
+ */
+void amd64_enc_sse_unop(ir_node const *node, uint8_t prefix, unsigned opcode,
+                        bool int_size);
+
+void amd64_enc_fsimple(uint8_t opcode);
+
+void amd64_enc_fbinop(ir_node const *node, uint8_t op_fwd, uint8_t op_rev);
+
+void amd64_enc_fop_reg(ir_node const *node, uint8_t op0, uint8_t op1);
+
+#endif
@@ -20,6 +20,7 @@
 #include "ircons_t.h"
 #include "iropt_t.h"
 #include "irprintf.h"
+#include "obst.h"
 #include "xmalloc.h"
 #include "bedump.h"
 
@@ -29,6 +30,16 @@
 #include "bearch_amd64_t.h"
 #include "gen_amd64_regalloc_if.h"
 
+struct obstack amd64_opcodes_obst;
+
+unsigned get_amd64_latency(const ir_node *node)
+{
+	assert(is_amd64_irn(node));
+	const ir_op           *op      = get_irn_op(node);
+	const amd64_op_attr_t *op_attr = (const amd64_op_attr_t*)get_op_attr(op);
+	return op_attr->latency;
+}
+
 amd64_insn_size_t get_amd64_insn_size(const ir_node *node)
 {
 	if (is_amd64_mov_imm(node)) {
@@ -313,3 +324,10 @@ int amd64_x87_binop_addr_attrs_equal(const ir_node *const a,
 	/* ignore x87 part for now */
 	return amd64_binop_addr_attrs_equal(a, b);
 }
+
+void amd64_init_op(ir_op *op, unsigned latency)
+{
+	amd64_op_attr_t *attr = OALLOCZ(&amd64_opcodes_obst, amd64_op_attr_t);
+	attr->latency = latency;
+	set_op_attr(op, attr);
+}
@@ -185,6 +185,13 @@ static inline amd64_x87_binop_addr_attr_t *get_amd64_x87_binop_addr_attr(
 x87_attr_t *amd64_get_x87_attr(ir_node *node);
 x87_attr_t const *amd64_get_x87_attr_const(ir_node const *node);
 
+extern struct obstack amd64_opcodes_obst;
+
+/**
+ * Returns the latency of an amd64 node as declared in the spec file.
+ */
+unsigned get_amd64_latency(const ir_node *node);
+
 amd64_insn_size_t get_amd64_insn_size(const ir_node *node);
 unsigned amd64_get_insn_size_bits(amd64_insn_size_t insn_size);
 
@@ -37,4 +37,6 @@ int amd64_x87_attrs_equal(const ir_node *a, const ir_node *b);
 int amd64_x87_addr_attrs_equal(const ir_node *a, const ir_node *b);
 int amd64_x87_binop_addr_attrs_equal(const ir_node *a, const ir_node *b);
 
+void amd64_init_op(ir_op *op, unsigned latency);
+
 #endif
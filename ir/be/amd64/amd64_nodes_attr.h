@@ -78,6 +78,10 @@ typedef struct amd64_addr_t {
 	ENUMBF(x86_addr_variant_t)       variant : 3;
 } amd64_addr_t;
 
+typedef struct amd64_op_attr_t {
+	unsigned latency;
+} amd64_op_attr_t;
+
 typedef struct amd64_attr_t {
 	except_attr exc; /**< the exception attribute. MUST be the first one. */
 	amd64_op_mode_t op_mode;
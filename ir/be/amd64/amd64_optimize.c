@@ -15,8 +15,27 @@
 #include "bepeephole.h"
 #include "besched.h"
 #include "gen_amd64_regalloc_if.h"
+#include "iredges_t.h"
+#include "irgmod.h"
 #include "util.h"
 
+static arch_register_t const *const flags_reg = &amd64_registers[REG_EFLAGS];
+
+/**
+ * Replaces the result @p pn of @p node by @p value, which must be in the same
+ * register, and removes @p node.
+ */
+static void replace_result(ir_node *const node, unsigned const pn,
+                           ir_node *const value)
+{
+	ir_node *const res = get_Proj_for_pn(node, pn);
+	if (res != NULL) {
+		edges_reroute(res, value);
+		kill_node(res);
+	}
+	be_peephole_exchange(node, value);
+}
+
 static void make_add(ir_node *const node, size_t const n_in, ir_node *const *const in, arch_register_req_t const **const reqs, amd64_binop_addr_attr_t const *const attr, arch_register_t const *const oreg)
 {
 	dbg_info *const dbgi  = get_irn_dbg_info(node);
@@ -28,6 +47,23 @@ static void make_add(ir_node *const node, size_t const n_in, ir_node *const *con
 	be_peephole_exchange(node, res);
 }
 
+static void make_shl(ir_node *const node, ir_node *const value, amd64_insn_size_t const size, uint8_t const amount, arch_register_t const *const oreg)
+{
+	dbg_info *const dbgi  = get_irn_dbg_info(node);
+	ir_node  *const block = get_nodes_block(node);
+	ir_node  *const in[]  = { value };
+	amd64_shift_attr_t const shl_attr = {
+		.base      = { .op_mode = AMD64_OP_SHIFT_IMM, },
+		.size      = size,
+		.immediate = amount,
+	};
+	ir_node *const shl = new_bd_amd64_shl(dbgi, block, ARRAY_SIZE(in), in, reg_reqs, &shl_attr);
+	arch_set_irn_register_req_out(shl, 0, &amd64_requirement_gp_same_0);
+	sched_add_before(node, shl);
+	ir_node *const res = be_new_Proj_reg(shl, pn_amd64_shl_res, oreg);
+	be_peephole_exchange(node, res);
+}
+
 static void peephole_amd64_lea(ir_node *const node)
 {
 	if (be_peephole_get_value(REG_EFLAGS))
@@ -36,7 +72,12 @@ static void peephole_amd64_lea(ir_node *const node)
 	arch_register_t   const *const oreg = arch_get_irn_register_out(node, pn_amd64_lea_res);
 	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
 	amd64_addr_t      const *const addr = &attr->addr;
-	if (addr->variant == X86_ADDR_BASE) {
+	if (addr->variant == X86_ADDR_INDEX && !addr->immediate.entity && addr->immediate.offset == 0) {
+		/* lea (,%r,1<<c), %r -> shl $c, %r */
+		ir_node *const idx = get_irn_n(node, addr->index_input);
+		if (oreg == arch_get_irn_register(idx))
+			make_shl(node, idx, attr->size, addr->log_scale, oreg);
+	} else if (addr->variant == X86_ADDR_BASE) {
 		/* lea c(%r), %r -> add $c, %r */
 		ir_node *const base = get_irn_n(node, addr->base_input);
 		if (oreg == arch_get_irn_register(base)) {
@@ -105,10 +146,239 @@ static void peephole_amd64_mov_imm(ir_node *const node)
 	}
 }
 
+/**
+ * Replace cmp $0, %r by test %r, %r.
+ */
+static void peephole_amd64_cmp(ir_node *const node)
+{
+	amd64_binop_addr_attr_t const *const attr = get_amd64_binop_addr_attr_const(node);
+	if (attr->base.base.op_mode != AMD64_OP_REG_IMM)
+		return;
+	x86_imm32_t const *const imm = &attr->u.immediate;
+	if (imm->entity != NULL || imm->offset != 0)
+		return;
+
+	amd64_binop_addr_attr_t const test_attr = {
+		.base = {
+			.base = { .op_mode = AMD64_OP_REG_REG, },
+			.size = attr->base.size,
+			.addr = {
+				.base_input = 0,
+				.variant    = X86_ADDR_REG,
+			},
+		},
+		.u.reg_input = 1,
+	};
+	dbg_info *const dbgi  = get_irn_dbg_info(node);
+	ir_node  *const block = get_nodes_block(node);
+	ir_node  *const op    = get_irn_n(node, attr->base.addr.base_input);
+	ir_node  *const in[]  = { op, op };
+	ir_node  *const test  = new_bd_amd64_test(dbgi, block, ARRAY_SIZE(in), in, amd64_reg_reg_reqs, &test_attr);
+	arch_set_irn_register_out(test, pn_amd64_test_flags, flags_reg);
+	be_peephole_replace(node, test);
+}
+
+/**
+ * Returns whether the flags of @p node describe the zero and sign of its
+ * result @p pn. The carry and overflow flags may differ from a test.
+ */
+static bool produces_zero_sign(ir_node const *const node, unsigned const pn)
+{
+	if (!is_amd64_irn(node))
+		return false;
+
+	switch ((amd64_opcodes)get_amd64_irn_opcode(node)) {
+	case iro_amd64_add:
+	case iro_amd64_and:
+	case iro_amd64_or:
+	case iro_amd64_sub:
+	case iro_amd64_xor:
+		return pn == pn_amd64_add_res;
+	case iro_amd64_neg:
+		return pn == pn_amd64_neg_res;
+	default:
+		return false;
+	}
+}
+
+/**
+ * Remove a test %r, %r if the instruction computing %r already produced the
+ * zero and sign flags and no instruction in between modified the flags.
+ */
+static void peephole_amd64_test(ir_node *const node)
+{
+	amd64_binop_addr_attr_t const *const attr = get_amd64_binop_addr_attr_const(node);
+	if (attr->base.base.op_mode != AMD64_OP_REG_REG)
+		return;
+	ir_node *const left  = get_irn_n(node, attr->base.addr.base_input);
+	ir_node *const right = get_irn_n(node, attr->u.reg_input);
+	if (left != right || !is_Proj(left))
+		return;
+
+	ir_node *const op = get_Proj_pred(left);
+	if (!produces_zero_sign(op, get_Proj_num(left))
+	    || get_nodes_block(op) != get_nodes_block(node)
+	    || get_amd64_addr_attr_const(op)->size != attr->base.size)
+		return;
+
+	sched_foreach_reverse_before(node, schedpoint) {
+		if (schedpoint == op)
+			break;
+		if (arch_irn_is(schedpoint, modify_flags))
+			return;
+	}
+
+	/* make sure the users only look at the zero and sign flag */
+	ir_node *const flags = get_Proj_for_pn(node, pn_amd64_test_flags);
+	if (flags == NULL)
+		return;
+	foreach_out_edge(flags, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		if (!is_amd64_jcc(user) && !is_amd64_setcc(user))
+			return;
+		x86_condition_code_t const cc = get_amd64_cc_attr_const(user)->cc;
+		if (cc != x86_cc_equal && cc != x86_cc_not_equal
+		    && cc != x86_cc_sign && cc != x86_cc_not_sign)
+			return;
+	}
+
+	/* all flag producing operations have the same flags output */
+	unsigned const pn_flags = pn_amd64_add_flags;
+	assert(pn_flags == pn_amd64_neg_flags);
+	arch_set_irn_register_out(op, pn_flags, flags_reg);
+	ir_node *const new_flags = be_get_or_make_Proj_for_pn(op, pn_flags);
+	replace_result(node, pn_amd64_test_flags, new_flags);
+	/* the flags are live again up to the operation */
+	register_values[flags_reg->global_index] = new_flags;
+}
+
+/**
+ * Place a compare directly before the conditional jump using its flags, so
+ * that the processor can fuse them.
+ */
+static void peephole_amd64_jcc(ir_node *const node)
+{
+	ir_node *const flags = get_irn_n(node, n_amd64_jcc_eflags);
+	if (!is_Proj(flags) || get_irn_n_edges(flags) != 1)
+		return;
+	ir_node *const cmp = get_Proj_pred(flags);
+	if ((!is_amd64_cmp(cmp) && !is_amd64_test(cmp))
+	    || get_nodes_block(cmp) != get_nodes_block(node)
+	    || sched_prev(node) == cmp)
+		return;
+
+	/* only register operands can be moved without looking at memory */
+	amd64_op_mode_t const op_mode = get_amd64_attr_const(cmp)->op_mode;
+	if (op_mode != AMD64_OP_REG_REG && op_mode != AMD64_OP_REG_IMM)
+		return;
+
+	for (ir_node *schedpoint = sched_next(cmp); schedpoint != node;
+	     schedpoint = sched_next(schedpoint)) {
+		/* schedpoint must not overwrite the operands of the compare */
+		foreach_irn_in(cmp, i, in) {
+			arch_register_t const *const reg = arch_get_irn_register(in);
+			be_foreach_out(schedpoint, o) {
+				if (arch_get_irn_register_out(schedpoint, o) == reg)
+					return;
+			}
+		}
+	}
+
+	sched_remove(cmp);
+	sched_add_before(node, cmp);
+}
+
+/**
+ * Returns whether the value @p value already has the upper bits beyond
+ * @p size set like an extension with the signedness @p is_signed would.
+ */
+static bool is_extended(ir_node const *const value,
+                        amd64_insn_size_t const size, bool const is_signed)
+{
+	if (!is_Proj(value))
+		return false;
+
+	ir_node const *const pred = get_Proj_pred(value);
+	unsigned       const pn   = get_Proj_num(value);
+	if (is_signed)
+		return is_amd64_movs(pred) && pn == pn_amd64_movs_res
+		    && get_amd64_addr_attr_const(pred)->size <= size;
+	if (is_amd64_mov_gp(pred))
+		return pn == pn_amd64_mov_gp_res
+		    && get_amd64_addr_attr_const(pred)->size <= size;
+	/* 32bit operations clear the upper half of the register */
+	if (size != INSN_SIZE_32 || !is_amd64_irn(pred))
+		return false;
+	switch ((amd64_opcodes)get_amd64_irn_opcode(pred)) {
+	case iro_amd64_add:
+	case iro_amd64_and:
+	case iro_amd64_imul:
+	case iro_amd64_or:
+	case iro_amd64_sub:
+	case iro_amd64_xor:
+		return pn == pn_amd64_add_res
+		    && get_amd64_addr_attr_const(pred)->size == INSN_SIZE_32;
+	case iro_amd64_lea:
+		return pn == pn_amd64_lea_res
+		    && get_amd64_addr_attr_const(pred)->size == INSN_SIZE_32;
+	default:
+		return false;
+	}
+}
+
+/**
+ * Remove an extension of a value in place, if the value is already extended.
+ */
+static void remove_redundant_extension(ir_node *const node, unsigned const pn,
+                                       bool const is_signed)
+{
+	amd64_addr_attr_t const *const attr = get_amd64_addr_attr_const(node);
+	if (attr->base.op_mode != AMD64_OP_REG)
+		return;
+	ir_node *const value = get_irn_n(node, attr->addr.base_input);
+	if (arch_get_irn_register(value) != arch_get_irn_register_out(node, pn)
+	    || !is_extended(value, attr->size, is_signed))
+		return;
+
+	/* the liveness information is only kept up to date within the block */
+	ir_node *const res   = get_Proj_for_pn(node, pn);
+	ir_node *const block = get_nodes_block(node);
+	if (res != NULL) {
+		foreach_out_edge(res, edge) {
+			ir_node *const user = get_edge_src_irn(edge);
+			if (is_Phi(user) || get_nodes_block(user) != block)
+				return;
+		}
+	}
+	replace_result(node, pn, value);
+}
+
+static void peephole_amd64_mov_gp(ir_node *const node)
+{
+	remove_redundant_extension(node, pn_amd64_mov_gp_res, false);
+}
+
+static void peephole_amd64_movs(ir_node *const node)
+{
+	remove_redundant_extension(node, pn_amd64_movs_res, true);
+}
+
+static void peephole_be_IncSP(ir_node *const node)
+{
+	be_peephole_IncSP_IncSP(node);
+}
+
 void amd64_peephole_optimization(ir_graph *const irg)
 {
 	ir_clear_opcodes_generic_func();
+	register_peephole_optimization(op_amd64_cmp,     peephole_amd64_cmp);
+	register_peephole_optimization(op_amd64_jcc,     peephole_amd64_jcc);
 	register_peephole_optimization(op_amd64_lea,     peephole_amd64_lea);
+	register_peephole_optimization(op_amd64_mov_gp,  peephole_amd64_mov_gp);
 	register_peephole_optimization(op_amd64_mov_imm, peephole_amd64_mov_imm);
+	register_peephole_optimization(op_amd64_movs,    peephole_amd64_movs);
+	register_peephole_optimization(op_amd64_test,    peephole_amd64_test);
+	be_register_peephole_rule(op_be_IncSP, n_be_IncSP_pred, op_be_IncSP,
+	                          peephole_be_IncSP, "IncSP_IncSP");
 	be_peephole_opt(irg);
 }
@@ -20,28 +20,40 @@
 #include "panic.h"
 #include "x86_imm.h"
 
-static bool is_externally_visible(ir_entity const *const entity)
+/**
+ * Returns whether @p entity may resolve to a definition outside of the
+ * module being linked, so it has to be accessed through the GOT.
+ */
+static bool is_preemptible(ir_entity const *const entity)
 {
 	ir_visibility const vis = get_entity_visibility(entity);
 	switch (vis) {
 	case ir_visibility_private:
 	case ir_visibility_local:
-		return false;
-	case ir_visibility_external:
+	/* hidden symbols are resolved within the module */
 	case ir_visibility_external_private:
+		return false;
 	case ir_visibility_external_protected:
+		/* protected definitions cannot be interposed */
+		return !entity_has_definition(entity)
+		    || (get_entity_linkage(entity) & IR_LINKAGE_MERGE);
+	case ir_visibility_external:
 		return true;
 	}
 	panic("invalid visibility in %+F", entity);
 }
 
-static ir_node *create_gotpcrel_load(ir_graph  *irg, ir_entity *const entity)
+/**
+ * Loads the address of @p entity from its GOT slot.  The load does not
+ * depend on memory, so loads in the same block are merged.
+ */
+static ir_node *create_gotpcrel_load(ir_graph *irg, ir_node *const block,
+                                     ir_entity *const entity)
 {
 	ir_node *const addr
 		= be_new_Relocation(irg, X86_IMM_GOTPCREL, entity, mode_P);
 	ir_type *const type  = get_entity_type(entity);
 	ir_node *const nomem = get_irg_no_mem(irg);
-	ir_node *const block = get_irg_start_block(irg);
 	ir_node *const load  = new_rd_Load(NULL, block, nomem, addr, mode_P,
 									   type, cons_floats);
 	return new_r_Proj(load, mode_P, pn_Load_res);
@@ -67,7 +79,8 @@ static void fix_address_pic_mach_o(ir_node *const node, void *const data)
 		        && !(get_entity_linkage(entity) & IR_LINKAGE_MERGE)) {
 			res = be_new_Relocation(irg, X86_IMM_PCREL, entity, mode_P);
 		} else {
-			res = create_gotpcrel_load(irg, entity);
+			ir_node *const start_block = get_irg_start_block(irg);
+			res = create_gotpcrel_load(irg, start_block, entity);
 		}
 		set_irn_n(node, i, res);
 	}
@@ -84,18 +97,24 @@ static void fix_address_pic_elf(ir_node *const node, void *const data)
 			continue;
 
 		ir_graph *const irg         = get_irn_irg(node);
-		bool      const ext_visible = is_externally_visible(entity);
+		bool      const preemptible = is_preemptible(entity);
 		ir_node  *      res;
-		if (i == n_Call_ptr && is_Call(node)) {
-			/* We can compilation-unit local functions directly, everything else
-			 * goes through the PLT */
-			x86_immediate_kind_t const reloc
-				= ext_visible ? X86_IMM_PLT : X86_IMM_PCREL;
-			res = be_new_Relocation(irg, reloc, entity, mode_P);
-		} else if (!ext_visible) {
+		if (!preemptible) {
+			/* Module local symbols are called and accessed directly. */
 			res = be_new_Relocation(irg, X86_IMM_PCREL, entity, mode_P);
+		} else if (i == n_Call_ptr && is_Call(node)) {
+			if (be_options.pic_style == BE_PIC_ELF_PLT) {
+				res = be_new_Relocation(irg, X86_IMM_PLT, entity, mode_P);
+			} else {
+				/* Load the target next to the call, so it becomes
+				 * call *foo@GOTPCREL(%rip). */
+				assert(be_options.pic_style == BE_PIC_ELF_NO_PLT);
+				ir_node *const block = get_nodes_block(node);
+				res = create_gotpcrel_load(irg, block, entity);
+			}
 		} else {
-			res = create_gotpcrel_load(irg, entity);
+			ir_node *const start_block = get_irg_start_block(irg);
+			res = create_gotpcrel_load(irg, start_block, entity);
 		}
 		set_irn_n(node, i, res);
 	}
@@ -107,10 +126,9 @@ void amd64_adjust_pic(ir_graph *irg)
 	case BE_PIC_NONE:
 		return;
 	case BE_PIC_ELF_PLT:
+	case BE_PIC_ELF_NO_PLT:
 		irg_walk_graph(irg, fix_address_pic_elf, NULL, NULL);
 		break;
-	case BE_PIC_ELF_NO_PLT:
-		panic("amd64 elf/no-plt not implemented yet");
 	case BE_PIC_MACH_O:
 		irg_walk_graph(irg, fix_address_pic_mach_o, NULL, NULL);
 		break;
@@ -7,22 +7,22 @@ $mode_x87   = "x86_mode_E";
 
 %reg_classes = (
 	gp => [
-		{ name => "rax", dwarf => 0 },
-		{ name => "rcx", dwarf => 2 },
-		{ name => "rdx", dwarf => 1 },
-		{ name => "rsi", dwarf => 4 },
-		{ name => "rdi", dwarf => 5 },
-		{ name => "rbx", dwarf => 3 },
-		{ name => "rbp", dwarf => 6 },
-		{ name => "rsp", dwarf => 7 },
-		{ name => "r8",  dwarf => 8 },
-		{ name => "r9",  dwarf => 9 },
-		{ name => "r10", dwarf => 10 },
-		{ name => "r11", dwarf => 11 },
-		{ name => "r12", dwarf => 12 },
-		{ name => "r13", dwarf => 13 },
-		{ name => "r14", dwarf => 14 },
-		{ name => "r15", dwarf => 15 },
+		{ name => "rax", encoding => 0,  dwarf => 0 },
+		{ name => "rcx", encoding => 1,  dwarf => 2 },
+		{ name => "rdx", encoding => 2,  dwarf => 1 },
+		{ name => "rsi", encoding => 6,  dwarf => 4 },
+		{ name => "rdi", encoding => 7,  dwarf => 5 },
+		{ name => "rbx", encoding => 3,  dwarf => 3 },
+		{ name => "rbp", encoding => 5,  dwarf => 6 },
+		{ name => "rsp", encoding => 4,  dwarf => 7 },
+		{ name => "r8",  encoding => 8,  dwarf => 8 },
+		{ name => "r9",  encoding => 9,  dwarf => 9 },
+		{ name => "r10", encoding => 10, dwarf => 10 },
+		{ name => "r11", encoding => 11, dwarf => 11 },
+		{ name => "r12", encoding => 12, dwarf => 12 },
+		{ name => "r13", encoding => 13, dwarf => 13 },
+		{ name => "r14", encoding => 14, dwarf => 14 },
+		{ name => "r15", encoding => 15, dwarf => 15 },
 		{ mode => $mode_gp }
 	],
 	flags => [
@@ -267,6 +267,19 @@ my $x87store = {
 	mode      => "mode_M",
 };
 
+my $prefetchop = {
+	op_flags  => [ "uses_memory" ],
+	state     => "exc_pinned",
+	in_reqs   => "...",
+	out_reqs  => [ "mem" ],
+	outs      => [ "M" ],
+	attr_type => "amd64_addr_attr_t",
+	attr      => "amd64_addr_t addr",
+	fixed     => "amd64_op_mode_t op_mode = AMD64_OP_ADDR;\n"
+	            ."amd64_insn_size_t size = INSN_SIZE_8;\n",
+	mode      => "mode_M",
+};
+
 %nodes = (
 push_am => {
 	op_flags  => [ "uses_memory" ],
@@ -278,6 +291,7 @@ push_am => {
 	attr      => "amd64_insn_size_t size, amd64_addr_t addr",
 	fixed     => "amd64_op_mode_t op_mode = AMD64_OP_ADDR;\n",
 	emit      => "push%M %A",
+	encode    => "amd64_enc_mem(node, 0xFF, 6)",
 },
 
 push_reg => {
@@ -301,6 +315,7 @@ pop_am => {
 	attr      => "amd64_insn_size_t size, amd64_addr_t addr",
 	fixed     => "amd64_op_mode_t op_mode = AMD64_OP_ADDR;\n",
 	emit      => "pop%M %A",
+	encode    => "amd64_enc_mem(node, 0x8F, 0)",
 },
 
 sub_sp => {
@@ -324,87 +339,108 @@ leave => {
 	outs      => [ "frame", "M",   "stack" ],
 	fixed     => "amd64_op_mode_t op_mode = AMD64_OP_NONE;\n",
 	emit      => "leave",
+	encode    => "amd64_enc_simple(0xC9)",
 },
 
 add => {
 	template => $binop_commutative,
 	emit     => "add%M %AM",
+	encode   => "amd64_enc_binop(node, 0)",
 },
 
 and => {
 	template => $binop_commutative,
 	emit     => "and%M %AM",
+	encode   => "amd64_enc_binop(node, 4)",
 },
 
 div => {
 	template => $divop,
 	emit     => "div%M %AM",
+	encode   => "amd64_enc_unop(node, 0xF7, 6)",
+	latency  => 25,
 },
 
 idiv => {
 	template => $divop,
 	emit     => "idiv%M %AM",
+	encode   => "amd64_enc_unop(node, 0xF7, 7)",
+	latency  => 25,
 },
 
 imul => {
 	template => $binop_commutative,
 	emit     => "imul%M %AM",
+	latency  => 5,
 },
 
 imul_1op => {
 	template => $mulop,
 	emit     => "imul%M %AM",
+	encode   => "amd64_enc_unop(node, 0xF7, 5)",
+	latency  => 5,
 },
 
 mul => {
 	template => $mulop,
 	emit     => "mul%M %AM",
+	encode   => "amd64_enc_unop(node, 0xF7, 4)",
+	latency  => 10,
 },
 
 or => {
 	template => $binop_commutative,
 	emit     => "or%M %AM",
+	encode   => "amd64_enc_binop(node, 1)",
 },
 
 shl => {
 	template => $shiftop,
 	emit     => "shl%MS %SO",
+	encode   => "amd64_enc_shiftop(node, 4)",
 },
 
 shr => {
 	template => $shiftop,
 	emit     => "shr%MS %SO",
+	encode   => "amd64_enc_shiftop(node, 5)",
 },
 
 sar => {
 	template => $shiftop,
 	emit     => "sar%MS %SO",
+	encode   => "amd64_enc_shiftop(node, 7)",
 },
 
 sub => {
 	template  => $binop,
 	irn_flags => [ "modify_flags", "rematerializable" ],
 	emit      => "sub%M %AM",
+	encode    => "amd64_enc_binop(node, 5)",
 },
 
 sbb => {
 	template => $binop,
 	emit     => "sbb%M %AM",
+	encode   => "amd64_enc_binop(node, 3)",
 },
 
 neg => {
 	template => $unop,
 	emit     => "neg%M %AM",
+	encode   => "amd64_enc_unop(node, 0xF7, 3)",
 },
 
 not => {
 	template => $unop,
 	emit     => "not%M %AM",
+	encode   => "amd64_enc_unop(node, 0xF7, 2)",
 },
 
 xor => {
 	template => $binop_commutative,
 	emit     => "xor%M %AM",
+	encode   => "amd64_enc_binop(node, 6)",
 },
 
 xor_0 => {
@@ -454,6 +490,7 @@ ijmp => {
 	attr_type => "amd64_addr_attr_t",
 	attr      => "amd64_insn_size_t size, amd64_op_mode_t op_mode, amd64_addr_t addr",
 	emit      => "jmp %*AM",
+	encode    => "amd64_enc_mem(node, 0xFF, 4)",
 },
 
 jmp => {
@@ -472,6 +509,19 @@ cmp => {
 	attr_type => "amd64_binop_addr_attr_t",
 	attr      => "const amd64_binop_addr_attr_t *attr_init",
 	emit      => "cmp%M %AM",
+	encode    => "amd64_enc_binop(node, 7)",
+},
+
+test => {
+	irn_flags => [ "modify_flags", "rematerializable" ],
+	state     => "exc_pinned",
+	in_reqs   => "...",
+	out_reqs  => [ "none", "flags", "mem" ],
+	outs      => [ "dummy", "flags", "M" ],
+	attr_type => "amd64_binop_addr_attr_t",
+	attr      => "const amd64_binop_addr_attr_t *attr_init",
+	emit      => "test%M %AM",
+	encode    => "amd64_enc_test(node)",
 },
 
 cmpxchg => {
@@ -498,6 +548,30 @@ setcc => {
 	emit      => "set%P0 %D0",
 },
 
+prefetcht0 => {
+	template => $prefetchop,
+	emit     => "prefetcht0 %A",
+	encode   => "amd64_enc_mem(node, 0x0F18, 1)",
+},
+
+prefetcht1 => {
+	template => $prefetchop,
+	emit     => "prefetcht1 %A",
+	encode   => "amd64_enc_mem(node, 0x0F18, 2)",
+},
+
+prefetcht2 => {
+	template => $prefetchop,
+	emit     => "prefetcht2 %A",
+	encode   => "amd64_enc_mem(node, 0x0F18, 3)",
+},
+
+prefetchnta => {
+	template => $prefetchop,
+	emit     => "prefetchnta %A",
+	encode   => "amd64_enc_mem(node, 0x0F18, 0)",
+},
+
 lea => {
 	irn_flags => [ "rematerializable" ],
 	in_reqs   => "...",
@@ -507,6 +581,8 @@ lea => {
 	attr      => "amd64_insn_size_t size, amd64_addr_t addr",
 	fixed     => "amd64_op_mode_t op_mode = AMD64_OP_ADDR;\n",
 	emit      => "lea%M %A, %D0",
+	encode    => "amd64_enc_unop_reg(node, 0x8D)",
+	latency   => 2,
 },
 
 jcc => {
@@ -561,16 +637,31 @@ ret => {
 	ins      => [ "mem", "stack", "first_result" ],
 	fixed    => "amd64_op_mode_t op_mode = AMD64_OP_NONE;\n",
 	emit     => "ret",
+	encode   => "amd64_enc_simple(0xC3)",
+},
+
+tail_call => {
+	state     => "pinned",
+	op_flags  => [ "cfopcode" ],
+	in_reqs   => "...",
+	out_reqs  => [ "exec" ],
+	ins       => [ "mem", "stack", "first_param" ],
+	attr_type => "amd64_addr_attr_t",
+	attr      => "amd64_op_mode_t op_mode, amd64_addr_t addr",
+	fixed     => "amd64_insn_size_t size = INSN_SIZE_64;",
+	emit      => "jmp %*AM",
 },
 
 bsf => {
 	template => $unop_out,
 	emit => "bsf%M %AM, %D0",
+	encode => "amd64_enc_unop_reg(node, 0x0FBC)",
 },
 
 bsr => {
 	template => $unop_out,
 	emit => "bsr%M %AM, %D0",
+	encode => "amd64_enc_unop_reg(node, 0x0FBD)",
 },
 
 # SSE
@@ -578,11 +669,15 @@ bsr => {
 adds => {
 	template => $binopx_commutative,
 	emit     => "adds%MX %AM",
+	encode   => "amd64_enc_sse_scalar(node, 0x0F58)",
+	latency  => 4,
 },
 
 divs => {
 	template => $binopx,
 	emit     => "divs%MX %AM",
+	encode   => "amd64_enc_sse_scalar(node, 0x0F5E)",
+	latency  => 16,
 },
 
 movs_xmm => {
@@ -594,6 +689,8 @@ movs_xmm => {
 muls => {
 	template => $binopx_commutative,
 	emit     => "muls%MX %AM",
+	encode   => "amd64_enc_sse_scalar(node, 0x0F59)",
+	latency  => 4,
 },
 
 movs_store_xmm => {
@@ -610,6 +707,8 @@ movs_store_xmm => {
 subs => {
 	template => $binopx,
 	emit     => "subs%MX %AM",
+	encode   => "amd64_enc_sse_scalar(node, 0x0F5C)",
+	latency  => 4,
 },
 
 ucomis => {
@@ -621,6 +720,7 @@ ucomis => {
 	attr_type => "amd64_binop_addr_attr_t",
 	attr      => "const amd64_binop_addr_attr_t *attr_init",
 	emit      => "ucomis%MX %AM",
+	latency   => 3,
 },
 
 xorpd_0 => {
@@ -630,11 +730,13 @@ xorpd_0 => {
 	outs      => [ "res" ],
 	fixed     => "amd64_op_mode_t op_mode = AMD64_OP_NONE;",
 	emit      => "xorpd %^D0, %^D0",
+	latency   => 3,
 },
 
 xorp => {
 	template => $binopx_commutative,
 	emit     => "xorp%MX %AM",
+	latency  => 3,
 },
 
 movd_xmm_gp => {
@@ -664,6 +766,8 @@ movd_gp_xmm => {
 cvtss2sd => {
 	template => $cvtop2x,
 	emit     => "cvtss2sd %AM, %^D0",
+	encode   => "amd64_enc_sse_unop(node, 0xF3, 0x0F5A, false)",
+	latency  => 8,
 },
 
 cvtsd2ss => {
@@ -671,26 +775,36 @@ cvtsd2ss => {
 	attr     => "amd64_op_mode_t op_mode, amd64_addr_t addr",
 	fixed    => "amd64_insn_size_t size = INSN_SIZE_64;\n",
 	emit     => "cvtsd2ss %AM, %^D0",
+	encode   => "amd64_enc_sse_unop(node, 0xF2, 0x0F5A, false)",
+	latency  => 8,
 },
 
 cvttsd2si => {
 	template => $cvtopx2i,
 	emit     => "cvttsd2si %AM, %D0",
+	encode   => "amd64_enc_sse_unop(node, 0xF2, 0x0F2C, true)",
+	latency  => 10,
 },
 
 cvttss2si => {
 	template => $cvtopx2i,
 	emit     => "cvttss2si %AM, %D0",
+	encode   => "amd64_enc_sse_unop(node, 0xF3, 0x0F2C, true)",
+	latency  => 10,
 },
 
 cvtsi2ss => {
 	template => $cvtop2x,
 	emit     => "cvtsi2ss %AM, %^D0",
+	encode   => "amd64_enc_sse_unop(node, 0xF3, 0x0F2A, true)",
+	latency  => 2,
 },
 
 cvtsi2sd => {
 	template => $cvtop2x,
 	emit     => "cvtsi2sd %AM, %^D0",
+	encode   => "amd64_enc_sse_unop(node, 0xF2, 0x0F2A, true)",
+	latency  => 2,
 },
 
 movq => {
@@ -703,12 +817,14 @@ movdqa => {
 	template => $movopx,
 	fixed    => "amd64_insn_size_t size = INSN_SIZE_128;\n",
 	emit     => "movdqa %AM, %D0",
+	encode   => "amd64_enc_sse_unop(node, 0x66, 0x0F6F, false)",
 },
 
 movdqu => {
 	template => $movopx,
 	fixed    => "amd64_insn_size_t size = INSN_SIZE_128;\n",
 	emit     => "movdqu %AM, %D0",
+	encode   => "amd64_enc_sse_unop(node, 0xF3, 0x0F6F, false)",
 },
 
 movdqu_store => {
@@ -749,26 +865,99 @@ l_haddpd => {
 punpckldq => {
 	template => $binopx,
 	emit     => "punpckldq %AM",
+	encode   => "amd64_enc_sse_binop(node, 0x66, 0x0F62)",
 },
 
 subpd => {
 	template => $binopx,
 	emit     => "subpd %AM",
+	encode   => "amd64_enc_sse_binop(node, 0x66, 0x0F5C)",
 },
 
 haddpd => {
 	template => $binopx,
 	emit     => "haddpd %AM",
+	encode   => "amd64_enc_sse_binop(node, 0x66, 0x0F7C)",
+},
+
+# Packed SSE operations on vector modes. The size of the node is the size of a
+# single lane.
+
+addp => {
+	template => $binopx_commutative,
+	emit     => "addp%MX %AM",
+	encode   => "amd64_enc_sse_packed(node, 0x0F58)",
+	latency  => 4,
+},
+
+mulp => {
+	template => $binopx_commutative,
+	emit     => "mulp%MX %AM",
+	encode   => "amd64_enc_sse_packed(node, 0x0F59)",
+	latency  => 4,
+},
+
+subp => {
+	template => $binopx,
+	emit     => "subp%MX %AM",
+	encode   => "amd64_enc_sse_packed(node, 0x0F5C)",
+	latency  => 4,
+},
+
+padd => {
+	template => $binopx_commutative,
+	emit     => "padd%MV %AM",
+	encode   => "amd64_enc_sse_packed_int(node, 0x0FFC, 0x0FFD, 0x0FFE, 0x0FD4)",
+	latency  => 1,
+},
+
+psub => {
+	template => $binopx,
+	emit     => "psub%MV %AM",
+	encode   => "amd64_enc_sse_packed_int(node, 0x0FF8, 0x0FF9, 0x0FFA, 0x0FFB)",
+	latency  => 1,
+},
+
+pmullw => {
+	template => $binopx_commutative,
+	emit     => "pmullw %AM",
+	encode   => "amd64_enc_sse_binop(node, 0x66, 0x0FD5)",
+	latency  => 5,
+},
+
+pand => {
+	template => $binopx_commutative,
+	emit     => "pand %AM",
+	encode   => "amd64_enc_sse_binop(node, 0x66, 0x0FDB)",
+	latency  => 1,
+},
+
+por => {
+	template => $binopx_commutative,
+	emit     => "por %AM",
+	encode   => "amd64_enc_sse_binop(node, 0x66, 0x0FEB)",
+	latency  => 1,
+},
+
+pxor => {
+	template => $binopx_commutative,
+	emit     => "pxor %AM",
+	encode   => "amd64_enc_sse_binop(node, 0x66, 0x0FEF)",
+	latency  => 1,
 },
 
 fldz => {
 	template => $x87const,
 	emit     => "fldz",
+	encode   => "amd64_enc_fsimple(0xEE)",
+	latency  => 4,
 },
 
 fld1 => {
 	template => $x87const,
 	emit     => "fld1",
+	encode   => "amd64_enc_fsimple(0xE8)",
+	latency  => 4,
 },
 
 fld => {
@@ -781,6 +970,7 @@ fld => {
 	attr_type => "amd64_x87_addr_attr_t",
 	attr      => "amd64_insn_size_t size, amd64_op_mode_t op_mode, amd64_addr_t addr",
 	emit      => "fld%FM %AM",
+	latency   => 2,
 },
 
 fild => {
@@ -793,46 +983,60 @@ fild => {
 	attr_type => "amd64_x87_addr_attr_t",
 	attr      => "amd64_insn_size_t size, amd64_op_mode_t op_mode, amd64_addr_t addr",
 	emit      => "fild%M %AM",
+	latency   => 4,
 },
 
 fisttp => {
 	template => $x87store,
 	emit     => "fisttp%M %AM",
+	latency  => 4,
 },
 
 fst => {
 	template => $x87store,
 	emit     => "fst%FP%FM %AM",
+	latency  => 2,
 },
 
 fstp => {
 	template => $x87store,
 	emit     => "fstp%FM %AM",
+	latency  => 2,
 },
 
 fadd => {
 	template => $x87binop,
 	emit     => "fadd%FP %AF",
+	encode   => "amd64_enc_fbinop(node, 0, 0)",
+	latency  => 4,
 },
 
 fdiv => {
 	template => $x87binop,
 	emit     => "fdiv%FR%FP %AF",
+	encode   => "amd64_enc_fbinop(node, 6, 7)",
+	latency  => 20,
 },
 
 fmul => {
 	template => $x87binop,
 	emit     => "fmul%FP %AF",
+	encode   => "amd64_enc_fbinop(node, 1, 1)",
+	latency  => 4,
 },
 
 fsub => {
 	template => $x87binop,
 	emit     => "fsub%FR%FP %AF",
+	encode   => "amd64_enc_fbinop(node, 4, 5)",
+	latency  => 4,
 },
 
 fchs => {
 	template => $x87unop,
 	emit     => "fchs",
+	encode   => "amd64_enc_fsimple(0xE0)",
+	latency  => 2,
 },
 
 fucomi => {
@@ -843,6 +1047,7 @@ fucomi => {
 	outs      => [ "flags" ],
 	attr_type => "amd64_x87_attr_t",
 	emit      => "fucom%FPi %F0",
+	latency   => 3,
 },
 
 fdup => {
@@ -854,6 +1059,7 @@ fdup => {
 	attr        => "const arch_register_t *reg",
 	init        => "attr->x87.reg = reg;",
 	emit        => "fld %F0",
+	encode      => "amd64_enc_fop_reg(node, 0xD9, 0xC0)",
 },
 
 fxch => {
@@ -864,6 +1070,7 @@ fxch => {
 	attr        => "const arch_register_t *reg",
 	init        => "attr->x87.reg = reg;",
 	emit        => "fxch %F0",
+	encode      => "amd64_enc_fop_reg(node, 0xD9, 0xC8)",
 },
 
 fpop => {
@@ -874,6 +1081,26 @@ fpop => {
 	attr        => "const arch_register_t *reg",
 	init        => "attr->x87.reg = reg;",
 	emit        => "fstp %F0",
+	encode      => "amd64_enc_fop_reg(node, 0xDD, 0xD8)",
 },
 
 );
+
+# Ops without an explicit latency are assumed to take a single cycle.
+foreach my $op (keys(%nodes)) {
+	my $node         = $nodes{$op};
+	my $op_attr_init = $node->{op_attr_init};
+
+	if (defined($op_attr_init)) {
+		$op_attr_init .= "\n\t";
+	} else {
+		$op_attr_init = "";
+	}
+
+	my $latency = $node->{latency} // 1;
+	$op_attr_init .= "amd64_init_op(op, $latency);";
+
+	$node->{op_attr_init} = $op_attr_init;
+}
+
+print "";
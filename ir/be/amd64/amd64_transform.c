@@ -26,6 +26,7 @@
 #include "bearch_amd64_t.h"
 #include "beirg.h"
 #include "besched.h"
+#include "beutil.h"
 
 #include "amd64_new_nodes.h"
 #include "amd64_nodes_attr.h"
@@ -40,6 +41,7 @@ DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
 
 static ir_mode        *mode_gp;
 static x86_cconv_t    *current_cconv = NULL;
+static bool            sibling_calls;
 static be_stack_env_t  stack_env;
 
 /** we don't have a concept of aliasing registers, so enumerate them
@@ -1051,6 +1053,101 @@ static ir_node *match_simple_lea(dbg_info *dbgi, ir_node *new_block,
 	}
 }
 
+/**
+ * Creates a lea for the Add @p node. Shifts and constants of the operands are
+ * folded into the scaled index and displacement where possible.
+ */
+static ir_node *create_add_lea_from_address(dbg_info *dbgi, ir_node *new_block,
+                                            amd64_insn_size_t size,
+                                            ir_node *node)
+{
+	x86_address_t maddr;
+	memset(&maddr, 0, sizeof(maddr));
+	x86_create_address_mode(&maddr, node, x86_create_am_force);
+	if (maddr.imm.entity != NULL || maddr.tls_segment || maddr.ip_base
+	    || (maddr.base == NULL && maddr.index == NULL)) {
+		return match_simple_lea(dbgi, new_block, size, get_Add_left(node),
+		                        get_Add_right(node));
+	}
+
+	ir_node     *in[2];
+	int          arity = 0;
+	amd64_addr_t addr  = {
+		.immediate = maddr.imm,
+		.log_scale = maddr.scale,
+		.variant   = maddr.variant,
+	};
+	if (x86_addr_variant_has_base(maddr.variant)) {
+		addr.base_input = arity;
+		in[arity++]     = be_transform_node(maddr.base);
+	}
+	if (x86_addr_variant_has_index(maddr.variant)) {
+		addr.index_input = arity;
+		in[arity++]      = be_transform_node(maddr.index);
+	}
+	arch_register_req_t const **const reqs
+		= arity == 2 ? amd64_reg_reg_reqs : reg_reqs;
+	return new_bd_amd64_lea(dbgi, new_block, arity, in, reqs, size, addr);
+}
+
+/**
+ * Returns the lane mode of the vector mode @p mode, which must fill an xmm
+ * register.
+ */
+static ir_mode *get_xmm_lane_mode(ir_mode *const mode)
+{
+	ir_mode *const lane_mode = get_mode_vector_element_mode(mode);
+	if (get_mode_size_bits(mode) != 128 || lane_mode == x86_mode_E)
+		panic("vector mode %+F not supported", mode);
+	return lane_mode;
+}
+
+/**
+ * Creates a packed SSE operation for the vector operation @p node on the
+ * transformed operands @p new_op1 and @p new_op2. Address mode is not matched
+ * as memory operands of packed SSE operations must be aligned.
+ */
+static ir_node *new_vector_binop(ir_node *const node,
+                                 construct_binop_func const func,
+                                 unsigned const pn_res, ir_node *const new_op1,
+                                 ir_node *const new_op2)
+{
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const new_block = be_transform_nodes_block(node);
+	ir_mode  *const lane_mode = get_xmm_lane_mode(get_irn_mode(node));
+	ir_node  *const in[]      = { new_op1, new_op2 };
+
+	amd64_binop_addr_attr_t attr = {
+		.base = {
+			.base.op_mode = AMD64_OP_REG_REG,
+			.addr = {
+				.base_input = 0,
+				.variant    = X86_ADDR_REG,
+			},
+			.size = get_insn_size_from_mode(lane_mode),
+		},
+		.u.reg_input = 1,
+	};
+	ir_node *const new_node = func(dbgi, new_block, ARRAY_SIZE(in), in,
+	                               amd64_xmm_xmm_reqs, &attr);
+	arch_set_irn_register_req_out(new_node, 0, &amd64_requirement_xmm_same_0);
+	return be_new_Proj(new_node, pn_res);
+}
+
+static ir_node *gen_vector_binop(ir_node *const node,
+                                 construct_binop_func const func,
+                                 unsigned const pn_res)
+{
+	ir_node *const new_op1 = be_transform_node(get_binop_left(node));
+	ir_node *const new_op2 = be_transform_node(get_binop_right(node));
+	return new_vector_binop(node, func, pn_res, new_op1, new_op2);
+}
+
+static bool is_float_vector(ir_mode *const mode)
+{
+	return mode_is_float(get_xmm_lane_mode(mode));
+}
+
 static ir_node *gen_Add(ir_node *const node)
 {
 	ir_node *const op1   = get_Add_left(node);
@@ -1058,7 +1155,12 @@ static ir_node *gen_Add(ir_node *const node)
 	ir_mode *const mode  = get_irn_mode(node);
 	ir_node *const block = get_nodes_block(node);
 
-	if (mode_is_float(mode)) {
+	if (mode_is_vector(mode)) {
+		if (is_float_vector(mode))
+			return gen_vector_binop(node, new_bd_amd64_addp,
+			                        pn_amd64_addp_res);
+		return gen_vector_binop(node, new_bd_amd64_padd, pn_amd64_padd_res);
+	} else if (mode_is_float(mode)) {
 		if (mode == x86_mode_E)
 			return gen_binop_x87(node, op1, op2, new_bd_amd64_fadd);
 		return gen_binop_am(node, op1, op2, new_bd_amd64_adds,
@@ -1081,7 +1183,7 @@ static ir_node *gen_Add(ir_node *const node)
 			? INSN_SIZE_32 : INSN_SIZE_64;
 		dbg_info *const dbgi      = get_irn_dbg_info(node);
 		ir_node  *const new_block = be_transform_node(block);
-		res = match_simple_lea(dbgi, new_block, size, op1, op2);
+		res = create_add_lea_from_address(dbgi, new_block, size, node);
 	}
 
 	x86_mark_non_am(node);
@@ -1094,7 +1196,12 @@ static ir_node *gen_Sub(ir_node *const node)
 	ir_node *const op2  = get_Sub_right(node);
 	ir_mode *const mode = get_irn_mode(node);
 
-	if (mode_is_float(mode)) {
+	if (mode_is_vector(mode)) {
+		if (is_float_vector(mode))
+			return gen_vector_binop(node, new_bd_amd64_subp,
+			                        pn_amd64_subp_res);
+		return gen_vector_binop(node, new_bd_amd64_psub, pn_amd64_psub_res);
+	} else if (mode_is_float(mode)) {
 		if (mode == x86_mode_E)
 			return gen_binop_x87(node, op1, op2, new_bd_amd64_fsub);
 		return gen_binop_am(node, op1, op2, new_bd_amd64_subs,
@@ -1109,6 +1216,9 @@ static ir_node *gen_Sub(ir_node *const node)
 
 static ir_node *gen_And(ir_node *const node)
 {
+	if (mode_is_vector(get_irn_mode(node)))
+		return gen_vector_binop(node, new_bd_amd64_pand, pn_amd64_pand_res);
+
 	ir_node *const op1 = get_And_left(node);
 	ir_node *const op2 = get_And_right(node);
 	return gen_binop_am(node, op1, op2, new_bd_amd64_and, pn_amd64_and_res,
@@ -1118,6 +1228,9 @@ static ir_node *gen_And(ir_node *const node)
 
 static ir_node *gen_Eor(ir_node *const node)
 {
+	if (mode_is_vector(get_irn_mode(node)))
+		return gen_vector_binop(node, new_bd_amd64_pxor, pn_amd64_pxor_res);
+
 	ir_node *const op1 = get_Eor_left(node);
 	ir_node *const op2 = get_Eor_right(node);
 	return gen_binop_am(node, op1, op2, new_bd_amd64_xor, pn_amd64_xor_res,
@@ -1127,6 +1240,9 @@ static ir_node *gen_Eor(ir_node *const node)
 
 static ir_node *gen_Or(ir_node *const node)
 {
+	if (mode_is_vector(get_irn_mode(node)))
+		return gen_vector_binop(node, new_bd_amd64_por, pn_amd64_por_res);
+
 	ir_node *const op1 = get_Or_left(node);
 	ir_node *const op2 = get_Or_right(node);
 	return gen_binop_am(node, op1, op2, new_bd_amd64_or, pn_amd64_or_res,
@@ -1140,7 +1256,15 @@ static ir_node *gen_Mul(ir_node *const node)
 	ir_node *const op2  = get_Mul_right(node);
 	ir_mode *const mode = get_irn_mode(node);
 
-	if (get_mode_size_bits(mode) < 16) {
+	if (mode_is_vector(mode)) {
+		if (is_float_vector(mode))
+			return gen_vector_binop(node, new_bd_amd64_mulp,
+			                        pn_amd64_mulp_res);
+		if (get_mode_size_bits(get_xmm_lane_mode(mode)) == 16)
+			return gen_vector_binop(node, new_bd_amd64_pmullw,
+			                        pn_amd64_pmullw_res);
+		panic("packed multiplication of %+F not supported", mode);
+	} else if (get_mode_size_bits(mode) < 16) {
 		/* imulb only supports rax - reg form */
 		ir_node *new_node
 			= gen_binop_rax(node, op1, op2, new_bd_amd64_imul_1op,
@@ -1445,11 +1569,34 @@ static ir_node *gen_float_neg(ir_node *const node)
 	return be_new_Proj(xor, pn_amd64_xorp_res);
 }
 
+/**
+ * Creates a vector negation by switching the sign bits of float lanes or by
+ * subtracting integer lanes from zero.
+ */
+static ir_node *gen_vector_neg(ir_node *const node)
+{
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const new_block = be_transform_nodes_block(node);
+	ir_node  *const new_op    = be_transform_node(get_Minus_op(node));
+	ir_mode  *const mode      = get_irn_mode(node);
+	if (is_float_vector(mode)) {
+		ir_tarval *const sign = tarval_neg(get_mode_null(mode));
+		ir_node   *const load = create_float_const(dbgi, new_block, sign);
+		return new_vector_binop(node, new_bd_amd64_pxor, pn_amd64_pxor_res,
+		                        new_op, load);
+	}
+	ir_node *const zero = new_bd_amd64_xorpd_0(dbgi, new_block);
+	return new_vector_binop(node, new_bd_amd64_psub, pn_amd64_psub_res, zero,
+	                        new_op);
+}
+
 static ir_node *gen_Minus(ir_node *const node)
 {
 	ir_mode *mode = get_irn_mode(node);
 
-	if (mode_is_float(mode)) {
+	if (mode_is_vector(mode)) {
+		return gen_vector_neg(node);
+	} else if (mode_is_float(mode)) {
 		if (mode == x86_mode_E) {
 			dbg_info *dbgi   = get_irn_dbg_info(node);
 			ir_node  *block  = be_transform_node(get_nodes_block(node));
@@ -1465,6 +1612,16 @@ static ir_node *gen_Minus(ir_node *const node)
 
 static ir_node *gen_Not(ir_node *const node)
 {
+	ir_mode *const mode = get_irn_mode(node);
+	if (mode_is_vector(mode)) {
+		dbg_info *const dbgi      = get_irn_dbg_info(node);
+		ir_node  *const new_block = be_transform_nodes_block(node);
+		ir_node  *const new_op    = be_transform_node(get_Not_op(node));
+		ir_node  *const ones
+			= create_float_const(dbgi, new_block, get_mode_all_one(mode));
+		return new_vector_binop(node, new_bd_amd64_pxor, pn_amd64_pxor_res,
+		                        new_op, ones);
+	}
 	return gen_unop(node, n_Not_op, &new_bd_amd64_not, pn_amd64_not_res);
 }
 
@@ -1700,8 +1857,112 @@ static void add_callee_saves(ir_graph *const irg, x86_cconv_t const *cconv,
 	assert(pos == n_callee_saves);
 }
 
+/**
+ * Turns a Call whose results are returned unchanged into a jump after the
+ * epilogue.  Only callees taking all their parameters in registers and
+ * returning their results where our caller expects them are handled.
+ */
+static ir_node *gen_sibling_call(ir_node *const node, ir_node *const call)
+{
+	ir_type     *const type  = get_Call_type(call);
+	x86_cconv_t *const cconv = amd64_decide_calling_convention(type, NULL);
+	ir_node           *res   = NULL;
+	for (size_t i = 0, n = cconv->n_parameters; i < n; ++i) {
+		if (cconv->parameters[i].reg == NULL)
+			goto out;
+	}
+	for (size_t i = 0, n = get_Return_n_ress(node); i < n; ++i) {
+		arch_register_t const *const reg = cconv->results[i].reg;
+		if (reg != current_cconv->results[i].reg || reg == NULL
+		 || reg->cls == &amd64_reg_classes[CLASS_amd64_x87])
+			goto out;
+	}
+
+	ir_graph *const irg            = get_irn_irg(node);
+	ir_node  *const block          = get_nodes_block(call);
+	ir_node  *const new_block      = be_transform_node(block);
+	dbg_info *const dbgi           = get_irn_dbg_info(call);
+	size_t    const n_params       = get_Call_n_params(call);
+	size_t    const n_callee_saves = rbitset_popcount(current_cconv->callee_saves, N_AMD64_REGISTERS);
+	/* mem + stack + callee + rax + params + callee saves */
+	unsigned  const max_inputs     = 4 + n_params + n_callee_saves;
+
+	ir_node                   **const in   = ALLOCAN(ir_node*, max_inputs);
+	arch_register_req_t const **const reqs = be_allocate_in_reqs(irg, max_inputs);
+	int                               arity = n_amd64_tail_call_first_param;
+
+	in[n_amd64_tail_call_stack]   = get_initial_sp(irg);
+	reqs[n_amd64_tail_call_stack] = amd64_registers[REG_RSP].single_req;
+	reqs[n_amd64_tail_call_mem]   = arch_memory_req;
+
+	/* The jump happens after the epilogue released the frame, so an address
+	 * mode may only refer to globals. */
+	ir_node *const  callee = get_Call_ptr(call);
+	ir_node *const  mem    = be_transform_node(get_Call_mem(call));
+	ir_node        *load;
+	amd64_addr_t    addr   = { .mem_input = n_amd64_tail_call_mem };
+	amd64_op_mode_t op_mode;
+	if (match_immediate_32(&addr.immediate, callee, true)) {
+		op_mode = AMD64_OP_IMM32;
+		in[n_amd64_tail_call_mem] = mem;
+	} else if ((load = source_am_possible(block, callee)) != NULL
+	        && get_Proj_for_pn(load, pn_Load_M) == NULL) {
+		perform_address_matching(get_Load_ptr(load), &arity, in, &addr);
+		if (x86_addr_variant_has_base(addr.variant)
+		 || x86_addr_variant_has_index(addr.variant))
+			goto out;
+		ir_node *sync_ins[] = { be_transform_node(get_Load_mem(load)), mem };
+		in[n_amd64_tail_call_mem] = be_make_Sync(new_block, ARRAY_SIZE(sync_ins), sync_ins);
+		op_mode = AMD64_OP_ADDR;
+	} else {
+		/* r11 is neither a parameter nor restored by the epilogue. */
+		int const input = arity++;
+		addr = (amd64_addr_t) {
+			.base_input = input,
+			.variant    = X86_ADDR_REG,
+		};
+		in[input]   = be_transform_node(callee);
+		reqs[input] = amd64_registers[REG_R11].single_req;
+		in[n_amd64_tail_call_mem] = mem;
+		op_mode = AMD64_OP_REG;
+	}
+
+	if (is_method_variadic(type)) {
+		amd64_imm64_t const imm = {
+			.kind   = X86_IMM_VALUE,
+			.offset = cconv->n_xmm_regs,
+		};
+		in[arity]   = new_bd_amd64_mov_imm(dbgi, new_block, INSN_SIZE_32, &imm);
+		reqs[arity] = amd64_registers[REG_RAX].single_req;
+		++arity;
+	}
+
+	for (size_t p = 0; p < n_params; ++p) {
+		in[arity]   = be_transform_node(get_Call_param(call, p));
+		reqs[arity] = cconv->parameters[p].reg->single_req;
+		++arity;
+	}
+
+	add_callee_saves(irg, current_cconv, &in[arity], &reqs[arity]);
+	arity += n_callee_saves;
+	assert(arity <= (int)max_inputs);
+
+	res = new_bd_amd64_tail_call(dbgi, new_block, arity, in, reqs, op_mode, addr);
+	be_stack_record_chain(&stack_env, res, n_amd64_tail_call_stack, NULL);
+out:
+	x86_free_calling_convention(cconv);
+	return res;
+}
+
 static ir_node *gen_Return(ir_node *const node)
 {
+	ir_node *const call = sibling_calls ? be_get_sibling_call(node) : NULL;
+	if (call != NULL) {
+		ir_node *const tail_call = gen_sibling_call(node, call);
+		if (tail_call != NULL)
+			return tail_call;
+	}
+
 	ir_graph          *const irg       = get_irn_irg(node);
 	ir_node           *const new_block = be_transform_nodes_block(node);
 	dbg_info          *const dbgi      = get_irn_dbg_info(node);
@@ -1746,7 +2007,10 @@ static ir_node *make_store_for_mode(ir_mode *const mode, dbg_info *const dbgi, i
 {
 	construct_binop_func               cons;
 	arch_register_req_t const **const *reqs;
-	if (!mode_is_float(mode)) {
+	if (mode == amd64_mode_xmm || mode_is_vector(mode)) {
+		cons = &new_bd_amd64_movdqu_store;
+		reqs = xmm_am_reqs;
+	} else if (!mode_is_float(mode)) {
 		cons = &new_bd_amd64_mov_store;
 		reqs = gp_am_reqs;
 	} else if (mode == x86_mode_E) {
@@ -2085,6 +2349,14 @@ static ir_node *gen_Cmp(ir_node *const node)
 			return match_cmp_x87(node, op1, op2);
 		match_binop(&args, block, cmp_mode, op1, op2, match_am);
 		new_node = new_bd_amd64_ucomis(dbgi, new_block, args.arity, args.in, args.reqs, &args.attr);
+	} else if (is_And(op1) && is_Const(op2) && is_Const_null(op2)
+	           && get_irn_n_edges(op1) == 1) {
+		/* the And is only needed for the flags, so use a test */
+		ir_node *const and_left  = get_And_left(op1);
+		ir_node *const and_right = get_And_right(op1);
+		match_binop(&args, block, cmp_mode, and_left, and_right,
+		            match_immediate | match_am | match_commutative);
+		new_node = new_bd_amd64_test(dbgi, new_block, args.arity, args.in, args.reqs, &args.attr);
 	} else {
 		match_binop(&args, block, cmp_mode, op1, op2, match_immediate | match_am);
 		new_node = new_bd_amd64_cmp(dbgi, new_block, args.arity, args.in, args.reqs, &args.attr);
@@ -2130,6 +2402,45 @@ static ir_node *gen_Cond(ir_node *const node)
 	return new_bd_amd64_jcc(dbgi, block, flags, cc);
 }
 
+/**
+ * Transforms a Mux(cmp, 0, 1) or Mux(cmp, 1, 0) into a setcc, the only kind
+ * of Mux allowed besides the ones the middleend optimizes away.
+ */
+static ir_node *gen_Mux(ir_node *const node)
+{
+	ir_node *const sel       = get_Mux_sel(node);
+	ir_node *const mux_true  = get_Mux_true(node);
+	ir_node *const mux_false = get_Mux_false(node);
+	if (!is_Cmp(sel) || mode_is_float(get_irn_mode(get_Cmp_left(sel)))
+	    || !is_Const(mux_true) || !is_Const(mux_false))
+		panic("cannot transform %+F", node);
+
+	x86_condition_code_t cc;
+	ir_node *const flags = get_flags_node(sel, &cc);
+	if (is_Const_null(mux_true)) {
+		assert(is_Const_one(mux_false));
+		cc = x86_negate_condition_code(cc);
+	} else {
+		assert(is_Const_one(mux_true) && is_Const_null(mux_false));
+	}
+
+	/* set<cc> temp */
+	dbg_info *const dbgi  = get_irn_dbg_info(node);
+	ir_node  *const block = be_transform_nodes_block(node);
+	ir_node  *const setcc = new_bd_amd64_setcc(dbgi, block, flags, cc);
+
+	/* movzbl temp, temp */
+	ir_node  *const movzbl_in[] = { setcc };
+	amd64_addr_t movzbl_addr = {
+		.base_input = 0,
+		.variant    = X86_ADDR_REG,
+	};
+	ir_node *const movzbl
+		= new_bd_amd64_mov_gp(dbgi, block, ARRAY_SIZE(movzbl_in), movzbl_in,
+		                      reg_reqs, INSN_SIZE_8, AMD64_OP_REG, movzbl_addr);
+	return be_new_Proj(movzbl, pn_amd64_mov_gp_res);
+}
+
 static ir_node *gen_ASM(ir_node *const node)
 {
 	return x86_match_ASM(node, amd64_additional_clobber_names,
@@ -2143,6 +2454,8 @@ static ir_node *gen_Phi(ir_node *const node)
 	if (mode_needs_gp_reg(mode)) {
 		/* all integer operations are on 64bit registers now */
 		req = amd64_reg_classes[CLASS_amd64_gp].class_req;
+	} else if (mode_is_vector(mode)) {
+		req = amd64_reg_classes[CLASS_amd64_xmm].class_req;
 	} else if (mode_is_float(mode)) {
 		req = mode == x86_mode_E
 		    ? amd64_reg_classes[CLASS_amd64_x87].class_req
@@ -2657,7 +2970,7 @@ ir_node *amd64_new_spill(ir_node *value, ir_node *after)
 	return store;
 }
 
-static ir_node *create_sse_spill(dbg_info *const dbgi, ir_node *const block,
+static ir_node *create_movdqu(dbg_info *const dbgi, ir_node *const block,
 		int const arity, ir_node *const *const in,
 		arch_register_req_t const **const in_reqs,
 		amd64_insn_size_t const size, amd64_op_mode_t const op_mode,
@@ -2692,7 +3005,7 @@ ir_node *amd64_new_reload(ir_node *value, ir_node *spill, ir_node *before)
 			pn_res = pn_amd64_fld_res;
 		} else {
 			size   = INSN_SIZE_128;
-			cons   = &create_sse_spill;
+			cons   = &create_movdqu;
 			pn_res = pn_amd64_movdqu_res;
 		}
 	} else {
@@ -2732,6 +3045,7 @@ static ir_node *gen_Load(ir_node *const node)
 	assert((size_t)arity <= ARRAY_SIZE(in));
 
 	create_mov_func   const cons      =
+		mode == amd64_mode_xmm || mode_is_vector(mode)        ? &create_movdqu :
 		mode_is_float(mode)                                   ?
 			(mode == x86_mode_E ? new_bd_amd64_fld : &new_bd_amd64_movs_xmm) :
 		get_mode_size_bits(mode) < 64 && mode_is_signed(mode) ? &new_bd_amd64_movs     :
@@ -2748,7 +3062,8 @@ static ir_node *gen_Unknown(ir_node *const node)
 	/* for now, there should be more efficient ways to do this */
 	ir_node *const block = be_transform_nodes_block(node);
 
-	if (mode_is_float(get_irn_mode(node))) {
+	ir_mode *const mode = get_irn_mode(node);
+	if (mode_is_float(mode) || mode_is_vector(mode)) {
 		return new_bd_amd64_xorpd_0(NULL, block);
 	} else {
 		ir_node *res = new_bd_amd64_xor_0(NULL, block);
@@ -2797,6 +3112,13 @@ static ir_node *gen_Proj_Load(ir_node *const node)
 			return be_new_Proj(new_load, pn_amd64_movs_M);
 		}
 		break;
+	case iro_amd64_movdqu:
+		if (pn == pn_Load_res) {
+			return be_new_Proj(new_load, pn_amd64_movdqu_res);
+		} else if (pn == pn_Load_M) {
+			return be_new_Proj(new_load, pn_amd64_movdqu_M);
+		}
+		break;
 	case iro_amd64_fld:
 		if (pn == pn_Load_res) {
 			return be_new_Proj(new_load, pn_amd64_fld_res);
@@ -2921,6 +3243,7 @@ static ir_node *gen_clz(ir_node *const node)
 	};
 	ir_node *xor = new_bd_amd64_xor(dbgi, block, ARRAY_SIZE(in), in, reg_reqs,
 	                                &attr);
+	arch_set_irn_register_req_out(xor, 0, &amd64_requirement_gp_same_0);
 	return be_new_Proj(xor, pn_amd64_xor_res);
 }
 
@@ -3114,6 +3437,45 @@ static ir_node *gen_va_start(ir_node *const node)
 	return amd64_initialize_va_list(dbgi, block, current_cconv, mem, ap, fp);
 }
 
+static ir_node *gen_prefetch(ir_node *const node)
+{
+	dbg_info *const dbgi    = get_irn_dbg_info(node);
+	ir_node  *const block   = be_transform_nodes_block(node);
+	ir_node  *const ptr     = get_Builtin_param(node, 0);
+	ir_node  *const mem     = get_Builtin_mem(node);
+	ir_node  *const new_mem = be_transform_node(mem);
+
+	int arity = 0;
+	ir_node *in[3];
+	amd64_addr_t addr;
+	perform_address_matching(ptr, &arity, in, &addr);
+
+	arch_register_req_t const **const reqs = gp_am_reqs[arity];
+	in[arity++] = new_mem;
+	assert((size_t)arity <= ARRAY_SIZE(in));
+
+	/* note: the rw parameter is ignored, there is no write prefetch in SSE */
+	ir_node *const param    = get_Builtin_param(node, 2);
+	long     const locality = get_Const_long(param);
+	ir_node *new_node;
+	switch (locality) {
+	case 0:
+		new_node = new_bd_amd64_prefetchnta(dbgi, block, arity, in, reqs, addr);
+		break;
+	case 1:
+		new_node = new_bd_amd64_prefetcht2(dbgi, block, arity, in, reqs, addr);
+		break;
+	case 2:
+		new_node = new_bd_amd64_prefetcht1(dbgi, block, arity, in, reqs, addr);
+		break;
+	default:
+		new_node = new_bd_amd64_prefetcht0(dbgi, block, arity, in, reqs, addr);
+		break;
+	}
+	set_irn_pinned(new_node, get_irn_pinned(node));
+	return new_node;
+}
+
 static ir_node *gen_Builtin(ir_node *const node)
 {
 	ir_builtin_kind const kind = get_Builtin_kind(node);
@@ -3130,6 +3492,8 @@ static ir_node *gen_Builtin(ir_node *const node)
 		return gen_saturating_increment(node);
 	case ir_bk_va_start:
 		return gen_va_start(node);
+	case ir_bk_prefetch:
+		return gen_prefetch(node);
 	default:
 		break;
 	}
@@ -3159,6 +3523,7 @@ static ir_node *gen_Proj_Builtin(ir_node *const proj)
 	case ir_bk_saturating_increment:
 		return be_new_Proj(new_node, pn_amd64_sbb_res);
 	case ir_bk_va_start:
+	case ir_bk_prefetch:
 		assert(get_Proj_num(proj) == pn_Builtin_M);
 		return new_node;
 	default:
@@ -3241,6 +3606,7 @@ static void amd64_register_transformers(void)
 	be_set_transform_function(op_Mod,               gen_Mod);
 	be_set_transform_function(op_Mul,               gen_Mul);
 	be_set_transform_function(op_Mulh,              gen_Mulh);
+	be_set_transform_function(op_Mux,               gen_Mux);
 	be_set_transform_function(op_Not,               gen_Not);
 	be_set_transform_function(op_Or,                gen_Or);
 	be_set_transform_function(op_Phi,               gen_Phi);
@@ -3357,6 +3723,7 @@ void amd64_transform_graph(ir_graph *irg)
 	amd64_create_stacklayout(irg, current_cconv);
 	be_add_parameter_entity_stores(irg);
 	x86_create_parameter_loads(irg, current_cconv);
+	sibling_calls = be_sibling_calls_possible(irg);
 
 	heights = heights_new(irg);
 	x86_calculate_non_address_mode_nodes(irg);
@@ -13,6 +13,7 @@
 #include "amd64_new_nodes.h"
 #include "amd64_nodes_attr.h"
 #include "amd64_transform.h"
+#include "array.h"
 #include "be.h"
 #include "bearch_amd64_t.h"
 #include "besched.h"
@@ -23,7 +24,9 @@
 #include "iredges_t.h"
 #include "irgmod.h"
 #include "irgraph_t.h"
+#include "irgwalk.h"
 #include "panic.h"
+#include "pmap.h"
 #include "tv.h"
 #include "typerep.h"
 #include "util.h"
@@ -46,6 +49,20 @@ static ir_entity       **xmm_save_slots;
  * stack. */
 static ir_entity        *stack_args_param;
 
+/** How a variadic function accesses its variadic arguments. */
+typedef struct va_usage_t {
+	ir_entity **va_lists;      /**< frame entities initialized by va_start */
+	ir_node   **members;       /**< Members selecting frame entities */
+	bool        escapes;       /**< a va_list may be accessed elsewhere */
+	bool        reads_gp;      /**< va_arg reads GP values */
+	bool        reads_xmm;     /**< va_arg reads SSE values */
+	bool        gp_exhausted;  /**< named parameters use all GP registers */
+	bool        xmm_exhausted; /**< named parameters use all XMM registers */
+} va_usage_t;
+
+/** Maps variadic graphs to their va_usage_t until they are transformed. */
+static pmap *va_usages;
+
 void amd64_set_va_stack_args_param(ir_entity *param)
 {
 	stack_args_param = param;
@@ -126,6 +143,139 @@ void amd64_insert_reg_save_area(ir_graph *irg, x86_cconv_t *cconv)
 	reg_save_area = new_entity(frame_type, reg_save_id, reg_save_type);
 }
 
+static bool is_gp_va_arg(ir_mode *mode)
+{
+	return mode == NULL || mode_is_int(mode) || mode_is_reference(mode);
+}
+
+static bool is_xmm_va_arg(ir_mode *mode)
+{
+	ir_mode *const mode_long_double
+		= get_type_mode(be_get_backend_param()->type_long_double);
+	return mode != NULL && mode_is_float(mode) && mode != mode_long_double;
+}
+
+static void collect_va_usage(ir_node *node, void *data)
+{
+	va_usage_t *const usage = (va_usage_t*)data;
+	if (is_Member(node)) {
+		ARR_APP1(ir_node*, usage->members, node);
+	} else if (is_Builtin(node)) {
+		ir_node *const ap = get_Builtin_param(node, 0);
+		switch (get_Builtin_kind(node)) {
+		case ir_bk_va_start: {
+			ir_graph *const irg = get_irn_irg(node);
+			if (is_Member(ap) && get_Member_ptr(ap) == get_irg_frame(irg)) {
+				ARR_APP1(ir_entity*, usage->va_lists, get_Member_entity(ap));
+			} else {
+				usage->escapes = true;
+			}
+			break;
+		}
+		case ir_bk_va_arg: {
+			ir_type *const type = get_method_res_type(get_Builtin_type(node), 0);
+			ir_mode *const mode = get_type_mode(type);
+			usage->reads_gp  |= is_gp_va_arg(mode);
+			usage->reads_xmm |= is_xmm_va_arg(mode);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
+
+static bool is_va_list(va_usage_t const *const usage,
+                       ir_entity const *const entity)
+{
+	for (size_t i = 0, n = ARR_LEN(usage->va_lists); i < n; ++i) {
+		if (usage->va_lists[i] == entity)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Checks whether the address of a va_list initialized by va_start is used
+ * by anything else than va_start and va_arg.
+ */
+static bool va_list_escapes(va_usage_t const *const usage)
+{
+	for (size_t i = 0, n = ARR_LEN(usage->members); i < n; ++i) {
+		ir_node *const member = usage->members[i];
+		if (!is_va_list(usage, get_Member_entity(member)))
+			continue;
+		foreach_out_edge(member, edge) {
+			ir_node *const user = get_edge_src_irn(edge);
+			if (!is_Builtin(user) || get_edge_src_pos(edge) != n_Builtin_max + 1)
+				return true;
+			ir_builtin_kind const kind = get_Builtin_kind(user);
+			if (kind != ir_bk_va_start && kind != ir_bk_va_arg)
+				return true;
+		}
+	}
+	return false;
+}
+
+void amd64_analyze_va_usage(ir_graph *const irg)
+{
+	ir_type *const mtp = get_entity_type(get_irg_entity(irg));
+	if (!is_method_variadic(mtp))
+		return;
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
+	va_usage_t *const usage = XMALLOCZ(va_usage_t);
+	usage->va_lists = NEW_ARR_F(ir_entity*, 0);
+	usage->members  = NEW_ARR_F(ir_node*, 0);
+	irg_walk_graph(irg, NULL, collect_va_usage, usage);
+	usage->escapes |= va_list_escapes(usage);
+	DEL_ARR_F(usage->members);
+	usage->members = NULL;
+
+	x86_cconv_t *const cconv = amd64_decide_calling_convention(mtp, NULL);
+	size_t const n_xmm_regs = cconv->n_xmm_regs;
+	size_t const n_gp_regs  = cconv->n_param_regs - n_xmm_regs;
+	size_t       n_gp_used  = 0;
+	size_t       n_xmm_used = 0;
+	for (size_t p = 0, n = cconv->n_parameters; p < n; ++p) {
+		arch_register_t const *const reg = cconv->parameters[p].reg;
+		if (reg == NULL)
+			continue;
+		if (reg->cls == &amd64_reg_classes[CLASS_amd64_gp]) {
+			++n_gp_used;
+		} else {
+			++n_xmm_used;
+		}
+	}
+	usage->gp_exhausted  = n_gp_used == n_gp_regs;
+	usage->xmm_exhausted = n_xmm_used == n_xmm_regs;
+	x86_free_calling_convention(cconv);
+
+	if (va_usages == NULL)
+		va_usages = pmap_create();
+	pmap_insert(va_usages, irg, usage);
+}
+
+static va_usage_t *get_va_usage(ir_graph const *const irg)
+{
+	return va_usages != NULL ? pmap_get(va_usage_t, va_usages, irg) : NULL;
+}
+
+void amd64_free_va_usages(void)
+{
+	if (va_usages == NULL)
+		return;
+	foreach_pmap(va_usages, entry) {
+		va_usage_t *const usage = (va_usage_t*)entry->value;
+		if (usage != NULL) {
+			DEL_ARR_F(usage->va_lists);
+			xfree(usage);
+		}
+	}
+	pmap_destroy(va_usages);
+	va_usages = NULL;
+}
+
 /*
  * Lowering of va_arg
  *
@@ -291,14 +441,22 @@ void amd64_lower_va_arg(ir_node *node)
 	ir_node  *block = get_nodes_block(node);
 	ir_node  *ap    = get_irn_n(node, pn_Builtin_max + 1);
 	ir_node  *mem   = get_Builtin_mem(node);
+	/* If the named parameters occupy all registers of the class, the
+	 * offset in a va_list initialized by our va_start never fits. */
+	va_usage_t const *const usage = get_va_usage(irg);
+	bool const is_local = usage != NULL && !usage->escapes && is_Member(ap)
+	                   && is_va_list(usage, get_Member_entity(ap));
+	bool const is_gp    = mode_is_int(resmode) || mode_is_reference(resmode);
+	bool const on_stack = resmode == mode_long_double || (is_local
+		&& (is_gp ? usage->gp_exhausted : usage->xmm_exhausted));
 	ir_node  *result;
-	if (resmode == mode_long_double) {
+	if (on_stack) {
 		result = load_va_from_stack(dbgi, block, resmode, restype, ap, &mem);
 	} else {
 		ir_node   *max;
 		ir_entity *offset_entity;
 		ir_node   *stride;
-		if (mode_is_int(resmode) || mode_is_reference(resmode)) {
+		if (is_gp) {
 			max           = new_r_Const_long(irg, mode_Is, n_gp_args * gp_size);
 			offset_entity = va_list_members.gp_offset;
 			stride        = new_r_Const_long(irg, mode_Is, gp_size);
@@ -464,13 +622,25 @@ void amd64_save_vararg_registers(ir_graph *const irg, x86_cconv_t const *const c
 	ir_node *const initial_mem    = get_irg_initial_mem(irg);
 	ir_node       *mem            = initial_mem;
 	ir_node       *first_mov      = NULL;
+
+	/* Only save the register classes which may be read through a va_list. */
+	va_usage_t *const usage    = get_va_usage(irg);
+	bool        const save_gp  = usage == NULL || usage->escapes || usage->reads_gp;
+	bool        const save_xmm = usage == NULL || usage->escapes || usage->reads_xmm;
 	for (size_t p = cconv->n_parameters; reg_params != max_reg_params; ++p, ++reg_params) {
-		arch_register_t const *const reg       = cconv->parameters[p].reg;
-		ir_node               *const reg_value = be_get_Start_proj(irg, reg);
+		arch_register_t const *const reg = cconv->parameters[p].reg;
 		if (reg->cls == &amd64_reg_classes[CLASS_amd64_gp]) {
-			mem = make_mov_val64_to_offset_mem(NULL, block, mem, frame, reg_save_area, gp_save_slots[gp_params++], reg_value);
+			ir_entity *const slot = gp_save_slots[gp_params++];
+			if (!save_gp)
+				continue;
+			ir_node *const reg_value = be_get_Start_proj(irg, reg);
+			mem = make_mov_val64_to_offset_mem(NULL, block, mem, frame, reg_save_area, slot, reg_value);
 		} else if (reg->cls == &amd64_reg_classes[CLASS_amd64_xmm]) {
-			mem = make_mov_xmmval64_to_offset_mem(NULL, block, mem, frame, reg_save_area, xmm_save_slots[xmm_params++], reg_value);
+			ir_entity *const slot = xmm_save_slots[xmm_params++];
+			if (!save_xmm)
+				continue;
+			ir_node *const reg_value = be_get_Start_proj(irg, reg);
+			mem = make_mov_xmmval64_to_offset_mem(NULL, block, mem, frame, reg_save_area, slot, reg_value);
 		} else {
 			panic("unexpected register class");
 		}
@@ -484,6 +654,11 @@ void amd64_save_vararg_registers(ir_graph *const irg, x86_cconv_t const *const c
 	}
 
 	// We are now done with vararg handling for this irg, free the memory.
-	free(gp_save_slots);
-	free(xmm_save_slots);
+	xfree(gp_save_slots);
+	xfree(xmm_save_slots);
+	if (usage != NULL) {
+		DEL_ARR_F(usage->va_lists);
+		xfree(usage);
+		pmap_insert(va_usages, irg, NULL);
+	}
 }
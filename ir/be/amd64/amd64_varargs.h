@@ -51,6 +51,21 @@ void amd64_collect_variadic_params(be_start_out *outs, x86_cconv_t *cconv);
  */
 void amd64_insert_reg_save_area(ir_graph *irg, x86_cconv_t *cconv);
 
+/**
+ * Determines which register classes the va_arg Builtins of @p irg read and
+ * whether a va_list initialized by its va_start escapes.  Must be called
+ * before the va_arg Builtins are lowered; the result is used by
+ * amd64_lower_va_arg() and amd64_save_vararg_registers().
+ *
+ * @param irg The graph to analyze
+ */
+void amd64_analyze_va_usage(ir_graph *irg);
+
+/**
+ * Frees the results of amd64_analyze_va_usage().
+ */
+void amd64_free_va_usages(void);
+
 /**
  * Lowers an ir_bk_va_arg Builtin node.
  *
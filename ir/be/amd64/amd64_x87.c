@@ -99,6 +99,7 @@ static void prepare_callbacks(void)
 	x86_register_x87_sim(op_amd64_fsub,   sim_amd64_fsub);
 	x86_register_x87_sim(op_amd64_fucomi, sim_amd64_fucomi);
 	x86_register_x87_sim(op_amd64_ret,    x86_sim_x87_ret);
+	x86_register_x87_sim(op_amd64_tail_call, x86_sim_x87_ret);
 }
 
 void amd64_simulate_graph_x87(ir_graph *irg)
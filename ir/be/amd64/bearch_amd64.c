@@ -8,6 +8,7 @@
  * @brief    The main amd64 backend driver file.
  */
 #include "amd64_emitter.h"
+#include "amd64_encode.h"
 #include "amd64_finish.h"
 #include "amd64_new_nodes.h"
 #include "amd64_optimize.h"
@@ -26,23 +27,31 @@
 #include "gen_amd64_regalloc_if.h"
 #include "irarch_t.h"
 #include "ircons.h"
+#include "irdom.h"
 #include "iredges_t.h"
 #include "irgmod.h"
 #include "irgopt.h"
 #include "irgwalk.h"
 #include "iropt_t.h"
 #include "irtools.h"
+#include "lc_opts_enum.h"
 #include "lower_alloc.h"
 #include "lower_builtins.h"
 #include "lower_calls.h"
 #include "lower_mode_b.h"
 #include "lowering.h"
 #include "panic.h"
+#include "util.h"
+
+#include <limits.h>
 
 DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
 
 pmap *amd64_constants;
 
+bool amd64_emit_machcode;
+bool amd64_emit_elf;
+
 ir_mode *amd64_mode_xmm;
 
 static ir_entity *amd64_get_frame_entity(const ir_node *node)
@@ -556,12 +565,12 @@ static void introduce_epilogue(ir_node *ret, bool omit_fp)
 	}
 }
 
-static void introduce_prologue(ir_graph *const irg, bool omit_fp)
+static void introduce_prologue(ir_node *const point, bool omit_fp)
 {
 	const arch_register_t *sp         = &amd64_registers[REG_RSP];
 	const arch_register_t *bp         = &amd64_registers[REG_RBP];
-	ir_node               *start      = get_irg_start(irg);
-	ir_node               *block      = get_nodes_block(start);
+	ir_graph              *irg        = get_irn_irg(point);
+	ir_node               *block      = get_block(point);
 	ir_type               *frame_type = get_irg_frame_type(irg);
 	unsigned               frame_size = get_type_size(frame_type);
 	ir_node               *initial_sp = be_get_Start_proj(irg, sp);
@@ -571,20 +580,20 @@ static void introduce_prologue(ir_graph *const irg, bool omit_fp)
 		ir_node *const mem        = get_irg_initial_mem(irg);
 		ir_node *const initial_bp = be_get_Start_proj(irg, bp);
 		ir_node *const push       = new_bd_amd64_push_reg(NULL, block, initial_sp, mem, initial_bp);
-		sched_add_after(start, push);
+		sched_add_after(point, push);
 		ir_node *const curr_mem   = be_new_Proj(push, pn_amd64_push_reg_M);
-		edges_reroute_except(mem, curr_mem, push);
+		be_reroute_behind_prologue(mem, curr_mem, push, block);
 		ir_node *const curr_sp    = be_new_Proj_reg(push, pn_amd64_push_reg_stack, sp);
 
 		/* move rsp to rbp */
 		ir_node *const curr_bp = be_new_Copy(block, curr_sp);
 		sched_add_after(push, curr_bp);
 		arch_copy_irn_out_info(curr_bp, 0, initial_bp);
-		edges_reroute_except(initial_bp, curr_bp, push);
+		be_reroute_behind_prologue(initial_bp, curr_bp, push, block);
 
 		ir_node *incsp = amd64_new_IncSP(block, curr_sp, frame_size, 0);
 		sched_add_after(curr_bp, incsp);
-		edges_reroute_except(initial_sp, incsp, push);
+		be_reroute_behind_prologue(initial_sp, incsp, push, block);
 
 		/* make sure the initial IncSP is really used by someone */
 		be_keep_if_unused(incsp);
@@ -595,31 +604,39 @@ static void introduce_prologue(ir_graph *const irg, bool omit_fp)
 		if (frame_size > 0) {
 			ir_node *const incsp = amd64_new_IncSP(block, initial_sp,
 			                                       frame_size, 0);
-			sched_add_after(start, incsp);
-			edges_reroute_except(initial_sp, incsp, incsp);
+			sched_add_after(point, incsp);
+			be_reroute_behind_prologue(initial_sp, incsp, incsp, block);
 		}
 	}
 }
 
 static void introduce_prologue_epilogue(ir_graph *irg, bool omit_fp)
 {
-	/* introduce epilogue for every return node */
+	ir_node *const point = be_get_prologue_point(irg, &amd64_registers[REG_RSP],
+	                                             amd64_get_frame_entity);
+	ir_node *const block = get_block(point);
+	amd64_get_irg_data(irg)->prologue_block = block;
+
+	/* introduce epilogue for every return node running with a frame */
 	foreach_irn_in(get_irg_end_block(irg), i, pred) {
 		if (is_x_except_branch(pred)) {
 			/* Don't generate any code for X_except ins */
 		} else {
-			assert(is_amd64_ret(pred));
-			introduce_epilogue(pred, omit_fp);
+			assert(is_amd64_ret(pred) || is_amd64_tail_call(pred));
+			assert((int)n_amd64_tail_call_mem == (int)n_amd64_ret_mem);
+			assert((int)n_amd64_tail_call_stack == (int)n_amd64_ret_stack);
+			if (block_dominates(block, get_nodes_block(pred)))
+				introduce_epilogue(pred, omit_fp);
 		}
 	}
 
-	introduce_prologue(irg, omit_fp);
+	introduce_prologue(point, omit_fp);
 }
 
 /**
  * Called immediatly before emit phase.
  */
-static void amd64_finish_and_emit(ir_graph *irg)
+static void amd64_before_emit(ir_graph *irg)
 {
 	bool          omit_fp = amd64_get_irg_data(irg)->omit_fp;
 	be_fec_env_t *fec_env = be_new_frame_entity_coalescer(irg);
@@ -645,16 +662,13 @@ static void amd64_finish_and_emit(ir_graph *irg)
 	amd64_simulate_graph_x87(irg);
 
 	amd64_peephole_optimization(irg);
-
-	/* emit code */
-	be_timer_push(T_EMIT);
-	amd64_emit_function(irg);
-	be_timer_pop(T_EMIT);
 }
 
 static void amd64_finish(void)
 {
+	amd64_free_va_usages();
 	amd64_free_opcodes();
+	obstack_free(&amd64_opcodes_obst, NULL);
 }
 
 static const regalloc_if_t amd64_regalloc_if = {
@@ -664,49 +678,238 @@ static const regalloc_if_t amd64_regalloc_if = {
 	.new_reload  = amd64_new_reload,
 };
 
+static bool lower_for_emit(ir_graph *const irg, unsigned *const sp_is_non_ssa)
+{
+	if (!be_step_first(irg))
+		return false;
+
+	struct obstack *obst = be_get_be_obst(irg);
+	be_birg_from_irg(irg)->isa_link = OALLOCZ(obst, amd64_irg_data_t);
+
+	be_birg_from_irg(irg)->non_ssa_regs = sp_is_non_ssa;
+	amd64_select_instructions(irg);
+
+	be_step_schedule(irg);
+
+	be_timer_push(T_RA_PREPARATION);
+	be_sched_fix_flags(irg, &amd64_reg_classes[CLASS_amd64_flags], NULL,
+					   NULL, NULL);
+	be_timer_pop(T_RA_PREPARATION);
+
+	be_step_regalloc(irg, &amd64_regalloc_if);
+
+	amd64_before_emit(irg);
+	return true;
+}
+
 static void amd64_generate_code(FILE *output, const char *cup_name)
 {
 	amd64_constants = pmap_create();
+	if (amd64_emit_elf)
+		be_elf_select_target(&amd64_elf_target);
 	be_begin(output, cup_name);
 	unsigned *const sp_is_non_ssa = rbitset_alloca(N_AMD64_REGISTERS);
 	rbitset_set(sp_is_non_ssa, REG_RSP);
 
 	foreach_irp_irg(i, irg) {
-		if (!be_step_first(irg))
+		if (!lower_for_emit(irg, sp_is_non_ssa))
 			continue;
 
-		struct obstack *obst = be_get_be_obst(irg);
-		be_birg_from_irg(irg)->isa_link = OALLOCZ(obst, amd64_irg_data_t);
+		be_timer_push(T_EMIT);
+		amd64_emit_function(irg);
+		be_timer_pop(T_EMIT);
 
-		be_birg_from_irg(irg)->non_ssa_regs = sp_is_non_ssa;
-		amd64_select_instructions(irg);
+		be_step_last(irg);
+	}
 
-		be_step_schedule(irg);
+	be_finish();
+	pmap_destroy(amd64_constants);
+}
 
-		be_timer_push(T_RA_PREPARATION);
-		be_sched_fix_flags(irg, &amd64_reg_classes[CLASS_amd64_flags], NULL,
-						   NULL, NULL);
-		be_timer_pop(T_RA_PREPARATION);
+static void amd64_begin_jit_session(void)
+{
+	amd64_constants = pmap_create();
+}
 
-		be_step_regalloc(irg, &amd64_regalloc_if);
+static void amd64_end_jit_session(void)
+{
+	pmap_destroy(amd64_constants);
+	amd64_constants = NULL;
+}
 
-		amd64_finish_and_emit(irg);
+static ir_jit_function_t *amd64_jit_compile(ir_jit_segment_t *const segment,
+                                            ir_graph *const irg)
+{
+	unsigned *const sp_is_non_ssa = rbitset_alloca(N_AMD64_REGISTERS);
+	rbitset_set(sp_is_non_ssa, REG_RSP);
 
-		be_step_last(irg);
+	if (!lower_for_emit(irg, sp_is_non_ssa))
+		return NULL;
+
+	be_timer_push(T_EMIT);
+	ir_jit_function_t *const res = amd64_emit_jit(segment, irg);
+	be_timer_pop(T_EMIT);
+
+	be_step_last(irg);
+	return res;
+}
+
+/** Register classes of the eightbytes of an aggregate in the SysV ABI. */
+typedef enum eightbyte_class_t {
+	CLASS_NONE,
+	CLASS_INTEGER,
+	CLASS_SSE,
+} eightbyte_class_t;
+
+/** Modes of the values an aggregate is returned in. */
+typedef enum ret_kind_t {
+	RET_NONE,
+	RET_BU,
+	RET_HU,
+	RET_IU,
+	RET_LU,
+	RET_F,
+	RET_D,
+	RET_LAST = RET_D,
+} ret_kind_t;
+
+static ir_mode         *ret_modes[RET_LAST + 1][RET_LAST + 1][2];
+static aggregate_spec_t ret_specs[RET_LAST + 1][RET_LAST + 1];
+
+static void init_aggregate_specs(void)
+{
+	ir_mode *const modes[] = {
+		[RET_NONE] = NULL,
+		[RET_BU]   = mode_Bu,
+		[RET_HU]   = mode_Hu,
+		[RET_IU]   = mode_Iu,
+		[RET_LU]   = mode_Lu,
+		[RET_F]    = mode_F,
+		[RET_D]    = mode_D,
+	};
+	for (ret_kind_t first = RET_BU; first <= RET_LAST; ++first) {
+		for (ret_kind_t second = RET_NONE; second <= RET_LAST; ++second) {
+			ret_modes[first][second][0] = modes[first];
+			ret_modes[first][second][1] = modes[second];
+			ret_specs[first][second] = (aggregate_spec_t) {
+				.n_values = second == RET_NONE ? 1 : 2,
+				.modes    = ret_modes[first][second],
+			};
+		}
 	}
+}
 
-	be_finish();
-	pmap_destroy(amd64_constants);
+/**
+ * Merges the classes of the leaves of the part of type @p type at byte offset
+ * @p offset of an aggregate into @p classes.  Returns false if the aggregate
+ * has to be returned in memory.
+ */
+static bool classify_eightbytes(ir_type const *const type,
+                                unsigned const offset,
+                                eightbyte_class_t *const classes)
+{
+	if (is_atomic_type(type)) {
+		ir_mode *const mode = get_type_mode(type);
+		unsigned const size = get_mode_size_bytes(mode);
+		/* unaligned leaves and x87 values are returned in memory */
+		if (size > 8 || offset % size != 0)
+			return false;
+		eightbyte_class_t *const cls = &classes[offset / 8];
+		if (!mode_is_float(mode))
+			*cls = CLASS_INTEGER;
+		else if (*cls == CLASS_NONE)
+			*cls = CLASS_SSE;
+		return true;
+	} else if (is_compound_type(type)) {
+		for (size_t i = 0, n = get_compound_n_members(type); i < n; ++i) {
+			ir_entity *const member = get_compound_member(type, i);
+			if (!classify_eightbytes(get_entity_type(member),
+			                         offset + get_entity_offset(member),
+			                         classes))
+				return false;
+		}
+		return true;
+	} else if (is_Array_type(type) && has_array_size(type)) {
+		ir_type *const element_type = get_array_element_type(type);
+		unsigned const element_size = get_type_size(element_type);
+		for (unsigned i = 0, n = get_array_size_int(type); i < n; ++i) {
+			if (!classify_eightbytes(element_type, offset + i * element_size,
+			                         classes))
+				return false;
+		}
+		return true;
+	}
+	return false;
+}
+
+static ret_kind_t get_ret_kind(eightbyte_class_t const cls, unsigned const size)
+{
+	switch (cls) {
+	case CLASS_INTEGER:
+		switch (size) {
+		case 1: return RET_BU;
+		case 2: return RET_HU;
+		case 4: return RET_IU;
+		case 8: return RET_LU;
+		}
+		break;
+	case CLASS_SSE:
+		switch (size) {
+		case 4: return RET_F;
+		case 8: return RET_D;
+		}
+		break;
+	case CLASS_NONE:
+		break;
+	}
+	return RET_NONE;
+}
+
+/**
+ * Returns small aggregates in RAX:RDX and XMM0:XMM1 as the SysV ABI does, or
+ * in RAX for the Win64 ABI.  Eightbytes with odd sizes are not supported and
+ * make the aggregate go through memory.
+ */
+static aggregate_spec_t const *amd64_decide_compound_ret(ir_type const *type)
+{
+	unsigned const size = get_type_size(type);
+	if (amd64_use_x64_abi) {
+		switch (size) {
+		case 1: return &ret_specs[RET_BU][RET_NONE];
+		case 2: return &ret_specs[RET_HU][RET_NONE];
+		case 4: return &ret_specs[RET_IU][RET_NONE];
+		case 8: return &ret_specs[RET_LU][RET_NONE];
+		}
+		return &no_values_aggregate_spec;
+	}
+
+	if (size == 0 || size > 16)
+		return &no_values_aggregate_spec;
+	eightbyte_class_t classes[2] = { CLASS_NONE, CLASS_NONE };
+	if (!classify_eightbytes(type, 0, classes))
+		return &no_values_aggregate_spec;
+
+	ret_kind_t kinds[2] = { RET_NONE, RET_NONE };
+	for (unsigned i = 0; i * 8 < size; ++i) {
+		kinds[i] = get_ret_kind(classes[i], MIN(size - i * 8, 8));
+		if (kinds[i] == RET_NONE)
+			return &no_values_aggregate_spec;
+	}
+	return &ret_specs[kinds[0]][kinds[1]];
 }
 
 static void amd64_lower_for_target(void)
 {
 	/* lower compound param handling */
-	lower_calls_with_compounds(LF_RETURN_HIDDEN, NULL);
+	init_aggregate_specs();
+	lower_calls_with_compounds(LF_RETURN_HIDDEN, amd64_decide_compound_ret);
 	be_after_irp_transform("lower-calls");
 
+	/* The ELF writer cannot emit jump tables, so lower all switches to
+	 * compare trees there. */
+	unsigned const small_switch = amd64_emit_elf ? UINT_MAX : 4;
 	foreach_irp_irg(i, irg) {
-		lower_switch(irg, 4, 256, mode_Iu);
+		lower_switch(irg, small_switch, 256, mode_Iu);
 		be_after_transform(irg, "lower-switch");
 	}
 
@@ -723,11 +926,16 @@ static void amd64_lower_for_target(void)
 		 * CopyBs into memcpy calls, because we cannot handle CopyB nodes
 		 * during code generation yet.
 		 * TODO:  Adapt this once custom CopyB handling is implemented. */
-		lower_CopyB(irg, 64, 65, true);
+		lower_CopyB(irg, 128, 129, true);
 		be_after_transform(irg, "lower-copyb");
 	}
 
-	ir_builtin_kind supported[6];
+	/* decide which vararg registers are needed before va_arg is lowered */
+	foreach_irp_irg(i, irg) {
+		amd64_analyze_va_usage(irg);
+	}
+
+	ir_builtin_kind supported[7];
 	size_t  s = 0;
 	supported[s++] = ir_bk_ffs;
 	supported[s++] = ir_bk_clz;
@@ -735,26 +943,160 @@ static void amd64_lower_for_target(void)
 	supported[s++] = ir_bk_compare_swap;
 	supported[s++] = ir_bk_saturating_increment;
 	supported[s++] = ir_bk_va_start;
+	supported[s++] = ir_bk_prefetch;
 
 	assert(s <= ARRAY_SIZE(supported));
 	lower_builtins(s, supported);
 	be_after_irp_transform("lower-builtins");
 }
 
+/**
+ * Checks for Mux(cmp, 0, 1) and Mux(cmp, 1, 0) on integer values, which are
+ * materialized with a setcc.
+ */
+static bool mux_is_set(ir_node *sel, ir_node *mux_false, ir_node *mux_true)
+{
+	if (!is_Cmp(sel) || !mode_is_int(get_irn_mode(mux_true)))
+		return false;
+	ir_mode *const cmp_mode = get_irn_mode(get_Cmp_left(sel));
+	if (!mode_is_int(cmp_mode) && !mode_is_reference(cmp_mode))
+		return false;
+	if (!is_Const(mux_true) || !is_Const(mux_false))
+		return false;
+	return (is_Const_one(mux_true) && is_Const_null(mux_false))
+	    || (is_Const_null(mux_true) && is_Const_one(mux_false));
+}
+
 static int amd64_is_mux_allowed(ir_node *sel, ir_node *mux_false,
                                 ir_node *mux_true)
 {
 	/* optimizable by middleend */
 	if (ir_is_optimizable_mux(sel, mux_false, mux_true))
 		return true;
-	return false;
+	return mux_is_set(sel, mux_false, mux_true);
+}
+
+/** The latencies of the instructions of a microarchitecture, which are
+ * used to replace multiplications by constants. */
+typedef struct amd64_insn_costs_t {
+	int add_cost;    /**< latency of an add or sub instruction */
+	int lea_cost;    /**< latency of a lea with a scaled index */
+	int shf_cost;    /**< latency of a constant shift instruction */
+	int mul32_cost;  /**< latency of a 32 bit imul instruction */
+	int mul64_cost;  /**< latency of a 64 bit imul instruction */
+} amd64_insn_costs_t;
+
+typedef enum {
+	tune_generic,
+	tune_core2,
+	tune_k8,
+	tune_zen,
+} amd64_tune_t;
+
+static const amd64_insn_costs_t amd64_insn_costs[] = {
+	/* Sandy Bridge and later Intel cores */
+	[tune_generic] = { 1, 1, 1, 3, 3 },
+	[tune_core2]   = { 1, 1, 1, 3, 5 },
+	[tune_k8]      = { 1, 2, 1, 3, 4 },
+	/* scaled leas are slower on Zen */
+	[tune_zen]     = { 1, 2, 1, 3, 3 },
+};
+
+static const lc_opt_enum_int_items_t tune_items[] = {
+	{ "generic",     tune_generic },
+	{ "core2",       tune_core2   },
+	{ "nehalem",     tune_generic },
+	{ "sandybridge", tune_generic },
+	{ "haswell",     tune_generic },
+	{ "skylake",     tune_generic },
+	{ "k8",          tune_k8      },
+	{ "k10",         tune_k8      },
+	{ "znver1",      tune_zen     },
+	{ "znver2",      tune_zen     },
+	{ NULL,          0            },
+};
+
+static int amd64_tune;
+static lc_opt_enum_int_var_t tune_var = {
+	&amd64_tune, tune_items
+};
+
+/**
+ * Returns true if the multiplication constant @p tv fits into a signed
+ * immediate of @p bits bits.
+ */
+static bool mul_imm_fits(ir_tarval *tv, unsigned bits)
+{
+	if (!tarval_is_long(tv))
+		return false;
+	long const val = get_tarval_long(tv);
+	long const max = (1L << (bits - 1)) - 1;
+	return -max - 1 <= val && val <= max;
+}
+
+/**
+ * Evaluate the latency of an instruction. Used by the irarch multiplication
+ * lowerer.
+ */
+static int amd64_evaluate_insn(insn_kind kind, const ir_mode *mode,
+                               ir_tarval *tv)
+{
+	(void)tv;
+	amd64_insn_costs_t const *const costs = &amd64_insn_costs[amd64_tune];
+	switch (kind) {
+	case MUL:
+		return get_mode_size_bits(mode) <= 32 ? costs->mul32_cost
+		                                      : costs->mul64_cost;
+	case LEA:
+		return costs->lea_cost;
+	case ADD:
+	case SUB:
+	case ZERO:
+		return costs->add_cost;
+	case SHIFT:
+		return costs->shf_cost;
+	default:
+		return 1;
+	}
+}
+
+/**
+ * Evaluate the size of an instruction in bytes. Used by the irarch
+ * multiplication lowerer in cold blocks.
+ */
+static int amd64_evaluate_insn_size(insn_kind kind, const ir_mode *mode,
+                                    ir_tarval *tv)
+{
+	/* 64 bit operations need a REX prefix */
+	int const rex = get_mode_size_bits(mode) > 32;
+	switch (kind) {
+	case MUL:
+		/* imul with an 8 or 32 bit immediate, otherwise the constant needs
+		 * a movabs */
+		if (mul_imm_fits(tv, 8))
+			return rex + 3;
+		if (mul_imm_fits(tv, 32))
+			return rex + 6;
+		return 10 + rex + 3;
+	case LEA:
+		return rex + 3;
+	case ADD:
+	case SUB:
+	case ZERO:
+		return rex + 2;
+	case SHIFT:
+		return rex + 3;
+	default:
+		return 1;
+	}
 }
 
 static const ir_settings_arch_dep_t amd64_arch_dep = {
 	.also_use_subs        = true,
 	.maximum_shifts       = 4,
 	.highest_shift_amount = 63,
-	.evaluate             = NULL,
+	.evaluate             = amd64_evaluate_insn,
+	.evaluate_size        = amd64_evaluate_insn_size,
 	.allow_mulhs          = true,
 	.allow_mulhu          = true,
 	.max_bits_for_mulh    = 32,
@@ -767,6 +1109,8 @@ static backend_params amd64_backend_params = {
 	.modulo_shift                  = 32,
 	.dep_param                     = &amd64_arch_dep,
 	.allow_ifconv                  = amd64_is_mux_allowed,
+	.branch_mispredict_penalty     = 15,
+	.mux_latency                   = 1,
 	.machine_size                  = 64,
 	.mode_float_arithmetic         = NULL,  /* will be set later */
 	.type_long_long                = NULL,  /* will be set later */
@@ -778,6 +1122,10 @@ static backend_params amd64_backend_params = {
 		.va_list_type = NULL,  /* Will be set later */
 		.lower_va_arg = amd64_lower_va_arg,
 	},
+	.prefetch_distance             = 256,
+	.mode_vector_move              = NULL,  /* will be set later */
+	.n_int_registers               = 14,
+	.n_float_registers             = 16,
 };
 
 static const backend_params *amd64_get_backend_params(void) {
@@ -797,6 +1145,7 @@ static void amd64_init_types(void)
 	/* use an int128 mode for xmm registers for now, so that firm allows us to
 	 * create constants with the xmm mode... */
 	amd64_mode_xmm = new_int_mode("x86_xmm", irma_twos_complement, 128, 0, 0);
+	amd64_backend_params.mode_vector_move = amd64_mode_xmm;
 
 	x86_init_x87_type();
 	amd64_backend_params.type_long_double = x86_type_E;
@@ -808,15 +1157,43 @@ static void amd64_init(void)
 {
 	amd64_init_types();
 	amd64_register_init();
+	obstack_init(&amd64_opcodes_obst);
 	amd64_create_opcodes();
 	amd64_cconv_init();
 	x86_set_be_asm_constraint_support(&amd64_asm_constraints);
 }
 
+/**
+ * Get the estimated cycle count for @p node.
+ *
+ * @param node  The node.
+ *
+ * @return      The estimated cycle count for this operation
+ */
 static unsigned amd64_get_op_estimated_cost(const ir_node *node)
 {
-	(void)node;/* TODO */
-	return 1;
+	if (!is_amd64_irn(node))
+		return 1;
+
+	unsigned cost = get_amd64_latency(node);
+
+	/* in case of memory operands add additional cycles */
+	amd64_op_mode_t const op_mode = get_amd64_attr_const(node)->op_mode;
+	if (amd64_loads(node) || op_mode == AMD64_OP_ADDR_REG
+	    || op_mode == AMD64_OP_ADDR_IMM || op_mode == AMD64_OP_X87_ADDR_REG) {
+		amd64_addr_t const *const addr = &get_amd64_addr_attr_const(node)->addr;
+		if (addr->immediate.kind == X86_IMM_FRAMEENT
+		    || addr->variant == X86_ADDR_JUST_IMM
+		    || addr->variant == X86_ADDR_RIP) {
+			/* Stack access or global, assume it is cached. */
+			cost += 5;
+		} else {
+			/* Access probably elsewhere. */
+			cost += 20;
+		}
+	}
+
+	return cost;
 }
 
 static arch_isa_if_t const amd64_isa_if = {
@@ -832,6 +1209,11 @@ static arch_isa_if_t const amd64_isa_if = {
 	.is_valid_clobber      = amd64_is_valid_clobber,
 	.handle_intrinsics     = amd64_handle_intrinsics,
 	.get_op_estimated_cost = amd64_get_op_estimated_cost,
+	.jit_compile           = amd64_jit_compile,
+	.begin_jit_session     = amd64_begin_jit_session,
+	.end_jit_session       = amd64_end_jit_session,
+	.emit_function         = amd64_emit_jit_function,
+	.emit_jit_relocation   = amd64_emit_jit_relocation,
 };
 
 BE_REGISTER_MODULE_CONSTRUCTOR(be_init_arch_amd64)
@@ -841,8 +1223,11 @@ void be_init_arch_amd64(void)
 	FIRM_DBG_REGISTER(dbg, "firm.be.amd64.cg");
 
 	static const lc_opt_table_entry_t options[] = {
-		LC_OPT_ENT_BOOL("x64abi",      "Use x64 ABI (otherwise system V)", &amd64_use_x64_abi),
-		LC_OPT_ENT_BOOL("no-red-zone", "gcc compatibility",                &amd64_use_red_zone),
+		LC_OPT_ENT_BOOL("x64abi",      "Use x64 ABI (otherwise system V)",              &amd64_use_x64_abi),
+		LC_OPT_ENT_BOOL("no-red-zone", "gcc compatibility",                             &amd64_use_red_zone),
+		LC_OPT_ENT_BOOL("machcode",    "output machine code instead of assembler",      &amd64_emit_machcode),
+		LC_OPT_ENT_BOOL("elf",         "write an ELF object file instead of assembler", &amd64_emit_elf),
+		LC_OPT_ENT_ENUM_INT("tune",    "optimize for instruction architecture",         &tune_var),
 		LC_OPT_LAST
 	};
 	lc_opt_entry_t *be_grp    = lc_opt_get_grp(firm_opt_get_root(), "be");
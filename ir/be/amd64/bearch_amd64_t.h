@@ -15,7 +15,8 @@
 #include "../ia32/x86_x87.h"
 
 typedef struct amd64_irg_data_t {
-	bool omit_fp;
+	bool     omit_fp;
+	ir_node *prologue_block; /**< block setting up the stack frame */
 } amd64_irg_data_t;
 
 extern pmap *amd64_constants; /**< A map of entities that store const tarvals */
@@ -24,6 +25,8 @@ extern ir_mode *amd64_mode_xmm;
 
 extern bool amd64_use_red_zone;
 extern bool amd64_use_x64_abi;
+extern bool amd64_emit_machcode; /**< emit machine code as .byte directives */
+extern bool amd64_emit_elf;      /**< write an ELF object file */
 
 #define AMD64_REGISTER_SIZE   8
 /** power of two stack alignment on calls */
@@ -45,6 +45,18 @@ static const arch_register_t* const float_result_regs[] = {
 	&arm_registers[REG_F1],
 };
 
+static const arch_register_t* const neon_param_regs[] = {
+	&arm_registers[REG_Q0],
+	&arm_registers[REG_Q1],
+	&arm_registers[REG_Q2],
+	&arm_registers[REG_Q3],
+};
+
+static const arch_register_t* const neon_result_regs[] = {
+	&arm_registers[REG_Q0],
+	&arm_registers[REG_Q1],
+};
+
 calling_convention_t *arm_decide_calling_convention(const ir_graph *irg,
                                                     ir_type *function_type)
 {
@@ -53,6 +65,7 @@ calling_convention_t *arm_decide_calling_convention(const ir_graph *irg,
 	size_t const        n_param_regs = ARRAY_SIZE(param_regs);
 	size_t const        n_params     = get_method_n_params(function_type);
 	size_t              regnum       = 0;
+	size_t              neon_regnum  = 0;
 	reg_or_stackslot_t *params       = XMALLOCNZ(reg_or_stackslot_t, n_params);
 
 	for (size_t i = 0; i < n_params; ++i) {
@@ -62,6 +75,18 @@ calling_convention_t *arm_decide_calling_convention(const ir_graph *irg,
 		reg_or_stackslot_t *param      = &params[i];
 		param->type = param_type;
 
+		/* vectors are passed in q registers or 8 byte aligned on the stack */
+		if (mode_is_vector(mode)) {
+			if (neon_regnum < ARRAY_SIZE(neon_param_regs)) {
+				param->reg0 = neon_param_regs[neon_regnum++];
+			} else {
+				stack_offset  = round_up2(stack_offset, 8);
+				param->offset = stack_offset;
+				stack_offset += bits / 8;
+			}
+			continue;
+		}
+
 		/* doubleword modes need to be passed in even registers */
 		if (param_type->flags & tf_lowered_dw) {
 			if (regnum < n_param_regs) {
@@ -101,12 +126,13 @@ calling_convention_t *arm_decide_calling_convention(const ir_graph *irg,
 			}
 		}
 	}
-	unsigned const n_param_regs_used = regnum;
+	unsigned const n_param_regs_used = regnum + neon_regnum;
 
 	size_t const        n_result_regs= ARRAY_SIZE(result_regs);
 	size_t const n_float_result_regs = ARRAY_SIZE(float_result_regs);
 	size_t              n_results    = get_method_n_ress(function_type);
 	size_t              float_regnum = 0;
+	size_t              neon_regnum_res = 0;
 	reg_or_stackslot_t *results      = XMALLOCNZ(reg_or_stackslot_t, n_results);
 	regnum = 0;
 	for (size_t i = 0; i < n_results; ++i) {
@@ -114,7 +140,11 @@ calling_convention_t *arm_decide_calling_convention(const ir_graph *irg,
 		ir_mode            *result_mode = get_type_mode(result_type);
 		reg_or_stackslot_t *result      = &results[i];
 
-		if (mode_is_float(result_mode)) {
+		if (mode_is_vector(result_mode)) {
+			if (neon_regnum_res >= ARRAY_SIZE(neon_result_regs))
+				panic("too many vector results");
+			result->reg0 = neon_result_regs[neon_regnum_res++];
+		} else if (mode_is_float(result_mode)) {
 			if (float_regnum >= n_float_result_regs) {
 				panic("too many float results");
 			} else {
@@ -157,7 +187,7 @@ calling_convention_t *arm_decide_calling_convention(const ir_graph *irg,
 
 void arm_free_calling_convention(calling_convention_t *cconv)
 {
-	free(cconv->parameters);
-	free(cconv->results);
-	free(cconv);
+	xfree(cconv->parameters);
+	xfree(cconv->results);
+	xfree(cconv);
 }
@@ -73,7 +73,8 @@ static void arm_emit_offset(const ir_node *node)
 	const arm_load_store_attr_t *attr = get_arm_load_store_attr_const(node);
 	assert(attr->base.is_load_store);
 
-	be_emit_irprintf("0x%X", attr->offset);
+	be_emit_cstring("0x");
+	be_emit_hex((unsigned)attr->offset);
 }
 
 /**
@@ -103,6 +104,26 @@ static void arm_emit_float_arithmetic_mode(const ir_node *node)
 	arm_emit_fpa_postfix(attr->mode);
 }
 
+/**
+ * Emit the NEON data type of a vector operation. Integer lanes use
+ * @p int_prefix, float lanes 'f'.
+ */
+static void arm_emit_neon_type(const ir_node *node, char int_prefix)
+{
+	const arm_farith_attr_t *attr      = get_arm_farith_attr_const(node);
+	ir_mode                 *lane_mode = get_mode_vector_element_mode(attr->mode);
+	be_emit_char(mode_is_float(lane_mode) ? 'f' : int_prefix);
+	be_emit_uint(get_mode_size_bits(lane_mode));
+}
+
+/**
+ * Emit the two d registers making up the q register @p reg.
+ */
+static void arm_emit_neon_dregs(const arch_register_t *reg)
+{
+	be_emit_irprintf("d%u, d%u", 2 * reg->index, 2 * reg->index + 1);
+}
+
 static void arm_emit_address(const ir_node *node)
 {
 	const arm_Address_attr_t *address = get_arm_Address_attr_const(node);
@@ -172,7 +193,8 @@ static void arm_emit_shifter_operand(const ir_node *node)
 		val = (val >> attr->shift_immediate)
 			| (val << ((32-attr->shift_immediate) & 31));
 		val &= 0xFFFFFFFF;
-		be_emit_irprintf("#0x%X", val);
+		be_emit_cstring("#0x");
+		be_emit_hex(val);
 		return;
 	}
 	case ARM_SHF_ASR_IMM:
@@ -181,7 +203,10 @@ static void arm_emit_shifter_operand(const ir_node *node)
 	case ARM_SHF_ROR_IMM: {
 		arm_emit_source_register(node, attr->shifter_op_input);
 		char const *const mod = get_shf_mod_name(attr->shift_modifier);
-		be_emit_irprintf(", %s #%u", mod, attr->shift_immediate);
+		be_emit_cstring(", ");
+		be_emit_string(mod);
+		be_emit_cstring(" #");
+		be_emit_uint(attr->shift_immediate);
 		return;
 	}
 
@@ -191,7 +216,9 @@ static void arm_emit_shifter_operand(const ir_node *node)
 	case ARM_SHF_ROR_REG: {
 		arm_emit_source_register(node, attr->shifter_op_input);
 		char const *const mod = get_shf_mod_name(attr->shift_modifier);
-		be_emit_irprintf(", %s ", mod);
+		be_emit_cstring(", ");
+		be_emit_string(mod);
+		be_emit_char(' ');
 		arm_emit_source_register(node, attr->shifter_op_input+1);
 		return;
 	}
@@ -217,7 +244,9 @@ static unsigned get_unique_label(void)
 
 static void emit_constant_name(const ent_or_tv_t *entry)
 {
-	be_emit_irprintf("%sC%u", be_gas_get_private_prefix(), entry->label);
+	be_emit_string(be_gas_get_private_prefix());
+	be_emit_char('C');
+	be_emit_uint(entry->label);
 }
 
 /**
@@ -278,6 +307,21 @@ void arm_emitf(const ir_node *node, const char *format, ...)
 			arm_emit_address(node);
 			break;
 
+		case 'Q': {
+			const char kind = *format++;
+			if (!is_digit(*format))
+				goto unknown;
+			unsigned const pos = *format++ - '0';
+			if (kind == 'S') {
+				arm_emit_neon_dregs(arch_get_irn_register_in(node, pos));
+			} else if (kind == 'D') {
+				arm_emit_neon_dregs(arch_get_irn_register_out(node, pos));
+			} else {
+				goto unknown;
+			}
+			break;
+		}
+
 		case 'o':
 			arm_emit_offset(node);
 			break;
@@ -304,6 +348,8 @@ void arm_emitf(const ir_node *node, const char *format, ...)
 			case 'S': arm_emit_store_mode(node);            break;
 			case 'A': arm_emit_float_arithmetic_mode(node); break;
 			case 'F': arm_emit_float_load_store_mode(node); break;
+			case 'V': arm_emit_neon_type(node, 'i');        break;
+			case 'N': arm_emit_neon_type(node, 's');        break;
 			default:
 				--format;
 				goto unknown;
@@ -312,19 +358,19 @@ void arm_emitf(const ir_node *node, const char *format, ...)
 
 		case 'X': {
 			int num = va_arg(ap, int);
-			be_emit_irprintf("%X", num);
+			be_emit_hex((unsigned)num);
 			break;
 		}
 
 		case 'u': {
 			unsigned num = va_arg(ap, unsigned);
-			be_emit_irprintf("%u", num);
+			be_emit_uint(num);
 			break;
 		}
 
 		case 'd': {
 			int num = va_arg(ap, int);
-			be_emit_irprintf("%d", num);
+			be_emit_int(num);
 			break;
 		}
 
@@ -409,6 +455,53 @@ static void emit_arm_fConst(const ir_node *irn)
 	arm_emitf(irn, "ldf%m %D0, %C", mode, entry);
 }
 
+/**
+ * Emit a NEON vector constant. Zero and all ones are created with vmov, other
+ * values are loaded from the constant pool.
+ */
+static void emit_arm_VConst(const ir_node *irn)
+{
+	ir_tarval *const tv = get_fConst_value(irn);
+	if (tarval_is_null(tv)) {
+		arm_emitf(irn, "vmov.i32 %D0, #0");
+	} else if (tarval_is_all_one(tv)) {
+		arm_emitf(irn, "vmov.i8 %D0, #0xff");
+	} else {
+		ent_or_tv_t key = {
+			.u.tv      = tv,
+			.is_entity = false
+		};
+		ent_or_tv_t *entry = get_ent_or_tv_entry(&key);
+		arm_emitf(irn, "adr r12, %C\nvld1.64 {%QD0}, [r12]", entry);
+	}
+}
+
+/**
+ * Emit a NEON register load from the stack frame as a pair of vldr.
+ */
+static void emit_arm_VLdr(const ir_node *node)
+{
+	const arm_load_store_attr_t *attr = get_arm_load_store_attr_const(node);
+	const arch_register_t       *reg
+		= arch_get_irn_register_out(node, pn_arm_VLdr_res);
+	int const offset = attr->offset;
+	arm_emitf(node, "vldr d%u, [%S0, #%d]\nvldr d%u, [%S0, #%d]",
+	          2 * reg->index, offset, 2 * reg->index + 1, offset + 8);
+}
+
+/**
+ * Emit a NEON register store to the stack frame as a pair of vstr.
+ */
+static void emit_arm_VStr(const ir_node *node)
+{
+	const arm_load_store_attr_t *attr = get_arm_load_store_attr_const(node);
+	const arch_register_t       *reg
+		= arch_get_irn_register_in(node, n_arm_VStr_val);
+	int const offset = attr->offset;
+	arm_emitf(node, "vstr d%u, [%S0, #%d]\nvstr d%u, [%S0, #%d]",
+	          2 * reg->index, offset, 2 * reg->index + 1, offset + 8);
+}
+
 /**
  * Emit a Compare with conditional branch.
  */
@@ -482,14 +575,65 @@ static void emit_jumptable_target(ir_entity const *const table,
 	arm_emit_cfop_target(proj_x);
 }
 
+static void emit_thumb_jumptable_target(ir_entity const *const table,
+                                        ir_node const *const proj_x)
+{
+	emit_jumptable_target(table, proj_x);
+	/* set the Thumb bit, as the target is loaded into pc */
+	be_emit_cstring("+1");
+}
+
 static void emit_arm_SwitchJmp(const ir_node *irn)
 {
 	const arm_SwitchJmp_attr_t *attr = get_arm_SwitchJmp_attr_const(irn);
+	if (arm_cg_config.thumb) {
+		/* Thumb-2 cannot use pc as base register, so address the table
+		 * following the branch with r12. tbb/tbh are not used, as they only
+		 * jump forward. */
+		unsigned const label = get_unique_label();
+		arm_emitf(irn, "adr r12, %sJ%u", be_gas_get_private_prefix(), label);
+		arm_emitf(irn, "ldr pc, [r12, %S0, lsl #2]");
+		be_emit_cstring("\t.p2align 2\n");
+		be_emit_write_line();
+		be_emit_irprintf("%sJ%u:\n", be_gas_get_private_prefix(), label);
+		be_emit_write_line();
+		be_emit_jump_table(irn, attr->table, NULL, mode_P,
+		                   emit_thumb_jumptable_target);
+		return;
+	}
 	arm_emitf(irn, "ldrls pc, [pc, %S0, asl #2]");
 
 	be_emit_jump_table(irn, attr->table, NULL, mode_P, emit_jumptable_target);
 }
 
+static void emit_arm_LinkMovPC(const ir_node *irn)
+{
+	if (arm_cg_config.thumb) {
+		arm_emitf(irn, "blx %O");
+	} else {
+		arm_emitf(irn, "mov lr, pc");
+		arm_emitf(irn, "mov pc, %O");
+	}
+}
+
+static void emit_arm_TailCall(const ir_node *irn)
+{
+	arm_Address_attr_t const *const attr = get_arm_Address_attr_const(irn);
+	if (attr->entity != NULL) {
+		arm_emitf(irn, "b %I");
+	} else {
+		arm_emitf(irn, "bx %S2");
+	}
+}
+
+static void emit_arm_OrPl(const ir_node *irn)
+{
+	/* Thumb-2 needs an IT block for the conditional instruction */
+	if (arm_cg_config.thumb)
+		arm_emitf(irn, "it pl");
+	arm_emitf(irn, "orrpl %D0, %S2, %O");
+}
+
 /** Emit an IncSP node */
 static void emit_be_IncSP(const ir_node *irn)
 {
@@ -518,6 +662,8 @@ static void emit_be_Copy(const ir_node *irn)
 		arm_emitf(irn, "mov %D0, %S0");
 	} else if (cls == &arm_reg_classes[CLASS_arm_fpa]) {
 		arm_emitf(irn, "mvf %D0, %S0");
+	} else if (cls == &arm_reg_classes[CLASS_arm_neon]) {
+		arm_emitf(irn, "vmov %D0, %S0");
 	} else {
 		panic("move not supported for this register class");
 	}
@@ -525,10 +671,19 @@ static void emit_be_Copy(const ir_node *irn)
 
 static void emit_be_Perm(const ir_node *irn)
 {
-	arm_emitf(irn,
-		"eor %D0, %D0, %D1\n"
-		"eor %D1, %D0, %D1\n"
-		"eor %D0, %D0, %D1");
+	arch_register_class_t const *const cls
+		= arch_get_irn_register_out(irn, 0)->cls;
+	if (cls == &arm_reg_classes[CLASS_arm_neon]) {
+		arm_emitf(irn,
+			"veor %D0, %D0, %D1\n"
+			"veor %D1, %D0, %D1\n"
+			"veor %D0, %D0, %D1");
+	} else {
+		arm_emitf(irn,
+			"eor %D0, %D0, %D1\n"
+			"eor %D1, %D0, %D1\n"
+			"eor %D0, %D0, %D1");
+	}
 }
 
 static void emit_be_MemPerm(const ir_node *node)
@@ -541,6 +696,12 @@ static void emit_be_MemPerm(const ir_node *node)
 		panic("memperm with more than 12 inputs not supported yet");
 
 	int sp_change = 0;
+	for (int i = 0; i < memperm_arity; ++i) {
+		ir_entity *entity = be_get_MemPerm_in_entity(node, i);
+		if (get_type_size(get_entity_type(entity)) > 4)
+			panic("memperm of entities larger than 4 bytes not supported yet");
+	}
+
 	for (int i = 0; i < memperm_arity; ++i) {
 		/* spill register */
 		arm_emitf(node, "str r%d, [sp, #-4]!", i);
@@ -592,7 +753,13 @@ static void arm_register_emitters(void)
 	be_set_emitter(op_arm_fConst,    emit_arm_fConst);
 	be_set_emitter(op_arm_FrameAddr, emit_arm_FrameAddr);
 	be_set_emitter(op_arm_Jmp,       emit_arm_Jmp);
+	be_set_emitter(op_arm_LinkMovPC, emit_arm_LinkMovPC);
+	be_set_emitter(op_arm_OrPl,      emit_arm_OrPl);
 	be_set_emitter(op_arm_SwitchJmp, emit_arm_SwitchJmp);
+	be_set_emitter(op_arm_TailCall,  emit_arm_TailCall);
+	be_set_emitter(op_arm_VConst,    emit_arm_VConst);
+	be_set_emitter(op_arm_VLdr,      emit_arm_VLdr);
+	be_set_emitter(op_arm_VStr,      emit_arm_VStr);
 	be_set_emitter(op_be_Copy,       emit_be_Copy);
 	be_set_emitter(op_be_CopyKeep,   emit_be_Copy);
 	be_set_emitter(op_be_IncSP,      emit_be_IncSP);
@@ -673,6 +840,10 @@ void arm_emit_function(ir_graph *irg)
 
 	ir_entity            *const entity = get_irg_entity(irg);
 	parameter_dbg_info_t *const infos  = construct_parameter_infos(irg);
+	if (arm_cg_config.thumb) {
+		be_emit_cstring("\t.thumb_func\n");
+		be_emit_write_line();
+	}
 	be_gas_emit_function_prolog(entity, 4, infos);
 
 	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
@@ -701,7 +872,23 @@ void arm_emit_function(ir_graph *irg)
 				be_emit_write_line();
 			} else {
 				ir_tarval *tv   = entry->u.tv;
-				unsigned   size = get_mode_size_bytes(get_tarval_mode(tv));
+				ir_mode   *mode = get_tarval_mode(tv);
+				unsigned   size = get_mode_size_bytes(mode);
+
+				if (mode_is_vector(mode)) {
+					/* vectors are loaded with vld1.64, the first lane is
+					 * stored in the least significant bits */
+					for (unsigned vi = 0; vi != size;) {
+						uint32_t v;
+						v  = get_tarval_sub_bits(tv, vi++) <<  0;
+						v |= get_tarval_sub_bits(tv, vi++) <<  8;
+						v |= get_tarval_sub_bits(tv, vi++) << 16;
+						v |= get_tarval_sub_bits(tv, vi++) << 24;
+						be_emit_irprintf("\t.word\t%" PRIu32 "\n", v);
+						be_emit_write_line();
+					}
+					continue;
+				}
 
 				/* beware: ARM fpa uses big endian format */
 				for (unsigned vi = round_up2(size, 4); vi != 0;) {
@@ -739,10 +926,22 @@ static const char *get_variant_string(arm_variant_t variant)
 
 void arm_emit_file_prologue(void)
 {
+	if (arm_cg_config.thumb) {
+		be_emit_cstring("\t.syntax unified\n");
+		be_emit_write_line();
+	}
 	be_emit_irprintf("\t.arch %s\n", get_variant_string(arm_cg_config.variant));
 	be_emit_write_line();
-	be_emit_cstring("\t.fpu softvfp\n");
+	if (arm_cg_config.neon) {
+		be_emit_cstring("\t.fpu neon\n");
+	} else {
+		be_emit_cstring("\t.fpu softvfp\n");
+	}
 	be_emit_write_line();
+	if (arm_cg_config.thumb) {
+		be_emit_cstring("\t.thumb\n");
+		be_emit_write_line();
+	}
 }
 
 void arm_init_emitter(void)
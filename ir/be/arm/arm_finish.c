@@ -26,7 +26,7 @@
 
 static bool is_frame_load(const ir_node *node)
 {
-	return is_arm_Ldr(node) || is_arm_Ldf(node);
+	return is_arm_Ldr(node) || is_arm_Ldf(node) || is_arm_VLdr(node);
 }
 
 static void arm_collect_frame_entity_nodes(ir_node *node, void *data)
@@ -57,6 +57,7 @@ static void arm_set_frame_entity(ir_node *node, ir_entity *entity,
 
 static void introduce_epilog(ir_node *ret)
 {
+	assert((int)n_arm_TailCall_sp == (int)n_arm_Return_sp);
 	arch_register_t const *const sp_reg = &arm_registers[REG_SP];
 	assert(arch_get_irn_register_req_in(ret, n_arm_Return_sp) == sp_reg->single_req);
 
@@ -74,7 +75,7 @@ static void introduce_prolog_epilog(ir_graph *irg)
 {
 	/* introduce epilog for every return node */
 	foreach_irn_in(get_irg_end_block(irg), i, ret) {
-		assert(is_arm_Return(ret));
+		assert(is_arm_Return(ret) || is_arm_TailCall(ret));
 		introduce_epilog(ret);
 	}
 
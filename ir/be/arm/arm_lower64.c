@@ -373,6 +373,7 @@ void arm_lower_64bit(void)
 		word_signed,
 		64, /* doubleword size */
 		arm_cg_config.big_endian,
+		NULL,
 	};
 
 	create_divmod_intrinsics(word_unsigned, word_signed);
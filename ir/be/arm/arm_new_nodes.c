@@ -31,13 +31,15 @@
 
 static bool arm_has_address_attr(const ir_node *node)
 {
-	return is_arm_Address(node) || is_arm_FrameAddr(node) || is_arm_Bl(node);
+	return is_arm_Address(node) || is_arm_FrameAddr(node) || is_arm_Bl(node)
+	    || is_arm_TailCall(node);
 }
 
 static bool has_load_store_attr(const ir_node *node)
 {
 	return is_arm_Ldr(node) || is_arm_Str(node) || is_arm_LinkLdrPC(node)
-		|| is_arm_Ldf(node) || is_arm_Stf(node);
+		|| is_arm_Ldf(node) || is_arm_Stf(node) || is_arm_VLdr(node)
+		|| is_arm_VStr(node);
 }
 
 static bool has_shifter_operand(const ir_node *node)
@@ -57,7 +59,10 @@ static bool has_cmp_attr(const ir_node *node)
 static bool has_farith_attr(const ir_node *node)
 {
 	return is_arm_Adf(node) || is_arm_Muf(node) || is_arm_Suf(node)
-	    || is_arm_Dvf(node) || is_arm_Mvf(node) || is_arm_FltX(node);
+	    || is_arm_Dvf(node) || is_arm_Mvf(node) || is_arm_FltX(node)
+	    || is_arm_VAdd(node) || is_arm_VSub(node) || is_arm_VMul(node)
+	    || is_arm_VAnd(node) || is_arm_VBic(node) || is_arm_VOrr(node)
+	    || is_arm_VEor(node) || is_arm_VMvn(node) || is_arm_VNeg(node);
 }
 
 void arm_dump_node(FILE *F, const ir_node *n, dump_reason_t reason)
@@ -191,13 +196,13 @@ const arm_Address_attr_t *get_arm_Address_attr_const(const ir_node *node)
 
 static const arm_fConst_attr_t *get_arm_fConst_attr_const(const ir_node *node)
 {
-	assert(is_arm_fConst(node));
+	assert(is_arm_fConst(node) || is_arm_VConst(node));
 	return (const arm_fConst_attr_t*)get_irn_generic_attr_const(node);
 }
 
 static arm_fConst_attr_t *get_arm_fConst_attr(ir_node *node)
 {
-	assert(is_arm_fConst(node));
+	assert(is_arm_fConst(node) || is_arm_VConst(node));
 	return (arm_fConst_attr_t*)get_irn_generic_attr(node);
 }
 
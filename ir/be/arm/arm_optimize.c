@@ -163,6 +163,31 @@ static void peephole_arm_Str_Ldr(ir_node *node)
 	attr->offset = 0;
 }
 
+/**
+ * Fix stackpointer relative NEON spills and reloads if the offset gets too
+ * big. They consist of two vldr/vstr with an offset of at most 1020.
+ */
+static void peephole_arm_VStr_VLdr(ir_node *node)
+{
+	arm_load_store_attr_t *attr   = get_arm_load_store_attr(node);
+	const int              offset = attr->offset;
+	if (offset >= 0 && offset <= 1012 && offset % 4 == 0)
+		return;
+
+	unsigned const n_ptr = is_arm_VStr(node) ? n_arm_VStr_ptr : n_arm_VLdr_ptr;
+	ir_node       *ptr   = get_irn_n(node, n_ptr);
+	arm_vals       v;
+	if (offset >= 0) {
+		arm_gen_vals_from_word(offset, &v);
+		ptr = gen_ptr_add(node, ptr, &v);
+	} else {
+		arm_gen_vals_from_word(-offset, &v);
+		ptr = gen_ptr_sub(node, ptr, &v);
+	}
+	set_irn_n(node, n_ptr, ptr);
+	attr->offset = 0;
+}
+
 /* Perform peephole-optimizations. */
 void arm_peephole_optimization(ir_graph *irg)
 {
@@ -172,6 +197,8 @@ void arm_peephole_optimization(ir_graph *irg)
 	register_peephole_optimization(op_arm_Str,       peephole_arm_Str_Ldr);
 	register_peephole_optimization(op_arm_Ldr,       peephole_arm_Str_Ldr);
 	register_peephole_optimization(op_arm_FrameAddr, peephole_arm_FrameAddr);
+	register_peephole_optimization(op_arm_VStr,      peephole_arm_VStr_VLdr);
+	register_peephole_optimization(op_arm_VLdr,      peephole_arm_VStr_VLdr);
 
 	be_peephole_opt(irg);
 }
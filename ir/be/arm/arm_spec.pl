@@ -6,6 +6,7 @@ $arch = "arm";
 $mode_gp    = "arm_mode_gp";
 $mode_flags = "arm_mode_flags";
 $mode_fp    = "mode_F";
+$mode_neon  = "arm_mode_neon";
 
 %reg_classes = (
 	gp => [
@@ -38,6 +39,25 @@ $mode_fp    = "mode_F";
 		{ name => "f7", dwarf => 103 },
 		{ mode => $mode_fp }
 	],
+	neon => [
+		{ name => "q0",  dwarf => 256 },
+		{ name => "q1",  dwarf => 258 },
+		{ name => "q2",  dwarf => 260 },
+		{ name => "q3",  dwarf => 262 },
+		{ name => "q4",  dwarf => 264 },
+		{ name => "q5",  dwarf => 266 },
+		{ name => "q6",  dwarf => 268 },
+		{ name => "q7",  dwarf => 270 },
+		{ name => "q8",  dwarf => 272 },
+		{ name => "q9",  dwarf => 274 },
+		{ name => "q10", dwarf => 276 },
+		{ name => "q11", dwarf => 278 },
+		{ name => "q12", dwarf => 280 },
+		{ name => "q13", dwarf => 282 },
+		{ name => "q14", dwarf => 284 },
+		{ name => "q15", dwarf => 286 },
+		{ mode => $mode_neon }
+	],
 	flags => [
 		{ name => "fl" },
 		{ mode => $mode_flags, flags => "manual_ra" }
@@ -240,6 +260,24 @@ my $mullop = {
 	outs      => [ "low", "high" ],
 };
 
+my $binop_neon = {
+	irn_flags => [ "rematerializable" ],
+	in_reqs   => [ "neon", "neon" ],
+	out_reqs  => [ "neon" ],
+	ins       => [ "left", "right" ],
+	attr_type => "arm_farith_attr_t",
+	attr      => "ir_mode *op_mode",
+};
+
+my $unop_neon = {
+	irn_flags => [ "rematerializable" ],
+	in_reqs   => [ "neon" ],
+	out_reqs  => [ "neon" ],
+	ins       => [ "val" ],
+	attr_type => "arm_farith_attr_t",
+	attr      => "ir_mode *op_mode",
+};
+
 my $binopf = {
 	irn_flags => [ "rematerializable" ],
 	in_reqs   => [ "fpa", "fpa" ],
@@ -321,7 +359,6 @@ Or => {
 
 OrPl => {
 	#irn_flags => [ "rematerializable" ],
-	emit      => 'orrpl %D0, %S2, %O',
 	attr_type => "arm_shifter_operand_t",
 	in_reqs   => [ "gp", "flags", "gp", "gp" ],
 	out_reqs  => [ "in_r2" ],
@@ -398,7 +435,7 @@ Clz => {
 },
 
 # mov lr, pc\n mov pc, XXX -- This combination is used for calls to function
-# pointers
+# pointers, Thumb-2 code uses blx instead
 LinkMovPC => {
 	state     => "exc_pinned",
 	irn_flags => [ "modify_flags" ],
@@ -407,8 +444,6 @@ LinkMovPC => {
 	attr_type => "arm_shifter_operand_t",
 	attr      => "unsigned shiftop_input, arm_shift_modifier_t shift_modifier, unsigned char immediate_value, unsigned char immediate_rot",
 	init      => "init_arm_shifter_operand(res, shiftop_input, immediate_value, shift_modifier, immediate_rot);\n",
-	emit      => "mov lr, pc\n".
-	             "mov pc, %O",
 },
 
 # mov lr, pc\n ldr pc, XXX -- This combination is used for calls to function
@@ -608,6 +643,104 @@ fConst => {
 	attr_type => "arm_fConst_attr_t",
 },
 
+VAdd => {
+	template => $binop_neon,
+	emit     => 'vadd.%MV %D0, %S0, %S1',
+},
+
+VSub => {
+	template => $binop_neon,
+	emit     => 'vsub.%MV %D0, %S0, %S1',
+},
+
+VMul => {
+	template => $binop_neon,
+	emit     => 'vmul.%MV %D0, %S0, %S1',
+},
+
+VAnd => {
+	template => $binop_neon,
+	emit     => 'vand %D0, %S0, %S1',
+},
+
+VBic => {
+	template => $binop_neon,
+	emit     => 'vbic %D0, %S0, %S1',
+},
+
+VOrr => {
+	template => $binop_neon,
+	emit     => 'vorr %D0, %S0, %S1',
+},
+
+VEor => {
+	template => $binop_neon,
+	emit     => 'veor %D0, %S0, %S1',
+},
+
+VMvn => {
+	template => $unop_neon,
+	emit     => 'vmvn %D0, %S0',
+},
+
+VNeg => {
+	template => $unop_neon,
+	emit     => 'vneg.%MN %D0, %S0',
+},
+
+VLd1 => {
+	op_flags  => [ "uses_memory" ],
+	state     => "exc_pinned",
+	ins       => [ "ptr", "mem" ],
+	outs      => [ "res", "M" ],
+	in_reqs   => [ "gp", "mem" ],
+	out_reqs  => [ "neon", "mem" ],
+	emit      => 'vld1.8 {%QD0}, [%S0]',
+},
+
+VSt1 => {
+	op_flags  => [ "uses_memory" ],
+	state     => "exc_pinned",
+	ins       => [ "ptr", "val", "mem" ],
+	outs      => [ "M" ],
+	in_reqs   => [ "gp", "neon", "mem" ],
+	out_reqs  => [ "mem" ],
+	emit      => 'vst1.8 {%QS1}, [%S0]',
+},
+
+# vldr/vstr pairs for NEON registers on the stack frame
+VLdr => {
+	op_flags  => [ "uses_memory" ],
+	state     => "exc_pinned",
+	ins       => [ "ptr", "mem" ],
+	outs      => [ "res", "M" ],
+	in_reqs   => [ "gp", "mem" ],
+	out_reqs  => [ "neon", "mem" ],
+	attr_type => "arm_load_store_attr_t",
+	attr      => "ir_mode *ls_mode, ir_entity *entity, int entity_sign, long offset, bool is_frame_entity",
+},
+
+VStr => {
+	op_flags  => [ "uses_memory" ],
+	state     => "exc_pinned",
+	ins       => [ "ptr", "val", "mem" ],
+	outs      => [ "M" ],
+	in_reqs   => [ "gp", "neon", "mem" ],
+	out_reqs  => [ "mem" ],
+	attr_type => "arm_load_store_attr_t",
+	attr      => "ir_mode *ls_mode, ir_entity *entity, int entity_sign, long offset, bool is_frame_entity",
+},
+
+# vector constants
+VConst => {
+	op_flags  => [ "constlike" ],
+	irn_flags => [ "rematerializable" ],
+	attr      => "ir_tarval *tv",
+	init      => "attr->tv = tv;",
+	out_reqs  => [ "neon" ],
+	attr_type => "arm_fConst_attr_t",
+},
+
 Return => {
 	state    => "pinned",
 	op_flags => [ "cfopcode" ],
@@ -617,6 +750,17 @@ Return => {
 	emit     => "bx lr",
 },
 
+# Call in tail position: "b entity" or "bx target" after the epilog
+TailCall => {
+	state     => "pinned",
+	op_flags  => [ "cfopcode" ],
+	in_reqs   => "...",
+	ins       => [ "mem", "sp", "target" ],
+	out_reqs  => [ "exec" ],
+	attr_type => "arm_Address_attr_t",
+	attr      => "ir_entity *entity, int offset",
+},
+
 AddS_t => {
 	ins       => [ "left", "right" ],
 	outs      => [ "res", "flags" ],
@@ -42,6 +42,7 @@ DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
 static const arch_register_t *sp_reg = &arm_registers[REG_SP];
 static be_stack_env_t         stack_env;
 static calling_convention_t  *cconv = NULL;
+static bool                   sibling_calls;
 
 static const arch_register_t *const callee_saves[] = {
 	&arm_registers[REG_R4],
@@ -72,6 +73,30 @@ static const arch_register_t *const caller_saves[] = {
 	&arm_registers[REG_F7],
 };
 
+/** callee saves which are only used if NEON is enabled */
+static const arch_register_t *const neon_callee_saves[] = {
+	&arm_registers[REG_Q4],
+	&arm_registers[REG_Q5],
+	&arm_registers[REG_Q6],
+	&arm_registers[REG_Q7],
+};
+
+/** caller saves which are only used if NEON is enabled */
+static const arch_register_t *const neon_caller_saves[] = {
+	&arm_registers[REG_Q0],
+	&arm_registers[REG_Q1],
+	&arm_registers[REG_Q2],
+	&arm_registers[REG_Q3],
+	&arm_registers[REG_Q8],
+	&arm_registers[REG_Q9],
+	&arm_registers[REG_Q10],
+	&arm_registers[REG_Q11],
+	&arm_registers[REG_Q12],
+	&arm_registers[REG_Q13],
+	&arm_registers[REG_Q14],
+	&arm_registers[REG_Q15],
+};
+
 static ir_node *get_initial_sp(ir_graph *const irg)
 {
 	return be_get_Start_proj(irg, &arm_registers[REG_SP]);
@@ -305,6 +330,16 @@ static bool try_encode_val_as_immediate(uint32_t val, arm_immediate_t *const res
 		res->rot   = 0;
 		return true;
 	}
+	if (arm_cg_config.thumb) {
+		/* Thumb-2 allows an 8bit value at any position which does not wrap
+		 * around (the replicated byte patterns are not used). */
+		unsigned const low_pos = ntz(val);
+		if (val >> low_pos > 0xff)
+			return false;
+		res->imm_8 = val >> low_pos;
+		res->rot   = 32 - low_pos;
+		return true;
+	}
 	/* arm allows to use to rotate an 8bit immediate value by a multiple of 2
 	   (= 0, 2, 4, 6, ...).
 	   So we determine the smallest even position with a bit set
@@ -425,7 +460,8 @@ static ir_node *gen_int_binop_ops(ir_node *node, ir_node *op1, ir_node *op2,
 		case ARM_SHF_LSL_REG:
 		case ARM_SHF_LSR_REG:
 		case ARM_SHF_ROR_REG:
-			if (factory->new_binop_reg_shift_reg) {
+			/* Thumb-2 has no register shifted register operands */
+			if (factory->new_binop_reg_shift_reg && !arm_cg_config.thumb) {
 				ir_node *mov_op  = get_irn_n(new_op2, n_arm_Mov_Rm);
 				ir_node *mov_sft = get_irn_n(new_op2, n_arm_Mov_Rs);
 				return factory->new_binop_reg_shift_reg(dbgi, block, new_op1, mov_op, mov_sft,
@@ -460,7 +496,7 @@ static ir_node *gen_int_binop_ops(ir_node *node, ir_node *op1, ir_node *op2,
 		case ARM_SHF_LSL_REG:
 		case ARM_SHF_LSR_REG:
 		case ARM_SHF_ROR_REG:
-			if (factory[idx].new_binop_reg_shift_reg) {
+			if (factory[idx].new_binop_reg_shift_reg && !arm_cg_config.thumb) {
 				ir_node *mov_op  = get_irn_n(new_op1, n_arm_Mov_Rm);
 				ir_node *mov_sft = get_irn_n(new_op1, n_arm_Mov_Rs);
 				return factory[idx].new_binop_reg_shift_reg(dbgi, block, new_op2, mov_op, mov_sft,
@@ -563,6 +599,46 @@ static ir_node *match_pkh(ir_node *node)
 	                         pkhbt_pkhtb_factory);
 }
 
+/**
+ * Returns the lane mode of the vector mode @p mode, which must fill a NEON
+ * q register.
+ */
+static ir_mode *get_neon_lane_mode(ir_mode *const mode)
+{
+	if (!arm_cg_config.neon)
+		panic("vector mode %+F needs NEON", mode);
+	ir_mode *const lane_mode = get_mode_vector_element_mode(mode);
+	if (get_mode_size_bits(mode) != 128
+	 || (mode_is_float(lane_mode) && get_mode_size_bits(lane_mode) != 32))
+		panic("vector mode %+F not supported", mode);
+	return lane_mode;
+}
+
+typedef ir_node *(*new_neon_binop_func)(dbg_info *dbgi, ir_node *block,
+                                        ir_node *left, ir_node *right,
+                                        ir_mode *op_mode);
+
+static ir_node *gen_neon_binop_ops(ir_node *const node, ir_node *const left,
+                                   ir_node *const right,
+                                   new_neon_binop_func const cons)
+{
+	dbg_info *const dbgi      = get_irn_dbg_info(node);
+	ir_node  *const block     = be_transform_nodes_block(node);
+	ir_mode  *const mode      = get_irn_mode(node);
+	ir_node  *const new_left  = be_transform_node(left);
+	ir_node  *const new_right = be_transform_node(right);
+	get_neon_lane_mode(mode);
+	return cons(dbgi, block, new_left, new_right, mode);
+}
+
+static ir_node *gen_neon_binop(ir_node *const node,
+                               new_neon_binop_func const cons)
+{
+	ir_node *const left  = get_binop_left(node);
+	ir_node *const right = get_binop_right(node);
+	return gen_neon_binop_ops(node, left, right, cons);
+}
+
 /**
  * Creates an ARM Add.
  *
@@ -570,6 +646,9 @@ static ir_node *match_pkh(ir_node *node)
  */
 static ir_node *gen_Add(ir_node *node)
 {
+	if (mode_is_vector(get_irn_mode(node)))
+		return gen_neon_binop(node, new_bd_arm_VAdd);
+
 	ir_node *rotl_left;
 	ir_node *rotl_right;
 	if (be_pattern_is_rotl(node, &rotl_left, &rotl_right)) {
@@ -697,6 +776,13 @@ static ir_node *gen_arm_AdC_t(ir_node *node)
  */
 static ir_node *gen_Mul(ir_node *node)
 {
+	ir_mode *const vmode = get_irn_mode(node);
+	if (mode_is_vector(vmode)) {
+		if (get_mode_size_bits(get_neon_lane_mode(vmode)) == 64)
+			panic("NEON multiplication of %+F not supported", vmode);
+		return gen_neon_binop(node, new_bd_arm_VMul);
+	}
+
 	ir_node  *block   = be_transform_nodes_block(node);
 	ir_node  *op1     = get_Mul_left(node);
 	ir_node  *new_op1 = be_transform_node(op1);
@@ -784,7 +870,15 @@ static ir_node *gen_And(ir_node *node)
 	arm_immediate_t imm;
 	ir_node *left  = get_And_left(node);
 	ir_node *right = get_And_right(node);
-	if (is_Not(right)) {
+	if (mode_is_vector(get_irn_mode(node))) {
+		if (is_Not(right))
+			return gen_neon_binop_ops(node, left, get_Not_op(right),
+			                          new_bd_arm_VBic);
+		if (is_Not(left))
+			return gen_neon_binop_ops(node, right, get_Not_op(left),
+			                          new_bd_arm_VBic);
+		return gen_neon_binop(node, new_bd_arm_VAnd);
+	} else if (is_Not(right)) {
 		ir_node *right_not = get_Not_op(right);
 		return gen_int_binop_ops(node, left, right_not, MATCH_SIZE_NEUTRAL,
 		                         &bic_factory);
@@ -805,6 +899,9 @@ static ir_node *gen_And(ir_node *node)
 
 static ir_node *gen_Or(ir_node *node)
 {
+	if (mode_is_vector(get_irn_mode(node)))
+		return gen_neon_binop(node, new_bd_arm_VOrr);
+
 	ir_node *rotl_left;
 	ir_node *rotl_right;
 	if (be_pattern_is_rotl(node, &rotl_left, &rotl_right)) {
@@ -846,6 +943,9 @@ static ir_node *gen_arm_OrPl_t(ir_node *node)
 
 static ir_node *gen_Eor(ir_node *node)
 {
+	if (mode_is_vector(get_irn_mode(node)))
+		return gen_neon_binop(node, new_bd_arm_VEor);
+
 	static const arm_binop_factory_t eor_factory = {
 		new_bd_arm_Eor_reg,
 		new_bd_arm_Eor_imm,
@@ -861,7 +961,9 @@ static ir_node *gen_Sub(ir_node *node)
 	ir_mode *mode  = get_irn_mode(node);
 	ir_node *left  = get_Sub_left(node);
 	ir_node *right = get_Sub_right(node);
-	if (mode_is_float(mode)) {
+	if (mode_is_vector(mode)) {
+		return gen_neon_binop(node, new_bd_arm_VSub);
+	} else if (mode_is_float(mode)) {
 		ir_node  *block     = be_transform_nodes_block(node);
 		ir_node  *new_left  = be_transform_node(left);
 		ir_node  *new_right = be_transform_node(right);
@@ -1040,6 +1142,12 @@ static ir_node *gen_Not(ir_node *node)
 	ir_node  *op     = get_Not_op(node);
 	ir_node  *new_op = be_transform_node(op);
 	dbg_info *dbgi   = get_irn_dbg_info(node);
+	ir_mode  *mode   = get_irn_mode(node);
+
+	if (mode_is_vector(mode)) {
+		get_neon_lane_mode(mode);
+		return new_bd_arm_VMvn(dbgi, block, new_op, mode);
+	}
 
 	/* check if we can fold in a Mov */
 	if (is_arm_Mov(new_op)) {
@@ -1060,6 +1168,9 @@ static ir_node *gen_Not(ir_node *node)
 		case ARM_SHF_LSL_REG:
 		case ARM_SHF_LSR_REG:
 		case ARM_SHF_ROR_REG: {
+			/* Thumb-2 has no register shifted register operands */
+			if (arm_cg_config.thumb)
+				break;
 			ir_node *mov_op  = get_irn_n(new_op, n_arm_Mov_Rm);
 			ir_node *mov_sft = get_irn_n(new_op, n_arm_Mov_Rs);
 			return new_bd_arm_Mvn_reg_shift_reg(dbgi, block, mov_op, mov_sft,
@@ -1085,7 +1196,15 @@ static ir_node *gen_Minus(ir_node *node)
 	dbg_info *dbgi   = get_irn_dbg_info(node);
 	ir_mode  *mode   = get_irn_mode(node);
 
-	if (mode_is_float(mode)) {
+	if (mode_is_vector(mode)) {
+		/* vneg has no 64bit lanes, subtract from zero instead */
+		if (get_mode_size_bits(get_neon_lane_mode(mode)) == 64) {
+			ir_node *const zero
+				= new_bd_arm_VConst(dbgi, block, get_mode_null(mode));
+			return new_bd_arm_VSub(dbgi, block, zero, new_op, mode);
+		}
+		return new_bd_arm_VNeg(dbgi, block, new_op, mode);
+	} else if (mode_is_float(mode)) {
 		if (arm_cg_config.fpu == ARM_FPU_FPA) {
 			return new_bd_arm_Mvf(dbgi, block, op, mode);
 		} else {
@@ -1109,7 +1228,10 @@ static ir_node *gen_Load(ir_node *node)
 		panic("unaligned Loads not supported yet");
 
 	ir_node *new_load;
-	if (mode_is_float(mode)) {
+	if (mode_is_vector(mode)) {
+		get_neon_lane_mode(mode);
+		new_load = new_bd_arm_VLd1(dbgi, block, new_ptr, new_mem);
+	} else if (mode_is_float(mode)) {
 		if (arm_cg_config.fpu == ARM_FPU_FPA) {
 			new_load = new_bd_arm_Ldf(dbgi, block, new_ptr, new_mem, mode,
 			                          NULL, 0, 0, false);
@@ -1141,7 +1263,10 @@ static ir_node *gen_Store(ir_node *node)
 		panic("unaligned Stores not supported yet");
 
 	ir_node *new_store;
-	if (mode_is_float(mode)) {
+	if (mode_is_vector(mode)) {
+		get_neon_lane_mode(mode);
+		new_store = new_bd_arm_VSt1(dbgi, block, new_ptr, new_val, new_mem);
+	} else if (mode_is_float(mode)) {
 		if (arm_cg_config.fpu == ARM_FPU_FPA) {
 			new_store = new_bd_arm_Stf(dbgi, block, new_ptr, new_val,
 			                           new_mem, mode, NULL, 0, 0, false);
@@ -1244,7 +1369,10 @@ static ir_node *gen_Const(ir_node *node)
 	ir_mode  *mode  = get_irn_mode(node);
 	dbg_info *dbg   = get_irn_dbg_info(node);
 
-	if (mode_is_float(mode)) {
+	if (mode_is_vector(mode)) {
+		get_neon_lane_mode(mode);
+		return new_bd_arm_VConst(dbg, block, get_Const_tarval(node));
+	} else if (mode_is_float(mode)) {
 		if (arm_cg_config.fpu == ARM_FPU_FPA) {
 			ir_tarval *tv = get_Const_tarval(node);
 			return new_bd_arm_fConst(dbg, block, tv);
@@ -1449,6 +1577,13 @@ static ir_node *gen_Proj_Load(ir_node *node)
 			return be_new_Proj(new_load, pn_arm_Ldf_M);
 		}
 		break;
+	case iro_arm_VLd1:
+		if (pn == pn_Load_res) {
+			return be_new_Proj(new_load, pn_arm_VLd1_res);
+		} else if (pn == pn_Load_M) {
+			return be_new_Proj(new_load, pn_arm_VLd1_M);
+		}
+		break;
 	default:
 		break;
 	}
@@ -1535,7 +1670,11 @@ static ir_node *gen_Proj_Proj_Start(ir_node *node)
 
 		ir_node *load;
 		ir_node *value;
-		if (mode_is_float(mode)) {
+		if (mode_is_vector(mode)) {
+			load  = new_bd_arm_VLdr(NULL, new_block, fp, mem, mode,
+			                        param->entity, 0, 0, true);
+			value = be_new_Proj(load, pn_arm_VLdr_res);
+		} else if (mode_is_float(mode)) {
 			load  = new_bd_arm_Ldf(NULL, new_block, fp, mem, mode,
 			                       param->entity, 0, 0, true);
 			value = be_new_Proj(load, pn_arm_Ldf_res);
@@ -1634,7 +1773,10 @@ static ir_node *gen_Unknown(ir_node *node)
 
 	/* just produce a 0 */
 	ir_mode *mode = get_irn_mode(node);
-	if (mode_is_float(mode)) {
+	if (mode_is_vector(mode)) {
+		get_neon_lane_mode(mode);
+		return new_bd_arm_VConst(dbgi, new_block, get_mode_null(mode));
+	} else if (mode_is_float(mode)) {
 		ir_tarval *tv     = get_mode_null(mode);
 		ir_node   *fconst = new_bd_arm_fConst(dbgi, new_block, tv);
 		return fconst;
@@ -1720,6 +1862,11 @@ static ir_node *gen_Start(ir_node *node)
 	for (size_t i = 0; i < ARRAY_SIZE(callee_saves); ++i) {
 		outs[callee_saves[i]->global_index] = BE_START_REG;
 	}
+	if (arm_cg_config.neon) {
+		for (size_t i = 0; i < ARRAY_SIZE(neon_callee_saves); ++i) {
+			outs[neon_callee_saves[i]->global_index] = BE_START_REG;
+		}
+	}
 
 	ir_graph *const irg = get_irn_irg(node);
 	return be_new_Start(irg, outs);
@@ -1728,18 +1875,125 @@ static ir_node *gen_Start(ir_node *node)
 /**
  * transform a Return node into epilogue code + return statement
  */
+/**
+ * Turns a Call whose results are returned unchanged into a branch after the
+ * epilog.  Only callees taking all their parameters in registers are handled.
+ */
+static ir_node *gen_sibling_call(ir_node *const node, ir_node *const call)
+{
+	ir_type              *const type       = get_Call_type(call);
+	calling_convention_t *const call_cconv = arm_decide_calling_convention(NULL, type);
+	ir_node                    *res        = NULL;
+	if (call_cconv->param_stack_size != 0)
+		goto out;
+	/* With the last argument register in use, no register is left over for
+	 * an indirect target. */
+	if (!is_Address(get_Call_ptr(call))) {
+		arch_register_t const *const r3 = &arm_registers[REG_R3];
+		for (size_t i = 0, n = call_cconv->n_parameters; i < n; ++i) {
+			if (call_cconv->parameters[i].reg0 == r3
+			 || call_cconv->parameters[i].reg1 == r3)
+				goto out;
+		}
+	}
+	for (size_t i = 0, n = get_Return_n_ress(node); i < n; ++i) {
+		if (call_cconv->results[i].reg0 != cconv->results[i].reg0
+		 || call_cconv->results[i].reg1 != cconv->results[i].reg1)
+			goto out;
+	}
+
+	ir_graph *const irg            = get_irn_irg(node);
+	ir_node  *const new_block      = be_transform_nodes_block(call);
+	dbg_info *const dbgi           = get_irn_dbg_info(call);
+	size_t    const n_params       = get_Call_n_params(call);
+	unsigned  const n_callee_saves = ARRAY_SIZE(callee_saves);
+	unsigned  const n_neon_saves   = arm_cg_config.neon ? ARRAY_SIZE(neon_callee_saves) : 0;
+	/* memory, stack, target, register arguments, callee saves */
+	size_t    const max_inputs     = 3 + call_cconv->n_param_regs + n_callee_saves + n_neon_saves;
+
+	ir_node                   **const in   = ALLOCAN(ir_node*, max_inputs);
+	arch_register_req_t const **const reqs = be_allocate_in_reqs(irg, max_inputs);
+	size_t                            p    = n_arm_TailCall_target;
+
+	in[n_arm_TailCall_mem]   = be_transform_node(get_Call_mem(call));
+	reqs[n_arm_TailCall_mem] = arch_memory_req;
+	in[n_arm_TailCall_sp]    = get_initial_sp(irg);
+	reqs[n_arm_TailCall_sp]  = sp_reg->single_req;
+
+	/* The epilog only restores the stack pointer, so the target may live in
+	 * any register not holding an argument or a callee save. */
+	ir_node   *const callee = get_Call_ptr(call);
+	ir_entity *const entity = is_Address(callee) ? get_Address_entity(callee) : NULL;
+	if (entity == NULL) {
+		in[p]   = be_transform_node(callee);
+		reqs[p] = arm_reg_classes[CLASS_arm_gp].class_req;
+		++p;
+	}
+
+	for (size_t i = 0; i < n_params; ++i) {
+		ir_node                  *new_value  = be_transform_node(get_Call_param(call, i));
+		ir_node                  *new_value1 = NULL;
+		reg_or_stackslot_t const *param      = &call_cconv->parameters[i];
+		ir_mode                  *mode       = get_type_mode(get_method_param_type(type, i));
+		if (mode_is_float(mode)) {
+			if (get_mode_size_bits(mode) == 64) {
+				double_to_ints(dbgi, new_block, new_value, &new_value,
+				               &new_value1);
+			} else {
+				new_value = float_to_int(dbgi, new_block, new_value);
+			}
+		}
+		in[p]   = new_value;
+		reqs[p] = param->reg0->single_req;
+		++p;
+		if (new_value1 != NULL) {
+			in[p]   = new_value1;
+			reqs[p] = param->reg1->single_req;
+			++p;
+		}
+	}
+
+	for (unsigned i = 0; i < n_callee_saves; ++i) {
+		arch_register_t const *const reg = callee_saves[i];
+		in[p]   = be_get_Start_proj(irg, reg);
+		reqs[p] = reg->single_req;
+		++p;
+	}
+	for (unsigned i = 0; i < n_neon_saves; ++i) {
+		arch_register_t const *const reg = neon_callee_saves[i];
+		in[p]   = be_get_Start_proj(irg, reg);
+		reqs[p] = reg->single_req;
+		++p;
+	}
+	assert(p <= max_inputs);
+
+	res = new_bd_arm_TailCall(dbgi, new_block, p, in, reqs, entity, 0);
+	be_stack_record_chain(&stack_env, res, n_arm_TailCall_sp, NULL);
+out:
+	arm_free_calling_convention(call_cconv);
+	return res;
+}
+
 static ir_node *gen_Return(ir_node *node)
 {
+	ir_node *const call = sibling_calls ? be_get_sibling_call(node) : NULL;
+	if (call != NULL) {
+		ir_node *const tail_call = gen_sibling_call(node, call);
+		if (tail_call != NULL)
+			return tail_call;
+	}
+
 	ir_node        *new_block      = be_transform_nodes_block(node);
 	dbg_info       *dbgi           = get_irn_dbg_info(node);
 	ir_node        *mem            = get_Return_mem(node);
 	ir_node        *new_mem        = be_transform_node(mem);
 	unsigned        n_callee_saves = ARRAY_SIZE(callee_saves);
+	unsigned        n_neon_saves   = arm_cg_config.neon ? ARRAY_SIZE(neon_callee_saves) : 0;
 	unsigned        n_res          = get_Return_n_ress(node);
 	ir_graph       *irg            = get_irn_irg(node);
 
 	unsigned       p     = n_arm_Return_first_result;
-	unsigned const n_ins = p + n_res + n_callee_saves;
+	unsigned const n_ins = p + n_res + n_callee_saves + n_neon_saves;
 
 	arch_register_req_t const **const reqs = be_allocate_in_reqs(irg, n_ins);
 	ir_node **in = ALLOCAN(ir_node*, n_ins);
@@ -1768,6 +2022,12 @@ static ir_node *gen_Return(ir_node *node)
 		reqs[p] = reg->single_req;
 		++p;
 	}
+	for (unsigned i = 0; i < n_neon_saves; ++i) {
+		arch_register_t const *const reg = neon_callee_saves[i];
+		in[p]   = be_get_Start_proj(irg, reg);
+		reqs[p] = reg->single_req;
+		++p;
+	}
 	assert(p == n_ins);
 
 	ir_node *const ret = new_bd_arm_Return(dbgi, new_block, n_ins, in, reqs);
@@ -1795,6 +2055,7 @@ static ir_node *gen_Call(ir_node *node)
 	size_t                in_arity       = 0;
 	size_t                sync_arity     = 0;
 	size_t const          n_caller_saves = ARRAY_SIZE(caller_saves);
+	size_t const          n_neon_saves   = arm_cg_config.neon ? ARRAY_SIZE(neon_caller_saves) : 0;
 	ir_entity            *entity         = NULL;
 
 	assert(n_params == cconv->n_parameters);
@@ -1853,7 +2114,9 @@ static ir_node *gen_Call(ir_node *node)
 		}
 
 		/* create a parameter frame if necessary */
-		ir_node *const str = mode_is_float(mode) ?
+		ir_node *const str = mode_is_vector(mode) ?
+			new_bd_arm_VStr(dbgi, new_block, callframe, new_value, new_mem, mode, NULL, 0, param->offset, true) :
+			mode_is_float(mode) ?
 			new_bd_arm_Stf(dbgi, new_block, callframe, new_value, new_mem, mode, NULL, 0, param->offset, true) :
 			new_bd_arm_Str(dbgi, new_block, callframe, new_value, new_mem, mode, NULL, 0, param->offset, true);
 		sync_ins[sync_arity++] = str;
@@ -1881,7 +2144,8 @@ static ir_node *gen_Call(ir_node *node)
 	assert(in_arity <= max_inputs);
 
 	/* Count outputs. */
-	unsigned const out_arity = pn_arm_Bl_first_result + n_caller_saves;
+	unsigned const out_arity
+		= pn_arm_Bl_first_result + n_caller_saves + n_neon_saves;
 
 	ir_node *res;
 	if (entity != NULL) {
@@ -1904,6 +2168,10 @@ static ir_node *gen_Call(ir_node *node)
 		const arch_register_t *reg = caller_saves[o];
 		arch_set_irn_register_req_out(res, pn_arm_Bl_first_result + o, reg->single_req);
 	}
+	for (size_t o = 0; o < n_neon_saves; ++o) {
+		const arch_register_t *reg = neon_caller_saves[o];
+		arch_set_irn_register_req_out(res, pn_arm_Bl_first_result + n_caller_saves + o, reg->single_req);
+	}
 
 	/* copy pinned attribute */
 	set_irn_pinned(res, get_irn_pinned(node));
@@ -1941,6 +2209,8 @@ static ir_node *gen_Phi(ir_node *node)
 		assert(get_mode_size_bits(mode) <= 32);
 		/* all integer operations are on 32bit registers now */
 		req  = arm_reg_classes[CLASS_arm_gp].class_req;
+	} else if (mode_is_vector(mode)) {
+		req = arm_reg_classes[CLASS_arm_neon].class_req;
 	} else {
 		req = arch_memory_req;
 	}
@@ -2051,6 +2321,7 @@ void arm_transform_graph(ir_graph *irg)
 	cconv = arm_decide_calling_convention(irg, get_entity_type(entity));
 	create_stacklayout(irg);
 	be_add_parameter_entity_stores(irg);
+	sibling_calls = be_sibling_calls_possible(irg);
 
 	be_transform_graph(irg, NULL);
 
@@ -32,6 +32,7 @@
 #include "lower_calls.h"
 #include "lower_softfloat.h"
 #include "lowering.h"
+#include "panic.h"
 #include "util.h"
 
 #define ARM_MODULO_SHIFT 256
@@ -41,6 +42,7 @@ arm_codegen_config_t arm_cg_config;
 
 ir_mode *arm_mode_gp;
 ir_mode *arm_mode_flags;
+ir_mode *arm_mode_neon;
 
 /**
  * Transforms the standard Firm graph into an ARM firm graph.
@@ -60,15 +62,29 @@ static void arm_select_instructions(ir_graph *irg)
 	place_code(irg);
 }
 
+static bool is_neon_value(ir_node const *const value)
+{
+	return arch_get_irn_register_req(value)->cls
+	    == &arm_reg_classes[CLASS_arm_neon];
+}
+
 static ir_node *arm_new_reload(ir_node *value, ir_node *spill, ir_node *before)
 {
 	ir_node  *block  = get_block(before);
 	ir_graph *irg    = get_irn_irg(before);
 	ir_node  *frame  = get_irg_frame(irg);
 	ir_mode  *mode   = get_irn_mode(value);
-	ir_node  *load   = new_bd_arm_Ldr(NULL, block, frame, spill, mode, NULL,
-	                                  false, 0, true);
-	ir_node  *proj   = be_new_Proj(load, pn_arm_Ldr_res);
+	ir_node  *load;
+	ir_node  *proj;
+	if (is_neon_value(value)) {
+		load = new_bd_arm_VLdr(NULL, block, frame, spill, mode, NULL, false,
+		                       0, true);
+		proj = be_new_Proj(load, pn_arm_VLdr_res);
+	} else {
+		load = new_bd_arm_Ldr(NULL, block, frame, spill, mode, NULL, false,
+		                      0, true);
+		proj = be_new_Proj(load, pn_arm_Ldr_res);
+	}
 	arch_add_irn_flags(load, arch_irn_flag_reload);
 	sched_add_before(before, load);
 	return proj;
@@ -81,8 +97,11 @@ static ir_node *arm_new_spill(ir_node *value, ir_node *after)
 	ir_node  *frame  = get_irg_frame(irg);
 	ir_node  *mem    = get_irg_no_mem(irg);
 	ir_mode  *mode   = get_irn_mode(value);
-	ir_node  *store  = new_bd_arm_Str(NULL, block, frame, value, mem, mode,
-	                                  NULL, false, 0, true);
+	ir_node  *store  = is_neon_value(value)
+		? new_bd_arm_VStr(NULL, block, frame, value, mem, mode, NULL, false, 0,
+		                  true)
+		: new_bd_arm_Str(NULL, block, frame, value, mem, mode, NULL, false, 0,
+		                 true);
 	arch_add_irn_flags(store, arch_irn_flag_spill);
 	sched_add_after(after, store);
 	return store;
@@ -230,7 +249,7 @@ static void arm_lower_for_target(void)
 		be_after_transform(irg, "lower-copyb");
 	}
 	if (arm_cg_config.fpu == ARM_FPU_SOFTFLOAT) {
-		lower_floating_point();
+		lower_floating_point(arm_cg_config.softfloat_fast_paths);
 		be_after_irp_transform("lower-fp");
 	}
 
@@ -266,6 +285,8 @@ static backend_params arm_backend_params = {
 	.modulo_shift                  = ARM_MODULO_SHIFT,
 	.dep_param                     = &arm_arch_dep,
 	.allow_ifconv                  = arm_is_mux_allowed,
+	.branch_mispredict_penalty     = 8,
+	.mux_latency                   = 1,
 	.machine_size                  = ARM_MACHINE_SIZE,
 	.mode_float_arithmetic         = NULL,
 	.type_long_long                = NULL,
@@ -277,6 +298,8 @@ static backend_params arm_backend_params = {
 		.va_list_type = NULL,
 		.lower_va_arg = NULL,
 	},
+	.n_int_registers               = 12,
+	.n_float_registers             = 16,
 };
 
 static void arm_init_backend_params(void)
@@ -294,6 +317,16 @@ static void arm_init(void)
 	arm_mode_gp    = new_int_mode("arm_gp", irma_twos_complement,
 	                              ARM_MACHINE_SIZE, 0, ARM_MODULO_SHIFT);
 	arm_mode_flags = new_non_arithmetic_mode("arm_flags", 32);
+	arm_mode_neon  = new_non_arithmetic_mode("arm_neon", 128);
+
+	if (arm_cg_config.thumb) {
+		if (arm_cg_config.variant < ARM_VARIANT_6T2)
+			panic("Thumb-2 code needs at least armv6t2");
+		if (arm_cg_config.fpu == ARM_FPU_FPA)
+			panic("FPA instructions are not available in Thumb-2 code");
+	}
+	if (arm_cg_config.neon && arm_cg_config.variant < ARM_VARIANT_7)
+		panic("NEON needs at least armv7");
 
 	set_modeP(new_reference_mode("p32", irma_twos_complement, ARM_MACHINE_SIZE, ARM_MODULO_SHIFT));
 
@@ -352,6 +385,9 @@ static lc_opt_enum_int_var_t arch_var = {
 static const lc_opt_table_entry_t arm_options[] = {
 	LC_OPT_ENT_ENUM_INT("fpu", "select the floating point unit", &arch_fpu_var),
 	LC_OPT_ENT_ENUM_INT("arch", "select architecture variant", &arch_var),
+	LC_OPT_ENT_BOOL("thumb", "generate Thumb-2 code", &arm_cg_config.thumb),
+	LC_OPT_ENT_BOOL("neon", "use NEON instructions for vector modes", &arm_cg_config.neon),
+	LC_OPT_ENT_BOOL("softfloat-fast", "inline the common cases of soft float operations", &arm_cg_config.softfloat_fast_paths),
 	LC_OPT_LAST
 };
 
@@ -361,6 +397,7 @@ static void arm_init_architecture(void)
 	arm_cg_config.variant    = ARM_VARIANT_6T2;
 	arm_cg_config.fpu        = ARM_FPU_SOFTFLOAT;
 	arm_cg_config.big_endian = false;
+	arm_cg_config.softfloat_fast_paths = true;
 
 	lc_opt_entry_t *be_grp  = lc_opt_get_grp(firm_opt_get_root(), "be");
 	lc_opt_entry_t *arm_grp = lc_opt_get_grp(be_grp, "arm");
@@ -43,12 +43,16 @@ typedef struct arm_codegen_config_t {
 	arm_variant_t     variant;
 	arm_fpu_variant_t fpu;
 	bool              big_endian;
+	bool              thumb;      /**< generate Thumb-2 code */
+	bool              neon;       /**< use NEON for vector modes */
+	bool              softfloat_fast_paths; /**< inline common soft float cases */
 } arm_codegen_config_t;
 
 extern arm_codegen_config_t arm_cg_config;
 
 extern ir_mode *arm_mode_gp;
 extern ir_mode *arm_mode_flags;
+extern ir_mode *arm_mode_neon;
 
 static inline arm_irg_data_t *arm_get_irg_data(ir_graph const *const irg)
 {
@@ -46,12 +46,23 @@ struct be_options_t {
 	bool timing;               /**< time the backend phases */
 	bool opt_profile_generate; /**< instrument code for profiling */
 	bool opt_profile_use;      /**< use existing profile data */
+	unsigned profile_counters; /**< an ir_profile_counters_t */
+	bool opt_profile_calls;    /**< profile and promote indirect calls */
+	char profile_samples[128]; /**< file of a sampled profile to use */
 	bool omit_fp;              /**< try to omit the frame pointer */
 	bool exceptions;           /**< enable exception handling */
 	bool do_verify;            /**< backend verify option */
+	int verify_sample;         /**< cheaply verify one in n blocks if
+	                                do_verify is off, 0 for never */
+	bool verify_liveness;      /**< check incrementally updated liveness */
 	char ilp_solver[128];      /**< the ilp solver name */
+	char time_trace[128];      /**< file for the pass profile trace */
 	bool verbose_asm;          /**< dump verbose assembler */
 	bool mark_spill_reload;    /**< mark spills and reloads */
+	bool split_cold;           /**< move cold blocks to a separate section */
+	bool sibling_calls;        /**< turn calls in tail position into jumps */
+	bool shrink_wrap;          /**< set up the stack frame only where needed */
+	bool release_graphs;       /**< free the nodes of emitted graphs */
 	be_pic_style_t pic_style;
 };
 extern be_options_t be_options;
@@ -77,6 +88,12 @@ unsigned be_get_n_allocatable_regs(const ir_graph *irg,
 
 void be_after_irp_transform(const char *name);
 
+/**
+ * Returns the arguments accepted by be_parse_arg() so far, each terminated by
+ * a newline.
+ */
+char const *be_get_parsed_args(void);
+
 void be_check_verify_result(bool fine, ir_graph *irg);
 
 /**
@@ -116,9 +133,13 @@ typedef enum {
 ENUM_COUNTABLE(be_timer_id_t)
 extern ir_timer_t *be_timers[T_LAST+1];
 
+const char *be_get_timer_name(be_timer_id_t id);
+
 static inline void be_timer_push(be_timer_id_t id)
 {
 	assert(id <= T_LAST);
+	if (ir_timing_is_enabled())
+		ir_timing_scope_push(be_get_timer_name(id), NULL);
 	if (!be_timing)
 		return;
 	ir_timer_push(be_timers[id]);
@@ -127,6 +148,8 @@ static inline void be_timer_push(be_timer_id_t id)
 static inline void be_timer_pop(be_timer_id_t id)
 {
 	assert(id <= T_LAST);
+	if (ir_timing_is_enabled())
+		ir_timing_scope_pop(be_get_timer_name(id));
 	if (!be_timing)
 		return;
 	ir_timer_pop(be_timers[id]);
@@ -12,6 +12,7 @@
 #define FIRM_BE_BEARCH_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "firm_types.h"
 #include "jit.h"
@@ -293,6 +294,24 @@ struct arch_isa_if_t {
 
 	void (*emit_function)(char *buffer, ir_jit_function_t *function);
 
+	/**
+	 * Encodes a relocation of jit code to @p entity plus @p offset into
+	 * @p buffer and returns its size, used to patch installed code.
+	 */
+	unsigned (*emit_jit_relocation)(char *buffer, uint8_t be_kind,
+	                                ir_entity *entity, int32_t offset);
+
+	/**
+	 * Sets up per-program state for the functions compiled in a jit
+	 * session, may be NULL.
+	 */
+	void (*begin_jit_session)(void);
+
+	/**
+	 * Frees the state set up by begin_jit_session, may be NULL.
+	 */
+	void (*end_jit_session)(void);
+
 	/**
 	 * lowers current program for target. See the documentation for
 	 * be_lower_for_target() for details.
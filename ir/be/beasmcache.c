@@ -0,0 +1,475 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Persistent cache of the assembler code of functions.
+ *
+ * A function is looked up by the structural fingerprint of its graph, see
+ * be_fingerprint_graph(), and the code emitted for it is spliced into the
+ * output instead of running the backend.  The private labels of the cached
+ * code are renamed when it is spliced, so they cannot clash with the labels
+ * of other functions.  Therefore the code of a function is only cached if it
+ * is self-contained: functions referencing private entities or labeled
+ * blocks, and functions whose code refers to globals created during code
+ * generation, e.g. floating point constants, are always compiled.
+ *
+ * The file has the same structure as the jit cache: a header and the libFirm
+ * revision followed by the entries, each made of the key and the code.  The
+ * whole file is written anew when the compilation unit is finished.
+ */
+#include "beasmcache.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "be_t.h"
+#include "bedwarf.h"
+#include "beelf.h"
+#include "beemitter.h"
+#include "befingerprint.h"
+#include "begnuas.h"
+#include "bemodule.h"
+#include "debug.h"
+#include "entity_t.h"
+#include "hashptr.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "irprog.h"
+#include "irtools.h"
+#include "lc_opts.h"
+#include "obst.h"
+#include "set.h"
+#include "typerep.h"
+#include "util.h"
+
+#define CACHE_MAGIC   "FIRMASMC"
+#define CACHE_VERSION 1
+
+/** Header of the cache file, followed by the libFirm revision and the
+ * entries. */
+typedef struct cache_header_t {
+	char     magic[8];
+	uint32_t version;
+	uint32_t n_entries;
+	uint32_t revision_size; /**< including the terminating zero and padding */
+} cache_header_t;
+
+/** Header of a cache entry, followed by the key and the code. */
+typedef struct cache_entry_header_t {
+	uint32_t key_size;
+	uint32_t code_size;
+} cache_entry_header_t;
+
+typedef struct cache_entry_t {
+	char const *key;
+	uint32_t    key_size;
+	char const *code;
+	uint32_t    code_size;
+} cache_entry_t;
+
+/** Global types receiving entities during code generation. */
+typedef struct tracked_type_t {
+	ir_type *type;
+	size_t   n_members; /**< members already added to created_names */
+} tracked_type_t;
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
+
+static char cache_filename[128];
+
+static bool            cache_open;
+static char const     *mapping;      /**< contents of the cache file */
+static size_t          mapping_size;
+static set            *entries;
+static bool            entries_added;
+static struct obstack  entries_obst; /**< holds the added entries */
+static unsigned        n_spliced;
+
+static tracked_type_t  tracked[IR_SEGMENT_LAST + 3];
+static size_t          n_tracked;
+/** Linker names of the globals created during code generation. */
+static set            *created_names;
+
+static struct obstack  capture_obst;
+static ir_graph       *capture_irg;
+static char const     *capture_key;
+static uint32_t        capture_key_size;
+
+static size_t pad4(size_t const size)
+{
+	return (size + 3) & ~(size_t)3;
+}
+
+static int cmp_cache_entry(void const *const elt, void const *const key,
+                           size_t const size)
+{
+	(void)size;
+	cache_entry_t const *const e0 = (cache_entry_t const*)elt;
+	cache_entry_t const *const e1 = (cache_entry_t const*)key;
+	return e0->key_size != e1->key_size
+	    || memcmp(e0->key, e1->key, e0->key_size) != 0;
+}
+
+static int cmp_name(void const *const elt, void const *const key,
+                    size_t const size)
+{
+	(void)size;
+	return strcmp((char const*)elt, (char const*)key);
+}
+
+static unsigned hash_key(char const *const key, uint32_t const key_size)
+{
+	return hash_data((unsigned char const*)key, key_size);
+}
+
+static void add_entry(char const *const key, uint32_t const key_size,
+                      char const *const code, uint32_t const code_size)
+{
+	cache_entry_t const entry = {
+		.key       = key,
+		.key_size  = key_size,
+		.code      = code,
+		.code_size = code_size,
+	};
+	(void)set_insert(cache_entry_t, entries, &entry, sizeof(entry),
+	                 hash_key(key, key_size));
+}
+
+/** Adds the entries of the mapped cache file, stops at the first damaged
+ * entry. */
+static void read_cache_file(void)
+{
+	char   const *const data = mapping;
+	size_t        const size = mapping_size;
+	if (size < sizeof(cache_header_t))
+		return;
+	cache_header_t const *const header = (cache_header_t const*)data;
+	if (memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0
+	 || header->version != CACHE_VERSION)
+		return;
+
+	/* code of other libFirm revisions is never used again */
+	char   const *const revision      = ir_get_version_revision();
+	size_t        const revision_size = pad4(strlen(revision) + 1);
+	if (header->revision_size != revision_size
+	 || size - sizeof(*header) < revision_size
+	 || strcmp(data + sizeof(*header), revision) != 0)
+		return;
+
+	size_t pos = sizeof(*header) + revision_size;
+	for (uint32_t n = 0; n < header->n_entries; ++n) {
+		if (size - pos < sizeof(cache_entry_header_t))
+			break;
+		cache_entry_header_t const *const entry
+			= (cache_entry_header_t const*)(data + pos);
+		if (entry->key_size > size || entry->code_size > size)
+			break;
+		size_t const entry_size = sizeof(*entry) + pad4(entry->key_size)
+		                        + pad4(entry->code_size);
+		if (size - pos < entry_size)
+			break;
+		char const *const key = (char const*)(entry + 1);
+		add_entry(key, entry->key_size, key + pad4(entry->key_size),
+		          entry->code_size);
+		pos += entry_size;
+	}
+}
+
+static void write_padded(FILE *const out, void const *const data,
+                         size_t const size)
+{
+	static char const zeros[3];
+	fwrite(data, 1, size, out);
+	fwrite(zeros, 1, pad4(size) - size, out);
+}
+
+static void write_cache_file(void)
+{
+	size_t const len      = strlen(cache_filename);
+	char  *const tmp_name = XMALLOCN(char, len + 5);
+	memcpy(tmp_name, cache_filename, len);
+	memcpy(tmp_name + len, ".tmp", 5);
+
+	FILE *const out = fopen(tmp_name, "wb");
+	if (out != NULL) {
+		char const *const revision = ir_get_version_revision();
+		cache_header_t header = {
+			.version       = CACHE_VERSION,
+			.n_entries     = set_count(entries),
+			.revision_size = pad4(strlen(revision) + 1),
+		};
+		memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+		fwrite(&header, 1, sizeof(header), out);
+		write_padded(out, revision, strlen(revision) + 1);
+		foreach_set(entries, cache_entry_t, entry) {
+			cache_entry_header_t const entry_header = {
+				.key_size  = entry->key_size,
+				.code_size = entry->code_size,
+			};
+			fwrite(&entry_header, 1, sizeof(entry_header), out);
+			write_padded(out, entry->key, entry->key_size);
+			write_padded(out, entry->code, entry->code_size);
+		}
+		/* replace the file atomically, so concurrent readers only see
+		 * complete caches */
+		bool const failed = ferror(out);
+		if (fclose(out) != 0 || failed || rename(tmp_name, cache_filename) != 0)
+			remove(tmp_name);
+	}
+	xfree(tmp_name);
+}
+
+static void track_type(ir_type *const type)
+{
+	assert(n_tracked < ARRAY_SIZE(tracked));
+	tracked[n_tracked++] = (tracked_type_t) {
+		.type      = type,
+		.n_members = get_compound_n_members(type),
+	};
+}
+
+void be_asm_cache_begin(be_main_env_t const *const env)
+{
+	/* debug info and profile based placement are not part of the key */
+	if (cache_filename[0] == '\0' || be_elf_is_selected()
+	 || be_dwarf_has_function_info() || be_options.opt_profile_use)
+		return;
+
+	cache_open    = true;
+	entries       = new_set(cmp_cache_entry, 16);
+	entries_added = false;
+	created_names = new_set(cmp_name, 16);
+	n_spliced     = 0;
+	n_tracked     = 0;
+	obstack_init(&entries_obst);
+	obstack_init(&capture_obst);
+	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+		track_type(get_segment_type(s));
+	}
+	track_type(env->pic_trampolines_type);
+	track_type(env->pic_symbols_type);
+
+	mapping      = NULL;
+	mapping_size = 0;
+	int const fd = open(cache_filename, O_RDONLY);
+	if (fd < 0)
+		return;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		void *const data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd,
+		                        0);
+		if (data != MAP_FAILED) {
+			mapping      = (char const*)data;
+			mapping_size = st.st_size;
+			read_cache_file();
+		}
+	}
+	close(fd);
+}
+
+static void check_node(ir_node *const node, void *const data)
+{
+	bool *const cacheable = (bool*)data;
+	ir_entity const *entity;
+	if (is_Address(node)) {
+		entity = get_Address_entity(node);
+	} else if (is_Offset(node)) {
+		entity = get_Offset_entity(node);
+	} else if (is_Block(node)) {
+		/* the label may be referenced by other functions */
+		if (get_Block_entity(node) != NULL)
+			*cacheable = false;
+		return;
+	} else {
+		return;
+	}
+	/* private entities are emitted with private labels, which are renamed */
+	if (get_entity_visibility(entity) == ir_visibility_private)
+		*cacheable = false;
+}
+
+static bool is_label_char(char const c)
+{
+	return isalnum((unsigned char)c) || c == '_' || c == '.' || c == '$';
+}
+
+/**
+ * Emits @p code, moving its private labels to a namespace of their own.
+ */
+static void splice_code(char const *const code, size_t const size)
+{
+	char   const *const prefix     = be_gas_get_private_prefix();
+	size_t        const prefix_len = strlen(prefix);
+	char   const *const end        = code + size;
+	char   const *      copied     = code;
+	++n_spliced;
+	for (char const *p = code; (size_t)(end - p) > prefix_len; ++p) {
+		if ((p != code && is_label_char(p[-1]))
+		 || memcmp(p, prefix, prefix_len) != 0
+		 || !is_label_char(p[prefix_len]))
+			continue;
+		p += prefix_len;
+		be_emit_string_len(copied, p - copied);
+		be_emit_irprintf("c%u.", n_spliced);
+		copied = p;
+	}
+	be_emit_string_len(copied, end - copied);
+	be_emit_write_line();
+}
+
+bool be_asm_cache_emit_function(ir_graph *const irg)
+{
+	if (!cache_open)
+		return false;
+	assert(capture_irg == NULL);
+
+	bool cacheable = true;
+	irg_walk_graph(irg, NULL, check_node, &cacheable);
+	if (!cacheable || !be_fingerprint_graph(&capture_obst, irg)) {
+		obstack_free(&capture_obst, obstack_finish(&capture_obst));
+		return false;
+	}
+
+	uint32_t      const key_size = obstack_object_size(&capture_obst);
+	char   const *const key      = (char const*)obstack_finish(&capture_obst);
+	cache_entry_t const templ    = { .key = key, .key_size = key_size };
+	cache_entry_t const *const found = set_find(cache_entry_t, entries, &templ,
+		sizeof(templ), hash_key(key, key_size));
+	if (found != NULL) {
+		DB((dbg, LEVEL_1, "using cached code for %+F\n", irg));
+		obstack_free(&capture_obst, (void*)key);
+		/* the cached code starts and ends with an unknown section */
+		be_gas_forget_section();
+		splice_code(found->code, found->code_size);
+		be_gas_forget_section();
+		return true;
+	}
+
+	capture_irg      = irg;
+	capture_key      = key;
+	capture_key_size = key_size;
+	be_gas_forget_section();
+	be_emit_begin_capture(&capture_obst);
+	return false;
+}
+
+/** Adds the linker names of the globals created since the last call to
+ * created_names. */
+static void collect_created_names(void)
+{
+	for (size_t i = 0; i < n_tracked; ++i) {
+		tracked_type_t *const t = &tracked[i];
+		size_t          const n = get_compound_n_members(t->type);
+		for (size_t m = t->n_members; m < n; ++m) {
+			ir_entity  *const member = get_compound_member(t->type, m);
+			char const *const name   = get_entity_ld_name(member);
+			(void)set_insert(char, created_names, name, strlen(name) + 1,
+			                 hash_str(name));
+		}
+		t->n_members = n;
+	}
+}
+
+/** Checks whether @p code mentions a global created during code
+ * generation. */
+static bool mentions_created_global(char const *const code, size_t const size)
+{
+	if (set_count(created_names) == 0)
+		return false;
+
+	char   const *const prefix     = be_gas_get_private_prefix();
+	size_t        const prefix_len = strlen(prefix);
+	char   const *const end        = code + size;
+	for (char const *p = code; p != end;) {
+		if (!is_label_char(*p)) {
+			++p;
+			continue;
+		}
+		char const *const begin = p;
+		while (p != end && is_label_char(*p))
+			++p;
+		size_t const len  = p - begin;
+		char  *const name = (char*)obstack_copy0(&capture_obst, begin, len);
+		bool found = set_find(char, created_names, name, len + 1,
+		                      hash_str(name)) != NULL;
+		if (!found && len > prefix_len
+		 && memcmp(name, prefix, prefix_len) == 0) {
+			char const *const unprefixed = name + prefix_len;
+			found = set_find(char, created_names, unprefixed,
+			                 len - prefix_len + 1, hash_str(unprefixed)) != NULL;
+		}
+		obstack_free(&capture_obst, name);
+		if (found)
+			return true;
+	}
+	return false;
+}
+
+void be_asm_cache_end_function(ir_graph *const irg)
+{
+	if (capture_irg == NULL)
+		return;
+	assert(capture_irg == irg);
+	(void)irg;
+
+	be_emit_end_capture();
+	be_gas_forget_section();
+	capture_irg = NULL;
+
+	uint32_t const code_size = obstack_object_size(&capture_obst);
+	char    *const code      = (char*)obstack_finish(&capture_obst);
+	collect_created_names();
+	if (mentions_created_global(code, code_size)) {
+		DB((dbg, LEVEL_1, "not caching %+F, it uses globals created by the backend\n",
+		    irg));
+	} else {
+		DB((dbg, LEVEL_1, "caching code for %+F\n", irg));
+		char const *const key
+			= (char const*)obstack_copy(&entries_obst, capture_key,
+			                            capture_key_size);
+		char const *const copy
+			= (char const*)obstack_copy(&entries_obst, code, code_size);
+		add_entry(key, capture_key_size, copy, code_size);
+		entries_added = true;
+	}
+	obstack_free(&capture_obst, (void*)capture_key);
+}
+
+void be_asm_cache_finish(void)
+{
+	if (!cache_open)
+		return;
+	assert(capture_irg == NULL);
+
+	if (entries_added)
+		write_cache_file();
+	if (mapping != NULL)
+		munmap((void*)mapping, mapping_size);
+	del_set(created_names);
+	del_set(entries);
+	obstack_free(&capture_obst, NULL);
+	obstack_free(&entries_obst, NULL);
+	cache_open = false;
+}
+
+static const lc_opt_table_entry_t be_asm_cache_options[] = {
+	LC_OPT_ENT_STR("asmcache", "reuse the assembler code of unchanged functions from the file", &cache_filename),
+	LC_OPT_LAST
+};
+
+BE_REGISTER_MODULE_CONSTRUCTOR(be_init_asmcache)
+void be_init_asmcache(void)
+{
+	lc_opt_entry_t *be_grp = lc_opt_get_grp(firm_opt_get_root(), "be");
+	lc_opt_add_table(be_grp, be_asm_cache_options);
+
+	FIRM_DBG_REGISTER(dbg, "firm.be.asmcache");
+}
@@ -0,0 +1,42 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Persistent cache of the assembler code of functions.
+ */
+#ifndef FIRM_BE_BEASMCACHE_H
+#define FIRM_BE_BEASMCACHE_H
+
+#include <stdbool.h>
+
+#include "be_types.h"
+#include "firm_types.h"
+
+/**
+ * Opens the cache selected with the asmcache option, if any.  Must be called
+ * after the assembler output of the compilation unit has begun.
+ */
+void be_asm_cache_begin(be_main_env_t const *env);
+
+/**
+ * Looks up the code of @p irg in the cache.  Emits the cached code and
+ * returns true if it is found, otherwise starts collecting the code emitted
+ * for @p irg until be_asm_cache_end_function().
+ */
+bool be_asm_cache_emit_function(ir_graph *irg);
+
+/**
+ * Adds the code emitted for @p irg since be_asm_cache_emit_function() to the
+ * cache.
+ */
+void be_asm_cache_end_function(ir_graph *irg);
+
+/**
+ * Writes the cache file, if functions were added, and closes the cache.
+ */
+void be_asm_cache_finish(void);
+
+#endif
@@ -18,6 +18,12 @@
  * to change as many edges to fallthroughs as possible, this is done by setting
  * a next and prev pointers on blocks. The greedy algorithm sorts the edges by
  * execution frequencies and tries to transform them to fallthroughs in this order
+ *
+ * The Ext-TSP algorithm (Newell and Pupyrev, "Improved Basic Block Reordering")
+ * additionally rewards short forward and backward jumps. It starts with one
+ * chain per block and repeatedly applies the merge of two chains with the
+ * highest increase of the Ext-TSP score, also trying to split one chain and
+ * insert the other one in between.
  */
 #include "beblocksched.h"
 
@@ -42,9 +48,37 @@
 #include "besched.h"
 #include "be.h"
 #include "panic.h"
+#include "lc_opts.h"
+#include "lc_opts_enum.h"
+
+/** Blocks executed less often than this fraction of the function entry are
+ * moved out of the hot part of the function. */
+#define COLD_BLOCK_FREQ_RATIO 0.001
 
 DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
 
+typedef enum blocksched_algo_t {
+	BLOCKSCHED_GREEDY,
+	BLOCKSCHED_EXTTSP,
+} blocksched_algo_t;
+
+static int algo = BLOCKSCHED_GREEDY;
+
+static const lc_opt_enum_int_items_t blockschedalgo_items[] = {
+	{ "greedy", BLOCKSCHED_GREEDY },
+	{ "exttsp", BLOCKSCHED_EXTTSP },
+	{ NULL,     0 }
+};
+
+static lc_opt_enum_int_var_t algo_var = {
+	&algo, blockschedalgo_items
+};
+
+static const lc_opt_table_entry_t be_blocksched_options[] = {
+	LC_OPT_ENT_ENUM_INT("blockscheduler", "the block scheduling algorithm", &algo_var),
+	LC_OPT_LAST
+};
+
 static bool blocks_removed;
 
 /**
@@ -558,6 +592,460 @@ static ir_node **create_blocksched_array(blocksched_env_t *const env)
 	return block_list;
 }
 
+/* Parameters of the Ext-TSP score, distances are in bytes. */
+#define EXTTSP_FORWARD_WEIGHT    0.1
+#define EXTTSP_BACKWARD_WEIGHT   0.1
+#define EXTTSP_FORWARD_DISTANCE  1024
+#define EXTTSP_BACKWARD_DISTANCE 640
+/** Chains longer than this are not split when merging. */
+#define EXTTSP_SPLIT_THRESHOLD   128
+/** Estimated size of an instruction in bytes. */
+#define EXTTSP_INSN_SIZE         4
+#define EXTTSP_EPSILON           1e-9
+
+typedef struct tsp_chain_t tsp_chain_t;
+
+typedef struct tsp_block_t {
+	ir_node     *block;
+	unsigned     size;   /**< estimated code size in bytes */
+	unsigned     offset; /**< offset in the layout currently evaluated */
+	tsp_chain_t *chain;  /**< chain containing the block */
+} tsp_block_t;
+
+typedef struct tsp_edge_t {
+	unsigned src;  /**< index of the source block */
+	unsigned dst;  /**< index of the target block */
+	double   freq; /**< execution frequency of the edge */
+} tsp_edge_t;
+
+/** Ways to merge chain X with chain Y, X is split into X1 and X2. */
+typedef enum merge_kind_t {
+	MERGE_X_Y,
+	MERGE_Y_X,
+	MERGE_X1_Y_X2,
+	MERGE_Y_X2_X1,
+	MERGE_X2_X1_Y,
+} merge_kind_t;
+
+typedef struct tsp_merge_t {
+	double       gain;  /**< increase of the score */
+	merge_kind_t kind;
+	size_t       split; /**< number of blocks in X1 */
+} tsp_merge_t;
+
+typedef struct tsp_adjacent_t {
+	tsp_chain_t *chain; /**< the adjacent chain Y */
+	unsigned    *edges; /**< edges between both chains */
+	tsp_merge_t  merge; /**< best merge of both chains */
+	bool         valid; /**< merge is up to date */
+} tsp_adjacent_t;
+
+struct tsp_chain_t {
+	unsigned       *blocks; /**< blocks in layout order, NULL if merged */
+	unsigned       *edges;  /**< edges inside the chain */
+	tsp_adjacent_t *adj;    /**< chains connected to this chain */
+	double          score;  /**< Ext-TSP score of the chain */
+	double          freq;   /**< sum of execution frequency times size */
+	unsigned        size;   /**< code size of the chain */
+	unsigned        id;
+};
+
+typedef struct tsp_env_t {
+	tsp_block_t *blocks;
+	tsp_edge_t  *edges;
+	tsp_chain_t *chains;
+	unsigned     entry; /**< index of the start block */
+} tsp_env_t;
+
+typedef struct tsp_slice_t {
+	const unsigned *blocks;
+	size_t          n;
+} tsp_slice_t;
+
+static tsp_block_t *get_tsp_block(const ir_node *block)
+{
+	return (tsp_block_t*)get_irn_link(block);
+}
+
+static unsigned estimate_block_size(ir_node *block)
+{
+	unsigned n_insns = 0;
+	sched_foreach(block, node) {
+		if (!is_Phi(node))
+			++n_insns;
+	}
+	return MAX(n_insns, 1) * EXTTSP_INSN_SIZE;
+}
+
+static double edge_score(const tsp_env_t *env, const tsp_edge_t *edge)
+{
+	const tsp_block_t *src     = &env->blocks[edge->src];
+	const tsp_block_t *dst     = &env->blocks[edge->dst];
+	unsigned    const  src_end = src->offset + src->size;
+	if (dst->offset == src_end)
+		return edge->freq;
+
+	if (dst->offset > src_end) {
+		unsigned const dist = dst->offset - src_end;
+		if (dist < EXTTSP_FORWARD_DISTANCE) {
+			return edge->freq * EXTTSP_FORWARD_WEIGHT
+			     * (1.0 - (double)dist / EXTTSP_FORWARD_DISTANCE);
+		}
+	} else {
+		unsigned const dist = src_end - dst->offset;
+		if (dist < EXTTSP_BACKWARD_DISTANCE) {
+			return edge->freq * EXTTSP_BACKWARD_WEIGHT
+			     * (1.0 - (double)dist / EXTTSP_BACKWARD_DISTANCE);
+		}
+	}
+	return 0.0;
+}
+
+static double edges_score(const tsp_env_t *env, const unsigned *edges)
+{
+	double score = 0.0;
+	for (size_t i = 0, n = ARR_LEN(edges); i < n; ++i) {
+		score += edge_score(env, &env->edges[edges[i]]);
+	}
+	return score;
+}
+
+/**
+ * Computes the score of the layout given by @p slices, which contain the
+ * blocks of chains @p x and @p y connected by @p edges.
+ */
+static double layout_score(tsp_env_t *env, const tsp_slice_t *slices,
+                           size_t n_slices, const tsp_chain_t *x,
+                           const tsp_chain_t *y, const unsigned *edges)
+{
+	/* the start block must stay in front */
+	if (slices[0].blocks[0] != env->entry
+	    && (env->blocks[env->entry].chain == x
+	        || env->blocks[env->entry].chain == y))
+		return -1.0;
+
+	unsigned offset = 0;
+	for (size_t s = 0; s < n_slices; ++s) {
+		for (size_t i = 0; i < slices[s].n; ++i) {
+			tsp_block_t *block = &env->blocks[slices[s].blocks[i]];
+			block->offset = offset;
+			offset       += block->size;
+		}
+	}
+	return edges_score(env, x->edges) + edges_score(env, y->edges)
+	     + edges_score(env, edges);
+}
+
+static size_t get_merge_slices(tsp_slice_t *slices, const tsp_chain_t *x,
+                               const tsp_chain_t *y, const tsp_merge_t *merge)
+{
+	tsp_slice_t const sx  = { x->blocks, ARR_LEN(x->blocks) };
+	tsp_slice_t const sy  = { y->blocks, ARR_LEN(y->blocks) };
+	tsp_slice_t const sx1 = { x->blocks, merge->split };
+	tsp_slice_t const sx2 = { x->blocks + merge->split, sx.n - merge->split };
+	switch (merge->kind) {
+	case MERGE_X_Y:
+		slices[0] = sx;  slices[1] = sy;
+		return 2;
+	case MERGE_Y_X:
+		slices[0] = sy;  slices[1] = sx;
+		return 2;
+	case MERGE_X1_Y_X2:
+		slices[0] = sx1; slices[1] = sy;  slices[2] = sx2;
+		return 3;
+	case MERGE_Y_X2_X1:
+		slices[0] = sy;  slices[1] = sx2; slices[2] = sx1;
+		return 3;
+	case MERGE_X2_X1_Y:
+		slices[0] = sx2; slices[1] = sx1; slices[2] = sy;
+		return 3;
+	}
+	panic("invalid merge kind");
+}
+
+static void try_merge(tsp_env_t *env, tsp_chain_t *x, tsp_adjacent_t *adj,
+                      merge_kind_t kind, size_t split)
+{
+	tsp_chain_t *y      = adj->chain;
+	tsp_merge_t  merge  = { 0.0, kind, split };
+	tsp_slice_t  slices[3];
+	size_t const n      = get_merge_slices(slices, x, y, &merge);
+	double const score  = layout_score(env, slices, n, x, y, adj->edges);
+	if (score < 0.0)
+		return;
+	merge.gain = score - x->score - y->score;
+	if (merge.gain > adj->merge.gain + EXTTSP_EPSILON)
+		adj->merge = merge;
+}
+
+/** Determines the best merge of @p x with the adjacent chain of @p adj. */
+static void compute_merge(tsp_env_t *env, tsp_chain_t *x, tsp_adjacent_t *adj)
+{
+	adj->merge.gain = -1.0;
+	try_merge(env, x, adj, MERGE_X_Y, 0);
+	try_merge(env, x, adj, MERGE_Y_X, 0);
+
+	size_t const n_blocks = ARR_LEN(x->blocks);
+	if (n_blocks <= EXTTSP_SPLIT_THRESHOLD) {
+		for (size_t split = 1; split < n_blocks; ++split) {
+			try_merge(env, x, adj, MERGE_X1_Y_X2, split);
+			try_merge(env, x, adj, MERGE_Y_X2_X1, split);
+			try_merge(env, x, adj, MERGE_X2_X1_Y, split);
+		}
+	}
+	adj->valid = true;
+}
+
+static tsp_adjacent_t *find_adjacent(tsp_chain_t *chain,
+                                     const tsp_chain_t *other)
+{
+	for (size_t i = 0, n = ARR_LEN(chain->adj); i < n; ++i) {
+		if (chain->adj[i].chain == other)
+			return &chain->adj[i];
+	}
+	return NULL;
+}
+
+static void remove_adjacent(tsp_chain_t *chain, tsp_adjacent_t *adj)
+{
+	DEL_ARR_F(adj->edges);
+	size_t const n = ARR_LEN(chain->adj);
+	*adj = chain->adj[n - 1];
+	ARR_SHRINKLEN(chain->adj, n - 1);
+}
+
+static void append_edges(unsigned **dest, const unsigned *edges)
+{
+	for (size_t i = 0, n = ARR_LEN(edges); i < n; ++i) {
+		ARR_APP1(unsigned, *dest, edges[i]);
+	}
+}
+
+static void add_edge_between(tsp_chain_t *chain, tsp_chain_t *other,
+                             unsigned edge)
+{
+	tsp_adjacent_t *adj = find_adjacent(chain, other);
+	if (adj == NULL) {
+		tsp_adjacent_t const new_adj = {
+			other, NEW_ARR_F(unsigned, 0), { -1.0, MERGE_X_Y, 0 }, false
+		};
+		ARR_APP1(tsp_adjacent_t, chain->adj, new_adj);
+		adj = &chain->adj[ARR_LEN(chain->adj) - 1];
+	}
+	ARR_APP1(unsigned, adj->edges, edge);
+}
+
+/** Merges chain @p y into chain @p x. */
+static void merge_chains(tsp_env_t *env, tsp_chain_t *x, tsp_chain_t *y,
+                         const tsp_merge_t *merge)
+{
+	DB((dbg, LEVEL_2, "Merge chains %u and %u (kind %d, split %zu, gain %.3g)\n",
+	    x->id, y->id, (int)merge->kind, merge->split, merge->gain));
+
+	tsp_slice_t slices[3];
+	size_t const n_slices = get_merge_slices(slices, x, y, merge);
+	unsigned    *blocks   = NEW_ARR_F(unsigned, 0);
+	for (size_t s = 0; s < n_slices; ++s) {
+		for (size_t i = 0; i < slices[s].n; ++i) {
+			ARR_APP1(unsigned, blocks, slices[s].blocks[i]);
+		}
+	}
+	for (size_t i = 0, n = ARR_LEN(y->blocks); i < n; ++i) {
+		env->blocks[y->blocks[i]].chain = x;
+	}
+	DEL_ARR_F(x->blocks);
+	DEL_ARR_F(y->blocks);
+	x->blocks = blocks;
+	y->blocks = NULL;
+
+	tsp_adjacent_t *xy = find_adjacent(x, y);
+	append_edges(&x->edges, y->edges);
+	append_edges(&x->edges, xy->edges);
+	DEL_ARR_F(y->edges);
+	x->score += y->score + merge->gain;
+	x->freq  += y->freq;
+	x->size  += y->size;
+	remove_adjacent(x, xy);
+	remove_adjacent(y, find_adjacent(y, x));
+
+	/* move the adjacent chains of y over to x */
+	for (size_t i = 0, n = ARR_LEN(y->adj); i < n; ++i) {
+		tsp_adjacent_t *adj   = &y->adj[i];
+		tsp_chain_t    *other = adj->chain;
+		for (size_t e = 0, n_edges = ARR_LEN(adj->edges); e < n_edges; ++e) {
+			add_edge_between(x, other, adj->edges[e]);
+			add_edge_between(other, x, adj->edges[e]);
+		}
+		remove_adjacent(other, find_adjacent(other, y));
+		DEL_ARR_F(adj->edges);
+	}
+	DEL_ARR_F(y->adj);
+
+	/* all merges involving x have changed */
+	for (size_t i = 0, n = ARR_LEN(x->adj); i < n; ++i) {
+		tsp_adjacent_t *adj = &x->adj[i];
+		adj->valid = false;
+		find_adjacent(adj->chain, x)->valid = false;
+	}
+}
+
+static int cmp_chain_density(const void *d1, const void *d2)
+{
+	const tsp_chain_t *c1       = *(const tsp_chain_t**)d1;
+	const tsp_chain_t *c2       = *(const tsp_chain_t**)d2;
+	double      const  density1 = c1->freq / c1->size;
+	double      const  density2 = c2->freq / c2->size;
+	if (density1 > density2)
+		return -1;
+	if (density1 < density2)
+		return 1;
+	return (c1->id > c2->id) - (c1->id < c2->id);
+}
+
+/**
+ * Computes a block schedule with the Ext-TSP algorithm from the edges
+ * collected in @p env.
+ */
+static ir_node **create_exttsp_block_schedule(blocksched_env_t *const env)
+{
+	ir_graph    *irg    = env->irg;
+	ir_node     *start  = get_irg_start_block(irg);
+	tsp_env_t    tsp;
+	tsp.blocks = NEW_ARR_F(tsp_block_t, 0);
+	tsp.edges  = NEW_ARR_F(tsp_edge_t, 0);
+	tsp.entry  = 0;
+
+	/* collect the blocks reachable from the start block */
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_VISITED);
+	inc_irg_visited(irg);
+	mark_irn_visited(start);
+	ir_node **stack = NEW_ARR_F(ir_node*, 1);
+	stack[0] = start;
+	while (ARR_LEN(stack) > 0) {
+		ir_node *block = stack[ARR_LEN(stack) - 1];
+		ARR_SHRINKLEN(stack, ARR_LEN(stack) - 1);
+		tsp_block_t const tsp_block = {
+			block, estimate_block_size(block), 0, NULL
+		};
+		ARR_APP1(tsp_block_t, tsp.blocks, tsp_block);
+		foreach_block_succ(block, edge) {
+			ir_node *succ_block = get_edge_src_irn(edge);
+			if (!irn_visited_else_mark(succ_block))
+				ARR_APP1(ir_node*, stack, succ_block);
+		}
+	}
+	DEL_ARR_F(stack);
+
+	size_t const n_blocks = ARR_LEN(tsp.blocks);
+	env->blockcount = n_blocks;
+	tsp.chains = OALLOCN(&env->obst, tsp_chain_t, n_blocks);
+	for (size_t i = 0; i < n_blocks; ++i) {
+		tsp_block_t *block = &tsp.blocks[i];
+		tsp_chain_t *chain = &tsp.chains[i];
+		chain->blocks = NEW_ARR_F(unsigned, 1);
+		chain->blocks[0] = i;
+		chain->edges  = NEW_ARR_F(unsigned, 0);
+		chain->adj    = NEW_ARR_F(tsp_adjacent_t, 0);
+		chain->score  = 0.0;
+		chain->freq   = get_block_execfreq(block->block) * block->size;
+		chain->size   = block->size;
+		chain->id     = i;
+		block->chain  = chain;
+		set_irn_link(block->block, block);
+	}
+
+	/* the edges are still valid for blocks which were not removed */
+	for (size_t i = 0, n = ARR_LEN(env->edges); i < n; ++i) {
+		const edge_t *edge = &env->edges[i];
+		if (is_Bad(get_Block_cfgpred(edge->block, edge->pos)))
+			continue;
+		ir_node *pred_block = get_Block_cfgpred_block(edge->block, edge->pos);
+		if (!irn_visited(pred_block) || !irn_visited(edge->block))
+			continue;
+		tsp_block_t *src   = get_tsp_block(pred_block);
+		tsp_block_t *dst   = get_tsp_block(edge->block);
+		unsigned     index = ARR_LEN(tsp.edges);
+		tsp_edge_t const tsp_edge = {
+			src - tsp.blocks, dst - tsp.blocks, edge->execfreq
+		};
+		ARR_APP1(tsp_edge_t, tsp.edges, tsp_edge);
+		if (src == dst) {
+			ARR_APP1(unsigned, src->chain->edges, index);
+		} else {
+			add_edge_between(src->chain, dst->chain, index);
+			add_edge_between(dst->chain, src->chain, index);
+		}
+	}
+	ir_free_resources(irg, IR_RESOURCE_IRN_VISITED);
+
+	for (size_t i = 0; i < n_blocks; ++i) {
+		tsp_chain_t *chain = &tsp.chains[i];
+		tsp.blocks[i].offset = 0;
+		chain->score = edges_score(&tsp, chain->edges);
+	}
+
+	/* greedily apply the best merge */
+	for (;;) {
+		tsp_chain_t    *best_chain = NULL;
+		tsp_adjacent_t *best       = NULL;
+		for (size_t i = 0; i < n_blocks; ++i) {
+			tsp_chain_t *chain = &tsp.chains[i];
+			if (chain->blocks == NULL)
+				continue;
+			for (size_t a = 0, n = ARR_LEN(chain->adj); a < n; ++a) {
+				tsp_adjacent_t *adj = &chain->adj[a];
+				if (!adj->valid)
+					compute_merge(&tsp, chain, adj);
+				if (adj->merge.gain > EXTTSP_EPSILON
+				    && (best == NULL || adj->merge.gain > best->merge.gain)) {
+					best_chain = chain;
+					best       = adj;
+				}
+			}
+		}
+		if (best == NULL)
+			break;
+		tsp_merge_t const merge = best->merge;
+		merge_chains(&tsp, best_chain, best->chain, &merge);
+	}
+
+	/* the start chain comes first, the others are sorted by density */
+	tsp_chain_t **chains = NEW_ARR_F(tsp_chain_t*, 0);
+	for (size_t i = 0; i < n_blocks; ++i) {
+		tsp_chain_t *chain = &tsp.chains[i];
+		if (chain->blocks != NULL && chain != tsp.blocks[tsp.entry].chain)
+			ARR_APP1(tsp_chain_t*, chains, chain);
+	}
+	QSORT_ARR(chains, cmp_chain_density);
+
+	DB((dbg, LEVEL_1, "Blockschedule:\n"));
+	struct obstack *const obst       = be_get_be_obst(irg);
+	ir_node       **const block_list = NEW_ARR_D(ir_node*, obst, n_blocks);
+	size_t                n          = 0;
+	for (size_t c = 0, n_chains = ARR_LEN(chains); c <= n_chains; ++c) {
+		tsp_chain_t *chain = c == 0 ? tsp.blocks[tsp.entry].chain
+		                            : chains[c - 1];
+		for (size_t i = 0, n_chain = ARR_LEN(chain->blocks); i < n_chain; ++i) {
+			ir_node *block = tsp.blocks[chain->blocks[i]].block;
+			block_list[n++] = block;
+			DB((dbg, LEVEL_1, "\t%+F\n", block));
+		}
+		DEL_ARR_F(chain->blocks);
+		DEL_ARR_F(chain->edges);
+		for (size_t a = 0, n_adj = ARR_LEN(chain->adj); a < n_adj; ++a) {
+			DEL_ARR_F(chain->adj[a].edges);
+		}
+		DEL_ARR_F(chain->adj);
+	}
+	assert(n == n_blocks);
+	assert(block_list[0] == start);
+
+	DEL_ARR_F(chains);
+	DEL_ARR_F(tsp.edges);
+	DEL_ARR_F(tsp.blocks);
+	return block_list;
+}
+
 ir_node **be_create_block_schedule(ir_graph *irg)
 {
 	blocksched_env_t env;
@@ -575,9 +1063,13 @@ ir_node **be_create_block_schedule(ir_graph *irg)
 
 	remove_empty_blocks(irg);
 
-	coalesce_blocks(&env);
-
-	ir_node **const block_list = create_blocksched_array(&env);
+	ir_node **block_list;
+	if (algo == BLOCKSCHED_EXTTSP) {
+		block_list = create_exttsp_block_schedule(&env);
+	} else {
+		coalesce_blocks(&env);
+		block_list = create_blocksched_array(&env);
+	}
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
 
 	DEL_ARR_F(env.edges);
@@ -586,8 +1078,38 @@ ir_node **be_create_block_schedule(ir_graph *irg)
 	return block_list;
 }
 
+size_t be_split_cold_blocks(ir_node **const block_schedule)
+{
+	size_t const n_blocks   = ARR_LEN(block_schedule);
+	ir_node     *start      = block_schedule[0];
+	double const start_freq = get_block_execfreq(start);
+	if (!(start_freq > 0.0))
+		return n_blocks;
+
+	ir_node  *const end_block = get_irg_end_block(get_irn_irg(start));
+	double    const threshold = start_freq * COLD_BLOCK_FREQ_RATIO;
+	ir_node       **cold      = NEW_ARR_F(ir_node*, 0);
+	size_t          n_hot     = 0;
+	for (size_t i = 0; i < n_blocks; ++i) {
+		ir_node *const block = block_schedule[i];
+		if (block != start && block != end_block
+		 && get_block_execfreq(block) < threshold) {
+			DB((dbg, LEVEL_1, "cold: %+F\n", block));
+			ARR_APP1(ir_node*, cold, block);
+		} else {
+			block_schedule[n_hot++] = block;
+		}
+	}
+	MEMCPY(&block_schedule[n_hot], cold, ARR_LEN(cold));
+	DEL_ARR_F(cold);
+	return n_hot;
+}
+
 BE_REGISTER_MODULE_CONSTRUCTOR(be_init_blocksched)
 void be_init_blocksched(void)
 {
+	lc_opt_entry_t *be_grp = lc_opt_get_grp(firm_opt_get_root(), "be");
+	lc_opt_add_table(be_grp, be_blocksched_options);
+
 	FIRM_DBG_REGISTER(dbg, "firm.be.blocksched");
 }
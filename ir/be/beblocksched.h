@@ -12,8 +12,19 @@
 #ifndef FIRM_BE_BEBLOCKSCHED_H
 #define FIRM_BE_BEBLOCKSCHED_H
 
+#include <stddef.h>
+
 #include "firm_types.h"
 
 ir_node **be_create_block_schedule(ir_graph *irg);
 
+/**
+ * Moves the rarely executed blocks of a block schedule to its end, keeping
+ * the relative order of the hot and the cold blocks.
+ *
+ * @return the index of the first cold block, the length of the schedule if
+ *         there is none
+ */
+size_t be_split_cold_blocks(ir_node **block_schedule);
+
 #endif
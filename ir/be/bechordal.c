@@ -31,9 +31,11 @@
 
 DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
 
-static int get_next_free_reg(bitset_t *const available)
+static unsigned get_next_free_reg(unsigned const *const available)
 {
-	return bitset_next_set(available, 0);
+	size_t const col = rbitset_next(available, 0, true);
+	assert(col != (size_t)-1 && "no register left (node not register pressure faithful?)");
+	return col;
 }
 
 static unsigned const *get_decisive_partner_regs(be_operand_t const *const o1, size_t const n_regs)
@@ -322,23 +324,24 @@ static void constraints(ir_node *const bl, void *const data)
 
 static void assign(ir_node *const block, void *const env_ptr)
 {
-	be_chordal_env_t *const env  = (be_chordal_env_t*)env_ptr;
-	struct list_head *const head = get_block_border_head(env, block);
+	be_chordal_env_t      *const env     = (be_chordal_env_t*)env_ptr;
+	block_borders_t const *const borders = get_block_borders(env, block);
 
 	DBG((dbg, LEVEL_4, "Assigning colors for block %+F\n", block));
 	DBG((dbg, LEVEL_4, "\tusedef chain for block\n"));
-	foreach_border_head(head, b) {
+	foreach_border(borders, b) {
 		DBG((dbg, LEVEL_4, "\t%s %+F/%d\n", b->is_def ? "def" : "use",
 					b->irn, get_irn_idx(b->irn)));
 	}
 
-	bitset_t *const available = bitset_alloca(env->allocatable_regs->size);
-	bitset_copy(available, env->allocatable_regs);
+	size_t    const n_regs    = env->allocatable_regs->size;
+	unsigned *const available = rbitset_alloca(n_regs);
+	rbitset_copy(available, env->allocatable_regs->data, n_regs);
 
 	/* Mind that the sequence of defs from back to front defines a perfect
 	 * elimination order. So, coloring the definitions from first to last
 	 * will work. */
-	foreach_border_head(head, b) {
+	foreach_border(borders, b) {
 		ir_node *const irn = b->irn;
 
 		/* Assign a color, if it is a local def. Global defs already have a
@@ -347,7 +350,7 @@ static void assign(ir_node *const block, void *const env_ptr)
 			/* Make the color available upon a use. */
 			arch_register_t const *const reg = arch_get_irn_register(irn);
 			assert(reg && "Register must have been assigned");
-			bitset_set(available, reg->index);
+			rbitset_set(available, reg->index);
 		} else {
 			arch_register_t const *reg = arch_get_irn_register(irn);
 			/* All live-ins must have a register assigned. (The dominators were
@@ -357,20 +360,27 @@ static void assign(ir_node *const block, void *const env_ptr)
 			if (reg) {
 				DBG((dbg, LEVEL_4, "%+F has reg %s\n", irn, reg->name));
 				col = reg->index;
-				assert(bitset_is_set(available, col) && "pre-colored register must be free");
+				assert(rbitset_is_set(available, col) && "pre-colored register must be free");
 			} else {
 				assert(!arch_irn_is_ignore(irn));
 				col = get_next_free_reg(available);
 				reg = arch_register_for_index(env->cls, col);
 				arch_set_irn_register(irn, reg);
 			}
-			bitset_clear(available, col);
+			rbitset_clear(available, col);
 
 			DBG((dbg, LEVEL_1, "\tassigning register %s(%d) to %+F\n", reg->name, col, irn));
 		}
 	}
 }
 
+void be_chordal_handle_constraints(be_chordal_env_t *const env)
+{
+	be_timer_push(T_CONSTR);
+	dom_tree_walk_irg(env->irg, constraints, NULL, env);
+	be_timer_pop(T_CONSTR);
+}
+
 static void be_ra_chordal_color(be_chordal_env_t *const chordal_env)
 {
 	ir_graph *const irg = chordal_env->irg;
@@ -378,9 +388,7 @@ static void be_ra_chordal_color(be_chordal_env_t *const chordal_env)
 	be_assure_live_sets(irg);
 
 	/* Handle register targeting constraints */
-	be_timer_push(T_CONSTR);
-	dom_tree_walk_irg(irg, constraints, NULL, chordal_env);
-	be_timer_pop(T_CONSTR);
+	be_chordal_handle_constraints(chordal_env);
 
 	be_chordal_dump(BE_CH_DUMP_CONSTR, irg, chordal_env->cls, "constr");
 
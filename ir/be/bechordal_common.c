@@ -28,39 +28,39 @@
 
 DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
 
-static inline border_t *border_add(be_chordal_env_t *const env, struct list_head *const head, ir_node *const irn, unsigned const step, unsigned const is_def, unsigned const is_real)
+/**
+ * Appends a border to the borders of the current block, which are grown on
+ * the obstack of @p env.
+ */
+static inline void border_add(be_chordal_env_t *const env, ir_node *const irn, unsigned const step, unsigned const is_def, unsigned const is_real)
 {
-	border_t *const b = OALLOC(&env->obst, border_t);
-	b->is_def  = is_def;
-	b->is_real = is_real;
-	b->irn     = irn;
-	b->step    = step;
-	list_add_tail(&b->list, head);
+	border_t const b = {
+		.irn     = irn,
+		.step    = step,
+		.is_def  = is_def,
+		.is_real = is_real,
+	};
+	obstack_grow(&env->obst, &b, sizeof(b));
 	DBG((dbg, LEVEL_5, "\t\t%s adding %+F, step: %d\n", is_def ? "def" : "use", irn, step));
-
-	return b;
 }
 
 void create_borders(ir_node *block, void *env_ptr)
 {
 /* Convenience macro for a def */
 #define border_def(irn, step, real) \
-	border_add(env, head, irn, step, 1, real)
+	border_add(env, irn, step, 1, real)
 
 /* Convenience macro for a use */
 #define border_use(irn, step, real) \
-	border_add(env, head, irn, step, 0, real)
+	border_add(env, irn, step, 0, real)
 
 	be_chordal_env_t *const env = (be_chordal_env_t*)env_ptr;
 
 	unsigned step = 0;
-	struct list_head *head;
 
-	/* Set up the border list in the block info */
-	head = OALLOC(&env->obst, struct list_head);
-	INIT_LIST_HEAD(head);
-	assert(pmap_get(struct list_head, env->border_heads, block) == NULL);
-	pmap_insert(env->border_heads, block, head);
+	/* The borders are grown in one object behind their header. */
+	assert(obstack_object_size(&env->obst) == 0);
+	obstack_blank(&env->obst, offsetof(block_borders_t, borders));
 
 	ir_nodeset_t live;
 	ir_nodeset_init(&live);
@@ -118,6 +118,20 @@ void create_borders(ir_node *block, void *env_ptr)
 	}
 
 	ir_nodeset_destroy(&live);
+
+	/* The borders were created from the end of the block to its beginning,
+	 * store them in schedule order. */
+	size_t           const n       = (obstack_object_size(&env->obst) - offsetof(block_borders_t, borders)) / sizeof(border_t);
+	block_borders_t *const borders = (block_borders_t*)obstack_finish(&env->obst);
+	borders->n_borders = n;
+	for (size_t i = 0; i < n / 2; ++i) {
+		border_t const tmp = borders->borders[i];
+		borders->borders[i]         = borders->borders[n - 1 - i];
+		borders->borders[n - 1 - i] = tmp;
+	}
+
+	assert(pmap_get(block_borders_t, env->block_borders, block) == NULL);
+	pmap_insert(env->block_borders, block, borders);
 }
 
 ir_node *pre_process_constraints(be_chordal_env_t *env, be_insn_t **the_insn)
@@ -32,4 +32,12 @@ void create_borders(ir_node *block, void *env_ptr);
  */
 ir_node *pre_process_constraints(be_chordal_env_t *_env, be_insn_t **the_insn);
 
+/**
+ * Handle the register constraints of all nodes: Perms are inserted in front
+ * of constrained nodes and the constrained values are precolored.
+ * Needs consistent dominance and liveness information.
+ * @param env The chordal environment.
+ */
+void be_chordal_handle_constraints(be_chordal_env_t *env);
+
 #endif
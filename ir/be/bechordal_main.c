@@ -59,6 +59,7 @@
 static be_ra_chordal_opts_t options = {
 	BE_CH_DUMP_NONE,
 	BE_CH_LOWER_PERM_SWAP,
+	false,
 };
 
 static const lc_opt_enum_int_items_t lower_perm_items[] = {
@@ -90,6 +91,7 @@ static lc_opt_enum_mask_var_t dump_var = {
 static const lc_opt_table_entry_t be_chordal_options[] = {
 	LC_OPT_ENT_ENUM_INT ("perm",          "perm lowering options", &lower_perm_var),
 	LC_OPT_ENT_ENUM_MASK("dump",          "select dump phases", &dump_var),
+	LC_OPT_ENT_BOOL     ("materialize_ifg", "compute the interference graph once instead of per query", &options.materialize_ifg),
 	LC_OPT_LAST
 };
 
@@ -162,7 +164,7 @@ static void pre_spill(be_chordal_env_t *const chordal_env,
                       ir_graph *const irg)
 {
 	chordal_env->cls              = cls;
-	chordal_env->border_heads     = pmap_create();
+	chordal_env->block_borders    = pmap_create();
 	chordal_env->allocatable_regs = bitset_malloc(cls->n_regs);
 	/* put all ignore registers into the ignore register set. */
 	be_get_allocatable_regs(irg, cls, chordal_env->allocatable_regs->data);
@@ -201,7 +203,7 @@ static void post_spill(be_chordal_env_t *const chordal_env, ir_graph *const irg,
 
 	/* Create the ifg with the selected flavor */
 	be_timer_push(T_RA_IFG);
-	chordal_env->ifg = be_create_ifg(chordal_env);
+	chordal_env->ifg = be_create_ifg(chordal_env, options.materialize_ifg);
 	be_timer_pop(T_RA_IFG);
 
 	if (stat_ev_enabled) {
@@ -210,6 +212,7 @@ static void post_spill(be_chordal_env_t *const chordal_env, ir_graph *const irg,
 		stat_ev_dbl("bechordal_ifg_nodes", stat.n_nodes);
 		stat_ev_dbl("bechordal_ifg_edges", stat.n_edges);
 		stat_ev_dbl("bechordal_ifg_comps", stat.n_comps);
+		be_stat_ifg_queries(chordal_env);
 
 		be_node_stats_t node_stats;
 		be_collect_node_stats(&node_stats, irg);
@@ -236,8 +239,8 @@ static void post_spill(be_chordal_env_t *const chordal_env, ir_graph *const irg,
 	be_ifg_free(chordal_env->ifg);
 
 	/* free some always allocated data structures */
-	pmap_destroy(chordal_env->border_heads);
-	free(chordal_env->allocatable_regs);
+	pmap_destroy(chordal_env->block_borders);
+	xfree(chordal_env->allocatable_regs);
 }
 
 /**
@@ -256,9 +259,10 @@ static void be_ra_chordal_main(ir_graph *irg, const regalloc_if_t *regif)
 	be_chordal_env_t chordal_env;
 	obstack_init(&chordal_env.obst);
 	chordal_env.irg              = irg;
-	chordal_env.border_heads     = NULL;
+	chordal_env.block_borders    = NULL;
 	chordal_env.ifg              = NULL;
 	chordal_env.allocatable_regs = NULL;
+	chordal_env.insn_summary     = be_new_insn_summary(irg);
 
 	if (stat_ev_enabled)
 		be_collect_node_stats(&last_node_stats, irg);
@@ -282,9 +286,11 @@ static void be_ra_chordal_main(ir_graph *irg, const regalloc_if_t *regif)
 
 		pre_spill(&chordal_env, cls, irg);
 
+		be_spill_stat_t *const spill_stat = be_spill_stat_begin(irg, cls);
 		be_timer_push(T_RA_SPILL);
 		be_do_spill(irg, cls, regif);
 		be_timer_pop(T_RA_SPILL);
+		be_spill_stat_finish(spill_stat);
 		be_chordal_dump(BE_CH_DUMP_SPILL, irg, cls, "spill");
 		stat_ev_dbl("bechordal_spillcosts", be_estimate_irg_costs(irg) - pre_spill_cost);
 
@@ -304,6 +310,7 @@ static void be_ra_chordal_main(ir_graph *irg, const regalloc_if_t *regif)
 	lower_nodes_after_ra(irg, options.lower_perm_opt == BE_CH_LOWER_PERM_COPY);
 	be_chordal_dump(BE_CH_DUMP_LOWER, irg, NULL, "belower-after-ra");
 
+	be_free_insn_summary(chordal_env.insn_summary);
 	obstack_free(&chordal_env.obst, NULL);
 	be_invalidate_live_sets(irg);
 	be_timer_pop(T_RA_EPILOG);
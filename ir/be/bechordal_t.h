@@ -13,19 +13,18 @@
 #define FIRM_BE_BECHORDAL_T_H
 
 #include "firm_types.h"
-#include "list.h"
 #include "pmap.h"
 #include "bitset.h"
 #include "obst.h"
 
 #include "bechordal.h"
 #include "beifg.h"
+#include "beinsn_t.h"
 
 /**
  * A liveness interval border.
  */
 struct border_t {
-	struct list_head  list;         /**< list head for queuing. */
 	ir_node          *irn;          /**< The node. */
 	unsigned         step;          /**< The number equal to the interval border. */
 	unsigned         is_def  : 1;   /**< Does this border denote a use or a def. */
@@ -35,6 +34,14 @@ struct border_t {
 	                                     value has one begin and one end. */
 };
 
+/**
+ * The liveness interval borders of a block in schedule order.
+ */
+typedef struct block_borders_t {
+	size_t   n_borders;
+	border_t borders[];
+} block_borders_t;
+
 /**
  * Environment for each of the chordal register allocator phases
  */
@@ -42,17 +49,19 @@ struct be_chordal_env_t {
 	struct obstack        obst;         /**< An obstack for temporary storage. */
 	ir_graph             *irg;          /**< The graph under examination. */
 	const arch_register_class_t *cls;   /**< The current register class. */
-	pmap                 *border_heads; /**< Maps blocks to border heads. */
+	pmap                 *block_borders; /**< Maps blocks to their borders. */
 	be_ifg_t             *ifg;          /**< The interference graph. */
 	bitset_t             *allocatable_regs; /**< set of allocatable registers */
+	be_insn_summary      *insn_summary; /**< constrained classes per node */
 };
 
-static inline struct list_head *get_block_border_head(be_chordal_env_t const *const inf, ir_node *const bl)
+static inline block_borders_t const *get_block_borders(be_chordal_env_t const *const inf, ir_node *const bl)
 {
-  return pmap_get(list_head, inf->border_heads, bl);
+	return pmap_get(block_borders_t const, inf->block_borders, bl);
 }
 
-#define foreach_border_head(head, pos)      list_for_each_entry_reverse(border_t, pos, head, list)
+#define foreach_border(borders, pos) \
+	for (border_t const *pos = (borders)->borders, *const pos##_end = pos + (borders)->n_borders; pos != pos##_end; ++pos)
 
 enum {
 	/* Dump flags */
@@ -73,6 +82,7 @@ enum {
 struct be_ra_chordal_opts_t {
 	unsigned dump_flags;
 	int      lower_perm_opt;
+	bool     materialize_ifg;
 };
 
 void be_chordal_dump(unsigned mask, ir_graph *irg, arch_register_class_t const *cls, char const *suffix);
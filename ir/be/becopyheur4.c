@@ -32,6 +32,7 @@
 #include "irtools.h"
 #include "list.h"
 #include "statev_t.h"
+#include "timing.h"
 
 #include "bearch.h"
 #include "beifg.h"
@@ -60,6 +61,8 @@ typedef float real_t;
 static unsigned last_chunk_id;
 static int      recolor_limit     = 7;
 static double   dislike_influence = REAL(0.1);
+static double   time_limit        = 0.0; /**< in msec per class, 0 = none */
+static int      chunk_limit       = 0;   /**< per class, 0 = none */
 
 typedef struct col_cost_t {
 	unsigned col;
@@ -317,7 +320,7 @@ static inline void delete_aff_chunk(aff_chunk_t *c)
 #ifndef NDEBUG
 	c->deleted = true;
 #endif
-	free(c);
+	xfree(c);
 }
 
 /**
@@ -763,7 +766,7 @@ static aff_chunk_t *fragment_chunk(co_mst_env_t *env, unsigned col,
 	}
 
 	assert(best && "No chunk found?");
-	free(visited);
+	xfree(visited);
 	return best;
 }
 
@@ -1241,13 +1244,23 @@ static void color_aff_chunk(co_mst_env_t *env, aff_chunk_t *c)
 
 	/* clear obsolete chunks and free some memory */
 	delete_aff_chunk(best_chunk);
-	free(visited);
+	xfree(visited);
 	if (best_starts)
 		del_pdeq(best_starts);
 
 	stat_ev_ctx_pop("heur4_color_chunk");
 }
 
+/**
+ * Checks whether the budget for coloring chunks is used up.
+ */
+static bool budget_exhausted(ir_timer_t *const timer, int const n_colored)
+{
+	if (chunk_limit > 0 && n_colored >= chunk_limit)
+		return true;
+	return timer != NULL && ir_timer_elapsed_usec(timer) >= time_limit * 1000.0;
+}
+
 /**
  * Main driver for mst safe coalescing algorithm.
  */
@@ -1288,18 +1301,40 @@ static int co_solve_heuristic_mst(copy_opt_t *co)
 
 	DBG((dbg, LEVEL_1, "==== Coloring %+F, class %s ====\n", co->irg, co->cls->name));
 
+	ir_timer_t *timer = NULL;
+	if (time_limit > 0) {
+		timer = ir_timer_new();
+		ir_timer_reset_and_start(timer);
+	}
+
 	/* build affinity chunks */
 	stat_ev_tim_push();
 	build_affinity_chunks(&mst_env);
 	stat_ev_tim_pop("heur4_initial_chunk");
 
 	/* color chunks as long as there are some */
+	int n_colored = 0;
 	while (!pqueue_empty(mst_env.chunks)) {
+		/* Every recoloring keeps the coloring valid and the heaviest chunks
+		 * come first, so stopping early keeps the best result so far. */
+		if (budget_exhausted(timer, n_colored)) {
+			DB((dbg, LEVEL_1, "budget exhausted after %d chunks\n", n_colored));
+			co->budget_exhausted = true;
+			break;
+		}
+
 		aff_chunk_t *chunk = (aff_chunk_t*)pqueue_pop_front(mst_env.chunks);
 
 		color_aff_chunk(&mst_env, chunk);
 		DB((dbg, LEVEL_4, "<<<====== Coloring chunk (%u) done\n", chunk->id));
 		delete_aff_chunk(chunk);
+		++n_colored;
+	}
+	while (!pqueue_empty(mst_env.chunks))
+		delete_aff_chunk((aff_chunk_t*)pqueue_pop_front(mst_env.chunks));
+	if (timer != NULL) {
+		ir_timer_stop(timer);
+		ir_timer_free(timer);
 	}
 
 	/* apply coloring */
@@ -1330,6 +1365,8 @@ static int co_solve_heuristic_mst(copy_opt_t *co)
 static const lc_opt_table_entry_t options[] = {
 	LC_OPT_ENT_INT("limit", "limit recoloring",  &recolor_limit),
 	LC_OPT_ENT_DBL("di",    "dislike influence", &dislike_influence),
+	LC_OPT_ENT_DBL("time",  "time limit per register class in msec (0 = none)", &time_limit),
+	LC_OPT_ENT_INT("chunks", "maximum number of colored chunks per register class (0 = none)", &chunk_limit),
 	LC_OPT_LAST
 };
 
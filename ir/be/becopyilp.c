@@ -26,9 +26,16 @@
 
 #define DUMP_ILP 1
 
-static int      time_limit = 60;
-static bool     solve_log  = false;
-static unsigned dump_flags = 0;
+static int      time_limit     = 60;
+static int      function_limit = 0;
+static bool     warm_start     = true;
+static bool     solve_log      = false;
+static unsigned dump_flags     = 0;
+
+/** The graph whose solving time is counted against function_limit. */
+static ir_graph const *limit_irg;
+/** Solving time spent on limit_irg in seconds. */
+static double          limit_used;
 
 static const lc_opt_enum_mask_items_t dump_items[] = {
 	{ "ilp", DUMP_ILP },
@@ -41,6 +48,8 @@ static lc_opt_enum_mask_var_t dump_var = {
 
 static const lc_opt_table_entry_t options[] = {
 	LC_OPT_ENT_INT      ("limit", "time limit for solving in seconds (0 for unlimited)", &time_limit),
+	LC_OPT_ENT_INT      ("function_limit", "time limit for all register classes of a function in seconds (0 for unlimited)", &function_limit),
+	LC_OPT_ENT_BOOL     ("warm_start", "start solving from the heur4 coalescing", &warm_start),
 	LC_OPT_ENT_BOOL     ("log",   "show ilp solving log", &solve_log),
 	LC_OPT_ENT_ENUM_MASK("dump",  "dump flags", &dump_var),
 	LC_OPT_LAST
@@ -191,13 +200,51 @@ ilp_env_t *new_ilp_env(copy_opt_t *const co, ilp_callback const build, ilp_callb
 	res->apply    = apply;
 	res->env      = env;
 	res->col_suff = NEW_ARR_F(ir_node*, 0);
+	res->lp       = NULL;
 	ir_nodeset_init(&res->all_removed);
 
 	return res;
 }
 
+void ilp_warm_start(copy_opt_t *const co)
+{
+	if (!warm_start)
+		return;
+	co_algo_info const *const heur = be_find_copyopt("heur4");
+	if (heur != NULL)
+		heur->copyopt(co);
+}
+
+/**
+ * Returns the time limit for the next solver run in seconds, 0 for unlimited
+ * and a negative value if the time of the function is used up.
+ */
+static double get_time_limit(ir_graph const *const irg)
+{
+	if (function_limit <= 0)
+		return time_limit;
+
+	if (limit_irg != irg) {
+		limit_irg  = irg;
+		limit_used = 0.0;
+	}
+	double const remaining = function_limit - limit_used;
+	if (remaining <= 0.0)
+		return -1.0;
+	if (time_limit > 0 && time_limit < remaining)
+		return time_limit;
+	return remaining;
+}
+
 lpp_sol_state_t ilp_go(ilp_env_t *const ienv)
 {
+	double const limit = get_time_limit(ienv->co->irg);
+	if (limit < 0.0) {
+		/* keep the current (warm start) coloring */
+		stat_ev_int("co_ilp_skipped", 1);
+		return lpp_unknown;
+	}
+
 	sr_remove(ienv);
 
 	ienv->build(ienv);
@@ -212,11 +259,12 @@ lpp_sol_state_t ilp_go(ilp_env_t *const ienv)
 		fclose(f);
 	}
 
-	lpp_set_time_limit(ienv->lp, time_limit);
+	lpp_set_time_limit(ienv->lp, limit);
 	if (solve_log)
 		lpp_set_log(ienv->lp, stdout);
 
 	lpp_solve(ienv->lp, be_options.ilp_solver);
+	limit_used += lpp_get_sol_time(ienv->lp);
 
 	//stat_ev_dbl("co_ilp_objval",     ienv->lp->objval);
 	//stat_ev_dbl("co_ilp_best_bound", ienv->lp->best_bound);
@@ -234,6 +282,7 @@ void free_ilp_env(ilp_env_t *const ienv)
 {
 	ir_nodeset_destroy(&ienv->all_removed);
 	DEL_ARR_F(ienv->col_suff);
-	lpp_free(ienv->lp);
-	free(ienv);
+	if (ienv->lp != NULL)
+		lpp_free(ienv->lp);
+	xfree(ienv);
 }
@@ -42,8 +42,9 @@
 DEBUG_ONLY(static firm_dbg_module_t *dbg;)
 
 typedef struct local_env_t {
-	int first_x_var;
-	int last_x_var;
+	int  first_x_var;
+	int  last_x_var;
+	int *x_base;      /**< first color variable of each node by node index */
 } local_env_t;
 
 static unsigned check_alignment_constraints(ir_node *node)
@@ -55,11 +56,16 @@ static unsigned check_alignment_constraints(ir_node *node)
 	return req->aligned && req->width > 1;
 }
 
-static void make_color_var_name(char *buf, size_t buf_size,
-                                const ir_node *node, unsigned color)
+/**
+ * Returns the index of the variable x_nc.  The color variables are unnamed
+ * and the variables of a node are consecutive in color order.
+ */
+static int get_color_var(local_env_t const *const lenv, ir_node const *const node,
+                         unsigned const color)
 {
-	unsigned const node_idx = get_irn_idx(node);
-	snprintf(buf, buf_size, "x_%u_%u", node_idx, color);
+	int const base = lenv->x_base[get_irn_idx(node)];
+	assert(base >= 0);
+	return base + (int)color;
 }
 
 static void build_coloring_cstr(ilp_env_t *ienv)
@@ -86,47 +92,36 @@ static void build_coloring_cstr(ilp_env_t *ienv)
 		}
 
 		/* add the coloring constraint */
-		int      const cst_idx         = lpp_add_cst(ienv->lp, NULL, lpp_equal, 1.0);
+		int      const cst_idx         = lpp_add_cst_fast(ienv->lp, lpp_equal, 1.0);
 		unsigned const curr_node_color = get_irn_col(irn);
 		for (unsigned col = 0; col < n_regs; ++col) {
-			if (!rbitset_is_set(colors, col)
-				|| (has_alignment_cstr && ((col % req->width) != 0)))
-				continue;
-
-			char buf[32];
-			make_color_var_name(buf, sizeof(buf), irn, col);
-			int const var_idx = lpp_add_var(ienv->lp, buf, lpp_binary, 0.0);
-			lpp_set_factor_fast(ienv->lp, cst_idx, var_idx, 1);
-
-			double const val = col == curr_node_color ? 1.0 : 0.0;
-			lpp_set_start_value(ienv->lp, var_idx, val);
-
-			lenv->last_x_var = var_idx;
+			int const var_idx = lpp_add_var_fast(ienv->lp, lpp_binary, 0.0);
+			if (col == 0)
+				lenv->x_base[get_irn_idx(irn)] = var_idx;
 			if (lenv->first_x_var == -1)
 				lenv->first_x_var = var_idx;
-		}
+			lenv->last_x_var = var_idx;
 
-		/* add register constraint constraints */
-		for (unsigned col = 0; col < n_regs; ++col) {
 			if (rbitset_is_set(colors, col)
 				// for aligned variable, we set the unaligned part to 0
-				&& (!has_alignment_cstr || ((col % req->width) == 0)))
-				continue;
-
-			char buf[32];
-			make_color_var_name(buf, sizeof(buf), irn, col);
-			int const cst_idx = lpp_add_cst(ienv->lp, NULL, lpp_equal, 0.0);
-			int const var_idx = lpp_add_var(ienv->lp, buf, lpp_binary, 0.0);
-			lpp_set_start_value(ienv->lp, var_idx, 0.0);
-			lpp_set_factor_fast(ienv->lp, cst_idx, var_idx, 1);
+				&& (!has_alignment_cstr || ((col % req->width) == 0))) {
+				lpp_set_factor_fast(ienv->lp, cst_idx, var_idx, 1);
 
-			lenv->last_x_var = var_idx;
+				double const val = col == curr_node_color ? 1.0 : 0.0;
+				lpp_set_start_value(ienv->lp, var_idx, val);
+			} else {
+				/* add register constraint constraints */
+				int const zero_idx = lpp_add_cst_fast(ienv->lp, lpp_equal, 0.0);
+				lpp_set_start_value(ienv->lp, var_idx, 0.0);
+				lpp_set_factor_fast(ienv->lp, zero_idx, var_idx, 1);
+			}
 		}
 	}
 }
 
 static void build_interference_cstr(ilp_env_t *const ienv)
 {
+	local_env_t    *const lenv               = (local_env_t*)ienv->env;
 	lpp_t          *const lpp                = ienv->lp;
 	be_ifg_t       *const ifg                = ienv->co->cenv->ifg;
 	unsigned        const n_colors           = ienv->co->cls->n_regs;
@@ -167,9 +162,7 @@ static void build_interference_cstr(ilp_env_t *const ienv)
 					aligment_offset = col % req->width;
 				}
 
-				char buf[32];
-				make_color_var_name(buf, sizeof(buf), irn, col - aligment_offset);
-				int const var_idx = lpp_get_var_idx(lpp, buf);
+				int const var_idx = get_color_var(lenv, irn, col - aligment_offset);
 				lpp_set_factor_fast(lpp, cst_idx, var_idx, 1);
 			}
 		}
@@ -197,6 +190,7 @@ static void make_affinity_var_name(char *buf, size_t buf_size,
  */
 static void build_affinity_cstr(ilp_env_t const *const ienv)
 {
+	local_env_t const *const lenv = (local_env_t const*)ienv->env;
 	lpp_t   *const lp       = ienv->lp;
 	unsigned const n_colors = ienv->co->cls->n_regs;
 
@@ -216,12 +210,9 @@ static void build_affinity_cstr(ilp_env_t const *const ienv)
 
 			/* add constraints relating the affinity var to the color vars */
 			for (unsigned col = 0; col < n_colors; ++col) {
-				int const cst_idx = lpp_add_cst(lp, NULL, lpp_less_equal, 0.0);
-
-				make_color_var_name(buf, sizeof(buf), root, col);
-				int const root_idx = lpp_get_var_idx(lp, buf);
-				make_color_var_name(buf, sizeof(buf), arg, col);
-				int const arg_idx  = lpp_get_var_idx(lp, buf);
+				int const cst_idx  = lpp_add_cst_fast(lp, lpp_less_equal, 0.0);
+				int const root_idx = get_color_var(lenv, root, col);
+				int const arg_idx  = get_color_var(lenv, arg, col);
 
 				lpp_set_factor_fast(lp, cst_idx, root_idx,  1.0);
 				lpp_set_factor_fast(lp, cst_idx, arg_idx,  -1.0);
@@ -472,6 +463,11 @@ static void build_path_cstr(ilp_env_t *ienv)
 
 static void ilp2_build(ilp_env_t *ienv)
 {
+	local_env_t *const lenv   = (local_env_t*)ienv->env;
+	unsigned     const n_idxs = get_irg_last_idx(ienv->co->irg);
+	lenv->x_base = XMALLOCN(int, n_idxs);
+	memset(lenv->x_base, -1, n_idxs * sizeof(*lenv->x_base));
+
 	ienv->lp = lpp_new("copyilp", lpp_minimize);
 	build_coloring_cstr(ienv);
 	build_interference_cstr(ienv);
@@ -494,30 +490,30 @@ static void ilp2_apply(ilp_env_t *const ienv)
 		double          *const sol   = XMALLOCN(double, count);
 		lpp_sol_state_t  const state = lpp_get_solution(ienv->lp, sol, lenv->first_x_var, lenv->last_x_var);
 
+		if (state == lpp_unknown) {
+			/* no solution within the time limit, keep the start coloring */
+			xfree(sol);
+			return;
+		}
 		if (state != lpp_optimal) {
 			ir_printf("WARNING: Solution state of %F register class %s is not 'optimal': %d\n", irg, ienv->co->cls->name, (int)state);
 			if (state < lpp_feasible)
 				panic("copy coalescing solution not feasible");
 		}
 
-		for (int i = 0; i < count; ++i) {
-			if (sol[i] <= 1 - EPSILON)
+		unsigned const n_regs = ienv->co->cls->n_regs;
+		be_ifg_foreach_node(ienv->co->cenv->ifg, irn) {
+			if (sr_is_removed(ienv, irn))
 				continue;
-			/* split variable name into components */
-			char var_name[32];
-			lpp_get_var_name(ienv->lp, lenv->first_x_var + i, var_name, sizeof(var_name));
-
-			unsigned nodenr;
-			unsigned color;
-			if (sscanf(var_name, "x_%u_%u", &nodenr, &color) == 2) {
-				ir_node *const irn = get_idx_irn(irg, nodenr);
-				set_irn_col(ienv->co->cls, irn, color);
-			} else {
-				panic("this should be an x-var");
+
+			int const base = get_color_var(lenv, irn, 0) - lenv->first_x_var;
+			for (unsigned col = 0; col < n_regs; ++col) {
+				if (sol[base + col] > 1 - EPSILON)
+					set_irn_col(ienv->co->cls, irn, col);
 			}
 		}
 
-		free(sol);
+		xfree(sol);
 	}
 }
 
@@ -534,13 +530,20 @@ static int co_solve_ilp2(copy_opt_t *const co)
 
 	FIRM_DBG_REGISTER(dbg, "firm.be.coilp2");
 
+	ilp_warm_start(co);
+
 	local_env_t my;
 	my.first_x_var = -1;
 	my.last_x_var  = -1;
+	my.x_base      = NULL;
 
 	ilp_env_t      *const ienv      = new_ilp_env(co, ilp2_build, ilp2_apply, &my);
 	lpp_sol_state_t const sol_state = ilp_go(ienv);
 	free_ilp_env(ienv);
+	xfree(my.x_base);
+
+	if (sol_state != lpp_optimal)
+		co->budget_exhausted = true;
 
 	return sol_state == lpp_optimal;
 }
@@ -46,6 +46,16 @@ struct ilp_env_t {
 
 ilp_env_t *new_ilp_env(copy_opt_t *co, ilp_callback build, ilp_callback apply, void *env);
 
+/**
+ * Coalesces with the heur4 heuristic first if warm starts are enabled, so the
+ * start values of the model describe its coloring.
+ */
+void ilp_warm_start(copy_opt_t *co);
+
+/**
+ * Builds and solves the model.  Returns lpp_unknown without solving if the
+ * time limit of the function is used up; the current coloring is kept then.
+ */
 lpp_sol_state_t ilp_go(ilp_env_t *ienv);
 
 void free_ilp_env(ilp_env_t *ienv);
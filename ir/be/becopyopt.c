@@ -19,6 +19,7 @@
 #include "execfreq_t.h"
 #include "irdump_t.h"
 #include "iredges_t.h"
+#include "irflag.h"
 #include "irgwalk.h"
 #include "irloop_t.h"
 #include "irnode_t.h"
@@ -142,6 +143,11 @@ void be_register_copyopt(const char *name, co_algo_info *copyopt)
 	be_add_module_to_list(&copyopts, name, copyopt);
 }
 
+co_algo_info const *be_find_copyopt(const char *const name)
+{
+	return (co_algo_info const*)be_find_module(copyopts, name);
+}
+
 BE_REGISTER_MODULE_CONSTRUCTOR(be_init_copyopt)
 void be_init_copyopt(void)
 {
@@ -185,7 +191,7 @@ static copy_opt_t *new_copy_opt(be_chordal_env_t *chordal_env, cost_fct_t get_co
 
 static void free_copy_opt(copy_opt_t *co)
 {
-	free(co);
+	xfree(co);
 }
 
 /**
@@ -472,7 +478,7 @@ static void co_collect_units(ir_node *irn, void *env)
 		}
 		list_add(&unit->units, tmp);
 	} else {
-		free(unit);
+		xfree(unit);
 	}
 }
 
@@ -487,9 +493,9 @@ static void co_free_ou_structure(copy_opt_t *co)
 {
 	ASSERT_OU_AVAIL(co);
 	list_for_each_entry_safe(unit_t, curr, tmp, &co->units, units) {
-		free(curr->nodes);
-		free(curr->costs);
-		free(curr);
+		xfree(curr->nodes);
+		xfree(curr->costs);
+		xfree(curr);
 	}
 	co->units.next = NULL;
 }
@@ -542,7 +548,7 @@ static void co_complete_stats(const copy_opt_t *co, co_complete_stats_t *stat)
 		}
 	}
 
-	free(seen);
+	xfree(seen);
 }
 
 static int compare_affinity_node_t(const void *k1, const void *k2, size_t size)
@@ -743,7 +749,7 @@ static void co_dump_appel_graph(const copy_opt_t *co, FILE *f)
 		}
 	}
 
-	free(node_map);
+	xfree(node_map);
 }
 
 static FILE *my_open(const be_chordal_env_t *env, const char *prefix,
@@ -762,7 +768,7 @@ static FILE *my_open(const be_chordal_env_t *env, const char *prefix,
 	char buf[1024];
 	ir_snprintf(buf, sizeof(buf), "%s%s_%F_%s%s", prefix, tu_name, env->irg,
 	            env->cls->name, suffix);
-	free(tu_name);
+	xfree(tu_name);
 	FILE *result = fopen(buf, "wt");
 	if (result == NULL) {
 		panic("couldn't open '%s' for writing", buf);
@@ -773,6 +779,12 @@ static FILE *my_open(const be_chordal_env_t *env, const char *prefix,
 
 void co_driver(be_chordal_env_t *cenv)
 {
+	/* the affinity and interference checks are quadratic in the worst case */
+	ir_graph *const irg = cenv->irg;
+	if (!ir_complexity_allows(irg, "copyopt",
+	                          get_irg_complexity(irg, IR_COMPLEXITY_NODES_SQUARED)))
+		return;
+
 	ir_timer_t *timer = ir_timer_new();
 
 	/* skip copymin if algo is 'none' */
@@ -815,6 +827,7 @@ void co_driver(be_chordal_env_t *cenv)
 
 	stat_ev_dbl("co_time", ir_timer_elapsed_msec(timer));
 	stat_ev_ull("co_optimal", was_optimal);
+	stat_ev_ull("co_budget_exhausted", co->budget_exhausted);
 	ir_timer_free(timer);
 
 	if (dump_flags & DUMP_AFTER) {
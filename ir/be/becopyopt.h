@@ -37,6 +37,12 @@ typedef struct {
  */
 void be_register_copyopt(const char *name, co_algo_info *copyopt);
 
+/**
+ * Returns the copy optimization algorithm registered as @p name, NULL if
+ * there is no such algorithm.
+ */
+co_algo_info const *be_find_copyopt(const char *name);
+
 /** The driver for copy minimization. */
 void co_driver(be_chordal_env_t *cenv);
 
@@ -34,6 +34,10 @@ struct copy_opt_t {
 	/** Representation in graph structure. Only build on demand */
 	struct obstack obst;
 	set           *nodes;
+
+	/** Set by algorithms which stopped at their budget and applied the best
+	 *  result found so far. */
+	bool budget_exhausted;
 };
 
 #define ASSERT_OU_AVAIL(co)     assert((co)->units.next && "Representation as optimization-units not built")
@@ -82,10 +82,15 @@ typedef struct dwarf_t {
 	const char      **file_list;
 	const ir_entity **pubnames_list;
 	pset_new_t        emitted_types;
+	pmap             *pointer_types;   /**< points-to type -> emitted pointer
+	                                        type */
+	pmap             *canonical_types; /**< pointer type -> equal emitted
+	                                        pointer type */
 	const char       *main_file;    /**< name of the main source file */
 	const char       *curr_file;    /**< name of the current source file */
 	unsigned          label_num;
 	unsigned          last_line;
+	dbg_info const   *last_dbgi;    /**< debug info of the last .loc */
 } dwarf_t;
 
 static dwarf_t               env;
@@ -111,25 +116,33 @@ static unsigned insert_file(const char *filename)
 
 static void emit_int32(uint32_t value)
 {
-	be_emit_irprintf("\t.long %u\n", value);
+	be_emit_cstring("\t.long ");
+	be_emit_uint(value);
+	be_emit_char('\n');
 	be_emit_write_line();
 }
 
 static void emit_int16(uint16_t value)
 {
-	be_emit_irprintf("\t.short %u\n", value);
+	be_emit_cstring("\t.short ");
+	be_emit_uint(value);
+	be_emit_char('\n');
 	be_emit_write_line();
 }
 
 static void emit_int8(uint8_t value)
 {
-	be_emit_irprintf("\t.byte %u\n", value);
+	be_emit_cstring("\t.byte ");
+	be_emit_uint(value);
+	be_emit_char('\n');
 	be_emit_write_line();
 }
 
 static void emit_uleb128(unsigned value)
 {
-	be_emit_irprintf("\t.uleb128 0x%x\n", value);
+	be_emit_cstring("\t.uleb128 ");
+	be_emit_uint(value);
+	be_emit_char('\n');
 	be_emit_write_line();
 }
 
@@ -145,7 +158,9 @@ static unsigned get_uleb128_size(unsigned value)
 
 static void emit_sleb128(long value)
 {
-	be_emit_irprintf("\t.sleb128 %ld\n", value);
+	be_emit_cstring("\t.sleb128 ");
+	be_emit_int(value);
+	be_emit_char('\n');
 	be_emit_write_line();
 }
 
@@ -311,12 +326,28 @@ void be_dwarf_location(dbg_info *dbgi)
 {
 	if (debug_level < LEVEL_LOCATIONS)
 		return;
+	/* equal debug infos describe the same location, which is still active */
+	if (dbgi == env.last_dbgi)
+		return;
 	src_loc_t loc = ir_retrieve_dbg_info(dbgi);
 	if (!loc.file)
 		return;
+	env.last_dbgi = dbgi;
+	/* only start a new row of the line table when the line changes */
+	if (loc.line == env.last_line && env.curr_file != NULL
+	 && streq(loc.file, env.curr_file))
+		return;
+	env.curr_file = loc.file;
+	env.last_line = loc.line;
 
 	unsigned filenum = insert_file(loc.file);
-	be_emit_irprintf("\t.loc %u %u %u\n", filenum, loc.line, loc.column);
+	be_emit_cstring("\t.loc ");
+	be_emit_uint(filenum);
+	be_emit_char(' ');
+	be_emit_uint(loc.line);
+	be_emit_char(' ');
+	be_emit_uint(loc.column);
+	be_emit_char('\n');
 	be_emit_write_line();
 }
 
@@ -347,6 +378,15 @@ void be_dwarf_callframe_spilloffset(const arch_register_t *reg, int offset)
 	}
 }
 
+void be_dwarf_callframe_restore(const arch_register_t *reg)
+{
+	if (should_emit_frameinfo()) {
+		be_emit_cstring("\t.cfi_restore ");
+		be_emit_irprintf("%%%s\n", reg->name);
+		be_emit_write_line();
+	}
+}
+
 static bool is_extern_entity(const ir_entity *entity)
 {
 	ir_visited_t visibility = get_entity_visibility(entity);
@@ -355,8 +395,10 @@ static bool is_extern_entity(const ir_entity *entity)
 
 static void emit_entity_label(const ir_entity *entity)
 {
-	be_emit_irprintf("%sE%ld:\n", be_gas_get_private_prefix(),
-	                 get_entity_nr(entity));
+	be_emit_string(be_gas_get_private_prefix());
+	be_emit_char('E');
+	be_emit_int(get_entity_nr(entity));
+	be_emit_cstring(":\n");
 	be_emit_write_line();
 }
 
@@ -376,11 +418,22 @@ static void emit_dbginfo(const dbg_info *dbgi)
 	emit_uleb128(loc.column);
 }
 
+/** Returns the type whose DIE describes @p type. */
+static const ir_type *get_canonical_type(const ir_type *type)
+{
+	const ir_type *canonical = pmap_get(const ir_type, env.canonical_types, type);
+	return canonical != NULL ? canonical : type;
+}
+
 static void emit_type_address(const ir_type *type)
 {
-	be_emit_irprintf("\t.long %sT%ld - %sinfo_begin\n",
-	                 be_gas_get_private_prefix(),
-	                 get_type_nr(type), be_gas_get_private_prefix());
+	be_emit_cstring("\t.long ");
+	be_emit_string(be_gas_get_private_prefix());
+	be_emit_char('T');
+	be_emit_int(get_type_nr(get_canonical_type(type)));
+	be_emit_cstring(" - ");
+	be_emit_string(be_gas_get_private_prefix());
+	be_emit_cstring("info_begin\n");
 	be_emit_write_line();
 }
 
@@ -504,8 +557,16 @@ void be_dwarf_function_before(const ir_entity *entity,
 	env.cur_ent = entity;
 }
 
+bool be_dwarf_has_function_info(void)
+{
+	return debug_level >= LEVEL_BASIC || should_emit_frameinfo();
+}
+
 void be_dwarf_function_begin(void)
 {
+	env.last_dbgi = NULL;
+	env.curr_file = NULL;
+	env.last_line = 0;
 	if (should_emit_frameinfo()) {
 		be_emit_cstring("\t.cfi_startproc\n");
 		be_emit_write_line();
@@ -537,8 +598,10 @@ static void emit_base_type_abbrev(void)
 
 static void emit_type_label(const ir_type *type)
 {
-	be_emit_irprintf("%sT%ld:\n", be_gas_get_private_prefix(),
-	                 get_type_nr(type));
+	be_emit_string(be_gas_get_private_prefix());
+	be_emit_char('T');
+	be_emit_int(get_type_nr(type));
+	be_emit_cstring(":\n");
 	be_emit_write_line();
 }
 
@@ -587,6 +650,16 @@ static void emit_pointer_type(const ir_type *type)
 	unsigned size      = get_type_size(type);
 	assert(size < 256);
 
+	/* frontends create equal pointer types in many places, share one DIE.
+	 * Decide before recursing, so references from inside see the result. */
+	const ir_type *const key   = get_canonical_type(points_to);
+	const ir_type *const equal = pmap_get(const ir_type, env.pointer_types, key);
+	if (equal != NULL && get_type_size(equal) == size) {
+		pmap_insert(env.canonical_types, type, (void*)equal);
+		return;
+	}
+	pmap_insert(env.pointer_types, key, (void*)type);
+
 	if (!is_Primitive_type(points_to) || get_type_mode(points_to) != mode_ANY) {
 		emit_type(points_to);
 
@@ -930,6 +1003,8 @@ void be_dwarf_close(void)
 	if (debug_level < LEVEL_BASIC)
 		return;
 	pmap_destroy(env.file_map);
+	pmap_destroy(env.pointer_types);
+	pmap_destroy(env.canonical_types);
 	DEL_ARR_F(env.file_list);
 	DEL_ARR_F(env.pubnames_list);
 	pset_new_destroy(&env.emitted_types);
@@ -940,9 +1015,11 @@ void be_dwarf_open(void)
 {
 	if (debug_level < LEVEL_BASIC)
 		return;
-	env.file_map      = pmap_create();
-	env.file_list     = NEW_ARR_F(const char*, 0);
-	env.pubnames_list = NEW_ARR_F(const ir_entity*, 0);
+	env.file_map        = pmap_create();
+	env.pointer_types   = pmap_create();
+	env.canonical_types = pmap_create();
+	env.file_list       = NEW_ARR_F(const char*, 0);
+	env.pubnames_list   = NEW_ARR_F(const ir_entity*, 0);
 	pset_new_init(&env.emitted_types);
 }
 
@@ -953,7 +1030,7 @@ void be_dwarf_set_source_language(dwarf_source_language new_language)
 
 void be_dwarf_set_compilation_directory(const char *new_comp_dir)
 {
-	free(comp_dir);
+	xfree(comp_dir);
 	comp_dir = xstrdup(new_comp_dir);
 }
 
@@ -34,6 +34,12 @@ void be_dwarf_unit_end(void);
 void be_dwarf_function_before(const ir_entity *ent,
                               const parameter_dbg_info_t *infos);
 
+/**
+ * Returns true if debug or callframe info is emitted for functions.  It
+ * requires the code of a function to be contiguous.
+ */
+bool be_dwarf_has_function_info(void);
+
 /** output debug info right before beginning to output assembly instructions */
 void be_dwarf_function_begin(void);
 
@@ -62,4 +68,9 @@ void be_dwarf_callframe_offset(int offset);
  */
 void be_dwarf_callframe_spilloffset(const arch_register_t *reg, int offset);
 
+/**
+ * Indicate that a callee saved register holds the value of the caller again.
+ */
+void be_dwarf_callframe_restore(const arch_register_t *reg);
+
 #endif
@@ -0,0 +1,971 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Writes ELF relocatable object files.
+ *
+ * The sections, symbols and relocations are collected while the compilation
+ * unit is generated.  At its end the symbol table is sorted (local symbols
+ * have to come first) and the file is written front to back.
+ */
+#include "beelf.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "array.h"
+#include "be_t.h"
+#include "bedwarf.h"
+#include "begnuas.h"
+#include "bitfiddle.h"
+#include "entity_t.h"
+#include "irnode_t.h"
+#include "irprog.h"
+#include "obst.h"
+#include "panic.h"
+#include "pmap.h"
+#include "tv.h"
+#include "util.h"
+
+/* constants from the System V ABI */
+#define ELF_ET_REL        1
+#define ELF_EV_CURRENT    1
+#define ELF_CLASS32       1
+#define ELF_CLASS64       2
+#define ELF_DATA2LSB      1
+#define ELF_SHT_PROGBITS  1
+#define ELF_SHT_SYMTAB    2
+#define ELF_SHT_STRTAB    3
+#define ELF_SHT_RELA      4
+#define ELF_SHT_NOBITS    8
+#define ELF_SHT_REL       9
+#define ELF_SHF_WRITE     0x1
+#define ELF_SHF_ALLOC     0x2
+#define ELF_SHF_EXECINSTR 0x4
+#define ELF_SHF_MERGE     0x10
+#define ELF_SHF_STRINGS   0x20
+#define ELF_SHF_INFO_LINK 0x40
+#define ELF_SHN_COMMON    0xFFF2
+#define ELF_STB_LOCAL     0
+#define ELF_STB_GLOBAL    1
+#define ELF_STB_WEAK      2
+#define ELF_STT_NOTYPE    0
+#define ELF_STT_OBJECT    1
+#define ELF_STT_FUNC      2
+#define ELF_STV_DEFAULT   0
+#define ELF_STV_HIDDEN    2
+#define ELF_STV_PROTECTED 3
+
+typedef struct elf_relocation_t {
+	unsigned         offset; /**< offset in the section */
+	uint32_t         type;
+	ir_entity const *entity;
+	int64_t          addend;
+} elf_relocation_t;
+
+typedef struct elf_section_t {
+	char const       *name;
+	uint32_t          type;
+	uint32_t          flags;
+	char             *data;        /**< contents, unused for NOBITS */
+	unsigned          size;
+	unsigned          alignment;
+	elf_relocation_t *relocations;
+	unsigned          index;       /**< section header index */
+} elf_section_t;
+
+typedef struct elf_symbol_t {
+	ir_entity const *entity;
+	elf_section_t   *section; /**< NULL if undefined or common */
+	unsigned         value;
+	unsigned         size;
+	uint8_t          type;
+	bool             common;
+	unsigned         index;   /**< symbol table index */
+	unsigned         name;    /**< string table offset */
+} elf_symbol_t;
+
+/** The sections of the object file, by their gas section. */
+static elf_section_t sections[] = {
+	[GAS_SECTION_TEXT]         = { .name = ".text",   .type = ELF_SHT_PROGBITS, .flags = ELF_SHF_ALLOC | ELF_SHF_EXECINSTR },
+	[GAS_SECTION_DATA]         = { .name = ".data",   .type = ELF_SHT_PROGBITS, .flags = ELF_SHF_ALLOC | ELF_SHF_WRITE },
+	[GAS_SECTION_RODATA]       = { .name = ".rodata", .type = ELF_SHT_PROGBITS, .flags = ELF_SHF_ALLOC },
+	[GAS_SECTION_BSS]          = { .name = ".bss",    .type = ELF_SHT_NOBITS,   .flags = ELF_SHF_ALLOC | ELF_SHF_WRITE },
+	[GAS_SECTION_CONSTRUCTORS] = { .name = ".ctors",  .type = ELF_SHT_PROGBITS, .flags = ELF_SHF_ALLOC | ELF_SHF_WRITE },
+	[GAS_SECTION_DESTRUCTORS]  = { .name = ".dtors",  .type = ELF_SHT_PROGBITS, .flags = ELF_SHF_ALLOC | ELF_SHF_WRITE },
+	[GAS_SECTION_JCR]          = { .name = ".jcr",    .type = ELF_SHT_PROGBITS, .flags = ELF_SHF_ALLOC | ELF_SHF_WRITE },
+	[GAS_SECTION_TEXT_UNLIKELY] = { .name = ".text.unlikely", .type = ELF_SHT_PROGBITS, .flags = ELF_SHF_ALLOC | ELF_SHF_EXECINSTR },
+	[GAS_SECTION_TEXT_HOT]      = { .name = ".text.hot",      .type = ELF_SHT_PROGBITS, .flags = ELF_SHF_ALLOC | ELF_SHF_EXECINSTR },
+	[GAS_SECTION_CSTRING]       = { .name = ".rodata.str1.1", .type = ELF_SHT_PROGBITS, .flags = ELF_SHF_ALLOC | ELF_SHF_MERGE | ELF_SHF_STRINGS },
+	[GAS_SECTION_LITERAL4]      = { .name = ".rodata.cst4",   .type = ELF_SHT_PROGBITS, .flags = ELF_SHF_ALLOC | ELF_SHF_MERGE },
+	[GAS_SECTION_LITERAL8]      = { .name = ".rodata.cst8",   .type = ELF_SHT_PROGBITS, .flags = ELF_SHF_ALLOC | ELF_SHF_MERGE },
+	[GAS_SECTION_LITERAL16]     = { .name = ".rodata.cst16",  .type = ELF_SHT_PROGBITS, .flags = ELF_SHF_ALLOC | ELF_SHF_MERGE },
+};
+
+static be_elf_target_t const *target;
+static FILE                  *output;
+static unsigned               output_pos;
+static struct obstack         obst;
+static pmap                  *symbols;      /**< entity -> elf_symbol_t */
+static elf_symbol_t         **symbol_list;  /**< symbols in creation order */
+static ir_entity const      **aliases;
+static pmap                  *constant_pool; /**< pool key -> first entity */
+static elf_section_t         *code_section; /**< section of the current function */
+
+void be_elf_select_target(be_elf_target_t const *const new_target)
+{
+	target = new_target;
+}
+
+bool be_elf_is_selected(void)
+{
+	return target != NULL;
+}
+
+static unsigned get_pointer_size(void)
+{
+	return target->elf64 ? 8 : 4;
+}
+
+static elf_section_t *get_section(be_gas_section_t const section,
+                                  ir_entity const *const entity)
+{
+	if (section & GAS_SECTION_FLAG_TLS)
+		panic("thread local %+F not supported in ELF object files", entity);
+	if (section & GAS_SECTION_FLAG_COMDAT)
+		panic("comdat %+F not supported in ELF object files", entity);
+	if ((size_t)section >= ARRAY_SIZE(sections)
+	 || sections[section].name == NULL)
+		panic("section of %+F not supported in ELF object files", entity);
+	return &sections[section];
+}
+
+/**
+ * Reserves @p size bytes aligned to @p alignment at the end of @p section and
+ * returns their offset.  The padding is filled with NOPs in code sections.
+ */
+static unsigned reserve(elf_section_t *const section, unsigned const alignment,
+                        unsigned const size)
+{
+	if (alignment > section->alignment)
+		section->alignment = alignment;
+
+	unsigned const offset = round_up2(section->size, alignment);
+	if (section->type != ELF_SHT_NOBITS) {
+		ARR_RESIZE(char, section->data, offset + size);
+		char    *const padding      = section->data + section->size;
+		unsigned const padding_size = offset - section->size;
+		if ((section->flags & ELF_SHF_EXECINSTR) && target->nops != NULL) {
+			target->nops(padding, padding_size);
+		} else {
+			memset(padding, 0, padding_size);
+		}
+		memset(section->data + offset, 0, size);
+	}
+	section->size = offset + size;
+	return offset;
+}
+
+static elf_symbol_t *get_symbol(ir_entity const *const entity)
+{
+	elf_symbol_t *symbol = pmap_get(elf_symbol_t, symbols, entity);
+	if (symbol == NULL) {
+		symbol         = OALLOCZ(&obst, elf_symbol_t);
+		symbol->entity = entity;
+		pmap_insert(symbols, entity, symbol);
+		ARR_APP1(elf_symbol_t*, symbol_list, symbol);
+	}
+	return symbol;
+}
+
+static void define_symbol(ir_entity const *const entity,
+                          elf_section_t *const section, unsigned const offset,
+                          unsigned const size, uint8_t const type)
+{
+	elf_symbol_t *const symbol = get_symbol(entity);
+	assert(symbol->section == NULL && !symbol->common);
+	symbol->section = section;
+	symbol->value   = offset;
+	symbol->size    = size;
+	symbol->type    = type;
+}
+
+static void add_relocation(elf_section_t *const section, unsigned const offset,
+                           uint32_t const type, ir_entity const *const entity,
+                           int64_t const addend)
+{
+	if (get_entity_kind(entity) == IR_ENTITY_LABEL)
+		panic("relocation to label %+F not supported in ELF object files",
+		      entity);
+	get_symbol(entity);
+	elf_relocation_t const relocation = {
+		.offset = offset,
+		.type   = type,
+		.entity = entity,
+		.addend = addend,
+	};
+	ARR_APP1(elf_relocation_t, section->relocations, relocation);
+}
+
+void be_elf_begin_compilation_unit(FILE *const new_output)
+{
+	assert(target != NULL);
+	if (be_get_backend_param()->byte_order_big_endian)
+		panic("ELF object files are only supported for little endian targets");
+	if (be_options.pic_style == BE_PIC_MACH_O)
+		panic("Mach-O position independent code not supported in ELF object files");
+	if (be_dwarf_has_function_info())
+		panic("debug and exception info not supported in ELF object files");
+	if (get_irp_n_asms() > 0)
+		panic("global assembler not supported in ELF object files");
+
+	output        = new_output;
+	output_pos    = 0;
+	symbols       = pmap_create();
+	symbol_list   = NEW_ARR_F(elf_symbol_t*, 0);
+	aliases       = NEW_ARR_F(ir_entity const*, 0);
+	constant_pool = pmap_create();
+	obstack_init(&obst);
+	for (size_t i = 0; i < ARRAY_SIZE(sections); ++i) {
+		elf_section_t *const section = &sections[i];
+		if (section->name == NULL)
+			continue;
+		section->data        = NEW_ARR_F(char, 0);
+		section->size        = 0;
+		section->alignment   = 1;
+		section->relocations = NEW_ARR_F(elf_relocation_t, 0);
+	}
+}
+
+char *be_elf_begin_function(ir_entity const *const entity,
+                            unsigned const p2alignment, unsigned const size)
+{
+	be_gas_section_t const section = be_gas_determine_section(NULL, entity);
+	code_section = get_section(section, entity);
+	unsigned const offset = reserve(code_section, 1u << p2alignment, size);
+	define_symbol(entity, code_section, offset, size, ELF_STT_FUNC);
+	return code_section->data + offset;
+}
+
+void be_elf_relocation(char const *const location, uint32_t const type,
+                       ir_entity const *const entity, int64_t const addend)
+{
+	assert(location >= code_section->data
+	       && location < code_section->data + code_section->size);
+	unsigned const offset = location - code_section->data;
+	add_relocation(code_section, offset, type, entity, addend);
+}
+
+static void write_int(char *const dst, uint64_t const value,
+                      unsigned const size)
+{
+	assert(size <= 8);
+	for (unsigned i = 0; i < size; ++i) {
+		dst[i] = (char)(value >> (i * 8));
+	}
+}
+
+static void write_tarval(char *const dst, ir_tarval *const tv,
+                         unsigned const size)
+{
+	unsigned const n = MIN(size, get_mode_size_bytes(get_tarval_mode(tv)));
+	for (unsigned i = 0; i < n; ++i) {
+		dst[i] = (char)get_tarval_sub_bits(tv, i);
+	}
+}
+
+/**
+ * Evaluates the constant expression @p node.  A referenced entity is returned
+ * in @p entity, the result is the offset to it then.
+ */
+static int64_t eval_init_expression(ir_node const *const node,
+                                    ir_entity const **const entity)
+{
+	switch (get_irn_opcode(node)) {
+	case iro_Conv:
+		return eval_init_expression(get_Conv_op(node), entity);
+
+	case iro_Const: {
+		ir_tarval *const tv = get_Const_tarval(node);
+		if (!tarval_is_long(tv))
+			panic("unsupported constant %+F in initializer", node);
+		return get_tarval_long(tv);
+	}
+
+	case iro_Address:
+		if (*entity != NULL)
+			panic("sum of addresses in initializer");
+		*entity = get_Address_entity(node);
+		return 0;
+
+	case iro_Offset:
+		return get_entity_offset(get_Offset_entity(node));
+
+	case iro_Align:
+		return get_type_alignment(get_Align_type(node));
+
+	case iro_Size:
+		return get_type_size(get_Size_type(node));
+
+	case iro_Add: {
+		int64_t const left  = eval_init_expression(get_Add_left(node), entity);
+		int64_t const right = eval_init_expression(get_Add_right(node), entity);
+		return left + right;
+	}
+
+	case iro_Sub: {
+		ir_entity const *right_entity = NULL;
+		int64_t const left  = eval_init_expression(get_Sub_left(node), entity);
+		int64_t const right
+			= eval_init_expression(get_Sub_right(node), &right_entity);
+		if (right_entity != NULL)
+			panic("difference of addresses %+F not supported in ELF object files",
+			      node);
+		return left - right;
+	}
+
+	case iro_Mul: {
+		ir_entity const *mul_entity = NULL;
+		int64_t const left
+			= eval_init_expression(get_Mul_left(node), &mul_entity);
+		int64_t const right
+			= eval_init_expression(get_Mul_right(node), &mul_entity);
+		if (mul_entity != NULL)
+			panic("multiplied address %+F in initializer", node);
+		return left * right;
+	}
+
+	case iro_Unknown:
+		return 0;
+
+	default:
+		panic("unsupported IR-node %+F in initializer", node);
+	}
+}
+
+static void write_init_expression(elf_section_t *const section,
+                                  unsigned const offset, ir_node *const node,
+                                  unsigned const size)
+{
+	char *const dst = section->data + offset;
+	if (is_Const(node)) {
+		write_tarval(dst, get_Const_tarval(node), size);
+		return;
+	}
+
+	ir_entity const *entity = NULL;
+	int64_t   const  value  = eval_init_expression(node, &entity);
+	if (size > 8)
+		panic("%u byte initializer %+F not supported", size, node);
+	if (entity != NULL) {
+		if (size != get_pointer_size())
+			panic("address in %u byte initializer not supported", size);
+		add_relocation(section, offset, target->reloc_abs, entity, value);
+		/* the addend is part of the relocation */
+		if (target->rela)
+			return;
+	}
+	write_int(dst, value, size);
+}
+
+static void write_bitfield(char *const dst, unsigned const offset_bits,
+                           unsigned const size_bits,
+                           ir_initializer_t const *const initializer)
+{
+	ir_tarval *tv;
+	switch (get_initializer_kind(initializer)) {
+	case IR_INITIALIZER_NULL:
+		return;
+	case IR_INITIALIZER_TARVAL:
+		tv = get_initializer_tarval_value(initializer);
+		goto write;
+	case IR_INITIALIZER_CONST: {
+		ir_node *const node = get_initializer_const_value(initializer);
+		if (!is_Const(node))
+			panic("bitfield initializer not a Const node");
+		tv = get_Const_tarval(node);
+		goto write;
+	}
+	case IR_INITIALIZER_COMPOUND:
+		panic("bitfield initializer is compound");
+	}
+	panic("invalid initializer");
+
+write:
+	for (unsigned bit = 0; bit < size_bits;) {
+		unsigned const src_byte = bit / 8;
+		unsigned const src_bit  = bit % 8;
+		unsigned const dst_byte = (offset_bits + bit) / 8;
+		unsigned const dst_bit  = (offset_bits + bit) % 8;
+		unsigned const n_bits   = MIN(size_bits - bit, 8 - dst_bit);
+
+		unsigned bits = get_tarval_sub_bits(tv, src_byte) >> src_bit;
+		if (src_bit + n_bits > 8)
+			bits |= get_tarval_sub_bits(tv, src_byte + 1) << (8 - src_bit);
+		bits &= (1u << n_bits) - 1;
+		dst[dst_byte] |= (char)(bits << dst_bit);
+
+		bit += n_bits;
+	}
+}
+
+static void write_initializer(elf_section_t *const section,
+                              unsigned const offset,
+                              ir_initializer_t const *const initializer,
+                              ir_type *const type)
+{
+	switch (get_initializer_kind(initializer)) {
+	case IR_INITIALIZER_NULL:
+		return;
+
+	case IR_INITIALIZER_TARVAL:
+		write_tarval(section->data + offset,
+		             get_initializer_tarval_value(initializer),
+		             get_type_size(type));
+		return;
+
+	case IR_INITIALIZER_CONST:
+		write_init_expression(section, offset,
+		                      get_initializer_const_value(initializer),
+		                      get_type_size(type));
+		return;
+
+	case IR_INITIALIZER_COMPOUND:
+		if (is_Array_type(type)) {
+			ir_type *const element_type = get_array_element_type(type);
+			unsigned       skip         = get_type_size(element_type);
+			unsigned const alignment    = get_type_alignment(element_type);
+			unsigned const misalign     = skip % alignment;
+			if (misalign != 0)
+				skip += alignment - misalign;
+
+			for (size_t i = 0,
+			     n = get_initializer_compound_n_entries(initializer);
+			     i < n; ++i) {
+				ir_initializer_t const *const sub_initializer
+					= get_initializer_compound_value(initializer, i);
+				write_initializer(section, offset + i * skip, sub_initializer,
+				                  element_type);
+			}
+		} else {
+			assert(is_compound_type(type));
+			for (size_t i = 0, n_members = get_compound_n_members(type);
+			     i < n_members; ++i) {
+				ir_entity *const member        = get_compound_member(type, i);
+				unsigned   const member_offset = offset + get_entity_offset(member);
+
+				assert(i < get_initializer_compound_n_entries(initializer));
+				ir_initializer_t const *const sub_initializer
+					= get_initializer_compound_value(initializer, i);
+
+				unsigned const bitfield_size = get_entity_bitfield_size(member);
+				if (bitfield_size > 0) {
+					write_bitfield(section->data + member_offset,
+					               get_entity_bitfield_offset(member),
+					               bitfield_size, sub_initializer);
+					continue;
+				}
+				write_initializer(section, member_offset, sub_initializer,
+				                  get_entity_type(member));
+			}
+		}
+		return;
+	}
+	panic("invalid initializer");
+}
+
+/**
+ * Defines the global entity @p entity, this mirrors the decisions the gas
+ * emitter makes for it.
+ */
+static void define_global(be_main_env_t const *const env,
+                          ir_entity const *const entity)
+{
+	ir_entity_kind const kind = get_entity_kind(entity);
+	/* functions are defined by be_elf_begin_function() */
+	if (kind == IR_ENTITY_LABEL || kind == IR_ENTITY_METHOD)
+		return;
+
+	be_gas_section_t const section_kind = be_gas_determine_section(env, entity);
+	if (section_kind & GAS_SECTION_FLAG_TLS)
+		panic("thread local %+F not supported in ELF object files", entity);
+
+	ir_linkage const linkage   = get_entity_linkage(entity);
+	bool       const zero_init = be_gas_entity_is_zero_initialized(entity);
+	unsigned         size      = be_gas_get_entity_size(entity);
+	if (size == 0)
+		size = 1;
+	unsigned alignment = be_gas_get_entity_alignment(entity);
+	if (!is_po2_or_zero(alignment))
+		panic("alignment not a power of 2");
+	if (alignment == 0)
+		alignment = 1;
+
+	if ((linkage & IR_LINKAGE_MERGE) || zero_init) {
+		switch (get_entity_visibility(entity)) {
+		case ir_visibility_external:
+		case ir_visibility_external_private:
+		case ir_visibility_external_protected:
+			if (linkage & IR_LINKAGE_MERGE) {
+				elf_symbol_t *const symbol = get_symbol(entity);
+				symbol->common = true;
+				symbol->value  = alignment;
+				symbol->size   = size;
+				symbol->type   = ELF_STT_OBJECT;
+				return;
+			}
+			break;
+		case ir_visibility_local:
+		case ir_visibility_private:
+			if (!(linkage & IR_LINKAGE_CONSTANT)) {
+				elf_section_t *const bss    = &sections[GAS_SECTION_BSS];
+				unsigned       const offset = reserve(bss, alignment, size);
+				define_symbol(entity, bss, offset, size, ELF_STT_OBJECT);
+				return;
+			}
+			break;
+		}
+	}
+
+	if (!entity_has_definition(entity))
+		return;
+	if (kind == IR_ENTITY_ALIAS) {
+		ARR_APP1(ir_entity const*, aliases, entity);
+		return;
+	}
+
+	elf_section_t *const section = get_section(section_kind, entity);
+
+	/* share the storage of equal constants in the unit */
+	ident *const pool_key = be_gas_get_constant_pool_key(section_kind, entity);
+	if (pool_key != NULL) {
+		ir_entity const *const first
+			= pmap_get(ir_entity const, constant_pool, pool_key);
+		if (first != NULL) {
+			elf_symbol_t const *const first_symbol = get_symbol(first);
+			define_symbol(entity, section, first_symbol->value, size,
+			              ELF_STT_OBJECT);
+			return;
+		}
+		pmap_insert(constant_pool, pool_key, (void*)entity);
+	}
+
+	/* entries of mergeable sections are aligned to their size */
+	alignment = MAX(alignment, be_gas_get_section_entsize(section_kind));
+	unsigned const offset = reserve(section, alignment, size);
+	define_symbol(entity, section, offset, size, ELF_STT_OBJECT);
+	if (!zero_init && section->type != ELF_SHT_NOBITS) {
+		write_initializer(section, offset, get_entity_initializer(entity),
+		                  get_entity_type(entity));
+	}
+}
+
+static void define_globals(ir_type *const type, be_main_env_t const *const env)
+{
+	for (size_t i = 0, n = get_compound_n_members(type); i < n; ++i) {
+		ir_entity *const entity = get_compound_member(type, i);
+		if (get_entity_linkage(entity) & IR_LINKAGE_NO_CODEGEN)
+			continue;
+		define_global(env, entity);
+	}
+}
+
+static void resolve_aliases(void)
+{
+	for (size_t i = 0, n = ARR_LEN(aliases); i < n; ++i) {
+		ir_entity    const *const entity  = aliases[i];
+		ir_entity    const *const aliased = get_entity_alias(entity);
+		elf_symbol_t const *const target_symbol
+			= pmap_get(elf_symbol_t const, symbols, aliased);
+		if (target_symbol == NULL || target_symbol->section == NULL)
+			panic("alias %+F to undefined %+F not supported in ELF object files",
+			      entity, aliased);
+		define_symbol(entity, target_symbol->section, target_symbol->value,
+		              target_symbol->size, target_symbol->type);
+	}
+}
+
+static uint8_t get_symbol_binding(elf_symbol_t const *const symbol)
+{
+	ir_entity const *const entity = symbol->entity;
+	if (get_entity_linkage(entity) & IR_LINKAGE_WEAK)
+		return ELF_STB_WEAK;
+	/* undefined symbols must be global */
+	if (symbol->section == NULL)
+		return ELF_STB_GLOBAL;
+	switch (get_entity_visibility(entity)) {
+	case ir_visibility_external:
+	case ir_visibility_external_private:
+	case ir_visibility_external_protected:
+		return ELF_STB_GLOBAL;
+	case ir_visibility_local:
+	case ir_visibility_private:
+		return ELF_STB_LOCAL;
+	}
+	panic("invalid visibility");
+}
+
+static uint8_t get_symbol_visibility(ir_entity const *const entity)
+{
+	switch (get_entity_visibility(entity)) {
+	case ir_visibility_external_private:   return ELF_STV_HIDDEN;
+	case ir_visibility_external_protected: return ELF_STV_PROTECTED;
+	default:                               return ELF_STV_DEFAULT;
+	}
+}
+
+static void write_bytes(void const *const data, size_t const size)
+{
+	fwrite(data, 1, size, output);
+	output_pos += size;
+}
+
+static void write_u8(uint8_t const value)
+{
+	write_bytes(&value, 1);
+}
+
+static void write_u16(uint16_t const value)
+{
+	char buffer[2];
+	write_int(buffer, value, sizeof(buffer));
+	write_bytes(buffer, sizeof(buffer));
+}
+
+static void write_u32(uint32_t const value)
+{
+	char buffer[4];
+	write_int(buffer, value, sizeof(buffer));
+	write_bytes(buffer, sizeof(buffer));
+}
+
+static void write_u64(uint64_t const value)
+{
+	char buffer[8];
+	write_int(buffer, value, sizeof(buffer));
+	write_bytes(buffer, sizeof(buffer));
+}
+
+/** Writes an address, offset or size field of the file class. */
+static void write_word(uint64_t const value)
+{
+	if (target->elf64) {
+		write_u64(value);
+	} else {
+		write_u32(value);
+	}
+}
+
+static void write_padding(unsigned const offset)
+{
+	assert(output_pos <= offset);
+	while (output_pos < offset) {
+		write_u8(0);
+	}
+}
+
+typedef enum elf_contents_t {
+	CONTENTS_NONE,
+	CONTENTS_SECTION,
+	CONTENTS_RELOCATIONS,
+	CONTENTS_SYMTAB,
+	CONTENTS_STRTAB,
+	CONTENTS_SHSTRTAB,
+} elf_contents_t;
+
+typedef struct elf_header_t {
+	elf_contents_t contents;
+	elf_section_t *section;
+	uint32_t       name;
+	uint32_t       type;
+	uint32_t       flags;
+	unsigned       offset;
+	unsigned       size;
+	uint32_t       link;
+	uint32_t       info;
+	unsigned       alignment;
+	unsigned       entsize;
+} elf_header_t;
+
+static uint32_t add_string(struct obstack *const strings,
+                           char const *const prefix, char const *const str)
+{
+	uint32_t const offset = obstack_object_size(strings);
+	obstack_grow(strings, prefix, strlen(prefix));
+	obstack_grow0(strings, str, strlen(str));
+	return offset;
+}
+
+static void write_relocations(elf_section_t const *const section)
+{
+	for (size_t i = 0, n = ARR_LEN(section->relocations); i < n; ++i) {
+		elf_relocation_t const *const relocation = &section->relocations[i];
+		elf_symbol_t     const *const symbol
+			= pmap_get(elf_symbol_t const, symbols, relocation->entity);
+		write_word(relocation->offset);
+		if (target->elf64) {
+			write_u64((uint64_t)symbol->index << 32 | relocation->type);
+		} else {
+			write_u32(symbol->index << 8 | (relocation->type & 0xFF));
+		}
+		if (target->rela)
+			write_word(relocation->addend);
+	}
+}
+
+static void write_symbol(elf_symbol_t const *const symbol)
+{
+	uint8_t const info  = get_symbol_binding(symbol) << 4 | symbol->type;
+	uint8_t const other = get_symbol_visibility(symbol->entity);
+	uint16_t const shndx
+		= symbol->common         ? ELF_SHN_COMMON
+		: symbol->section != NULL ? symbol->section->index
+		: 0;
+	if (target->elf64) {
+		write_u32(symbol->name);
+		write_u8(info);
+		write_u8(other);
+		write_u16(shndx);
+		write_u64(symbol->value);
+		write_u64(symbol->size);
+	} else {
+		write_u32(symbol->name);
+		write_u32(symbol->value);
+		write_u32(symbol->size);
+		write_u8(info);
+		write_u8(other);
+		write_u16(shndx);
+	}
+}
+
+static void write_object_file(void)
+{
+	bool     const elf64      = target->elf64;
+	unsigned const word_size  = elf64 ? 8 : 4;
+	unsigned const ehdr_size  = elf64 ? 64 : 52;
+	unsigned const shdr_size  = elf64 ? 64 : 40;
+	unsigned const sym_size   = elf64 ? 24 : 16;
+	unsigned const rel_size   = (target->rela ? 3 : 2) * word_size;
+
+	/* Local symbols have to precede the global ones. */
+	struct obstack strtab;
+	obstack_init(&strtab);
+	obstack_1grow(&strtab, '\0');
+	size_t const n_symbols = ARR_LEN(symbol_list);
+	elf_symbol_t **const sorted = XMALLOCN(elf_symbol_t*, n_symbols);
+	unsigned n_sorted = 0;
+	for (int local = 1; local >= 0; --local) {
+		for (size_t i = 0; i < n_symbols; ++i) {
+			elf_symbol_t *const symbol = symbol_list[i];
+			if ((get_symbol_binding(symbol) == ELF_STB_LOCAL) != local)
+				continue;
+			symbol->index = n_sorted + 1;
+			sorted[n_sorted++] = symbol;
+
+			ir_entity const *const entity = symbol->entity;
+			char const *const name   = get_entity_ld_name(entity);
+			char const *const prefix
+				= get_entity_visibility(entity) == ir_visibility_private
+				? be_gas_get_private_prefix() : "";
+			symbol->name = add_string(&strtab, prefix, name);
+		}
+	}
+	unsigned n_locals = 1;
+	while (n_locals <= n_sorted
+	    && get_symbol_binding(sorted[n_locals - 1]) == ELF_STB_LOCAL)
+		++n_locals;
+
+	/* Collect the section headers. */
+	struct obstack shstrtab;
+	obstack_init(&shstrtab);
+	obstack_1grow(&shstrtab, '\0');
+	elf_header_t *headers = NEW_ARR_F(elf_header_t, 0);
+	elf_header_t const null_header = { .contents = CONTENTS_NONE };
+	ARR_APP1(elf_header_t, headers, null_header);
+	for (size_t i = 0; i < ARRAY_SIZE(sections); ++i) {
+		elf_section_t *const section = &sections[i];
+		if (section->name == NULL
+		 || (section->size == 0 && i != GAS_SECTION_TEXT))
+			continue;
+		section->index = ARR_LEN(headers);
+		elf_header_t const header = {
+			.contents  = section->type == ELF_SHT_NOBITS ? CONTENTS_NONE
+			                                             : CONTENTS_SECTION,
+			.section   = section,
+			.name      = add_string(&shstrtab, "", section->name),
+			.type      = section->type,
+			.flags     = section->flags,
+			.size      = section->size,
+			.alignment = section->alignment,
+			.entsize   = be_gas_get_section_entsize(i),
+		};
+		ARR_APP1(elf_header_t, headers, header);
+	}
+	for (size_t i = 0, n_sections = ARR_LEN(headers); i < n_sections; ++i) {
+		elf_section_t *const section = headers[i].section;
+		if (section == NULL || ARR_LEN(section->relocations) == 0)
+			continue;
+		char const *const prefix = target->rela ? ".rela" : ".rel";
+		elf_header_t const header = {
+			.contents  = CONTENTS_RELOCATIONS,
+			.section   = section,
+			.name      = add_string(&shstrtab, prefix, section->name),
+			.type      = target->rela ? ELF_SHT_RELA : ELF_SHT_REL,
+			.flags     = ELF_SHF_INFO_LINK,
+			.size      = ARR_LEN(section->relocations) * rel_size,
+			.link      = 0, /* the symbol table, set below */
+			.info      = section->index,
+			.alignment = word_size,
+			.entsize   = rel_size,
+		};
+		ARR_APP1(elf_header_t, headers, header);
+	}
+	unsigned const symtab = ARR_LEN(headers);
+	elf_header_t const symtab_header = {
+		.contents  = CONTENTS_SYMTAB,
+		.name      = add_string(&shstrtab, "", ".symtab"),
+		.type      = ELF_SHT_SYMTAB,
+		.size      = (n_sorted + 1) * sym_size,
+		.link      = symtab + 1,
+		.info      = n_locals,
+		.alignment = word_size,
+		.entsize   = sym_size,
+	};
+	ARR_APP1(elf_header_t, headers, symtab_header);
+	elf_header_t const strtab_header = {
+		.contents  = CONTENTS_STRTAB,
+		.name      = add_string(&shstrtab, "", ".strtab"),
+		.type      = ELF_SHT_STRTAB,
+		.size      = obstack_object_size(&strtab),
+		.alignment = 1,
+	};
+	ARR_APP1(elf_header_t, headers, strtab_header);
+	elf_header_t shstrtab_header = {
+		.contents  = CONTENTS_SHSTRTAB,
+		.name      = add_string(&shstrtab, "", ".shstrtab"),
+		.type      = ELF_SHT_STRTAB,
+		.alignment = 1,
+	};
+	shstrtab_header.size = obstack_object_size(&shstrtab);
+	ARR_APP1(elf_header_t, headers, shstrtab_header);
+	char const *const strtab_data   = obstack_finish(&strtab);
+	char const *const shstrtab_data = obstack_finish(&shstrtab);
+
+	/* Lay out the file. */
+	size_t   const n_headers = ARR_LEN(headers);
+	unsigned       offset    = ehdr_size;
+	for (size_t i = 1; i < n_headers; ++i) {
+		elf_header_t *const header = &headers[i];
+		if (header->type == ELF_SHT_REL || header->type == ELF_SHT_RELA)
+			header->link = symtab;
+		offset         = round_up2(offset, header->alignment);
+		header->offset = offset;
+		if (header->contents != CONTENTS_NONE)
+			offset += header->size;
+	}
+	unsigned const shoff = round_up2(offset, word_size);
+
+	/* ELF header */
+	static char const magic[] = { 0x7F, 'E', 'L', 'F' };
+	write_bytes(magic, sizeof(magic));
+	write_u8(elf64 ? ELF_CLASS64 : ELF_CLASS32);
+	write_u8(ELF_DATA2LSB);
+	write_u8(ELF_EV_CURRENT);
+	write_padding(16);
+	write_u16(ELF_ET_REL);
+	write_u16(target->machine);
+	write_u32(ELF_EV_CURRENT);
+	write_word(0); /* entry */
+	write_word(0); /* program headers */
+	write_word(shoff);
+	write_u32(0);  /* flags */
+	write_u16(ehdr_size);
+	write_u16(0);  /* program header size */
+	write_u16(0);  /* number of program headers */
+	write_u16(shdr_size);
+	write_u16(n_headers);
+	write_u16(n_headers - 1);
+
+	/* contents */
+	for (size_t i = 1; i < n_headers; ++i) {
+		elf_header_t const *const header = &headers[i];
+		if (header->contents == CONTENTS_NONE)
+			continue;
+		write_padding(header->offset);
+		switch (header->contents) {
+		case CONTENTS_NONE:
+			break;
+		case CONTENTS_SECTION:
+			write_bytes(header->section->data, header->size);
+			break;
+		case CONTENTS_RELOCATIONS:
+			write_relocations(header->section);
+			break;
+		case CONTENTS_SYMTAB:
+			/* the first symbol is the undefined one */
+			write_padding(output_pos + sym_size);
+			for (unsigned s = 0; s < n_sorted; ++s) {
+				write_symbol(sorted[s]);
+			}
+			break;
+		case CONTENTS_STRTAB:
+			write_bytes(strtab_data, header->size);
+			break;
+		case CONTENTS_SHSTRTAB:
+			write_bytes(shstrtab_data, header->size);
+			break;
+		}
+	}
+
+	/* section headers */
+	write_padding(shoff);
+	for (size_t i = 0; i < n_headers; ++i) {
+		elf_header_t const *const header = &headers[i];
+		write_u32(header->name);
+		write_u32(header->type);
+		write_word(header->flags);
+		write_word(0); /* address */
+		write_word(header->offset);
+		write_word(header->size);
+		write_u32(header->link);
+		write_u32(header->info);
+		write_word(header->alignment);
+		write_word(header->entsize);
+	}
+
+	DEL_ARR_F(headers);
+	obstack_free(&shstrtab, NULL);
+	obstack_free(&strtab, NULL);
+	xfree(sorted);
+}
+
+void be_elf_end_compilation_unit(be_main_env_t const *const env)
+{
+	define_globals(get_glob_type(), env);
+	define_globals(get_tls_type(), env);
+	define_globals(get_segment_type(IR_SEGMENT_CONSTRUCTORS), env);
+	define_globals(get_segment_type(IR_SEGMENT_DESTRUCTORS), env);
+	define_globals(get_segment_type(IR_SEGMENT_JCR), env);
+	resolve_aliases();
+
+	write_object_file();
+
+	for (size_t i = 0; i < ARRAY_SIZE(sections); ++i) {
+		elf_section_t *const section = &sections[i];
+		if (section->name == NULL)
+			continue;
+		DEL_ARR_F(section->data);
+		DEL_ARR_F(section->relocations);
+	}
+	DEL_ARR_F(aliases);
+	pmap_destroy(constant_pool);
+	DEL_ARR_F(symbol_list);
+	pmap_destroy(symbols);
+	obstack_free(&obst, NULL);
+	target       = NULL;
+	output       = NULL;
+	code_section = NULL;
+}
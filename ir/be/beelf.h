@@ -0,0 +1,73 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Writes ELF relocatable object files.
+ *
+ * The code of the functions is produced by the binary encoders of a backend
+ * (see bejit.h), the global variables and constants are laid out from their
+ * initializers.  Everything is collected in memory and written in a single
+ * pass when the compilation unit ends.
+ */
+#ifndef FIRM_BE_BEELF_H
+#define FIRM_BE_BEELF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "be_types.h"
+#include "firm_types.h"
+
+/** Target description for the ELF writer. */
+typedef struct be_elf_target_t {
+	uint16_t machine;   /**< ELF machine number */
+	bool     elf64;     /**< write ELFCLASS64 instead of ELFCLASS32 files */
+	bool     rela;      /**< relocations carry explicit addends */
+	uint32_t reloc_abs; /**< relocation type of pointer sized data */
+	/** create @p size bytes of NOP instructions for alignment */
+	void   (*nops)(char *buffer, unsigned size);
+} be_elf_target_t;
+
+/**
+ * Writes an ELF object file for @p target instead of assembler for the next
+ * compilation unit.  Must be called before be_begin().
+ */
+void be_elf_select_target(be_elf_target_t const *target);
+
+/**
+ * Returns true if an ELF object file is written for the current compilation
+ * unit.
+ */
+bool be_elf_is_selected(void);
+
+/**
+ * Starts the object file of a compilation unit written to @p output.
+ */
+void be_elf_begin_compilation_unit(FILE *output);
+
+/**
+ * Lays out the global entities and writes the object file.
+ */
+void be_elf_end_compilation_unit(be_main_env_t const *env);
+
+/**
+ * Defines the function @p entity in the text section aligned to
+ * 2^@p p2alignment bytes and returns a buffer for its @p size bytes of code.
+ * The buffer is valid until the next call of be_elf_begin_function().
+ */
+char *be_elf_begin_function(ir_entity const *entity, unsigned p2alignment,
+                            unsigned size);
+
+/**
+ * Records a relocation of type @p type to @p entity at @p location in the
+ * buffer returned by be_elf_begin_function().  With REL relocations the
+ * caller has to store @p addend at @p location itself.
+ */
+void be_elf_relocation(char const *location, uint32_t type,
+                       ir_entity const *entity, int64_t addend);
+
+#endif
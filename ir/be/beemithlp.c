@@ -16,6 +16,7 @@
 #include "benode.h"
 #include "dbginfo.h"
 #include "debug.h"
+#include "execfreq.h"
 #include "firm_types.h"
 #include "irnode_t.h"
 #include "irop_t.h"
@@ -68,3 +69,36 @@ void be_emit_init_cf_links(ir_node *const *const block_schedule)
 		prev = block;
 	}
 }
+
+bool be_emit_should_align_block(ir_node const *const block,
+                                double const jump_factor, double const min_freq)
+{
+	/* the first block starts at the aligned function entry */
+	ir_node const *const prev = be_emit_get_prev_block(block);
+	if (prev == NULL)
+		return false;
+
+	double const block_freq = get_block_execfreq(block);
+	if (block_freq < min_freq)
+		return false;
+
+	int    const n_preds   = get_Block_n_cfgpreds(block);
+	double       fall_freq = 0.0; /* executions of the padding */
+	double       jmp_freq  = 0.0; /* jumps to the aligned label */
+	for (int i = 0; i < n_preds; ++i) {
+		ir_node const *const pred = get_Block_cfgpred_block(block, i);
+		/* critical edges are split, so a predecessor with several successors
+		 * is the only predecessor */
+		double const edge_freq = n_preds == 1 ? block_freq
+		                                      : get_block_execfreq(pred);
+		if (pred == prev) {
+			fall_freq += edge_freq;
+		} else {
+			jmp_freq += edge_freq;
+		}
+	}
+	/* without a fallthrough the padding only costs code size */
+	if (fall_freq == 0.0)
+		return true;
+	return jmp_freq > jump_factor * fall_freq;
+}
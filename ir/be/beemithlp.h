@@ -71,4 +71,14 @@ static inline ir_node *be_emit_get_prev_block(ir_node const *const block)
 	return (ir_node*)get_irn_link(block);
 }
 
+/**
+ * Returns true if aligning @p block is expected to pay off: The block must be
+ * executed at least @p min_freq times per function call and must be entered
+ * by jumps at least @p jump_factor times as often as by falling through the
+ * alignment padding from the previous block.
+ * Requires a prior call to be_emit_init_cf_links().
+ */
+bool be_emit_should_align_block(ir_node const *block, double jump_factor,
+                                double min_freq);
+
 #endif
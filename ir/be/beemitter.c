@@ -11,11 +11,21 @@
  */
 #include "beemitter.h"
 
+#include <assert.h>
+#include <string.h>
+
 #include "panic.h"
 #include "irprintf.h"
 
+/** Size of the buffer collecting finished lines before they are written. */
+#define EMIT_BUFFER_SIZE (64 * 1024)
+
 static FILE    *emit_file;
 struct obstack  emit_obst;
+static char     emit_buffer[EMIT_BUFFER_SIZE];
+static size_t   emit_buffer_len;
+static struct obstack *capture_obst;
+static struct obstack *buffer_obst;
 
 void be_emit_init(FILE *file)
 {
@@ -25,9 +35,53 @@ void be_emit_init(FILE *file)
 
 void be_emit_exit(void)
 {
+	be_emit_flush();
 	obstack_free(&emit_obst, NULL);
 }
 
+void be_emit_uint(uint64_t value)
+{
+	char  buf[20];
+	char *end = buf + sizeof(buf);
+	char *pos = end;
+	do {
+		*--pos = '0' + value % 10;
+		value /= 10;
+	} while (value != 0);
+	be_emit_string_len(pos, end - pos);
+}
+
+void be_emit_int(int64_t value)
+{
+	if (value < 0) {
+		be_emit_char('-');
+		be_emit_uint(-(uint64_t)value);
+	} else {
+		be_emit_uint(value);
+	}
+}
+
+void be_emit_int_with_sign(int64_t value)
+{
+	if (value >= 0)
+		be_emit_char('+');
+	be_emit_int(value);
+}
+
+void be_emit_hex(uint64_t value)
+{
+	static char const digits[] = "0123456789ABCDEF";
+
+	char  buf[16];
+	char *end = buf + sizeof(buf);
+	char *pos = end;
+	do {
+		*--pos = digits[value & 0xF];
+		value >>= 4;
+	} while (value != 0);
+	be_emit_string_len(pos, end - pos);
+}
+
 void be_emit_irvprintf(const char *fmt, va_list args)
 {
 	ir_obst_vprintf(&emit_obst, fmt, args);
@@ -41,10 +95,67 @@ void be_emit_irprintf(const char *fmt, ...)
 	va_end(ap);
 }
 
+void be_emit_flush(void)
+{
+	fwrite(emit_buffer, 1, emit_buffer_len, emit_file);
+	emit_buffer_len = 0;
+}
+
+/** Appends @p len bytes at @p data to the output. */
+static void write_data(char const *data, size_t len)
+{
+	if (emit_buffer_len + len > EMIT_BUFFER_SIZE) {
+		be_emit_flush();
+		if (len > EMIT_BUFFER_SIZE) {
+			fwrite(data, 1, len, emit_file);
+			return;
+		}
+	}
+	memcpy(emit_buffer + emit_buffer_len, data, len);
+	emit_buffer_len += len;
+}
+
 void be_emit_write_line(void)
 {
 	size_t const len  = obstack_object_size(&emit_obst);
 	char  *const line = (char*)obstack_finish(&emit_obst);
-	fwrite(line, 1, len, emit_file);
+	if (capture_obst != NULL)
+		obstack_grow(capture_obst, line, len);
+	if (buffer_obst != NULL)
+		obstack_grow(buffer_obst, line, len);
+	else
+		write_data(line, len);
 	obstack_free(&emit_obst, line);
 }
+
+void be_emit_begin_capture(struct obstack *obst)
+{
+	assert(capture_obst == NULL);
+	assert(obstack_object_size(&emit_obst) == 0);
+	capture_obst = obst;
+}
+
+void be_emit_end_capture(void)
+{
+	assert(obstack_object_size(&emit_obst) == 0);
+	capture_obst = NULL;
+}
+
+void be_emit_begin_buffer(struct obstack *obst)
+{
+	assert(buffer_obst == NULL);
+	assert(obstack_object_size(&emit_obst) == 0);
+	buffer_obst = obst;
+}
+
+void be_emit_end_buffer(void)
+{
+	assert(obstack_object_size(&emit_obst) == 0);
+	buffer_obst = NULL;
+}
+
+void be_emit_write_buffer(char const *data, size_t len)
+{
+	assert(buffer_obst == NULL);
+	write_data(data, len);
+}
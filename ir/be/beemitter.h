@@ -15,6 +15,7 @@
 #ifndef FIRM_BE_BEEMITTER_H
 #define FIRM_BE_BEEMITTER_H
 
+#include <stdint.h>
 #include <stdio.h>
 #include "obst.h"
 
@@ -59,6 +60,28 @@ static inline void be_emit_string(const char *str)
 #define be_emit_cstring(str) \
 	be_emit_string_len(str, sizeof(str) - 1)
 
+/**
+ * Emit a signed integer in decimal notation.
+ */
+void be_emit_int(int64_t value);
+
+/**
+ * Emit a signed integer in decimal notation with an explicit sign, like the
+ * printf format "%+d".
+ */
+void be_emit_int_with_sign(int64_t value);
+
+/**
+ * Emit an unsigned integer in decimal notation.
+ */
+void be_emit_uint(uint64_t value);
+
+/**
+ * Emit an unsigned integer in hexadecimal notation with upper case digits and
+ * without prefix, like the printf format "%X".
+ */
+void be_emit_hex(uint64_t value);
+
 /**
  * Initializes an emitter environment.
  *
@@ -86,10 +109,47 @@ void be_emit_irprintf(const char *fmt, ...);
 void be_emit_irvprintf(const char *fmt, va_list args);
 
 /**
- * Flush the line in the current line buffer to the emitter file.
+ * Finish the line in the current line buffer. Finished lines are collected in
+ * an output buffer, which is written to the emitter file when it is full or
+ * by be_emit_flush().
  */
 void be_emit_write_line(void);
 
+/**
+ * Write all finished lines to the emitter file. Needed before anything else
+ * writes to the file.
+ */
+void be_emit_flush(void);
+
+/**
+ * Starts collecting a copy of all lines finished from now on in @p obst.
+ * No line may be in progress.
+ */
+void be_emit_begin_capture(struct obstack *obst);
+
+/**
+ * Stops collecting lines started with be_emit_begin_capture().
+ */
+void be_emit_end_capture(void);
+
+/**
+ * Collects all lines finished from now on in @p obst instead of writing them
+ * to the emitter file, so the output of a graph can be produced on its own.
+ * No line may be in progress.
+ */
+void be_emit_begin_buffer(struct obstack *obst);
+
+/**
+ * Stops collecting lines started with be_emit_begin_buffer().
+ */
+void be_emit_end_buffer(void);
+
+/**
+ * Writes @p len bytes at @p data, usually the lines collected by
+ * be_emit_begin_buffer(), to the emitter file.
+ */
+void be_emit_write_buffer(char const *data, size_t len);
+
 /** Return column in current line. Counting starts at 0. */
 static inline size_t be_emit_get_column(void)
 {
@@ -0,0 +1,311 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Structural fingerprints of graphs.
+ */
+#include "befingerprint.h"
+
+#include <string.h>
+
+#include "array.h"
+#include "be_t.h"
+#include "entity_t.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irmode_t.h"
+#include "irnode_t.h"
+#include "tv.h"
+#include "typerep.h"
+#include "util.h"
+
+static void key_u32(struct obstack *const obst, uint32_t const value)
+{
+	obstack_grow(obst, &value, sizeof(value));
+}
+
+static void key_str(struct obstack *const obst, char const *const str)
+{
+	obstack_grow(obst, str, strlen(str) + 1);
+}
+
+static void key_mode(struct obstack *const obst, ir_mode *const mode)
+{
+	if (mode == NULL) {
+		key_str(obst, "");
+		return;
+	}
+	key_str(obst, get_mode_name(mode));
+	key_u32(obst, get_mode_sort(mode));
+	key_u32(obst, get_mode_size_bits(mode));
+	key_u32(obst, mode_is_signed(mode));
+	if (mode_is_vector(mode))
+		key_mode(obst, get_mode_vector_element_mode(mode));
+}
+
+static void key_tarval(struct obstack *const obst, ir_tarval *const tv)
+{
+	ir_mode *const mode = get_tarval_mode(tv);
+	key_mode(obst, mode);
+	if (get_mode_arithmetic(mode) == irma_none && !mode_is_vector(mode)) {
+		key_u32(obst, tv == tarval_b_true);
+		return;
+	}
+	for (unsigned i = 0, n = get_mode_size_bytes(mode); i < n; ++i) {
+		obstack_1grow(obst, get_tarval_sub_bits(tv, i));
+	}
+}
+
+static void key_type(struct obstack *obst, ir_type *type);
+
+static void key_entity(struct obstack *const obst,
+                       ir_entity const *const entity)
+{
+	key_str(obst, get_id_str(get_entity_ld_ident(entity)));
+	key_u32(obst, get_entity_kind(entity));
+	if (is_global_entity(entity)) {
+		key_u32(obst, get_entity_visibility(entity));
+		key_u32(obst, get_entity_linkage(entity));
+		key_type(obst, get_entity_type(entity));
+	} else {
+		/* frame entities and compound members */
+		key_u32(obst, is_parameter_entity(entity)
+		              ? get_entity_parameter_number(entity) : (size_t)-1);
+		key_u32(obst, get_entity_offset(entity));
+		key_type(obst, get_entity_type(entity));
+	}
+}
+
+/** Describes the layout of @p type, compound members are not followed. */
+static void key_type(struct obstack *const obst, ir_type *const type)
+{
+	tp_opcode const opcode = get_type_opcode(type);
+	key_u32(obst, opcode);
+	key_u32(obst, get_type_size(type));
+	key_u32(obst, get_type_alignment(type));
+	switch (opcode) {
+	case tpo_primitive:
+	case tpo_pointer:
+		key_mode(obst, get_type_mode(type));
+		return;
+	case tpo_array:
+		key_type(obst, get_array_element_type(type));
+		return;
+	case tpo_method:
+		key_u32(obst, get_method_calling_convention(type));
+		key_u32(obst, get_method_additional_properties(type));
+		key_u32(obst, is_method_variadic(type));
+		key_u32(obst, get_method_n_params(type));
+		for (size_t i = 0, n = get_method_n_params(type); i < n; ++i) {
+			key_type(obst, get_method_param_type(type, i));
+		}
+		key_u32(obst, get_method_n_ress(type));
+		for (size_t i = 0, n = get_method_n_ress(type); i < n; ++i) {
+			key_type(obst, get_method_res_type(type, i));
+		}
+		return;
+	case tpo_struct:
+	case tpo_union:
+	case tpo_class:
+	case tpo_segment:
+		key_u32(obst, get_compound_n_members(type));
+		for (size_t i = 0, n = get_compound_n_members(type); i < n; ++i) {
+			ir_entity *const member = get_compound_member(type, i);
+			key_u32(obst, get_entity_offset(member));
+			key_u32(obst, get_type_size(get_entity_type(member)));
+		}
+		return;
+	default:
+		return;
+	}
+}
+
+static unsigned get_node_index(ir_node const *const node)
+{
+	return PTR_TO_INT(get_irn_link(node));
+}
+
+static void number_node(ir_node *const node, void *const data)
+{
+	ir_node ***const nodes = (ir_node***)data;
+	ARR_APP1(ir_node*, *nodes, node);
+	set_irn_link(node, INT_TO_PTR(ARR_LEN(*nodes) - 1));
+}
+
+/** Describes the attributes of @p node, returns false for opcodes which
+ * cannot be fingerprinted. */
+static bool key_attributes(struct obstack *const obst, ir_node const *const node)
+{
+	switch (get_irn_opcode(node)) {
+	case iro_Add:
+	case iro_Anchor:
+	case iro_And:
+	case iro_Bad:
+	case iro_Bitcast:
+	case iro_Conv:
+	case iro_Deleted:
+	case iro_Dummy:
+	case iro_End:
+	case iro_Eor:
+	case iro_Free:
+	case iro_Id:
+	case iro_IJmp:
+	case iro_Jmp:
+	case iro_Minus:
+	case iro_Mul:
+	case iro_Mulh:
+	case iro_Mux:
+	case iro_NoMem:
+	case iro_Not:
+	case iro_Or:
+	case iro_Pin:
+	case iro_Raise:
+	case iro_Return:
+	case iro_Shl:
+	case iro_Shr:
+	case iro_Shrs:
+	case iro_Start:
+	case iro_Sub:
+	case iro_Sync:
+	case iro_Tuple:
+	case iro_Unknown:
+		return true;
+	case iro_Address:
+		key_entity(obst, get_Address_entity(node));
+		return true;
+	case iro_Offset:
+		key_entity(obst, get_Offset_entity(node));
+		return true;
+	case iro_Member:
+		key_entity(obst, get_Member_entity(node));
+		return true;
+	case iro_Align:
+		key_type(obst, get_Align_type(node));
+		return true;
+	case iro_Size:
+		key_type(obst, get_Size_type(node));
+		return true;
+	case iro_Alloc:
+		key_u32(obst, get_Alloc_alignment(node));
+		return true;
+	case iro_Block: {
+		ir_entity const *const entity = get_Block_entity(node);
+		key_u32(obst, entity != NULL);
+		if (entity != NULL)
+			key_entity(obst, entity);
+		return true;
+	}
+	case iro_Builtin:
+		key_u32(obst, get_Builtin_kind(node));
+		key_type(obst, get_Builtin_type(node));
+		return true;
+	case iro_Call:
+		key_type(obst, get_Call_type(node));
+		return true;
+	case iro_Cmp:
+		key_u32(obst, get_Cmp_relation(node));
+		return true;
+	case iro_Cond:
+		key_u32(obst, get_Cond_jmp_pred(node));
+		return true;
+	case iro_Confirm:
+		key_u32(obst, get_Confirm_relation(node));
+		return true;
+	case iro_Const:
+		key_tarval(obst, get_Const_tarval(node));
+		return true;
+	case iro_CopyB:
+		key_type(obst, get_CopyB_type(node));
+		key_u32(obst, get_CopyB_volatility(node));
+		return true;
+	case iro_Div:
+		key_mode(obst, get_Div_resmode(node));
+		key_u32(obst, get_Div_no_remainder(node));
+		return true;
+	case iro_Mod:
+		key_mode(obst, get_Mod_resmode(node));
+		return true;
+	case iro_Load:
+		key_mode(obst, get_Load_mode(node));
+		key_type(obst, get_Load_type(node));
+		key_u32(obst, get_Load_volatility(node));
+		key_u32(obst, get_Load_unaligned(node));
+		return true;
+	case iro_Store:
+		key_type(obst, get_Store_type(node));
+		key_u32(obst, get_Store_volatility(node));
+		key_u32(obst, get_Store_unaligned(node));
+		return true;
+	case iro_Phi:
+		key_u32(obst, get_Phi_loop(node));
+		return true;
+	case iro_Proj:
+		key_u32(obst, get_Proj_num(node));
+		return true;
+	case iro_Sel:
+		key_type(obst, get_Sel_type(node));
+		return true;
+	case iro_Switch: {
+		ir_switch_table const *const table = get_Switch_table(node);
+		size_t                 const n     = ir_switch_table_get_n_entries(table);
+		key_u32(obst, get_Switch_n_outs(node));
+		key_u32(obst, n);
+		for (size_t i = 0; i < n; ++i) {
+			ir_tarval *const min = ir_switch_table_get_min(table, i);
+			key_u32(obst, min != NULL);
+			if (min == NULL)
+				continue;
+			key_tarval(obst, min);
+			key_tarval(obst, ir_switch_table_get_max(table, i));
+			key_u32(obst, ir_switch_table_get_pn(table, i));
+		}
+		return true;
+	}
+	default:
+		/* inline assembler and backend nodes */
+		return false;
+	}
+}
+
+bool be_fingerprint_graph(struct obstack *const obst, ir_graph *const irg)
+{
+	key_str(obst, be_get_parsed_args());
+	key_entity(obst, get_irg_entity(irg));
+	key_type(obst, get_entity_type(get_irg_entity(irg)));
+	ir_type *const frame = get_irg_frame_type(irg);
+	key_u32(obst, get_compound_n_members(frame));
+	for (size_t i = 0, n = get_compound_n_members(frame); i < n; ++i) {
+		key_entity(obst, get_compound_member(frame, i));
+	}
+
+	ir_node **nodes = NEW_ARR_F(ir_node*, 0);
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	irg_walk_graph(irg, NULL, number_node, &nodes);
+
+	bool res = true;
+	key_u32(obst, ARR_LEN(nodes));
+	for (size_t i = 0, n = ARR_LEN(nodes); i < n && res; ++i) {
+		ir_node const *const node = nodes[i];
+		key_str(obst, get_irn_opname(node));
+		key_mode(obst, get_irn_mode(node));
+		key_u32(obst, get_irn_pinned(node));
+		if (is_fragile_op(node))
+			key_u32(obst, ir_throws_exception(node));
+		key_u32(obst, is_Block(node) ? (unsigned)-1
+		                             : get_node_index(get_nodes_block(node)));
+		int const arity = get_irn_arity(node);
+		key_u32(obst, arity);
+		for (int p = 0; p < arity; ++p) {
+			key_u32(obst, get_node_index(get_irn_n(node, p)));
+		}
+		res = key_attributes(obst, node);
+	}
+
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	DEL_ARR_F(nodes);
+	return res;
+}
+
@@ -0,0 +1,29 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Structural fingerprints of graphs.
+ */
+#ifndef FIRM_BE_BEFINGERPRINT_H
+#define FIRM_BE_BEFINGERPRINT_H
+
+#include <stdbool.h>
+
+#include "firm_types.h"
+#include "obst.h"
+
+/**
+ * Appends a fingerprint of @p irg to @p obst.  The nodes are numbered in walk
+ * order and written with their opcode, mode, inputs and attributes, entities
+ * are described by their linker names and types by their layout.  The
+ * backend arguments are part of the fingerprint, too.
+ *
+ * @return false if the graph contains nodes which cannot be described, like
+ *         inline assembler or backend nodes
+ */
+bool be_fingerprint_graph(struct obstack *obst, ir_graph *irg);
+
+#endif
@@ -0,0 +1,322 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Profile guided function ordering.
+ *
+ * Implements the call-chain clustering heuristic (C3) from Ottoni and Maher,
+ * "Optimizing Function Placement for Large-Scale Data-Center Applications".
+ * Functions are visited in order of decreasing execution count and the
+ * cluster of each function is appended to the cluster of its most frequent
+ * caller, unless the merged cluster would exceed a page. The clusters are
+ * finally ordered by decreasing density. Placing callers and callees close to
+ * each other reduces the number of pages and iTLB entries used by the hot
+ * code.
+ */
+#include "befuncorder.h"
+
+#include <stdint.h>
+
+#include "array.h"
+#include "bemodule.h"
+#include "debug.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "irprofile.h"
+#include "irprog_t.h"
+#include "irtools.h"
+#include "lc_opts.h"
+#include "pmap.h"
+#include "util.h"
+#include "xmalloc.h"
+
+/** Estimated code size of a node in bytes. */
+#define FUNC_NODE_SIZE        4
+/** Clusters are not merged beyond this size in bytes. */
+#define FUNC_MAX_CLUSTER_SIZE 4096
+/** Clusters are not merged if the density of the caller cluster would drop
+ * by more than this factor. */
+#define FUNC_MAX_DENSITY_DROP 8.0
+/** Functions whose hottest block is executed at least this fraction of the
+ * hottest block of the program are hot. */
+#define FUNC_HOT_RATIO        0.01
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
+
+typedef struct func_cluster_t func_cluster_t;
+
+typedef struct func_t func_t;
+struct func_t {
+	ir_graph       *irg;
+	uint64_t        samples;      /**< sum of the block execution counts */
+	uint32_t        max_count;    /**< highest block execution count */
+	bool            has_profile;  /**< profile data exists for the function */
+	unsigned        size;         /**< estimated code size in bytes */
+	func_t         *caller;       /**< most frequent caller */
+	uint64_t        caller_count; /**< number of calls from caller */
+	func_cluster_t *cluster;
+};
+
+struct func_cluster_t {
+	func_t   **funcs; /**< functions of the cluster in layout order */
+	uint64_t   samples;
+	unsigned   size;
+};
+
+typedef struct call_edge_t {
+	func_t   *caller;
+	func_t   *callee;
+	uint64_t  count;
+} call_edge_t;
+
+typedef struct collect_env_t {
+	func_t       *func;
+	pmap         *func_map;
+	call_edge_t **edges;
+} collect_env_t;
+
+static bool  order_functions = true;
+static pmap *placements;
+
+static const lc_opt_table_entry_t be_funcorder_options[] = {
+	LC_OPT_ENT_BOOL("funcorder", "order functions by profiled calls and place hot and cold functions in separate sections", &order_functions),
+	LC_OPT_LAST
+};
+
+static void collect_node(ir_node *node, void *data)
+{
+	collect_env_t *env  = (collect_env_t*)data;
+	func_t        *func = env->func;
+	func->size += FUNC_NODE_SIZE;
+
+	uint32_t count;
+	if (is_Block(node)) {
+		if (ir_profile_find_block_execcount(node, &count)) {
+			func->has_profile = true;
+			func->samples    += count;
+			func->max_count   = MAX(func->max_count, count);
+		}
+	} else if (is_Call(node)) {
+		ir_entity *const callee = get_Call_callee(node);
+		if (callee == NULL || !is_method_entity(callee))
+			return;
+		ir_graph *const callee_irg = get_entity_irg(callee);
+		if (callee_irg == NULL)
+			return;
+		func_t *const callee_func = pmap_get(func_t, env->func_map, callee_irg);
+		if (callee_func == NULL
+		    || !ir_profile_find_block_execcount(get_nodes_block(node), &count)
+		    || count == 0)
+			return;
+		call_edge_t const edge = { func, callee_func, count };
+		ARR_APP1(call_edge_t, *env->edges, edge);
+	}
+}
+
+static int cmp_call_edge(const void *d1, const void *d2)
+{
+	const call_edge_t *e1 = (const call_edge_t*)d1;
+	const call_edge_t *e2 = (const call_edge_t*)d2;
+	if (e1->callee != e2->callee)
+		return e1->callee < e2->callee ? -1 : 1;
+	if (e1->caller != e2->caller)
+		return e1->caller < e2->caller ? -1 : 1;
+	return 0;
+}
+
+static int cmp_func_samples(const void *d1, const void *d2)
+{
+	const func_t *f1 = *(const func_t**)d1;
+	const func_t *f2 = *(const func_t**)d2;
+	if (f1->samples != f2->samples)
+		return f1->samples > f2->samples ? -1 : 1;
+	return (f1 > f2) - (f1 < f2);
+}
+
+static double get_density(uint64_t samples, unsigned size)
+{
+	return (double)samples / MAX(size, 1);
+}
+
+static int cmp_cluster_density(const void *d1, const void *d2)
+{
+	const func_cluster_t *c1       = *(const func_cluster_t**)d1;
+	const func_cluster_t *c2       = *(const func_cluster_t**)d2;
+	double         const  density1 = get_density(c1->samples, c1->size);
+	double         const  density2 = get_density(c2->samples, c2->size);
+	if (density1 != density2)
+		return density1 > density2 ? -1 : 1;
+	const func_t *f1 = c1->funcs[0];
+	const func_t *f2 = c2->funcs[0];
+	return (f1 > f2) - (f1 < f2);
+}
+
+/**
+ * Determines the most frequent caller of each function from the call edges
+ * @p edges.
+ */
+static void find_callers(call_edge_t *edges)
+{
+	QSORT_ARR(edges, cmp_call_edge);
+	for (size_t i = 0, n = ARR_LEN(edges); i < n;) {
+		func_t  *const caller = edges[i].caller;
+		func_t  *const callee = edges[i].callee;
+		uint64_t       count  = 0;
+		for (; i < n && edges[i].caller == caller && edges[i].callee == callee;
+		     ++i) {
+			count += edges[i].count;
+		}
+		/* recursive calls do not influence the placement */
+		if (caller != callee && count > callee->caller_count) {
+			callee->caller       = caller;
+			callee->caller_count = count;
+		}
+	}
+}
+
+static void merge_clusters(func_cluster_t *into, func_cluster_t *from)
+{
+	for (size_t i = 0, n = ARR_LEN(from->funcs); i < n; ++i) {
+		func_t *const func = from->funcs[i];
+		func->cluster = into;
+		ARR_APP1(func_t*, into->funcs, func);
+	}
+	into->samples += from->samples;
+	into->size    += from->size;
+	ARR_SHRINKLEN(from->funcs, 0);
+	from->samples = 0;
+	from->size    = 0;
+}
+
+static be_func_placement_t classify_func(const func_t *func,
+                                         uint32_t max_count)
+{
+	if (!func->has_profile)
+		return BE_FUNC_NORMAL;
+	if (func->max_count == 0)
+		return BE_FUNC_COLD;
+	if (func->max_count >= max_count * FUNC_HOT_RATIO)
+		return BE_FUNC_HOT;
+	return BE_FUNC_NORMAL;
+}
+
+void be_order_functions(void)
+{
+	be_free_func_order();
+	if (!order_functions)
+		return;
+
+	size_t   const n_funcs  = get_irp_n_irgs();
+	func_t  *const funcs    = XMALLOCNZ(func_t, n_funcs);
+	pmap    *const func_map = pmap_create();
+	for (size_t i = 0; i < n_funcs; ++i) {
+		funcs[i].irg = get_irp_irg(i);
+		pmap_insert(func_map, funcs[i].irg, &funcs[i]);
+	}
+
+	call_edge_t  *edges = NEW_ARR_F(call_edge_t, 0);
+	collect_env_t env   = { NULL, func_map, &edges };
+	for (size_t i = 0; i < n_funcs; ++i) {
+		env.func = &funcs[i];
+		irg_walk_graph(funcs[i].irg, collect_node, NULL, &env);
+	}
+	find_callers(edges);
+	DEL_ARR_F(edges);
+	pmap_destroy(func_map);
+
+	func_cluster_t *const clusters = XMALLOCN(func_cluster_t, n_funcs);
+	func_t        **const sorted   = XMALLOCN(func_t*, n_funcs);
+	for (size_t i = 0; i < n_funcs; ++i) {
+		func_t         *const func    = &funcs[i];
+		func_cluster_t *const cluster = &clusters[i];
+		cluster->funcs    = NEW_ARR_F(func_t*, 1);
+		cluster->funcs[0] = func;
+		cluster->samples  = func->samples;
+		cluster->size     = func->size;
+		func->cluster     = cluster;
+		sorted[i]         = func;
+	}
+
+	/* append each function to the cluster of its most frequent caller */
+	qsort(sorted, n_funcs, sizeof(*sorted), cmp_func_samples);
+	for (size_t i = 0; i < n_funcs; ++i) {
+		func_t *const func   = sorted[i];
+		func_t *const caller = func->caller;
+		if (caller == NULL || caller->cluster == func->cluster)
+			continue;
+
+		func_cluster_t *const into = caller->cluster;
+		func_cluster_t *const from = func->cluster;
+		unsigned        const size = into->size + from->size;
+		if (size > FUNC_MAX_CLUSTER_SIZE)
+			continue;
+		double const density = get_density(into->samples + from->samples,
+		                                   size);
+		if (density * FUNC_MAX_DENSITY_DROP
+		    < get_density(into->samples, into->size))
+			continue;
+
+		DB((dbg, LEVEL_2, "append %+F to cluster of caller %+F\n", func->irg,
+		    caller->irg));
+		merge_clusters(into, from);
+	}
+
+	/* the densest clusters come first */
+	func_cluster_t **order = NEW_ARR_F(func_cluster_t*, 0);
+	for (size_t i = 0; i < n_funcs; ++i) {
+		if (ARR_LEN(clusters[i].funcs) > 0)
+			ARR_APP1(func_cluster_t*, order, &clusters[i]);
+	}
+	QSORT_ARR(order, cmp_cluster_density);
+
+	uint32_t const max_count = ir_profile_get_max_execcount();
+	placements = pmap_create();
+	size_t pos = 0;
+	for (size_t c = 0, n_clusters = ARR_LEN(order); c < n_clusters; ++c) {
+		func_cluster_t *const cluster = order[c];
+		for (size_t i = 0, n = ARR_LEN(cluster->funcs); i < n; ++i) {
+			func_t              *const func      = cluster->funcs[i];
+			be_func_placement_t  const placement = classify_func(func, max_count);
+			DB((dbg, LEVEL_1, "%+F (%d)\n", func->irg, (int)placement));
+			set_irp_irg(pos++, func->irg);
+			pmap_insert(placements, get_irg_entity(func->irg),
+			            (void*)(uintptr_t)placement);
+		}
+	}
+	assert(pos == n_funcs);
+
+	DEL_ARR_F(order);
+	for (size_t i = 0; i < n_funcs; ++i) {
+		DEL_ARR_F(clusters[i].funcs);
+	}
+	xfree(sorted);
+	xfree(clusters);
+	xfree(funcs);
+}
+
+be_func_placement_t be_get_func_placement(const ir_entity *entity)
+{
+	if (placements == NULL)
+		return BE_FUNC_NORMAL;
+	return (be_func_placement_t)(uintptr_t)pmap_get(void, placements, entity);
+}
+
+void be_free_func_order(void)
+{
+	if (placements != NULL) {
+		pmap_destroy(placements);
+		placements = NULL;
+	}
+}
+
+BE_REGISTER_MODULE_CONSTRUCTOR(be_init_funcorder)
+void be_init_funcorder(void)
+{
+	lc_opt_entry_t *be_grp = lc_opt_get_grp(firm_opt_get_root(), "be");
+	lc_opt_add_table(be_grp, be_funcorder_options);
+
+	FIRM_DBG_REGISTER(dbg, "firm.be.funcorder");
+}
@@ -0,0 +1,38 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Profile guided function ordering.
+ */
+#ifndef FIRM_BE_BEFUNCORDER_H
+#define FIRM_BE_BEFUNCORDER_H
+
+#include "firm_types.h"
+
+typedef enum be_func_placement_t {
+	BE_FUNC_NORMAL, /**< no profile data or neither hot nor cold */
+	BE_FUNC_HOT,    /**< frequently executed function */
+	BE_FUNC_COLD,   /**< function never executed while profiling */
+} be_func_placement_t;
+
+/**
+ * Reorders the graphs of the program so that functions calling each other
+ * frequently are placed next to each other and classifies the functions as
+ * hot or cold. Must be called while the profile data is loaded.
+ */
+void be_order_functions(void);
+
+/**
+ * Returns where the function @p entity should be placed.
+ */
+be_func_placement_t be_get_func_placement(const ir_entity *entity);
+
+/**
+ * Frees the placement information computed by be_order_functions().
+ */
+void be_free_func_order(void);
+
+#endif
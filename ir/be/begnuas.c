@@ -21,6 +21,7 @@
 #include "bedwarf.h"
 #include "beemithlp.h"
 #include "beemitter.h"
+#include "befuncorder.h"
 #include "bemodule.h"
 #include "dbginfo.h"
 #include "entity_t.h"
@@ -51,6 +52,7 @@ char                        be_gas_elf_type_char       = '@';
 static be_gas_section_t current_section = (be_gas_section_t) -1;
 static pmap            *block_numbers;
 static unsigned         next_block_nr;
+static pmap            *constant_pool; /**< pool key -> first entity */
 
 static void emit_section_macho(be_gas_section_t section)
 {
@@ -94,6 +96,9 @@ static void emit_section_macho(be_gas_section_t section)
 		[GAS_SECTION_DEBUG_LINE]      = { "__DWARF,__debug_line",     "regular,debug" },
 		[GAS_SECTION_DEBUG_PUBNAMES]  = { "__DWARF,__debug_pubnames", "regular,debug" },
 		[GAS_SECTION_DEBUG_FRAME]     = { "__DWARF,__debug_frame",    "regular,debug" },
+		[GAS_SECTION_LITERAL4]        = { "__TEXT,__literal4",        "4byte_literals" },
+		[GAS_SECTION_LITERAL8]        = { "__TEXT,__literal8",        "8byte_literals" },
+		[GAS_SECTION_LITERAL16]       = { "__TEXT,__literal16",       "16byte_literals" },
 	};
 	static const macho_sectioninfo_t macho_sectioninfos_coalesce[] = {
 		[GAS_SECTION_TEXT]    = { "__TEXT,__textcoal_nt", "coalesced,pure_instructions" },
@@ -140,13 +145,30 @@ static const elf_sectioninfo_t elf_sectioninfos[] = {
 	[GAS_SECTION_CONSTRUCTORS]   = { "ctors",             "progbits", "aw" },
 	[GAS_SECTION_DESTRUCTORS]    = { "dtors",             "progbits", "aw" },
 	[GAS_SECTION_JCR]            = { "jcr",               "progbits", "aw" },
+	[GAS_SECTION_CSTRING]        = { "rodata.str1.1",     "progbits", "aMS" },
 	[GAS_SECTION_DEBUG_INFO]     = { "debug_info",        "progbits", ""   },
 	[GAS_SECTION_DEBUG_ABBREV]   = { "debug_abbrev",      "progbits", ""   },
 	[GAS_SECTION_DEBUG_LINE]     = { "debug_line",        "progbits", ""   },
 	[GAS_SECTION_DEBUG_PUBNAMES] = { "debug_pubnames",    "progbits", ""   },
 	[GAS_SECTION_DEBUG_FRAME]    = { "debug_frame",       "progbits", ""   },
+	[GAS_SECTION_TEXT_UNLIKELY]  = { "text.unlikely",     "progbits", "ax" },
+	[GAS_SECTION_TEXT_HOT]       = { "text.hot",          "progbits", "ax" },
+	[GAS_SECTION_LITERAL4]       = { "rodata.cst4",       "progbits", "aM" },
+	[GAS_SECTION_LITERAL8]       = { "rodata.cst8",       "progbits", "aM" },
+	[GAS_SECTION_LITERAL16]      = { "rodata.cst16",      "progbits", "aM" },
 };
 
+unsigned be_gas_get_section_entsize(be_gas_section_t const section)
+{
+	switch (section & GAS_SECTION_TYPE_MASK) {
+	case GAS_SECTION_CSTRING:   return 1;
+	case GAS_SECTION_LITERAL4:  return 4;
+	case GAS_SECTION_LITERAL8:  return 8;
+	case GAS_SECTION_LITERAL16: return 16;
+	default:                    return 0;
+	}
+}
+
 static void emit_section_sparc(be_gas_section_t section,
                                const ir_entity *entity)
 {
@@ -264,6 +286,13 @@ static void emit_section(be_gas_section_t section, const ir_entity *entity)
 		be_emit_string(info->type);
 	}
 
+	/* entry size of mergeable sections */
+	unsigned const entsize = be_gas_get_section_entsize(base);
+	if (entsize != 0) {
+		be_emit_char(',');
+		be_emit_uint(entsize);
+	}
+
 	if (flags & GAS_SECTION_FLAG_COMDAT) {
 		be_emit_char(',');
 		be_gas_emit_entity(entity);
@@ -282,6 +311,11 @@ void be_gas_emit_switch_section(be_gas_section_t section)
 	emit_section(section, NULL);
 }
 
+void be_gas_forget_section(void)
+{
+	current_section = (be_gas_section_t) -1;
+}
+
 static ir_tarval *get_initializer_tarval(const ir_initializer_t *initializer)
 {
 	if (initializer->kind == IR_INITIALIZER_TARVAL)
@@ -392,7 +426,7 @@ static bool entity_is_string_const(const ir_entity *ent, bool only_suffix_null)
 	return initializer_is_string_const(init, only_suffix_null);
 }
 
-static bool entity_is_zero_initialized(ir_entity const *entity)
+bool be_gas_entity_is_zero_initialized(ir_entity const *entity)
 {
 	if (is_alias_entity(entity))
 		return false;
@@ -464,17 +498,118 @@ static reloc_class_t classify_initializer_relocs(
 	panic("invalid initializer");
 }
 
+/**
+ * Returns the text section of the function @p entity, hot and cold functions
+ * are placed in separate sections on ELF targets.
+ */
+static be_gas_section_t determine_text_section(const ir_entity *entity)
+{
+	if (!is_method_entity(entity) || is_comdat(entity)
+	    || be_gas_object_file_format != OBJECT_FILE_FORMAT_ELF
+	    || be_gas_elf_variant != ELF_VARIANT_NORMAL)
+		return GAS_SECTION_TEXT;
+
+	switch (be_get_func_placement(entity)) {
+	case BE_FUNC_NORMAL: return GAS_SECTION_TEXT;
+	case BE_FUNC_HOT:    return GAS_SECTION_TEXT_HOT;
+	case BE_FUNC_COLD:   return GAS_SECTION_TEXT_UNLIKELY;
+	}
+	panic("invalid function placement");
+}
+
+/**
+ * Returns the mergeable section for the constant @p entity or
+ * GAS_SECTION_RODATA if it cannot be merged with equal constants.
+ */
+static be_gas_section_t determine_merge_section(const ir_entity *entity)
+{
+	if (!(get_entity_linkage(entity) & IR_LINKAGE_NO_IDENTITY))
+		return GAS_SECTION_RODATA;
+
+	switch (be_gas_object_file_format) {
+	case OBJECT_FILE_FORMAT_MACH_O:
+		if (entity_is_string_const(entity, true))
+			return GAS_SECTION_CSTRING;
+		break;
+	case OBJECT_FILE_FORMAT_ELF:
+		if (be_gas_elf_variant != ELF_VARIANT_NORMAL)
+			return GAS_SECTION_RODATA;
+		break;
+	case OBJECT_FILE_FORMAT_COFF:
+		return GAS_SECTION_RODATA;
+	}
+
+	/* the entries of a mergeable section must fill it without padding */
+	if (is_comdat(entity) || get_entity_owner(entity) != get_glob_type())
+		return GAS_SECTION_RODATA;
+	ir_type *const type      = get_entity_type(entity);
+	unsigned const size      = get_type_size(type);
+	unsigned const alignment = be_gas_get_entity_alignment(entity);
+	if (alignment > size)
+		return GAS_SECTION_RODATA;
+
+	ir_initializer_t const *const init = get_entity_initializer(entity);
+	if (entity_is_string_const(entity, true)) {
+		if (alignment <= 1 && get_initializer_compound_n_entries(init) == size)
+			return GAS_SECTION_CSTRING;
+		return GAS_SECTION_RODATA;
+	}
+
+	if (init == NULL)
+		return GAS_SECTION_RODATA;
+	ir_tarval *const tv = get_initializer_tarval(init);
+	if (!tarval_is_constant(tv)
+	 || get_mode_size_bits(get_tarval_mode(tv)) != size * 8)
+		return GAS_SECTION_RODATA;
+	switch (size) {
+	case 4:  return GAS_SECTION_LITERAL4;
+	case 8:  return GAS_SECTION_LITERAL8;
+	case 16: return GAS_SECTION_LITERAL16;
+	default: return GAS_SECTION_RODATA;
+	}
+}
+
+ident *be_gas_get_constant_pool_key(be_gas_section_t const section,
+                                    ir_entity const *const entity)
+{
+	/* equal constants are only shared in ELF files, where they are aliased */
+	unsigned const entsize = be_gas_get_section_entsize(section);
+	if (entsize == 0 || be_gas_object_file_format != OBJECT_FILE_FORMAT_ELF
+	 || get_entity_visibility(entity) != ir_visibility_private)
+		return NULL;
+
+	struct obstack obst;
+	obstack_init(&obst);
+	obstack_printf(&obst, "%u:", (unsigned)section);
+	ir_initializer_t const *const init = get_entity_initializer(entity);
+	if (section == GAS_SECTION_CSTRING) {
+		for (size_t i = 0, n = get_initializer_compound_n_entries(init);
+		     i + 1 < n; ++i) {
+			ir_initializer_t const *const sub
+				= get_initializer_compound_value(init, i);
+			obstack_1grow(&obst, get_tarval_long(get_initializer_tarval(sub)));
+		}
+	} else {
+		ir_tarval const *const tv = get_initializer_tarval(init);
+		for (unsigned i = 0; i < entsize; ++i)
+			obstack_printf(&obst, "%02x", get_tarval_sub_bits(tv, i));
+	}
+	size_t const len = obstack_object_size(&obst);
+	char  *const str = (char*)obstack_finish(&obst);
+	ident *const key = new_id_from_chars(str, len);
+	obstack_free(&obst, NULL);
+	return key;
+}
+
 static be_gas_section_t determine_basic_section(const ir_entity *entity)
 {
 	if (is_method_entity(entity) || is_alias_entity(entity))
-		return GAS_SECTION_TEXT;
+		return determine_text_section(entity);
 
 	if (get_entity_linkage(entity) & IR_LINKAGE_CONSTANT) {
-		/* mach-o is the only one with a cstring section */
-		if (be_gas_object_file_format == OBJECT_FILE_FORMAT_MACH_O
-		    && (get_entity_linkage(entity) & IR_LINKAGE_NO_IDENTITY)
-		    && entity_is_string_const(entity, true))
-			return GAS_SECTION_CSTRING;
+		be_gas_section_t const merge_section = determine_merge_section(entity);
+		if (merge_section != GAS_SECTION_RODATA)
+			return merge_section;
 
 		if (be_options.pic_style != BE_PIC_NONE) {
 			ir_initializer_t const *const init = get_entity_initializer(entity);
@@ -488,13 +623,14 @@ static be_gas_section_t determine_basic_section(const ir_entity *entity)
 			return GAS_SECTION_RODATA;
 		}
 	}
-	if (entity_is_zero_initialized(entity))
+	if (be_gas_entity_is_zero_initialized(entity))
 		return GAS_SECTION_BSS;
 
 	return GAS_SECTION_DATA;
 }
 
-static be_gas_section_t determine_section(be_main_env_t const *const main_env, ir_entity const *const entity)
+be_gas_section_t be_gas_determine_section(be_main_env_t const *const main_env,
+                                          ir_entity const *const entity)
 {
 	ir_type *owner = get_entity_owner(entity);
 
@@ -615,7 +751,7 @@ void be_gas_emit_function_prolog(const ir_entity *entity, unsigned po2alignment,
 {
 	be_dwarf_function_before(entity, parameter_infos);
 
-	be_gas_section_t section = determine_section(NULL, entity);
+	be_gas_section_t section = be_gas_determine_section(NULL, entity);
 	emit_section(section, entity);
 
 	/* write the begin line (makes the life easier for scripts parsing the
@@ -700,6 +836,49 @@ void be_gas_emit_function_epilog(const ir_entity *entity)
 	next_block_nr -= next_block_nr % 100;
 }
 
+bool be_gas_can_split_function(const ir_entity *entity)
+{
+	/* debug and callframe info describe a function as a single range */
+	return be_options.split_cold
+	    && be_gas_object_file_format == OBJECT_FILE_FORMAT_ELF
+	    && be_gas_elf_variant == ELF_VARIANT_NORMAL
+	    && (be_gas_determine_section(NULL, entity) == GAS_SECTION_TEXT
+	        || be_gas_determine_section(NULL, entity) == GAS_SECTION_TEXT_HOT)
+	    && !be_dwarf_has_function_info();
+}
+
+static void emit_cold_part_name(const ir_entity *entity)
+{
+	be_gas_emit_entity(entity);
+	be_emit_cstring(".cold");
+}
+
+void be_gas_begin_cold_part(const ir_entity *entity)
+{
+	be_gas_emit_switch_section(GAS_SECTION_TEXT_UNLIKELY);
+
+	be_emit_cstring("\t.type\t");
+	emit_cold_part_name(entity);
+	be_emit_cstring(", ");
+	be_emit_char(be_gas_elf_type_char);
+	be_emit_cstring("function\n");
+	emit_cold_part_name(entity);
+	be_emit_cstring(":\n");
+	be_emit_write_line();
+}
+
+void be_gas_end_cold_part(const ir_entity *entity)
+{
+	be_emit_cstring("\t.size\t");
+	emit_cold_part_name(entity);
+	be_emit_cstring(", .-");
+	emit_cold_part_name(entity);
+	be_emit_char('\n');
+	be_emit_write_line();
+
+	be_gas_emit_switch_section(be_gas_determine_section(NULL, entity));
+}
+
 /**
  * Output parts of a tarval.
  *
@@ -824,10 +1003,14 @@ static void emit_string_char(int c)
 	case '\t': be_emit_cstring("\\t"); break;
 	case '\\': be_emit_cstring("\\\\"); break;
 	default  :
-		if (isprint(c))
+		if (isprint(c)) {
 			be_emit_char(c);
-		else
-			be_emit_irprintf("\\%03o", c);
+		} else {
+			be_emit_char('\\');
+			be_emit_char('0' + ((c >> 6) & 7));
+			be_emit_char('0' + ((c >> 3) & 7));
+			be_emit_char('0' + (c & 7));
+		}
 		break;
 	}
 }
@@ -932,7 +1115,7 @@ static size_t get_initializer_size(const ir_initializer_t *initializer,
 	panic("found invalid initializer");
 }
 
-static unsigned long compute_entity_size(ir_entity const *const entity)
+unsigned long be_gas_get_entity_size(ir_entity const *const entity)
 {
 	ir_type *const type = get_entity_type(entity);
 	unsigned long  size = get_type_size(type);
@@ -1160,6 +1343,59 @@ static void emit_node_data(ir_node *const init, ir_type *const type)
 	be_emit_write_line();
 }
 
+/** Initializers of at least this size are emitted as byte runs. */
+#define BULK_INITIALIZER_SIZE 256
+/** Maximal number of bytes in a single .ascii directive. */
+#define BYTE_RUN_LENGTH       64
+/** Gaps up to this size are filled with zeros inside a byte run. */
+#define BYTE_RUN_MAX_GAP      16
+
+static unsigned char byte_run[BYTE_RUN_LENGTH];
+static unsigned      byte_run_len;
+
+static void flush_byte_run(void)
+{
+	if (byte_run_len == 0)
+		return;
+	be_emit_cstring("\t.ascii \"");
+	for (unsigned i = 0; i < byte_run_len; ++i) {
+		emit_string_char(byte_run[i]);
+	}
+	be_emit_cstring("\"\n");
+	be_emit_write_line();
+	byte_run_len = 0;
+}
+
+static void emit_run_byte(unsigned char const byte)
+{
+	byte_run[byte_run_len++] = byte;
+	if (byte_run_len == BYTE_RUN_LENGTH)
+		flush_byte_run();
+}
+
+/**
+ * Appends the @p size bytes of @p tv in target byte order to the byte run,
+ * this matches the memory layout produced by emit_tarval_data().
+ */
+static void emit_run_tarval(ir_tarval const *const tv, unsigned const size)
+{
+	bool const big_endian = be_get_backend_param()->byte_order_big_endian;
+	for (unsigned i = 0; i < size; ++i) {
+		emit_run_byte(get_tarval_sub_bits(tv, big_endian ? size - 1 - i : i));
+	}
+}
+
+static size_t emit_run_string(ir_initializer_t const *const initializer)
+{
+	size_t const len = initializer->compound.n_initializers;
+	for (size_t i = 0; i < len; ++i) {
+		ir_initializer_t const *const sub_initializer
+			= get_initializer_compound_value(initializer, i);
+		emit_run_byte(get_tarval_long(get_initializer_tarval(sub_initializer)));
+	}
+	return len;
+}
+
 static void emit_initializer(ir_entity const *const entity,
                              unsigned long const size)
 {
@@ -1185,6 +1421,10 @@ static void emit_initializer(ir_entity const *const entity,
 
 	emit_ir_initializer(vals, initializer, type);
 
+	/* Large initializers (tables, embedded data) are written as runs of
+	 * .ascii bytes, only relocated values and big gaps interrupt the runs. */
+	bool const bulk = size >= BULK_INITIALIZER_SIZE;
+
 	/* now write values sorted */
 	for (size_t k = 0; k < size; ) {
 		int                     space     = 0;
@@ -1193,22 +1433,39 @@ static void emit_initializer(ir_entity const *const entity,
 		switch (kind) {
 		case NORMAL:
 			if (vals[k].v.value != NULL) {
-				emit_node_data(vals[k].v.value, vals[k].type);
+				ir_node *const value = vals[k].v.value;
 				elem_size = get_type_size(vals[k].type);
+				if (bulk && is_Const(value)
+				 && get_mode_size_bytes(get_irn_mode(value)) == (unsigned)elem_size) {
+					emit_run_tarval(get_Const_tarval(value), elem_size);
+				} else {
+					flush_byte_run();
+					emit_node_data(value, vals[k].type);
+				}
 			} else {
 				elem_size = 0;
 			}
 			break;
 		case TARVAL:
-			emit_tarval_data(vals[k].type, vals[k].v.tarval);
 			elem_size = get_type_size(vals[k].type);
+			if (bulk)
+				emit_run_tarval(vals[k].v.tarval, elem_size);
+			else
+				emit_tarval_data(vals[k].type, vals[k].v.tarval);
 			break;
 		case STRING:
-			elem_size = emit_string_initializer(vals[k].v.string);
+			if (bulk)
+				elem_size = emit_run_string(vals[k].v.string);
+			else
+				elem_size = emit_string_initializer(vals[k].v.string);
 			break;
 		case BITFIELD:
-			be_emit_irprintf("\t.byte\t%d\n", vals[k].v.bf_val);
-			be_emit_write_line();
+			if (bulk) {
+				emit_run_byte(vals[k].v.bf_val);
+			} else {
+				be_emit_irprintf("\t.byte\t%d\n", vals[k].v.bf_val);
+				be_emit_write_line();
+			}
 			elem_size = 1;
 			break;
 		default:
@@ -1223,11 +1480,18 @@ static void emit_initializer(ir_entity const *const entity,
 
 		/* a gap */
 		if (space > 0) {
-			be_emit_irprintf("\t.space\t%d, 0\n", space);
-			be_emit_write_line();
+			if (bulk && space <= BYTE_RUN_MAX_GAP && k < size) {
+				for (int i = 0; i < space; ++i)
+					emit_run_byte(0);
+			} else {
+				flush_byte_run();
+				be_emit_irprintf("\t.space\t%d, 0\n", space);
+				be_emit_write_line();
+			}
 		}
 	}
-	free(vals);
+	flush_byte_run();
+	xfree(vals);
 }
 
 static void emit_align(unsigned p2alignment)
@@ -1236,7 +1500,7 @@ static void emit_align(unsigned p2alignment)
 	be_emit_write_line();
 }
 
-static unsigned get_effective_entity_alignment(const ir_entity *entity)
+unsigned be_gas_get_entity_alignment(const ir_entity *entity)
 {
 	unsigned alignment = get_entity_alignment(entity);
 	if (alignment == 0) {
@@ -1249,7 +1513,7 @@ static unsigned get_effective_entity_alignment(const ir_entity *entity)
 static void emit_common(const ir_entity *entity, unsigned long size,
                         bool is_local)
 {
-	unsigned const alignment = get_effective_entity_alignment(entity);
+	unsigned const alignment = be_gas_get_entity_alignment(entity);
 
 	switch (be_gas_object_file_format) {
 	case OBJECT_FILE_FORMAT_MACH_O:
@@ -1285,7 +1549,7 @@ static void emit_zerofill(const ir_entity *entity, const char *section_segment,
 	be_emit_char(',');
 	be_gas_emit_entity(entity);
 	unsigned const alignment
-		= get_effective_entity_alignment(entity);
+		= be_gas_get_entity_alignment(entity);
 	be_emit_irprintf(",%lu,%u\n", size, log2_floor(alignment));
 	be_emit_write_line();
 }
@@ -1344,7 +1608,9 @@ void be_gas_emit_entity(const ir_entity *entity)
 {
 	if (entity->kind == IR_ENTITY_LABEL) {
 		ir_label_t label = get_entity_label(entity);
-		be_emit_irprintf("%s_%lu", be_gas_get_private_prefix(), label);
+		be_emit_string(be_gas_get_private_prefix());
+		be_emit_char('_');
+		be_emit_uint(label);
 		return;
 	}
 
@@ -1374,7 +1640,8 @@ void be_gas_emit_block_name(const ir_node *block)
 		} else {
 			nr = PTR_TO_INT(nr_val)-1;
 		}
-		be_emit_irprintf("%s%d", be_gas_get_private_prefix(), nr);
+		be_emit_string(be_gas_get_private_prefix());
+		be_emit_int(nr);
 	}
 }
 
@@ -1425,9 +1692,16 @@ static void emit_global(be_main_env_t const *const main_env,
 	if (kind == IR_ENTITY_LABEL)
 		return;
 
+	/* Keep the visibility of hidden declarations, so the linker accepts
+	 * direct references to them in position independent code. */
+	if (!entity_has_definition(entity)
+	 && get_entity_visibility(entity) == ir_visibility_external_private
+	 && be_gas_object_file_format == OBJECT_FILE_FORMAT_ELF)
+		emit_symbol_directive(".hidden", entity);
+
 	/* we already emitted all functions with graphs in other functions like
 	 * be_gas_emit_function_prolog(). All others don't need to be emitted. */
-	be_gas_section_t const section = determine_section(main_env, entity);
+	be_gas_section_t const section = be_gas_determine_section(main_env, entity);
 	if (kind == IR_ENTITY_METHOD && section != GAS_SECTION_PIC_TRAMPOLINES)
 		return;
 
@@ -1442,8 +1716,8 @@ static void emit_global(be_main_env_t const *const main_env,
 
 	ir_visibility const visibility       = get_entity_visibility(entity);
 	ir_linkage    const linkage          = get_entity_linkage(entity);
-	bool          const zero_initializer = entity_is_zero_initialized(entity);
-	unsigned long       size             = compute_entity_size(entity);
+	bool          const zero_initializer = be_gas_entity_is_zero_initialized(entity);
+	unsigned long       size             = be_gas_get_entity_size(entity);
 
 	/* We need to output at least 1 byte, otherwise macho will merge
 	 * the label with the next thing */
@@ -1497,8 +1771,26 @@ static void emit_global(be_main_env_t const *const main_env,
 		return;
 	}
 
-	/* alignment */
-	unsigned alignment = get_effective_entity_alignment(entity);
+	/* share the storage of equal constants in the unit */
+	ident *const pool_key = be_gas_get_constant_pool_key(section, entity);
+	if (pool_key != NULL) {
+		ir_entity const *const first
+			= pmap_get(ir_entity const, constant_pool, pool_key);
+		if (first != NULL) {
+			be_emit_cstring("\t.set ");
+			be_gas_emit_entity(entity);
+			be_emit_char(',');
+			be_gas_emit_entity(first);
+			be_emit_char('\n');
+			be_emit_write_line();
+			return;
+		}
+		pmap_insert(constant_pool, pool_key, (void*)entity);
+	}
+
+	/* alignment, entries of mergeable sections are aligned to their size */
+	unsigned alignment = MAX(be_gas_get_entity_alignment(entity),
+	                         be_gas_get_section_entsize(section));
 	if (!is_po2_or_zero(alignment))
 		panic("alignment not a power of 2");
 	if (alignment > 1) {
@@ -1642,6 +1934,7 @@ void be_emit_jump_table(const ir_node *node, const ir_switch_table *table,
 	}
 
 	/* emit table */
+	be_gas_section_t const code_section = current_section;
 	unsigned pointer_size = get_mode_size_bytes(entry_mode);
 	if (entity != NULL) {
 		if (be_gas_object_file_format != OBJECT_FILE_FORMAT_MACH_O)
@@ -1662,11 +1955,15 @@ void be_emit_jump_table(const ir_node *node, const ir_switch_table *table,
 	}
 
 	if (entity != NULL
-	 && be_gas_object_file_format != OBJECT_FILE_FORMAT_MACH_O)
-		be_gas_emit_switch_section(GAS_SECTION_TEXT);
+	 && be_gas_object_file_format != OBJECT_FILE_FORMAT_MACH_O) {
+		/* the switch may be part of the cold code of its function */
+		be_gas_emit_switch_section(code_section == GAS_SECTION_TEXT_UNLIKELY
+		                        || code_section == GAS_SECTION_TEXT_HOT
+		                           ? code_section : GAS_SECTION_TEXT);
+	}
 
-	free(labels);
-	free(targets);
+	xfree(labels);
+	xfree(targets);
 }
 
 static void emit_global_asms(void)
@@ -1696,6 +1993,7 @@ void be_gas_begin_compilation_unit(const be_main_env_t *env)
 
 	block_numbers = pmap_create();
 	next_block_nr = 0;
+	constant_pool = pmap_create();
 
 	emit_global_asms();
 }
@@ -1704,6 +2002,7 @@ void be_gas_end_compilation_unit(const be_main_env_t *env)
 {
 	emit_global_decls(env);
 
+	pmap_destroy(constant_pool);
 	pmap_destroy(block_numbers);
 
 	be_dwarf_unit_end();
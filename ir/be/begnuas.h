@@ -34,6 +34,11 @@ typedef enum {
 	GAS_SECTION_DEBUG_LINE,      /**< dwarf debug line */
 	GAS_SECTION_DEBUG_PUBNAMES,  /**< dwarf pub names */
 	GAS_SECTION_DEBUG_FRAME,     /**< dwarf callframe infos */
+	GAS_SECTION_TEXT_UNLIKELY,   /**< rarely executed program code */
+	GAS_SECTION_TEXT_HOT,        /**< frequently executed program code */
+	GAS_SECTION_LITERAL4,        /**< mergeable 4 byte constants */
+	GAS_SECTION_LITERAL8,        /**< mergeable 8 byte constants */
+	GAS_SECTION_LITERAL16,       /**< mergeable 16 byte constants */
 	GAS_SECTION_TYPE_MASK    = 0xFF,
 
 	GAS_SECTION_FLAG_TLS     = 1 << 8,  /**< thread local flag */
@@ -65,6 +70,12 @@ extern bool                 be_gas_emit_cfi_directives;
  */
 void be_gas_emit_switch_section(be_gas_section_t section);
 
+/**
+ * Forgets the current output section, so the next switch to a section is
+ * emitted even if the section stays the same.
+ */
+void be_gas_forget_section(void);
+
 /**
  * emit assembler instructions necessary before starting function code
  */
@@ -74,8 +85,64 @@ void be_gas_emit_function_prolog(const ir_entity *entity,
 
 void be_gas_emit_function_epilog(const ir_entity *entity);
 
+/**
+ * Returns true if the code of the function @p entity may be split into a hot
+ * part and a cold part emitted in a separate section.
+ */
+bool be_gas_can_split_function(const ir_entity *entity);
+
+/**
+ * Switches to the section for rarely executed code and starts the cold part
+ * of the function @p entity.
+ */
+void be_gas_begin_cold_part(const ir_entity *entity);
+
+/**
+ * Ends the cold part of the function @p entity and switches back to the
+ * section of the function.  Must be called before be_gas_emit_function_epilog().
+ */
+void be_gas_end_cold_part(const ir_entity *entity);
+
 char const *be_gas_get_private_prefix(void);
 
+/**
+ * Returns the section the global entity @p entity is placed in.
+ *
+ * @param main_env  the backend environment, may be NULL for functions
+ */
+be_gas_section_t be_gas_determine_section(be_main_env_t const *main_env,
+                                          ir_entity const *entity);
+
+/**
+ * Returns true if the entity @p entity has an initializer which is all zero.
+ */
+bool be_gas_entity_is_zero_initialized(ir_entity const *entity);
+
+/**
+ * Returns the size of @p entity in bytes, variable sized entities are sized
+ * by their initializer.
+ */
+unsigned long be_gas_get_entity_size(ir_entity const *entity);
+
+/**
+ * Returns the alignment of @p entity, falling back to the one of its type.
+ */
+unsigned be_gas_get_entity_alignment(ir_entity const *entity);
+
+/**
+ * Returns the entry size of the mergeable section @p section or 0 if the
+ * section is not mergeable.
+ */
+unsigned be_gas_get_section_entsize(be_gas_section_t section);
+
+/**
+ * Returns an ident identifying the contents of the constant @p entity placed
+ * in the mergeable section @p section.  Entities with the same key can share
+ * their storage.  Returns NULL if @p entity may not be shared.
+ */
+ident *be_gas_get_constant_pool_key(be_gas_section_t section,
+                                    ir_entity const *entity);
+
 /**
  * emit ld_ident of an entity and performs additional mangling if necessary.
  * (mangling is necessary for ir_visibility_private for example).
@@ -16,7 +16,9 @@
 #include "lc_opts_enum.h"
 
 #include "timing.h"
+#include "array.h"
 #include "bitset.h"
+#include "raw_bitset.h"
 #include "irgwalk.h"
 #include "irnode_t.h"
 #include "beifg.h"
@@ -25,17 +27,36 @@
 #include "bemodule.h"
 #include "belive.h"
 
+/** Classes with more nodes get adjacency arrays instead of a bit matrix. */
+#define IFG_MATRIX_MAX_NODES 2048
+
 void be_ifg_free(be_ifg_t *self)
 {
-	free(self);
+	if (self->nodes != NULL) {
+		DEL_ARR_F(self->nodes);
+		DEL_ARR_F(self->numbers);
+		xfree(self->matrix);
+		xfree(self->adj_begin);
+		xfree(self->adj);
+		xfree(self->degrees);
+	}
+	xfree(self);
+}
+
+/** Returns the dense number of @p irn in a materialized graph, ~0u if it is
+ * not a node of the graph. */
+static unsigned get_ifg_number(const be_ifg_t *ifg, const ir_node *irn)
+{
+	unsigned const idx = get_irn_idx(irn);
+	return idx < ARR_LEN(ifg->numbers) ? ifg->numbers[idx] : ~0u;
 }
 
 static void nodes_walker(ir_node *bl, void *data)
 {
-	nodes_iter_t     *it   = (nodes_iter_t*)data;
-	struct list_head *head = get_block_border_head(it->env, bl);
+	nodes_iter_t          *it      = (nodes_iter_t*)data;
+	block_borders_t const *borders = get_block_borders(it->env, bl);
 
-	foreach_border_head(head, b) {
+	foreach_border(borders, b) {
 		if (b->is_def && b->is_real) {
 			obstack_ptr_grow(&it->obst, b->irn);
 			it->n++;
@@ -69,16 +90,16 @@ ir_node *be_ifg_nodes_next(nodes_iter_t *const it)
 
 static void find_neighbour_walker(ir_node *block, void *data)
 {
-	neighbours_iter_t *it    = (neighbours_iter_t*)data;
-	struct list_head  *head  = get_block_border_head(it->env, block);
-	be_lv_t           *lv    = be_get_irg_liveness(it->env->irg);
+	neighbours_iter_t     *it      = (neighbours_iter_t*)data;
+	block_borders_t const *borders = get_block_borders(it->env, block);
+	be_lv_t               *lv      = be_get_irg_liveness(it->env->irg);
 
 	int has_started = 0;
 
 	if (!be_is_live_in(lv, block, it->irn) && block != get_nodes_block(it->irn))
 		return;
 
-	foreach_border_head(head, b) {
+	foreach_border(borders, b) {
 		ir_node *irn = b->irn;
 
 		if (irn == it->irn) {
@@ -100,8 +121,27 @@ static void find_neighbour_walker(ir_node *block, void *data)
 static void find_neighbours(const be_ifg_t *ifg, neighbours_iter_t *it, const ir_node *irn)
 {
 	it->env         = ifg->env;
+	it->ifg         = ifg;
 	it->irn         = irn;
 	it->valid       = 1;
+
+	if (ifg->nodes != NULL) {
+		unsigned const nr = get_ifg_number(ifg, irn);
+		it->row = NULL;
+		it->pos = 0;
+		it->end = 0;
+		if (nr == ~0u)
+			return;
+		if (ifg->matrix != NULL) {
+			it->row = &ifg->matrix[nr * ifg->stride];
+			it->end = ifg->n_nodes;
+		} else {
+			it->pos = ifg->adj_begin[nr];
+			it->end = ifg->adj_begin[nr + 1];
+		}
+		return;
+	}
+
 	ir_nodeset_init(&it->neighbours);
 
 	dom_tree_walk(get_nodes_block(irn), find_neighbour_walker, NULL, it);
@@ -113,12 +153,27 @@ static inline void neighbours_break(neighbours_iter_t *it, int force)
 {
 	(void) force;
 	assert(it->valid == 1);
-	ir_nodeset_destroy(&it->neighbours);
+	if (it->ifg->nodes == NULL)
+		ir_nodeset_destroy(&it->neighbours);
 	it->valid = 0;
 }
 
 static ir_node *get_next_neighbour(neighbours_iter_t *it)
 {
+	const be_ifg_t *ifg = it->ifg;
+	if (ifg->nodes != NULL) {
+		if (it->row != NULL) {
+			size_t const next = rbitset_next_max(it->row, it->pos, it->end, true);
+			if (next == (size_t)-1)
+				return NULL;
+			it->pos = next + 1;
+			return ifg->nodes[next];
+		}
+		if (it->pos < it->end)
+			return ifg->nodes[ifg->adj[it->pos++]];
+		return NULL;
+	}
+
 	ir_node *res = ir_nodeset_iterator_next(&it->iter);
 
 	if (res == NULL) {
@@ -167,15 +222,16 @@ static inline int get_next_clique(cliques_iter_t *it)
 	/* continue in the block we left the last time */
 	for (; it->blk < it->n_blocks; it->blk++) {
 		int output_on_shrink = 0;
-		struct list_head *head = get_block_border_head(it->cenv, it->blocks[it->blk]);
+		block_borders_t const *const borders = get_block_borders(it->cenv, it->blocks[it->blk]);
+		border_t        const *const end     = borders->borders + borders->n_borders;
 
 		/* on entry to a new block set the first border ... */
 		if (!it->bor)
-			it->bor = head->prev;
+			it->bor = borders->borders;
 
 		/* ... otherwise continue with the border we left the last time */
-		for (; it->bor != head; it->bor = it->bor->prev) {
-			border_t *b = list_entry(it->bor, border_t, list);
+		for (; it->bor != end; ++it->bor) {
+			border_t const *b = it->bor;
 
 			/* if its a definition irn starts living */
 			if (b->is_def) {
@@ -243,6 +299,11 @@ void be_ifg_cliques_break(cliques_iter_t *iter)
 
 int be_ifg_degree(const be_ifg_t *ifg, const ir_node *irn)
 {
+	if (ifg->nodes != NULL) {
+		unsigned const nr = get_ifg_number(ifg, irn);
+		return nr != ~0u ? (int)ifg->degrees[nr] : 0;
+	}
+
 	neighbours_iter_t it;
 	int degree;
 	find_neighbours(ifg, &it, irn);
@@ -251,11 +312,160 @@ int be_ifg_degree(const be_ifg_t *ifg, const ir_node *irn)
 	return degree;
 }
 
-be_ifg_t *be_create_ifg(const be_chordal_env_t *env)
+static void number_walker(ir_node *block, void *data)
+{
+	be_ifg_t              *ifg     = (be_ifg_t*)data;
+	block_borders_t const *borders = get_block_borders(ifg->env, block);
+
+	foreach_border(borders, b) {
+		if (!b->is_def)
+			continue;
+		unsigned *const nr = &ifg->numbers[get_irn_idx(b->irn)];
+		if (*nr == ~0u) {
+			*nr = ifg->n_nodes++;
+			ARR_APP1(ir_node*, ifg->nodes, b->irn);
+		}
+	}
+}
+
+typedef struct edge_env_t {
+	be_ifg_t *ifg;
+	unsigned *living;     /**< numbers of the living nodes */
+	unsigned *living_pos; /**< position of each node in living */
+	unsigned  n_living;
+	unsigned *pairs;      /**< both directions of all edges for large
+	                           classes, ARR_F */
+} edge_env_t;
+
+static void add_edge(edge_env_t *env, unsigned a, unsigned b)
+{
+	be_ifg_t *ifg = env->ifg;
+	if (ifg->matrix != NULL) {
+		rbitset_set(&ifg->matrix[a * ifg->stride], b);
+		rbitset_set(&ifg->matrix[b * ifg->stride], a);
+	} else {
+		ARR_APP1(unsigned, env->pairs, a);
+		ARR_APP1(unsigned, env->pairs, b);
+		ARR_APP1(unsigned, env->pairs, b);
+		ARR_APP1(unsigned, env->pairs, a);
+	}
+}
+
+/**
+ * A value interferes with all values living at its definition, so sweeping
+ * the borders of each block once finds all edges.
+ */
+static void edge_walker(ir_node *block, void *data)
+{
+	edge_env_t            *env     = (edge_env_t*)data;
+	be_ifg_t              *ifg     = env->ifg;
+	block_borders_t const *borders = get_block_borders(ifg->env, block);
+
+	foreach_border(borders, b) {
+		unsigned const nr = ifg->numbers[get_irn_idx(b->irn)];
+		if (b->is_def) {
+			for (unsigned i = 0; i < env->n_living; ++i)
+				add_edge(env, nr, env->living[i]);
+			env->living_pos[nr]           = env->n_living;
+			env->living[env->n_living++] = nr;
+		} else {
+			unsigned const pos  = env->living_pos[nr];
+			unsigned const last = env->living[--env->n_living];
+			env->living[pos]       = last;
+			env->living_pos[last] = pos;
+		}
+	}
+	assert(env->n_living == 0);
+}
+
+static int cmp_unsigned(const void *a, const void *b)
+{
+	unsigned const x = *(const unsigned*)a;
+	unsigned const y = *(const unsigned*)b;
+	return (x > y) - (x < y);
+}
+
+/** Builds sorted adjacency arrays from the collected edge pairs. */
+static void build_adjacency(be_ifg_t *ifg, const unsigned *pairs)
+{
+	unsigned const n       = ifg->n_nodes;
+	size_t   const n_pairs = ARR_LEN(pairs) / 2;
+	unsigned      *begin   = XMALLOCNZ(unsigned, n + 1);
+	unsigned      *adj     = XMALLOCN(unsigned, n_pairs);
+
+	for (size_t i = 0; i < n_pairs; ++i)
+		++begin[pairs[2 * i] + 1];
+	for (unsigned i = 0; i < n; ++i)
+		begin[i + 1] += begin[i];
+
+	unsigned *fill = XMALLOCN(unsigned, n);
+	memcpy(fill, begin, n * sizeof(*fill));
+	for (size_t i = 0; i < n_pairs; ++i)
+		adj[fill[pairs[2 * i]]++] = pairs[2 * i + 1];
+	xfree(fill);
+
+	/* sort the neighbours and drop edges found in several blocks */
+	unsigned out = 0;
+	for (unsigned i = 0; i < n; ++i) {
+		unsigned const b = begin[i];
+		unsigned const e = begin[i + 1];
+		qsort(&adj[b], e - b, sizeof(*adj), cmp_unsigned);
+		begin[i] = out;
+		for (unsigned j = b; j < e; ++j) {
+			if (j == b || adj[j] != adj[j - 1])
+				adj[out++] = adj[j];
+		}
+		ifg->degrees[i] = out - begin[i];
+	}
+	begin[n] = out;
+
+	ifg->adj_begin = begin;
+	ifg->adj       = adj;
+}
+
+static void materialize_ifg(be_ifg_t *ifg)
 {
-	be_ifg_t *ifg = XMALLOC(be_ifg_t);
+	ir_graph *irg = ifg->env->irg;
+	unsigned  n_idx = get_irg_last_idx(irg);
+	ifg->nodes   = NEW_ARR_F(ir_node*, 0);
+	ifg->numbers = NEW_ARR_F(unsigned, n_idx);
+	memset(ifg->numbers, 0xFF, n_idx * sizeof(*ifg->numbers));
+	irg_block_walk_graph(irg, number_walker, NULL, ifg);
+
+	unsigned const n = ifg->n_nodes;
+	ifg->degrees = XMALLOCNZ(unsigned, n);
+	if (n <= IFG_MATRIX_MAX_NODES) {
+		ifg->stride = BITSET_SIZE_ELEMS(n);
+		ifg->matrix = XMALLOCNZ(unsigned, (size_t)n * ifg->stride);
+	}
+
+	edge_env_t env;
+	env.ifg        = ifg;
+	env.living     = XMALLOCN(unsigned, n);
+	env.living_pos = XMALLOCN(unsigned, n);
+	env.n_living   = 0;
+	env.pairs      = NEW_ARR_F(unsigned, 0);
+	irg_block_walk_graph(irg, edge_walker, NULL, &env);
+	xfree(env.living);
+	xfree(env.living_pos);
+
+	if (ifg->matrix != NULL) {
+		for (unsigned i = 0; i < n; ++i)
+			ifg->degrees[i] = rbitset_popcount(&ifg->matrix[i * ifg->stride], n);
+	} else {
+		build_adjacency(ifg, env.pairs);
+	}
+	DEL_ARR_F(env.pairs);
+}
+
+be_ifg_t *be_create_ifg(const be_chordal_env_t *env, bool materialize)
+{
+	be_ifg_t *ifg = XMALLOCZ(be_ifg_t);
 	ifg->env = env;
 
+	if (materialize)
+		materialize_ifg(ifg);
+
 	return ifg;
 }
 
@@ -301,7 +511,7 @@ void be_ifg_stat(ir_graph *irg, be_ifg_t *ifg, be_ifg_stat_t *stat)
 			int_comp_rec(ifg, n, seen);
 		}
 	}
-	free(seen);
+	xfree(seen);
 
 	stat->n_nodes = n_nodes;
 	/* Every interference edge was counted twice, once for each end. */
@@ -19,6 +19,16 @@
 
 struct be_ifg_t {
 	const be_chordal_env_t *env;
+	/* The following fields are only used if the graph is materialized, in
+	 * that case nodes is not NULL. */
+	ir_node  **nodes;     /**< nodes by dense number */
+	unsigned  *numbers;   /**< dense numbers by node index, ~0u for others */
+	unsigned   n_nodes;
+	unsigned   stride;    /**< elements per row of the bit matrix */
+	unsigned  *matrix;    /**< adjacency bit matrix, NULL for large classes */
+	unsigned  *adj_begin; /**< begin of the neighbours of each node in adj */
+	unsigned  *adj;       /**< sorted neighbours of all nodes */
+	unsigned  *degrees;
 };
 
 typedef struct nodes_iter_t {
@@ -31,10 +41,14 @@ typedef struct nodes_iter_t {
 
 typedef struct neighbours_iter_t {
 	const be_chordal_env_t *env;
+	const be_ifg_t       *ifg;
 	const ir_node        *irn;
 	int                   valid;
 	ir_nodeset_t          neighbours;
 	ir_nodeset_iterator_t iter;
+	const unsigned       *row;  /**< bit matrix row of a materialized graph */
+	unsigned              pos;  /**< position in row or adj */
+	unsigned              end;
 } neighbours_iter_t;
 
 typedef struct cliques_iter_t {
@@ -43,7 +57,7 @@ typedef struct cliques_iter_t {
 	ir_node **buf;
 	ir_node **blocks;
 	int n_blocks, blk;
-	struct list_head *bor;
+	border_t const *bor;
 	pset *living;
 } cliques_iter_t;
 
@@ -81,6 +95,12 @@ typedef struct {
 
 void be_ifg_stat(ir_graph *irg, be_ifg_t *ifg, be_ifg_stat_t *stat);
 
-be_ifg_t *be_create_ifg(const be_chordal_env_t *env);
+/**
+ * Creates the interference graph of the current register class of @p env.
+ * If @p materialize is set, all edges are computed once: Small classes get an
+ * adjacency bit matrix, large ones sorted adjacency arrays.  Otherwise every
+ * query walks the blocks and liveness again.
+ */
+be_ifg_t *be_create_ifg(const be_chordal_env_t *env, bool materialize);
 
 #endif
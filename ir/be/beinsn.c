@@ -9,18 +9,97 @@
  * @author      Sebastian Hack
  */
 #include "irgraph_t.h"
+#include "irgwalk.h"
 #include "irmode_t.h"
 #include "irnode_t.h"
 #include "iredges_t.h"
+#include "xmalloc.h"
 
+#include "be_t.h"
 #include "bearch.h"
 #include "bechordal_t.h"
 #include "beinsn_t.h"
+#include "besched.h"
+
+typedef struct summary_entry_t {
+	const ir_node *node;        /**< the node, the index may be reused */
+	unsigned       constrained; /**< classes with constrained operands */
+} summary_entry_t;
+
+struct be_insn_summary {
+	unsigned         n_nodes;
+	summary_entry_t *entries;
+};
+
+/**
+ * Records the register classes in which a node has limited or wide
+ * requirements.  Unlike be_scan_insn() this ignores whether the operands are
+ * present or ignore values, so the result stays conservative while the
+ * allocator rewires the operands.
+ */
+static void summarize_block(ir_node *const block, void *const data)
+{
+	be_insn_summary *const summary = (be_insn_summary*)data;
+	sched_foreach(block, irn) {
+		unsigned constrained = 0;
+		be_foreach_out(irn, o) {
+			arch_register_req_t const *const req
+				= arch_get_irn_register_req_out(irn, o);
+			if (req->cls != NULL && (req->limited != NULL || req->width > 1))
+				constrained |= 1U << req->cls->index;
+		}
+		for (int i = 0, n = get_irn_arity(irn); i < n; ++i) {
+			arch_register_req_t const *const req
+				= arch_get_irn_register_req_in(irn, i);
+			if (req->cls != NULL && req->limited != NULL)
+				constrained |= 1U << req->cls->index;
+		}
+
+		summary_entry_t *const entry = &summary->entries[get_irn_idx(irn)];
+		entry->node        = irn;
+		entry->constrained = constrained;
+	}
+}
+
+be_insn_summary *be_new_insn_summary(ir_graph *const irg)
+{
+	assert(isa_if->n_register_classes <= sizeof(unsigned) * 8);
+	be_insn_summary *const summary = XMALLOC(be_insn_summary);
+	summary->n_nodes = get_irg_last_idx(irg);
+	summary->entries = XMALLOCNZ(summary_entry_t, summary->n_nodes);
+	irg_block_walk_graph(irg, summarize_block, NULL, summary);
+	return summary;
+}
+
+void be_free_insn_summary(be_insn_summary *const summary)
+{
+	xfree(summary->entries);
+	xfree(summary);
+}
+
+/**
+ * Returns whether the summary shows that @p irn has no constrained operands
+ * in the register class @p cls.
+ */
+static bool is_unconstrained(be_insn_summary const *const summary,
+                             ir_node const *const irn,
+                             arch_register_class_t const *const cls)
+{
+	if (summary == NULL)
+		return false;
+	unsigned const idx = get_irn_idx(irn);
+	if (idx >= summary->n_nodes)
+		return false;
+	summary_entry_t const *const entry = &summary->entries[idx];
+	return entry->node == irn && !(entry->constrained & (1U << cls->index));
+}
 
 be_insn_t *be_scan_insn(be_chordal_env_t *const env, ir_node *const irn)
 {
 	struct obstack              *const obst = &env->obst;
 	const arch_register_class_t *const cls = env->cls;
+	if (is_unconstrained(env->insn_summary, irn, cls))
+		return NULL;
 
 	be_insn_t *const insn = OALLOCZ(obst, be_insn_t);
 	insn->irn = irn;
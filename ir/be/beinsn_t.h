@@ -15,8 +15,9 @@
 #include "bechordal.h"
 #include "raw_bitset.h"
 
-typedef struct be_operand_t  be_operand_t;
-typedef struct be_insn_t     be_insn_t;
+typedef struct be_operand_t     be_operand_t;
+typedef struct be_insn_t        be_insn_t;
+typedef struct be_insn_summary  be_insn_summary;
 
 struct be_operand_t {
 	ir_node        *carrier; /**< node representing the operand value (Proj or the node itself for defs, the used value for uses) */
@@ -32,13 +33,28 @@ struct be_insn_t {
 	ir_node      *irn;       /**< ir_node of the instruction */
 };
 
+/**
+ * Summarizes for each node of @p irg the register classes in which the node
+ * has constrained operands.  The requirements of a node do not change during
+ * register allocation, so the summary is computed once and used by all
+ * register class passes to skip unconstrained nodes.  Nodes created later
+ * are scanned as usual.
+ */
+be_insn_summary *be_new_insn_summary(ir_graph *irg);
+
+/**
+ * Frees the summary.
+ */
+void be_free_insn_summary(be_insn_summary *summary);
+
 /**
  * Create a be_insn_t for an IR node.
  *
  * @param env      the insn construction environment
  * @param irn      the irn for which the be_insn should be built
  *
- * @return the be_insn for the IR node
+ * @return the be_insn for the IR node or NULL if it has no constrained
+ *         operands in the register class of @p env
  */
 be_insn_t *be_scan_insn(be_chordal_env_t *env, ir_node *irn);
 
@@ -44,5 +44,6 @@ void be_free_birg(ir_graph *irg)
 	birg->lv = NULL;
 
 	obstack_free(&birg->obst, NULL);
+	obstack_free(&birg->emit_obst, NULL);
 	irg->be_data = NULL;
 }
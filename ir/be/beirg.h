@@ -77,6 +77,9 @@ typedef struct be_irg_t {
 	/** obstack (mainly used to keep register constraints which we can't keep
 	 * in the irg obst, because it gets replaced during code selection) */
 	struct obstack    obst;
+	/** assembler output of the graph, written to the output file in graph
+	 * order by be_step_last() */
+	struct obstack    emit_obst;
 	/** Architecture specific per-graph data */
 	void             *isa_link;
 } be_irg_t;
@@ -9,7 +9,7 @@
  * @author      Matthias Braun
  * @date        12.03.2007
  */
-#include "bejit.h"
+#include "bejit_t.h"
 
 #include <assert.h>
 #include <limits.h>
@@ -24,44 +24,6 @@
 #include "obst.h"
 #include "panic.h"
 
-typedef enum reloc_dest_kind_t {
-	RELOC_DEST_CODE_FRAGMENT,
-	RELOC_DEST_ENTITY,
-} reloc_dest_kind_t;
-
-typedef struct relocation_t {
-	uint8_t                   be_kind;
-	ENUMBF(reloc_dest_kind_t) dest_kind : 8;
-	uint16_t                  offset;
-	int32_t                   dest_offset;
-	union dest {
-		uint16_t   fragment_num;
-		ir_entity *entity;
-	} dest;
-} relocation_t;
-
-typedef struct fragment_info_t {
-	unsigned     address;  /**< Address from begin of code segment */
-	unsigned     len;      /**< size of the fragments data */
-	uint8_t      p2align;  /**< power 2 of two we should align */
-	uint8_t      max_skip; /**< Maximum number of bytes to skip for alignment */
-	uint16_t     n_relocations;
-	relocation_t relocations[];
-} fragment_info_t;
-
-struct ir_jit_segment_t {
-	struct obstack code_obst;
-	struct obstack fragment_info_obst;
-	struct obstack fragment_info_arr_obst;
-};
-
-struct ir_jit_function_t {
-	unsigned          size;
-	unsigned          n_fragments;
-	char const       *code;
-	fragment_info_t **fragment_infos;
-};
-
 struct obstack        *code_obst;
 static struct obstack *fragment_info_obst;
 static struct obstack *fragment_info_arr_obst;
@@ -72,15 +34,17 @@ ir_jit_segment_t *be_new_jit_segment(void)
 	obstack_init(&segment->code_obst);
 	obstack_init(&segment->fragment_info_obst);
 	obstack_init(&segment->fragment_info_arr_obst);
+	be_jit_init_memory(segment);
 	return segment;
 }
 
 void be_destroy_jit_segment(ir_jit_segment_t *segment)
 {
+	be_jit_free_memory(segment);
 	obstack_free(&segment->code_obst, NULL);
 	obstack_free(&segment->fragment_info_obst, NULL);
 	obstack_free(&segment->fragment_info_arr_obst, NULL);
-	free(segment);
+	xfree(segment);
 }
 
 void be_jit_set_entity_addr(ir_entity *entity, void const *address)
@@ -105,7 +69,7 @@ void be_jit_begin_function(ir_jit_segment_t *const segment)
 	fragment_info_arr_obst = &segment->fragment_info_arr_obst;
 }
 
-static void layout_fragments(ir_jit_function_t *const function,
+void be_jit_layout_fragments(ir_jit_function_t *const function,
                              unsigned const code_size)
 {
 	unsigned          const n_fragments    = function->n_fragments;
@@ -149,7 +113,7 @@ ir_jit_function_t *be_jit_finish_function(void)
 	res->fragment_infos = fragment_infos;
 	res->code           = obstack_finish(code_obst);
 
-	layout_fragments(res, code_size);
+	be_jit_layout_fragments(res, code_size);
 
 #ifndef NDEBUG
 	code_obst              = NULL;
@@ -165,6 +129,51 @@ unsigned be_get_function_size(ir_jit_function_t const *const function)
 	return function->size;
 }
 
+relocation_t const *be_jit_get_site_relocation(
+		ir_jit_function_t const *const function, size_t index,
+		unsigned *const offset)
+{
+	for (unsigned i = 0, n = function->n_fragments; i < n; ++i) {
+		fragment_info_t const *const fragment = function->fragment_infos[i];
+		for (unsigned r = 0, n_relocs = fragment->n_relocations; r < n_relocs;
+		     ++r) {
+			relocation_t const *const relocation = &fragment->relocations[r];
+			if (relocation->dest_kind != RELOC_DEST_ENTITY)
+				continue;
+			if (index-- == 0) {
+				*offset = fragment->address + relocation->offset;
+				return relocation;
+			}
+		}
+	}
+	panic("site index out of range");
+}
+
+size_t be_jit_get_n_sites(ir_jit_function_t const *const function)
+{
+	size_t n_sites = 0;
+	for (unsigned i = 0, n = function->n_fragments; i < n; ++i) {
+		fragment_info_t const *const fragment = function->fragment_infos[i];
+		for (unsigned r = 0, n_relocs = fragment->n_relocations; r < n_relocs;
+		     ++r) {
+			if (fragment->relocations[r].dest_kind == RELOC_DEST_ENTITY)
+				++n_sites;
+		}
+	}
+	return n_sites;
+}
+
+void be_jit_get_site(ir_jit_function_t const *const function,
+                     size_t const index, ir_jit_site_t *const site)
+{
+	unsigned                  offset;
+	relocation_t const *const relocation
+		= be_jit_get_site_relocation(function, index, &offset);
+	site->offset = offset;
+	site->entity = relocation->dest.entity;
+	site->addend = relocation->dest_offset;
+}
+
 unsigned be_begin_fragment(uint8_t const p2align, uint8_t const max_skip)
 {
 	assert(obstack_object_size(fragment_info_obst) == 0);
@@ -358,7 +367,7 @@ void be_jit_emit_memory(char *const buffer, ir_jit_function_t *const function,
 	for (size_t i = 0, n = function->n_fragments; i < n; ++i) {
 		fragment_info_t const *const fragment  = function->fragment_infos[i];
 		unsigned               const address   = fragment->address;
-		unsigned               const nop_bytes = last_address - address;
+		unsigned               const nop_bytes = address - last_address;
 		assert(address >= last_address);
 		if (nop_bytes > 0)
 			emitter->nops(buffer + last_address, nop_bytes);
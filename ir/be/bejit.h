@@ -33,6 +33,20 @@ typedef struct be_jit_emit_interface_t {
 void be_jit_emit_memory(char *buffer, ir_jit_function_t *function,
                         be_jit_emit_interface_t const *emitter);
 
+/**
+ * Returns the address @p buffer will be executed at.  While code is installed
+ * into dual mapped memory it is written through a different mapping than the
+ * one it runs from, so relative relocations must use this address.
+ */
+char const *be_jit_exec_address(char const *buffer);
+
+/**
+ * Encodes a relocation into @p buffer with the jit emitter of the selected
+ * backend and returns its size.
+ */
+unsigned be_emit_jit_relocation(char *buffer, uint8_t be_kind,
+                                ir_entity *entity, int32_t offset);
+
 void be_jit_emit_as_asm(ir_jit_function_t *function, emit_relocation_func emit);
 
 void be_jit_begin_function(ir_jit_segment_t *segment);
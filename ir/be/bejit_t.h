@@ -0,0 +1,77 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Internal data structures of jit compiled functions.
+ */
+#ifndef FIRM_BE_BEJIT_T_H
+#define FIRM_BE_BEJIT_T_H
+
+#include "bejit.h"
+#include "compiler.h"
+
+typedef enum reloc_dest_kind_t {
+	RELOC_DEST_CODE_FRAGMENT,
+	RELOC_DEST_ENTITY,
+} reloc_dest_kind_t;
+
+typedef struct relocation_t {
+	uint8_t                   be_kind;
+	ENUMBF(reloc_dest_kind_t) dest_kind : 8;
+	uint16_t                  offset;
+	int32_t                   dest_offset;
+	union dest {
+		uint16_t   fragment_num;
+		ir_entity *entity;
+	} dest;
+} relocation_t;
+
+typedef struct fragment_info_t {
+	unsigned     address;  /**< Address from begin of code segment */
+	unsigned     len;      /**< size of the fragments data */
+	uint8_t      p2align;  /**< power 2 of two we should align */
+	uint8_t      max_skip; /**< Maximum number of bytes to skip for alignment */
+	uint16_t     n_relocations;
+	relocation_t relocations[];
+} fragment_info_t;
+
+struct ir_jit_segment_t {
+	struct obstack         code_obst;
+	struct obstack         fragment_info_obst;
+	struct obstack         fragment_info_arr_obst;
+	ir_jit_memory_flags_t  memory_flags;
+	struct jit_chunk_t   **chunks;     /**< executable memory, ARR_F */
+	struct jit_block_t    *blocks;     /**< installed code sorted by address,
+	                                        ARR_F */
+};
+
+struct ir_jit_function_t {
+	unsigned          size;
+	unsigned          n_fragments;
+	char const       *code;
+	fragment_info_t **fragment_infos;
+};
+
+/**
+ * Assigns the final addresses to the fragments of @p function.  @p code_size
+ * is the size of the concatenated fragments without alignment.
+ */
+void be_jit_layout_fragments(ir_jit_function_t *function, unsigned code_size);
+
+/**
+ * Returns the @p index-th relocation of @p function, which refers to an
+ * entity, and stores its offset from the start of the function in @p offset.
+ */
+relocation_t const *be_jit_get_site_relocation(
+		ir_jit_function_t const *function, size_t index, unsigned *offset);
+
+/** Initializes the executable memory pool of @p segment. */
+void be_jit_init_memory(ir_jit_segment_t *segment);
+
+/** Unmaps all executable memory of @p segment. */
+void be_jit_free_memory(ir_jit_segment_t *segment);
+
+#endif
@@ -0,0 +1,485 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Persistent cache of jit compiled functions.
+ *
+ * A function is looked up by the structural fingerprint of its graph, see
+ * be_fingerprint_graph(), code of other libFirm revisions is never used.
+ * The cached fragments and relocations are position independent, so loading
+ * a function only copies it into the segment; relocations are resolved by
+ * be_emit_function() as usual.
+ *
+ * The cache file is mapped into memory when the cache is opened.  Functions
+ * added to the cache are collected in memory and the whole file is written
+ * anew when the cache is closed.  Failing to read or write the file only
+ * results in an empty cache.
+ */
+#include "bejit_t.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "be_t.h"
+#include "befingerprint.h"
+#include "entity_t.h"
+#include "hashptr.h"
+#include "irprog.h"
+#include "obst.h"
+#include "panic.h"
+#include "pmap.h"
+#include "set.h"
+#include "typerep.h"
+#include "util.h"
+
+#define CACHE_MAGIC   "FIRMJITC"
+#define CACHE_VERSION 1
+
+/** Header of the cache file, followed by the libFirm revision and the
+ * entries. */
+typedef struct cache_header_t {
+	char     magic[8];
+	uint32_t version;
+	uint32_t n_entries;
+	uint32_t revision_size; /**< including the terminating zero and padding */
+} cache_header_t;
+
+/** Header of a cache entry, followed by the key, the fragments, the
+ * relocations, the names of relocated entities and the code. */
+typedef struct cache_entry_header_t {
+	uint32_t key_size;
+	uint32_t n_fragments;
+	uint32_t n_relocations;
+	uint32_t names_size;
+	uint32_t code_size;
+} cache_entry_header_t;
+
+typedef struct cache_fragment_t {
+	uint32_t len;
+	uint8_t  p2align;
+	uint8_t  max_skip;
+	uint16_t n_relocations;
+} cache_fragment_t;
+
+typedef struct cache_relocation_t {
+	uint8_t  be_kind;
+	uint8_t  dest_kind;
+	uint16_t offset;
+	int32_t  dest_offset;
+	uint32_t dest;        /**< fragment number or offset of the entity name */
+} cache_relocation_t;
+
+typedef struct cache_entry_t {
+	char                 const *key;
+	uint32_t                    key_size;
+	cache_entry_header_t const *header;
+} cache_entry_t;
+
+struct ir_jit_cache_t {
+	char           *filename;
+	char const     *mapping;      /**< contents of the cache file */
+	size_t          mapping_size;
+	char const     *old_entries;  /**< entries of the file still valid */
+	size_t          old_size;
+	uint32_t        n_old;
+	set            *entries;
+	struct obstack  obst;         /**< holds the new entries */
+	char          **new_entries;
+	size_t         *new_sizes;
+};
+
+static size_t pad4(size_t const size)
+{
+	return (size + 3) & ~(size_t)3;
+}
+
+static int cmp_cache_entry(void const *const elt, void const *const key,
+                           size_t const size)
+{
+	(void)size;
+	cache_entry_t const *const e0 = (cache_entry_t const*)elt;
+	cache_entry_t const *const e1 = (cache_entry_t const*)key;
+	return e0->key_size != e1->key_size
+	    || memcmp(e0->key, e1->key, e0->key_size) != 0;
+}
+
+static void add_entry(ir_jit_cache_t *const cache,
+                      cache_entry_header_t const *const header)
+{
+	cache_entry_t const entry = {
+		.key      = (char const*)(header + 1),
+		.key_size = header->key_size,
+		.header   = header,
+	};
+	unsigned const hash = hash_data((unsigned char const*)entry.key,
+	                                entry.key_size);
+	(void)set_insert(cache_entry_t, cache->entries, &entry, sizeof(entry),
+	                 hash);
+}
+
+static size_t get_entry_size(cache_entry_header_t const *const header)
+{
+	return sizeof(*header) + pad4(header->key_size)
+	     + header->n_fragments * sizeof(cache_fragment_t)
+	     + header->n_relocations * sizeof(cache_relocation_t)
+	     + pad4(header->names_size) + pad4(header->code_size);
+}
+
+/** Checks that the fragments and relocations of @p entry are consistent. */
+static bool check_entry(cache_entry_header_t const *const entry)
+{
+	char const *const key = (char const*)(entry + 1);
+	cache_fragment_t const *const fragments
+		= (cache_fragment_t const*)(key + pad4(entry->key_size));
+	cache_relocation_t const *const relocations
+		= (cache_relocation_t const*)(fragments + entry->n_fragments);
+
+	uint32_t code_size     = 0;
+	uint32_t n_relocations = 0;
+	for (uint32_t f = 0; f < entry->n_fragments; ++f) {
+		code_size     += fragments[f].len;
+		n_relocations += fragments[f].n_relocations;
+	}
+	if (code_size != entry->code_size || n_relocations != entry->n_relocations)
+		return false;
+	for (uint32_t r = 0; r < n_relocations; ++r) {
+		cache_relocation_t const *const reloc = &relocations[r];
+		uint32_t const limit = reloc->dest_kind == RELOC_DEST_ENTITY
+		                     ? entry->names_size : entry->n_fragments;
+		if ((reloc->dest_kind != RELOC_DEST_ENTITY
+		  && reloc->dest_kind != RELOC_DEST_CODE_FRAGMENT)
+		 || reloc->dest >= limit)
+			return false;
+	}
+	char const *const names = (char const*)(relocations + n_relocations);
+	return entry->names_size == 0 || names[entry->names_size - 1] == '\0';
+}
+
+/** Adds the entries of the mapped cache file, stops at the first damaged
+ * entry. */
+static void read_cache_file(ir_jit_cache_t *const cache)
+{
+	char   const *const data = cache->mapping;
+	size_t        const size = cache->mapping_size;
+	if (size < sizeof(cache_header_t))
+		return;
+	cache_header_t const *const header = (cache_header_t const*)data;
+	if (memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0
+	 || header->version != CACHE_VERSION)
+		return;
+
+	/* code of other libFirm revisions is never used again */
+	char   const *const revision      = ir_get_version_revision();
+	size_t        const revision_size = pad4(strlen(revision) + 1);
+	if (header->revision_size != revision_size
+	 || size - sizeof(*header) < revision_size
+	 || strcmp(data + sizeof(*header), revision) != 0)
+		return;
+
+	size_t const begin = sizeof(*header) + revision_size;
+	size_t       pos   = begin;
+	uint32_t     n     = 0;
+	for (; n < header->n_entries; ++n) {
+		if (size - pos < sizeof(cache_entry_header_t))
+			break;
+		cache_entry_header_t const *const entry
+			= (cache_entry_header_t const*)(data + pos);
+		if (entry->key_size > size || entry->n_fragments > size
+		 || entry->n_relocations > size || entry->names_size > size
+		 || entry->code_size > size)
+			break;
+		size_t const entry_size = get_entry_size(entry);
+		if (size - pos < entry_size || !check_entry(entry))
+			break;
+		add_entry(cache, entry);
+		pos += entry_size;
+	}
+	cache->old_entries = data + begin;
+	cache->old_size    = pos - begin;
+	cache->n_old       = n;
+}
+
+ir_jit_cache_t *be_jit_open_cache(char const *const filename)
+{
+	ir_jit_cache_t *const cache = XMALLOCZ(ir_jit_cache_t);
+	size_t          const len   = strlen(filename);
+	cache->filename    = XMALLOCN(char, len + 1);
+	memcpy(cache->filename, filename, len + 1);
+	cache->entries     = new_set(cmp_cache_entry, 16);
+	cache->new_entries = NEW_ARR_F(char*, 0);
+	cache->new_sizes   = NEW_ARR_F(size_t, 0);
+	obstack_init(&cache->obst);
+
+	int const fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return cache;
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		void *const mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+		                           fd, 0);
+		if (mapping != MAP_FAILED) {
+			cache->mapping      = (char const*)mapping;
+			cache->mapping_size = st.st_size;
+			read_cache_file(cache);
+		}
+	}
+	close(fd);
+	return cache;
+}
+
+static void write_padded(FILE *const out, void const *const data,
+                         size_t const size)
+{
+	static char const zeros[3];
+	fwrite(data, 1, size, out);
+	fwrite(zeros, 1, pad4(size) - size, out);
+}
+
+static void write_cache_file(ir_jit_cache_t const *const cache)
+{
+	size_t const len      = strlen(cache->filename);
+	char  *const tmp_name = XMALLOCN(char, len + 5);
+	memcpy(tmp_name, cache->filename, len);
+	memcpy(tmp_name + len, ".tmp", 5);
+
+	FILE *const out = fopen(tmp_name, "wb");
+	if (out != NULL) {
+		char const *const revision = ir_get_version_revision();
+		size_t      const n_new    = ARR_LEN(cache->new_entries);
+		cache_header_t header = {
+			.version       = CACHE_VERSION,
+			.n_entries     = cache->n_old + n_new,
+			.revision_size = pad4(strlen(revision) + 1),
+		};
+		memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+		fwrite(&header, 1, sizeof(header), out);
+		write_padded(out, revision, strlen(revision) + 1);
+		fwrite(cache->old_entries, 1, cache->old_size, out);
+		for (size_t i = 0; i < n_new; ++i) {
+			fwrite(cache->new_entries[i], 1, cache->new_sizes[i], out);
+		}
+		/* replace the file atomically, so concurrent readers only see
+		 * complete caches */
+		bool const failed = ferror(out);
+		if (fclose(out) != 0 || failed || rename(tmp_name, cache->filename) != 0)
+			remove(tmp_name);
+	}
+	xfree(tmp_name);
+}
+
+void be_jit_close_cache(ir_jit_cache_t *const cache)
+{
+	if (ARR_LEN(cache->new_entries) > 0)
+		write_cache_file(cache);
+
+	if (cache->mapping != NULL)
+		munmap((void*)cache->mapping, cache->mapping_size);
+	DEL_ARR_F(cache->new_sizes);
+	DEL_ARR_F(cache->new_entries);
+	obstack_free(&cache->obst, NULL);
+	del_set(cache->entries);
+	xfree(cache->filename);
+	xfree(cache);
+}
+
+/*
+ * Lookup and insertion
+ */
+
+static ir_jit_function_t *load_function(ir_jit_segment_t *const segment,
+                                        cache_entry_header_t const *const entry)
+{
+	char const *const key = (char const*)(entry + 1);
+	cache_fragment_t const *const fragments
+		= (cache_fragment_t const*)(key + pad4(entry->key_size));
+	cache_relocation_t const *const relocations
+		= (cache_relocation_t const*)(fragments + entry->n_fragments);
+	char const *const names
+		= (char const*)(relocations + entry->n_relocations);
+	char const *const code = names + pad4(entry->names_size);
+
+	/* resolve the relocated entities first, the function is not usable
+	 * without them */
+	pmap *const entities = pmap_create();
+	bool        found    = true;
+	for (uint32_t r = 0; r < entry->n_relocations && found; ++r) {
+		cache_relocation_t const *const reloc = &relocations[r];
+		if (reloc->dest_kind != RELOC_DEST_ENTITY
+		 || pmap_contains(entities, INT_TO_PTR(reloc->dest + 1)))
+			continue;
+		ident *const id = new_id_from_str(names + reloc->dest);
+		found = false;
+		for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST && !found;
+		     ++s) {
+			ir_type *const type = get_segment_type(s);
+			for (size_t i = 0, n = get_compound_n_members(type); i < n; ++i) {
+				ir_entity *const member = get_compound_member(type, i);
+				if (get_entity_ld_ident(member) == id) {
+					pmap_insert(entities, INT_TO_PTR(reloc->dest + 1), member);
+					found = true;
+					break;
+				}
+			}
+		}
+	}
+	if (!found) {
+		pmap_destroy(entities);
+		return NULL;
+	}
+
+	be_jit_begin_function(segment);
+	obstack_grow(&segment->code_obst, code, entry->code_size);
+	cache_relocation_t const *reloc = relocations;
+	for (uint32_t f = 0; f < entry->n_fragments; ++f) {
+		cache_fragment_t const *const cached = &fragments[f];
+		size_t const size = sizeof(fragment_info_t)
+		                  + cached->n_relocations * sizeof(relocation_t);
+		fragment_info_t *const fragment
+			= (fragment_info_t*)obstack_alloc(&segment->fragment_info_obst, size);
+		fragment->address       = ~0u;
+		fragment->len           = cached->len;
+		fragment->p2align       = cached->p2align;
+		fragment->max_skip      = cached->max_skip;
+		fragment->n_relocations = cached->n_relocations;
+		for (unsigned r = 0; r < cached->n_relocations; ++r, ++reloc) {
+			relocation_t *const relocation = &fragment->relocations[r];
+			relocation->be_kind     = reloc->be_kind;
+			relocation->dest_kind   = (reloc_dest_kind_t)reloc->dest_kind;
+			relocation->offset      = reloc->offset;
+			relocation->dest_offset = reloc->dest_offset;
+			if (reloc->dest_kind == RELOC_DEST_ENTITY) {
+				relocation->dest.entity
+					= pmap_get(ir_entity, entities, INT_TO_PTR(reloc->dest + 1));
+			} else {
+				relocation->dest.fragment_num = reloc->dest;
+			}
+		}
+		obstack_ptr_grow(&segment->fragment_info_arr_obst, fragment);
+	}
+	pmap_destroy(entities);
+	return be_jit_finish_function();
+}
+
+/** Serializes @p function to a new entry with the key @p key. */
+static void store_function(ir_jit_cache_t *const cache, char const *const key,
+                           uint32_t const key_size,
+                           ir_jit_function_t const *const function)
+{
+	struct obstack *const obst = &cache->obst;
+
+	/* the names of entities are collected in front of the entry and moved
+	 * behind the relocations later */
+	struct obstack names;
+	obstack_init(&names);
+	pmap *const name_offsets = pmap_create();
+
+	uint32_t code_size     = 0;
+	uint32_t n_relocations = 0;
+	for (unsigned f = 0; f < function->n_fragments; ++f) {
+		fragment_info_t const *const fragment = function->fragment_infos[f];
+		code_size     += fragment->len;
+		n_relocations += fragment->n_relocations;
+		for (unsigned r = 0; r < fragment->n_relocations; ++r) {
+			relocation_t const *const reloc = &fragment->relocations[r];
+			if (reloc->dest_kind != RELOC_DEST_ENTITY)
+				continue;
+			ir_entity *const entity = reloc->dest.entity;
+			if (pmap_contains(name_offsets, entity))
+				continue;
+			pmap_insert(name_offsets, entity,
+			            INT_TO_PTR(obstack_object_size(&names)));
+			char const *const name = get_entity_ld_name(entity);
+			obstack_grow(&names, name, strlen(name) + 1);
+		}
+	}
+
+	cache_entry_header_t const header = {
+		.key_size      = key_size,
+		.n_fragments   = function->n_fragments,
+		.n_relocations = n_relocations,
+		.names_size    = obstack_object_size(&names),
+		.code_size     = code_size,
+	};
+	size_t const size = get_entry_size(&header);
+	char  *const data = (char*)obstack_alloc(obst, size);
+	memset(data, 0, size);
+	memcpy(data, &header, sizeof(header));
+	memcpy(data + sizeof(header), key, key_size);
+
+	cache_fragment_t *const fragments
+		= (cache_fragment_t*)(data + sizeof(header) + pad4(key_size));
+	cache_relocation_t *reloc
+		= (cache_relocation_t*)(fragments + function->n_fragments);
+	char *const names_begin = (char*)(reloc + n_relocations);
+	memcpy(names_begin, obstack_base(&names), header.names_size);
+	memcpy(names_begin + pad4(header.names_size), function->code, code_size);
+
+	for (unsigned f = 0; f < function->n_fragments; ++f) {
+		fragment_info_t const *const fragment = function->fragment_infos[f];
+		fragments[f] = (cache_fragment_t) {
+			.len           = fragment->len,
+			.p2align       = fragment->p2align,
+			.max_skip      = fragment->max_skip,
+			.n_relocations = fragment->n_relocations,
+		};
+		for (unsigned r = 0; r < fragment->n_relocations; ++r, ++reloc) {
+			relocation_t const *const relocation = &fragment->relocations[r];
+			bool const is_entity = relocation->dest_kind == RELOC_DEST_ENTITY;
+			*reloc = (cache_relocation_t) {
+				.be_kind     = relocation->be_kind,
+				.dest_kind   = relocation->dest_kind,
+				.offset      = relocation->offset,
+				.dest_offset = relocation->dest_offset,
+				.dest        = is_entity
+					? PTR_TO_INT(pmap_get(void, name_offsets,
+					                      relocation->dest.entity))
+					: relocation->dest.fragment_num,
+			};
+		}
+	}
+
+	pmap_destroy(name_offsets);
+	obstack_free(&names, NULL);
+
+	ARR_APP1(char*, cache->new_entries, data);
+	ARR_APP1(size_t, cache->new_sizes, size);
+	add_entry(cache, (cache_entry_header_t const*)data);
+}
+
+ir_jit_function_t *be_jit_compile_cached(ir_jit_cache_t *const cache,
+                                         ir_jit_segment_t *const segment,
+                                         ir_graph *const irg)
+{
+	struct obstack obst;
+	obstack_init(&obst);
+	if (!be_fingerprint_graph(&obst, irg)) {
+		obstack_free(&obst, NULL);
+		return be_jit_compile(segment, irg);
+	}
+
+	uint32_t      const key_size = obstack_object_size(&obst);
+	char   const *const key      = (char const*)obstack_finish(&obst);
+	cache_entry_t const templ    = { .key = key, .key_size = key_size };
+	unsigned      const hash     = hash_data((unsigned char const*)key,
+	                                         key_size);
+	cache_entry_t const *const found
+		= set_find(cache_entry_t, cache->entries, &templ, sizeof(templ), hash);
+
+	ir_jit_function_t *res = NULL;
+	if (found != NULL)
+		res = load_function(segment, found->header);
+	if (res == NULL) {
+		res = be_jit_compile(segment, irg);
+		if (res != NULL && found == NULL)
+			store_function(cache, key, key_size, res);
+	}
+	obstack_free(&obst, NULL);
+	return res;
+}
@@ -0,0 +1,481 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Executable memory of jit segments.
+ *
+ * Installed code is placed in chunks of executable memory, which are carved
+ * up with a first fit free list.  A chunk is never writable and executable at
+ * the same time: Either it is mapped twice from a memory file, once writable
+ * and once executable, or its protection is switched while a batch of
+ * functions is copied into it.  All functions of a batch are allocated before
+ * any code is written, so a batch costs at most one pair of mprotect() calls
+ * per chunk.
+ */
+/* for memfd_create and MAP_ANONYMOUS */
+#define _GNU_SOURCE
+
+#include "bejit_t.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "array.h"
+#include "bitfiddle.h"
+#include "panic.h"
+#include "util.h"
+
+/** Size of chunks backed by normal pages. */
+#define CHUNK_SIZE      (256 * 1024)
+/** Size of chunks backed by huge pages. */
+#define HUGE_CHUNK_SIZE (2 * 1024 * 1024)
+/** Minimum alignment of installed functions. */
+#define CODE_ALIGNMENT  16
+
+typedef struct jit_range_t {
+	size_t begin;
+	size_t end;
+} jit_range_t;
+
+typedef struct jit_chunk_t {
+	char        *exec;        /**< executable mapping */
+	char        *write;       /**< writable mapping, equal to exec unless the
+	                               chunk is dual mapped */
+	size_t       size;
+	jit_range_t *free;        /**< free ranges sorted by offset, ARR_F */
+	size_t       dirty_begin; /**< range written by the current batch */
+	size_t       dirty_end;
+} jit_chunk_t;
+
+typedef struct jit_block_t {
+	char const  *address;
+	size_t       size;
+	jit_chunk_t *chunk;
+} jit_block_t;
+
+/** Difference between the executable and the writable mapping of the code
+ * being written. */
+static uintptr_t exec_displacement;
+
+char const *be_jit_exec_address(char const *const buffer)
+{
+	return (char const*)((uintptr_t)buffer + exec_displacement);
+}
+
+void be_jit_init_memory(ir_jit_segment_t *const segment)
+{
+	segment->memory_flags = IR_JIT_MEMORY_DEFAULT;
+	segment->chunks       = NEW_ARR_F(jit_chunk_t*, 0);
+	segment->blocks       = NEW_ARR_F(jit_block_t, 0);
+}
+
+static void free_chunk(jit_chunk_t *const chunk)
+{
+	munmap(chunk->exec, chunk->size);
+	if (chunk->write != chunk->exec)
+		munmap(chunk->write, chunk->size);
+	DEL_ARR_F(chunk->free);
+	xfree(chunk);
+}
+
+void be_jit_free_memory(ir_jit_segment_t *const segment)
+{
+	for (size_t i = 0, n = ARR_LEN(segment->chunks); i < n; ++i) {
+		free_chunk(segment->chunks[i]);
+	}
+	DEL_ARR_F(segment->chunks);
+	DEL_ARR_F(segment->blocks);
+}
+
+void be_jit_set_memory_flags(ir_jit_segment_t *const segment,
+                             ir_jit_memory_flags_t const flags)
+{
+	assert(ARR_LEN(segment->chunks) == 0);
+	segment->memory_flags = flags;
+}
+
+static bool map_dual(jit_chunk_t *const chunk, bool const huge)
+{
+#ifdef __linux__
+	int fd = -1;
+#ifdef MFD_HUGETLB
+	if (huge)
+		fd = memfd_create("firm-jit", MFD_CLOEXEC | MFD_HUGETLB);
+#else
+	(void)huge;
+#endif
+	if (fd < 0)
+		fd = memfd_create("firm-jit", MFD_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	bool success = false;
+	if (ftruncate(fd, chunk->size) == 0) {
+		void *const write = mmap(NULL, chunk->size, PROT_READ | PROT_WRITE,
+		                         MAP_SHARED, fd, 0);
+		void *const exec  = mmap(NULL, chunk->size, PROT_READ | PROT_EXEC,
+		                         MAP_SHARED, fd, 0);
+		if (write != MAP_FAILED && exec != MAP_FAILED) {
+			chunk->write = (char*)write;
+			chunk->exec  = (char*)exec;
+			success      = true;
+		} else {
+			if (write != MAP_FAILED)
+				munmap(write, chunk->size);
+			if (exec != MAP_FAILED)
+				munmap(exec, chunk->size);
+		}
+	}
+	close(fd);
+	return success;
+#else
+	(void)chunk;
+	(void)huge;
+	return false;
+#endif
+}
+
+static bool map_single(jit_chunk_t *const chunk, bool const huge)
+{
+	int const flags   = MAP_PRIVATE | MAP_ANONYMOUS;
+	void     *address = MAP_FAILED;
+#ifdef MAP_HUGETLB
+	if (huge)
+		address = mmap(NULL, chunk->size, PROT_READ | PROT_EXEC,
+		               flags | MAP_HUGETLB, -1, 0);
+#endif
+	if (address == MAP_FAILED) {
+		address = mmap(NULL, chunk->size, PROT_READ | PROT_EXEC, flags, -1, 0);
+		if (address == MAP_FAILED)
+			return false;
+#ifdef MADV_HUGEPAGE
+		if (huge)
+			madvise(address, chunk->size, MADV_HUGEPAGE);
+#endif
+	}
+	chunk->exec  = (char*)address;
+	chunk->write = (char*)address;
+	return true;
+}
+
+static jit_chunk_t *new_chunk(ir_jit_segment_t *const segment,
+                              size_t const min_size)
+{
+	ir_jit_memory_flags_t const flags = segment->memory_flags;
+	bool   const huge       = flags & IR_JIT_MEMORY_HUGE_PAGES;
+	size_t const chunk_size = huge ? HUGE_CHUNK_SIZE : CHUNK_SIZE;
+	size_t const page_size  = sysconf(_SC_PAGESIZE);
+	size_t const size       = round_up2(round_up2(MAX(min_size, chunk_size),
+	                                              chunk_size), page_size);
+
+	jit_chunk_t *const chunk = XMALLOCZ(jit_chunk_t);
+	chunk->size = size;
+	bool const mapped = flags & IR_JIT_MEMORY_DUAL_MAPPING
+		? map_dual(chunk, huge) : map_single(chunk, huge);
+	if (!mapped)
+		panic("could not allocate memory for jit code");
+
+	chunk->free = NEW_ARR_F(jit_range_t, 1);
+	chunk->free[0] = (jit_range_t) { .begin = 0, .end = size };
+	chunk->dirty_begin = size;
+	chunk->dirty_end   = 0;
+	ARR_APP1(jit_chunk_t*, segment->chunks, chunk);
+	return chunk;
+}
+
+/** Takes @p size bytes aligned to @p align from the free ranges of
+ * @p chunk, returns the offset or (size_t)-1 if nothing fits. */
+static size_t take_range(jit_chunk_t *const chunk, size_t const size,
+                         size_t const align)
+{
+	jit_range_t *ranges = chunk->free;
+	for (size_t i = 0, n = ARR_LEN(ranges); i < n; ++i) {
+		jit_range_t *const range = &ranges[i];
+		size_t       const begin = round_up2(range->begin, align);
+		size_t       const end   = begin + size;
+		if (begin < range->begin || end > range->end)
+			continue;
+
+		size_t const rest_end = range->end;
+		if (begin > range->begin) {
+			range->end = begin;
+			if (end < rest_end) {
+				/* split the range */
+				ARR_EXTEND(jit_range_t, chunk->free, 1);
+				ranges = chunk->free;
+				memmove(&ranges[i + 2], &ranges[i + 1],
+				        (n - i - 1) * sizeof(*ranges));
+				ranges[i + 1] = (jit_range_t) { .begin = end, .end = rest_end };
+			}
+		} else if (end < rest_end) {
+			range->begin = end;
+		} else {
+			memmove(&ranges[i], &ranges[i + 1],
+			        (n - i - 1) * sizeof(*ranges));
+			ARR_RESIZE(jit_range_t, chunk->free, n - 1);
+		}
+		return begin;
+	}
+	return (size_t)-1;
+}
+
+/** Returns @p size bytes at @p begin to the free ranges of @p chunk. */
+static void release_range(jit_chunk_t *const chunk, size_t const begin,
+                          size_t const size)
+{
+	size_t const end = begin + size;
+	size_t const n   = ARR_LEN(chunk->free);
+	size_t       i   = 0;
+	while (i < n && chunk->free[i].begin < begin)
+		++i;
+
+	jit_range_t *const ranges    = chunk->free;
+	bool         const join_prev = i > 0 && ranges[i - 1].end == begin;
+	bool         const join_next = i < n && ranges[i].begin == end;
+	if (join_prev && join_next) {
+		ranges[i - 1].end = ranges[i].end;
+		memmove(&ranges[i], &ranges[i + 1], (n - i - 1) * sizeof(*ranges));
+		ARR_RESIZE(jit_range_t, chunk->free, n - 1);
+	} else if (join_prev) {
+		ranges[i - 1].end = end;
+	} else if (join_next) {
+		ranges[i].begin = begin;
+	} else {
+		ARR_EXTEND(jit_range_t, chunk->free, 1);
+		memmove(&chunk->free[i + 1], &chunk->free[i],
+		        (n - i) * sizeof(*chunk->free));
+		chunk->free[i] = (jit_range_t) { .begin = begin, .end = end };
+	}
+}
+
+static void add_block(ir_jit_segment_t *const segment,
+                      jit_block_t const *const block)
+{
+	size_t const n = ARR_LEN(segment->blocks);
+	size_t       i = n;
+	while (i > 0 && segment->blocks[i - 1].address > block->address)
+		--i;
+	ARR_APP1(jit_block_t, segment->blocks, *block);
+	jit_block_t *const blocks = segment->blocks;
+	memmove(&blocks[i + 1], &blocks[i], (n - i) * sizeof(*blocks));
+	blocks[i] = *block;
+}
+
+static char *allocate_code(ir_jit_segment_t *const segment, size_t const size,
+                           size_t const align)
+{
+	jit_chunk_t *chunk  = NULL;
+	size_t       offset = (size_t)-1;
+	for (size_t i = 0, n = ARR_LEN(segment->chunks); i < n; ++i) {
+		chunk  = segment->chunks[i];
+		offset = take_range(chunk, size, align);
+		if (offset != (size_t)-1)
+			break;
+	}
+	if (offset == (size_t)-1) {
+		chunk  = new_chunk(segment, size + align);
+		offset = take_range(chunk, size, align);
+		assert(offset != (size_t)-1);
+	}
+
+	chunk->dirty_begin = MIN(chunk->dirty_begin, offset);
+	chunk->dirty_end   = MAX(chunk->dirty_end, offset + size);
+
+	jit_block_t const block = {
+		.address = chunk->exec + offset,
+		.size    = size,
+		.chunk   = chunk,
+	};
+	add_block(segment, &block);
+	return chunk->exec + offset;
+}
+
+static jit_block_t *find_block(ir_jit_segment_t *const segment,
+                               char const *const address)
+{
+	jit_block_t *const blocks = segment->blocks;
+	size_t             lo     = 0;
+	size_t             hi     = ARR_LEN(blocks);
+	while (lo < hi) {
+		size_t const mid = lo + (hi - lo) / 2;
+		if (blocks[mid].address < address) {
+			lo = mid + 1;
+		} else if (blocks[mid].address > address) {
+			hi = mid;
+		} else {
+			return &blocks[mid];
+		}
+	}
+	return NULL;
+}
+
+static unsigned get_function_alignment(ir_jit_function_t const *const function)
+{
+	unsigned align = CODE_ALIGNMENT;
+	for (unsigned i = 0, n = function->n_fragments; i < n; ++i) {
+		align = MAX(align, 1u << function->fragment_infos[i]->p2align);
+	}
+	return align;
+}
+
+/** Changes the protection of the pages of @p chunk, which contain the bytes
+ * from @p begin to @p end. */
+static void protect_range(jit_chunk_t const *const chunk, size_t const begin,
+                          size_t const end, int const prot)
+{
+	size_t const page_size  = sysconf(_SC_PAGESIZE);
+	size_t const page_begin = begin & ~(page_size - 1);
+	size_t const page_end   = round_up2(end, page_size);
+	if (mprotect(chunk->exec + page_begin, page_end - page_begin, prot) != 0)
+		panic("could not change protection of jit code");
+}
+
+/** Changes the protection of the pages written by the current batch. */
+static void protect_dirty(jit_chunk_t const *const chunk, int const prot)
+{
+	protect_range(chunk, chunk->dirty_begin, chunk->dirty_end, prot);
+}
+
+void be_jit_install_functions(ir_jit_segment_t *const segment,
+                              size_t const n_functions,
+                              ir_jit_function_t *const *const functions,
+                              void const **const addresses)
+{
+	for (size_t i = 0; i < n_functions; ++i) {
+		ir_jit_function_t const *const function = functions[i];
+		addresses[i] = allocate_code(segment, be_get_function_size(function),
+		                             get_function_alignment(function));
+	}
+
+	bool const dual = segment->memory_flags & IR_JIT_MEMORY_DUAL_MAPPING;
+	jit_chunk_t **const chunks = segment->chunks;
+	if (!dual) {
+		for (size_t i = 0, n = ARR_LEN(chunks); i < n; ++i) {
+			if (chunks[i]->dirty_begin < chunks[i]->dirty_end)
+				protect_dirty(chunks[i], PROT_READ | PROT_WRITE);
+		}
+	}
+
+	for (size_t i = 0; i < n_functions; ++i) {
+		jit_block_t const *const block
+			= find_block(segment, (char const*)addresses[i]);
+		jit_chunk_t const *const chunk = block->chunk;
+		char              *const write
+			= chunk->write + (block->address - chunk->exec);
+		exec_displacement = (uintptr_t)chunk->exec - (uintptr_t)chunk->write;
+		be_emit_function(write, functions[i]);
+	}
+	exec_displacement = 0;
+
+	for (size_t i = 0, n = ARR_LEN(chunks); i < n; ++i) {
+		jit_chunk_t *const chunk = chunks[i];
+		if (chunk->dirty_begin >= chunk->dirty_end)
+			continue;
+		if (!dual)
+			protect_dirty(chunk, PROT_READ | PROT_EXEC);
+		__builtin___clear_cache(chunk->exec + chunk->dirty_begin,
+		                        chunk->exec + chunk->dirty_end);
+		chunk->dirty_begin = chunk->size;
+		chunk->dirty_end   = 0;
+	}
+}
+
+void be_jit_free_code(ir_jit_segment_t *const segment,
+                      void const *const address)
+{
+	jit_block_t *const block = find_block(segment, (char const*)address);
+	if (block == NULL)
+		panic("%p is not jit code of the segment", address);
+
+	jit_chunk_t *const chunk = block->chunk;
+	release_range(chunk, block->address - chunk->exec, block->size);
+
+	jit_block_t *const blocks = segment->blocks;
+	size_t       const n      = ARR_LEN(blocks);
+	size_t       const i      = block - blocks;
+	memmove(&blocks[i], &blocks[i + 1], (n - i - 1) * sizeof(*blocks));
+	ARR_RESIZE(jit_block_t, segment->blocks, n - 1);
+}
+
+void be_jit_compact_memory(ir_jit_segment_t *const segment)
+{
+	jit_chunk_t **const chunks = segment->chunks;
+	size_t              n      = 0;
+	for (size_t i = 0, n_chunks = ARR_LEN(chunks); i < n_chunks; ++i) {
+		jit_chunk_t *const chunk  = chunks[i];
+		jit_range_t *const ranges = chunk->free;
+		bool         const unused = ARR_LEN(ranges) == 1
+		                         && ranges[0].begin == 0
+		                         && ranges[0].end == chunk->size;
+		if (unused) {
+			free_chunk(chunk);
+		} else {
+			chunks[n++] = chunk;
+		}
+	}
+	ARR_RESIZE(jit_chunk_t*, segment->chunks, n);
+}
+
+int be_jit_patch_site(ir_jit_segment_t *const segment, void const *const code,
+                      ir_jit_function_t const *const function,
+                      size_t const index, void const *const address)
+{
+	jit_block_t const *const block = find_block(segment, (char const*)code);
+	if (block == NULL)
+		panic("%p is not jit code of the segment", code);
+
+	unsigned                  offset;
+	relocation_t const *const relocation
+		= be_jit_get_site_relocation(function, index, &offset);
+	jit_chunk_t  const *const chunk       = block->chunk;
+	size_t              const site_offset = block->address - chunk->exec + offset;
+	char               *const write       = chunk->write + site_offset;
+
+	/* Encode the site into a buffer as if it were at its executable address,
+	 * with the entity temporarily resolved to the new address.  Sites are
+	 * filled completely, so the old bytes only serve as padding. */
+	char         buffer[32];
+	size_t const avail = MIN(sizeof(buffer), block->size - offset);
+	memcpy(buffer, write, avail);
+	ir_entity  *const entity   = relocation->dest.entity;
+	void const *const old_addr = be_jit_get_entity_addr(entity);
+	be_jit_set_entity_addr(entity, address);
+	exec_displacement = (uintptr_t)(chunk->exec + site_offset)
+	                  - (uintptr_t)buffer;
+	unsigned const size = be_emit_jit_relocation(buffer, relocation->be_kind,
+	                                             entity,
+	                                             relocation->dest_offset);
+	exec_displacement = 0;
+	be_jit_set_entity_addr(entity, old_addr);
+	assert(size <= avail);
+
+	bool const dual = segment->memory_flags & IR_JIT_MEMORY_DUAL_MAPPING;
+	if (!dual)
+		protect_range(chunk, site_offset, site_offset + size,
+		              PROT_READ | PROT_WRITE);
+
+	/* Both mappings have the same alignment, so a site within an aligned
+	 * word of the executable code is replaced by a single store. */
+	size_t const misalign = site_offset % sizeof(uint64_t);
+	bool   const atomic   = misalign + size <= sizeof(uint64_t);
+	if (atomic) {
+		uint64_t *const word  = (uint64_t*)(write - misalign);
+		uint64_t        value = __atomic_load_n(word, __ATOMIC_RELAXED);
+		memcpy((char*)&value + misalign, buffer, size);
+		__atomic_store_n(word, value, __ATOMIC_RELEASE);
+	} else {
+		memcpy(write, buffer, size);
+	}
+
+	if (!dual)
+		protect_range(chunk, site_offset, site_offset + size,
+		              PROT_READ | PROT_EXEC);
+	__builtin___clear_cache(chunk->exec + site_offset,
+	                        chunk->exec + site_offset + size);
+	return atomic;
+}
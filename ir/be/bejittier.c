@@ -0,0 +1,275 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Lazy compilation and tiered recompilation of jit functions.
+ *
+ * Every function gets a stub, which is built as a firm graph and compiled
+ * like any other function:
+ *
+ *   code = fn->code; if (code == NULL || ++fn->counter == threshold)
+ *       code = tier_up(fn);
+ *   return code(args...);
+ *
+ * tier_up() compiles a copy of the graph with the linear scan allocator on
+ * the first call and the graph itself with the default pipeline once the
+ * function became hot.  The new code is published with a single pointer
+ * store, so threads still running the old code are not disturbed.  Callers
+ * always go through the stub, so call sites never need patching.
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "array.h"
+#include "bera.h"
+#include "ircons.h"
+#include "irgraph_t.h"
+#include "irmode_t.h"
+#include "irprog.h"
+#include "jit.h"
+#include "panic.h"
+#include "tv.h"
+#include "typerep.h"
+#include "util.h"
+
+struct ir_jit_tiering_t {
+	ir_jit_segment_t   *segment;
+	unsigned            hot_threshold;
+	void              (*optimize)(ir_graph *irg);
+	ir_type            *type_u;        /**< type of the call counter */
+	ir_type            *type_p;        /**< type of code addresses */
+	ir_type            *tier_up_type;  /**< method type of tier_up() */
+	struct lazy_function_t **functions; /**< ARR_F */
+};
+
+typedef struct lazy_function_t {
+	void const       *volatile code; /**< current code, NULL before the first
+	                                      call */
+	uint32_t          counter;       /**< number of calls */
+	unsigned          tier;          /**< number of compilations so far */
+	ir_graph         *irg;
+	ir_jit_tiering_t *tiering;
+} lazy_function_t;
+
+ir_jit_tiering_t *be_new_jit_tiering(unsigned const hot_threshold,
+                                     void (*const optimize)(ir_graph *irg))
+{
+	ir_jit_tiering_t *const tiering = XMALLOCZ(ir_jit_tiering_t);
+	tiering->segment       = be_new_jit_segment();
+	tiering->hot_threshold = hot_threshold;
+	tiering->optimize      = optimize;
+	tiering->type_u        = new_type_primitive(mode_Iu);
+	tiering->type_p        = new_type_pointer(new_type_primitive(mode_Bu));
+	tiering->functions     = NEW_ARR_F(lazy_function_t*, 0);
+
+	ir_type *const tier_up_type = new_type_method(1, 1);
+	set_method_param_type(tier_up_type, 0, tiering->type_p);
+	set_method_res_type(tier_up_type, 0, tiering->type_p);
+	tiering->tier_up_type = tier_up_type;
+	return tiering;
+}
+
+void be_destroy_jit_tiering(ir_jit_tiering_t *const tiering)
+{
+	for (size_t i = 0, n = ARR_LEN(tiering->functions); i < n; ++i) {
+		xfree(tiering->functions[i]);
+	}
+	DEL_ARR_F(tiering->functions);
+	be_destroy_jit_segment(tiering->segment);
+	xfree(tiering);
+}
+
+static void const *compile(ir_jit_tiering_t *const tiering,
+                           ir_graph *const irg)
+{
+	ir_jit_function_t *const function = be_jit_compile(tiering->segment, irg);
+	if (function == NULL)
+		panic("could not compile %+F", irg);
+	void const *code;
+	be_jit_install_functions(tiering->segment, 1, &function, &code);
+	return code;
+}
+
+/** Compiles the next tier of @p fn, called by the stubs. */
+static void const *tier_up(lazy_function_t *const fn)
+{
+	ir_jit_tiering_t *const tiering = fn->tiering;
+	ir_graph         *const irg     = fn->irg;
+	switch (fn->tier) {
+	case 0: {
+		/* the backend destroys the graph, keep it for the next tier */
+		ir_graph *const copy = create_irg_copy(irg);
+		set_irg_entity(copy, get_irg_entity(irg));
+
+		allocate_func const linear = be_find_register_allocator("linear");
+		allocate_func const prev   = be_select_register_allocator(linear);
+		fn->code = compile(tiering, copy);
+		be_select_register_allocator(prev);
+
+		set_irg_entity(copy, NULL);
+		free_ir_graph(copy);
+		break;
+	}
+	case 1:
+		if (tiering->optimize != NULL)
+			tiering->optimize(irg);
+		fn->code = compile(tiering, irg);
+		fn->irg  = NULL;
+		break;
+	default:
+		/* the counter wrapped around */
+		return fn->code;
+	}
+	++fn->tier;
+	return fn->code;
+}
+
+static ir_node *new_pointer_const(ir_graph *const irg, void const *const ptr)
+{
+	unsigned char buf[sizeof(uintptr_t)];
+	uintptr_t     value = (uintptr_t)ptr;
+	for (size_t i = 0; i < sizeof(buf); ++i) {
+		buf[i]   = value & 0xFF;
+		value  >>= 8;
+	}
+	return new_r_Const(irg, new_tarval_from_bytes(buf, mode_P));
+}
+
+/** Builds the stub graph forwarding calls to @p fn. */
+static ir_graph *build_stub(lazy_function_t *const fn, ir_type *const mtp)
+{
+	ir_jit_tiering_t *const tiering = fn->tiering;
+	ident            *const id      = id_unique("jit_stub.%u");
+	ir_entity        *const entity
+		= new_global_entity(get_glob_type(), id, mtp, ir_visibility_private,
+		                    IR_LINKAGE_DEFAULT);
+
+	ir_graph *const irg   = new_ir_graph(entity, 0);
+	ir_node  *const block = get_r_cur_block(irg);
+	ir_node        *mem   = get_irg_initial_mem(irg);
+
+	/* count the call */
+	ir_node *const counter_addr = new_pointer_const(irg, &fn->counter);
+	ir_node *const load_counter = new_r_Load(block, mem, counter_addr,
+	                                         mode_Iu, tiering->type_u,
+	                                         cons_none);
+	mem = new_r_Proj(load_counter, mode_M, pn_Load_M);
+	ir_node *const counter = new_r_Proj(load_counter, mode_Iu, pn_Load_res);
+	ir_node *const one     = new_r_Const_long(irg, mode_Iu, 1);
+	ir_node *const count   = new_r_Add(block, counter, one, mode_Iu);
+	ir_node *const store   = new_r_Store(block, mem, counter_addr, count,
+	                                     tiering->type_u, cons_none);
+	mem = new_r_Proj(store, mode_M, pn_Store_M);
+
+	ir_node *const code_addr = new_pointer_const(irg, (void const*)&fn->code);
+	ir_node *const load_code = new_r_Load(block, mem, code_addr, mode_P,
+	                                      tiering->type_p, cons_volatile);
+	mem = new_r_Proj(load_code, mode_M, pn_Load_M);
+	ir_node *const code    = new_r_Proj(load_code, mode_P, pn_Load_res);
+	ir_node *const null    = new_r_Const(irg, get_mode_null(mode_P));
+	ir_node *const is_null = new_r_Cmp(block, code, null, ir_relation_equal);
+	ir_node *const cond    = new_r_Cond(block, is_null);
+	ir_node *const to_up   = new_r_Proj(cond, mode_X, pn_Cond_true);
+	ir_node *const to_hot  = new_r_Proj(cond, mode_X, pn_Cond_false);
+	mature_immBlock(block);
+
+	ir_node *const hot_block = new_r_Block(irg, 1, &to_hot);
+	ir_node *const threshold
+		= new_r_Const_long(irg, mode_Iu, tiering->hot_threshold);
+	ir_node *const is_hot   = new_r_Cmp(hot_block, count, threshold,
+	                                    ir_relation_equal);
+	ir_node *const cond_hot = new_r_Cond(hot_block, is_hot);
+	ir_node *const to_up2   = new_r_Proj(cond_hot, mode_X, pn_Cond_true);
+	ir_node *const to_call  = new_r_Proj(cond_hot, mode_X, pn_Cond_false);
+
+	/* compile the next tier */
+	ir_node *const up_preds[] = { to_up, to_up2 };
+	ir_node *const up_block   = new_r_Block(irg, ARRAY_SIZE(up_preds), up_preds);
+	ir_node *const tier_up_addr
+		= new_pointer_const(irg, (void const*)(uintptr_t)&tier_up);
+	ir_node *const fn_addr  = new_pointer_const(irg, fn);
+	ir_node *const up_call  = new_r_Call(up_block, mem, tier_up_addr, 1,
+	                                     &fn_addr, tiering->tier_up_type);
+	ir_node *const up_mem   = new_r_Proj(up_call, mode_M, pn_Call_M);
+	ir_node *const up_ress  = new_r_Proj(up_call, mode_T, pn_Call_T_result);
+	ir_node *const up_code  = new_r_Proj(up_ress, mode_P, 0);
+	ir_node *const up_jmp   = new_r_Jmp(up_block);
+
+	/* forward the call */
+	ir_node *const call_preds[] = { to_call, up_jmp };
+	ir_node *const call_block
+		= new_r_Block(irg, ARRAY_SIZE(call_preds), call_preds);
+	ir_node *const mems[]  = { mem, up_mem };
+	ir_node *const codes[] = { code, up_code };
+	ir_node *const call_mem
+		= new_r_Phi(call_block, ARRAY_SIZE(mems), mems, mode_M);
+	ir_node *const call_code
+		= new_r_Phi(call_block, ARRAY_SIZE(codes), codes, mode_P);
+
+	size_t   const n_params = get_method_n_params(mtp);
+	ir_node *const args     = get_irg_args(irg);
+	ir_node      **params   = ALLOCAN(ir_node*, n_params);
+	for (size_t i = 0; i < n_params; ++i) {
+		ir_mode *const mode = get_type_mode(get_method_param_type(mtp, i));
+		params[i] = new_r_Proj(args, mode, i);
+	}
+	ir_node *const call = new_r_Call(call_block, call_mem, call_code,
+	                                 n_params, params, mtp);
+	ir_node *const ret_mem = new_r_Proj(call, mode_M, pn_Call_M);
+
+	size_t   const n_ress = get_method_n_ress(mtp);
+	ir_node *const ress   = new_r_Proj(call, mode_T, pn_Call_T_result);
+	ir_node      **results = ALLOCAN(ir_node*, n_ress);
+	for (size_t i = 0; i < n_ress; ++i) {
+		ir_mode *const mode = get_type_mode(get_method_res_type(mtp, i));
+		results[i] = new_r_Proj(ress, mode, i);
+	}
+	ir_node *const ret = new_r_Return(call_block, ret_mem, n_ress, results);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+
+	irg_finalize_cons(irg);
+	return irg;
+}
+
+/** Returns true if all parameters and results of @p mtp are scalars. */
+static bool can_forward(ir_type const *const mtp)
+{
+	if (is_method_variadic(mtp))
+		return false;
+	for (size_t i = 0, n = get_method_n_params(mtp); i < n; ++i) {
+		if (get_type_mode(get_method_param_type(mtp, i)) == NULL)
+			return false;
+	}
+	for (size_t i = 0, n = get_method_n_ress(mtp); i < n; ++i) {
+		if (get_type_mode(get_method_res_type(mtp, i)) == NULL)
+			return false;
+	}
+	return true;
+}
+
+void const *be_jit_add_lazy_function(ir_jit_tiering_t *const tiering,
+                                     ir_graph *const irg)
+{
+	ir_entity *const entity = get_irg_entity(irg);
+	ir_type   *const mtp    = get_entity_type(entity);
+	/* the stub contains host addresses */
+	if (get_mode_size_bytes(mode_P) != sizeof(void*) || !can_forward(mtp))
+		return NULL;
+
+	lazy_function_t *const fn = XMALLOCZ(lazy_function_t);
+	fn->irg     = irg;
+	fn->tiering = tiering;
+	ARR_APP1(lazy_function_t*, tiering->functions, fn);
+
+	ir_graph   *const stub        = build_stub(fn, mtp);
+	ir_entity  *const stub_entity = get_irg_entity(stub);
+	void const *const code        = compile(tiering, stub);
+	free_ir_graph(stub);
+	free_entity(stub_entity);
+
+	be_jit_set_entity_addr(entity, code);
+	return code;
+}
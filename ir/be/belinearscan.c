@@ -0,0 +1,247 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Linear scan register allocator.
+ *
+ * A register allocator for fast compilation (JIT compilation, unoptimized
+ * code), trading code quality for allocation speed:
+ *  - The selected spiller lowers the register pressure to the number of
+ *    available registers. Reloaded values stay in a register until the
+ *    pressure forces them out again.
+ *  - The register constraints are handled by Perms in front of the
+ *    constrained nodes like in the chordal allocator.
+ *  - The live intervals of each block are computed by one backward walk over
+ *    its schedule. The blocks are scanned in dominance order, assigning the
+ *    first free register at the start of an interval and releasing it at its
+ *    end. As the program is in SSA form, values live into a block were
+ *    assigned in a dominator already and no interference graph is needed.
+ *  - There is no copy coalescing, Phis are resolved by SSA destruction.
+ */
+#include "array.h"
+#include "bechordal_common.h"
+#include "bechordal_t.h"
+#include "beirg.h"
+#include "belive.h"
+#include "belower.h"
+#include "bemodule.h"
+#include "bera.h"
+#include "besched.h"
+#include "bespill.h"
+#include "bespillutil.h"
+#include "bessadestr.h"
+#include "bestat.h"
+#include "beverify.h"
+#include "be_t.h"
+#include "bitset.h"
+#include "debug.h"
+#include "irdom.h"
+#include "iredges_t.h"
+#include "irgraph_t.h"
+#include "irnode_t.h"
+#include "statev_t.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
+
+/** Start or end of the live interval of a value inside a block. */
+typedef struct interval_border_t {
+	ir_node *value;
+	bool     is_def; /**< start of the interval, else its end */
+} interval_border_t;
+
+typedef struct linear_scan_env_t {
+	be_chordal_env_t   chordal_env; /**< for the constraint handling */
+	be_lv_t           *lv;
+	bitset_t          *live;        /**< live values, by node index */
+	interval_border_t *borders;     /**< borders of the current block,
+	                                     in reverse schedule order */
+} linear_scan_env_t;
+
+static void add_border(linear_scan_env_t *const env, ir_node *const value,
+                       bool const is_def)
+{
+	interval_border_t const border = { value, is_def };
+	ARR_APP1(interval_border_t, env->borders, border);
+}
+
+/**
+ * Collects the interval borders of the values of the current register class
+ * in @p block.
+ */
+static void compute_intervals(linear_scan_env_t *const env,
+                              ir_node *const block)
+{
+	arch_register_class_t const *const cls  = env->chordal_env.cls;
+	bitset_t                    *const live = env->live;
+
+	ARR_SHRINKLEN(env->borders, 0);
+	be_lv_foreach_cls(env->lv, block, be_lv_state_end, cls, value) {
+		bitset_set(live, get_irn_idx(value));
+	}
+
+	sched_foreach_reverse(block, node) {
+		be_foreach_definition(node, cls, def, req,
+			bitset_clear(live, get_irn_idx(def));
+			add_border(env, def, true);
+		);
+
+		/* the operands of Phis are used at the end of the predecessors */
+		if (is_Phi(node))
+			continue;
+		be_foreach_use(node, cls, in_req, op, op_req,
+			unsigned const idx = get_irn_idx(op);
+			if (!bitset_is_set(live, idx)) {
+				/* the last use ends the interval */
+				bitset_set(live, idx);
+				add_border(env, op, false);
+			}
+		);
+	}
+
+	/* the remaining values are live-in and were assigned in a dominator */
+	be_lv_foreach_cls(env->lv, block, be_lv_state_in, cls, value) {
+		bitset_clear(live, get_irn_idx(value));
+	}
+}
+
+/**
+ * Assigns registers to the values defined in @p block.
+ */
+static void assign_block(ir_node *const block, void *const data)
+{
+	linear_scan_env_t *const env = (linear_scan_env_t*)data;
+	be_chordal_env_t  *const chordal_env = &env->chordal_env;
+	compute_intervals(env, block);
+
+	bitset_t *const available = bitset_alloca(chordal_env->allocatable_regs->size);
+	bitset_copy(available, chordal_env->allocatable_regs);
+	be_lv_foreach_cls(env->lv, block, be_lv_state_in, chordal_env->cls, value) {
+		arch_register_t const *const reg = arch_get_irn_register(value);
+		assert(reg != NULL && "live-in value must have a register");
+		bitset_clear(available, reg->index);
+	}
+
+	for (size_t i = ARR_LEN(env->borders); i-- > 0;) {
+		interval_border_t const *const border = &env->borders[i];
+		ir_node                 *const value  = border->value;
+		arch_register_t   const       *reg    = arch_get_irn_register(value);
+		if (!border->is_def) {
+			assert(reg != NULL && "register must have been assigned");
+			bitset_set(available, reg->index);
+			continue;
+		}
+
+		/* constrained values are precolored */
+		if (reg == NULL) {
+			assert(!arch_irn_is_ignore(value));
+			size_t const col = bitset_next_set(available, 0);
+			assert(col != (size_t)-1 && "no register left (node not register pressure faithful?)");
+			reg = arch_register_for_index(chordal_env->cls, col);
+			arch_set_irn_register(value, reg);
+		}
+		assert(bitset_is_set(available, reg->index) && "pre-colored register must be free");
+		bitset_clear(available, reg->index);
+		DB((dbg, LEVEL_2, "\tassigning register %s to %+F\n", reg->name, value));
+	}
+}
+
+/**
+ * Allocates the registers of the register class @p cls.
+ */
+static void linear_scan_cls(linear_scan_env_t *const env,
+                            arch_register_class_t const *const cls,
+                            regalloc_if_t const *const regif)
+{
+	be_chordal_env_t *const chordal_env = &env->chordal_env;
+	ir_graph         *const irg         = chordal_env->irg;
+
+	chordal_env->cls              = cls;
+	chordal_env->allocatable_regs = bitset_malloc(cls->n_regs);
+	be_get_allocatable_regs(irg, cls, chordal_env->allocatable_regs->data);
+
+	DB((dbg, LEVEL_1, "=== Allocating registers of %s ===\n", cls->name));
+
+	be_spill_stat_t *const spill_stat = be_spill_stat_begin(irg, cls);
+	be_timer_push(T_RA_SPILL);
+	be_do_spill(irg, cls, regif);
+	be_timer_pop(T_RA_SPILL);
+	be_spill_stat_finish(spill_stat);
+
+	be_timer_push(T_RA_SPILL_APPLY);
+	check_for_memory_operands(irg, regif);
+	be_timer_pop(T_RA_SPILL_APPLY);
+
+	if (be_options.do_verify) {
+		be_timer_push(T_VERIFY);
+		bool check_schedule = be_verify_schedule(irg);
+		be_check_verify_result(check_schedule, irg);
+		bool check_pressure = be_verify_register_pressure(irg, cls);
+		be_check_verify_result(check_pressure, irg);
+		be_timer_pop(T_VERIFY);
+	}
+
+	be_timer_push(T_RA_COLOR);
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+	be_assure_live_sets(irg);
+	be_chordal_handle_constraints(chordal_env);
+
+	env->lv   = be_get_irg_liveness(irg);
+	env->live = bitset_malloc(get_irg_last_idx(irg));
+	dom_tree_walk_irg(irg, assign_block, NULL, env);
+	xfree(env->live);
+	be_timer_pop(T_RA_COLOR);
+
+	be_timer_push(T_RA_SSA);
+	be_ssa_destruction(irg, cls);
+	be_timer_pop(T_RA_SSA);
+
+	xfree(chordal_env->allocatable_regs);
+}
+
+/**
+ * The linear scan register allocator for a whole procedure.
+ */
+static void be_linear_scan(ir_graph *irg, const regalloc_if_t *regif)
+{
+	be_timer_push(T_RA_OTHER);
+
+	be_spill_prepare_for_constraints(irg);
+
+	linear_scan_env_t env;
+	memset(&env, 0, sizeof(env));
+	obstack_init(&env.chordal_env.obst);
+	env.chordal_env.irg = irg;
+	env.borders         = NEW_ARR_F(interval_border_t, 0);
+
+	arch_register_class_t const *const reg_classes = isa_if->register_classes;
+	for (int c = 0, n_cls = isa_if->n_register_classes; c < n_cls; ++c) {
+		arch_register_class_t const *const cls = &reg_classes[c];
+		if (cls->manual_ra)
+			continue;
+
+		stat_ev_ctx_push_str("linearscan_cls", cls->name);
+		linear_scan_cls(&env, cls, regif);
+		stat_ev_ctx_pop("linearscan_cls");
+	}
+
+	be_timer_push(T_RA_EPILOG);
+	lower_nodes_after_ra(irg, false);
+	be_invalidate_live_sets(irg);
+	be_timer_pop(T_RA_EPILOG);
+
+	DEL_ARR_F(env.borders);
+	obstack_free(&env.chordal_env.obst, NULL);
+
+	be_timer_pop(T_RA_OTHER);
+}
+
+BE_REGISTER_MODULE_CONSTRUCTOR(be_init_linear_scan)
+void be_init_linear_scan(void)
+{
+	be_register_allocator("linear", be_linear_scan);
+	FIRM_DBG_REGISTER(dbg, "firm.be.linearscan");
+}
@@ -186,7 +186,7 @@ void be_list_sched_begin(ir_graph *irg)
 
 void be_list_sched_finish(void)
 {
-	free(available);
+	xfree(available);
 }
 
 BE_REGISTER_MODULE_CONSTRUCTOR(be_init_listsched)
@@ -25,6 +25,7 @@
 #include "besched.h"
 #include "bemodule.h"
 #include "beirg.h"
+#include "beverify.h"
 
 DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
 
@@ -260,11 +261,17 @@ static void collect_liveness_nodes(ir_node *irn, void *data)
 
 void be_liveness_compute_sets(be_lv_t *lv)
 {
-	if (lv->sets_valid)
+	if (lv->sets_valid) {
+		ir_analysis_reused(IR_ANALYSIS_LIVENESS);
+		if (be_options.verify_liveness)
+			be_check_verify_result(be_liveness_check(lv), lv->irg);
 		return;
+	}
 
 	be_timer_push(T_LIVE);
+	ir_analysis_start(IR_ANALYSIS_LIVENESS);
 	ir_nodehashmap_init(&lv->map);
+	ir_nodeset_init(&lv->marked);
 	obstack_init(&lv->obst);
 
 	ir_graph *irg = lv->irg;
@@ -285,6 +292,7 @@ void be_liveness_compute_sets(be_lv_t *lv)
 
 	DEL_ARR_F(nodes);
 	lv->sets_valid = true;
+	ir_analysis_stop(IR_ANALYSIS_LIVENESS);
 	be_timer_pop(T_LIVE);
 }
 
@@ -299,8 +307,10 @@ void be_liveness_invalidate_sets(be_lv_t *lv)
 {
 	if (!lv->sets_valid)
 		return;
+	ir_analysis_invalidated(IR_ANALYSIS_LIVENESS);
 	obstack_free(&lv->obst, NULL);
 	ir_nodehashmap_destroy(&lv->map);
+	ir_nodeset_destroy(&lv->marked);
 	lv->sets_valid = false;
 }
 
@@ -325,7 +335,7 @@ void be_liveness_free(be_lv_t *lv)
 {
 	be_liveness_invalidate_sets(lv);
 	be_liveness_invalidate_chk(lv);
-	free(lv);
+	xfree(lv);
 }
 
 void be_liveness_remove(be_lv_t *lv, const ir_node *irn)
@@ -355,6 +365,42 @@ void be_liveness_update(be_lv_t *lv, ir_node *irn)
 	be_liveness_introduce(lv, irn);
 }
 
+void be_liveness_mark(be_lv_t *lv, ir_node *irn)
+{
+	assert(lv->sets_valid);
+	ir_nodeset_insert(&lv->marked, irn);
+}
+
+void be_liveness_mark_new_nodes(be_lv_t *lv, unsigned first_idx)
+{
+	ir_graph *const irg = lv->irg;
+	for (unsigned i = first_idx, n = get_irg_last_idx(irg); i < n; ++i) {
+		ir_node *const node = get_idx_irn(irg, i);
+		if (node == NULL || is_Deleted(node))
+			continue;
+		be_liveness_mark(lv, node);
+		/* the operands gained new users */
+		foreach_irn_in(node, j, op) {
+			be_liveness_mark(lv, op);
+		}
+	}
+}
+
+void be_liveness_update_marked(be_lv_t *lv)
+{
+	assert(lv->sets_valid);
+	be_timer_push(T_LIVE);
+	foreach_ir_nodeset(&lv->marked, irn, iter) {
+		/* nodes may have been killed after they were marked */
+		if (is_Deleted(irn) || !is_liveness_node(irn))
+			continue;
+		be_liveness_update(lv, irn);
+	}
+	ir_nodeset_destroy(&lv->marked);
+	ir_nodeset_init(&lv->marked);
+	be_timer_pop(T_LIVE);
+}
+
 void be_liveness_transfer(const arch_register_class_t *cls,
                           ir_node *node, ir_nodeset_t *nodeset)
 {
@@ -472,12 +518,15 @@ static const ir_node *get_highest_sync_op(const ir_node *const sync)
 	return best;
 }
 
+const ir_node *be_get_memory_value_def(const ir_node *node)
+{
+	return is_Sync(node) ? get_highest_sync_op(node) : node;
+}
+
 bool be_memory_values_interfere(const ir_node *a, const ir_node *b)
 {
-	if (is_Sync(a))
-		a = get_highest_sync_op(a);
-	if (is_Sync(b))
-		b = get_highest_sync_op(b);
+	a = be_get_memory_value_def(a);
+	b = be_get_memory_value_def(b);
 
 	if (value_strictly_dominates(b, a)) {
 		/* Adjust a and b so, that a dominates b if
@@ -525,6 +574,10 @@ static void be_live_chk_compare(be_lv_t *lv, lv_chk_t *lvc)
 	irg_block_walk_graph(irg, collect_node, NULL, &obst);
 	obstack_ptr_grow(&obst, NULL);
 	ir_node **blocks = (ir_node**)obstack_finish(&obst);
+	size_t    n_blocks = 0;
+	while (blocks[n_blocks] != NULL)
+		++n_blocks;
+	unsigned *states = OALLOCN(&obst, unsigned, n_blocks);
 
 	irg_walk_graph(irg, collect_node, NULL, &obst);
 	obstack_ptr_grow(&obst, NULL);
@@ -533,18 +586,20 @@ static void be_live_chk_compare(be_lv_t *lv, lv_chk_t *lvc)
 	stat_ev_ctx_push("be_lv_chk_compare");
 	for (unsigned j = 0; nodes[j] != NULL; ++j) {
 		const ir_node *irn = nodes[j];
-		if (is_Block(irn))
+		if (!is_liveness_node(irn))
 			continue;
 
+		lv_chk_bls_xxx(lvc, irn, n_blocks, (const ir_node *const *)blocks,
+		               states);
 		for (unsigned i = 0; blocks[i] != NULL; ++i) {
 			const ir_node *bl = blocks[i];
 			bool lvr_in  = be_is_live_in (lv, bl, irn);
 			bool lvr_out = be_is_live_out(lv, bl, irn);
 			bool lvr_end = be_is_live_end(lv, bl, irn);
 
-			bool lvc_in  = lv_chk_bl_in (lvc, bl, irn);
-			bool lvc_out = lv_chk_bl_out(lvc, bl, irn);
-			bool lvc_end = lv_chk_bl_end(lvc, bl, irn);
+			bool lvc_in  = (states[i] & lv_chk_state_in)  != 0;
+			bool lvc_out = (states[i] & lv_chk_state_out) != 0;
+			bool lvc_end = (states[i] & lv_chk_state_end) != 0;
 
 			if (lvr_in != lvc_in)
 				ir_fprintf(stderr, "live in  info for %+F at %+F differs: nml: %d, chk: %d\n", irn, bl, lvr_in, lvc_in);
@@ -76,6 +76,27 @@ void be_liveness_remove(be_lv_t *lv, const ir_node *irn);
  */
 void be_liveness_introduce(be_lv_t *lv, ir_node *irn);
 
+/**
+ * Remember that the liveness of @p irn has changed.
+ * The liveness of all remembered nodes is recomputed at once by
+ * be_liveness_update_marked(). This allows a phase to change the graph while
+ * still querying the liveness information of the unmodified graph.
+ */
+void be_liveness_mark(be_lv_t *lv, ir_node *irn);
+
+/**
+ * Remember all nodes with an index of at least @p first_idx, which still
+ * exist, and their operands as changed.
+ * Use get_irg_last_idx() before modifying the graph to obtain @p first_idx.
+ */
+void be_liveness_mark_new_nodes(be_lv_t *lv, unsigned first_idx);
+
+/**
+ * Update the liveness information of all nodes remembered with
+ * be_liveness_mark() and be_liveness_mark_new_nodes().
+ */
+void be_liveness_update_marked(be_lv_t *lv);
+
 /**
  * The liveness transfer function.
  * Updates a live set over a single step from a given node to its predecessor.
@@ -119,6 +140,13 @@ bool be_values_interfere(const ir_node *a, const ir_node *b);
  */
 bool be_memory_values_interfere(const ir_node *a, const ir_node *b);
 
+/**
+ * Returns the node which stands for the memory value @p node in
+ * be_memory_values_interfere(): the operand of a Sync which is defined last,
+ * @p node itself if it is no Sync.
+ */
+const ir_node *be_get_memory_value_def(const ir_node *node);
+
 /**
  * Compute a set of nodes which are live just before the given node.
  * @param cls      The register class to consider.
@@ -133,6 +161,7 @@ struct be_lv_t {
 	ir_nodehashmap_t map;
 	struct obstack   obst;
 	bool             sets_valid;
+	ir_nodeset_t     marked;     /**< nodes, whose liveness has to be updated */
 	ir_graph        *irg;
 	lv_chk_t        *lvc;
 };
@@ -17,6 +17,7 @@
 
 #include "ident_t.h"
 #include "obst.h"
+#include "panic.h"
 #include "statev.h"
 #include "irprog.h"
 #include "irgopt.h"
@@ -31,10 +32,14 @@
 #include "irprofile.h"
 #include "ircons.h"
 #include "util.h"
+#include "xmalloc.h"
 
 #include "be_t.h"
+#include "beasmcache.h"
 #include "bediagnostic.h"
+#include "beelf.h"
 #include "begnuas.h"
+#include "bejit.h"
 #include "bemodule.h"
 #include "beutil.h"
 #include "benode.h"
@@ -52,6 +57,7 @@
 #include "beirg.h"
 #include "bestack.h"
 #include "beemitter.h"
+#include "befuncorder.h"
 
 static struct obstack obst;
 static be_main_env_t  env;
@@ -62,17 +68,29 @@ be_options_t be_options = {
 	.timing               = false,
 	.opt_profile_generate = false,
 	.opt_profile_use      = false,
+	.profile_counters     = IR_PROFILE_COUNTERS_PLAIN,
+	.opt_profile_calls    = false,
 	.omit_fp              = false,
 	.exceptions           = false,
 	.do_verify            = true,
+	.verify_sample        = 8,
+	.verify_liveness      = false,
 	.ilp_solver           = "",
 	.verbose_asm          = true,
+	.split_cold           = true,
+	.sibling_calls        = true,
+	.shrink_wrap          = true,
+	.release_graphs       = false,
 	.pic_style            = BE_PIC_NONE,
 };
 
 /* back end instruction set architecture to use */
 arch_isa_if_t const *isa_if = NULL;
 
+/** Whether emitted graphs are released, only while emitting a compilation
+ * unit, as the jit may compile a graph again. */
+static bool release_graphs;
+
 /* possible dumping options */
 static const lc_opt_enum_mask_items_t dump_items[] = {
 	{ "none",       DUMP_NONE },
@@ -97,6 +115,16 @@ static lc_opt_enum_int_var_t pic_style_var = {
 	(int*)&be_options.pic_style, pic_style_items
 };
 
+static const lc_opt_enum_int_items_t profile_counters_items[] = {
+	{ "plain",        IR_PROFILE_COUNTERS_PLAIN        },
+	{ "atomic",       IR_PROFILE_COUNTERS_ATOMIC       },
+	{ "thread-local", IR_PROFILE_COUNTERS_THREAD_LOCAL },
+	{ NULL,           IR_PROFILE_COUNTERS_PLAIN        },
+};
+static lc_opt_enum_int_var_t profile_counters_var = {
+	(int*)&be_options.profile_counters, profile_counters_items
+};
+
 static lc_opt_enum_mask_var_t dump_var = {
 	&be_options.dump_flags, dump_items
 };
@@ -107,13 +135,23 @@ static const lc_opt_table_entry_t be_main_options[] = {
 	LC_OPT_ENT_ENUM_INT ("pic",        "Generate position independent code",                  &pic_style_var),
 	LC_OPT_ENT_BOOL     ("exceptions", "enable exception handling",                           &be_options.exceptions),
 	LC_OPT_ENT_BOOL     ("verify",     "verify the backend irg",                              &be_options.do_verify),
+	LC_OPT_ENT_INT      ("verifysample", "cheaply verify one in n blocks if verify is off (0 = never)", &be_options.verify_sample),
+	LC_OPT_ENT_BOOL     ("verifylive", "check liveness updates against a recomputation",     &be_options.verify_liveness),
 	LC_OPT_ENT_BOOL     ("time",       "get backend timing statistics",                       &be_options.timing),
 	LC_OPT_ENT_BOOL     ("profilegenerate",   "instrument the code for execution count profiling", &be_options.opt_profile_generate),
 	LC_OPT_ENT_BOOL     ("profileuse",        "use existing profile data",                         &be_options.opt_profile_use),
+	LC_OPT_ENT_ENUM_INT ("profilecounters",   "kind of the profile counters",                      &profile_counters_var),
+	LC_OPT_ENT_BOOL     ("profilecalls",      "profile indirect call targets and promote hot ones", &be_options.opt_profile_calls),
+	LC_OPT_ENT_STR      ("profilesamples",    "use the sampled profile (AutoFDO text format) in the file", &be_options.profile_samples),
 	LC_OPT_ENT_BOOL     ("verboseasm",        "enable verbose assembler output",                   &be_options.verbose_asm),
 	LC_OPT_ENT_BOOL     ("mark_spill_reload", "mark spills and reloads",                           &be_options.mark_spill_reload),
+	LC_OPT_ENT_BOOL     ("splitcold",         "emit rarely executed code in a separate section",   &be_options.split_cold),
+	LC_OPT_ENT_BOOL     ("sibcalls",          "turn calls in tail position into jumps",            &be_options.sibling_calls),
+	LC_OPT_ENT_BOOL     ("shrinkwrap",        "set up the stack frame only where needed",          &be_options.shrink_wrap),
+	LC_OPT_ENT_BOOL     ("releasegraphs",     "free the nodes of each graph after emitting it",    &be_options.release_graphs),
 
 	LC_OPT_ENT_STR("ilp.solver", "the ilp solver name", &be_options.ilp_solver),
+	LC_OPT_ENT_STR("timetrace",  "write a Chrome trace of the pass profile to the file", &be_options.time_trace),
 	LC_OPT_LAST
 };
 
@@ -237,6 +275,9 @@ static void be_opt_register(void)
 	                       &isa_ifs, (void**) &isa_if);
 }
 
+/** The arguments accepted by be_parse_arg() so far. */
+static ident *parsed_args;
+
 /* Parse one argument. */
 int be_parse_arg(const char *arg)
 {
@@ -249,7 +290,17 @@ int be_parse_arg(const char *arg)
 	/* backend args may not have an effect anymore after the backend
 	 * has been initialized */
 	assert(!isa_initialized);
-	return lc_opt_from_single_arg(be_grp, arg);
+	int const res = lc_opt_from_single_arg(be_grp, arg);
+	if (res) {
+		char const *const prev = parsed_args ? get_id_str(parsed_args) : "";
+		parsed_args = new_id_fmt("%s%s\n", prev, arg);
+	}
+	return res;
+}
+
+char const *be_get_parsed_args(void)
+{
+	return parsed_args ? get_id_str(parsed_args) : "";
 }
 
 void be_check_verify_result(bool fine, ir_graph *irg)
@@ -269,6 +320,11 @@ static void be_sched_verify(ir_graph *irg)
 		bool fine = be_verify_schedule(irg);
 		be_check_verify_result(fine, irg);
 		be_timer_pop(T_VERIFY);
+	} else if (be_options.verify_sample > 0) {
+		be_timer_push(T_VERIFY);
+		bool const fine = be_verify_schedule_sampled(irg, be_options.verify_sample);
+		be_check_verify_result(fine, irg);
+		be_timer_pop(T_VERIFY);
 	}
 }
 
@@ -279,6 +335,11 @@ static void be_regalloc_verify(ir_graph *const irg)
 		bool const fine = be_verify_register_allocation(irg);
 		be_check_verify_result(fine, irg);
 		be_timer_pop(T_VERIFY);
+	} else if (be_options.verify_sample > 0) {
+		be_timer_push(T_VERIFY);
+		bool const fine = be_verify_register_constraints_sampled(irg, be_options.verify_sample);
+		be_check_verify_result(fine, irg);
+		be_timer_pop(T_VERIFY);
 	}
 }
 
@@ -310,6 +371,7 @@ static void initialize_birg(be_irg_t *birg, ir_graph *irg, be_main_env_t *env)
 	memset(birg, 0, sizeof(*birg));
 	birg->main_env = env;
 	obstack_init(&birg->obst);
+	obstack_init(&birg->emit_obst);
 	irg->be_data = birg;
 
 	be_info_init_irg(irg);
@@ -324,6 +386,10 @@ static void initialize_birg(be_irg_t *birg, ir_graph *irg, be_main_env_t *env)
 	}
 }
 
+/** Indirect calls are promoted if their most frequent target receives at
+ * least this share of the profiled calls. */
+#define PROMOTE_CALL_PROBABILITY 0.8
+
 static ir_graph *be_prepare_profile(const char *const cup_name)
 {
 	obstack_printf(&obst, "%s.prof", cup_name);
@@ -332,21 +398,32 @@ static ir_graph *be_prepare_profile(const char *const cup_name)
 
 	bool have_profile = false;
 	if (be_options.opt_profile_use) {
-		bool res = ir_profile_read(prof_filename);
-		if (!res) {
+		have_profile = ir_profile_read(prof_filename);
+		if (!have_profile)
 			be_warningf(NULL, "could not read profile data '%s'", prof_filename);
-		} else {
-			ir_create_execfreqs_from_profile();
-			ir_profile_free();
-			have_profile = true;
-		}
+	} else if (be_options.profile_samples[0] != '\0') {
+		have_profile = ir_profile_read_samples(be_options.profile_samples);
+		if (!have_profile)
+			be_warningf(NULL, "could not read sampled profile '%s'", be_options.profile_samples);
 	}
 
 	ir_graph *prof_init_irg = NULL;
 	if (be_options.opt_profile_generate)
-		prof_init_irg = ir_profile_instrument(prof_filename);
-
-	if (!have_profile) {
+		prof_init_irg = ir_profile_instrument(prof_filename,
+			(ir_profile_counters_t)be_options.profile_counters,
+			be_options.opt_profile_calls);
+
+	if (have_profile) {
+		/* after the instrumentation, which must see the same graphs as when
+		 * reading the profile */
+		if (be_options.opt_profile_calls) {
+			foreach_irp_irg(i, irg) {
+				promote_indirect_calls(irg, PROMOTE_CALL_PROBABILITY);
+			}
+		}
+		ir_create_execfreqs_from_profile();
+		be_order_functions();
+	} else {
 		be_timer_push(T_EXECFREQ);
 		foreach_irp_irg(i, irg) {
 			ir_estimate_execfreq(irg);
@@ -360,6 +437,10 @@ void be_begin(FILE *file_handle, const char *cup_name)
 {
 	memset(be_asm_constraint_flags, 0, sizeof(be_asm_constraint_flags));
 
+	if (be_options.time_trace[0] != '\0')
+		ir_timing_enable(true);
+	ir_timing_scope_push("backend", NULL);
+
 	bemain_timer = NULL;
 	if (be_options.timing) {
 		bemain_timer = ir_timer_new();
@@ -403,6 +484,7 @@ void be_begin(FILE *file_handle, const char *cup_name)
 	env.cup_name             = cup_name;
 
 	be_info_init();
+	release_graphs = be_options.release_graphs;
 
 	/* First: initialize all birgs */
 	size_t          num_birgs = 0;
@@ -425,7 +507,12 @@ void be_begin(FILE *file_handle, const char *cup_name)
 	if (prof_init_irg != NULL)
 		initialize_birg(&birgs[num_birgs++], prof_init_irg, &env);
 
-	be_gas_begin_compilation_unit(&env);
+	if (be_elf_is_selected()) {
+		be_elf_begin_compilation_unit(file_handle);
+	} else {
+		be_gas_begin_compilation_unit(&env);
+	}
+	be_asm_cache_begin(&env);
 }
 
 void firm_be_finish(void)
@@ -478,7 +565,7 @@ float_int_conversion_overflow_style_t be_get_float_int_overflow(void)
 
 int be_timing;
 
-static const char *get_timer_name(be_timer_id_t id)
+const char *be_get_timer_name(be_timer_id_t id)
 {
 	switch (id) {
 	case T_ABI:            return "abi";
@@ -535,7 +622,9 @@ void be_lower_for_target(void)
 {
 	initialize_isa();
 
+	ir_timing_scope_push("lower_for_target", NULL);
 	isa_if->lower_for_target();
+	ir_timing_scope_pop("lower_for_target");
 	/* set the phase to low */
 	foreach_irp_irg_r(i, irg) {
 		assert(!irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_TARGET_LOWERED));
@@ -545,19 +634,59 @@ void be_lower_for_target(void)
 
 static int cse_setting;
 
+/**
+ * Reports the memory held by @p irg per category as statistic events
+ * bemain_memory_@p when_<category>.
+ */
+static void stat_ev_memory_usage(ir_graph *irg, const char *when)
+{
+	ir_memory_usage_t usage;
+	ir_graph_memory_usage(irg, &usage);
+	for (ir_memory_category_t c = IR_MEMORY_FIRST; c <= IR_MEMORY_LAST; ++c) {
+		char buf[128];
+		snprintf(buf, sizeof(buf), "bemain_memory_%s_%s", when,
+		         get_ir_memory_category_name(c));
+		stat_ev_ull(buf, usage.bytes[c]);
+	}
+}
+
+/**
+ * Frees the nodes of the emitted graph @p irg.  Only the anchors remain, so
+ * the graph and its entity stay valid, and a client emitting a large
+ * compilation unit only needs the memory of the graphs not emitted yet.
+ */
+static void release_graph(ir_graph *irg)
+{
+	if (!release_graphs)
+		return;
+	set_irn_in(get_irg_end_block(irg), 0, NULL);
+	set_End_keepalives(get_irg_end(irg), 0, NULL);
+	dead_node_elimination(irg);
+	if (stat_ev_enabled)
+		stat_ev_memory_usage(irg, "released");
+}
+
 bool be_step_first(ir_graph *irg)
 {
 	ir_entity *const entity = get_irg_entity(irg);
 	if (get_entity_linkage(entity) & IR_LINKAGE_NO_CODEGEN)
 		return false;
+	if (be_asm_cache_emit_function(irg)) {
+		release_graph(irg);
+		be_free_birg(irg);
+		return false;
+	}
 
+	ir_timing_scope_push(get_entity_name(entity), irg);
 	be_timer_push(T_OTHER);
 	if (stat_ev_enabled) {
 		stat_ev_ctx_push_fmt("bemain_irg", "%+F", irg);
 		stat_ev_ull("bemain_insns_start", be_count_insns(irg));
 		stat_ev_ull("bemain_blocks_start", be_count_blocks(irg));
+		stat_ev_memory_usage(irg, "start");
 	}
 	cse_setting = get_opt_cse();
+	be_emit_begin_buffer(&be_birg_from_irg(irg)->emit_obst);
 	return true;
 }
 
@@ -581,6 +710,7 @@ void be_step_regalloc(ir_graph *irg, const regalloc_if_t *regif)
 		stat_ev_dbl("bemain_costs_before_ra", be_estimate_irg_costs(irg));
 		stat_ev_ull("bemain_insns_before_ra", be_count_insns(irg));
 		stat_ev_ull("bemain_blocks_before_ra", be_count_blocks(irg));
+		stat_ev_memory_usage(irg, "before_ra");
 		be_stat_values(irg);
 	}
 
@@ -599,22 +729,29 @@ void be_step_regalloc(ir_graph *irg, const regalloc_if_t *regif)
 
 void be_step_last(ir_graph *irg)
 {
+	be_asm_cache_end_function(irg);
+	be_emit_end_buffer();
+	struct obstack *const output = &be_birg_from_irg(irg)->emit_obst;
+	size_t          const size   = obstack_object_size(output);
+	be_emit_write_buffer((char const*)obstack_finish(output), size);
 	if (stat_ev_enabled) {
 		stat_ev_ull("bemain_insns_finish", be_count_insns(irg));
 		stat_ev_ull("bemain_blocks_finish", be_count_blocks(irg));
+		stat_ev_memory_usage(irg, "finish");
 	}
 
 	be_dump(DUMP_FINAL, irg, "final");
 	be_regalloc_verify(irg);
 
 	be_timer_pop(T_OTHER);
+	ir_timing_scope_pop(get_entity_name(get_irg_entity(irg)));
 
 	if (be_timing) {
 		if (stat_ev_enabled) {
 			for (be_timer_id_t t = T_FIRST; t < T_LAST+1; ++t) {
 				char buf[128];
 				snprintf(buf, sizeof(buf), "bemain_time_%s",
-						 get_timer_name(t));
+						 be_get_timer_name(t));
 				stat_ev_dbl(buf, ir_timer_elapsed_usec(be_timers[t]));
 			}
 		} else {
@@ -622,7 +759,7 @@ void be_step_last(ir_graph *irg)
 				   get_entity_name(get_irg_entity(irg)));
 			for (be_timer_id_t t = T_FIRST; t < T_LAST+1; ++t) {
 				double val = ir_timer_elapsed_usec(be_timers[t]) / 1000.0;
-				printf("%-20s: %10.3f msec\n", get_timer_name(t), val);
+				printf("%-20s: %10.3f msec\n", be_get_timer_name(t), val);
 			}
 		}
 		for (be_timer_id_t t = T_FIRST; t < T_LAST+1; ++t) {
@@ -630,6 +767,7 @@ void be_step_last(ir_graph *irg)
 		}
 	}
 
+	release_graph(irg);
 	be_free_birg(irg);
 	stat_ev_ctx_pop("bemain_irg");
 
@@ -638,7 +776,15 @@ void be_step_last(ir_graph *irg)
 
 void be_finish(void)
 {
-	be_gas_end_compilation_unit(&env);
+	if (be_elf_is_selected()) {
+		be_elf_end_compilation_unit(&env);
+	} else {
+		be_gas_end_compilation_unit(&env);
+	}
+	be_asm_cache_finish();
+	release_graphs = false;
+	/* the profile was kept for the frequencies of the transformed graphs */
+	ir_profile_free();
 
 	if (be_options.timing) {
 		ir_timer_stop(bemain_timer);
@@ -655,8 +801,24 @@ void be_finish(void)
 		stat_ev_ctx_pop("bemain_compilation_unit");
 	}
 
+	ir_timing_scope_pop("backend");
+	if (be_options.time_trace[0] != '\0') {
+		FILE *const out = fopen(be_options.time_trace, "w");
+		if (out == NULL) {
+			be_warningf(NULL, "could not open time trace '%s'",
+			            be_options.time_trace);
+		} else {
+			ir_timing_write_chrome_trace(out);
+			fclose(out);
+		}
+		if (be_options.timing)
+			ir_timing_write_summary(stdout);
+		ir_timing_enable(false);
+	}
+
 	be_emit_exit();
 	be_info_free();
+	be_free_func_order();
 
 	pmap_destroy(env.ent_trampoline_map);
 	pmap_destroy(env.ent_pic_symbol_map);
@@ -670,6 +832,15 @@ void be_main(FILE *file_handle, const char *cup_name)
 	isa_if->generate_code(file_handle, cup_name);
 }
 
+/** Prepares @p irg for jit compilation, @p birg receives its backend data. */
+static void prepare_jit_irg(be_irg_t *const birg, ir_graph *const irg)
+{
+	initialize_birg(birg, irg, &env);
+	if (isa_if->handle_intrinsics)
+		isa_if->handle_intrinsics(irg);
+	be_dump(DUMP_INITIAL, irg, "prepared");
+}
+
 ir_jit_function_t *be_jit_compile(ir_jit_segment_t *const segment,
                                   ir_graph *const irg)
 {
@@ -683,15 +854,95 @@ ir_jit_function_t *be_jit_compile(ir_jit_segment_t *const segment,
 	if (get_entity_linkage(entity) & IR_LINKAGE_NO_CODEGEN)
 		return NULL;
 	be_irg_t *const birg = OALLOCZ(&obst, be_irg_t);
-	initialize_birg(birg, irg, &env);
-	if (isa_if->handle_intrinsics)
-		isa_if->handle_intrinsics(irg);
-	be_dump(DUMP_INITIAL, irg, "prepared");
+	prepare_jit_irg(birg, irg);
 
 	return isa_if->jit_compile(segment, irg);
 }
 
+struct ir_jit_session_t {
+	struct obstack obst; /**< holds the backend data of the compiled graph */
+};
+
+static bool jit_session_active;
+
+ir_jit_session_t *be_new_jit_session(void)
+{
+	initialize_isa();
+	if (jit_session_active)
+		panic("only one jit session may be active at a time");
+	jit_session_active = true;
+
+	/* Lowering is done once for the whole program, the graphs are only
+	 * prepared individually when they are compiled. */
+	if (get_irp_n_irgs() > 0 && !irg_is_constrained(get_irp_irg(0), IR_GRAPH_CONSTRAINT_TARGET_LOWERED))
+		be_lower_for_target();
+
+	/* PIC trampolines and symbols are shared by all functions of the
+	 * session. */
+	memset(&env, 0, sizeof(env));
+	env.ent_trampoline_map   = pmap_create();
+	env.pic_trampolines_type = new_type_segment(NEW_IDENT("$PIC_TRAMPOLINE_TYPE"), tf_none);
+	env.ent_pic_symbol_map   = pmap_create();
+	env.pic_symbols_type     = new_type_segment(NEW_IDENT("$PIC_SYMBOLS_TYPE"), tf_none);
+	env.cup_name             = "<jit>";
+
+	be_info_init();
+	if (isa_if->begin_jit_session)
+		isa_if->begin_jit_session();
+
+	ir_jit_session_t *const session = XMALLOCZ(ir_jit_session_t);
+	obstack_init(&session->obst);
+	return session;
+}
+
+void be_destroy_jit_session(ir_jit_session_t *const session)
+{
+	assert(jit_session_active);
+	if (isa_if->end_jit_session)
+		isa_if->end_jit_session();
+	be_info_free();
+
+	pmap_destroy(env.ent_trampoline_map);
+	pmap_destroy(env.ent_pic_symbol_map);
+	free_type(env.pic_trampolines_type);
+	free_type(env.pic_symbols_type);
+	memset(&env, 0, sizeof(env));
+
+	obstack_free(&session->obst, NULL);
+	xfree(session);
+	jit_session_active = false;
+}
+
+ir_jit_function_t *be_jit_session_compile(ir_jit_session_t *const session,
+                                          ir_jit_segment_t *const segment,
+                                          ir_graph *const irg)
+{
+	if (isa_if->jit_compile == NULL)
+		return NULL;
+
+	ir_entity *entity = get_irg_entity(irg);
+	if (get_entity_linkage(entity) & IR_LINKAGE_NO_CODEGEN)
+		return NULL;
+	if (!irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_TARGET_LOWERED))
+		panic("%+F was not lowered for the target by the jit session", irg);
+
+	be_irg_t *const birg = OALLOCZ(&session->obst, be_irg_t);
+	prepare_jit_irg(birg, irg);
+	ir_jit_function_t *const res = isa_if->jit_compile(segment, irg);
+	/* The backend data was released by the backend, reuse its memory. */
+	obstack_free(&session->obst, birg);
+	return res;
+}
+
 void be_emit_function(char *const buffer, ir_jit_function_t *const function)
 {
 	isa_if->emit_function(buffer, function);
 }
+
+unsigned be_emit_jit_relocation(char *const buffer, uint8_t const be_kind,
+                                ir_entity *const entity, int32_t const offset)
+{
+	if (isa_if->emit_jit_relocation == NULL)
+		panic("the selected backend cannot patch jit code");
+	return isa_if->emit_jit_relocation(buffer, be_kind, entity, offset);
+}
@@ -27,10 +27,12 @@ struct be_module_list_entry_t {
 
 void be_init_arch(void);
 void be_init_arch_TEMPLATE(void);
+void be_init_arch_aarch64(void);
 void be_init_arch_amd64(void);
 void be_init_arch_arm(void);
 void be_init_arch_ia32(void);
 void be_init_arch_sparc(void);
+void be_init_asmcache(void);
 void be_init_blocksched(void);
 void be_init_chordal(void);
 void be_init_chordal_common(void);
@@ -42,7 +44,9 @@ void be_init_copynone(void);
 void be_init_copyopt(void);
 void be_init_daemelspill(void);
 void be_init_dwarf(void);
+void be_init_funcorder(void);
 void be_init_gas(void);
+void be_init_linear_scan(void);
 void be_init_listsched(void);
 void be_init_live(void);
 void be_init_loopana(void);
@@ -52,6 +56,7 @@ void be_init_peephole(void);
 void be_init_pref_alloc(void);
 void be_init_ra(void);
 void be_init_sched(void);
+void be_init_sched_latency(void);
 void be_init_sched_normal(void);
 void be_init_sched_rand(void);
 void be_init_sched_trivial(void);
@@ -76,10 +81,12 @@ void be_init_modules(void)
 	run_once = true;
 
 	be_init_arch();
+	be_init_asmcache();
 	be_init_blocksched();
 	be_init_chordal_common();
 	be_init_copyopt();
 	be_init_dwarf();
+	be_init_funcorder();
 	be_init_gas();
 	be_init_live();
 	be_init_loopana();
@@ -97,15 +104,18 @@ void be_init_modules(void)
 	be_init_arch_arm();
 	be_init_arch_sparc();
 	be_init_arch_amd64();
+	be_init_arch_aarch64();
 	be_init_arch_TEMPLATE();
 
 	be_init_listsched();
 	be_init_sched_normal();
+	be_init_sched_latency();
 	be_init_sched_rand();
 	be_init_sched_trivial();
 
 	be_init_chordal_main();
 	be_init_pref_alloc();
+	be_init_linear_scan();
 
 	be_init_chordal();
 	be_init_pbqp_coloring();
@@ -137,6 +147,17 @@ typedef struct module_opt_data_t {
 	be_module_list_entry_t * const *list_head;
 } module_opt_data_t;
 
+void *be_find_module(be_module_list_entry_t const *const list_head,
+                     char const *const name)
+{
+	for (be_module_list_entry_t const *module = list_head; module != NULL;
+	     module = module->next) {
+		if (streq(module->name, name))
+			return module->data;
+	}
+	return NULL;
+}
+
 /**
  * Searches in list for module option. If found, set option to given value and
  * return true.
@@ -147,17 +168,12 @@ static bool set_opt_module(void *const data, size_t const length, char const *co
 	(void)length;
 
 	const module_opt_data_t *moddata = (module_opt_data_t*)data;
-	bool                     res     = false;
-	for (const be_module_list_entry_t *module = *(moddata->list_head);
-	     module != NULL; module = module->next) {
-		if (streq(module->name, opt)) {
-			*(moddata->var) = module->data;
-			res = true;
-			break;
-		}
-	}
+	void                    *module  = be_find_module(*moddata->list_head, opt);
+	if (module == NULL)
+		return false;
 
-	return res;
+	*(moddata->var) = module;
+	return true;
 }
 
 /**
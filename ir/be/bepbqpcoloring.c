@@ -19,6 +19,7 @@
 #include "irprintf.h"
 #include "irgwalk.h"
 #include "irtools.h"
+#include "array.h"
 #include "time.h"
 #include "execfreq_t.h"
 #include "bipartite.h"
@@ -36,7 +37,6 @@
 #include "benode.h"
 #include "belive.h"
 #include "belive.h"
-#include "plist.h"
 #include "pqueue.h"
 
 /* pbqp includes */
@@ -69,7 +69,7 @@ typedef struct be_pbqp_alloc_env_t {
 	bitset_t              const *allocatable_regs;
 	pbqp_matrix_t               *ife_matrix_template;
 	pbqp_matrix_t               *aff_matrix_template;
-	plist_t                     *rpeo;
+	pbqp_node_t               **rpeo;
 	unsigned                    *restr_nodes;
 	unsigned                    *ife_edge_num;
 	ir_execfreq_int_factors      execfreq_factors;
@@ -77,7 +77,6 @@ typedef struct be_pbqp_alloc_env_t {
 } be_pbqp_alloc_env_t;
 
 
-#define insert_edge(pbqp, src_node, trg_node, template_matrix) (add_edge_costs(pbqp, get_irn_idx(src_node), get_irn_idx(trg_node), pbqp_matrix_copy(pbqp, template_matrix)))
 #define get_free_regs(restr_nodes, cls, irn)                   ((cls)->n_regs - restr_nodes[get_irn_idx(irn)])
 
 static const lc_opt_table_entry_t options[] = {
@@ -86,6 +85,16 @@ static const lc_opt_table_entry_t options[] = {
 	LC_OPT_LAST
 };
 
+static void insert_edge(pbqp_t *pbqp, ir_node *src_node, ir_node *trg_node,
+                        pbqp_matrix_t *template_matrix)
+{
+	/* add_edge_costs() transposes the costs if the nodes are swapped, so pass
+	 * a copy of the template. */
+	pbqp_matrix_t *costs = pbqp_matrix_copy(pbqp, template_matrix);
+	add_edge_costs(pbqp, get_irn_idx(src_node), get_irn_idx(trg_node), costs);
+	pbqp_matrix_free(pbqp, costs);
+}
+
 #if KAPS_DUMP
 static FILE *my_open(const be_chordal_env_t *env, const char *prefix, const char *suffix)
 {
@@ -104,7 +113,7 @@ static FILE *my_open(const be_chordal_env_t *env, const char *prefix, const char
 			tu_name[i] = '_';
 
 	ir_snprintf(buf, sizeof(buf), "%s%s_%F_%s%s", prefix, tu_name, env->irg, env->cls->name, suffix);
-	free(tu_name);
+	xfree(tu_name);
 	result = fopen(buf, "wt");
 	if (result == NULL) {
 		panic("couldn't open '%s' for writing", buf);
@@ -141,6 +150,7 @@ static void create_pbqp_node(be_pbqp_alloc_env_t *pbqp_alloc_env, ir_node *irn)
 
 	/* add vector to pbqp node */
 	add_node_costs(pbqp_inst, get_irn_idx(irn), costs_vector);
+	vector_free(pbqp_inst, costs_vector);
 	pbqp_alloc_env->restr_nodes[get_irn_idx(irn)] = cntConstrains;
 }
 
@@ -187,10 +197,19 @@ static void insert_afe_edge(be_pbqp_alloc_env_t *pbqp_alloc_env, ir_node *src_no
 	const arch_register_class_t *cls         = pbqp_alloc_env->cls;
 	unsigned                    *restr_nodes = pbqp_alloc_env->restr_nodes;
 	unsigned                     colors_n    = cls->n_regs;
-	pbqp_matrix_t               *afe_matrix  = pbqp_matrix_alloc(pbqp, colors_n, colors_n);
 
 	if (get_edge(pbqp, get_irn_idx(src_node), get_irn_idx(trg_node)) == NULL) {
+#if DO_USEFUL_OPT || USE_BIPARTIT_MATCHING
+		/* do useful optimization to speed up pbqp solving */
+		if (get_free_regs(restr_nodes, cls, src_node) == 1 && get_free_regs(restr_nodes, cls, trg_node) == 1) {
+			return;
+		}
+#endif
+
+		pbqp_matrix_t *afe_matrix;
 		if (use_exec_freq) {
+			afe_matrix = pbqp_matrix_alloc(pbqp, colors_n, colors_n);
+
 			/* get exec_freq for copy_block */
 			ir_node *root_bl = get_nodes_block(src_node);
 			ir_node *copy_bl = is_Phi(src_node) ? get_Block_cfgpred_block(root_bl, pos) : root_bl;
@@ -209,9 +228,6 @@ static void insert_afe_edge(be_pbqp_alloc_env_t *pbqp_alloc_env, ir_node *src_no
 		}
 #if DO_USEFUL_OPT || USE_BIPARTIT_MATCHING
 		/* do useful optimization to speed up pbqp solving */
-		if (get_free_regs(restr_nodes, cls, src_node) == 1 && get_free_regs(restr_nodes, cls, trg_node) == 1) {
-			return;
-		}
 		if (get_free_regs(restr_nodes, cls, src_node) == 1 || get_free_regs(restr_nodes, cls, trg_node) == 1) {
 			if (get_free_regs(restr_nodes, cls, src_node) == 1) {
 				unsigned regIdx = vector_get_min_index(get_node(pbqp, get_irn_idx(src_node))->costs);
@@ -220,11 +236,17 @@ static void insert_afe_edge(be_pbqp_alloc_env_t *pbqp_alloc_env, ir_node *src_no
 				unsigned regIdx = vector_get_min_index(get_node(pbqp, get_irn_idx(trg_node))->costs);
 				vector_add_matrix_col(get_node(pbqp, get_irn_idx(src_node))->costs, afe_matrix, regIdx);
 			}
-			return;
+		} else {
+			/* insert interference edge */
+			insert_edge(pbqp, src_node, trg_node, afe_matrix);
 		}
-#endif
+#else
 		/* insert interference edge */
 		insert_edge(pbqp, src_node, trg_node, afe_matrix);
+#endif
+
+		if (afe_matrix != pbqp_alloc_env->aff_matrix_template)
+			pbqp_matrix_free(pbqp, afe_matrix);
 	}
 }
 
@@ -273,14 +295,32 @@ static void create_affinity_edges(ir_node *irn, void *env)
 	}
 }
 
+#if !USE_BIPARTIT_MATCHING
+/**
+ * Removes the frontmost occurrence of @p node from the block local rpeo
+ * @p list, whose front is the end of the array.
+ */
+static void erase_from_rpeo(pbqp_node_t **list, pbqp_node_t *node)
+{
+	size_t const len = ARR_LEN(list);
+	for (size_t i = len; i-- > 0;) {
+		if (list[i] != node)
+			continue;
+		memmove(&list[i], &list[i + 1], (len - i - 1) * sizeof(*list));
+		ARR_SHRINKLEN(list, len - 1);
+		return;
+	}
+}
+#endif
+
 static void create_pbqp_coloring_instance(ir_node *block, void *data)
 {
 	be_pbqp_alloc_env_t         *pbqp_alloc_env     = (be_pbqp_alloc_env_t*)data;
 	be_lv_t                     *lv                 = pbqp_alloc_env->lv;
 	const arch_register_class_t *cls                = pbqp_alloc_env->cls;
-	plist_t                     *rpeo               = pbqp_alloc_env->rpeo;
 	pbqp_t                      *pbqp_inst          = pbqp_alloc_env->pbqp_inst;
-	plist_t                     *temp_list          = plist_new();
+	/* rpeo of this block, the front of the order is the end of the array */
+	pbqp_node_t                **temp_list          = NEW_ARR_F(pbqp_node_t*, 0);
 	ir_nodeset_t                 live_nodes;
 #if USE_BIPARTIT_MATCHING
 	int                         *assignment         = ALLOCAN(int, cls->n_regs);
@@ -288,7 +328,7 @@ static void create_pbqp_coloring_instance(ir_node *block, void *data)
 	unsigned                    *restr_nodes        = pbqp_alloc_env->restr_nodes;
 	pqueue_t                    *restr_nodes_queue  = new_pqueue();
 	pqueue_t                    *queue              = new_pqueue();
-	plist_t                     *sorted_list        = plist_new();
+	pbqp_node_t                **sorted_list        = NEW_ARR_F(pbqp_node_t*, 0);
 	ir_node                     *last_element       = NULL;
 #endif
 
@@ -345,7 +385,7 @@ static void create_pbqp_coloring_instance(ir_node *block, void *data)
 					continue;
 
 				/* insert pbqp node into temp rpeo list of this block */
-				plist_insert_front(temp_list, get_node(pbqp_inst, get_irn_idx(proj)));
+				ARR_APP1(pbqp_node_t*, temp_list, get_node(pbqp_inst, get_irn_idx(proj)));
 
 				if (is_Perm_Proj(proj)) {
 					/* add proj to clique */
@@ -356,7 +396,7 @@ static void create_pbqp_coloring_instance(ir_node *block, void *data)
 					clique[clique_size] = clique_member;
 
 					for (idx = 0; idx < costs->len; idx++) {
-						if (costs->entries[idx].data != INF_COSTS) {
+						if (costs->entries[idx] != INF_COSTS) {
 							bipartite_add(bp, clique_size, idx);
 						}
 					}
@@ -368,8 +408,8 @@ static void create_pbqp_coloring_instance(ir_node *block, void *data)
 			}
 
 			if (clique_size > 0) {
-				foreach_plist(temp_list, listElement) {
-					pbqp_node *clique_candidate  = listElement->data;
+				for (size_t i = ARR_LEN(temp_list); i-- > 0;) {
+					pbqp_node *clique_candidate  = temp_list[i];
 					unsigned   idx               = 0;
 					bool       isMember          = true;
 
@@ -398,7 +438,7 @@ static void create_pbqp_coloring_instance(ir_node *block, void *data)
 
 					vector *costs = clique_candidate->costs;
 					for (idx = 0; idx < costs->len; idx++) {
-						if (costs->entries[idx].data != INF_COSTS) {
+						if (costs->entries[idx] != INF_COSTS) {
 							bipartite_add(bp, clique_size, idx);
 						}
 					}
@@ -418,7 +458,7 @@ static void create_pbqp_coloring_instance(ir_node *block, void *data)
 				int     idx;
 				for (idx = 0; idx < (int)costs->len; idx++) {
 					if (assignment[nodeIdx] != idx) {
-						costs->entries[idx].data = INF_COSTS;
+						costs->entries[idx] = INF_COSTS;
 					}
 				}
 				assert(assignment[nodeIdx] >= 0 && "there must have been a register assigned (node not register pressure faithful?)");
@@ -428,7 +468,7 @@ static void create_pbqp_coloring_instance(ir_node *block, void *data)
 			bipartite_free(bp);
 		} else {
 			if (arch_irn_consider_in_reg_alloc(cls, irn)) {
-				plist_insert_front(temp_list, get_node(pbqp_inst, get_irn_idx(irn)));
+				ARR_APP1(pbqp_node_t*, temp_list, get_node(pbqp_inst, get_irn_idx(irn)));
 			}
 		}
 #else
@@ -463,33 +503,33 @@ static void create_pbqp_coloring_instance(ir_node *block, void *data)
 				} else {
 					pqueue_put(queue, last_element, pbqp_alloc_env->ife_edge_num[get_irn_idx(last_element)]);
 				}
-				plist_erase(temp_list, plist_find_value(temp_list, get_node(pbqp_inst, last_element->node_idx)));
+				erase_from_rpeo(temp_list, get_node(pbqp_inst, last_element->node_idx));
 				last_element = NULL;
 			}
 
 			/* first insert all restricted proj nodes */
 			while (!pqueue_empty(restr_nodes_queue)) {
 				ir_node *node = (ir_node*)pqueue_pop_front(restr_nodes_queue);
-				plist_insert_front(sorted_list, get_node(pbqp_inst, get_irn_idx(node)));
+				ARR_APP1(pbqp_node_t*, sorted_list, get_node(pbqp_inst, get_irn_idx(node)));
 			}
 
 			/* insert proj nodes descending by their number of interference edges */
 			while (!pqueue_empty(queue)) {
 				ir_node *node = (ir_node*)pqueue_pop_front(queue);
-				plist_insert_front(sorted_list, get_node(pbqp_inst, get_irn_idx(node)));
+				ARR_APP1(pbqp_node_t*, sorted_list, get_node(pbqp_inst, get_irn_idx(node)));
 			}
 
-			/* invert sorted list */
-			foreach_plist(sorted_list, el) {
-				plist_insert_front(temp_list, el->data);
+			/* prepend the sorted nodes, the first one becomes the new front */
+			for (size_t i = ARR_LEN(sorted_list); i-- > 0;) {
+				ARR_APP1(pbqp_node_t*, temp_list, sorted_list[i]);
 			}
 
-			plist_clear(sorted_list);
+			ARR_SHRINKLEN(sorted_list, 0);
 		} else {
 			if (arch_irn_consider_in_reg_alloc(cls, irn)) {
 				// remember last colorable node
 				last_element = irn;
-				plist_insert_front(temp_list, get_node(pbqp_inst, get_irn_idx(irn)));
+				ARR_APP1(pbqp_node_t*, temp_list, get_node(pbqp_inst, get_irn_idx(irn)));
 			} else {
 				// node not colorable, so ignore it
 				last_element = NULL;
@@ -499,16 +539,16 @@ static void create_pbqp_coloring_instance(ir_node *block, void *data)
 	}
 
 	/* add the temp rpeo list of this block to the global reverse perfect elimination order list*/
-	foreach_plist(temp_list, el) {
-		plist_insert_back(rpeo, el->data);
+	for (size_t i = ARR_LEN(temp_list); i-- > 0;) {
+		ARR_APP1(pbqp_node_t*, pbqp_alloc_env->rpeo, temp_list[i]);
 	}
 
 	/* free reserved memory */
 	ir_nodeset_destroy(&live_nodes);
-	plist_free(temp_list);
+	DEL_ARR_F(temp_list);
 #if USE_BIPARTIT_MATCHING
 #else
-	plist_free(sorted_list);
+	DEL_ARR_F(sorted_list);
 	del_pqueue(queue);
 	del_pqueue(restr_nodes_queue);
 #endif
@@ -553,7 +593,7 @@ static void be_pbqp_coloring(be_chordal_env_t *env)
 	pbqp_alloc_env.irg              = irg;
 	pbqp_alloc_env.lv               = be_get_irg_liveness(irg);
 	pbqp_alloc_env.allocatable_regs = env->allocatable_regs;
-	pbqp_alloc_env.rpeo             = plist_new();
+	pbqp_alloc_env.rpeo             = NEW_ARR_F(pbqp_node_t*, 0);
 	pbqp_alloc_env.restr_nodes      = XMALLOCNZ(unsigned, get_irg_last_idx(irg));
 	pbqp_alloc_env.ife_edge_num     = XMALLOCNZ(unsigned, get_irg_last_idx(irg));
 	pbqp_alloc_env.env              = env;
@@ -597,8 +637,8 @@ static void be_pbqp_coloring(be_chordal_env_t *env)
 #if TIMER
 	ir_timer_reset_and_start(t_ra_pbqp_alloc_create_aff);
 #endif
-	foreach_plist(pbqp_alloc_env.rpeo, element) {
-		pbqp_node_t *node = (pbqp_node_t*)element->data;
+	for (size_t i = 0, n = ARR_LEN(pbqp_alloc_env.rpeo); i < n; ++i) {
+		pbqp_node_t *node = pbqp_alloc_env.rpeo[i];
 		ir_node     *irn  = get_idx_irn(irg, node->index);
 
 		create_affinity_edges(irn, &pbqp_alloc_env);
@@ -616,8 +656,8 @@ static void be_pbqp_coloring(be_chordal_env_t *env)
 
 	/* print out reverse perfect elimination order */
 #if PRINT_RPEO
-	foreach_plist(pbqp_alloc_env.rpeo, elements) {
-		pbqp_node_t *node = elements->data;
+	for (size_t i = 0, n = ARR_LEN(pbqp_alloc_env.rpeo); i < n; ++i) {
+		pbqp_node_t *node = pbqp_alloc_env.rpeo[i];
 		printf(" %d(%ld);", node->index, get_idx_irn(irg, node->index)->node_nr);
 	}
 	printf("\n");
@@ -643,8 +683,8 @@ static void be_pbqp_coloring(be_chordal_env_t *env)
 
 
 	/* assign colors */
-	foreach_plist(pbqp_alloc_env.rpeo, element) {
-		pbqp_node_t           *node  = (pbqp_node_t*)element->data;
+	for (size_t i = 0, n = ARR_LEN(pbqp_alloc_env.rpeo); i < n; ++i) {
+		pbqp_node_t           *node  = pbqp_alloc_env.rpeo[i];
 		ir_node               *irn   = get_idx_irn(irg, node->index);
 		num                    color = get_node_solution(pbqp_alloc_env.pbqp_inst, node->index);
 		const arch_register_t *reg   = arch_register_for_index(cls, color);
@@ -668,9 +708,9 @@ static void be_pbqp_coloring(be_chordal_env_t *env)
 	fclose(file_before);
 #endif
 	free_pbqp(pbqp_alloc_env.pbqp_inst);
-	plist_free(pbqp_alloc_env.rpeo);
-	free(pbqp_alloc_env.restr_nodes);
-	free(pbqp_alloc_env.ife_edge_num);
+	DEL_ARR_F(pbqp_alloc_env.rpeo);
+	xfree(pbqp_alloc_env.restr_nodes);
+	xfree(pbqp_alloc_env.ife_edge_num);
 }
 
 
@@ -15,8 +15,10 @@
 #include "irgwalk.h"
 #include "ircons.h"
 #include "irgmod.h"
+#include "irtools.h"
 #include "heights.h"
 #include "panic.h"
+#include "statev_t.h"
 
 #include "beirg.h"
 #include "belive.h"
@@ -26,9 +28,23 @@
 
 DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
 
-static be_lv_t *lv;
-static ir_node *current_node;
-ir_node       **register_values;
+/** A rewrite rule, tried on nodes of the root opcode it is registered for. */
+typedef struct peephole_rule_t peephole_rule_t;
+struct peephole_rule_t {
+	peephole_opt_func func;
+	char const       *name;
+	ir_op const      *operand_op; /**< opcode of operand pos, NULL for any */
+	int               pos;
+	unsigned          n_fired;    /**< number of times the rule changed the graph */
+	peephole_rule_t  *next;       /**< next rule of the same root opcode */
+};
+
+static be_lv_t          *lv;
+static ir_node          *current_node;
+static unsigned          n_changes;  /**< number of nodes exchanged so far */
+static peephole_rule_t **rules;      /**< rule lists indexed by opcode */
+static int               max_passes = 3;
+ir_node                **register_values;
 
 static void clear_reg_value(ir_node *node)
 {
@@ -93,6 +109,7 @@ static void be_peephole_before_exchange(const ir_node *old_node,
 {
 	DB((dbg, LEVEL_1, "About to exchange and kill %+F with %+F\n", old_node,
 	    new_node));
+	++n_changes;
 
 	assert(sched_is_scheduled(skip_Proj_const(old_node)));
 	assert(sched_is_scheduled(skip_Proj(new_node)));
@@ -127,6 +144,10 @@ static void be_peephole_before_exchange(const ir_node *old_node,
 	}
 
 	be_liveness_remove(lv, old_node);
+	/* the operands lose a user */
+	foreach_irn_in(old_node, i, op) {
+		be_liveness_mark(lv, op);
+	}
 }
 
 void be_peephole_exchange(ir_node *old, ir_node *nw)
@@ -145,6 +166,7 @@ void be_peephole_replace(ir_node *const old, ir_node *const nw)
 
 ir_node *be_peephole_to_tuple(ir_node *const node)
 {
+	++n_changes;
 	be_liveness_remove(lv, node);
 	set_irn_mode(node, mode_T);
 	ir_node *const res = be_new_Proj(node, 0);
@@ -153,13 +175,78 @@ ir_node *be_peephole_to_tuple(ir_node *const node)
 	return res;
 }
 
+void be_register_peephole_rule(ir_op *const op, int const pos,
+                               ir_op const *const operand_op,
+                               peephole_opt_func const func,
+                               char const *const name)
+{
+	unsigned const code = get_op_code(op);
+	if (rules == NULL)
+		rules = NEW_ARR_FZ(peephole_rule_t*, ir_get_n_opcodes());
+	if (code >= ARR_LEN(rules)) {
+		size_t const old_len = ARR_LEN(rules);
+		ARR_RESIZE(peephole_rule_t*, rules, ir_get_n_opcodes());
+		memset(&rules[old_len], 0, (ARR_LEN(rules) - old_len) * sizeof(*rules));
+	}
+
+	peephole_rule_t *const rule = XMALLOCZ(peephole_rule_t);
+	rule->func       = func;
+	rule->name       = name != NULL ? name : get_op_name(op);
+	rule->operand_op = operand_op;
+	rule->pos        = pos;
+
+	/* keep registration order */
+	peephole_rule_t **anchor = &rules[code];
+	while (*anchor != NULL)
+		anchor = &(*anchor)->next;
+	*anchor = rule;
+}
+
+static bool rule_matches(peephole_rule_t const *const rule,
+                         ir_node const *const node)
+{
+	if (rule->operand_op == NULL)
+		return true;
+	if (rule->pos >= get_irn_arity(node))
+		return false;
+	ir_node const *const operand = skip_Proj_const(get_irn_n(node, rule->pos));
+	return get_irn_op(operand) == rule->operand_op;
+}
+
 /**
- * block-walker: run peephole optimization on the given block.
+ * Try the rules of the node's opcode until one of them changes the graph.
+ * A rule counts as fired if it exchanged a node or created new ones.
  */
-static void process_block(ir_node *block, void *data)
+static void apply_rules(ir_node *const node)
 {
-	(void)data;
+	unsigned const code = get_irn_opcode(node);
+	if (code >= ARR_LEN(rules))
+		return;
+
+	ir_graph *const irg = get_irn_irg(node);
+	for (peephole_rule_t *rule = rules[code]; rule != NULL; rule = rule->next) {
+		if (!rule_matches(rule, node))
+			continue;
 
+		unsigned const changes_before = n_changes;
+		unsigned const idx_before     = get_irg_last_idx(irg);
+		DB((dbg, LEVEL_2, "optimize %+F with %s\n", node, rule->name));
+		rule->func(current_node);
+		assert(!is_Bad(current_node));
+		if (n_changes != changes_before || get_irg_last_idx(irg) != idx_before) {
+			++rule->n_fired;
+			return;
+		}
+	}
+}
+
+/**
+ * Walk the block from the last instruction to the first and apply the rules.
+ *
+ * @return whether a node was exchanged
+ */
+static bool process_block_once(ir_node *const block)
+{
 	/* construct initial register assignment */
 	memset(register_values, 0, sizeof(ir_node*) * isa_if->n_registers);
 
@@ -169,6 +256,8 @@ static void process_block(ir_node *block, void *data)
 	}
 	DB((dbg, LEVEL_1, "\nstart processing\n"));
 
+	unsigned const changes_before = n_changes;
+
 	/* walk the block from last insn to the first */
 	current_node = sched_last(block);
 	for (; !sched_is_begin(current_node);
@@ -180,14 +269,42 @@ static void process_block(ir_node *block, void *data)
 		clear_defs(current_node);
 		set_uses(current_node);
 
-		ir_op            *op            = get_irn_op(current_node);
-		peephole_opt_func peephole_node = (peephole_opt_func)op->ops.generic;
-		if (peephole_node == NULL)
-			continue;
+		apply_rules(current_node);
+	}
+	return n_changes != changes_before;
+}
 
-		DB((dbg, LEVEL_2, "optimize %+F\n", current_node));
-		peephole_node(current_node);
-		assert(!is_Bad(current_node));
+/**
+ * block-walker: run peephole optimization on the given block.  A rewrite may
+ * expose new opportunities at nodes already visited (above all at the operands
+ * of the replacement), so the block is walked again until nothing changes or
+ * the pass budget is exhausted.  Each walk starts from the live-out registers,
+ * so the register values stay exact.
+ */
+static void process_block(ir_node *block, void *data)
+{
+	(void)data;
+
+	for (int pass = 0; process_block_once(block) && ++pass < max_passes;) {
+		DB((dbg, LEVEL_1, "\nrevisiting %+F\n", block));
+	}
+}
+
+static void free_rules(void)
+{
+	for (size_t i = 0, n = ARR_LEN(rules); i < n; ++i) {
+		for (peephole_rule_t *rule = rules[i], *next; rule != NULL; rule = next) {
+			next = rule->next;
+			if (rule->n_fired > 0) {
+				DB((dbg, LEVEL_1, "rule %s fired %u times\n", rule->name,
+				    rule->n_fired));
+				stat_ev_ctx_push_str("bepeephole_rule", rule->name);
+				stat_ev_int("bepeephole_fired", rule->n_fired);
+				stat_ev_ctx_pop("bepeephole_rule");
+			}
+			xfree(rule);
+		}
+		rules[i] = NULL;
 	}
 }
 
@@ -407,13 +524,30 @@ void be_peephole_opt(ir_graph *irg)
 
 	register_values = XMALLOCN(ir_node*, isa_if->n_registers);
 
-	irg_block_walk_graph(irg, process_block, NULL, NULL);
+	unsigned const last_idx = get_irg_last_idx(irg);
+	if (rules != NULL) {
+		irg_block_walk_graph(irg, process_block, NULL, NULL);
+		free_rules();
+	}
+
+	/* nodes created by the optimizations may be used in other blocks */
+	be_liveness_mark_new_nodes(lv, last_idx);
+	be_liveness_update_marked(lv);
 
-	free(register_values);
+	xfree(register_values);
 }
 
+static const lc_opt_table_entry_t options[] = {
+	LC_OPT_ENT_INT("passes", "maximum number of peephole walks per block", &max_passes),
+	LC_OPT_LAST
+};
+
 BE_REGISTER_MODULE_CONSTRUCTOR(be_init_peephole)
 void be_init_peephole(void)
 {
+	lc_opt_entry_t *be_grp       = lc_opt_get_grp(firm_opt_get_root(), "be");
+	lc_opt_entry_t *peephole_grp = lc_opt_get_grp(be_grp, "peephole");
+	lc_opt_add_table(peephole_grp, options);
+
 	FIRM_DBG_REGISTER(dbg, "firm.be.peephole");
 }
@@ -74,21 +74,34 @@ bool be_can_move_up(ir_heights_t *heights, const ir_node *node,
                     const ir_node *after);
 
 /**
- * Register a peephole optimization function.
+ * Register a peephole rule for nodes with opcode @p op.  If @p operand_op is
+ * not NULL, the rule is only tried on nodes whose operand @p pos is produced by
+ * a node with this opcode (looking through Projs).  The rules of an opcode are
+ * tried in registration order until one of them changes the graph.  Rules only
+ * live until the end of the next be_peephole_opt() run.
+ *
+ * @param name  name of the rule in statistics, NULL for the opcode name
+ */
+void be_register_peephole_rule(ir_op *op, int pos, ir_op const *operand_op,
+                               peephole_opt_func func, char const *name);
+
+/**
+ * Register a peephole optimization function for all nodes with opcode @p op.
  */
 static inline void register_peephole_optimization(ir_op *const op, peephole_opt_func const func)
 {
-	assert(!op->ops.generic);
-	op->ops.generic = (op_func)func;
+	be_register_peephole_rule(op, -1, NULL, func, NULL);
 }
 
 /**
  * Do peephole optimizations. It traverses the schedule of all blocks in
  * backward direction. The register_values variable indicates which (live)
  * values are stored in which register.
- * The generic op handler is called for each node if it exists. That's where
- * backend specific optimizations should be performed based on the
- * register-liveness information.
+ * The registered rules are tried on each node. That's where backend specific
+ * optimizations should be performed based on the register-liveness
+ * information.  A block is walked again after a node was exchanged in it,
+ * until nothing changes or the budget given by the be.peephole.passes option
+ * is exhausted.  Statistics report how often each rule fired.
  */
 void be_peephole_opt(ir_graph *irg);
 
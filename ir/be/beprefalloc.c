@@ -56,6 +56,7 @@
 #include "bespill.h"
 #include "bespillutil.h"
 #include "beverify.h"
+#include "bestat.h"
 #include "beutil.h"
 #include "bestack.h"
 
@@ -467,7 +468,7 @@ static void combine_congruence_classes(void)
 	irg_block_walk_graph(irg, create_congruence_class, NULL, NULL);
 	/* merge preferences */
 	irg_walk_graph(irg, set_congruence_prefs, NULL, NULL);
-	free(congruence_classes);
+	xfree(congruence_classes);
 }
 
 
@@ -1011,7 +1012,7 @@ static void solve_lpp(ir_nodeset_t *live_nodes, ir_node *node,
 			assert(lpp_vars[l*n_regs+r] > 0);
 		}
 	}
-	free(forbidden_edges);
+	xfree(forbidden_edges);
 
 	/* add constraints */
 	for (unsigned l = 0; l < n_regs; ++l) {
@@ -1070,7 +1071,7 @@ static void solve_lpp(ir_nodeset_t *live_nodes, ir_node *node,
 		assert(dest_reg != (unsigned)-1);
 		assignment[dest_reg] = l;
 	}
-	free(lpp_vars);
+	xfree(lpp_vars);
 
 	fprintf(stderr, "Assignment: ");
 	for (unsigned l = 0; l < n_regs; ++l) {
@@ -1200,7 +1201,7 @@ static void enforce_constraints(ir_nodeset_t *live_nodes, ir_node *node,
 	hungarian_prepare_cost_matrix(bp, HUNGARIAN_MODE_MAXIMIZE_UTIL);
 
 	unsigned *assignment = ALLOCAN(unsigned, n_regs);
-	int       res        = hungarian_solve(bp, assignment, NULL, 0);
+	int       res        = hungarian_solve_jv(bp, assignment, NULL, 0);
 	(void)res;
 	assert(res == 0);
 
@@ -1736,7 +1737,7 @@ static void determine_block_order(void)
 
 static void free_block_order(void)
 {
-	free(block_order);
+	xfree(block_order);
 }
 
 /**
@@ -1770,9 +1771,11 @@ static void be_pref_alloc_cls(void)
 static void spill(const regalloc_if_t *regif)
 {
 	/* spill */
+	be_spill_stat_t *const spill_stat = be_spill_stat_begin(irg, cls);
 	be_timer_push(T_RA_SPILL);
 	be_do_spill(irg, cls, regif);
 	be_timer_pop(T_RA_SPILL);
+	be_spill_stat_finish(spill_stat);
 
 	be_timer_push(T_RA_SPILL_APPLY);
 	check_for_memory_operands(irg, regif);
@@ -1830,7 +1833,7 @@ static void be_pref_alloc(ir_graph *new_irg, const regalloc_if_t *regif)
 		/* we most probably constructed new Phis so liveness info is invalid
 		 * now */
 		be_invalidate_live_sets(irg);
-		free(normal_regs);
+		xfree(normal_regs);
 
 		stat_ev_ctx_pop("regcls");
 	}
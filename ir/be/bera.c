@@ -24,6 +24,18 @@ void be_register_allocator(const char *name, allocate_func allocator)
 	be_add_module_to_list(&register_allocators, name, allocator);
 }
 
+allocate_func be_find_register_allocator(char const *const name)
+{
+	return (allocate_func)be_find_module(register_allocators, name);
+}
+
+allocate_func be_select_register_allocator(allocate_func const allocator)
+{
+	allocate_func const prev = selected_allocator;
+	selected_allocator = allocator;
+	return prev;
+}
+
 void be_allocate_registers(ir_graph *irg, const regalloc_if_t *regif)
 {
 	selected_allocator(irg, regif);
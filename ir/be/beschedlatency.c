@@ -0,0 +1,309 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   List scheduler balancing instruction latencies against register
+ *          pressure.
+ *
+ * The machine model is the cost model of the backend: the estimated cost of
+ * a node is taken as the number of cycles until its results are available.
+ * Nodes are prioritized by the length of the critical path from them to the
+ * end of their block, and nodes whose operands are not available yet are
+ * delayed.  While the estimated register pressure of a register class reaches
+ * the number of allocatable registers, nodes ending live ranges are preferred
+ * instead.
+ */
+#include <limits.h>
+#include <string.h>
+
+#include "be_t.h"
+#include "bearch.h"
+#include "belistsched.h"
+#include "bemodule.h"
+#include "benode.h"
+#include "besched.h"
+#include "debug.h"
+#include "iredges_t.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "irnodeset.h"
+#include "util.h"
+#include "xmalloc.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
+
+#define PRIO_UNKNOWN UINT_MAX
+
+typedef struct latency_info_t {
+	unsigned prio;   /**< length of the critical path to the block end */
+	unsigned ready;  /**< cycle at which the results are available */
+	unsigned n_uses; /**< unscheduled uses of the value in the current block */
+	unsigned stamp;  /**< block number for which n_uses is valid */
+} latency_info_t;
+
+static latency_info_t *infos;
+static unsigned       *pressure;
+static unsigned       *limits;
+static unsigned        block_nr;
+static unsigned        cycle;
+
+static latency_info_t *get_info(const ir_node *node)
+{
+	return &infos[get_irn_idx(node)];
+}
+
+static unsigned get_latency(const ir_node *node)
+{
+	if (is_Phi(node) || be_is_Keep(node))
+		return 0;
+	return isa_if->get_op_estimated_cost(node);
+}
+
+/**
+ * Returns the register class of @p value if it occupies an allocatable
+ * register, NULL otherwise.
+ */
+static const arch_register_class_t *get_value_cls(const ir_node *value)
+{
+	if (get_irn_mode(value) == mode_T)
+		return NULL;
+	const arch_register_req_t *req = arch_get_irn_register_req(value);
+	if (req->cls == NULL || req->ignore || req->cls->manual_ra)
+		return NULL;
+	return req->cls;
+}
+
+static bool is_live_out(const ir_node *value, const ir_node *block)
+{
+	foreach_out_edge(value, edge) {
+		const ir_node *user = get_edge_src_irn(edge);
+		if (is_Phi(user) || get_nodes_block(user) != block)
+			return true;
+	}
+	return false;
+}
+
+static unsigned get_prio(ir_node *node);
+
+static unsigned get_max_user_prio(const ir_node *value, const ir_node *block)
+{
+	unsigned max = 0;
+	foreach_out_edge(value, edge) {
+		ir_node *user = get_edge_src_irn(edge);
+		if (is_Proj(user)) {
+			max = MAX(max, get_max_user_prio(user, block));
+		} else if (!is_Block(user) && !is_Phi(user)
+		           && get_nodes_block(user) == block) {
+			max = MAX(max, get_prio(user));
+		}
+	}
+	return max;
+}
+
+static unsigned get_prio(ir_node *node)
+{
+	latency_info_t *info = get_info(node);
+	if (info->prio == PRIO_UNKNOWN) {
+		info->prio = get_latency(node)
+		           + get_max_user_prio(node, get_nodes_block(node));
+	}
+	return info->prio;
+}
+
+/**
+ * Returns the cycle at which all operands of @p node are available.
+ */
+static unsigned get_earliest_cycle(const ir_node *node)
+{
+	const ir_node *block    = get_nodes_block(node);
+	unsigned       earliest = 0;
+	foreach_irn_in(node, i, op) {
+		const ir_node *pred = skip_Proj_const(op);
+		if (get_nodes_block(pred) == block)
+			earliest = MAX(earliest, get_info(pred)->ready);
+	}
+	return earliest;
+}
+
+static void add_pressure(const ir_node *value)
+{
+	const arch_register_class_t *cls = get_value_cls(value);
+	if (cls == NULL)
+		return;
+	latency_info_t *info = get_info(value);
+	if ((info->stamp == block_nr && info->n_uses > 0)
+	    || is_live_out(value, get_nodes_block(value)))
+		++pressure[cls->index];
+}
+
+static void init_block(ir_node *block)
+{
+	++block_nr;
+	cycle = 0;
+	memset(pressure, 0, isa_if->n_register_classes * sizeof(*pressure));
+
+	/* count the uses of each value and the values live into the block */
+	foreach_out_edge(block, edge) {
+		ir_node *node = get_edge_src_irn(edge);
+		get_info(node)->ready = 0;
+		if (is_Phi(node) || arch_is_irn_not_scheduled(node))
+			continue;
+		foreach_irn_in(node, i, op) {
+			const arch_register_class_t *cls = get_value_cls(op);
+			if (cls == NULL)
+				continue;
+			latency_info_t *info = get_info(op);
+			if (info->stamp != block_nr) {
+				info->stamp  = block_nr;
+				info->n_uses = 0;
+				if (get_nodes_block(op) != block
+				    || arch_is_irn_not_scheduled(skip_Proj_const(op)))
+					++pressure[cls->index];
+			}
+			++info->n_uses;
+		}
+	}
+
+	/* phis are defined at the block entry */
+	foreach_out_edge(block, edge) {
+		ir_node *node = get_edge_src_irn(edge);
+		if (is_Phi(node))
+			add_pressure(node);
+	}
+}
+
+static bool is_pressure_high(void)
+{
+	for (unsigned c = 0, n = isa_if->n_register_classes; c < n; ++c) {
+		if (pressure[c] >= limits[c])
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Returns the number of live ranges scheduling @p node ends minus the number
+ * of live ranges it starts.
+ */
+static int get_pressure_delta(ir_node *node)
+{
+	const ir_node *block = get_nodes_block(node);
+	int            delta = 0;
+	foreach_irn_in(node, i, op) {
+		if (get_value_cls(op) == NULL)
+			continue;
+		const latency_info_t *info = get_info(op);
+		if (info->n_uses == 1
+		    && (get_nodes_block(op) != block || !is_live_out(op, block)))
+			++delta;
+	}
+	be_foreach_value(node, value,
+		if (get_value_cls(value) != NULL)
+			--delta;
+	);
+	return delta;
+}
+
+static ir_node *latency_select(ir_nodeset_t *ready_set)
+{
+	bool     high      = is_pressure_high();
+	ir_node *best      = NULL;
+	int      best_key  = INT_MIN;
+	unsigned best_prio = 0;
+	foreach_ir_nodeset(ready_set, node, iter) {
+		int key;
+		if (high) {
+			key = get_pressure_delta(node);
+		} else {
+			unsigned const earliest = get_earliest_cycle(node);
+			key = earliest > cycle ? -(int)(earliest - cycle) : 0;
+		}
+		unsigned const prio = get_prio(node);
+		if (best == NULL || key > best_key
+		    || (key == best_key && (prio > best_prio
+		        || (prio == best_prio
+		            && get_irn_idx(node) < get_irn_idx(best))))) {
+			best      = node;
+			best_key  = key;
+			best_prio = prio;
+		}
+	}
+	DB((dbg, LEVEL_2, "\tselect %+F (prio %u, key %d%s)\n", best, best_prio,
+	    best_key, high ? ", high pressure" : ""));
+	return best;
+}
+
+static void issue(ir_node *node)
+{
+	const ir_node *block   = get_nodes_block(node);
+	unsigned const start   = MAX(cycle, get_earliest_cycle(node));
+	unsigned const latency = get_latency(node);
+	get_info(node)->ready = start + latency;
+	if (latency > 0)
+		cycle = start + 1;
+
+	foreach_irn_in(node, i, op) {
+		const arch_register_class_t *cls = get_value_cls(op);
+		if (cls == NULL)
+			continue;
+		latency_info_t *info = get_info(op);
+		assert(info->stamp == block_nr && info->n_uses > 0);
+		if (--info->n_uses == 0
+		    && (get_nodes_block(op) != block || !is_live_out(op, block))
+		    && pressure[cls->index] > 0)
+			--pressure[cls->index];
+	}
+	be_foreach_value(node, value,
+		add_pressure(value);
+	);
+}
+
+static void sched_block(ir_node *block, void *data)
+{
+	(void)data;
+	init_block(block);
+	ir_nodeset_t *cands = be_list_sched_begin_block(block);
+	while (ir_nodeset_size(cands) > 0) {
+		ir_node *node = latency_select(cands);
+		issue(node);
+		be_list_sched_schedule(node);
+	}
+	be_list_sched_end_block();
+}
+
+static void sched_latency(ir_graph *irg)
+{
+	unsigned const n_classes = isa_if->n_register_classes;
+	pressure = XMALLOCN(unsigned, n_classes);
+	limits   = XMALLOCN(unsigned, n_classes);
+	for (unsigned c = 0; c < n_classes; ++c) {
+		const arch_register_class_t *cls = &isa_if->register_classes[c];
+		limits[c] = cls->manual_ra ? UINT_MAX
+		                           : be_get_n_allocatable_regs(irg, cls);
+	}
+
+	be_list_sched_begin(irg);
+
+	unsigned const n_idx = get_irg_last_idx(irg);
+	infos = XMALLOCNZ(latency_info_t, n_idx);
+	for (unsigned i = 0; i < n_idx; ++i)
+		infos[i].prio = PRIO_UNKNOWN;
+	block_nr = 0;
+
+	irg_block_walk_graph(irg, sched_block, NULL, NULL);
+
+	be_list_sched_finish();
+	xfree(infos);
+	xfree(limits);
+	xfree(pressure);
+}
+
+BE_REGISTER_MODULE_CONSTRUCTOR(be_init_sched_latency)
+void be_init_sched_latency(void)
+{
+	be_register_scheduler("latency", sched_latency);
+	FIRM_DBG_REGISTER(dbg, "firm.be.sched.latency");
+}
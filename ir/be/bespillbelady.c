@@ -58,8 +58,11 @@ typedef struct loc_t {
 } loc_t;
 
 typedef struct workset_t {
-	unsigned len;     /**< current length */
-	loc_t    vals[];  /**< array of the values/distances in this working set */
+	unsigned  len;     /**< current length */
+	unsigned *slots;   /**< slot of each value by node index, entries of
+	                        values not in the workset are stale.  NULL if
+	                        the workset is not indexed. */
+	loc_t     vals[];  /**< array of the values/distances in this working set */
 } workset_t;
 
 static struct obstack               obst;
@@ -67,6 +70,7 @@ static const arch_register_class_t *cls;
 static const be_lv_t               *lv;
 static be_loopana_t                *loop_ana;
 static unsigned                     n_regs;
+static unsigned                     n_idx;  /**< size of the workset index */
 static workset_t                   *ws;     /**< the main workset used while
 	                                             processing a block. */
 static be_uses_t                   *uses;   /**< env for the next-use magic */
@@ -97,6 +101,47 @@ static workset_t *new_workset(void)
 	return OALLOCFZ(&obst, workset_t, vals, n_regs);
 }
 
+/**
+ * Alloc a new workset which finds its values in constant time.
+ */
+static workset_t *new_indexed_workset(void)
+{
+	workset_t *res = new_workset();
+	res->slots = OALLOCNZ(&obst, unsigned, n_idx);
+	return res;
+}
+
+/**
+ * Recomputes the index of @p workset after its values were moved.
+ */
+static void workset_reindex(workset_t *workset)
+{
+	if (workset->slots == NULL)
+		return;
+	for (unsigned i = 0, len = workset->len; i < len; ++i) {
+		workset->slots[get_irn_idx(workset->vals[i].node)] = i;
+	}
+}
+
+/**
+ * Returns the slot of @p val in @p workset or the length of the workset if
+ * @p val is not contained.
+ */
+static unsigned workset_find(const workset_t *workset, const ir_node *val)
+{
+	unsigned const len = workset->len;
+	if (workset->slots != NULL) {
+		unsigned const slot = workset->slots[get_irn_idx(val)];
+		return slot < len && workset->vals[slot].node == val ? slot : len;
+	}
+
+	for (unsigned i = 0; i < len; ++i) {
+		if (workset->vals[i].node == val)
+			return i;
+	}
+	return len;
+}
+
 /**
  * Alloc a new instance on obstack and make it equal to @param workset
  */
@@ -104,6 +149,7 @@ static workset_t *workset_clone(workset_t *workset)
 {
 	workset_t *res = OALLOCF(&obst, workset_t, vals, n_regs);
 	memcpy(res, workset, sizeof(*res) + n_regs * sizeof(res->vals[0]));
+	res->slots = NULL;
 	return res;
 }
 
@@ -112,8 +158,11 @@ static workset_t *workset_clone(workset_t *workset)
  */
 static void workset_copy(workset_t *dest, const workset_t *src)
 {
+	unsigned *const slots = dest->slots;
 	size_t size = sizeof(*src) + n_regs * sizeof(src->vals[0]);
 	memcpy(dest, src, size);
+	dest->slots = slots;
+	workset_reindex(dest);
 }
 
 /**
@@ -125,6 +174,7 @@ static void workset_bulk_fill(workset_t *workset, int count, const loc_t *locs)
 {
 	workset->len = count;
 	MEMCPY(&workset->vals[0], locs, count);
+	workset_reindex(workset);
 }
 
 /**
@@ -137,13 +187,11 @@ static void workset_insert(workset_t *workset, ir_node *val, bool spilled)
 	assert(arch_irn_consider_in_reg_alloc(cls, val));
 
 	/* check if val is already contained */
-	for (unsigned i = 0, len = workset->len; i < len; ++i) {
-		loc_t *loc = &workset->vals[i];
-		if (loc->node == val) {
-			if (spilled)
-				loc->spilled = true;
-			return;
-		}
+	unsigned const slot = workset_find(workset, val);
+	if (slot < workset->len) {
+		if (spilled)
+			workset->vals[slot].spilled = true;
+		return;
 	}
 
 	/* insert val */
@@ -152,6 +200,8 @@ static void workset_insert(workset_t *workset, ir_node *val, bool spilled)
 	loc->node    = val;
 	loc->spilled = spilled;
 	loc->time    = TIME_UNDEFINED;
+	if (workset->slots != NULL)
+		workset->slots[get_irn_idx(val)] = workset->len;
 	workset->len++;
 }
 
@@ -168,22 +218,20 @@ static void workset_clear(workset_t *workset)
  */
 static void workset_remove(workset_t *workset, ir_node *val)
 {
-	for (unsigned i = 0, len = workset->len; i < len; ++i) {
-		if (workset->vals[i].node == val) {
-			workset->vals[i] = workset->vals[--workset->len];
-			return;
-		}
-	}
+	unsigned const slot = workset_find(workset, val);
+	if (slot == workset->len)
+		return;
+
+	loc_t const *const last = &workset->vals[--workset->len];
+	workset->vals[slot] = *last;
+	if (workset->slots != NULL)
+		workset->slots[get_irn_idx(last->node)] = slot;
 }
 
 static const loc_t *workset_contains(const workset_t *ws, const ir_node *val)
 {
-	for (unsigned i = 0, len = ws->len; i < len; ++i) {
-		if (ws->vals[i].node == val)
-			return &ws->vals[i];
-	}
-
-	return NULL;
+	unsigned const slot = workset_find(ws, val);
+	return slot < ws->len ? &ws->vals[slot] : NULL;
 }
 
 static int loc_compare(const void *a, const void *b)
@@ -201,9 +249,46 @@ static int loc_compare(const void *a, const void *b)
 	return get_irn_node_nr(p->node) - get_irn_node_nr(q->node);
 }
 
-static void workset_sort(workset_t *workset)
+static void loc_sift_down(loc_t *const heap, unsigned i, unsigned const len)
 {
-	QSORT(workset->vals, workset->len, loc_compare);
+	for (;;) {
+		unsigned largest = i;
+		unsigned left    = 2 * i + 1;
+		unsigned right   = left + 1;
+		if (left < len && loc_compare(&heap[left], &heap[largest]) > 0)
+			largest = left;
+		if (right < len && loc_compare(&heap[right], &heap[largest]) > 0)
+			largest = right;
+		if (largest == i)
+			return;
+
+		loc_t const tmp = heap[i];
+		heap[i]       = heap[largest];
+		heap[largest] = tmp;
+		i = largest;
+	}
+}
+
+/**
+ * Moves the @p n values with the farthest next use to the end of
+ * @p workset in increasing order, so they are in the same place as after
+ * sorting the whole workset.  The other values are left in heap order.
+ */
+static void workset_select_farthest(workset_t *workset, unsigned n)
+{
+	loc_t   *const vals = workset->vals;
+	unsigned       len  = workset->len;
+	for (unsigned i = len / 2; i-- > 0; ) {
+		loc_sift_down(vals, i, len);
+	}
+	for (unsigned i = 0; i < n; ++i) {
+		--len;
+		loc_t const tmp = vals[0];
+		vals[0]   = vals[len];
+		vals[len] = tmp;
+		loc_sift_down(vals, 0, len);
+	}
+	workset_reindex(workset);
 }
 
 static inline unsigned workset_get_time(const workset_t *workset, unsigned idx)
@@ -342,8 +427,8 @@ static void displace(workset_t *const new_vals, bool const is_usage,
 			workset_set_time(ws, i, dist);
 		}
 
-		/* sort entries by increasing nextuse-distance*/
-		workset_sort(ws);
+		/* move the entries with the farthest next use to the end */
+		workset_select_farthest(ws, spills_needed);
 
 		for (int i = len - spills_needed; i < (int)len; ++i) {
 			ir_node *val = ws->vals[i].node;
@@ -851,12 +936,13 @@ static void be_spill_belady(ir_graph *irg, const arch_register_class_t *rcls,
 	cls          = rcls;
 	lv           = be_get_irg_liveness(irg);
 	n_regs       = be_get_n_allocatable_regs(irg, cls);
-	ws           = new_workset();
+	n_idx        = get_irg_last_idx(irg);
+	ws           = new_indexed_workset();
 	uses         = be_begin_uses(irg, lv);
 	loop_ana     = be_new_loop_pressure(irg, cls);
 	senv         = be_new_spill_env(irg, regif);
 	blocklist    = be_get_cfgpostorder(irg);
-	temp_workset = new_workset();
+	temp_workset = new_indexed_workset();
 	stat_ev_tim_pop("belady_time_init");
 
 	stat_ev_tim_push();
@@ -316,7 +316,7 @@ static void be_spill_daemel(ir_graph *irg, const arch_register_class_t *new_cls,
 
 	irg_block_walk_graph(irg, spill_block, NULL, NULL);
 
-	free(spilled_nodes);
+	xfree(spilled_nodes);
 
 	be_insert_spills_reloads(spill_env);
 	be_delete_spill_env(spill_env);
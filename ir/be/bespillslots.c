@@ -20,6 +20,9 @@
 #include "execfreq.h"
 #include "unionfind.h"
 #include "irdump_t.h"
+#include "iredges_t.h"
+#include "irflag.h"
+#include "pdeq.h"
 
 #include "benode.h"
 #include "besched.h"
@@ -243,26 +246,249 @@ void be_load_needs_frame_entity(be_fec_env_t *env, ir_node *node,
 	merge_spilltypes(spill->web, type);
 }
 
-static int merge_interferences(be_fec_env_t *env, bitset_t** interferences,
-                               int* spillslot_unionfind, int s1, int s2)
+/**
+ * Returns the schedule position of the last user of @p value in @p block, 0
+ * if there is none.  Users of Syncs count like in be_memory_values_interfere(),
+ * which only follows the first Sync user.
+ */
+static sched_timestep_t get_last_user_step(const ir_node *value,
+                                           const ir_node *block)
 {
-	/* merge spillslots and interferences */
-	int res = uf_union(spillslot_unionfind, s1, s2);
-	/* we assume that we always merge s2 to s1 so swap s1, s2 if necessary */
-	if (res != s1) {
-		int t = s1;
+	sched_timestep_t last = 0;
+	foreach_out_edge(value, edge) {
+		const ir_node *const user = get_edge_src_irn(edge);
+		if (is_Sync(user))
+			return MAX(last, get_last_user_step(user, block));
+		if (get_nodes_block(user) == block && !is_Phi(user))
+			last = MAX(last, sched_get_time_step(user));
+	}
+	return last;
+}
+
+/**
+ * Adds the spill @p idx to the spills present in the blocks where its value
+ * may be live.  The blocks are found by walking backwards from the users to
+ * the definition, users of Syncs count as users of their operands.
+ */
+static void add_use_blocks(ir_node *value, ir_node *def_block, unsigned idx,
+                           unsigned **present, ir_node ***blocks, pdeq *todo)
+{
+	foreach_out_edge(value, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		if (is_Anchor(user))
+			continue;
+		if (is_Sync(user))
+			add_use_blocks(user, def_block, idx, present, blocks, todo);
+
+		ir_node *block = get_nodes_block(user);
+		if (is_Phi(user))
+			block = get_Block_cfgpred_block(block, get_edge_src_pos(edge));
+		if (block != NULL && !is_Bad(block))
+			pdeq_putr(todo, block);
+	}
+
+	while (!pdeq_empty(todo)) {
+		ir_node *const block = (ir_node*)pdeq_getl(todo);
+		if (Block_block_visited(block))
+			continue;
+		mark_Block_block_visited(block);
+
+		unsigned const block_idx = get_irn_idx(block);
+		if (present[block_idx] == NULL) {
+			present[block_idx] = NEW_ARR_F(unsigned, 0);
+			ARR_APP1(ir_node*, *blocks, block);
+		}
+		ARR_APP1(unsigned, present[block_idx], idx);
+
+		if (block == def_block)
+			continue;
+		for (int i = 0, n = get_Block_n_cfgpreds(block); i < n; ++i) {
+			ir_node *const pred = get_Block_cfgpred_block(block, i);
+			if (pred != NULL && !is_Bad(pred))
+				pdeq_putr(todo, pred);
+		}
+	}
+}
+
+typedef struct live_range_t {
+	unsigned         spill;
+	bool             defined;  /**< defined in the block, else live-in */
+	sched_timestep_t def;      /**< position of the definition */
+	sched_timestep_t end;      /**< position of the last use in the block */
+} live_range_t;
+
+static int cmp_live_range(const void *d1, const void *d2)
+{
+	const live_range_t *const r1 = (const live_range_t*)d1;
+	const live_range_t *const r2 = (const live_range_t*)d2;
+	if (r1->defined != r2->defined)
+		return r1->defined ? 1 : -1;
+	if (r1->def != r2->def)
+		return r1->def < r2->def ? -1 : 1;
+	return (r1->spill > r2->spill) - (r1->spill < r2->spill);
+}
+
+static void add_interference(unsigned **interferences, unsigned s1, unsigned s2)
+{
+	DB((dbg, LEVEL_1, "Slot %u and %u interfere\n", s1, s2));
+	ARR_APP1(unsigned, interferences[s1], s2);
+	ARR_APP1(unsigned, interferences[s2], s1);
+}
+
+/**
+ * Computes the interferences of the spills present in @p block with a sweep
+ * over the schedule.  A value interferes with a value defined in the block if
+ * it is defined earlier or live-in and used after the definition or live at
+ * the block end.
+ */
+static void sweep_block(const ir_node **values, const be_lv_t *lv, ir_node *block,
+                        const unsigned *present, unsigned **interferences)
+{
+	size_t        const n_present = ARR_LEN(present);
+	live_range_t *const ranges    = XMALLOCN(live_range_t, n_present);
+	size_t              n_defs    = 0;
+	for (size_t i = 0; i < n_present; ++i) {
+		unsigned       const idx   = present[i];
+		const ir_node *const value = values[idx];
+		live_range_t  *const range = &ranges[i];
+		range->spill   = idx;
+		range->defined = get_nodes_block(value) == block;
+		range->def     = range->defined ? sched_get_time_step(value) : 0;
+		if (range->defined)
+			++n_defs;
+	}
+	if (n_defs == 0)
+		goto end;
+
+	for (size_t i = 0; i < n_present; ++i) {
+		live_range_t  *const range = &ranges[i];
+		const ir_node *const value = values[range->spill];
+		if (!range->defined && !block_dominates(get_nodes_block(value), block)) {
+			range->end = 0;
+		} else if (be_is_live_end(lv, block, value)) {
+			range->end = UINT_MAX;
+		} else {
+			range->end = get_last_user_step(value, block);
+		}
+	}
+
+	/* live-in values first, then by definition */
+	QSORT(ranges, n_present, cmp_live_range);
+
+	unsigned *const active   = XMALLOCN(unsigned, n_present);
+	size_t          n_active = 0;
+	size_t          next     = 0;
+	for (size_t d = n_present - n_defs; d < n_present; ++d) {
+		const live_range_t *const def = &ranges[d];
+
+		/* activate the values defined before */
+		for (; next < n_present; ++next) {
+			if (ranges[next].defined && ranges[next].def >= def->def)
+				break;
+			active[n_active++] = (unsigned)next;
+		}
+
+		/* values dead before this definition are dead for all later ones */
+		size_t n_live = 0;
+		for (size_t a = 0; a < n_active; ++a) {
+			const live_range_t *const range = &ranges[active[a]];
+			if (range->end <= def->def)
+				continue;
+			active[n_live++] = active[a];
+			add_interference(interferences, range->spill, def->spill);
+		}
+		n_active = n_live;
+	}
+	xfree(active);
+
+end:
+	xfree(ranges);
+}
+
+/**
+ * Computes the interferences of all spills from their live ranges on the
+ * block schedules instead of testing all pairs.
+ */
+static unsigned **build_interferences(be_fec_env_t *env)
+{
+	spill_t       **spills     = env->spills;
+	size_t          spillcount = ARR_LEN(spills);
+	ir_graph       *irg        = env->irg;
+	const be_lv_t  *lv         = be_get_irg_liveness(irg);
+	unsigned      **present    = XMALLOCNZ(unsigned*, get_irg_last_idx(irg));
+	ir_node       **blocks     = NEW_ARR_F(ir_node*, 0);
+	const ir_node **values     = XMALLOCN(const ir_node*, spillcount);
+	unsigned      **interferences = XMALLOCN(unsigned*, spillcount);
+	pdeq           *todo       = new_pdeq();
+
+	ir_reserve_resources(irg, IR_RESOURCE_BLOCK_VISITED);
+	for (size_t i = 0; i < spillcount; ++i) {
+		interferences[i] = NEW_ARR_F(unsigned, 0);
+		ir_node *const spill = spills[i]->spill;
+		if (is_NoMem(spill)) {
+			values[i] = NULL;
+			continue;
+		}
+		ir_node *const value = (ir_node*)be_get_memory_value_def(spill);
+		values[i] = value;
+
+		inc_irg_block_visited(irg);
+		ir_node *const def_block = get_nodes_block(value);
+		pdeq_putr(todo, def_block);
+		add_use_blocks(value, def_block, (unsigned)i, present, &blocks, todo);
+	}
+	ir_free_resources(irg, IR_RESOURCE_BLOCK_VISITED);
+	del_pdeq(todo);
+
+	for (size_t b = 0, n = ARR_LEN(blocks); b < n; ++b) {
+		ir_node  *const block    = blocks[b];
+		unsigned *const in_block = present[get_irn_idx(block)];
+		sweep_block(values, lv, block, in_block, interferences);
+		DEL_ARR_F(in_block);
+	}
+
+	DEL_ARR_F(blocks);
+	xfree(values);
+	xfree(present);
+	return interferences;
+}
+
+/**
+ * Returns true if a spill of slot @p s1 interferes with a spill of slot
+ * @p s2.
+ */
+static bool slots_interfere(unsigned **interferences, int *spillslot_unionfind,
+                            int s1, int s2)
+{
+	if (ARR_LEN(interferences[s2]) < ARR_LEN(interferences[s1])) {
+		int const t = s1;
 		s1 = s2;
 		s2 = t;
 	}
+	for (size_t i = 0, n = ARR_LEN(interferences[s1]); i < n; ++i) {
+		if (uf_find(spillslot_unionfind, interferences[s1][i]) == s2)
+			return true;
+	}
+	return false;
+}
 
-	bitset_or(interferences[s1], interferences[s2]);
+static int merge_interferences(unsigned **interferences,
+                               int *spillslot_unionfind, int s1, int s2)
+{
+	/* merge spillslots and interferences */
+	int res = uf_union(spillslot_unionfind, s1, s2);
+	int old = res == s1 ? s2 : s1;
 
-	/* update other interferences */
-	for (size_t i = 0, n = ARR_LEN(env->spills); i < n; ++i) {
-		bitset_t *intfs = interferences[i];
-		if (bitset_is_set(intfs, s2))
-			bitset_set(intfs, s1);
+	/* append the smaller list to the larger one */
+	if (ARR_LEN(interferences[res]) < ARR_LEN(interferences[old])) {
+		unsigned *const t = interferences[res];
+		interferences[res] = interferences[old];
+		interferences[old] = t;
+	}
+	for (size_t i = 0, n = ARR_LEN(interferences[old]); i < n; ++i) {
+		ARR_APP1(unsigned, interferences[res], interferences[old][i]);
 	}
+	ARR_SHRINKLEN(interferences[old], 0);
 
 	return res;
 }
@@ -271,7 +497,7 @@ static int merge_interferences(be_fec_env_t *env, bitset_t** interferences,
  * A greedy coalescing algorithm for spillslots:
  *  1. Sort the list of affinity edges
  *  2. Try to merge slots with affinity edges (most expensive slots first)
- *  3. Try to merge everything else that is possible
+ *  3. Assign the remaining slots first fit to the slots not interfering
  */
 static void do_greedy_coalescing(be_fec_env_t *env)
 {
@@ -285,34 +511,11 @@ static void do_greedy_coalescing(be_fec_env_t *env)
 	struct obstack data;
 	obstack_init(&data);
 
-	bitset_t **interferences       = OALLOCN(&data, bitset_t*, spillcount);
-	int       *spillslot_unionfind = OALLOCN(&data, int,       spillcount);
-
+	int *spillslot_unionfind = OALLOCN(&data, int, spillcount);
 	uf_init(spillslot_unionfind, spillcount);
 
-	for (size_t i = 0; i < spillcount; ++i) {
-		interferences[i] = bitset_obstack_alloc(&data, spillcount);
-	}
-
 	/* construct interferences */
-	for (size_t i = 0; i < spillcount; ++i) {
-		ir_node *spill1 = spills[i]->spill;
-		if (is_NoMem(spill1))
-			continue;
-
-		for (size_t i2 = i+1; i2 < spillcount; ++i2) {
-			ir_node *spill2 = spills[i2]->spill;
-			if (is_NoMem(spill2))
-				continue;
-
-			if (be_memory_values_interfere(spill1, spill2)) {
-				DB((dbg, LEVEL_1, "Slot %d and %d interfere\n", i, i2));
-
-				bitset_set(interferences[i], i2);
-				bitset_set(interferences[i2], i);
-			}
-		}
-	}
+	unsigned **interferences = build_interferences(env);
 
 	/* sort affinity edges */
 	QSORT_ARR(env->affinity_edges, cmp_affinity);
@@ -322,60 +525,70 @@ static void do_greedy_coalescing(be_fec_env_t *env)
 		const affinity_edge_t *edge = env->affinity_edges[i];
 		int s1 = uf_find(spillslot_unionfind, edge->slot1);
 		int s2 = uf_find(spillslot_unionfind, edge->slot2);
+		if (s1 == s2)
+			continue;
 
 		/* test if values interfere */
-		if (bitset_is_set(interferences[s1], s2)) {
-			assert(bitset_is_set(interferences[s2], s1));
+		if (slots_interfere(interferences, spillslot_unionfind, s1, s2))
 			continue;
-		}
 
 		DB((dbg, LEVEL_1,
 		    "Merging %d and %d because of affinity edge\n", s1, s2));
 
-		merge_interferences(env, interferences, spillslot_unionfind, s1, s2);
+		merge_interferences(interferences, spillslot_unionfind, s1, s2);
 	}
 
-	/* Try to merge as much remaining spillslots as possible */
+	/* Assign the remaining slots to the first slot not used by an
+	 * interfering slot */
+	int *const color     = OALLOCN(&data, int, spillcount);
+	int *const used      = OALLOCN(&data, int, spillcount);
+	int *const color_rep = OALLOCN(&data, int, spillcount);
+	int        n_colors  = 0;
+	for (size_t i = 0; i < spillcount; ++i) {
+		color[i] = -1;
+		used[i]  = -1;
+	}
 	for (size_t i = 0; i < spillcount; ++i) {
-		int s1 = uf_find(spillslot_unionfind, i);
-		if (s1 != (int)i)
+		if (uf_find(spillslot_unionfind, i) != (int)i)
 			continue;
 
-		for (size_t i2 = i+1; i2 < spillcount; ++i2) {
-			int s2 = uf_find(spillslot_unionfind, i2);
-			if (s2 != (int)i2)
-				continue;
-
-			/* Test if values interfere, we have to test n1-n2 and n2-n1,
-			 * because only 1 side gets updated when node merging occurs */
-			if (bitset_is_set(interferences[s1], s2)) {
-				assert(bitset_is_set(interferences[s2], s1));
-				continue;
-			}
-
-			DB((dbg, LEVEL_1,
-			    "Merging %d and %d because it is possible\n", s1, s2));
-
-			if (merge_interferences(env, interferences, spillslot_unionfind,
-			                        s1, s2) != 0) {
-				/* We can break the loop here, because s2 is the new supernode
-				 * now and we'll test s2 again later anyway */
-				break;
-			}
+		for (size_t n = 0, len = ARR_LEN(interferences[i]); n < len; ++n) {
+			int const other = uf_find(spillslot_unionfind, interferences[i][n]);
+			if (color[other] >= 0)
+				used[color[other]] = (int)i;
 		}
+		int c = 0;
+		while (c < n_colors && used[c] == (int)i)
+			++c;
+		if (c == n_colors)
+			color_rep[n_colors++] = (int)i;
+		color[i] = c;
+	}
+	for (size_t i = 0; i < spillcount; ++i) {
+		if (color[i] < 0)
+			continue;
+		int const rep = uf_find(spillslot_unionfind, color_rep[color[i]]);
+		int const s   = uf_find(spillslot_unionfind, i);
+		if (rep == s)
+			continue;
+		DB((dbg, LEVEL_1, "Merging %d and %d because it is possible\n", rep, s));
+		uf_union(spillslot_unionfind, rep, s);
 	}
 
 	/* Assign spillslots to spills */
 	for (size_t i = 0; i < spillcount; ++i) {
 		spills[i]->spillslot = uf_find(spillslot_unionfind, i);
+		DEL_ARR_F(interferences[i]);
 	}
 
+	xfree(interferences);
 	obstack_free(&data, 0);
 }
 
 typedef struct spill_slot_t {
 	int        size;
 	int        align;
+	double     accesses; /**< execution frequency weighted number of accesses */
 	ir_entity *entity;
 } spill_slot_t;
 
@@ -418,15 +631,58 @@ static memperm_t *get_memperm(be_fec_env_t *env, ir_node *block)
 	return res;
 }
 
-static ir_entity* create_stack_entity(be_fec_env_t *env, spill_slot_t *slot)
+static void create_stack_entity(be_fec_env_t *env, spill_slot_t *slot)
 {
 	ir_graph  *irg   = env->irg;
 	ir_type   *frame = get_irg_frame_type(irg);
 	ir_entity *res   = frame_alloc_area(frame, slot->size, slot->align,
 	                                    env->at_begin);
 	slot->entity = res;
+}
 
-	return res;
+static spill_slot_t *sorted_slots_base;
+
+/** Compare 2 spillslots by their number of accesses (used in quicksort) */
+static int cmp_slot_accesses(const void *d1, const void *d2)
+{
+	int const           id1 = *(const int*)d1;
+	int const           id2 = *(const int*)d2;
+	spill_slot_t const *s1  = &sorted_slots_base[id1];
+	spill_slot_t const *s2  = &sorted_slots_base[id2];
+	if (s1->accesses != s2->accesses)
+		return s1->accesses < s2->accesses ? -1 : 1;
+	return id1 - id2;
+}
+
+/**
+ * Create the stack entities for all used spillslots. The entity created last
+ * ends up next to the register addressing the frame: At the start of the
+ * frame for the stack pointer and at the end for the frame pointer. So the
+ * slots are created in order of increasing accesses, which puts the hottest
+ * slots together near the base register, where they can be reached with
+ * short displacements and share cache lines.
+ */
+static void create_stack_entities(be_fec_env_t *env, spill_slot_t *slots,
+                                  size_t n_slots)
+{
+	int    *order   = ALLOCAN(int, n_slots);
+	size_t  n_order = 0;
+	for (size_t s = 0; s < n_slots; ++s) {
+		if (slots[s].size != 0)
+			order[n_order++] = s;
+	}
+
+	sorted_slots_base = slots;
+	QSORT(order, n_order, cmp_slot_accesses);
+	sorted_slots_base = NULL;
+
+	for (size_t i = 0; i < n_order; ++i)
+		create_stack_entity(env, &slots[order[i]]);
+}
+
+static double get_access_freq(const ir_node *node)
+{
+	return get_block_execfreq(get_nodes_block(node));
 }
 
 /**
@@ -491,7 +747,20 @@ static void assign_spillslots(be_fec_env_t *env)
 		} else {
 			enlarge_spillslot(slot, align, size);
 		}
+
+		/* PhiM and Sync are no accesses, the MemPerms are rare */
+		ir_node *const node = spill->spill;
+		if (!is_Phi(node) && !is_Sync(node) && !is_NoMem(node))
+			slot->accesses += get_access_freq(node);
 	}
+	for (size_t s = 0; s < ARR_LEN(env->reloads); ++s) {
+		ir_node       *reload    = env->reloads[s];
+		ir_node       *spillnode = get_memory_edge(reload);
+		const spill_t *spill     = get_spill(env, spillnode);
+		spillslots[spill->spillslot].accesses += get_access_freq(reload);
+	}
+
+	create_stack_entities(env, spillslots, spillcount);
 
 	for (size_t s = 0; s < spillcount; ++s) {
 		const spill_t *spill  = spills[s];
@@ -499,9 +768,6 @@ static void assign_spillslots(be_fec_env_t *env)
 		int            slotid = spill->spillslot;
 		spill_slot_t  *slot   = &spillslots[slotid];
 
-		if (slot->entity == NULL)
-			create_stack_entity(env, slot);
-
 		if (is_Phi(node)) {
 			ir_node *block = get_nodes_block(node);
 
@@ -517,8 +783,6 @@ static void assign_spillslots(be_fec_env_t *env)
 					memperm_t       *memperm;
 					memperm_entry_t *entry;
 					spill_slot_t    *argslot = &spillslots[argslotid];
-					if (argslot->entity == NULL)
-						create_stack_entity(env, argslot);
 
 					memperm = get_memperm(env, predblock);
 
@@ -628,10 +892,10 @@ void be_free_frame_entity_coalescer(be_fec_env_t *env)
 	DEL_ARR_F(env->reloads);
 	DEL_ARR_F(env->affinity_edges);
 	DEL_ARR_F(env->spills);
-	free(env->spills_set);
+	xfree(env->spills_set);
 	obstack_free(&env->obst, NULL);
 
-	free(env);
+	xfree(env);
 }
 
 void be_forbid_coalescing(be_fec_env_t *env)
@@ -649,7 +913,11 @@ void be_assign_entities(be_fec_env_t *env,
 	if (stat_ev_enabled)
 		stat_ev_dbl("spillslots", ARR_LEN(env->spills));
 
-	if (be_coalesce_spill_slots && !env->coalescing_forbidden)
+	/* the interference check compares all pairs of spills */
+	double const n_spills = ARR_LEN(env->spills);
+	if (be_coalesce_spill_slots && !env->coalescing_forbidden
+	    && ir_complexity_allows(env->irg, "spillslot_coalescing",
+	                            n_spills * n_spills))
 		do_greedy_coalescing(env);
 
 	if (stat_ev_enabled)
@@ -121,7 +121,7 @@ void be_delete_spill_env(spill_env_t *env)
 {
 	ir_nodehashmap_destroy(&env->spillmap);
 	obstack_free(&env->obst, NULL);
-	free(env);
+	xfree(env);
 }
 
 void be_add_spill(spill_env_t *env, ir_node *to_spill, ir_node *after)
@@ -347,6 +347,38 @@ static bool is_value_available(spill_env_t *env, const ir_node *arg)
 	return false;
 }
 
+/**
+ * Tests whether a value in a register class without register allocation (the
+ * flags) is live before @p before.  These values never cross block borders
+ * and die at the next instruction modifying the flags, so looking back to that
+ * instruction is enough.
+ */
+static bool flags_live_before(const ir_node *before)
+{
+	/* a block stands for a phi argument reloaded at the end of the block */
+	if (is_Block(before))
+		before = be_get_end_of_block_insertion_point(before);
+
+	const ir_node *block = get_nodes_block(before);
+	for (ir_node *node = sched_prev(before); !sched_is_begin(node);
+	     node = sched_prev(node)) {
+		be_foreach_value(node, value,
+			const arch_register_req_t *req = arch_get_irn_register_req(value);
+			if (req->cls == NULL || !req->cls->manual_ra)
+				continue;
+			foreach_out_edge(value, edge) {
+				const ir_node *user = get_edge_src_irn(edge);
+				if (get_nodes_block(user) != block || !sched_is_scheduled(user)
+				    || !sched_comes_before(user, before))
+					return true;
+			}
+		);
+		if (arch_irn_is(node, modify_flags))
+			return false;
+	}
+	return false;
+}
+
 /**
  * Check if a node is rematerializable. This tests for the following conditions:
  *
@@ -373,11 +405,8 @@ static int check_remat_conditions_costs(spill_env_t *env,
 	if (parentcosts + costs >= spillcosts)
 		return REMAT_COST_INFINITE;
 
-	/* never rematerialize a node which modifies the flags.
-	 * (would be better to test whether the flags are actually live at point
-	 * reloader...)
-	 */
-	if (arch_irn_is(insn, modify_flags))
+	/* never rematerialize a node which destroys live flags */
+	if (arch_irn_is(insn, modify_flags) && flags_live_before(reloader))
 		return REMAT_COST_INFINITE;
 
 	int argremats = 0;
@@ -539,6 +568,9 @@ void be_insert_spills_reloads(spill_env_t *env)
 {
 	be_timer_push(T_RA_SPILL_APPLY);
 
+	be_lv_t  *const lv       = be_get_irg_liveness(env->irg);
+	unsigned  const last_idx = get_irg_last_idx(env->irg);
+
 	/* create all phi-ms first, this is needed so, that phis, hanging on
 	   spilled phis work correctly */
 	for (spill_info_t *info = env->mem_phis; info != NULL;
@@ -546,6 +578,10 @@ void be_insert_spills_reloads(spill_env_t *env)
 		spill_node(env, info);
 	}
 
+	/* one SSA construction environment serves all spilled values */
+	be_ssa_construction_env_t senv;
+	be_ssa_construction_init(&senv, env->irg);
+
 	/* process each spilled node */
 	for (spill_info_t *si = env->spills; si != NULL; si = si->next) {
 		ir_node  *to_spill        = si->to_spill;
@@ -631,17 +667,13 @@ void be_insert_spills_reloads(spill_env_t *env)
 		/* if we had any reloads or remats, then we need to reconstruct the
 		 * SSA form for the spilled value */
 		if (ARR_LEN(copies) > 0) {
-			be_ssa_construction_env_t senv;
-			be_ssa_construction_init(&senv, env->irg);
 			be_ssa_construction_add_copy(&senv, to_spill);
 			be_ssa_construction_add_copies(&senv, copies, ARR_LEN(copies));
 			be_ssa_construction_fix_users(&senv, to_spill);
-			be_ssa_construction_destroy(&senv);
+			be_ssa_construction_reset(&senv);
 		}
 		/* need to reconstruct SSA form if we had multiple spills */
 		if (si->spills != NULL && si->spills->next != NULL) {
-			be_ssa_construction_env_t senv;
-			be_ssa_construction_init(&senv, env->irg);
 			unsigned spill_count = 0;
 			for (spill_t *spill = si->spills ; spill != NULL;
 			     spill = spill->next) {
@@ -656,21 +688,28 @@ void be_insert_spills_reloads(spill_env_t *env)
 				be_ssa_construction_fix_users(&senv, si->spills->spill);
 			}
 
-			be_ssa_construction_destroy(&senv);
+			be_ssa_construction_reset(&senv);
 		}
 
 		DEL_ARR_F(copies);
 		si->reloaders = NULL;
 	}
+	be_ssa_construction_destroy(&senv);
 
 	stat_ev_dbl("spill_spills", env->spill_count);
 	stat_ev_dbl("spill_reloads", env->reload_count);
 	stat_ev_dbl("spill_remats", env->remat_count);
 	stat_ev_dbl("spill_spilled_phis", env->spilled_phi_count);
 
-	/* Matze: In theory be_ssa_construction should take care of the liveness...
-	 * try to disable this again in the future */
-	be_invalidate_live_sets(env->irg);
+	/* Only the spilled values, the new nodes and their operands changed, so
+	 * update their liveness instead of recomputing everything. */
+	if (lv->sets_valid) {
+		for (spill_info_t *si = env->spills; si != NULL; si = si->next)
+			be_liveness_mark(lv, si->to_spill);
+		for (spill_info_t *si = env->mem_phis; si != NULL; si = si->next_mem_phi)
+			be_liveness_mark(lv, si->to_spill);
+		be_liveness_mark_new_nodes(lv, last_idx);
+	}
 
 	be_remove_dead_nodes_from_schedule(env->irg);
 
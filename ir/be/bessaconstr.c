@@ -21,6 +21,12 @@
  * of the dominance frontier, create a phi and do the same search for all
  * phi arguments.
  *
+ * The iterated dominance frontier of a set of blocks is the union of the
+ * iterated dominance frontiers (merge sets) of its members.  The merge sets
+ * are computed on demand and kept for the lifetime of the environment, so a
+ * caller reconstructing many values with one environment (see
+ * be_ssa_construction_reset()) computes each of them only once.
+ *
  * A copy in this context means, that you want to introduce several new
  * abstract values (in Firm: nodes) for which you know, that they
  * represent the same concrete value. This is the case if you
@@ -45,6 +51,7 @@
 
 #include "debug.h"
 #include "array.h"
+#include "raw_bitset.h"
 #include "irdom.h"
 #include "ircons.h"
 #include "iredges_t.h"
@@ -56,6 +63,8 @@ static ir_node *search_def_end_of_block(be_ssa_construction_env_t *env,
                                         ir_node *block);
 
 struct constr_info {
+	/** The reconstruction this info belongs to, stale infos are ignored. */
+	unsigned epoch;
 	bool is_definition     : 1;
 	bool is_use            : 1;
 	bool already_processed : 1;
@@ -67,6 +76,9 @@ struct constr_info {
 		/** Last definition of a block. */
 		ir_node *last_definition;
 	} u;
+	/** NULL terminated iterated dominance frontier of a block, kept across
+	 * reconstructions. */
+	ir_node **merge_set;
 };
 
 typedef struct constr_info constr_info;
@@ -85,7 +97,13 @@ static constr_info *get_or_set_info(be_ssa_construction_env_t *env,
 	constr_info *info = ir_nodemap_get(constr_info, &env->infos, node);
 	if (info == NULL) {
 		info = OALLOCZ(&env->obst, constr_info);
+		info->epoch = env->epoch;
 		ir_nodemap_insert(&env->infos, node, info);
+	} else if (info->epoch != env->epoch) {
+		ir_node **const merge_set = info->merge_set;
+		memset(info, 0, sizeof(*info));
+		info->epoch     = env->epoch;
+		info->merge_set = merge_set;
 	}
 	return info;
 }
@@ -93,7 +111,8 @@ static constr_info *get_or_set_info(be_ssa_construction_env_t *env,
 static constr_info *get_info(const be_ssa_construction_env_t *env,
                              const ir_node *node)
 {
-	return ir_nodemap_get(constr_info, &env->infos, node);
+	constr_info *const info = ir_nodemap_get(constr_info, &env->infos, node);
+	return info != NULL && info->epoch == env->epoch ? info : NULL;
 }
 
 /**
@@ -156,29 +175,71 @@ static void introduce_use(be_ssa_construction_env_t *env, ir_node *use)
 	pdeq_putr(env->worklist, use);
 }
 
+/**
+ * Returns the iterated dominance frontier of the single block @p block.
+ */
+static ir_node **get_merge_set(be_ssa_construction_env_t *env, ir_node *block)
+{
+	constr_info *const block_info = get_or_set_info(env, block);
+	if (block_info->merge_set != NULL)
+		return block_info->merge_set;
+
+	if (env->merge_marks == NULL) {
+		ir_node *const start_block = get_irg_start_block(env->irg);
+		unsigned const n_blocks
+			= get_Block_dom_max_subtree_pre_num(start_block) + 1;
+		env->merge_marks = rbitset_obstack_alloc(&env->obst, n_blocks);
+	}
+
+	/* the worklist of the environment is in use, so the merge set itself
+	 * serves as worklist */
+	ir_node **merge_set = NEW_ARR_F(ir_node*, 0);
+	ir_node  *x         = block;
+	for (size_t next = 0;; ++next) {
+		ir_node **const domfront = ir_get_dominance_frontier(x);
+		for (size_t i = 0, len = ARR_LEN(domfront); i < len; ++i) {
+			ir_node *const y   = domfront[i];
+			unsigned const idx = get_Block_dom_tree_pre_num(y);
+			if (rbitset_is_set(env->merge_marks, idx))
+				continue;
+			rbitset_set(env->merge_marks, idx);
+			ARR_APP1(ir_node*, merge_set, y);
+		}
+		if (next == ARR_LEN(merge_set))
+			break;
+		x = merge_set[next];
+	}
+
+	size_t    const len    = ARR_LEN(merge_set);
+	ir_node **const result = OALLOCN(&env->obst, ir_node*, len + 1);
+	for (size_t i = 0; i < len; ++i) {
+		result[i] = merge_set[i];
+		rbitset_clear(env->merge_marks, get_Block_dom_tree_pre_num(result[i]));
+	}
+	result[len] = NULL;
+	DEL_ARR_F(merge_set);
+
+	block_info->merge_set = result;
+	return result;
+}
+
 /**
  * Calculates the iterated dominance frontier of a set of blocks. Marks the
  * blocks as visited.
  */
-static void mark_iterated_dominance_frontiers(
-                                           const be_ssa_construction_env_t *env)
+static void mark_iterated_dominance_frontiers(be_ssa_construction_env_t *env)
 {
 	stat_ev_cnt_decl(blocks);
 	DBG((dbg, LEVEL_3, "Dominance Frontier:"));
 	stat_ev_tim_push();
 	while (!pdeq_empty(env->worklist)) {
-		ir_node  *block    = (ir_node*)pdeq_getl(env->worklist);
-		ir_node **domfront = ir_get_dominance_frontier(block);
-		for (size_t i = 0, len = ARR_LEN(domfront); i < len; ++i) {
-			ir_node *y = domfront[i];
-			if (Block_block_visited(y))
+		ir_node *const block = (ir_node*)pdeq_getl(env->worklist);
+		for (ir_node **y = get_merge_set(env, block); *y != NULL; ++y) {
+			if (Block_block_visited(*y))
 				continue;
 
-			if (!irn_visited(y))
-				pdeq_putr(env->worklist, y);
-
-			DBG((dbg, LEVEL_3, " %+F", y));
-			mark_Block_block_visited(y);
+			DBG((dbg, LEVEL_3, " %+F", *y));
+			mark_Block_block_visited(*y);
 			stat_ev_cnt_inc(blocks);
 		}
 	}
@@ -358,6 +419,7 @@ void be_ssa_construction_init(be_ssa_construction_env_t *env, ir_graph *irg)
 
 	memset(env, 0, sizeof(env[0]));
 	env->irg       = irg;
+	env->epoch     = 1;
 	env->new_phis  = NEW_ARR_F(ir_node*, 0);
 	env->worklist  = new_pdeq();
 	ir_nodemap_init(&env->infos, irg);
@@ -377,6 +439,21 @@ void be_ssa_construction_init(be_ssa_construction_env_t *env, ir_graph *irg)
 	inc_irg_block_visited(irg);
 }
 
+void be_ssa_construction_reset(be_ssa_construction_env_t *env)
+{
+	assert(pdeq_empty(env->worklist));
+	stat_ev_int("bessaconstr_phis", ARR_LEN(env->new_phis));
+
+	env->mode    = NULL;
+	env->phi_req = NULL;
+	env->iterated_domfront_calculated = false;
+	ARR_SHRINKLEN(env->new_phis, 0);
+	++env->epoch;
+
+	inc_irg_visited(env->irg);
+	inc_irg_block_visited(env->irg);
+}
+
 void be_ssa_construction_destroy(be_ssa_construction_env_t *env)
 {
 	stat_ev_int("bessaconstr_phis", ARR_LEN(env->new_phis));
@@ -48,6 +48,8 @@ typedef struct be_ssa_construction_env_t {
 	pdeq                        *worklist;
 	ir_node                    **new_phis;
 	bool                         iterated_domfront_calculated;
+	unsigned                     epoch;
+	unsigned                    *merge_marks;
 	ir_nodemap                   infos;
 	struct obstack               obst;
 } be_ssa_construction_env_t;
@@ -84,6 +86,16 @@ void be_ssa_construction_update_liveness_phis(be_ssa_construction_env_t *env,
 
 ir_node **be_ssa_construction_get_new_phis(be_ssa_construction_env_t *env);
 
+/**
+ * Prepares an SSA construction environment for another value.
+ *
+ * Reusing one environment for many values avoids setting it up again and
+ * keeps the dominance frontier information computed so far.  The phis
+ * returned by be_ssa_construction_get_new_phis() are forgotten.  The caller
+ * must not use the visited flags in between.
+ */
+void be_ssa_construction_reset(be_ssa_construction_env_t *env);
+
 /**
  * Destroys an SSA construction environment.
  */
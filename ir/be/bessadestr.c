@@ -12,10 +12,11 @@
 #include "bessadestr.h"
 
 #include "debug.h"
-#include "bitset.h"
 #include "irnode_t.h"
 #include "irgwalk.h"
 #include "irgmod.h"
+#include "iredges_t.h"
+#include "raw_bitset.h"
 #include "be_types.h"
 #include "bearch.h"
 #include "beirg.h"
@@ -27,6 +28,56 @@
 
 DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
 
+/**
+ * Returns a register of class @p cls which holds no value at the end of
+ * @p block and is not in @p involved, or NULL if there is none.
+ */
+static arch_register_t const *find_free_register(
+		arch_register_class_t const *const cls, ir_node *const block,
+		ir_node *const before, unsigned const *const involved)
+{
+	/* Copies for another successor could occupy registers, which the live
+	 * sets do not know about. */
+	unsigned n_succs = 0;
+	foreach_block_succ(block, edge) {
+		++n_succs;
+	}
+	if (n_succs != 1)
+		return NULL;
+
+	ir_graph       *const irg    = get_irn_irg(block);
+	unsigned const        n_regs = cls->n_regs;
+	unsigned       *const used   = rbitset_alloca(n_regs);
+	rbitset_copy(used, involved, n_regs);
+
+	be_lv_t *const lv = be_get_irg_liveness(irg);
+	be_lv_foreach_cls(lv, block, be_lv_state_end, cls, live) {
+		rbitset_set(used, arch_get_irn_register(live)->index);
+	}
+	/* the control flow nodes at the end of the block use registers, too */
+	for (ir_node *node = before; !is_Block(node); node = sched_next(node)) {
+		be_foreach_value(node, value,
+			arch_register_t const *const reg = arch_get_irn_register(value);
+			if (reg != NULL && reg->cls == cls)
+				rbitset_set(used, reg->index);
+		);
+		foreach_irn_in(node, i, in) {
+			arch_register_t const *const reg = arch_get_irn_register(in);
+			if (reg != NULL && reg->cls == cls)
+				rbitset_set(used, reg->index);
+		}
+	}
+
+	unsigned const *const allocatable = be_birg_from_irg(irg)->allocatable_regs;
+	for (unsigned r = 0; r < n_regs; ++r) {
+		arch_register_t const *const reg = arch_register_for_index(cls, r);
+		if (!rbitset_is_set(used, r)
+		 && rbitset_is_set(allocatable, reg->global_index))
+			return reg;
+	}
+	return NULL;
+}
+
 /* We represent a parallel copy/register transfer graph as follows.  As usual,
  * nodes are registers and edges are move operations.
  * - We exploit the fact that each node has at most one incoming edge and
@@ -34,124 +85,133 @@ DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
  *   *source* node of n.
  * - We mark nodes that do not have an incoming edge with parcopy[n] == n_regs.
  * - Self-loops are explicitely represented as parcopy[n] == n.
- * - Additionally, we maintain a second array n_used where n_used[n] gives us
- *   the number of *outgoing* edges of node n.
+ *
+ * The parallel copy is sequentialized as described in "Revisiting
+ * Out-of-SSA Translation for Correctness, Code Quality, and Efficiency" by
+ * Boissinot et al.: A register whose value is not needed anymore is written
+ * right away. After a value has been copied, the copy serves as source for
+ * the remaining uses, which frees the original register. Only cycles remain,
+ * which are broken with a free register or implemented by a Perm node, which
+ * is lowered to swaps later.
  */
 static void impl_parcopy(const arch_register_class_t *cls,
-                         ir_node *before, unsigned *parcopy, unsigned *n_used,
+                         ir_node *before, unsigned *parcopy,
                          ir_node **phis, ir_node **phi_args, unsigned pred_nr)
 {
-	ir_node        *block        = get_nodes_block(before);
-	ir_graph       *irg          = get_irn_irg(block);
-	be_lv_t        *lv           = be_get_irg_liveness(irg);
-	const unsigned  n_regs       = cls->n_regs;
-	unsigned        num_restores = 0;
-	unsigned        restore_srcs[n_regs];
-	unsigned        restore_dsts[n_regs];
-
-	/* Step 1: Search register transfer graph for nodes with > 1 outgoing edge.
-	 * Goal: Establish invariant that each node has <= 1 outgoing edges by
-	 *       recording restore copies (and inserting them later). */
-	for (unsigned to_reg = 0; to_reg < n_regs; ++to_reg) {
-		const unsigned from_reg    = parcopy[to_reg];
-		unsigned       from_n_used = n_used[from_reg];
-
-		if (from_reg == n_regs)
-			continue;
-
-		/* Decide if the current edge should be kept or not.
-		 * We keep an edge if it is a self-loop or if it is the last outgoing
-		 * edge of a node with multiple outgoing edges.
-		 * TODO: More clever heuristics which edge to keep? */
-		if (from_reg == to_reg || from_n_used == 1) {
-			/* Keep from_reg -> to_reg and cut every other edge. */
-
-			for (unsigned dst = 0; dst < n_regs; ++dst) {
-				if (dst != to_reg && parcopy[dst] == from_reg) {
-					/* Note: As we insert restore copies *after* the Perm node,
-					 * we record to_reg as the source of the copy. */
-					restore_srcs[num_restores] = to_reg;
-					restore_dsts[num_restores] = dst;
-					++num_restores;
-
-					/* Mark as done. */
-					parcopy[dst] = n_regs;
-					if (dst > to_reg) {
-						--from_n_used;
-					}
-				}
-			}
+	ir_node        *block     = get_nodes_block(before);
+	const unsigned  n_regs    = cls->n_regs;
+	unsigned        n_ready   = 0;
+	unsigned        n_copies  = 0;
+	unsigned        n_swaps   = 0;
+	unsigned        ready[n_regs];
+	/* location of the value originally in a register */
+	ir_node        *loc[n_regs];
+	/* registers which are read or written by the parallel copy */
+	unsigned       *involved  = rbitset_alloca(n_regs);
+	/* registers whose original value is not needed anymore */
+	unsigned       *freed     = rbitset_alloca(n_regs);
+	/* registers whose original value is read by the parallel copy */
+	unsigned       *read      = rbitset_alloca(n_regs);
 
-			assert(from_n_used == 1);
-			n_used[from_reg] = 1;
-		} else {
-			--n_used[from_reg];
-		}
-	}
-
-#ifndef NDEBUG
-	/* Check invariant. */
 	for (unsigned dst = 0; dst < n_regs; ++dst) {
+		loc[dst] = phi_args[dst];
 		const unsigned src = parcopy[dst];
-		assert(src == n_regs || n_used[src] == 1);
+		if (src != n_regs) {
+			rbitset_set(involved, dst);
+			rbitset_set(involved, src);
+			if (src != dst)
+				rbitset_set(read, src);
+		}
 	}
-#endif
-
-	/* Step 2: Build Perm node and Proj node(s). */
-	unsigned  perm_size = 0;
-	ir_node  *perm_ins[n_regs];
+	/* Destinations whose value is not read can be written immediately. */
 	for (unsigned dst = 0; dst < n_regs; ++dst) {
 		const unsigned src = parcopy[dst];
-		if (src != n_regs && src != dst) {
-			assert(phi_args[src] != NULL);
-			perm_ins[perm_size++] = phi_args[src];
-		}
+		if (src == n_regs || src == dst || rbitset_is_set(read, dst))
+			continue;
+		rbitset_set(freed, dst);
+		ready[n_ready++] = dst;
 	}
 
-	if (perm_size > 0) {
-		ir_node *perm = be_new_Perm(cls, block, perm_size, perm_ins);
-		sched_add_before(before, perm);
-
-		unsigned i = 0;
-		for (unsigned dst = 0; dst < n_regs; ++dst) {
+	for (;;) {
+		while (n_ready > 0) {
+			const unsigned dst = ready[--n_ready];
 			const unsigned src = parcopy[dst];
-			if (src == n_regs || src == dst)
-				continue;
 
 			arch_register_t const *const reg  = arch_register_for_index(cls, dst);
-			ir_node               *const proj = be_new_Proj_reg(perm, i, reg);
-
-			ir_node *phi = phis[dst];
-			set_irn_n(phi, pred_nr, proj);
-			phi_args[dst] = proj;
-
-			if (lv->sets_valid) {
-				be_liveness_introduce(lv, proj);
-				be_liveness_update(lv, perm_ins[i]);
+			ir_node               *const copy = be_new_Copy_before_reg(loc[src], before, reg);
+			DB((dbg, LEVEL_2, "%+F: copy %+F to %s\n", block, loc[src], reg->name));
+			set_irn_n(phis[dst], pred_nr, copy);
+			parcopy[dst] = n_regs;
+			++n_copies;
+
+			/* Use the copy for the remaining uses of the value, so the
+			 * original register can be overwritten. */
+			loc[src] = copy;
+			if (parcopy[src] != n_regs && parcopy[src] != src
+			 && !rbitset_is_set(freed, src)) {
+				rbitset_set(freed, src);
+				ready[n_ready++] = src;
 			}
-
-			++i;
 		}
+
+		/* Only cycles are left. */
+		unsigned dst = 0;
+		while (dst < n_regs && (parcopy[dst] == n_regs || parcopy[dst] == dst))
+			++dst;
+		if (dst == n_regs)
+			return;
+
+		arch_register_t const *const free_reg
+			= find_free_register(cls, block, before, involved);
+		if (free_reg == NULL)
+			break;
+
+		/* Break the cycle by moving one value into the free register. */
+		ir_node *const save = be_new_Copy_before_reg(loc[dst], before, free_reg);
+		DB((dbg, LEVEL_2, "%+F: save %+F in %s\n", block, loc[dst], free_reg->name));
+		loc[dst] = save;
+		rbitset_set(freed, dst);
+		ready[n_ready++] = dst;
+		++n_copies;
 	}
 
-	/* Step 3: Place restore copies. */
-	for (unsigned i = 0; i < num_restores; ++i) {
-		const unsigned  src_reg = restore_srcs[i];
-		const unsigned  dst_reg = restore_dsts[i];
+	/* Implement the remaining cycles with a Perm. */
+	unsigned  perm_size = 0;
+	ir_node  *perm_ins[n_regs];
+	for (unsigned dst = 0; dst < n_regs; ++dst) {
+		const unsigned src = parcopy[dst];
+		if (src != n_regs && src != dst) {
+			assert(loc[src] == phi_args[src]);
+			perm_ins[perm_size++] = loc[src];
+
+			/* A cycle of length n needs n-1 swaps, count each cycle at its
+			 * smallest register. */
+			unsigned r = src;
+			while (r > dst)
+				r = parcopy[r];
+			if (r != dst)
+				++n_swaps;
+		}
+	}
 
-		ir_node               *const src  = phi_args[src_reg];
-		arch_register_t const *const reg  = arch_register_for_index(cls, dst_reg);
-		ir_node               *const copy = be_new_Copy_before_reg(src, before, reg);
+	ir_node *perm = be_new_Perm(cls, block, perm_size, perm_ins);
+	sched_add_before(before, perm);
 
-		ir_node *phi = phis[dst_reg];
-		set_irn_n(phi, pred_nr, copy);
-		phi_args[src_reg] = copy;
+	unsigned i = 0;
+	for (unsigned dst = 0; dst < n_regs; ++dst) {
+		const unsigned src = parcopy[dst];
+		if (src == n_regs || src == dst)
+			continue;
 
-		if (lv->sets_valid) {
-			be_liveness_introduce(lv, copy);
-			be_liveness_update(lv, src);
-		}
+		arch_register_t const *const reg  = arch_register_for_index(cls, dst);
+		ir_node               *const proj = be_new_Proj_reg(perm, i, reg);
+		set_irn_n(phis[dst], pred_nr, proj);
+		++i;
 	}
+
+	DB((dbg, LEVEL_1, "%+F: parallel copy with %u copies and %u swaps\n", block, n_copies, n_swaps));
+	stat_ev_int("bessadestr_copies", n_copies);
+	stat_ev_int("bessadestr_swaps",  n_swaps);
 }
 
 static void insert_shuffle_code_walker(ir_node *block, void *data)
@@ -166,12 +226,9 @@ static void insert_shuffle_code_walker(ir_node *block, void *data)
 
 	for (int pred_nr = 0; pred_nr < get_irn_arity(block); ++pred_nr) {
 		unsigned  parcopy [n_regs];
-		unsigned  n_used  [n_regs];
 		ir_node  *phis    [n_regs];
 		ir_node  *phi_args[n_regs];
-		bitset_t *keep_val = bitset_alloca(n_regs);
 
-		memset(n_used,   0, n_regs * sizeof(n_used[0]));
 		memset(phis,     0, n_regs * sizeof(phis[0]));
 		memset(phi_args, 0, n_regs * sizeof(phi_args[0]));
 		for (unsigned i = 0; i < n_regs; ++i) {
@@ -189,7 +246,6 @@ static void insert_shuffle_code_walker(ir_node *block, void *data)
 
 			assert(parcopy[phi_reg_idx] == n_regs);
 			parcopy[phi_reg_idx] = arg_reg_idx;
-			++n_used[arg_reg_idx];
 
 			if (phi_reg_idx != arg_reg_idx)
 				need_perm = true;
@@ -197,13 +253,10 @@ static void insert_shuffle_code_walker(ir_node *block, void *data)
 			/* If arg is live, we must keep it in its current register.
 			 * This is done by adding a self-loop to the register transfer
 			 * graph.
-			 * Because we may see the same arg multiple times, we use a bitset
-			 * instead of directly incrementing n_used.
 			 */
 			if (be_is_live_in(lv, block, arg)) {
 				assert(parcopy[arg_reg_idx] == n_regs || parcopy[arg_reg_idx] == arg_reg_idx);
 				parcopy[arg_reg_idx] = arg_reg_idx;
-				bitset_set(keep_val, arg_reg_idx);
 			}
 
 			assert(phis[phi_reg_idx] == NULL);
@@ -213,12 +266,15 @@ static void insert_shuffle_code_walker(ir_node *block, void *data)
 		}
 
 		if (need_perm) {
-			for (unsigned i = 0; i < n_regs; ++i)
-				n_used[i] += bitset_is_set(keep_val, i);
+			/* the arguments are not used at the end of pred anymore */
+			for (unsigned i = 0; i < n_regs; ++i) {
+				if (phi_args[i] != NULL)
+					be_liveness_mark(lv, phi_args[i]);
+			}
 
 			ir_node *pred   = get_Block_cfgpred_block(block, pred_nr);
 			ir_node *before = be_get_end_of_block_insertion_point(pred);
-			impl_parcopy(cls, before, parcopy, n_used, phis, phi_args, pred_nr);
+			impl_parcopy(cls, before, parcopy, phis, phi_args, pred_nr);
 		}
 	}
 }
@@ -227,11 +283,16 @@ void be_ssa_destruction(ir_graph *irg, const arch_register_class_t *cls)
 {
 	FIRM_DBG_REGISTER(dbg, "ir.be.ssadestr");
 
-	be_invalidate_live_sets(irg);
-	be_assure_live_chk(irg);
+	/* The live sets describe the graph before the parallel copies are
+	 * inserted, which is what finding free registers needs. They are updated
+	 * afterwards. */
+	be_assure_live_sets(irg);
+	assure_edges(irg);
 
+	unsigned const last_idx = get_irg_last_idx(irg);
 	irg_block_walk_graph(irg, insert_shuffle_code_walker, NULL, (void*)cls);
 
-	/* unfortunately updating doesn't work yet. */
-	be_invalidate_live_chk(irg);
+	be_lv_t *const lv = be_get_irg_liveness(irg);
+	be_liveness_mark_new_nodes(lv, last_idx);
+	be_liveness_update_marked(lv);
 }
@@ -16,12 +16,16 @@
  *    and the spills.
  */
 #include "bestack.h"
+#include "be_t.h"
+#include "bearch.h"
 #include "beirg.h"
 #include "besched.h"
 #include "benode.h"
 #include "bessaconstr.h"
 
+#include "execfreq.h"
 #include "ircons_t.h"
+#include "irdom.h"
 #include "iredges_t.h"
 #include "irnode_t.h"
 #include "irgwalk.h"
@@ -178,6 +182,166 @@ void be_abi_fix_stack_bias(ir_graph *irg, get_sp_bias_func get_sp_bias,
 	ir_free_resources(irg, IR_RESOURCE_BLOCK_VISITED);
 }
 
+typedef struct frame_use_env_t {
+	arch_register_t const *sp;
+	get_frame_entity_func  get_frame_entity;
+	ir_type               *frame_type;
+	bool                   sp_relative;
+	ir_node               *block;    /**< common dominator of all users */
+} frame_use_env_t;
+
+static bool is_sp(frame_use_env_t const *const env, ir_node const *const value)
+{
+	return get_irn_mode(value) != mode_T
+	    && arch_get_irn_register(value) == env->sp;
+}
+
+/**
+ * Check whether @p node only works after the prologue ran: It touches a frame
+ * entity or the stack pointer.  Accesses to incoming stack arguments are fine
+ * before the prologue if they are relative to the stack pointer, as the bias
+ * is tracked per block.  Control flow leaving the function reads the stack
+ * pointer, too, but without a frame it simply does not need an epilogue.
+ */
+static bool needs_frame(frame_use_env_t const *const env, ir_node *const node)
+{
+	if (is_Phi(node) || be_is_Keep(node) || is_cfop(node))
+		return false;
+	if (be_is_Asm(node))
+		return true;
+
+	ir_entity const *const entity = env->get_frame_entity(node);
+	if (entity != NULL)
+		return !env->sp_relative || get_entity_owner(entity) == env->frame_type;
+
+	foreach_irn_in(node, i, in) {
+		if (is_sp(env, in))
+			return true;
+	}
+	be_foreach_value(node, value,
+		if (is_sp(env, value))
+			return true;
+	);
+	return false;
+}
+
+static void find_frame_users(ir_node *const block, void *const data)
+{
+	frame_use_env_t *const env   = (frame_use_env_t*)data;
+	ir_node         *const start = get_irg_start(get_irn_irg(block));
+	sched_foreach(block, node) {
+		if (node == start || !needs_frame(env, node))
+			continue;
+		env->block = env->block == NULL ? block
+		           : ir_deepest_common_dominator(env->block, block);
+		return;
+	}
+}
+
+/**
+ * Check whether the frame can be set up at the begin of @p block: The stack
+ * bias is tracked per block, so no block reachable from @p block may be
+ * entered from outside the region dominated by it.  This also rules out
+ * re-entering @p block itself.
+ */
+static bool is_single_entry_region(ir_node *const block)
+{
+	ir_graph *const irg       = get_irn_irg(block);
+	ir_node  *const end_block = get_irg_end_block(irg);
+	ir_node       **worklist  = NEW_ARR_F(ir_node*, 0);
+	bool            ok        = true;
+
+	inc_irg_block_visited(irg);
+	mark_Block_block_visited(block);
+	ARR_APP1(ir_node*, worklist, block);
+	while (ok && ARR_LEN(worklist) > 0) {
+		size_t   const n  = ARR_LEN(worklist) - 1;
+		ir_node *const bl = worklist[n];
+		ARR_SHRINKLEN(worklist, n);
+		foreach_block_succ(bl, edge) {
+			ir_node *const succ = get_edge_src_irn(edge);
+			if (succ == end_block)
+				continue;
+			if (succ == block || !block_dominates(block, succ)) {
+				ok = false;
+				break;
+			}
+			if (!Block_block_visited(succ)) {
+				mark_Block_block_visited(succ);
+				ARR_APP1(ir_node*, worklist, succ);
+			}
+		}
+	}
+	DEL_ARR_F(worklist);
+	return ok;
+}
+
+ir_node *be_get_prologue_point(ir_graph *const irg,
+                               arch_register_t const *const sp,
+                               get_frame_entity_func get_frame_entity)
+{
+	ir_node *const start       = get_irg_start(irg);
+	ir_node *const start_block = get_nodes_block(start);
+	if (!be_options.shrink_wrap)
+		return start;
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+
+	be_stack_layout_t const *const layout = be_get_irg_stack_layout(irg);
+	frame_use_env_t env = {
+		.sp               = sp,
+		.get_frame_entity = get_frame_entity,
+		.frame_type       = get_irg_frame_type(irg),
+		.sp_relative      = layout->sp_relative,
+		.block            = NULL,
+	};
+	irg_block_walk_graph(irg, NULL, find_frame_users, &env);
+
+	/* a function never needing the frame keeps its prologue; it is cheap and
+	 * debuggers expect it */
+	ir_node *block = env.block;
+	if (block == NULL)
+		return start;
+
+	ir_reserve_resources(irg, IR_RESOURCE_BLOCK_VISITED);
+	while (block != start_block && !is_single_entry_region(block))
+		block = get_Block_idom(block);
+	ir_free_resources(irg, IR_RESOURCE_BLOCK_VISITED);
+
+	if (block == start_block
+	 || get_block_execfreq(block) >= get_block_execfreq(start_block))
+		return start;
+
+	/* the prologue goes behind the Phis */
+	ir_node *point = block;
+	sched_foreach_phi(block, phi) {
+		point = phi;
+	}
+	return point;
+}
+
+void be_reroute_behind_prologue(ir_node *const old, ir_node *const nw,
+                                ir_node *const exception,
+                                ir_node *const prologue_block)
+{
+	if (prologue_block == get_irg_start_block(get_irn_irg(old))) {
+		edges_reroute_except(old, nw, exception);
+		return;
+	}
+
+	foreach_out_edge_safe(old, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		if (user == exception || is_End(user) || is_Anchor(user))
+			continue;
+		int      const pos   = get_edge_src_pos(edge);
+		ir_node *const block = is_Phi(user)
+			? get_Block_cfgpred_block(get_nodes_block(user), pos)
+			: get_nodes_block(user);
+		if (block_dominates(prologue_block, block))
+			set_irn_n(user, pos, nw);
+	}
+}
+
 typedef struct fix_stack_walker_env_t {
 	const arch_register_t *sp;
 	ir_node              **sp_nodes;
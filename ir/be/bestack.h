@@ -49,6 +49,27 @@ void be_abi_fix_stack_bias(ir_graph *irg, get_sp_bias_func get_sp_bias,
                            set_frame_offset_func set_frame_offset,
                            get_frame_entity_func get_frame_entity);
 
+/**
+ * Determine where the prologue setting up the stack frame goes.
+ *
+ * Without shrink-wrapping this is right behind the Start node.  Otherwise the
+ * prologue moves into the block dominating all nodes which need the frame
+ * (see @p get_frame_entity and @p sp), if that block runs less often than the
+ * start block and the region dominated by it is entered through that block
+ * only.  Returns outside of this region need no epilogue.
+ *
+ * @return the node the prologue is scheduled after
+ */
+ir_node *be_get_prologue_point(ir_graph *irg, arch_register_t const *sp,
+                               get_frame_entity_func get_frame_entity);
+
+/**
+ * Like edges_reroute_except(), but only reroutes users running after the
+ * prologue placed in @p prologue_block.
+ */
+void be_reroute_behind_prologue(ir_node *old, ir_node *nw, ir_node *exception,
+                                ir_node *prologue_block);
+
 int be_get_stack_entity_offset(be_stack_layout_t *frame, ir_entity *ent,
                                int bias);
 
@@ -12,14 +12,21 @@
 
 #include "panic.h"
 #include "execfreq.h"
+#include "irgraph_t.h"
 #include "irgwalk.h"
 #include "irhooks.h"
+#include "irloop.h"
 #include "irnode_t.h"
+#include "irnodemap.h"
 #include "iredges_t.h"
+#include "obst.h"
+#include "pmap.h"
 #include "statev_t.h"
+#include "timing.h"
 #include "util.h"
 
 #include "bearch.h"
+#include "beifg.h"
 #include "beirg.h"
 #include "bestat.h"
 #include "belive.h"
@@ -36,9 +43,9 @@ struct pressure_walker_env_t {
 	const arch_register_class_t *cls;
 };
 
-static void check_reg_pressure_class(pressure_walker_env_t *env,
-                                     ir_node *block,
-                                     const arch_register_class_t *cls)
+static unsigned check_reg_pressure_class(pressure_walker_env_t *env,
+                                         ir_node *block,
+                                         const arch_register_class_t *cls)
 {
 	ir_nodeset_t live_nodes;
 	ir_nodeset_init(&live_nodes);
@@ -58,6 +65,7 @@ static void check_reg_pressure_class(pressure_walker_env_t *env,
 		env->max_pressure = max_live;
 
 	ir_nodeset_destroy(&live_nodes);
+	return max_live;
 }
 
 static void stat_reg_pressure_block(ir_node *block, void *data)
@@ -86,6 +94,273 @@ void be_do_stat_reg_pressure(ir_graph *irg, const arch_register_class_t *cls)
 	stat_ev_dbl("bechordal_maximum_register_pressure", env.max_pressure);
 }
 
+/** Kinds of nodes inserted by the spiller. */
+typedef enum spill_kind_t {
+	SPILL_KIND_SPILL,
+	SPILL_KIND_RELOAD,
+	SPILL_KIND_REMAT,
+	SPILL_KIND_COUNT
+} spill_kind_t;
+
+static char const *const spill_kind_names[SPILL_KIND_COUNT] = {
+	"spills", "reloads", "remats"
+};
+
+/** Number of blocks reported as spill hot spots per register class. */
+#define BESTAT_HOT_BLOCKS 16
+
+/** Spill statistics of a block, a loop or the whole function. */
+typedef struct spill_counts_t {
+	unsigned counts[SPILL_KIND_COUNT];
+	double   weighted[SPILL_KIND_COUNT]; /**< counts weighted by execfreq */
+	double   costs;        /**< execfreq weighted costs of the inserted nodes */
+	unsigned max_pressure; /**< maximum register pressure before spilling */
+} spill_counts_t;
+
+typedef struct block_spill_stat_t {
+	ir_node        *block;
+	double          freq;
+	spill_counts_t  counts;
+} block_spill_stat_t;
+
+typedef struct loop_spill_stat_t {
+	ir_loop        *loop;
+	spill_counts_t  counts;
+} loop_spill_stat_t;
+
+struct be_spill_stat_t {
+	ir_graph              *irg;
+	pressure_walker_env_t  pressure;
+	unsigned               first_idx; /**< first node index of the spiller */
+	ir_nodemap             blocks;    /**< block -> block_spill_stat_t */
+	block_spill_stat_t   **block_list;
+	struct obstack         obst;
+};
+
+static block_spill_stat_t *get_block_spill_stat(be_spill_stat_t *stat,
+                                                ir_node *block)
+{
+	block_spill_stat_t *bs
+		= ir_nodemap_get(block_spill_stat_t, &stat->blocks, block);
+	if (bs == NULL) {
+		bs        = OALLOCZ(&stat->obst, block_spill_stat_t);
+		bs->block = block;
+		ir_nodemap_insert(&stat->blocks, block, bs);
+		ARR_APP1(block_spill_stat_t*, stat->block_list, bs);
+	}
+	return bs;
+}
+
+static void record_block_pressure(ir_node *block, void *data)
+{
+	be_spill_stat_t    *const stat = (be_spill_stat_t*)data;
+	block_spill_stat_t *const bs   = get_block_spill_stat(stat, block);
+	bs->counts.max_pressure
+		= check_reg_pressure_class(&stat->pressure, block, stat->pressure.cls);
+}
+
+be_spill_stat_t *be_spill_stat_begin(ir_graph *irg,
+                                     const arch_register_class_t *cls)
+{
+	if (!stat_ev_enabled && !ir_timing_is_enabled())
+		return NULL;
+
+	be_assure_live_sets(irg);
+	be_spill_stat_t *const stat = XMALLOCZ(be_spill_stat_t);
+	stat->irg          = irg;
+	stat->pressure.irg = irg;
+	stat->pressure.lv  = be_get_irg_liveness(irg);
+	stat->pressure.cls = cls;
+	stat->block_list   = NEW_ARR_F(block_spill_stat_t*, 0);
+	obstack_init(&stat->obst);
+	ir_nodemap_init(&stat->blocks, irg);
+
+	irg_block_walk_graph(irg, record_block_pressure, NULL, stat);
+	stat->first_idx = get_irg_last_idx(irg);
+	return stat;
+}
+
+static void count_block_spills(ir_node *block, void *data)
+{
+	be_spill_stat_t    *const stat = (be_spill_stat_t*)data;
+	block_spill_stat_t *const bs   = get_block_spill_stat(stat, block);
+	double              const freq = get_block_execfreq(block);
+	bs->freq = freq;
+
+	sched_foreach(block, node) {
+		/* only count the nodes of this spiller run, earlier register classes
+		 * and the instruction selection create flagged nodes, too */
+		if (get_irn_idx(node) < stat->first_idx)
+			continue;
+
+		spill_kind_t kind;
+		if (arch_irn_is(node, spill)) {
+			kind = SPILL_KIND_SPILL;
+		} else if (arch_irn_is(node, reload)) {
+			kind = SPILL_KIND_RELOAD;
+		} else if (arch_irn_is(node, rematerialized)) {
+			kind = SPILL_KIND_REMAT;
+		} else {
+			continue;
+		}
+		++bs->counts.counts[kind];
+		bs->counts.weighted[kind] += freq;
+		bs->counts.costs += isa_if->get_op_estimated_cost(node) * freq;
+	}
+}
+
+static void add_spill_counts(spill_counts_t *dest, spill_counts_t const *src)
+{
+	for (spill_kind_t k = SPILL_KIND_SPILL; k < SPILL_KIND_COUNT; ++k) {
+		dest->counts[k]   += src->counts[k];
+		dest->weighted[k] += src->weighted[k];
+	}
+	dest->costs        += src->costs;
+	dest->max_pressure  = MAX(dest->max_pressure, src->max_pressure);
+}
+
+static bool has_spills(spill_counts_t const *counts)
+{
+	for (spill_kind_t k = SPILL_KIND_SPILL; k < SPILL_KIND_COUNT; ++k) {
+		if (counts->counts[k] != 0)
+			return true;
+	}
+	return false;
+}
+
+static void emit_spill_counts(spill_counts_t const *counts)
+{
+	for (spill_kind_t k = SPILL_KIND_SPILL; k < SPILL_KIND_COUNT; ++k) {
+		char buf[128];
+		snprintf(buf, sizeof(buf), "bestat_%s", spill_kind_names[k]);
+		stat_ev_ull(buf, counts->counts[k]);
+		snprintf(buf, sizeof(buf), "bestat_weighted_%s", spill_kind_names[k]);
+		stat_ev_dbl(buf, counts->weighted[k]);
+	}
+	stat_ev_dbl("bestat_spill_costs", counts->costs);
+	stat_ev_ull("bestat_max_pressure", counts->max_pressure);
+}
+
+static void add_timing_counters(char const *cls_name,
+                                spill_counts_t const *counts)
+{
+	char buf[128];
+	for (spill_kind_t k = SPILL_KIND_SPILL; k < SPILL_KIND_COUNT; ++k) {
+		snprintf(buf, sizeof(buf), "%s_%s", cls_name, spill_kind_names[k]);
+		ir_timing_scope_add(buf, counts->counts[k]);
+		snprintf(buf, sizeof(buf), "%s_weighted_%s", cls_name,
+		         spill_kind_names[k]);
+		ir_timing_scope_add(buf, counts->weighted[k]);
+	}
+	snprintf(buf, sizeof(buf), "%s_spill_costs", cls_name);
+	ir_timing_scope_add(buf, counts->costs);
+	snprintf(buf, sizeof(buf), "%s_max_pressure", cls_name);
+	ir_timing_scope_add(buf, counts->max_pressure);
+}
+
+static int cmp_block_spill_stat(const void *p1, const void *p2)
+{
+	block_spill_stat_t const *const b1 = *(block_spill_stat_t const**)p1;
+	block_spill_stat_t const *const b2 = *(block_spill_stat_t const**)p2;
+	if (b1->counts.costs != b2->counts.costs)
+		return b1->counts.costs < b2->counts.costs ? 1 : -1;
+	return QSORT_CMP(get_irn_node_nr(b1->block), get_irn_node_nr(b2->block));
+}
+
+static int cmp_loop_spill_stat(const void *p1, const void *p2)
+{
+	loop_spill_stat_t const *const l1 = *(loop_spill_stat_t const**)p1;
+	loop_spill_stat_t const *const l2 = *(loop_spill_stat_t const**)p2;
+	if (l1->counts.costs != l2->counts.costs)
+		return l1->counts.costs < l2->counts.costs ? 1 : -1;
+	return QSORT_CMP(get_loop_loop_nr(l1->loop), get_loop_loop_nr(l2->loop));
+}
+
+/**
+ * Sums the block statistics up into the loops containing them, a block
+ * counts for its own loop and all loops surrounding it.
+ */
+static loop_spill_stat_t **collect_loop_spill_stats(be_spill_stat_t *stat)
+{
+	ir_loop            *const root  = get_irg_loop(stat->irg);
+	pmap               *const map   = pmap_create();
+	loop_spill_stat_t **      loops = NEW_ARR_F(loop_spill_stat_t*, 0);
+	for (size_t i = 0, n = ARR_LEN(stat->block_list); i < n; ++i) {
+		block_spill_stat_t const *const bs = stat->block_list[i];
+		for (ir_loop *loop = get_irn_loop(bs->block);
+		     loop != NULL && loop != root; loop = get_loop_outer_loop(loop)) {
+			loop_spill_stat_t *ls = pmap_get(loop_spill_stat_t, map, loop);
+			if (ls == NULL) {
+				ls       = OALLOCZ(&stat->obst, loop_spill_stat_t);
+				ls->loop = loop;
+				pmap_insert(map, loop, ls);
+				ARR_APP1(loop_spill_stat_t*, loops, ls);
+			}
+			add_spill_counts(&ls->counts, &bs->counts);
+		}
+	}
+	pmap_destroy(map);
+	return loops;
+}
+
+void be_spill_stat_finish(be_spill_stat_t *stat)
+{
+	if (stat == NULL)
+		return;
+
+	ir_graph                    *const irg = stat->irg;
+	arch_register_class_t const *const cls = stat->pressure.cls;
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+	irg_block_walk_graph(irg, count_block_spills, NULL, stat);
+
+	spill_counts_t total;
+	memset(&total, 0, sizeof(total));
+	size_t const n_blocks = ARR_LEN(stat->block_list);
+	for (size_t i = 0; i < n_blocks; ++i)
+		add_spill_counts(&total, &stat->block_list[i]->counts);
+
+	ir_timing_scope_push("spill_stats", irg);
+	add_timing_counters(cls->name, &total);
+	ir_timing_scope_pop("spill_stats");
+
+	if (stat_ev_enabled) {
+		emit_spill_counts(&total);
+
+		loop_spill_stat_t **const loops = collect_loop_spill_stats(stat);
+		size_t              const n_loops = ARR_LEN(loops);
+		QSORT_ARR(loops, cmp_loop_spill_stat);
+		for (size_t i = 0; i < n_loops; ++i) {
+			loop_spill_stat_t const *const ls = loops[i];
+			if (!has_spills(&ls->counts))
+				continue;
+			stat_ev_ctx_push_fmt("bestat_loop", "%ld",
+			                     get_loop_loop_nr(ls->loop));
+			stat_ev_int("bestat_loop_depth", get_loop_depth(ls->loop));
+			emit_spill_counts(&ls->counts);
+			stat_ev_ctx_pop("bestat_loop");
+		}
+		DEL_ARR_F(loops);
+
+		/* report the blocks where the spill code costs the most */
+		QSORT_ARR(stat->block_list, cmp_block_spill_stat);
+		for (size_t i = 0; i < MIN(n_blocks, BESTAT_HOT_BLOCKS); ++i) {
+			block_spill_stat_t const *const bs = stat->block_list[i];
+			if (!has_spills(&bs->counts))
+				break;
+			stat_ev_ctx_push_fmt("bestat_block", "%ld",
+			                     get_irn_node_nr(bs->block));
+			stat_ev_dbl("bestat_block_execfreq", bs->freq);
+			emit_spill_counts(&bs->counts);
+			stat_ev_ctx_pop("bestat_block");
+		}
+	}
+
+	DEL_ARR_F(stat->block_list);
+	ir_nodemap_destroy(&stat->blocks);
+	obstack_free(&stat->obst, NULL);
+	xfree(stat);
+}
+
 typedef struct estimate_irg_costs_env_t {
 	double costs;
 } estimate_irg_costs_env_t;
@@ -264,3 +539,37 @@ void be_stat_values(ir_graph *irg)
 	stat_ev_ull("valstat_unused_constrained_values",
 	            stats.unused_constrained_values);
 }
+
+static unsigned long query_ifg(const be_ifg_t *ifg)
+{
+	unsigned long n_edges = 0;
+	be_ifg_foreach_node(ifg, irn) {
+		neighbours_iter_t iter;
+		be_ifg_foreach_neighbour(ifg, &iter, irn, neighbour) {
+			++n_edges;
+		}
+		n_edges += be_ifg_degree(ifg, irn);
+	}
+	return n_edges;
+}
+
+void be_stat_ifg_queries(const be_chordal_env_t *env)
+{
+	be_ifg_t *const walked = be_create_ifg(env, false);
+	stat_ev_tim_push();
+	unsigned long const walked_edges = query_ifg(walked);
+	stat_ev_tim_pop("bestat_ifg_walk_query_time");
+	be_ifg_free(walked);
+
+	stat_ev_tim_push();
+	be_ifg_t *const materialized = be_create_ifg(env, true);
+	stat_ev_tim_pop("bestat_ifg_materialize_time");
+	stat_ev_tim_push();
+	unsigned long const materialized_edges = query_ifg(materialized);
+	stat_ev_tim_pop("bestat_ifg_materialized_query_time");
+	be_ifg_free(materialized);
+
+	assert(walked_edges == materialized_edges);
+	(void)walked_edges;
+	(void)materialized_edges;
+}
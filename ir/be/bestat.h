@@ -12,6 +12,7 @@
 #define FIRM_BE_BESTAT_H
 
 #include "be_types.h"
+#include "bechordal.h"
 #include "firm_types.h"
 
 typedef enum be_stat_tag_t {
@@ -42,6 +43,22 @@ void be_emit_node_stats(be_node_stats_t *stats, const char *prefix);
  */
 void be_do_stat_reg_pressure(ir_graph *irg, const arch_register_class_t *cls);
 
+typedef struct be_spill_stat_t be_spill_stat_t;
+
+/**
+ * Records the register pressure of @p cls in each block before spilling.
+ * Returns NULL if neither statev nor the pass profile is recording.
+ */
+be_spill_stat_t *be_spill_stat_begin(ir_graph *irg,
+                                     const arch_register_class_t *cls);
+
+/**
+ * Counts the spills, reloads and rematerializations created since
+ * be_spill_stat_begin(), weights them by execution frequency and reports
+ * them per function, per loop and for the hottest blocks.  Frees @p stat.
+ */
+void be_spill_stat_finish(be_spill_stat_t *stat);
+
 /**
  * Gives a cost estimate for the program (based on execution frequencies)
  * and backend op_estimated_cost
@@ -64,4 +81,10 @@ unsigned long be_count_blocks(ir_graph *irg);
  */
 void be_stat_values(ir_graph *irg);
 
+/**
+ * Compares the time of neighbour and degree queries on an interference graph
+ * answered from the liveness information with a materialized one.
+ */
+void be_stat_ifg_queries(const be_chordal_env_t *env);
+
 #endif
@@ -436,10 +436,10 @@ void be_assure_state(ir_graph *irg, const arch_register_t *reg, void *func_env,
 	ir_free_resources(irg, IR_RESOURCE_IRN_VISITED | IR_RESOURCE_IRN_LINK);
 
 	/* reconstruct ssa-form */
+	be_ssa_construction_env_t senv;
+	be_ssa_construction_init(&senv, irg);
 	spill_info_t *info = env.spills;
 	while (info != NULL) {
-		be_ssa_construction_env_t senv;
-		be_ssa_construction_init(&senv, irg);
 		if (sched_is_scheduled(info->value))
 			be_ssa_construction_add_copy(&senv, info->value);
 		be_ssa_construction_add_copies(&senv,
@@ -453,10 +453,11 @@ void be_assure_state(ir_graph *irg, const arch_register_t *reg, void *func_env,
 			ir_node *phi = phis[i];
 			arch_set_irn_register(phi, env.reg);
 		}
-		be_ssa_construction_destroy(&senv);
+		be_ssa_construction_reset(&senv);
 
 		info = info->next;
 	}
+	be_ssa_construction_destroy(&senv);
 
 	/* some nodes might be dead now. */
 	be_remove_dead_nodes_from_schedule(irg);
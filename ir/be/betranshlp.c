@@ -9,12 +9,15 @@
  * @author      Matthias Braun, Michael Beck
  * @date        14.06.2007
  */
+#include "array.h"
 #include "bearch.h"
 #include "beirg.h"
 #include "belive.h"
 #include "benode.h"
 #include "betranshlp.h"
+#include "bitset.h"
 #include "beutil.h"
+#include "bitwidth.h"
 #include "cgana.h"
 #include "debug.h"
 #include "execfreq_t.h"
@@ -37,14 +40,19 @@
 #include "vrp.h"
 
 typedef struct be_transform_env_t {
-	pdeq *worklist;  /**< worklist of nodes that still need to be transformed */
+	pdeq     *worklist;    /**< worklist of nodes that still need to be transformed */
+	ir_node **new_nodes;   /**< maps the index of an old node to its transformation */
+	unsigned  n_old_nodes; /**< number of entries in new_nodes */
+	ir_widths *widths;     /**< known widths of the old nodes */
 } be_transform_env_t;
 
 static be_transform_env_t env;
 
 void be_set_transformed_node(ir_node *old_node, ir_node *new_node)
 {
-	set_irn_link(old_node, new_node);
+	unsigned const idx = get_irn_idx(old_node);
+	assert(idx < env.n_old_nodes);
+	env.new_nodes[idx] = new_node;
 	mark_irn_visited(old_node);
 }
 
@@ -53,6 +61,12 @@ bool be_is_transformed(const ir_node *node)
 	return irn_visited(node);
 }
 
+static ir_node *get_transformed_node(ir_node const *const node)
+{
+	assert(be_is_transformed(node));
+	return env.new_nodes[get_irn_idx(node)];
+}
+
 ir_node *be_transform_phi(ir_node *node, const arch_register_req_t *req)
 {
 	ir_node  *block = be_transform_nodes_block(node);
@@ -173,7 +187,7 @@ ir_node *be_transform_node(ir_node *node)
 {
 	ir_node *new_node;
 	if (be_is_transformed(node)) {
-		new_node = (ir_node*)get_irn_link(node);
+		new_node = get_transformed_node(node);
 	} else {
 #ifdef DEBUG_libfirm
 		be_set_transformed_node(node, NULL);
@@ -210,43 +224,70 @@ void be_enqueue_preds(ir_node *node)
 }
 
 /**
- * Rewire nodes which are potential loops (like Phis) to avoid endless loops.
+ * Returns the transformation of @p node, if it is a node of the old graph,
+ * which still is referenced from the new graph, or NULL otherwise.
+ * Nodes of the new graph are never marked visited, so only old nodes are
+ * considered transformed.
  */
-static void fix_loops(ir_node *node)
+static ir_node *get_new_pred(ir_node const *const node)
 {
-	if (irn_visited_else_mark(node))
-		return;
+	return be_is_transformed(node) ? get_transformed_node(node) : NULL;
+}
 
-	bool changed = false;
-	if (! is_Block(node)) {
-		ir_node *block     = get_nodes_block(node);
-		ir_node *new_block = (ir_node*)get_irn_link(block);
+/**
+ * Rewire nodes which are potential loops (like Phis) to avoid endless loops.
+ * The new graph is walked with an explicit stack, as it may be very deep.
+ */
+static void fix_loops(ir_node *const anchor)
+{
+	ir_graph *const irg     = get_irn_irg(anchor);
+	bitset_t *const visited = bitset_malloc(get_irg_last_idx(irg));
+	ir_node       **stack   = NEW_ARR_F(ir_node*, 1);
+	stack[0] = anchor;
+	bitset_set(visited, get_irn_idx(anchor));
+
+	while (ARR_LEN(stack) > 0) {
+		ir_node *const node = stack[ARR_LEN(stack) - 1];
+		ARR_SHRINKLEN(stack, ARR_LEN(stack) - 1);
+
+		bool changed = false;
+		if (!is_Block(node)) {
+			ir_node *block     = get_nodes_block(node);
+			ir_node *new_block = get_new_pred(block);
+			if (new_block != NULL) {
+				set_nodes_block(node, new_block);
+				block   = new_block;
+				changed = true;
+			}
 
-		if (new_block != NULL) {
-			set_nodes_block(node, new_block);
-			block = new_block;
-			changed = true;
+			if (!bitset_is_set(visited, get_irn_idx(block))) {
+				bitset_set(visited, get_irn_idx(block));
+				ARR_APP1(ir_node*, stack, block);
+			}
 		}
 
-		fix_loops(block);
-	}
-
-	foreach_irn_in(node, i, pred) {
-		ir_node *in = pred;
-		ir_node *nw = (ir_node*)get_irn_link(in);
+		foreach_irn_in(node, i, pred) {
+			ir_node *in = pred;
+			ir_node *nw = get_new_pred(in);
+			if (nw != NULL && nw != in) {
+				set_irn_n(node, i, nw);
+				in      = nw;
+				changed = true;
+			}
 
-		if (nw != NULL && nw != in) {
-			set_irn_n(node, i, nw);
-			in = nw;
-			changed = true;
+			if (!bitset_is_set(visited, get_irn_idx(in))) {
+				bitset_set(visited, get_irn_idx(in));
+				ARR_APP1(ir_node*, stack, in);
+			}
 		}
 
-		fix_loops(in);
+		if (changed) {
+			identify_remember(node);
+		}
 	}
 
-	if (changed) {
-		identify_remember(node);
-	}
+	DEL_ARR_F(stack);
+	xfree(visited);
 }
 
 /**
@@ -280,10 +321,7 @@ static void transform_nodes(ir_graph *irg, arch_pretrans_nodes *pre_transform)
 	}
 
 	/* Fix loops. */
-	inc_irg_visited(irg);
-	foreach_irn_in_r(new_anchor, i, n) {
-		fix_loops(n);
-	}
+	fix_loops(new_anchor);
 
 	del_pdeq(env.worklist);
 	free_End(old_end);
@@ -291,6 +329,12 @@ static void transform_nodes(ir_graph *irg, arch_pretrans_nodes *pre_transform)
 
 void be_transform_graph(ir_graph *irg, arch_pretrans_nodes *func)
 {
+	/* the transformations are stored by the indices of the old nodes, which
+	 * are reused by the new nodes */
+	env.n_old_nodes = get_irg_last_idx(irg);
+	env.new_nodes   = XMALLOCNZ(ir_node*, env.n_old_nodes);
+	env.widths      = compute_widths(irg);
+
 	/* create a new obstack */
 	struct obstack old_obst = irg->obst;
 	obstack_init(&irg->obst);
@@ -302,9 +346,10 @@ void be_transform_graph(ir_graph *irg, arch_pretrans_nodes *func)
 	new_identities(irg);
 
 	/* do the main transformation */
-	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
 	transform_nodes(irg, func);
-	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	xfree(env.new_nodes);
+	free_widths(env.widths);
+	env.widths = NULL;
 
 	/* free the old obstack */
 	obstack_free(&old_obst, 0);
@@ -317,13 +362,33 @@ void be_transform_graph(ir_graph *irg, arch_pretrans_nodes *func)
 	edges_activate(irg);
 }
 
+/**
+ * Checks the upper bits with the width analysis, which also knows about
+ * values whose upper bits are cleared by distant nodes.
+ */
+static bool upper_bits_known_clean(const ir_node *node, ir_mode *mode)
+{
+	if (env.widths == NULL)
+		return false;
+	/* narrower values have undefined upper bits in their register */
+	ir_mode *const node_mode = get_irn_mode(node);
+	if (!mode_is_int(node_mode)
+	    || get_mode_size_bits(node_mode) < be_get_machine_size())
+		return false;
+	unsigned const bits = get_mode_size_bits(mode);
+	return mode_is_signed(mode) ? is_sign_extended(env.widths, node, bits)
+	                            : is_zero_extended(env.widths, node, bits);
+}
+
 bool be_upper_bits_clean(const ir_node *node, ir_mode *mode)
 {
 	ir_op *op = get_irn_op(node);
-	if (op->ops.generic2 == NULL)
-		return false;
-	upper_bits_clean_func func = (upper_bits_clean_func)op->ops.generic2;
-	return func(node, mode);
+	if (op->ops.generic2 != NULL) {
+		upper_bits_clean_func func = (upper_bits_clean_func)op->ops.generic2;
+		if (func(node, mode))
+			return true;
+	}
+	return upper_bits_known_clean(node, mode);
 }
 
 static bool bit_binop_upper_bits_clean(const ir_node *node, ir_mode *mode)
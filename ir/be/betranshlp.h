@@ -57,7 +57,7 @@ void be_set_transform_function(ir_op *op, be_transform_func func);
 void be_set_transform_proj_function(ir_op *pred_op, be_transform_func func);
 
 /**
- * Associate an old node with a transformed node. Uses link field.
+ * Associate an old node with a transformed node.
  */
 void be_set_transformed_node(ir_node *old_node, ir_node *new_node);
 
@@ -11,6 +11,7 @@
  */
 #include <limits.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "obst.h"
 #include "pmap.h"
@@ -42,26 +43,83 @@ typedef struct be_use_t {
 	ir_visited_t   visited;
 } be_use_t;
 
+#define HashSet          be_use_set_t
+#define HashSetEntry     be_use_set_entry_t
+#define ValueType        be_use_t*
+#define ADDITIONAL_DATA  struct obstack obst; /**< holds the uses */
+#include "hashset.h"
+#undef ADDITIONAL_DATA
+#undef ValueType
+#undef HashSetEntry
+#undef HashSet
+
+typedef struct be_use_set_t be_use_set_t;
+
+/**
+ * The uses of a value inside the block queried last.
+ */
+typedef struct be_block_uses_t {
+	unsigned        n_uses;
+	const unsigned *steps;     /**< schedule steps of the uses, ascending */
+	ir_node *const *nodes;     /**< the using nodes in the order of steps */
+	bool            has_tail;  /**< tail holds the result without local use */
+	be_next_use_t   tail;      /**< time is relative to the end of the block */
+} be_block_uses_t;
+
 /**
  * The "uses" environment.
  */
 struct be_uses_t {
-	set           *uses; /**< cache: contains all computed uses so far. */
+	be_use_set_t   uses; /**< cache: contains all computed uses so far. */
 	const be_lv_t *lv;   /**< the liveness for the graph. */
 	ir_visited_t   visited_counter; /**< current search counter. */
+	const ir_node *block;        /**< block of the next-use table */
+	pmap          *block_uses;   /**< maps values to their be_block_uses_t */
+	struct obstack block_obst;   /**< memory of the next-use table */
 };
 
+static unsigned hash_use(const be_use_t *use)
+{
+	return hash_combine(hash_irn(use->block), hash_irn(use->node));
+}
+
 /**
- * Set-compare two uses.
+ * Creates the use for the block and definition of @p key, its next use is
+ * not computed yet.
  */
-static int cmp_use(const void *a, const void *b, size_t n)
+static be_use_t *new_use(struct obstack *obst, const be_use_t *key)
 {
-	(void)n;
-	const be_use_t *p = (const be_use_t*)a;
-	const be_use_t *q = (const be_use_t*)b;
-	return p->block != q->block || p->node != q->node;
+	be_use_t *const use = OALLOC(obst, be_use_t);
+	use->block          = key->block;
+	use->node           = key->node;
+	use->next_use       = USES_INFINITY;
+	use->outermost_loop = UNKNOWN_OUTERMOST_LOOP;
+	use->visited        = 0;
+	return use;
 }
 
+#define HashSet                   be_use_set_t
+#define HashSetEntry              be_use_set_entry_t
+#define ValueType                 be_use_t*
+#define KeyType                   be_use_t const*
+#define GetKey(value)             (value)
+#define InitData(self,value,key)  ((value) = new_use(&(self)->obst, (key)))
+#define NullValue                 NULL
+#define DeletedValue              ((be_use_t*)-1)
+#define SCALAR_RETURN
+#define Hash(self,key)            hash_use(key)
+#define KeysEqual(self,key1,key2) ((key1)->block == (key2)->block && (key1)->node == (key2)->node)
+#define SetRangeEmpty(ptr,size)   memset(ptr, 0, (size) * sizeof((ptr)[0]))
+
+void be_use_set_init_size(be_use_set_t *self, size_t expected_elements);
+void be_use_set_destroy(be_use_set_t *self);
+be_use_t *be_use_set_insert(be_use_set_t *self, be_use_t const *key);
+#define hashset_init_size  be_use_set_init_size
+#define hashset_destroy    be_use_set_destroy
+#define hashset_insert     be_use_set_insert
+
+#include "hashset.c.h"
+
 static be_next_use_t get_next_use(be_uses_t *env, ir_node *from,
 								  const ir_node *def, bool skip_from_uses);
 
@@ -81,17 +139,9 @@ static const be_use_t *get_or_set_use_block(be_uses_t *env,
 	temp.block = block;
 	temp.node  = def;
 
-	unsigned  hash   = hash_combine(hash_irn(block), hash_irn(def));
-	be_use_t *result = set_find(be_use_t, env->uses, &temp, sizeof(temp), hash);
-
-	if (result == NULL) {
-		// insert templ first as we might end in a loop in the get_next_use
-		// call otherwise
-		temp.next_use       = USES_INFINITY;
-		temp.outermost_loop = UNKNOWN_OUTERMOST_LOOP;
-		temp.visited        = 0;
-		result = set_insert(be_use_t, env->uses, &temp, sizeof(temp), hash);
-	}
+	/* insert the use first as we might end in a loop in the get_next_use
+	 * call otherwise, the uses live on an obstack so result stays valid */
+	be_use_t *result = be_use_set_insert(&env->uses, &temp);
 
 	if (result->outermost_loop == UNKNOWN_OUTERMOST_LOOP
 	 && result->visited < env->visited_counter) {
@@ -159,53 +209,18 @@ static inline void set_step(ir_node *node, unsigned step)
 }
 
 /**
- * Find the next use of a value defined by def, starting at node from.
+ * Find the next use of a value after the end of a block.
  *
  * @param env             the uses environment
- * @param from            the node at which we should start the search
+ * @param block           the block of the search
  * @param def             the definition of the value
- * @param skip_from_uses  if non-zero, ignore from uses
+ * @param step            the distance from the search start to the block end
+ * @param cacheable       set to false if the result may change later
  */
-static be_next_use_t get_next_use(be_uses_t *env, ir_node *from,
-								  const ir_node *def, bool skip_from_uses)
+static be_next_use_t get_next_use_after_block(be_uses_t *env, ir_node *block,
+                                              const ir_node *def, unsigned step,
+                                              bool *cacheable)
 {
-	if (skip_from_uses) {
-		from = sched_next(from);
-	}
-
-	ir_node *next_use_node = NULL;
-	unsigned next_use_step = INT_MAX;
-	unsigned timestep      = get_step(from);
-	ir_node *block         = get_nodes_block(from);
-	foreach_out_edge(def, edge) {
-		ir_node *node = get_edge_src_irn(edge);
-		if (is_Anchor(node))
-			continue;
-		if (get_nodes_block(node) != block)
-			continue;
-		if (is_Phi(node))
-			continue;
-
-		unsigned node_step = get_step(node);
-		if (node_step < timestep)
-			continue;
-		if (node_step < next_use_step) {
-			next_use_node = node;
-			next_use_step = node_step;
-		}
-	}
-
-	if (next_use_node != NULL) {
-		be_next_use_t result;
-		result.time           = next_use_step - timestep + skip_from_uses;
-		result.outermost_loop = get_loop_depth(get_irn_loop(block));
-		result.before         = next_use_node;
-		return result;
-	}
-
-	ir_node *node = sched_last(block);
-	unsigned step = get_step(node) + 1 + timestep + skip_from_uses;
-
 	if (be_is_phi_argument(block, def)) {
 		// TODO we really should continue searching the uses of the phi,
 		// as a phi isn't a real use that implies a reload (because we could
@@ -215,6 +230,7 @@ static be_next_use_t get_next_use(be_uses_t *env, ir_node *from,
 		result.time           = step;
 		result.outermost_loop = get_loop_depth(get_irn_loop(block));
 		result.before         = block;
+		*cacheable            = true;
 		return result;
 	}
 
@@ -277,16 +293,183 @@ static be_next_use_t get_next_use(be_uses_t *env, ir_node *from,
 		// generally correct, so mark it
 		result.outermost_loop = UNKNOWN_OUTERMOST_LOOP;
 	}
+	/* Uses in successors which are still being computed may become known
+	 * later, all other results are final. */
+	*cacheable = !found_visited;
 	DBG((dbg, LEVEL_5, "Result: %d (outerloop: %u)\n", result.time,
 	     result.outermost_loop));
 	return result;
 }
 
+/**
+ * Find the next use of a value defined by def, starting at node from.
+ *
+ * @param env             the uses environment
+ * @param from            the node at which we should start the search
+ * @param def             the definition of the value
+ * @param skip_from_uses  if non-zero, ignore from uses
+ */
+static be_next_use_t get_next_use(be_uses_t *env, ir_node *from,
+								  const ir_node *def, bool skip_from_uses)
+{
+	if (skip_from_uses) {
+		from = sched_next(from);
+	}
+
+	ir_node *next_use_node = NULL;
+	unsigned next_use_step = INT_MAX;
+	unsigned timestep      = get_step(from);
+	ir_node *block         = get_nodes_block(from);
+	foreach_out_edge(def, edge) {
+		ir_node *node = get_edge_src_irn(edge);
+		if (is_Anchor(node))
+			continue;
+		if (get_nodes_block(node) != block)
+			continue;
+		if (is_Phi(node))
+			continue;
+
+		unsigned node_step = get_step(node);
+		if (node_step < timestep)
+			continue;
+		if (node_step < next_use_step) {
+			next_use_node = node;
+			next_use_step = node_step;
+		}
+	}
+
+	if (next_use_node != NULL) {
+		be_next_use_t result;
+		result.time           = next_use_step - timestep + skip_from_uses;
+		result.outermost_loop = get_loop_depth(get_irn_loop(block));
+		result.before         = next_use_node;
+		return result;
+	}
+
+	ir_node *node = sched_last(block);
+	unsigned step = get_step(node) + 1 + timestep + skip_from_uses;
+
+	bool cacheable;
+	return get_next_use_after_block(env, block, def, step, &cacheable);
+}
+
+typedef struct use_step_t {
+	unsigned  step;
+	unsigned  pos;  /**< position in the out edges, breaks ties */
+	ir_node  *node;
+} use_step_t;
+
+static int cmp_use_step(const void *a, const void *b)
+{
+	const use_step_t *p = (const use_step_t*)a;
+	const use_step_t *q = (const use_step_t*)b;
+	if (p->step != q->step)
+		return p->step < q->step ? -1 : 1;
+	return p->pos < q->pos ? -1 : p->pos > q->pos;
+}
+
+/**
+ * Returns the uses of @p def in @p block ordered by their schedule step.
+ * The table is built on the first query for a value and kept until a
+ * different block is queried.
+ */
+static be_block_uses_t *get_block_uses(be_uses_t *env, const ir_node *block,
+                                       const ir_node *def)
+{
+	if (env->block != block) {
+		pmap_destroy(env->block_uses);
+		obstack_free(&env->block_obst, NULL);
+		obstack_init(&env->block_obst);
+		env->block_uses = pmap_create();
+		env->block      = block;
+	}
+
+	be_block_uses_t *uses = pmap_get(be_block_uses_t, env->block_uses, def);
+	if (uses != NULL)
+		return uses;
+
+	/* collect the local uses like get_next_use() does */
+	use_step_t       *steps = NEW_ARR_F(use_step_t, 0);
+	unsigned          pos   = 0;
+	foreach_out_edge(def, edge) {
+		ir_node *node = get_edge_src_irn(edge);
+		if (is_Anchor(node))
+			continue;
+		if (get_nodes_block(node) != block)
+			continue;
+		if (is_Phi(node))
+			continue;
+
+		use_step_t const use = { get_step(node), pos++, node };
+		ARR_APP1(use_step_t, steps, use);
+	}
+	QSORT_ARR(steps, cmp_use_step);
+
+	unsigned  const n_uses = ARR_LEN(steps);
+	unsigned *const ssteps = OALLOCN(&env->block_obst, unsigned, n_uses);
+	ir_node **const nodes  = OALLOCN(&env->block_obst, ir_node*, n_uses);
+	for (unsigned i = 0; i < n_uses; ++i) {
+		ssteps[i] = steps[i].step;
+		nodes[i]  = steps[i].node;
+	}
+	DEL_ARR_F(steps);
+
+	uses = OALLOCZ(&env->block_obst, be_block_uses_t);
+	uses->n_uses = n_uses;
+	uses->steps  = ssteps;
+	uses->nodes  = nodes;
+	pmap_insert(env->block_uses, def, uses);
+	return uses;
+}
+
 be_next_use_t be_get_next_use(be_uses_t *env, ir_node *from,
                               const ir_node *def, bool skip_from_uses)
 {
 	++env->visited_counter;
-	return get_next_use(env, from, def, skip_from_uses);
+
+	if (skip_from_uses) {
+		from = sched_next(from);
+	}
+
+	unsigned         const timestep = get_step(from);
+	ir_node         *const block    = get_nodes_block(from);
+	be_block_uses_t *const uses     = get_block_uses(env, block, def);
+
+	/* binary search the first local use at or after timestep */
+	unsigned lo = 0;
+	unsigned hi = uses->n_uses;
+	while (lo < hi) {
+		unsigned const mid = lo + (hi - lo) / 2;
+		if (uses->steps[mid] < timestep)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < uses->n_uses) {
+		be_next_use_t result;
+		result.time           = uses->steps[lo] - timestep + skip_from_uses;
+		result.outermost_loop = get_loop_depth(get_irn_loop(block));
+		result.before         = uses->nodes[lo];
+		return result;
+	}
+
+	ir_node *node = sched_last(block);
+	unsigned step = get_step(node) + 1 + timestep + skip_from_uses;
+	if (uses->has_tail) {
+		be_next_use_t result = uses->tail;
+		result.time += step;
+		return result;
+	}
+
+	bool          cacheable;
+	be_next_use_t result = get_next_use_after_block(env, block, def, step,
+	                                                &cacheable);
+	if (cacheable) {
+		uses->tail       = result;
+		uses->tail.time -= step;
+		uses->has_tail   = true;
+	}
+	return result;
 }
 
 /**
@@ -319,14 +502,20 @@ be_uses_t *be_begin_uses(ir_graph *irg, const be_lv_t *lv)
 	irg_block_walk_graph(irg, set_sched_step_walker, NULL, NULL);
 
 	be_uses_t *env = XMALLOCZ(be_uses_t);
-	env->uses = new_set(cmp_use, 512);
-	env->lv   = lv;
+	be_use_set_init_size(&env->uses, 512);
+	obstack_init(&env->uses.obst);
+	env->lv         = lv;
+	env->block_uses = pmap_create();
+	obstack_init(&env->block_obst);
 
 	return env;
 }
 
 void be_end_uses(be_uses_t *env)
 {
-	del_set(env->uses);
-	free(env);
+	be_use_set_destroy(&env->uses);
+	obstack_free(&env->uses.obst, NULL);
+	pmap_destroy(env->block_uses);
+	obstack_free(&env->block_obst, NULL);
+	xfree(env);
 }
@@ -10,6 +10,7 @@
  */
 #include <stdio.h>
 
+#include "be_t.h"
 #include "beirg.h"
 #include "belive.h"
 #include "benode.h"
@@ -87,25 +88,125 @@ ir_node *insert_Perm_before(ir_graph *irg, const arch_register_class_t *cls,
 	ir_node *const block = get_nodes_block(pos);
 	ir_node *const perm  = be_new_Perm(cls, block, n, nodes);
 	sched_add_before(pos, perm);
-	free(nodes);
+	xfree(nodes);
 
+	be_ssa_construction_env_t senv;
+	be_ssa_construction_init(&senv, irg);
 	for (size_t i = 0; i < n; ++i) {
 		ir_node *const perm_op = get_irn_n(perm, i);
 		ir_node *const proj    = be_new_Proj(perm, i);
 
-		be_ssa_construction_env_t senv;
-		be_ssa_construction_init(&senv, irg);
 		be_ssa_construction_add_copy(&senv, perm_op);
 		be_ssa_construction_add_copy(&senv, proj);
 		be_ssa_construction_fix_users(&senv, perm_op);
 		be_ssa_construction_update_liveness_phis(&senv, lv);
 		be_liveness_update(lv, perm_op);
 		be_liveness_update(lv, proj);
-		be_ssa_construction_destroy(&senv);
+		be_ssa_construction_reset(&senv);
 	}
+	be_ssa_construction_destroy(&senv);
 	return perm;
 }
 
+/**
+ * Walker: clears the flag if the node is an Alloc or passes the address of a
+ * frame entity on.  Releasing the frame before a sibling call would then
+ * leave the callee with dangling pointers.
+ */
+static void check_frame_escape(ir_node *const node, void *const data)
+{
+	bool *const possible = (bool*)data;
+	if (is_Alloc(node)) {
+		*possible = false;
+		return;
+	}
+	ir_node *const frame = get_irg_frame(get_irn_irg(node));
+	foreach_irn_in(node, i, pred) {
+		if (pred != frame)
+			continue;
+		if (!is_Member(node)) {
+			*possible = false;
+			return;
+		}
+		foreach_out_edge(node, edge) {
+			ir_node *const user = get_edge_src_irn(edge);
+			if (is_Load(user))
+				continue;
+			if (is_Store(user) && get_Store_ptr(user) == node)
+				continue;
+			*possible = false;
+			return;
+		}
+	}
+}
+
+bool be_sibling_calls_possible(ir_graph *const irg)
+{
+	if (!be_options.sibling_calls
+	 || is_method_variadic(get_entity_type(get_irg_entity(irg))))
+		return false;
+	bool possible = true;
+	irg_walk_graph(irg, check_frame_escape, NULL, &possible);
+	return possible;
+}
+
+ir_node *be_get_sibling_call(ir_node const *const ret)
+{
+	ir_node *const mem = get_Return_mem(ret);
+	if (!is_Proj(mem) || get_Proj_num(mem) != pn_Call_M)
+		return NULL;
+	ir_node *const call = get_Proj_pred(mem);
+	if (!is_Call(call) || get_nodes_block(call) != get_nodes_block(ret)
+	 || get_irn_n_edges(mem) != 1)
+		return NULL;
+
+	ir_type *const type  = get_Call_type(call);
+	size_t   const n_res = get_Return_n_ress(ret);
+	if (get_method_n_ress(type) != n_res
+	 || ir_needs_reloaded_callee_saves(call))
+		return NULL;
+	mtp_additional_properties props = get_method_additional_properties(type);
+	ir_entity *const callee = get_Call_callee(call);
+	if (callee != NULL)
+		props |= get_entity_additional_properties(callee);
+	if (props & mtp_property_returns_twice)
+		return NULL;
+
+	/* The results must go to the Return unchanged and nowhere else. */
+	foreach_out_edge(call, edge) {
+		ir_node *const proj = get_edge_src_irn(edge);
+		if (!is_Proj(proj))
+			return NULL;
+		switch ((pn_Call)get_Proj_num(proj)) {
+		case pn_Call_M:
+			continue;
+		case pn_Call_T_result:
+			foreach_out_edge(proj, res_edge) {
+				ir_node *const res = get_edge_src_irn(res_edge);
+				if (get_irn_n_edges(res) != 1)
+					return NULL;
+				unsigned const pn = get_Proj_num(res);
+				if (pn >= n_res || get_Return_res(ret, pn) != res)
+					return NULL;
+			}
+			continue;
+		case pn_Call_X_regular:
+		case pn_Call_X_except:
+			return NULL;
+		}
+		panic("invalid Proj->Call");
+	}
+	for (size_t i = 0; i < n_res; ++i) {
+		ir_node *const res = get_Return_res(ret, i);
+		if (!is_Proj(res) || get_Proj_num(res) != i)
+			return NULL;
+		ir_node *const pred = get_Proj_pred(res);
+		if (!is_Proj(pred) || get_Proj_pred(pred) != call)
+			return NULL;
+	}
+	return call;
+}
+
 //---------------------------------------------------------------------------
 
 typedef struct remove_dead_nodes_env_t_ {
@@ -134,8 +235,13 @@ static void remove_dead_nodes_walker(ir_node *block, void *data)
 		if (bitset_is_set(env->reachable, get_irn_idx(node)))
 			continue;
 
-		if (env->lv->sets_valid)
+		if (env->lv->sets_valid) {
 			be_liveness_remove(env->lv, node);
+			/* the operands lost a user */
+			foreach_irn_in(node, i, op) {
+				be_liveness_mark(env->lv, op);
+			}
+		}
 		sched_remove(node);
 
 		/* kill projs */
@@ -164,6 +270,9 @@ void be_remove_dead_nodes_from_schedule(ir_graph *irg)
 
 	/* walk schedule and remove non-marked nodes */
 	irg_block_walk_graph(irg, remove_dead_nodes_walker, NULL, &env);
+
+	if (env.lv->sets_valid)
+		be_liveness_update_marked(env.lv);
 }
 
 void be_keep_if_unused(ir_node *node)
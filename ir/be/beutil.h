@@ -40,7 +40,26 @@ ir_node *insert_Perm_before(ir_graph *irg, const arch_register_class_t *cls,
 						   ir_node *irn);
 
 /**
- * Removes dead nodes from schedule
+ * Checks whether calls in tail position of @p irg may be turned into jumps:
+ * the graph must not be variadic, contain no Alloc and pass no address of a
+ * frame entity on, as the frame is released before the jump.  Must be called
+ * before the graph is transformed.
+ */
+bool be_sibling_calls_possible(ir_graph *irg);
+
+/**
+ * Returns the Call whose results @p ret returns unchanged, if nothing but
+ * the epilogue executes after it.  If be_sibling_calls_possible() holds for
+ * the graph, the backend may then release the frame and jump to the callee
+ * instead, provided the callee finds its arguments and places its results
+ * where the caller's caller expects them.  Returns NULL otherwise.
+ */
+ir_node *be_get_sibling_call(ir_node const *ret);
+
+/**
+ * Removes dead nodes from schedule.
+ * If the liveness sets are valid, they are updated, including the nodes
+ * remembered with be_liveness_mark().
  * @param irg  the graph
  */
 void be_remove_dead_nodes_from_schedule(ir_graph *irg);
@@ -14,6 +14,7 @@
 #include "bitset.h"
 #include "set.h"
 #include "array.h"
+#include "hashptr.h"
 
 #include "irnode_t.h"
 #include "irgwalk.h"
@@ -122,9 +123,13 @@ typedef struct be_verify_schedule_env_t_ {
 	bitset_t *scheduled;     /**< bitset of scheduled nodes */
 } be_verify_schedule_env_t;
 
-static void verify_schedule_walker(ir_node *block, void *data)
+/**
+ * Checks the schedule of a block.  If @p scheduled is not NULL, the scheduled
+ * nodes are recorded in it and nodes scheduled twice are reported.
+ */
+static bool verify_block_schedule(ir_node *const block, bitset_t *const scheduled)
 {
-	be_verify_schedule_env_t *env = (be_verify_schedule_env_t*) data;
+	bool problem_found = false;
 
 	/*
 	 * Tests for the following things:
@@ -137,29 +142,31 @@ static void verify_schedule_walker(ir_node *block, void *data)
 	sched_timestep_t last_timestep  = 0;
 	sched_foreach(block, node) {
 		/* this node is scheduled */
-		if (bitset_is_set(env->scheduled, get_irn_idx(node))) {
-			verify_warnf(block, "%+F appears to be schedule twice");
-			env->problem_found = true;
+		if (scheduled != NULL) {
+			if (bitset_is_set(scheduled, get_irn_idx(node))) {
+				verify_warnf(block, "%+F appears to be schedule twice", node);
+				problem_found = true;
+			}
+			bitset_set(scheduled, get_irn_idx(node));
 		}
-		bitset_set(env->scheduled, get_irn_idx(node));
 
 		/* Check that scheduled nodes are in the correct block */
 		if (get_nodes_block(node) != block) {
 			verify_warnf(block, "%+F is in wrong %+F", node, get_nodes_block(node));
-			env->problem_found = true;
+			problem_found = true;
 		}
 
 		/* Check that timesteps are increasing */
 		sched_timestep_t timestep = sched_get_time_step(node);
 		if (timestep <= last_timestep) {
 			verify_warnf(block, "schedule timestep did not increase at %+F", node);
-			env->problem_found = true;
+			problem_found = true;
 		}
 		last_timestep = timestep;
 
 		if (arch_get_irn_flags(node) & arch_irn_flag_not_scheduled) {
 			verify_warnf(block, "flag_not_scheduled node %+F scheduled anyway", node);
-			env->problem_found = true;
+			problem_found = true;
 		}
 
 		/* Check that phis come before any other node */
@@ -167,7 +174,7 @@ static void verify_schedule_walker(ir_node *block, void *data)
 			non_phi_found = node;
 		} else if (non_phi_found) {
 			verify_warnf(block, "%+F scheduled after non-Phi %+F", node, non_phi_found);
-			env->problem_found = true;
+			problem_found = true;
 		}
 
 		/* Check for control flow changing nodes */
@@ -175,7 +182,7 @@ static void verify_schedule_walker(ir_node *block, void *data)
 			/* check, that only one CF operation is scheduled */
 			if (cfchange_found != NULL) {
 				verify_warnf(block, "additional control flow changing node %+F scheduled after %+F", node, cfchange_found);
-				env->problem_found = true;
+				problem_found = true;
 			} else {
 				cfchange_found = node;
 			}
@@ -183,7 +190,7 @@ static void verify_schedule_walker(ir_node *block, void *data)
 			/* keepany isn't a real instruction. */
 			if (!be_is_Keep(node)) {
 				verify_warnf(block, "%+F scheduled after control flow changing node %+F", node, cfchange_found);
-				env->problem_found = true;
+				problem_found = true;
 			}
 		}
 
@@ -196,7 +203,7 @@ static void verify_schedule_walker(ir_node *block, void *data)
 
 				if (sched_get_time_step(arg) >= nodetime) {
 					verify_warnf(block, "%+F used by %+F before it was defined", arg, node);
-					env->problem_found = true;
+					problem_found = true;
 				}
 			}
 		}
@@ -204,7 +211,7 @@ static void verify_schedule_walker(ir_node *block, void *data)
 		/* Check that no dead nodes are scheduled */
 		if (get_irn_n_edges(node) == 0) {
 			verify_warnf(block, "%+F is dead but scheduled", node);
-			env->problem_found = true;
+			problem_found = true;
 		}
 
 		if (be_is_Keep(node) || be_is_CopyKeep(node)) {
@@ -222,10 +229,19 @@ static void verify_schedule_walker(ir_node *block, void *data)
 				prev = sched_prev(prev);
 			} while (is_Phi(prev));
 			verify_warnf(block, "%+F not scheduled after its pred node", node);
-			env->problem_found = true;
+			problem_found = true;
 ok:;
 		}
 	}
+
+	return !problem_found;
+}
+
+static void verify_schedule_walker(ir_node *block, void *data)
+{
+	be_verify_schedule_env_t *env = (be_verify_schedule_env_t*)data;
+	if (!verify_block_schedule(block, env->scheduled))
+		env->problem_found = true;
 }
 
 static void check_schedule(ir_node *node, void *data)
@@ -253,6 +269,47 @@ bool be_verify_schedule(ir_graph *irg)
 	return ! env.problem_found;
 }
 
+typedef struct be_verify_sampled_env_t {
+	unsigned seed;          /**< varies the sample between functions */
+	unsigned rate;          /**< about one in rate blocks is checked */
+	bool     problem_found;
+} be_verify_sampled_env_t;
+
+static void init_sampled_env(be_verify_sampled_env_t *const env,
+                             ir_graph const *const irg, unsigned const rate)
+{
+	assert(rate > 0);
+	env->seed          = hash_str(get_entity_ld_name(get_irg_entity(irg)));
+	env->rate          = rate;
+	env->problem_found = false;
+}
+
+/**
+ * Decides whether @p block belongs to the sample.  The sample depends on the
+ * function name, so different functions have different blocks checked, but
+ * compiling the same code twice checks the same blocks.
+ */
+static bool is_sampled(be_verify_sampled_env_t const *const env,
+                       ir_node const *const block)
+{
+	return hash_combine(env->seed, get_irn_idx(block)) % env->rate == 0;
+}
+
+static void verify_schedule_sampled_walker(ir_node *block, void *data)
+{
+	be_verify_sampled_env_t *const env = (be_verify_sampled_env_t*)data;
+	if (is_sampled(env, block) && !verify_block_schedule(block, NULL))
+		env->problem_found = true;
+}
+
+bool be_verify_schedule_sampled(ir_graph *const irg, unsigned const rate)
+{
+	be_verify_sampled_env_t env;
+	init_sampled_env(&env, irg, rate);
+	irg_block_walk_graph(irg, verify_schedule_sampled_walker, NULL, &env);
+	return !env.problem_found;
+}
+
 /*--------------------------------------------------------------------------- */
 
 typedef struct be_verify_reg_alloc_env_t {
@@ -444,11 +501,41 @@ bool be_verify_register_allocation(ir_graph *const irg)
 	return !env.problem_found;
 }
 
+static void verify_constraints_sampled_walker(ir_node *block, void *data)
+{
+	be_verify_sampled_env_t *const sampled = (be_verify_sampled_env_t*)data;
+	if (!is_sampled(sampled, block))
+		return;
+
+	be_verify_reg_alloc_env_t env = {
+		.lv            = NULL,
+		.problem_found = false,
+	};
+	sched_foreach(block, node) {
+		be_foreach_value(node, value,
+			check_output_constraints(&env, value);
+		);
+		check_input_constraints(&env, node);
+	}
+	if (env.problem_found)
+		sampled->problem_found = true;
+}
+
+bool be_verify_register_constraints_sampled(ir_graph *const irg,
+                                            unsigned const rate)
+{
+	be_verify_sampled_env_t env;
+	init_sampled_env(&env, irg, rate);
+	irg_block_walk_graph(irg, verify_constraints_sampled_walker, NULL, &env);
+	return !env.problem_found;
+}
+
 /*--------------------------------------------------------------------------- */
 
 typedef struct lv_walker_t {
 	be_lv_t *given;
 	be_lv_t *fresh;
+	bool     problem_found;
 } lv_walker_t;
 
 static const char *lv_flags_to_str(unsigned flags)
@@ -474,8 +561,14 @@ static void lv_check_walker(ir_node *bl, void *data)
 	be_lv_info_t   *const fresh   = ir_nodehashmap_get(be_lv_info_t, &w->fresh->map, bl);
 	unsigned const        n_curr  = curr  ? curr->n_members  : 0;
 	unsigned const        n_fresh = fresh ? fresh->n_members : 0;
-	if (n_curr != n_fresh) {
-		ir_fprintf(stderr, "%+F: liveness set sizes differ. curr %d, correct %d\n", bl, n_curr, n_fresh);
+	bool                  differs = n_curr != n_fresh;
+	for (unsigned i = 0; !differs && i < n_curr; ++i) {
+		differs = curr->nodes[i].node  != fresh->nodes[i].node
+		       || curr->nodes[i].flags != fresh->nodes[i].flags;
+	}
+	if (differs) {
+		w->problem_found = true;
+		ir_fprintf(stderr, "%+F: liveness sets differ. curr %d, correct %d\n", bl, n_curr, n_fresh);
 
 		ir_fprintf(stderr, "current:\n");
 		for (unsigned i = 0; i < n_curr; ++i) {
@@ -491,7 +584,7 @@ static void lv_check_walker(ir_node *bl, void *data)
 	}
 }
 
-void be_liveness_check(be_lv_t *lv)
+bool be_liveness_check(be_lv_t *lv)
 {
 	be_lv_t *const fresh = be_liveness_new(lv->irg);
 	be_liveness_compute_sets(fresh);
@@ -501,4 +594,5 @@ void be_liveness_check(be_lv_t *lv)
 	};
 	irg_block_walk_graph(lv->irg, lv_check_walker, NULL, &w);
 	be_liveness_free(fresh);
+	return !w.problem_found;
 }
@@ -36,6 +36,17 @@ bool be_verify_register_pressure(ir_graph *irg,
  */
 bool be_verify_schedule(ir_graph *irg);
 
+/**
+ * Cheap variant of be_verify_schedule(): Checks the schedule of about one in
+ * @p rate blocks.  Runs in time linear to the checked blocks and does not
+ * allocate memory.
+ *
+ * @param irg   The irg to check
+ * @param rate  Sampling rate, 1 checks every block
+ * @return      true if the sampled schedule is valid, false otherwise
+ */
+bool be_verify_schedule_sampled(ir_graph *irg, unsigned rate);
+
 /**
  * Verify register allocation: Checks that no 2 live nodes have the same
  * register assigned, also checks that each scheduled node has a register
@@ -46,9 +57,21 @@ bool be_verify_schedule(ir_graph *irg);
  */
 bool be_verify_register_allocation(ir_graph *irg);
 
+/**
+ * Cheap part of be_verify_register_allocation(): Checks the register
+ * constraints of the nodes in about one in @p rate blocks.  Does not need
+ * liveness information and does not allocate memory.
+ *
+ * @param irg   The graph to check
+ * @param rate  Sampling rate, 1 checks every block
+ * @return      true if verify succeeded, false otherwise
+ */
+bool be_verify_register_constraints_sampled(ir_graph *irg, unsigned rate);
+
 /**
  * Check the given liveness information against a freshly computed one.
+ * @return true if both are equal, false otherwise
  */
-void be_liveness_check(be_lv_t *lv);
+bool be_liveness_check(be_lv_t *lv);
 
 #endif
@@ -31,6 +31,7 @@
 #include "ident_t.h"
 #include "instrument.h"
 #include "ircons.h"
+#include "irdom.h"
 #include "iredges_t.h"
 #include "irgmod.h"
 #include "irgopt.h"
@@ -47,6 +48,8 @@
 #include "panic.h"
 #include "x86_x87.h"
 
+#include <limits.h>
+
 pmap *ia32_tv_ent; /**< A map of entities that store const tarvals */
 
 ir_mode *ia32_mode_fpcw;
@@ -203,6 +206,9 @@ int ia32_get_sp_bias(const ir_node *node)
 		return get_mode_size_bytes(ls_mode);
 	}
 
+	if (is_ia32_PushEax(node))
+		return IA32_REGISTER_SIZE;
+
 	if (is_ia32_Pop(node) || is_ia32_PopMem(node)) {
 		ir_mode *ls_mode = get_ia32_ls_mode(node);
 		return -get_mode_size_bytes(ls_mode);
@@ -982,6 +988,8 @@ static int determine_ebp_input(ir_node *ret)
 
 static void introduce_epilogue(ir_node *const ret, bool const omit_fp)
 {
+	assert((int)n_ia32_TailCall_mem == (int)n_ia32_Return_mem);
+	assert((int)n_ia32_TailCall_stack == (int)n_ia32_Return_stack);
 	ir_node        *curr_sp;
 	ir_node  *const first_sp = get_irn_n(ret, n_ia32_Return_stack);
 	ir_node  *const block    = get_nodes_block(ret);
@@ -1027,12 +1035,12 @@ static void introduce_epilogue(ir_node *const ret, bool const omit_fp)
 		kill_node(first_sp);
 }
 
-static void introduce_prologue(ir_graph *const irg, bool omit_fp)
+static void introduce_prologue(ir_node *const point, bool omit_fp)
 {
 	const arch_register_t *sp         = &ia32_registers[REG_ESP];
 	const arch_register_t *bp         = &ia32_registers[REG_EBP];
-	ir_node               *start      = get_irg_start(irg);
-	ir_node               *block      = get_nodes_block(start);
+	ir_graph              *irg        = get_irn_irg(point);
+	ir_node               *block      = get_block(point);
 	ir_type               *frame_type = get_irg_frame_type(irg);
 	unsigned               frame_size = get_type_size(frame_type);
 	ir_node               *initial_sp = be_get_Start_proj(irg, sp);
@@ -1044,19 +1052,19 @@ static void introduce_prologue(ir_graph *const irg, bool omit_fp)
 		ir_node *const initial_bp = be_get_Start_proj(irg, bp);
 		ir_node *const push       = new_bd_ia32_Push(NULL, block, noreg, noreg, mem, initial_bp, initial_sp, ia32_mode_gp);
 		arch_add_irn_flags(push, arch_irn_flag_spill);
-		sched_add_after(start, push);
+		sched_add_after(point, push);
 		ir_node *const curr_mem   = be_new_Proj(push, pn_ia32_Push_M);
-		edges_reroute_except(mem, curr_mem, push);
+		be_reroute_behind_prologue(mem, curr_mem, push, block);
 		ir_node *const curr_sp    = be_new_Proj_reg(push, pn_ia32_Push_stack, sp);
 
 		/* move esp to ebp */
 		ir_node *const curr_bp = be_new_Copy(block, curr_sp);
 		sched_add_after(push, curr_bp);
 		arch_copy_irn_out_info(curr_bp, 0, initial_bp);
-		edges_reroute_except(initial_bp, curr_bp, push);
+		be_reroute_behind_prologue(initial_bp, curr_bp, push, block);
 
 		ir_node *incsp = ia32_new_IncSP(block, curr_sp, frame_size, 0);
-		edges_reroute_except(initial_sp, incsp, push);
+		be_reroute_behind_prologue(initial_sp, incsp, push, block);
 		sched_add_after(curr_bp, incsp);
 
 		/* make sure the initial IncSP is really used by someone */
@@ -1066,27 +1074,34 @@ static void introduce_prologue(ir_graph *const irg, bool omit_fp)
 		layout->initial_bias = -4;
 	} else {
 		ir_node *const incsp = ia32_new_IncSP(block, initial_sp, frame_size, 0);
-		edges_reroute_except(initial_sp, incsp, incsp);
-		sched_add_after(start, incsp);
+		be_reroute_behind_prologue(initial_sp, incsp, incsp, block);
+		sched_add_after(point, incsp);
 	}
 }
 
 /**
- * Put the prologue code at the beginning, epilogue code before each return
+ * Put the prologue code where the frame is needed first, epilogue code before
+ * each return running with the frame
  */
 static void introduce_prologue_epilogue(ir_graph *const irg, bool omit_fp)
 {
+	ir_node *const point = be_get_prologue_point(irg, &ia32_registers[REG_ESP],
+	                                             ia32_get_frame_entity);
+	ir_node *const block = get_block(point);
+	ia32_get_irg_data(irg)->prologue_block = block;
+
 	/* introduce epilogue for every return node */
 	foreach_irn_in(get_irg_end_block(irg), i, pred) {
 		if (is_x_except_branch(pred)) {
 			/* Don't generate any code for X_except ins */
 		} else {
-			assert(is_ia32_Return(pred));
-			introduce_epilogue(pred, omit_fp);
+			assert(is_ia32_Return(pred) || is_ia32_TailCall(pred));
+			if (block_dominates(block, get_nodes_block(pred)))
+				introduce_epilogue(pred, omit_fp);
 		}
 	}
 
-	introduce_prologue(irg, omit_fp);
+	introduce_prologue(point, omit_fp);
 }
 
 static x87_attr_t *ia32_get_x87_attr(ir_node *const node)
@@ -1370,6 +1385,7 @@ static const ir_settings_arch_dep_t ia32_arch_dep = {
 	.maximum_shifts       = 4,
 	.highest_shift_amount = 63,
 	.evaluate             = ia32_evaluate_insn,
+	.evaluate_size        = ia32_evaluate_insn_size,
 	.allow_mulhs          = true,
 	.allow_mulhu          = true,
 	.max_bits_for_mulh    = 32,
@@ -1393,6 +1409,8 @@ static backend_params ia32_backend_params = {
 		.va_list_type = NULL, /* will be set later */
 		.lower_va_arg = be_default_lower_va_arg,
 	},
+	.n_int_registers                = 6,
+	.n_float_registers              = 8,
 };
 
 /**
@@ -1424,6 +1442,10 @@ static void ia32_init(void)
 
 	ia32_backend_params.type_long_long          = type_long_long;
 	ia32_backend_params.type_unsigned_long_long = type_unsigned_long_long;
+	ia32_backend_params.prefetch_distance       = ia32_cg_config.prefetch_distance;
+	ia32_backend_params.branch_mispredict_penalty
+		= ia32_cg_config.branch_mispredict_penalty;
+	ia32_backend_params.mux_latency             = ia32_cg_config.cmov_latency;
 
 	// va_list is a void pointer
 	ir_type *type_va_list = new_type_pointer(new_type_primitive(mode_ANY));
@@ -1492,6 +1514,8 @@ static void ia32_generate_code(FILE *output, const char *cup_name)
 {
 	ia32_tv_ent = pmap_create();
 
+	if (ia32_cg_config.emit_elf)
+		be_elf_select_target(&ia32_elf_target);
 	be_begin(output, cup_name);
 	unsigned *const sp_is_non_ssa = rbitset_alloca(N_IA32_REGISTERS);
 	rbitset_set(sp_is_non_ssa, REG_ESP);
@@ -1513,6 +1537,17 @@ static void ia32_generate_code(FILE *output, const char *cup_name)
 	pmap_destroy(ia32_tv_ent);
 }
 
+static void ia32_begin_jit_session(void)
+{
+	ia32_tv_ent = pmap_create();
+}
+
+static void ia32_end_jit_session(void)
+{
+	pmap_destroy(ia32_tv_ent);
+	ia32_tv_ent = NULL;
+}
+
 static ir_jit_function_t *ia32_jit_compile(ir_jit_segment_t *const segment,
                                            ir_graph *const irg)
 {
@@ -1637,7 +1672,7 @@ static void ia32_lower_for_target(void)
 
 	/* replace floating point operations by function calls */
 	if (ia32_cg_config.use_softfloat) {
-		lower_floating_point();
+		lower_floating_point(false);
 		be_after_irp_transform("lower-fp");
 	}
 
@@ -1665,9 +1700,12 @@ static void ia32_lower_for_target(void)
 	lower_builtins(s, supported);
 	be_after_irp_transform("lower-builtins");
 
+	/* The ELF writer cannot emit jump tables, so lower all switches to
+	 * compare trees there. */
+	unsigned const small_switch = ia32_cg_config.emit_elf ? UINT_MAX : 4;
 	foreach_irp_irg(i, irg) {
 		/* break up switches with wide ranges */
-		lower_switch(irg, 4, 256, mode_gp);
+		lower_switch(irg, small_switch, 256, mode_gp);
 		be_after_transform(irg, "lower-switch");
 	}
 
@@ -1717,7 +1755,10 @@ static arch_isa_if_t const ia32_isa_if = {
 	.get_params            = ia32_get_libfirm_params,
 	.generate_code         = ia32_generate_code,
 	.jit_compile           = ia32_jit_compile,
+	.begin_jit_session     = ia32_begin_jit_session,
+	.end_jit_session       = ia32_end_jit_session,
 	.emit_function         = ia32_emit_jit_function,
+	.emit_jit_relocation   = ia32_emit_jit_relocation,
 	.lower_for_target      = ia32_lower_for_target,
 	.is_valid_clobber      = ia32_is_valid_clobber,
 	.get_op_estimated_cost = ia32_get_op_estimated_cost,
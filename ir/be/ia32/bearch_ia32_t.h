@@ -32,6 +32,7 @@ typedef struct ia32_irg_data_t {
 
 	ir_node  *fpu_trunc_mode; /**< truncate fpu mode */
 	ir_node  *get_eip;        /**< get eip node */
+	ir_node  *prologue_block; /**< block setting up the stack frame */
 } ia32_irg_data_t;
 
 extern pmap *ia32_tv_ent; /**< A map of entities that store const tarvals */
@@ -75,6 +75,7 @@ typedef enum cpu_arch_features {
 	arch_feature_sse4_2   = 0x02000000, /**< SSE4.2 instructions */
 	arch_feature_sse4a    = 0x04000000, /**< SSE4a instructions */
 	arch_feature_popcnt   = 0x08000000, /**< popcnt instruction */
+	arch_feature_lzcnt    = 0x10000000, /**< lzcnt instruction (ABM) */
 
 	arch_mmx_insn     = arch_feature_mmx,                         /**< MMX instructions */
 	arch_sse1_insn    = arch_feature_sse1   | arch_mmx_insn,      /**< SSE1 instructions, include MMX */
@@ -125,7 +126,7 @@ typedef enum cpu_arch_features {
 	cpu_k8             = arch_k8  | arch_3DNowE_insn | arch_feature_cmov | arch_feature_p6_insn | arch_64bit_insn,
 	cpu_k8_sse3        = arch_k8  | arch_3DNowE_insn | arch_feature_cmov | arch_feature_p6_insn | arch_64bit_insn | arch_sse3_insn,
 	cpu_k10_generic    = arch_k10 | arch_feature_p6_insn,
-	cpu_k10            = arch_k10 | arch_3DNowE_insn | arch_feature_cmov | arch_feature_p6_insn | arch_feature_popcnt | arch_64bit_insn | arch_sse4a_insn,
+	cpu_k10            = arch_k10 | arch_3DNowE_insn | arch_feature_cmov | arch_feature_p6_insn | arch_feature_popcnt | arch_feature_lzcnt | arch_64bit_insn | arch_sse4a_insn,
 
 	/* other CPUs */
 	cpu_winchip_c6  = arch_i486 | arch_feature_mmx,
@@ -139,6 +140,7 @@ ENUM_BITSET(cpu_arch_features)
 
 static bool              opt_size             = false;
 static bool              emit_machcode        = false;
+static bool              emit_elf             = false;
 static bool              use_softfloat        = false;
 static bool              use_sse              = false;
 static bool              use_sse2             = false;
@@ -149,6 +151,8 @@ static bool              use_sse4_2           = false;
 static bool              use_sse4a            = false;
 static bool              use_sse5             = false;
 static bool              use_ssse3            = false;
+static bool              use_popcnt           = false;
+static bool              use_lzcnt            = false;
 static cpu_arch_features arch                 = cpu_generic;
 static cpu_arch_features opt_arch             = 0;
 static int               fpu_arch             = 0;
@@ -244,6 +248,7 @@ static const lc_opt_table_entry_t ia32_architecture_options[] = {
 	LC_OPT_ENT_BOOL    ("optcc",            "optimize calling convention",                        &opt_cc),
 	LC_OPT_ENT_BOOL    ("unsafe_floatconv", "do unsafe floating point controlword optimizations", &opt_unsafe_floatconv),
 	LC_OPT_ENT_BOOL    ("machcode",         "output machine code instead of assembler",           &emit_machcode),
+	LC_OPT_ENT_BOOL    ("elf",              "write an ELF object file instead of assembler",      &emit_elf),
 	LC_OPT_ENT_BOOL    ("soft-float",       "equivalent to fpmath=softfloat",                     &use_softfloat),
 	LC_OPT_ENT_BOOL    ("sse",              "gcc compatibility",                                  &use_sse),
 	LC_OPT_ENT_BOOL    ("sse2",             "gcc compatibility",                                  &use_sse2),
@@ -254,18 +259,23 @@ static const lc_opt_table_entry_t ia32_architecture_options[] = {
 	LC_OPT_ENT_BOOL    ("sse4a",            "gcc compatibility",                                  &use_sse4a),
 	LC_OPT_ENT_BOOL    ("sse5",             "gcc compatibility",                                  &use_sse5),
 	LC_OPT_ENT_BOOL    ("ssse3",            "gcc compatibility",                                  &use_ssse3),
+	LC_OPT_ENT_BOOL    ("popcnt",           "use the popcnt instruction",                         &use_popcnt),
+	LC_OPT_ENT_BOOL    ("lzcnt",            "use the lzcnt instruction",                          &use_lzcnt),
 	LC_OPT_LAST
 };
 
 typedef struct insn_const {
-	int      add_cost;                 /**< cost of an add instruction */
-	int      lea_cost;                 /**< cost of a lea instruction */
-	int      const_shf_cost;           /**< cost of a constant shift instruction */
-	int      cost_mul_start;           /**< starting cost of a multiply instruction */
-	int      cost_mul_bit;             /**< cost of multiply for every set bit */
-	unsigned function_alignment;       /**< logarithm for alignment of function labels */
-	unsigned label_alignment;          /**< logarithm for alignment of loops labels */
-	unsigned label_alignment_max_skip; /**< maximum skip for alignment of loops labels */
+	int      add_cost;                  /**< cost of an add instruction */
+	int      lea_cost;                  /**< cost of a lea instruction */
+	int      const_shf_cost;            /**< cost of a constant shift instruction */
+	int      cost_mul_start;            /**< starting cost of a multiply instruction */
+	int      cost_mul_bit;              /**< cost of multiply for every set bit */
+	unsigned function_alignment;        /**< logarithm for alignment of function labels */
+	unsigned label_alignment;           /**< logarithm for alignment of loops labels */
+	unsigned label_alignment_max_skip;  /**< maximum skip for alignment of loops labels */
+	unsigned prefetch_distance;         /**< distance of software prefetches in bytes */
+	unsigned branch_mispredict_penalty; /**< cycles lost by a mispredicted branch */
+	unsigned cmov_latency;              /**< latency of a cmov instruction */
 } insn_const;
 
 /* costs for optimizing for size */
@@ -278,6 +288,9 @@ static const insn_const size_cost = {
 	0,   /* logarithm for alignment of function labels */
 	0,   /* logarithm for alignment of loops labels */
 	0,   /* maximum skip for alignment of loops labels */
+	0,   /* prefetch distance in bytes */
+	0,   /* branch misprediction penalty */
+	0,   /* cmov latency */
 };
 
 /* costs for the i386 */
@@ -290,6 +303,9 @@ static const insn_const i386_cost = {
 	2,   /* logarithm for alignment of function labels */
 	2,   /* logarithm for alignment of loops labels */
 	3,   /* maximum skip for alignment of loops labels */
+	0,   /* prefetch distance in bytes */
+	0,   /* branch misprediction penalty */
+	0,   /* cmov latency */
 };
 
 /* costs for the i486 */
@@ -302,6 +318,9 @@ static const insn_const i486_cost = {
 	4,   /* logarithm for alignment of function labels */
 	4,   /* logarithm for alignment of loops labels */
 	15,  /* maximum skip for alignment of loops labels */
+	0,   /* prefetch distance in bytes */
+	0,   /* branch misprediction penalty */
+	0,   /* cmov latency */
 };
 
 /* costs for the Pentium */
@@ -314,6 +333,9 @@ static const insn_const pentium_cost = {
 	4,   /* logarithm for alignment of function labels */
 	4,   /* logarithm for alignment of loops labels */
 	7,   /* maximum skip for alignment of loops labels */
+	0,   /* prefetch distance in bytes */
+	0,   /* branch misprediction penalty */
+	0,   /* cmov latency */
 };
 
 /* costs for the Pentium Pro */
@@ -326,6 +348,9 @@ static const insn_const pentiumpro_cost = {
 	4,   /* logarithm for alignment of function labels */
 	4,   /* logarithm for alignment of loops labels */
 	10,  /* maximum skip for alignment of loops labels */
+	128, /* prefetch distance in bytes */
+	15,  /* branch misprediction penalty */
+	2,   /* cmov latency */
 };
 
 /* costs for the K6 */
@@ -338,6 +363,9 @@ static const insn_const k6_cost = {
 	5,   /* logarithm for alignment of function labels */
 	5,   /* logarithm for alignment of loops labels */
 	7,   /* maximum skip for alignment of loops labels */
+	128, /* prefetch distance in bytes */
+	0,   /* branch misprediction penalty */
+	0,   /* cmov latency */
 };
 
 /* costs for the Geode */
@@ -350,6 +378,9 @@ static const insn_const geode_cost = {
 	0,   /* logarithm for alignment of function labels */
 	0,   /* logarithm for alignment of loops labels */
 	0,   /* maximum skip for alignment of loops labels */
+	128, /* prefetch distance in bytes */
+	0,   /* branch misprediction penalty */
+	0,   /* cmov latency */
 };
 
 /* costs for the Athlon */
@@ -362,6 +393,9 @@ static const insn_const athlon_cost = {
 	4,   /* logarithm for alignment of function labels */
 	4,   /* logarithm for alignment of loops labels */
 	7,   /* maximum skip for alignment of loops labels */
+	256, /* prefetch distance in bytes */
+	10,  /* branch misprediction penalty */
+	1,   /* cmov latency */
 };
 
 /* costs for the Opteron/K8 */
@@ -374,6 +408,9 @@ static const insn_const k8_cost = {
 	4,   /* logarithm for alignment of function labels */
 	4,   /* logarithm for alignment of loops labels */
 	7,   /* maximum skip for alignment of loops labels */
+	256, /* prefetch distance in bytes */
+	12,  /* branch misprediction penalty */
+	1,   /* cmov latency */
 };
 
 /* costs for the K10 */
@@ -386,6 +423,9 @@ static const insn_const k10_cost = {
 	5,   /* logarithm for alignment of function labels */
 	5,   /* logarithm for alignment of loops labels */
 	7,   /* maximum skip for alignment of loops labels */
+	256, /* prefetch distance in bytes */
+	12,  /* branch misprediction penalty */
+	1,   /* cmov latency */
 };
 
 /* costs for the Pentium 4 */
@@ -398,6 +438,9 @@ static const insn_const netburst_cost = {
 	4,   /* logarithm for alignment of function labels */
 	4,   /* logarithm for alignment of loops labels */
 	7,   /* maximum skip for alignment of loops labels */
+	512, /* prefetch distance in bytes */
+	20,  /* branch misprediction penalty */
+	6,   /* cmov latency */
 };
 
 /* costs for the Nocona and Core */
@@ -410,6 +453,9 @@ static const insn_const nocona_cost = {
 	4,   /* logarithm for alignment of function labels */
 	4,   /* logarithm for alignment of loops labels */
 	7,   /* maximum skip for alignment of loops labels */
+	512, /* prefetch distance in bytes */
+	20,  /* branch misprediction penalty */
+	6,   /* cmov latency */
 };
 
 /* costs for the Core2 */
@@ -422,6 +468,9 @@ static const insn_const core2_cost = {
 	4,   /* logarithm for alignment of function labels */
 	4,   /* logarithm for alignment of loops labels */
 	10,  /* maximum skip for alignment of loops labels */
+	256, /* prefetch distance in bytes */
+	15,  /* branch misprediction penalty */
+	2,   /* cmov latency */
 };
 
 /* costs for the generic32 */
@@ -434,6 +483,9 @@ static const insn_const generic32_cost = {
 	4,   /* logarithm for alignment of function labels */
 	4,   /* logarithm for alignment of loops labels */
 	7,   /* maximum skip for alignment of loops labels */
+	256, /* prefetch distance in bytes */
+	15,  /* branch misprediction penalty */
+	2,   /* cmov latency */
 };
 
 static const insn_const *arch_costs = &generic32_cost;
@@ -462,16 +514,19 @@ static void set_arch_costs(void)
 	}
 }
 
-/* Evaluate the costs of an instruction. */
-int ia32_evaluate_insn(insn_kind kind, const ir_mode *mode, ir_tarval *tv)
+/**
+ * Evaluate the costs of an instruction with the cost table @p costs.
+ */
+static int evaluate_insn(insn_const const *const costs, insn_kind kind,
+                         const ir_mode *mode, ir_tarval *tv)
 {
 	int cost;
 
 	switch (kind) {
 	case MUL:
-		cost = arch_costs->cost_mul_start;
-		if (arch_costs->cost_mul_bit > 0)
-			cost += get_tarval_popcount(tv) * arch_costs->cost_mul_bit;
+		cost = costs->cost_mul_start;
+		if (costs->cost_mul_bit > 0)
+			cost += get_tarval_popcount(tv) * costs->cost_mul_bit;
 		if (get_mode_size_bits(mode) <= 32)
 			return cost;
 		/* 64bit mul supported, approx 4times of a 32bit mul*/
@@ -479,27 +534,39 @@ int ia32_evaluate_insn(insn_kind kind, const ir_mode *mode, ir_tarval *tv)
 	case LEA:
 		/* lea is only supported for 32 bit */
 		if (get_mode_size_bits(mode) <= 32)
-			return arch_costs->lea_cost;
+			return costs->lea_cost;
 		/* in 64bit mode, the Lea cost are at worst 2 shifts and one add */
-		return 2 * arch_costs->add_cost + 2 * (2 * arch_costs->const_shf_cost);
+		return 2 * costs->add_cost + 2 * (2 * costs->const_shf_cost);
 	case ADD:
 	case SUB:
 		if (get_mode_size_bits(mode) <= 32)
-			return arch_costs->add_cost;
+			return costs->add_cost;
 		/* 64bit add/sub supported, double the cost */
-		return 2 * arch_costs->add_cost;
+		return 2 * costs->add_cost;
 	case SHIFT:
 		if (get_mode_size_bits(mode) <= 32)
-			return arch_costs->const_shf_cost;
+			return costs->const_shf_cost;
 		/* 64bit shift supported, double the cost */
-		return 2 * arch_costs->const_shf_cost;
+		return 2 * costs->const_shf_cost;
 	case ZERO:
-		return arch_costs->add_cost;
+		return costs->add_cost;
 	default:
 		return 1;
 	}
 }
 
+/* Evaluate the costs of an instruction. */
+int ia32_evaluate_insn(insn_kind kind, const ir_mode *mode, ir_tarval *tv)
+{
+	return evaluate_insn(arch_costs, kind, mode, tv);
+}
+
+/* Evaluate the size of an instruction. */
+int ia32_evaluate_insn_size(insn_kind kind, const ir_mode *mode, ir_tarval *tv)
+{
+	return evaluate_insn(&size_cost, kind, mode, tv);
+}
+
 /* auto detection code only works if we're on an x86 cpu obviously */
 #ifdef NATIVE_X86
 typedef struct x86_cpu_info_t {
@@ -570,7 +637,9 @@ enum {
 	CPUID_FEAT_EDX_HTT       = 1 << 28,
 	CPUID_FEAT_EDX_TM1       = 1 << 29,
 	CPUID_FEAT_EDX_IA64      = 1 << 30,
-	CPUID_FEAT_EDX_PBE       = 1 << 31
+	CPUID_FEAT_EDX_PBE       = 1 << 31,
+
+	CPUID_FEAT_EXT_ECX_ABM   = 1 << 5,
 };
 
 static cpu_arch_features auto_detect_Intel(x86_cpu_info_t const *info)
@@ -853,6 +922,14 @@ static void autodetect_arch(void)
 			auto_arch |= arch_feature_sse4_2;
 		if (cpu_info.ecx_features & CPUID_FEAT_ECX_POPCNT)
 			auto_arch |= arch_feature_popcnt;
+
+		/* get extended feature bits */
+		x86_cpuid(&regs, 0x80000000);
+		if (regs.r.eax >= 0x80000001) {
+			x86_cpuid(&regs, 0x80000001);
+			if (regs.r.ecx & CPUID_FEAT_EXT_ECX_ABM)
+				auto_arch |= arch_feature_lzcnt;
+		}
 	}
 
 	arch     = auto_arch;
@@ -874,6 +951,10 @@ void ia32_setup_cg_config(void)
 	if (arch == cpu_autodetect)
 		autodetect_arch();
 #endif
+	if (use_popcnt)
+		arch |= arch_feature_popcnt;
+	if (use_lzcnt)
+		arch |= arch_feature_lzcnt;
 	if (opt_arch == 0)
 		opt_arch = arch;
 
@@ -909,20 +990,30 @@ void ia32_setup_cg_config(void)
 	c->use_sse_prefetch     = flags(arch, (arch_feature_3DNowE | arch_feature_sse1));
 	c->use_3dnow_prefetch   = flags(arch, arch_feature_3DNow);
 	c->use_popcnt           = flags(arch, arch_feature_popcnt);
+	c->use_lzcnt            = flags(arch, arch_feature_lzcnt);
 	c->use_bswap            = (arch & arch_mask) >= arch_i486;
 	c->use_cmpxchg          = (arch & arch_mask) != arch_i386;
 	c->optimize_cc          = opt_cc;
 	c->use_unsafe_floatconv = opt_unsafe_floatconv;
-	c->emit_machcode        = emit_machcode;
+	c->emit_elf             = emit_elf;
+	c->emit_machcode        = emit_machcode && !emit_elf;
 
 	c->function_alignment       = arch_costs->function_alignment;
 	c->label_alignment          = arch_costs->label_alignment;
 	c->label_alignment_max_skip = arch_costs->label_alignment_max_skip;
+	c->prefetch_distance
+		= c->use_sse_prefetch || c->use_3dnow_prefetch
+		? arch_costs->prefetch_distance : 0;
+	c->branch_mispredict_penalty = arch_costs->branch_mispredict_penalty;
+	c->cmov_latency              = arch_costs->cmov_latency;
 
 	c->label_alignment_factor =
 		flags(opt_arch, arch_i386 | arch_i486) || opt_size ? 0 :
 		opt_arch & arch_all_amd                            ? 3 :
 		2;
+	/* the in-order Atom suffers most from split fetch lines, elsewhere the
+	 * padding only pays off in blocks executed repeatedly per call */
+	c->label_alignment_min_freq = flags(opt_arch, arch_atom) ? 1.0 : 2.0;
 	c->po2_stack_alignment = po2_stack_alignment;
 }
 
@@ -65,6 +65,8 @@ typedef struct {
 	unsigned use_3dnow_prefetch:1;
 	/** use SSE4.2 or SSE4a popcnt instruction */
 	unsigned use_popcnt:1;
+	/** use ABM lzcnt instruction */
+	unsigned use_lzcnt:1;
 	/** use i486 instructions */
 	unsigned use_bswap:1;
 	/** use cmpxchg */
@@ -79,6 +81,8 @@ typedef struct {
 	unsigned use_unsafe_floatconv:1;
 	/** emit machine code instead of assembler */
 	unsigned emit_machcode:1;
+	/** write an ELF object file instead of assembler */
+	unsigned emit_elf:1;
 
 	/** function alignment (a power of two in bytes) */
 	unsigned function_alignment;
@@ -89,8 +93,17 @@ typedef struct {
 	/** if a blocks execfreq is factor higher than its predecessor then align
 	 *  the blocks label (0 switches off label alignment) */
 	double label_alignment_factor;
+	/** minimum execution frequency of a block relative to the function entry
+	 *  to align its label */
+	double label_alignment_min_freq;
 	/** stack alignment required at calls */
 	unsigned po2_stack_alignment;
+	/** distance of software prefetches in bytes (0 switches them off) */
+	unsigned prefetch_distance;
+	/** cycles lost by a mispredicted branch (0 if unknown) */
+	unsigned branch_mispredict_penalty;
+	/** latency of a cmov instruction */
+	unsigned cmov_latency;
 } ia32_code_gen_config_t;
 
 extern ia32_code_gen_config_t  ia32_cg_config;
@@ -121,4 +134,16 @@ void ia32_setup_cg_config(void);
  */
 int ia32_evaluate_insn(insn_kind kind, const ir_mode *mode, ir_tarval *tv);
 
+/**
+ * Evaluate the size of an instruction. Used by the irach multiplication
+ * lowerer in cold blocks.
+ *
+ * @param kind   the instruction
+ * @param mode   the mode of the instruction
+ * @param tv     for MUL instruction, the multiplication constant
+ *
+ * @return the size
+ */
+int ia32_evaluate_insn_size(insn_kind kind, const ir_mode *mode, ir_tarval *tv);
+
 #endif
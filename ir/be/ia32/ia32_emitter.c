@@ -50,6 +50,7 @@
 #include "ia32_emitter.h"
 #include "ia32_encode.h"
 #include "ia32_new_nodes.h"
+#include "irdom.h"
 #include "irgwalk.h"
 #include "irnodehashmap.h"
 #include "irtools.h"
@@ -64,6 +65,7 @@ static char       pic_base_label[128];
 static bool       omit_fp;
 static int        frame_type_size;
 static int        callframe_offset;
+static ir_node   *prologue_block;
 static ir_entity *thunks[N_ia32_gp_REGS];
 static ir_type   *thunk_type;
 
@@ -226,10 +228,11 @@ static void emit_ia32_immediate(bool const prefix, x86_imm32_t const *const imm)
 		assert(imm->kind != X86_IMM_VALUE);
 		ia32_emit_relocation(imm);
 		if (offset != 0)
-			be_emit_irprintf("%+"PRId32, offset);
+			be_emit_int_with_sign(offset);
 	} else {
 		assert(imm->kind == X86_IMM_VALUE);
-		be_emit_irprintf("0x%"PRIX32, (uint32_t)offset);
+		be_emit_cstring("0x");
+		be_emit_hex((uint32_t)offset);
 	}
 }
 
@@ -385,11 +388,11 @@ static void ia32_emit_am(ir_node const *const node)
 		const ia32_attr_t *attr = get_ia32_attr_const(node);
 		ia32_emit_relocation(&attr->am_imm);
 		if (offset != 0)
-			be_emit_irprintf("%+"PRId32, offset);
+			be_emit_int_with_sign(offset);
 	} else if (offset != 0 || (!base && !idx)) {
 		assert(attr->am_imm.kind == X86_IMM_VALUE);
 		/* also handle special case if nothing is set */
-		be_emit_irprintf("%"PRId32, offset);
+		be_emit_int(offset);
 	}
 
 	if (base || idx) {
@@ -408,8 +411,10 @@ static void ia32_emit_am(ir_node const *const node)
 			emit_register(reg, NULL);
 
 			int const scale = get_ia32_am_scale(node);
-			if (scale > 0)
-				be_emit_irprintf(",%d", 1 << scale);
+			if (scale > 0) {
+				be_emit_char(',');
+				be_emit_int(1 << scale);
+			}
 		}
 		be_emit_char(')');
 	}
@@ -677,20 +682,20 @@ emit_S:
 			case 'u':
 				if (mod & EMIT_LONG) {
 					unsigned long num = va_arg(ap, unsigned long);
-					be_emit_irprintf("%lu", num);
+					be_emit_uint(num);
 				} else {
 					unsigned num = va_arg(ap, unsigned);
-					be_emit_irprintf("%u", num);
+					be_emit_uint(num);
 				}
 				break;
 
 			case 'd':
 				if (mod & EMIT_LONG) {
 					long num = va_arg(ap, long);
-					be_emit_irprintf("%ld", num);
+					be_emit_int(num);
 				} else {
 					int num = va_arg(ap, int);
-					be_emit_irprintf("%d", num);
+					be_emit_int(num);
 				}
 				break;
 
@@ -978,7 +983,9 @@ static void emit_ia32_asm_operand(ir_node const *const node, char const modifier
 
 	case ASM_OP_MEMORY: {
 		arch_register_t const *const reg = arch_get_irn_register_in(node, op->inout_pos);
-		be_emit_irprintf("(%%%s)", reg->name);
+		be_emit_cstring("(%");
+		be_emit_string(reg->name);
+		be_emit_char(')');
 		return;
 	}
 
@@ -1387,12 +1394,51 @@ static void ia32_emit_node(ir_node *node)
 	be_emit_node(node);
 
 	if (omit_fp) {
-		int sp_change = ia32_get_sp_bias(node);
+		int sp_change = be_is_IncSP(node) ? be_get_IncSP_offset(node)
+		                                  : ia32_get_sp_bias(node);
 		if (sp_change != 0) {
 			assert(sp_change != SP_BIAS_RESET);
 			callframe_offset += sp_change;
 			be_dwarf_callframe_offset(callframe_offset);
 		}
+	} else if (get_nodes_block(node) == prologue_block
+	        && prologue_block != get_irg_start_block(get_irn_irg(node))) {
+		/* track the shrink-wrapped prologue; ebp is not allocatable, so
+		 * only the prologue pushes it and copies esp into it */
+		arch_register_t const *const bp = &ia32_registers[REG_EBP];
+		if (is_ia32_Push(node)
+		 && arch_get_irn_register_in(node, n_ia32_Push_val) == bp) {
+			be_dwarf_callframe_offset(8);
+			be_dwarf_callframe_spilloffset(bp, -8);
+		} else if (be_is_Copy(node) && arch_get_irn_register(node) == bp) {
+			be_dwarf_callframe_register(bp);
+		}
+	}
+}
+
+/**
+ * Describe the call frame at the begin of a block outside of the region
+ * set up by a shrink-wrapped prologue (@p has_frame false) or inside it.
+ */
+static void emit_block_callframe(ir_node const *const block, bool const has_frame)
+{
+	if (omit_fp) {
+		callframe_offset = 4; /* 4 bytes for the return address */
+		/* ESP guessing, TODO perform a real ESP simulation */
+		if (has_frame && block != prologue_block)
+			callframe_offset += frame_type_size;
+		be_dwarf_callframe_offset(callframe_offset);
+	} else if (prologue_block != get_irg_start_block(get_irn_irg(block))) {
+		arch_register_t const *const bp = &ia32_registers[REG_EBP];
+		if (has_frame && block != prologue_block) {
+			be_dwarf_callframe_register(bp);
+			be_dwarf_callframe_offset(8);
+			be_dwarf_callframe_spilloffset(bp, -8);
+		} else {
+			be_dwarf_callframe_register(&ia32_registers[REG_ESP]);
+			be_dwarf_callframe_offset(4);
+			be_dwarf_callframe_restore(bp);
+		}
 	}
 }
 
@@ -1417,46 +1463,18 @@ static void ia32_emit_align_label(void)
 /**
  * Test whether a block should be aligned.
  * For cpus in the P4/Athlon class it is useful to align jump labels to
- * 16 bytes. However we should only do that if the alignment nops before the
- * label aren't executed more often than we have jumps to the label.
+ * 16 bytes. However we should only do that for hot blocks and if the
+ * alignment nops before the label aren't executed more often than we have
+ * jumps to the label.
  */
 bool ia32_should_align_block(ir_node const *const block)
 {
-	static const double DELTA = .0001;
-	ir_node *prev      = be_emit_get_prev_block(block);
-	double   prev_freq = 0;  /**< execfreq of the fallthrough block */
-	double   jmp_freq  = 0;  /**< execfreq of all non-fallthrough blocks */
-
-	if (ia32_cg_config.label_alignment_factor <= 0)
+	if (ia32_cg_config.label_alignment == 0
+	 || ia32_cg_config.label_alignment_factor <= 0)
 		return false;
-
-	double block_freq = get_block_execfreq(block);
-	if (block_freq < DELTA)
-		return false;
-
-	for (int i = 0, n_cfgpreds = get_Block_n_cfgpreds(block);
-	     i < n_cfgpreds; ++i) {
-		const ir_node *pred      = get_Block_cfgpred_block(block, i);
-		double         pred_freq = get_block_execfreq(pred);
-
-		if (pred == prev) {
-			assert (pred_freq > 0.0f && "Might result in NaN below!?!");
-			prev_freq += pred_freq;
-		} else {
-			jmp_freq  += pred_freq;
-		}
-	}
-	if (prev_freq == 0.0)
-		/* Prev-by-schedule block never falls-through => align! */
-		return true;
-
-	if (prev_freq < DELTA && !(jmp_freq < DELTA))
-		return true;
-
-	jmp_freq /= prev_freq;
-	assert (jmp_freq == jmp_freq && "NaN!");
-
-	return jmp_freq > ia32_cg_config.label_alignment_factor;
+	return be_emit_should_align_block(block,
+	                                  ia32_cg_config.label_alignment_factor,
+	                                  ia32_cg_config.label_alignment_min_freq);
 }
 
 /**
@@ -1471,29 +1489,8 @@ static void ia32_emit_block_header(ir_node *block)
 	if (block == get_irg_end_block(irg))
 		return;
 
-	if (ia32_cg_config.label_alignment > 0) {
-		/* align the current block if:
-		 * a) if should be aligned due to its execution frequency
-		 * b) there is no fall-through here
-		 */
-		if (ia32_should_align_block(block)) {
-			ia32_emit_align_label();
-		} else {
-			/* if the predecessor block has no fall-through,
-			   we can always align the label. */
-			bool has_fallthrough = false;
-			for (int i = get_Block_n_cfgpreds(block); i-- > 0; ) {
-				ir_node *pred_block = get_Block_cfgpred(block, i);
-				if (is_fallthrough(pred_block)) {
-					has_fallthrough = true;
-					break;
-				}
-			}
-
-			if (!has_fallthrough)
-				ia32_emit_align_label();
-		}
-	}
+	if (ia32_should_align_block(block))
+		ia32_emit_align_label();
 
 	const bool need_label = block_needs_label(block);
 	be_gas_begin_block(block, need_label);
@@ -1507,15 +1504,7 @@ static void ia32_gen_block(ir_node *block)
 {
 	ia32_emit_block_header(block);
 
-	if (omit_fp) {
-		ir_graph *irg = get_irn_irg(block);
-		callframe_offset = 4; /* 4 bytes for the return address */
-		/* ESP guessing, TODO perform a real ESP simulation */
-		if (block != get_irg_start_block(irg)) {
-			callframe_offset += frame_type_size;
-		}
-		be_dwarf_callframe_offset(callframe_offset);
-	}
+	emit_block_callframe(block, block_dominates(prologue_block, block));
 
 	/* emit the contents of the block */
 	be_dwarf_location(get_irn_dbg_info(block));
@@ -1524,19 +1513,31 @@ static void ia32_gen_block(ir_node *block)
 	}
 }
 
-static void emit_function_text(ir_graph *const irg, ir_node *const *const blk_sched)
+static void emit_function_text(ir_graph *const irg, ir_node **const blk_sched)
 {
 	ia32_register_emitters();
 
 	/* we use links to point to target blocks */
 	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
 
+	ir_entity *const entity   = get_irg_entity(irg);
+	size_t     const n_blocks = ARR_LEN(blk_sched);
+	size_t     const n_hot    = be_gas_can_split_function(entity)
+		? be_split_cold_blocks(blk_sched) : n_blocks;
+
 	be_emit_init_cf_links(blk_sched);
+	/* the hot part never falls through into the cold part */
+	if (n_hot < n_blocks)
+		set_irn_link(blk_sched[n_hot], NULL);
 
-	for (size_t i = 0, n = ARR_LEN(blk_sched); i < n; ++i) {
+	for (size_t i = 0; i < n_blocks; ++i) {
+		if (i == n_hot)
+			be_gas_begin_cold_part(entity);
 		ir_node *const block = blk_sched[i];
 		ia32_gen_block(block);
 	}
+	if (n_hot < n_blocks)
+		be_gas_end_cold_part(entity);
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
 }
 
@@ -1589,6 +1590,11 @@ static unsigned emit_jit_entity_relocation_asm(char *const buffer,
 
 void ia32_emit_function(ir_graph *const irg)
 {
+	if (ia32_cg_config.emit_elf) {
+		ia32_emit_elf_function(irg);
+		return;
+	}
+
 	be_gas_elf_type_char = '@';
 	get_unique_label(pic_base_label, sizeof(pic_base_label), "PIC_BASE");
 
@@ -1596,11 +1602,17 @@ void ia32_emit_function(ir_graph *const irg)
 	be_gas_emit_function_prolog(entity, ia32_cg_config.function_alignment,
 	                            NULL);
 
-	omit_fp = ia32_get_irg_data(irg)->omit_fp;
+	ia32_irg_data_t const *const irg_data = ia32_get_irg_data(irg);
+	omit_fp        = irg_data->omit_fp;
+	prologue_block = irg_data->prologue_block;
+	if (prologue_block != get_irg_start_block(irg))
+		assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
 	if (omit_fp) {
 		ir_type *frame_type = get_irg_frame_type(irg);
 		frame_type_size = get_type_size(frame_type);
 		be_dwarf_callframe_register(&ia32_registers[REG_ESP]);
+	} else if (prologue_block != get_irg_start_block(irg)) {
+		/* the blocks describe their call frame themselves */
 	} else {
 		/* well not entirely correct here, we should emit this after the
 		 * "movl esp, ebp" */
@@ -1618,7 +1630,7 @@ void ia32_emit_function(ir_graph *const irg)
 		be_jit_emit_as_asm(function, emit_jit_entity_relocation_asm);
 		be_destroy_jit_segment(segment);
 	} else {
-		ir_node *const *const blk_sched = be_create_block_schedule(irg);
+		ir_node **const blk_sched = be_create_block_schedule(irg);
 
 		if (be_options.exceptions) {
 			be_exc_init(entity, blk_sched);
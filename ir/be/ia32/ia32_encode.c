@@ -15,6 +15,7 @@
 #include "bearch_ia32_t.h"
 #include "beblocksched.h"
 #include "beemithlp.h"
+#include "beelf.h"
 #include "begnuas.h"
 #include "bejit.h"
 #include "besched.h"
@@ -25,7 +26,13 @@
 #include "ia32_emitter.h"
 #include "ia32_new_nodes.h"
 #include "irnodehashmap.h"
+#include "panic.h"
 #include "x86_cc.h"
+#include "x86_encode.h"
+
+/* i386 relocation types of the System V ABI */
+#define R_386_32   1
+#define R_386_PC32 2
 
 static ir_nodehashmap_t block_fragmentnum;
 
@@ -288,6 +295,13 @@ static void enc_copy(const ir_node *copy)
 	enc_mov(in, out);
 }
 
+static void enc_copyebpesp(ir_node const *const node)
+{
+	arch_register_t const *const in  = arch_get_irn_register_in(node, 0);
+	arch_register_t const *const out = arch_get_irn_register_out(node, 0);
+	enc_mov(in, out);
+}
+
 static void enc_perm(const ir_node *node)
 {
 	arch_register_t       const *const reg0 = arch_get_irn_register_out(node, 0);
@@ -754,6 +768,30 @@ zero_neg:
 	enc_helper_sbb( in_hi, out_hi);
 }
 
+/* helper function for enc_cmp64 */
+static void enc_helper_arith(unsigned const ext, ir_node const *const right,
+                             arch_register_t const *const left)
+{
+	if (is_ia32_Immediate(right)) {
+		ia32_immediate_attr_t const *const attr = get_ia32_immediate_attr_const(right);
+		unsigned const size = ia32_is_8bit_imm(attr) ? 8 : 32;
+		be_emit8(0x80 | (size == 8 ? OP_16_32_IMM8 : OP_16_32));
+		enc_modru(left, ext);
+		enc_imm(attr, size);
+	} else {
+		be_emit8(ext << 3 | OP_MEM_SRC | OP_16_32);
+		enc_modrr(arch_get_irn_register(right), left);
+	}
+}
+
+static void enc_cmp64(const ir_node *node)
+{
+	arch_register_t const *const left_low = arch_get_irn_register_in(node, n_ia32_Cmp64_left_low);
+	arch_register_t const *const scratch  = arch_get_irn_register_out(node, pn_ia32_Cmp64_scratch);
+	enc_helper_arith(7, get_irn_n(node, n_ia32_Cmp64_right_low), left_low);
+	enc_helper_arith(3, get_irn_n(node, n_ia32_Cmp64_right_high), scratch);
+}
+
 /**
  * Emits a MOV out, [MEM].
  */
@@ -838,6 +876,12 @@ static void enc_popcnt(ir_node const *const node)
 	ia32_enc_0f_unop_reg(node, 0xB8, n_ia32_Popcnt_operand);
 }
 
+static void enc_lzcnt(ir_node const *const node)
+{
+	be_emit8(0xF3);
+	ia32_enc_0f_unop_reg(node, 0xBD, n_ia32_Lzcnt_operand);
+}
+
 /**
  * Emit a Push.
  */
@@ -1005,6 +1049,9 @@ static void enc_ia32_jcc(const ir_node *node)
 
 static void enc_switchjmp(const ir_node *node)
 {
+	/* ia32_lower_for_target() lowers all switches for ELF output */
+	assert(!ia32_cg_config.emit_elf);
+
 	be_emit8(0xFF); // jmp *tbl.label(,%in,4)
 	enc_mod_am(0x05, node);
 
@@ -1013,6 +1060,25 @@ static void enc_switchjmp(const ir_node *node)
 	                   ia32_emit_jumptable_target);
 }
 
+static void enc_tail_call(ir_node const *const node)
+{
+	ir_node *const callee = get_irn_n(node, n_ia32_TailCall_callee);
+	if (is_ia32_Immediate(callee)) {
+		x86_imm32_t const *const imm
+			= &get_ia32_immediate_attr_const(callee)->imm;
+		assert(imm->kind == X86_IMM_PCREL);
+		be_emit8(0xE9);
+		x86_imm32_t const jmp_imm = {
+			.kind   = X86_IMM_PCREL,
+			.entity = imm->entity,
+			.offset = imm->offset - 4,
+		};
+		enc_relocation(&jmp_imm);
+	} else {
+		ia32_enc_unop(node, 0xFF, 4, n_ia32_TailCall_callee);
+	}
+}
+
 static void enc_return(const ir_node *node)
 {
 	const ia32_return_attr_t *attr = get_ia32_return_attr_const(node);
@@ -1268,6 +1334,7 @@ static void ia32_register_binary_emitters(void)
 	be_set_emitter(op_be_IncSP,           enc_incsp);
 	be_set_emitter(op_be_Perm,            enc_perm);
 	be_set_emitter(op_ia32_Return,        enc_return);
+	be_set_emitter(op_ia32_TailCall,      enc_tail_call);
 	be_set_emitter(op_ia32_Bswap,         enc_bswap);
 	be_set_emitter(op_ia32_Bt,            enc_bt);
 	be_set_emitter(op_ia32_CMovcc,        enc_cmovcc);
@@ -1275,6 +1342,7 @@ static void ia32_register_binary_emitters(void)
 	be_set_emitter(op_ia32_Const,         enc_mov_const);
 	be_set_emitter(op_ia32_Conv_I2I,      enc_conv_i2i);
 	be_set_emitter(op_ia32_CopyB_i,       enc_copybi);
+	be_set_emitter(op_ia32_CopyEbpEsp,    enc_copyebpesp);
 	be_set_emitter(op_ia32_Dec,           enc_dec);
 	be_set_emitter(op_ia32_FldCW,         enc_fldcw);
 	be_set_emitter(op_ia32_FnstCW,        enc_fnstcw);
@@ -1289,9 +1357,11 @@ static void ia32_register_binary_emitters(void)
 	be_set_emitter(op_ia32_LdTls,         enc_ldtls);
 	be_set_emitter(op_ia32_Lea,           enc_lea);
 	be_set_emitter(op_ia32_Load,          enc_load);
+	be_set_emitter(op_ia32_Cmp64,         enc_cmp64);
 	be_set_emitter(op_ia32_Minus64,       enc_minus64);
 	be_set_emitter(op_ia32_Pop,           enc_pop);
 	be_set_emitter(op_ia32_PopMem,        enc_popmem);
+	be_set_emitter(op_ia32_Lzcnt,         enc_lzcnt);
 	be_set_emitter(op_ia32_Popcnt,        enc_popcnt);
 	be_set_emitter(op_ia32_Push,          enc_push);
 	be_set_emitter(op_ia32_PushEax,       enc_pusheax);
@@ -1324,7 +1394,7 @@ static void gen_binary_block(ir_node *const block)
 	uint8_t p2align  = 0;
 	uint8_t max_skip = 0;
 	if (block != get_irg_end_block(irg)
-	 && ia32_cg_config.label_alignment > 0 && ia32_should_align_block(block)) {
+	 && ia32_should_align_block(block)) {
 		p2align  = ia32_cg_config.label_alignment;
 		max_skip = ia32_cg_config.label_alignment_max_skip;
 	}
@@ -1372,47 +1442,8 @@ ir_jit_function_t *ia32_emit_jit(ir_jit_segment_t *const segment,
 	return be_jit_finish_function();
 }
 
-static void enc_nop_callback(char *buffer, unsigned size)
-{
-	memset(buffer, 0, size);
-	while (size > 0) {
-		switch (size) {
-		case 1: buffer[0] = 0x90; return;
-		case 2:
-			buffer[0] = 0x66;
-			++buffer;
-			--size;
-			continue;
-		case 3:
-		sequence_0f1f:
-			buffer[0] = 0x0F;
-			buffer[1] = 0x1F;
-			return;
-		case 4: buffer[2] = 0x40; goto sequence_0f1f;
-		case 5: buffer[2] = 0x44; goto sequence_0f1f;
-		case 6:
-			buffer[0] = 0x66;
-			++buffer;
-			--size;
-			continue;
-		case 7: buffer[2] = 0x80; goto sequence_0f1f;
-		case 8: buffer[2] = 0x84; goto sequence_0f1f;
-		default:
-			buffer[0] = 0x66;
-			buffer[1] = 0x0F;
-			buffer[2] = 0x1F;
-			buffer[3] = 0x84;
-			buffer += 9;
-			size   -= 9;
-			continue;
-		}
-	}
-}
-
-static unsigned enc_relocation_callback(char *const buffer,
-                                        uint8_t const be_kind,
-                                        ir_entity *const entity,
-                                        int32_t const offset)
+unsigned ia32_emit_jit_relocation(char *const buffer, uint8_t const be_kind,
+                                  ir_entity *const entity, int32_t const offset)
 {
 	uint32_t value;
 	if (entity == NULL) {
@@ -1424,7 +1455,7 @@ static unsigned enc_relocation_callback(char *const buffer,
 			panic("Could not resolve address of entity %+F", entity);
 		intptr_t addr = entity_addr + offset;
 		if (be_kind == X86_IMM_PCREL)
-			addr -= (intptr_t)buffer;
+			addr -= (intptr_t)be_jit_exec_address(buffer);
 		value = (uint32_t)addr;
 		if ((intptr_t)value != addr)
 			panic("Overflow in relocation");
@@ -1437,8 +1468,59 @@ static unsigned enc_relocation_callback(char *const buffer,
 void ia32_emit_jit_function(char *buffer, ir_jit_function_t *const function)
 {
 	static const be_jit_emit_interface_t jit_emit_interface = {
-		.nops       = enc_nop_callback,
-		.relocation = enc_relocation_callback,
+		.nops       = x86_enc_nops,
+		.relocation = ia32_emit_jit_relocation,
 	};
 	be_jit_emit_memory(buffer, function, &jit_emit_interface);
 }
+
+static unsigned enc_elf_relocation_callback(char *const buffer,
+                                            uint8_t const be_kind,
+                                            ir_entity *const entity,
+                                            int32_t const offset)
+{
+	/* Intra function jumps are resolved already, everything else gets a
+	 * relocation with the addend stored in place. */
+	memcpy(buffer, &offset, 4);
+	if (entity == NULL) {
+		assert(be_kind == IA32_RELOCATION_RELJUMP);
+		return 4;
+	}
+
+	uint32_t type;
+	switch ((x86_immediate_kind_t)be_kind) {
+	case X86_IMM_ADDR:  type = R_386_32;   break;
+	case X86_IMM_PCREL: type = R_386_PC32; break;
+	default:
+		panic("relocation kind %u to %+F not supported in ELF object files",
+		      be_kind, entity);
+	}
+	be_elf_relocation(buffer, type, entity, offset);
+	return 4;
+}
+
+be_elf_target_t const ia32_elf_target = {
+	.machine   = 3, /* EM_386 */
+	.elf64     = false,
+	.rela      = false,
+	.reloc_abs = R_386_32,
+	.nops      = x86_enc_nops,
+};
+
+void ia32_emit_elf_function(ir_graph *const irg)
+{
+	ir_jit_segment_t  *const segment  = be_new_jit_segment();
+	ir_jit_function_t *const function = ia32_emit_jit(segment, irg);
+
+	char *const buffer
+		= be_elf_begin_function(get_irg_entity(irg),
+		                        ia32_cg_config.function_alignment,
+		                        be_get_function_size(function));
+	static const be_jit_emit_interface_t elf_emit_interface = {
+		.nops       = x86_enc_nops,
+		.relocation = enc_elf_relocation_callback,
+	};
+	be_jit_emit_memory(buffer, function, &elf_emit_interface);
+
+	be_destroy_jit_segment(segment);
+}
@@ -12,6 +12,7 @@
 #define FIRM_BE_IA32_IA32_ENCODE_H
 
 #include <stdint.h>
+#include "beelf.h"
 #include "firm_types.h"
 #include "jit.h"
 
@@ -23,6 +24,15 @@ ir_jit_function_t *ia32_emit_jit(ir_jit_segment_t *segment, ir_graph *irg);
 
 void ia32_emit_jit_function(char *buffer, ir_jit_function_t *function);
 
+unsigned ia32_emit_jit_relocation(char *buffer, uint8_t be_kind,
+                                  ir_entity *entity, int32_t offset);
+
+/** Target description to write i386 ELF object files. */
+extern be_elf_target_t const ia32_elf_target;
+
+/** Encodes the function @p irg into the ELF object file. */
+void ia32_emit_elf_function(ir_graph *irg);
+
 void ia32_enc_simple(uint8_t opcode);
 
 void ia32_enc_binop(ir_node const *node, unsigned code);
@@ -24,6 +24,9 @@
 #include "irgwalk.h"
 #include "tv.h"
 #include "array.h"
+#include "execfreq.h"
+#include "irdom.h"
+#include "pmap.h"
 
 #include "bearch.h"
 #include "besched.h"
@@ -86,9 +89,75 @@ static ir_node *create_fpu_mode_spill(void *const env, ir_node *const state, boo
 	return spill;
 }
 
+/**
+ * Computes the truncating control word from the rounding control word
+ * @p last_state and stores it to a fresh frame slot after @p after.
+ * Returns the memory of the store.
+ */
+static ir_node *create_truncate_word(ir_node *const last_state, ir_node *const after)
+{
+	ir_node  *const block = get_nodes_block(after);
+	ir_graph *const irg   = get_irn_irg(block);
+	ir_node  *const noreg = ia32_new_NoReg_gp(irg);
+	ir_node  *const nomem = get_irg_no_mem(irg);
+	ir_node  *const frame = get_irg_frame(irg);
+
+	ir_node *const cwstore = create_fnstcw(block, frame, noreg, nomem, last_state);
+	sched_add_after(after, cwstore);
+
+	ir_node *const load = new_bd_ia32_Load(NULL, block, frame, noreg, cwstore);
+	set_ia32_op_type(load, ia32_AddrModeS);
+	set_ia32_ls_mode(load, mode_Hu);
+	set_ia32_frame_use(load, IA32_FRAME_USE_32BIT);
+	sched_add_after(cwstore, load);
+
+	ir_node *const load_res = be_new_Proj(load, pn_ia32_Load_res);
+
+	/* TODO: Make the actual mode configurable in ChangeCW. */
+	ir_node *const or_const = ia32_create_Immediate(irg, 0xC00);
+	ir_node *const orn      = new_bd_ia32_Or(NULL, block, noreg, noreg, nomem, load_res, or_const);
+	sched_add_after(load, orn);
+
+	ir_node *const store = new_bd_ia32_Store(NULL, block, frame, noreg, nomem, orn);
+	set_ia32_op_type(store, ia32_AddrModeD);
+	/* Use ia32_mode_gp, as movl has a shorter opcode than movw. */
+	set_ia32_ls_mode(store, ia32_mode_gp);
+	set_ia32_frame_use(store, IA32_FRAME_USE_32BIT);
+	sched_add_after(orn, store);
+	return be_new_Proj(store, pn_ia32_Store_M);
+}
+
+/**
+ * Returns the memory holding the truncating control word derived from
+ * @p last_state for a switch before @p before.
+ *
+ * The word only depends on @p last_state, so it is computed once directly
+ * after the definition of @p last_state, unless that point is executed more
+ * often than the switch.  Later switches from the same state reuse a
+ * dominating computation and only need the fldcw.
+ */
+static ir_node *get_truncate_word(pmap *const truncate_words, ir_node *const last_state, ir_node *const before)
+{
+	ir_node *mem = pmap_get(ir_node, truncate_words, last_state);
+	if (mem && value_strictly_dominates(skip_Proj(mem), before))
+		return mem;
+
+	ir_node *const def_block = get_nodes_block(last_state);
+	ir_node *const use_block = get_nodes_block(before);
+	ir_node       *after;
+	if (def_block != use_block && block_dominates(def_block, use_block)
+	 && get_block_execfreq(def_block) <= get_block_execfreq(use_block)) {
+		after = be_move_after_schedule_first(skip_Proj(last_state));
+	} else {
+		after = sched_prev(before);
+	}
+	mem = create_truncate_word(last_state, after);
+	pmap_insert(truncate_words, last_state, mem);
+	return mem;
+}
+
 static ir_node *create_fpu_mode_reload(void *const env, ir_node *const state, ir_node *const spill, ir_node *const before, ir_node *const last_state)
 {
-	(void)env;
 	(void)state;
 
 	ir_node        *reload;
@@ -109,29 +178,7 @@ static ir_node *create_fpu_mode_reload(void *const env, ir_node *const state, ir
 			mem = spill;
 		} else {
 			assert(last_state);
-			ir_node *const cwstore = create_fnstcw(block, frame, noreg, nomem, last_state);
-			sched_add_before(before, cwstore);
-
-			ir_node *const load = new_bd_ia32_Load(NULL, block, frame, noreg, cwstore);
-			set_ia32_op_type(load, ia32_AddrModeS);
-			set_ia32_ls_mode(load, mode_Hu);
-			set_ia32_frame_use(load, IA32_FRAME_USE_32BIT);
-			sched_add_before(before, load);
-
-			ir_node *const load_res = be_new_Proj(load, pn_ia32_Load_res);
-
-			/* TODO: Make the actual mode configurable in ChangeCW. */
-			ir_node *const or_const = ia32_create_Immediate(irg, 0xC00);
-			ir_node *const orn      = new_bd_ia32_Or(NULL, block, noreg, noreg, nomem, load_res, or_const);
-			sched_add_before(before, orn);
-
-			ir_node *const store = new_bd_ia32_Store(NULL, block, frame, noreg, nomem, orn);
-			set_ia32_op_type(store, ia32_AddrModeD);
-			/* Use ia32_mode_gp, as movl has a shorter opcode than movw. */
-			set_ia32_ls_mode(store, ia32_mode_gp);
-			set_ia32_frame_use(store, IA32_FRAME_USE_32BIT);
-			sched_add_before(before, store);
-			mem = be_new_Proj(store, pn_ia32_Store_M);
+			mem = get_truncate_word((pmap*)env, last_state, before);
 		}
 
 		reload = new_bd_ia32_FldCW(NULL, block, frame, noreg, mem);
@@ -207,6 +254,8 @@ void ia32_setup_fpu_mode(ir_graph *irg)
 	rewire_fpu_mode_nodes(irg);
 
 	/* ensure correct fpu mode for operations */
+	pmap *const truncate_words = pmap_create();
 	be_assure_state(irg, &ia32_registers[REG_FPCW],
-	                NULL, create_fpu_mode_spill, create_fpu_mode_reload);
+	                truncate_words, create_fpu_mode_spill, create_fpu_mode_reload);
+	pmap_destroy(truncate_words);
 }
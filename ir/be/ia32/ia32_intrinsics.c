@@ -438,6 +438,49 @@ static void ia32_lower_conv64(ir_node *node, ir_mode *mode)
 	}
 }
 
+/**
+ * Creates an ordered 64bit comparison.  It is computed without branches by
+ * a compare of the low words followed by a subtract with borrow of the high
+ * words.
+ */
+static ir_node *ia32_create_cmp64(dbg_info *dbgi, ir_node *block,
+                                  const lower64_entry_t *left,
+                                  const lower64_entry_t *right,
+                                  ir_relation relation)
+{
+	relation &= ir_relation_less_equal_greater;
+
+	/* a < c and a >= c only depend on the high word if the low word of c is
+	 * zero, the generic lowering yields a single compare then */
+	ir_node *right_low = right->low_word;
+	if ((relation == ir_relation_less || relation == ir_relation_greater_equal)
+	    && is_Const(right_low) && is_Const_null(right_low))
+		return NULL;
+
+	/* the subtraction only yields < and >=, so a > b becomes b < a and
+	 * a <= b becomes b >= a */
+	switch (relation) {
+	case ir_relation_less:
+		return new_bd_ia32_l_Less64(dbgi, block,
+		                            left->low_word, left->high_word,
+		                            right->low_word, right->high_word);
+	case ir_relation_greater:
+		return new_bd_ia32_l_Less64(dbgi, block,
+		                            right->low_word, right->high_word,
+		                            left->low_word, left->high_word);
+	case ir_relation_less_equal:
+		return new_bd_ia32_l_GreaterEqual64(dbgi, block,
+		                                    right->low_word, right->high_word,
+		                                    left->low_word, left->high_word);
+	case ir_relation_greater_equal:
+		return new_bd_ia32_l_GreaterEqual64(dbgi, block,
+		                                    left->low_word, left->high_word,
+		                                    right->low_word, right->high_word);
+	default:
+		return NULL;
+	}
+}
+
 static ir_entity *ia32_create_intrinsic_fkt(ir_type *method, const ir_op *op,
                                             const ir_mode *imode,
                                             const ir_mode *omode, void *context)
@@ -468,6 +511,7 @@ void ia32_lower64(void)
 		word_signed,
 		64,    /* doubleword size */
 		be_is_big_endian(),
+		ia32_create_cmp64,
 	};
 
 	ir_prepare_dw_lowering(&lower_dw_params);
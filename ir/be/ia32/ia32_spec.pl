@@ -598,6 +598,22 @@ l_Sbb => {
 	dump_func => "NULL",
 },
 
+# Ordered doubleword comparisons created by the 64bit lowering, they are
+# signed if the high words are.
+l_Less64 => {
+	ins       => [ "left_low", "left_high", "right_low", "right_high" ],
+	attr_type => "",
+	dump_func => "NULL",
+	mode      => "mode_b",
+},
+
+l_GreaterEqual64 => {
+	ins       => [ "left_low", "left_high", "right_low", "right_high" ],
+	attr_type => "",
+	dump_func => "NULL",
+	mode      => "mode_b",
+},
+
 IDiv => {
 	template => $divop,
 	emit     => "idiv%M %AS3",
@@ -798,6 +814,19 @@ Cmp => {
 	latency  => 1,
 },
 
+# Compares two doublewords by a cmp of the low words followed by a sbb of the
+# high words, which leaves the difference of the high words in scratch.
+Cmp64 => {
+	irn_flags => [ "modify_flags", "rematerializable" ],
+	in_reqs   => [ "gp", "gp", "gp", "gp" ],
+	out_reqs  => [ "flags", "in_r1 !in_r0 !in_r2 !in_r3" ],
+	ins       => [ "left_low", "left_high", "right_low", "right_high" ],
+	outs      => [ "eflags", "scratch" ],
+	emit      => "cmpl %S2, %S0\n".
+	             "sbbl %S3, %D1",
+	latency   => 2,
+},
+
 XorHighLow => {
 	irn_flags => [ "modify_flags", "rematerializable" ],
 	state     => "exc_pinned",
@@ -1178,6 +1207,13 @@ Popcnt => {
 	latency  => 1,
 },
 
+# ABM lzcnt instruction
+Lzcnt => {
+	template => $unop_from_mem,
+	emit     => "lzcnt%M %AS3, %D0",
+	latency  => 1,
+},
+
 Return => {
 	state     => "pinned",
 	op_flags  => [ "cfopcode" ],
@@ -1189,6 +1225,16 @@ Return => {
 	latency   => 0,
 },
 
+TailCall => {
+	state     => "pinned",
+	op_flags  => [ "cfopcode" ],
+	in_reqs   => "...",
+	out_reqs  => [ "exec" ],
+	ins       => [ "mem", "stack", "callee", "first_argument" ],
+	emit      => "jmp %*S2",
+	latency   => 0,
+},
+
 Call => {
 	op_flags  => [ "uses_memory", "fragile" ],
 	irn_flags => [ "modify_flags" ],
@@ -54,6 +54,7 @@
 DEBUG_ONLY(static firm_dbg_module_t *dbg;)
 
 static x86_cconv_t          *current_cconv;
+static bool                  sibling_calls;
 static be_stack_env_t        stack_env;
 static ir_heights_t         *heights;
 static x86_immediate_kind_t  lconst_imm_kind;
@@ -2252,6 +2253,16 @@ static ir_node *get_flags_node(ir_node *cmp, x86_condition_code_t *cc_out)
 		return new_bd_ia32_Stc(dbgi, block);
 	}
 
+	if (is_ia32_l_Less64(cmp) || is_ia32_l_GreaterEqual64(cmp)) {
+		ir_node *high = get_irn_n(cmp, n_ia32_l_Less64_left_high);
+		bool     less = is_ia32_l_Less64(cmp);
+		if (mode_is_signed(get_irn_mode(high)))
+			*cc_out = less ? x86_cc_less : x86_cc_greater_equal;
+		else
+			*cc_out = less ? x86_cc_below : x86_cc_above_equal;
+		return be_transform_node(cmp);
+	}
+
 	/* must have a Cmp as input */
 	ir_relation relation = get_Cmp_relation(cmp);
 	ir_node    *l        = get_Cmp_left(cmp);
@@ -4278,8 +4289,17 @@ static ir_node *gen_Proj_Proj_Start(ir_node *node)
 	return be_get_Start_proj(irg, param->reg);
 }
 
+static ir_node *gen_sibling_call(ir_node *node, ir_node *call);
+
 static ir_node *gen_Return(ir_node *node)
 {
+	ir_node *const call = sibling_calls ? be_get_sibling_call(node) : NULL;
+	if (call != NULL) {
+		ir_node *const tail_call = gen_sibling_call(node, call);
+		if (tail_call != NULL)
+			return tail_call;
+	}
+
 	ir_graph *irg       = get_irn_irg(node);
 	ir_node  *new_block = be_transform_nodes_block(node);
 	dbg_info *dbgi      = get_irn_dbg_info(node);
@@ -4500,6 +4520,29 @@ static ir_node *gen_ia32_l_Sbb(ir_node *node)
 	                       match_am | match_immediate | match_mode_neutral);
 }
 
+/**
+ * Transforms an ordered 64bit comparison into a Cmp64, whose flags reflect
+ * the difference of the doublewords.
+ */
+static ir_node *gen_ia32_l_Cmp64(ir_node *node)
+{
+	/* l_Less64 and l_GreaterEqual64 have the same inputs */
+	dbg_info *dbgi       = get_irn_dbg_info(node);
+	ir_node  *new_block  = be_transform_nodes_block(node);
+	ir_node  *left_low   = get_irn_n(node, n_ia32_l_Less64_left_low);
+	ir_node  *left_high  = get_irn_n(node, n_ia32_l_Less64_left_high);
+	ir_node  *right_low  = get_irn_n(node, n_ia32_l_Less64_right_low);
+	ir_node  *right_high = get_irn_n(node, n_ia32_l_Less64_right_high);
+	ir_node  *new_ll     = be_transform_node(left_low);
+	ir_node  *new_lh     = be_transform_node(left_high);
+	ir_node  *new_rl     = create_immediate_or_transform(right_low, 'i');
+	ir_node  *new_rh     = create_immediate_or_transform(right_high, 'i');
+	ir_node  *cmp        = new_bd_ia32_Cmp64(dbgi, new_block, new_ll, new_lh,
+	                                         new_rl, new_rh);
+	SET_IA32_ORIG_NODE(cmp, node);
+	return be_new_Proj(cmp, pn_ia32_Cmp64_eflags);
+}
+
 static ir_node *gen_ia32_l_Minus64(ir_node *node)
 {
 	dbg_info *dbgi      = get_irn_dbg_info(node);
@@ -4935,6 +4978,82 @@ static bool callee_is_plt(ir_node *callee)
 	    && be_get_Relocation_kind(callee) == X86_IMM_PLT;
 }
 
+/**
+ * Turns a Call whose results are returned unchanged into a jump after the
+ * epilogue.  Writing stack arguments over our own incoming arguments is not
+ * supported, so only callees taking their parameters in registers (or none)
+ * are handled.
+ */
+static ir_node *gen_sibling_call(ir_node *const node, ir_node *const call)
+{
+	ir_node *const callee = get_Call_ptr(call);
+	/* PLT calls need the GOT address in ebx, which the epilogue restores,
+	 * and the JIT cannot relocate a jump. */
+	if (current_cconv->sp_delta != 0 || callee_is_plt(callee)
+	 || ia32_cg_config.emit_machcode)
+		return NULL;
+
+	ir_type     *const type  = get_Call_type(call);
+	x86_cconv_t *const cconv = ia32_decide_calling_convention(type, NULL);
+	ir_node           *res   = NULL;
+	if (cconv->param_stacksize != 0 || cconv->sp_delta != 0)
+		goto out;
+	for (size_t i = 0, n = get_Return_n_ress(node); i < n; ++i) {
+		arch_register_t const *const reg = cconv->results[i].reg;
+		if (reg != current_cconv->results[i].reg
+		 || reg->cls == &ia32_reg_classes[CLASS_ia32_fp])
+			goto out;
+	}
+	/* eax, ecx and edx all holding arguments leave no register for an
+	 * indirect target. */
+	ir_node *target = try_create_Immediate(callee, 'i');
+	if (target == NULL && cconv->n_param_regs >= 3)
+		goto out;
+
+	ir_graph *const irg            = get_irn_irg(node);
+	ir_node  *const block          = be_transform_nodes_block(call);
+	dbg_info *const dbgi           = get_irn_dbg_info(call);
+	unsigned  const n_params       = get_Call_n_params(call);
+	unsigned  const n_callee_saves = rbitset_popcount(current_cconv->callee_saves, N_IA32_REGISTERS);
+	unsigned  const n_ins          = n_ia32_TailCall_first_argument + cconv->n_param_regs + n_callee_saves;
+
+	ir_node                   **const in   = ALLOCAN(ir_node*, n_ins);
+	arch_register_req_t const **const reqs = be_allocate_in_reqs(irg, n_ins);
+
+	if (target == NULL)
+		target = be_transform_node(callee);
+	adjust_pc_relative_relocation(target);
+	in[n_ia32_TailCall_callee]     = target;
+	reqs[n_ia32_TailCall_callee]   = ia32_reg_classes[CLASS_ia32_gp].class_req;
+	in[n_ia32_TailCall_mem]        = be_transform_node(get_Call_mem(call));
+	reqs[n_ia32_TailCall_mem]      = arch_memory_req;
+	in[n_ia32_TailCall_stack]      = get_initial_sp(irg);
+	reqs[n_ia32_TailCall_stack]    = ia32_registers[REG_ESP].single_req;
+
+	unsigned p = n_ia32_TailCall_first_argument;
+	for (unsigned i = 0; i < n_params; ++i) {
+		in[p]   = be_transform_node(get_Call_param(call, i));
+		reqs[p] = cconv->parameters[i].reg->single_req;
+		++p;
+	}
+	for (unsigned i = 0; i < N_IA32_REGISTERS; ++i) {
+		if (!rbitset_is_set(current_cconv->callee_saves, i))
+			continue;
+		arch_register_t const *const reg = &ia32_registers[i];
+		in[p]   = be_get_Start_proj(irg, reg);
+		reqs[p] = reg->single_req;
+		++p;
+	}
+	assert(p == n_ins);
+
+	res = new_bd_ia32_TailCall(dbgi, block, n_ins, in, reqs);
+	SET_IA32_ORIG_NODE(res, call);
+	be_stack_record_chain(&stack_env, res, n_ia32_TailCall_stack, NULL);
+out:
+	x86_free_calling_convention(cconv);
+	return res;
+}
+
 static ir_node *gen_Call(ir_node *node)
 {
 	arch_register_req_t const *const req_gp = ia32_reg_classes[CLASS_ia32_gp].class_req;
@@ -5344,6 +5463,9 @@ static ir_node *gen_ffs(ir_node *node)
  */
 static ir_node *gen_clz(ir_node *node)
 {
+	if (ia32_cg_config.use_lzcnt)
+		return gen_unop_AM(node, new_bd_ia32_Lzcnt);
+
 	ir_node  *bsr   = gen_unop_AM(node, new_bd_ia32_Bsr);
 	ir_node  *real  = skip_Proj(bsr);
 	dbg_info *dbgi  = get_irn_dbg_info(real);
@@ -5753,7 +5875,9 @@ static void register_transformers(void)
 	be_set_transform_function(op_ia32_l_Adc,       gen_ia32_l_Adc);
 	be_set_transform_function(op_ia32_l_Add,       gen_ia32_l_Add);
 	be_set_transform_function(op_ia32_l_FloattoLL, gen_ia32_l_FloattoLL);
+	be_set_transform_function(op_ia32_l_GreaterEqual64, gen_ia32_l_Cmp64);
 	be_set_transform_function(op_ia32_l_IMul,      gen_ia32_l_IMul);
+	be_set_transform_function(op_ia32_l_Less64,    gen_ia32_l_Cmp64);
 	be_set_transform_function(op_ia32_l_LLtoFloat, gen_ia32_l_LLtoFloat);
 	be_set_transform_function(op_ia32_l_Minus64,   gen_ia32_l_Minus64);
 	be_set_transform_function(op_ia32_l_Mul,       gen_ia32_l_Mul);
@@ -5919,6 +6043,7 @@ void ia32_transform_graph(ir_graph *irg)
 	ia32_create_stacklayout(irg, current_cconv);
 	be_add_parameter_entity_stores(irg);
 	x86_create_parameter_loads(irg, current_cconv);
+	sibling_calls = be_sibling_calls_possible(irg);
 
 	be_timer_push(T_HEIGHTS);
 	heights = heights_new(irg);
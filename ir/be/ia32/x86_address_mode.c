@@ -381,6 +381,40 @@ static bool value_last_used_here(be_lv_t *lv, ir_node *here, ir_node *value)
 	return true;
 }
 
+typedef struct address_uses_t {
+	bool     value_use;   /**< the value is needed in a register */
+	bool     other_block; /**< a memory operation is in another block */
+} address_uses_t;
+
+/** Address arithmetic is only followed this deep to the memory operations. */
+#define MAX_ADDRESS_USE_DEPTH 3
+
+/**
+ * Collects the uses of the address computation @p node. Uses by further
+ * additions and shifts are followed to their memory operations.
+ */
+static void collect_address_uses(address_uses_t *uses, ir_node const *node,
+                                 ir_node const *block, unsigned depth)
+{
+	foreach_out_edge(node, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		int      const pos  = get_edge_src_pos(edge);
+		if ((is_Load(user) && pos == n_Load_ptr)
+		 || (is_Store(user) && pos == n_Store_ptr)) {
+			if (get_nodes_block(user) != block)
+				uses->other_block = true;
+		} else if ((is_Add(user) || (is_Shl(user) && pos == n_Shl_left))
+		        && depth < MAX_ADDRESS_USE_DEPTH
+		        && get_irn_mode(user) == get_irn_mode(node)) {
+			collect_address_uses(uses, user, block, depth + 1);
+		} else {
+			uses->value_use = true;
+		}
+		if (uses->value_use)
+			return;
+	}
+}
+
 /**
  * Walker: mark those nodes that cannot be part of an address mode because
  * their value must be accessed through a register
@@ -412,12 +446,11 @@ static void mark_non_address_nodes(ir_node *node, void *env)
 		if (get_irn_n_edges(node) <= 1)
 			break;
 
-		/* for adds and shls with multiple users we use this heuristic:
-		 * we do not fold them into address mode if their operands don't live
-		 * out of the block, because in this case we will reduce register
-		 * pressure. Otherwise we fold them in aggressively in the hope, that
-		 * the node itself doesn't exist anymore and we were able to save the
-		 * register for the result */
+		/* for adds and shls with multiple users we decide with all users in
+		 * view: folding the computation into every memory operand costs no
+		 * ALU operation but keeps its operands alive up to each use, while
+		 * materializing a single LEA costs one operation and one register
+		 * for the result. */
 		ir_node *left  = get_binop_left(node);
 		ir_node *right = get_binop_right(node);
 
@@ -429,18 +462,26 @@ static void mark_non_address_nodes(ir_node *node, void *env)
 		 || eat_immediate(&addr, right, false))
 			return;
 
-		/* Fold AM if any of the two operands does not die here. This duplicates
-		 * an addition and has the same register pressure for the case that only
-		 * one operand dies, but is faster (on Pentium 4).
-		 * && instead of || only folds AM if both operands do not die here */
-		if (!value_last_used_here(lv, node, left)
-		 || !value_last_used_here(lv, node, right)) {
-			return;
+		address_uses_t uses = { false, false };
+		collect_address_uses(&uses, node, get_nodes_block(node), 0);
+		/* The value is needed in a register anyway, so let the memory
+		 * operations use it instead of recomputing the address at each of
+		 * them with the operands kept alive. */
+		if (uses.value_use) {
+			x86_mark_non_am(node);
+			break;
 		}
 
-		/* At least one of left and right are not used by anyone else, so it is
-		 * beneficial for the register pressure (if both are unused otherwise,
-		 * else neutral) and ALU use to not fold AM. */
+		/* Fold AM if only one of the operands dies here: this has the same
+		 * register pressure as materializing the value but saves the
+		 * addition. If both die, the LEA reduces the register pressure. If an
+		 * operand dies and a memory operand is in another block, folding
+		 * would extend its live range across the block boundary. */
+		unsigned const n_dying = value_last_used_here(lv, node, left)
+		                       + value_last_used_here(lv, node, right);
+		if (n_dying == 0 || (n_dying == 1 && !uses.other_block))
+			return;
+
 		x86_mark_non_am(node);
 		break;
 	}
@@ -465,7 +506,7 @@ void x86_calculate_non_address_mode_nodes(ir_graph *irg)
 
 void x86_free_non_address_mode_nodes(void)
 {
-	free(non_address_mode_nodes);
+	xfree(non_address_mode_nodes);
 }
 
 char const *x86_get_addr_variant_str(x86_addr_variant_t const variant)
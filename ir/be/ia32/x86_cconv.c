@@ -17,11 +17,11 @@
 
 void x86_free_calling_convention(x86_cconv_t *cconv)
 {
-	free(cconv->parameters);
-	free(cconv->results);
-	free(cconv->caller_saves);
-	free(cconv->callee_saves);
-	free(cconv);
+	xfree(cconv->parameters);
+	xfree(cconv->results);
+	xfree(cconv->caller_saves);
+	xfree(cconv->callee_saves);
+	xfree(cconv);
 }
 
 void x86_create_parameter_loads(ir_graph *irg, const x86_cconv_t *cconv)
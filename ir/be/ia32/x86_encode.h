@@ -0,0 +1,16 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2016 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief  Binary encoding helpers shared by the ia32 and amd64 backends.
+ */
+#ifndef FIRM_BE_IA32_X86_ENCODE_H
+#define FIRM_BE_IA32_X86_ENCODE_H
+
+/** Fills @p buffer with @p size bytes of NOP instructions. */
+void x86_enc_nops(char *buffer, unsigned size);
+
+#endif
@@ -22,6 +22,9 @@
  *              stack in same order no matter from which predecessor block
  *              control has been transferred. This problem is solved by permuting
  *              the floating point stack at the end of the predecessor if necessary.
+ *              The begin state of such a block is chosen once all its forward
+ *              predecessors are simulated: Among their end states the one
+ *              needing the fewest fxch weighted by execution frequency wins.
  *
  *              Note that an X_except block's begin state is always expected to
  *              be empty: Before making a call that may throw, the stack must be
@@ -54,6 +57,8 @@
 #include "array.h"
 #include "pdeq.h"
 #include "debug.h"
+#include "execfreq.h"
+#include "irdom.h"
 #include "panic.h"
 #include "belive.h"
 #include "besched.h"
@@ -99,12 +104,24 @@ struct x87_state {
 	x87_simulator *sim;            /**< The simulator. */
 };
 
+/**
+ * The end state of a simulated predecessor of a block whose begin state is not
+ * chosen yet.
+ */
+typedef struct x87_arrival {
+	ir_node            *pred;  /**< the predecessor block */
+	x87_state          *state; /**< end state of the predecessor */
+	struct x87_arrival *next;
+} x87_arrival;
+
 /**
  * A block state: Every block has a x87 state at the beginning and at the end.
  */
 typedef struct blk_state {
-	x87_state const *begin; /**< state at the begin or NULL if not assigned */
-	x87_state const *end;   /**< state at the end or NULL if not assigned */
+	x87_state const *begin;     /**< state at the begin or NULL if not assigned */
+	x87_state const *end;       /**< state at the end or NULL if not assigned */
+	x87_arrival     *arrivals;  /**< candidates for the begin state */
+	int              n_missing; /**< forward preds still to be simulated */
 } blk_state;
 
 /** liveness bitset for fp registers. */
@@ -120,6 +137,7 @@ struct x87_simulator {
 	fp_liveness   *live;       /**< Liveness information. */
 	unsigned       n_idx;      /**< The cached get_irg_last_idx() result. */
 	pdeq          *worklist;   /**< Worklist of blocks that must be processed. */
+	ir_node      **undecided;  /**< Blocks with arrivals but no begin state. */
 };
 
 /**
@@ -313,8 +331,10 @@ static blk_state *x87_get_bl_state(x87_simulator *sim, ir_node *block)
 	blk_state *res = pmap_get(blk_state, sim->blk_states, block);
 	if (res == NULL) {
 		res = OALLOC(&sim->obst, blk_state);
-		res->begin = NULL;
-		res->end   = NULL;
+		res->begin     = NULL;
+		res->end       = NULL;
+		res->arrivals  = NULL;
+		res->n_missing = -1;
 
 		pmap_insert(sim->blk_states, block, res);
 	}
@@ -382,6 +402,34 @@ static void move_to_tos(x87_state *const state, ir_node *const before,
 
 /* -------------- x87 perm --------------- */
 
+/**
+ * Returns the number of fxch instructions x87_shuffle() creates to permute
+ * @p state into @p dst_state.
+ */
+static unsigned x87_shuffle_cost(x87_state const *const state,
+                                 x87_state const *const dst_state)
+{
+	assert(state->depth == dst_state->depth);
+
+	unsigned done = 0;
+	unsigned cost = 0;
+	for (unsigned i = 0; i < state->depth; ++i) {
+		if ((done & (1 << i)) != 0
+		 || x87_get_st_reg(state, i) == x87_get_st_reg(dst_state, i))
+			continue;
+
+		/* A cycle including the tos needs one exchange less than its length,
+		 * other cycles move through the tos and need one more. */
+		unsigned len = 0;
+		for (unsigned idx = i; (done & (1 << idx)) == 0; ++len) {
+			done |= 1 << idx;
+			idx   = x87_reg_on_stack(dst_state, x87_get_st_reg(state, idx));
+		}
+		cost += i == 0 ? len - 1 : len + 1;
+	}
+	return cost;
+}
+
 /**
  * Calculate the necessary permutations to reach dst_state.
  *
@@ -1487,6 +1535,59 @@ static void sim_be_Keep(x87_state *state, ir_node *node)
 	DEBUG_ONLY(x87_dump_stack(state);)
 }
 
+/**
+ * Returns the number of forward control flow predecessors of @p block, that
+ * is all predecessors except the ones reached through a back edge.
+ */
+static int x87_count_forward_preds(ir_node const *const block)
+{
+	int n_forward = 0;
+	for (int i = 0, n = get_Block_n_cfgpreds(block); i < n; ++i) {
+		ir_node const *const pred = get_Block_cfgpred_block(block, i);
+		if (!block_dominates(block, pred))
+			++n_forward;
+	}
+	return n_forward;
+}
+
+/**
+ * Chooses the begin state of @p block among the end states of its simulated
+ * predecessors, such that the fxch instructions needed on the incoming edges
+ * weighted by their execution frequency are minimal.  The other predecessors
+ * get shuffled into the chosen state.
+ */
+static void x87_choose_begin_state(x87_simulator *const sim,
+                                   ir_node *const block)
+{
+	blk_state *const bl_state = x87_get_bl_state(sim, block);
+	assert(bl_state->begin == NULL && bl_state->arrivals != NULL);
+
+	x87_state const *best      = NULL;
+	double           best_cost = 0;
+	for (x87_arrival const *c = bl_state->arrivals; c != NULL; c = c->next) {
+		double cost = 0;
+		for (x87_arrival const *a = bl_state->arrivals; a != NULL; a = a->next) {
+			cost += x87_shuffle_cost(a->state, c->state)
+			      * get_block_execfreq(a->pred);
+		}
+		if (best == NULL || cost < best_cost) {
+			best      = c->state;
+			best_cost = cost;
+		}
+	}
+
+	DB((dbg, LEVEL_2, "Set begin state for %+F (cost %f):\n", block,
+	    best_cost));
+	DEBUG_ONLY(x87_dump_stack(best);)
+	bl_state->begin = best;
+	for (x87_arrival const *a = bl_state->arrivals; a != NULL; a = a->next) {
+		if (a->state != best)
+			x87_shuffle(a->pred, a->state, best);
+	}
+	bl_state->arrivals = NULL;
+	pdeq_putr(sim->worklist, block);
+}
+
 /**
  * Run a simulation and fix all virtual instructions for a block.
  *
@@ -1543,7 +1644,23 @@ static void x87_simulate_block(x87_simulator *sim, ir_node *block)
 
 		blk_state *const succ_state = x87_get_bl_state(sim, succ);
 
-		if (succ_state->begin == NULL) {
+		if (succ_state->begin == NULL && get_Block_n_cfgpreds(succ) > 1
+		 && !is_x_except_Proj(cfgpred)) {
+			/* Remember the state and choose among the candidates once all
+			 * forward predecessors are simulated.  Note that critical edges are
+			 * removed, so this block has no other successor to disturb. */
+			if (succ_state->n_missing < 0) {
+				succ_state->n_missing = x87_count_forward_preds(succ);
+				ARR_APP1(ir_node*, sim->undecided, succ);
+			}
+			x87_arrival *const arrival = OALLOC(&sim->obst, x87_arrival);
+			arrival->pred         = block;
+			arrival->state        = next_state;
+			arrival->next         = succ_state->arrivals;
+			succ_state->arrivals  = arrival;
+			if (--succ_state->n_missing <= 0)
+				x87_choose_begin_state(sim, succ);
+		} else if (succ_state->begin == NULL) {
 			DB((dbg, LEVEL_2, "Set begin state for succ %+F:\n", succ));
 			DEBUG_ONLY(x87_dump_stack(next_state);)
 			succ_state->begin = next_state;
@@ -1603,6 +1720,7 @@ void x86_prepare_x87_callbacks_ia32(void)
 	x86_register_x87_sim(op_ia32_FucomFnstsw, sim_ia32_FucomFnstsw);
 	x86_register_x87_sim(op_ia32_Fucomi,      sim_ia32_Fucomi);
 	x86_register_x87_sim(op_ia32_Return,      x86_sim_x87_ret);
+	x86_register_x87_sim(op_ia32_TailCall,    x86_sim_x87_ret);
 }
 
 /**
@@ -1658,9 +1776,13 @@ void x86_x87_simulate_graph(ir_graph *irg, const x87_simulator_config_t *config)
 	x87_state const empty = { .sim = &sim };
 	bl_state->begin = &empty;
 
-	sim.worklist = new_pdeq();
+	sim.worklist  = new_pdeq();
+	sim.undecided = NEW_ARR_F(ir_node*, 0);
 	pdeq_putr(sim.worklist, start_block);
 
+	/* dominance identifies the back edges of loops */
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+
 	be_assure_live_sets(irg);
 	sim.lv = be_get_irg_liveness(irg);
 
@@ -1676,11 +1798,26 @@ void x86_x87_simulate_graph(ir_graph *irg, const x87_simulator_config_t *config)
 	do {
 		ir_node *block = (ir_node*)pdeq_getl(sim.worklist);
 		x87_simulate_block(&sim, block);
+
+		/* Some forward predecessors may never be simulated, for example
+		 * because they are only reachable through the block itself.  Then go
+		 * on with the candidates found so far. */
+		for (size_t i = ARR_LEN(sim.undecided); pdeq_empty(sim.worklist) && i-- > 0;) {
+			ir_node   *const undecided = sim.undecided[i];
+			blk_state *const bl_state  = x87_get_bl_state(&sim, undecided);
+			if (bl_state->begin == NULL)
+				x87_choose_begin_state(&sim, undecided);
+		}
 	} while (!pdeq_empty(sim.worklist));
 
 	/* kill it */
+	DEL_ARR_F(sim.undecided);
 	del_pdeq(sim.worklist);
 	x87_destroy_simulator(&sim);
+
+	/* the simulator rewires values to stack registers without updating the
+	 * liveness */
+	be_invalidate_live_sets(irg);
 }
 
 /* Initializes the x87 simulator. */
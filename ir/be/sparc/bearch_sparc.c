@@ -89,11 +89,13 @@ static lc_opt_enum_int_var_t arch_fpu_var = {
 };
 
 static bool use_softfloat;
+static bool use_leaf_functions = true;
 
 static const lc_opt_table_entry_t sparc_options[] = {
 	LC_OPT_ENT_ENUM_INT("fpunit",     "select the floating point unit", &arch_fpu_var),
 	LC_OPT_ENT_ENUM_INT("cpu",        "select architecture variant",    &cpu_var),
 	LC_OPT_ENT_BOOL    ("soft-float", "equivalent to fpmath=softfloat", &use_softfloat),
+	LC_OPT_ENT_BOOL    ("leaf",       "omit the register window in small leaf functions", &use_leaf_functions),
 	LC_OPT_LAST
 };
 
@@ -352,6 +354,8 @@ static void sparc_setup_cg_config(void)
 	if (use_softfloat)
 		fpu = use_fpu_no;
 
+	sparc_cg_config.leaf_functions = use_leaf_functions;
+
 	if (fpu == use_fpu_auto) {
 		sparc_cg_config.use_fpu = has_fpu;
 	} else {
@@ -475,7 +479,7 @@ static void sparc_lower_for_target(void)
 	}
 
 	if (!sparc_cg_config.use_fpu) {
-		lower_floating_point();
+		lower_floating_point(false);
 		be_after_irp_transform("lower-fp");
 	}
 
@@ -545,6 +549,8 @@ static const backend_params *sparc_get_backend_params(void)
 			.va_list_type = NULL, /* will be set later */
 			.lower_va_arg = be_default_lower_va_arg,
 		},
+		.n_int_registers                = 21,
+		.n_float_registers              = 32,
 	};
 
 	ir_mode *mode_long_long
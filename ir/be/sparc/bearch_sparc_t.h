@@ -27,6 +27,7 @@ typedef struct sparc_irg_data_t {
 typedef struct sparc_codegen_config_t {
 	bool use_fpu;
 	bool use_cas;
+	bool leaf_functions; /**< omit the register window in small leaf functions */
 } sparc_codegen_config_t;
 extern sparc_codegen_config_t sparc_cg_config;
 
@@ -13,7 +13,9 @@
 #include "beirg.h"
 #include "sparc_cconv.h"
 #include "irmode_t.h"
+#include "iredges_t.h"
 #include "irgwalk.h"
+#include "irtools.h"
 #include "typerep.h"
 #include "xmalloc.h"
 #include "util.h"
@@ -144,6 +146,78 @@ static void check_omit_fp(ir_node *node, void *env)
 	}
 }
 
+/**
+ * Number of integer registers a leaf function can use without a register
+ * window: %g1-%g3 and %o0-%o5.
+ */
+#define SPARC_LEAF_MAX_PRESSURE 9
+
+static void add_block_pressure(ir_node *block)
+{
+	uintptr_t const pressure = (uintptr_t)get_irn_link(block);
+	set_irn_link(block, (void*)(pressure + 1));
+}
+
+/**
+ * Estimates the integer register pressure per block: Values which are used
+ * more than once or in another block are counted in the defining and in the
+ * using blocks. Values with a single local user are assumed to die right
+ * away.
+ */
+static void estimate_pressure(ir_node *node, void *env)
+{
+	(void)env;
+	if (is_Block(node) || is_Const(node) || is_Address(node))
+		return;
+	ir_mode *const mode = get_irn_mode(node);
+	if (!mode_is_int(mode) && !mode_is_reference(mode))
+		return;
+
+	ir_node *const block = get_nodes_block(node);
+	bool long_lived = get_irn_n_edges(node) > 1;
+	foreach_out_edge(node, edge) {
+		ir_node *const user       = get_edge_src_irn(edge);
+		ir_node *const user_block = is_Phi(user)
+			? get_Block_cfgpred_block(get_nodes_block(user),
+			                          get_edge_src_pos(edge))
+			: get_nodes_block(user);
+		if (user_block != block) {
+			add_block_pressure(user_block);
+			long_lived = true;
+		}
+	}
+	if (long_lived)
+		add_block_pressure(block);
+}
+
+static void check_block_pressure(ir_node *block, void *env)
+{
+	bool *const is_small = (bool*)env;
+	if ((uintptr_t)get_irn_link(block) > SPARC_LEAF_MAX_PRESSURE)
+		*is_small = false;
+}
+
+/**
+ * Returns true if @p irg is a leaf function whose values probably fit into
+ * the registers usable without a register window.
+ */
+static bool is_small_leaf(ir_graph *irg)
+{
+	bool is_leaf = true;
+	irg_walk_graph(irg, check_omit_fp, NULL, &is_leaf);
+	if (!is_leaf)
+		return false;
+
+	assure_edges(irg);
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	irg_block_walk_graph(irg, firm_clear_link, NULL, NULL);
+	irg_walk_graph(irg, NULL, estimate_pressure, NULL);
+	bool is_small = true;
+	irg_block_walk_graph(irg, check_block_pressure, NULL, &is_small);
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	return is_small;
+}
+
 static unsigned determine_n_float_regs(ir_mode *mode)
 {
 	unsigned bits = get_mode_size_bits(mode);
@@ -164,7 +238,8 @@ calling_convention_t *sparc_decide_calling_convention(ir_type *function_type,
 {
 	bool omit_fp = false;
 	if (irg != NULL) {
-		omit_fp = be_options.omit_fp;
+		omit_fp = be_options.omit_fp
+		       || (sparc_cg_config.leaf_functions && is_small_leaf(irg));
 		/* our current vaarg handling needs the standard space to store the
 		 * args 0-5 in it */
 		if (is_method_variadic(function_type))
@@ -338,10 +413,10 @@ calling_convention_t *sparc_decide_calling_convention(ir_type *function_type,
 
 void sparc_free_calling_convention(calling_convention_t *cconv)
 {
-	free(cconv->parameters);
-	free(cconv->results);
-	free(cconv->caller_saves);
-	free(cconv);
+	xfree(cconv->parameters);
+	xfree(cconv->results);
+	xfree(cconv->caller_saves);
+	xfree(cconv);
 }
 
 void sparc_cconv_init(void)
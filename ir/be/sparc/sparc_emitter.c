@@ -441,6 +441,20 @@ static void optimize_fallthrough(ir_node *node)
 	}
 }
 
+static int cmp_block_execfreqs(const void *d1, const void *d2)
+{
+	ir_node **p1 = (ir_node**)d1;
+	ir_node **p2 = (ir_node**)d2;
+	double freq1 = get_block_execfreq(*p1);
+	double freq2 = get_block_execfreq(*p2);
+	/* sort by decreasing execution frequency */
+	if (freq1 > freq2)
+		return -1;
+	if (freq1 < freq2)
+		return 1;
+	return get_irn_node_nr(*p2)-get_irn_node_nr(*p1);
+}
+
 /**
  * search for an instruction that can fill the delay slot of @p node
  */
@@ -483,11 +497,21 @@ static ir_node *pick_delay_slot_for(ir_node *node)
 		return schedpoint;
 	}
 
-	/* look in successor blocks */
-	ir_node *block = get_nodes_block(node);
-	/* TODO: sort succs by execution frequency */
+	/* look in successor blocks, the most frequently executed one first */
+	ir_node  *block   = get_nodes_block(node);
+	unsigned  n_succs = 0;
+	foreach_block_succ(block, edge) {
+		++n_succs;
+	}
+	ir_node **succs = ALLOCAN(ir_node*, n_succs);
+	n_succs = 0;
 	foreach_block_succ(block, edge) {
-		ir_node *succ = get_edge_src_irn(edge);
+		succs[n_succs++] = get_edge_src_irn(edge);
+	}
+	QSORT(succs, n_succs, cmp_block_execfreqs);
+
+	for (unsigned i = 0; i < n_succs; ++i) {
+		ir_node *succ = succs[i];
 		/* we can't easily move up stuff from blocks with multiple predecessors
 		 * since the instruction is lacking for the other preds then.
 		 * (We also don't have to do any phi translation) */
@@ -1414,22 +1438,10 @@ static void sparc_emit_func_epilog(ir_graph *irg)
 	be_gas_emit_function_epilog(entity);
 }
 
-static int cmp_block_execfreqs(const void *d1, const void *d2)
-{
-	ir_node **p1 = (ir_node**)d1;
-	ir_node **p2 = (ir_node**)d2;
-	double freq1 = get_block_execfreq(*p1);
-	double freq2 = get_block_execfreq(*p2);
-	if (freq1 < freq2)
-		return -1;
-	if (freq1 > freq2)
-		return 1;
-	return get_irn_node_nr(*p2)-get_irn_node_nr(*p1);
-}
-
 static void pick_delay_slots(size_t n_blocks, ir_node *const *const blocks)
 {
-	/* create blocklist sorted by execution frequency */
+	/* create blocklist sorted by execution frequency, so the delay slots of
+	 * the hottest branches get the first pick of the filler candidates */
 	ir_node **const sorted_blocks = XMALLOCN(ir_node*, n_blocks);
 	MEMCPY(sorted_blocks, blocks, n_blocks);
 	QSORT(sorted_blocks, n_blocks, cmp_block_execfreqs);
@@ -1445,7 +1457,7 @@ static void pick_delay_slots(size_t n_blocks, ir_node *const *const blocks)
 			pmap_insert(delay_slots, node, filler);
 		}
 	}
-	free(sorted_blocks);
+	xfree(sorted_blocks);
 }
 
 void sparc_emit_function(ir_graph *irg)
@@ -1480,7 +1492,7 @@ void sparc_emit_function(ir_graph *irg)
 	sparc_emit_func_epilog(irg);
 
 	pmap_destroy(delay_slots);
-	free(delay_slot_fillers);
+	xfree(delay_slot_fillers);
 	heights_free(heights);
 }
 
@@ -132,6 +132,7 @@ void sparc_lower_64bit(void)
 		word_signed,
 		64,    /* doubleword size */
 		be_is_big_endian(),
+		NULL,
 	};
 
 	/* make sure opcodes are initialized */
@@ -516,6 +516,7 @@ Return => {
 # This is a JumpLink instruction, but with the addition that you can add custom
 # register constraints to model your calling conventions
 Call => {
+	op_flags  => [ "uses_memory", "fragile" ],
 	irn_flags => [ "has_delay_slot" ],
 	state     => "exc_pinned",
 	in_reqs   => "...",
@@ -477,6 +477,8 @@ static void show_commands(void)
 		"create nr             break if node nr was created\n"
 		"disable nr            disable breakpoint nr\n"
 		"dumpfilter string     only dump graphs whose name contains string\n"
+		"dumpnodes string      only dump the nodes matching the comma separated opcodes and node numbers\n"
+		"dumpradius n          also dump nodes up to n edges away from the matching nodes\n"
 		"enable nr             enable breakpoint nr\n"
 		"help                  list all commands\n"
 		"init                  break after initialization\n"
@@ -736,6 +738,8 @@ enum tokens {
 	tok_create,
 	tok_disable,
 	tok_dumpfilter,
+	tok_dumpnodes,
+	tok_dumpradius,
 	tok_enable,
 	tok_help,
 	tok_init,
@@ -763,6 +767,8 @@ static const char *const reserved[] = {
 	"create",
 	"disable",
 	"dumpfilter",
+	"dumpnodes",
+	"dumpradius",
 	"enable",
 	"help",
 	"init",
@@ -1103,6 +1109,22 @@ void firm_debug(const char *cmd)
 			break;
 		}
 
+		case tok_dumpnodes: {
+			get_text();
+			char *buf = ALLOCAN(char, lexer.len+1);
+			memcpy(buf, lexer.s, lexer.len);
+			buf[lexer.len] = '\0';
+			ir_set_dump_node_filter(buf);
+			break;
+		}
+
+		case tok_dumpradius:
+			token = get_token();
+			if (token != tok_number)
+				goto error;
+			ir_set_dump_radius(lexer.number);
+			break;
+
 		case tok_help:
 			show_commands();
 			break;
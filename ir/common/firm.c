@@ -16,6 +16,7 @@
 #include "version.h"
 #include <stdio.h>
 #include "lc_opts.h"
+#include "dbginfo_t.h"
 #include "ident_t.h"
 #include "firm.h"
 #include "irflag_t.h"
@@ -83,9 +84,12 @@ void ir_finish(void)
 	firm_finish_debugger();
 #endif
 	exit_execfreq();
+	firm_finish_memory_disambiguator();
 	firm_be_finish();
+	ir_dump_wait();
 
 	free_ir_prog();
+	finish_dbginfo();
 	firm_finish_op();
 	finish_tarval();
 	finish_mode();
@@ -7,14 +7,32 @@
  * @file
  * @brief   platform neutral timing utilities
  */
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#include "array.h"
+#include "ident_t.h"
+#include "irgraph_t.h"
+#include "panic.h"
+#include "pmap.h"
 #include "timing.h"
+#include "typerep.h"
 #include "xmalloc.h"
-#include "panic.h"
 
-#ifdef _WIN32
+#if defined(FIRM_TIMING_TSC) \
+	&& (defined(__x86_64__) || defined(__i386__) || defined(__aarch64__))
+#define HAVE_TSC
+
+#include <sys/time.h>
+#include <unistd.h>
+
+/* Time stamp counter value. */
+typedef unsigned long long ir_timer_val_t;
+
+#elif defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include <mmsystem.h>
@@ -67,10 +85,96 @@ ir_timer_t *ir_timer_new(void)
 
 void ir_timer_free(ir_timer_t *timer)
 {
-	free(timer);
+	xfree(timer);
 }
 
-#ifdef HAVE_GETTIMEOFDAY
+#ifdef HAVE_TSC
+
+/*
+ * The counters are read directly, which costs a few cycles instead of a
+ * syscall or vDSO call.  This assumes an invariant TSC on x86, i.e. one that
+ * ticks at a constant rate and is synchronized between cores, as provided by
+ * all recent processors.  The generic timer of AArch64 always is.
+ */
+
+/** Ticks of the counter per microsecond, 0 if not calibrated yet. */
+static double tsc_ticks_per_usec;
+
+static inline void _time_get(ir_timer_val_t *val)
+{
+#ifdef __aarch64__
+	__asm__ volatile("isb; mrs %0, cntvct_el0" : "=r" (*val));
+#else
+	unsigned h;
+	unsigned l;
+	__asm__ volatile("rdtsc" : "=a" (l), "=d" (h));
+	*val = (ir_timer_val_t)h << 32 | l;
+#endif
+}
+
+static double get_tsc_ticks_per_usec(void)
+{
+	if (tsc_ticks_per_usec == 0) {
+#ifdef __aarch64__
+		unsigned long long freq;
+		__asm__ volatile("mrs %0, cntfrq_el0" : "=r" (freq));
+		tsc_ticks_per_usec = freq / 1000000.0;
+#else
+		/* measure the counter against the OS clock for 10 msec */
+		struct timeval begin;
+		struct timeval now;
+		ir_timer_val_t tsc_begin;
+		ir_timer_val_t tsc_end;
+		gettimeofday(&begin, NULL);
+		_time_get(&tsc_begin);
+		long usec;
+		do {
+			gettimeofday(&now, NULL);
+			usec = (now.tv_sec - begin.tv_sec) * 1000000L
+			     + (now.tv_usec - begin.tv_usec);
+		} while (usec < 10000);
+		_time_get(&tsc_end);
+		tsc_ticks_per_usec = (double)(tsc_end - tsc_begin) / usec;
+#endif
+	}
+	return tsc_ticks_per_usec;
+}
+
+static inline void _time_reset(ir_timer_val_t *val)
+{
+	*val = 0;
+}
+
+static inline unsigned long _time_to_msec(const ir_timer_val_t *elapsed)
+{
+	return (unsigned long)(*elapsed / get_tsc_ticks_per_usec() / 1000.0);
+}
+
+static inline unsigned long _time_to_usec(const ir_timer_val_t *elapsed)
+{
+	return (unsigned long)(*elapsed / get_tsc_ticks_per_usec());
+}
+
+static inline double _time_to_sec(const ir_timer_val_t *elapsed)
+{
+	return *elapsed / get_tsc_ticks_per_usec() / 1000000.0;
+}
+
+static inline ir_timer_val_t *_time_add(ir_timer_val_t *res,
+		const ir_timer_val_t *lhs, const ir_timer_val_t *rhs)
+{
+	*res = *lhs + *rhs;
+	return res;
+}
+
+static inline ir_timer_val_t *_time_sub(ir_timer_val_t *res,
+		const ir_timer_val_t *lhs, const ir_timer_val_t *rhs)
+{
+	*res = *lhs - *rhs;
+	return res;
+}
+
+#elif defined(HAVE_GETTIMEOFDAY)
 
 static inline void _time_get(ir_timer_val_t *val)
 {
@@ -415,3 +519,289 @@ double ir_timer_elapsed_sec(const ir_timer_t *timer)
 	}
 	return _time_to_sec(elapsed);
 }
+
+/** A named counter attached to a scope of the pass profile. */
+typedef struct timing_counter_t {
+	ident  *name;
+	double  value;
+} timing_counter_t;
+
+/** A scope of the pass profile. */
+typedef struct timing_scope_t {
+	ident            *name;        /**< name of the scope */
+	ir_graph         *irg;         /**< graph the scope works on or NULL */
+	ident            *irg_name;    /**< name of the graph, it may be freed */
+	size_t            parent;      /**< index of the enclosing scope */
+	unsigned long     wall_begin;  /**< usec since the profile was enabled */
+	unsigned long     wall_end;
+	clock_t           cpu_begin;
+	clock_t           cpu_end;
+	long              obst_begin;  /**< bytes held by the graph obstack */
+	long              obst_end;
+	unsigned          nodes_begin; /**< last node index of the graph */
+	unsigned          nodes_end;
+	size_t            mem_begin;   /**< bytes held by the graph in total */
+	ir_memory_usage_t mem_end;     /**< bytes held by the graph per category */
+	timing_counter_t *counters;    /**< counters reported by the pass or NULL */
+	bool              open;
+} timing_scope_t;
+
+/** Totals of all scopes with the same name for the summary. */
+typedef struct timing_total_t {
+	ident         *name;
+	unsigned       count;
+	unsigned long  wall;
+	unsigned long  wall_self; /**< wall time without child scopes */
+	clock_t        cpu;
+	long           obst;
+	long           nodes;
+	long           mem;
+} timing_total_t;
+
+#define NO_SCOPE ((size_t)-1)
+
+static bool            timing_enabled;
+static ir_timer_val_t  timing_origin;
+static timing_scope_t *timing_scopes;
+static size_t          timing_current = NO_SCOPE;
+
+static unsigned long timing_now(void)
+{
+	ir_timer_val_t now;
+	_time_get(&now);
+	_time_sub(&now, &now, &timing_origin);
+	return _time_to_usec(&now);
+}
+
+static size_t get_n_timing_scopes(void)
+{
+	return timing_scopes != NULL ? ARR_LEN(timing_scopes) : 0;
+}
+
+static void timing_scope_measure_end(timing_scope_t *scope)
+{
+	scope->wall_end = timing_now();
+	scope->cpu_end  = clock();
+	if (scope->irg != NULL) {
+		scope->obst_end  = obstack_memory_used(&scope->irg->obst);
+		scope->nodes_end = get_irg_last_idx(scope->irg);
+		ir_graph_memory_usage(scope->irg, &scope->mem_end);
+	}
+}
+
+void ir_timing_enable(int enable)
+{
+	if (enable && !timing_enabled) {
+		if (timing_scopes != NULL) {
+			for (size_t i = 0, n = ARR_LEN(timing_scopes); i < n; ++i) {
+				if (timing_scopes[i].counters != NULL)
+					DEL_ARR_F(timing_scopes[i].counters);
+			}
+			DEL_ARR_F(timing_scopes);
+		}
+		timing_scopes  = NEW_ARR_F(timing_scope_t, 0);
+		timing_current = NO_SCOPE;
+		_time_get(&timing_origin);
+	}
+	timing_enabled = enable;
+}
+
+int ir_timing_is_enabled(void)
+{
+	return timing_enabled;
+}
+
+void ir_timing_scope_push(const char *name, ir_graph *irg)
+{
+	if (!timing_enabled)
+		return;
+
+	if (irg == NULL && timing_current != NO_SCOPE)
+		irg = timing_scopes[timing_current].irg;
+
+	timing_scope_t scope = {
+		.name       = new_id_from_str(name),
+		.irg        = irg,
+		.parent     = timing_current,
+		.wall_begin = timing_now(),
+		.cpu_begin  = clock(),
+		.open       = true,
+	};
+	if (irg != NULL) {
+		scope.irg_name    = get_entity_ident(get_irg_entity(irg));
+		scope.obst_begin  = obstack_memory_used(&irg->obst);
+		scope.nodes_begin = get_irg_last_idx(irg);
+
+		ir_memory_usage_t usage;
+		ir_graph_memory_usage(irg, &usage);
+		scope.mem_begin = ir_memory_usage_total(&usage);
+	}
+	timing_current = ARR_LEN(timing_scopes);
+	ARR_APP1(timing_scope_t, timing_scopes, scope);
+}
+
+void ir_timing_scope_pop(const char *name)
+{
+	if (!timing_enabled)
+		return;
+	if (timing_current == NO_SCOPE)
+		panic("timing scope stack underflow");
+
+	timing_scope_t *const scope = &timing_scopes[timing_current];
+	if (strcmp(get_id_str(scope->name), name) != 0)
+		panic("timing scope '%s' closed while '%s' is open", name,
+		      get_id_str(scope->name));
+
+	timing_scope_measure_end(scope);
+	scope->open    = false;
+	timing_current = scope->parent;
+}
+
+void ir_timing_scope_add(const char *name, double value)
+{
+	if (!timing_enabled)
+		return;
+	if (timing_current == NO_SCOPE)
+		panic("timing counter '%s' added outside of a scope", name);
+
+	timing_scope_t *const scope = &timing_scopes[timing_current];
+	ident          *const id    = new_id_from_str(name);
+	if (scope->counters == NULL)
+		scope->counters = NEW_ARR_F(timing_counter_t, 0);
+	for (size_t i = 0, n = ARR_LEN(scope->counters); i < n; ++i) {
+		if (scope->counters[i].name == id) {
+			scope->counters[i].value += value;
+			return;
+		}
+	}
+	timing_counter_t const counter = { .name = id, .value = value };
+	ARR_APP1(timing_counter_t, scope->counters, counter);
+}
+
+/** Returns the measurements of @p scope, closing it temporarily if open. */
+static timing_scope_t get_closed_scope(const timing_scope_t *scope)
+{
+	timing_scope_t res = *scope;
+	if (res.open)
+		timing_scope_measure_end(&res);
+	return res;
+}
+
+static void write_json_string(FILE *out, const char *str)
+{
+	putc('"', out);
+	for (const char *c = str; *c != '\0'; ++c) {
+		unsigned char const ch = (unsigned char)*c;
+		if (ch == '"' || ch == '\\') {
+			fprintf(out, "\\%c", ch);
+		} else if (ch < 0x20) {
+			fprintf(out, "\\u%04x", ch);
+		} else {
+			putc(ch, out);
+		}
+	}
+	putc('"', out);
+}
+
+void ir_timing_write_chrome_trace(FILE *out)
+{
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", out);
+	for (size_t i = 0, n = get_n_timing_scopes(); i < n; ++i) {
+		timing_scope_t const scope = get_closed_scope(&timing_scopes[i]);
+		fputs(i == 0 ? "\n" : ",\n", out);
+		fputs("{\"name\":", out);
+		write_json_string(out, get_id_str(scope.name));
+		fprintf(out, ",\"cat\":\"firm\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+		        "\"ts\":%lu,\"dur\":%lu,\"args\":{\"cpu_us\":%.0f",
+		        scope.wall_begin, scope.wall_end - scope.wall_begin,
+		        (scope.cpu_end - scope.cpu_begin) * 1e6 / CLOCKS_PER_SEC);
+		if (scope.irg != NULL) {
+			fputs(",\"irg\":", out);
+			write_json_string(out, get_id_str(scope.irg_name));
+			fprintf(out, ",\"obstack_bytes\":%ld,\"nodes_created\":%ld",
+			        scope.obst_end - scope.obst_begin,
+			        (long)scope.nodes_end - (long)scope.nodes_begin);
+			size_t const mem_end = ir_memory_usage_total(&scope.mem_end);
+			fprintf(out, ",\"memory_bytes\":%ld",
+			        (long)mem_end - (long)scope.mem_begin);
+			for (ir_memory_category_t c = IR_MEMORY_FIRST; c <= IR_MEMORY_LAST;
+			     ++c) {
+				fprintf(out, ",\"held_%s\":%zu",
+				        get_ir_memory_category_name(c), scope.mem_end.bytes[c]);
+			}
+		}
+		if (scope.counters != NULL) {
+			for (size_t c = 0, n_c = ARR_LEN(scope.counters); c < n_c; ++c) {
+				putc(',', out);
+				write_json_string(out, get_id_str(scope.counters[c].name));
+				fprintf(out, ":%g", scope.counters[c].value);
+			}
+		}
+		fputs("}}", out);
+	}
+	fputs("\n]}\n", out);
+}
+
+static int cmp_total(const void *p1, const void *p2)
+{
+	const timing_total_t *const t1 = (const timing_total_t*)p1;
+	const timing_total_t *const t2 = (const timing_total_t*)p2;
+	if (t1->wall_self != t2->wall_self)
+		return t1->wall_self < t2->wall_self ? 1 : -1;
+	return strcmp(get_id_str(t1->name), get_id_str(t2->name));
+}
+
+void ir_timing_write_summary(FILE *out)
+{
+	size_t          const n_scopes = get_n_timing_scopes();
+	timing_total_t       *totals   = NEW_ARR_F(timing_total_t, 0);
+	size_t         *const total_of = XMALLOCN(size_t, n_scopes);
+	pmap           *const by_name  = pmap_create();
+
+	for (size_t i = 0; i < n_scopes; ++i) {
+		timing_scope_t const scope = get_closed_scope(&timing_scopes[i]);
+		/* pmap values are pointers, store the index biased by one */
+		size_t idx = (size_t)pmap_get(void, by_name, scope.name);
+		if (idx-- == 0) {
+			idx = ARR_LEN(totals);
+			timing_total_t const total = { .name = scope.name };
+			ARR_APP1(timing_total_t, totals, total);
+			pmap_insert(by_name, scope.name, (void*)(idx + 1));
+		}
+		total_of[i] = idx;
+
+		unsigned long const wall = scope.wall_end - scope.wall_begin;
+		timing_total_t *const total = &totals[idx];
+		++total->count;
+		total->wall      += wall;
+		total->wall_self += wall;
+		total->cpu       += scope.cpu_end - scope.cpu_begin;
+		total->obst      += scope.obst_end - scope.obst_begin;
+		total->nodes     += (long)scope.nodes_end - (long)scope.nodes_begin;
+		if (scope.irg != NULL)
+			total->mem += (long)ir_memory_usage_total(&scope.mem_end)
+			            - (long)scope.mem_begin;
+		/* parents precede their children */
+		if (scope.parent != NO_SCOPE)
+			totals[total_of[scope.parent]].wall_self -= wall;
+	}
+
+	size_t const n_totals = ARR_LEN(totals);
+	qsort(totals, n_totals, sizeof(*totals), cmp_total);
+
+	fprintf(out, "%-30s %8s %12s %12s %12s %12s %12s %10s\n", "scope",
+	        "count", "self msec", "total msec", "cpu msec", "obst bytes",
+	        "mem bytes", "nodes");
+	for (size_t i = 0; i < n_totals; ++i) {
+		timing_total_t const *const total = &totals[i];
+		fprintf(out, "%-30s %8u %12.3f %12.3f %12.3f %12ld %12ld %10ld\n",
+		        get_id_str(total->name), total->count,
+		        total->wall_self / 1000.0, total->wall / 1000.0,
+		        total->cpu * 1000.0 / CLOCKS_PER_SEC, total->obst,
+		        total->mem, total->nodes);
+	}
+
+	pmap_destroy(by_name);
+	xfree(total_of);
+	DEL_ARR_F(totals);
+}
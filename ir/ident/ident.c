@@ -7,55 +7,126 @@
  * @file
  * @brief     Hash table to store names.
  * @author    Goetz Lindenmaier
+ *
+ * Identifiers are interned in a table that is split into shards by hash
+ * value. Each shard has its own lock, so threads interning different names
+ * rarely contend. The returned ident pointers stay valid until
+ * finish_ident().
  */
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "hashptr.h"
 #include "ident_t.h"
+#include "lock.h"
 #include "obst.h"
 #include "set.h"
+#include "xmalloc.h"
 
-static set *id_set;
+/** log2 of the number of shards of the ident table */
+#define ID_SHARD_BITS 4
+#define N_ID_SHARDS   (1u << ID_SHARD_BITS)
 
-/** An obstack used for temporary space */
-static struct obstack id_obst;
+/** A part of the ident table. */
+typedef struct id_shard {
+	set       *ids;  /**< the idents of this shard */
+	ir_lock_t  lock; /**< protects ids */
+} id_shard;
+
+static id_shard id_shards[N_ID_SHARDS];
+
+/** Protects the counter of id_unique(). */
+static ir_lock_t unique_lock;
+
+/** Returns the shard for a hash value. The set uses the lower bits of the
+ * hash for its buckets, so select the shard by the upper bits of a
+ * multiplicative hash, which depend on all bits of the value. */
+static id_shard *get_shard(unsigned hash)
+{
+	uint32_t const mixed = (uint32_t)hash * 0x9E3779B9u;
+	return &id_shards[mixed >> (32 - ID_SHARD_BITS)];
+}
 
 void init_ident(void)
 {
-	/* it's ok to use memcmp here, we check only strings */
-	id_set = new_set(memcmp, 128);
-	obstack_init(&id_obst);
+	for (unsigned i = 0; i < N_ID_SHARDS; ++i) {
+		id_shard *const shard = &id_shards[i];
+		/* it's ok to use memcmp here, we check only strings */
+		shard->ids = new_set(memcmp, 128 / N_ID_SHARDS);
+		ir_lock_init(&shard->lock);
+	}
+	ir_lock_init(&unique_lock);
 }
 
-ident *new_id_from_chars(const char *str, size_t len)
+/** Inserts a string into a shard, the shard must be locked. */
+static ident *shard_insert(id_shard *shard, const char *str, size_t len,
+                           unsigned hash)
 {
-	unsigned   hash   = hash_data((const unsigned char*)str, len);
-	set_entry *result = set_hinsert0(id_set, str, len, hash);
+	set_entry *result = set_hinsert0(shard->ids, str, len, hash);
 	return (ident*)result->dptr;
 }
 
+ident *new_id_from_chars(const char *str, size_t len)
+{
+	unsigned  const hash  = hash_data((const unsigned char*)str, len);
+	id_shard *const shard = get_shard(hash);
+	ir_lock(&shard->lock);
+	ident *const res = shard_insert(shard, str, len, hash);
+	ir_unlock(&shard->lock);
+	return res;
+}
+
 ident *new_id_from_str(const char *str)
 {
 	return new_id_from_chars(str, strlen(str));
 }
 
-static ident *new_ident_from_obst(struct obstack *const obst)
+void new_ids_from_strs(size_t n, const char *const *strs, ident **ids)
 {
-	size_t const len    = obstack_object_size(obst);
-	char  *const string = (char*)obstack_finish(obst);
-	ident *const res    = new_id_from_chars(string, len);
-	obstack_free(obst, string);
-	return res;
+	size_t   *const lens   = XMALLOCN(size_t, n);
+	unsigned *const hashes = XMALLOCN(unsigned, n);
+	unsigned        used   = 0;
+	for (size_t i = 0; i < n; ++i) {
+		size_t   const len  = strlen(strs[i]);
+		unsigned const hash = hash_data((const unsigned char*)strs[i], len);
+		lens[i]   = len;
+		hashes[i] = hash;
+		used     |= 1u << (get_shard(hash) - id_shards);
+	}
+
+	/* take each lock only once */
+	for (unsigned s = 0; s < N_ID_SHARDS; ++s) {
+		if ((used & (1u << s)) == 0)
+			continue;
+		id_shard *const shard = &id_shards[s];
+		ir_lock(&shard->lock);
+		for (size_t i = 0; i < n; ++i) {
+			if (get_shard(hashes[i]) == shard)
+				ids[i] = shard_insert(shard, strs[i], lens[i], hashes[i]);
+		}
+		ir_unlock(&shard->lock);
+	}
+	xfree(hashes);
+	xfree(lens);
 }
 
 ident *new_id_fmt(char const *const fmt, ...)
 {
+	/* a local obstack keeps this reentrant */
+	struct obstack obst;
+	obstack_init(&obst);
+
 	va_list ap;
 	va_start(ap, fmt);
-	obstack_vprintf(&id_obst, fmt, ap);
+	obstack_vprintf(&obst, fmt, ap);
 	va_end(ap);
-	return new_ident_from_obst(&id_obst);
+
+	size_t const len    = obstack_object_size(&obst);
+	char  *const string = (char*)obstack_finish(&obst);
+	ident *const res    = new_id_from_chars(string, len);
+	obstack_free(&obst, NULL);
+	return res;
 }
 
 const char *(get_id_str)(ident *id)
@@ -65,13 +136,20 @@ const char *(get_id_str)(ident *id)
 
 void finish_ident(void)
 {
-	obstack_free(&id_obst, NULL);
-	del_set(id_set);
-	id_set = NULL;
+	for (unsigned i = 0; i < N_ID_SHARDS; ++i) {
+		id_shard *const shard = &id_shards[i];
+		del_set(shard->ids);
+		shard->ids = NULL;
+		ir_lock_destroy(&shard->lock);
+	}
+	ir_lock_destroy(&unique_lock);
 }
 
 ident *id_unique(const char *tag)
 {
 	static unsigned unique_id = 0;
-	return new_id_fmt(tag, unique_id++);
+	ir_lock(&unique_lock);
+	unsigned const id = unique_id++;
+	ir_unlock(&unique_lock);
+	return new_id_fmt(tag, id);
 }
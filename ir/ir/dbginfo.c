@@ -10,10 +10,19 @@
  * @date     2001
  */
 #include "dbginfo_t.h"
+
+#include <stdint.h>
+
+#include "array.h"
+#include "hashptr.h"
+#include "ident_t.h"
 #include "irnode_t.h"
 #include "type_t.h"
 #include "entity_t.h"
 #include "panic.h"
+#include "pmap.h"
+#include "set.h"
+#include "util.h"
 
 merge_pair_func *__dbg_info_merge_pair = default_dbg_info_merge_pair;
 merge_sets_func *__dbg_info_merge_sets = default_dbg_info_merge_sets;
@@ -84,13 +93,101 @@ void default_dbg_info_merge_sets(ir_node *const *new_nodes, int n_new_nodes,
 	}
 }
 
+/** A source location of the interned table. */
+typedef struct interned_loc_t {
+	uint32_t file;   /**< index into the file table + 1, 0 if unknown */
+	uint32_t line;
+	uint16_t column;
+} interned_loc_t;
+
+/** An entry of the lookup set of the interned table. */
+typedef struct interned_loc_entry_t {
+	interned_loc_t loc;
+	uint32_t       index; /**< index of loc in the table */
+} interned_loc_entry_t;
+
+static interned_loc_t *interned_locs;  /**< the interned table */
+static set            *interned_set;   /**< set of interned_loc_entry_t */
+static char const    **interned_files; /**< file names by index */
+static pmap           *file_indices;   /**< file ident -> index + 1 */
+
+static int cmp_interned_loc(const void *elt, const void *key, size_t size)
+{
+	(void)size;
+	interned_loc_t const *const l1 = &((interned_loc_entry_t const*)elt)->loc;
+	interned_loc_t const *const l2 = &((interned_loc_entry_t const*)key)->loc;
+	return l1->file != l2->file || l1->line != l2->line
+	    || l1->column != l2->column;
+}
+
+static uint32_t intern_file(char const *const file)
+{
+	if (file == NULL)
+		return 0;
+	ident *const id  = new_id_from_str(file);
+	uint32_t     num = PTR_TO_INT(pmap_get(void, file_indices, id));
+	if (num == 0) {
+		ARR_APP1(char const*, interned_files, get_id_str(id));
+		num = ARR_LEN(interned_files);
+		pmap_insert(file_indices, id, INT_TO_PTR(num));
+	}
+	return num;
+}
+
+dbg_info *ir_intern_src_loc(src_loc_t const loc)
+{
+	if (interned_locs == NULL) {
+		interned_locs  = NEW_ARR_F(interned_loc_t, 0);
+		interned_set   = new_set(cmp_interned_loc, 64);
+		interned_files = NEW_ARR_F(char const*, 0);
+		file_indices   = pmap_create();
+	}
+
+	/* columns beyond the packed range are dropped */
+	interned_loc_entry_t key = {
+		.loc = {
+			.file   = intern_file(loc.file),
+			.line   = loc.line,
+			.column = loc.column <= UINT16_MAX ? loc.column : 0,
+		},
+		.index = ARR_LEN(interned_locs),
+	};
+	unsigned const hash = hash_combine(hash_combine(key.loc.file, key.loc.line),
+	                                   key.loc.column);
+	interned_loc_entry_t const *const entry
+		= set_insert(interned_loc_entry_t, interned_set, &key, sizeof(key), hash);
+	if (entry->index == ARR_LEN(interned_locs))
+		ARR_APP1(interned_loc_t, interned_locs, key.loc);
+	/* the dbg_info is the index + 1 so that it is never NULL */
+	return (dbg_info*)INT_TO_PTR(entry->index + 1);
+}
+
 static src_loc_t default_retrieve_dbg(dbg_info const *const dbg)
 {
-	(void)dbg;
-	src_loc_t const loc = { NULL, 0, 0 };
+	src_loc_t loc = { NULL, 0, 0 };
+	/* dbg_infos of frontends without a retriever are not in the table range */
+	size_t const index = PTR_TO_INT(dbg) - 1;
+	if (interned_locs != NULL && index < ARR_LEN(interned_locs)) {
+		interned_loc_t const *const interned = &interned_locs[index];
+		if (interned->file != 0)
+			loc.file = interned_files[interned->file - 1];
+		loc.line   = interned->line;
+		loc.column = interned->column;
+	}
 	return loc;
 }
 
+void finish_dbginfo(void)
+{
+	if (interned_locs == NULL)
+		return;
+	DEL_ARR_F(interned_locs);
+	del_set(interned_set);
+	DEL_ARR_F(interned_files);
+	pmap_destroy(file_indices);
+	interned_locs = NULL;
+}
+
 /** The debug info retriever function. */
 static retrieve_dbg_func      retrieve_dbg      = default_retrieve_dbg;
 static retrieve_type_dbg_func retrieve_type_dbg = NULL;
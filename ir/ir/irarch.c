@@ -30,9 +30,11 @@
 #include "irhooks.h"
 #include "ircons.h"
 #include "irarch_t.h"
+#include "irprofile.h"
 #include "irflag.h"
 #include "be.h"
 #include "panic.h"
+#include "util.h"
 
 /** The bit mask, which optimizations to apply. */
 static arch_dep_opts_t opts;
@@ -60,6 +62,7 @@ struct instruction {
 	unsigned     shift_count; /**< shift count for LEA and SHIFT */
 	ir_node     *irn;         /**< the generated node for this instruction */
 	int          costs;       /**< the costs for this instruction */
+	int          latency;     /**< the latency until the result is ready */
 };
 
 /**
@@ -83,6 +86,24 @@ typedef struct mul_env {
 	evaluate_costs_func evaluate;  /**< the evaluate callback */
 } mul_env;
 
+/**
+ * With a profile loaded, a block is cold if it runs less than
+ * 1/PROFILE_COLD_RATIO times as often as the hottest block of the program.
+ */
+#define PROFILE_COLD_RATIO 1000
+
+/**
+ * Returns true if the profile shows that @p block is rarely executed, so
+ * code size matters more than speed.
+ */
+static bool is_cold_block(const ir_node *block)
+{
+	uint32_t const max_count = ir_profile_get_max_execcount();
+	uint32_t       count;
+	return max_count > 0 && ir_profile_find_block_execcount(block, &count)
+	    && (uint64_t)count * PROFILE_COLD_RATIO < max_count;
+}
+
 /**
  * Some kind of default evaluator. Return the cost of
  * instructions.
@@ -96,6 +117,18 @@ static int default_evaluate(insn_kind kind, const ir_mode *mode, ir_tarval *tv)
 	return 1;
 }
 
+/**
+ * The default size evaluator: Every instruction has the same size.
+ */
+static int default_evaluate_size(insn_kind kind, const ir_mode *mode,
+                                 ir_tarval *tv)
+{
+	(void)kind;
+	(void)mode;
+	(void)tv;
+	return 1;
+}
+
 /**
  * emit a LEA (or an Add) instruction
  */
@@ -109,6 +142,7 @@ static instruction *emit_LEA(mul_env *env, instruction *a, instruction *b,
 	res->shift_count = shift;
 	res->irn = NULL;
 	res->costs = -1;
+	res->latency = -1;
 	return res;
 }
 
@@ -137,6 +171,7 @@ static instruction *emit_SHIFT(mul_env *env, instruction *a, unsigned shift)
 	}
 	res->irn = NULL;
 	res->costs = -1;
+	res->latency = -1;
 	return res;
 }
 
@@ -152,6 +187,7 @@ static instruction *emit_SUB(mul_env *env, instruction *a, instruction *b)
 	res->shift_count = 0;
 	res->irn = NULL;
 	res->costs = -1;
+	res->latency = -1;
 	return res;
 }
 
@@ -167,6 +203,7 @@ static instruction *emit_ROOT(mul_env *env, ir_node *root_op)
 	res->shift_count = 0;
 	res->irn = root_op;
 	res->costs = 0;
+	res->latency = 0;
 	return res;
 }
 
@@ -471,6 +508,25 @@ static int evaluate_insn(mul_env *env, instruction *inst)
 	panic("unsupported instruction kind");
 }
 
+/**
+ * Calculate the length of the critical path of the given instruction
+ * sequence, i.e. the latency of its result.
+ */
+static int evaluate_latency(mul_env *env, instruction *inst)
+{
+	if (inst->latency >= 0)
+		return inst->latency;
+
+	int latency = 0;
+	for (size_t i = 0; i < ARRAY_SIZE(inst->in); ++i) {
+		if (inst->in[i] != NULL)
+			latency = MAX(latency, evaluate_latency(env, inst->in[i]));
+	}
+	latency += env->evaluate(inst->kind, env->mode, NULL);
+	inst->latency = latency;
+	return latency;
+}
+
 /**
  * Evaluate the replacement instructions and build a new graph
  * if faster than the Mul.
@@ -493,18 +549,33 @@ static ir_node *do_decomposition(ir_node *irn, ir_node *operand, ir_tarval *tv)
 	env.root     = emit_ROOT(&env, operand);
 	env.fail     = false;
 	env.n_shift  = env.params->maximum_shifts;
-	env.evaluate = env.params->evaluate != NULL ? env.params->evaluate
-	                                            : default_evaluate;
 	env.irg      = get_irn_irg(irn);
 
+	/* cold blocks are optimized for size, the others for latency */
+	bool const cold = is_cold_block(get_nodes_block(irn));
+	if (cold) {
+		env.evaluate = env.params->evaluate_size != NULL
+		             ? env.params->evaluate_size : default_evaluate_size;
+	} else {
+		env.evaluate = env.params->evaluate != NULL
+		             ? env.params->evaluate : default_evaluate;
+	}
+
 	int            r;
 	unsigned char *R    = value_to_condensed(&env, tv, &r);
 	instruction   *inst = decompose_mul(&env, R, r, tv);
 
-	/* the paper suggests 70% here */
-	int      mul_costs = (env.evaluate(MUL, env.mode, tv) * 7 + 5) / 10;
-	ir_node *res       = irn;
-	if (evaluate_insn(&env, inst) <= mul_costs && !env.fail) {
+	/* The costs also check the shift constraints. The paper suggests 70% of
+	 * the Mul for the latency, which leaves room for the higher register
+	 * pressure of the sequence. The sum of the costs bounds the number of
+	 * instructions issued instead of the Mul. */
+	int const costs    = evaluate_insn(&env, inst);
+	int const mul_cost = env.evaluate(MUL, env.mode, tv);
+	bool      faster   = costs <= mul_cost;
+	if (!cold)
+		faster &= evaluate_latency(&env, inst) <= (mul_cost * 7 + 5) / 10;
+	ir_node *res = irn;
+	if (faster && !env.fail) {
 		env.op       = operand;
 		env.blk      = get_nodes_block(irn);
 		env.dbg      = get_irn_dbg_info(irn);
@@ -964,8 +1035,8 @@ ir_node *arch_dep_replace_div_by_const(ir_node *irn)
 			res    = new_rd_Shr(dbg, block, left, k_node, mode);
 		}
 	} else if (k != 0) {
-		/* other constant */
-		if (allow_Mulh(params, mode))
+		/* other constant, the Mulh sequence is larger than the Div */
+		if (allow_Mulh(params, mode) && !is_cold_block(block))
 			res = replace_div_by_mulh(irn, tv);
 	} else { /* k == 0  i.e. division by 1 */
 		res = left;
@@ -1045,8 +1116,8 @@ ir_node *arch_dep_replace_mod_by_const(ir_node *irn)
 			ir_node *k_node = new_r_Const(irg, k_val);
 			res = new_rd_And(dbg, block, left, k_node, mode);
 		}
-	/* other constant */
-	} else if (allow_Mulh(params, mode)) {
+	/* other constant, the Mulh sequence is larger than the Mod */
+	} else if (allow_Mulh(params, mode) && !is_cold_block(block)) {
 		res = replace_div_by_mulh(irn, tv);
 		res = new_rd_Mul(dbg, block, res, c, mode);
 		res = new_rd_Sub(dbg, block, left, res, mode);
@@ -33,7 +33,7 @@ typedef enum insn_kind {
  * @param mode   the mode of the instruction
  * @param tv     for MUL instruction, the multiplication constant
  *
- * @return the costs of this instruction
+ * @return the costs of this instruction, i.e. its latency or its size
  */
 typedef int (*evaluate_costs_func)(insn_kind kind, const ir_mode *mode, ir_tarval *tv);
 
@@ -48,7 +48,10 @@ struct ir_settings_arch_dep_t {
 	unsigned highest_shift_amount; /**< The highest shift amount you want to
 	                                    tolerate. Muls which would require a higher
 	                                    shift constant are left. */
-	evaluate_costs_func evaluate;  /**< Evaluate the costs of a generated instruction. */
+	evaluate_costs_func evaluate;  /**< Evaluate the latency of a generated
+	                                    instruction, used in normal blocks. */
+	evaluate_costs_func evaluate_size; /**< Evaluate the size of a generated
+	                                        instruction, used in cold blocks. */
 
 	/* Div/Mod optimization */
 	unsigned allow_mulhs   : 1;    /**< Use the Mulhs operation for division by constant */
@@ -66,6 +69,8 @@ typedef const ir_settings_arch_dep_t *(*arch_dep_params_factory_t)(void);
 /**
  * Replaces Muls with Lea/Shifts/Add/Subs if these
  * have smaller costs than the original multiplication.
+ * The latency of the sequence is compared in normal blocks and its size in
+ * blocks, which are cold according to the profile.
  *
  * @param irn       The Firm node to inspect.
  * @return          A replacement expression for irn.
@@ -83,6 +88,8 @@ ir_node *arch_dep_replace_mul_with_shifts(ir_node *irn);
  * requirements of the variables stated above. If a Shl/Add/Sub/Mulh
  * sequence can be generated that meets these requirements, this expression
  * is returned. In each other case irn is returned unmodified.
+ * Divisions by other constants than powers of two are kept in cold blocks,
+ * as the Mulh sequence is larger.
  *
  * @param irn       The Firm node to inspect.
  * @return          A replacement expression for irn.
@@ -100,6 +107,7 @@ ir_node *arch_dep_replace_div_by_const(ir_node *irn);
  * requirements of the variables stated above. If a Shl/Add/Sub/Mulh
  * sequence can be generated that meets these requirements, this expression
  * is returned. In each other case irn is returned unmodified.
+ * Modulos by other constants than powers of two are kept in cold blocks.
  *
  * @param irn       The Firm node to inspect.
  * @return          A replacement expression for irn.
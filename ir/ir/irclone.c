@@ -0,0 +1,60 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Copying of (sub)graphs into a graph.
+ */
+#include "irclone.h"
+
+#include "array.h"
+#include "iropt_t.h"
+#include "irtools.h"
+
+void ir_cloner_init(ir_cloner_t *cloner, const ir_graph *src, ir_graph *dst)
+{
+	ir_nodemap_init(&cloner->map, src);
+	/* reserve room for every node of src at once */
+	cloner->cloned = NEW_ARR_F(ir_node*, get_irg_last_idx(src));
+	ARR_SHRINKLEN(cloner->cloned, 0);
+	cloner->irg = dst;
+}
+
+void ir_cloner_destroy(ir_cloner_t *cloner)
+{
+	ir_nodemap_destroy(&cloner->map);
+	DEL_ARR_F(cloner->cloned);
+}
+
+ir_node *ir_cloner_copy(ir_cloner_t *cloner, const ir_node *node)
+{
+	ir_node *const copy = irn_copy_into_irg(node, cloner->irg);
+	ir_cloner_map(cloner, node, copy);
+	ARR_APP1(ir_node*, cloner->cloned, (ir_node*)node);
+	return copy;
+}
+
+static ir_node *get_copy_or_self(const ir_cloner_t *cloner, ir_node *node)
+{
+	ir_node *const copy = ir_cloner_get(cloner, node);
+	return copy != NULL ? copy : node;
+}
+
+void ir_cloner_rewire(ir_cloner_t *cloner)
+{
+	for (size_t i = 0, n = ARR_LEN(cloner->cloned); i < n; ++i) {
+		ir_node *const node = cloner->cloned[i];
+		ir_node *const copy = ir_cloner_get(cloner, node);
+		if (!is_Block(node))
+			set_nodes_block(copy, get_copy_or_self(cloner, get_nodes_block(node)));
+
+		foreach_irn_in(node, j, in) {
+			set_irn_n(copy, j, get_copy_or_self(cloner, in));
+		}
+
+		/* Now the copy is complete. We can add it to the hash table for CSE. */
+		add_identities(copy);
+	}
+}
@@ -0,0 +1,71 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Copying of (sub)graphs into a graph.
+ *
+ * A cloner maps the nodes of a source graph to their copies with a dense map
+ * indexed by the node index.  Nodes are first copied with their inputs still
+ * pointing to the original nodes, then ir_cloner_rewire() sets the block and
+ * the inputs of all copies in a single pass over the copied nodes.
+ */
+#ifndef FIRM_IR_IRCLONE_H
+#define FIRM_IR_IRCLONE_H
+
+#include "firm_types.h"
+#include "irnodemap.h"
+
+typedef struct ir_cloner_t {
+	ir_nodemap  map;    /**< maps original nodes to their copies */
+	ir_node   **cloned; /**< originals copied by ir_cloner_copy(), ARR_F */
+	ir_graph   *irg;    /**< the graph receiving the copies */
+} ir_cloner_t;
+
+/**
+ * Initializes a cloner copying nodes of @p src into @p dst.
+ * The map and the list of copied nodes are sized for all nodes of @p src.
+ */
+void ir_cloner_init(ir_cloner_t *cloner, const ir_graph *src, ir_graph *dst);
+
+/**
+ * Frees all memory used by a cloner.  The copies are not affected.
+ */
+void ir_cloner_destroy(ir_cloner_t *cloner);
+
+/**
+ * Uses @p copy as the copy of @p node, without copying @p node.
+ * The inputs of @p copy are not changed by ir_cloner_rewire().
+ */
+static inline void ir_cloner_map(ir_cloner_t *cloner, const ir_node *node,
+                                 ir_node *copy)
+{
+	ir_nodemap_insert(&cloner->map, node, copy);
+}
+
+/**
+ * Returns the copy of @p node, NULL if @p node was neither copied nor mapped.
+ */
+static inline ir_node *ir_cloner_get(const ir_cloner_t *cloner,
+                                     const ir_node *node)
+{
+	return ir_nodemap_get(ir_node, &cloner->map, node);
+}
+
+/**
+ * Copies @p node with its attributes into the target graph.  The block and
+ * inputs of the copy still point to the original nodes until
+ * ir_cloner_rewire() is called.
+ */
+ir_node *ir_cloner_copy(ir_cloner_t *cloner, const ir_node *node);
+
+/**
+ * Sets the block and inputs of all copies made so far to the copies of the
+ * original block and inputs.  Inputs without a copy are kept, so a region can
+ * be copied inside its own graph.  The copies are entered into the CSE table.
+ */
+void ir_cloner_rewire(ir_cloner_t *cloner);
+
+#endif
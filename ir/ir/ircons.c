@@ -34,6 +34,109 @@
  */
 static uninitialized_local_variable_func_t *default_initialize_local_variable = NULL;
 
+/** Graphs with at least this many local variables keep the construction
+ * values of their blocks in sparse maps instead of arrays. */
+#define SPARSE_VALUES_MIN_LOC  128
+/** Initial number of slots of a sparse value map, a power of two. */
+#define VALUE_MAP_INITIAL_SIZE 8
+
+typedef struct value_map_entry_t {
+	int      pos;
+	ir_node *value; /**< NULL marks a free slot */
+} value_map_entry_t;
+
+/** An open addressed hash map from value numbers to values. */
+struct ir_value_map_t {
+	unsigned          n_entries;
+	unsigned          mask;      /**< number of slots minus one */
+	value_map_entry_t entries[];
+};
+
+static bool has_sparse_values(ir_graph const *const irg)
+{
+	return irg->n_loc >= SPARSE_VALUES_MIN_LOC;
+}
+
+static ir_value_map_t *new_value_map(ir_graph *const irg, unsigned const size)
+{
+	ir_value_map_t *const map
+		= OALLOCFZ(get_irg_obstack(irg), ir_value_map_t, entries, size);
+	map->mask = size - 1;
+	return map;
+}
+
+void alloc_graph_values(ir_node *const block)
+{
+	ir_graph   *const irg = get_irn_irg(block);
+	block_attr *const b   = &block->attr.block;
+	if (has_sparse_values(irg)) {
+		b->values.value_map = new_value_map(irg, VALUE_MAP_INITIAL_SIZE);
+	} else {
+		b->values.graph_arr
+			= NEW_ARR_DZ(ir_node*, get_irg_obstack(irg), irg->n_loc);
+	}
+}
+
+/** Returns the slot of @p pos in @p map or the free slot to insert it. */
+static value_map_entry_t *find_value_entry(ir_value_map_t *const map,
+                                           int const pos)
+{
+	for (unsigned i = (unsigned)pos & map->mask;; i = (i + 1) & map->mask) {
+		value_map_entry_t *const entry = &map->entries[i];
+		if (entry->value == NULL || entry->pos == pos)
+			return entry;
+	}
+}
+
+static ir_value_map_t *grow_value_map(ir_graph *const irg,
+                                      ir_value_map_t const *const map)
+{
+	unsigned        const size    = map->mask + 1;
+	ir_value_map_t *const new_map = new_value_map(irg, 2 * size);
+	for (unsigned i = 0; i < size; ++i) {
+		value_map_entry_t const *const entry = &map->entries[i];
+		if (entry->value != NULL)
+			*find_value_entry(new_map, entry->pos) = *entry;
+	}
+	new_map->n_entries = map->n_entries;
+	return new_map;
+}
+
+/** Returns the value @p pos of @p block during construction. */
+static ir_node *get_block_value(ir_node *const block, int const pos)
+{
+	block_attr *const b = &block->attr.block;
+	if (!has_sparse_values(get_irn_irg(block)))
+		return b->values.graph_arr[pos];
+	return find_value_entry(b->values.value_map, pos)->value;
+}
+
+/** Sets the value @p pos of @p block during construction. */
+static void set_block_value(ir_node *const block, int const pos,
+                            ir_node *const value)
+{
+	ir_graph   *const irg = get_irn_irg(block);
+	block_attr *const b   = &block->attr.block;
+	if (!has_sparse_values(irg)) {
+		b->values.graph_arr[pos] = value;
+		return;
+	}
+
+	ir_value_map_t    *map   = b->values.value_map;
+	value_map_entry_t *entry = find_value_entry(map, pos);
+	if (entry->value == NULL) {
+		/* keep at least half of the slots free */
+		if (2 * (map->n_entries + 1) > map->mask + 1) {
+			map                 = grow_value_map(irg, map);
+			b->values.value_map = map;
+			entry               = find_value_entry(map, pos);
+		}
+		++map->n_entries;
+		entry->pos = pos;
+	}
+	entry->value = value;
+}
+
 ir_node *new_rd_Const_long(dbg_info *db, ir_graph *irg, ir_mode *mode,
                            long value)
 {
@@ -194,7 +297,7 @@ static ir_node *set_phi_arguments(ir_node *phi, int pos)
  */
 static ir_node *get_r_value_internal(ir_node *block, int pos, ir_mode *mode)
 {
-	ir_node *res = block->attr.block.graph_arr[pos];
+	ir_node *res = get_block_value(block, pos);
 	if (res != NULL)
 		return res;
 
@@ -231,7 +334,7 @@ bad:
 			res = new_rd_Phi0(NULL, block, mode, pos);
 			/* enter phi0 into our variable value table to break cycles
 			 * arising from set_phi_arguments */
-			block->attr.block.graph_arr[pos] = res;
+			set_block_value(block, pos, res);
 			res = set_phi_arguments(res, pos);
 		}
 	} else {
@@ -241,7 +344,7 @@ bad:
 		res->attr.phi.next     = block->attr.block.phis;
 		block->attr.block.phis = res;
 	}
-	block->attr.block.graph_arr[pos] = res;
+	set_block_value(block, pos, res);
 	return res;
 }
 
@@ -281,8 +384,8 @@ void mature_immBlock(ir_node *block)
 		ir_node *const next      = phi->attr.phi.next;
 		int      const pos       = phi->attr.phi.u.pos;
 		ir_node *const new_value = set_phi_arguments(phi, pos);
-		if (block->attr.block.graph_arr[pos] == phi)
-			block->attr.block.graph_arr[pos] = new_value;
+		if (get_block_value(block, pos) == phi)
+			set_block_value(block, pos, new_value);
 		phi = next;
 	}
 
@@ -388,8 +491,8 @@ ir_node *new_rd_immBlock(dbg_info *dbgi, ir_graph *irg)
 
 	set_Block_block_visited(res, 0);
 
-	/* Create and initialize array for Phi-node construction. */
-	res->attr.block.graph_arr = NEW_ARR_DZ(ir_node*, get_irg_obstack(irg), irg->n_loc);
+	/* Create and initialize the values for Phi-node construction. */
+	alloc_graph_values(res);
 
 	/* Immature block may not be optimized! */
 	verify_new_node(res);
@@ -468,7 +571,7 @@ static ir_mode *guess_recursively(ir_node *block, int pos)
 		return NULL;
 
 	/* already have a defintion -> we can simply look at its mode */
-	ir_node *const value = block->attr.block.graph_arr[pos];
+	ir_node *const value = get_block_value(block, pos);
 	if (value != NULL)
 		return get_irn_mode(value);
 
@@ -490,7 +593,7 @@ ir_mode *ir_r_guess_mode(ir_graph *irg, int pos)
 {
 	/* already have a defintion -> we can simply look at its mode */
 	ir_node *const block = irg->current_block;
-	ir_node *const value = block->attr.block.graph_arr[pos+1];
+	ir_node *const value = get_block_value(block, pos + 1);
 	if (value != NULL)
 		return get_irn_mode(value);
 
@@ -513,7 +616,7 @@ void set_r_value(ir_graph *irg, int pos, ir_node *value)
 	assert(pos >= 0);
 	assert(pos + 1 < irg->n_loc);
 	assert(value->kind == k_ir_node);
-	irg->current_block->attr.block.graph_arr[pos + 1] = value;
+	set_block_value(irg->current_block, pos + 1, value);
 }
 
 void set_value(int pos, ir_node *value)
@@ -536,7 +639,7 @@ void set_r_store(ir_graph *const irg, ir_node *store)
 {
 	assert(irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_CONSTRUCTION));
 	assert(get_irn_mode(store) == mode_M && "storing non-memory node");
-	irg->current_block->attr.block.graph_arr[0] = store;
+	set_block_value(irg->current_block, 0, store);
 }
 
 void set_store(ir_node *store)
@@ -556,6 +659,55 @@ void ir_set_uninitialized_local_variable_func(
 	default_initialize_local_variable = func;
 }
 
+void new_r_nodes(ir_graph *const irg, size_t const n_nodes,
+                 ir_node_desc const *const descs, ir_node **const nodes)
+{
+	new_ir_nodes(irg, n_nodes, descs, nodes);
+
+	/* Attributes which are not accessible through setters are initialized
+	 * like the node constructors do. */
+	struct obstack *const obst = get_irg_obstack(irg);
+	for (size_t i = 0; i < n_nodes; ++i) {
+		ir_node_desc const *const desc = &descs[i];
+		ir_node            *const node = nodes[i];
+		if (desc->op == NULL)
+			continue;
+		assert(desc->op != op_Start && desc->op != op_End
+		    && desc->op != op_Anchor);
+		if (is_Block(node)) {
+			node->attr.block.backedge = new_backedge_arr(obst, desc->arity);
+			set_Block_matured(node, 1);
+			if (irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_CONSTRUCTION))
+				alloc_graph_values(node);
+		} else if (is_Phi(node)) {
+			node->attr.phi.u.backedge = new_backedge_arr(obst, desc->arity);
+		}
+	}
+}
+
+void optimize_new_nodes(size_t const n_nodes, ir_node_desc const *const descs,
+                        ir_node **const nodes)
+{
+	for (size_t i = 0; i < n_nodes; ++i) {
+		if (descs[i].op == NULL)
+			continue;
+
+		/* Operands replaced earlier in the batch may have become Ids. */
+		ir_node *const node = nodes[i];
+		foreach_irn_in(node, n, pred) {
+			if (is_Id(pred))
+				set_irn_n(node, n, skip_Id(pred));
+		}
+		verify_new_node(node);
+
+		ir_node *const res = optimize_in_place_2(node);
+		if (res != node) {
+			exchange(node, res);
+			nodes[i] = res;
+		}
+	}
+}
+
 void irg_finalize_cons(ir_graph *irg)
 {
 	ir_node *end_block = get_irg_end_block(irg);
@@ -599,10 +751,9 @@ ir_node *new_r_Block_noopt(ir_graph *irg, int arity, ir_node *in[])
 	ir_node *res = new_ir_node(NULL, irg, NULL, op_Block, mode_BB, arity, in);
 	res->attr.block.backedge = new_backedge_arr(get_irg_obstack(irg), arity);
 	set_Block_matured(res, 1);
-	/* Create and initialize array for Phi-node construction. */
-	if (irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_CONSTRUCTION)) {
-		res->attr.block.graph_arr = NEW_ARR_DZ(ir_node*, get_irg_obstack(irg), irg->n_loc);
-	}
+	/* Create and initialize the values for Phi-node construction. */
+	if (irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_CONSTRUCTION))
+		alloc_graph_values(res);
 	verify_new_node(res);
 	return res;
 }
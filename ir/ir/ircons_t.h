@@ -44,6 +44,19 @@ ir_node *new_r_Anchor(ir_graph *irg);
  * This is an internal helper function for new_ir_graph() */
 ir_node *new_r_Block_noopt(ir_graph *irg, int arity, ir_node *in[]);
 
+/**
+ * Allocates and initializes the nodes of a batch, see new_r_nodes().  The
+ * attributes of the nodes are zero.
+ */
+void new_ir_nodes(ir_graph *irg, size_t n_nodes, ir_node_desc const *descs,
+                  ir_node **nodes);
+
+/**
+ * Allocates the values of @p block for SSA construction, a sparse map if the
+ * graph has many local variables.
+ */
+void alloc_graph_values(ir_node *block);
+
 /**
  * Allocate a frag array for a node if the current graph state is phase_building.
  *
@@ -9,11 +9,18 @@
  * @author  Martin Trapp, Christian Schaefer, Goetz Lindenmaier, Hubert Schmidt,
  *          Matthias Braun
  */
+/* for open_memstream */
+#define _POSIX_C_SOURCE 200809L
+
 #include <string.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <limits.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
 
 #include "irnode_t.h"
 #include "irgraph_t.h"
@@ -23,7 +30,7 @@
 
 #include "irdump_t.h"
 
-#include "irgwalk.h"
+#include "irgwalk_t.h"
 #include "tv_t.h"
 #include "irouts_t.h"
 #include "iredges_t.h"
@@ -198,7 +205,7 @@ static char *dump_filter;
 
 void ir_set_dump_filter(const char *new_filter)
 {
-	free(dump_filter);
+	xfree(dump_filter);
 	dump_filter = xstrdup(new_filter);
 }
 
@@ -213,6 +220,31 @@ static int ir_should_dump(const char *name)
 	return !dump_filter || strstart(name, dump_filter);
 }
 
+static char    *dump_node_filter;
+static unsigned dump_radius;
+
+void ir_set_dump_node_filter(const char *filter)
+{
+	xfree(dump_node_filter);
+	dump_node_filter = filter != NULL && filter[0] != '\0'
+	                 ? xstrdup(filter) : NULL;
+}
+
+const char *ir_get_dump_node_filter(void)
+{
+	return dump_node_filter != NULL ? dump_node_filter : "";
+}
+
+void ir_set_dump_radius(unsigned radius)
+{
+	dump_radius = radius;
+}
+
+unsigned ir_get_dump_radius(void)
+{
+	return dump_radius;
+}
+
 /* -------------- some extended helper functions ----------------- */
 
 #define CUSTOM_COLOR_BASE    100
@@ -547,16 +579,20 @@ static int node_floats(const ir_node *n)
 }
 
 /**
- *  Walker that visits the anchors
+ * Walker that visits the anchors.
+ * Graphs are dumped in the middle of other walks, so the visited counters of
+ * the nodes are left alone.
  */
 static void ird_walk_graph(ir_graph *irg, irg_walk_func *pre, irg_walk_func *post, void *env)
 {
+	ir_node *start = get_irg_end(irg);
 	if ((flags & ir_dump_flag_all_anchors)
 			|| ((flags & ir_dump_flag_iredges) && edges_activated(irg))) {
-		irg_walk_anchors(irg, pre, post, env);
-	} else {
-		irg_walk_graph(irg, pre, post, env);
+		start = irg->anchor;
 	}
+	bitset_t *const visited = bitset_malloc(get_irg_last_idx(irg));
+	irg_walk_bitset(start, visited, pre, post, env);
+	xfree(visited);
 }
 
 /**
@@ -600,22 +636,12 @@ static void collect_node(ir_node *node, void *env)
  */
 static ir_node **construct_block_lists(ir_graph *irg)
 {
-	int const walk_flag = ir_resources_reserved(irg) & IR_RESOURCE_IRN_VISITED;
-
-	if (walk_flag) {
-		ir_free_resources(irg, IR_RESOURCE_IRN_VISITED);
-	}
-
 	foreach_irp_irg_r(i, irg) {
 		ird_set_irg_link(irg, NULL);
 	}
 
 	ird_walk_graph(irg, clear_link, collect_node, irg);
 
-	if (walk_flag) {
-		ir_reserve_resources(irg, IR_RESOURCE_IRN_VISITED);
-	}
-
 	return (ir_node**)ird_get_irg_link(irg);
 }
 
@@ -883,7 +909,7 @@ hook_entry_t *dump_add_node_info_callback(dump_node_info_cb_t *cb, void *data)
 void dump_remove_node_info_callback(hook_entry_t *const info)
 {
 	unregister_hook(hook_node_info, info);
-	free(info);
+	xfree(info);
 }
 
 /**
@@ -1719,6 +1745,125 @@ void dump_blocks_as_subgraphs(FILE *out, ir_graph *irg)
 	DEL_ARR_F(arr);
 }
 
+/** Distance of nodes outside of the dumped region. */
+#define REGION_NONE   UINT_MAX
+/** Distance of operands dumped at the border of the region. */
+#define REGION_BORDER (UINT_MAX - 1)
+
+typedef struct region_env_t {
+	ir_node  **nodes; /**< all nodes of the graph in walk order */
+	unsigned  *dist;  /**< distance to the next matching node by index */
+} region_env_t;
+
+/** Returns true if @p node is selected by the node filter. */
+static bool matches_node_filter(const ir_node *node)
+{
+	const char *const opname = get_irn_opname(node);
+	for (const char *item = dump_node_filter; *item != '\0';) {
+		const char *end = strchr(item, ',');
+		if (end == NULL)
+			end = item + strlen(item);
+		size_t const len = end - item;
+
+		char      *nr_end;
+		long const nr = strtol(item, &nr_end, 10);
+		if (len > 0 && nr_end == end) {
+			if (nr == get_irn_node_nr(node))
+				return true;
+		} else if (strlen(opname) == len && strncmp(opname, item, len) == 0) {
+			return true;
+		}
+		item = *end != '\0' ? end + 1 : end;
+	}
+	return false;
+}
+
+static void collect_region_node(ir_node *node, void *data)
+{
+	region_env_t *const env = (region_env_t*)data;
+	ARR_APP1(ir_node*, env->nodes, node);
+	if (matches_node_filter(node))
+		env->dist[get_irn_idx(node)] = 0;
+}
+
+/**
+ * Dumps the nodes selected by the node filter and the radius.  Only the
+ * selected nodes and the operands they use are written, so the size of the
+ * dump does not depend on the size of the graph.
+ */
+static void dump_node_region(FILE *F, ir_graph *irg)
+{
+	unsigned const n_idx = get_irg_last_idx(irg);
+	region_env_t   env;
+	env.nodes = NEW_ARR_F(ir_node*, 0);
+	env.dist  = XMALLOCN(unsigned, n_idx);
+	for (unsigned i = 0; i < n_idx; ++i)
+		env.dist[i] = REGION_NONE;
+	ird_walk_graph(irg, NULL, collect_region_node, &env);
+
+	unsigned *const dist = env.dist;
+	size_t    const n    = ARR_LEN(env.nodes);
+	/* a matching block selects its contents */
+	for (size_t i = 0; i < n; ++i) {
+		ir_node *const node = env.nodes[i];
+		if (!is_Block(node) && dist[get_irn_idx(get_nodes_block(node))] == 0)
+			dist[get_irn_idx(node)] = 0;
+	}
+
+	/* grow the region by one edge per round, block inputs are not followed
+	 * as they would add whole blocks */
+	for (unsigned r = 1; r <= dump_radius; ++r) {
+		for (size_t i = 0; i < n; ++i) {
+			ir_node  *const node = env.nodes[i];
+			unsigned *const d    = &dist[get_irn_idx(node)];
+			foreach_irn_in(node, p, pred) {
+				unsigned *const dp = &dist[get_irn_idx(pred)];
+				if (*d == r - 1 && *dp == REGION_NONE)
+					*dp = r;
+				else if (*dp == r - 1 && *d == REGION_NONE)
+					*d = r;
+			}
+		}
+	}
+
+	/* operands and blocks of the region are dumped without their edges */
+	for (size_t i = 0; i < n; ++i) {
+		ir_node *const node = env.nodes[i];
+		if (dist[get_irn_idx(node)] >= REGION_BORDER)
+			continue;
+		foreach_irn_in(node, p, pred) {
+			unsigned *const dp = &dist[get_irn_idx(pred)];
+			if (*dp == REGION_NONE)
+				*dp = REGION_BORDER;
+		}
+		if (!is_Block(node)) {
+			unsigned *const db = &dist[get_irn_idx(get_nodes_block(node))];
+			if (*db == REGION_NONE)
+				*db = REGION_BORDER;
+		}
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+		ir_node *const node = env.nodes[i];
+		unsigned const d    = dist[get_irn_idx(node)];
+		if (d == REGION_NONE)
+			continue;
+		if (d == REGION_BORDER) {
+			overrule_nodecolor = ird_color_block_inout;
+			dump_node(F, node);
+			overrule_nodecolor = ird_color_default_node;
+			continue;
+		}
+		dump_node(F, node);
+		dump_ir_data_edges(F, node);
+		if (!node_floats(node))
+			dump_ir_block_edge(F, node);
+	}
+
+	xfree(env.dist);
+	DEL_ARR_F(env.nodes);
+}
+
 void dump_ir_graph_file(FILE *out, ir_graph *irg)
 {
 	dump_vcg_header(out, get_irg_dump_name(irg), NULL, NULL);
@@ -1731,6 +1876,14 @@ void dump_ir_graph_file(FILE *out, ir_graph *irg)
 	dump_graph_info(out, irg);
 	print_dbg_info(out, get_entity_dbg_info(ent));
 
+	if (dump_node_filter != NULL) {
+		/* type info and out edges would refer to nodes missing in the dump */
+		dump_node_region(out, irg);
+		fprintf(out, "}\n\n");
+		dump_vcg_footer(out);
+		return;
+	}
+
 	/* dump nodes */
 	if (flags & ir_dump_flag_blocks_as_subgraphs) {
 		dump_blocks_as_subgraphs(out, irg);
@@ -2127,7 +2280,7 @@ static char  *dump_path;
 
 void ir_set_dump_path(const char *path)
 {
-	free(dump_path);
+	xfree(dump_path);
 	dump_path = xstrdup(path);
 }
 
@@ -2162,6 +2315,158 @@ static void add_dump_path(void)
 	}
 }
 
+/** Size of the stdio buffer of dump files. */
+#define DUMP_BUFFER_SIZE      (1024 * 1024)
+/** Dumping waits while more memory than this is waiting to be written. */
+#define MAX_PENDING_DUMP_SIZE (64 * 1024 * 1024)
+
+/** A dump file, written directly or formatted in memory. */
+typedef struct dump_file_t {
+	FILE   *out;
+	char   *file_name; /**< name of the file to write in the background */
+	char   *data;
+	size_t  size;
+} dump_file_t;
+
+static void write_dump_file(const char *file_name, const char *data,
+                            size_t size)
+{
+	FILE *const out = fopen(file_name, "wb");
+	if (out == NULL) {
+		fprintf(stderr, "Couldn't open '%s': %s\n", file_name, strerror(errno));
+		return;
+	}
+	fwrite(data, 1, size, out);
+	fclose(out);
+}
+
+#ifndef _WIN32
+/** A dump formatted in memory, which waits to be written. */
+typedef struct pending_dump_t pending_dump_t;
+struct pending_dump_t {
+	pending_dump_t *next;
+	char           *file_name;
+	char           *data;
+	size_t          size;
+};
+
+static bool             dump_async;
+static pthread_mutex_t  pending_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   pending_cond = PTHREAD_COND_INITIALIZER;
+static pending_dump_t  *pending_first;
+static pending_dump_t **pending_last = &pending_first;
+static size_t           pending_size;
+static bool             writer_running;
+
+/** Writes the pending dumps until there are no more. */
+static void *write_pending_dumps(void *data)
+{
+	(void)data;
+	pthread_mutex_lock(&pending_lock);
+	for (pending_dump_t *dump; (dump = pending_first) != NULL;) {
+		pthread_mutex_unlock(&pending_lock);
+		write_dump_file(dump->file_name, dump->data, dump->size);
+		pthread_mutex_lock(&pending_lock);
+
+		pending_first = dump->next;
+		if (pending_first == NULL)
+			pending_last = &pending_first;
+		pending_size -= dump->size;
+		pthread_cond_broadcast(&pending_cond);
+		xfree(dump->file_name);
+		/* the data comes from open_memstream(), so it belongs to libc */
+		free(dump->data);
+		xfree(dump);
+	}
+	writer_running = false;
+	pthread_cond_broadcast(&pending_cond);
+	pthread_mutex_unlock(&pending_lock);
+	return NULL;
+}
+
+/** Hands a dump formatted in memory to the writer thread, which is started
+ * if it is not running. */
+static void queue_dump(char *file_name, char *data, size_t size)
+{
+	pending_dump_t *const dump = XMALLOC(pending_dump_t);
+	dump->next      = NULL;
+	dump->file_name = file_name;
+	dump->data      = data;
+	dump->size      = size;
+
+	pthread_mutex_lock(&pending_lock);
+	while (writer_running && pending_size > MAX_PENDING_DUMP_SIZE)
+		pthread_cond_wait(&pending_cond, &pending_lock);
+	*pending_last  = dump;
+	pending_last   = &dump->next;
+	pending_size  += size;
+	bool const start = !writer_running;
+	writer_running = true;
+	pthread_mutex_unlock(&pending_lock);
+
+	if (start) {
+		pthread_t      thread;
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+		if (pthread_create(&thread, &attr, write_pending_dumps, NULL) != 0)
+			write_pending_dumps(NULL);
+		pthread_attr_destroy(&attr);
+	}
+}
+#endif
+
+void ir_set_dump_async(int enable)
+{
+#ifndef _WIN32
+	dump_async = enable;
+#else
+	(void)enable;
+#endif
+}
+
+void ir_dump_wait(void)
+{
+#ifndef _WIN32
+	pthread_mutex_lock(&pending_lock);
+	while (writer_running)
+		pthread_cond_wait(&pending_cond, &pending_lock);
+	pthread_mutex_unlock(&pending_lock);
+#endif
+}
+
+static bool open_dump_file(dump_file_t *file, const char *file_name)
+{
+	file->file_name = NULL;
+#ifndef _WIN32
+	if (dump_async) {
+		file->out = open_memstream(&file->data, &file->size);
+		if (file->out != NULL) {
+			file->file_name = xstrdup(file_name);
+			return true;
+		}
+	}
+#endif
+
+	/* xvcg expects only <LF> so we need "b"inary mode (for win32) */
+	file->out = fopen(file_name, "wb");
+	if (file->out == NULL) {
+		fprintf(stderr, "Couldn't open '%s': %s\n", file_name, strerror(errno));
+		return false;
+	}
+	setvbuf(file->out, NULL, _IOFBF, DUMP_BUFFER_SIZE);
+	return true;
+}
+
+static void close_dump_file(dump_file_t *file)
+{
+	fclose(file->out);
+#ifndef _WIN32
+	if (file->file_name != NULL)
+		queue_dump(file->file_name, file->data, file->size);
+#endif
+}
+
 void dump_ir_graph_ext(ir_graph_dump_func func, ir_graph *graph,
                        const char *suffix)
 {
@@ -2181,18 +2486,15 @@ void dump_ir_graph_ext(ir_graph_dump_func func, ir_graph *graph,
 	}
 	obstack_1grow(&obst, '\0');
 
-	char *file_name = (char*)obstack_finish(&obst);
-	/* xvcg expects only <LF> so we need "b"inary mode (for win32) */
-	FILE *out       = fopen(file_name, "wb");
+	char       *file_name = (char*)obstack_finish(&obst);
+	dump_file_t file;
+	bool const  opened    = open_dump_file(&file, file_name);
 	obstack_free(&obst, file_name);
-
-	if (out == NULL) {
-		fprintf(stderr, "Couldn't open '%s': %s\n", file_name, strerror(errno));
+	if (!opened)
 		return;
-	}
 
-	func(out, graph);
-	fclose(out);
+	func(file.out, graph);
+	close_dump_file(&file);
 }
 
 void dump_ir_prog_ext(ir_prog_dump_func func, const char *suffix)
@@ -2207,16 +2509,15 @@ void dump_ir_prog_ext(ir_prog_dump_func func, const char *suffix)
 	}
 	obstack_1grow(&obst, '\0');
 
-	char *file_name = (char*)obstack_finish(&obst);
-	FILE *out       = fopen(file_name, "wb");
+	char       *file_name = (char*)obstack_finish(&obst);
+	dump_file_t file;
+	bool const  opened    = open_dump_file(&file, file_name);
 	obstack_free(&obst, file_name);
-
-	if (out == NULL) {
-		fprintf(stderr, "Couldn't open '%s': %s\n", file_name, strerror(errno));
+	if (!opened)
 		return;
-	}
-	func(out);
-	fclose(out);
+
+	func(file.out);
+	close_dump_file(&file);
 }
 
 void dump_ir_graph(ir_graph *graph, const char *suffix)
@@ -170,7 +170,8 @@ void dump_irnode_to_file(FILE *const F, const ir_node *const n)
 	}
 
 	/* Loop node.   Someone else please tell me what's wrong ... */
-	if (irg_has_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO)) {
+	if (is_Block(n)
+	    && irg_has_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO)) {
 		const ir_loop *loop = get_irn_loop(n);
 		if (loop != NULL) {
 			fprintf(F, "  in loop %ld with depth %u\n",
@@ -799,3 +800,14 @@ void dump_globals_as_text(FILE *const out)
 		dump_entity_to_file(out, entity);
 	}
 }
+
+void dump_analysis_statistics(FILE *const out)
+{
+	fprintf(out, "%-20s %10s %10s %10s %10s\n",
+	        "analysis", "computed", "reused", "discarded", "time [s]");
+	for (ir_analysis_t a = IR_ANALYSIS_FIRST; a <= IR_ANALYSIS_LAST; ++a) {
+		fprintf(out, "%-20s %10u %10u %10u %10.3f\n", get_ir_analysis_name(a),
+		        ir_get_analysis_computations(a), ir_get_analysis_reuses(a),
+		        ir_get_analysis_invalidations(a), ir_get_analysis_time(a));
+	}
+}
@@ -17,6 +17,7 @@
 #include "iredgekinds.h"
 #include "iredges_t.h"
 #include "irgwalk.h"
+#include "irhooks.h"
 #include "irnodemap.h"
 #include "irdump_t.h"
 #include "irprintf.h"
@@ -24,35 +25,7 @@
 #include "set.h"
 #include "bitset.h"
 
-#include "iredgeset.h"
-#include "hashptr.h"
-
-#define DO_REHASH
-#define SCALAR_RETURN
-#define HashSet                   ir_edgeset_t
-#define HashSetIterator           ir_edgeset_iterator_t
-#define ValueType                 ir_edge_t*
-#define NullValue                 NULL
-#define DeletedValue              ((ir_edge_t*)-1)
-#define Hash(this,key)            (hash_ptr(key->src) ^ (key->pos * 40013))
-#define KeysEqual(this,key1,key2) ((key1->src) == (key2->src) && (key1->pos == key2->pos))
-#define SetRangeEmpty(ptr,size)   memset(ptr, 0, (size) * sizeof((ptr)[0]))
-
-#define hashset_init            ir_edgeset_init
-void ir_edgeset_init_size(ir_edgeset_t *self, size_t size);
-#define hashset_init_size       ir_edgeset_init_size
-#define hashset_destroy         ir_edgeset_destroy
-#define hashset_insert          ir_edgeset_insert
-#define hashset_remove          ir_edgeset_remove
-ir_edge_t *ir_edgeset_find(const ir_edgeset_t *self, const ir_edge_t*);
-#define hashset_find            ir_edgeset_find
-size_t ir_edgeset_size(const ir_edgeset_t *self);
-#define hashset_size            ir_edgeset_size
-#define hashset_iterator_init   ir_edgeset_iterator_init
-#define hashset_iterator_next   ir_edgeset_iterator_next
-#define hashset_remove_iterator ir_edgeset_remove_iterator
-
-#include "hashset.c.h"
+#include "util.h"
 
 /**
  * A function that allows for setting an edge.
@@ -138,21 +111,52 @@ static inline long edge_get_id(const ir_edge_t *e)
 void edges_init_graph_kind(ir_graph *irg, ir_edge_kind_t kind)
 {
 	if (edges_activated_kind(irg, kind)) {
-		irg_edge_info_t *info   = get_irg_edge_info(irg, kind);
-		size_t           amount = get_irg_last_idx(irg) * 5 / 4;
+		irg_edge_info_t *info = get_irg_edge_info(irg, kind);
 
-		if (info->allocated) {
-			amount = ir_edgeset_size(&info->edges);
-			ir_edgeset_destroy(&info->edges);
+		if (info->allocated)
 			obstack_free(&info->edges_obst, NULL);
-		}
 		obstack_init(&info->edges_obst);
 		INIT_LIST_HEAD(&info->free_edges);
-		ir_edgeset_init_size(&info->edges, amount);
 		info->allocated = 1;
 	}
 }
 
+/**
+ * Returns the edge from @p src at position @p pos or NULL if there is none.
+ */
+static ir_edge_t *get_in_edge(const ir_node *src, int pos, ir_edge_kind_t kind)
+{
+	const irn_edge_info_t *info = get_irn_edge_info_const(src, kind);
+	unsigned               idx  = pos + 1;
+	return idx < info->n_in_edges ? info->in_edges[idx] : NULL;
+}
+
+/**
+ * Records @p edge as the edge from @p src at position @p pos. The in edge
+ * array of @p src is enlarged if necessary, the old one stays on the edge
+ * obstack until the edges are deactivated.
+ */
+static void set_in_edge(ir_node *src, int pos, ir_edge_t *edge,
+                        ir_edge_kind_t kind, irg_edge_info_t *irg_info)
+{
+	irn_edge_info_t *info = get_irn_edge_info(src, kind);
+	unsigned         idx  = pos + 1;
+
+	if (idx >= info->n_in_edges) {
+		unsigned n = edge_kind_info[kind].get_arity(src) + 1;
+		if (n < 2 * info->n_in_edges)
+			n = 2 * info->n_in_edges;
+		if (n <= idx)
+			n = idx + 1;
+
+		ir_edge_t **in_edges = OALLOCNZ(&irg_info->edges_obst, ir_edge_t*, n);
+		MEMCPY(in_edges, info->in_edges, info->n_in_edges);
+		info->in_edges   = in_edges;
+		info->n_in_edges = n;
+	}
+	info->in_edges[idx] = edge;
+}
+
 /**
  * Change the out count
  *
@@ -193,18 +197,23 @@ static inline void verify_list_head(ir_node *irn, ir_edge_kind_t kind)
 	del_pset(lh_set);
 }
 
+static void dump_edges_walker(ir_node *irn, void *data)
+{
+	ir_edge_kind_t         kind = *(ir_edge_kind_t*)data;
+	const irn_edge_info_t *info = get_irn_edge_info(irn, kind);
+	for (unsigned i = 0; i < info->n_in_edges; ++i) {
+		const ir_edge_t *e = info->in_edges[i];
+		if (e != NULL)
+			ir_printf("%+F %d\n", e->src, e->pos);
+	}
+}
+
 void edges_dump_kind(ir_graph *irg, ir_edge_kind_t kind)
 {
 	if (!edges_activated_kind(irg, kind))
 		return;
 
-	irg_edge_info_t       *info  = get_irg_edge_info(irg, kind);
-	ir_edgeset_t          *edges = &info->edges;
-	ir_edge_t             *e;
-	ir_edgeset_iterator_t  iter;
-	foreach_ir_edgeset(edges, e, iter) {
-		ir_printf("%+F %d\n", e->src, e->pos);
-	}
+	irg_walk_graph(irg, dump_edges_walker, NULL, &kind);
 }
 
 static void add_edge(ir_node *src, int pos, ir_node *tgt, ir_edge_kind_t kind,
@@ -213,8 +222,7 @@ static void add_edge(ir_node *src, int pos, ir_node *tgt, ir_edge_kind_t kind,
 	if (tgt == NULL)
 		return;
 	assert(edges_activated_kind(irg, kind));
-	irg_edge_info_t *info  = get_irg_edge_info(irg, kind);
-	ir_edgeset_t    *edges = &info->edges;
+	irg_edge_info_t *info = get_irg_edge_info(irg, kind);
 
 	irn_edge_info_t  *tgt_info = get_irn_edge_info(tgt, kind);
 	struct list_head *head     = &tgt_info->outs_head;
@@ -232,14 +240,11 @@ static void add_edge(ir_node *src, int pos, ir_node *tgt, ir_edge_kind_t kind,
 
 	edge->src     = src;
 	edge->pos     = pos;
-#ifdef DEBUG_libfirm
-	edge->present = false;
-#endif
 
-	ir_edge_t *new_edge = ir_edgeset_insert(edges, edge);
-	assert(new_edge == edge);
+	assert(get_in_edge(src, pos, kind) == NULL);
+	set_in_edge(src, pos, edge, kind, info);
 
-	list_add(&new_edge->list, head);
+	list_add(&edge->list, head);
 	edge_change_cnt(tgt_info, +1);
 }
 
@@ -250,23 +255,15 @@ static void delete_edge(ir_node *src, int pos, ir_node *old_tgt,
 		return;
 	assert(edges_activated_kind(irg, kind));
 
-	irg_edge_info_t *info  = get_irg_edge_info(irg, kind);
-	ir_edgeset_t    *edges = &info->edges;
-
-	/* Initialize the edge template to search in the set. */
-	ir_edge_t templ;
-	templ.src = src;
-	templ.pos = pos;
-
-	/* search the edge in the set. */
-	ir_edge_t *edge = ir_edgeset_find(edges, &templ);
+	irg_edge_info_t *info = get_irg_edge_info(irg, kind);
+	ir_edge_t       *edge = get_in_edge(src, pos, kind);
 
 	/* mark the edge invalid if it was found */
 	if (edge == NULL)
 		return;
 
 	list_del(&edge->list);
-	ir_edgeset_remove(edges, edge);
+	get_irn_edge_info(src, kind)->in_edges[pos + 1] = NULL;
 	list_add(&edge->list, &info->free_edges);
 	edge->pos = -2;
 	edge->src = NULL;
@@ -289,9 +286,6 @@ static void edges_notify_edge_kind(ir_node *src, int pos, ir_node *tgt, ir_node
 	if (tgt == old_tgt)
 		return;
 
-	irg_edge_info_t *info  = get_irg_edge_info(irg, kind);
-	ir_edgeset_t    *edges = &info->edges;
-
 	/* The target is not NULL and the old target differs
 	 * from the new target, the edge shall be moved (if the
 	 * old target was != NULL) or added (if the old target was
@@ -301,12 +295,7 @@ static void edges_notify_edge_kind(ir_node *src, int pos, ir_node *tgt, ir_node
 	assert(head->next && head->prev &&
 			"target list head must have been initialized");
 
-	/* Initialize the edge template to search in the set. */
-	ir_edge_t templ;
-	templ.src = src;
-	templ.pos = pos;
-
-	ir_edge_t *edge = ir_edgeset_find(edges, &templ);
+	ir_edge_t *edge = get_in_edge(src, pos, kind);
 	assert(edge && "edge to redirect not found!");
 
 	list_move(&edge->list, head);
@@ -328,8 +317,12 @@ static void edges_notify_edge_kind(ir_node *src, int pos, ir_node *tgt, ir_node
 void edges_notify_edge(ir_node *src, int pos, ir_node *tgt, ir_node *old_tgt,
                        ir_graph *irg)
 {
+	irg_invalidate_walk_cache(irg);
+	hook_input_change(src, pos, tgt, old_tgt);
+
 	if (edges_activated_kind(irg, EDGE_KIND_NORMAL)) {
 		edges_notify_edge_kind(src, pos, tgt, old_tgt, EDGE_KIND_NORMAL, irg);
+		hook_edge_change(src, pos, tgt, old_tgt);
 	}
 
 	if (edges_activated_kind(irg, EDGE_KIND_BLOCK)) {
@@ -417,7 +410,6 @@ static void edges_node_revival_kind(ir_node *irn, ir_edge_kind_t kind)
 
 typedef struct build_walker {
 	ir_edge_kind_t kind;
-	bitset_t      *reachable;
 	bool           fine;
 } build_walker;
 
@@ -449,6 +441,8 @@ static void init_lh_walker(ir_node *irn, void *data)
 	INIT_LIST_HEAD(head);
 	get_irn_edge_info(irn, kind)->edges_built = 0;
 	get_irn_edge_info(irn, kind)->out_count   = 0;
+	get_irn_edge_info(irn, kind)->n_in_edges  = 0;
+	get_irn_edge_info(irn, kind)->in_edges    = NULL;
 }
 
 void edges_activate_kind(ir_graph *irg, ir_edge_kind_t kind)
@@ -498,7 +492,6 @@ void edges_deactivate_kind(ir_graph *irg, ir_edge_kind_t kind)
 	info->activated = 0;
 	if (info->allocated) {
 		obstack_free(&info->edges_obst, NULL);
-		ir_edgeset_destroy(&info->edges);
 		info->allocated = 0;
 	}
 	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
@@ -549,34 +542,41 @@ void edges_reroute_except(ir_node *from, ir_node *to, ir_node *exception)
 
 static void verify_set_presence(ir_node *irn, void *data)
 {
-	build_walker *w     = (build_walker*)data;
-	ir_graph     *irg   = get_irn_irg(irn);
-	ir_edgeset_t *edges = &get_irg_edge_info(irg, w->kind)->edges;
+	build_walker *w = (build_walker*)data;
 
 	foreach_tgt(irn, i, n, w->kind) {
-		ir_edge_t  templ = { .src = irn, .pos = i };
-		ir_edge_t *e     = ir_edgeset_find(edges, &templ);
-		ir_node   *dst   = get_n(irn, i, w->kind);
-		if (dst == NULL)
-			continue;
-		if (e != NULL) {
-#ifdef DEBUG_libfirm
-			e->present = true;
-#endif
-		} else {
+		ir_edge_t *e   = get_in_edge(irn, i, w->kind);
+		ir_node   *dst = get_n(irn, i, w->kind);
+		if (dst == NULL) {
+			if (e != NULL) {
+				w->fine = false;
+				ir_fprintf(stderr, "Edge Verifier: edge(%ld) %+F,%d is superfluous\n", edge_get_id(e), irn, i);
+			}
+		} else if (e == NULL) {
 			w->fine = false;
 			ir_fprintf(stderr, "Edge Verifier: %+F,%d is missing\n",
 			           irn, i);
 		}
 	}
+
+	/* edges recorded for positions the node does not have anymore */
+	const irn_edge_info_t *info  = get_irn_edge_info(irn, w->kind);
+	int                    first = edge_kind_info[w->kind].first_idx;
+	int                    arity = edge_kind_info[w->kind].get_arity(irn);
+	for (unsigned idx = 0; idx < info->n_in_edges; ++idx) {
+		int        pos = (int)idx - 1;
+		ir_edge_t *e   = info->in_edges[idx];
+		if (e != NULL && (pos < first || pos >= arity)) {
+			w->fine = false;
+			ir_fprintf(stderr, "Edge Verifier: edge(%ld) %+F,%d is superfluous\n", edge_get_id(e), irn, pos);
+		}
+	}
 }
 
 static void verify_list_presence(ir_node *irn, void *data)
 {
 	build_walker *w = (build_walker*)data;
 
-	bitset_set(w->reachable, get_irn_idx(irn));
-
 	/* check list heads */
 	verify_list_head(irn, w->kind);
 
@@ -599,36 +599,10 @@ static void verify_list_presence(ir_node *irn, void *data)
 
 int edges_verify_kind(ir_graph *irg, ir_edge_kind_t kind)
 {
-	struct build_walker    w     = { .kind      = kind,
-	                                 .reachable = bitset_alloca(get_irg_last_idx(irg)),
-	                                 .fine      = true };
-
-#ifdef DEBUG_libfirm
-	ir_edgeset_t          *edges = &get_irg_edge_info(irg, kind)->edges;
-	ir_edge_t             *e;
-	ir_edgeset_iterator_t iter;
-	/* Clear the present bit in all edges available. */
-	foreach_ir_edgeset(edges, e, iter) {
-		e->present = false;
-	}
-#endif
+	struct build_walker w = { .kind = kind, .fine = true };
 
 	irg_walk_graph(irg, verify_set_presence, verify_list_presence, &w);
 
-#ifdef DEBUG_libfirm
-	/*
-	 * Dump all edges which are not invalid and not present.
-	 * These edges are superfluous and their presence in the
-	 * edge set is wrong.
-	 */
-	foreach_ir_edgeset(edges, e, iter) {
-		if (! e->present && bitset_is_set(w.reachable, get_irn_idx(e->src))) {
-			w.fine = false;
-			ir_fprintf(stderr, "Edge Verifier: edge(%ld) %+F,%d is superfluous\n", edge_get_id(e), e->src, e->pos);
-		}
-	}
-#endif
-
 	return w.fine;
 }
 
@@ -712,7 +686,7 @@ static void verify_edge_counter(ir_node *irn, void *env)
 			irn, ref_cnt, list_cnt);
 	}
 
-	free(bs);
+	xfree(bs);
 }
 
 int edges_verify(ir_graph *irg)
@@ -743,8 +717,10 @@ void edges_init_dbg(int do_dbg)
 
 void edges_activate(ir_graph *irg)
 {
+	ir_analysis_start(IR_ANALYSIS_OUT_EDGES);
 	edges_activate_kind(irg, EDGE_KIND_NORMAL);
 	edges_activate_kind(irg, EDGE_KIND_BLOCK);
+	ir_analysis_stop(IR_ANALYSIS_OUT_EDGES);
 }
 
 void edges_deactivate(ir_graph *irg)
@@ -755,8 +731,14 @@ void edges_deactivate(ir_graph *irg)
 
 void assure_edges(ir_graph *irg)
 {
-	assure_edges_kind(irg, EDGE_KIND_BLOCK);
-	assure_edges_kind(irg, EDGE_KIND_NORMAL);
+	if (edges_activated(irg)) {
+		ir_analysis_reused(IR_ANALYSIS_OUT_EDGES);
+	} else {
+		ir_analysis_start(IR_ANALYSIS_OUT_EDGES);
+		assure_edges_kind(irg, EDGE_KIND_BLOCK);
+		assure_edges_kind(irg, EDGE_KIND_NORMAL);
+		ir_analysis_stop(IR_ANALYSIS_OUT_EDGES);
+	}
 	add_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
 }
 
@@ -12,15 +12,24 @@
 
 #include "lc_opts.h"
 
+#include "debug.h"
 #include "firm_common.h"
+#include "irgraph_t.h"
+#include "irnode_t.h"
 #include "irtools.h"
 #include "irflag_t.h"
+#include "statev_t.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
 
 /* DISABLE - don't do this optimization
    ENABLE  - lets see, if there is a better graph */
 #define ON   -1
 #define OFF   0
 
+/** Steps a super-linear pass may spend on a graph, <= 0 for unlimited. */
+static double complexity_budget = 1e10;
+
 optimization_state_t libFIRM_opt =
 #define FLAG(name, value, def)   (irf_##name & def) |
 #include "irflag_t.def"
@@ -70,10 +79,60 @@ void all_optimizations_off(void)
 	libFIRM_opt = 0;
 }
 
+void set_opt_complexity_budget(double budget)
+{
+	complexity_budget = budget;
+}
+
+double get_opt_complexity_budget(void)
+{
+	return complexity_budget;
+}
+
+double get_irg_complexity(ir_graph *irg, ir_complexity_t complexity)
+{
+	/* count the blocks without a walk, the caller may have reserved the
+	 * visited flags */
+	double   const n_nodes  = get_irg_last_idx(irg);
+	unsigned       n_blocks = 0;
+	for (unsigned i = 0, n = get_irg_last_idx(irg); i < n; ++i) {
+		ir_node const *const node = get_idx_irn(irg, i);
+		if (node != NULL && is_Block(node))
+			++n_blocks;
+	}
+
+	switch (complexity) {
+	case IR_COMPLEXITY_NODES_SQUARED:  return n_nodes * n_nodes;
+	case IR_COMPLEXITY_NODES_BLOCKS:   return n_nodes * n_blocks;
+	case IR_COMPLEXITY_BLOCKS_SQUARED: return (double)n_blocks * n_blocks;
+	case IR_COMPLEXITY_BLOCKS_CUBED:
+		return (double)n_blocks * n_blocks * n_blocks;
+	}
+	panic("invalid complexity class");
+}
+
+int ir_complexity_allows(ir_graph *irg, const char *pass, double cost)
+{
+	if (complexity_budget <= 0 || cost <= complexity_budget)
+		return true;
+
+	DB((dbg, LEVEL_1, "%s throttled on %+F: %g steps exceed the budget of %g\n",
+	    pass, irg, cost, complexity_budget));
+	if (stat_ev_enabled) {
+		char buf[128];
+		snprintf(buf, sizeof(buf), "throttled_%s", pass);
+		stat_ev_ctx_push_fmt("irg", "%+F", irg);
+		stat_ev_dbl(buf, cost);
+		stat_ev_ctx_pop("irg");
+	}
+	return false;
+}
+
 static const lc_opt_table_entry_t firm_flags[] = {
 #define FLAG(name, val, def) LC_OPT_ENT_BIT(#name, #name, &libFIRM_opt, (1 << val)),
 #include "irflag_t.def"
 #undef FLAG
+	LC_OPT_ENT_DBL("complexity_budget", "steps a super-linear pass may spend on a graph (<= 0: unlimited)", &complexity_budget),
 	LC_OPT_LAST
 };
 
@@ -81,4 +140,5 @@ void firm_init_flags(void)
 {
 	lc_opt_entry_t *grp = lc_opt_get_grp(firm_opt_get_root(), "opt");
 	lc_opt_add_table(grp, firm_flags);
+	FIRM_DBG_REGISTER(dbg, "firm.opt.complexity");
 }
@@ -54,7 +54,15 @@ void exchange(ir_node *old, ir_node *nw)
 	}
 #endif
 
+	/* replacing control flow may change the successors of the blocks */
+	ir_mode              *const mode    = get_irn_mode(old);
+	ir_graph_properties_t       changed = IR_GRAPH_PROPERTY_CONSISTENT_OUTS
+	                                    | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO;
+	if (is_Block(old) || mode == mode_X || mode == mode_T)
+		changed |= IR_GRAPH_PROPERTY_CONSISTENT_BLOCK_OUTS;
+
 	hook_replace(old, nw);
+	irg_invalidate_walk_cache(irg);
 
 	/* If new outs are on, we can skip the id node creation and reroute
 	 * the edges from the old node to the new directly. */
@@ -83,8 +91,7 @@ void exchange(ir_node *old, ir_node *nw)
 	}
 
 	/* update irg flags */
-	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUTS
-	                        | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+	clear_irg_properties(irg, changed);
 }
 
 static void collect_new_start_block_node_(ir_node *node)
@@ -308,6 +315,7 @@ void kill_node(ir_node *node)
 	if (edges_activated(irg)) {
 		edges_node_deleted(node);
 	}
+	irg_invalidate_walk_cache(irg);
 	/* noone is allowed to reference this node anymore */
 	set_irn_op(node, op_Deleted);
 }
@@ -9,6 +9,8 @@
  * @author   Martin Trapp, Christian Schaefer, Goetz Lindenmaier, Michael Beck
  */
 
+#include <time.h>
+
 #include "xmalloc.h"
 #include "ircons_t.h"
 #include "irgraph_t.h"
@@ -21,6 +23,7 @@
 #include "irouts.h"
 #include "irhooks.h"
 #include "irtools.h"
+#include "irclone.h"
 #include "util.h"
 #include "irgwalk.h"
 #include "irbackedge_t.h"
@@ -29,6 +32,7 @@
 #include "irmemory.h"
 #include "iroptimize.h"
 #include "irgopt.h"
+#include "irverify_t.h"
 
 #define INITIAL_IDX_IRN_MAP_SIZE 1024
 
@@ -76,8 +80,11 @@ static void free_graph(ir_graph *irg)
 {
 	for (ir_edge_kind_t i = EDGE_KIND_FIRST; i <= EDGE_KIND_LAST; ++i)
 		edges_deactivate_kind(irg, i);
+	irg_walk_cache_deactivate(irg);
+	if (irg->walk_stack != NULL)
+		DEL_ARR_F(irg->walk_stack);
 	DEL_ARR_F(irg->idx_irn_map);
-	free(irg);
+	xfree(irg);
 }
 
 void irg_set_nloc(ir_graph *res, int n_loc)
@@ -90,7 +97,7 @@ void irg_set_nloc(ir_graph *res, int n_loc)
 	res->n_loc = n_loc + 1;
 
 	if (res->loc_descriptions) {
-		free(res->loc_descriptions);
+		xfree(res->loc_descriptions);
 		res->loc_descriptions = NULL;
 	}
 }
@@ -176,14 +183,13 @@ ir_graph *new_const_code_irg(void)
  * to the copied graph.
  *
  * @param n    A node from the original method graph.
- * @param env  The copied graph.
+ * @param env  The cloner into the copied graph.
  */
 static void copy_all_nodes(ir_node *node, void *env)
 {
-	ir_graph *irg      = (ir_graph*)env;
-	ir_node  *new_node = irn_copy_into_irg(node, irg);
-
-	set_irn_link(node, new_node);
+	ir_cloner_t *cloner   = (ir_cloner_t*)env;
+	ir_graph    *irg      = cloner->irg;
+	ir_node     *new_node = ir_cloner_copy(cloner, node);
 
 	/* fix access to entities on the stack frame */
 	if (is_Member(new_node)) {
@@ -201,22 +207,6 @@ static void copy_all_nodes(ir_node *node, void *env)
 	}
 }
 
-/**
- * Post-walker: Set the predecessors of the copied nodes.
- * The copied nodes are set as link of their original nodes. The links of
- * "irn" predecessors are the predecessors of copied node.
- */
-static void rewire(ir_node *irn, void *env)
-{
-	(void)env;
-	irn_rewire_inputs(irn);
-}
-
-static ir_node *get_new_node(const ir_node *old_node)
-{
-	return (ir_node*)get_irn_link(old_node);
-}
-
 ir_graph *create_irg_copy(ir_graph *irg)
 {
 	ir_graph *res = alloc_graph();
@@ -227,27 +217,28 @@ ir_graph *create_irg_copy(ir_graph *irg)
 	irp_reserve_resources(irp, IRP_RESOURCE_ENTITY_LINK);
 	res->frame_type  = clone_frame_type(irg->frame_type);
 
-	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
-
 	/* copy all nodes from the graph irg to the new graph res */
-	irg_walk_anchors(irg, copy_all_nodes, rewire, res);
+	ir_cloner_t cloner;
+	ir_cloner_init(&cloner, irg, res);
+	irg_walk_anchors(irg, copy_all_nodes, NULL, &cloner);
+	ir_cloner_rewire(&cloner);
 
 	/* copy the Anchor node */
-	res->anchor = get_new_node(irg->anchor);
+	res->anchor = ir_cloner_get(&cloner, irg->anchor);
 
 	/* -- The end block -- */
-	set_irg_end_block (res, get_new_node(get_irg_end_block(irg)));
-	set_irg_end       (res, get_new_node(get_irg_end(irg)));
+	set_irg_end_block (res, ir_cloner_get(&cloner, get_irg_end_block(irg)));
+	set_irg_end       (res, ir_cloner_get(&cloner, get_irg_end(irg)));
 
 	/* -- The start block -- */
-	set_irg_start_block(res, get_new_node(get_irg_start_block(irg)));
-	set_irg_no_mem     (res, get_new_node(get_irg_no_mem(irg)));
-	set_irg_start      (res, get_new_node(get_irg_start(irg)));
+	set_irg_start_block(res, ir_cloner_get(&cloner, get_irg_start_block(irg)));
+	set_irg_no_mem     (res, ir_cloner_get(&cloner, get_irg_no_mem(irg)));
+	set_irg_start      (res, ir_cloner_get(&cloner, get_irg_start(irg)));
 
 	/* Proj results of start node */
-	set_irg_initial_mem(res, get_new_node(get_irg_initial_mem(irg)));
+	set_irg_initial_mem(res, ir_cloner_get(&cloner, get_irg_initial_mem(irg)));
 
-	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	ir_cloner_destroy(&cloner);
 	irp_free_resources(irp, IRP_RESOURCE_ENTITY_LINK);
 
 	return res;
@@ -261,6 +252,7 @@ void free_ir_graph(ir_graph *irg)
 	confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_NONE);
 
 	free_irg_outs(irg);
+	free_verify_changes(irg);
 	del_identities(irg);
 	if (irg->ent) {
 		set_entity_irg(irg->ent, NULL);  /* not set in const code irg */
@@ -269,7 +261,9 @@ void free_ir_graph(ir_graph *irg)
 	free_End(get_irg_end(irg));
 	obstack_free(&irg->obst, NULL);
 	if (irg->loc_descriptions)
-		free(irg->loc_descriptions);
+		xfree(irg->loc_descriptions);
+	if (irg->escaped_methods)
+		DEL_ARR_F(irg->escaped_methods);
 	irg->kind = k_BAD;
 	free_graph(irg);
 }
@@ -560,6 +554,20 @@ int (irg_has_properties)(const ir_graph *irg, ir_graph_properties_t props)
 	return irg_has_properties_(irg, props);
 }
 
+/** The analyses recorded in the analysis statistics, which have a property. */
+static const struct {
+	ir_graph_properties_t property;
+	ir_analysis_t         analysis;
+} property_analyses[] = {
+	{ IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES,           IR_ANALYSIS_OUT_EDGES },
+	{ IR_GRAPH_PROPERTY_CONSISTENT_OUTS,                IR_ANALYSIS_OUTS },
+	{ IR_GRAPH_PROPERTY_CONSISTENT_BLOCK_OUTS,          IR_ANALYSIS_BLOCK_OUTS },
+	{ IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE,           IR_ANALYSIS_DOMINANCE },
+	{ IR_GRAPH_PROPERTY_CONSISTENT_POSTDOMINANCE,       IR_ANALYSIS_POSTDOMINANCE },
+	{ IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE_FRONTIERS, IR_ANALYSIS_DOMINANCE_FRONTIERS },
+	{ IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO,            IR_ANALYSIS_LOOPINFO },
+};
+
 typedef void (*assure_property_func)(ir_graph *irg);
 
 void assure_irg_properties(ir_graph *irg, ir_graph_properties_t props)
@@ -578,10 +586,15 @@ void assure_irg_properties(ir_graph *irg, ir_graph_properties_t props)
 		{ IR_GRAPH_PROPERTY_CONSISTENT_POSTDOMINANCE, compute_postdoms },
 		{ IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES,     assure_edges },
 		{ IR_GRAPH_PROPERTY_CONSISTENT_OUTS,          assure_irg_outs },
+		{ IR_GRAPH_PROPERTY_CONSISTENT_BLOCK_OUTS,    assure_irg_block_outs },
 		{ IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO,      assure_loopinfo },
 		{ IR_GRAPH_PROPERTY_CONSISTENT_ENTITY_USAGE,  assure_irg_entity_usage_computed },
 		{ IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE_FRONTIERS, ir_compute_dominance_frontiers },
 	};
+	for (size_t i = 0; i < ARRAY_SIZE(property_analyses); ++i) {
+		if (props & irg->properties & property_analyses[i].property)
+			ir_analysis_reused(property_analyses[i].analysis);
+	}
 	for (size_t i = 0; i < ARRAY_SIZE(property_functions); ++i) {
 		ir_graph_properties_t missing = props & ~irg->properties;
 		if (missing & property_functions[i].property)
@@ -592,14 +605,113 @@ void assure_irg_properties(ir_graph *irg, ir_graph_properties_t props)
 
 void confirm_irg_properties(ir_graph *irg, ir_graph_properties_t props)
 {
+	/* consistent outs include the control flow successors of the blocks */
+	if (props & IR_GRAPH_PROPERTY_CONSISTENT_OUTS)
+		props |= IR_GRAPH_PROPERTY_CONSISTENT_BLOCK_OUTS;
+
+	for (size_t i = 0; i < ARRAY_SIZE(property_analyses); ++i) {
+		if (irg->properties & ~props & property_analyses[i].property)
+			ir_analysis_invalidated(property_analyses[i].analysis);
+	}
 	clear_irg_properties(irg, ~props);
 	if (!(props & IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES))
 		edges_deactivate(irg);
-	if (!(props & IR_GRAPH_PROPERTY_CONSISTENT_OUTS)
-	    && (irg->properties & IR_GRAPH_PROPERTY_CONSISTENT_OUTS))
-	    free_irg_outs(irg);
 	if (!(props & IR_GRAPH_PROPERTY_CONSISTENT_ENTITY_USAGE))
 		set_irp_globals_entity_usage_state(ir_entity_usage_not_computed);
 	if (!(props & IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE_FRONTIERS))
 		ir_free_dominance_frontiers(irg);
 }
+
+typedef struct analysis_statistics {
+	unsigned computations;
+	unsigned reuses;
+	unsigned invalidations;
+	clock_t  time;   /**< processor time spent so far */
+	clock_t  start;  /**< start of the running part of the computation */
+	int      paused; /**< analysis paused by this one, or -1 */
+} analysis_statistics;
+
+static analysis_statistics analysis_stats[IR_ANALYSIS_LAST + 1];
+/** The analysis currently being computed, or -1. */
+static int running_analysis = -1;
+
+void ir_analysis_start(ir_analysis_t analysis)
+{
+	clock_t const now = clock();
+	if (running_analysis >= 0) {
+		analysis_statistics *const outer = &analysis_stats[running_analysis];
+		outer->time += now - outer->start;
+	}
+	analysis_statistics *const stats = &analysis_stats[analysis];
+	stats->paused    = running_analysis;
+	stats->start     = now;
+	running_analysis = analysis;
+}
+
+void ir_analysis_stop(ir_analysis_t analysis)
+{
+	assert(running_analysis == (int)analysis);
+	clock_t              const now   = clock();
+	analysis_statistics *const stats = &analysis_stats[analysis];
+	stats->time += now - stats->start;
+	++stats->computations;
+	running_analysis = stats->paused;
+	if (running_analysis >= 0)
+		analysis_stats[running_analysis].start = now;
+}
+
+void ir_analysis_reused(ir_analysis_t analysis)
+{
+	++analysis_stats[analysis].reuses;
+}
+
+void ir_analysis_invalidated(ir_analysis_t analysis)
+{
+	++analysis_stats[analysis].invalidations;
+}
+
+const char *get_ir_analysis_name(ir_analysis_t analysis)
+{
+	switch (analysis) {
+	case IR_ANALYSIS_OUT_EDGES:           return "out edges";
+	case IR_ANALYSIS_OUTS:                return "outs";
+	case IR_ANALYSIS_BLOCK_OUTS:          return "block outs";
+	case IR_ANALYSIS_DOMINANCE:           return "dominance";
+	case IR_ANALYSIS_POSTDOMINANCE:       return "postdominance";
+	case IR_ANALYSIS_DOMINANCE_FRONTIERS: return "dominance frontiers";
+	case IR_ANALYSIS_LOOPINFO:            return "loop info";
+	case IR_ANALYSIS_LIVENESS:            return "liveness";
+	}
+	return "<unknown>";
+}
+
+unsigned ir_get_analysis_computations(ir_analysis_t analysis)
+{
+	return analysis_stats[analysis].computations;
+}
+
+unsigned ir_get_analysis_reuses(ir_analysis_t analysis)
+{
+	return analysis_stats[analysis].reuses;
+}
+
+unsigned ir_get_analysis_invalidations(ir_analysis_t analysis)
+{
+	return analysis_stats[analysis].invalidations;
+}
+
+double ir_get_analysis_time(ir_analysis_t analysis)
+{
+	return (double)analysis_stats[analysis].time / CLOCKS_PER_SEC;
+}
+
+void ir_clear_analysis_statistics(void)
+{
+	for (ir_analysis_t a = IR_ANALYSIS_FIRST; a <= IR_ANALYSIS_LAST; ++a) {
+		analysis_statistics *const stats = &analysis_stats[a];
+		stats->computations  = 0;
+		stats->reuses        = 0;
+		stats->invalidations = 0;
+		stats->time          = 0;
+	}
+}
@@ -16,10 +16,10 @@
 #include "entity_t.h"
 #include "firm_types.h"
 #include "iredgekinds.h"
-#include "iredgeset.h"
 #include "irloop.h"
 #include "irnodemap.h"
 #include "irprog.h"
+#include "irvaluetable.h"
 #include "list.h"
 #include "obst.h"
 #include "pset.h"
@@ -73,7 +73,6 @@
  * Edge info to put into an irg.
  */
 typedef struct irg_edge_info_t {
-	ir_edgeset_t     edges;          /**< A set containing all edges of the current graph. */
 	struct list_head free_edges;     /**< list of all free edges. */
 	struct obstack   edges_obst;     /**< Obstack, where edges are allocated on. */
 	unsigned         allocated : 1;  /**< Set if edges are allocated on the obstack. */
@@ -92,13 +91,40 @@ typedef struct cg_callee_entry {
 typedef struct ir_bitinfo {
 	struct ir_nodemap map;
 	struct obstack    obst;
+	ir_node         **replaced; /**< replacement nodes, whose users need an update */
 } ir_bitinfo;
 
+/**
+ * Def-use edges of a graph in compressed sparse row form: the edges of the
+ * node with index i are edges[start[i]] up to edges[start[i+1]].  The arrays
+ * are kept between recomputations and only grow.
+ */
+typedef struct ir_outs_info {
+	unsigned               *start;      /**< edge offsets by node index */
+	struct ir_def_use_edge *edges;      /**< the edges of all nodes */
+	unsigned                n_nodes;    /**< indexed nodes, 0 if invalid */
+	unsigned                start_size; /**< allocated length of start */
+	unsigned                edges_size; /**< allocated length of edges */
+} ir_outs_info;
+
 typedef struct ir_vrp_info {
 	struct ir_nodemap infos;
 	struct obstack    obst;
 } ir_vrp_info;
 
+/**
+ * Cached walk orders of a graph, see irg_walk_cache_activate().
+ * The orders are flexible arrays of walk events: the node index shifted left
+ * by one, the lowest bit is set for the post callback.
+ */
+typedef struct irg_walk_cache_t {
+	unsigned *nodes;        /**< events of irg_walk_graph() */
+	unsigned *blocks;       /**< events of irg_block_walk_graph() */
+	bool      active;       /**< Set if walk orders are cached. */
+	bool      nodes_valid;  /**< Set if nodes matches the graph. */
+	bool      blocks_valid; /**< Set if blocks matches the graph. */
+} irg_walk_cache_t;
+
 /**
  * An ir_graph represents the code of a function as a graph of nodes.
  */
@@ -117,6 +143,8 @@ struct ir_graph {
 	ir_graph_constraints_t constraints;
 	op_pin_state           irg_pinned_state;  /**< Flag for status of nodes. */
 	irg_callee_info_state  callee_info_state; /**< Validity of callee info. */
+	ir_entity            **escaped_methods;   /**< cgana: methods made free by
+	                                               this graph. */
 
 	/** this flag is an identifier for ir walk. it will be incremented every
 	 * time someone walks through the graph */
@@ -125,6 +153,7 @@ struct ir_graph {
 	ir_visited_t     self_visited;  /**< Visited flag of the irg */
 	ir_node        **idx_irn_map;   /**< Map of node indexes to nodes. */
 	size_t           index;         /**< a unique number for each graph */
+	size_t           irp_pos;       /**< position in the graph list of irp */
 	/** A void* field to link any information to the graph. */
 	void            *link;
 	void            *be_data;       /**< backend can put in private data here */
@@ -138,21 +167,32 @@ struct ir_graph {
 	ir_node *current_block;    /**< Block for new_*()ly created nodes. */
 
 	/** Hash table for global value numbering (CSE) */
-	pset               *value_table;
-	struct obstack      out_obst;    /**< Space for the Def-Use arrays. */
-	bool                out_obst_allocated;
+	ir_valuetable_t    *value_table;
+	/** Cached alias queries, see ir_init_alias_cache() */
+	struct ir_alias_cache *alias_cache;
+	/** Memory SSA links, see ir_init_memssa() */
+	struct ir_memssa      *memssa;
+	ir_outs_info        outs;        /**< Def-Use edges of all nodes. */
+	ir_outs_info        block_outs;  /**< control flow successors of blocks. */
 	ir_bitinfo          bitinfo;     /**< bit info */
 	ir_vrp_info         vrp;         /**< vrp info */
 	ir_loop            *loop;        /**< The outermost loop for this graph. */
 	ir_dom_front_info_t domfront;    /**< dominance frontier analysis data */
 	irg_edges_info_t    edge_info;   /**< edge info for automatic outs */
+	irg_walk_cache_t    walk_cache;  /**< cached walk orders */
+	struct walk_frame  *walk_stack;  /**< explicit stack of the walkers */
+	size_t              walk_tos;    /**< top (index) of walk_stack */
 	ir_graph          **callers;     /**< Callgraph: list of callers. */
 	unsigned           *caller_isbe; /**< Callgraph: bitset if backedge info is
 	                                      calculated. */
 	cg_callee_entry   **callees;     /**< Callgraph: list of callee calls */
 	unsigned           *callee_isbe; /**< Callgraph: bitset if backedge info is
 	                                      calculated. */
+	bool                callees_dirty; /**< Callgraph: Calls changed since the
+	                                        callees were computed. */
 	ir_loop            *l;           /**< For callgraph analysis. */
+	/** Nodes changed since the last verification, see irg_verify_changed() */
+	struct verify_changes_t *verify_changes;
 
 #ifdef DEBUG_libfirm
 	/** Unique graph number for each graph to make output readable. */
@@ -191,6 +231,21 @@ ir_graph *new_const_code_irg(void);
  */
 ir_graph *create_irg_copy(ir_graph *irg);
 
+/**
+ * Record the start of a computation of @p analysis for the analysis
+ * statistics.  The analysis running so far is paused until ir_analysis_stop().
+ */
+void ir_analysis_start(ir_analysis_t analysis);
+
+/** Record the end of a computation started with ir_analysis_start(). */
+void ir_analysis_stop(ir_analysis_t analysis);
+
+/** Record that a still valid result of @p analysis was requested. */
+void ir_analysis_reused(ir_analysis_t analysis);
+
+/** Record that a valid result of @p analysis was thrown away. */
+void ir_analysis_invalidated(ir_analysis_t analysis);
+
 /**
  * Set the op_pin_state_pinned state of a graph.
  *
@@ -484,6 +539,16 @@ static inline ir_node *get_idx_irn_(const ir_graph *irg, unsigned idx)
 	return irg->idx_irn_map[idx];
 }
 
+/**
+ * Drops the cached walk orders of a graph. Must be called whenever an edge
+ * of the graph or the opcode of one of its nodes changes.
+ */
+static inline void irg_invalidate_walk_cache(ir_graph *irg)
+{
+	irg->walk_cache.nodes_valid  = false;
+	irg->walk_cache.blocks_valid = false;
+}
+
 /**
  * Get the anchor.
  */
@@ -17,7 +17,7 @@
 #include "irnode_t.h"
 #include "irgraph_t.h"
 #include "irprog_t.h"
-#include "irgwalk.h"
+#include "irgwalk_t.h"
 #include "irhooks.h"
 #include "entity_t.h"
 #include "ircons.h"
@@ -26,76 +26,115 @@
 #include "pset_new.h"
 #include "array.h"
 
+/** Position of a walk frame whose block has not been visited yet. */
+#define WALK_BLOCK -2
+/** Position of a walk frame whose arity has not been read yet. */
+#define WALK_INS   -1
+
 /**
- * specialized version of irg_walk_2, called if only pre callback exists
+ * A node on the explicit walker stack.
  */
-static void irg_walk_2_pre(ir_node *node, irg_walk_func *pre, void *env)
+typedef struct walk_frame {
+	ir_node *node; /**< the node */
+	int      pos;  /**< the next predecessor to visit counting downwards,
+	                    or WALK_BLOCK/WALK_INS */
+} walk_frame;
+
+/**
+ * Push a node onto the walker stack of its graph. The stack is reused by all
+ * walks of the graph, nested walks started from a callback continue on top of
+ * the frames of the outer walk. Walks of different graphs do not share any
+ * state.
+ */
+static inline void walk_push(ir_graph *irg, ir_node *node, int pos)
 {
-	ir_graph    *irg     = get_irn_irg(node);
-	ir_visited_t visited = irg->visited;
+	if (irg->walk_stack == NULL) {
+		irg->walk_stack = NEW_ARR_F(walk_frame, 256);
+	} else if (irg->walk_tos == ARR_LEN(irg->walk_stack)) {
+		ARR_RESIZE(walk_frame, irg->walk_stack, irg->walk_tos * 2);
+	}
+	walk_frame *const frame = &irg->walk_stack[irg->walk_tos++];
+	frame->node = node;
+	frame->pos  = pos;
+}
 
+/**
+ * Marks @p node visited, calls @p pre and puts it onto the walker stack.
+ */
+static inline void walk_enter(ir_graph *irg, ir_node *node,
+                              ir_visited_t visited, irg_walk_func *pre,
+                              void *env)
+{
 	set_irn_visited(node, visited);
 
-	pre(node, env);
+	if (pre != NULL)
+		pre(node, env);
 
-	if (!is_Block(node)) {
-		ir_node *pred = get_nodes_block(node);
-		if (pred->visited < visited)
-			irg_walk_2_pre(pred, pre, env);
-	}
-	foreach_irn_in_r(node, i, pred) {
-		if (pred->visited < visited)
-			irg_walk_2_pre(pred, pre, env);
-	}
+	walk_push(irg, node, is_Block(node) ? WALK_INS : WALK_BLOCK);
 }
 
 /**
- * specialized version of irg_walk_2, called if only post callback exists
+ * Iterative core of irg_walk_2(). Visits the block of a node first and then
+ * its operands from the last to the first one, exactly like the recursive
+ * formulation. Operands are read only when they are about to be visited, so
+ * callbacks may modify nodes that have not been finished yet.
  */
-static void irg_walk_2_post(ir_node *node, irg_walk_func *post, void *env)
+static inline void irg_walk_2_iter(ir_node *node, irg_walk_func *pre,
+                                   irg_walk_func *post, void *env)
 {
 	ir_graph    *irg     = get_irn_irg(node);
 	ir_visited_t visited = irg->visited;
-
-	set_irn_visited(node, visited);
-
-	if (!is_Block(node)) {
-		ir_node *pred = get_nodes_block(node);
-		if (pred->visited < visited)
-			irg_walk_2_post(pred, post, env);
-	}
-	foreach_irn_in_r(node, i, pred) {
+	size_t const base    = irg->walk_tos;
+
+	walk_enter(irg, node, visited, pre, env);
+	while (irg->walk_tos > base) {
+		/* callbacks may resize the stack, so no pointer is kept across
+		 * them */
+		walk_frame *const top = &irg->walk_stack[irg->walk_tos - 1];
+		ir_node    *const irn = top->node;
+		ir_node          *pred;
+		if (top->pos == WALK_BLOCK) {
+			top->pos = WALK_INS;
+			pred     = get_nodes_block(irn);
+		} else {
+			if (top->pos == WALK_INS)
+				top->pos = get_irn_arity(irn);
+			if (top->pos == 0) {
+				--irg->walk_tos;
+				if (post != NULL)
+					post(irn, env);
+				continue;
+			}
+			pred = get_irn_n(irn, --top->pos);
+		}
 		if (pred->visited < visited)
-			irg_walk_2_post(pred, post, env);
+			walk_enter(irg, pred, visited, pre, env);
 	}
+}
+
+/**
+ * specialized version of irg_walk_2, called if only pre callback exists
+ */
+static void irg_walk_2_pre(ir_node *node, irg_walk_func *pre, void *env)
+{
+	irg_walk_2_iter(node, pre, NULL, env);
+}
 
-	post(node, env);
+/**
+ * specialized version of irg_walk_2, called if only post callback exists
+ */
+static void irg_walk_2_post(ir_node *node, irg_walk_func *post, void *env)
+{
+	irg_walk_2_iter(node, NULL, post, env);
 }
 
 /**
  * specialized version of irg_walk_2, called if pre and post callbacks exist
  */
 static void irg_walk_2_both(ir_node *node, irg_walk_func *pre,
-                                irg_walk_func *post, void *env)
+                            irg_walk_func *post, void *env)
 {
-	ir_graph    *irg     = get_irn_irg(node);
-	ir_visited_t visited = irg->visited;
-
-	set_irn_visited(node, visited);
-
-	pre(node, env);
-
-	if (!is_Block(node)) {
-		ir_node *pred = get_nodes_block(node);
-		if (pred->visited < visited)
-			irg_walk_2_both(pred, pre, post, env);
-	}
-	foreach_irn_in_r(node, i, pred) {
-		if (pred->visited < visited)
-			irg_walk_2_both(pred, pre, post, env);
-	}
-
-	post(node, env);
+	irg_walk_2_iter(node, pre, post, env);
 }
 
 void irg_walk_2(ir_node *node, irg_walk_func *pre, irg_walk_func *post,
@@ -126,91 +165,141 @@ void irg_walk(ir_node *node, irg_walk_func *pre, irg_walk_func *post,
 	ir_free_resources(irg, IR_RESOURCE_IRN_VISITED);
 }
 
-void irg_walk_graph(ir_graph *irg, irg_walk_func *pre, irg_walk_func *post,
-                    void *env)
-{
-	irg_walk(get_irg_end(irg), pre, post, env);
-}
-
-void all_irg_walk(irg_walk_func *pre, irg_walk_func *post, void *env)
+/**
+ * Sets the bit of @p node in @p visited and returns true if it was not set
+ * yet and the node is covered by the bitset.
+ */
+static inline bool bitset_walk_mark(bitset_t *visited, const ir_node *node)
 {
-	foreach_irp_irg(i, irg) {
-		irg_walk_graph(irg, pre, post, env);
-	}
+	unsigned const idx = get_irn_idx(node);
+	if (idx >= bitset_size(visited) || bitset_is_set(visited, idx))
+		return false;
+	bitset_set(visited, idx);
+	return true;
 }
 
 /**
- * specialized version of irg_walk_in_or_dep_2, called if only pre callback exists
+ * Calls @p pre for @p node and puts it onto @p stack.
  */
-static void irg_walk_in_or_dep_2_pre(ir_node *node, irg_walk_func *pre,
-                                     void *env)
+static inline void bitset_walk_enter(walk_frame **stack, ir_node *node,
+                                     irg_walk_func *pre, void *env)
 {
-	ir_graph    *irg     = get_irn_irg(node);
-	ir_visited_t visited = irg->visited;
+	if (pre != NULL)
+		pre(node, env);
 
-	set_irn_visited(node, visited);
+	walk_frame const frame = { node, is_Block(node) ? WALK_INS : WALK_BLOCK };
+	ARR_APP1(walk_frame, *stack, frame);
+}
 
-	pre(node, env);
+void irg_walk_bitset(ir_node *node, bitset_t *visited, irg_walk_func *pre,
+                     irg_walk_func *post, void *env)
+{
+	if (!bitset_walk_mark(visited, node))
+		return;
 
-	if (!is_Block(node)) {
-		ir_node *pred = get_nodes_block(node);
-		if (pred->visited < visited)
-			irg_walk_in_or_dep_2_pre(pred, pre, env);
-	}
-	foreach_irn_in_r(node, i, pred) {
-		if (pred->visited < visited)
-			irg_walk_in_or_dep_2_pre(pred, pre, env);
+	/* a private stack keeps the graph untouched */
+	walk_frame *stack = NEW_ARR_A(walk_frame, 64);
+	bitset_walk_enter(&stack, node, pre, env);
+	while (ARR_LEN(stack) > 0) {
+		walk_frame *const top = &stack[ARR_LEN(stack) - 1];
+		ir_node    *const irn = top->node;
+		ir_node          *pred;
+		if (top->pos == WALK_BLOCK) {
+			top->pos = WALK_INS;
+			pred     = get_nodes_block(irn);
+		} else {
+			if (top->pos == WALK_INS)
+				top->pos = get_irn_arity(irn);
+			if (top->pos == 0) {
+				ARR_SHRINKLEN(stack, ARR_LEN(stack) - 1);
+				if (post != NULL)
+					post(irn, env);
+				continue;
+			}
+			pred = get_irn_n(irn, --top->pos);
+		}
+		if (bitset_walk_mark(visited, pred))
+			bitset_walk_enter(&stack, pred, pre, env);
 	}
+	DEL_ARR_F(stack);
+}
+
+void irg_walk_graph_bitset(ir_graph *irg, bitset_t *visited,
+                           irg_walk_func *pre, irg_walk_func *post, void *env)
+{
+	irg_walk_bitset(get_irg_end(irg), visited, pre, post, env);
 }
 
 /**
- * specialized version of irg_walk_in_or_dep_2, called if only post callback exists
+ * Walker recording pre events into a walk cache array.
  */
-static void irg_walk_in_or_dep_2_post(ir_node *node, irg_walk_func *post,
-                                      void *env)
+static void record_pre(ir_node *node, void *env)
 {
-	ir_graph    *irg     = get_irn_irg(node);
-	ir_visited_t visited = irg->visited;
-
-	set_irn_visited(node, visited);
-
-	if (!is_Block(node)) {
-		ir_node *pred = get_nodes_block(node);
-		if (pred->visited < visited)
-			irg_walk_in_or_dep_2_post(pred, post, env);
-	}
-	foreach_irn_in_r(node, i, pred) {
-		if (pred->visited < visited)
-			irg_walk_in_or_dep_2_post(pred, post, env);
-	}
-
-	post(node, env);
+	unsigned **events = (unsigned**)env;
+	ARR_APP1(unsigned, *events, get_irn_idx(node) << 1);
 }
 
 /**
- * specialized version of irg_walk_in_or_dep_2, called if pre and post callbacks exist
+ * Walker recording post events into a walk cache array.
  */
-static void irg_walk_in_or_dep_2_both(ir_node *node, irg_walk_func *pre,
-                                      irg_walk_func *post, void *env)
+static void record_post(ir_node *node, void *env)
 {
-	ir_graph    *irg     = get_irn_irg(node);
-	ir_visited_t visited = irg->visited;
+	unsigned **events = (unsigned**)env;
+	ARR_APP1(unsigned, *events, get_irn_idx(node) << 1 | 1);
+}
 
-	set_irn_visited(node, visited);
+/**
+ * Returns an empty event array, reusing @p events if possible.
+ */
+static unsigned *clear_events(unsigned *events)
+{
+	if (events == NULL)
+		return NEW_ARR_F(unsigned, 0);
+	ARR_SHRINKLEN(events, 0);
+	return events;
+}
 
-	pre(node, env);
+void irg_walk_graph(ir_graph *irg, irg_walk_func *pre, irg_walk_func *post,
+                    void *env)
+{
+	irg_walk_cache_t *const cache = &irg->walk_cache;
+	if (!cache->active) {
+		irg_walk(get_irg_end(irg), pre, post, env);
+		return;
+	}
 
-	if (!is_Block(node)) {
-		ir_node *pred = get_nodes_block(node);
-		if (pred->visited < visited)
-			irg_walk_in_or_dep_2_both(pred, pre, post, env);
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_VISITED);
+	if (!cache->nodes_valid) {
+		cache->nodes = clear_events(cache->nodes);
+		inc_irg_visited(irg);
+		irg_walk_2(get_irg_end(irg), record_pre, record_post, &cache->nodes);
+		cache->nodes_valid = true;
 	}
-	foreach_irn_in_r(node, i, pred) {
-		if (pred->visited < visited)
-			irg_walk_in_or_dep_2_both(pred, pre, post, env);
+
+	inc_irg_visited(irg);
+	ir_visited_t    const visited  = irg->visited;
+	unsigned const *const events   = cache->nodes;
+	size_t          const n_events = ARR_LEN(events);
+	for (size_t i = 0; i < n_events; ++i) {
+		unsigned const event = events[i];
+		ir_node *const node  = get_idx_irn(irg, event >> 1);
+		if ((event & 1) == 0) {
+			set_irn_visited(node, visited);
+			if (pre != NULL)
+				pre(node, env);
+		} else if (post != NULL) {
+			post(node, env);
+		}
 	}
+	assert(cache->nodes_valid && "graph modified during cached walk");
+	ir_free_resources(irg, IR_RESOURCE_IRN_VISITED);
+}
 
-	post(node, env);
+void all_irg_walk(irg_walk_func *pre, irg_walk_func *post, void *env)
+{
+	foreach_irp_irg(i, irg) {
+		irg_walk_graph(irg, pre, post, env);
+	}
 }
 
 /**
@@ -219,12 +308,7 @@ static void irg_walk_in_or_dep_2_both(ir_node *node, irg_walk_func *pre,
 static void irg_walk_in_or_dep_2(ir_node *node, irg_walk_func *pre,
                                  irg_walk_func *post, void *env)
 {
-	if (irn_visited(node))
-		return;
-
-	if      (post == NULL) irg_walk_in_or_dep_2_pre (node, pre, env);
-	else if (pre == NULL)  irg_walk_in_or_dep_2_post(node, post, env);
-	else                   irg_walk_in_or_dep_2_both(node, pre, post, env);
+	irg_walk_2(node, pre, post, env);
 }
 
 void irg_walk_in_or_dep(ir_node *node, irg_walk_func *pre, irg_walk_func *post,
@@ -255,37 +339,58 @@ static ir_node *get_cf_op(ir_node *n)
 	return n;
 }
 
+/**
+ * Marks @p block visited, calls @p pre and puts it onto the walker stack.
+ */
+static inline void block_walk_enter(ir_graph *irg, ir_node *block,
+                                    irg_walk_func *pre, void *env)
+{
+	mark_Block_block_visited(block);
+
+	if (pre != NULL)
+		pre(block, env);
+
+	walk_push(irg, block, get_Block_n_cfgpreds(block));
+}
+
 static void irg_block_walk_2(ir_node *node, irg_walk_func *pre,
                              irg_walk_func *post, void *env)
 {
 	if (Block_block_visited(node))
 		return;
-	mark_Block_block_visited(node);
 
-	if (pre != NULL)
-		pre(node, env);
+	ir_graph    *const irg  = get_irn_irg(node);
+	size_t const       base = irg->walk_tos;
+	block_walk_enter(irg, node, pre, env);
+	while (irg->walk_tos > base) {
+		walk_frame *const top   = &irg->walk_stack[irg->walk_tos - 1];
+		ir_node    *const block = top->node;
+		if (top->pos == 0) {
+			--irg->walk_tos;
+			if (post != NULL)
+				post(block, env);
+			continue;
+		}
 
-	for (int i = get_Block_n_cfgpreds(node); i-- > 0; ) {
 		/* find the corresponding predecessor block. */
-		ir_node *pred_cfop  = get_cf_op(get_Block_cfgpred(node, i));
+		ir_node *pred_cfop = get_cf_op(get_Block_cfgpred(block, --top->pos));
 		if (is_Bad(pred_cfop))
 			continue;
 		ir_node *pred_block = get_nodes_block(pred_cfop);
-		/* recursion */
-		irg_block_walk_2(pred_block, pre, post, env);
+		if (!Block_block_visited(pred_block))
+			block_walk_enter(irg, pred_block, pre, env);
 	}
-
-	if (post != NULL)
-		post(node, env);
 }
 
-void irg_block_walk(ir_node *node, irg_walk_func *pre, irg_walk_func *post,
-                    void *env)
+/**
+ * Block walk without resource handling, see irg_block_walk().
+ */
+static void block_walk_core(ir_node *node, irg_walk_func *pre,
+                            irg_walk_func *post, void *env)
 {
 	ir_graph *const irg   = get_irn_irg(node);
 	ir_node  *const block = get_block(node);
 
-	ir_reserve_resources(irg, IR_RESOURCE_BLOCK_VISITED);
 	inc_irg_block_visited(irg);
 	irg_block_walk_2(block, pre, post, env);
 
@@ -297,14 +402,69 @@ void irg_block_walk(ir_node *node, irg_walk_func *pre, irg_walk_func *post,
 			irg_block_walk_2(pred, pre, post, env);
 		}
 	}
+}
+
+void irg_block_walk(ir_node *node, irg_walk_func *pre, irg_walk_func *post,
+                    void *env)
+{
+	ir_graph *const irg = get_irn_irg(node);
 
+	ir_reserve_resources(irg, IR_RESOURCE_BLOCK_VISITED);
+	block_walk_core(node, pre, post, env);
 	ir_free_resources(irg, IR_RESOURCE_BLOCK_VISITED);
 }
 
 void irg_block_walk_graph(ir_graph *irg, irg_walk_func *pre,
                           irg_walk_func *post, void *env)
 {
-	irg_block_walk(get_irg_end(irg), pre, post, env);
+	irg_walk_cache_t *const cache = &irg->walk_cache;
+	if (!cache->active) {
+		irg_block_walk(get_irg_end(irg), pre, post, env);
+		return;
+	}
+
+	ir_reserve_resources(irg, IR_RESOURCE_BLOCK_VISITED);
+	if (!cache->blocks_valid) {
+		cache->blocks = clear_events(cache->blocks);
+		block_walk_core(get_irg_end(irg), record_pre, record_post,
+		                &cache->blocks);
+		cache->blocks_valid = true;
+	}
+
+	inc_irg_block_visited(irg);
+	unsigned const *const events   = cache->blocks;
+	size_t          const n_events = ARR_LEN(events);
+	for (size_t i = 0; i < n_events; ++i) {
+		unsigned const event = events[i];
+		ir_node *const block = get_idx_irn(irg, event >> 1);
+		if ((event & 1) == 0) {
+			mark_Block_block_visited(block);
+			if (pre != NULL)
+				pre(block, env);
+		} else if (post != NULL) {
+			post(block, env);
+		}
+	}
+	assert(cache->blocks_valid && "graph modified during cached walk");
+	ir_free_resources(irg, IR_RESOURCE_BLOCK_VISITED);
+}
+
+void irg_walk_cache_activate(ir_graph *irg)
+{
+	irg->walk_cache.active = true;
+}
+
+void irg_walk_cache_deactivate(ir_graph *irg)
+{
+	irg_walk_cache_t *const cache = &irg->walk_cache;
+	if (cache->nodes != NULL)
+		DEL_ARR_F(cache->nodes);
+	if (cache->blocks != NULL)
+		DEL_ARR_F(cache->blocks);
+	cache->nodes  = NULL;
+	cache->blocks = NULL;
+	cache->active = false;
+	irg_invalidate_walk_cache(irg);
 }
 
 void irg_walk_anchors(ir_graph *irg, irg_walk_func *pre, irg_walk_func *post,
@@ -0,0 +1,43 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Graph walkers -- private header.
+ */
+#ifndef FIRM_IR_IRGWALK_T_H
+#define FIRM_IR_IRGWALK_T_H
+
+#include "irgwalk.h"
+#include "bitset.h"
+
+/**
+ * Walks over the ir graph like irg_walk() but records visited nodes in the
+ * caller-owned bitset @p visited, indexed by node index, instead of the
+ * visited counters of the nodes. Nodes whose bit is already set are not
+ * visited. Neither the nodes nor the graph are modified by the walk itself,
+ * no resources are reserved and the walk does not use the walker stack of the
+ * graph, so walks with different bitsets can be nested or run concurrently.
+ *
+ * Nodes with an index not covered by @p visited (nodes created after the
+ * bitset was allocated) are not visited.
+ *
+ * @param node     the start node
+ * @param visited  bitset of visited nodes, at least get_irg_last_idx() bits
+ * @param pre      walker function, executed before the predecessor of a node are visited
+ * @param post     walker function, executed after the predecessor of a node are visited
+ * @param env      environment, passed to pre and post
+ */
+void irg_walk_bitset(ir_node *node, bitset_t *visited, irg_walk_func *pre,
+                     irg_walk_func *post, void *env);
+
+/**
+ * Walks over all reachable nodes of @p irg starting at the End node, see
+ * irg_walk_bitset(). The graph's walk cache is not used.
+ */
+void irg_walk_graph_bitset(ir_graph *irg, bitset_t *visited,
+                           irg_walk_func *pre, irg_walk_func *post, void *env);
+
+#endif
@@ -12,7 +12,10 @@
 
 #include <assert.h>
 
+#include "panic.h"
+
 hook_entry_t *hooks[hook_last];
+unsigned      hooks_active;
 
 void register_hook(hook_type_t hook, hook_entry_t *entry)
 {
@@ -22,9 +25,12 @@ void register_hook(hook_type_t hook, hook_entry_t *entry)
 
 	/* hook should not be registered yet */
 	assert(entry->next == NULL && hooks[hook] != entry);
+	if (!(FIRM_HOOK_MASK & (1u << hook)))
+		panic("hook type %d not compiled in", (int)hook);
 
-	entry->next = hooks[hook];
-	hooks[hook] = entry;
+	entry->next   = hooks[hook];
+	hooks[hook]   = entry;
+	hooks_active |= 1u << hook;
 }
 
 void unregister_hook(hook_type_t hook, hook_entry_t *entry)
@@ -36,4 +42,6 @@ void unregister_hook(hook_type_t hook, hook_entry_t *entry)
 			break;
 		}
 	}
+	if (hooks[hook] == NULL)
+		hooks_active &= ~(1u << hook);
 }
@@ -12,6 +12,7 @@
 #define FIRM_IR_IRHOOKS_H
 
 #include <stdio.h>
+#include "compiler.h"
 #include "firm_types.h"
 
 /**
@@ -31,6 +32,18 @@ struct hook_entry {
 		/** This hook is called, before a node is replaced (exchange()) by another. */
 		void (*_hook_replace)(void *context, ir_node *old_node, ir_node *new_node);
 
+		/** This hook is called, after the out edge from input pos of src was
+		 * added, moved from old_tgt to tgt or removed (tgt is NULL) while out
+		 * edges are active.  The input of src is not changed yet. */
+		void (*_hook_edge_change)(void *context, ir_node *src, int pos,
+		                          ir_node *tgt, ir_node *old_tgt);
+
+		/** This hook is called, before input pos of src is changed from
+		 * old_tgt to tgt, whether out edges are active or not.  old_tgt is
+		 * NULL for added inputs, tgt is NULL for removed ones. */
+		void (*_hook_input_change)(void *context, ir_node *src, int pos,
+		                           ir_node *tgt, ir_node *old_tgt);
+
 		/** This hook is called, after a new graph was created and before the first block
 		 * on this graph is built. */
 		void (*_hook_new_graph)(void *context, ir_graph *irg, ir_entity *ent);
@@ -64,6 +77,8 @@ struct hook_entry {
 typedef enum {
 	hook_new_node,             /**< type for hook_new_node() hook */
 	hook_replace,              /**< type for hook_replace() hook */
+	hook_edge_change,          /**< type for hook_edge_change() hook */
+	hook_input_change,         /**< type for hook_input_change() hook */
 	hook_new_graph,            /**< type for hook_new_graph() hook */
 	hook_lower,                /**< type for hook_lower() hook */
 	hook_new_mode,             /**< type for hook_new_mode() hook */
@@ -89,25 +104,44 @@ void register_hook(hook_type_t hook, hook_entry_t *entry);
  */
 void unregister_hook(hook_type_t hook, hook_entry_t *entry);
 
+/**
+ * The hook types compiled into the library, bit (1 << type) for each.
+ * Builds which know they never register a hook type may define a smaller
+ * mask to remove its dispatch from the callers entirely.
+ */
+#ifndef FIRM_HOOK_MASK
+#define FIRM_HOOK_MASK (~0u)
+#endif
+
 /** Global list of registerd hooks. */
 extern hook_entry_t *hooks[hook_last];
 
+/** The hook types with registered entries, bit (1 << type) for each. */
+extern unsigned hooks_active;
+
 /**
  * Executes the hook @p what with the args @p args
  * Do not use this macro directly.
  */
-#define hook_exec(what, args) do {             \
-	hook_entry_t *_p;                          \
-	for (_p = hooks[what]; _p; _p = _p->next){ \
-		void *hook_ctx_ = _p->context;         \
-		_p->hook._##what args;                 \
-	}                                          \
+#define hook_exec(what, args) do {                                      \
+	if (UNLIKELY(FIRM_HOOK_MASK & hooks_active & (1u << (what)))) {     \
+		for (hook_entry_t *_p = hooks[what]; _p != NULL; _p = _p->next) { \
+			void *hook_ctx_ = _p->context;                              \
+			_p->hook._##what args;                                      \
+		}                                                               \
+	}                                                                   \
 } while (0)
 
 /** Called after a new node has been created */
 #define hook_new_node(node)               hook_exec(hook_new_node, (hook_ctx_, node))
 /** Called when a node is replaced */
 #define hook_replace(old, nw)             hook_exec(hook_replace, (hook_ctx_, old, nw))
+/** Called when an out edge has been changed */
+#define hook_edge_change(src, pos, tgt, old_tgt) \
+	hook_exec(hook_edge_change, (hook_ctx_, src, pos, tgt, old_tgt))
+/** Called before an input of a node is changed */
+#define hook_input_change(src, pos, tgt, old_tgt) \
+	hook_exec(hook_input_change, (hook_ctx_, src, pos, tgt, old_tgt))
 /** Called after a new graph has been created */
 #define hook_new_graph(irg, ent)          hook_exec(hook_new_graph, (hook_ctx_, irg, ent))
 /** Called before a node gets lowered */
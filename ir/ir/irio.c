@@ -5,17 +5,22 @@
 
 /**
  * @file
- * @brief   Write textual representation of firm to file.
+ * @brief   Write textual or binary representation of firm to file.
  * @author  Moritz Kroll, Matthias Braun
  */
 #include "irio.h"
 
 #include <string.h>
 #include <ctype.h>
+#include <fcntl.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "array.h"
+#include "hashptr.h"
 #include "ircons_t.h"
 #include "irflag_t.h"
 #include "irgmod.h"
@@ -32,6 +37,20 @@
 
 #define SYMERROR ((unsigned) ~0)
 
+/** Magic bytes starting the binary format, followed by the version. */
+static const char binary_magic[] = "\x7F" "FIRMIR";
+#define BINARY_VERSION 1
+
+/**
+ * Token tags of the binary format.  The punctuation tokens '[', ']', '{' and
+ * '}' are written as themselves, whitespace is not written at all.
+ */
+typedef enum token_tag_t {
+	TOKEN_NUMBER = 'n', /**< zigzag encoded varint */
+	TOKEN_WORD   = 'w', /**< string table index of a symbol */
+	TOKEN_STRING = 's', /**< string table index of a quoted string */
+} token_tag_t;
+
 typedef enum typetag_t {
 	tt_align,
 	tt_builtin_kind,
@@ -70,6 +89,7 @@ typedef enum keyword_t {
 	kw_type,
 	kw_typegraph,
 	kw_unknown,
+	kw_vector_mode,
 } keyword_t;
 
 typedef struct symbol_t {
@@ -111,14 +131,19 @@ static int id_cmp(const void *elt, const void *key, size_t size)
 static void FIRM_PRINTF(2, 3)
 parse_error(read_env_t *env, const char *fmt, ...)
 {
-	/* workaround read_c "feature" that a '\n' triggers the line++
-	 * instead of the character after the '\n' */
-	unsigned line = env->line;
-	if (env->c == '\n') {
-		line--;
-	}
+	if (env->binary) {
+		fprintf(stderr, "%s:@%zu: error ", env->inputname,
+		        (size_t)(env->pos - env->tokens));
+	} else {
+		/* workaround read_c "feature" that a '\n' triggers the line++
+		 * instead of the character after the '\n' */
+		unsigned line = env->line;
+		if (env->c == '\n') {
+			line--;
+		}
 
-	fprintf(stderr, "%s:%u: error ", env->inputname, line);
+		fprintf(stderr, "%s:%u: error ", env->inputname, line);
+	}
 	env->read_errors = true;
 
 	va_list ap;
@@ -199,6 +224,7 @@ static void symtbl_init(void)
 	INSERTKEYWORD(type);
 	INSERTKEYWORD(typegraph);
 	INSERTKEYWORD(unknown);
+	INSERTKEYWORD(vector_mode);
 
 	INSERTENUM(tt_align, align_non_aligned);
 	INSERTENUM(tt_align, align_is_aligned);
@@ -295,30 +321,117 @@ static unsigned symbol(const char *str, typetag_t typetag)
 	return entry ? entry->code : SYMERROR;
 }
 
+static void write_varint(struct obstack *obst, unsigned long value)
+{
+	do {
+		unsigned char c = value & 0x7F;
+		value >>= 7;
+		if (value != 0)
+			c |= 0x80;
+		obstack_1grow(obst, c);
+	} while (value != 0);
+}
+
+/**
+ * Writes a binary token referring to @p str in the string table.
+ * @return the string table index of @p str
+ */
+static size_t write_string_token(write_env_t *env, token_tag_t tag,
+                                 const char *str)
+{
+	ident *const id  = new_id_from_str(str);
+	size_t       idx = (size_t)pmap_get(void, env->string_index, id);
+	if (idx-- == 0) {
+		idx = ARR_LEN(env->strings);
+		ARR_APP1(ident*, env->strings, id);
+		pmap_insert(env->string_index, id, (void*)(idx + 1));
+	}
+	obstack_1grow(&env->tokens, tag);
+	write_varint(&env->tokens, idx);
+	return idx;
+}
+
+/** Writes whitespace which only exists in the text format. */
+static void write_layout(write_env_t *env, const char *layout)
+{
+	if (!env->binary)
+		fputs(layout, env->file);
+}
+
+/** Writes the punctuation @p c, followed by @p layout in the text format. */
+static void write_punct(write_env_t *env, char c, const char *layout)
+{
+	if (env->binary) {
+		obstack_1grow(&env->tokens, c);
+	} else {
+		fputc(c, env->file);
+		fputs(layout, env->file);
+	}
+}
+
 void write_long(write_env_t *env, long value)
 {
-	fprintf(env->file, "%ld ", value);
+	if (env->binary) {
+		obstack_1grow(&env->tokens, TOKEN_NUMBER);
+		unsigned long const bits = (unsigned long)value;
+		write_varint(&env->tokens, value < 0 ? ~(bits << 1) : bits << 1);
+	} else {
+		fprintf(env->file, "%ld ", value);
+	}
 }
 
 void write_int(write_env_t *env, int value)
 {
-	fprintf(env->file, "%d ", value);
+	if (env->binary)
+		write_long(env, value);
+	else
+		fprintf(env->file, "%d ", value);
 }
 
 void write_unsigned(write_env_t *env, unsigned value)
 {
-	fprintf(env->file, "%u ", value);
+	if (env->binary)
+		write_long(env, (long)value);
+	else
+		fprintf(env->file, "%u ", value);
 }
 
 void write_size_t(write_env_t *env, size_t value)
 {
-	ir_fprintf(env->file, "%zu ", value);
+	if (env->binary)
+		write_long(env, (long)value);
+	else
+		ir_fprintf(env->file, "%zu ", value);
 }
 
 void write_symbol(write_env_t *env, const char *symbol)
 {
-	fputs(symbol, env->file);
-	fputc(' ', env->file);
+	if (env->binary) {
+		write_string_token(env, TOKEN_WORD, symbol);
+	} else {
+		fputs(symbol, env->file);
+		fputc(' ', env->file);
+	}
+}
+
+/** Starts a top-level section with the keyword @p keyword. */
+static void write_section(write_env_t *env, const char *keyword, long nr)
+{
+	if (!env->binary) {
+		write_symbol(env, keyword);
+		return;
+	}
+
+	size_t const offset = obstack_object_size(&env->tokens);
+	size_t const n      = ARR_LEN(env->sections);
+	if (n > 0)
+		env->sections[n - 1].end = offset;
+	binary_section_t const section = {
+		.keyword = write_string_token(env, TOKEN_WORD, keyword),
+		.nr      = nr,
+		.begin   = offset,
+	};
+	ARR_APP1(binary_section_t, env->sections, section);
 }
 
 void write_entity_ref(write_env_t *env, ir_entity *entity)
@@ -343,6 +456,11 @@ void write_type_ref(write_env_t *env, ir_type *type)
 
 void write_string(write_env_t *env, const char *string)
 {
+	if (env->binary) {
+		write_string_token(env, TOKEN_STRING, string);
+		return;
+	}
+
 	fputc('"', env->file);
 	for (const char *c = string; *c != '\0'; ++c) {
 		switch (*c) {
@@ -371,7 +489,7 @@ void write_ident(write_env_t *env, ident *id)
 void write_ident_null(write_env_t *env, ident *id)
 {
 	if (id == NULL) {
-		fputs("NULL ", env->file);
+		write_symbol(env, "NULL");
 	} else {
 		write_ident(env, id);
 	}
@@ -388,26 +506,22 @@ void write_tarval_ref(write_env_t *env, ir_tarval *tv)
 	write_mode_ref(env, mode);
 	char buf[128];
 	const char *ascii = ir_tarval_to_ascii(buf, sizeof(buf), tv);
-	fputs(ascii, env->file);
-	fputc(' ', env->file);
+	write_symbol(env, ascii);
 }
 
 void write_align(write_env_t *env, ir_align align)
 {
-	fputs(get_align_name(align), env->file);
-	fputc(' ', env->file);
+	write_symbol(env, get_align_name(align));
 }
 
 void write_builtin_kind(write_env_t *env, ir_builtin_kind kind)
 {
-	fputs(get_builtin_kind_name(kind), env->file);
-	fputc(' ', env->file);
+	write_symbol(env, get_builtin_kind_name(kind));
 }
 
 void write_cond_jmp_predicate(write_env_t *env, cond_jmp_predicate pred)
 {
-	fputs(get_cond_jmp_predicate_name(pred), env->file);
-	fputc(' ', env->file);
+	write_symbol(env, get_cond_jmp_predicate_name(pred));
 }
 
 void write_relation(write_env_t *env, ir_relation relation)
@@ -427,22 +541,22 @@ void write_loop(write_env_t *env, bool loop)
 
 static void write_list_begin(write_env_t *env)
 {
-	fputs("[", env->file);
+	write_punct(env, '[', "");
 }
 
 static void write_list_end(write_env_t *env)
 {
-	fputs("] ", env->file);
+	write_punct(env, ']', " ");
 }
 
 static void write_scope_begin(write_env_t *env)
 {
-	fputs("{\n", env->file);
+	write_punct(env, '{', "\n");
 }
 
 static void write_scope_end(write_env_t *env)
 {
-	fputs("}\n\n", env->file);
+	write_punct(env, '}', "\n\n");
 }
 
 void write_node_ref(write_env_t *env, const ir_node *node)
@@ -453,11 +567,9 @@ void write_node_ref(write_env_t *env, const ir_node *node)
 void write_initializer(write_env_t *const env,
                        ir_initializer_t const *const ini)
 {
-	FILE *f = env->file;
 	ir_initializer_kind_t ini_kind = get_initializer_kind(ini);
 
-	fputs(get_initializer_kind_name(ini_kind), f);
-	fputc(' ', f);
+	write_symbol(env, get_initializer_kind_name(ini_kind));
 
 	switch (ini_kind) {
 	case IR_INITIALIZER_CONST:
@@ -484,37 +596,32 @@ void write_initializer(write_env_t *const env,
 
 void write_pin_state(write_env_t *env, op_pin_state state)
 {
-	fputs(get_op_pin_state_name(state), env->file);
-	fputc(' ', env->file);
+	write_symbol(env, get_op_pin_state_name(state));
 }
 
 void write_volatility(write_env_t *env, ir_volatility vol)
 {
-	fputs(get_volatility_name(vol), env->file);
-	fputc(' ', env->file);
+	write_symbol(env, get_volatility_name(vol));
 }
 
 static void write_type_state(write_env_t *env, ir_type_state state)
 {
-	fputs(get_type_state_name(state), env->file);
-	fputc(' ', env->file);
+	write_symbol(env, get_type_state_name(state));
 }
 
 void write_visibility(write_env_t *env, ir_visibility visibility)
 {
-	fputs(get_visibility_name(visibility), env->file);
-	fputc(' ', env->file);
+	write_symbol(env, get_visibility_name(visibility));
 }
 
 static void write_mode_arithmetic(write_env_t *env, ir_mode_arithmetic arithmetic)
 {
-	fputs(get_mode_arithmetic_name(arithmetic), env->file);
-	fputc(' ', env->file);
+	write_symbol(env, get_mode_arithmetic_name(arithmetic));
 }
 
 static void write_type_common(write_env_t *env, ir_type *tp)
 {
-	fputc('\t', env->file);
+	write_layout(env, "\t");
 	write_symbol(env, "type");
 	write_long(env, get_type_nr(tp));
 	write_symbol(env, get_type_opcode_name(get_type_opcode(tp)));
@@ -529,7 +636,7 @@ static void write_type(write_env_t *env, ir_type *tp);
 static bool is_internal_mode(ir_mode *mode)
 {
 	return !mode_is_int(mode) && !mode_is_reference(mode)
-	    && !mode_is_float(mode);
+	    && !mode_is_float(mode) && !mode_is_vector(mode);
 }
 
 static bool is_default_mode(ir_mode *mode)
@@ -548,7 +655,7 @@ static void write_type_primitive(write_env_t *env, ir_type *tp)
 
 	write_type_common(env, tp);
 	write_mode_ref(env, mode);
-	fputc('\n', env->file);
+	write_layout(env, "\n");
 }
 
 static void write_type_compound(write_env_t *env, ir_type *tp)
@@ -562,7 +669,7 @@ static void write_type_compound(write_env_t *env, ir_type *tp)
 	}
 	write_type_common(env, tp);
 	write_ident_null(env, get_compound_ident(tp));
-	fputc('\n', env->file);
+	write_layout(env, "\n");
 
 	for (size_t i = 0, n = get_compound_n_members(tp); i < n; ++i) {
 		ir_entity *member = get_compound_member(tp, i);
@@ -584,7 +691,7 @@ static void write_type_array(write_env_t *env, ir_type *tp)
 		write_symbol(env, "unknown");
 	else
 		panic("upper array bound is not constant");
-	fputc('\n', env->file);
+	write_layout(env, "\n");
 }
 
 static void write_type_method(write_env_t *env, ir_type *tp)
@@ -606,7 +713,7 @@ static void write_type_method(write_env_t *env, ir_type *tp)
 	for (size_t i = 0; i < nresults; i++)
 		write_type_ref(env, get_method_res_type(tp, i));
 	write_unsigned(env, is_method_variadic(tp));
-	fputc('\n', env->file);
+	write_layout(env, "\n");
 }
 
 static void write_type_pointer(write_env_t *env, ir_type *tp)
@@ -617,7 +724,7 @@ static void write_type_pointer(write_env_t *env, ir_type *tp)
 
 	write_type_common(env, tp);
 	write_type_ref(env, points_to);
-	fputc('\n', env->file);
+	write_layout(env, "\n");
 }
 
 static void write_type(write_env_t *env, ir_type *tp)
@@ -666,7 +773,7 @@ static void write_entity(write_env_t *env, ir_entity *ent)
 		write_entity(env, aliased);
 	}
 
-	fputc('\t', env->file);
+	write_layout(env, "\t");
 	switch ((ir_entity_kind)ent->kind) {
 	case IR_ENTITY_ALIAS:           write_symbol(env, "alias");           break;
 	case IR_ENTITY_NORMAL:          write_symbol(env, "entity");          break;
@@ -750,7 +857,7 @@ static void write_entity(write_env_t *env, ir_entity *ent)
 		break;
 	}
 
-	fputc('\n', env->file);
+	write_layout(env, "\n");
 }
 
 void write_switch_table_ref(write_env_t *env, const ir_switch_table *table)
@@ -879,11 +986,11 @@ static void write_node(const ir_node *node, write_env_t *env)
 	ir_op           *const op   = get_irn_op(node);
 	write_node_func *const func = get_generic_function_ptr(write_node_func, op);
 
-	fputc('\t', env->file);
+	write_layout(env, "\t");
 	if (func == NULL)
 		panic("no write_node_func for %+F", node);
 	func(env, node);
-	fputc('\n', env->file);
+	write_layout(env, "\n");
 }
 
 static void write_node_recursive(ir_node *node, write_env_t *env);
@@ -946,6 +1053,11 @@ static void write_mode(write_env_t *env, ir_mode *mode)
 		write_unsigned(env, get_mode_exponent_size(mode));
 		write_unsigned(env, get_mode_mantissa_size(mode));
 		write_unsigned(env, get_mode_float_int_overflow(mode));
+	} else if (mode_is_vector(mode)) {
+		write_symbol(env, "vector_mode");
+		write_string(env, get_mode_name(mode));
+		write_mode_ref(env, get_mode_vector_element_mode(mode));
+		write_unsigned(env, get_mode_vector_n_lanes(mode));
 	} else {
 		panic("cannot write internal modes");
 	}
@@ -953,35 +1065,35 @@ static void write_mode(write_env_t *env, ir_mode *mode)
 
 static void write_modes(write_env_t *env)
 {
-	write_symbol(env, "modes");
-	fputs("{\n", env->file);
+	write_section(env, "modes", 0);
+	write_scope_begin(env);
 
 	for (size_t i = 0, n_modes = ir_get_n_modes(); i < n_modes; i++) {
 		ir_mode *mode = ir_get_mode(i);
 		if (is_internal_mode(mode))
 			continue;
-		fputc('\t', env->file);
+		write_layout(env, "\t");
 		write_mode(env, mode);
-		fputc('\n', env->file);
+		write_layout(env, "\n");
 	}
 
-	fputs("}\n\n", env->file);
+	write_scope_end(env);
 }
 
 static void write_program(write_env_t *env)
 {
-	write_symbol(env, "program");
+	write_section(env, "program", 0);
 	write_scope_begin(env);
 	if (irp_prog_name_is_set()) {
-		fputc('\t', env->file);
+		write_layout(env, "\t");
 		write_symbol(env, "name");
 		write_string(env, get_irp_name());
-		fputc('\n', env->file);
+		write_layout(env, "\n");
 	}
 
 	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
 		ir_type *segment_type = get_segment_type(s);
-		fputc('\t', env->file);
+		write_layout(env, "\t");
 		write_symbol(env, "segment_type");
 		write_symbol(env, get_segment_name(s));
 		if (segment_type == NULL) {
@@ -989,34 +1101,46 @@ static void write_program(write_env_t *env)
 		} else {
 			write_type_ref(env, segment_type);
 		}
-		fputc('\n', env->file);
+		write_layout(env, "\n");
 	}
 
 	for (size_t i = 0, n_asms = get_irp_n_asms(); i < n_asms; ++i) {
 		ident *asm_text = get_irp_asm(i);
-		fputc('\t', env->file);
+		write_layout(env, "\t");
 		write_symbol(env, "asm");
 		write_ident(env, asm_text);
-		fputc('\n', env->file);
+		write_layout(env, "\n");
 	}
 	write_scope_end(env);
 }
 
-int ir_export(const char *filename)
+static void export_file(FILE *file, bool binary);
+
+static int export_filename(const char *filename, bool binary)
 {
-	FILE *file = fopen(filename, "wt");
+	FILE *file = fopen(filename, binary ? "wb" : "wt");
 	int   res  = 0;
 	if (file == NULL) {
 		perror(filename);
 		return 1;
 	}
 
-	ir_export_file(file);
+	export_file(file, binary);
 	res = ferror(file);
 	fclose(file);
 	return res;
 }
 
+int ir_export(const char *filename)
+{
+	return export_filename(filename, false);
+}
+
+int ir_export_binary(const char *filename)
+{
+	return export_filename(filename, true);
+}
+
 static void write_node_cb(ir_node *node, void *ctx)
 {
 	write_env_t *env = (write_env_t*)ctx;
@@ -1025,7 +1149,7 @@ static void write_node_cb(ir_node *node, void *ctx)
 
 static void write_typegraph(write_env_t *env)
 {
-	write_symbol(env, "typegraph");
+	write_section(env, "typegraph", 0);
 	write_scope_begin(env);
 	irp_reserve_resources(irp, IRP_RESOURCE_TYPE_VISITED);
 	inc_master_type_visited();
@@ -1045,8 +1169,9 @@ static void write_typegraph(write_env_t *env)
 
 static void write_irg(write_env_t *env, ir_graph *irg)
 {
-	write_symbol(env, "irg");
-	write_entity_ref(env, get_irg_entity(irg));
+	ir_entity *const entity = get_irg_entity(irg);
+	write_section(env, "irg", get_entity_nr(entity));
+	write_entity_ref(env, entity);
 	write_type_ref(env, get_irg_frame_type(irg));
 	write_scope_begin(env);
 	ir_reserve_resources(irg, IR_RESOURCE_IRN_VISITED);
@@ -1061,8 +1186,49 @@ static void write_irg(write_env_t *env, ir_graph *irg)
 	write_scope_end(env);
 }
 
-/* Exports the whole irp to the given file in a textual form. */
-void ir_export_file(FILE *file)
+/**
+ * Writes the binary format: the header, the string table, the section index
+ * and finally the token stream.
+ */
+static void write_binary_file(write_env_t *env)
+{
+	size_t         const size       = obstack_object_size(&env->tokens);
+	unsigned char *const tokens     = (unsigned char*)obstack_finish(&env->tokens);
+	size_t         const n_sections = ARR_LEN(env->sections);
+	if (n_sections > 0)
+		env->sections[n_sections - 1].end = size;
+
+	struct obstack header;
+	obstack_init(&header);
+	obstack_grow(&header, binary_magic, sizeof(binary_magic) - 1);
+	obstack_1grow(&header, BINARY_VERSION);
+
+	size_t const n_strings = ARR_LEN(env->strings);
+	write_varint(&header, n_strings);
+	for (size_t i = 0; i < n_strings; ++i) {
+		char const *const str = get_id_str(env->strings[i]);
+		size_t      const len = strlen(str);
+		write_varint(&header, len);
+		obstack_grow(&header, str, len);
+	}
+
+	write_varint(&header, n_sections);
+	for (size_t i = 0; i < n_sections; ++i) {
+		binary_section_t const *const section = &env->sections[i];
+		write_varint(&header, section->keyword);
+		write_varint(&header, (unsigned long)section->nr);
+		write_varint(&header, section->begin);
+		write_varint(&header, section->end);
+	}
+	write_varint(&header, size);
+
+	size_t const header_size = obstack_object_size(&header);
+	fwrite(obstack_finish(&header), 1, header_size, env->file);
+	fwrite(tokens, 1, size, env->file);
+	obstack_free(&header, NULL);
+}
+
+static void export_file(FILE *file, bool binary)
 {
 	write_env_t my_env;
 	write_env_t *env = &my_env;
@@ -1071,6 +1237,13 @@ void ir_export_file(FILE *file)
 	env->file         = file;
 	env->write_queue  = new_pdeq();
 	env->entity_queue = new_pdeq();
+	env->binary       = binary;
+	if (binary) {
+		obstack_init(&env->tokens);
+		env->string_index = pmap_create();
+		env->strings      = NEW_ARR_F(ident*, 0);
+		env->sections     = NEW_ARR_F(binary_section_t, 0);
+	}
 
 	writers_init();
 	write_modes(env);
@@ -1081,7 +1254,7 @@ void ir_export_file(FILE *file)
 		write_irg(env, irg);
 	}
 
-	write_symbol(env, "constirg");
+	write_section(env, "constirg", 0);
 	write_node_ref(env, get_const_code_irg()->current_block);
 	write_scope_begin(env);
 	walk_const_code(NULL, write_node_cb, env);
@@ -1089,14 +1262,93 @@ void ir_export_file(FILE *file)
 
 	write_program(env);
 
+	if (binary) {
+		write_binary_file(env);
+		DEL_ARR_F(env->sections);
+		DEL_ARR_F(env->strings);
+		pmap_destroy(env->string_index);
+		obstack_free(&env->tokens, NULL);
+	}
+
 	del_pdeq(env->entity_queue);
 	del_pdeq(env->write_queue);
 }
 
+/* Exports the whole irp to the given file in a textual form. */
+void ir_export_file(FILE *file)
+{
+	export_file(file, false);
+}
+
+void ir_export_binary_file(FILE *file)
+{
+	export_file(file, true);
+}
+
+
+
+static unsigned long read_varint(read_env_t *env)
+{
+	unsigned long res   = 0;
+	unsigned      shift = 0;
+	while (env->pos < env->end) {
+		unsigned char const c = *env->pos++;
+		res |= (unsigned long)(c & 0x7F) << shift;
+		if (!(c & 0x80))
+			return res;
+		shift += 7;
+	}
+	parse_error(env, "truncated number\n");
+	exit(1);
+}
+
+/** Reads the next token of the binary format. */
+static void read_token(read_env_t *env)
+{
+	if (env->pos >= env->end) {
+		env->token = EOF;
+		env->c     = EOF;
+		return;
+	}
 
+	int const tag = *env->pos++;
+	env->token = tag;
+	switch (tag) {
+	case TOKEN_NUMBER: {
+		unsigned long const bits = read_varint(env);
+		env->token_number = (long)(bits >> 1) ^ -(long)(bits & 1);
+		env->c            = env->token_number < 0 ? '-' : '0';
+		return;
+	}
+	case TOKEN_WORD:
+	case TOKEN_STRING: {
+		unsigned long const idx = read_varint(env);
+		if (idx >= env->n_strings) {
+			parse_error(env, "invalid string index %lu\n", idx);
+			exit(1);
+		}
+		env->token_string = env->strings[idx];
+		env->c = tag == TOKEN_STRING ? '"' : env->token_string[0];
+		return;
+	}
+	case '[':
+	case ']':
+	case '{':
+	case '}':
+		env->c = tag;
+		return;
+	}
+	parse_error(env, "invalid token 0x%02x\n", (unsigned)tag);
+	exit(1);
+}
 
 static void read_c(read_env_t *env)
 {
+	if (env->binary) {
+		read_token(env);
+		return;
+	}
+
 	int c = fgetc(env->file);
 	env->c = c;
 	if (c == '\n')
@@ -1123,6 +1375,12 @@ static void skip_ws(read_env_t *env)
 
 static void skip_to(read_env_t *env, char to_ch)
 {
+	if (env->binary) {
+		/* there are no lines to recover at, give up on the section */
+		env->pos = env->end;
+		read_token(env);
+		return;
+	}
 	while (env->c != to_ch && env->c != EOF) {
 		read_c(env);
 	}
@@ -1142,10 +1400,31 @@ static bool expect_char(read_env_t *env, char ch)
 
 #define EXPECT(c) if (expect_char(env, (c))) {} else return
 
+/** Copies the current token of the binary format to the obstack. */
+static char *read_token_string(read_env_t *env)
+{
+	assert(obstack_object_size(&env->obst) == 0);
+	if (env->token == TOKEN_NUMBER)
+		obstack_printf(&env->obst, "%ld", env->token_number);
+	else
+		obstack_grow(&env->obst, env->token_string, strlen(env->token_string));
+	obstack_1grow(&env->obst, '\0');
+	read_token(env);
+	return (char*)obstack_finish(&env->obst);
+}
+
 static char *read_word(read_env_t *env)
 {
 	skip_ws(env);
 
+	if (env->binary) {
+		if (env->token != TOKEN_WORD && env->token != TOKEN_NUMBER) {
+			parse_error(env, "Expected word, got '%c'\n", env->c);
+			exit(1);
+		}
+		return read_token_string(env);
+	}
+
 	assert(obstack_object_size(&env->obst) == 0);
 	while (true) {
 		int c = env->c;
@@ -1176,6 +1455,8 @@ static char *read_string(read_env_t *env)
 		parse_error(env, "Expected string, got '%c'\n", env->c);
 		exit(1);
 	}
+	if (env->binary)
+		return read_token_string(env);
 	read_c(env);
 
 	assert(obstack_object_size(&env->obst) == 0);
@@ -1260,6 +1541,15 @@ static ident *read_ident_null(read_env_t *env)
 static long read_long(read_env_t *env)
 {
 	skip_ws(env);
+	if (env->binary) {
+		if (env->token != TOKEN_NUMBER) {
+			parse_error(env, "Expected number, got '%c'\n", env->c);
+			exit(1);
+		}
+		long const result = env->token_number;
+		read_token(env);
+		return result;
+	}
 	if (!isdigit(env->c) && env->c != '-') {
 		parse_error(env, "Expected number, got '%c'\n", env->c);
 		exit(1);
@@ -1307,7 +1597,7 @@ static void expect_list_begin(read_env_t *env)
 
 static bool list_has_next(read_env_t *env)
 {
-	if (feof(env->file)) {
+	if (env->c == EOF) {
 		parse_error(env, "Unexpected EOF while reading list");
 		exit(1);
 	}
@@ -1594,114 +1884,637 @@ static ir_initializer_t *read_initializer(read_env_t *env)
 	panic("unknown initializer kind");
 }
 
-/** Reads a type description and remembers it by its id. */
-static void read_type(read_env_t *env)
-{
-	long           typenr = read_long(env);
-	tp_opcode      opcode = (tp_opcode) read_enum(env, tt_tpo);
-	unsigned       size   = (unsigned) read_long(env);
-	unsigned       align  = (unsigned) read_long(env);
-	ir_type_state  state  = read_type_state(env);
-	unsigned       flags  = (unsigned) read_long(env);
-	ir_type       *type;
+/*
+ * Merging of units, see ir_lto_begin().
+ */
 
-	switch (opcode) {
-	case tpo_array: {
-		ir_type *elemtype = read_type_ref(env);
-		type = new_type_array(elemtype);
-		char *str = read_word(env);
-		if (!streq(str, "unknown")) {
-			long size = atol(str);
-			set_array_size_int(type, size);
-		}
-		obstack_free(&env->obst, str);
-		set_type_size(type, size);
-		goto finish_type;
+/**
+ * A method declaration of the current unit which was merged into an entity
+ * of the program.  It is applied if the unit brings the graph of the method.
+ */
+typedef struct lto_method_t {
+	ir_type                  *type;
+	ir_linkage                linkage;
+	mtp_additional_properties properties;
+} lto_method_t;
+
+struct ir_lto_t {
+	set           *types;      /**< the merged types, by structure */
+	unsigned       n_renamed;  /**< number of renamed local entities */
+	/* the rest is set up for every unit */
+	ir_type      **unit_types; /**< types created by the current unit */
+	pmap          *canonical;  /**< type of the current unit -> merged type */
+	pmap          *methods;    /**< entity -> lto_method_t */
+	struct obstack obst;
+};
+
+/** Checks whether @p type is merged with structurally identical types. */
+static bool lto_is_mergeable(ir_type const *type)
+{
+	switch (get_type_opcode(type)) {
+	case tpo_array:
+	case tpo_method:
+	case tpo_pointer:
+	case tpo_primitive:
+	case tpo_struct:
+	case tpo_union:
+		return true;
+	case tpo_class:
+	case tpo_code:
+	case tpo_segment:
+	case tpo_uninitialized:
+	case tpo_unknown:
+		return false;
 	}
+	panic("invalid type");
+}
 
-	case tpo_class: {
-		ident *id = read_ident_null(env);
+static bool is_struct_or_union(ir_type const *type)
+{
+	tp_opcode const opcode = get_type_opcode(type);
+	return opcode == tpo_struct || opcode == tpo_union;
+}
 
-		if (typenr == (long) IR_SEGMENT_GLOBAL)
-			type = get_glob_type();
-		else
-			type = new_type_class(id);
-		set_type_size(type, size);
-		goto finish_type;
-	}
+static bool lto_same_layout(ir_type const *a, ir_type const *b)
+{
+	return get_type_opcode(a) == get_type_opcode(b)
+	    && get_type_size(a) == get_type_size(b)
+	    && get_type_alignment(a) == get_type_alignment(b)
+	    && get_type_state(a) == get_type_state(b)
+	    && a->flags == b->flags;
+}
 
-	case tpo_method: {
-		unsigned                  callingconv = read_unsigned(env);
-		mtp_additional_properties addprops
-			= (mtp_additional_properties) read_long(env);
-		size_t nparams  = read_size_t(env);
-		size_t nresults = read_size_t(env);
+static bool lto_same_array_size(ir_type const *a, ir_type const *b)
+{
+	if (has_array_size(a) != has_array_size(b))
+		return false;
+	return !has_array_size(a) || get_array_size_int(a) == get_array_size_int(b);
+}
 
-		type = new_type_method(nparams, nresults);
+static bool lto_same_signature(ir_type const *a, ir_type const *b)
+{
+	return get_method_n_params(a) == get_method_n_params(b)
+	    && get_method_n_ress(a) == get_method_n_ress(b)
+	    && is_method_variadic(a) == is_method_variadic(b)
+	    && get_method_calling_convention(a) == get_method_calling_convention(b)
+	    && get_method_additional_properties(a)
+	       == get_method_additional_properties(b);
+}
 
-		for (size_t i = 0; i < nparams; i++) {
-			long ptypenr = read_long(env);
-			ir_type *paramtype = get_type(env, ptypenr);
+/**
+ * Compares the structure of two types.  Named compounds behind pointers are
+ * only compared by name, which breaks cycles.
+ */
+static bool lto_same_shape(ir_type const *a, ir_type const *b, bool by_value)
+{
+	if (a == b)
+		return true;
+	if (!lto_same_layout(a, b))
+		return false;
 
-			set_method_param_type(type, i, paramtype);
+	switch (get_type_opcode(a)) {
+	case tpo_primitive:
+		return get_type_mode(a) == get_type_mode(b);
+
+	case tpo_pointer:
+		return lto_same_shape(get_pointer_points_to_type(a),
+		                      get_pointer_points_to_type(b), false);
+
+	case tpo_array:
+		return lto_same_array_size(a, b)
+		    && lto_same_shape(get_array_element_type(a),
+		                      get_array_element_type(b), true);
+
+	case tpo_method:
+		if (!lto_same_signature(a, b))
+			return false;
+		for (size_t i = 0, n = get_method_n_params(a); i < n; ++i) {
+			if (!lto_same_shape(get_method_param_type(a, i),
+			                    get_method_param_type(b, i), false))
+				return false;
 		}
-		for (size_t i = 0; i < nresults; i++) {
-			long ptypenr = read_long(env);
-			ir_type *restype = get_type(env, ptypenr);
-
-			set_method_res_type(type, i, restype);
+		for (size_t i = 0, n = get_method_n_ress(a); i < n; ++i) {
+			if (!lto_same_shape(get_method_res_type(a, i),
+			                    get_method_res_type(b, i), false))
+				return false;
 		}
+		return true;
 
-		int const variadic = read_long(env);
-		set_method_variadic(type, variadic);
-
-		set_method_calling_convention(type, callingconv);
-		set_method_additional_properties(type, addprops);
-		goto finish_type;
+	case tpo_struct:
+	case tpo_union: {
+		ident *const name = get_compound_ident(a);
+		if (name != get_compound_ident(b))
+			return false;
+		if (!by_value && name != NULL)
+			return true;
+		size_t const n = get_compound_n_members(a);
+		if (n != get_compound_n_members(b))
+			return false;
+		for (size_t i = 0; i < n; ++i) {
+			ir_entity const *const ma = get_compound_member(a, i);
+			ir_entity const *const mb = get_compound_member(b, i);
+			if (get_entity_ident(ma) != get_entity_ident(mb)
+			    || get_entity_offset(ma) != get_entity_offset(mb)
+			    || get_entity_bitfield_offset(ma) != get_entity_bitfield_offset(mb)
+			    || get_entity_bitfield_size(ma) != get_entity_bitfield_size(mb)
+			    || !lto_same_shape(get_entity_type(ma), get_entity_type(mb), true))
+				return false;
+		}
+		return true;
 	}
 
-	case tpo_pointer: {
-		ir_type *pointsto = get_type(env, read_long(env));
-		type = new_type_pointer(pointsto);
-		goto finish_type;
+	default:
+		return false;
 	}
+}
 
-	case tpo_primitive: {
-		ir_mode *mode = read_mode_ref(env);
-		type = new_type_primitive(mode);
-		set_type_size(type, size);
-		goto finish_type;
-	}
+/**
+ * Compares two types whose components are merged already, so they have to be
+ * identical.  Compounds are compared by their structure.
+ */
+static bool lto_same_type(ir_type const *a, ir_type const *b)
+{
+	if (a == b)
+		return true;
+	if (!lto_same_layout(a, b))
+		return false;
 
-	case tpo_struct: {
-		ident *id = read_ident_null(env);
-		type = new_type_struct(id);
-		set_type_size(type, size);
-		goto finish_type;
-	}
+	switch (get_type_opcode(a)) {
+	case tpo_primitive:
+		return get_type_mode(a) == get_type_mode(b);
 
-	case tpo_union: {
-		ident *id = read_ident_null(env);
-		type = new_type_union(id);
-		set_type_size(type, size);
-		goto finish_type;
-	}
+	case tpo_pointer:
+		return get_pointer_points_to_type(a) == get_pointer_points_to_type(b);
 
-	case tpo_segment: {
-		ident *id = read_ident_null(env);
-		type = new_type_segment(id, 0);
-		goto finish_type;
-	}
+	case tpo_array:
+		return lto_same_array_size(a, b)
+		    && get_array_element_type(a) == get_array_element_type(b);
 
-	case tpo_code:
-	case tpo_unknown:
-	case tpo_uninitialized:
-		parse_error(env, "can't import this type kind (%d)", opcode);
-		return;
-	}
-	parse_error(env, "unknown type kind: \"%d\"\n", opcode);
-	skip_to(env, '\n');
-	return;
+	case tpo_method:
+		if (!lto_same_signature(a, b))
+			return false;
+		for (size_t i = 0, n = get_method_n_params(a); i < n; ++i) {
+			if (get_method_param_type(a, i) != get_method_param_type(b, i))
+				return false;
+		}
+		for (size_t i = 0, n = get_method_n_ress(a); i < n; ++i) {
+			if (get_method_res_type(a, i) != get_method_res_type(b, i))
+				return false;
+		}
+		return true;
+
+	case tpo_struct:
+	case tpo_union:
+		return lto_same_shape(a, b, true);
+
+	default:
+		return false;
+	}
+}
+
+/** Hashes a type consistently with lto_same_type(). */
+static unsigned lto_hash_type(ir_type const *type)
+{
+	unsigned hash = hash_combine(get_type_opcode(type), get_type_size(type));
+	switch (get_type_opcode(type)) {
+	case tpo_primitive:
+		return hash_combine(hash, hash_ptr(get_type_mode(type)));
+
+	case tpo_pointer:
+		return hash_combine(hash, hash_ptr(get_pointer_points_to_type(type)));
+
+	case tpo_array:
+		return hash_combine(hash, hash_ptr(get_array_element_type(type)));
+
+	case tpo_method:
+		for (size_t i = 0, n = get_method_n_params(type); i < n; ++i)
+			hash = hash_combine(hash, hash_ptr(get_method_param_type(type, i)));
+		for (size_t i = 0, n = get_method_n_ress(type); i < n; ++i)
+			hash = hash_combine(hash, hash_ptr(get_method_res_type(type, i)));
+		return hash;
+
+	case tpo_struct:
+	case tpo_union:
+		hash = hash_combine(hash, hash_ptr(get_compound_ident(type)));
+		for (size_t i = 0, n = get_compound_n_members(type); i < n; ++i) {
+			ir_entity const *const member = get_compound_member(type, i);
+			hash = hash_combine(hash, hash_ptr(get_entity_ident(member)));
+		}
+		return hash;
+
+	default:
+		return hash;
+	}
+}
+
+static int lto_type_cmp(const void *elt, const void *key, size_t size)
+{
+	(void)size;
+	ir_type const *const *const a = (ir_type const*const*)elt;
+	ir_type const *const *const b = (ir_type const*const*)key;
+	return !lto_same_type(*a, *b);
+}
+
+/** Returns the merged type identical to @p type, which may be @p type. */
+static ir_type *lto_insert_type(ir_lto_t *lto, ir_type *type)
+{
+	return *set_insert(ir_type*, lto->types, &type, sizeof(type),
+	                   lto_hash_type(type));
+}
+
+/** Returns the merged type for a type of the current unit. */
+static ir_type *lto_canonical(ir_lto_t *lto, ir_type *type)
+{
+	ir_type *canonical = pmap_get(ir_type, lto->canonical, type);
+	if (canonical != NULL)
+		return canonical;
+	if (!pmap_contains(lto->canonical, type))
+		return type;
+
+	/* merge the components first, compounds are merged already so there are
+	 * no cycles; the entry guards against unusual ones anyway */
+	pmap_insert(lto->canonical, type, type);
+	switch (get_type_opcode(type)) {
+	case tpo_pointer:
+		set_pointer_points_to_type(type,
+			lto_canonical(lto, get_pointer_points_to_type(type)));
+		break;
+	case tpo_array:
+		set_array_element_type(type,
+			lto_canonical(lto, get_array_element_type(type)));
+		break;
+	case tpo_method:
+		for (size_t i = 0, n = get_method_n_params(type); i < n; ++i) {
+			set_method_param_type(type, i,
+				lto_canonical(lto, get_method_param_type(type, i)));
+		}
+		for (size_t i = 0, n = get_method_n_ress(type); i < n; ++i) {
+			set_method_res_type(type, i,
+				lto_canonical(lto, get_method_res_type(type, i)));
+		}
+		break;
+	default:
+		break;
+	}
+	canonical = lto_insert_type(lto, type);
+	pmap_insert(lto->canonical, type, canonical);
+	return canonical;
+}
+
+/**
+ * Merges the types of the current unit with the types of the program after
+ * the type graph has been read: References by entities and ids are
+ * redirected to the merged types and the duplicates are freed.
+ */
+static void lto_merge_types(read_env_t *env)
+{
+	ir_lto_t *const lto = env->lto;
+	for (size_t i = 0, n = ARR_LEN(lto->unit_types); i < n; ++i) {
+		ir_type *const type = lto->unit_types[i];
+		pmap_insert(lto->canonical, type, lto_is_mergeable(type) ? NULL : type);
+	}
+	for (size_t i = 0, n = ARR_LEN(lto->unit_types); i < n; ++i) {
+		ir_type *const type = lto->unit_types[i];
+		if (is_struct_or_union(type))
+			pmap_insert(lto->canonical, type, lto_insert_type(lto, type));
+	}
+	for (size_t i = 0, n = ARR_LEN(lto->unit_types); i < n; ++i)
+		lto_canonical(lto, lto->unit_types[i]);
+
+	/* members of merged compounds are replaced by the members of the merged
+	 * type, all other entities get the merged types */
+	pmap *const members = pmap_create();
+	foreach_set(env->idset, id_entry, entry) {
+		if (!is_entity(entry->elem))
+			continue;
+		ir_entity *const entity    = (ir_entity*)entry->elem;
+		ir_type   *const owner     = get_entity_owner(entity);
+		ir_type   *const canonical = lto_canonical(lto, owner);
+		if (canonical != owner) {
+			size_t const idx = get_compound_member_index(owner, entity);
+			pmap_insert(members, entity, get_compound_member(canonical, idx));
+		} else {
+			set_entity_type(entity, lto_canonical(lto, get_entity_type(entity)));
+		}
+	}
+	foreach_set(env->idset, id_entry, entry) {
+		if (is_type(entry->elem)) {
+			entry->elem = lto_canonical(lto, (ir_type*)entry->elem);
+		} else if (is_entity(entry->elem)) {
+			ir_entity *const member = pmap_get(ir_entity, members, entry->elem);
+			if (member != NULL)
+				entry->elem = member;
+		}
+	}
+	pmap_destroy(members);
+
+	for (size_t i = 0, n = ARR_LEN(env->fixedtypes); i < n; ++i)
+		env->fixedtypes[i] = lto_canonical(lto, env->fixedtypes[i]);
+
+	foreach_pmap(lto->methods, entry) {
+		lto_method_t *const method = (lto_method_t*)entry->value;
+		method->type = lto_canonical(lto, method->type);
+	}
+
+	for (size_t i = ARR_LEN(lto->unit_types); i-- > 0;) {
+		ir_type *const type = lto->unit_types[i];
+		if (lto_canonical(lto, type) != type)
+			free_type(type);
+	}
+}
+
+/** Returns the existing segment type named @p id, if any. */
+static ir_type *lto_find_segment(ident *id)
+{
+	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+		ir_type *const segment = get_segment_type(s);
+		if (get_compound_ident(segment) == id)
+			return segment;
+	}
+	return NULL;
+}
+
+static bool is_local_visibility(ir_visibility visibility)
+{
+	return visibility == ir_visibility_local
+	    || visibility == ir_visibility_private;
+}
+
+/** Returns a new linker name for an entity clashing with another global. */
+static ident *lto_unique_ident(ir_lto_t *lto, ident *id)
+{
+	ident *unique;
+	do {
+		unique = new_id_fmt("%s.lto.%u", get_id_str(id), ++lto->n_renamed);
+	} while (ir_get_global(unique) != NULL);
+	return unique;
+}
+
+/**
+ * Resolves a global entity of the current unit against the globals of the
+ * program.  Returns the entity to merge with or NULL if a new entity has to
+ * be created, possibly under the new linker name @p ld_name.
+ */
+static ir_entity *lto_resolve_global(read_env_t *env, ir_entity_kind kind,
+                                     ident *name, ident **ld_name,
+                                     ir_visibility visibility)
+{
+	ident     *const id       = *ld_name != NULL ? *ld_name : name;
+	ir_entity *const existing = ir_get_global(id);
+	if (existing == NULL)
+		return NULL;
+
+	if (is_local_visibility(visibility)) {
+		*ld_name = lto_unique_ident(env->lto, id);
+		return NULL;
+	}
+	if (is_local_visibility(get_entity_visibility(existing))) {
+		set_entity_ld_ident(existing, lto_unique_ident(env->lto, id));
+		return NULL;
+	}
+	if (kind != get_entity_kind(existing) || kind == IR_ENTITY_ALIAS) {
+		parse_error(env, "cannot merge %s with a different kind of entity\n",
+		            get_id_str(id));
+		*ld_name = lto_unique_ident(env->lto, id);
+		return NULL;
+	}
+	return existing;
+}
+
+/** The most constraining visibility of two external entities wins. */
+static ir_visibility lto_merge_visibility(ir_visibility a, ir_visibility b)
+{
+	if (a == ir_visibility_external_private
+	    || b == ir_visibility_external_private)
+		return ir_visibility_external_private;
+	if (a == ir_visibility_external_protected
+	    || b == ir_visibility_external_protected)
+		return ir_visibility_external_protected;
+	return ir_visibility_external;
+}
+
+/**
+ * Decides whether a definition with linkage @p linkage replaces the
+ * definition of @p entity, if it has one.  Reports multiple definitions.
+ */
+static bool lto_replaces_definition(read_env_t *env, ir_entity const *entity,
+                                    bool defined, ir_linkage linkage)
+{
+	if (!defined)
+		return true;
+	ir_linkage const weak = IR_LINKAGE_WEAK | IR_LINKAGE_NO_CODEGEN;
+	ir_linkage const old  = get_entity_linkage(entity);
+	if ((old & weak) && !(linkage & weak))
+		return true;
+	if (!((old | linkage) & (weak | IR_LINKAGE_MERGE))) {
+		parse_error(env, "multiple definitions of %s\n",
+		            get_entity_ld_name(entity));
+	}
+	return false;
+}
+
+/**
+ * Merges a global entity of the current unit into @p entity, reading the rest
+ * of the entity description.
+ */
+static void lto_merge_global(read_env_t *env, ir_entity *entity,
+                             ir_entity_kind kind, ir_type *type,
+                             ir_visibility visibility, ir_linkage linkage,
+                             ir_volatility volatility)
+{
+	ir_lto_t *const lto = env->lto;
+	switch (kind) {
+	case IR_ENTITY_NORMAL: {
+		ir_initializer_t *initializer = NULL;
+		const char       *str         = read_word(env);
+		if (streq(str, "initializer")) {
+			initializer = read_initializer(env);
+		} else if (!streq(str, "none")) {
+			parse_error(env, "expected 'initializer' or 'none' got '%s'\n", str);
+		}
+		if (initializer != NULL && lto_replaces_definition(env, entity,
+				get_entity_initializer(entity) != NULL, linkage)) {
+			set_entity_type(entity, type);
+			set_entity_initializer(entity, initializer);
+			set_entity_linkage(entity, linkage);
+			set_entity_volatility(entity, volatility);
+		}
+		break;
+	}
+
+	case IR_ENTITY_METHOD: {
+		lto_method_t *const method = OALLOC(&lto->obst, lto_method_t);
+		method->type       = type;
+		method->linkage    = linkage;
+		method->properties = (mtp_additional_properties)read_long(env);
+		pmap_insert(lto->methods, entity, method);
+		break;
+	}
+
+	default:
+		panic("cannot merge entity kind %d", kind);
+	}
+
+	set_entity_visibility(entity, lto_merge_visibility(
+		get_entity_visibility(entity), visibility));
+}
+
+/** Frees a graph of a merged entity together with its frame type. */
+static void lto_free_irg(read_env_t *env, ir_graph *irg)
+{
+	ir_type *const frame = get_irg_frame_type(irg);
+	free_ir_graph(irg);
+	for (size_t i = 0, n = ARR_LEN(env->fixedtypes); i < n; ++i) {
+		if (env->fixedtypes[i] == frame) {
+			env->fixedtypes[i] = env->fixedtypes[n - 1];
+			ARR_SHRINKLEN(env->fixedtypes, n - 1);
+			break;
+		}
+	}
+	free_type(frame);
+}
+
+/**
+ * Decides between the graph @p old of an entity merged with the current unit
+ * and the graph @p irg read from the unit.
+ */
+static void lto_merge_irg(read_env_t *env, ir_entity *entity, ir_graph *old,
+                          ir_graph *irg)
+{
+	lto_method_t const *const method
+		= pmap_get(lto_method_t, env->lto->methods, entity);
+	if (method == NULL)
+		return;
+
+	if (lto_replaces_definition(env, entity, old != NULL, method->linkage)) {
+		if (old != NULL)
+			lto_free_irg(env, old);
+		set_entity_type(entity, method->type);
+		set_entity_linkage(entity, method->linkage);
+		add_entity_additional_properties(entity, method->properties);
+		set_entity_irg(entity, irg);
+	} else {
+		lto_free_irg(env, irg);
+		set_entity_irg(entity, old);
+	}
+}
+
+/** Reads a type description and remembers it by its id. */
+static void read_type(read_env_t *env)
+{
+	long           typenr = read_long(env);
+	tp_opcode      opcode = (tp_opcode) read_enum(env, tt_tpo);
+	unsigned       size   = (unsigned) read_long(env);
+	unsigned       align  = (unsigned) read_long(env);
+	ir_type_state  state  = read_type_state(env);
+	unsigned       flags  = (unsigned) read_long(env);
+	ir_type       *type;
+
+	switch (opcode) {
+	case tpo_array: {
+		ir_type *elemtype = read_type_ref(env);
+		type = new_type_array(elemtype);
+		char *str = read_word(env);
+		if (!streq(str, "unknown")) {
+			long size = atol(str);
+			set_array_size_int(type, size);
+		}
+		obstack_free(&env->obst, str);
+		set_type_size(type, size);
+		goto finish_type;
+	}
+
+	case tpo_class: {
+		ident *id = read_ident_null(env);
+
+		if (typenr == (long) IR_SEGMENT_GLOBAL)
+			type = get_glob_type();
+		else
+			type = new_type_class(id);
+		set_type_size(type, size);
+		goto finish_type;
+	}
+
+	case tpo_method: {
+		unsigned                  callingconv = read_unsigned(env);
+		mtp_additional_properties addprops
+			= (mtp_additional_properties) read_long(env);
+		size_t nparams  = read_size_t(env);
+		size_t nresults = read_size_t(env);
+
+		type = new_type_method(nparams, nresults);
+
+		for (size_t i = 0; i < nparams; i++) {
+			long ptypenr = read_long(env);
+			ir_type *paramtype = get_type(env, ptypenr);
+
+			set_method_param_type(type, i, paramtype);
+		}
+		for (size_t i = 0; i < nresults; i++) {
+			long ptypenr = read_long(env);
+			ir_type *restype = get_type(env, ptypenr);
+
+			set_method_res_type(type, i, restype);
+		}
+
+		int const variadic = read_long(env);
+		set_method_variadic(type, variadic);
+
+		set_method_calling_convention(type, callingconv);
+		set_method_additional_properties(type, addprops);
+		goto finish_type;
+	}
+
+	case tpo_pointer: {
+		ir_type *pointsto = get_type(env, read_long(env));
+		type = new_type_pointer(pointsto);
+		goto finish_type;
+	}
+
+	case tpo_primitive: {
+		ir_mode *mode = read_mode_ref(env);
+		type = new_type_primitive(mode);
+		set_type_size(type, size);
+		goto finish_type;
+	}
+
+	case tpo_struct: {
+		ident *id = read_ident_null(env);
+		type = new_type_struct(id);
+		set_type_size(type, size);
+		goto finish_type;
+	}
+
+	case tpo_union: {
+		ident *id = read_ident_null(env);
+		type = new_type_union(id);
+		set_type_size(type, size);
+		goto finish_type;
+	}
+
+	case tpo_segment: {
+		ident *id = read_ident_null(env);
+		/* merged units share the segments of the program */
+		if (env->lto != NULL) {
+			ir_type *const segment = lto_find_segment(id);
+			if (segment != NULL) {
+				set_id(env, typenr, segment);
+				return;
+			}
+		}
+		type = new_type_segment(id, 0);
+		goto finish_type;
+	}
+
+	case tpo_code:
+	case tpo_unknown:
+	case tpo_uninitialized:
+		parse_error(env, "can't import this type kind (%d)", opcode);
+		return;
+	}
+	parse_error(env, "unknown type kind: \"%d\"\n", opcode);
+	skip_to(env, '\n');
+	return;
 
 finish_type:
 	if (align > 0)
@@ -1710,6 +2523,8 @@ finish_type:
 
 	if (state == layout_fixed)
 		ARR_APP1(ir_type *, env->fixedtypes, type);
+	if (env->lto != NULL)
+		ARR_APP1(ir_type *, env->lto->unit_types, type);
 
 	set_id(env, typenr, type);
 }
@@ -1721,6 +2536,19 @@ static void read_unknown_entity(read_env_t *env)
 	set_id(env, entnr, entity);
 }
 
+/**
+ * Creates an entity under its linker name first, so only the linker name is
+ * entered into the globals of the program.
+ */
+static ir_entity *create_entity(ir_type *owner, ident *name, ident *ld_name,
+                                ir_type *type)
+{
+	ir_entity *entity = new_entity(owner, ld_name != NULL ? ld_name : name,
+	                               type);
+	set_entity_ident(entity, name);
+	return entity;
+}
+
 /** Reads an entity description and remembers it by its id. */
 static void read_entity(read_env_t *env, ir_entity_kind kind)
 {
@@ -1749,6 +2577,18 @@ static void read_entity(read_env_t *env, ir_entity_kind kind)
 
 	ir_volatility volatility = read_volatility(env);
 
+	if (env->lto != NULL && owner != NULL && is_segment_type(owner)
+	    && !(owner->flags & tf_info)) {
+		ir_entity *const merged
+			= lto_resolve_global(env, kind, name, &ld_name, visibility);
+		if (merged != NULL) {
+			lto_merge_global(env, merged, kind, type, visibility, linkage,
+			                 volatility);
+			set_id(env, entnr, merged);
+			return;
+		}
+	}
+
 	switch (kind) {
 	case IR_ENTITY_ALIAS: {
 		ir_entity *aliased = read_entity_ref(env);
@@ -1756,9 +2596,7 @@ static void read_entity(read_env_t *env, ir_entity_kind kind)
 		break;
 	}
 	case IR_ENTITY_NORMAL:
-		entity = new_entity(owner, name, type);
-		if (ld_name != NULL)
-			set_entity_ld_ident(entity, ld_name);
+		entity = create_entity(owner, name, ld_name, type);
 		const char *str = read_word(env);
 		if (streq(str, "initializer")) {
 			ir_initializer_t *initializer = read_initializer(env);
@@ -1771,17 +2609,13 @@ static void read_entity(read_env_t *env, ir_entity_kind kind)
 		}
 		break;
 	case IR_ENTITY_COMPOUND_MEMBER:
-		entity = new_entity(owner, name, type);
-		if (ld_name != NULL)
-			set_entity_ld_ident(entity, ld_name);
+		entity = create_entity(owner, name, ld_name, type);
 		set_entity_offset(entity, read_int(env));
 		set_entity_bitfield_offset(entity, read_unsigned(env));
 		set_entity_bitfield_size(entity, read_unsigned(env));
 		break;
 	case IR_ENTITY_METHOD:
-		entity = new_entity(owner, name, type);
-		if (ld_name != NULL)
-			set_entity_ld_ident(entity, ld_name);
+		entity = create_entity(owner, name, ld_name, type);
 		add_entity_additional_properties(
 			entity, (mtp_additional_properties) read_long(env));
 		break;
@@ -1868,6 +2702,9 @@ static void read_typegraph(read_env_t *env)
 		}
 	}
 	env->irg = old_irg;
+
+	if (env->lto != NULL)
+		lto_merge_types(env);
 }
 
 ir_node *read_node_ref(read_env_t *env)
@@ -2081,11 +2918,16 @@ next_delayed_pred: ;
 static ir_graph *read_irg(read_env_t *env)
 {
 	ir_entity *irgent = get_entity(env, read_long(env));
+	ir_graph  *merged = env->lto != NULL ? get_entity_irg(irgent) : NULL;
 	ir_graph  *irg    = new_ir_graph(irgent, 0);
 	ir_type   *frame  = read_type_ref(env);
+	/* the frame type created with the graph is replaced */
+	free_type(get_irg_frame_type(irg));
 	set_irg_frame_type(irg, frame);
 	read_graph(env, irg);
 	irg_finalize_cons(irg);
+	if (env->lto != NULL)
+		lto_merge_irg(env, irgent, merged, irg);
 	return irg;
 }
 
@@ -2136,6 +2978,13 @@ static void read_modes(read_env_t *env)
 			               overflow);
 			break;
 		}
+		case kw_vector_mode: {
+			const char *name         = read_string(env);
+			ir_mode    *element_mode = read_mode_ref(env);
+			unsigned    n_lanes      = read_unsigned(env);
+			new_vector_mode(name, element_mode, n_lanes);
+			break;
+		}
 
 		default:
 			skip_to(env, '\n');
@@ -2177,7 +3026,7 @@ static void read_program(read_env_t *env)
 
 int ir_import(const char *filename)
 {
-	FILE *file = fopen(filename, "rt");
+	FILE *file = fopen(filename, "rb");
 	if (file == NULL) {
 		perror(filename);
 		return 1;
@@ -2188,78 +3037,172 @@ int ir_import(const char *filename)
 	return res;
 }
 
-int ir_import_file(FILE *input, const char *inputname)
+/** Reads a top-level section, starting at its keyword. */
+static void read_section(read_env_t *env)
 {
-	read_env_t          myenv;
-	int                 oldoptimize = get_optimize();
-	read_env_t         *env         = &myenv;
-
-	readers_init();
-	symtbl_init();
+	keyword_t kw = read_keyword(env);
+	switch (kw) {
+	case kw_modes:
+		read_modes(env);
+		return;
 
-	memset(env, 0, sizeof(*env));
-	obstack_init(&env->obst);
-	obstack_init(&env->preds_obst);
-	env->idset      = new_set(id_cmp, 128);
-	env->fixedtypes = NEW_ARR_F(ir_type *, 0);
-	env->inputname  = inputname;
-	env->file       = input;
-	env->line       = 1;
-	env->delayed_initializers = NEW_ARR_F(delayed_initializer_t, 0);
+	case kw_typegraph:
+		read_typegraph(env);
+		return;
 
-	/* read first character */
-	read_c(env);
+	case kw_irg:
+		read_irg(env);
+		return;
 
-	/* if the first line starts with '#', it contains a comment. */
-	if (env->c == '#')
-		skip_to(env, '\n');
+	case kw_constirg: {
+		ir_graph *constirg = get_const_code_irg();
+		long bodyblockid = read_long(env);
+		set_id(env, bodyblockid, constirg->current_block);
+		read_graph(env, constirg);
+		return;
+	}
 
-	set_optimize(0);
+	case kw_program:
+		read_program(env);
+		return;
 
-	while (true) {
-		keyword_t kw;
+	default:
+		parse_error(env, "Unexpected keyword %d at toplevel\n", kw);
+		exit(1);
+	}
+}
 
-		skip_ws(env);
-		if (env->c == EOF)
-			break;
+/**
+ * Reads the string table and the section index of the binary format from
+ * @p data, which has to stay alive as long as sections are read.
+ */
+static bool read_binary_tables(read_env_t *env, const unsigned char *data,
+                               size_t size)
+{
+	env->pos    = data;
+	env->end    = data + size;
+	env->tokens = data;
+
+	env->n_strings = read_varint(env);
+	env->strings   = XMALLOCN(char*, env->n_strings);
+	for (size_t i = 0; i < env->n_strings; ++i) {
+		size_t const len = read_varint(env);
+		if (len > (size_t)(env->end - env->pos)) {
+			parse_error(env, "truncated string table\n");
+			return false;
+		}
+		env->strings[i] = (char*)obstack_copy0(&env->obst, env->pos, len);
+		env->pos += len;
+	}
 
-		kw = read_keyword(env);
-		switch (kw) {
-		case kw_modes:
-			read_modes(env);
-			break;
+	env->n_sections = read_varint(env);
+	env->sections   = XMALLOCN(binary_section_t, env->n_sections);
+	for (size_t i = 0; i < env->n_sections; ++i) {
+		binary_section_t *const section = &env->sections[i];
+		section->keyword = read_varint(env);
+		section->nr      = (long)read_varint(env);
+		section->begin   = read_varint(env);
+		section->end     = read_varint(env);
+	}
 
-		case kw_typegraph:
-			read_typegraph(env);
-			break;
+	size_t const tokens_size = read_varint(env);
+	if (tokens_size != (size_t)(env->end - env->pos)) {
+		parse_error(env, "token stream size mismatch\n");
+		return false;
+	}
+	env->tokens = env->pos;
+	for (size_t i = 0; i < env->n_sections; ++i) {
+		binary_section_t const *const section = &env->sections[i];
+		if (section->keyword >= env->n_strings || section->begin > section->end
+		    || section->end > tokens_size) {
+			parse_error(env, "invalid section %zu\n", i);
+			return false;
+		}
+	}
+	return true;
+}
 
-		case kw_irg:
-			read_irg(env);
-			break;
+/**
+ * Reads the header of the binary format, the magic has been read already.
+ * The rest of the file is kept in memory.
+ */
+static bool read_binary_header(read_env_t *env)
+{
+	size_t const magic_len = sizeof(binary_magic) - 1;
+	char         magic[sizeof(binary_magic)];
+	if (fread(magic + 1, 1, magic_len, env->file) != magic_len
+	    || memcmp(magic + 1, binary_magic + 1, magic_len - 1) != 0
+	    || magic[magic_len] != BINARY_VERSION) {
+		parse_error(env, "not a firm file of binary version %d\n",
+		            BINARY_VERSION);
+		return false;
+	}
 
-		case kw_constirg: {
-			ir_graph *constirg = get_const_code_irg();
-			long bodyblockid = read_long(env);
-			set_id(env, bodyblockid, constirg->current_block);
-			read_graph(env, constirg);
-			break;
+	size_t size     = 0;
+	size_t capacity = 64 * 1024;
+	env->data = XMALLOCN(unsigned char, capacity);
+	for (size_t n; (n = fread(env->data + size, 1, capacity - size, env->file)) > 0;) {
+		size += n;
+		if (size == capacity) {
+			capacity *= 2;
+			env->data = XREALLOC(env->data, unsigned char, capacity);
 		}
+	}
+	return read_binary_tables(env, env->data, size);
+}
 
-		case kw_program:
-			read_program(env);
-			break;
+/** Reads the section @p i of the binary format. */
+static void read_binary_section(read_env_t *env, size_t i)
+{
+	binary_section_t const *const section = &env->sections[i];
+	env->pos = env->tokens + section->begin;
+	env->end = env->tokens + section->end;
+	read_token(env);
+	read_section(env);
+	if (env->c != EOF)
+		parse_error(env, "garbage at end of section %zu\n", i);
+}
 
-		default: {
-			parse_error(env, "Unexpected keyword %d at toplevel\n", kw);
-			exit(1);
-		}
+/** Checks whether the section @p i of the binary format holds a graph. */
+static bool is_irg_section(read_env_t const *env, size_t i)
+{
+	return streq(env->strings[env->sections[i].keyword], "irg");
+}
+
+/** Reads the sections of the binary format, possibly skipping graphs. */
+static void read_binary_sections(read_env_t *env, const char *only_irg)
+{
+	for (size_t i = 0; i < env->n_sections; ++i) {
+		if (only_irg != NULL && is_irg_section(env, i)) {
+			ir_entity *const entity = (ir_entity*)get_id(env, env->sections[i].nr);
+			if (entity == NULL || !streq(get_entity_ld_name(entity), only_irg))
+				continue;
 		}
+		read_binary_section(env, i);
 	}
+}
 
+static void init_read_env(read_env_t *env, FILE *input, const char *inputname)
+{
+	memset(env, 0, sizeof(*env));
+	obstack_init(&env->obst);
+	obstack_init(&env->preds_obst);
+	env->idset      = new_set(id_cmp, 128);
+	env->fixedtypes = NEW_ARR_F(ir_type *, 0);
+	env->inputname  = inputname;
+	env->file       = input;
+	env->line       = 1;
+	env->delayed_initializers = NEW_ARR_F(delayed_initializer_t, 0);
+}
+
+/** Fixes the type layouts and resolves the initializers read so far. */
+static void finish_program(read_env_t *env)
+{
 	for (size_t i = 0, n = ARR_LEN(env->fixedtypes); i < n; i++)
 		set_type_state(env->fixedtypes[i], layout_fixed);
 
 	DEL_ARR_F(env->fixedtypes);
+	env->fixedtypes = NULL;
 
 	/* resolve delayed initializers */
 	for (size_t i = 0, n = ARR_LEN(env->delayed_initializers); i < n; ++i) {
@@ -2275,16 +3218,336 @@ int ir_import_file(FILE *input, const char *inputname)
 	}
 	DEL_ARR_F(env->delayed_initializers);
 	env->delayed_initializers = NULL;
+}
 
+static void free_read_env(read_env_t *env)
+{
 	del_set(env->idset);
+	obstack_free(&env->preds_obst, NULL);
+	obstack_free(&env->obst, NULL);
+	xfree(env->sections);
+	xfree(env->strings);
+	xfree(env->data);
+}
+
+static int import_file(FILE *input, const char *inputname,
+                       const char *only_irg, ir_lto_t *lto)
+{
+	read_env_t          myenv;
+	int                 oldoptimize = get_optimize();
+	read_env_t         *env         = &myenv;
+
+	readers_init();
+	symtbl_init();
+	init_read_env(env, input, inputname);
+	env->lto = lto;
+
+	/* read first character */
+	read_c(env);
+
+	set_optimize(0);
+
+	if (env->c == binary_magic[0]) {
+		env->binary = true;
+		if (read_binary_header(env))
+			read_binary_sections(env, only_irg);
+	} else if (only_irg != NULL) {
+		parse_error(env, "importing single graphs needs the binary format\n");
+	} else {
+		/* if the first line starts with '#', it contains a comment. */
+		if (env->c == '#')
+			skip_to(env, '\n');
+
+		while (true) {
+			skip_ws(env);
+			if (env->c == EOF)
+				break;
+			read_section(env);
+		}
+	}
+
+	finish_program(env);
 
 	set_optimize(oldoptimize);
 
-	obstack_free(&env->preds_obst, NULL);
-	obstack_free(&env->obst, NULL);
+	free_read_env(env);
 
 	pmap_destroy(node_readers);
 	node_readers = NULL;
 
 	return env->read_errors;
 }
+
+int ir_import_file(FILE *input, const char *inputname)
+{
+	return import_file(input, inputname, NULL, NULL);
+}
+
+int ir_import_file_graph(FILE *input, const char *inputname,
+                         const char *ld_name)
+{
+	return import_file(input, inputname, ld_name, NULL);
+}
+
+ir_lto_t *ir_lto_begin(void)
+{
+	ir_lto_t *const lto = XMALLOCZ(ir_lto_t);
+	lto->types = new_set(lto_type_cmp, 256);
+	/* units are merged with the types already in the program, too */
+	for (size_t i = 0, n = get_irp_n_types(); i < n; ++i) {
+		ir_type *const type = get_irp_type(i);
+		if (lto_is_mergeable(type))
+			lto_insert_type(lto, type);
+	}
+	return lto;
+}
+
+int ir_lto_add_file(ir_lto_t *lto, FILE *input, const char *inputname)
+{
+	lto->unit_types = NEW_ARR_F(ir_type*, 0);
+	lto->canonical  = pmap_create();
+	lto->methods    = pmap_create();
+	obstack_init(&lto->obst);
+
+	int const res = import_file(input, inputname, NULL, lto);
+
+	obstack_free(&lto->obst, NULL);
+	pmap_destroy(lto->methods);
+	pmap_destroy(lto->canonical);
+	DEL_ARR_F(lto->unit_types);
+	return res;
+}
+
+int ir_lto_add(ir_lto_t *lto, const char *filename)
+{
+	FILE *file = fopen(filename, "rb");
+	if (file == NULL) {
+		perror(filename);
+		return 1;
+	}
+
+	int res = ir_lto_add_file(lto, file, filename);
+	fclose(file);
+	return res;
+}
+
+void ir_lto_finish(ir_lto_t *lto)
+{
+	del_set(lto->types);
+	xfree(lto);
+}
+
+/** A program imported by ir_import_mmap() with graphs not constructed yet. */
+typedef struct lazy_program_t lazy_program_t;
+
+/** A graph of a program imported by ir_import_mmap(). */
+struct ir_lazy_irg {
+	lazy_program_t *program;
+	ir_entity      *entity;
+	size_t          section; /**< the section holding the graph */
+};
+
+struct lazy_program_t {
+	read_env_t                 env;       /**< the reader state kept between
+	                                           graphs, the ids in particular */
+	ir_prog                   *irp;       /**< the program importing the file */
+	void                      *mapping;
+	size_t                     mapping_size;
+	struct ir_lazy_irg        *irgs;      /**< the graphs in file order */
+	size_t                     n_irgs;
+	size_t                     n_pending; /**< graphs not constructed yet */
+};
+
+static lazy_program_t **lazy_programs;
+static bool             constructing_lazy_irg;
+
+static void free_lazy_program(lazy_program_t *program)
+{
+	free_read_env(&program->env);
+	munmap(program->mapping, program->mapping_size);
+	xfree(program->irgs);
+
+	size_t const n = ARR_LEN(lazy_programs);
+	for (size_t i = 0; i < n; ++i) {
+		if (lazy_programs[i] == program) {
+			lazy_programs[i] = lazy_programs[n - 1];
+			ARR_SHRINKLEN(lazy_programs, n - 1);
+			break;
+		}
+	}
+	xfree(program);
+}
+
+ir_graph *ir_load_lazy_irg(ir_entity *ent)
+{
+	struct ir_lazy_irg *const lazy    = ent->attr.mtd_attr.lazy_irg;
+	lazy_program_t     *const program = lazy->program;
+	if (constructing_lazy_irg)
+		panic("graph of %+F accessed while constructing another graph", ent);
+
+	ent->attr.mtd_attr.lazy_irg = NULL;
+	--program->irp->n_lazy_irgs;
+	--program->n_pending;
+
+	constructing_lazy_irg = true;
+	ir_prog *const old_irp      = get_irp();
+	int      const oldoptimize = get_optimize();
+	set_irp(program->irp);
+	set_optimize(0);
+	readers_init();
+
+	read_binary_section(&program->env, lazy->section);
+
+	pmap_destroy(node_readers);
+	node_readers = NULL;
+	set_optimize(oldoptimize);
+	set_irp(old_irp);
+	constructing_lazy_irg = false;
+
+	if (program->n_pending == 0)
+		free_lazy_program(program);
+	return ent->attr.mtd_attr.irg;
+}
+
+void ir_load_lazy_irgs(void)
+{
+	/* the graph under construction is already part of the program */
+	if (constructing_lazy_irg)
+		return;
+
+	for (size_t i = 0; i < ARR_LEN(lazy_programs);) {
+		lazy_program_t *const program = lazy_programs[i];
+		if (program->irp != irp) {
+			++i;
+			continue;
+		}
+		/* construct in file order, the last one frees the program */
+		for (size_t j = 0;; ++j) {
+			struct ir_lazy_irg *const lazy = &program->irgs[j];
+			if (lazy->entity->attr.mtd_attr.lazy_irg != lazy)
+				continue;
+			bool const last = program->n_pending == 1;
+			ir_load_lazy_irg(lazy->entity);
+			if (last)
+				break;
+		}
+	}
+}
+
+void ir_discard_lazy_irgs(void)
+{
+	if (lazy_programs == NULL)
+		return;
+
+	for (size_t i = ARR_LEN(lazy_programs); i-- > 0;) {
+		lazy_program_t *const program = lazy_programs[i];
+		if (program->irp != irp)
+			continue;
+		for (size_t j = 0; j < program->n_irgs; ++j) {
+			struct ir_lazy_irg *const lazy = &program->irgs[j];
+			if (lazy->entity->attr.mtd_attr.lazy_irg == lazy)
+				lazy->entity->attr.mtd_attr.lazy_irg = NULL;
+		}
+		irp->n_lazy_irgs -= program->n_pending;
+		free_lazy_program(program);
+	}
+}
+
+/**
+ * Reads the sections of a mapped binary file except for the graphs, which
+ * are only recorded at their entities.
+ */
+static void read_lazy_program(lazy_program_t *program)
+{
+	read_env_t          *const env       = &program->env;
+	size_t               const magic_len = sizeof(binary_magic) - 1;
+	unsigned char const *const data      = (unsigned char const*)program->mapping;
+	if (data[magic_len] != BINARY_VERSION) {
+		parse_error(env, "not a firm file of binary version %d\n",
+		            BINARY_VERSION);
+		return;
+	}
+	if (!read_binary_tables(env, data + magic_len + 1,
+	                        program->mapping_size - magic_len - 1))
+		return;
+
+	program->irgs = XMALLOCN(struct ir_lazy_irg, env->n_sections);
+	for (size_t i = 0; i < env->n_sections; ++i) {
+		if (!is_irg_section(env, i)) {
+			read_binary_section(env, i);
+			continue;
+		}
+
+		ir_entity *const entity = (ir_entity*)get_id(env, env->sections[i].nr);
+		if (entity == NULL || !is_method_entity(entity)
+		    || entity->attr.mtd_attr.irg != NULL
+		    || entity->attr.mtd_attr.lazy_irg != NULL) {
+			parse_error(env, "invalid graph section %zu\n", i);
+			continue;
+		}
+		struct ir_lazy_irg *const lazy = &program->irgs[program->n_irgs++];
+		lazy->program  = program;
+		lazy->entity   = entity;
+		lazy->section  = i;
+		entity->attr.mtd_attr.lazy_irg = lazy;
+	}
+	program->n_pending = program->n_irgs;
+	irp->n_lazy_irgs  += program->n_irgs;
+}
+
+int ir_import_mmap(const char *filename)
+{
+	int const fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		perror(filename);
+		return 1;
+	}
+	size_t const magic_len = sizeof(binary_magic) - 1;
+	void        *mapping   = MAP_FAILED;
+	struct stat  st;
+	if (fstat(fd, &st) == 0 && (size_t)st.st_size > magic_len)
+		mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	/* the textual format is imported right away */
+	if (mapping == MAP_FAILED)
+		return ir_import(filename);
+	if (memcmp(mapping, binary_magic, magic_len) != 0) {
+		munmap(mapping, st.st_size);
+		return ir_import(filename);
+	}
+
+	lazy_program_t *const program = XMALLOCZ(lazy_program_t);
+	read_env_t     *const env     = &program->env;
+	program->irp          = irp;
+	program->mapping      = mapping;
+	program->mapping_size = st.st_size;
+	init_read_env(env, NULL, NULL);
+	env->inputname = (char*)obstack_copy0(&env->obst, filename, strlen(filename));
+	env->binary    = true;
+
+	int const oldoptimize = get_optimize();
+	readers_init();
+	symtbl_init();
+	set_optimize(0);
+
+	read_lazy_program(program);
+	finish_program(env);
+
+	set_optimize(oldoptimize);
+	pmap_destroy(node_readers);
+	node_readers = NULL;
+
+	int const res = env->read_errors;
+	if (program->n_pending == 0) {
+		free_read_env(env);
+		munmap(mapping, st.st_size);
+		xfree(program->irgs);
+		xfree(program);
+	} else {
+		if (lazy_programs == NULL)
+			lazy_programs = NEW_ARR_F(lazy_program_t*, 0);
+		ARR_APP1(lazy_program_t*, lazy_programs, program);
+	}
+	return res;
+}
@@ -3,9 +3,11 @@
 
 #include <stdio.h>
 
+#include "irio.h"
 #include "irnode_t.h"
 #include "obst.h"
 #include "pdeq.h"
+#include "pmap.h"
 #include "set.h"
 #include "type_t.h"
 #include "typerep.h"
@@ -21,13 +23,36 @@ typedef struct delayed_pred_t {
 	long     preds[];
 } delayed_pred_t;
 
+/** A top-level section of the binary format. */
+typedef struct binary_section_t {
+	size_t keyword; /**< string table index of the section keyword */
+	long   nr;      /**< entity number of an irg section, 0 otherwise */
+	size_t begin;   /**< offset of the section in the token stream */
+	size_t end;     /**< offset behind the section in the token stream */
+} binary_section_t;
+
 typedef struct read_env_t {
-	int            c;           /**< currently read char */
+	int            c;           /**< currently read char, in the binary format
+	                                 the char the current token starts with */
 	FILE          *file;
 	const char    *inputname;
 	unsigned       line;
 
+	bool                 binary;       /**< reading the binary format */
+	unsigned char       *data;         /**< contents of a binary file */
+	const unsigned char *pos;          /**< position in the token stream */
+	const unsigned char *end;          /**< end of the current section */
+	const unsigned char *tokens;       /**< begin of the token stream */
+	char               **strings;      /**< string table */
+	size_t               n_strings;
+	binary_section_t    *sections;
+	size_t               n_sections;
+	int                  token;        /**< tag of the current token */
+	long                 token_number; /**< value of a number token */
+	const char          *token_string; /**< value of a word or string token */
+
 	ir_graph      *irg;
+	ir_lto_t      *lto;         /**< merge state when merging units */
 	set           *idset;       /**< id_entry set, which maps from file ids to
 	                                 new Firm elements */
 	ir_type      **fixedtypes;
@@ -42,6 +67,12 @@ typedef struct write_env_t {
 	FILE *file;
 	pdeq *write_queue;
 	pdeq *entity_queue;
+
+	bool               binary;       /**< write the binary format */
+	struct obstack     tokens;       /**< token stream of the binary format */
+	pmap              *string_index; /**< ident -> string table index + 1 */
+	ident            **strings;      /**< string table of the binary format */
+	binary_section_t  *sections;     /**< top-level sections */
 } write_env_t;
 
 void write_align(write_env_t *env, ir_align align);
@@ -0,0 +1,138 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Accounting of the memory held by graphs.
+ */
+#include "array.h"
+#include "beirg.h"
+#include "belive.h"
+#include "irdom_t.h"
+#include "irgraph_t.h"
+#include "irmemory_t.h"
+#include "irprog_t.h"
+#include "irvaluetable.h"
+#include "pmap.h"
+
+/** Returns the bytes allocated for the flexible array @p arr. */
+static size_t arr_f_bytes(void const *const arr, size_t const elt_size)
+{
+	if (arr == NULL)
+		return 0;
+	return ARR_ELTS_OFFS + ARR_DESCR(arr)->allocated * elt_size;
+}
+
+#define ARR_F_BYTES(arr) arr_f_bytes((arr), sizeof(*(arr)))
+
+/** Returns the bytes of the bucket array of a hashset.c.h instantiation. */
+#define HASHSET_BYTES(set) ((set)->num_buckets * sizeof(*(set)->entries))
+
+static size_t outs_bytes(ir_outs_info const *const outs)
+{
+	return outs->start_size * sizeof(*outs->start)
+	     + outs->edges_size * sizeof(*outs->edges);
+}
+
+static size_t analyses_bytes(ir_graph *const irg)
+{
+	size_t bytes = 0;
+	if (irg->value_table != NULL)
+		bytes += sizeof(*irg->value_table) + HASHSET_BYTES(irg->value_table);
+	if (irg->domfront.df_map != NULL) {
+		bytes += pmap_memory_used(irg->domfront.df_map)
+		       + obstack_memory_used(&irg->domfront.obst);
+	}
+	if (irg->bitinfo.map.data != NULL) {
+		bytes += ARR_F_BYTES(irg->bitinfo.map.data)
+		       + ARR_F_BYTES(irg->bitinfo.replaced)
+		       + obstack_memory_used(&irg->bitinfo.obst);
+	}
+	if (irg->vrp.infos.data != NULL) {
+		bytes += ARR_F_BYTES(irg->vrp.infos.data)
+		       + obstack_memory_used(&irg->vrp.obst);
+	}
+	bytes += get_alias_cache_memory_used(irg);
+	bytes += get_memssa_memory_used(irg);
+	bytes += ARR_F_BYTES(irg->walk_cache.nodes);
+	bytes += ARR_F_BYTES(irg->walk_cache.blocks);
+	bytes += ARR_F_BYTES(irg->callers);
+	bytes += ARR_F_BYTES(irg->callees);
+	return bytes;
+}
+
+static size_t liveness_bytes(be_lv_t *const lv)
+{
+	if (lv == NULL)
+		return 0;
+	if (!lv->sets_valid)
+		return sizeof(*lv);
+	/* the marked nodeset keeps a control byte per bucket */
+	return sizeof(*lv) + HASHSET_BYTES(&lv->map)
+	     + HASHSET_BYTES(&lv->marked) + lv->marked.num_buckets
+	     + obstack_memory_used(&lv->obst);
+}
+
+const char *get_ir_memory_category_name(ir_memory_category_t category)
+{
+	switch (category) {
+	case IR_MEMORY_NODES:    return "nodes";
+	case IR_MEMORY_EDGES:    return "edges";
+	case IR_MEMORY_OUTS:     return "outs";
+	case IR_MEMORY_ANALYSES: return "analyses";
+	case IR_MEMORY_BACKEND:  return "backend";
+	case IR_MEMORY_LIVENESS: return "liveness";
+	}
+	return "<unknown>";
+}
+
+void ir_graph_memory_usage(ir_graph *irg, ir_memory_usage_t *usage)
+{
+	size_t *const bytes = usage->bytes;
+	bytes[IR_MEMORY_NODES] = sizeof(*irg) + obstack_memory_used(&irg->obst)
+	                       + ARR_F_BYTES(irg->idx_irn_map);
+
+	bytes[IR_MEMORY_EDGES] = 0;
+	for (ir_edge_kind_t kind = EDGE_KIND_FIRST; kind <= EDGE_KIND_LAST; ++kind) {
+		irg_edge_info_t *const info = &irg->edge_info[kind];
+		if (info->allocated)
+			bytes[IR_MEMORY_EDGES] += obstack_memory_used(&info->edges_obst);
+	}
+
+	bytes[IR_MEMORY_OUTS]     = outs_bytes(&irg->outs)
+	                          + outs_bytes(&irg->block_outs);
+	bytes[IR_MEMORY_ANALYSES] = analyses_bytes(irg);
+
+	be_irg_t *const birg = be_birg_from_irg(irg);
+	if (birg != NULL) {
+		bytes[IR_MEMORY_BACKEND]  = sizeof(*birg)
+		                          + obstack_memory_used(&birg->obst);
+		bytes[IR_MEMORY_LIVENESS] = liveness_bytes(birg->lv);
+	} else {
+		bytes[IR_MEMORY_BACKEND]  = 0;
+		bytes[IR_MEMORY_LIVENESS] = 0;
+	}
+}
+
+size_t ir_memory_usage_total(const ir_memory_usage_t *usage)
+{
+	size_t total = 0;
+	for (ir_memory_category_t c = IR_MEMORY_FIRST; c <= IR_MEMORY_LAST; ++c) {
+		total += usage->bytes[c];
+	}
+	return total;
+}
+
+void ir_program_memory_usage(ir_memory_usage_t *usage)
+{
+	ir_graph_memory_usage(get_const_code_irg(), usage);
+	foreach_irp_irg(i, irg) {
+		ir_memory_usage_t irg_usage;
+		ir_graph_memory_usage(irg, &irg_usage);
+		for (ir_memory_category_t c = IR_MEMORY_FIRST; c <= IR_MEMORY_LAST; ++c) {
+			usage->bytes[c] += irg_usage.bytes[c];
+		}
+	}
+}
@@ -34,6 +34,9 @@ static bool modes_are_equal(const ir_mode *m, const ir_mode *n)
 		return false;
 	if (m->sort == irms_auxiliary || m->sort == irms_data)
 		return streq(m->name, n->name);
+	if (m->sort == irms_vector)
+		return m->vector_element == n->vector_element
+		    && m->vector_lanes   == n->vector_lanes;
 	return m->arithmetic        == n->arithmetic
 	    && m->size              == n->size
 	    && m->sign              == n->sign
@@ -207,6 +210,23 @@ ir_mode *new_non_arithmetic_mode(const char *name, unsigned bit_size)
 	return register_mode(result);
 }
 
+ir_mode *new_vector_mode(const char *name, ir_mode *element_mode,
+                          unsigned n_lanes)
+{
+	if (!mode_is_int(element_mode) && !mode_is_float(element_mode))
+		panic("vector element mode %F is not a number mode", element_mode);
+	if (n_lanes < 2)
+		panic("vector modes need at least 2 lanes");
+	unsigned const bit_size = get_mode_size_bits(element_mode) * n_lanes;
+	if (bit_size >= (unsigned)sc_get_precision())
+		panic("cannot create mode: more bits than tarval module maximum");
+
+	ir_mode *result = alloc_mode(name, irms_vector, irma_none, bit_size, 0, 0);
+	result->vector_element = element_mode;
+	result->vector_lanes   = n_lanes;
+	return register_mode(result);
+}
+
 static ir_mode *new_non_data_mode(const char *name)
 {
 	ir_mode *result = alloc_mode(name, irms_auxiliary, irma_none, 0, 0, 0);
@@ -311,6 +331,11 @@ int (mode_is_data)(const ir_mode *mode)
 	return mode_is_data_(mode);
 }
 
+int (mode_is_vector)(const ir_mode *mode)
+{
+	return mode_is_vector_(mode);
+}
+
 unsigned (get_mode_mantissa_size)(const ir_mode *mode)
 {
 	return get_mode_mantissa_size_(mode);
@@ -321,6 +346,18 @@ unsigned (get_mode_exponent_size)(const ir_mode *mode)
 	return get_mode_exponent_size_(mode);
 }
 
+ir_mode *(get_mode_vector_element_mode)(const ir_mode *mode)
+{
+	assert(mode_is_vector(mode));
+	return get_mode_vector_element_mode_(mode);
+}
+
+unsigned (get_mode_vector_n_lanes)(const ir_mode *mode)
+{
+	assert(mode_is_vector(mode));
+	return get_mode_vector_n_lanes_(mode);
+}
+
 float_int_conversion_overflow_style_t get_mode_float_int_overflow(
 		const ir_mode *mode)
 {
@@ -362,6 +399,7 @@ int smaller_mode(const ir_mode *sm, const ir_mode *lm)
 		case irms_internal_boolean:
 		case irms_reference:
 		case irms_float_number:
+		case irms_vector:
 			/* int to float works if the float is large enough */
 			return false;
 		}
@@ -376,6 +414,7 @@ int smaller_mode(const ir_mode *sm, const ir_mode *lm)
 	case irms_data:
 	case irms_internal_boolean:
 	case irms_reference:
+	case irms_vector:
 		/* do exist machines out there with different pointer lengths ?*/
 		return false;
 	}
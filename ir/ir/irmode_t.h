@@ -30,9 +30,12 @@
 #define mode_is_reference(mode)        mode_is_reference_(mode)
 #define mode_is_num(mode)              mode_is_num_(mode)
 #define mode_is_data(mode)             mode_is_data_(mode)
+#define mode_is_vector(mode)           mode_is_vector_(mode)
 #define get_type_for_mode(mode)        get_type_for_mode_(mode)
 #define get_mode_mantissa_size(mode)   get_mode_mantissa_size_(mode)
 #define get_mode_exponent_size(mode)   get_mode_exponent_size_(mode)
+#define get_mode_vector_element_mode(mode) get_mode_vector_element_mode_(mode)
+#define get_mode_vector_n_lanes(mode)  get_mode_vector_n_lanes_(mode)
 
 /** Helper values for ir_mode_sort. */
 enum ir_mode_sort_helper {
@@ -50,6 +53,7 @@ typedef enum ir_mode_sort {
 	irms_reference        = 3 | irmsh_is_data,
 	irms_int_number       = 4 | irmsh_is_data | irmsh_is_num,
 	irms_float_number     = 5 | irmsh_is_data | irmsh_is_num,
+	irms_vector           = 6 | irmsh_is_data,
 } ir_mode_sort;
 
 /**
@@ -89,9 +93,14 @@ struct ir_mode {
 	ir_tarval          *one;       /**< The value 1 */
 	ir_tarval          *all_one;   /**< The value where all bits are set */
 	ir_tarval          *infinity;  /**< The (positive) infinity value */
+	/** Preallocated tarvals for small integral values, see tv.c */
+	ir_tarval         **small_values;
 	/** For reference modes, a signed integer mode used to add/subtract
 	 * offsets. */
 	ir_mode            *offset_mode;
+	/** For vector modes, the mode of a single lane. */
+	ir_mode            *vector_element;
+	unsigned           vector_lanes; /**< For vector modes, number of lanes */
 };
 
 static inline ident *get_mode_ident_(const ir_mode *mode)
@@ -156,6 +165,11 @@ static inline int mode_is_data_(const ir_mode *mode)
 	return (get_mode_sort(mode) & irmsh_is_data) != 0;
 }
 
+static inline int mode_is_vector_(const ir_mode *mode)
+{
+	return get_mode_sort(mode) == irms_vector;
+}
+
 static inline ir_type *get_type_for_mode_(const ir_mode *mode)
 {
 	return mode->type;
@@ -171,6 +185,16 @@ static inline unsigned get_mode_exponent_size_(const ir_mode *mode)
 	return mode->float_desc.exponent_size;
 }
 
+static inline ir_mode *get_mode_vector_element_mode_(const ir_mode *mode)
+{
+	return mode->vector_element;
+}
+
+static inline unsigned get_mode_vector_n_lanes_(const ir_mode *mode)
+{
+	return mode->vector_lanes;
+}
+
 /** mode module initialization, call once before use of any other function **/
 void init_mode(void);
 
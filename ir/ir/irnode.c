@@ -21,7 +21,7 @@
 #include "irprog_t.h"
 #include "iredgekinds.h"
 #include "iredges_t.h"
-#include "ircons.h"
+#include "ircons_t.h"
 #include "irprintf.h"
 #include "panic.h"
 #include "irverify.h"
@@ -75,13 +75,48 @@ ir_relation get_inversed_relation(ir_relation relation)
 	return code;
 }
 
-ir_node *new_ir_node(dbg_info *db, ir_graph *irg, ir_node *block, ir_op *op,
-                     ir_mode *mode, int arity, ir_node *const *in)
+/** Rounds @p size up to the alignment of arbitrary data. */
+static size_t round_up_aligned(size_t const size)
 {
-	assert(mode != NULL);
+	return (size + sizeof(aligned_type) - 1)
+	     / sizeof(aligned_type) * sizeof(aligned_type);
+}
+
+/** Returns whether nodes of @p op with @p arity inputs keep their in array
+ * directly behind the attributes. */
+static bool has_inline_in(ir_op const *const op, int const arity)
+{
+	return arity >= 0 && op->opar != oparity_dynamic;
+}
+
+/** Returns the offset of the inline in array of nodes of @p op. */
+static size_t get_inline_in_offset(ir_op const *const op)
+{
+	size_t const attr_end = offsetof(ir_node, attr) + op->attr_size;
+	return round_up_aligned(attr_end);
+}
 
-	size_t   const node_size = offsetof(ir_node, attr) + op->attr_size;
-	ir_node *const res       = (ir_node*)OALLOCNZ(get_irg_obstack(irg), char, node_size);
+/** Returns the number of bytes allocated for a node of @p op with @p arity
+ * inputs. */
+static size_t get_node_size(ir_op const *const op, int const arity)
+{
+	/* Nodes with a fixed arity keep their in array directly behind the
+	 * attributes, so creating them needs a single allocation and the operands
+	 * are always adjacent to the node. */
+	if (has_inline_in(op, arity))
+		return get_inline_in_offset(op) + sizeof(ir_arr_descr)
+		     + (arity + 1) * sizeof(ir_node*);
+	return offsetof(ir_node, attr) + op->attr_size;
+}
+
+/** Initializes the zeroed memory of node @p res without announcing it to
+ * the edges and hooks. */
+static void init_ir_node(ir_node *const res, dbg_info *const db,
+                         ir_graph *const irg, ir_node *const block,
+                         ir_op *const op, ir_mode *const mode, int const arity,
+                         ir_node *const *const in)
+{
+	assert(mode != NULL);
 
 	res->kind     = k_ir_node;
 	res->op       = op;
@@ -93,10 +128,10 @@ ir_node *new_ir_node(dbg_info *db, ir_graph *irg, ir_node *block, ir_op *op,
 		res->in = NEW_ARR_F(ir_node *, 1);  /* 1: space for block */
 	} else {
 		/* Nodes with dynamic arity must always have a flexible array. */
-		if (op->opar == oparity_dynamic)
-			res->in = NEW_ARR_F(ir_node *, (arity+1));
+		if (has_inline_in(op, arity))
+			res->in = (ir_node**)ir_init_arr_d((char*)res + get_inline_in_offset(op), arity + 1);
 		else
-			res->in = NEW_ARR_D(ir_node*, get_irg_obstack(irg), arity + 1);
+			res->in = NEW_ARR_F(ir_node *, arity + 1);
 		MEMCPY(&res->in[1], in, arity);
 	}
 
@@ -109,21 +144,81 @@ ir_node *new_ir_node(dbg_info *db, ir_graph *irg, ir_node *block, ir_op *op,
 		/* Edges will be built immediately. */
 		res->edge_info[i].edges_built = 1;
 		res->edge_info[i].out_count = 0;
+		res->edge_info[i].n_in_edges = 0;
+		res->edge_info[i].in_edges   = NULL;
 	}
+}
 
+/** Notifies the edges and hooks about the new node @p res. */
+static void announce_new_node(ir_node *const res)
+{
+	ir_graph *const irg   = get_irn_irg(res);
+	ir_node  *const block = res->in[0];
 	/* don't put this into the for loop, arity is -1 for some nodes! */
 	if (block != NULL)
 		edges_notify_edge(res, -1, block, NULL, irg);
-	for (int i = 0; i < arity; ++i)
+	for (int i = 0, arity = get_irn_arity(res); i < arity; ++i)
 		edges_notify_edge(res, i, res->in[i+1], NULL, irg);
 
 	hook_new_node(res);
 	if (irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_BACKEND))
 		be_info_new_node(irg, res);
+}
 
+ir_node *new_ir_node(dbg_info *db, ir_graph *irg, ir_node *block, ir_op *op,
+                     ir_mode *mode, int arity, ir_node *const *in)
+{
+	size_t   const node_size = get_node_size(op, arity);
+	ir_node *const res = (ir_node*)OALLOCNZ(get_irg_obstack(irg), char, node_size);
+	init_ir_node(res, db, irg, block, op, mode, arity, in);
+	announce_new_node(res);
 	return res;
 }
 
+void new_ir_nodes(ir_graph *const irg, size_t const n_nodes,
+                  ir_node_desc const *const descs, ir_node **const nodes)
+{
+	/* Place all nodes in one allocation, so that operands referring to later
+	 * nodes of the batch can be resolved before the nodes are initialized. */
+	size_t *const offsets   = XMALLOCN(size_t, n_nodes);
+	size_t        total     = 0;
+	int           max_arity = 0;
+	for (size_t i = 0; i < n_nodes; ++i) {
+		ir_node_desc const *const desc = &descs[i];
+		if (desc->op == NULL)
+			continue;
+		offsets[i] = total;
+		total     += round_up_aligned(get_node_size(desc->op, desc->arity));
+		max_arity  = MAX(max_arity, desc->arity);
+	}
+	char *const memory = OALLOCNZ(get_irg_obstack(irg), char, total);
+	for (size_t i = 0; i < n_nodes; ++i) {
+		if (descs[i].op != NULL)
+			nodes[i] = (ir_node*)(memory + offsets[i]);
+	}
+
+	ir_node **const in = XMALLOCN(ir_node*, MAX(max_arity, 1));
+	for (size_t i = 0; i < n_nodes; ++i) {
+		ir_node_desc const *const desc = &descs[i];
+		if (desc->op == NULL)
+			continue;
+		for (int n = 0; n < desc->arity; ++n) {
+			assert((size_t)desc->in[n] < n_nodes);
+			in[n] = nodes[desc->in[n]];
+		}
+		ir_node *const block = desc->block < 0 ? NULL : nodes[desc->block];
+		init_ir_node(nodes[i], desc->dbgi, irg, block, desc->op, desc->mode,
+		             desc->arity, in);
+	}
+	xfree(in);
+	xfree(offsets);
+
+	for (size_t i = 0; i < n_nodes; ++i) {
+		if (descs[i].op != NULL)
+			announce_new_node(nodes[i]);
+	}
+}
+
 ir_node *new_similar_node(ir_node *const old, ir_node *const block, ir_node **const in)
 {
 	dbg_info *const dbgi  = get_irn_dbg_info(old);
@@ -141,6 +236,23 @@ int (get_irn_arity)(const ir_node *node)
 	return get_irn_arity_(node);
 }
 
+/**
+ * Returns the outs properties invalidated by changing input n of node.  Only
+ * changes to blocks, End and control flow nodes affect the control flow
+ * successors of the blocks.
+ */
+static ir_graph_properties_t get_changed_outs(const ir_node *node, int n)
+{
+	ir_graph_properties_t const outs = IR_GRAPH_PROPERTY_CONSISTENT_OUTS;
+	if (is_Block(node) || is_End(node))
+		return outs | IR_GRAPH_PROPERTY_CONSISTENT_BLOCK_OUTS;
+	ir_mode *const mode = get_irn_mode(node);
+	if ((mode == mode_X && (n < 0 || is_Proj(node)))
+	    || (mode == mode_T && n < 0))
+		return outs | IR_GRAPH_PROPERTY_CONSISTENT_BLOCK_OUTS;
+	return outs;
+}
+
 void set_irn_in(ir_node *const node, int const arity, ir_node *const *const in)
 {
 	assert(node != NULL && node->kind == k_ir_node);
@@ -174,7 +286,7 @@ void set_irn_in(ir_node *const node, int const arity, ir_node *const *const in)
 	MEMCPY(*pOld_in + 1, in, arity);
 
 	/* update irg flags */
-	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUTS | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+	clear_irg_properties(irg, get_changed_outs(node, 0) | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
 }
 
 ir_node *(get_irn_n)(const ir_node *node, int n)
@@ -197,7 +309,7 @@ void set_irn_n(ir_node *node, int n, ir_node *in)
 	node->in[n + 1] = in;
 
 	/* update irg flags */
-	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUTS | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+	clear_irg_properties(irg, get_changed_outs(node, n) | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
 }
 
 int add_irn_n(ir_node *node, ir_node *in)
@@ -210,7 +322,7 @@ int add_irn_n(ir_node *node, ir_node *in)
 	edges_notify_edge(node, pos, node->in[pos + 1], NULL, irg);
 
 	/* update irg flags */
-	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUTS);
+	clear_irg_properties(irg, get_changed_outs(node, pos));
 
 	return pos;
 }
@@ -232,7 +344,7 @@ static void remove_irn_n(ir_node *node, int n)
 	ARR_SHRINKLEN(node->in, arity);
 
 	/* update irg flags */
-	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUTS);
+	clear_irg_properties(irg, get_changed_outs(node, n));
 }
 
 void remove_Sync_n(ir_node *n, int i)
@@ -460,7 +572,7 @@ void set_End_keepalives(ir_node *end, int n, ir_node *in[])
 	}
 
 	/* update irg flags */
-	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUTS);
+	clear_irg_properties(irg, get_changed_outs(end, 0));
 }
 
 void remove_End_n(ir_node *n, int idx)
@@ -521,7 +633,7 @@ void remove_End_Bads_and_doublets(ir_node *end)
 	pset_new_destroy(&keeps);
 
 	if (changed)
-		clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUTS);
+		clear_irg_properties(irg, get_changed_outs(end, 0));
 }
 
 void free_End(ir_node *end)
@@ -85,18 +85,26 @@ struct ir_switch_table {
 	ir_switch_table_entry entries[];
 };
 
+/** Sparse map of the construction values of a block, see ircons.c. */
+typedef struct ir_value_map_t ir_value_map_t;
+
 /** Attributes for Block nodes. */
 typedef struct block_attr {
 	ir_visited_t block_visited; /**< Visited flag for block walker. */
 	unsigned    is_matured : 1; /**< If set, all inputs are fixed. */
 	unsigned    dynamic_ins: 1; /**< If set in-array is an ARR_F on the heap. */
 	unsigned    marked     : 1; /**< Can be used to temporary mark the block. */
-	ir_node   **graph_arr;      /**< An array to store construction values. */
+	/** Construction values, a sparse map if the graph has many locals. */
+	union {
+		ir_node        **graph_arr; /**< An array of construction values. */
+		ir_value_map_t  *value_map; /**< A map of construction values. */
+	} values;
 	ir_dom_info dom;            /**< Information about dominators. */
 	ir_dom_info pdom;           /**< Information about post-dominators. */
 	bitset_t   *backedge;       /**< Bit n set to true if pred n is backedge.*/
 	ir_entity  *entity;         /**< entity representing this block */
 	ir_node    *phis;           /**< The list of Phi nodes in this block. */
+	ir_loop    *loop;           /**< The innermost loop of this block. */
 	double      execfreq;       /**< block execution frequency */
 } block_attr;
 
@@ -274,6 +282,9 @@ typedef struct irn_edge_kind_info_t {
 	struct list_head outs_head;  /**< The list of all outs. */
 	unsigned edges_built : 1;    /**< Set edges where built for this node. */
 	unsigned out_count   : 31;   /**< Number of outs in the list. */
+	unsigned n_in_edges;         /**< Length of the in_edges array. */
+	ir_edge_t **in_edges;        /**< The edges from this node to its operands,
+	                                  indexed by position + 1. */
 } irn_edge_info_t;
 
 typedef irn_edge_info_t irn_edges_info_t[EDGE_KIND_LAST+1];
@@ -286,11 +297,6 @@ typedef struct ir_def_use_edge {
 	int     pos;             /** The position of this edge in use's input array. */
 } ir_def_use_edge;
 
-typedef struct ir_def_use_edges {
-	unsigned        n_edges;
-	ir_def_use_edge edges[];
-} ir_def_use_edges;
-
 /**
  * Data of a function graph node.
  */
@@ -308,12 +314,6 @@ struct ir_node {
 	dbg_info        *dbi;      /**< Information for debug support. */
 	long             node_nr;  /**< Globally unique node number. */
 
-	union {
-		ir_def_use_edges *out;    /**< array of def-use edges. */
-		unsigned          n_outs; /**< number of def-use edges (temporarily used
-		                               during construction of data structure) */
-	} o;
-	ir_loop         *loop;         /**< Loop information. */
 	void            *backend_info;
 	irn_edges_info_t edge_info;    /**< Everlasting out edges. */
 
@@ -19,6 +19,7 @@
 #include "array.h"
 #include "irnode_t.h"
 #include "irgraph_t.h"
+#include "xmalloc.h"
 
 /**
  * Allocate and initialize a new nodemap object
@@ -103,4 +104,133 @@ static inline void *ir_nodemap_get_fast(const ir_nodemap *nodemap,
 	return nodemap->data[idx];
 }
 
+/*
+ * A nodemap variant where every entry carries a generation stamp. Entries
+ * whose stamp differs from the generation of the map are considered empty,
+ * so clearing the map is O(1) instead of proportional to the number of nodes
+ * in the graph. Entries have a fixed size and are stored inline.
+ */
+
+/**
+ * Makes sure the generation map has space for node indices below @p n.
+ * New entries are marked stale.
+ */
+static inline void ir_nodegenmap_reserve(ir_nodegenmap *map, unsigned n)
+{
+	size_t len = ARR_LEN(map->stamps);
+	if (n <= len)
+		return;
+	n += n / 4;
+	ARR_RESIZE(unsigned, map->stamps, n);
+	memset(map->stamps + len, 0, (n - len) * sizeof(map->stamps[0]));
+	map->data = XREALLOC(map->data, char, n * map->elem_size);
+}
+
+/**
+ * Initialize a generation map with entries of @p elem_size bytes.
+ *
+ * @param irg        The graph the map will run on.
+ * @param elem_size  The size of a single entry.
+ */
+static inline void ir_nodegenmap_init(ir_nodegenmap *map, const ir_graph *irg,
+                                      size_t elem_size)
+{
+	unsigned max_idx = get_irg_last_idx(irg) + 32;
+	map->stamps     = NEW_ARR_FZ(unsigned, max_idx);
+	map->data       = XMALLOCN(char, max_idx * elem_size);
+	map->elem_size  = elem_size;
+	map->generation = 1;
+}
+
+/**
+ * Frees all internal memory used by the generation map but does not free
+ * the map struct itself.
+ */
+static inline void ir_nodegenmap_destroy(ir_nodegenmap *map)
+{
+	DEL_ARR_F(map->stamps);
+	xfree(map->data);
+	map->stamps = NULL;
+	map->data   = NULL;
+}
+
+/**
+ * Removes all mappings and prepares the map for use on @p irg.
+ * This is O(1) unless the graph has grown or the generation counter
+ * wraps around.
+ */
+static inline void ir_nodegenmap_clear(ir_nodegenmap *map, const ir_graph *irg)
+{
+	if (++map->generation == 0) {
+		memset(map->stamps, 0, ARR_LEN(map->stamps) * sizeof(map->stamps[0]));
+		map->generation = 1;
+	}
+	ir_nodegenmap_reserve(map, get_irg_last_idx(irg));
+}
+
+/**
+ * Returns the entry for @p node or NULL if nothing is mapped.
+ */
+static inline void *ir_nodegenmap_find(const ir_nodegenmap *map,
+                                       const ir_node *node)
+{
+	unsigned idx = get_irn_idx(node);
+	if (idx >= ARR_LEN(map->stamps) || map->stamps[idx] != map->generation)
+		return NULL;
+	return map->data + idx * map->elem_size;
+}
+
+/**
+ * Returns the entry for @p node, creating a zero initialized one if nothing
+ * is mapped yet.
+ */
+static inline void *ir_nodegenmap_insert(ir_nodegenmap *map,
+                                         const ir_node *node)
+{
+	unsigned idx = get_irn_idx(node);
+	ir_nodegenmap_reserve(map, idx + 1);
+	char *entry = map->data + idx * map->elem_size;
+	if (map->stamps[idx] != map->generation) {
+		map->stamps[idx] = map->generation;
+		memset(entry, 0, map->elem_size);
+	}
+	return entry;
+}
+
+/**
+ * Removes the mapping for @p node.
+ */
+static inline void ir_nodegenmap_remove(ir_nodegenmap *map,
+                                        const ir_node *node)
+{
+	unsigned idx = get_irn_idx(node);
+	if (idx < ARR_LEN(map->stamps))
+		map->stamps[idx] = 0;
+}
+
+/**
+ * Defines typed accessors ir_nodegenmap_get_NAME() and
+ * ir_nodegenmap_set_NAME() for entries of type @p type. Getting the entry
+ * of an unmapped node returns 0.
+ */
+#define IR_NODEGENMAP_ACCESSORS(name, type) \
+	static inline type ir_nodegenmap_get_##name(const ir_nodegenmap *map, \
+	                                            const ir_node *node) \
+	{ \
+		assert(map->elem_size == sizeof(type)); \
+		type const *entry = (type const*)ir_nodegenmap_find(map, node); \
+		return entry != NULL ? *entry : (type)0; \
+	} \
+	static inline void ir_nodegenmap_set_##name(ir_nodegenmap *map, \
+	                                            const ir_node *node, \
+	                                            type value) \
+	{ \
+		assert(map->elem_size == sizeof(type)); \
+		*(type*)ir_nodegenmap_insert(map, node) = value; \
+	}
+
+IR_NODEGENMAP_ACCESSORS(node,     ir_node*)
+IR_NODEGENMAP_ACCESSORS(unsigned, unsigned)
+IR_NODEGENMAP_ACCESSORS(double,   double)
+
 #endif
@@ -11,8 +11,17 @@
 #ifndef FIRM_IRNODEMAP_T_H
 #define FIRM_IRNODEMAP_T_H
 
+#include <stddef.h>
+
 typedef struct ir_nodemap {
 	void **data;
 } ir_nodemap;
 
+typedef struct ir_nodegenmap {
+	unsigned *stamps;     /**< generation of each entry (ARR_F) */
+	char     *data;       /**< the entries, elem_size bytes each */
+	size_t    elem_size;  /**< size of a single entry */
+	unsigned  generation; /**< current generation, never 0 */
+} ir_nodegenmap;
+
 #endif
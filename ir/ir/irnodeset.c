@@ -15,6 +15,7 @@
 #include "hashptr.h"
 
 #define DO_REHASH
+#define GROUP_PROBING
 #define ID_HASH
 #define HashSet                   ir_nodeset_t
 #define HashSetIterator           ir_nodeset_iterator_t
@@ -23,9 +23,11 @@
 #define HashSetIterator  ir_nodeset_iterator_t
 #define ValueType        ir_node*
 #define DO_REHASH
+#define GROUP_PROBING
 
 #include "hashset.h"
 
+#undef GROUP_PROBING
 #undef DO_REHASH
 #undef ValueType
 #undef HashSetIterator
@@ -74,7 +76,7 @@ static inline ir_nodeset_t *ir_nodeset_new(size_t expected_elements) {
  */
 static inline void ir_nodeset_del(ir_nodeset_t *nodeset) {
 	ir_nodeset_destroy(nodeset);
-	free(nodeset);
+	xfree(nodeset);
 }
 
 /**
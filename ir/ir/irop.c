@@ -88,7 +88,7 @@ void free_ir_op(ir_op *code)
 	assert(opcodes[code->code] == code);
 	opcodes[code->code] = NULL;
 
-	free(code);
+	xfree(code);
 }
 
 unsigned ir_get_n_opcodes(void)
@@ -10,40 +10,50 @@
  * @date        06.04.2006, 11.11.2010
  */
 
+#include <math.h>
+
 #include "util.h"
+#include "array.h"
+#include "dbginfo.h"
 #include "debug.h"
 #include "execfreq_t.h"
 #include "hashptr.h"
 #include "ident_t.h"
 #include "ircons_t.h"
 #include "irdump_t.h"
+#include "irgopt.h"
 #include "irgwalk.h"
 #include "irnode_t.h"
 #include "irprofile.h"
 #include "irprog_t.h"
 #include "obst.h"
+#include "pmap.h"
 #include "set.h"
 #include "typerep.h"
 #include "xmalloc.h"
 
-/* Instrument blocks walker. */
-typedef struct block_id_walker_data_t {
-	unsigned int  id;       /**< current block id number */
-	ir_node      *counters; /**< the node representing the counter array */
-} block_id_walker_data_t;
-
-/* Associate counters with blocks. */
-typedef struct block_assoc_t {
-	unsigned int i;          /**< current block id number */
-	unsigned int *counters;  /**< block execution counts */
-} block_assoc_t;
-
 /* minimal execution frequency (an execfreq of 0 confuses algos) */
 #define MIN_EXECFREQ 0.00001
 
+/* An indirect call site is recorded in this many pointer sized words: the
+ * targets, their counts and the count of other targets. */
+#define CALL_SITE_WORDS (2 * IR_PROFILE_N_CALL_TARGETS + 1)
+
+/* the target index of an unknown target in the profile file */
+#define UNKNOWN_TARGET 0xFFFFFFFFu
+
 /* keep the execcounts here because they are only read once per compiler run */
 static set *profile = NULL;
 
+/* the highest execcount of profile */
+static uint32_t max_execcount = 0;
+
+/* the execution counts of the control flow edges */
+static set *edge_profile = NULL;
+
+/* the most frequent targets of the indirect calls */
+static set *call_profile = NULL;
+
 /* Hook for vcg output. */
 static hook_entry_t *hook;
 
@@ -71,6 +81,121 @@ static int cmp_execcount(const void *a, const void *b, size_t size)
 	return ea->block != eb->block;
 }
 
+bool ir_profile_find_block_execcount(const ir_node *block, uint32_t *count)
+{
+	if (profile == NULL)
+		return false;
+
+	execcount_t  const query = { .block = get_irn_node_nr(block), .count = 0 };
+	execcount_t *const ec    = set_find(execcount_t, profile, &query, sizeof(query), query.block);
+	if (ec == NULL)
+		return false;
+
+	*count = ec->count;
+	return true;
+}
+
+/**
+ * The execution count of the control flow edge from @c pred to the
+ * predecessor @c pos of @c block. The blocks are identified by their ids like
+ * in execcount_t.
+ */
+typedef struct edgecount_t {
+	unsigned long block; /**< target block id */
+	int           pos;   /**< predecessor position in the target block */
+	unsigned long pred;  /**< source block id */
+	uint32_t      count; /**< execution count */
+} edgecount_t;
+
+static int cmp_edgecount(const void *a, const void *b, size_t size)
+{
+	const edgecount_t *ea = (const edgecount_t*)a;
+	const edgecount_t *eb = (const edgecount_t*)b;
+	(void)size;
+	return ea->block != eb->block || ea->pos != eb->pos;
+}
+
+static unsigned hash_edgecount(const edgecount_t *ec)
+{
+	return hash_combine(ec->block, ec->pos);
+}
+
+bool ir_profile_find_edge_execcount(const ir_node *block, int pos,
+                                    uint32_t *count)
+{
+	if (edge_profile == NULL)
+		return false;
+
+	ir_node const *const pred = get_Block_cfgpred_block(block, pos);
+	if (pred == NULL)
+		return false;
+
+	edgecount_t  const query = {
+		.block = get_irn_node_nr(block),
+		.pos   = pos,
+		.pred  = 0,
+		.count = 0,
+	};
+	edgecount_t *const ec = set_find(edgecount_t, edge_profile, &query, sizeof(query), hash_edgecount(&query));
+	/* the control flow may have changed since the profile was recorded */
+	if (ec == NULL || ec->pred != (unsigned long)get_irn_node_nr(pred))
+		return false;
+
+	*count = ec->count;
+	return true;
+}
+
+/**
+ * The most frequent targets of an indirect call, which is identified by its
+ * id like the blocks in execcount_t.
+ */
+typedef struct calltargets_t {
+	unsigned long call;      /**< call id */
+	uint32_t      total;     /**< execution count of the call */
+	size_t        n_targets; /**< number of known targets */
+	ir_entity    *targets[IR_PROFILE_N_CALL_TARGETS]; /**< the targets */
+	uint32_t      counts[IR_PROFILE_N_CALL_TARGETS];  /**< their counts */
+} calltargets_t;
+
+static int cmp_calltargets(const void *a, const void *b, size_t size)
+{
+	const calltargets_t *ca = (const calltargets_t*)a;
+	const calltargets_t *cb = (const calltargets_t*)b;
+	(void)size;
+	return ca->call != cb->call;
+}
+
+static calltargets_t *find_calltargets(const ir_node *call)
+{
+	if (call_profile == NULL)
+		return NULL;
+
+	calltargets_t query;
+	memset(&query, 0, sizeof(query));
+	query.call = get_irn_node_nr(call);
+	return set_find(calltargets_t, call_profile, &query, sizeof(query), query.call);
+}
+
+size_t ir_profile_get_call_targets(const ir_node *call, ir_entity **targets,
+                                   uint32_t *counts, uint32_t *total)
+{
+	calltargets_t const *const ct = find_calltargets(call);
+	if (ct == NULL)
+		return 0;
+
+	for (size_t i = 0; i < ct->n_targets; ++i) {
+		targets[i] = ct->targets[i];
+		counts[i]  = ct->counts[i];
+	}
+	*total = ct->total;
+	return ct->n_targets;
+}
+
+uint32_t ir_profile_get_max_execcount(void)
+{
+	return max_execcount;
+}
+
 uint32_t ir_profile_get_block_execcount(const ir_node *block)
 {
 	execcount_t  const query = { .block = get_irn_node_nr(block), .count = 0 };
@@ -85,35 +210,203 @@ uint32_t ir_profile_get_block_execcount(const ir_node *block)
 }
 
 /**
- * Block walker, count number of blocks.
+ * A control flow edge of the profiled graph. Besides the real edges there
+ * are virtual edges from the end block to the start block and from blocks
+ * without successors (like noreturn calls) to the end block, so the
+ * execution counts obey flow conservation in every block.
  */
-static void block_counter(ir_node *bb, void *data)
+typedef struct profile_edge_t {
+	ir_node  *block;   /**< target block */
+	ir_node  *pred;    /**< source block */
+	int       pos;     /**< predecessor position in block, -1 if virtual */
+	unsigned  src;     /**< vertex number of pred */
+	unsigned  dst;     /**< vertex number of block */
+	double    weight;  /**< estimated execution frequency */
+	bool      counted; /**< edge is not in the spanning tree */
+	bool      known;   /**< the execution count is known */
+	int64_t   count;   /**< execution count */
+} profile_edge_t;
+
+/**
+ * The control flow graph of an ir_graph with a spanning tree. Only edges not
+ * in the spanning tree get a counter, the counts of the others follow from
+ * flow conservation (see Ball, Larus: "Optimally Profiling and Tracing
+ * Programs"). The tree prefers frequent edges, so the counters are placed on
+ * rarely executed edges.
+ */
+typedef struct profile_cfg_t {
+	ir_node        **blocks;     /**< blocks indexed by vertex number */
+	profile_edge_t  *edges;      /**< control flow edges */
+	unsigned        *n_succs;    /**< number of outgoing edges per vertex */
+	unsigned         n_counters; /**< number of counted edges */
+} profile_cfg_t;
+
+static void collect_block(ir_node *bb, void *data)
+{
+	ir_node ***const blocks = (ir_node***)data;
+	set_irn_link(bb, INT_TO_PTR(ARR_LEN(*blocks)));
+	ARR_APP1(ir_node*, *blocks, bb);
+}
+
+static unsigned get_block_vertex(ir_node const *const bb)
+{
+	return PTR_TO_INT(get_irn_link(bb));
+}
+
+static void add_edge(profile_cfg_t *const cfg, ir_node *const block,
+                     ir_node *const pred, int const pos)
 {
-	unsigned *const count = (unsigned*)data;
-	(void)bb;
-	++*count;
+	profile_edge_t const edge = {
+		.block = block,
+		.pred  = pred,
+		.pos   = pos,
+		.src   = get_block_vertex(pred),
+		.dst   = get_block_vertex(block),
+	};
+	ARR_APP1(profile_edge_t, cfg->edges, edge);
+	++cfg->n_succs[edge.src];
 }
 
 /**
- * Returns the number of blocks the given graph.
+ * Returns the block which counts the executions of @p edge, or NULL if the
+ * edge is critical and has to be split for this.
  */
-static unsigned int get_irg_n_blocks(ir_graph *irg)
+static ir_node *get_counter_block(profile_cfg_t const *const cfg,
+                                  profile_edge_t const *const edge)
+{
+	ir_graph *const irg = get_irn_irg(edge->block);
+	if (edge->pos < 0) {
+		/* the end block cannot be instrumented */
+		return edge->block == get_irg_start_block(irg) ? edge->block
+		                                               : edge->pred;
+	}
+	if (edge->block != get_irg_end_block(irg)
+	    && get_Block_n_cfgpreds(edge->block) == 1)
+		return edge->block;
+	if (cfg->n_succs[edge->src] == 1)
+		return edge->pred;
+	return NULL;
+}
+
+static bool is_splittable(profile_edge_t const *const edge)
 {
-	unsigned int count = 0;
-	irg_block_walk_graph(irg, block_counter, NULL, &count);
-	return count;
+	ir_graph *const irg = get_irn_irg(edge->block);
+	return edge->block != get_irg_end_block(irg)
+	    && !is_unknown_jump(get_Block_cfgpred(edge->block, edge->pos));
+}
+
+static int cmp_edge_weight(const void *a, const void *b)
+{
+	profile_edge_t const *const ea = *(profile_edge_t const *const*)a;
+	profile_edge_t const *const eb = *(profile_edge_t const *const*)b;
+	if (ea->weight != eb->weight)
+		return ea->weight < eb->weight ? 1 : -1;
+	return QSORT_CMP(ea, eb);
+}
+
+static unsigned find_root(unsigned *const parent, unsigned v)
+{
+	while (parent[v] != v) {
+		parent[v] = parent[parent[v]];
+		v         = parent[v];
+	}
+	return v;
 }
 
 /**
- * Returns the number of basic blocks in the current ir program.
+ * Computes a maximum spanning tree of the control flow graph with Kruskal's
+ * algorithm and marks the edges outside of it as counted.
  */
-static unsigned int get_irp_n_blocks(void)
+static void select_counted_edges(profile_cfg_t *const cfg)
 {
-	unsigned int count = 0;
-	foreach_irp_irg(i, irg) {
-		count += get_irg_n_blocks(irg);
+	size_t    const n_vertices = ARR_LEN(cfg->blocks);
+	size_t    const n_edges    = ARR_LEN(cfg->edges);
+	unsigned *const parent     = XMALLOCN(unsigned, n_vertices);
+	for (unsigned v = 0; v < n_vertices; ++v) {
+		parent[v] = v;
+	}
+
+	profile_edge_t **const sorted = XMALLOCN(profile_edge_t*, n_edges);
+	for (size_t e = 0; e < n_edges; ++e) {
+		sorted[e] = &cfg->edges[e];
 	}
-	return count;
+	QSORT(sorted, n_edges, cmp_edge_weight);
+
+	cfg->n_counters = 0;
+	for (size_t e = 0; e < n_edges; ++e) {
+		profile_edge_t *const edge = sorted[e];
+		unsigned        const src  = find_root(parent, edge->src);
+		unsigned        const dst  = find_root(parent, edge->dst);
+		if (edge->counted || src == dst) {
+			edge->counted = true;
+			++cfg->n_counters;
+		} else {
+			parent[src] = dst;
+		}
+	}
+
+	xfree(sorted);
+	xfree(parent);
+}
+
+/**
+ * Builds the control flow graph of @p irg and selects the edges to count.
+ * The result only depends on the graph, so instrumentation and reading
+ * the profile agree on the counters.
+ */
+static void build_profile_cfg(ir_graph *const irg, profile_cfg_t *const cfg)
+{
+	/* the estimated frequencies weight the edges of the spanning tree */
+	ir_estimate_execfreq(irg);
+
+	cfg->blocks = NEW_ARR_F(ir_node*, 0);
+	cfg->edges  = NEW_ARR_F(profile_edge_t, 0);
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	irg_block_walk_graph(irg, collect_block, NULL, &cfg->blocks);
+
+	size_t const n_vertices = ARR_LEN(cfg->blocks);
+	cfg->n_succs = XMALLOCNZ(unsigned, n_vertices);
+	for (size_t v = 0; v < n_vertices; ++v) {
+		ir_node *const block = cfg->blocks[v];
+		for (int i = 0, n = get_Block_n_cfgpreds(block); i < n; ++i) {
+			ir_node *const pred = get_Block_cfgpred_block(block, i);
+			if (pred != NULL)
+				add_edge(cfg, block, pred, i);
+		}
+	}
+
+	ir_node *const start_block = get_irg_start_block(irg);
+	ir_node *const end_block   = get_irg_end_block(irg);
+	for (size_t v = 0; v < n_vertices; ++v) {
+		ir_node *const block = cfg->blocks[v];
+		if (block != end_block && cfg->n_succs[v] == 0)
+			add_edge(cfg, end_block, block, -1);
+	}
+	/* Count the invocations directly: a call of exit() breaks the flow
+	 * conservation, so they are not derived from the returns. */
+	add_edge(cfg, start_block, end_block, -1);
+	cfg->edges[ARR_LEN(cfg->edges) - 1].counted = true;
+
+	for (size_t e = 0, n = ARR_LEN(cfg->edges); e < n; ++e) {
+		profile_edge_t *const edge = &cfg->edges[e];
+		if (get_counter_block(cfg, edge) == NULL && !is_splittable(edge)) {
+			/* cannot be instrumented precisely, so keep it in the tree */
+			edge->weight = HUGE_VAL;
+		} else {
+			edge->weight = get_block_execfreq(edge->pred)
+			             / cfg->n_succs[edge->src];
+		}
+	}
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+
+	select_counted_edges(cfg);
+}
+
+static void free_profile_cfg(profile_cfg_t *const cfg)
+{
+	DEL_ARR_F(cfg->blocks);
+	DEL_ARR_F(cfg->edges);
+	xfree(cfg->n_succs);
 }
 
 /* vcg helper */
@@ -123,6 +416,15 @@ static void dump_profile_node_info(void *ctx, FILE *f, const ir_node *irn)
 	if (is_Block(irn)) {
 		unsigned int execcount = ir_profile_get_block_execcount(irn);
 		fprintf(f, "profiled execution count: %u\n", execcount);
+	} else if (is_Call(irn)) {
+		calltargets_t const *const ct = find_calltargets(irn);
+		if (ct == NULL)
+			return;
+		fprintf(f, "profiled calls: %u\n", ct->total);
+		for (size_t i = 0; i < ct->n_targets; ++i) {
+			fprintf(f, "  %s: %u\n", get_entity_ld_name(ct->targets[i]),
+			        ct->counts[i]);
+		}
 	}
 }
 
@@ -149,10 +451,15 @@ static void add_constructor(ir_entity *method)
  * Returns an entity representing the __init_firmprof function from libfirmprof
  * This is the equivalent of:
  * extern void __init_firmprof(char *filename, uint *counters, uint size)
+ * Thread local counters are registered with __init_firmprof_threads, which
+ * has the same signature and merges the counters of exiting threads.
  */
-static ir_entity *get_init_firmprof_ref(void)
+static ir_entity *get_init_firmprof_ref(ir_profile_counters_t const kind)
 {
-	ident   *const init_name = new_id_from_str("__init_firmprof");
+	char const *const name
+		= kind == IR_PROFILE_COUNTERS_THREAD_LOCAL ? "__init_firmprof_threads"
+		                                          : "__init_firmprof";
+	ident   *const init_name = new_id_from_str(name);
 	ir_type *const init_type = new_type_method(3, 0);
 	ir_type *const uint      = new_type_primitive(mode_Iu);
 	ir_type *const uintptr   = new_type_pointer(uint);
@@ -168,6 +475,73 @@ static ir_entity *get_init_firmprof_ref(void)
 	return result;
 }
 
+/**
+ * Returns an entity representing a function from libfirmprof which takes
+ * a pointer into the counters, optionally returning another one:
+ * extern void __firmprof_increment(uint *counter)
+ * extern uint *__firmprof_thread_counters(uint *counters)
+ */
+static ir_entity *get_counter_function_ref(char const *const name,
+                                           bool const has_result)
+{
+	ir_type *const type    = new_type_method(1, has_result);
+	ir_type *const uintptr = new_type_pointer(new_type_primitive(mode_Iu));
+	set_method_param_type(type, 0, uintptr);
+	if (has_result)
+		set_method_res_type(type, 0, uintptr);
+
+	ir_entity *const result = new_entity(get_glob_type(), new_id_from_str(name), type);
+	set_entity_visibility(result, ir_visibility_external);
+
+	return result;
+}
+
+/**
+ * Returns an entity representing the function from libfirmprof which
+ * registers the call target profile of the counters:
+ * extern void __init_firmprof_calls(uint *counters, void *sites,
+ *                                   uint n_sites, void **targets,
+ *                                   uint n_targets)
+ */
+static ir_entity *get_init_calls_ref(void)
+{
+	ident   *const init_name = new_id_from_str("__init_firmprof_calls");
+	ir_type *const init_type = new_type_method(5, 0);
+	ir_type *const uint      = new_type_primitive(mode_Iu);
+	ir_type *const uintptr   = new_type_pointer(uint);
+	ir_type *const voidptr   = new_type_pointer(new_type_primitive(mode_Bu));
+
+	set_method_param_type(init_type, 0, uintptr);
+	set_method_param_type(init_type, 1, voidptr);
+	set_method_param_type(init_type, 2, uint);
+	set_method_param_type(init_type, 3, voidptr);
+	set_method_param_type(init_type, 4, uint);
+
+	ir_entity *const result = new_entity(get_glob_type(), init_name, init_type);
+	set_entity_visibility(result, ir_visibility_external);
+
+	return result;
+}
+
+/**
+ * Returns an entity representing the function from libfirmprof which
+ * records the target of an indirect call:
+ * extern void __firmprof_call_target(void *site, void *callee)
+ */
+static ir_entity *get_call_target_function_ref(void)
+{
+	ident   *const name    = new_id_from_str("__firmprof_call_target");
+	ir_type *const type    = new_type_method(2, 0);
+	ir_type *const voidptr = new_type_pointer(new_type_primitive(mode_Bu));
+	set_method_param_type(type, 0, voidptr);
+	set_method_param_type(type, 1, voidptr);
+
+	ir_entity *const result = new_entity(get_glob_type(), name, type);
+	set_entity_visibility(result, ir_visibility_external);
+
+	return result;
+}
+
 /**
  * Generates a new irg which calls the initializer
  *
@@ -175,9 +549,14 @@ static ir_entity *get_init_firmprof_ref(void)
  *    static void __firmprof_initializer(void) __attribute__ ((constructor))
  *    {
  *        __init_firmprof(ent_filename, bblock_counts, n_blocks);
+ *        __init_firmprof_calls(bblock_counts, call_sites, n_sites,
+ *                              call_targets, n_targets);
  *    }
+ *
+ * The call target profile is only registered if @p call_sites is given.
  */
-static ir_graph *gen_initializer_irg(ir_entity *ent_filename, ir_entity *bblock_counts, int n_blocks)
+static ir_graph *gen_initializer_irg(ir_entity *ent_filename, ir_entity *bblock_counts, int n_blocks, ir_profile_counters_t kind,
+                                     ir_entity *call_sites, unsigned n_sites, ir_entity *call_targets, unsigned n_targets)
 {
 	ident     *const name = new_id_from_str("__firmprof_initializer");
 	ir_entity *const ent  = new_entity(get_glob_type(), name, new_type_method(0, 0));
@@ -191,7 +570,7 @@ static ir_graph *gen_initializer_irg(ir_entity *ent_filename, ir_entity *bblock_
 
 	ir_node   *const bb        = get_r_cur_block(irg);
 	ir_node   *const init_mem  = get_irg_initial_mem(irg);
-	ir_entity *const init_ent  = get_init_firmprof_ref();
+	ir_entity *const init_ent  = get_init_firmprof_ref(kind);
 	ir_node   *const callee    = new_r_Address(irg, init_ent);
 	ir_node   *const filename  = new_r_Address(irg, ent_filename);
 	ir_node   *const counters  = new_r_Address(irg, bblock_counts);
@@ -199,7 +578,24 @@ static ir_graph *gen_initializer_irg(ir_entity *ent_filename, ir_entity *bblock_
 	ir_node   *const ins[]     = { filename, counters, size };
 	ir_type   *const call_type = get_entity_type(init_ent);
 	ir_node   *const call      = new_r_Call(bb, init_mem, callee, ARRAY_SIZE(ins), ins, call_type);
-	ir_node   *const call_mem  = new_r_Proj(call, mode_M, pn_Call_M);
+	ir_node         *call_mem  = new_r_Proj(call, mode_M, pn_Call_M);
+	if (call_sites != NULL) {
+		ir_entity *const calls_ent = get_init_calls_ref();
+		ir_node   *const targets   = call_targets != NULL
+			? new_r_Address(irg, call_targets)
+			: new_r_Const(irg, get_mode_null(mode_P));
+		ir_node   *const cins[]    = {
+			counters,
+			new_r_Address(irg, call_sites),
+			new_r_Const_long(irg, mode_Iu, n_sites),
+			targets,
+			new_r_Const_long(irg, mode_Iu, n_targets),
+		};
+		ir_node   *const ccallee   = new_r_Address(irg, calls_ent);
+		ir_type   *const ctype     = get_entity_type(calls_ent);
+		ir_node   *const ccall     = new_r_Call(bb, call_mem, ccallee, ARRAY_SIZE(cins), cins, ctype);
+		call_mem = new_r_Proj(ccall, mode_M, pn_Call_M);
+	}
 	ir_node   *const ret       = new_r_Return(bb, call_mem, 0, NULL);
 
 	add_immBlock_pred(get_irg_end_block(irg), ret);
@@ -209,84 +605,198 @@ static ir_graph *gen_initializer_irg(ir_entity *ent_filename, ir_entity *bblock_
 	return irg;
 }
 
+/* Instrumentation data of a graph. */
+typedef struct instrument_env_t {
+	ir_profile_counters_t kind;      /**< kind of the counters */
+	ir_node              *address;   /**< the node representing the counter array */
+	ir_type              *type;      /**< the type of a counter */
+	ir_entity            *increment; /**< the atomic increment function */
+	unsigned              id;        /**< current counter id number */
+	ir_node             **calls;     /**< the recorded indirect calls */
+	ir_entity            *sites;     /**< the call site array */
+	ir_entity            *record;    /**< the call target recording function */
+	size_t                site;      /**< current call site number */
+} instrument_env_t;
+
+/**
+ * Appends the memory operation @p op with the memory result @p mem to the
+ * instrumentation code of @p bb.
+ */
+static void chain_mem(ir_node *const bb, ir_node *const op, ir_node *const mem)
+{
+	/* the block links to the last memory of its instrumentation, which links
+	 * to the first memory operation */
+	ir_node *const prev = (ir_node*)get_irn_link(bb);
+	set_irn_link(bb, mem);
+	set_irn_link(mem, prev != NULL ? get_irn_link(prev) : op);
+}
+
+/**
+ * Returns the memory input for a new memory operation of the
+ * instrumentation code of @p bb.
+ */
+static ir_node *get_chain_mem(ir_node *const bb)
+{
+	ir_node *const prev = (ir_node*)get_irn_link(bb);
+	return prev != NULL ? prev : new_r_Unknown(get_irn_irg(bb), mode_M);
+}
+
 /**
  * Instrument a block with code needed for profiling.
  * This just inserts the instruction nodes, it doesn't connect the memory
- * nodes in a meaningful way.
+ * nodes in a meaningful way. Several counters in a block are chained.
  */
-static void instrument_block(ir_node *const bb, ir_node *const address, unsigned int const id)
+static void instrument_block(ir_node *const bb, instrument_env_t *const env)
 {
 	ir_graph *const irg = get_irn_irg(bb);
 
 	/* We can't instrument the end block */
-	if (bb == get_irg_end_block(irg))
+	assert(bb != get_irg_end_block(irg));
+
+	ir_type *const type_Iu = env->type;
+	ir_node *const mem     = get_chain_mem(bb);
+	ir_mode *const mode_o  = get_reference_offset_mode(mode_P);
+	ir_node *const cnst    = new_r_Const_long(irg, mode_o, get_mode_size_bytes(mode_Iu) * env->id++);
+	ir_node *const offset  = new_r_Add(bb, env->address, cnst, mode_P);
+	if (env->kind == IR_PROFILE_COUNTERS_ATOMIC) {
+		ir_node *const callee = new_r_Address(irg, env->increment);
+		ir_type *const type   = get_entity_type(env->increment);
+		ir_node *const call   = new_r_Call(bb, mem, callee, 1, &offset, type);
+		ir_node *const cmem   = new_r_Proj(call, mode_M, pn_Call_M);
+		chain_mem(bb, call, cmem);
 		return;
+	}
 
-	ir_type *const type_Iu = get_entity_type(get_irn_entity_attr(address));
-	ir_node *const unknown = new_r_Unknown(irg, mode_M);
-	ir_node *const cnst    = new_r_Const_long(irg, mode_Iu, get_mode_size_bytes(mode_Iu) * id);
-	ir_node *const offset  = new_r_Add(bb, address, cnst, mode_P);
-	ir_node *const load    = new_r_Load(bb, unknown, offset, mode_Iu, type_Iu, cons_none);
+	ir_node *const load    = new_r_Load(bb, mem, offset, mode_Iu, type_Iu, cons_none);
 	ir_node *const lmem    = new_r_Proj(load, mode_M, pn_Load_M);
 	ir_node *const proji   = new_r_Proj(load, mode_Iu, pn_Load_res);
 	ir_node *const one     = new_r_Const_one(irg, mode_Iu);
 	ir_node *const add     = new_r_Add(bb, proji, one, mode_Iu);
 	ir_node *const store   = new_r_Store(bb, lmem, offset, add, type_Iu, cons_none);
 	ir_node *const smem    = new_r_Proj(store, mode_M, pn_Store_M);
-
-	set_irn_link(bb, smem);
-	set_irn_link(smem, load);
+	chain_mem(bb, load, smem);
 }
 
 /**
- * SSA Construction for instrumentation code memory.
- *
- * This introduces a new memory node and connects it to the instrumentation
- * codes, inserting phiM nodes as necessary. Note that afterwards, the new
- * memory is not connected to any return nodes and thus still dead.
+ * Instruments the indirect call @p call, which is the current call site, with
+ * a call recording its target.
  */
-static void fix_ssa(ir_node *const bb, void *const data)
+static void instrument_call(ir_node *const call, instrument_env_t *const env)
 {
-	(void)data;
+	ir_node  *const bb     = get_nodes_block(call);
+	ir_graph *const irg    = get_irn_irg(bb);
+	ir_mode  *const mode_o = get_reference_offset_mode(mode_P);
+	ir_node  *const cnst   = new_r_Const_long(irg, mode_o, CALL_SITE_WORDS * get_mode_size_bytes(mode_o) * env->site++);
+	ir_node  *const sites  = new_r_Address(irg, env->sites);
+	ir_node  *const ins[]  = { new_r_Add(bb, sites, cnst, mode_P), get_Call_ptr(call) };
+	ir_node  *const callee = new_r_Address(irg, env->record);
+	ir_type  *const type   = get_entity_type(env->record);
+	ir_node  *const record = new_r_Call(bb, get_chain_mem(bb), callee, ARRAY_SIZE(ins), ins, type);
+	ir_node  *const cmem   = new_r_Proj(record, mode_M, pn_Call_M);
+	chain_mem(bb, record, cmem);
+}
 
-	ir_graph *const irg = get_irn_irg(bb);
+/**
+ * Instruments the start block of @p irg with a call which returns the counter
+ * array of the current thread.
+ */
+static ir_node *get_thread_counters(ir_graph *const irg, ir_node *const address,
+                                    ir_entity *const thread_counters)
+{
+	ir_node *const bb     = get_irg_start_block(irg);
+	ir_node *const callee = new_r_Address(irg, thread_counters);
+	ir_type *const type   = get_entity_type(thread_counters);
+	ir_node *const call   = new_r_Call(bb, get_chain_mem(bb), callee, 1, &address, type);
+	ir_node *const cmem   = new_r_Proj(call, mode_M, pn_Call_M);
+	ir_node *const ress   = new_r_Proj(call, mode_T, pn_Call_T_result);
+	chain_mem(bb, call, cmem);
+	return new_r_Proj(ress, mode_P, 0);
+}
 
-	/* end blocks are not instrumented, skip! */
-	if (bb == get_irg_end_block(irg))
-		return;
+/**
+ * Places a new block on the critical edge @p edge and returns it.
+ */
+static ir_node *split_edge(profile_edge_t const *const edge)
+{
+	ir_graph *const irg   = get_irn_irg(edge->block);
+	ir_node  *const cfop  = get_Block_cfgpred(edge->block, edge->pos);
+	ir_node  *const split = new_r_Block(irg, 1, &cfop);
+	ir_node  *const jmp   = new_r_Jmp(split);
+	set_irn_n(edge->block, edge->pos, jmp);
+	set_irn_link(split, NULL);
+	return split;
+}
 
-	ir_node  *mem;
-	int const arity = get_Block_n_cfgpreds(bb);
+/**
+ * SSA Construction for instrumentation code memory.
+ *
+ * Returns the instrumentation memory at the end of @p bb, connects the first
+ * load of the block to it and inserts phiM nodes as necessary. Note that
+ * afterwards, the new memory is not connected to any return nodes and thus
+ * still dead.
+ */
+static ir_node *get_block_mem(ir_node *const bb)
+{
+	/* The block link fields point to the projm from the instrumentation code,
+	 * the projm in turn links to the initial load or call which lacks a memory
+	 * argument at this point. */
+	ir_node *const last = (ir_node*)get_irn_link(bb);
+	if (irn_visited(bb))
+		return last;
+	mark_irn_visited(bb);
+
+	ir_graph *const irg   = get_irn_irg(bb);
+	int       const arity = get_Block_n_cfgpreds(bb);
+	ir_node        *mem;
 	if (bb == get_irg_start_block(irg)) {
 		mem = get_irg_initial_mem(irg);
 	} else if (arity == 1) {
+		/* only unreachable cycles of blocks see this */
+		if (last == NULL)
+			set_irn_link(bb, new_r_NoMem(irg));
 		ir_node *const pred = get_Block_cfgpred_block(bb, 0);
-		mem = pred ? (ir_node*)get_irn_link(pred) : new_r_NoMem(irg);
+		mem = pred ? get_block_mem(pred) : new_r_NoMem(irg);
 	} else {
-		ir_node **ins = ALLOCAN(ir_node*, arity);
+		ir_node **ins   = ALLOCAN(ir_node*, arity);
+		ir_node  *dummy = new_r_Dummy(irg, mode_M);
+		for (int n = arity; n-- != 0;) {
+			ins[n] = dummy;
+		}
+		/* the memory may only be used in an endless loop */
+		mem = new_r_Phi_loop(bb, arity, ins);
+		if (last == NULL)
+			set_irn_link(bb, mem);
 		for (int n = arity; n-- != 0;) {
 			ir_node *const pred = get_Block_cfgpred_block(bb, n);
-			ins[n] = pred ? (ir_node*)get_irn_link(pred) : new_r_NoMem(irg);
+			set_irn_n(mem, n, pred ? get_block_mem(pred) : new_r_NoMem(irg));
 		}
-		mem = new_r_Phi(bb, arity, ins, mode_M);
 	}
 
-	/* The block link fields point to the projm from the instrumentation code,
-	 * the projm in turn links to the initial load which lacks a memory
-	 * argument at this point. */
-	ir_node *const proj = (ir_node*)get_irn_link(bb);
-	ir_node *const load = (ir_node*)get_irn_link(proj);
-	set_Load_mem(load, mem);
+	if (last == NULL) {
+		set_irn_link(bb, mem);
+		return mem;
+	}
+	ir_node *const first = (ir_node*)get_irn_link(last);
+	if (is_Load(first)) {
+		set_Load_mem(first, mem);
+	} else {
+		set_Call_mem(first, mem);
+	}
+	return last;
 }
 
-/**
- * Instrument a single block.
- */
-static void block_instrument_walker(ir_node *bb, void *data)
+static void fix_ssa(ir_node *const bb, void *const data)
 {
-	block_id_walker_data_t *wd = (block_id_walker_data_t*)data;
-	instrument_block(bb, wd->counters, wd->id);
-	++wd->id;
+	(void)data;
+	ir_graph *const irg = get_irn_irg(bb);
+	if (bb != get_irg_end_block(irg))
+		(void)get_block_mem(bb);
+}
+
+static void clear_block_link(ir_node *const bb, void *const data)
+{
+	(void)data;
+	set_irn_link(bb, NULL);
 }
 
 /**
@@ -295,21 +805,56 @@ static void block_instrument_walker(ir_node *bb, void *data)
  */
 static ir_node *sync_mem(ir_node *bb, ir_node *mem)
 {
-	ir_node *const ins[] = { (ir_node*)get_irn_link(bb), mem };
+	ir_node *const ins[] = { get_block_mem(bb), mem };
 	return new_r_Sync(bb, ARRAY_SIZE(ins), ins);
 }
 
 /**
- * Instrument a single ir_graph, counters should point to the bblock
+ * Instrument a single ir_graph, counters should point to the edge
  * counters array.
  */
-static void instrument_irg(ir_graph *irg, ir_entity *counters, block_id_walker_data_t *wd)
+static void instrument_irg(ir_graph *irg, ir_entity *counters,
+                           ir_entity *thread_counters, profile_cfg_t const *cfg,
+                           instrument_env_t *env)
 {
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_IRN_VISITED);
+	irg_block_walk_graph(irg, clear_block_link, NULL, NULL);
+
 	/* generate a node pointing to the count array */
-	wd->counters = new_r_Address(irg, counters);
+	env->address = new_r_Address(irg, counters);
+	if (env->kind == IR_PROFILE_COUNTERS_THREAD_LOCAL)
+		env->address = get_thread_counters(irg, env->address, thread_counters);
+
+	/* instrument each counted edge in the current irg */
+	bool split = false;
+	for (size_t e = 0, n = ARR_LEN(cfg->edges); e < n; ++e) {
+		profile_edge_t const *const edge = &cfg->edges[e];
+		if (!edge->counted)
+			continue;
+
+		ir_node *bb = get_counter_block(cfg, edge);
+		if (bb == NULL) {
+			if (is_splittable(edge)) {
+				bb    = split_edge(edge);
+				split = true;
+			} else {
+				/* Only parallel edges get here. Counting the source block
+				 * overestimates them, but there is no place for an edge
+				 * counter. */
+				bb = edge->pred;
+			}
+		}
+		instrument_block(bb, env);
+	}
 
-	/* instrument each block in the current irg */
-	irg_block_walk_graph(irg, block_instrument_walker, NULL, wd);
+	/* the call sites are ordered by graph */
+	if (env->calls != NULL) {
+		for (size_t n = ARR_LEN(env->calls); env->site < n
+		     && get_irn_irg(env->calls[env->site]) == irg;) {
+			instrument_call(env->calls[env->site], env);
+		}
+	}
+	inc_irg_visited(irg);
 	irg_block_walk_graph(irg, fix_ssa, NULL, NULL);
 
 	/* connect the new memory nodes to the return nodes */
@@ -349,23 +894,27 @@ static void instrument_irg(ir_graph *irg, ir_entity *counters, block_id_walker_d
 			set_Call_mem(node, sync_mem(bb, mem));
 		}
 	}
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_IRN_VISITED);
+
+	confirm_irg_properties(irg, split ? IR_GRAPH_PROPERTIES_NONE
+	                                  : IR_GRAPH_PROPERTIES_CONTROL_FLOW);
 }
 
 /**
  * Creates a new entity representing the equivalent of
- * static unsigned int name[size]
+ * static element_type name[size]
  */
-static ir_entity *new_array_entity(ident *name, int size)
+static ir_entity *new_array_entity(ident *name, ir_type *element_type,
+                                   int size)
 {
-	ir_type *const uint_type = new_type_primitive(mode_Iu);
-
-	ir_type *const array_type = new_type_array(uint_type);
+	ir_type *const array_type = new_type_array(element_type);
 	set_array_size_int(array_type, size);
-	set_type_size(array_type, size * get_mode_size_bytes(mode_Iu));
+	set_type_size(array_type, size * get_type_size(element_type));
 	set_type_state(array_type, layout_fixed);
 
 	ir_entity *const result = new_entity(get_glob_type(), name, array_type);
 	set_entity_visibility(result, ir_visibility_private);
+	set_entity_initializer(result, get_initializer_null());
 
 	return result;
 }
@@ -402,7 +951,98 @@ static ir_entity *new_static_string_entity(ident *name, const char *string)
 	return result;
 }
 
-ir_graph *ir_profile_instrument(const char *filename)
+/**
+ * Creates a new entity representing the equivalent of
+ * static void (*const name[])(void) = { targets... }
+ */
+static ir_entity *new_call_targets_entity(ident *name, ir_entity **targets)
+{
+	size_t     const n         = ARR_LEN(targets);
+	ir_type   *const code_ptr  = new_type_pointer(new_type_method(0, 0));
+	ir_entity *const result    = new_array_entity(name, code_ptr, n);
+	set_entity_linkage(result, IR_LINKAGE_CONSTANT);
+
+	ir_graph         *const irg      = get_const_code_irg();
+	ir_initializer_t *const contents = create_initializer_compound(n);
+	for (size_t i = 0; i < n; ++i) {
+		ir_node          *const addr = new_r_Address(irg, targets[i]);
+		ir_initializer_t *const init = create_initializer_const(addr);
+		set_initializer_compound_value(contents, i, init);
+	}
+	set_entity_initializer(result, contents);
+
+	return result;
+}
+
+static void collect_call_site(ir_node *node, void *data)
+{
+	ir_node ***const calls = (ir_node***)data;
+	if (is_Call(node) && !is_Address(get_Call_ptr(node)))
+		ARR_APP1(ir_node*, *calls, node);
+}
+
+/**
+ * Collects the indirect calls of all irgs in a fixed order, so the call sites
+ * of instrumentation and reading agree.
+ */
+static ir_node **collect_irp_call_sites(void)
+{
+	ir_node **calls = NEW_ARR_F(ir_node*, 0);
+	foreach_irp_irg_r(i, irg) {
+		irg_walk_graph(irg, NULL, collect_call_site, &calls);
+	}
+	return calls;
+}
+
+/**
+ * Collects the functions defined in the compilation unit, which are the
+ * targets of indirect calls that can be identified in the profile.
+ */
+static ir_entity **collect_irp_call_targets(void)
+{
+	ir_entity   **targets = NEW_ARR_F(ir_entity*, 0);
+	ir_type *const glob   = get_glob_type();
+	for (size_t i = 0, n = get_compound_n_members(glob); i < n; ++i) {
+		ir_entity *const ent = get_compound_member(glob, i);
+		if (is_method_entity(ent) && get_entity_irg(ent) != NULL)
+			ARR_APP1(ir_entity*, targets, ent);
+	}
+	return targets;
+}
+
+/**
+ * Builds the control flow graphs of all irgs, @p n_counters returns the total
+ * number of counters.
+ */
+static profile_cfg_t *build_irp_profile_cfgs(unsigned *const n_counters)
+{
+	/* The estimated frequencies must not depend on a loaded profile, else
+	 * the counters of instrumentation and reading could differ. */
+	set *const loaded = edge_profile;
+	edge_profile = NULL;
+
+	profile_cfg_t *const cfgs = XMALLOCNZ(profile_cfg_t, get_irp_n_irgs());
+	*n_counters = 0;
+	foreach_irp_irg_r(i, irg) {
+		build_profile_cfg(irg, &cfgs[i]);
+		*n_counters += cfgs[i].n_counters;
+	}
+
+	edge_profile = loaded;
+	return cfgs;
+}
+
+static void free_irp_profile_cfgs(profile_cfg_t *const cfgs)
+{
+	for (size_t i = 0, n = get_irp_n_irgs(); i < n; ++i) {
+		free_profile_cfg(&cfgs[i]);
+	}
+	xfree(cfgs);
+}
+
+ir_graph *ir_profile_instrument(const char *filename,
+                                ir_profile_counters_t kind,
+                                bool call_targets)
 {
 	FIRM_DBG_REGISTER(dbg, "firm.ir.profile");
 
@@ -411,29 +1051,91 @@ ir_graph *ir_profile_instrument(const char *filename)
 	if (get_irp_n_irgs() == 0)
 		return NULL;
 
-	/* count the number of block first */
-	unsigned const n_blocks = get_irp_n_blocks();
+	/* select the counted edges first */
+	unsigned             n_counters;
+	profile_cfg_t *const cfgs = build_irp_profile_cfgs(&n_counters);
 
 	/* create all the necessary types and entities. Note that the
 	 * types must have a fixed layout, because we are already running in the
 	 * backend */
-	ident     *const counter_id    = new_id_from_str("__FIRMPROF__BLOCK_COUNTS");
-	ir_entity *const bblock_counts = new_array_entity(counter_id, n_blocks);
+	ident     *const counter_id  = new_id_from_str("__FIRMPROF__EDGE_COUNTS");
+	ir_type   *const uint_type   = new_type_primitive(mode_Iu);
+	ir_entity *const edge_counts = new_array_entity(counter_id, uint_type, n_counters);
 
 	ident     *const filename_id  = new_id_from_str("__FIRMPROF__FILE_NAME");
 	ir_entity *const ent_filename = new_static_string_entity(filename_id, filename);
 
-	/* initialize block id array and instrument blocks */
-	block_id_walker_data_t wd = { .id = 0 };
+	instrument_env_t env = {
+		.kind = kind,
+		.type = new_type_primitive(mode_Iu),
+		.id   = 0,
+	};
+	ir_entity       *thread_counters = NULL;
+	if (kind == IR_PROFILE_COUNTERS_ATOMIC)
+		env.increment = get_counter_function_ref("__firmprof_increment", false);
+	else if (kind == IR_PROFILE_COUNTERS_THREAD_LOCAL)
+		thread_counters = get_counter_function_ref("__firmprof_thread_counters", true);
+
+	/* the tables of the call target profile, the targets must be collected
+	 * before any new function is created */
+	ir_entity *call_sites = NULL;
+	ir_entity *targets    = NULL;
+	size_t     n_sites    = 0;
+	size_t     n_targets  = 0;
+	if (call_targets) {
+		env.calls = collect_irp_call_sites();
+		n_sites   = ARR_LEN(env.calls);
+	}
+	if (n_sites > 0) {
+		ir_entity  **const target_ents = collect_irp_call_targets();
+		n_targets = ARR_LEN(target_ents);
+		if (n_targets > 0) {
+			ident *const targets_id = new_id_from_str("__FIRMPROF__CALL_TARGETS");
+			targets = new_call_targets_entity(targets_id, target_ents);
+		}
+		DEL_ARR_F(target_ents);
+
+		ir_type *const word_type = new_type_primitive(get_reference_offset_mode(mode_P));
+		ident   *const sites_id  = new_id_from_str("__FIRMPROF__CALL_SITES");
+		call_sites = new_array_entity(sites_id, word_type, n_sites * CALL_SITE_WORDS);
+		env.sites  = call_sites;
+		env.record = get_call_target_function_ref();
+	}
+
+	/* instrument the counted edges and the indirect calls */
 	foreach_irp_irg_r(i, irg) {
-		instrument_irg(irg, bblock_counts, &wd);
+		instrument_irg(irg, edge_counts, thread_counters, &cfgs[i], &env);
 	}
+	free_irp_profile_cfgs(cfgs);
+	if (env.calls != NULL)
+		DEL_ARR_F(env.calls);
 
-	return gen_initializer_irg(ent_filename, bblock_counts, n_blocks);
+	return gen_initializer_irg(ent_filename, edge_counts, n_counters, kind,
+	                           call_sites, n_sites, targets, n_targets);
 }
 
-static unsigned int *parse_profile(const char *filename, unsigned int num_blocks)
+/**
+ * Reads a 32-bit unsigned integer stored in little endian format.
+ */
+static bool read_u32(FILE *const f, uint32_t *const value)
 {
+	unsigned char bytes[4];
+	if (fread(bytes, 1, 4, f) < 4)
+		return false;
+
+	*value = (bytes[0] <<  0) | (bytes[1] <<  8)
+	       | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+	return true;
+}
+
+/**
+ * Reads the counters and, if present, the call target profile of
+ * @p num_sites call sites, which is returned in @p sites.
+ */
+static unsigned int *parse_profile(const char *filename, unsigned int num_counters,
+                                   size_t num_sites, uint32_t **sites)
+{
+	*sites = NULL;
 	FILE *const f = fopen(filename, "rb");
 	if (!f) {
 		DBG((dbg, LEVEL_2, "Failed to open profile file (%s)\n", filename));
@@ -449,49 +1151,227 @@ static unsigned int *parse_profile(const char *filename, unsigned int num_blocks
 		goto end;
 	}
 
-	result = XMALLOCN(unsigned int, num_blocks);
+	result = XMALLOCN(unsigned int, num_counters);
 
 	/* The profiling output format is defined to be a sequence of integer
 	 * values stored little endian format. */
-	for (unsigned i = 0; i < num_blocks; ++i) {
-		unsigned char bytes[4];
-		if ((ret = fread(bytes, 1, 4, f)) < 1)
-			break;
+	for (unsigned i = 0; i < num_counters; ++i) {
+		if (!read_u32(f, &result[i])) {
+			DBG((dbg, LEVEL_4, "Failed to read counters... (size: %u)\n",
+				sizeof(unsigned int) * num_counters));
+			goto fail;
+		}
+	}
 
-		result[i] = (bytes[0] <<  0) | (bytes[1] <<  8)
-		          | (bytes[2] << 16) | (bytes[3] << 24);
+	/* the call target profile follows optionally: the number of call sites
+	 * and for each site the target indices and counts and the count of
+	 * other targets */
+	uint32_t n_sites;
+	if (!read_u32(f, &n_sites))
+		goto end;
+	if (n_sites != num_sites) {
+		DBG((dbg, LEVEL_2, "Profile contains %u instead of %zu call sites\n",
+			n_sites, num_sites));
+		goto fail;
+	}
+	*sites = XMALLOCN(uint32_t, num_sites * CALL_SITE_WORDS);
+	for (size_t i = 0; i < num_sites * CALL_SITE_WORDS; ++i) {
+		if (!read_u32(f, &(*sites)[i])) {
+			DBG((dbg, LEVEL_4, "Failed to read call sites\n"));
+			goto fail;
+		}
 	}
 
-	if (ret < 1) {
-		DBG((dbg, LEVEL_4, "Failed to read counters... (size: %u)\n",
-			sizeof(unsigned int) * num_blocks));
-		free(result);
-		result = NULL;
+	if (fgetc(f) != EOF) {
+		/* the profile was recorded for different code */
+		DBG((dbg, LEVEL_2, "Profile contains more than %u counters\n",
+			num_counters));
+		goto fail;
 	}
 
 end:
 	fclose(f);
 	return result;
+
+fail:
+	xfree(*sites);
+	*sites = NULL;
+	xfree(result);
+	fclose(f);
+	return NULL;
 }
 
 /**
- * Reads the corresponding profile info file if it exists.
+ * Derives the counts of the spanning tree edges from the counted edges: In
+ * every block the incoming count equals the outgoing count, so the count of
+ * the only unknown edge of a block follows from its other edges.
  */
-static void block_associate_walker(ir_node *bb, void *env)
+static void derive_edge_counts(profile_cfg_t *const cfg)
 {
-	block_assoc_t *b = (block_assoc_t*)env;
-	execcount_t query;
+	size_t const n_vertices = ARR_LEN(cfg->blocks);
+	size_t const n_edges    = ARR_LEN(cfg->edges);
+
+	/* the incident edges of vertex v are incident[first[v]..first[v+1]-1],
+	 * self loops are always counted and cancel out */
+	unsigned *const first     = XMALLOCNZ(unsigned, n_vertices + 1);
+	unsigned *const n_unknown = XMALLOCNZ(unsigned, n_vertices);
+	for (size_t e = 0; e < n_edges; ++e) {
+		profile_edge_t const *const edge = &cfg->edges[e];
+		if (edge->src == edge->dst)
+			continue;
+		++first[edge->src + 1];
+		++first[edge->dst + 1];
+		if (!edge->known) {
+			++n_unknown[edge->src];
+			++n_unknown[edge->dst];
+		}
+	}
+	for (size_t v = 0; v < n_vertices; ++v) {
+		first[v + 1] += first[v];
+	}
+	unsigned *const incident = XMALLOCN(unsigned, first[n_vertices]);
+	unsigned *const fill     = XMALLOCN(unsigned, n_vertices);
+	memcpy(fill, first, n_vertices * sizeof(*fill));
+	for (size_t e = 0; e < n_edges; ++e) {
+		profile_edge_t const *const edge = &cfg->edges[e];
+		if (edge->src == edge->dst)
+			continue;
+		incident[fill[edge->src]++] = e;
+		incident[fill[edge->dst]++] = e;
+	}
+
+	unsigned *worklist = NEW_ARR_F(unsigned, 0);
+	for (unsigned v = 0; v < n_vertices; ++v) {
+		if (n_unknown[v] == 1)
+			ARR_APP1(unsigned, worklist, v);
+	}
+	while (ARR_LEN(worklist) > 0) {
+		unsigned const v = worklist[ARR_LEN(worklist) - 1];
+		ARR_SHRINKLEN(worklist, ARR_LEN(worklist) - 1);
+		if (n_unknown[v] != 1)
+			continue;
 
-	query.block = get_irn_node_nr(bb);
-	query.count = b->counters[b->i++];
-	DBG((dbg, LEVEL_4, "execcount(%+F, %u): %u\n", bb, query.block, query.count));
-	(void)set_insert(execcount_t, profile, &query, sizeof(query), query.block);
+		/* balance is the incoming minus the outgoing count */
+		profile_edge_t *unknown = NULL;
+		int64_t         balance = 0;
+		for (unsigned i = first[v]; i < first[v + 1]; ++i) {
+			profile_edge_t *const edge = &cfg->edges[incident[i]];
+			if (!edge->known)
+				unknown = edge;
+			else if (edge->dst == v)
+				balance += edge->count;
+			else
+				balance -= edge->count;
+		}
+		int64_t const count = unknown->dst == v ? -balance : balance;
+		/* calls of exit() break the conservation */
+		unknown->count = MAX(count, 0);
+		unknown->known = true;
+
+		unsigned const other = unknown->dst == v ? unknown->src : unknown->dst;
+		--n_unknown[v];
+		if (--n_unknown[other] == 1)
+			ARR_APP1(unsigned, worklist, other);
+	}
+
+	DEL_ARR_F(worklist);
+	xfree(fill);
+	xfree(incident);
+	xfree(n_unknown);
+	xfree(first);
 }
 
-static void irp_associate_blocks(block_assoc_t *env)
+static uint32_t clamp_count(int64_t const count)
 {
-	foreach_irp_irg_r(i, irg) {
-		irg_block_walk_graph(irg, block_associate_walker, NULL, env);
+	return (uint32_t)MIN(count, (int64_t)UINT32_MAX);
+}
+
+/**
+ * Associates the counters starting at counter @p id with the edges and
+ * blocks of @p cfg.
+ */
+static void associate_counts(profile_cfg_t *const cfg,
+                             uint32_t const *const counters, unsigned *const id)
+{
+	size_t const n_edges = ARR_LEN(cfg->edges);
+	for (size_t e = 0; e < n_edges; ++e) {
+		profile_edge_t *const edge = &cfg->edges[e];
+		edge->known = edge->counted;
+		if (edge->counted)
+			edge->count = counters[(*id)++];
+	}
+	derive_edge_counts(cfg);
+
+	/* the count of a block is the sum of its incoming edges */
+	size_t   const n_vertices   = ARR_LEN(cfg->blocks);
+	int64_t *const block_counts = XMALLOCNZ(int64_t, n_vertices);
+	for (size_t e = 0; e < n_edges; ++e) {
+		profile_edge_t const *const edge = &cfg->edges[e];
+		block_counts[edge->dst] += edge->count;
+		if (edge->pos < 0)
+			continue;
+
+		edgecount_t const query = {
+			.block = get_irn_node_nr(edge->block),
+			.pos   = edge->pos,
+			.pred  = get_irn_node_nr(edge->pred),
+			.count = clamp_count(edge->count),
+		};
+		(void)set_insert(edgecount_t, edge_profile, &query, sizeof(query), hash_edgecount(&query));
+	}
+
+	for (size_t v = 0; v < n_vertices; ++v) {
+		ir_node     *const bb    = cfg->blocks[v];
+		execcount_t  const query = {
+			.block = get_irn_node_nr(bb),
+			.count = clamp_count(block_counts[v]),
+		};
+		DBG((dbg, LEVEL_4, "execcount(%+F, %u): %u\n", bb, query.block, query.count));
+		execcount_t const *const ec
+			= set_insert(execcount_t, profile, &query, sizeof(query), query.block);
+		max_execcount = MAX(max_execcount, ec->count);
+	}
+	xfree(block_counts);
+}
+
+/**
+ * Associates the recorded targets of the indirect calls @p calls with them.
+ * @p targets are the functions indexed in the profile.
+ */
+static void associate_call_targets(ir_node *const *const calls,
+                                   ir_entity *const *const targets,
+                                   uint32_t const *const sites)
+{
+	size_t const n_targets = ARR_LEN(targets);
+	for (size_t i = 0, n = ARR_LEN(calls); i < n; ++i) {
+		uint32_t const *const site = &sites[i * CALL_SITE_WORDS];
+		calltargets_t         ct;
+		memset(&ct, 0, sizeof(ct));
+		ct.call = get_irn_node_nr(calls[i]);
+
+		int64_t total = site[CALL_SITE_WORDS - 1];
+		for (size_t t = 0; t < IR_PROFILE_N_CALL_TARGETS; ++t) {
+			uint32_t const index = site[2 * t];
+			uint32_t const count = site[2 * t + 1];
+			total += count;
+			if (index == UNKNOWN_TARGET || index >= n_targets || count == 0)
+				continue;
+
+			/* insertion sort by decreasing count */
+			size_t pos = ct.n_targets++;
+			for (; pos > 0 && ct.counts[pos - 1] < count; --pos) {
+				ct.targets[pos] = ct.targets[pos - 1];
+				ct.counts[pos]  = ct.counts[pos - 1];
+			}
+			ct.targets[pos] = targets[index];
+			ct.counts[pos]  = count;
+		}
+		ct.total = clamp_count(total);
+		if (ct.total == 0)
+			continue;
+
+		DBG((dbg, LEVEL_4, "calls(%+F): %u\n", calls[i], ct.total));
+		(void)set_insert(calltargets_t, call_profile, &ct, sizeof(ct), ct.call);
 	}
 }
 
@@ -501,6 +1381,17 @@ void ir_profile_free(void)
 		del_set(profile);
 		profile = NULL;
 	}
+	max_execcount = 0;
+
+	if (edge_profile) {
+		del_set(edge_profile);
+		edge_profile = NULL;
+	}
+
+	if (call_profile) {
+		del_set(call_profile);
+		call_profile = NULL;
+	}
 
 	if (hook != NULL) {
 		dump_remove_node_info_callback(hook);
@@ -512,25 +1403,350 @@ bool ir_profile_read(const char *filename)
 {
 	FIRM_DBG_REGISTER(dbg, "firm.ir.profile");
 
-	unsigned n_blocks = get_irp_n_blocks();
-	block_assoc_t env = {
-		.i        = 0,
-		.counters = parse_profile(filename, n_blocks)
-	};
-	if (!env.counters)
+	unsigned             n_counters;
+	profile_cfg_t *const cfgs     = build_irp_profile_cfgs(&n_counters);
+	ir_node      **const calls    = collect_irp_call_sites();
+	uint32_t            *sites;
+	unsigned int  *const counters = parse_profile(filename, n_counters, ARR_LEN(calls), &sites);
+	if (!counters) {
+		DEL_ARR_F(calls);
+		free_irp_profile_cfgs(cfgs);
 		return false;
+	}
 
 	ir_profile_free();
-	profile = new_set(cmp_execcount, 16);
+	profile      = new_set(cmp_execcount, 16);
+	edge_profile = new_set(cmp_edgecount, 16);
 
-	irp_associate_blocks(&env);
-	free(env.counters);
+	unsigned id = 0;
+	for (size_t i = get_irp_n_irgs(); i-- > 0;) {
+		associate_counts(&cfgs[i], counters, &id);
+	}
+	xfree(counters);
+	free_irp_profile_cfgs(cfgs);
+
+	if (sites != NULL) {
+		ir_entity **const targets = collect_irp_call_targets();
+		call_profile = new_set(cmp_calltargets, 16);
+		associate_call_targets(calls, targets, sites);
+		DEL_ARR_F(targets);
+		xfree(sites);
+	}
+	DEL_ARR_F(calls);
 
 	/* register the vcg hook */
 	hook = dump_add_node_info_callback(dump_profile_node_info, NULL);
 	return 1;
 }
 
+/**
+ * The samples of a function in a sampled profile.
+ */
+typedef struct sample_function_t {
+	uint32_t  head;  /**< samples of the function entry */
+	int64_t  *lines; /**< samples per line offset, -1 if none */
+} sample_function_t;
+
+/**
+ * Reads a line of @p f onto @p obst, returns NULL at the end of the file.
+ */
+static char *read_line(FILE *const f, struct obstack *const obst)
+{
+	int c = fgetc(f);
+	if (c == EOF)
+		return NULL;
+	for (; c != EOF && c != '\n'; c = fgetc(f)) {
+		obstack_1grow(obst, c);
+	}
+	obstack_1grow(obst, '\0');
+	return (char*)obstack_finish(obst);
+}
+
+/**
+ * Parses a function header "name:total_samples:head_samples", returns false
+ * if the line is malformed.
+ */
+static bool parse_sample_header(char *const line, ident **const name,
+                                uint32_t *const head)
+{
+	char *const head_colon = strrchr(line, ':');
+	if (head_colon == NULL || head_colon == line)
+		return false;
+	*head_colon = '\0';
+	char *const total_colon = strrchr(line, ':');
+	if (total_colon == NULL || total_colon == line)
+		return false;
+	*total_colon = '\0';
+
+	char *end;
+	unsigned long long const value = strtoull(head_colon + 1, &end, 10);
+	*head = clamp_count(MIN(value, (unsigned long long)INT64_MAX));
+	*name = new_id_from_str(line);
+	return end != head_colon + 1;
+}
+
+/**
+ * Parses a body line "offset[.discriminator]: samples [targets...]" and
+ * records the samples of the line offset in @p fn. The discriminators
+ * distinguish blocks on the same line, which cannot be told apart by the
+ * source positions, so the maximum is used for all of them. Lines of inlined
+ * functions are no body lines, they have no sample count.
+ */
+static void parse_sample_line(char const *const line,
+                              sample_function_t *const fn)
+{
+	char *end;
+	unsigned long const offset = strtoul(line, &end, 10);
+	if (end == line)
+		return;
+	if (*end == '.')
+		(void)strtoul(end + 1, &end, 10);
+	if (*end != ':')
+		return;
+
+	char const *const value = end + 1;
+	unsigned long long const count = strtoull(value, &end, 10);
+	if (end == value || (*end != '\0' && *end != ' '))
+		return;
+
+	while (offset >= ARR_LEN(fn->lines)) {
+		ARR_APP1(int64_t, fn->lines, -1);
+	}
+	int64_t const samples = (int64_t)MIN(count, (unsigned long long)INT64_MAX);
+	if (samples > fn->lines[offset])
+		fn->lines[offset] = samples;
+}
+
+/**
+ * Parses a sampled profile in the text format of AutoFDO, returns a map of
+ * function names to sample_function_t or NULL if the file cannot be read.
+ */
+static pmap *parse_samples(const char *filename)
+{
+	FILE *const f = fopen(filename, "r");
+	if (!f) {
+		DBG((dbg, LEVEL_2, "Failed to open sample file (%s)\n", filename));
+		return NULL;
+	}
+
+	pmap              *const functions = pmap_create();
+	sample_function_t       *fn        = NULL;
+	size_t                   indent    = 0;
+	struct obstack           obst;
+	obstack_init(&obst);
+	for (char *line; (line = read_line(f, &obst)) != NULL;
+	     obstack_free(&obst, line)) {
+		size_t const line_indent = strspn(line, " \t");
+		char  *const content     = line + line_indent;
+		if (*content == '\0' || *content == '!')
+			continue;
+
+		if (line_indent == 0) {
+			ident    *name;
+			uint32_t  head;
+			if (!parse_sample_header(line, &name, &head)) {
+				DBG((dbg, LEVEL_2, "Broken function header in samples\n"));
+				fn = NULL;
+				continue;
+			}
+			/* the samples of a function may be split into several
+			 * entries */
+			fn = pmap_get(sample_function_t, functions, name);
+			if (fn == NULL) {
+				fn = XMALLOCZ(sample_function_t);
+				fn->lines = NEW_ARR_F(int64_t, 0);
+				pmap_insert(functions, name, fn);
+			}
+			fn->head += head;
+			indent    = 0;
+			continue;
+		}
+
+		if (fn == NULL)
+			continue;
+		/* deeper indented lines belong to inlined functions */
+		if (indent == 0)
+			indent = line_indent;
+		if (line_indent == indent)
+			parse_sample_line(content, fn);
+	}
+	obstack_free(&obst, NULL);
+	fclose(f);
+	return functions;
+}
+
+static void free_samples(pmap *const functions)
+{
+	foreach_pmap(functions, entry) {
+		sample_function_t *const fn = (sample_function_t*)entry->value;
+		DEL_ARR_F(fn->lines);
+		xfree(fn);
+	}
+	pmap_destroy(functions);
+}
+
+typedef struct block_samples_env_t {
+	sample_function_t const *fn;         /**< the samples of the function */
+	unsigned                 start_line; /**< the line of the function */
+	int64_t                 *samples;    /**< samples per vertex */
+} block_samples_env_t;
+
+/**
+ * Walker: The samples of a block are the maximum of the samples of the lines
+ * of its nodes.
+ */
+static void collect_block_samples(ir_node *const node, void *const data)
+{
+	if (is_Block(node) || is_irn_start_block_placed(node))
+		return;
+
+	block_samples_env_t *const env = (block_samples_env_t*)data;
+	src_loc_t            const loc = ir_retrieve_dbg_info(get_irn_dbg_info(node));
+	if (loc.line < env->start_line)
+		return;
+
+	size_t const offset = loc.line - env->start_line;
+	if (offset >= ARR_LEN(env->fn->lines))
+		return;
+
+	unsigned const v = get_block_vertex(get_nodes_block(node));
+	if (env->fn->lines[offset] > env->samples[v])
+		env->samples[v] = env->fn->lines[offset];
+}
+
+/**
+ * Associates the samples of @p fn with the edges and blocks of @p cfg. The
+ * samples of a block are the count of the edge to it if it has no other
+ * predecessor and of the edge from it if it has no other successor. The
+ * remaining edge counts are derived from flow conservation.
+ */
+static void associate_samples(profile_cfg_t *const cfg,
+                              sample_function_t const *const fn,
+                              unsigned const start_line)
+{
+	ir_graph *const irg        = get_irn_irg(cfg->blocks[0]);
+	size_t    const n_vertices = ARR_LEN(cfg->blocks);
+	size_t    const n_edges    = ARR_LEN(cfg->edges);
+	int64_t  *const samples    = XMALLOCN(int64_t, n_vertices);
+	unsigned *const n_preds    = XMALLOCNZ(unsigned, n_vertices);
+	for (size_t v = 0; v < n_vertices; ++v) {
+		samples[v] = -1;
+	}
+
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	for (size_t v = 0; v < n_vertices; ++v) {
+		set_irn_link(cfg->blocks[v], INT_TO_PTR(v));
+	}
+	block_samples_env_t env = {
+		.fn         = fn,
+		.start_line = start_line,
+		.samples    = samples,
+	};
+	irg_walk_graph(irg, NULL, collect_block_samples, &env);
+
+	unsigned const start = get_block_vertex(get_irg_start_block(irg));
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	samples[start] = MAX(samples[start], (int64_t)fn->head);
+
+	for (size_t e = 0; e < n_edges; ++e) {
+		++n_preds[cfg->edges[e].dst];
+	}
+	ir_node *const end_block = get_irg_end_block(irg);
+	for (size_t e = 0; e < n_edges; ++e) {
+		profile_edge_t *const edge = &cfg->edges[e];
+		edge->known = true;
+		if (edge->block != end_block && n_preds[edge->dst] == 1
+		    && samples[edge->dst] >= 0) {
+			edge->count = samples[edge->dst];
+		} else if (cfg->n_succs[edge->src] == 1 && samples[edge->src] >= 0) {
+			edge->count = samples[edge->src];
+		} else {
+			edge->known = false;
+		}
+	}
+	derive_edge_counts(cfg);
+
+	/* the count of a block are its samples if there are any, the sum of its
+	 * incoming edges otherwise */
+	int64_t *const block_counts = XMALLOCNZ(int64_t, n_vertices);
+	bool    *const complete     = XMALLOCN(bool, n_vertices);
+	for (size_t v = 0; v < n_vertices; ++v) {
+		complete[v] = n_preds[v] > 0;
+	}
+	for (size_t e = 0; e < n_edges; ++e) {
+		profile_edge_t const *const edge = &cfg->edges[e];
+		if (!edge->known) {
+			complete[edge->dst] = false;
+			continue;
+		}
+		block_counts[edge->dst] += edge->count;
+		if (edge->pos < 0)
+			continue;
+
+		edgecount_t const query = {
+			.block = get_irn_node_nr(edge->block),
+			.pos   = edge->pos,
+			.pred  = get_irn_node_nr(edge->pred),
+			.count = clamp_count(edge->count),
+		};
+		(void)set_insert(edgecount_t, edge_profile, &query, sizeof(query), hash_edgecount(&query));
+	}
+
+	for (size_t v = 0; v < n_vertices; ++v) {
+		int64_t const count = samples[v] >= 0 || !complete[v] ? samples[v]
+		                                                      : block_counts[v];
+		if (count < 0)
+			continue;
+
+		ir_node     *const bb    = cfg->blocks[v];
+		execcount_t  const query = {
+			.block = get_irn_node_nr(bb),
+			.count = clamp_count(count),
+		};
+		DBG((dbg, LEVEL_4, "execcount(%+F, %u): %u\n", bb, query.block, query.count));
+		execcount_t const *const ec
+			= set_insert(execcount_t, profile, &query, sizeof(query), query.block);
+		max_execcount = MAX(max_execcount, ec->count);
+	}
+	xfree(complete);
+	xfree(block_counts);
+	xfree(n_preds);
+	xfree(samples);
+}
+
+bool ir_profile_read_samples(const char *filename)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.ir.profile");
+
+	pmap *const functions = parse_samples(filename);
+	if (functions == NULL)
+		return false;
+
+	ir_profile_free();
+	profile      = new_set(cmp_execcount, 16);
+	edge_profile = new_set(cmp_edgecount, 16);
+
+	foreach_irp_irg(i, irg) {
+		/* the lines of the samples are relative to the function */
+		ir_entity         *const ent = get_irg_entity(irg);
+		sample_function_t *const fn  = pmap_get(sample_function_t, functions, get_entity_ld_ident(ent));
+		src_loc_t          const loc = ir_retrieve_dbg_info(get_entity_dbg_info(ent));
+		if (fn == NULL || loc.line == 0)
+			continue;
+
+		/* the estimated weights of the profile cfg are not needed */
+		profile_cfg_t cfg;
+		build_profile_cfg(irg, &cfg);
+		associate_samples(&cfg, fn, loc.line);
+		free_profile_cfg(&cfg);
+	}
+	free_samples(functions);
+
+	/* register the vcg hook */
+	hook = dump_add_node_info_callback(dump_profile_node_info, NULL);
+	return true;
+}
+
 typedef struct initialize_execfreq_env_t {
 	double freq_factor;
 } initialize_execfreq_env_t;
@@ -553,17 +1769,34 @@ static void initialize_execfreq(ir_node *block, void *data)
 	set_block_execfreq(block, freq);
 }
 
-static void ir_set_execfreqs_from_profile(ir_graph *irg)
+static void check_block_execcount(ir_node *block, void *data)
+{
+	bool    *const complete = (bool*)data;
+	uint32_t       count;
+	if (!ir_profile_find_block_execcount(block, &count))
+		*complete = false;
+}
+
+void ir_set_execfreqs_from_profile(ir_graph *irg)
 {
 	/* Find the first block containing instructions */
 	ir_node *const start_block = get_irg_start_block(irg);
-	unsigned const count       = ir_profile_get_block_execcount(start_block);
-	if (count == 0) {
+	uint32_t       count;
+	if (!ir_profile_find_block_execcount(start_block, &count) || count == 0) {
 		/* the function was never executed, so fallback to estimated freqs */
 		ir_estimate_execfreq(irg);
 		return;
 	}
 
+	/* Blocks created after the profile was recorded have no counts. The
+	 * estimation still uses the profiled probabilities of the known edges. */
+	bool complete = true;
+	irg_block_walk_graph(irg, check_block_execcount, NULL, &complete);
+	if (!complete) {
+		ir_estimate_execfreq(irg);
+		return;
+	}
+
 	initialize_execfreq_env_t env = { .freq_factor = 1.0 / count };
 	irg_block_walk_graph(irg, initialize_execfreq, NULL, &env);
 }
@@ -13,17 +13,42 @@
 #define FIRM_BE_BEPROFILE_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "firm_types.h"
 
+/**
+ * Kinds of profile counters.
+ */
+typedef enum ir_profile_counters_t {
+	IR_PROFILE_COUNTERS_PLAIN,        /**< plain increments, counts may get
+	                                       lost in multithreaded programs */
+	IR_PROFILE_COUNTERS_ATOMIC,       /**< relaxed atomic increments by
+	                                       __firmprof_increment() */
+	IR_PROFILE_COUNTERS_THREAD_LOCAL, /**< plain increments of a counter array
+	                                       per thread, which is merged when the
+	                                       thread exits */
+} ir_profile_counters_t;
+
+/** The number of most frequent targets recorded per indirect call. */
+#define IR_PROFILE_N_CALL_TARGETS 4
+
 /**
  * Instruments all irgs in the program with profile code.
- * The final code will have a counter for each basic block which is
- * incremented in that block. After the program has run the info is written
- * to @p filename.
+ * The final code counts the executions of the control flow edges outside of
+ * a spanning tree of each graph, the counts of the other edges and the blocks
+ * are derived from them. Optionally the most frequent targets of each
+ * indirect call are recorded, too. After the program has run the info is
+ * written to @p filename.
+ *
+ * @param filename      the name of the profile file
+ * @param kind          the kind of the counters
+ * @param call_targets  record the targets of indirect calls
  */
-ir_graph *ir_profile_instrument(const char *filename);
+ir_graph *ir_profile_instrument(const char *filename,
+                                ir_profile_counters_t kind,
+                                bool call_targets);
 
 /**
  * Reads the corresponding profile info file if it exists and returns a
@@ -32,6 +57,19 @@ ir_graph *ir_profile_instrument(const char *filename);
  */
 bool ir_profile_read(const char *filename);
 
+/**
+ * Reads a sampled profile in the text format of AutoFDO, like written by
+ * create_llvm_prof --format=text, instead of an instrumentation profile.
+ * The samples of the source lines are mapped to the blocks with the source
+ * positions of their nodes, the line offsets are relative to the line of the
+ * function entity. Blocks whose count follows neither from the samples nor
+ * from the flow conservation get no count.
+ *
+ * @param filename  the name of the file containing the samples
+ * @return false if the file cannot be read
+ */
+bool ir_profile_read_samples(const char *filename);
+
 /**
  * Frees the profile info
  */
@@ -42,6 +80,55 @@ void ir_profile_free(void);
  */
 uint32_t ir_profile_get_block_execcount(const ir_node *block);
 
+/**
+ * Get block execution count as determined by profiling.
+ *
+ * @param block  the block
+ * @param count  returns the execution count
+ * @return false if no profile is loaded or it contains no data for @p block
+ */
+bool ir_profile_find_block_execcount(const ir_node *block, uint32_t *count);
+
+/**
+ * Get the execution count of the control flow edge from predecessor @p pos
+ * of @p block as determined by profiling.
+ *
+ * @param block  the target block of the edge
+ * @param pos    the predecessor position of the edge
+ * @param count  returns the execution count
+ * @return false if no profile is loaded or it contains no data for the edge
+ */
+bool ir_profile_find_edge_execcount(const ir_node *block, int pos,
+                                    uint32_t *count);
+
+/**
+ * Get the most frequent targets of the indirect call @p call as determined
+ * by profiling, ordered by decreasing count. Only functions defined in the
+ * profiled compilation unit are identified as targets.
+ *
+ * @param call     the indirect call
+ * @param targets  returns up to IR_PROFILE_N_CALL_TARGETS targets
+ * @param counts   returns the number of calls of each target
+ * @param total    returns the number of executions of @p call
+ * @return the number of targets, 0 if there is no data for @p call or none
+ *         of its targets is known
+ */
+size_t ir_profile_get_call_targets(const ir_node *call, ir_entity **targets,
+                                   uint32_t *counts, uint32_t *total);
+
+/**
+ * Returns the highest block execution count of the loaded profile, 0 if no
+ * profile is loaded.
+ */
+uint32_t ir_profile_get_max_execcount(void);
+
+/**
+ * Sets the block execution frequencies of @p irg from the profile data.
+ * They are estimated if there is no profile data for the graph, using the
+ * profiled edge probabilities if the graph changed since profiling.
+ */
+void ir_set_execfreqs_from_profile(ir_graph *irg);
+
 /**
  * Initializes exec_freq structure for an irg based on profile data
  */
@@ -93,6 +93,8 @@ void free_ir_prog(void)
 	if (irp == NULL)
 		return;
 
+	ir_discard_lazy_irgs();
+
 	/* must iterate backwards here */
 	foreach_irp_irg_r(i, irg) {
 		free_ir_graph(irg);
@@ -119,7 +121,7 @@ void free_ir_prog(void)
 
 	irp->name           = NULL;
 	irp->const_code_irg = NULL;
-	free(irp);
+	xfree(irp);
 	irp = NULL;
 }
 
@@ -165,26 +167,35 @@ void add_irp_irg(ir_graph *irg)
 {
 	assert(irg != NULL);
 	assert(irp && irp->graphs);
+	irg->irp_pos = ARR_LEN(irp->graphs);
 	ARR_APP1(ir_graph *, irp->graphs, irg);
 }
 
 void remove_irp_irg(ir_graph *irg)
 {
-	size_t i, l;
-
 	assert(irg);
-	l = ARR_LEN(irp->graphs);
-	for (i = 0; i < l; ++i) {
-		if (irp->graphs[i] == irg) {
-			for (; i < l - 1; ++i) {
-				irp->graphs[i] = irp->graphs[i+1];
-			}
-			ARR_SETLEN(ir_graph*, irp->graphs, l - 1);
-			break;
-		}
+	/* the const code graph is not in the list */
+	size_t const pos = irg->irp_pos;
+	if (pos < ARR_LEN(irp->graphs) && irp->graphs[pos] == irg) {
+		irp->graphs[pos] = NULL;
+		++irp->n_removed_irgs;
 	}
 }
 
+void compact_irp_irgs(void)
+{
+	size_t n = 0;
+	for (size_t i = 0, l = ARR_LEN(irp->graphs); i < l; ++i) {
+		ir_graph *const irg = irp->graphs[i];
+		if (irg == NULL)
+			continue;
+		irg->irp_pos     = n;
+		irp->graphs[n++] = irg;
+	}
+	ARR_SETLEN(ir_graph*, irp->graphs, n);
+	irp->n_removed_irgs = 0;
+}
+
 size_t (get_irp_n_irgs)(void)
 {
 	return get_irp_n_irgs_();
@@ -204,6 +215,7 @@ void set_irp_irg(size_t pos, ir_graph *irg)
 {
 	assert(irp && irg);
 	assert(pos < ARR_LEN(irp->graphs));
+	irg->irp_pos     = pos;
 	irp->graphs[pos] = irg;
 }
 
@@ -211,24 +223,32 @@ void add_irp_type(ir_type *typ)
 {
 	assert(typ != NULL);
 	assert(irp);
+	typ->irp_pos = ARR_LEN(irp->types);
 	ARR_APP1(ir_type *, irp->types, typ);
 }
 
 void remove_irp_type(ir_type *typ)
 {
-	size_t i, l;
 	assert(typ);
+	size_t const pos = typ->irp_pos;
+	if (pos < ARR_LEN(irp->types) && irp->types[pos] == typ) {
+		irp->types[pos] = NULL;
+		++irp->n_removed_types;
+	}
+}
 
-	l = ARR_LEN(irp->types);
-	for (i = 0; i < l; ++i) {
-		if (irp->types[i] == typ) {
-			for (; i < l - 1; ++i) {
-				irp->types[i] = irp->types[i+1];
-			}
-			ARR_SETLEN(ir_type *, irp->types, l - 1);
-			break;
-		}
+void compact_irp_types(void)
+{
+	size_t n = 0;
+	for (size_t i = 0, l = ARR_LEN(irp->types); i < l; ++i) {
+		ir_type *const typ = irp->types[i];
+		if (typ == NULL)
+			continue;
+		typ->irp_pos    = n;
+		irp->types[n++] = typ;
 	}
+	ARR_SETLEN(ir_type*, irp->types, n);
+	irp->n_removed_types = 0;
 }
 
 size_t (get_irp_n_types) (void)
@@ -245,6 +265,7 @@ void set_irp_type(size_t pos, ir_type *typ)
 {
 	assert(irp && typ);
 	assert(pos < ARR_LEN((irp)->types));
+	typ->irp_pos    = pos;
 	irp->types[pos] = typ;
 }
 
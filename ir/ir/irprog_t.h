@@ -16,6 +16,7 @@
 
 #include "array.h"
 #include "callgraph.h"
+#include "compiler.h"
 #include "irmemory.h"
 #include "pmap.h"
 #include "typerep.h"
@@ -43,6 +44,10 @@ struct ir_prog {
 	ir_graph  *main_irg;            /**< The entry point to the compiled program
 	                                     or NULL if no point exists. */
 	ir_graph **graphs;              /**< A list of all graphs in the ir. */
+	size_t     n_lazy_irgs;         /**< graphs imported by ir_import_mmap()
+	                                     which are not constructed yet */
+	size_t     n_removed_irgs;      /**< NULL entries left in graphs by
+	                                     remove_irp_irg() */
 	pmap      *globals;             /**< Map identifiers to global entities. */
 	/** This graph holds nodes for global entity initialization expressions.
 	 * It is not a function. */
@@ -50,6 +55,8 @@ struct ir_prog {
 	ir_entity *unknown_entity;      /**< unique 'unknown'-entity */
 	ir_type   *segment_types[IR_SEGMENT_LAST+1];
 	ir_type  **types;               /**< A list of all types in the ir. */
+	size_t     n_removed_types;     /**< NULL entries left in types by
+	                                     remove_irp_type() */
 	ir_type   *code_type;           /**< unique 'code'-type */
 	ir_type   *unknown_type;        /**< unique 'unknown'-type */
 	ir_type   *dummy_owner;         /**< owner for internal entities */
@@ -93,25 +100,53 @@ static inline ir_type *get_tls_type_(void)
 	return get_segment_type_(IR_SEGMENT_THREAD_LOCAL);
 }
 
+/** Constructs all pending graphs of the current program, see
+ * ir_import_mmap(). */
+void ir_load_lazy_irgs(void);
+
+/** Drops the pending graphs of the current program without constructing
+ * them. */
+void ir_discard_lazy_irgs(void);
+
+/** Closes the gaps left by removed graphs, keeping the order of the others. */
+void compact_irp_irgs(void);
+
+/** Closes the gaps left by removed types, keeping the order of the others. */
+void compact_irp_types(void);
+
+/* Removed graphs and types leave a NULL entry, which is only dropped when the
+ * number of entries is queried next.  So a backwards walk over the list can
+ * remove the current entry, and a batch of removals costs a single pass. */
+
 static inline size_t get_irp_n_irgs_(void)
 {
+	if (UNLIKELY(irp->n_lazy_irgs != 0))
+		ir_load_lazy_irgs();
+	if (UNLIKELY(irp->n_removed_irgs != 0))
+		compact_irp_irgs();
 	return ARR_LEN(irp->graphs);
 }
 
 static inline ir_graph *get_irp_irg_(size_t pos)
 {
+	if (UNLIKELY(irp->n_lazy_irgs != 0))
+		ir_load_lazy_irgs();
 	assert(pos < ARR_LEN(irp->graphs));
+	assert(irp->graphs[pos] != NULL);
 	return irp->graphs[pos];
 }
 
 static inline size_t get_irp_n_types_(void)
 {
+	if (UNLIKELY(irp->n_removed_types != 0))
+		compact_irp_types();
 	return ARR_LEN(irp->types);
 }
 
 static inline ir_type *get_irp_type_(size_t pos)
 {
 	assert(pos < ARR_LEN(irp->types));
+	assert(irp->types[pos] != NULL);
 	/* Don't set the skip_tid result so that no double entries are generated. */
 	return irp->types[pos];
 }
@@ -186,15 +221,15 @@ void init_irprog_2(void);
 /** Adds type to the list of types in irp. */
 void add_irp_type(ir_type *typ);
 
-/** Removes type from the list of types, deallocates it and
-    shrinks the list by one. */
+/** Removes type from the list of types in constant time.  The order of the
+    remaining types is kept. */
 void remove_irp_type(ir_type *typ);
 
 /** Adds irg to the list of ir graphs in the current irp. */
 FIRM_API void add_irp_irg(ir_graph *irg);
 
-/** Removes irg from the list of irgs and
-    shrinks the list by one. */
+/** Removes irg from the list of irgs in constant time.  The order of the
+    remaining graphs is kept. */
 FIRM_API void remove_irp_irg(ir_graph *irg);
 
 #define foreach_irp_irg(idx, irg) \
@@ -0,0 +1,42 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief     Hash table of nodes used for global value numbering (CSE).
+ */
+#include <string.h>
+
+#include "irvaluetable.h"
+#include "irnode_t.h"
+#include "iropt_t.h"
+
+#define HashSet                   ir_valuetable_t
+#define HashSetEntry              ir_valuetable_entry_t
+#define HashSetIterator           ir_valuetable_iterator_t
+#define ValueType                 ir_node*
+#define NullValue                 NULL
+#define DeletedValue              ((ir_node*)-1)
+#define SCALAR_RETURN
+#define Hash(self,key)            ir_node_hash(key)
+#define KeysEqual(self,key1,key2) ((key1) == (key2) || !(self)->cmp((key1), (key2)))
+#define SetRangeEmpty(ptr,size)   memset(ptr, 0, (size) * sizeof((ptr)[0]))
+
+void ir_valuetable_init_size_(ir_valuetable_t *self, size_t expected_elements);
+#define hashset_init_size       ir_valuetable_init_size_
+#define hashset_destroy         ir_valuetable_destroy
+#define hashset_insert          ir_valuetable_insert
+#define hashset_size            ir_valuetable_size
+#define hashset_iterator_init   ir_valuetable_iterator_init
+#define hashset_iterator_next   ir_valuetable_iterator_next
+
+#include "hashset.c.h"
+
+void ir_valuetable_init_size(ir_valuetable_t *table, ir_valuetable_cmp_func cmp,
+                             size_t expected_elements)
+{
+	ir_valuetable_init_size_(table, expected_elements);
+	table->cmp = cmp;
+}
@@ -0,0 +1,117 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief     Hash table of nodes used for global value numbering (CSE).
+ *
+ * The table uses open addressing and stores the hash value of each node next
+ * to it. Probes compare the stored hash first, so nodes with a different hash
+ * are rejected without touching them, and growing the table never recomputes
+ * node hashes.
+ */
+#ifndef FIRM_IR_IRVALUETABLE_H
+#define FIRM_IR_IRVALUETABLE_H
+
+#include <stdbool.h>
+
+#include "firm_types.h"
+#include "xmalloc.h"
+
+/**
+ * Compares two nodes of a value table.
+ *
+ * @return 0 if the nodes compute the same value, non-zero otherwise
+ */
+typedef int (*ir_valuetable_cmp_func)(const ir_node *elt, const ir_node *key);
+
+#define HashSet          ir_valuetable_t
+#define HashSetEntry     ir_valuetable_entry_t
+#define HashSetIterator  ir_valuetable_iterator_t
+#define ValueType        ir_node*
+#define ADDITIONAL_DATA  ir_valuetable_cmp_func cmp;
+
+#include "hashset.h"
+
+#undef ADDITIONAL_DATA
+#undef ValueType
+#undef HashSetIterator
+#undef HashSetEntry
+#undef HashSet
+
+typedef struct ir_valuetable_t          ir_valuetable_t;
+typedef struct ir_valuetable_iterator_t ir_valuetable_iterator_t;
+
+/**
+ * Initializes a value table.
+ *
+ * @param table              Pointer to allocated space for the table
+ * @param cmp                The function deciding whether two nodes are equal
+ * @param expected_elements  Number of elements expected in the table (roughly)
+ */
+void ir_valuetable_init_size(ir_valuetable_t *table, ir_valuetable_cmp_func cmp,
+                             size_t expected_elements);
+
+/**
+ * Destroys a value table and frees the memory allocated for the hash table.
+ * The memory of the table itself is not freed.
+ */
+void ir_valuetable_destroy(ir_valuetable_t *table);
+
+/**
+ * Allocates memory for a value table and initializes it.
+ */
+static inline ir_valuetable_t *ir_valuetable_new(ir_valuetable_cmp_func cmp,
+                                                 size_t expected_elements)
+{
+	ir_valuetable_t *res = XMALLOC(ir_valuetable_t);
+	ir_valuetable_init_size(res, cmp, expected_elements);
+	return res;
+}
+
+/**
+ * Destroys a value table and frees the memory of the table itself.
+ */
+static inline void ir_valuetable_del(ir_valuetable_t *table)
+{
+	ir_valuetable_destroy(table);
+	xfree(table);
+}
+
+/**
+ * Inserts a node into a value table unless an equal node is already there.
+ *
+ * @param table  the value table
+ * @param node   the node to insert
+ * @return the equal node found in the table, or @p node if it was inserted
+ */
+ir_node *ir_valuetable_insert(ir_valuetable_t *table, ir_node *node);
+
+/**
+ * Returns the number of nodes in a value table.
+ */
+size_t ir_valuetable_size(const ir_valuetable_t *table);
+
+/**
+ * Initializes an iterator. Sets the iterator before the first element in the
+ * table.
+ */
+void ir_valuetable_iterator_init(ir_valuetable_iterator_t *iterator,
+                                 const ir_valuetable_t *table);
+
+/**
+ * Advances the iterator and returns the current element or NULL if all
+ * elements in the table have been processed.
+ * @attention It is not allowed to insert nodes while iterating.
+ */
+ir_node *ir_valuetable_iterator_next(ir_valuetable_iterator_t *iterator);
+
+#define foreach_ir_valuetable(table, irn, iter) \
+	for (bool irn##__once = true; irn##__once;) \
+		for (ir_valuetable_iterator_t iter; irn##__once;) \
+			for (ir_node *irn; irn##__once; irn##__once = false) \
+				for (ir_valuetable_iterator_init(&iter, table); (irn = ir_valuetable_iterator_next(&iter));)
+
+#endif
@@ -23,6 +23,9 @@
 #include "irflag_t.h"
 #include "irnodeset.h"
 #include "ircons.h"
+#include "irhooks.h"
+#include "raw_bitset.h"
+#include "util.h"
 
 static void warn(const ir_node *n, const char *format, ...)
 {
@@ -661,11 +664,17 @@ static int verify_node_Call(const ir_node *n)
 	return fine;
 }
 
+/** Vector modes support the lane-wise numeric operations. */
+static int mode_is_num_or_vector(const ir_mode *mode)
+{
+	return mode_is_num(mode) || mode_is_vector(mode);
+}
+
 static int verify_node_Add(const ir_node *n)
 {
 	bool     fine = true;
 	ir_mode *mode = get_irn_mode(n);
-	if (mode_is_num(mode)) {
+	if (mode_is_num_or_vector(mode)) {
 		fine &= check_mode_same_input(n, n_Add_left, "left");
 		fine &= check_mode_same_input(n, n_Add_right, "right");
 	} else if (mode_is_reference(mode)) {
@@ -683,7 +692,7 @@ static int verify_node_Add(const ir_node *n)
 			fine = false;
 		}
 	} else {
-		warn(n, "mode must be numeric or reference but is %+F", mode);
+		warn(n, "mode must be numeric, vector or reference but is %+F", mode);
 		fine = false;
 	}
 	return fine;
@@ -693,7 +702,7 @@ static int verify_node_Sub(const ir_node *n)
 {
 	bool     fine = true;
 	ir_mode *mode = get_irn_mode(n);
-	if (mode_is_num(mode)) {
+	if (mode_is_num_or_vector(mode)) {
 		ir_mode *mode_left = get_irn_mode(get_Sub_left(n));
 		if (mode_is_reference(mode_left)) {
 			fine &= check_input_func(n, n_Sub_left, "left", mode_is_reference, "reference");
@@ -714,14 +723,14 @@ static int verify_node_Sub(const ir_node *n)
 
 static int verify_node_Minus(const ir_node *n)
 {
-	bool fine = check_mode_func(n, mode_is_num, "numeric");
+	bool fine = check_mode_func(n, mode_is_num_or_vector, "numeric or vector");
 	fine &= check_mode_same_input(n, n_Minus_op, "op");
 	return fine;
 }
 
 static int verify_node_Mul(const ir_node *n)
 {
-	bool fine = check_mode_func(n, mode_is_num, "numeric");
+	bool fine = check_mode_func(n, mode_is_num_or_vector, "numeric or vector");
 	fine &= check_mode_same_input(n, n_Mul_left, "left");
 	fine &= check_mode_same_input(n, n_Mul_right, "right");
 	return fine;
@@ -763,14 +772,14 @@ static int verify_node_Mod(const ir_node *n)
 	return fine;
 }
 
-static int mode_is_intb(const ir_mode *mode)
+static int mode_is_intbv(const ir_mode *mode)
 {
-	return mode_is_int(mode) || mode == mode_b;
+	return mode_is_int(mode) || mode == mode_b || mode_is_vector(mode);
 }
 
 static int verify_node_And(const ir_node *n)
 {
-	bool fine = check_mode_func(n, mode_is_intb, "int or mode_b");
+	bool fine = check_mode_func(n, mode_is_intbv, "int, mode_b or vector");
 	fine &= check_mode_same_input(n, n_And_left, "left");
 	fine &= check_mode_same_input(n, n_And_right, "right");
 	return fine;
@@ -778,7 +787,7 @@ static int verify_node_And(const ir_node *n)
 
 static int verify_node_Or(const ir_node *n)
 {
-	bool fine = check_mode_func(n, mode_is_intb, "int or mode_b");
+	bool fine = check_mode_func(n, mode_is_intbv, "int, mode_b or vector");
 	fine &= check_mode_same_input(n, n_Or_left, "left");
 	fine &= check_mode_same_input(n, n_Or_right, "right");
 	return fine;
@@ -786,7 +795,7 @@ static int verify_node_Or(const ir_node *n)
 
 static int verify_node_Eor(const ir_node *n)
 {
-	bool fine = check_mode_func(n, mode_is_intb, "int or mode_b");
+	bool fine = check_mode_func(n, mode_is_intbv, "int, mode_b or vector");
 	fine &= check_mode_same_input(n, n_Eor_left, "left");
 	fine &= check_mode_same_input(n, n_Eor_right, "right");
 	return fine;
@@ -794,7 +803,7 @@ static int verify_node_Eor(const ir_node *n)
 
 static int verify_node_Not(const ir_node *n)
 {
-	bool fine = check_mode_func(n, mode_is_intb, "int or mode_b");
+	bool fine = check_mode_func(n, mode_is_intbv, "int, mode_b or vector");
 	fine &= check_mode_same_input(n, n_Not_op, "op");
 	return fine;
 }
@@ -1293,6 +1302,7 @@ static bool check_has_memory(ir_graph *irg)
 }
 
 static bool check_graph_properties(ir_graph *irg);
+static void clear_verify_changes(ir_graph *irg);
 
 int irg_verify(ir_graph *irg)
 {
@@ -1315,6 +1325,7 @@ int irg_verify(ir_graph *irg)
 		fine &= check_has_memory(irg);
 	}
 
+	clear_verify_changes(irg);
 	return fine;
 }
 
@@ -1491,3 +1502,187 @@ static bool check_graph_properties(ir_graph *irg)
 	check_consistent_out_edges(irg);
 	return properties_fine;
 }
+
+/**
+ * The nodes of a graph created or changed since its last verification.  They
+ * are recorded by index, so dead node elimination cannot leave dangling
+ * pointers behind.
+ */
+typedef struct verify_changes_t {
+	unsigned *indices;        /**< indices of the changed nodes */
+	unsigned *changed;        /**< bitset of the indices in indices */
+	unsigned  n_bits;         /**< size of the changed bitset */
+	unsigned  n_incremental;  /**< incremental verifications since the last
+	                               full one */
+} verify_changes_t;
+
+static unsigned     verify_full_interval = 16;
+static unsigned     n_tracked_graphs;
+static hook_entry_t new_node_hook;
+static hook_entry_t replace_hook;
+static hook_entry_t input_change_hook;
+
+void ir_set_verify_full_interval(unsigned interval)
+{
+	verify_full_interval = interval;
+}
+
+static void add_changed_node(verify_changes_t *changes, const ir_node *node)
+{
+	unsigned const idx = get_irn_idx(node);
+	if (idx >= changes->n_bits) {
+		unsigned const n_bits = MAX(idx + 1, 2 * changes->n_bits);
+		size_t   const old    = BITSET_SIZE_ELEMS(changes->n_bits);
+		size_t   const size   = BITSET_SIZE_ELEMS(n_bits);
+		changes->changed = XREALLOC(changes->changed, unsigned, size);
+		memset(changes->changed + old, 0, (size - old) * sizeof(unsigned));
+		changes->n_bits = n_bits;
+	}
+	if (rbitset_is_set(changes->changed, idx))
+		return;
+	rbitset_set(changes->changed, idx);
+	ARR_APP1(unsigned, changes->indices, idx);
+}
+
+static void mark_changed(const ir_node *node)
+{
+	verify_changes_t *const changes = get_irn_irg(node)->verify_changes;
+	if (changes != NULL)
+		add_changed_node(changes, node);
+}
+
+static void track_new_node(void *context, ir_node *node)
+{
+	(void)context;
+	mark_changed(node);
+}
+
+static void track_replace(void *context, ir_node *old_node, ir_node *new_node)
+{
+	(void)context;
+	(void)old_node;
+	if (new_node != NULL)
+		mark_changed(new_node);
+}
+
+static void track_input_change(void *context, ir_node *src, int pos,
+                                ir_node *tgt, ir_node *old_tgt)
+{
+	(void)context;
+	(void)pos;
+	(void)tgt;
+	(void)old_tgt;
+	mark_changed(src);
+}
+
+static void clear_changed_nodes(verify_changes_t *changes)
+{
+	for (size_t i = 0, n = ARR_LEN(changes->indices); i < n; ++i) {
+		rbitset_clear(changes->changed, changes->indices[i]);
+	}
+	ARR_SHRINKLEN(changes->indices, 0);
+}
+
+static void clear_verify_changes(ir_graph *irg)
+{
+	verify_changes_t *const changes = irg->verify_changes;
+	if (changes == NULL)
+		return;
+	clear_changed_nodes(changes);
+	changes->n_incremental = 0;
+}
+
+/** Returns the changed node with index @p idx if it is still alive. */
+static ir_node *get_changed_node(ir_graph *irg, unsigned idx)
+{
+	/* dead node elimination renumbers the nodes */
+	if (idx >= get_irg_last_idx(irg))
+		return NULL;
+	ir_node *const node = get_idx_irn(irg, idx);
+	if (node == NULL || is_Deleted(node) || !irn_visited(node))
+		return NULL;
+	return node;
+}
+
+/** Starts recording the changes of @p irg. */
+static void track_verify_changes(ir_graph *irg)
+{
+	verify_changes_t *const changes = XMALLOCZ(verify_changes_t);
+	changes->indices    = NEW_ARR_F(unsigned, 0);
+	irg->verify_changes = changes;
+
+	if (n_tracked_graphs++ == 0) {
+		new_node_hook.hook._hook_new_node         = track_new_node;
+		replace_hook.hook._hook_replace           = track_replace;
+		input_change_hook.hook._hook_input_change = track_input_change;
+		register_hook(hook_new_node,     &new_node_hook);
+		register_hook(hook_replace,      &replace_hook);
+		register_hook(hook_input_change, &input_change_hook);
+	}
+}
+
+void free_verify_changes(ir_graph *irg)
+{
+	verify_changes_t *const changes = irg->verify_changes;
+	if (changes == NULL)
+		return;
+	DEL_ARR_F(changes->indices);
+	xfree(changes->changed);
+	xfree(changes);
+	irg->verify_changes = NULL;
+
+	if (--n_tracked_graphs == 0) {
+		unregister_hook(hook_new_node,     &new_node_hook);
+		unregister_hook(hook_replace,      &replace_hook);
+		unregister_hook(hook_input_change, &input_change_hook);
+	}
+}
+
+int irg_verify_changed(ir_graph *irg)
+{
+	verify_changes_t *const changes = irg->verify_changes;
+	if (changes == NULL) {
+		track_verify_changes(irg);
+		return irg_verify(irg);
+	}
+	if (verify_full_interval != 0
+	    && ++changes->n_incremental >= verify_full_interval)
+		return irg_verify(irg);
+
+	/* like irg_verify(), only check nodes reachable from the anchors, dead
+	 * nodes may be left in any state */
+	irg_walk_anchors(irg, NULL, NULL, NULL);
+
+	/* the users of changed nodes are checked, too, as far as they are known */
+	if (edges_activated(irg)) {
+		for (size_t i = 0; i < ARR_LEN(changes->indices); ++i) {
+			ir_node *const node = get_changed_node(irg, changes->indices[i]);
+			if (node == NULL)
+				continue;
+			foreach_out_edge(node, edge) {
+				add_changed_node(changes, get_edge_src_irn(edge));
+			}
+		}
+	}
+
+	bool const check_dominance
+		= get_irg_pinned(irg) == op_pin_state_pinned
+		&& irg_has_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+	bool fine = true;
+	properties_fine = true;
+	n_returns       = 0;
+	for (size_t i = 0, n = ARR_LEN(changes->indices); i < n; ++i) {
+		ir_node *const node = get_changed_node(irg, changes->indices[i]);
+		if (node == NULL)
+			continue;
+		bool const node_fine = irn_verify(node);
+		fine &= node_fine;
+		if (node_fine && check_dominance)
+			fine &= check_dominance_for_node(node);
+		check_simple_properties(node, irg);
+	}
+	fine &= properties_fine;
+
+	clear_changed_nodes(changes);
+	return fine;
+}
@@ -18,4 +18,9 @@
  */
 void ir_register_verify_node_ops(void);
 
+/**
+ * Stops recording the changes of @p irg for irg_verify_changed().
+ */
+void free_verify_changes(ir_graph *irg);
+
 #endif
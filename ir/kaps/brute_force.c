@@ -10,9 +10,12 @@
  * @author  Sebastian Buchwald
  */
 #include <assert.h>
+#include <limits.h>
 #include <stdbool.h>
 
 #include "panic.h"
+#include "util.h"
+#include "xmalloc.h"
 
 #include "bucket.h"
 #include "brute_force.h"
@@ -32,6 +35,165 @@
 static int dump = 0;
 #endif
 
+/** Maximal number of nodes of a component, which is solved exactly. */
+#define MAX_COMPONENT_NODES       8
+/** Maximal number of edges of such a component. */
+#define MAX_COMPONENT_EDGES       (MAX_COMPONENT_NODES * (MAX_COMPONENT_NODES - 1) / 2)
+/** Maximal number of assignments enumerated for such a component. */
+#define MAX_COMPONENT_ASSIGNMENTS 4096
+
+/** A small connected component of the unreduced PBQP graph. */
+typedef struct component_t {
+	pbqp_node_t   *nodes[MAX_COMPONENT_NODES];
+	unsigned       n_nodes;
+	pbqp_matrix_t *edge_costs[MAX_COMPONENT_EDGES];
+	unsigned       edge_src[MAX_COMPONENT_EDGES]; /**< position of the source */
+	unsigned       edge_tgt[MAX_COMPONENT_EDGES]; /**< position of the target */
+	unsigned       n_edges;
+} component_t;
+
+static unsigned get_component_pos(component_t const *const comp,
+                                  pbqp_node_t const *const node)
+{
+	for (unsigned i = 0; i < comp->n_nodes; ++i) {
+		if (comp->nodes[i] == node)
+			return i;
+	}
+	return UINT_MAX;
+}
+
+/**
+ * Collects the component of @p node, returns false if it has too many nodes.
+ */
+static bool collect_component(component_t *const comp, pbqp_node_t *const node)
+{
+	comp->nodes[0] = node;
+	comp->n_nodes  = 1;
+	for (unsigned i = 0; i < comp->n_nodes; ++i) {
+		pbqp_node_t *const cur = comp->nodes[i];
+		for (unsigned e = 0, n = pbqp_node_get_degree(cur); e < n; ++e) {
+			pbqp_edge_t *const edge  = cur->edges[e];
+			pbqp_node_t *const other = edge->src == cur ? edge->tgt : edge->src;
+			if (get_component_pos(comp, other) != UINT_MAX)
+				continue;
+			if (comp->n_nodes == MAX_COMPONENT_NODES)
+				return false;
+			comp->nodes[comp->n_nodes++] = other;
+		}
+	}
+
+	/* Each edge is recorded once, at its source. */
+	comp->n_edges = 0;
+	for (unsigned i = 0; i < comp->n_nodes; ++i) {
+		pbqp_node_t *const cur = comp->nodes[i];
+		for (unsigned e = 0, n = pbqp_node_get_degree(cur); e < n; ++e) {
+			pbqp_edge_t *const edge = cur->edges[e];
+			if (edge->src != cur)
+				continue;
+			comp->edge_costs[comp->n_edges] = edge->costs;
+			comp->edge_src[comp->n_edges]   = i;
+			comp->edge_tgt[comp->n_edges]   = get_component_pos(comp, edge->tgt);
+			++comp->n_edges;
+		}
+	}
+	return true;
+}
+
+static num get_assignment_costs(component_t const *const comp,
+                                unsigned const *const selection, num const bound)
+{
+	num costs = 0;
+	for (unsigned i = 0; i < comp->n_nodes; ++i) {
+		costs = pbqp_add(costs, comp->nodes[i]->costs->entries[selection[i]]);
+		if (costs >= bound)
+			return INF_COSTS;
+	}
+	for (unsigned i = 0; i < comp->n_edges; ++i) {
+		pbqp_matrix_t const *const mat = comp->edge_costs[i];
+		unsigned const row = selection[comp->edge_src[i]];
+		unsigned const col = selection[comp->edge_tgt[i]];
+		costs = pbqp_add(costs, mat->entries[row * mat->cols + col]);
+		if (costs >= bound)
+			return INF_COSTS;
+	}
+	return costs;
+}
+
+bool apply_brute_force_component(pbqp_t *pbqp, pbqp_node_t *node)
+{
+	component_t comp;
+	if (!collect_component(&comp, node))
+		return false;
+
+	/* Only the alternatives with finite costs are enumerated. */
+	unsigned *alternatives[MAX_COMPONENT_NODES];
+	unsigned  n_alternatives[MAX_COMPONENT_NODES];
+	unsigned  n_assignments = 1;
+	for (unsigned i = 0; i < comp.n_nodes; ++i) {
+		vector_t const *const vec = comp.nodes[i]->costs;
+		alternatives[i]   = ALLOCAN(unsigned, vec->len);
+		n_alternatives[i] = 0;
+		for (unsigned a = 0; a < vec->len; ++a) {
+			if (vec->entries[a] != INF_COSTS)
+				alternatives[i][n_alternatives[i]++] = a;
+		}
+		if (n_alternatives[i] == 0
+		 || n_assignments > MAX_COMPONENT_ASSIGNMENTS / n_alternatives[i])
+			return false;
+		n_assignments *= n_alternatives[i];
+	}
+
+	unsigned pos[MAX_COMPONENT_NODES]       = { 0 };
+	unsigned selection[MAX_COMPONENT_NODES];
+	unsigned best[MAX_COMPONENT_NODES];
+	num      min = INF_COSTS;
+	for (unsigned i = 0; i < comp.n_nodes; ++i)
+		selection[i] = alternatives[i][0];
+	for (;;) {
+		num const costs = get_assignment_costs(&comp, selection, min);
+		if (costs < min) {
+			min = costs;
+			MEMCPY(best, selection, comp.n_nodes);
+		}
+
+		/* Advance to the next assignment. */
+		unsigned i = 0;
+		for (; i < comp.n_nodes; ++i) {
+			if (++pos[i] < n_alternatives[i]) {
+				selection[i] = alternatives[i][pos[i]];
+				break;
+			}
+			pos[i]       = 0;
+			selection[i] = alternatives[i][0];
+		}
+		if (i == comp.n_nodes)
+			break;
+	}
+
+	/* Leave infeasible components to the caller. */
+	if (min == INF_COSTS)
+		return false;
+
+#if KAPS_DUMP
+	if (pbqp->dump_file) {
+		char     txt[100];
+		sprintf(txt, "BF-Reduction of the component of Node n%u", node->index);
+		pbqp_dump_section(pbqp->dump_file, 2, txt);
+		pbqp_dump_graph(pbqp);
+	}
+#endif
+
+#if KAPS_STATISTIC
+	pbqp->num_bf++;
+#endif
+
+	/* Selecting an alternative adds the costs of the incident edges to the
+	 * neighbours, so the remaining selections keep their costs. */
+	for (unsigned i = 0; i < comp.n_nodes; ++i)
+		select_alternative(pbqp, comp.nodes[i], best[i]);
+	return true;
+}
+
 /* Forward declarations. */
 static void apply_Brute_Force(pbqp_t *pbqp);
 
@@ -60,6 +222,10 @@ static unsigned get_minimal_alternative(pbqp_t *pbqp, pbqp_node_t *node)
 	num       min          = INF_COSTS;
 	unsigned  bucket_index = node->bucket_index;
 
+	/* The copies are released with the obstack below, so they must not end
+	 * up in the free lists. */
+	++pbqp->pool_disabled;
+
 	for (unsigned node_index = 0; node_index < node_len; ++node_index) {
 		pbqp_node_bucket_t bucket_deg3;
 		num                value;
@@ -86,7 +252,7 @@ static unsigned get_minimal_alternative(pbqp_t *pbqp, pbqp_node_t *node)
 		bucket_red_length = node_bucket_get_length(reduced_bucket);
 
 		/* Select alternative and solve PBQP recursively. */
-		select_alternative(node_buckets[3][bucket_index], node_index);
+		select_alternative(pbqp, node_buckets[3][bucket_index], node_index);
 		apply_brute_force_reductions(pbqp);
 
 		value = determine_solution(pbqp);
@@ -117,6 +283,8 @@ static unsigned get_minimal_alternative(pbqp_t *pbqp, pbqp_node_t *node)
 		obstack_free(&pbqp->obstack, tmp);
 	}
 
+	--pbqp->pool_disabled;
+
 	return min_index;
 }
 
@@ -159,7 +327,7 @@ static void apply_Brute_Force(pbqp_t *pbqp)
 #endif
 
 	/* Now that we found the minimum set all other costs to infinity. */
-	select_alternative(node, min_index);
+	select_alternative(pbqp, node, min_index);
 }
 
 static void back_propagate_RI(pbqp_t *pbqp, pbqp_node_t *node)
@@ -259,7 +427,7 @@ static void back_propagate_RII(pbqp_t *pbqp, pbqp_node_t *node)
 	}
 #endif
 
-	obstack_free(&pbqp->obstack, vec);
+	vector_free(pbqp, vec);
 }
 
 static void back_propagate_brute_force(pbqp_t *pbqp)
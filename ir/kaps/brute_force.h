@@ -12,8 +12,17 @@
 #ifndef KAPS_BRUTE_FORCE_H
 #define KAPS_BRUTE_FORCE_H
 
+#include <stdbool.h>
+
 #include "pbqp_t.h"
 
 void solve_pbqp_brute_force(pbqp_t *pbqp);
 
+/**
+ * Solves the connected component of the unreduced node @p node exactly and
+ * selects the optimal alternatives of its nodes.  Only small components are
+ * solved, returns false if the component is too large.
+ */
+bool apply_brute_force_component(pbqp_t *pbqp, pbqp_node_t *node);
+
 #endif
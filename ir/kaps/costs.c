@@ -0,0 +1,257 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Min-plus kernels on contiguous PBQP cost arrays.
+ *
+ * With unsigned 32 bit costs INF_COSTS is the all ones pattern, so the
+ * saturating addition is min(x, ~y) + y and deleted entries can be masked to
+ * INF_COSTS with an or.  The kernels use the vector unit of the target for
+ * this and handle the remaining entries with scalar code.
+ */
+#include <assert.h>
+
+#include "costs.h"
+#include "vector.h"
+
+#if KAPS_USE_UNSIGNED && UINT_MAX == 0xFFFFFFFFu
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define COSTV_LANES 8
+
+typedef __m256i costv;
+
+static inline costv costv_load(num const *p)
+{
+	return _mm256_loadu_si256((__m256i const*)p);
+}
+
+static inline void costv_store(num *p, costv v)
+{
+	_mm256_storeu_si256((__m256i*)p, v);
+}
+
+static inline costv costv_set1(num x)     { return _mm256_set1_epi32((int)x); }
+static inline costv costv_sub(costv a, costv b) { return _mm256_sub_epi32(a, b); }
+static inline costv costv_min(costv a, costv b) { return _mm256_min_epu32(a, b); }
+static inline costv costv_eq(costv a, costv b)  { return _mm256_cmpeq_epi32(a, b); }
+static inline costv costv_or(costv a, costv b)  { return _mm256_or_si256(a, b); }
+static inline costv costv_and(costv a, costv b) { return _mm256_and_si256(a, b); }
+/** Returns b with the lanes selected by mask a cleared. */
+static inline costv costv_andnot(costv a, costv b) { return _mm256_andnot_si256(a, b); }
+
+static inline costv costv_add_sat(costv a, costv b)
+{
+	costv const not_b = _mm256_xor_si256(b, _mm256_set1_epi32(-1));
+	return _mm256_add_epi32(costv_min(a, not_b), b);
+}
+
+static inline num costv_hmin(costv v)
+{
+	__m128i m = _mm_min_epu32(_mm256_castsi256_si128(v),
+	                          _mm256_extracti128_si256(v, 1));
+	m = _mm_min_epu32(m, _mm_shuffle_epi32(m, 0x4E));
+	m = _mm_min_epu32(m, _mm_shuffle_epi32(m, 0xB1));
+	return (num)_mm_cvtsi128_si32(m);
+}
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+#define COSTV_LANES 4
+
+typedef __m128i costv;
+
+static inline costv costv_load(num const *p)
+{
+	return _mm_loadu_si128((__m128i const*)p);
+}
+
+static inline void costv_store(num *p, costv v)
+{
+	_mm_storeu_si128((__m128i*)p, v);
+}
+
+static inline costv costv_set1(num x)     { return _mm_set1_epi32((int)x); }
+static inline costv costv_sub(costv a, costv b) { return _mm_sub_epi32(a, b); }
+static inline costv costv_eq(costv a, costv b)  { return _mm_cmpeq_epi32(a, b); }
+static inline costv costv_or(costv a, costv b)  { return _mm_or_si128(a, b); }
+static inline costv costv_and(costv a, costv b) { return _mm_and_si128(a, b); }
+/** Returns b with the lanes selected by mask a cleared. */
+static inline costv costv_andnot(costv a, costv b) { return _mm_andnot_si128(a, b); }
+
+static inline costv costv_min(costv a, costv b)
+{
+#ifdef __SSE4_1__
+	return _mm_min_epu32(a, b);
+#else
+	/* SSE2 only compares signed, so flip the sign bits first. */
+	costv const sign = _mm_set1_epi32(INT_MIN);
+	costv const gt   = _mm_cmpgt_epi32(_mm_xor_si128(a, sign),
+	                                   _mm_xor_si128(b, sign));
+	return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+#endif
+}
+
+static inline costv costv_add_sat(costv a, costv b)
+{
+	costv const not_b = _mm_xor_si128(b, _mm_set1_epi32(-1));
+	return _mm_add_epi32(costv_min(a, not_b), b);
+}
+
+static inline num costv_hmin(costv v)
+{
+	v = costv_min(v, _mm_shuffle_epi32(v, 0x4E));
+	v = costv_min(v, _mm_shuffle_epi32(v, 0xB1));
+	return (num)_mm_cvtsi128_si32(v);
+}
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define COSTV_LANES 4
+
+typedef uint32x4_t costv;
+
+static inline costv costv_load(num const *p)    { return vld1q_u32(p); }
+static inline void  costv_store(num *p, costv v) { vst1q_u32(p, v); }
+static inline costv costv_set1(num x)           { return vdupq_n_u32(x); }
+static inline costv costv_sub(costv a, costv b) { return vsubq_u32(a, b); }
+static inline costv costv_min(costv a, costv b) { return vminq_u32(a, b); }
+static inline costv costv_eq(costv a, costv b)  { return vceqq_u32(a, b); }
+static inline costv costv_or(costv a, costv b)  { return vorrq_u32(a, b); }
+static inline costv costv_and(costv a, costv b) { return vandq_u32(a, b); }
+/** Returns b with the lanes selected by mask a cleared. */
+static inline costv costv_andnot(costv a, costv b) { return vbicq_u32(b, a); }
+static inline costv costv_add_sat(costv a, costv b) { return vqaddq_u32(a, b); }
+
+static inline num costv_hmin(costv v)
+{
+#ifdef __aarch64__
+	return vminvq_u32(v);
+#else
+	uint32x2_t m = vpmin_u32(vget_low_u32(v), vget_high_u32(v));
+	m = vpmin_u32(m, m);
+	return vget_lane_u32(m, 0);
+#endif
+}
+#endif
+#endif
+
+void costs_add(num *sum, num const *summand, unsigned len)
+{
+	unsigned i = 0;
+#ifdef COSTV_LANES
+	for (; i + COSTV_LANES <= len; i += COSTV_LANES) {
+		costv_store(&sum[i],
+		            costv_add_sat(costv_load(&sum[i]), costv_load(&summand[i])));
+	}
+#endif
+	for (; i < len; ++i) {
+		sum[i] = pbqp_add(sum[i], summand[i]);
+	}
+}
+
+void costs_add_value(num *costs, num value, unsigned len)
+{
+	unsigned i = 0;
+#ifdef COSTV_LANES
+	costv const values = costv_set1(value);
+	for (; i + COSTV_LANES <= len; i += COSTV_LANES) {
+		costv_store(&costs[i], costv_add_sat(costv_load(&costs[i]), values));
+	}
+#endif
+	for (; i < len; ++i) {
+		costs[i] = pbqp_add(costs[i], value);
+	}
+}
+
+void costs_min_elementwise(num *mins, num const *costs, unsigned len)
+{
+	unsigned i = 0;
+#ifdef COSTV_LANES
+	for (; i + COSTV_LANES <= len; i += COSTV_LANES) {
+		costv_store(&mins[i],
+		            costv_min(costv_load(&mins[i]), costv_load(&costs[i])));
+	}
+#endif
+	for (; i < len; ++i) {
+		if (costs[i] < mins[i])
+			mins[i] = costs[i];
+	}
+}
+
+num costs_min(num const *costs, unsigned len)
+{
+	num      min = INF_COSTS;
+	unsigned i   = 0;
+#ifdef COSTV_LANES
+	if (len >= COSTV_LANES) {
+		costv mins = costv_set1(INF_COSTS);
+		for (; i + COSTV_LANES <= len; i += COSTV_LANES) {
+			mins = costv_min(mins, costv_load(&costs[i]));
+		}
+		min = costv_hmin(mins);
+	}
+#endif
+	for (; i < len; ++i) {
+		if (costs[i] < min)
+			min = costs[i];
+	}
+	return min;
+}
+
+num costs_min_flagged(num const *costs, num const *flags, unsigned len)
+{
+	num      min = INF_COSTS;
+	unsigned i   = 0;
+#ifdef COSTV_LANES
+	if (len >= COSTV_LANES) {
+		costv const inf  = costv_set1(INF_COSTS);
+		costv       mins = inf;
+		for (; i + COSTV_LANES <= len; i += COSTV_LANES) {
+			/* Deleted entries become INF_COSTS and do not change the minimum. */
+			costv const deleted = costv_eq(costv_load(&flags[i]), inf);
+			mins = costv_min(mins, costv_or(costv_load(&costs[i]), deleted));
+		}
+		min = costv_hmin(mins);
+	}
+#endif
+	for (; i < len; ++i) {
+		if (flags[i] != INF_COSTS && costs[i] < min)
+			min = costs[i];
+	}
+	return min;
+}
+
+void costs_sub_value_flagged(num *costs, num const *flags, num value,
+                             unsigned len)
+{
+	unsigned i = 0;
+#ifdef COSTV_LANES
+	costv const inf    = costv_set1(INF_COSTS);
+	costv const values = costv_set1(value);
+	/* Only finite values leave infinite costs untouched. */
+	costv const keep_inf = costv_set1(value != INF_COSTS ? INF_COSTS : 0);
+	for (; i + COSTV_LANES <= len; i += COSTV_LANES) {
+		costv const elems   = costv_load(&costs[i]);
+		costv const keep    = costv_and(costv_eq(elems, inf), keep_inf);
+		costv const deleted = costv_eq(costv_load(&flags[i]), inf);
+		costv const diff    = costv_or(costv_and(keep, elems),
+		                               costv_andnot(keep, costv_sub(elems, values)));
+		costv_store(&costs[i], costv_andnot(deleted, diff));
+	}
+#endif
+	for (; i < len; ++i) {
+		if (flags[i] == INF_COSTS) {
+			costs[i] = 0;
+			continue;
+		}
+		/* inf - x = inf if x < inf */
+		if (costs[i] == INF_COSTS && value != INF_COSTS)
+			continue;
+		costs[i] -= value;
+	}
+}
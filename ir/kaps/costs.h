@@ -0,0 +1,38 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Min-plus kernels on contiguous PBQP cost arrays.
+ *
+ * All additions saturate at INF_COSTS like pbqp_add().  An entry of a flags
+ * array which is INF_COSTS marks the corresponding cost as virtually deleted.
+ */
+#ifndef KAPS_COSTS_H
+#define KAPS_COSTS_H
+
+#include "pbqp_t.h"
+
+/* sum[i] += summand[i] */
+void costs_add(num *sum, num const *summand, unsigned len);
+
+/* costs[i] += value */
+void costs_add_value(num *costs, num value, unsigned len);
+
+/* mins[i] = min(mins[i], costs[i]) */
+void costs_min_elementwise(num *mins, num const *costs, unsigned len);
+
+/* Returns the minimum of costs, INF_COSTS for an empty array. */
+num costs_min(num const *costs, unsigned len);
+
+/* Returns the minimum of the costs which are not deleted by flags. */
+num costs_min_flagged(num const *costs, num const *flags, unsigned len);
+
+/* Subtracts value from the costs, where inf - x = inf if x < inf.  Costs
+ * deleted by flags are set to 0. */
+void costs_sub_value_flagged(num *costs, num const *flags, num value,
+                             unsigned len);
+
+#endif
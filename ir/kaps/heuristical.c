@@ -13,6 +13,7 @@
 
 #include "adt/array.h"
 
+#include "brute_force.h"
 #include "bucket.h"
 #include "heuristical.h"
 #include "optimal.h"
@@ -35,6 +36,10 @@ static void apply_RN(pbqp_t *pbqp)
 	pbqp_node_t *node = get_node_with_max_degree();
 	assert(pbqp_node_get_degree(node) > 2);
 
+	/* Small components are solved exactly. */
+	if (apply_brute_force_component(pbqp, node))
+		return;
+
 #if KAPS_DUMP
 	if (pbqp->dump_file) {
 		char     txt[100];
@@ -60,7 +65,7 @@ static void apply_RN(pbqp_t *pbqp)
 #endif
 
 	/* Now that we found the local minimum set all other costs to infinity. */
-	select_alternative(node, min_index);
+	select_alternative(pbqp, node, min_index);
 }
 
 static void apply_heuristic_reductions(pbqp_t *pbqp)
@@ -13,6 +13,7 @@
 
 #include "adt/array.h"
 
+#include "brute_force.h"
 #include "bucket.h"
 #include "heuristical_co.h"
 #include "optimal.h"
@@ -27,25 +28,29 @@
 #include "pbqp_node_t.h"
 #include "vector.h"
 
-#include "plist.h"
 #include "timing.h"
 
-static void merge_into_RN_node(pbqp_t *pbqp, plist_t *rpeo)
+/** Position of the next node in the reverse perfect elimination order. */
+static size_t rpeo_pos;
+
+static void merge_into_RN_node(pbqp_t *pbqp, pbqp_node_t **rpeo)
 {
 	pbqp_node_t *node;
 
-	/* We want to reduce the first node in reverse perfect elimination order. */
+	/* We want to reduce the first node in reverse perfect elimination order.
+	 * The order is walked as a ring, so it stays intact after pbqp solving. */
+	size_t const n_nodes = ARR_LEN(rpeo);
 	do {
-		/* get first element from reverse perfect elimination order */
-		node = (pbqp_node_t *)plist_first(rpeo)->data;
-		/* remove element from reverse perfect elimination order */
-		plist_erase(rpeo, plist_first(rpeo));
-		/* insert node at the end of rpeo so the rpeo already exits after pbqp solving */
-		plist_insert_back(rpeo, node);
+		node     = rpeo[rpeo_pos];
+		rpeo_pos = rpeo_pos + 1 < n_nodes ? rpeo_pos + 1 : 0;
 	} while (node_is_reduced(node));
 
 	assert(pbqp_node_get_degree(node) > 2);
 
+	/* Small components are solved exactly. */
+	if (apply_brute_force_component(pbqp, node))
+		return;
+
 	/* Check whether we can merge a neighbor into the current node. */
 	apply_RM(pbqp, node);
 }
@@ -83,10 +88,10 @@ static void apply_RN_co(pbqp_t *pbqp)
 #endif
 
 	/* Now that we found the local minimum set all other costs to infinity. */
-	select_alternative(node, min_index);
+	select_alternative(pbqp, node, min_index);
 }
 
-static void apply_heuristic_reductions_co(pbqp_t *pbqp, plist_t *rpeo)
+static void apply_heuristic_reductions_co(pbqp_t *pbqp, pbqp_node_t **rpeo)
 {
 	#if KAPS_TIMING
 		/* create timers */
@@ -160,7 +165,7 @@ static void apply_heuristic_reductions_co(pbqp_t *pbqp, plist_t *rpeo)
 	}
 }
 
-void solve_pbqp_heuristical_co(pbqp_t *pbqp, plist_t *rpeo)
+void solve_pbqp_heuristical_co(pbqp_t *pbqp, pbqp_node_t **rpeo)
 {
 #ifndef NDEBUG
 	assert(pbqp);
@@ -169,6 +174,8 @@ void solve_pbqp_heuristical_co(pbqp_t *pbqp, plist_t *rpeo)
 	pbqp->solution = 0;
 #endif
 
+	rpeo_pos = 0;
+
 	/* Reduce nodes degree ... */
 	initial_simplify_edges(pbqp);
 
@@ -14,8 +14,10 @@
 
 #include "pbqp_t.h"
 
-#include "plist.h"
-
-void solve_pbqp_heuristical_co(pbqp_t *pbqp, plist_t *rpeo);
+/**
+ * Solves @p pbqp, @p rpeo is a flexible array holding the nodes in reverse
+ * perfect elimination order.
+ */
+void solve_pbqp_heuristical_co(pbqp_t *pbqp, pbqp_node_t **rpeo);
 
 #endif
@@ -21,9 +21,11 @@
 #include "pbqp_node_t.h"
 #include "vector.h"
 
-#include "plist.h"
 #include "timing.h"
 
+/** Position of the next node in the reverse perfect elimination order. */
+static size_t rpeo_pos;
+
 static void back_propagate_RI(pbqp_t *pbqp, pbqp_node_t *node)
 {
 	(void)pbqp;
@@ -111,7 +113,7 @@ static void back_propagate_RII(pbqp_t *pbqp, pbqp_node_t *node)
 	}
 #endif
 
-	obstack_free(&pbqp->obstack, vec);
+	vector_free(pbqp, vec);
 }
 
 static void back_propagate_RN(pbqp_t *pbqp, pbqp_node_t *node)
@@ -140,7 +142,7 @@ static void back_propagate_RN(pbqp_t *pbqp, pbqp_node_t *node)
 	}
 #endif
 
-	obstack_free(&pbqp->obstack, vec);
+	vector_free(pbqp, vec);
 }
 
 static void back_propagate_ld(pbqp_t *pbqp)
@@ -170,17 +172,16 @@ static void back_propagate_ld(pbqp_t *pbqp)
 	}
 }
 
-static void merge_into_RN_node(pbqp_t *pbqp, plist_t *rpeo)
+static void merge_into_RN_node(pbqp_t *pbqp, pbqp_node_t **rpeo)
 {
 	pbqp_node_t *node;
 
+	/* Walk the reverse perfect elimination order backwards as a ring, so it
+	 * stays intact after pbqp solving. */
+	size_t const n_nodes = ARR_LEN(rpeo);
 	do {
-		/* get last element from reverse perfect elimination order */
-		node = (pbqp_node_t *)plist_last(rpeo)->data;
-		/* remove element from reverse perfect elimination order */
-		plist_erase(rpeo, plist_last(rpeo));
-		/* insert node at the beginning of rpeo so the rpeo already exits after pbqp solving */
-		plist_insert_front(rpeo, node);
+		node     = rpeo[rpeo_pos];
+		rpeo_pos = rpeo_pos > 0 ? rpeo_pos - 1 : n_nodes - 1;
 	} while (node_is_reduced(node));
 
 	assert(pbqp_node_get_degree(node) > 2);
@@ -234,7 +235,7 @@ static void apply_RN_co_without_selection(pbqp_t *pbqp)
 	node_bucket_insert(&reduced_bucket, node);
 }
 
-static void apply_heuristic_reductions_co(pbqp_t *pbqp, plist_t *rpeo)
+static void apply_heuristic_reductions_co(pbqp_t *pbqp, pbqp_node_t **rpeo)
 {
 	#if KAPS_TIMING
 		/* create timers */
@@ -308,7 +309,7 @@ static void apply_heuristic_reductions_co(pbqp_t *pbqp, plist_t *rpeo)
 	}
 }
 
-void solve_pbqp_heuristical_co_ld(pbqp_t *pbqp, plist_t *rpeo)
+void solve_pbqp_heuristical_co_ld(pbqp_t *pbqp, pbqp_node_t **rpeo)
 {
 #ifndef NDEBUG
 	assert(pbqp);
@@ -317,6 +318,8 @@ void solve_pbqp_heuristical_co_ld(pbqp_t *pbqp, plist_t *rpeo)
 	pbqp->solution = 0;
 #endif
 
+	rpeo_pos = ARR_LEN(rpeo) - 1;
+
 	/* Reduce nodes degree ... */
 	initial_simplify_edges(pbqp);
 
@@ -6,8 +6,11 @@
 #define HEURISTICAL_CO_LD_H_
 
 #include "pbqp_t.h"
-#include "plist.h"
 
-void solve_pbqp_heuristical_co_ld(pbqp_t *pbqp, plist_t *rpeo);
+/**
+ * Solves @p pbqp with late decision, @p rpeo is a flexible array holding the
+ * nodes in reverse perfect elimination order.
+ */
+void solve_pbqp_heuristical_co_ld(pbqp_t *pbqp, pbqp_node_t **rpeo);
 
 #endif
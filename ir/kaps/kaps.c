@@ -66,6 +66,11 @@ pbqp_t *alloc_pbqp(unsigned number_nodes)
 	pbqp->dump_file    = NULL;
 #endif
 	pbqp->nodes        = OALLOCNZ(&pbqp->obstack, pbqp_node_t*, number_nodes);
+	pbqp->pool_disabled = 0;
+	for (unsigned i = 0; i < KAPS_SIZE_CLASSES; ++i) {
+		pbqp->free_matrices[i] = NULL;
+		pbqp->free_vectors[i]  = NULL;
+	}
 #if KAPS_STATISTIC
 	pbqp->num_bf       = 0;
 	pbqp->num_edges    = 0;
@@ -81,8 +86,14 @@ pbqp_t *alloc_pbqp(unsigned number_nodes)
 
 void free_pbqp(pbqp_t *pbqp)
 {
+	for (unsigned i = 0; i < KAPS_SIZE_CLASSES; ++i) {
+		if (pbqp->free_matrices[i] != NULL)
+			DEL_ARR_F(pbqp->free_matrices[i]);
+		if (pbqp->free_vectors[i] != NULL)
+			DEL_ARR_F(pbqp->free_vectors[i]);
+	}
 	obstack_free(&pbqp->obstack, NULL);
-	free(pbqp);
+	xfree(pbqp);
 }
 
 void add_node_costs(pbqp_t *pbqp, unsigned node_index, vector_t *costs)
@@ -114,6 +125,7 @@ void add_edge_costs(pbqp_t *pbqp, unsigned src_index, unsigned tgt_index,
 		}
 
 		add_node_costs(pbqp, src_index, diagonal);
+		vector_free(pbqp, diagonal);
 
 		return;
 	}
@@ -127,7 +139,7 @@ void add_edge_costs(pbqp_t *pbqp, unsigned src_index, unsigned tgt_index,
 	}
 
 	if (edge == NULL) {
-		alloc_edge(pbqp, src_index, tgt_index, costs);
+		alloc_edge(pbqp, src_index, tgt_index, pbqp_matrix_copy(pbqp, costs));
 	} else {
 		pbqp_matrix_add(edge->costs, costs);
 	}
@@ -12,17 +12,40 @@
 #include <assert.h>
 #include <string.h>
 
+#include "adt/array.h"
+#include "bitfiddle.h"
+
+#include "costs.h"
 #include "pbqp_t.h"
 #include "vector.h"
 #include "matrix.h"
 
+/**
+ * Returns an uninitialized matrix with room for @p length entries.  Matrices
+ * are recycled per power of two size class.
+ */
+static pbqp_matrix_t *get_matrix(pbqp_t *pbqp, unsigned length)
+{
+	unsigned        size_class = log2_ceil(length);
+	pbqp_matrix_t **free_list  = pbqp->free_matrices[size_class];
+	assert(size_class < KAPS_SIZE_CLASSES);
+
+	if (pbqp->pool_disabled == 0 && free_list != NULL && ARR_LEN(free_list) > 0) {
+		pbqp_matrix_t *mat = free_list[ARR_LEN(free_list) - 1];
+		ARR_SHRINKLEN(free_list, ARR_LEN(free_list) - 1);
+		return mat;
+	}
+
+	return (pbqp_matrix_t *)obstack_alloc(&pbqp->obstack, sizeof(pbqp_matrix_t) + (sizeof(num) << size_class));
+}
+
 pbqp_matrix_t *pbqp_matrix_alloc(pbqp_t *pbqp, unsigned rows, unsigned cols)
 {
 	assert(cols > 0);
 	assert(rows > 0);
 
 	unsigned length = rows * cols;
-	pbqp_matrix_t *mat = (pbqp_matrix_t *)obstack_alloc(&pbqp->obstack, sizeof(*mat) + sizeof(*mat->entries) * length);
+	pbqp_matrix_t *mat = get_matrix(pbqp, length);
 
 	mat->cols = cols;
 	mat->rows = rows;
@@ -31,11 +54,25 @@ pbqp_matrix_t *pbqp_matrix_alloc(pbqp_t *pbqp, unsigned rows, unsigned cols)
 	return mat;
 }
 
+void pbqp_matrix_free(pbqp_t *pbqp, pbqp_matrix_t *mat)
+{
+	/* Memory allocated while recycling is disabled is released by the
+	 * caller. */
+	if (pbqp->pool_disabled != 0)
+		return;
+
+	unsigned size_class = log2_ceil(mat->rows * mat->cols);
+	if (pbqp->free_matrices[size_class] == NULL)
+		pbqp->free_matrices[size_class] = NEW_ARR_F(pbqp_matrix_t *, 0);
+	ARR_APP1(pbqp_matrix_t *, pbqp->free_matrices[size_class], mat);
+}
+
 pbqp_matrix_t *pbqp_matrix_copy(pbqp_t *pbqp, pbqp_matrix_t *m)
 {
 	unsigned       len  = m->rows * m->cols;
-	pbqp_matrix_t *copy = (pbqp_matrix_t *)obstack_copy(&pbqp->obstack, m, sizeof(*copy) + sizeof(*copy->entries) * len);
-	assert(copy);
+	pbqp_matrix_t *copy = get_matrix(pbqp, len);
+
+	memcpy(copy, m, sizeof(*copy) + sizeof(*copy->entries) * len);
 
 	return copy;
 }
@@ -45,7 +82,7 @@ pbqp_matrix_t *pbqp_matrix_copy_and_transpose(pbqp_t *pbqp, pbqp_matrix_t *m)
 	unsigned       cols = m->cols;
 	unsigned       rows = m->rows;
 	unsigned       len  = rows * cols;
-	pbqp_matrix_t *copy = (pbqp_matrix_t *)obstack_alloc(&pbqp->obstack, sizeof(*copy) + sizeof(*copy->entries) * len);
+	pbqp_matrix_t *copy = get_matrix(pbqp, len);
 
 	for (unsigned i = 0; i < rows; ++i) {
 		for (unsigned j = 0; j < cols; ++j) {
@@ -61,12 +98,28 @@ pbqp_matrix_t *pbqp_matrix_copy_and_transpose(pbqp_t *pbqp, pbqp_matrix_t *m)
 
 void pbqp_matrix_transpose(pbqp_t *pbqp, pbqp_matrix_t *mat)
 {
-	unsigned       len = mat->rows * mat->cols;
+	unsigned len = mat->rows * mat->cols;
+
+	/* Square matrices (the common case for register allocation) are
+	 * transposed without any copy. */
+	if (mat->rows == mat->cols) {
+		unsigned n = mat->rows;
+
+		for (unsigned i = 0; i < n; ++i) {
+			for (unsigned j = i + 1; j < n; ++j) {
+				num tmp = mat->entries[i * n + j];
+				mat->entries[i * n + j] = mat->entries[j * n + i];
+				mat->entries[j * n + i] = tmp;
+			}
+		}
+		return;
+	}
+
 	pbqp_matrix_t *tmp = pbqp_matrix_copy_and_transpose(pbqp, mat);
 
 	memcpy(mat, tmp, sizeof(*mat) + sizeof(*mat->entries) * len);
 
-	obstack_free(&pbqp->obstack, tmp);
+	pbqp_matrix_free(pbqp, tmp);
 }
 
 void pbqp_matrix_add(pbqp_matrix_t *sum, pbqp_matrix_t *summand)
@@ -74,11 +127,7 @@ void pbqp_matrix_add(pbqp_matrix_t *sum, pbqp_matrix_t *summand)
 	assert(sum->cols == summand->cols);
 	assert(sum->rows == summand->rows);
 
-	unsigned len = sum->rows * sum->cols;
-
-	for (unsigned i = 0; i < len; ++i) {
-		sum->entries[i] = pbqp_add(sum->entries[i], summand->entries[i]);
-	}
+	costs_add(sum->entries, summand->entries, sum->rows * sum->cols);
 }
 
 void pbqp_matrix_set_col_value(pbqp_matrix_t *mat, unsigned col, num value)
@@ -121,7 +170,7 @@ num pbqp_matrix_get_col_min(pbqp_matrix_t *matrix, unsigned col_index, vector_t
 
 	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
 		/* Ignore virtual deleted columns. */
-		if (flags->entries[row_index].data == INF_COSTS) continue;
+		if (flags->entries[row_index] == INF_COSTS) continue;
 
 		num elem = matrix->entries[row_index * col_len + col_index];
 
@@ -133,6 +182,27 @@ num pbqp_matrix_get_col_min(pbqp_matrix_t *matrix, unsigned col_index, vector_t
 	return min;
 }
 
+void pbqp_matrix_get_col_mins(pbqp_matrix_t *matrix, vector_t *flags, num *mins)
+{
+	unsigned col_len = matrix->cols;
+	unsigned row_len = matrix->rows;
+
+	assert(row_len == flags->len);
+
+	/* Walk the rows instead of the columns, so the minima of all columns are
+	 * computed on contiguous memory. */
+	for (unsigned col_index = 0; col_index < col_len; ++col_index) {
+		mins[col_index] = INF_COSTS;
+	}
+	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
+		/* Ignore virtual deleted rows. */
+		if (flags->entries[row_index] == INF_COSTS) continue;
+
+		costs_min_elementwise(mins, &matrix->entries[row_index * col_len],
+		                      col_len);
+	}
+}
+
 unsigned pbqp_matrix_get_col_min_index(pbqp_matrix_t *matrix, unsigned col_index, vector_t *flags)
 {
 	unsigned min_index = 0;
@@ -144,7 +214,7 @@ unsigned pbqp_matrix_get_col_min_index(pbqp_matrix_t *matrix, unsigned col_index
 
 	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
 		/* Ignore virtual deleted columns. */
-		if (flags->entries[row_index].data == INF_COSTS) continue;
+		if (flags->entries[row_index] == INF_COSTS) continue;
 
 		num elem = matrix->entries[row_index * col_len + col_index];
 
@@ -166,7 +236,7 @@ void pbqp_matrix_sub_col_value(pbqp_matrix_t *matrix, unsigned col_index,
 	assert(row_len == flags->len);
 
 	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
-		if (flags->entries[row_index].data == INF_COSTS) {
+		if (flags->entries[row_index] == INF_COSTS) {
 			matrix->entries[row_index * col_len + col_index] = 0;
 			continue;
 		}
@@ -180,23 +250,13 @@ void pbqp_matrix_sub_col_value(pbqp_matrix_t *matrix, unsigned col_index,
 
 num pbqp_matrix_get_row_min(pbqp_matrix_t *matrix, unsigned row_index, vector_t *flags)
 {
-	num      min = INF_COSTS;
 	unsigned len = flags->len;
 
 	assert(matrix->cols == len);
 
-	for (unsigned col_index = 0; col_index < len; ++col_index) {
-		/* Ignore virtual deleted columns. */
-		if (flags->entries[col_index].data == INF_COSTS) continue;
-
-		num elem = matrix->entries[row_index * len + col_index];
-
-		if (elem < min) {
-			min = elem;
-		}
-	}
-
-	return min;
+	/* Ignore virtual deleted columns. */
+	return costs_min_flagged(&matrix->entries[row_index * len], flags->entries,
+	                         len);
 }
 
 unsigned pbqp_matrix_get_row_min_index(pbqp_matrix_t *matrix, unsigned row_index, vector_t *flags)
@@ -209,7 +269,7 @@ unsigned pbqp_matrix_get_row_min_index(pbqp_matrix_t *matrix, unsigned row_index
 
 	for (unsigned col_index = 0; col_index < len; ++col_index) {
 		/* Ignore virtual deleted columns. */
-		if (flags->entries[col_index].data == INF_COSTS) continue;
+		if (flags->entries[col_index] == INF_COSTS) continue;
 
 		num elem = matrix->entries[row_index * len + col_index];
 
@@ -229,17 +289,8 @@ void pbqp_matrix_sub_row_value(pbqp_matrix_t *matrix, unsigned row_index,
 
 	assert(col_len == flags->len);
 
-	for (unsigned col_index = 0; col_index < col_len; ++col_index) {
-		if (flags->entries[col_index].data == INF_COSTS) {
-			matrix->entries[row_index * col_len + col_index] = 0;
-			continue;
-		}
-		/* inf - x = inf if x < inf */
-		if (matrix->entries[row_index * col_len + col_index] == INF_COSTS && value
-				!= INF_COSTS)
-			continue;
-		matrix->entries[row_index * col_len + col_index] -= value;
-	}
+	costs_sub_value_flagged(&matrix->entries[row_index * col_len],
+	                        flags->entries, value, col_len);
 }
 
 int pbqp_matrix_is_zero(pbqp_matrix_t *mat, vector_t *src_vec, vector_t *tgt_vec)
@@ -251,11 +302,11 @@ int pbqp_matrix_is_zero(pbqp_matrix_t *mat, vector_t *src_vec, vector_t *tgt_vec
 	assert(row_len == src_vec->len);
 
 	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
-		if (src_vec->entries[row_index].data == INF_COSTS)
+		if (src_vec->entries[row_index] == INF_COSTS)
 			continue;
 
 		for (unsigned col_index = 0; col_index < col_len; ++col_index) {
-			if (tgt_vec->entries[col_index].data == INF_COSTS)
+			if (tgt_vec->entries[col_index] == INF_COSTS)
 				continue;
 
 			if (mat->entries[row_index * col_len + col_index] != 0) {
@@ -275,12 +326,8 @@ void pbqp_matrix_add_to_all_cols(pbqp_matrix_t *mat, vector_t *vec)
 	assert(row_len == vec->len);
 
 	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
-		num value = vec->entries[row_index].data;
-
-		for (unsigned col_index = 0; col_index < col_len; ++col_index) {
-			mat->entries[row_index * col_len + col_index] = pbqp_add(
-					mat->entries[row_index * col_len + col_index], value);
-		}
+		costs_add_value(&mat->entries[row_index * col_len],
+		                vec->entries[row_index], col_len);
 	}
 }
 
@@ -292,10 +339,6 @@ void pbqp_matrix_add_to_all_rows(pbqp_matrix_t *mat, vector_t *vec)
 	assert(col_len == vec->len);
 
 	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
-		for (unsigned col_index = 0; col_index < col_len; ++col_index) {
-			num value = vec->entries[col_index].data;
-
-			mat->entries[row_index * col_len + col_index] = pbqp_add(mat->entries[row_index * col_len + col_index], value);
-		}
+		costs_add(&mat->entries[row_index * col_len], vec->entries, col_len);
 	}
 }
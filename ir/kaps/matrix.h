@@ -16,6 +16,9 @@
 
 pbqp_matrix_t *pbqp_matrix_alloc(pbqp_t *pbqp, unsigned rows, unsigned cols);
 
+/* Recycle the given matrix for later allocations. */
+void pbqp_matrix_free(pbqp_t *pbqp, pbqp_matrix_t *mat);
+
 /* Copy the given matrix. */
 pbqp_matrix_t *pbqp_matrix_copy(pbqp_t *pbqp, pbqp_matrix_t *m);
 
@@ -31,6 +34,9 @@ void pbqp_matrix_set(pbqp_matrix_t *mat, unsigned row, unsigned col, num value);
 num pbqp_matrix_get_col_min(pbqp_matrix_t *matrix, unsigned col_index, vector_t *flags);
 num pbqp_matrix_get_row_min(pbqp_matrix_t *matrix, unsigned row_index, vector_t *flags);
 
+/* Stores the result of pbqp_matrix_get_col_min() for every column in mins. */
+void pbqp_matrix_get_col_mins(pbqp_matrix_t *matrix, vector_t *flags, num *mins);
+
 unsigned pbqp_matrix_get_col_min_index(pbqp_matrix_t *matrix, unsigned col_index, vector_t *flags);
 unsigned pbqp_matrix_get_row_min_index(pbqp_matrix_t *matrix, unsigned row_index, vector_t *flags);
 
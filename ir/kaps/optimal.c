@@ -132,14 +132,14 @@ static void normalize_towards_source(pbqp_edge_t *edge)
 		num min = pbqp_matrix_get_row_min(mat, src_index, tgt_vec);
 
 		if (min != 0) {
-			if (src_vec->entries[src_index].data == INF_COSTS) {
+			if (src_vec->entries[src_index] == INF_COSTS) {
 				pbqp_matrix_set_row_value(mat, src_index, 0);
 				continue;
 			}
 
 			pbqp_matrix_sub_row_value(mat, src_index, tgt_vec, min);
-			src_vec->entries[src_index].data = pbqp_add(
-					src_vec->entries[src_index].data, min);
+			src_vec->entries[src_index] = pbqp_add(
+					src_vec->entries[src_index], min);
 
 			if (min == INF_COSTS) {
 				new_infinity = 1;
@@ -174,19 +174,24 @@ static void normalize_towards_target(pbqp_edge_t *edge)
 	assert(tgt_len > 0);
 
 
+	/* Subtracting from one column does not change the minima of the other
+	 * columns, so compute them all at once. */
+	num *mins = ALLOCAN(num, tgt_len);
+	pbqp_matrix_get_col_mins(mat, src_vec, mins);
+
 	/* Normalize towards target node. */
 	for (unsigned tgt_index = 0; tgt_index < tgt_len; ++tgt_index) {
-		num min = pbqp_matrix_get_col_min(mat, tgt_index, src_vec);
+		num min = mins[tgt_index];
 
 		if (min != 0) {
-			if (tgt_vec->entries[tgt_index].data == INF_COSTS) {
+			if (tgt_vec->entries[tgt_index] == INF_COSTS) {
 				pbqp_matrix_set_col_value(mat, tgt_index, 0);
 				continue;
 			}
 
 			pbqp_matrix_sub_col_value(mat, tgt_index, src_vec, min);
-			tgt_vec->entries[tgt_index].data = pbqp_add(
-					tgt_vec->entries[tgt_index].data, min);
+			tgt_vec->entries[tgt_index] = pbqp_add(
+					tgt_vec->entries[tgt_index], min);
 
 			if (min == INF_COSTS) {
 				new_infinity = 1;
@@ -231,13 +236,13 @@ static void merge_source_into_target(pbqp_t *pbqp, pbqp_edge_t *edge)
 
 	/* Check that each column has at most one zero entry. */
 	for (unsigned tgt_index = 0; tgt_index < tgt_len; ++tgt_index) {
-		if (tgt_vec->entries[tgt_index].data == INF_COSTS)
+		if (tgt_vec->entries[tgt_index] == INF_COSTS)
 			continue;
 
 		unsigned onlyOneZero = 0;
 
 		for (unsigned src_index = 0; src_index < src_len; ++src_index) {
-			if (src_vec->entries[src_index].data == INF_COSTS)
+			if (src_vec->entries[src_index] == INF_COSTS)
 				continue;
 
 			if (mat->entries[src_index * tgt_len + tgt_index] == INF_COSTS)
@@ -295,13 +300,13 @@ static void merge_source_into_target(pbqp_t *pbqp, pbqp_edge_t *edge)
 		/* Source node selects the column of the old_matrix. */
 		if (old_edge->tgt == src_node) {
 			for (unsigned tgt_index = 0; tgt_index < tgt_len; ++tgt_index) {
-				if (tgt_vec->entries[tgt_index].data == INF_COSTS)
+				if (tgt_vec->entries[tgt_index] == INF_COSTS)
 					continue;
 
 				unsigned src_index = mapping[tgt_index];
 
 				for (unsigned other_index = 0; other_index < other_len; ++other_index) {
-					if (other_vec->entries[other_index].data == INF_COSTS)
+					if (other_vec->entries[other_index] == INF_COSTS)
 						continue;
 
 					new_matrix->entries[tgt_index * other_len + other_index] = old_matrix->entries[other_index * src_len + src_index];
@@ -310,13 +315,13 @@ static void merge_source_into_target(pbqp_t *pbqp, pbqp_edge_t *edge)
 		} else {
 			/* Source node selects the row of the old_matrix. */
 			for (unsigned tgt_index = 0; tgt_index < tgt_len; ++tgt_index) {
-				if (tgt_vec->entries[tgt_index].data == INF_COSTS)
+				if (tgt_vec->entries[tgt_index] == INF_COSTS)
 					continue;
 
 				unsigned src_index = mapping[tgt_index];
 
 				for (unsigned other_index = 0; other_index < other_len; ++other_index) {
-					if (other_vec->entries[other_index].data == INF_COSTS)
+					if (other_vec->entries[other_index] == INF_COSTS)
 						continue;
 
 					new_matrix->entries[tgt_index * other_len + other_index] = old_matrix->entries[src_index * other_len + other_index];
@@ -327,13 +332,14 @@ static void merge_source_into_target(pbqp_t *pbqp, pbqp_edge_t *edge)
 		pbqp_edge_t *new_edge = get_edge(pbqp, tgt_node->index, other_node->index);
 
 		add_edge_costs(pbqp, tgt_node->index, other_node->index, new_matrix);
+		pbqp_matrix_free(pbqp, new_matrix);
 
 		if (new_edge == NULL) {
 			reorder_node_after_edge_insertion(tgt_node);
 			reorder_node_after_edge_insertion(other_node);
 		}
 
-		delete_edge(old_edge);
+		delete_edge(pbqp, old_edge);
 
 		new_edge = get_edge(pbqp, tgt_node->index, other_node->index);
 		simplify_edge(pbqp, new_edge);
@@ -371,13 +377,13 @@ static void merge_target_into_source(pbqp_t *pbqp, pbqp_edge_t *edge)
 
 	/* Check that each row has at most one zero entry. */
 	for (unsigned src_index = 0; src_index < src_len; ++src_index) {
-		if (src_vec->entries[src_index].data == INF_COSTS)
+		if (src_vec->entries[src_index] == INF_COSTS)
 			continue;
 
 		unsigned onlyOneZero = 0;
 
 		for (unsigned tgt_index = 0; tgt_index < tgt_len; ++tgt_index) {
-			if (tgt_vec->entries[tgt_index].data == INF_COSTS)
+			if (tgt_vec->entries[tgt_index] == INF_COSTS)
 				continue;
 
 			if (mat->entries[src_index * tgt_len + tgt_index] == INF_COSTS)
@@ -435,13 +441,13 @@ static void merge_target_into_source(pbqp_t *pbqp, pbqp_edge_t *edge)
 		/* Target node selects the column of the old_matrix. */
 		if (old_edge->tgt == tgt_node) {
 			for (unsigned src_index = 0; src_index < src_len; ++src_index) {
-				if (src_vec->entries[src_index].data == INF_COSTS)
+				if (src_vec->entries[src_index] == INF_COSTS)
 					continue;
 
 				unsigned tgt_index = mapping[src_index];
 
 				for (unsigned other_index = 0; other_index < other_len; ++other_index) {
-					if (other_vec->entries[other_index].data == INF_COSTS)
+					if (other_vec->entries[other_index] == INF_COSTS)
 						continue;
 
 					new_matrix->entries[src_index * other_len + other_index] = old_matrix->entries[other_index * tgt_len + tgt_index];
@@ -450,13 +456,13 @@ static void merge_target_into_source(pbqp_t *pbqp, pbqp_edge_t *edge)
 		} else {
 			/* Source node selects the row of the old_matrix. */
 			for (unsigned src_index = 0; src_index < src_len; ++src_index) {
-				if (src_vec->entries[src_index].data == INF_COSTS)
+				if (src_vec->entries[src_index] == INF_COSTS)
 					continue;
 
 				unsigned tgt_index = mapping[src_index];
 
 				for (unsigned other_index = 0; other_index < other_len; ++other_index) {
-					if (other_vec->entries[other_index].data == INF_COSTS)
+					if (other_vec->entries[other_index] == INF_COSTS)
 						continue;
 
 					new_matrix->entries[src_index * other_len + other_index] = old_matrix->entries[tgt_index * other_len + other_index];
@@ -467,13 +473,14 @@ static void merge_target_into_source(pbqp_t *pbqp, pbqp_edge_t *edge)
 		pbqp_edge_t *new_edge = get_edge(pbqp, src_node->index, other_node->index);
 
 		add_edge_costs(pbqp, src_node->index, other_node->index, new_matrix);
+		pbqp_matrix_free(pbqp, new_matrix);
 
 		if (new_edge == NULL) {
 			reorder_node_after_edge_insertion(src_node);
 			reorder_node_after_edge_insertion(other_node);
 		}
 
-		delete_edge(old_edge);
+		delete_edge(pbqp, old_edge);
 
 		new_edge = get_edge(pbqp, src_node->index, other_node->index);
 		simplify_edge(pbqp, new_edge);
@@ -613,7 +620,7 @@ void simplify_edge(pbqp_t *pbqp, pbqp_edge_t *edge)
 		pbqp->num_edges++;
 #endif
 
-		delete_edge(edge);
+		delete_edge(pbqp, edge);
 	}
 }
 
@@ -693,7 +700,7 @@ num determine_solution(pbqp_t *pbqp)
 		pbqp_node_t *node = node_buckets[0][node_index];
 
 		node->solution = vector_get_min_index(node->costs);
-		solution       = pbqp_add(solution, node->costs->entries[node->solution].data);
+		solution       = pbqp_add(solution, node->costs->entries[node->solution]);
 
 #if KAPS_DUMP
 		if (file) {
@@ -810,7 +817,7 @@ static void back_propagate_RII(pbqp_t *pbqp, pbqp_node_t *node)
 	}
 #endif
 
-	obstack_free(&pbqp->obstack, vec);
+	vector_free(pbqp, vec);
 }
 
 void back_propagate(pbqp_t *pbqp)
@@ -987,7 +994,7 @@ void apply_RII(pbqp_t *pbqp)
 
 			mat->entries[row_index * col_len + col_index] = vector_get_min(vec);
 
-			obstack_free(&pbqp->obstack, vec);
+			vector_free(pbqp, vec);
 		}
 	}
 
@@ -1011,7 +1018,7 @@ void apply_RII(pbqp_t *pbqp)
 		pbqp_matrix_add(edge->costs, mat);
 
 		/* Free local matrix. */
-		obstack_free(&pbqp->obstack, mat);
+		pbqp_matrix_free(pbqp, mat);
 
 		reorder_node_after_edge_deletion(src_node);
 		reorder_node_after_edge_deletion(tgt_node);
@@ -1028,7 +1035,7 @@ void apply_RII(pbqp_t *pbqp)
 	simplify_edge(pbqp, edge);
 }
 
-static void select_column(pbqp_edge_t *edge, unsigned col_index)
+static void select_column(pbqp_t *pbqp, pbqp_edge_t *edge, unsigned col_index)
 {
 	pbqp_node_t *src_node = edge->src;
 	pbqp_node_t *tgt_node = edge->tgt;
@@ -1047,10 +1054,10 @@ static void select_column(pbqp_edge_t *edge, unsigned col_index)
 		num elem = mat->entries[src_index * tgt_len + col_index];
 
 		if (elem != 0) {
-			if (elem == INF_COSTS && src_vec->entries[src_index].data != INF_COSTS)
+			if (elem == INF_COSTS && src_vec->entries[src_index] != INF_COSTS)
 				new_infinity = 1;
 
-			src_vec->entries[src_index].data = pbqp_add(src_vec->entries[src_index].data, elem);
+			src_vec->entries[src_index] = pbqp_add(src_vec->entries[src_index], elem);
 		}
 	}
 
@@ -1066,10 +1073,10 @@ static void select_column(pbqp_edge_t *edge, unsigned col_index)
 		}
 	}
 
-	delete_edge(edge);
+	delete_edge(pbqp, edge);
 }
 
-static void select_row(pbqp_edge_t *edge, unsigned row_index)
+static void select_row(pbqp_t *pbqp, pbqp_edge_t *edge, unsigned row_index)
 {
 	pbqp_matrix_t *mat          = edge->costs;
 	pbqp_node_t   *tgt_node     = edge->tgt;
@@ -1083,10 +1090,10 @@ static void select_row(pbqp_edge_t *edge, unsigned row_index)
 		num elem = mat->entries[row_index * tgt_len + tgt_index];
 
 		if (elem != 0) {
-			if (elem == INF_COSTS && tgt_vec->entries[tgt_index].data != INF_COSTS)
+			if (elem == INF_COSTS && tgt_vec->entries[tgt_index] != INF_COSTS)
 				new_infinity = 1;
 
-			tgt_vec->entries[tgt_index].data = pbqp_add(tgt_vec->entries[tgt_index].data, elem);
+			tgt_vec->entries[tgt_index] = pbqp_add(tgt_vec->entries[tgt_index], elem);
 		}
 	}
 
@@ -1102,10 +1109,11 @@ static void select_row(pbqp_edge_t *edge, unsigned row_index)
 		}
 	}
 
-	delete_edge(edge);
+	delete_edge(pbqp, edge);
 }
 
-void select_alternative(pbqp_node_t *node, unsigned selected_index)
+void select_alternative(pbqp_t *pbqp, pbqp_node_t *node,
+                        unsigned selected_index)
 {
 	unsigned  max_degree = pbqp_node_get_degree(node);
 	vector_t *node_vec   = node->costs;
@@ -1117,7 +1125,7 @@ void select_alternative(pbqp_node_t *node, unsigned selected_index)
 	/* Set all other costs to infinity. */
 	for (unsigned node_index = 0; node_index < node_len; ++node_index) {
 		if (node_index != selected_index) {
-			node_vec->entries[node_index].data = INF_COSTS;
+			node_vec->entries[node_index] = INF_COSTS;
 		}
 	}
 
@@ -1126,9 +1134,9 @@ void select_alternative(pbqp_node_t *node, unsigned selected_index)
 		pbqp_edge_t *edge = node->edges[edge_index];
 
 		if (edge->src == node)
-			select_row(edge, selected_index);
+			select_row(pbqp, edge, selected_index);
 		else
-			select_column(edge, selected_index);
+			select_column(pbqp, edge, selected_index);
 	}
 }
 
@@ -1161,7 +1169,7 @@ unsigned get_local_minimal_alternative(pbqp_t *pbqp, pbqp_node_t *node)
 	num       min        = INF_COSTS;
 
 	for (unsigned node_index = 0; node_index < node_len; ++node_index) {
-		num value = node_vec->entries[node_index].data;
+		num value = node_vec->entries[node_index];
 
 		for (unsigned edge_index = 0; edge_index < max_degree; ++edge_index) {
 			pbqp_edge_t   *edge   = node->edges[edge_index];
@@ -1179,7 +1187,7 @@ unsigned get_local_minimal_alternative(pbqp_t *pbqp, pbqp_node_t *node)
 
 			value = pbqp_add(value, vector_get_min(vec));
 
-			obstack_free(&pbqp->obstack, vec);
+			vector_free(pbqp, vec);
 		}
 
 		if (value < min) {
@@ -32,7 +32,8 @@ void free_buckets(void);
 unsigned get_local_minimal_alternative(pbqp_t *pbqp, pbqp_node_t *node);
 pbqp_node_t *get_node_with_max_degree(void);
 void initial_simplify_edges(pbqp_t *pbqp);
-void select_alternative(pbqp_node_t *node, unsigned selected_index);
+void select_alternative(pbqp_t *pbqp, pbqp_node_t *node,
+                        unsigned selected_index);
 void simplify_edge(pbqp_t *pbqp, pbqp_edge_t *edge);
 void reorder_node_after_edge_deletion(pbqp_node_t *node);
 void reorder_node_after_edge_insertion(pbqp_node_t *node);
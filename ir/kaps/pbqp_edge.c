@@ -39,11 +39,9 @@ pbqp_edge_t *alloc_edge(pbqp_t *pbqp, unsigned src_index, unsigned tgt_index,
 	pbqp_node_t *src_node = get_node(pbqp, src_index);
 	pbqp_node_t *tgt_node = get_node(pbqp, tgt_index);
 
-	if (transpose) {
-		edge->costs = pbqp_matrix_copy_and_transpose(pbqp, costs);
-	} else {
-		edge->costs = pbqp_matrix_copy(pbqp, costs);
-	}
+	if (transpose)
+		pbqp_matrix_transpose(pbqp, costs);
+	edge->costs = costs;
 
 	/*
 	 * Connect edge with incident nodes. Since the edge is allocated, we know
@@ -58,7 +56,7 @@ pbqp_edge_t *alloc_edge(pbqp_t *pbqp, unsigned src_index, unsigned tgt_index,
 	return edge;
 }
 
-void delete_edge(pbqp_edge_t *edge)
+void delete_edge(pbqp_t *pbqp, pbqp_edge_t *edge)
 {
 	pbqp_node_t *src_node = edge->src;
 	pbqp_node_t *tgt_node = edge->tgt;
@@ -69,6 +67,10 @@ void delete_edge(pbqp_edge_t *edge)
 	edge->src = NULL;
 	edge->tgt = NULL;
 
+	/* The edge itself may still be referenced by edge buckets. */
+	pbqp_matrix_free(pbqp, edge->costs);
+	edge->costs = NULL;
+
 	reorder_node_after_edge_deletion(src_node);
 	reorder_node_after_edge_deletion(tgt_node);
 }
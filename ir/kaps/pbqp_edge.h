@@ -14,13 +14,14 @@
 
 #include "pbqp_t.h"
 
+/* Create an edge with the given costs, which are owned by the edge. */
 pbqp_edge_t *alloc_edge(pbqp_t *pbqp, unsigned src_index, unsigned tgt_index,
                         pbqp_matrix_t *costs);
 
 pbqp_edge_t *pbqp_edge_deep_copy(pbqp_t *pbqp, pbqp_edge_t *edge,
                                  pbqp_node_t *src_node, pbqp_node_t *tgt_node);
 
-void delete_edge(pbqp_edge_t *edge);
+void delete_edge(pbqp_t *pbqp, pbqp_edge_t *edge);
 unsigned is_deleted(pbqp_edge_t *edge);
 
 #endif
@@ -35,6 +35,9 @@
 #include "matrix_t.h"
 #include "vector_t.h"
 
+/* Number of power of two size classes of recycled matrices and vectors. */
+#define KAPS_SIZE_CLASSES 32
+
 typedef struct pbqp_edge_t pbqp_edge_t;
 typedef struct pbqp_node_t pbqp_node_t;
 typedef struct pbqp_t      pbqp_t;
@@ -45,6 +48,9 @@ struct pbqp_t {
 	size_t         num_nodes;          /* Number of PBQP nodes. */
 	pbqp_node_t  **nodes;              /* Nodes of PBQP. */
 	FILE          *dump_file;          /* File to dump in. */
+	pbqp_matrix_t **free_matrices[KAPS_SIZE_CLASSES]; /* Recycled matrices. */
+	vector_t      **free_vectors[KAPS_SIZE_CLASSES];  /* Recycled vectors. */
+	unsigned       pool_disabled;      /* Do not recycle while non-zero. */
 #if KAPS_STATISTIC
 	unsigned       num_bf;             /* Number of brute force reductions. */
 	unsigned       num_edges;          /* Number of independent edges. */
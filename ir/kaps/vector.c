@@ -12,7 +12,9 @@
 #include <string.h>
 
 #include "adt/array.h"
+#include "bitfiddle.h"
 
+#include "costs.h"
 #include "vector.h"
 
 num pbqp_add(num x, num y)
@@ -38,22 +40,66 @@ num pbqp_add(num x, num y)
 	return res;
 }
 
+/**
+ * Returns an uninitialized vector with room for @p length entries.  Vectors
+ * are recycled per power of two size class.
+ */
+static vector_t *get_vector(pbqp_t *pbqp, unsigned length)
+{
+	unsigned   size_class = log2_ceil(length);
+	vector_t **free_list  = pbqp->free_vectors[size_class];
+	assert(size_class < KAPS_SIZE_CLASSES);
+
+	if (pbqp->pool_disabled == 0 && free_list != NULL && ARR_LEN(free_list) > 0) {
+		vector_t *vec = free_list[ARR_LEN(free_list) - 1];
+		ARR_SHRINKLEN(free_list, ARR_LEN(free_list) - 1);
+		return vec;
+	}
+
+	vector_t *vec = (vector_t *)obstack_alloc(&pbqp->obstack, sizeof(*vec) + (sizeof(*vec->entries) << size_class));
+#if KAPS_ENABLE_VECTOR_NAMES
+	vec->names = OALLOCN(&pbqp->obstack, const char*, 1u << size_class);
+#endif
+	return vec;
+}
+
 vector_t *vector_alloc(pbqp_t *pbqp, unsigned length)
 {
-	vector_t *vec = (vector_t *)obstack_alloc(&pbqp->obstack, sizeof(*vec) + sizeof(*vec->entries) * length);
 	assert(length > 0);
+	vector_t *vec = get_vector(pbqp, length);
 
 	vec->len = length;
 	memset(vec->entries, 0, sizeof(*vec->entries) * length);
+#if KAPS_ENABLE_VECTOR_NAMES
+	memset(vec->names, 0, sizeof(*vec->names) * length);
+#endif
 
 	return vec;
 }
 
+void vector_free(pbqp_t *pbqp, vector_t *vec)
+{
+	/* Memory allocated while recycling is disabled is released by the
+	 * caller. */
+	if (pbqp->pool_disabled != 0)
+		return;
+
+	unsigned size_class = log2_ceil(vec->len);
+	if (pbqp->free_vectors[size_class] == NULL)
+		pbqp->free_vectors[size_class] = NEW_ARR_F(vector_t *, 0);
+	ARR_APP1(vector_t *, pbqp->free_vectors[size_class], vec);
+}
+
 vector_t *vector_copy(pbqp_t *pbqp, vector_t *v)
 {
 	unsigned  len  = v->len;
-	vector_t *copy = (vector_t *)obstack_copy(&pbqp->obstack, v, sizeof(*copy) + sizeof(*copy->entries) * len);
-	assert(copy);
+	vector_t *copy = get_vector(pbqp, len);
+
+	copy->len = len;
+	memcpy(copy->entries, v->entries, sizeof(*copy->entries) * len);
+#if KAPS_ENABLE_VECTOR_NAMES
+	memcpy(copy->names, v->names, sizeof(*copy->names) * len);
+#endif
 
 	return copy;
 }
@@ -64,32 +110,26 @@ void vector_add(vector_t *sum, vector_t *summand)
 
 	assert(len == summand->len);
 
-	for (unsigned i = 0; i < len; ++i) {
-		sum->entries[i].data = pbqp_add(sum->entries[i].data, summand->entries[i].data);
-	}
+	costs_add(sum->entries, summand->entries, len);
 }
 
 void vector_set(vector_t *vec, unsigned index, num value)
 {
 	assert(index < vec->len);
-	vec->entries[index].data = value;
+	vec->entries[index] = value;
 }
 
 #if KAPS_ENABLE_VECTOR_NAMES
 void vector_set_description(vector_t *vec, unsigned index, const char *name)
 {
 	assert(index < vec->len);
-	vec->entries[index].name = name;
+	vec->names[index] = name;
 }
 #endif
 
 void vector_add_value(vector_t *vec, num value)
 {
-	unsigned len = vec->len;
-
-	for (unsigned index = 0; index < len; ++index) {
-		vec->entries[index].data = pbqp_add(vec->entries[index].data, value);
-	}
+	costs_add_value(vec->entries, value, vec->len);
 }
 
 void vector_add_matrix_col(vector_t *vec, pbqp_matrix_t *mat, unsigned col_index)
@@ -100,7 +140,7 @@ void vector_add_matrix_col(vector_t *vec, pbqp_matrix_t *mat, unsigned col_index
 	assert(col_index < mat->cols);
 
 	for (unsigned index = 0; index < len; ++index) {
-		vec->entries[index].data = pbqp_add(vec->entries[index].data, mat->entries[index * mat->cols + col_index]);
+		vec->entries[index] = pbqp_add(vec->entries[index], mat->entries[index * mat->cols + col_index]);
 	}
 }
 
@@ -111,28 +151,14 @@ void vector_add_matrix_row(vector_t *vec, pbqp_matrix_t *mat, unsigned row_index
 	assert(len == mat->cols);
 	assert(row_index < mat->rows);
 
-
-	for (unsigned index = 0; index < len; ++index) {
-		vec->entries[index].data = pbqp_add(vec->entries[index].data, mat->entries[row_index * mat->cols + index]);
-	}
+	costs_add(vec->entries, &mat->entries[row_index * mat->cols], len);
 }
 
 num vector_get_min(vector_t *vec)
 {
-	unsigned len = vec->len;
-	num      min = INF_COSTS;
-
-	assert(len > 0);
-
-	for (unsigned index = 0; index < len; ++index) {
-		num elem = vec->entries[index].data;
-
-		if (elem < min) {
-			min = elem;
-		}
-	}
+	assert(vec->len > 0);
 
-	return min;
+	return costs_min(vec->entries, vec->len);
 }
 
 unsigned vector_get_min_index(vector_t *vec)
@@ -144,7 +170,7 @@ unsigned vector_get_min_index(vector_t *vec)
 	assert(len > 0);
 
 	for (unsigned index = 0; index < len; ++index) {
-		num elem = vec->entries[index].data;
+		num elem = vec->entries[index];
 
 		if (elem < min) {
 			min = elem;
@@ -18,6 +18,9 @@ num pbqp_add(num x, num y);
 
 vector_t *vector_alloc(pbqp_t *pbqp, unsigned length);
 
+/* Recycle the given vector for later allocations. */
+void vector_free(pbqp_t *pbqp, vector_t *vec);
+
 /* Copy the given vector. */
 vector_t *vector_copy(pbqp_t *pbqp, vector_t *v);
 
@@ -14,20 +14,19 @@
 
 #include "pbqp_t.h"
 
-typedef struct vec_elem_t vec_elem_t;
-
-struct vec_elem_t {
-	num data;
-#if KAPS_ENABLE_VECTOR_NAMES
-	const char *name;
-#endif
-};
-
 typedef struct vector_t vector_t;
 
+/**
+ * Cost vector.  The costs are stored contiguously, so the kernels in costs.h
+ * can process them with vector instructions; descriptions live in a separate
+ * array.
+ */
 struct vector_t {
-	unsigned   len;
-	vec_elem_t entries[];
+	unsigned     len;
+#if KAPS_ENABLE_VECTOR_NAMES
+	const char **names;
+#endif
+	num          entries[];
 };
 
 #endif
@@ -11,23 +11,39 @@
 
 /* Default appendable implementations */
 
+/**
+ * Appends @p n pad characters in chunks.
+ */
+static int append_pad(lc_appendable_t *app, size_t n, char pad)
+{
+	char buf[32];
+	memset(buf, pad, MIN(n, sizeof(buf)));
+
+	int res = 0;
+	while (n > 0) {
+		size_t chunk = MIN(n, sizeof(buf));
+		res += lc_appendable_snadd(app, buf, chunk);
+		n   -= chunk;
+	}
+	return res;
+}
+
 int lc_appendable_snwadd(lc_appendable_t *app, const char *str, size_t len,
 		unsigned int width, int left_just, char pad)
 {
 	int res = 0;
-	size_t i;
 	size_t to_pad = width > len ? width - len : 0;
 
 	/* If not left justified, pad left */
-	for (i = 0; !left_just && i < to_pad; ++i)
-		res += lc_appendable_chadd(app, pad);
+	if (!left_just)
+		res += append_pad(app, to_pad, pad);
 
 	/* Send the visible portion of the string to the output. */
 	res += lc_appendable_snadd(app, str, len);
 
 	/* If left justified, pad right. */
-	for (i = 0; left_just && i < to_pad; ++i)
-		res += lc_appendable_chadd(app, pad);
+	if (left_just)
+		res += append_pad(app, to_pad, pad);
 
 	return res;
 }
@@ -81,6 +97,59 @@ static lc_appendable_funcs_t app_file = {
 
 const lc_appendable_funcs_t *lc_appendable_file = &app_file;
 
+/*
+ * Buffered file appendable.
+ */
+
+static void buffered_flush(lc_appendable_file_buffer_t *buffer)
+{
+	fwrite(buffer->data, sizeof(char), buffer->len, buffer->file);
+	buffer->len = 0;
+}
+
+static void buffered_init(lc_appendable_t *obj)
+{
+	lc_appendable_file_buffer_t *buffer = (lc_appendable_file_buffer_t*)obj->obj;
+	buffer->len = 0;
+}
+
+static int buffered_snadd(lc_appendable_t *obj, const char *str, size_t n)
+{
+	lc_appendable_file_buffer_t *buffer = (lc_appendable_file_buffer_t*)obj->obj;
+	obj->written += n;
+	if (buffer->len + n > sizeof(buffer->data)) {
+		buffered_flush(buffer);
+		/* large strings are written directly */
+		if (n > sizeof(buffer->data)) {
+			fwrite(str, sizeof(char), n, buffer->file);
+			return n;
+		}
+	}
+	memcpy(buffer->data + buffer->len, str, n);
+	buffer->len += n;
+	return n;
+}
+
+static int buffered_chadd(lc_appendable_t *obj, int ch)
+{
+	char c = (char)ch;
+	return buffered_snadd(obj, &c, 1);
+}
+
+static void buffered_finish(lc_appendable_t *obj)
+{
+	buffered_flush((lc_appendable_file_buffer_t*)obj->obj);
+}
+
+static lc_appendable_funcs_t app_file_buffered = {
+	buffered_init,
+	buffered_finish,
+	buffered_snadd,
+	buffered_chadd
+};
+
+const lc_appendable_funcs_t *lc_appendable_file_buffered = &app_file_buffered;
+
 
 /*
  * String appendable.
@@ -88,14 +157,15 @@ const lc_appendable_funcs_t *lc_appendable_file = &app_file;
 
 static void str_init(lc_appendable_t *obj)
 {
-	strncpy((char*)obj->obj, "", obj->limit);
+	if (obj->limit > 0)
+		((char*)obj->obj)[0] = '\0';
 }
 
 static int str_snadd(lc_appendable_t *obj, const char *str, size_t n)
 {
 	size_t to_write = MIN(obj->limit - obj->written - 1, n);
 	char *tgt = (char*)obj->obj;
-	strncpy(tgt + obj->written, str, to_write);
+	memcpy(tgt + obj->written, str, to_write);
 	obj->written += to_write;
 	return to_write;
 }
@@ -15,6 +15,7 @@
 #define _LIBCORE_APPENDABLE_H
 
 #include <stddef.h>
+#include <stdio.h>
 
 struct lc_appendable_funcs_t;
 
@@ -46,4 +47,16 @@ extern const lc_appendable_funcs_t *lc_appendable_file;
 extern const lc_appendable_funcs_t *lc_appendable_string;
 extern const lc_appendable_funcs_t *lc_appendable_obstack;
 
+/**
+ * Object of lc_appendable_file_buffered: Collects the output and writes it
+ * to the file in bulk when the buffer is full or the appendable is finished.
+ */
+typedef struct lc_appendable_file_buffer_t {
+	FILE  *file;
+	size_t len;
+	char   data[256];
+} lc_appendable_file_buffer_t;
+
+extern const lc_appendable_funcs_t *lc_appendable_file_buffered;
+
 #endif
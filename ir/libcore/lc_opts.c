@@ -205,13 +205,13 @@ static lc_opt_entry_t *resolve_up_to_last_str_rec(lc_opt_entry_t *from,
 		size_t next = strspn(path + end, path_delim);
 
 		/* copy the part of the path into a buffer */
-		char *buf = (char*)malloc((end+1) * sizeof(buf[0]));
+		char *buf = XMALLOCN(char, end + 1);
 		strncpy(buf, path, end);
 		buf[end] = '\0';
 
 		/* resolve the group and free */
 		from = lc_opt_get_grp(from, buf);
-		free(buf);
+		xfree(buf);
 
 		res = resolve_up_to_last_str_rec(from, path + end + next, last_name);
 	} else if (last_name != NULL) {
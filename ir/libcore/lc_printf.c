@@ -38,6 +38,36 @@ struct lc_arg_env_t {
 	lc_arg_t *upper[26];        /**< Map for upper conversion specifiers. */
 };
 
+/**
+ * A conversion of a precompiled format string.
+ */
+typedef struct lc_fmt_op_t {
+	lc_arg_occ_t    occ;      /**< The parsed occurrence. */
+	const lc_arg_t *arg;      /**< The argument, NULL if nothing is converted. */
+	const char     *text;     /**< Literal text following the conversion. */
+	size_t          text_len; /**< Length of the literal text. */
+} lc_fmt_op_t;
+
+/**
+ * A precompiled format string.
+ */
+typedef struct lc_fmt_t {
+	const char         *key;        /**< The format string pointer. */
+	const lc_arg_env_t *env;        /**< The environment used for parsing. */
+	unsigned            generation; /**< The cache generation when parsed. */
+	const char         *text;       /**< Copy of the format string. */
+	size_t              prefix_len; /**< Literal text before the first %. */
+	size_t              n_ops;      /**< Number of conversions. */
+	lc_fmt_op_t         ops[];      /**< The conversions. */
+} lc_fmt_t;
+
+#define FMT_CACHE_SIZE 256
+
+/** Precompiled format strings, indexed by the format string pointer. */
+static lc_fmt_t *fmt_cache[FMT_CACHE_SIZE];
+/** Bumped whenever an environment changes to invalidate the cache. */
+static unsigned  fmt_cache_generation;
+
 static int lc_arg_cmp(const void *p1, const void *p2, size_t size)
 {
 	const lc_arg_t *a1 = (const lc_arg_t*)p1;
@@ -55,8 +85,9 @@ lc_arg_env_t *lc_arg_new_env(void)
 
 void lc_arg_free_env(lc_arg_env_t *env)
 {
+	++fmt_cache_generation;
 	del_set(env->args);
-	free(env);
+	xfree(env);
 }
 
 int lc_arg_register(lc_arg_env_t *env, const char *name, char letter,
@@ -78,6 +109,7 @@ int lc_arg_register(lc_arg_env_t *env, const char *name, char letter,
 	}
 
 	lc_arg_t *ent = set_insert(lc_arg_t, env->args, &arg, sizeof(arg), hash_str(name));
+	++fmt_cache_generation;
 
 	if (ent && base != 0)
 		map[letter - base] = ent;
@@ -259,12 +291,14 @@ static int std_emit(lc_appendable_t *app, const lc_arg_occ_t *occ, const lc_arg_
 		}
 
 		default: {
-			int len = MAX(128, occ->width + 1);
-			char *buf = XMALLOCN(char, len);
+			char  local[128];
+			int   len = MAX((int)sizeof(local), occ->width + 1);
+			char *buf = len > (int)sizeof(local) ? XMALLOCN(char, len) : local;
 			res = dispatch_snprintf(buf, len, fmt, occ->lc_arg_type, val);
 			assert(res < len);
 			lc_appendable_snadd(app, buf, res);
-			free(buf);
+			if (buf != local)
+				xfree(buf);
 		}
 	}
 
@@ -308,155 +342,218 @@ static char *read_int(const char *s, int *value)
 	return endptr;
 }
 
-/* Generic printf() function. */
-
-int lc_evpprintf(const lc_arg_env_t *env, lc_appendable_t *app, const char *fmt,
-                 va_list args)
+/**
+ * Parses a single conversion starting after the % at @p s.
+ *
+ * @return the position after the conversion.
+ */
+static const char *parse_conversion(const lc_arg_env_t *env, const char *s,
+                                    lc_fmt_op_t *op)
 {
-	int         res  = 0;
-	const char *last = fmt + strlen(fmt);
+	lc_arg_occ_t *occ = &op->occ;
+	memset(op, 0, sizeof(*op));
+
+	/* Eat all flags and set the corresponding flags in the occ struct */
+	for (; *s != '\0' && strchr("#0-+", *s); ++s) {
+		switch (*s) {
+			case '#':
+				occ->flag_hash = 1;
+				break;
+			case '0':
+				occ->flag_zero = 1;
+				break;
+			case '-':
+				occ->flag_minus = 1;
+				break;
+			case '+':
+				occ->flag_plus = 1;
+				break;
+			case ' ':
+				occ->flag_space = 1;
+				break;
+		}
+	}
 
-	/* Find the first % */
-	const char *s = strchr(fmt, '%');
+	/* Read the width if given */
+	s = read_int(s, &occ->width);
 
-	/* Emit the text before the first % was found */
-	size_t addlen = (s ? s : last) - fmt;
-	lc_appendable_snadd(app, fmt, addlen);
-	res += addlen;
+	occ->precision = -1;
 
-	while (s != NULL) {
-		lc_arg_value_t val;
-
-		/* We must be at a '%' */
-		assert(*s == '%');
-
-		/* Reset the occurrence structure */
-		lc_arg_occ_t occ;
-		memset(&occ, 0, sizeof(occ));
-
-		/* Eat all flags and set the corresponding flags in the occ struct */
-		for (++s; strchr("#0-+", *s); ++s) {
-			switch (*s) {
-				case '#':
-					occ.flag_hash = 1;
-					break;
-				case '0':
-					occ.flag_zero = 1;
-					break;
-				case '-':
-					occ.flag_minus = 1;
-					break;
-				case '+':
-					occ.flag_plus = 1;
-					break;
-				case ' ':
-					occ.flag_space = 1;
-					break;
+	/* read the precision if given */
+	if (*s == '.') {
+		int precision;
+		s = read_int(s + 1, &precision);
+
+		/* Negative or lacking precision after a '.' is treated as
+		 * precision 0. */
+		occ->precision = MAX(0, precision);
+	}
+
+	/*
+	 * Now, we can either have:
+	 * - a named argument like {node}
+	 * - some modifiers followed by a conversion specifier
+	 * - or some other character, which ends this format invalidly
+	 */
+	char            ch  = *s;
+	const lc_arg_t *arg = NULL;
+	switch (ch) {
+		case '%':
+			occ->conversion = '%';
+			return s + 1;
+		case '{': {
+			const char *named = ++s;
+
+			/* Read until the closing brace or end of the string. */
+			for (ch = *s; ch != '}' && ch != '\0'; ch = *++s) {
 			}
-		}
 
-		/* Read the width if given */
-		s = read_int(s, &occ.width);
+			if (s - named) {
+				size_t n = s - named;
+				char *name;
+				lc_arg_t tmp;
+
+				name = XMALLOCN(char, n + 1);
+				MEMCPY(name, named, n);
+				name[n] = '\0';
+				tmp.name = name;
 
-		occ.precision = -1;
+				arg = set_find(lc_arg_t, env->args, &tmp, sizeof(tmp), hash_str(name));
+				occ->modifier = "";
+				occ->modifier_length = 0;
 
-		/* read the precision if given */
-		if (*s == '.') {
-			int precision;
-			s = read_int(s + 1, &precision);
+				/* Set the conversion specifier of the occurrence to the
+				 * letter specified in the argument description. */
+				if (arg)
+					occ->conversion = arg->letter;
 
-			/* Negative or lacking precision after a '.' is treated as
-			 * precision 0. */
-			occ.precision = MAX(0, precision);
+				xfree(name);
+
+				/* If we ended with a closing brace, move the current
+				 * pointer after it, since it is not to be dumped. */
+				if (ch == '}')
+					s++;
+			}
+			break;
 		}
 
-		/*
-		 * Now, we can either have:
-		 * - a named argument like {node}
-		 * - some modifiers followed by a conversion specifier
-		 * - or some other character, which ends this format invalidly
-		 */
-		char            ch  = *s;
-		const lc_arg_t *arg = NULL;
-		switch (ch) {
-			case '%':
-				s++;
-				lc_appendable_chadd(app, '%');
-				++res;
-				break;
-			case '{': {
-				const char *named = ++s;
+		default: {
+			const char *mod = s;
+
+			/* Read, as long there are letters */
+			while (isalpha((unsigned char)ch) && !arg) {
+				int              base = 'a';
+				lc_arg_t *const *map  = env->lower;
+
+				/* If uppercase, select the uppercase map from the
+				 * environment */
+				if (isupper((unsigned char)ch)) {
+					base = 'A';
+					map = env->upper;
+				}
 
-				/* Read until the closing brace or end of the string. */
-				for (ch = *s; ch != '}' && ch != '\0'; ch = *++s) {
+				if (map[ch - base] != NULL) {
+					occ->modifier = mod;
+					occ->modifier_length = s - mod;
+					occ->conversion = ch;
+					arg = map[ch - base];
 				}
 
-				if (s - named) {
-					size_t n = s - named;
-					char *name;
-					lc_arg_t tmp;
+				ch = *++s;
+			}
+		}
+	}
 
-					name = (char*) malloc(sizeof(char) * (n + 1));
-					MEMCPY(name, named, n);
-					name[n] = '\0';
-					tmp.name = name;
+	/* Let the handler determine the type of the argument based on the
+	 * information gathered. */
+	if (arg != NULL && arg->handler != NULL) {
+		op->arg             = arg;
+		occ->lc_arg_type = arg->handler->get_lc_arg_type(occ);
+	}
+	return s;
+}
 
-					arg = set_find(lc_arg_t, env->args, &tmp, sizeof(tmp), hash_str(named));
-					occ.modifier = "";
-					occ.modifier_length = 0;
+/**
+ * Precompiles the format string @p key into a list of conversions.
+ */
+static lc_fmt_t *compile_format(const lc_arg_env_t *env, const char *key)
+{
+	size_t len   = strlen(key);
+	size_t n_pct = 0;
+	for (const char *p = key; (p = strchr(p, '%')) != NULL; ++p)
+		++n_pct;
+
+	size_t    ops_size = n_pct * sizeof(lc_fmt_op_t);
+	lc_fmt_t *fmt      = (lc_fmt_t*)xmalloc(sizeof(*fmt) + ops_size + len + 1);
+	char     *text     = (char*)fmt->ops + ops_size;
+	MEMCPY(text, key, len + 1);
+
+	fmt->key        = key;
+	fmt->env        = env;
+	fmt->generation = fmt_cache_generation;
+	fmt->text       = text;
+	fmt->n_ops      = 0;
+
+	/* Parse the copy, so the conversions point into it */
+	const char *last = text + len;
+	const char *s    = strchr(text, '%');
+	fmt->prefix_len  = (s ? s : last) - text;
+	while (s != NULL) {
+		lc_fmt_op_t *op  = &fmt->ops[fmt->n_ops++];
+		const char  *old = parse_conversion(env, s + 1, op);
+		if (op->occ.conversion == '%') {
+			/* the second % is emitted as literal text */
+			s = strchr(old, '%');
+			--old;
+		} else {
+			s = strchr(old, '%');
+		}
+		op->text     = old;
+		op->text_len = (s ? s : last) - old;
+	}
+	return fmt;
+}
 
-					/* Set the conversion specifier of the occurrence to the
-					 * letter specified in the argument description. */
-					if (arg)
-						occ.conversion = arg->letter;
+/**
+ * Returns the precompiled version of the format string @p key.
+ */
+static const lc_fmt_t *get_format(const lc_arg_env_t *env, const char *key)
+{
+	lc_fmt_t **slot = &fmt_cache[hash_ptr(key) % FMT_CACHE_SIZE];
+	lc_fmt_t  *fmt  = *slot;
+	/* the string may live in a reused buffer, so compare the contents too */
+	if (fmt != NULL && fmt->key == key && fmt->env == env
+	    && fmt->generation == fmt_cache_generation
+	    && strcmp(fmt->text, key) == 0)
+		return fmt;
+
+	xfree(fmt);
+	fmt   = compile_format(env, key);
+	*slot = fmt;
+	return fmt;
+}
 
-					free(name);
+/* Generic printf() function. */
 
-					/* If we ended with a closing brace, move the current
-					 * pointer after it, since it is not to be dumped. */
-					if (ch == '}')
-						s++;
-				}
-				break;
-			}
+int lc_evpprintf(const lc_arg_env_t *env, lc_appendable_t *app, const char *fmt,
+                 va_list args)
+{
+	const lc_fmt_t *compiled = get_format(env, fmt);
 
-			default: {
-				const char *mod = s;
-
-				/* Read, as long there are letters */
-				while (isalpha((unsigned char)ch) && !arg) {
-					int              base = 'a';
-					lc_arg_t *const *map  = env->lower;
-
-					/* If uppercase, select the uppercase map from the
-					 * environment */
-					if (isupper((unsigned char)ch)) {
-						base = 'A';
-						map = env->upper;
-					}
-
-					if (map[ch - base] != NULL) {
-						occ.modifier = mod;
-						occ.modifier_length = s - mod;
-						occ.conversion = ch;
-						arg = map[ch - base];
-					}
-
-					ch = *++s;
-				}
-			}
-		}
+	/* Emit the text before the first % was found */
+	int res = compiled->prefix_len;
+	lc_appendable_snadd(app, compiled->text, compiled->prefix_len);
 
-		/* Call the handler if an argument was determined */
-		if (arg != NULL && arg->handler != NULL) {
-			const lc_arg_handler_t *handler = arg->handler;
+	for (size_t i = 0, n = compiled->n_ops; i < n; ++i) {
+		const lc_fmt_op_t *op = &compiled->ops[i];
 
-			/* Let the handler determine the type of the argument based on the
-			 * information gathered. */
-			occ.lc_arg_type = handler->get_lc_arg_type(&occ);
+		/* Call the handler if an argument was determined */
+		if (op->arg != NULL) {
+			const lc_arg_handler_t *handler = op->arg->handler;
+			lc_arg_value_t          val;
 
 			/* Store the value according to argument information */
-			switch (occ.lc_arg_type) {
+			switch (op->occ.lc_arg_type) {
 #define LC_ARG_TYPE(type,name,va_type) \
 			case lc_arg_type_ ## name: val.v_ ## name = va_arg(args, va_type); break;
 #include "lc_printf_arg_types.def"
@@ -464,14 +561,11 @@ int lc_evpprintf(const lc_arg_env_t *env, lc_appendable_t *app, const char *fmt,
 			}
 
 			/* Finally, call the handler. */
-			res += handler->emit(app, &occ, &val);
+			res += handler->emit(app, &op->occ, &val);
 		}
 
-		const char *old = s;
-		s = strchr(s, '%');
-		size_t addlen = (s ? s : last) - old;
-		lc_appendable_snadd(app, old, addlen);
-		res += addlen;
+		lc_appendable_snadd(app, op->text, op->text_len);
+		res += op->text_len;
 	}
 
 	return res;
@@ -505,9 +599,11 @@ int lc_evsnprintf(const lc_arg_env_t *env, char *buf, size_t len, const char *fm
 
 int lc_evfprintf(const lc_arg_env_t *env, FILE *f, const char *fmt, va_list args)
 {
-	lc_appendable_t app;
+	lc_appendable_t             app;
+	lc_appendable_file_buffer_t buffer;
 
-	lc_appendable_init(&app, lc_appendable_file, f, 0);
+	buffer.file = f;
+	lc_appendable_init(&app, lc_appendable_file_buffered, &buffer, 0);
 	int res = lc_evpprintf(env, &app, fmt, args);
 	lc_appendable_finish(&app);
 	return res;
@@ -5,7 +5,7 @@
 
 /**
  * @file
- * @brief   Lowering of builtins to compiler-lib calls
+ * @brief   Lowering of builtins to arithmetic and compiler-lib calls
  * @author  Matthias Braun
  */
 #include "lower_builtins.h"
@@ -134,6 +134,171 @@ static void replace_with_call(ir_node *node)
 	turn_into_tuple(node, ARRAY_SIZE(in), in);
 }
 
+/**
+ * Returns a constant of mode @p mode, which has the lowest @p width bits of
+ * every @p period bits set.
+ */
+static ir_node *new_pattern_Const(ir_graph *irg, ir_mode *mode,
+                                  unsigned period, unsigned width)
+{
+	ir_tarval *const one = get_mode_one(mode);
+	ir_tarval *      tv  = get_mode_null(mode);
+	for (unsigned i = 0, bits = get_mode_size_bits(mode); i < bits; ++i) {
+		if (i % period < width)
+			tv = tarval_or(tv, tarval_shl_unsigned(one, i));
+	}
+	return new_r_Const(irg, tv);
+}
+
+static ir_node *new_shift(dbg_info *dbgi, ir_node *block, ir_node *op,
+                          unsigned amount, bool left)
+{
+	ir_graph *const irg   = get_irn_irg(block);
+	ir_mode  *const mode  = get_irn_mode(op);
+	ir_node  *const count = new_r_Const_long(irg, mode_Iu, amount);
+	return left ? new_rd_Shl(dbgi, block, op, count, mode)
+	            : new_rd_Shr(dbgi, block, op, count, mode);
+}
+
+static ir_node *new_masked(dbg_info *dbgi, ir_node *block, ir_node *op,
+                           unsigned period, unsigned width)
+{
+	ir_graph *const irg  = get_irn_irg(block);
+	ir_mode  *const mode = get_irn_mode(op);
+	ir_node  *const mask = new_pattern_Const(irg, mode, period, width);
+	return new_rd_And(dbgi, block, op, mask, mode);
+}
+
+/**
+ * Creates the number of set bits of @p op by adding up the bits in
+ * increasingly wide fields.  The bytes are summed up by a multiplication if
+ * it fits into a machine word.
+ */
+static ir_node *create_popcount(dbg_info *dbgi, ir_node *block, ir_node *op)
+{
+	ir_graph *const irg  = get_irn_irg(block);
+	ir_mode  *const mode = get_irn_mode(op);
+	unsigned  const bits = get_mode_size_bits(mode);
+
+	ir_node *const pairs = new_masked(dbgi, block,
+	                                  new_shift(dbgi, block, op, 1, false), 2, 1);
+	ir_node *x = new_rd_Sub(dbgi, block, op, pairs, mode);
+	x = new_rd_Add(dbgi, block, new_masked(dbgi, block, x, 4, 2),
+	               new_masked(dbgi, block, new_shift(dbgi, block, x, 2, false),
+	                          4, 2), mode);
+	x = new_rd_Add(dbgi, block, x, new_shift(dbgi, block, x, 4, false), mode);
+	x = new_masked(dbgi, block, x, 8, 4);
+	if (bits <= 8)
+		return x;
+
+	if (bits <= be_get_machine_size()) {
+		ir_node *const ones = new_pattern_Const(irg, mode, 8, 1);
+		x = new_rd_Mul(dbgi, block, x, ones, mode);
+		return new_shift(dbgi, block, x, bits - 8, false);
+	}
+	for (unsigned shift = 8; shift < bits; shift *= 2) {
+		x = new_rd_Add(dbgi, block, x, new_shift(dbgi, block, x, shift, false),
+		               mode);
+	}
+	ir_node *const mask = new_r_Const_long(irg, mode, 2 * bits - 1);
+	return new_rd_And(dbgi, block, x, mask, mode);
+}
+
+static ir_node *create_parity(dbg_info *dbgi, ir_node *block, ir_node *op)
+{
+	ir_graph *const irg  = get_irn_irg(block);
+	ir_mode  *const mode = get_irn_mode(op);
+	ir_node        *x    = op;
+	for (unsigned shift = get_mode_size_bits(mode) / 2; shift >= 4; shift /= 2) {
+		x = new_rd_Eor(dbgi, block, x, new_shift(dbgi, block, x, shift, false),
+		               mode);
+	}
+	/* look up the parity of the remaining nibble in a 16 bit table */
+	ir_node *const low    = new_rd_And(dbgi, block, x,
+	                                   new_r_Const_long(irg, mode, 0xF), mode);
+	ir_node *const nibble = new_rd_Conv(dbgi, block, low, mode_Iu);
+	ir_node *const table  = new_r_Const_long(irg, mode_Iu, 0x6996);
+	ir_node *const parity = new_rd_Shr(dbgi, block, table, nibble, mode_Iu);
+	return new_rd_And(dbgi, block, parity, new_r_Const_one(irg, mode_Iu),
+	                  mode_Iu);
+}
+
+static ir_node *create_bswap(dbg_info *dbgi, ir_node *block, ir_node *op)
+{
+	ir_mode *const mode = get_irn_mode(op);
+	unsigned const bits = get_mode_size_bits(mode);
+	ir_node       *x    = op;
+	/* swap neighbouring bytes, then pairs of them and so on */
+	for (unsigned width = 8; width < bits; width *= 2) {
+		ir_node *low  = x;
+		ir_node *high = new_shift(dbgi, block, x, width, false);
+		if (2 * width < bits) {
+			low  = new_masked(dbgi, block, low, 2 * width, width);
+			high = new_masked(dbgi, block, high, 2 * width, width);
+		}
+		low = new_shift(dbgi, block, low, width, true);
+		x   = new_rd_Or(dbgi, block, low, high, mode);
+	}
+	return x;
+}
+
+/**
+ * Replaces a bit manipulation builtin by an inline sequence of arithmetic
+ * operations, which is cheaper than the compiler-lib call and is visible to
+ * the optimizations.
+ */
+static void replace_with_arithmetic(ir_node *node)
+{
+	dbg_info *const dbgi     = get_irn_dbg_info(node);
+	ir_node  *const block    = get_nodes_block(node);
+	ir_type  *const mtp      = get_Builtin_type(node);
+	ir_mode  *const res_mode = get_type_mode(get_method_res_type(mtp, 0));
+	ir_node  *const param    = get_Builtin_param(node, 0);
+	ir_mode  *const mode     = find_unsigned_mode(get_irn_mode(param));
+	ir_node  *const op       = new_rd_Conv(dbgi, block, param, mode);
+
+	ir_node *res;
+	switch (get_Builtin_kind(node)) {
+	case ir_bk_popcount:
+		res = create_popcount(dbgi, block, op);
+		break;
+	case ir_bk_parity:
+		res = create_parity(dbgi, block, op);
+		break;
+	case ir_bk_bswap:
+		res = create_bswap(dbgi, block, op);
+		break;
+	case ir_bk_clz: {
+		/* count the zeros above the highest set bit after smearing it down */
+		ir_node *x = op;
+		for (unsigned shift = 1; shift < get_mode_size_bits(mode); shift *= 2) {
+			x = new_rd_Or(dbgi, block, x,
+			              new_shift(dbgi, block, x, shift, false), mode);
+		}
+		res = create_popcount(dbgi, block, new_rd_Not(dbgi, block, x, mode));
+		break;
+	}
+	case ir_bk_ctz: {
+		/* count the ones of the mask below the lowest set bit */
+		ir_graph *const irg   = get_irn_irg(block);
+		ir_node  *const one   = new_r_Const_one(irg, mode);
+		ir_node  *const below = new_rd_Sub(dbgi, block, op, one, mode);
+		ir_node  *const zeros = new_rd_Not(dbgi, block, op, mode);
+		res = create_popcount(dbgi, block,
+		                      new_rd_And(dbgi, block, zeros, below, mode));
+		break;
+	}
+	default:
+		panic("unexpected builtin %+F", node);
+	}
+
+	ir_node *const in[] = {
+		[pn_Builtin_M]       = get_Builtin_mem(node),
+		[pn_Builtin_max + 1] = new_rd_Conv(dbgi, block, res, res_mode),
+	};
+	turn_into_tuple(node, ARRAY_SIZE(in), in);
+}
+
 static void replace_may_alias(ir_node *node)
 {
 	ir_node *in0   = get_Builtin_param(node, 0);
@@ -175,13 +340,16 @@ static void lower_builtin(ir_node *node, void *env)
 	}
 
 	case ir_bk_ffs:
+		/* replace with a call */
+		replace_with_call(node);
+		goto changed;
+
 	case ir_bk_clz:
 	case ir_bk_ctz:
 	case ir_bk_popcount:
 	case ir_bk_parity:
 	case ir_bk_bswap:
-		/* replace with a call */
-		replace_with_call(node);
+		replace_with_arithmetic(node);
 		goto changed;
 
 	case ir_bk_may_alias:
@@ -5,7 +5,7 @@
 
 /**
  * @file
- * @brief   Lowering of builtins to compiler-lib calls
+ * @brief   Lowering of builtins to arithmetic and compiler-lib calls
  * @author  Matthias Braun
  */
 #ifndef FIRM_LOWER_BUILTINS_H
@@ -238,6 +238,7 @@ typedef struct wlk_env {
 	ir_heights_t         *heights;         /**< Heights for reachability check. */
 	bool                  only_local_mem:1;/**< Set if only local memory access was found. */
 	bool                  changed:1;       /**< Set if the current graph was changed. */
+	bool                  split_ret:1;     /**< Set if a returned aggregate was split into its leaves. */
 	ir_node             **param_members;
 } wlk_env;
 
@@ -593,10 +594,228 @@ static void get_dest_addrs(const cl_entry *entry, ir_node **ins,
 	}
 }
 
+/** A scalar part of an aggregate which is returned as values. */
+typedef struct ret_leaf_t {
+	ir_node  *addr;   /**< address of the leaf */
+	ir_mode  *mode;   /**< mode of the leaf */
+	unsigned  offset; /**< byte offset of the leaf in the aggregate */
+	unsigned  value;  /**< index of the value containing the leaf */
+	unsigned  shift;  /**< bit position of the leaf in its value */
+} ret_leaf_t;
+
+/**
+ * Appends the scalar leaves of the aggregate of type @p type at @p addr to
+ * @p leaves.  Returns false if the aggregate contains bitfields or unions,
+ * which cannot be accessed leaf by leaf.
+ */
+static bool collect_ret_leaves(ir_node *const block, ir_node *const addr,
+                               ir_type *const type, unsigned const offset,
+                               ret_leaf_t **const leaves)
+{
+	if (is_atomic_type(type)) {
+		ret_leaf_t const leaf = {
+			.addr   = addr,
+			.mode   = get_type_mode(type),
+			.offset = offset,
+		};
+		ARR_APP1(ret_leaf_t, *leaves, leaf);
+		return true;
+	} else if (is_Struct_type(type)) {
+		for (size_t i = 0, n = get_compound_n_members(type); i < n; ++i) {
+			ir_entity *const member = get_compound_member(type, i);
+			if (get_entity_bitfield_size(member) > 0)
+				return false;
+			ir_node *const member_addr = new_r_Member(block, addr, member);
+			if (!collect_ret_leaves(block, member_addr, get_entity_type(member),
+			                        offset + get_entity_offset(member), leaves))
+				return false;
+		}
+		return true;
+	} else if (is_Array_type(type) && has_array_size(type)) {
+		ir_graph *const irg          = get_irn_irg(block);
+		ir_mode  *const mode_offset
+			= get_reference_offset_mode(get_irn_mode(addr));
+		ir_type  *const element_type = get_array_element_type(type);
+		unsigned  const element_size = get_type_size(element_type);
+		for (unsigned i = 0, n = get_array_size_int(type); i < n; ++i) {
+			ir_node *const index = new_r_Const_long(irg, mode_offset, i);
+			ir_node *const element_addr = new_r_Sel(block, addr, index, type);
+			if (!collect_ret_leaves(block, element_addr, element_type,
+			                        offset + i * element_size, leaves))
+				return false;
+		}
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Returns whether the aggregate at @p addr is only accessed through Member and
+ * Sel paths, so that it can be replaced by scalars once its returned values
+ * are split into its leaves.
+ */
+static bool is_accessed_by_paths(ir_node const *const addr)
+{
+	foreach_out_edge(addr, edge) {
+		ir_node *const succ = get_edge_src_irn(edge);
+		switch (get_irn_opcode(succ)) {
+		case iro_Load:
+		case iro_Return:
+			break;
+		case iro_Store:
+			if (get_Store_value(succ) == addr)
+				return false;
+			break;
+		case iro_Member:
+		case iro_Sel:
+			if (!is_accessed_by_paths(succ))
+				return false;
+			break;
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Returns the leaves of the aggregate of type @p type at @p addr with their
+ * positions in the values of @p ret_spec, or NULL if the aggregate is accessed
+ * otherwise or some leaf does not fit into a single value as is: it straddles
+ * two values, a float leaf does not fill its float value or shares an integer
+ * value with other leaves.
+ */
+static ret_leaf_t *get_ret_leaves(ir_node *const block, ir_node *const addr,
+                                  ir_type *const type,
+                                  aggregate_spec_t const *const ret_spec)
+{
+	assure_irg_properties(get_irn_irg(addr),
+	                      IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
+	if (!is_accessed_by_paths(addr))
+		return NULL;
+
+	ret_leaf_t *leaves = NEW_ARR_F(ret_leaf_t, 0);
+	if (!collect_ret_leaves(block, addr, type, 0, &leaves)
+	    || ARR_LEN(leaves) == 0)
+		goto fail;
+
+	bool const big_endian = be_is_big_endian();
+	for (size_t l = 0, n = ARR_LEN(leaves); l < n; ++l) {
+		ret_leaf_t *const leaf      = &leaves[l];
+		unsigned    const leaf_size = get_mode_size_bytes(leaf->mode);
+		unsigned          v         = 0;
+		unsigned          offset    = 0;
+		for (;; ++v) {
+			if (v == ret_spec->n_values)
+				goto fail;
+			unsigned const size = get_mode_size_bytes(ret_spec->modes[v]);
+			if (leaf->offset < offset + size)
+				break;
+			offset += size;
+		}
+
+		ir_mode *const mode = ret_spec->modes[v];
+		unsigned const size = get_mode_size_bytes(mode);
+		unsigned const pos  = leaf->offset - offset;
+		if (pos + leaf_size > size)
+			goto fail;
+		if (mode_is_float(mode) || mode_is_float(leaf->mode)) {
+			if (leaf->mode != mode)
+				goto fail;
+		} else if (mode_is_reference(leaf->mode) && leaf_size != size) {
+			goto fail;
+		}
+		leaf->value = v;
+		leaf->shift = 8 * (big_endian ? size - pos - leaf_size : pos);
+	}
+	return leaves;
+
+fail:
+	DEL_ARR_F(leaves);
+	return NULL;
+}
+
+/**
+ * Stores the values of an aggregate returned by a call leaf by leaf, so that
+ * the destination can be replaced by scalars later.
+ */
+static ir_node *store_ret_leaves(ir_node *const block, ir_node *const mem,
+                                 ir_node *const proj_res, long const pn,
+                                 aggregate_spec_t const *const ret_spec,
+                                 ret_leaf_t const *const leaves)
+{
+	ir_graph *const irg      = get_irn_irg(block);
+	size_t    const n_leaves = ARR_LEN(leaves);
+	ir_node **const sync_in  = ALLOCAN(ir_node*, n_leaves);
+	for (size_t l = 0; l < n_leaves; ++l) {
+		ret_leaf_t const *const leaf  = &leaves[l];
+		ir_mode          *const mode  = ret_spec->modes[leaf->value];
+		ir_node          *      value = new_r_Proj(proj_res, mode,
+		                                           pn + leaf->value);
+		if (leaf->shift > 0) {
+			ir_node *const shift = new_r_Const_long(irg, mode_Iu, leaf->shift);
+			value = new_r_Shr(block, value, shift, mode);
+		}
+		if (leaf->mode != mode)
+			value = new_r_Conv(block, value, leaf->mode);
+		ir_type *const type  = get_type_for_mode(leaf->mode);
+		ir_node *const store = new_r_Store(block, mem, leaf->addr, value,
+		                                   type, cons_none);
+		sync_in[l] = new_r_Proj(store, mode_M, pn_Store_M);
+	}
+	return new_r_Sync(block, n_leaves, sync_in);
+}
+
+/**
+ * Loads the values of a returned aggregate leaf by leaf and assembles them,
+ * so that the aggregate can be replaced by scalars later.
+ */
+static ir_node *load_ret_leaves(ir_node *const block, ir_node *const mem,
+                                ir_node **const values,
+                                aggregate_spec_t const *const ret_spec,
+                                ret_leaf_t const *const leaves)
+{
+	ir_graph *const irg      = get_irn_irg(block);
+	size_t    const n_leaves = ARR_LEN(leaves);
+	ir_node **const sync_in  = ALLOCAN(ir_node*, n_leaves);
+	for (unsigned v = 0; v < ret_spec->n_values; ++v)
+		values[v] = NULL;
+	for (size_t l = 0; l < n_leaves; ++l) {
+		ret_leaf_t const *const leaf  = &leaves[l];
+		ir_type          *const type  = get_type_for_mode(leaf->mode);
+		ir_node          *const load  = new_r_Load(block, mem, leaf->addr,
+		                                           leaf->mode, type, cons_none);
+		ir_node          *      value = new_r_Proj(load, leaf->mode,
+		                                           pn_Load_res);
+		sync_in[l] = new_r_Proj(load, mode_M, pn_Load_M);
+
+		ir_mode *const mode = ret_spec->modes[leaf->value];
+		if (leaf->mode != mode) {
+			/* zero extend, the bits above the leaf belong to other leaves */
+			if (mode_is_signed(leaf->mode))
+				value = new_r_Conv(block, value, find_unsigned_mode(leaf->mode));
+			value = new_r_Conv(block, value, mode);
+		}
+		if (leaf->shift > 0) {
+			ir_node *const shift = new_r_Const_long(irg, mode_Iu, leaf->shift);
+			value = new_r_Shl(block, value, shift, mode);
+		}
+		ir_node *const prev = values[leaf->value];
+		values[leaf->value] = prev != NULL
+			? new_r_Or(block, prev, value, mode) : value;
+	}
+	for (unsigned v = 0; v < ret_spec->n_values; ++v) {
+		if (values[v] == NULL)
+			values[v] = new_r_Const(irg, get_mode_null(ret_spec->modes[v]));
+	}
+	return new_r_Sync(block, n_leaves, sync_in);
+}
+
 static void fix_int_return(cl_entry const *const entry,
-                           ir_node *const base_addr,
+                           ir_node *const base_addr, ir_type *const type,
                            aggregate_spec_t const *const ret_spec,
-                           long const orig_pn, long const pn)
+                           long const orig_pn, long const pn,
+                           wlk_env *const env)
 {
 	ir_node  *const call  = entry->call;
 	ir_node  *const block = get_nodes_block(call);
@@ -626,6 +845,16 @@ static void fix_int_return(cl_entry const *const entry,
 	ir_node *dummy = new_r_Dummy(irg, mode_M);
 	edges_reroute(proj_mem, dummy);
 
+	ret_leaf_t *const leaves = get_ret_leaves(block, base_addr, type, ret_spec);
+	if (leaves != NULL) {
+		ir_node *const sync = store_ret_leaves(block, proj_mem, proj_res, pn,
+		                                       ret_spec, leaves);
+		edges_reroute(dummy, sync);
+		DEL_ARR_F(leaves);
+		env->split_ret = true;
+		return;
+	}
+
 	unsigned  const n_values = ret_spec->n_values;
 	ir_node **const sync_in  = ALLOCAN(ir_node*, n_values);
 	int             offset   = 0;
@@ -678,7 +907,7 @@ static void fix_call_compound_ret(const cl_entry *entry,
 		aggregate_spec_t const *const ret_spec = env->env->aggregate_ret(type);
 		unsigned                const n_values = ret_spec->n_values;
 		if (n_values > 0) {
-			fix_int_return(entry, dest_addr, ret_spec, i, pn);
+			fix_int_return(entry, dest_addr, type, ret_spec, i, pn, env);
 			pn += n_values;
 		} else {
 			/* add parameter with destination */
@@ -793,6 +1022,17 @@ static void transform_return(ir_node *ret, size_t n_ret_com, wlk_env *env)
 				for (unsigned i = 0; i < n_values; ++i) {
 					new_in[n_in++] = new_r_Unknown(irg, ret_spec->modes[i]);
 				}
+				continue;
+			}
+
+			ret_leaf_t *const leaves = is_compound_address(frame_type, pred)
+				? get_ret_leaves(block, pred, type, ret_spec) : NULL;
+			if (leaves != NULL) {
+				mem = load_ret_leaves(block, mem, &new_in[n_in], ret_spec,
+				                      leaves);
+				n_in += n_values;
+				DEL_ARR_F(leaves);
+				env->split_ret = true;
 			} else {
 				ir_node **const sync_in = ALLOCAN(ir_node*, n_values);
 				int             offset  = 0;
@@ -958,6 +1198,14 @@ static void transform_irg(lowering_env_t const *const env, ir_graph *const irg)
 	obstack_free(&walk_env.obst, NULL);
 	confirm_irg_properties(irg, walk_env.changed
 		? IR_GRAPH_PROPERTIES_CONTROL_FLOW : IR_GRAPH_PROPERTIES_ALL);
+
+	/* the temporaries of aggregates returned in registers are only accessed
+	 * leaf by leaf now and can be replaced by scalars, the remaining paths
+	 * are lowered like the rest of the graph */
+	if (walk_env.split_ret) {
+		scalar_replacement_opt(irg);
+		lower_highlevel_graph(irg);
+	}
 }
 
 static void lower_method_types(ir_type *const type, ir_entity *const entity,
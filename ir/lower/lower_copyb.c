@@ -8,6 +8,8 @@
  * @brief   Lower small CopyB nodes into a series of Load/Store nodes
  * @author  Michael Beck, Matthias Braun, Manuel Mohr
  */
+#include "lower_copyb.h"
+
 #include "adt/list.h"
 #include "ircons.h"
 #include "lowering.h"
@@ -27,6 +29,8 @@ static unsigned min_large_size; /**< The minimum size of a CopyB node
 static unsigned native_mode_bytes; /**< The size of the native mode in bytes. */
 static bool allow_misalignments; /**< Whether backend can handle misaligned
                                       loads and stores. */
+static ir_mode *mode_vector; /**< The widest mode for misaligned loads and
+                                  stores, NULL if none. */
 
 typedef struct walk_env {
 	ir_node **copybs; /**< The list of CopyB nodes. */
@@ -40,53 +44,93 @@ static ir_mode *get_ir_mode(unsigned mode_bytes)
 	case 4:  return mode_Iu;
 	case 8:  return mode_Lu;
 	default:
+		if (mode_vector != NULL && mode_bytes == get_mode_size_bytes(mode_vector))
+			return mode_vector;
 		panic("unexpected mode size requested in copyb lowering");
 	}
 }
 
+unsigned get_next_mem_chunk(unsigned size, unsigned done, unsigned *bytes)
+{
+	unsigned chunk_bytes = *bytes;
+	if (done == 0) {
+		while (chunk_bytes > size)
+			chunk_bytes /= 2;
+	}
+
+	unsigned rest = size - done;
+	if (chunk_bytes <= rest) {
+		*bytes = chunk_bytes;
+		return done;
+	}
+
+	/* cover the rest with one access ending at the last byte */
+	while (chunk_bytes / 2 >= rest)
+		chunk_bytes /= 2;
+	*bytes = chunk_bytes;
+	return size - chunk_bytes;
+}
+
+/**
+ * Copies @p mode_bytes bytes at @p offset with a Load/Store pair.
+ */
+static ir_node *copy_chunk(ir_node *block, ir_node *mem, ir_node *addr_src,
+                           ir_node *addr_dst, ir_type *tp, unsigned offset,
+                           unsigned mode_bytes)
+{
+	ir_graph *irg          = get_irn_irg(block);
+	ir_mode  *mode         = get_ir_mode(mode_bytes);
+	ir_mode  *mode_ref     = get_irn_mode(addr_src);
+	ir_mode  *mode_ref_int = get_reference_offset_mode(mode_ref);
+
+	/* construct offset */
+	ir_node *addr_const = new_r_Const_long(irg, mode_ref_int, offset);
+	ir_node *add        = new_r_Add(block, addr_src, addr_const, mode_ref);
+
+	ir_node *load     = new_r_Load(block, mem, add, mode, tp, cons_none);
+	ir_node *load_res = new_r_Proj(load, mode, pn_Load_res);
+	ir_node *load_mem = new_r_Proj(load, mode_M, pn_Load_M);
+
+	ir_node *addr_const2 = new_r_Const_long(irg, mode_ref_int, offset);
+	ir_node *add2        = new_r_Add(block, addr_dst, addr_const2, mode_ref);
+
+	ir_node *store = new_r_Store(block, load_mem, add2, load_res, tp,
+	                             cons_none);
+	return new_r_Proj(store, mode_M, pn_Store_M);
+}
+
 /**
  * Turn a small CopyB node into a series of Load/Store nodes.
  */
 static void lower_small_copyb_node(ir_node *irn)
 {
-	ir_graph *irg        = get_irn_irg(irn);
-	ir_node  *block      = get_nodes_block(irn);
-	ir_type  *tp         = get_CopyB_type(irn);
-	ir_node  *addr_src   = get_CopyB_src(irn);
-	ir_node  *addr_dst   = get_CopyB_dst(irn);
-	ir_node  *mem        = get_CopyB_mem(irn);
-	ir_mode  *mode_ref   = get_irn_mode(addr_src);
-	unsigned  mode_bytes = allow_misalignments ? native_mode_bytes
-	                                           : get_type_alignment(tp);
-	unsigned  size       = get_type_size(tp);
-	unsigned  offset     = 0;
-
-	while (offset < size) {
-		ir_mode *mode = get_ir_mode(mode_bytes);
-		for (; offset + mode_bytes <= size; offset += mode_bytes) {
-			ir_mode *mode_ref_int = get_reference_offset_mode(mode_ref);
-
-			/* construct offset */
-			ir_node *addr_const = new_r_Const_long(irg, mode_ref_int, offset);
-			ir_node *add        = new_r_Add(block, addr_src, addr_const,
-			                                mode_ref);
-
-			ir_node *load     = new_r_Load(block, mem, add, mode, tp, cons_none);
-			ir_node *load_res = new_r_Proj(load, mode, pn_Load_res);
-			ir_node *load_mem = new_r_Proj(load, mode_M, pn_Load_M);
-
-			ir_node *addr_const2 = new_r_Const_long(irg, mode_ref_int, offset);
-			ir_node *add2        = new_r_Add(block, addr_dst, addr_const2,
-			                                 mode_ref);
-
-			ir_node *store     = new_r_Store(block, load_mem, add2, load_res,
-			                                 tp, cons_none);
-			ir_node *store_mem = new_r_Proj(store, mode_M, pn_Store_M);
-
-			mem = store_mem;
+	ir_node *block    = get_nodes_block(irn);
+	ir_type *tp       = get_CopyB_type(irn);
+	ir_node *addr_src = get_CopyB_src(irn);
+	ir_node *addr_dst = get_CopyB_dst(irn);
+	ir_node *mem      = get_CopyB_mem(irn);
+	unsigned size     = get_type_size(tp);
+
+	if (allow_misalignments) {
+		/* use the widest accesses, the tail overlaps the last of them */
+		unsigned mode_bytes = mode_vector != NULL
+			? get_mode_size_bytes(mode_vector) : native_mode_bytes;
+		for (unsigned done = 0; done < size;) {
+			unsigned offset = get_next_mem_chunk(size, done, &mode_bytes);
+			mem  = copy_chunk(block, mem, addr_src, addr_dst, tp, offset,
+			                  mode_bytes);
+			done = offset + mode_bytes;
+		}
+	} else {
+		unsigned mode_bytes = get_type_alignment(tp);
+		unsigned offset     = 0;
+		while (offset < size) {
+			for (; offset + mode_bytes <= size; offset += mode_bytes) {
+				mem = copy_chunk(block, mem, addr_src, addr_dst, tp, offset,
+				                 mode_bytes);
+			}
+			mode_bytes /= 2;
 		}
-
-		mode_bytes /= 2;
 	}
 
 	exchange(irn, mem);
@@ -185,6 +229,7 @@ void lower_CopyB(ir_graph *irg, unsigned max_small_sz, unsigned min_large_sz,
 	min_large_size      = min_large_sz;
 	native_mode_bytes   = bparams->machine_size / 8;
 	allow_misalignments = allow_misaligns;
+	mode_vector         = bparams->mode_vector_move;
 
 	walk_env_t env = { .copybs = NEW_ARR_F(ir_node*, 0) };
 	irg_walk_graph(irg, NULL, find_copyb_nodes, &env);
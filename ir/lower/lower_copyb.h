@@ -0,0 +1,27 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Splitting of small memory operations into Loads and Stores
+ */
+#ifndef FIRM_LOWER_COPYB_H
+#define FIRM_LOWER_COPYB_H
+
+/**
+ * Determines the next access when splitting a memory operation of @p size
+ * bytes, of which the first @p done bytes are handled already, into
+ * misaligned accesses.
+ *
+ * @p bytes has to be initialized to the size of the widest access (a power of
+ * two) before the first call and receives the size of the next access. A rest
+ * smaller than the previous access is handled by a single access overlapping
+ * the already handled bytes.
+ *
+ * @return the offset of the next access
+ */
+unsigned get_next_mem_chunk(unsigned size, unsigned done, unsigned *bytes);
+
+#endif
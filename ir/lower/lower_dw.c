@@ -763,6 +763,55 @@ typedef ir_node* (*new_rd_shr_func)(dbg_info *dbgi, ir_node *block,
                                     ir_node *left, ir_node *right,
                                     ir_mode *mode);
 
+/**
+ * Translate a right shift by the constant @p right without control flow.
+ * Shifts by less than a word combine both words, which targets may match to
+ * double shift instructions.
+ */
+static void lower_const_shr(ir_node *node, ir_mode *mode, ir_node *right,
+                            new_rd_shr_func new_rd_shrs)
+{
+	ir_mode  *low_unsigned = env.p.word_unsigned;
+	unsigned  word_bits    = get_mode_modulo_shift(mode);
+	unsigned  amount       = get_Const_long(right) & (2 * word_bits - 1);
+	ir_node  *left         = get_binop_left(node);
+	ir_node  *left_low     = get_lowered_low(left);
+	ir_node  *left_high    = get_lowered_high(left);
+	ir_node  *block        = get_nodes_block(node);
+	ir_graph *irg          = get_irn_irg(node);
+	dbg_info *dbgi         = get_irn_dbg_info(node);
+	ir_node  *res_low;
+	ir_node  *res_high;
+
+	if (amount == 0) {
+		res_low  = left_low;
+		res_high = left_high;
+	} else if (amount < word_bits) {
+		ir_node *cnst  = new_r_Const_long(irg, low_unsigned, amount);
+		ir_node *cnst2 = new_r_Const_long(irg, low_unsigned,
+		                                  word_bits - amount);
+		ir_node *shr   = new_rd_Shr(dbgi, block, left_low, cnst,
+		                            low_unsigned);
+		ir_node *conv  = create_conv(block, left_high, low_unsigned);
+		ir_node *carry = new_rd_Shl(dbgi, block, conv, cnst2, low_unsigned);
+		res_low  = new_rd_Or(dbgi, block, shr, carry, low_unsigned);
+		res_high = new_rd_shrs(dbgi, block, left_high, cnst, mode);
+	} else {
+		ir_node *cnst = new_r_Const_long(irg, low_unsigned,
+		                                 amount - word_bits);
+		ir_node *conv = create_conv(block, left_high, low_unsigned);
+		res_low = new_rd_shrs(dbgi, block, conv, cnst, low_unsigned);
+		if (new_rd_shrs == new_rd_Shrs) {
+			ir_node *cnst2 = new_r_Const_long(irg, low_unsigned,
+			                                  word_bits - 1);
+			res_high = new_rd_Shrs(dbgi, block, left_high, cnst2, mode);
+		} else {
+			res_high = new_r_Const_null(irg, mode);
+		}
+	}
+	ir_set_dw_lowered(node, res_low, res_high);
+}
+
 static void lower_shr_helper(ir_node *node, ir_mode *mode,
                              new_rd_shr_func new_rd_shrs)
 {
@@ -803,6 +852,11 @@ static void lower_shr_helper(ir_node *node, ir_mode *mode,
 		right = create_conv(block, right, low_unsigned);
 	}
 
+	if (is_Const(right)) {
+		lower_const_shr(node, mode, right, new_rd_shrs);
+		return;
+	}
+
 	ir_node *lower_block = part_block_dw(node);
 	env.flags |= CF_CHANGED;
 	block = get_nodes_block(node);
@@ -879,6 +933,46 @@ static void lower_Shrs(ir_node *node, ir_mode *mode)
 	lower_shr_helper(node, mode, new_rd_Shrs);
 }
 
+/**
+ * Translate a left shift by the constant @p right without control flow,
+ * see lower_const_shr().
+ */
+static void lower_const_shl(ir_node *node, ir_mode *mode, ir_node *right)
+{
+	ir_mode  *low_unsigned = env.p.word_unsigned;
+	unsigned  word_bits    = get_mode_modulo_shift(mode);
+	unsigned  amount       = get_Const_long(right) & (2 * word_bits - 1);
+	ir_node  *left         = get_binop_left(node);
+	ir_node  *left_low     = get_lowered_low(left);
+	ir_node  *left_high    = get_lowered_high(left);
+	ir_node  *block        = get_nodes_block(node);
+	ir_graph *irg          = get_irn_irg(node);
+	dbg_info *dbgi         = get_irn_dbg_info(node);
+	ir_node  *res_low;
+	ir_node  *res_high;
+
+	if (amount == 0) {
+		res_low  = left_low;
+		res_high = left_high;
+	} else if (amount < word_bits) {
+		ir_node *cnst  = new_r_Const_long(irg, low_unsigned, amount);
+		ir_node *cnst2 = new_r_Const_long(irg, low_unsigned,
+		                                  word_bits - amount);
+		ir_node *shl   = new_rd_Shl(dbgi, block, left_high, cnst, mode);
+		ir_node *conv  = create_conv(block, left_low, mode);
+		ir_node *carry = new_rd_Shr(dbgi, block, conv, cnst2, mode);
+		res_low  = new_rd_Shl(dbgi, block, left_low, cnst, low_unsigned);
+		res_high = new_rd_Or(dbgi, block, shl, carry, mode);
+	} else {
+		ir_node *cnst = new_r_Const_long(irg, low_unsigned,
+		                                 amount - word_bits);
+		ir_node *conv = create_conv(block, left_low, mode);
+		res_low  = new_r_Const_null(irg, low_unsigned);
+		res_high = new_rd_Shl(dbgi, block, conv, cnst, mode);
+	}
+	ir_set_dw_lowered(node, res_low, res_high);
+}
+
 static void lower_Shl(ir_node *node, ir_mode *mode)
 {
 	ir_node  *right         = get_binop_right(node);
@@ -917,6 +1011,11 @@ static void lower_Shl(ir_node *node, ir_mode *mode)
 		right = create_conv(lower_block, right, low_unsigned);
 	}
 
+	if (is_Const(right)) {
+		lower_const_shl(node, mode, right);
+		return;
+	}
+
 	part_block_dw(node);
 	env.flags |= CF_CHANGED;
 	ir_node *block = get_nodes_block(node);
@@ -1186,6 +1285,14 @@ static void lower_Cond(ir_node *node, ir_mode *high_mode)
 	assert(relation != ir_relation_equal);
 	assert(relation != ir_relation_less_greater);
 
+	if (env.p.create_cmp != NULL) {
+		ir_node *cmp = env.p.create_cmp(dbg, block, lentry, rentry, relation);
+		if (cmp != NULL) {
+			set_Cond_selector(node, cmp);
+			return;
+		}
+	}
+
 	/* a rel b <==> a_h REL b_h || (a_h == b_h && a_l rel b_l) */
 	ir_node *dstT, *dstF, *newbl_eq, *newbl_l;
 	ir_node *projEqF;
@@ -1378,6 +1485,14 @@ static void lower_Cmp(ir_node *cmp, ir_mode *m)
 	assert(relation != ir_relation_equal);
 	assert(relation != ir_relation_less_greater);
 
+	if (env.p.create_cmp != NULL) {
+		ir_node *res = env.p.create_cmp(dbg, block, lentry, rentry, relation);
+		if (res != NULL) {
+			exchange(cmp, res);
+			return;
+		}
+	}
+
 	/* a rel b <==> a_h REL b_h || (a_h == b_h && a_l rel b_l) */
 	ir_node *high1 = new_rd_Cmp(dbg, block, lentry->high_word,
 								rentry->high_word,
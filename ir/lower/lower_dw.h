@@ -36,6 +36,23 @@ typedef ir_entity *(create_intrinsic_fkt)(ir_type *method, const ir_op *op,
                                           const ir_mode *imode,
                                           const ir_mode *omode, void *context);
 
+/**
+ * A callback type for creating a target specific ordered comparison of two
+ * doublewords.
+ *
+ * @param dbgi      debug info of the comparison
+ * @param block     the block of the comparison
+ * @param left      the lowered left operand
+ * @param right     the lowered right operand
+ * @param relation  the relation, one of <, <=, > and >=
+ * @return a mode_b node usable as Cond or Mux selector or NULL to use the
+ *         generic lowering
+ */
+typedef ir_node *(create_dw_cmp_fkt)(dbg_info *dbgi, ir_node *block,
+                                     const lower64_entry_t *left,
+                                     const lower64_entry_t *right,
+                                     ir_relation relation);
+
 /**
  * The lowering parameter description.
  */
@@ -47,6 +64,8 @@ typedef struct lwrdw_param_t {
 	unsigned short        doubleword_size;  /**< bitsize of the doubleword mode */
 	bool                  big_endian:1;     /**< target is big endian if true,
 											     else little endian */
+	create_dw_cmp_fkt    *create_cmp;       /**< callback that creates ordered
+	                                             comparisons, may be NULL */
 } lwrdw_param_t;
 
 /**
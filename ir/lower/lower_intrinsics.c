@@ -8,9 +8,11 @@
  * @brief   lowering of Calls of intrinsic functions
  * @author  Michael Beck
  */
+#include <limits.h>
 #include <stdbool.h>
 
 #include "lowering.h"
+#include "lower_copyb.h"
 #include "irop_t.h"
 #include "irprog_t.h"
 #include "irnode_t.h"
@@ -23,11 +25,16 @@
 #include "irverify.h"
 #include "pmap.h"
 #include "array.h"
+#include "bitfiddle.h"
 #include "iropt_dbg.h"
 #include "panic.h"
 #include "be.h"
 #include "util.h"
 #include "tv_t.h"
+#include "type_t.h"
+
+/** Maximum number of Loads/Stores per operand for inlined memset/memcmp. */
+#define MAX_INLINE_MEM_ACCESSES 8
 
 /** Walker environment. */
 struct ir_intrinsics_map {
@@ -68,9 +75,9 @@ ir_intrinsics_map *ir_create_intrinsics_map(i_record *list, size_t length,
 
 void ir_free_intrinsics_map(ir_intrinsics_map *map)
 {
-	free(map->i_map);
+	xfree(map->i_map);
 	pmap_destroy(map->c_map);
-	free(map);
+	xfree(map);
 }
 
 /**
@@ -849,6 +856,72 @@ int i_mapper_strcpy(ir_node *call)
 	return 0;
 }
 
+/**
+ * Returns the constant length @p len of a memory function if it is positive
+ * and at most @p max_size, 0 otherwise.
+ */
+static unsigned get_const_mem_length(ir_node *len, unsigned long max_size)
+{
+	if (!is_Const(len))
+		return 0;
+	ir_tarval *tv = get_Const_tarval(len);
+	if (!tarval_is_long(tv))
+		return 0;
+	long size = get_tarval_long(tv);
+	if (size <= 0 || (unsigned long)size > max_size)
+		return 0;
+	return (unsigned)size;
+}
+
+/**
+ * Returns a byte array type of @p size bytes for the memory accesses
+ * replacing a call to a memory function.
+ */
+static ir_type *get_byte_array_type(unsigned size)
+{
+	ir_type *const byte_type = get_type_for_mode(mode_Bu);
+	ir_type *const res       = new_type_array(byte_type);
+	set_array_size_int(res, size);
+	set_type_size(res, size);
+	set_type_state(res, layout_fixed);
+	return res;
+}
+
+/**
+ * Returns the maximum length of inlined memset/memcmp calls, 0 if the backend
+ * does not allow misaligned accesses.
+ */
+static unsigned get_max_inline_mem_length(void)
+{
+	backend_params const *const be_params = be_get_backend_param();
+	if (!be_params->unaligned_memaccess_supported)
+		return 0;
+	return MAX_INLINE_MEM_ACCESSES * (be_params->machine_size / 8);
+}
+
+static ir_mode *get_chunk_mode(unsigned bytes)
+{
+	switch (bytes) {
+	case 1: return mode_Bu;
+	case 2: return mode_Hu;
+	case 4: return mode_Iu;
+	case 8: return mode_Lu;
+	}
+	panic("unexpected chunk size");
+}
+
+static ir_node *new_chunk_address(ir_node *block, ir_node *ptr,
+                                  unsigned offset)
+{
+	if (offset == 0)
+		return ptr;
+	ir_graph *const irg      = get_irn_irg(block);
+	ir_mode  *const mode_ref = get_irn_mode(ptr);
+	ir_mode  *const mode_int = get_reference_offset_mode(mode_ref);
+	ir_node  *const cnst     = new_r_Const_long(irg, mode_int, offset);
+	return new_r_Add(block, ptr, cnst, mode_ref);
+}
+
 int i_mapper_memcpy(ir_node *call)
 {
 	ir_node *dst = get_Call_param(call, 0);
@@ -864,6 +937,21 @@ int i_mapper_memcpy(ir_node *call)
 		replace_call(dst, call, mem);
 		return 1;
 	}
+
+	unsigned const size = get_const_mem_length(len, UINT_MAX);
+	if (size != 0) {
+		/* a memcpy(d, s, C) ==> CopyB(d, s), lowered for the target later */
+		dbg_info *const dbgi  = get_irn_dbg_info(call);
+		ir_node  *const block = get_nodes_block(call);
+		ir_node  *const mem   = get_Call_mem(call);
+		ir_type  *const type  = get_byte_array_type(size);
+		ir_node  *const copyb = new_rd_CopyB(dbgi, block, mem, dst, src, type,
+		                                     cons_none);
+
+		DBG_OPT_ALGSIM0(call, copyb);
+		replace_call(dst, call, copyb);
+		return 1;
+	}
 	return 0;
 }
 
@@ -898,9 +986,93 @@ int i_mapper_memset(ir_node *call)
 		replace_call(dst, call, mem);
 		return 1;
 	}
+
+	unsigned const size = get_const_mem_length(len, get_max_inline_mem_length());
+	if (size != 0) {
+		/* a memset(d, C, len) ==> Stores of C replicated to words */
+		ir_graph *const irg   = get_irn_irg(call);
+		ir_node  *const block = get_nodes_block(call);
+		ir_node  *const dst   = get_Call_param(call, 0);
+		ir_node  *const value = get_Call_param(call, 1);
+		ir_node  *const byte  = new_r_Conv(block, value, mode_Bu);
+		ir_type  *const type  = get_byte_array_type(size);
+		ir_node        *mem   = get_Call_mem(call);
+
+		unsigned bytes = be_get_backend_param()->machine_size / 8;
+		for (unsigned done = 0; done < size;) {
+			unsigned const offset = get_next_mem_chunk(size, done, &bytes);
+			ir_mode *const mode   = get_chunk_mode(bytes);
+			ir_node       *val    = byte;
+			if (bytes > 1) {
+				/* all_one / 0xFF has a one in the lowest bit of each byte */
+				ir_tarval *const ones = tarval_div(get_mode_all_one(mode),
+					new_tarval_from_long(0xFF, mode));
+				ir_node *const cnst = new_r_Const(irg, ones);
+				val = new_r_Mul(block, new_r_Conv(block, byte, mode), cnst, mode);
+			}
+			ir_node *const addr  = new_chunk_address(block, dst, offset);
+			ir_node *const store = new_r_Store(block, mem, addr, val, type,
+			                                   cons_none);
+			mem  = new_r_Proj(store, mode_M, pn_Store_M);
+			done = offset + bytes;
+		}
+
+		DBG_OPT_ALGSIM0(call, dst);
+		replace_call(dst, call, mem);
+		return 1;
+	}
 	return 0;
 }
 
+/**
+ * Checks whether the result of @p call is only compared for (in)equality
+ * against zero.
+ */
+static bool is_result_only_tested_for_zero(ir_node *call)
+{
+	ir_node *const proj_res = get_Proj_for_pn(call, pn_Call_T_result);
+	if (proj_res == NULL)
+		return true;
+	foreach_out_edge(proj_res, edge) {
+		ir_node *const res = get_edge_src_irn(edge);
+		foreach_out_edge(res, res_edge) {
+			ir_node *const cmp = get_edge_src_irn(res_edge);
+			if (!is_Cmp(cmp) || get_Cmp_left(cmp) != res)
+				return false;
+			ir_node *const right = get_Cmp_right(cmp);
+			if (!is_Const(right) || !is_Const_null(right))
+				return false;
+			ir_relation const relation = get_Cmp_relation(cmp);
+			if (relation != ir_relation_equal
+			 && relation != ir_relation_less_greater)
+				return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Replaces the zero tests of the result of @p call by tests of @p diff.
+ */
+static void replace_zero_tests(ir_node *call, ir_node *diff)
+{
+	ir_node *const proj_res = get_Proj_for_pn(call, pn_Call_T_result);
+	if (proj_res == NULL)
+		return;
+	ir_graph *const irg  = get_irn_irg(call);
+	ir_node  *const zero = new_r_Const_null(irg, get_irn_mode(diff));
+	foreach_out_edge(proj_res, edge) {
+		ir_node *const res = get_edge_src_irn(edge);
+		foreach_out_edge_safe(res, res_edge) {
+			ir_node    *const cmp      = get_edge_src_irn(res_edge);
+			ir_node    *const block    = get_nodes_block(cmp);
+			dbg_info   *const dbgi     = get_irn_dbg_info(cmp);
+			ir_relation const relation = get_Cmp_relation(cmp);
+			exchange(cmp, new_rd_Cmp(dbgi, block, diff, zero, relation));
+		}
+	}
+}
+
 int i_mapper_memcmp(ir_node *call)
 {
 	ir_node *left  = get_Call_param(call, 0);
@@ -924,5 +1096,49 @@ int i_mapper_memcmp(ir_node *call)
 		replace_call(irn, call, mem);
 		return 1;
 	}
+
+	unsigned const size = get_const_mem_length(len, get_max_inline_mem_length());
+	if (size != 0 && is_result_only_tested_for_zero(call)) {
+		/* a memcmp(a, b, len) ==/!= 0 ==> Loads combined by Eor/Or */
+		ir_graph *const irg       = get_irn_irg(call);
+		ir_node  *const block     = get_nodes_block(call);
+		ir_type  *const type      = get_byte_array_type(size);
+		unsigned        bytes     = be_get_backend_param()->machine_size / 8;
+		ir_mode  *const diff_mode = get_chunk_mode(MIN(bytes, 1u << log2_floor(size)));
+		ir_node        *mem       = get_Call_mem(call);
+		ir_node        *diff      = NULL;
+
+		for (unsigned done = 0; done < size;) {
+			unsigned const offset = get_next_mem_chunk(size, done, &bytes);
+			ir_mode *const mode   = get_chunk_mode(bytes);
+			ir_node       *vals[2];
+			for (unsigned i = 0; i < 2; ++i) {
+				ir_node *const ptr  = get_Call_param(call, i);
+				ir_node *const addr = new_chunk_address(block, ptr, offset);
+				ir_node *const load = new_r_Load(block, mem, addr, mode, type,
+				                                 cons_none);
+				mem     = new_r_Proj(load, mode_M, pn_Load_M);
+				vals[i] = new_r_Proj(load, mode, pn_Load_res);
+			}
+			ir_node *chunk_diff = new_r_Eor(block, vals[0], vals[1], mode);
+			if (mode != diff_mode)
+				chunk_diff = new_r_Conv(block, chunk_diff, diff_mode);
+			diff = diff == NULL ? chunk_diff
+			                    : new_r_Or(block, diff, chunk_diff, diff_mode);
+			done = offset + bytes;
+		}
+
+		ir_node   *const adr     = get_Call_ptr(call);
+		ir_entity *const ent     = get_Address_entity(adr);
+		ir_type   *const call_tp = get_entity_type(ent);
+		ir_type   *const res_tp  = get_method_res_type(call_tp, 0);
+		ir_mode   *const mode    = get_type_mode(res_tp);
+
+		replace_zero_tests(call, diff);
+		irn = new_r_Const_null(irg, mode);
+		DBG_OPT_ALGSIM0(call, irn);
+		replace_call(irn, call, mem);
+		return 1;
+	}
 	return 0;
 }
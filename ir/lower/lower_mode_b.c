@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+#include "be.h"
 #include "irnode_t.h"
 #include "ircons_t.h"
 #include "irflag.h"
@@ -48,6 +49,13 @@ static ir_node *create_not(dbg_info *dbgi, ir_node *node)
 
 static ir_node *convert_to_modeb(ir_node *node)
 {
+	/* a materialized comparison: use the comparison itself, so the backend
+	 * can reuse its flags */
+	if (is_Mux(node) && is_Const(get_Mux_false(node))
+	    && is_Const_null(get_Mux_false(node)) && is_Const(get_Mux_true(node))
+	    && is_Const_one(get_Mux_true(node)))
+		return get_Mux_sel(node);
+
 	ir_node  *block = get_nodes_block(node);
 	ir_graph *irg   = get_irn_irg(node);
 	ir_node  *zero  = new_r_Const_null(irg, lowered_mode);
@@ -55,6 +63,26 @@ static ir_node *convert_to_modeb(ir_node *node)
 	return cmp;
 }
 
+/**
+ * Materializes the value of a comparison without control flow as
+ * Mux(cmp, 0, 1), which becomes a single set instruction in the backend.
+ * Returns NULL if the backend does not support such a Mux.
+ */
+static ir_node *create_mux_set(ir_node *cond_value, ir_mode *dest_mode)
+{
+	ir_graph *irg  = get_irn_irg(cond_value);
+	ir_node  *one  = new_r_Const_one(irg, dest_mode);
+	ir_node  *zero = new_r_Const_null(irg, dest_mode);
+
+	arch_allow_ifconv_func const allow_ifconv
+		= be_get_backend_param()->allow_ifconv;
+	if (!allow_ifconv(cond_value, zero, one))
+		return NULL;
+
+	ir_node *block = get_nodes_block(cond_value);
+	return new_r_Mux(block, cond_value, zero, one, dest_mode);
+}
+
 /**
  * implementation of create_set_func which produces a cond with control
  * flow
@@ -90,6 +118,15 @@ static ir_node *create_cond_set(ir_node *cond_value, ir_mode *dest_mode)
 	return phi;
 }
 
+/**
+ * Returns whether @p node is a comparison: a Cmp or a target specific node
+ * like the doubleword comparisons of the 64bit lowering.
+ */
+static bool is_comparison(const ir_node *node)
+{
+	return is_Cmp(node) || get_irn_opcode(node) > iro_last;
+}
+
 static ir_node *lower_node(ir_node *node)
 {
 	ir_node *res = (ir_node *)get_irn_link(node);
@@ -150,7 +187,19 @@ static ir_node *lower_node(ir_node *node)
 	}
 
 	case iro_Not: {
-		ir_node *op     = get_Not_op(node);
+		ir_node *op = get_Not_op(node);
+		if (is_Cmp(op) && get_irn_n_edges(op) == 1) {
+			/* materialize the negated comparison instead of flipping the
+			 * materialized value */
+			ir_node    *cmp_block = get_nodes_block(op);
+			ir_node    *left      = get_Cmp_left(op);
+			ir_node    *right     = get_Cmp_right(op);
+			ir_relation relation  = get_negated_relation(get_Cmp_relation(op));
+			ir_node    *negated   = new_rd_Cmp(dbgi, cmp_block, left, right,
+			                                   relation);
+			res = lower_node(negated);
+			break;
+		}
 		ir_node *low_op = lower_node(op);
 
 		res = create_not(dbgi, low_op);
@@ -172,9 +221,6 @@ static ir_node *lower_node(ir_node *node)
 		break;
 	}
 
-	case iro_Cmp:
-		res = create_cond_set(node, mode);
-		break;
 
 	case iro_Const: {
 		ir_tarval *tv = get_Const_tarval(node);
@@ -197,6 +243,12 @@ static ir_node *lower_node(ir_node *node)
 		break;
 
 	default:
+		if (is_comparison(node)) {
+			res = create_mux_set(node, mode);
+			if (res == NULL)
+				res = create_cond_set(node, mode);
+			break;
+		}
 		panic("don't know how to lower mode_b node %+F", node);
 	}
 
@@ -222,7 +274,7 @@ static void collect_needs_lowering(ir_node *node, void *env)
 	 * something our lower_node function can handle) */
 	if (get_irn_mode(node) == mode_b) {
 		assert(is_And(node) || is_Or(node) || is_Eor(node) || is_Phi(node)
-		       || is_Not(node) || is_Mux(node) || is_Cmp(node)
+		       || is_Not(node) || is_Mux(node) || is_comparison(node)
 		       || is_Const(node) || is_Unknown(node) || is_Bad(node));
 		return;
 	}
@@ -230,7 +282,7 @@ static void collect_needs_lowering(ir_node *node, void *env)
 	foreach_irn_in(node, i, in) {
 		if (get_irn_mode(in) != mode_b)
 			continue;
-		if (is_Cmp(in) && needs_mode_b_input(node, i))
+		if (is_comparison(in) && needs_mode_b_input(node, i))
 			continue;
 
 		needs_lowering_t entry = { .node  = node, .input = i };
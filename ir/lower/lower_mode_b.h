@@ -12,6 +12,9 @@
  * modeled as cpu flags). So you often have to convert them into machine words
  * with the values 0/1 and operate on them instead.
  *
+ * Comparisons are materialized once each as Mux(cmp, 0, 1) if the backend
+ * allows such a Mux, and with control flow otherwise.
+ *
  * After this pass the following holds:
  *   - The only inputs with mode_b are for the Cond node and the Sel input of
  *     a Mux node.
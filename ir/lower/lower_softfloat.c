@@ -10,6 +10,7 @@
  */
 #include <stdbool.h>
 
+#include "array.h"
 #include "be.h"
 #include "dbginfo_t.h"
 #include "panic.h"
@@ -28,6 +29,7 @@
 #include "pmap.h"
 #include "type_t.h"
 #include "tv_t.h"
+#include "util.h"
 
 typedef bool (*lower_softfloat_func)(ir_node *node);
 
@@ -270,15 +272,23 @@ static ir_node *create_softfloat_address(const ir_node *n, const char *name)
 
 	ir_graph  *const irg = get_irn_irg(n);
 	ir_entity *const ent = create_compilerlib_entity(id, method);
+	add_entity_additional_properties(ent, mtp_property_pure
+	                                 | mtp_property_nothrow
+	                                 | mtp_property_terminates);
 	return new_r_Address(irg, ent);
 }
 
-static ir_node *make_softfloat_call(ir_node *const n, char const *const name,
-                                    size_t const arity,
-                                    ir_node *const *const in)
+/**
+ * Creates a call of the softfloat function @p name replacing @p n in
+ * @p block.
+ */
+static ir_node *make_softfloat_call_in(ir_node *const block,
+                                       ir_node *const n,
+                                       char const *const name,
+                                       size_t const arity,
+                                       ir_node *const *const in)
 {
 	dbg_info *const dbgi     = get_irn_dbg_info(n);
-	ir_node  *const block    = get_nodes_block(n);
 	ir_graph *const irg      = get_irn_irg(n);
 	ir_node  *const nomem    = get_irg_no_mem(irg);
 	ir_node  *const callee   = create_softfloat_address(n, name);
@@ -291,6 +301,466 @@ static ir_node *make_softfloat_call(ir_node *const n, char const *const name,
 	return result;
 }
 
+/**
+ * Creates a call of the softfloat function @p name replacing @p n.  The
+ * functions are pure, so the call floats and equal calls can be merged.
+ */
+static ir_node *make_softfloat_call(ir_node *const n, char const *const name,
+                                    size_t const arity,
+                                    ir_node *const *const in)
+{
+	ir_node *const block  = get_nodes_block(n);
+	ir_node *const result = make_softfloat_call_in(block, n, name, arity, in);
+	set_irn_pinned(skip_Proj(skip_Proj(result)), false);
+	return result;
+}
+
+/** Set if the common cases are computed inline. */
+static bool inline_fast_paths;
+
+/** The Adds, Subs and Convs, which get an inline fast path and a call for
+ * the other cases. */
+static ir_node **fast_path_nodes;
+
+/** The type of the clz Builtin. */
+static ir_type *clz_tp;
+
+/**
+ * Builds the integer operations on the bits of floating point values in a
+ * block.
+ */
+typedef struct fp_builder_t {
+	dbg_info *dbgi;
+	ir_node  *block;
+	ir_mode  *mode;     /**< the lowered unsigned mode */
+	ir_mode  *smode;    /**< the signed mode of the same size */
+	unsigned  bits;     /**< the number of bits */
+	unsigned  mantissa; /**< the number of explicit mantissa bits */
+	unsigned  exponent; /**< the number of exponent bits */
+} fp_builder_t;
+
+static fp_builder_t make_fp_builder(ir_node *const n, ir_node *const block,
+                                    ir_mode *const float_mode)
+{
+	ir_mode *const mode = get_lowered_mode(float_mode);
+	return (fp_builder_t) {
+		.dbgi     = get_irn_dbg_info(n),
+		.block    = block,
+		.mode     = mode,
+		.smode    = find_signed_mode(mode),
+		.bits     = get_mode_size_bits(mode),
+		.mantissa = get_mode_mantissa_size(float_mode),
+		.exponent = get_mode_exponent_size(float_mode),
+	};
+}
+
+/**
+ * Creates a Const, which is registered as start block node while the
+ * control flow is changed.
+ */
+static ir_node *fp_tv(fp_builder_t const *const b, ir_tarval *const tv)
+{
+	ir_graph *const irg = get_irn_irg(b->block);
+	ir_node  *const res = new_r_Const(irg, tv);
+	if (ir_resources_reserved(irg) & IR_RESOURCE_PHI_LIST)
+		collect_new_start_block_node(res);
+	return res;
+}
+
+static ir_node *fp_const(fp_builder_t const *const b, ir_mode *const mode,
+                         long const value)
+{
+	return fp_tv(b, new_tarval_from_long(value, mode));
+}
+
+/** Returns the tarval 2^@p k - 1 in @p mode. */
+static ir_tarval *fp_mask_tv(ir_mode *const mode, unsigned const k)
+{
+	ir_tarval *const one = get_mode_one(mode);
+	return tarval_sub(tarval_shl_unsigned(one, k), one);
+}
+
+static ir_node *fp_mask(fp_builder_t const *const b, unsigned const k)
+{
+	return fp_tv(b, fp_mask_tv(b->mode, k));
+}
+
+static ir_node *fp_and(fp_builder_t const *const b, ir_node *const l,
+                       ir_node *const r)
+{
+	return new_rd_And(b->dbgi, b->block, l, r, get_irn_mode(l));
+}
+
+static ir_node *fp_or(fp_builder_t const *const b, ir_node *const l,
+                      ir_node *const r)
+{
+	return new_rd_Or(b->dbgi, b->block, l, r, get_irn_mode(l));
+}
+
+static ir_node *fp_eor(fp_builder_t const *const b, ir_node *const l,
+                       ir_node *const r)
+{
+	return new_rd_Eor(b->dbgi, b->block, l, r, get_irn_mode(l));
+}
+
+static ir_node *fp_add(fp_builder_t const *const b, ir_node *const l,
+                       ir_node *const r)
+{
+	return new_rd_Add(b->dbgi, b->block, l, r, get_irn_mode(l));
+}
+
+static ir_node *fp_sub(fp_builder_t const *const b, ir_node *const l,
+                       ir_node *const r)
+{
+	return new_rd_Sub(b->dbgi, b->block, l, r, get_irn_mode(l));
+}
+
+static ir_node *fp_conv(fp_builder_t const *const b, ir_node *const op,
+                        ir_mode *const mode)
+{
+	return new_rd_Conv(b->dbgi, b->block, op, mode);
+}
+
+typedef ir_node *(*new_shift_func)(dbg_info *dbgi, ir_node *block,
+                                    ir_node *left, ir_node *right,
+                                    ir_mode *mode);
+
+/**
+ * Shifts @p x by the mode_Iu value @p count, which is less than the size of
+ * @p x.  The shift is done in a mode with the modulo shift of the target, as
+ * backends like arm only support these.
+ */
+static ir_node *fp_shift(fp_builder_t const *const b,
+                         new_shift_func const new_shift, ir_node *const x,
+                         ir_node *const count)
+{
+	ir_mode  *const mode   = get_irn_mode(x);
+	unsigned  const bits   = get_mode_size_bits(mode);
+	unsigned  const modulo = MAX(be_get_backend_param()->modulo_shift, bits);
+	if (get_mode_modulo_shift(mode) == modulo)
+		return new_shift(b->dbgi, b->block, x, count, mode);
+
+	ir_mode *const shift_mode = new_int_mode(get_mode_name(mode),
+	                                         irma_twos_complement, bits,
+	                                         mode_is_signed(mode), modulo);
+	ir_node *const op  = fp_conv(b, x, shift_mode);
+	ir_node *const res = new_shift(b->dbgi, b->block, op, count, shift_mode);
+	return fp_conv(b, res, mode);
+}
+
+/** Shifts @p x left by the mode_Iu value @p count. */
+static ir_node *fp_shl(fp_builder_t const *const b, ir_node *const x,
+                       ir_node *const count)
+{
+	return fp_shift(b, new_rd_Shl, x, count);
+}
+
+/** Shifts @p x logically right by the mode_Iu value @p count. */
+static ir_node *fp_shr(fp_builder_t const *const b, ir_node *const x,
+                       ir_node *const count)
+{
+	return fp_shift(b, new_rd_Shr, x, count);
+}
+
+static ir_node *fp_shl_c(fp_builder_t const *const b, ir_node *const x,
+                         unsigned const count)
+{
+	return fp_shl(b, x, fp_const(b, mode_Iu, count));
+}
+
+static ir_node *fp_shr_c(fp_builder_t const *const b, ir_node *const x,
+                         unsigned const count)
+{
+	return fp_shr(b, x, fp_const(b, mode_Iu, count));
+}
+
+/** Returns the sign bit in the lowered mode. */
+static ir_node *fp_sign_bit(fp_builder_t const *const b)
+{
+	return fp_tv(b, tarval_shl_unsigned(get_mode_one(b->mode), b->bits - 1));
+}
+
+/** Returns 1 if the sign bit of @p x is set and 0 otherwise. */
+static ir_node *fp_sign(fp_builder_t const *const b, ir_node *const x)
+{
+	return fp_shr_c(b, x, get_mode_size_bits(get_irn_mode(x)) - 1);
+}
+
+/**
+ * Returns all bits set if the sign bit of @p x is set and 0 otherwise.
+ * This avoids a Shrs, which is expensive for lowered 64 bit values.
+ */
+static ir_node *fp_sign_mask(fp_builder_t const *const b, ir_node *const x)
+{
+	return fp_sub(b, fp_const(b, get_irn_mode(x), 0), fp_sign(b, x));
+}
+
+/** Returns 1 if @p x is not 0 and 0 otherwise. */
+static ir_node *fp_nonzero(fp_builder_t const *const b, ir_node *const x)
+{
+	ir_node *const zero = fp_const(b, get_irn_mode(x), 0);
+	return fp_sign(b, fp_or(b, x, fp_sub(b, zero, x)));
+}
+
+/** Returns the bits of the floating point value @p value. */
+static ir_node *fp_bits(fp_builder_t const *const b, ir_node *const value)
+{
+	return new_rd_Bitcast(b->dbgi, b->block, value, b->mode);
+}
+
+/**
+ * Returns an integer, which orders like the floating point value with the
+ * bits @p x, if it is no NaN, with both zeros being equal.  @p nan is set to
+ * 1 for a NaN and 0 otherwise.
+ */
+static ir_node *fp_order_key(fp_builder_t const *const b, ir_node *const x,
+                             ir_node **const nan)
+{
+	ir_node   *const mag    = fp_and(b, x, fp_mask(b, b->bits - 1));
+	ir_tarval *const inf_tv = tarval_shl_unsigned(
+		fp_mask_tv(b->mode, b->exponent), b->mantissa);
+	*nan = fp_sign(b, fp_sub(b, fp_tv(b, inf_tv), mag));
+
+	ir_node *const sign = fp_conv(b, fp_sign_mask(b, x), b->smode);
+	return fp_sub(b, fp_eor(b, fp_conv(b, mag, b->smode), sign), sign);
+}
+
+/**
+ * Computes the sum of the floating point values with the bits @p x and @p y
+ * rounded to nearest even.  @p is_fast is set to a Cmp, which is true if the
+ * values are normals of the same sign, so the sum is correct.
+ */
+static ir_node *fp_add_same_sign(fp_builder_t const *const b, ir_node *const x,
+                                 ir_node *const y, ir_node **const is_fast)
+{
+	unsigned const w      = b->bits;
+	unsigned const man    = b->mantissa;
+	/* guard bits keep the sum of both mantissas below the sign bit */
+	unsigned const guard  = w - man - 3;
+	ir_node *const zero   = fp_const(b, b->mode, 0);
+	ir_node *const one    = fp_const(b, b->mode, 1);
+	ir_node *const magmsk = fp_mask(b, w - 1);
+	ir_node *const sign   = fp_and(b, x, fp_sign_bit(b));
+
+	/* order the magnitudes, so hi has the larger exponent */
+	ir_node *const mag_x = fp_and(b, x, magmsk);
+	ir_node *const mag_y = fp_and(b, y, magmsk);
+	ir_node *const swap  = fp_and(b, fp_eor(b, mag_x, mag_y),
+	                              fp_sign_mask(b, fp_sub(b, mag_x, mag_y)));
+	ir_node *const hi    = fp_eor(b, mag_x, swap);
+	ir_node *const lo    = fp_eor(b, mag_y, swap);
+
+	ir_node *const exp_hi = fp_shr_c(b, hi, man);
+	ir_node *const exp_lo = fp_shr_c(b, lo, man);
+	ir_node *const diff   = fp_sub(b, exp_hi, exp_lo);
+
+	/* the slow cases: different signs, a subnormal or zero and a possible
+	 * overflow, an infinity or NaN */
+	long     const max_exp = (1L << b->exponent) - 3;
+	ir_node *const slow
+		= fp_or(b, fp_sign(b, fp_eor(b, x, y)),
+		  fp_or(b, fp_sign(b, fp_sub(b, exp_lo, one)),
+		           fp_sign(b, fp_sub(b, fp_const(b, b->mode, max_exp), exp_hi))));
+	*is_fast = new_rd_Cmp(b->dbgi, b->block, slow, zero, ir_relation_equal);
+
+	/* align the mantissas, the bits shifted out are sticky */
+	ir_node *const hidden  = fp_tv(b, tarval_shl_unsigned(get_mode_one(b->mode),
+	                                                      man));
+	ir_node *const man_msk = fp_mask(b, man);
+	ir_node *const man_hi  = fp_shl_c(b, fp_or(b, fp_and(b, hi, man_msk), hidden),
+	                                  guard);
+	ir_node *const man_lo0 = fp_shl_c(b, fp_or(b, fp_and(b, lo, man_msk), hidden),
+	                                  guard);
+	/* larger shifts leave only the sticky bit */
+	ir_node *const max_sh  = fp_const(b, b->mode, w - 1);
+	ir_node *const too_far = fp_sign_mask(b, fp_sub(b, max_sh, diff));
+	ir_node *const shift   = fp_eor(b, diff,
+	                                fp_and(b, fp_eor(b, diff, max_sh), too_far));
+	ir_node *const count   = fp_conv(b, shift, mode_Iu);
+	ir_node *const man_lo  = fp_shr(b, man_lo0, count);
+	ir_node *const lost    = fp_and(b, man_lo0,
+	                                fp_sub(b, fp_shl(b, one, count), one));
+	ir_node *const sum0    = fp_add(b, man_hi,
+	                                fp_or(b, man_lo, fp_nonzero(b, lost)));
+
+	/* normalize a carry, keeping the shifted out bit sticky */
+	ir_node *const carry = fp_shr_c(b, sum0, man + guard + 1);
+	ir_node *const sum   = fp_or(b, fp_shr(b, sum0, fp_conv(b, carry, mode_Iu)),
+	                             fp_and(b, sum0, carry));
+
+	/* round to nearest even, a carry of the rounding increments the
+	 * exponent, which may overflow to infinity */
+	ir_node *const low      = fp_and(b, sum, fp_mask(b, guard));
+	ir_node *const mantissa = fp_shr_c(b, sum, guard);
+	ir_node *const half     = fp_const(b, b->mode, 1L << (guard - 1));
+	ir_node *const round    = fp_sign(b, fp_sub(b, half,
+	                                  fp_add(b, low, fp_and(b, mantissa, one))));
+	ir_node *const exp      = fp_sub(b, fp_add(b, exp_hi, carry), one);
+	ir_node *const res      = fp_add(b, fp_add(b, fp_shl_c(b, exp, man), mantissa),
+	                                 round);
+	return fp_or(b, res, sign);
+}
+
+/**
+ * Converts the 32 bit integer @p op to the bits of a floating point value.
+ * The result is exact if the magnitude has at most mantissa+1 bits.
+ * @p is_fast is set to a Cmp, which is true in this case.
+ */
+static ir_node *fp_from_int(fp_builder_t const *const b, ir_node *const op,
+                            ir_node **const is_fast)
+{
+	ir_mode *const op_mode = get_irn_mode(op);
+	ir_node *const zero    = fp_const(b, mode_Iu, 0);
+	ir_node *const bits    = fp_conv(b, op, mode_Iu);
+	ir_node *abs;
+	ir_node *sign;
+	if (mode_is_signed(op_mode)) {
+		ir_node *const s = fp_sign_mask(b, op);
+		abs  = fp_conv(b, fp_sub(b, fp_eor(b, op, s), s), mode_Iu);
+		sign = fp_sign(b, bits);
+	} else {
+		abs  = bits;
+		sign = zero;
+	}
+
+	ir_tarval *const limit = tarval_shl_unsigned(get_mode_one(mode_Iu),
+	                                             MIN(b->mantissa + 1, 31));
+	*is_fast = b->mantissa + 1 >= 32 ? NULL
+	         : new_rd_Cmp(b->dbgi, b->block, abs, fp_tv(b, limit),
+	                      ir_relation_less);
+
+	/* the position of the leading one gives the exponent */
+	ir_node *const nomem = get_irg_no_mem(get_irn_irg(b->block));
+	ir_node *const in[]  = { fp_or(b, abs, fp_const(b, mode_Iu, 1)) };
+	ir_node *const clz   = new_rd_Builtin(b->dbgi, b->block, nomem,
+	                                      ARRAY_SIZE(in), in, ir_bk_clz,
+	                                      clz_tp);
+	ir_node *const lz    = fp_conv(b, new_r_Proj(clz, mode_Is,
+	                                             pn_Builtin_max + 1), mode_Iu);
+
+	/* shift the leading one to the hidden bit, it increments the exponent */
+	long     const bias     = (1L << (b->exponent - 1)) - 1;
+	ir_node *const shift    = b->mantissa >= 31
+		? fp_add(b, lz, fp_const(b, mode_Iu, b->mantissa - 31))
+		: fp_sub(b, lz, fp_const(b, mode_Iu, 31 - b->mantissa));
+	ir_node *const mantissa = fp_shl(b, fp_conv(b, abs, b->mode), shift);
+	ir_node *const exp      = fp_sub(b, fp_const(b, b->mode, 31 + bias - 1),
+	                                 fp_conv(b, lz, b->mode));
+	ir_node *const res      = fp_or(b, fp_add(b, fp_shl_c(b, exp, b->mantissa),
+	                                          mantissa),
+	                                fp_shl_c(b, fp_conv(b, sign, b->mode),
+	                                         b->bits - 1));
+	/* zero has no leading one */
+	ir_node *const nonzero  = fp_conv(b, fp_nonzero(b, abs), b->mode);
+	return fp_and(b, res, fp_sub(b, fp_const(b, b->mode, 0), nonzero));
+}
+
+/**
+ * Returns the operand of the integer to float Conv @p n in a mode of at
+ * least 32 bits and sets @p name to the softfloat function.
+ */
+static ir_node *get_int_conv_operand(ir_node *const n, char const **const name)
+{
+	ir_node *op      = get_Conv_op(n);
+	ir_mode *op_mode = get_irn_mode(op);
+	ir_mode *min_mode;
+	if (mode_is_signed(op_mode)) {
+		*name    = "float";
+		min_mode = mode_Is;
+	} else {
+		*name    = "floatun";
+		min_mode = mode_Iu;
+	}
+	if (get_mode_size_bits(op_mode) < get_mode_size_bits(min_mode))
+		op = new_rd_Conv(get_irn_dbg_info(n), get_nodes_block(n), op, min_mode);
+	return op;
+}
+
+/**
+ * Returns true if the integer to float Conv @p n gets a fast path.
+ */
+static bool is_fast_int_conv(ir_node *const n)
+{
+	ir_mode *const op_mode = get_irn_mode(get_Conv_op(n));
+	return inline_fast_paths && get_mode_size_bits(op_mode) <= 32;
+}
+
+/**
+ * Replaces @p n by an inline fast path and a softfloat call, which is only
+ * executed if the fast path does not apply.
+ */
+static void lower_fast_path(ir_node *const n)
+{
+	/* Split the block in two halfs, with n and its operands in the upper
+	 * block, where the fast path is computed. */
+	ir_node  *const lower_block = get_nodes_block(n);
+	part_block(n);
+	ir_node  *const upper_block = get_nodes_block(n);
+	ir_graph *const irg         = get_irn_irg(n);
+	ir_mode  *const mode        = get_irn_mode(n);
+	fp_builder_t const b = make_fp_builder(n, upper_block, mode);
+
+	char const *name;
+	ir_node    *in[2];
+	size_t      arity;
+	ir_node    *fast;
+	ir_node    *is_fast;
+	switch (get_irn_opcode(n)) {
+	case iro_Add:
+	case iro_Sub: {
+		in[0] = get_binop_left(n);
+		in[1] = get_binop_right(n);
+		arity = 2;
+		ir_node *right = fp_bits(&b, in[1]);
+		if (is_Sub(n)) {
+			/* x - y = x + -y */
+			name  = "sub";
+			right = fp_eor(&b, right, fp_sign_bit(&b));
+		} else {
+			name = "add";
+		}
+		fast = fp_add_same_sign(&b, fp_bits(&b, in[0]), right, &is_fast);
+		break;
+	}
+	case iro_Conv:
+		in[0] = get_int_conv_operand(n, &name);
+		arity = 1;
+		fast  = fp_from_int(&b, in[0], &is_fast);
+		break;
+	default:
+		panic("unexpected fast path node %+F", n);
+	}
+	fast = new_rd_Bitcast(b.dbgi, upper_block, fast, mode);
+
+	ir_node *const cond       = new_rd_Cond(b.dbgi, upper_block, is_fast);
+	ir_node *const true_proj  = new_r_Proj(cond, mode_X, pn_Cond_true);
+	ir_node *const false_proj = new_r_Proj(cond, mode_X, pn_Cond_false);
+	ir_node *const fast_block = new_r_Block(irg, 1, &true_proj);
+	ir_node *const slow_block = new_r_Block(irg, 1, &false_proj);
+	ir_node *const jmps[]     = {
+		new_r_Jmp(fast_block), new_r_Jmp(slow_block)
+	};
+	set_Cond_jmp_pred(cond, COND_JMP_PRED_TRUE);
+
+	/* Kill the jump from upper to lower block and replace the in array. */
+	assert(get_Block_n_cfgpreds(lower_block) == 1);
+	kill_node(get_Block_cfgpred(lower_block, 0));
+	set_irn_in(lower_block, ARRAY_SIZE(jmps), jmps);
+
+	ir_node *const slow  = make_softfloat_call_in(slow_block, n, name, arity,
+	                                              in);
+	ir_node *const ins[] = { fast, slow };
+	ir_node *const phi   = new_r_Phi(lower_block, ARRAY_SIZE(ins), ins, mode);
+	collect_new_phi_node(phi);
+
+	/* Add links for the next part_block() call, like lower_mux does. */
+	set_irn_link(true_proj,  get_irn_link(cond));
+	set_irn_link(false_proj, true_proj);
+	set_irn_link(cond,       false_proj);
+
+	exchange(n, phi);
+}
+
 /**
  * Transforms an Add into the appropriate soft float function.
  */
@@ -300,6 +770,11 @@ static bool lower_Add(ir_node *const n)
 	if (!mode_is_float(mode))
 		return false;
 
+	if (inline_fast_paths) {
+		ARR_APP1(ir_node*, fast_path_nodes, n);
+		return true;
+	}
+
 	ir_node *const left   = get_Add_left(n);
 	ir_node *const right  = get_Add_right(n);
 	ir_node *const in[]   = { left, right };
@@ -421,6 +896,60 @@ static bool lower_Builtin(ir_node *node)
 	return true;
 }
 
+/**
+ * Transforms a Cmp into integer operations on the bits of the operands.
+ */
+static void lower_Cmp_inline(ir_node *const n)
+{
+	ir_node     *const left     = get_Cmp_left(n);
+	ir_node     *const right    = get_Cmp_right(n);
+	ir_relation  const relation = get_Cmp_relation(n);
+	fp_builder_t const b        = make_fp_builder(n, get_nodes_block(n),
+	                                              get_irn_mode(left));
+
+	ir_node *nan_l;
+	ir_node *nan_r;
+	ir_node *key_l = fp_order_key(&b, fp_bits(&b, left),  &nan_l);
+	ir_node *key_r = fp_order_key(&b, fp_bits(&b, right), &nan_r);
+	ir_node *const unord = fp_or(&b, nan_l, nan_r);
+	ir_node *const zero  = fp_const(&b, b.mode, 0);
+
+	bool        const unordered = relation & ir_relation_unordered;
+	ir_relation const ordered   = relation & ~ir_relation_unordered;
+	ir_node          *res;
+	if (ordered == ir_relation_false) {
+		res = new_rd_Cmp(b.dbgi, b.block, unord, zero,
+		                 unordered ? ir_relation_less_greater
+		                           : ir_relation_false);
+	} else if (ordered == ir_relation_less_equal_greater) {
+		res = new_rd_Cmp(b.dbgi, b.block, unord, zero,
+		                 unordered ? ir_relation_true : ir_relation_equal);
+	} else {
+		/* Replace the keys of unordered operands by constants, whose
+		 * comparison yields the result for unordered operands. */
+		long key_l_c;
+		long key_r_c;
+		if (((ordered & ir_relation_less) != 0) == unordered) {
+			key_l_c = 0;
+			key_r_c = 1;
+		} else if (((ordered & ir_relation_equal) != 0) == unordered) {
+			key_l_c = 0;
+			key_r_c = 0;
+		} else {
+			key_l_c = 1;
+			key_r_c = 0;
+		}
+		ir_node *const mask = fp_sub(&b, fp_const(&b, b.smode, 0),
+		                             fp_conv(&b, unord, b.smode));
+		ir_node *const c_l  = fp_const(&b, b.smode, key_l_c);
+		ir_node *const c_r  = fp_const(&b, b.smode, key_r_c);
+		key_l = fp_eor(&b, key_l, fp_and(&b, fp_eor(&b, key_l, c_l), mask));
+		key_r = fp_eor(&b, key_r, fp_and(&b, fp_eor(&b, key_r, c_r), mask));
+		res   = new_rd_Cmp(b.dbgi, b.block, key_l, key_r, ordered);
+	}
+	exchange(n, res);
+}
+
 /**
  * Transforms a Cmp into the appropriate soft float function.
  */
@@ -431,6 +960,11 @@ static bool lower_Cmp(ir_node *const n)
 	if (!mode_is_float(op_mode))
 		return false;
 
+	if (inline_fast_paths) {
+		lower_Cmp_inline(n);
+		return true;
+	}
+
 	dbg_info *const dbgi = get_irn_dbg_info(n);
 	ir_graph *const irg  = get_irn_irg(n);
 	ir_node  *const zero = new_rd_Const_null(dbgi, irg, mode_Is);
@@ -568,18 +1102,22 @@ static bool lower_Conv(ir_node *const n)
 		else
 			name = "fixuns";
 	} else if (!mode_is_float(op_mode)) {
-		ir_mode *min_mode;
-		if (mode_is_signed(op_mode)) {
-			name     = "float";
-			min_mode = mode_Is;
-		} else {
-			name     = "floatun";
-			min_mode = mode_Iu;
-		}
-		if (get_mode_size_bits(op_mode) < get_mode_size_bits(min_mode)) {
-			op_mode = min_mode;
-			op      = new_rd_Conv(dbgi, block, op, op_mode);
+		if (is_fast_int_conv(n)) {
+			/* Conversions from 32 bit integers are exact if the mantissa is
+			 * wide enough, otherwise only small integers are inline. */
+			if (get_mode_mantissa_size(mode) + 1 < 32) {
+				ARR_APP1(ir_node*, fast_path_nodes, n);
+				return true;
+			}
+			fp_builder_t const b = make_fp_builder(n, block, mode);
+			ir_node *is_fast;
+			ir_node *const bits
+				= fp_from_int(&b, get_int_conv_operand(n, &name), &is_fast);
+			assert(is_fast == NULL);
+			exchange(n, new_rd_Bitcast(dbgi, block, bits, mode));
+			return true;
 		}
+		op = get_int_conv_operand(n, &name);
 	} else {
 		/* Remove unnecessary Convs. */
 		if (op_mode == mode) {
@@ -710,7 +1248,15 @@ static bool lower_Minus(ir_node *n)
 	if (!mode_is_float(mode))
 		return false;
 
-	ir_node *const op     = get_Minus_op(n);
+	ir_node *const op = get_Minus_op(n);
+	if (inline_fast_paths) {
+		/* Flip the sign bit. */
+		fp_builder_t const b = make_fp_builder(n, get_nodes_block(n), mode);
+		ir_node *const bits = fp_eor(&b, fp_bits(&b, op), fp_sign_bit(&b));
+		exchange(n, new_rd_Bitcast(b.dbgi, b.block, bits, mode));
+		return true;
+	}
+
 	ir_node *const in[]   = { op };
 	ir_node *const result = make_softfloat_call(n, "neg", ARRAY_SIZE(in), in);
 	exchange(n, result);
@@ -743,6 +1289,11 @@ static bool lower_Sub(ir_node *n)
 	if (!mode_is_float(mode))
 		return false;
 
+	if (inline_fast_paths) {
+		ARR_APP1(ir_node*, fast_path_nodes, n);
+		return true;
+	}
+
 	ir_node *const left   = get_Sub_left(n);
 	ir_node *const right  = get_Sub_right(n);
 	ir_node *const in[]   = { left, right };
@@ -821,6 +1372,8 @@ static void ir_prepare_softfloat_lowering(void)
 	make_unop_type(&unop_tp_ls_f, type_Ls, type_F);
 	make_unop_type(&unop_tp_lu_d, type_Lu, type_D);
 	make_unop_type(&unop_tp_lu_f, type_Lu, type_F);
+
+	make_unop_type(&clz_tp, type_Iu, type_Is);
 }
 
 /**
@@ -831,9 +1384,10 @@ static int lower_mux_cb(ir_node *mux)
 	return ir_nodeset_contains(&created_mux_nodes, mux);
 }
 
-void lower_floating_point(void)
+void lower_floating_point(bool const fast_paths)
 {
 	ir_prepare_softfloat_lowering();
+	inline_fast_paths = fast_paths;
 
 	ir_clear_opcodes_generic_func();
 	ir_register_softloat_lower_function(op_Add,   lower_Add);
@@ -850,8 +1404,23 @@ void lower_floating_point(void)
 
 		assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
 
+		fast_path_nodes = NEW_ARR_F(ir_node*, 0);
 		irg_walk_graph(irg, NULL, lower_node, &changed_irgs[i]);
 
+		if (ARR_LEN(fast_path_nodes) > 0) {
+			ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK
+			                          | IR_RESOURCE_PHI_LIST);
+			collect_phiprojs_and_start_block_nodes(irg);
+			for (size_t j = 0, n = ARR_LEN(fast_path_nodes); j < n; ++j) {
+				lower_fast_path(fast_path_nodes[j]);
+			}
+			ir_free_resources(irg, IR_RESOURCE_IRN_LINK
+			                       | IR_RESOURCE_PHI_LIST);
+			clear_irg_properties(irg, IR_GRAPH_PROPERTY_NO_CRITICAL_EDGES
+			                          | IR_GRAPH_PROPERTY_ONE_RETURN);
+		}
+		DEL_ARR_F(fast_path_nodes);
+
 		if (ir_nodeset_size(&created_mux_nodes) > 0)
 			lower_mux(irg, lower_mux_cb);
 
@@ -890,5 +1459,5 @@ void lower_floating_point(void)
 		confirm_irg_properties(irg, changed_irgs[i] ? IR_GRAPH_PROPERTIES_NONE
 		                                            : IR_GRAPH_PROPERTIES_ALL);
 	}
-	free(changed_irgs);
+	xfree(changed_irgs);
 }
@@ -11,11 +11,20 @@
 #ifndef FIRM_LOWER_LOWER_SOFTFLOAT_H
 #define FIRM_LOWER_LOWER_SOFTFLOAT_H
 
+#include <stdbool.h>
+
 /**
  * Lowers all floating-point operations.
  *
- * They are replaced by calls into a soft float library.
+ * They are replaced by calls into a soft float library.  The calls are pure,
+ * so equal calls are merged.
+ *
+ * @param fast_paths  If set, negations and comparisons are computed inline
+ *                    with integer operations.  Additions of normal values of
+ *                    the same sign and conversions from small integers get an
+ *                    inline fast path and only call into the library for the
+ *                    other cases.
  */
-void lower_floating_point(void);
+void lower_floating_point(bool fast_paths);
 
 #endif
@@ -8,6 +8,8 @@
  * @brief   Lowering of Switches if necessary or advantageous.
  * @author  Moritz Kroll
  */
+#include <limits.h>
+#include <math.h>
 #include <stdbool.h>
 
 #include "array.h"
@@ -17,10 +19,17 @@
 #include "irnodeset.h"
 #include "irnode_t.h"
 #include "irouts_t.h"
+#include "irprofile.h"
 #include "lowering.h"
 #include "panic.h"
 #include "util.h"
 
+/** Minimum percentage of the values in the range of a jump table which must
+ * belong to a case. */
+#define MIN_TABLE_DENSITY    40
+/** Maximum number of different targets of a bit test. */
+#define MAX_BIT_TEST_TARGETS 3
+
 typedef struct walk_env_t {
 	ir_nodeset_t  processed;
 	ir_mode      *selector_mode;
@@ -30,21 +39,37 @@ typedef struct walk_env_t {
 } walk_env_t;
 
 typedef struct target_t {
-	ir_node *block;     /**< block that is targetted */
-	uint16_t n_entries; /**< number of table entries targetting this block */
-	uint16_t i;
+	ir_node  *block;     /**< block that is targetted */
+	unsigned  n_entries; /**< number of table entries targetting this block */
+	double    weight;    /**< expected execution count of one entry */
+	ir_node **preds;     /**< the new control flow predecessors */
 } target_t;
 
 typedef struct switch_info_t {
-	ir_node     *switchn;
-	ir_tarval   *switch_min;
-	ir_tarval   *switch_max;
-	ir_node     *default_block;
-	unsigned     num_cases;
-	target_t    *targets;
-	ir_node    **defusers;    /**< the Projs pointing to the default case */
+	ir_node      *switchn;
+	ir_tarval    *switch_min;
+	ir_tarval    *switch_max;
+	ir_node      *default_block;
+	unsigned      num_cases;
+	target_t     *targets;
+	ir_node     **defusers;   /**< the Projs pointing to the default case */
+	ir_mode      *table_mode; /**< selector mode of jump tables */
+	ir_nodeset_t *processed;  /**< Switches which need no lowering */
 } switch_info_t;
 
+typedef enum cluster_kind_t {
+	CLUSTER_CASE,     /**< a single case compared directly */
+	CLUSTER_TABLE,    /**< a jump table over a dense range of cases */
+	CLUSTER_BIT_TEST, /**< cases with few targets tested with bit masks */
+} cluster_kind_t;
+
+typedef struct cluster_t {
+	cluster_kind_t               kind;
+	const ir_switch_table_entry *entries;   /**< the (sorted) cases */
+	size_t                       n_entries;
+	double                       weight;    /**< expected execution count */
+} cluster_t;
+
 /**
  * analyze enough to decide if we should lower the switch
  */
@@ -106,6 +131,23 @@ static void analyse_switch1(switch_info_t *info)
 		++target->n_entries;
 	}
 
+	/* weight the cases by the execution counts of their targets if the
+	 * switch appears in the profile, uniformly otherwise */
+	uint32_t count;
+	bool     use_profile
+		= ir_profile_find_block_execcount(get_nodes_block(switchn), &count)
+		&& count > 0;
+	for (unsigned pn = 0; pn < n_outs; ++pn) {
+		target_t *target = &targets[pn];
+		target->weight = 1.0;
+		if (use_profile && target->block != NULL && target->n_entries > 0) {
+			if (!ir_profile_find_block_execcount(target->block, &count))
+				count = 0;
+			target->weight = (double)count / target->n_entries;
+		}
+		target->preds = NEW_ARR_F(ir_node*, 0);
+	}
+
 	info->default_block = targets[pn_Switch_default].block;
 	info->targets       = targets;
 }
@@ -128,6 +170,24 @@ static int compare_entries(const void *a, const void *b)
 	return 1;
 }
 
+/**
+ * Subtracts @p delta (in the mode of the normalized selector) from a case
+ * value and converts it to @p mode.  Unsigned modes zero extend the value like
+ * the normalized selector.
+ */
+static ir_tarval *normalize_case_value(ir_tarval *value, ir_mode *mode,
+                                       ir_tarval *delta)
+{
+	if (delta != NULL) {
+		value = tarval_convert_to(value, get_tarval_mode(delta));
+		value = tarval_sub(value, delta);
+	} else if (!mode_is_signed(mode)) {
+		ir_mode *umode = find_unsigned_mode(get_tarval_mode(value));
+		value = tarval_convert_to(value, umode);
+	}
+	return tarval_convert_to(value, mode);
+}
+
 static void normalize_table(ir_node *switchn, ir_mode *new_mode,
                             ir_tarval *delta)
 {
@@ -145,21 +205,13 @@ static void normalize_table(ir_node *switchn, ir_mode *new_mode,
 			break;
 		}
 
-		ir_tarval *min = entry->min;
-		min = tarval_convert_to(min, new_mode);
-		if (delta != NULL)
-			min = tarval_sub(min, delta);
-
+		ir_tarval *min = normalize_case_value(entry->min, new_mode, delta);
 		if (entry->min == entry->max) {
 			entry->min = min;
 			entry->max = min;
 		} else {
-			ir_tarval *max = entry->max;
-			max = tarval_convert_to(max, new_mode);
-			if (delta != NULL)
-				max = tarval_sub(max, delta);
 			entry->min = min;
-			entry->max = max;
+			entry->max = normalize_case_value(entry->max, new_mode, delta);
 		}
 	}
 }
@@ -261,8 +313,6 @@ static bool normalize_switch(switch_info_t *info, ir_mode *selector_mode)
 		mode     = selector_mode;
 		info->switch_min = tarval_convert_to(info->switch_min, mode);
 		info->switch_max = tarval_convert_to(info->switch_max, mode);
-		if (delta != NULL)
-			delta = tarval_convert_to(delta, mode);
 		set_Switch_selector(switchn, selector);
 	}
 
@@ -278,16 +328,23 @@ static ir_node *create_case_cond(const ir_switch_table_entry *entry,
                                  dbg_info *dbgi, ir_node *block,
                                  ir_node *selector)
 {
-	ir_graph *irg      = get_irn_irg(block);
-	ir_node  *minconst = new_r_Const(irg, entry->min);
-
+	ir_graph *irg = get_irn_irg(block);
 	ir_node  *cmp;
 	if (entry->min == entry->max) {
+		ir_node *minconst = new_r_Const(irg, entry->min);
 		cmp = new_rd_Cmp(dbgi, block, selector, minconst, ir_relation_equal);
 	} else {
-		ir_tarval *adjusted_max = tarval_sub(entry->max, entry->min);
-		ir_node   *sub          = new_rd_Sub(dbgi, block, selector, minconst,
-		                                     get_tarval_mode(adjusted_max));
+		/* compare unsigned, so values below min are out of range, too */
+		ir_mode   *umode        = find_unsigned_mode(get_irn_mode(selector));
+		ir_tarval *min          = tarval_convert_to(entry->min, umode);
+		ir_tarval *adjusted_max
+			= tarval_sub(tarval_convert_to(entry->max, umode), min);
+		ir_node   *value        = selector;
+		if (get_irn_mode(value) != umode)
+			value = new_rd_Conv(dbgi, block, value, umode);
+		ir_node   *minconst     = new_r_Const(irg, min);
+		ir_node   *sub          = new_rd_Sub(dbgi, block, value, minconst,
+		                                     umode);
 		ir_node   *maxconst     = new_r_Const(irg, adjusted_max);
 		cmp = new_rd_Cmp(dbgi, block, sub, maxconst, ir_relation_less_equal);
 	}
@@ -296,70 +353,321 @@ static ir_node *create_case_cond(const ir_switch_table_entry *entry,
 
 static void connect_to_target(target_t *target, ir_node *cf)
 {
-	ir_node *block     = target->block;
-	unsigned n_entries = target->n_entries;
-	if (get_Block_n_cfgpreds(block) != (int)n_entries) {
-		ir_node **new_in = ALLOCAN(ir_node*, n_entries);
-		ir_graph *irg    = get_irn_irg(block);
-		ir_node  *dummy  = new_r_Dummy(irg, mode_X);
-		for (unsigned i = 0; i < n_entries; ++i) {
-			new_in[i] = dummy;
+	ARR_APP1(ir_node*, target->preds, cf);
+}
+
+/**
+ * Computes max - min of two case values.
+ *
+ * @return false if the distance does not fit into an unsigned long
+ */
+static bool get_distance(ir_tarval *min, ir_tarval *max,
+                         unsigned long *distance)
+{
+	ir_mode   *umode = find_unsigned_mode(get_tarval_mode(min));
+	ir_tarval *diff  = tarval_sub(tarval_convert_to(max, umode),
+	                              tarval_convert_to(min, umode));
+	if (!tarval_is_long(diff))
+		return false;
+	*distance = (unsigned long)get_tarval_long(diff);
+	return true;
+}
+
+static double get_entry_n_values(const ir_switch_table_entry *entry)
+{
+	unsigned long distance;
+	if (!get_distance(entry->min, entry->max, &distance))
+		return (double)ULONG_MAX;
+	return (double)distance + 1;
+}
+
+/**
+ * Creates the check whether the selector lies in the range of the cluster
+ * starting at @p first and ending at @p last.  The false Proj jumps to the
+ * default case.
+ *
+ * @return the block reached if the selector is in range, *index is set to
+ *         the selector relative to the start of the range
+ */
+static ir_node *create_range_check(switch_info_t *info, ir_node *block,
+                                   const ir_switch_table_entry *first,
+                                   const ir_switch_table_entry *last,
+                                   ir_node **index)
+{
+	ir_graph  *irg      = get_irn_irg(block);
+	ir_node   *switchn  = info->switchn;
+	dbg_info  *dbgi     = get_irn_dbg_info(switchn);
+	ir_node   *selector = get_Switch_selector(switchn);
+	ir_mode   *umode    = find_unsigned_mode(get_irn_mode(selector));
+	ir_tarval *min      = tarval_convert_to(first->min, umode);
+	ir_tarval *range    = tarval_sub(tarval_convert_to(last->max, umode), min);
+
+	ir_node *value = selector;
+	if (get_irn_mode(value) != umode)
+		value = new_rd_Conv(dbgi, block, value, umode);
+	if (!tarval_is_null(min)) {
+		ir_node *min_const = new_r_Const(irg, min);
+		value = new_rd_Sub(dbgi, block, value, min_const, umode);
+	}
+	ir_node *max_const  = new_r_Const(irg, range);
+	ir_node *cmp        = new_rd_Cmp(dbgi, block, value, max_const,
+	                                 ir_relation_less_equal);
+	ir_node *cond       = new_rd_Cond(dbgi, block, cmp);
+	ir_node *proj_true  = new_r_Proj(cond, mode_X, pn_Cond_true);
+	ir_node *proj_false = new_r_Proj(cond, mode_X, pn_Cond_false);
+	ARR_APP1(ir_node*, info->defusers, proj_false);
+
+	ir_node *in[]      = { proj_true };
+	ir_node *new_block = new_r_Block(irg, ARRAY_SIZE(in), in);
+	*index = new_rd_Conv(dbgi, new_block, value, info->table_mode);
+	return new_block;
+}
+
+/**
+ * Creates a Switch with a jump table for the cases of @p cluster.
+ */
+static void create_table_cluster(switch_info_t *info, ir_node *block,
+                                 const cluster_t *cluster)
+{
+	ir_graph                    *irg   = get_irn_irg(block);
+	ir_node                     *switchn = info->switchn;
+	dbg_info                    *dbgi  = get_irn_dbg_info(switchn);
+	const ir_switch_table_entry *first = &cluster->entries[0];
+	const ir_switch_table_entry *last  = &cluster->entries[cluster->n_entries-1];
+
+	ir_node *index;
+	ir_node *table_block = create_range_check(info, block, first, last, &index);
+
+	/* number the targets of the cluster */
+	unsigned  n_outs  = get_Switch_n_outs(switchn);
+	unsigned *new_pns = XMALLOCNZ(unsigned, n_outs);
+	unsigned *old_pns = XMALLOCN(unsigned, cluster->n_entries + 1);
+	unsigned  n_pns   = 1;
+	old_pns[pn_Switch_default] = pn_Switch_default;
+
+	ir_mode         *mode  = info->table_mode;
+	ir_mode         *umode = find_unsigned_mode(get_tarval_mode(first->min));
+	ir_tarval       *min   = tarval_convert_to(first->min, umode);
+	ir_switch_table *table = ir_new_switch_table(irg, cluster->n_entries);
+	for (size_t e = 0; e < cluster->n_entries; ++e) {
+		const ir_switch_table_entry *entry = &cluster->entries[e];
+		if (new_pns[entry->pn] == 0) {
+			old_pns[n_pns]      = entry->pn;
+			new_pns[entry->pn] = n_pns++;
 		}
-		set_irn_in(block, n_entries, new_in);
-		assert(target->i == 0);
+		ir_tarval *entry_min
+			= tarval_sub(tarval_convert_to(entry->min, umode), min);
+		ir_tarval *entry_max
+			= tarval_sub(tarval_convert_to(entry->max, umode), min);
+		ir_switch_table_set(table, e, tarval_convert_to(entry_min, mode),
+		                    tarval_convert_to(entry_max, mode),
+		                    new_pns[entry->pn]);
 	}
-	assert(target->i < n_entries);
-	set_Block_cfgpred(target->block, target->i++, cf);
+
+	ir_node *new_switch = new_rd_Switch(dbgi, table_block, index, n_pns, table);
+	ir_nodeset_insert(info->processed, new_switch);
+	for (unsigned pn = 0; pn < n_pns; ++pn) {
+		/* create intermediate blocks so we don't have critical edges */
+		ir_node *proj        = new_r_Proj(new_switch, mode_X, pn);
+		ir_node *in[]        = { proj };
+		ir_node *split_block = new_r_Block(irg, ARRAY_SIZE(in), in);
+		ir_node *jmp         = new_r_Jmp(split_block);
+		if (pn == pn_Switch_default)
+			ARR_APP1(ir_node*, info->defusers, jmp);
+		else
+			connect_to_target(&info->targets[old_pns[pn]], jmp);
+	}
+
+	xfree(old_pns);
+	xfree(new_pns);
+}
+
+typedef struct bit_test_t {
+	unsigned   pn;     /**< the target */
+	ir_tarval *mask;   /**< the bits of the values jumping to the target */
+	double     weight; /**< expected execution count */
+} bit_test_t;
+
+static int compare_bit_tests(const void *a, const void *b)
+{
+	const bit_test_t *test0 = (const bit_test_t*)a;
+	const bit_test_t *test1 = (const bit_test_t*)b;
+	if (test0->weight != test1->weight)
+		return test0->weight < test1->weight ? 1 : -1;
+	return (test0->pn > test1->pn) - (test0->pn < test1->pn);
 }
 
 /**
- * Creates an if cascade realizing binary search.
+ * Creates "if ((1 << index) & mask) goto target;" tests for the cases of
+ * @p cluster, testing the most frequent target first.
  */
-static void create_if_cascade(switch_info_t *info, ir_node *block,
-                              ir_switch_table_entry *curcases,
-                              unsigned numcases)
+static void create_bit_test_cluster(switch_info_t *info, ir_node *block,
+                                    const cluster_t *cluster)
 {
-	ir_graph      *irg      = get_irn_irg(block);
-	const ir_node *switchn  = info->switchn;
-	dbg_info      *dbgi     = get_irn_dbg_info(switchn);
-	ir_node       *selector = get_Switch_selector(switchn);
+	ir_graph                    *irg   = get_irn_irg(block);
+	dbg_info                    *dbgi  = get_irn_dbg_info(info->switchn);
+	const ir_switch_table_entry *first = &cluster->entries[0];
+	const ir_switch_table_entry *last  = &cluster->entries[cluster->n_entries-1];
+
+	ir_node *index;
+	block = create_range_check(info, block, first, last, &index);
+
+	ir_mode    *mode    = info->table_mode;
+	ir_tarval  *one     = get_mode_one(mode);
+	ir_tarval  *covered = get_mode_null(mode);
+	bit_test_t  tests[MAX_BIT_TEST_TARGETS];
+	unsigned    n_tests = 0;
+	for (size_t e = 0; e < cluster->n_entries; ++e) {
+		const ir_switch_table_entry *entry = &cluster->entries[e];
+		unsigned t = 0;
+		while (t < n_tests && tests[t].pn != entry->pn)
+			++t;
+		if (t == n_tests) {
+			assert(n_tests < MAX_BIT_TEST_TARGETS);
+			tests[t].pn     = entry->pn;
+			tests[t].mask   = get_mode_null(mode);
+			tests[t].weight = 0.0;
+			++n_tests;
+		}
 
-	if (numcases == 0) {
-		/* zero cases: "goto default;" */
-		ARR_APP1(ir_node*, info->defusers, new_r_Jmp(block));
-	} else if (numcases == 1) {
-		/*only one case: "if (sel == val) goto target else goto default;"*/
-		const ir_switch_table_entry *entry = &curcases[0];
-		ir_node *cond      = create_case_cond(entry, dbgi, block, selector);
-		ir_node *trueproj  = new_r_Proj(cond, mode_X, pn_Cond_true);
-		ir_node *falseproj = new_r_Proj(cond, mode_X, pn_Cond_false);
+		unsigned long low;
+		unsigned long high;
+		bool ok = get_distance(first->min, entry->min, &low)
+		       && get_distance(first->min, entry->max, &high);
+		assert(ok && high < get_mode_size_bits(mode));
+		(void)ok;
+		for (unsigned long bit = low; bit <= high; ++bit) {
+			tests[t].mask = tarval_or(tests[t].mask,
+			                          tarval_shl_unsigned(one, bit));
+		}
+		tests[t].weight += info->targets[entry->pn].weight;
+		covered = tarval_or(covered, tests[t].mask);
+	}
+	QSORT(tests, n_tests, compare_bit_tests);
+
+	/* the last test is not necessary if every value of the range jumps to
+	 * one of the targets */
+	unsigned long range;
+	bool ok = get_distance(first->min, last->max, &range);
+	assert(ok);
+	(void)ok;
+	ir_tarval *all = range + 1 == get_mode_size_bits(mode)
+		? get_mode_all_one(mode)
+		: tarval_sub(tarval_shl_unsigned(one, range + 1), one);
+	bool complete = covered == all;
+
+	ir_node *bit = new_rd_Shl(dbgi, block, new_r_Const(irg, one), index, mode);
+	for (unsigned t = 0; t < n_tests; ++t) {
+		target_t *target = &info->targets[tests[t].pn];
+		if (complete && t == n_tests - 1) {
+			connect_to_target(target, new_r_Jmp(block));
+			break;
+		}
+
+		ir_node *mask_const = new_r_Const(irg, tests[t].mask);
+		ir_node *and        = new_rd_And(dbgi, block, bit, mask_const, mode);
+		ir_node *null       = new_r_Const(irg, get_mode_null(mode));
+		ir_node *cmp        = new_rd_Cmp(dbgi, block, and, null,
+		                                 ir_relation_less_greater);
+		ir_node *cond       = new_rd_Cond(dbgi, block, cmp);
+		ir_node *proj_true  = new_r_Proj(cond, mode_X, pn_Cond_true);
+		ir_node *proj_false = new_r_Proj(cond, mode_X, pn_Cond_false);
+		connect_to_target(target, proj_true);
+
+		if (t == n_tests - 1) {
+			ARR_APP1(ir_node*, info->defusers, proj_false);
+		} else {
+			ir_node *in[] = { proj_false };
+			block = new_r_Block(irg, ARRAY_SIZE(in), in);
+		}
+	}
+}
+
+static void create_cluster(switch_info_t *info, ir_node *block,
+                           const cluster_t *cluster)
+{
+	switch (cluster->kind) {
+	case CLUSTER_CASE: {
+		/* "if (sel == val) goto target else goto default;" */
+		const ir_switch_table_entry *entry = &cluster->entries[0];
+		dbg_info *dbgi      = get_irn_dbg_info(info->switchn);
+		ir_node  *selector  = get_Switch_selector(info->switchn);
+		ir_node  *cond      = create_case_cond(entry, dbgi, block, selector);
+		ir_node  *trueproj  = new_r_Proj(cond, mode_X, pn_Cond_true);
+		ir_node  *falseproj = new_r_Proj(cond, mode_X, pn_Cond_false);
 
 		connect_to_target(&info->targets[entry->pn], trueproj);
 		ARR_APP1(ir_node*, info->defusers, falseproj);
-	} else if (numcases == 2) {
-		/* only two cases: "if (sel == val[0]) goto target[0];" */
-		const ir_switch_table_entry *entry0 = &curcases[0];
-		const ir_switch_table_entry *entry1 = &curcases[1];
+		return;
+	}
+	case CLUSTER_TABLE:
+		create_table_cluster(info, block, cluster);
+		return;
+	case CLUSTER_BIT_TEST:
+		create_bit_test_cluster(info, block, cluster);
+		return;
+	}
+	panic("invalid cluster kind");
+}
+
+/**
+ * Creates a binary search tree over the clusters, balanced by their expected
+ * execution counts.
+ */
+static void create_cluster_tree(switch_info_t *info, ir_node *block,
+                                const cluster_t *clusters, size_t n_clusters)
+{
+	ir_graph *irg      = get_irn_irg(block);
+	ir_node  *switchn  = info->switchn;
+	dbg_info *dbgi     = get_irn_dbg_info(switchn);
+	ir_node  *selector = get_Switch_selector(switchn);
+
+	if (n_clusters == 0) {
+		/* zero cases: "goto default;" */
+		ARR_APP1(ir_node*, info->defusers, new_r_Jmp(block));
+	} else if (n_clusters == 1) {
+		create_cluster(info, block, &clusters[0]);
+	} else if (n_clusters == 2 && clusters[0].kind == CLUSTER_CASE
+	           && clusters[1].kind == CLUSTER_CASE) {
+		/* only two cases: "if (sel == val[0]) goto target[0];", testing the
+		 * more frequent case first */
+		const cluster_t *cluster0 = &clusters[0];
+		const cluster_t *cluster1 = &clusters[1];
+		if (cluster1->weight > cluster0->weight) {
+			cluster0 = &clusters[1];
+			cluster1 = &clusters[0];
+		}
+		const ir_switch_table_entry *entry0 = &cluster0->entries[0];
 		ir_node *cond      = create_case_cond(entry0, dbgi, block, selector);
 		ir_node *trueproj  = new_r_Proj(cond, mode_X, pn_Cond_true);
 		ir_node *falseproj = new_r_Proj(cond, mode_X, pn_Cond_false);
 		connect_to_target(&info->targets[entry0->pn], trueproj);
 
+		/* second part: "else if (sel == val[1]) goto target[1] else goto default;" */
 		ir_node *in[]    = { falseproj };
 		ir_node *neblock = new_r_Block(irg, ARRAY_SIZE(in), in);
-
-		/* second part: "else if (sel == val[1]) goto target[1] else goto default;" */
-		ir_node *cond1      = create_case_cond(entry1, dbgi, neblock, selector);
-		ir_node *trueproj1  = new_r_Proj(cond1, mode_X, pn_Cond_true);
-		ir_node *falseproj1 = new_r_Proj(cond1, mode_X, pn_Cond_false);
-		connect_to_target(&info->targets[entry1->pn], trueproj1);
-		ARR_APP1(ir_node*, info->defusers, falseproj1);
+		create_cluster(info, neblock, cluster1);
 	} else {
-		/* recursive case: split cases in the middle */
-		unsigned midcase = numcases / 2;
-		const ir_switch_table_entry *entry = &curcases[midcase];
-		ir_node *val = new_r_Const(irg, entry->min);
-		ir_node *cmp = new_rd_Cmp(dbgi, block, selector, val, ir_relation_less);
+		/* recursive case: split where the weights of both sides are equal */
+		double total = 0.0;
+		for (size_t c = 0; c < n_clusters; ++c)
+			total += clusters[c].weight;
+
+		size_t split     = 1;
+		double left      = clusters[0].weight;
+		double best_diff = fabs(2 * left - total);
+		for (size_t c = 2; c < n_clusters; ++c) {
+			left += clusters[c - 1].weight;
+			double diff = fabs(2 * left - total);
+			if (diff < best_diff) {
+				best_diff = diff;
+				split     = c;
+			}
+		}
+
+		const ir_switch_table_entry *entry = &clusters[split].entries[0];
+		ir_node *val  = new_r_Const(irg, entry->min);
+		ir_node *cmp  = new_rd_Cmp(dbgi, block, selector, val, ir_relation_less);
 		ir_node *cond = new_rd_Cond(dbgi, block, cmp);
 
 		ir_node *ltin[]  = { new_r_Proj(cond, mode_X, pn_Cond_true) };
@@ -368,11 +676,120 @@ static void create_if_cascade(switch_info_t *info, ir_node *block,
 		ir_node *gein[]  = { new_r_Proj(cond, mode_X, pn_Cond_false) };
 		ir_node *geblock = new_r_Block(irg, ARRAY_SIZE(gein), gein);
 
-		create_if_cascade(info, ltblock, curcases, midcase);
-		create_if_cascade(info, geblock, curcases + midcase, numcases - midcase);
+		create_cluster_tree(info, ltblock, clusters, split);
+		create_cluster_tree(info, geblock, clusters + split, n_clusters - split);
 	}
 }
 
+/**
+ * Checks whether a jump table for the cases first to last (inclusive) is
+ * dense enough.
+ *
+ * @param covered  the number of values of the cases first to last
+ */
+static bool is_table_cluster(const walk_env_t *env,
+                             const ir_switch_table_entry *first,
+                             const ir_switch_table_entry *last, double covered)
+{
+	unsigned long range;
+	if (!get_distance(first->min, last->max, &range))
+		return false;
+	double values = (double)range + 1;
+	return covered * 100 >= values * MIN_TABLE_DENSITY
+	    && values - covered <= env->spare_size;
+}
+
+/**
+ * Checks whether bit tests are cheaper than comparing the selector with the
+ * bounds of each case.
+ */
+static bool is_bit_test_profitable(unsigned n_targets, unsigned n_compares)
+{
+	return (n_targets == 1 && n_compares >= 3)
+	    || (n_targets == 2 && n_compares >= 5)
+	    || (n_targets == 3 && n_compares >= 6);
+}
+
+/**
+ * Partitions the sorted cases into clusters: dense ranges become jump
+ * tables, ranges narrower than a machine word with few targets become bit
+ * tests and the remaining cases are compared one by one.
+ *
+ * @return the number of clusters
+ */
+static size_t cluster_cases(const switch_info_t *info, const walk_env_t *env,
+                            const ir_switch_table *table, cluster_t *clusters)
+{
+	size_t                       n_entries  = table->n_entries;
+	const ir_switch_table_entry *entries    = table->entries;
+	unsigned                     word_bits  = get_mode_size_bits(info->table_mode);
+	size_t                       n_clusters = 0;
+
+	/* n_values[i] is the number of values of the cases before case i */
+	double *n_values = XMALLOCN(double, n_entries + 1);
+	n_values[0] = 0.0;
+	for (size_t i = 0; i < n_entries; ++i)
+		n_values[i + 1] = n_values[i] + get_entry_n_values(&entries[i]);
+
+	for (size_t i = 0; i < n_entries;) {
+		const ir_switch_table_entry *first = &entries[i];
+
+		/* find the largest dense range for a jump table */
+		cluster_kind_t kind = CLUSTER_CASE;
+		size_t         end  = i + 1;
+		for (size_t j = n_entries; j - i > env->small_switch; --j) {
+			double covered = n_values[j] - n_values[i];
+			if (is_table_cluster(env, first, &entries[j - 1], covered)) {
+				kind = CLUSTER_TABLE;
+				end  = j;
+				break;
+			}
+		}
+
+		/* otherwise find the largest range usable for bit tests */
+		if (kind == CLUSTER_CASE) {
+			unsigned pns[MAX_BIT_TEST_TARGETS];
+			unsigned n_targets  = 0;
+			unsigned n_compares = 0;
+			for (size_t j = i; j < n_entries; ++j) {
+				const ir_switch_table_entry *entry = &entries[j];
+				unsigned long range;
+				if (!get_distance(first->min, entry->max, &range)
+				 || range >= word_bits)
+					break;
+
+				unsigned t = 0;
+				while (t < n_targets && pns[t] != entry->pn)
+					++t;
+				if (t == n_targets) {
+					if (n_targets == MAX_BIT_TEST_TARGETS)
+						break;
+					pns[n_targets++] = entry->pn;
+				}
+
+				n_compares += entry->min == entry->max ? 1 : 2;
+				if (is_bit_test_profitable(n_targets, n_compares)) {
+					kind = CLUSTER_BIT_TEST;
+					end  = j + 1;
+				}
+			}
+		}
+
+		cluster_t *cluster = &clusters[n_clusters++];
+		cluster->kind      = kind;
+		cluster->entries   = first;
+		cluster->n_entries = end - i;
+		cluster->weight    = 0.0;
+		for (size_t j = i; j < end; ++j) {
+			const ir_switch_table_entry *entry = &entries[j];
+			cluster->weight += info->targets[entry->pn].weight;
+		}
+		i = end;
+	}
+	xfree(n_values);
+	return n_clusters;
+}
+
 /**
  * Block-Walker: searches for Switch nodes
  */
@@ -424,18 +841,36 @@ static void find_switch_nodes(ir_node *block, void *ctx)
 	normalize_table(switchn, selector_mode, NULL);
 	analyse_switch1(&info);
 
-	/* Now create the if cascade */
-	env->changed  = true;
-	info.defusers = NEW_ARR_F(ir_node*, 0);
-	block         = get_nodes_block(switchn);
-	ir_switch_table *table = get_Switch_table(switchn);
-	create_if_cascade(&info, block, table->entries, table->n_entries);
-
-	/* Connect new default case users */
+	/* Now create the decision tree */
+	env->changed    = true;
+	info.defusers   = NEW_ARR_F(ir_node*, 0);
+	info.table_mode = env->selector_mode;
+	info.processed  = &env->processed;
+	block           = get_nodes_block(switchn);
+	ir_switch_table *table      = get_Switch_table(switchn);
+	cluster_t       *clusters   = XMALLOCN(cluster_t, table->n_entries);
+	size_t           n_clusters = cluster_cases(&info, env, table, clusters);
+	create_cluster_tree(&info, block, clusters, n_clusters);
+	xfree(clusters);
+
+	/* Connect the new predecessors of the targets and the default case */
+	for (unsigned pn = 0, n_outs = get_Switch_n_outs(switchn); pn < n_outs;
+	     ++pn) {
+		target_t *target  = &info.targets[pn];
+		size_t    n_preds = ARR_LEN(target->preds);
+		if (n_preds > 0) {
+			set_irn_in(target->block, n_preds, target->preds);
+		} else if (pn != pn_Switch_default && target->block != NULL) {
+			/* no case jumps to the target */
+			ir_node *bad = new_r_Bad(get_irn_irg(switchn), mode_X);
+			set_irn_in(target->block, 1, &bad);
+		}
+		DEL_ARR_F(target->preds);
+	}
 	set_irn_in(info.default_block, ARR_LEN(info.defusers), info.defusers);
 
 	DEL_ARR_F(info.defusers);
-	free(info.targets);
+	xfree(info.targets);
 }
 
 void lower_switch(ir_graph *irg, unsigned small_switch, unsigned spare_size,
@@ -12,13 +12,14 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "array.h"
 #include "obst.h"
 #include "hashptr.h"
 #include "debug.h"
 #include "set.h"
 #include "panic.h"
+#include "util.h"
 
-#include "sp_matrix.h"
 #include "mps.h"
 #include "lpp_solvers.h"
 
@@ -44,11 +45,18 @@ static int cmp_name_t(const void *x, const void *y, size_t size)
  */
 static void update_stats(lpp_t *lpp)
 {
-	lpp->n_elems    = matrix_get_entries(lpp->m);
-	lpp->matrix_mem = lpp->n_elems * matrix_get_elem_size();
+	lpp->n_elems    = ARR_LEN(lpp->factors);
+	lpp->matrix_mem = lpp->n_elems * sizeof(*lpp->factors);
 	lpp->density    = (double)lpp->n_elems / (double)(lpp->cst_next * lpp->var_next) * 100.0;
 }
 
+static void add_factor(lpp_t *lpp, int row, int col, double val)
+{
+	lpp_factor_t const factor = { row, col, val };
+	ARR_APP1(lpp_factor_t, lpp->factors, factor);
+	lpp->compressed = false;
+}
+
 lpp_t *lpp_new(const char *name, lpp_opt_t opt_type)
 {
 	return lpp_new_userdef(name, opt_type, 64, 64, 2.0);
@@ -74,7 +82,7 @@ lpp_t *lpp_new_userdef(const char *name, lpp_opt_t opt_type,
 	lpp->var_size    = estimated_vars;
 	lpp->csts        = XMALLOCNZ(lpp_name_t *, estimated_csts);
 	lpp->vars        = XMALLOCNZ(lpp_name_t *, estimated_vars);
-	lpp->m           = new_matrix(estimated_csts, estimated_vars);
+	lpp->factors     = NEW_ARR_F(lpp_factor_t, 0);
 	lpp->emphasis    = lpp_balanced;
 	idx              = lpp_add_cst(lpp, "obj", lpp_objective, 0);
 	(void)idx;
@@ -88,8 +96,85 @@ lpp_t *lpp_new_userdef(const char *name, lpp_opt_t opt_type,
 
 void lpp_free_matrix(lpp_t *lpp)
 {
-	del_matrix(lpp->m);
-	lpp->m = NULL;
+	DEL_ARR_F(lpp->factors);
+	xfree(lpp->col_begin);
+	lpp->factors   = NULL;
+	lpp->col_begin = NULL;
+}
+
+/**
+ * Stable counting sort of @p n factors from @p src to @p dst by the row
+ * (@p by_col false) or column (@p by_col true) index.
+ */
+static void sort_factors(lpp_factor_t *dst, lpp_factor_t const *src, size_t n,
+                         int *begin, int n_keys, bool by_col)
+{
+	memset(begin, 0, (n_keys + 1) * sizeof(*begin));
+	for (size_t i = 0; i < n; ++i)
+		++begin[(by_col ? src[i].col : src[i].row) + 1];
+	for (int k = 0; k < n_keys; ++k)
+		begin[k + 1] += begin[k];
+	for (size_t i = 0; i < n; ++i)
+		dst[begin[by_col ? src[i].col : src[i].row]++] = src[i];
+}
+
+void lpp_compress(lpp_t *lpp)
+{
+	if (lpp->compressed)
+		return;
+
+	/* Sort by row first and then stable by column, so the factors of a
+	 * matrix position keep the order in which they were set. */
+	size_t        const n       = ARR_LEN(lpp->factors);
+	int           const n_keys  = MAX(lpp->cst_next, lpp->var_next);
+	int          *const begin   = XMALLOCN(int, n_keys + 1);
+	lpp_factor_t *const by_row  = XMALLOCN(lpp_factor_t, n);
+	sort_factors(by_row, lpp->factors, n, begin, lpp->cst_next, false);
+	sort_factors(lpp->factors, by_row, n, begin, lpp->var_next, true);
+	xfree(by_row);
+	xfree(begin);
+
+	/* Keep the last value of each position and drop zeros. */
+	size_t o = 0;
+	for (size_t i = 0; i < n; ++i) {
+		lpp_factor_t const *const f = &lpp->factors[i];
+		if (i + 1 < n && f[1].row == f->row && f[1].col == f->col)
+			continue;
+		if (f->val != 0.0)
+			lpp->factors[o++] = *f;
+	}
+	ARR_SHRINKLEN(lpp->factors, o);
+
+	lpp->col_begin = XREALLOC(lpp->col_begin, int, lpp->var_next + 1);
+	int col = 0;
+	for (size_t i = 0; i < o; ++i) {
+		while (col <= lpp->factors[i].col)
+			lpp->col_begin[col++] = (int)i;
+	}
+	while (col <= lpp->var_next)
+		lpp->col_begin[col++] = (int)o;
+
+	lpp->compressed = true;
+	update_stats(lpp);
+}
+
+double lpp_get_factor(lpp_t *lpp, int cst_idx, int var_idx)
+{
+	lpp_compress(lpp);
+
+	int lo = lpp->col_begin[var_idx];
+	int hi = lpp->col_begin[var_idx + 1];
+	while (lo < hi) {
+		int const mid = lo + (hi - lo) / 2;
+		int const row = lpp->factors[mid].row;
+		if (row == cst_idx)
+			return lpp->factors[mid].val;
+		if (row < cst_idx)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return 0.0;
 }
 
 void lpp_free(lpp_t *lpp)
@@ -100,23 +185,23 @@ void lpp_free(lpp_t *lpp)
 	del_set(lpp->var2nr);
 
 	/* matrix might have been already deleted */
-	if (lpp->m)
-		del_matrix(lpp->m);
+	if (lpp->factors)
+		lpp_free_matrix(lpp);
 
-	free(lpp->csts);
-	free(lpp->vars);
+	xfree(lpp->csts);
+	xfree(lpp->vars);
 
-	free(lpp);
+	xfree(lpp);
 }
 
 double lpp_get_fix_costs(lpp_t *lpp)
 {
-	return matrix_get(lpp->m, 0, 0);
+	return lpp_get_factor(lpp, 0, 0);
 }
 
 void lpp_set_fix_costs(lpp_t *lpp, double value)
 {
-	matrix_set(lpp->m, 0, 0, value);
+	add_factor(lpp, 0, 0, value);
 }
 
 static int name2nr(set *where, const char *name)
@@ -137,11 +222,70 @@ static int var_nr(const lpp_t *lpp, const char *name)
 	return name2nr(lpp->var2nr, name);
 }
 
-static inline char *get_next_name(lpp_t *lpp)
+/**
+ * Generates the name of an unnamed constraint or variable.
+ */
+static const char *get_name(lpp_t *lpp, lpp_name_t *n)
 {
-	char *res = OALLOCN(&lpp->obst, char, 12);
-	snprintf(res, 12, "_%u", lpp->next_name_number++);
-	return res;
+	if (n->name == NULL) {
+		char *res = OALLOCN(&lpp->obst, char, 12);
+		snprintf(res, 12, "_%u", lpp->next_name_number++);
+		n->name = res;
+	}
+	return n->name;
+}
+
+#ifdef DEBUG_libfirm
+/**
+ * Returns the name of a constraint or variable for debug output without
+ * generating one.
+ */
+static const char *debug_name(lpp_name_t const *n)
+{
+	return n->name != NULL ? n->name : "_";
+}
+#endif
+
+const char *lpp_cst_name(lpp_t *lpp, int index)
+{
+	return get_name(lpp, lpp->csts[index]);
+}
+
+const char *lpp_var_name(lpp_t *lpp, int index)
+{
+	return get_name(lpp, lpp->vars[index]);
+}
+
+static lpp_name_t *new_name(lpp_t *lpp)
+{
+	lpp_name_t *const n = OALLOC(&lpp->obst, lpp_name_t);
+	n->name = NULL;
+	n->nr   = -1;
+	return n;
+}
+
+static void add_cst(lpp_t *lpp, lpp_name_t *cst, lpp_cst_t cst_type, double rhs)
+{
+	cst->value_kind    = lpp_none;
+	cst->value         = 0.0;
+	cst->nr            = lpp->cst_next;
+	cst->type.cst_type = cst_type;
+
+	if (lpp->cst_next == lpp->cst_size) {
+		lpp->cst_size = (int)((double)lpp->cst_size * lpp->grow_factor) + 1;
+		lpp->csts     = XREALLOC(lpp->csts, lpp_name_t *, lpp->cst_size);
+	}
+
+	lpp->csts[lpp->cst_next] = cst;
+	lpp->cst_next++;
+	add_factor(lpp, cst->nr, 0, rhs);
+}
+
+int lpp_add_cst_fast(lpp_t *lpp, lpp_cst_t cst_type, double rhs)
+{
+	lpp_name_t *const cst = new_name(lpp);
+	add_cst(lpp, cst, cst_type, rhs);
+	return cst->nr;
 }
 
 int lpp_add_cst(lpp_t *lpp, const char *cst_name, lpp_cst_t cst_type, double rhs)
@@ -153,32 +297,18 @@ int lpp_add_cst(lpp_t *lpp, const char *cst_name, lpp_cst_t cst_type, double rhs
 	if (cst_name && cst_name[0] == '_')
 		return ERR_NAME_NOT_ALLOWED;
 
-	if (cst_name)
-		n.name = obst_xstrdup(&lpp->obst, cst_name);
-	else
-		n.name = get_next_name(lpp);
+	/* Unnamed constraints cannot be looked up, so do not hash them. */
+	if (!cst_name)
+		return lpp_add_cst_fast(lpp, cst_type, rhs);
 
-	n.nr  = -1;
+	n.name = obst_xstrdup(&lpp->obst, cst_name);
+	n.nr   = -1;
 	inner = set_insert(lpp_name_t, lpp->cst2nr, &n, sizeof(n), HASH_NAME_T(&n));
 	assert(inner);
 
-	if (inner->nr == -1) {
-		inner->value_kind    = lpp_none;
-		inner->value         = 0.0;
-		inner->nr            = lpp->cst_next;
-		inner->type.cst_type = cst_type;
-
-		if (lpp->cst_next == lpp->cst_size) {
-			lpp->cst_size = (int)((double)lpp->cst_size * lpp->grow_factor) + 1;
-			lpp->csts     = XREALLOC(lpp->csts, lpp_name_t *, lpp->cst_size);
-		}
-
-		lpp->csts[lpp->cst_next] = inner;
-		lpp->cst_next++;
-		matrix_set(lpp->m, inner->nr, 0, rhs);
-	}
+	if (inner->nr == -1)
+		add_cst(lpp, inner, cst_type, rhs);
 
-	update_stats(lpp);
 	return inner->nr;
 }
 
@@ -206,8 +336,8 @@ int lpp_get_cst_idx(lpp_t *lpp, const char *cst_name)
 
 void lpp_get_cst_name(lpp_t *lpp, int index, char *buf, size_t buf_size)
 {
-	DBG((dbg, LEVEL_2, "%d --> %s\n", index, lpp->csts[index]->name));
-	strncpy(buf, lpp->csts[index]->name, buf_size);
+	DBG((dbg, LEVEL_2, "%d --> %s\n", index, lpp_cst_name(lpp, index)));
+	strncpy(buf, lpp_cst_name(lpp, index), buf_size);
 }
 
 int lpp_add_var_default(lpp_t *lpp, const char *var_name, lpp_var_t var_type, double obj, double startval)
@@ -220,6 +350,32 @@ int lpp_add_var_default(lpp_t *lpp, const char *var_name, lpp_var_t var_type, do
 	return val;
 }
 
+static void add_var(lpp_t *lpp, lpp_name_t *var, lpp_var_t var_type, double obj)
+{
+	var->nr            = lpp->var_next;
+	var->value_kind    = lpp_none;
+	var->value         = 0;
+	var->type.var_type = var_type;
+
+	if (lpp->var_next == lpp->var_size) {
+		lpp->var_size = (int)((double)lpp->var_size * lpp->grow_factor) + 1;
+		lpp->vars     = XREALLOC(lpp->vars, lpp_name_t *, lpp->var_size);
+	}
+
+	lpp->vars[lpp->var_next] = var;
+	lpp->var_next++;
+	add_factor(lpp, 0, var->nr, obj);
+}
+
+int lpp_add_var_fast(lpp_t *lpp, lpp_var_t var_type, double obj)
+{
+	assert(var_type != lpp_invalid && "invalid is for internal use only");
+
+	lpp_name_t *const var = new_name(lpp);
+	add_var(lpp, var, var_type, obj);
+	return var->nr;
+}
+
 int lpp_add_var(lpp_t *lpp, const char *var_name, lpp_var_t var_type, double obj)
 {
 	lpp_name_t n, *inner;
@@ -231,32 +387,18 @@ int lpp_add_var(lpp_t *lpp, const char *var_name, lpp_var_t var_type, double obj
 	if (var_name && var_name[0] == '_')
 		return ERR_NAME_NOT_ALLOWED;
 
-	if (var_name)
-		n.name = obst_xstrdup(&lpp->obst, var_name);
-	else
-		n.name = get_next_name(lpp);
+	/* Unnamed variables cannot be looked up, so do not hash them. */
+	if (!var_name)
+		return lpp_add_var_fast(lpp, var_type, obj);
 
-	n.nr  = -1;
-	inner = set_insert(lpp_name_t, lpp->var2nr, &n, sizeof(n), HASH_NAME_T(&n));
+	n.name = obst_xstrdup(&lpp->obst, var_name);
+	n.nr   = -1;
+	inner  = set_insert(lpp_name_t, lpp->var2nr, &n, sizeof(n), HASH_NAME_T(&n));
 	assert(inner);
 
-	if (inner->nr == -1) {
-		inner->nr            = lpp->var_next;
-		inner->value_kind    = lpp_none;
-		inner->value         = 0;
-		inner->type.var_type = var_type;
-
-		if (lpp->var_next == lpp->var_size) {
-			lpp->var_size = (int)((double)lpp->var_size * lpp->grow_factor) + 1;
-			lpp->vars     = XREALLOC(lpp->vars, lpp_name_t *, lpp->var_size);
-		}
-
-		lpp->vars[lpp->var_next] = inner;
-		lpp->var_next++;
-		matrix_set(lpp->m, 0, inner->nr, obj);
-	}
+	if (inner->nr == -1)
+		add_var(lpp, inner, var_type, obj);
 
-	update_stats(lpp);
 	return inner->nr;
 }
 
@@ -268,8 +410,8 @@ int lpp_get_var_idx(lpp_t *lpp, const char *var_name)
 
 void lpp_get_var_name(lpp_t *lpp, int index, char *buf, size_t buf_size)
 {
-	DBG((dbg, LEVEL_2, "%d --> %s\n", index, lpp->vars[index]->name));
-	strncpy(buf, lpp->vars[index]->name, buf_size);
+	DBG((dbg, LEVEL_2, "%d --> %s\n", index, lpp_var_name(lpp, index)));
+	strncpy(buf, lpp_var_name(lpp, index), buf_size);
 }
 
 int lpp_set_factor(lpp_t *lpp, const char *cst_name, const char *var_name, double value)
@@ -280,8 +422,7 @@ int lpp_set_factor(lpp_t *lpp, const char *cst_name, const char *var_name, doubl
 	var = var_nr(lpp, var_name);
 	assert(cst != -1 && var != -1);
 	DBG((dbg, LEVEL_2, "%s[%d] %s[%d] %g\n", cst_name, cst, var_name, var, value));
-	matrix_set(lpp->m, cst, var, value);
-	update_stats(lpp);
+	add_factor(lpp, cst, var, value);
 	return 0;
 }
 
@@ -289,9 +430,8 @@ int lpp_set_factor_fast(lpp_t *lpp, int cst_idx, int var_idx, double value)
 {
 	assert(cst_idx >= 0 && var_idx >= 0);
 	assert(cst_idx < lpp->cst_next && var_idx < lpp->var_next);
-	DBG((dbg, LEVEL_2, "%s[%d] %s[%d] %g\n", lpp->csts[cst_idx]->name, cst_idx, lpp->vars[var_idx]->name, var_idx, value));
-	matrix_set(lpp->m, cst_idx, var_idx, value);
-	update_stats(lpp);
+	DBG((dbg, LEVEL_2, "%s[%d] %s[%d] %g\n", debug_name(lpp->csts[cst_idx]), cst_idx, debug_name(lpp->vars[var_idx]), var_idx, value));
+	add_factor(lpp, cst_idx, var_idx, value);
 	return 0;
 }
 
@@ -299,16 +439,16 @@ int lpp_set_factor_fast_bulk(lpp_t *lpp, int cst_idx, int *var_idx, int num_vars
 {
 	assert(cst_idx >= 0 && cst_idx < lpp->cst_next);
 	assert(num_vars < lpp->var_next);
-	DBG((dbg, LEVEL_2, "row %s[%d] %d vars %g\n", lpp->csts[cst_idx]->name, cst_idx, num_vars, value));
-	matrix_set_row_bulk(lpp->m, cst_idx, var_idx, num_vars, value);
-	update_stats(lpp);
+	DBG((dbg, LEVEL_2, "row %s[%d] %d vars %g\n", debug_name(lpp->csts[cst_idx]), cst_idx, num_vars, value));
+	for (int i = 0; i < num_vars; ++i)
+		add_factor(lpp, cst_idx, var_idx[i], value);
 	return 0;
 }
 
 void lpp_set_start_value(lpp_t *lpp, int var_idx, double value)
 {
 	assert(var_idx > 0 && var_idx < lpp->var_next);
-	DBG((dbg, LEVEL_2, "%d %s %g\n", var_idx, lpp->vars[var_idx]->name, value));
+	DBG((dbg, LEVEL_2, "%d %s %g\n", var_idx, debug_name(lpp->vars[var_idx]), value));
 	lpp->vars[var_idx]->value = value;
 	lpp->vars[var_idx]->value_kind = lpp_value_start;
 }
@@ -329,42 +469,52 @@ lpp_sol_state_t lpp_get_solution(lpp_t *lpp, double *values, int begin, int end)
 
 void lpp_check_startvals(lpp_t *lpp)
 {
-	int cst_idx;
-
-	for (cst_idx = 1; cst_idx < lpp->cst_next; ++cst_idx) {
-		double     sum     = 0.0;
-		lpp_name_t *cst    = lpp->csts[cst_idx];
-		double     cst_val = matrix_get(lpp->m, cst_idx, 0);
-		int        var_idx;
+	/* Constraints can only be checked if all variables have a start value. */
+	for (int var_idx = 1; var_idx < lpp->var_next; ++var_idx) {
+		if (lpp->vars[var_idx]->value_kind != lpp_value_start)
+			return;
+	}
 
-		for (var_idx = 1; var_idx < lpp->var_next; ++var_idx) {
-				if (lpp->vars[var_idx]->value_kind != lpp_value_start)
-					goto next;
+	lpp_compress(lpp);
+
+	/* Accumulate the left hand sides of all constraints in one pass. */
+	double *const sums    = XMALLOCNZ(double, lpp->cst_next);
+	double *const cst_val = XMALLOCNZ(double, lpp->cst_next);
+	for (size_t i = 0, n = ARR_LEN(lpp->factors); i < n; ++i) {
+		lpp_factor_t const *const f = &lpp->factors[i];
+		if (f->col == 0)
+			cst_val[f->row] = f->val;
+		else
+			sums[f->row] += lpp->vars[f->col]->value * f->val;
+	}
 
-				sum += lpp->vars[var_idx]->value *
-					matrix_get(lpp->m, cst_idx, var_idx);
-		}
+	for (int cst_idx = 1; cst_idx < lpp->cst_next; ++cst_idx) {
+		double      const sum  = sums[cst_idx];
+		char const *const name = lpp_cst_name(lpp, cst_idx);
+		lpp_name_t *const cst  = lpp->csts[cst_idx];
 		switch (cst->type.cst_type) {
 			case lpp_equal:
-				if(sum != cst_val) {
-					fprintf(stderr, "constraint %s unsatisfied: %g != %g\n", cst->name, sum, cst_val);
+				if(sum != cst_val[cst_idx]) {
+					fprintf(stderr, "constraint %s unsatisfied: %g != %g\n", name, sum, cst_val[cst_idx]);
 				}
 				break;
 			case lpp_less_equal:
-				if(sum > cst_val) {
-					fprintf(stderr, "constraint %s unsatisfied: %g >= %g\n", cst->name, sum, cst_val);
+				if(sum > cst_val[cst_idx]) {
+					fprintf(stderr, "constraint %s unsatisfied: %g >= %g\n", name, sum, cst_val[cst_idx]);
 				}
 				break;
 			case lpp_greater_equal:
-				if(sum < cst_val) {
-					fprintf(stderr, "constraint %s unsatisfied: %g <= %g\n", cst->name, sum, cst_val);
+				if(sum < cst_val[cst_idx]) {
+					fprintf(stderr, "constraint %s unsatisfied: %g <= %g\n", name, sum, cst_val[cst_idx]);
 				}
 				break;
 			default:
 				panic("unknown constraint type");
 		}
-next: ;
 	}
+
+	xfree(cst_val);
+	xfree(sums);
 }
 
 void lpp_dump(lpp_t *lpp, const char *filename)
@@ -398,17 +548,27 @@ void lpp_dump_plain(lpp_t *lpp, FILE *f)
 {
 	int i;
 
+	/* The factors are stored by column, so build a row major copy. */
+	lpp_compress(lpp);
+	size_t        const n         = ARR_LEN(lpp->factors);
+	int          *const row_begin = XMALLOCN(int, lpp->cst_next + 1);
+	lpp_factor_t *const by_row    = XMALLOCN(lpp_factor_t, n);
+	sort_factors(by_row, lpp->factors, n, row_begin, lpp->cst_next, false);
+
 	fprintf(f, lpp->opt_type == lpp_minimize ? "Minimize\n" : "Maximize\n");
 	for(i = 0; i < lpp->cst_next; ++i) {
 		lpp_name_t *cst = lpp->csts[i];
+		double      rhs = 0.0;
 
-
-		fprintf(f, "%16s: ", cst->name);
-		matrix_foreach_in_row(lpp->m, cst->nr, elm) {
-			lpp_name_t *var = lpp->vars[elm->col];
+		/* after sorting row_begin[i] is the end of row i */
+		fprintf(f, "%16s: ", lpp_cst_name(lpp, i));
+		for (int e = i > 0 ? row_begin[i - 1] : 0; e < row_begin[i]; ++e) {
+			lpp_factor_t const *const elm = &by_row[e];
 			/* TODO Perhaps better a define LPP_COL_RHS */
 			if(elm->col > 0)
-				fprintf(f, "%+4.1f %-16s ", elm->val, var->name);
+				fprintf(f, "%+4.1f %-16s ", elm->val, lpp_var_name(lpp, elm->col));
+			else
+				rhs = elm->val;
 		}
 
 		if (i == 0) {
@@ -417,14 +577,17 @@ void lpp_dump_plain(lpp_t *lpp, FILE *f)
 		}
 
 		fprintf(f, "%3s %+4.1f\n",
-				lpp_cst_op_to_str(cst->type.cst_type), matrix_get(lpp->m, cst->nr, 0));
+				lpp_cst_op_to_str(cst->type.cst_type), rhs);
 	}
 
+	xfree(by_row);
+	xfree(row_begin);
+
 	fprintf(f, "Binary\n");
 	for(i = 0; i < lpp->var_next; ++i) {
 		lpp_name_t *var = lpp->vars[i];
 		if (var->type.var_type == lpp_binary)
-			fprintf(f, "%16s\n", var->name);
+			fprintf(f, "%16s\n", lpp_var_name(lpp, i));
 	}
 	fprintf(f, "End\n");
 }
@@ -17,8 +17,6 @@
 
 #include "set.h"
 
-#include "sp_matrix.h"
-
 typedef enum _lpp_opt_t {
 	lpp_minimize,
 	lpp_maximize
@@ -72,13 +70,25 @@ typedef struct _name_t {
 	} type;
 } lpp_name_t;
 
+/**
+ * A coefficient of the problem matrix.  Row 0 holds the objective function,
+ * column 0 the right hand sides.
+ */
+typedef struct lpp_factor_t {
+	int    row;                     /**< the constraint number */
+	int    col;                     /**< the variable number */
+	double val;                     /**< the coefficient */
+} lpp_factor_t;
+
 typedef struct _lpp_t {
 	/* The problem data */
 	const char     *name;            /**< A textual name for this problem */
 	FILE           *log;             /**< The log file. */
 	lpp_opt_t      opt_type;         /**< Optimization direction */
 	struct obstack obst;             /**< Obstack for variable names */
-	sp_matrix_t    *m;               /**< The matrix holding objective, constraints and rhs */
+	lpp_factor_t   *factors;         /**< Coefficients of objective, constraints and rhs in the order they were set */
+	int            *col_begin;       /**< Start of each column in factors, valid if compressed */
+	bool           compressed;       /**< factors are sorted by column and row without duplicates or zeros */
 
 	/* Cst/Var to Nr mapping */
 	set *cst2nr;                     /**< Holds name_t's for constraints */
@@ -110,7 +120,7 @@ typedef struct _lpp_t {
 	/* some statistic stuff */
 	unsigned       send_time;        /**< in case of solve_net: send time in usec */
 	unsigned       recv_time;        /**< in case of solve_net: recv time in usec */
-	unsigned       n_elems;          /**< number of elements stored in the matrix */
+	unsigned       n_elems;          /**< number of elements stored in the matrix, updated by lpp_compress() */
 	unsigned       matrix_mem;       /**< memory used by matrix elements (in bytes) */
 	double         density;          /**< density of the matrix (percentage) */
 } lpp_t;
@@ -142,6 +152,20 @@ lpp_t *lpp_new_userdef(const char *name, lpp_opt_t opt_type,
  */
 void lpp_free_matrix(lpp_t *lpp);
 
+/**
+ * Sorts the coefficients of @p lpp by column and row in a single linear
+ * pass.  For every matrix position only the value set last is kept and zero
+ * values are removed.  Afterwards the coefficients of variable @c i are
+ * @c lpp->factors[lpp->col_begin[i]] up to (excluding)
+ * @c lpp->factors[lpp->col_begin[i+1]].
+ */
+void lpp_compress(lpp_t *lpp);
+
+/**
+ * Returns the coefficient of variable @p var_idx in constraint @p cst_idx.
+ */
+double lpp_get_factor(lpp_t *lpp, int cst_idx, int var_idx);
+
 /**
  * Frees all memory allocated for LPP data structure.
  */
@@ -177,6 +201,14 @@ int lpp_add_cst(lpp_t *lpp, const char *cst_name, lpp_cst_t cst_type, double rhs
  */
 int lpp_add_cst_uniq(lpp_t *lpp, const char *cst_name, lpp_cst_t cst_type, double rhs);
 
+/**
+ * Adds an unnamed constraint to a problem.  Unlike lpp_add_cst() neither a
+ * name is generated nor hashed, so the constraint cannot be found by
+ * lpp_get_cst_idx().
+ * @return The index of the new constraint
+ */
+int lpp_add_cst_fast(lpp_t *lpp, lpp_cst_t cst_type, double rhs);
+
 /**
  * Returns the internal index of a constraint.
  * @param cst_name The name of the constraint
@@ -204,6 +236,14 @@ void lpp_get_cst_name(lpp_t *lpp, int index, char *buf, size_t buf_size);
  */
 int lpp_add_var(lpp_t *lpp, const char *var_name, lpp_var_t var_type, double obj);
 
+/**
+ * Adds an unnamed variable to a problem.  Unlike lpp_add_var() neither a
+ * name is generated nor hashed, so the variable cannot be found by
+ * lpp_get_var_idx().
+ * @return The index of the new variable
+ */
+int lpp_add_var_fast(lpp_t *lpp, lpp_var_t var_type, double obj);
+
 /**
  * Same as lpp_add_var() but the user can supply a default value.
  */
@@ -224,6 +264,18 @@ int lpp_get_var_idx(lpp_t *lpp, const char *var_name);
  */
 void lpp_get_var_name(lpp_t *lpp, int index, char *buf, size_t buf_size);
 
+/**
+ * Returns the name of constraint @p index.  Unnamed constraints get a
+ * generated name on the first call.
+ */
+const char *lpp_cst_name(lpp_t *lpp, int index);
+
+/**
+ * Returns the name of variable @p index.  Unnamed variables get a generated
+ * name on the first call.
+ */
+const char *lpp_var_name(lpp_t *lpp, int index);
+
 /**
  * Sets the factor of the variable @p var_name in constraint @p cst_name to @p value.
  * @return -1 if constraint or variable name does not exist.
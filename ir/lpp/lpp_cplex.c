@@ -16,9 +16,9 @@
 #include <stdlib.h>
 #include <ilcplex/cplex.h>
 
+#include "array.h"
 #include "obst.h"
 #include "stat_timing.h"
-#include "sp_matrix.h"
 
 static char cpx_cst_encoding[4] = "?ELG";
 static char cpx_var_encoding[4] = "??CB";
@@ -60,7 +60,7 @@ static void free_cpx(cpx_t *cpx)
 {
 	CPXfreeprob(cpx->env, &cpx->prob);
 	CPXcloseCPLEX(&cpx->env);
-	free(cpx);
+	xfree(cpx);
 }
 
 /**
@@ -80,7 +80,8 @@ static void cpx_construct(cpx_t *cpx)
 
 	numcols    = lpp->var_next-1;
 	numrows    = lpp->cst_next-1;
-	numentries = matrix_get_entries(lpp->m);
+	lpp_compress(lpp);
+	numentries = ARR_LEN(lpp->factors);
 	objsen     = lpp->opt_type == lpp_minimize ? 1 : -1;
 	obstack_init(&obst);
 
@@ -105,11 +106,11 @@ static void cpx_construct(cpx_t *cpx)
 	for (i = 0; i < numcols; ++i) {
 		lpp_name_t *curr_var = lpp->vars[1+i];
 
-		obj[i] = matrix_get(lpp->m, 0, 1+i);
+		obj[i] = 0.0;
 		lb[i]  = 0.0;
 		ub[i]  = CPX_INFBOUND;
 
-		colname[i] = (char*) curr_var->name;
+		colname[i] = (char*) lpp_var_name(lpp, 1 + i);
 		vartype[i] = cpx_var_encoding[curr_var->type.var_type];
 
 		if (curr_var->value_kind == lpp_value_start) {
@@ -119,9 +120,12 @@ static void cpx_construct(cpx_t *cpx)
 
 		matbeg[i] = o;
 		matcnt[i] = 0;
-		matrix_foreach_in_col(lpp->m, 1 + i, elem) {
-			if (elem->row == 0)
+		for (int e = lpp->col_begin[1 + i]; e < lpp->col_begin[2 + i]; ++e) {
+			const lpp_factor_t *elem = &lpp->factors[e];
+			if (elem->row == 0) {
+				obj[i] = elem->val;
 				continue;
+			}
 			matind[o] = elem->row-1;
 			matval[o] = elem->val;
 			matcnt[i]++;
@@ -133,9 +137,14 @@ static void cpx_construct(cpx_t *cpx)
 	for (i = 0; i < numrows; ++i) {
 		lpp_name_t *curr_cst = lpp->csts[1 + i];
 
-		rhs[i]     = matrix_get(lpp->m, 1 + i, 0);
+		rhs[i]     = 0.0;
 		sense[i]   = cpx_cst_encoding[curr_cst->type.cst_type];
-		rowname[i] = (char*) curr_cst->name;
+		rowname[i] = (char*) lpp_cst_name(lpp, 1 + i);
+	}
+	for (int e = lpp->col_begin[0]; e < lpp->col_begin[1]; ++e) {
+		const lpp_factor_t *elem = &lpp->factors[e];
+		if (elem->row > 0)
+			rhs[elem->row - 1] = elem->val;
 	}
 
 	cpx->status = CPXcopylpwnames(cpx->env, cpx->prob,
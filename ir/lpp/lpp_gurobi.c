@@ -16,11 +16,11 @@
 #include <stdlib.h>
 #include <math.h>
 
+#include "array.h"
 #include "obst.h"
 
 #include <gurobi_c.h>
 
-#include "sp_matrix.h"
 
 static char gurobi_cst_encoding[4] = { 0, GRB_EQUAL, GRB_LESS_EQUAL, GRB_GREATER_EQUAL };
 static char gurobi_var_encoding[4] = { 0, 0, GRB_CONTINUOUS, GRB_BINARY };
@@ -68,7 +68,7 @@ static void free_gurobi(gurobi_t *grb)
 {
 	GRBfreemodel(grb->model);
 	GRBfreeenv(grb->env);
-	free(grb);
+	xfree(grb);
 }
 
 /**
@@ -92,7 +92,8 @@ static void gurobi_construct(gurobi_t *grb)
 
 	numcols    = lpp->var_next-1;
 	numrows    = lpp->cst_next-1;
-	numentries = matrix_get_entries(lpp->m);
+	lpp_compress(lpp);
+	numentries = ARR_LEN(lpp->factors);
 	objsen     = lpp->opt_type == lpp_minimize ? 1 : -1;
 	obstack_init(&obst);
 
@@ -116,10 +117,10 @@ static void gurobi_construct(gurobi_t *grb)
 	for (i = 0; i < numcols; ++i) {
 		lpp_name_t *curr_var = lpp->vars[1+i];
 
-		obj[i] = matrix_get(lpp->m, 0, 1+i);
+		obj[i] = 0.0;
 		lb[i]  = 0.0;
 
-		colname[i] = (char*) curr_var->name;
+		colname[i] = (char*) lpp_var_name(lpp, 1 + i);
 		vartype[i] = gurobi_var_encoding[curr_var->type.var_type];
 
 		if (curr_var->value_kind == lpp_value_start) {
@@ -129,9 +130,12 @@ static void gurobi_construct(gurobi_t *grb)
 
 		matbeg[i] = o;
 		matcnt[i] = 0;
-		matrix_foreach_in_col(lpp->m, 1 + i, elem) {
-			if (elem->row == 0)
+		for (int e = lpp->col_begin[1 + i]; e < lpp->col_begin[2 + i]; ++e) {
+			const lpp_factor_t *elem = &lpp->factors[e];
+			if (elem->row == 0) {
+				obj[i] = elem->val;
 				continue;
+			}
 			matind[o] = elem->row-1;
 			matval[o] = elem->val;
 			matcnt[i]++;
@@ -143,9 +147,14 @@ static void gurobi_construct(gurobi_t *grb)
 	for (i = 0; i < numrows; ++i) {
 		lpp_name_t *curr_cst = lpp->csts[1 + i];
 
-		rhs[i]     = matrix_get(lpp->m, 1 + i, 0);
+		rhs[i]     = 0.0;
 		sense[i]   = gurobi_cst_encoding[curr_cst->type.cst_type];
-		rowname[i] = (char*) curr_cst->name;
+		rowname[i] = (char*) lpp_cst_name(lpp, 1 + i);
+	}
+	for (int e = lpp->col_begin[0]; e < lpp->col_begin[1]; ++e) {
+		const lpp_factor_t *elem = &lpp->factors[e];
+		if (elem->row > 0)
+			rhs[elem->row - 1] = elem->val;
 	}
 
 	error = GRBloadmodel(grb->env, &grb->model, lpp->name, numcols, numrows,
@@ -89,14 +89,35 @@ static int mps_insert_markers(FILE *out, lpp_mps_style_t style, lpp_var_t curr,
 	return marker_nr;
 }
 
+/**
+ * Writes the coefficients of column @p col of the compressed matrix, two per
+ * line.
+ */
+static void mps_write_column(lpp_t *lpp, lpp_mps_style_t style, FILE *out,
+                             int col, const char *col_name)
+{
+	const lpp_factor_t *const begin = &lpp->factors[lpp->col_begin[col]];
+	const lpp_factor_t *const end   = &lpp->factors[lpp->col_begin[col + 1]];
+	const lpp_factor_t       *elem  = begin;
+	for (; end - elem >= 2; elem += 2) {
+		mps_write_line(out, style, l_data_col2, col_name,
+		               lpp_cst_name(lpp, elem[0].row), elem[0].val,
+		               lpp_cst_name(lpp, elem[1].row), elem[1].val);
+	}
+	if (elem != end)
+		mps_write_line(out, style, l_data_col1, col_name,
+		               lpp_cst_name(lpp, elem->row), elem->val);
+}
+
 void mps_write_mps(lpp_t *lpp, lpp_mps_style_t style, FILE *out)
 {
-	int i, count, marker_nr = 0;
+	int i, marker_nr = 0;
 	const lpp_name_t *curr;
-	const matrix_elem_t *before = NULL;
 	lpp_var_t last_type;
 	assert(style == s_mps_fixed || style == s_mps_free);
 
+	lpp_compress(lpp);
+
 	/* NAME */
 	mps_write_line(out, style, l_ind_name, lpp->name);
 
@@ -110,7 +131,7 @@ void mps_write_mps(lpp_t *lpp, lpp_mps_style_t style, FILE *out)
 	mps_write_line(out, style, l_ind_rows);
 	for(i=0; i<lpp->cst_next; ++i) {
 		curr = lpp->csts[i];
-		mps_write_line(out, style, l_data_row, mps_cst_encoding[curr->type.cst_type], curr->name);
+		mps_write_line(out, style, l_data_row, mps_cst_encoding[curr->type.cst_type], lpp_cst_name(lpp, i));
 	}
 
 	/* COLUMNS */
@@ -124,35 +145,13 @@ void mps_write_mps(lpp_t *lpp, lpp_mps_style_t style, FILE *out)
 		last_type = curr->type.var_type;
 
 		/* participation in constraints */
-		count = 0;
-		matrix_foreach_in_col(lpp->m, curr->nr, elem) {
-			if (count == 0) {
-				before = elem;
-				count = 1;
-			} else {
-				mps_write_line(out, style, l_data_col2, curr->name, lpp->csts[before->row]->name, (double)before->val, lpp->csts[elem->row]->name, (double)elem->val);
-				count = 0;
-			}
-		}
-		if (count == 1)
-			mps_write_line(out, style, l_data_col1, curr->name, lpp->csts[before->row]->name, (double)before->val);
+		mps_write_column(lpp, style, out, i, lpp_var_name(lpp, i));
 	}
 	mps_insert_markers(out, style, lpp_invalid, last_type, marker_nr); /* potential end-marker */
 
 	/* RHS */
 	mps_write_line(out, style, l_ind_rhs);
-	count = 0;
-	matrix_foreach_in_col(lpp->m, 0, elem) {
-		if (count == 0) {
-			before = elem;
-			count = 1;
-		} else {
-			mps_write_line(out, style, l_data_col2, "rhs", lpp->csts[before->row]->name, (double)before->val, lpp->csts[elem->row]->name, (double)elem->val);
-			count = 0;
-		}
-	}
-	if (count == 1)
-		mps_write_line(out, style, l_data_col1, "rhs", lpp->csts[before->row]->name, (double)before->val);
+	mps_write_column(lpp, style, out, 0, "rhs");
 
 	/* ENDATA */
 	mps_write_line(out, style, l_ind_end);
@@ -165,7 +164,7 @@ void mps_write_mst(lpp_t *lpp, lpp_mps_style_t style, FILE *out)
 	for (i=0; i<lpp->var_next; ++i) {
 		const lpp_name_t *var = lpp->vars[i];
 		if (var->value_kind == lpp_value_start)
-			mps_write_line(out, style, l_data_mst, var->name, (double)var->value);
+			mps_write_line(out, style, l_data_mst, lpp_var_name(lpp, i), (double)var->value);
 	}
 	mps_write_line(out, style, l_ind_end);
 }
@@ -49,6 +49,12 @@ enum
     DEFAULT_ROUNDING = sizeof (union fooround)
   };
 
+/* Upper bound for the geometric growth of the chunk size.  */
+enum
+  {
+    OBSTACK_MAX_CHUNK_SIZE = 256 * 1024
+  };
+
 /* When we copy a long block of data, this is the unit to do it with.
    On some machines, copying successive ints does not work;
    in such a case, redefine COPYING_UNIT to `long' (if that works)
@@ -205,6 +211,16 @@ void _obstack_newchunk(struct obstack *h, PTR_INT_TYPE length)
   PTR_INT_TYPE already;
   char *object_base;
 
+  /* Grow the preferred chunk size geometrically, so obstacks holding a lot
+     of data (like the graph obstack of a big function) end up with a few
+     large chunks instead of thousands of small ones.  */
+  if (h->chunk_size < OBSTACK_MAX_CHUNK_SIZE)
+    {
+      h->chunk_size *= 2;
+      if (h->chunk_size > OBSTACK_MAX_CHUNK_SIZE)
+	h->chunk_size = OBSTACK_MAX_CHUNK_SIZE;
+    }
+
   /* Compute size for new chunk.  */
   new_size = (obj_size + length) + (obj_size >> 3) + h->alignment_mask + 100;
   if (new_size < h->chunk_size)
@@ -331,6 +347,18 @@ PTR_INT_TYPE _obstack_memory_used(struct obstack *h)
   return nbytes;
 }
 
+PTR_INT_TYPE _obstack_chunk_count(struct obstack *h)
+{
+  register struct _obstack_chunk* lp;
+  register PTR_INT_TYPE n_chunks = 0;
+
+  for (lp = h->chunk; lp != 0; lp = lp->prev)
+    {
+      ++n_chunks;
+    }
+  return n_chunks;
+}
+
 static FIRM_NORETURN print_and_abort(void)
 {
   /* Don't change any of these strings.  Yes, it would be possible to add
@@ -468,7 +468,7 @@ static void merge_empty_predecessors(ir_node *block, unsigned new_n_cfgpreds)
 
 	DB((dbg, LEVEL_1, "Set new inputs for %+F\n", block));
 	set_irn_in(block, n, in);
-	free(in);
+	xfree(in);
 }
 
 /**
@@ -11,16 +11,58 @@
  *           Michael Beck
  *
  * The idea here is to push nodes as deep into the dominance tree as their
- * dependencies allow. After pushing them back up out of as many loops as
- * possible.
+ * dependencies allow. After pushing them back up into the dominating block
+ * with the least execution frequency.
  */
+#include <limits.h>
 #include <stdbool.h>
 
 #include "iroptimize.h"
 #include "adt/pdeq.h"
+#include "be.h"
+#include "execfreq.h"
 #include "irnode_t.h"
 #include "iredges_t.h"
 #include "irgopt.h"
+#include "irgwalk.h"
+#include "irloop.h"
+#include "irprofile.h"
+#include "obst.h"
+#include "util.h"
+
+/**
+ * A node is only hoisted into a dominator if this reduces the execution
+ * frequency by at least this factor.  This keeps nodes in place if the
+ * frequencies only differ by rounding errors.
+ */
+#define HOIST_MIN_FREQ_RATIO 0.99
+
+/** Maximum number of nodes hoisted out of a loop, 0 if unlimited. */
+static unsigned max_loop_pressure = 0;
+
+/** Register classes the hoisting budget of a loop is kept for. */
+typedef enum pressure_class_t {
+	PRESSURE_INT,
+	PRESSURE_FLOAT,
+	PRESSURE_NONE,
+} pressure_class_t;
+
+/**
+ * Hoisting budget of a loop, stored in the loop link.  Every hoisted value is
+ * live through the loop and occupies a register there.
+ */
+typedef struct loop_budget_t {
+	int used[PRESSURE_NONE];  /**< registers taken by hoisted values */
+	int limit[PRESSURE_NONE]; /**< registers available for hoisted values */
+} loop_budget_t;
+
+/** Whether hoisting is limited by the loop budgets. */
+static bool limit_hoisting;
+
+void set_place_code_loop_pressure(unsigned limit)
+{
+	max_loop_pressure = limit;
+}
 
 #ifndef NDEBUG
 static bool is_block_reachable(ir_node *block)
@@ -163,38 +205,164 @@ static ir_node *consumer_dom_dca(ir_node *dca, ir_node *consumer,
 	return dca;
 }
 
-static inline int get_block_loop_depth(ir_node *block)
+/**
+ * Checks whether @p block is part of @p loop or one of its inner loops.
+ */
+static bool is_in_loop(const ir_node *block, const ir_loop *loop)
+{
+	for (ir_loop *l = get_irn_loop(block); get_loop_depth(l) > 0;
+	     l = get_loop_outer_loop(l)) {
+		if (l == loop)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Returns the register class a hoisted node @p n is accounted to.  With an
+ * explicit limit every node counts.  Constants are left to
+ * rematerialization and do not count.
+ */
+static pressure_class_t get_pressure_class(const ir_node *n)
+{
+	if (max_loop_pressure != 0)
+		return PRESSURE_INT;
+	if (is_irn_constlike(n))
+		return PRESSURE_NONE;
+	ir_mode *const mode = get_irn_mode(n);
+	if (mode_is_float(mode))
+		return PRESSURE_FLOAT;
+	if (mode_is_int(mode) || mode_is_reference(mode) || mode == mode_T)
+		return PRESSURE_INT;
+	return PRESSURE_NONE;
+}
+
+/**
+ * Checks whether @p op has a user besides @p n in @p loop.  Users which are
+ * not placed yet are assumed to end up in the loop.
+ */
+static bool has_other_use_in_loop(const ir_node *op, const ir_node *n,
+                                  const ir_loop *loop)
 {
-	return get_loop_depth(get_irn_loop(block));
+	foreach_out_edge(op, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		if (user == n || is_End(user) || is_Anchor(user))
+			continue;
+		if (!get_irn_pinned(user) && !irn_visited(user))
+			return true;
+		ir_node *block = get_nodes_block(user);
+		if (is_Phi(user))
+			block = get_Block_cfgpred_block(block, get_edge_src_pos(edge));
+		if (block == NULL || is_in_loop(block, loop))
+			return true;
+	}
+	return false;
 }
 
 /**
- * Move n to a block with less loop depth than its current block. The
- * new block must be dominated by early.
+ * Returns the number of registers hoisting @p n of class @p cls out of
+ * @p loop takes.  The hoisted value is live through the loop, but operands
+ * which are defined outside of the loop and not used there otherwise are not
+ * anymore.
+ */
+static int get_hoisting_cost(const ir_node *n, const ir_loop *loop,
+                             pressure_class_t cls)
+{
+	int cost = 1;
+	if (max_loop_pressure != 0)
+		return cost;
+
+	foreach_irn_in(n, i, op) {
+		if (get_pressure_class(op) != cls
+		    || is_in_loop(get_nodes_block(op), loop))
+			continue;
+		/* count operands used multiple times only once */
+		bool seen = false;
+		for (int j = 0; j < i; ++j)
+			seen |= get_irn_n(n, j) == op;
+		if (!seen && !has_other_use_in_loop(op, n, loop))
+			--cost;
+	}
+	return cost;
+}
+
+/**
+ * Checks whether @p n of class @p cls may be hoisted from @p block into
+ * @p target without exceeding the budget of the loops it leaves.
+ */
+static bool may_hoist(const ir_node *n, const ir_node *block,
+                      const ir_node *target, pressure_class_t cls)
+{
+	if (!limit_hoisting || cls == PRESSURE_NONE)
+		return true;
+
+	for (ir_loop *l = get_irn_loop(block); get_loop_depth(l) > 0;
+	     l = get_loop_outer_loop(l)) {
+		if (is_in_loop(target, l))
+			break;
+		loop_budget_t const *const budget = (loop_budget_t const*)get_loop_link(l);
+		if (budget == NULL)
+			continue;
+		int const cost = get_hoisting_cost(n, l, cls);
+		if (cost > 0 && budget->used[cls] + cost > budget->limit[cls])
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Records that @p n of class @p cls was hoisted from @p block into
+ * @p target.
+ */
+static void add_hoisted(const ir_node *n, const ir_node *block,
+                        const ir_node *target, pressure_class_t cls)
+{
+	if (!limit_hoisting || cls == PRESSURE_NONE)
+		return;
+
+	for (ir_loop *l = get_irn_loop(block); get_loop_depth(l) > 0;
+	     l = get_loop_outer_loop(l)) {
+		if (is_in_loop(target, l))
+			break;
+		loop_budget_t *const budget = (loop_budget_t*)get_loop_link(l);
+		if (budget != NULL)
+			budget->used[cls] += get_hoisting_cost(n, l, cls);
+	}
+}
+
+/**
+ * Move n to a block which is executed less often than its current block.
+ * The new block must be dominated by early.
  *
  * @param n      the node that should be moved
  * @param early  the earliest block we can n move to
  */
 static void move_out_of_loops(ir_node *n, ir_node *early)
 {
-	ir_node *block      = get_nodes_block(n);
-	ir_node *best       = block;
-	int      best_depth = get_block_loop_depth(best);
-
-	/* Find the region deepest in the dominator tree dominating
-	   dca with the least loop nesting depth, but still dominated
-	   by our early placement. */
+	ir_node         *const latest    = get_nodes_block(n);
+	ir_node               *block     = latest;
+	ir_node               *best      = block;
+	double                 best_freq = get_block_execfreq(best);
+	pressure_class_t const cls       = get_pressure_class(n);
+
+	/* Find the block deepest in the dominator tree dominating dca with the
+	   least execution frequency, but still dominated by our early
+	   placement. */
 	while (block != early) {
-		ir_node *idom       = get_Block_idom(block);
-		int      idom_depth = get_block_loop_depth(idom);
-		if (idom_depth < best_depth) {
-			best       = idom;
-			best_depth = idom_depth;
+		ir_node *idom = get_Block_idom(block);
+		if (!may_hoist(n, latest, idom, cls))
+			break;
+		double idom_freq = get_block_execfreq(idom);
+		if (idom_freq < best_freq * HOIST_MIN_FREQ_RATIO) {
+			best      = idom;
+			best_freq = idom_freq;
 		}
 		block = idom;
 	}
-	if (best != get_nodes_block(n))
+	if (best != latest) {
+		add_hoisted(n, latest, best, cls);
 		set_nodes_block(n, best);
+	}
 }
 
 /**
@@ -254,7 +422,7 @@ static void set_projs_block(ir_node *node, ir_node *block)
  * Find the latest legal block for N and place N into the
  * `optimal' Block between the latest and earliest legal block.
  * The `optimal' block is the dominance-deepest block of those
- * with the least loop-nesting-depth.  This places N out of as many
+ * with the least execution frequency.  This places N out of as many
  * loops as possible and then makes it as control dependent as
  * possible.
  */
@@ -326,17 +494,83 @@ static void place_late(ir_graph *irg, pdeq *worklist)
 	}
 }
 
+/**
+ * Returns how many values may be hoisted out of @p loop before its estimated
+ * register pressure exceeds @p n_registers.
+ */
+static int get_hoisting_limit(const ir_loop *loop, bool float_values,
+                              unsigned n_registers)
+{
+	if (n_registers == 0)
+		return INT_MAX;
+	unsigned const pressure = get_loop_register_pressure(loop, float_values, NULL);
+	return pressure < n_registers ? (int)(n_registers - pressure) : 0;
+}
+
+/**
+ * Block walker: sets up the hoisting budget of the loop of a block.
+ */
+static void init_loop_budget(ir_node *block, void *env)
+{
+	struct obstack *const obst = (struct obstack*)env;
+	ir_loop        *const loop = get_irn_loop(block);
+	if (get_loop_depth(loop) == 0 || get_loop_link(loop) != NULL)
+		return;
+
+	loop_budget_t *const budget = OALLOCZ(obst, loop_budget_t);
+	if (max_loop_pressure != 0) {
+		budget->limit[PRESSURE_INT] = (int)MIN(max_loop_pressure, INT_MAX);
+	} else {
+		backend_params const *const be_params = be_get_backend_param();
+		budget->limit[PRESSURE_INT]
+			= get_hoisting_limit(loop, false, be_params->n_int_registers);
+		budget->limit[PRESSURE_FLOAT]
+			= get_hoisting_limit(loop, true, be_params->n_float_registers);
+	}
+	set_loop_link(loop, budget);
+}
+
+/**
+ * Block walker: clears the loop links.
+ */
+static void clear_loop_link(ir_node *block, void *env)
+{
+	(void)env;
+	set_loop_link(get_irn_loop(block), NULL);
+}
+
 /* Code Placement. */
 void place_code(ir_graph *irg)
 {
 	/* Handle graph state */
 	assure_irg_properties(irg,
 		IR_GRAPH_PROPERTY_NO_CRITICAL_EDGES |
+		IR_GRAPH_PROPERTY_NO_BADS |
 		IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE |
 		IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES |
 		IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE |
 		IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
 
+	/* The placement minimizes the execution frequency, use the profile if we
+	 * have one. */
+	ir_set_execfreqs_from_profile(irg);
+
+	/* Hoisting is limited by the register pressure of the loops, which is
+	 * estimated with the original placement.  Moving nodes invalidates the
+	 * loop information, but the loop tree attached to the blocks stays
+	 * usable as the control flow does not change. */
+	backend_params const *const be_params = be_get_backend_param();
+	limit_hoisting = max_loop_pressure != 0
+	              || be_params->n_int_registers != 0
+	              || be_params->n_float_registers != 0;
+	struct obstack obst;
+	if (limit_hoisting) {
+		obstack_init(&obst);
+		ir_reserve_resources(irg, IR_RESOURCE_LOOP_LINK);
+		irg_block_walk_graph(irg, clear_loop_link, NULL, NULL);
+		irg_block_walk_graph(irg, init_loop_budget, NULL, &obst);
+	}
+
 	/* Place all floating nodes as early as possible. This guarantees
 	 a legal code placement. */
 	pdeq *worklist = new_pdeq();
@@ -352,6 +586,11 @@ void place_code(ir_graph *irg)
 	   unnecessary executions of the node. */
 	place_late(irg, worklist);
 
+	if (limit_hoisting) {
+		irg_block_walk_graph(irg, clear_loop_link, NULL, NULL);
+		ir_free_resources(irg, IR_RESOURCE_LOOP_LINK);
+		obstack_free(&obst, NULL);
+	}
 	del_pdeq(worklist);
 	confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_CONTROL_FLOW);
 }
@@ -43,6 +43,7 @@
 #include "panic.h"
 #include "irnodeset.h"
 #include "tv_t.h"
+#include "statev_t.h"
 
 #include "irprintf.h"
 #include "irdump.h"
@@ -74,6 +75,7 @@ struct opcode_key_t {
 struct listmap_entry_t {
 	void            *id;    /**< The id. */
 	node_t          *list;  /**< The associated list for this id. */
+	unsigned         n;     /**< The number of nodes on the list. */
 	listmap_entry_t *next;  /**< Link to the next entry in the map. */
 };
 
@@ -98,7 +100,7 @@ typedef union {
 struct node_t {
 	ir_node        *node;           /**< The IR-node itself. */
 	list_head       node_list;      /**< Double-linked list of leader/follower entries. */
-	list_head       cprop_list;     /**< Double-linked partition.cprop list. */
+	node_t         *cprop_next;     /**< Next node on the partition.cprop list. */
 	partition_t    *part;           /**< points to the partition this node belongs to */
 	node_t         *next;           /**< Next node on local list (partition.touched, fallen). */
 	node_t         *race_next;      /**< Next node on race list. */
@@ -119,7 +121,8 @@ struct node_t {
 struct partition_t {
 	list_head    leader;          /**< The head of partition leader node list. */
 	list_head    follower;        /**< The head of partition follower node list. */
-	list_head    cprop;           /**< The head of partition.cprop list. */
+	node_t      *cprop;           /**< The head of partition.cprop list. */
+	node_t      *cprop_last;      /**< The last node on partition.cprop list. */
 	partition_t *wl_next;         /**< Next entry in the work list if any. */
 	partition_t *touched_next;    /**< Points to the next partition in the touched set. */
 	partition_t *cprop_next;      /**< Points to the next partition in the cprop list. */
@@ -492,7 +495,7 @@ static void listmap_term(listmap_t *map)
  */
 static listmap_entry_t *listmap_find(listmap_t *map, void *id)
 {
-	listmap_entry_t  key   = { .id = id, .list = NULL, .next = NULL };
+	listmap_entry_t  key   = { .id = id, .list = NULL, .n = 0, .next = NULL };
 	listmap_entry_t *entry = set_insert(listmap_entry_t, map->map, &key,
 	                                    sizeof(key), hash_ptr(id));
 
@@ -551,15 +554,27 @@ static int cmp_def_use_edge(const void *a, const void *b)
 	return ea->pos - eb->pos;
 }
 
+/**
+ * Returns the Def-Use edge at position pos of a node.
+ */
+static const ir_def_use_edge *get_def_use_edge(const ir_node *irn,
+                                               unsigned pos)
+{
+	unsigned                     n_outs;
+	const ir_def_use_edge *const edges = get_irn_out_edges(irn, &n_outs);
+	assert(pos < n_outs);
+	return &edges[pos];
+}
+
 /**
  * We need the Def-Use edges sorted.
  */
 static void sort_irn_outs(node_t *node)
 {
-	ir_node  *irn    = node->node;
-	unsigned  n_outs = get_irn_n_outs(irn);
-	QSORT(irn->o.out->edges, n_outs, cmp_def_use_edge);
-	node->max_user_input = n_outs > 0 ? irn->o.out->edges[n_outs-1].pos : -1;
+	unsigned               n_outs;
+	ir_def_use_edge *const edges = get_irn_out_edges(node->node, &n_outs);
+	QSORT(edges, n_outs, cmp_def_use_edge);
+	node->max_user_input = n_outs > 0 ? edges[n_outs-1].pos : -1;
 }
 
 /**
@@ -612,7 +627,6 @@ static inline partition_t *new_partition(environment_t *env)
 
 	INIT_LIST_HEAD(&part->leader);
 	INIT_LIST_HEAD(&part->follower);
-	INIT_LIST_HEAD(&part->cprop);
 #ifdef DEBUG_libfirm
 	part->dbg_next = env->dbg_list;
 	env->dbg_list  = part;
@@ -663,7 +677,6 @@ static node_t *create_partition_node(ir_node *irn, partition_t *part,
 	node_t *node = OALLOCZ(&env->obst, node_t);
 
 	INIT_LIST_HEAD(&node->node_list);
-	INIT_LIST_HEAD(&node->cprop_list);
 	node->node    = irn;
 	node->part    = part;
 	node->type.tv = tarval_bottom;
@@ -744,8 +757,13 @@ static void add_to_cprop(node_t *y, environment_t *env)
 	/* Add y to y.partition.cprop. */
 	if (!y->on_cprop) {
 		partition_t *Y = y->part;
-		list_add_tail(&y->cprop_list, &Y->cprop);
-		y->on_cprop = true;
+		if (Y->cprop == NULL)
+			Y->cprop = y;
+		else
+			Y->cprop_last->cprop_next = y;
+		Y->cprop_last = y;
+		y->cprop_next = NULL;
+		y->on_cprop   = true;
 
 		DB((dbg, LEVEL_3, "Add %+F to part%u.cprop\n", y->node, Y->nr));
 
@@ -802,25 +820,25 @@ static void move_edges_to_leader(node_t *x)
 	ir_node *irn = x->node;
 	foreach_irn_in_r(irn, i, pred_irn) {
 		node_t  *pred = get_irn_node(pred_irn);
-		ir_node *p    = pred->node;
-		unsigned n    = get_irn_n_outs(p);
+		unsigned         n;
+		ir_def_use_edge *edges = get_irn_out_edges(pred->node, &n);
 		for (unsigned j = 0; j < pred->n_followers; ++j) {
-			ir_def_use_edge edge = p->o.out->edges[j];
+			ir_def_use_edge edge = edges[j];
 			if (edge.pos == i && edge.use == irn) {
 				/* found a follower edge to x, move it to the leader */
 				/* remove this edge from the follower set */
 				--pred->n_followers;
-				p->o.out->edges[j] = p->o.out->edges[pred->n_followers];
+				edges[j] = edges[pred->n_followers];
 
 				/* sort it into the leader set */
 				unsigned k;
 				for (k = pred->n_followers+1; k < n; ++k) {
-					if (p->o.out->edges[k].pos >= edge.pos)
+					if (edges[k].pos >= edge.pos)
 						break;
-					p->o.out->edges[k-1] = p->o.out->edges[k];
+					edges[k-1] = edges[k];
 				}
 				/* place the new edge here */
-				p->o.out->edges[k-1] = edge;
+				edges[k-1] = edge;
 
 				/* edge found and moved */
 				break;
@@ -994,7 +1012,7 @@ static bool step(step_env *env)
 		/* let n be the first node in unwalked */
 		node_t *n = env->unwalked;
 		while (env->index < n->n_followers) {
-			const ir_def_use_edge *edge = &n->node->o.out->edges[env->index];
+			const ir_def_use_edge *edge = get_def_use_edge(n->node, env->index);
 
 			/* let m be n.F.def_use[index] */
 			node_t *m = get_irn_node(edge->use);
@@ -1287,7 +1305,7 @@ static void collect_touched(list_head *list, int idx, environment_t *env)
 
 		/* for all edges in x.L.def_use_{idx} */
 		while (x->next_edge < num_edges) {
-			const ir_def_use_edge *edge = &x->node->o.out->edges[x->next_edge];
+			const ir_def_use_edge *edge = get_def_use_edge(x->node, x->next_edge);
 
 			/* check if we have necessary edges */
 			if (edge->pos > idx)
@@ -1345,7 +1363,7 @@ static void collect_commutative_touched(list_head *list, environment_t *env)
 
 		/* for all edges in x.L.def_use_{idx} */
 		while (x->next_edge < num_edges) {
-			const ir_def_use_edge *edge = &x->node->o.out->edges[x->next_edge];
+			const ir_def_use_edge *edge = get_def_use_edge(x->node, x->next_edge);
 			ir_node               *succ;
 
 			/* check if we have necessary edges */
@@ -1523,15 +1541,22 @@ static partition_t *split_by_what(partition_t *X, what_func What,
 		listmap_entry_t *entry = listmap_find(&map, id);
 		x->next     = entry->list;
 		entry->list = x;
+		++entry->n;
 	}
 	/* Let P be a set of Partitions. */
 
+	/* The largest set stays in X, so every node that is moved to a new
+	 * partition ends up in one at most half the size of its old one. */
+	listmap_entry_t *largest = map.values;
+	for (listmap_entry_t *iter = map.values; iter != NULL; iter = iter->next) {
+		if (iter->n > largest->n)
+			largest = iter;
+	}
+
 	/* for all sets S except one in the range of map do */
 	for (listmap_entry_t *iter = map.values; iter != NULL; iter = iter->next) {
-		if (iter->next == NULL) {
-			/* this is the last entry, ignore */
-			break;
-		}
+		if (iter == largest)
+			continue;
 		node_t *S = iter->list;
 
 		/* Add SPLIT( X, S ) to P. */
@@ -2520,15 +2545,15 @@ static void segregate_def_use_chain_1(const ir_node *follower, node_t *leader)
 	DB((dbg, LEVEL_2, "%+F is a follower of %+F\n", follower, leader->node));
 	/* The leader edges must remain sorted, but follower edges can
 	   be unsorted. */
-	ir_node *l = leader->node;
-	unsigned n = get_irn_n_outs(l);
+	unsigned         n;
+	ir_def_use_edge *edges = get_irn_out_edges(leader->node, &n);
 	for (unsigned i = leader->n_followers; i < n; ++i) {
-		if (l->o.out->edges[i].use == follower) {
-			ir_def_use_edge t = l->o.out->edges[i];
+		if (edges[i].use == follower) {
+			ir_def_use_edge t = edges[i];
 
 			for (unsigned j = i; j-- > leader->n_followers; )
-				l->o.out->edges[j+1] = l->o.out->edges[j];
-			l->o.out->edges[leader->n_followers] = t;
+				edges[j+1] = edges[j];
+			edges[leader->n_followers] = t;
 			++leader->n_followers;
 			break;
 		}
@@ -2570,14 +2595,14 @@ static void propagate(environment_t *env)
 		node_t   *fallen   = NULL;
 		unsigned  n_fallen = 0;
 		for (;;) {
-			if (list_empty(&X->cprop))
+			if (X->cprop == NULL)
 				break;
 
 			/* remove the first Node x from X.cprop */
-			node_t *x = list_entry(X->cprop.next, node_t, cprop_list);
+			node_t *x = X->cprop;
 
 			//assert(x->part == X);
-			list_del(&x->cprop_list);
+			X->cprop    = x->cprop_next;
 			x->on_cprop = false;
 
 			if (x->is_follower && identity(x) == x) {
@@ -3190,6 +3215,11 @@ static void add_memory_keeps(ir_graph *irg, ir_node **kept_memory, size_t len)
 
 void combo(ir_graph *irg)
 {
+	/* partitions may be split once per node */
+	if (!ir_complexity_allows(irg, "combo",
+	                          get_irg_complexity(irg, IR_COMPLEXITY_NODES_SQUARED)))
+		return;
+
 	assure_irg_properties(irg,
 		IR_GRAPH_PROPERTY_NO_BADS
 		| IR_GRAPH_PROPERTY_NO_TUPLES
@@ -3244,6 +3274,9 @@ void combo(ir_graph *irg)
 	dump_all_partitions(&env);
 	check_all_partitions(&env);
 
+	stat_ev_dbl("combo_bytes_per_node",
+	            (double)obstack_memory_used(&env.obst) / get_irg_last_idx(irg));
+
 	/* apply the result */
 
 	/* check, which nodes must be kept */
@@ -18,14 +18,19 @@
  *            |
  *         Conv Hs
  *
+ * Nodes with multiple users are only narrowed if the width analysis shows
+ * that none of their users depends on the upper bits.  The other users then
+ * get an extension of the narrowed node, which is in turn removed once they
+ * get narrowed themselves, so chains of extensions vanish program-wide.
+ *
  * TODO: * try to optimize cmp modes
- *       * decide when it is useful to move the convs through phis
  */
 #include <stdbool.h>
 
 #include "util.h"
 #include "iroptimize.h"
 
+#include "bitwidth.h"
 #include "debug.h"
 #include "ircons.h"
 #include "irgmod.h"
@@ -34,12 +39,21 @@
 #include "iropt_t.h"
 #include "iredges_t.h"
 #include "irgwalk.h"
+#include "pmap.h"
 #include "tv.h"
 #include "vrp.h"
 
 DEBUG_ONLY(static firm_dbg_module_t *dbg;)
 
-static bool is_optimizable_node(const ir_node *node, ir_mode *dest_mode)
+typedef struct conv_env_t {
+	ir_widths *widths;   /**< widths of the graph before this iteration */
+	pmap      *costs;    /**< maps nodes to their conversion costs */
+	pmap      *narrowed; /**< maps nodes to their narrowed versions */
+	bool       changed;
+} conv_env_t;
+
+static bool is_optimizable_node(conv_env_t const *const env,
+                                const ir_node *node, ir_mode *dest_mode)
 {
 	switch (get_irn_opcode(node)) {
 	case iro_And:
@@ -57,10 +71,19 @@ static bool is_optimizable_node(const ir_node *node, ir_mode *dest_mode)
 
 	case iro_Shr:
 	case iro_Shrs: {
-		int dest_size = get_mode_size_bits(dest_mode);
-		int size      = get_mode_size_bits(get_irn_mode(node));
-		if (dest_size != size)
-			return false;
+		unsigned dest_size = get_mode_size_bits(dest_mode);
+		unsigned size      = get_mode_size_bits(get_irn_mode(node));
+		if (dest_size != size) {
+			/* A narrower shift yields the same bits if the bits shifted
+			 * in from above are the ones the narrower mode fills in. */
+			ir_node const *const left = get_binop_left(node);
+			if (is_Shr(node)) {
+				if (!is_zero_extended(env->widths, left, dest_size))
+					return false;
+			} else if (!is_sign_extended(env->widths, left, dest_size)) {
+				return false;
+			}
+		}
 		/* FALLTHROUGH */
 	}
 	case iro_Shl: {
@@ -92,11 +115,29 @@ static bool is_shift(ir_node const *const node)
 	return is_Shl(node) || is_Shr(node) || is_Shrs(node);
 }
 
-static int get_conv_costs(const ir_node *const node, ir_mode *const dest_mode)
+/**
+ * Returns whether @p node must keep its mode for some of its users, i.e.
+ * it has multiple users and one of them depends on bits beyond @p dest_mode.
+ * Only strictly narrower modes are considered for shared nodes, otherwise
+ * the users could keep switching the node between modes of equal size.
+ */
+static bool is_needed_wide(conv_env_t const *const env, const ir_node *node,
+                           ir_mode *dest_mode)
+{
+	if (get_irn_n_edges(node) <= 1)
+		return false;
+	unsigned const dest_size = get_mode_size_bits(dest_mode);
+	return dest_size >= get_mode_size_bits(get_irn_mode(node))
+	    || get_demanded_width(env->widths, node) > dest_size;
+}
+
+static int get_conv_costs(conv_env_t *env, const ir_node *node,
+                          ir_mode *dest_mode);
+
+static int compute_conv_costs(conv_env_t *const env, const ir_node *const node,
+                              ir_mode *const dest_mode)
 {
 	ir_mode *const mode = get_irn_mode(node);
-	if (mode == dest_mode)
-		return 0;
 
 	switch (get_irn_opcode(node)) {
 	case iro_Bad:
@@ -118,7 +159,7 @@ static int get_conv_costs(const ir_node *const node, ir_mode *const dest_mode)
 		return 0;
 	}
 
-	if (get_irn_n_edges(node) > 1) {
+	if (is_needed_wide(env, node, dest_mode)) {
 		DB((dbg, LEVEL_3, "multi outs at %+F\n", node));
 		return 1;
 	}
@@ -126,8 +167,6 @@ static int get_conv_costs(const ir_node *const node, ir_mode *const dest_mode)
 	if (ir_zero_when_converted(node, dest_mode))
 		return -1;
 
-	/* TODO: Phi nodes */
-
 	if (!is_downconv(mode, dest_mode))
 		return 1;
 
@@ -135,7 +174,7 @@ static int get_conv_costs(const ir_node *const node, ir_mode *const dest_mode)
 		ir_node *pred      = get_Conv_op(node);
 		ir_mode *pred_mode = get_irn_mode(pred);
 		if (smaller_mode(pred_mode, dest_mode)) {
-			return get_conv_costs(pred, dest_mode) - 1;
+			return get_conv_costs(env, pred, dest_mode) - 1;
 		} else if (may_leave_out_middle_conv(pred_mode, mode, dest_mode)) {
 			return 0;
 		} else {
@@ -143,7 +182,7 @@ static int get_conv_costs(const ir_node *const node, ir_mode *const dest_mode)
 		}
 	}
 
-	if (!is_optimizable_node(node, dest_mode))
+	if (!is_optimizable_node(env, node, dest_mode))
 		return 1;
 
 	int costs = 0;
@@ -151,13 +190,30 @@ static int get_conv_costs(const ir_node *const node, ir_mode *const dest_mode)
 	int const arity = is_shift(node) ? 1 : get_irn_arity(node);
 	for (int i = 0; i < arity; ++i) {
 		ir_node *const pred   = get_irn_n(node, i);
-		int      const pcosts = get_conv_costs(pred, dest_mode);
+		int      const pcosts = get_conv_costs(env, pred, dest_mode);
 		costs += MIN(pcosts, 1);
 	}
 
 	return costs;
 }
 
+static int get_conv_costs(conv_env_t *const env, const ir_node *const node,
+                          ir_mode *const dest_mode)
+{
+	if (get_irn_mode(node) == dest_mode)
+		return 0;
+
+	pmap_entry const *const entry = pmap_find(env->costs, node);
+	if (entry != NULL)
+		return PTR_TO_INT(entry->value);
+
+	/* nodes reached again through a Phi cycle are converted anyway */
+	pmap_insert(env->costs, node, INT_TO_PTR(0));
+	int const costs = compute_conv_costs(env, node, dest_mode);
+	pmap_insert(env->costs, node, INT_TO_PTR(costs));
+	return costs;
+}
+
 static ir_node *place_conv(ir_node *node, ir_mode *dest_mode)
 {
 	ir_node *block = get_nodes_block(node);
@@ -165,12 +221,17 @@ static ir_node *place_conv(ir_node *node, ir_mode *dest_mode)
 	return conv;
 }
 
-static ir_node *conv_transform(ir_node *node, ir_mode *dest_mode)
+static ir_node *conv_transform(conv_env_t *const env, ir_node *node,
+                               ir_mode *dest_mode)
 {
 	ir_mode *const mode = get_irn_mode(node);
 	if (mode == dest_mode)
 		return node;
 
+	ir_node *const narrowed = pmap_get(ir_node, env->narrowed, node);
+	if (narrowed != NULL)
+		return narrowed;
+
 	ir_graph *const irg  = get_irn_irg(node);
 	switch (get_irn_opcode(node)) {
 	case iro_Bad:
@@ -196,7 +257,7 @@ static ir_node *conv_transform(ir_node *node, ir_mode *dest_mode)
 		return new_r_Unknown(irg, dest_mode);
 	}
 
-	if (get_irn_n_edges(node) > 1)
+	if (is_needed_wide(env, node, dest_mode))
 		return place_conv(node, dest_mode);
 
 	if (!is_downconv(mode, dest_mode))
@@ -206,28 +267,23 @@ static ir_node *conv_transform(ir_node *node, ir_mode *dest_mode)
 		ir_node *pred      = get_Conv_op(node);
 		ir_mode *pred_mode = get_irn_mode(pred);
 		if (smaller_mode(pred_mode, dest_mode))
-			return conv_transform(get_Conv_op(node), dest_mode);
+			return conv_transform(env, get_Conv_op(node), dest_mode);
 		return place_conv(node, dest_mode);
 	}
 
-	if (!is_optimizable_node(node, dest_mode))
+	if (!is_optimizable_node(env, node, dest_mode))
 		return place_conv(node, dest_mode);
 
-	// We want to create a new node with the right mode
+	/* We want to create a new node with the right mode.  It is registered
+	 * before its operands get transformed, so Phi cycles reach it. */
 	int       const arity = get_irn_arity(node);
 	ir_node **const ins   = ALLOCAN(ir_node *, arity);
 
 	// The shift count does not participate in the conv optimization
 	int const conv_arity = is_shift(node) ? 1 : arity;
+	ir_node  *const dummy = new_r_Dummy(irg, dest_mode);
 	for (int i = 0; i < conv_arity; i++) {
-		ir_node *pred = get_irn_n(node, i);
-		ir_node *transformed;
-		if (get_conv_costs(pred, dest_mode) > 0) {
-			transformed = place_conv(pred, dest_mode);
-		} else {
-			transformed = conv_transform(pred, dest_mode);
-		}
-		ins[i] = transformed;
+		ins[i] = dummy;
 	}
 
 	for (int i = conv_arity; i < arity; i++) {
@@ -239,13 +295,30 @@ static ir_node *conv_transform(ir_node *node, ir_mode *dest_mode)
 	ir_op    *const op       = get_irn_op(node);
 	ir_node  *const new_node = new_ir_node(dbg, irg, block, op, dest_mode, arity, ins);
 	copy_node_attr(irg, node, new_node);
+	pmap_insert(env->narrowed, node, new_node);
+
+	for (int i = 0; i < conv_arity; i++) {
+		ir_node *pred = get_irn_n(node, i);
+		ir_node *transformed;
+		if (get_conv_costs(env, pred, dest_mode) > 0
+		    && !pmap_contains(env->narrowed, pred)) {
+			transformed = place_conv(pred, dest_mode);
+		} else {
+			transformed = conv_transform(env, pred, dest_mode);
+		}
+		set_irn_n(new_node, i, transformed);
+	}
+
+	/* The remaining users only demand bits the narrowed node still has. */
+	if (get_irn_n_edges(node) > 1)
+		exchange(node, place_conv(new_node, mode));
 
 	return new_node;
 }
 
 static void conv_opt_walker(ir_node *node, void *data)
 {
-	bool *const changed = (bool*)data;
+	conv_env_t *const env = (conv_env_t*)data;
 
 	if (!is_Conv(node))
 		return;
@@ -263,15 +336,21 @@ static void conv_opt_walker(ir_node *node, void *data)
 		return;
 
 	/* - 1 for the initial conv */
-	int const costs = get_conv_costs(pred, mode) - 1;
+	env->costs = pmap_create();
+	int const costs = get_conv_costs(env, pred, mode) - 1;
 	DB((dbg, LEVEL_2, "Costs for %+F -> %+F: %d\n", node, pred, costs));
-	if (costs > 0)
+	if (costs > 0) {
+		pmap_destroy(env->costs);
 		return;
+	}
 
-	ir_node *const transformed = conv_transform(pred, mode);
+	env->narrowed = pmap_create();
+	ir_node *const transformed = conv_transform(env, pred, mode);
+	pmap_destroy(env->narrowed);
+	pmap_destroy(env->costs);
 	if (node != transformed) {
 		exchange(node, transformed);
-		*changed = true;
+		env->changed = true;
 	}
 }
 
@@ -283,15 +362,17 @@ void conv_opt(ir_graph *irg)
 
 	DB((dbg, LEVEL_1, "===> Performing conversion optimization on %+F\n", irg));
 
-	bool global_changed = false;
-	bool changed;
+	bool       global_changed = false;
+	conv_env_t env;
 	do {
-		changed = false;
-		irg_walk_graph(irg, NULL, conv_opt_walker, &changed);
-		if (changed)
+		env.widths  = compute_widths(irg);
+		env.changed = false;
+		irg_walk_graph(irg, NULL, conv_opt_walker, &env);
+		free_widths(env.widths);
+		if (env.changed)
 			local_optimize_graph(irg);
-		global_changed |= changed;
-	} while (changed);
+		global_changed |= env.changed;
+	} while (env.changed);
 
 	confirm_irg_properties(irg,
 		global_changed ? IR_GRAPH_PROPERTIES_NONE : IR_GRAPH_PROPERTIES_ALL);
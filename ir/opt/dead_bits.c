@@ -0,0 +1,161 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2013 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Removes computations of bits nobody cares about.
+ *
+ * Based on the don't care analysis (dca.c) and the known bits (constbits.c).
+ * A node all of whose relevant bits are known becomes a constant, and bit
+ * operations are bypassed if they do not change the relevant bits of their
+ * result, e.g. x & 0xFF when only the low 8 bits are used.  The users of a
+ * bypassed node do not care about the bits in which the values differ, so
+ * both analyses stay valid while the graph is rewritten, and a single walk
+ * suffices.
+ */
+#include "iroptimize.h"
+
+#include "constbits.h"
+#include "dca.h"
+#include "debug.h"
+#include "ircons.h"
+#include "irgmod.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "tv.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/**
+ * Returns whether the bits of @p node in @p mask are known to be zero
+ * (@p value false) or one (@p value true).
+ */
+static bool has_known_bits(const ir_node *node, ir_tarval *mask, bool value)
+{
+	if (is_Const(node)) {
+		ir_tarval *const tv = get_Const_tarval(node);
+		return tarval_is_null(tarval_and(mask, value ? tarval_not(tv) : tv));
+	}
+	bitinfo const *const b = get_bitinfo(node);
+	if (b == NULL)
+		return false;
+	ir_tarval *const bits = value ? tarval_not(b->o) : b->z;
+	return tarval_is_null(tarval_and(mask, bits));
+}
+
+/** Creates a mask with the msb of @p tv and all less significant bits set. */
+static ir_tarval *create_msb_mask(ir_tarval *tv)
+{
+	if (tarval_is_null(tv))
+		return tv;
+	int        const msb = get_tarval_highest_bit(tv);
+	ir_mode   *const mode = get_tarval_mode(tv);
+	ir_tarval *const one  = get_mode_one(mode);
+	ir_tarval *const bit  = tarval_shl_unsigned(one, msb);
+	return tarval_or(bit, tarval_sub(bit, one));
+}
+
+/**
+ * Returns the operand @p node can be replaced with because it does not change
+ * the bits in @p care, or NULL.
+ */
+static ir_node *get_bypass(const ir_node *node, ir_tarval *care)
+{
+	switch (get_irn_opcode(node)) {
+	case iro_And: {
+		ir_node *const l = get_And_left(node);
+		ir_node *const r = get_And_right(node);
+		if (has_known_bits(r, care, true))
+			return l;
+		if (has_known_bits(l, care, true))
+			return r;
+		return NULL;
+	}
+
+	case iro_Or:
+	case iro_Eor: {
+		ir_node *const l = get_binop_left(node);
+		ir_node *const r = get_binop_right(node);
+		if (has_known_bits(r, care, false))
+			return l;
+		if (has_known_bits(l, care, false))
+			return r;
+		return NULL;
+	}
+
+	case iro_Add: {
+		/* carries only propagate upwards */
+		ir_tarval *const mask = create_msb_mask(care);
+		ir_node   *const l    = get_Add_left(node);
+		ir_node   *const r    = get_Add_right(node);
+		if (has_known_bits(r, mask, false))
+			return l;
+		if (has_known_bits(l, mask, false))
+			return r;
+		return NULL;
+	}
+
+	case iro_Sub: {
+		ir_tarval *const mask = create_msb_mask(care);
+		ir_node   *const r    = get_Sub_right(node);
+		return has_known_bits(r, mask, false) ? get_Sub_left(node) : NULL;
+	}
+
+	default:
+		return NULL;
+	}
+}
+
+static void dead_bits_walker(ir_node *node, void *data)
+{
+	bool *const changed = (bool*)data;
+	ir_mode *const mode = get_irn_mode(node);
+	if (!mode_is_int(mode) || is_irn_constlike(node))
+		return;
+
+	ir_tarval *const care = (ir_tarval*)get_irn_link(node);
+	if (care == NULL || get_tarval_mode(care) != mode)
+		return;
+
+	/* all relevant bits known: use a constant */
+	bitinfo const *const b = get_bitinfo(node);
+	if (tarval_is_null(care)
+	    || (b != NULL && tarval_is_null(tarval_and(care,
+	                                               tarval_eor(b->z, b->o))))) {
+		ir_tarval *const tv = b != NULL ? tarval_and(b->z, care) : care;
+		ir_node   *const c  = new_r_Const(get_irn_irg(node), tv);
+		DB((dbg, LEVEL_2, "%+F -> %+F (care %T)\n", node, c, care));
+		exchange(node, c);
+		*changed = true;
+		return;
+	}
+
+	ir_node *const bypass = get_bypass(node, care);
+	if (bypass != NULL && get_irn_mode(bypass) == mode) {
+		DB((dbg, LEVEL_2, "%+F -> %+F (care %T)\n", node, bypass, care));
+		exchange(node, bypass);
+		*changed = true;
+	}
+}
+
+void dead_bits_elimination(ir_graph *irg)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.deadbits");
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_BADS
+		| IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE);
+	constbits_analyze(irg);
+
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	dca_analyze(irg);
+	bool changed = false;
+	irg_walk_graph(irg, NULL, dead_bits_walker, &changed);
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+
+	constbits_clear(irg);
+	confirm_irg_properties(irg,
+		changed ? IR_GRAPH_PROPERTIES_CONTROL_FLOW : IR_GRAPH_PROPERTIES_ALL);
+}
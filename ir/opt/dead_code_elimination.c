@@ -12,7 +12,8 @@
  * which is not used can't be found by any walker.
  * The only drawback is that the nodes still take up memory. This phase fixes
  * this by copying all (reachable) nodes to a new obstack and throwing away
- * the old one.
+ * the old one. The copies are grouped by block, a block followed by the nodes
+ * placed in it, so later walks touch memory mostly linearly.
  */
 #include "iroptimize.h"
 #include "irnode_t.h"
@@ -25,7 +26,9 @@
 #include "irouts.h"
 #include "iropt_t.h"
 #include "pmap.h"
+#include "statev_t.h"
 #include "vrp.h"
+#include "xmalloc.h"
 
 /**
  * Reroute the inputs of a node from nodes in the old graph to copied nodes in
@@ -46,24 +49,118 @@ static void copy_node_dce(ir_node *node, void *env)
 	set_irn_link(node, new_node);
 }
 
+static void collect_node(ir_node *node, void *env)
+{
+	ir_node ***nodes = (ir_node***)env;
+	ARR_APP1(ir_node*, *nodes, node);
+}
+
 /**
- * Copies the graph reachable from the End node to the obstack
- * in irg. Then fixes the fields containing nodes of the graph.
- *
- * @param copy_node_nr  If non-zero, the node number will be copied
+ * Returns the block whose group @p node is copied with, or NULL if it does not
+ * belong to a block.
  */
-static void copy_graph_env(ir_graph *irg)
+static ir_node *get_copy_group(ir_node *node)
+{
+	if (is_Block(node))
+		return node;
+	ir_node *const block = node->in[0];
+	return block != NULL && is_Block(block) ? block : NULL;
+}
+
+/**
+ * Returns the nodes reachable from the anchor in the order they are copied:
+ * nodes without a block first, then each block followed by its nodes. Blocks
+ * appear in the order the walker reaches them, and nodes of one block keep
+ * their walk order.
+ */
+static ir_node **get_copy_order(ir_graph *irg)
+{
+	ir_node **nodes = NEW_ARR_F(ir_node*, 0);
+	irg_walk_in_or_dep(irg->anchor, collect_node, NULL, &nodes);
+
+	/* number the groups, group 0 holds the nodes without a block */
+	size_t    const n_nodes  = ARR_LEN(nodes);
+	unsigned *const group_of = XMALLOCNZ(unsigned, get_irg_last_idx(irg));
+	size_t         *start    = NEW_ARR_F(size_t, 1);
+	start[0] = 0;
+	for (size_t i = 0; i < n_nodes; ++i) {
+		ir_node *const block = get_copy_group(nodes[i]);
+		if (block == NULL) {
+			++start[0];
+			continue;
+		}
+		unsigned *const group = &group_of[get_irn_idx(block)];
+		if (*group == 0) {
+			*group = ARR_LEN(start);
+			ARR_APP1(size_t, start, 0);
+		}
+		++start[*group];
+	}
+
+	/* turn the sizes into start positions */
+	size_t pos = 0;
+	for (size_t g = 0, n_groups = ARR_LEN(start); g < n_groups; ++g) {
+		size_t const size = start[g];
+		start[g] = pos;
+		pos     += size;
+	}
+
+	/* place the blocks first, so each one precedes its nodes */
+	ir_node **const order = NEW_ARR_F(ir_node*, n_nodes);
+	for (size_t i = 0; i < n_nodes; ++i) {
+		ir_node *const node = nodes[i];
+		if (is_Block(node))
+			order[start[group_of[get_irn_idx(node)]]++] = node;
+	}
+	for (size_t i = 0; i < n_nodes; ++i) {
+		ir_node *const node = nodes[i];
+		if (is_Block(node))
+			continue;
+		ir_node *const block = get_copy_group(node);
+		unsigned const group = block != NULL ? group_of[get_irn_idx(block)] : 0;
+		order[start[group]++] = node;
+	}
+
+	DEL_ARR_F(start);
+	xfree(group_of);
+	DEL_ARR_F(nodes);
+	return order;
+}
+
+/**
+ * Copies the nodes in @p order to the obstack in irg. Then fixes the fields
+ * containing nodes of the graph.
+ */
+static void copy_graph_env(ir_graph *irg, ir_node **order)
 {
 	/* copy nodes */
-	ir_node *anchor = irg->anchor;
-	irg_walk_in_or_dep(anchor, copy_node_dce, rewire_inputs, NULL);
+	for (size_t i = 0, n = ARR_LEN(order); i < n; ++i)
+		copy_node_dce(order[i], NULL);
+	for (size_t i = 0, n = ARR_LEN(order); i < n; ++i)
+		rewire_inputs(order[i], NULL);
 
 	/* fix the anchor */
-	ir_node *new_anchor = (ir_node*)get_irn_link(anchor);
+	ir_node *new_anchor = (ir_node*)get_irn_link(irg->anchor);
 	assert(new_anchor != NULL);
 	irg->anchor = new_anchor;
 }
 
+/**
+ * Copies the callee arrays of the old Calls in order to their copies, the old
+ * arrays live on the old obstack.
+ */
+static void copy_callee_info(ir_node *const *order)
+{
+	for (size_t i = 0, n = ARR_LEN(order); i < n; ++i) {
+		ir_node *const old = order[i];
+		if (!is_Call(old) || !cg_call_has_callees(old))
+			continue;
+		ir_node *const copy = (ir_node*)get_irn_link(old);
+		cg_set_call_callee_arr(copy, cg_get_call_n_callees(old),
+		                       old->attr.call.callee_arr);
+	}
+}
+
 /**
  * Copies all reachable nodes to a new obstack.  Removes bad inputs
  * from block nodes and the corresponding inputs from Phi nodes.
@@ -76,13 +173,16 @@ void dead_node_elimination(ir_graph *irg)
 {
 	edges_deactivate(irg);
 
-	/* Handle graph state */
-	free_callee_info(irg);
+	/* Handle graph state, copying keeps the callee information */
+	irg_callee_info_state const callee_info_state
+		= get_irg_callee_info_state(irg);
 	free_irg_outs(irg);
 	free_loop_information(irg);
 	free_vrp_data(irg);
 	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
 
+	ir_node **const order = get_copy_order(irg);
+
 	/* A quiet place, where the old obstack can rest in peace,
 	   until it will be cremated. */
 	struct obstack graveyard_obst = irg->obst;
@@ -96,8 +196,16 @@ void dead_node_elimination(ir_graph *irg)
 
 	/* Copy the graph from the old to the new obstack */
 	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
-	copy_graph_env(irg);
+	copy_graph_env(irg, order);
+	if (callee_info_state != irg_callee_info_none)
+		copy_callee_info(order);
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	set_irg_callee_info_state(irg, callee_info_state);
+	DEL_ARR_F(order);
+
+	stat_ev_dbl("dead_node_elimination_bytes_reclaimed",
+	            (double)obstack_memory_used(&graveyard_obst)
+	            - (double)obstack_memory_used(&irg->obst));
 
 	/* Free memory from old unoptimized obstack */
 	obstack_free(&graveyard_obst, 0);  /* First empty the obstack ... */
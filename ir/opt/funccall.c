@@ -9,6 +9,8 @@
  * @author  Michael Beck
  */
 #include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "util.h"
 #include "opt_init.h"
@@ -27,6 +29,7 @@
 #include "irhooks.h"
 #include "irprog_t.h"
 #include "irtools.h"
+#include "obst.h"
 #include "raw_bitset.h"
 #include "debug.h"
 #include "panic.h"
@@ -385,8 +388,16 @@ next_no_change:
 			if (callee == NULL)
 				return mtp_no_property;
 			ir_graph *irg = get_entity_linktime_irg(callee);
-			if (irg == NULL)
-				return mtp_no_property;
+			if (irg == NULL) {
+				/* external methods have the properties given by the frontend
+				 * or read from a summary */
+				mtp_additional_properties entprops
+					= callprops | get_entity_additional_properties(callee);
+				if (entprops & mtp_property_pure)
+					entprops |= mtp_property_no_write;
+				max_prop &= entprops;
+				goto call_next;
+			}
 			/* recursively analyze graph, unless we found a loop in which case
 			 * we can't guarantee termination and have to live with the
 			 * currently set flags */
@@ -588,9 +599,11 @@ static void handle_nothrow_Calls(void)
  */
 static bool is_malloc_call_result(const ir_node *node)
 {
-	/* TODO: check mtp_malloc */
-	(void)node;
-	return false;
+	if (!is_Call(node))
+		return false;
+	ir_entity *const callee = get_Call_callee(node);
+	return callee != NULL
+	    && (get_entity_additional_properties(callee) & mtp_property_malloc);
 }
 
 /**
@@ -849,14 +862,135 @@ void optimize_funccalls(void)
 	}
 	handle_const_Calls();
 
-	free(busy_set);
-	free(ready_set);
+	xfree(busy_set);
+	xfree(ready_set);
 
 	foreach_irp_irg(i, irg) {
 		assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE);
 	}
 }
 
+/** The properties in method summaries and their names. */
+static const struct {
+	mtp_additional_properties  property;
+	const char                *name;
+} summary_properties[] = {
+	{ mtp_property_no_write,   "no_write"   },
+	{ mtp_property_pure,       "pure"       },
+	{ mtp_property_noreturn,   "noreturn"   },
+	{ mtp_property_terminates, "terminates" },
+	{ mtp_property_nothrow,    "nothrow"    },
+	{ mtp_property_malloc,     "malloc"     },
+};
+
+static const char summary_header[] = "# firm method summaries";
+
+static bool is_summarized(const ir_entity *entity)
+{
+	if (!is_method_entity(entity))
+		return false;
+	ir_visibility const visibility = get_entity_visibility(entity);
+	if (visibility == ir_visibility_local
+	    || visibility == ir_visibility_private)
+		return false;
+	return !(get_entity_linkage(entity) & IR_LINKAGE_WEAK);
+}
+
+int ir_export_method_summaries(const char *filename)
+{
+	FILE *const out = fopen(filename, "w");
+	if (out == NULL)
+		return 1;
+
+	fprintf(out, "%s\n", summary_header);
+	ir_type *const segment = get_glob_type();
+	for (size_t i = 0, n = get_compound_n_members(segment); i < n; ++i) {
+		ir_entity *const entity = get_compound_member(segment, i);
+		if (!is_summarized(entity))
+			continue;
+
+		mtp_additional_properties const props
+			= get_entity_additional_properties(entity);
+		bool first = true;
+		for (size_t p = 0; p < ARRAY_SIZE(summary_properties); ++p) {
+			if (!(props & summary_properties[p].property))
+				continue;
+			if (first)
+				fputs(get_entity_ld_name(entity), out);
+			fprintf(out, " %s", summary_properties[p].name);
+			first = false;
+		}
+		if (!first)
+			fputc('\n', out);
+	}
+
+	int const res = ferror(out);
+	return fclose(out) != 0 || res != 0;
+}
+
+static char *read_line(FILE *const f, struct obstack *const obst)
+{
+	int c = fgetc(f);
+	if (c == EOF)
+		return NULL;
+	for (; c != EOF && c != '\n'; c = fgetc(f)) {
+		obstack_1grow(obst, c);
+	}
+	obstack_1grow(obst, '\0');
+	return (char*)obstack_finish(obst);
+}
+
+/**
+ * Parses a summary line "ld_name property...", unknown properties are
+ * ignored.
+ */
+static void parse_summary(char *const line)
+{
+	char const *const separators = " \t\r";
+	char       *const name       = strtok(line, separators);
+	if (name == NULL || name[0] == '#')
+		return;
+
+	mtp_additional_properties props = mtp_no_property;
+	for (char const *word; (word = strtok(NULL, separators)) != NULL;) {
+		for (size_t p = 0; p < ARRAY_SIZE(summary_properties); ++p) {
+			if (streq(word, summary_properties[p].name))
+				props |= summary_properties[p].property;
+		}
+	}
+
+	/* the graph of a method defined here is analysed instead */
+	ir_entity *const entity = ir_get_global(new_id_from_str(name));
+	if (entity == NULL || !is_summarized(entity)
+	    || get_entity_irg(entity) != NULL)
+		return;
+	DB((dbg, LEVEL_2, "%+F: summary adds %x\n", entity, (unsigned)props));
+	add_entity_additional_properties(entity, props);
+}
+
+int ir_import_method_summaries(const char *filename)
+{
+	FILE *const in = fopen(filename, "r");
+	if (in == NULL)
+		return 1;
+
+	struct obstack obst;
+	obstack_init(&obst);
+	char *line = read_line(in, &obst);
+	bool  res  = line == NULL || !streq(line, summary_header);
+	if (!res) {
+		obstack_free(&obst, line);
+		for (; (line = read_line(in, &obst)) != NULL;
+		     obstack_free(&obst, line)) {
+			parse_summary(line);
+		}
+		res = ferror(in) != 0;
+	}
+	obstack_free(&obst, NULL);
+	fclose(in);
+	return res;
+}
+
 void firm_init_funccalls(void)
 {
 	FIRM_DBG_REGISTER(dbg, "firm.opt.funccalls");
@@ -5,8 +5,16 @@
 
 /**
  * @file
- * @brief    Removal of unreachable methods.
+ * @brief    Removal of unreachable methods, entities and types.
  * @author   Matthias Braun
+ *
+ * Entities and types are marked in dense bitsets indexed by their numbers.
+ * Marking is iterative: newly marked entities and types are put on work
+ * queues, and the graphs of marked methods are collected and walked in
+ * batches, which run in parallel if the batch is big enough.  Walks of
+ * different graphs do not share any state, so the workers only have to
+ * record the entities and types they find; marking happens on the main
+ * thread afterwards.
  */
 #include "iroptimize.h"
 #include "typerep.h"
@@ -14,36 +22,134 @@
 #include "entity_t.h"
 #include "irprog_t.h"
 #include "irnode_t.h"
+#include "irgraph_t.h"
 #include "irgwalk.h"
+#include "array.h"
+#include "raw_bitset.h"
 #include "panic.h"
 #include "debug.h"
+#include "util.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/** Minimum number of graphs per thread of a parallel walk. */
+#define GC_MIN_GRAPHS_PER_THREAD 8
+/** Maximum number of threads walking graphs. */
+#define GC_MAX_THREADS           8
 
 DEBUG_ONLY(static firm_dbg_module_t *dbg;)
 
-static void visit_entity(ir_entity *entity);
+/** Entities and types referenced by walked nodes. */
+typedef struct gc_refs_t {
+	ir_entity **entities;
+	ir_type   **types;
+	bool        collect_types; /**< Whether types are recorded at all. */
+} gc_refs_t;
+
+/** The garbage collection environment. */
+typedef struct gc_env_t {
+	unsigned   *entity_marks;  /**< Marked entities, indexed by number. */
+	unsigned   *type_marks;    /**< Marked types, indexed by number. */
+	size_t      n_nrs;         /**< Size of the bitsets. */
+	ir_entity **entity_queue;  /**< Marked entities not yet visited. */
+	ir_type   **type_queue;    /**< Marked types not yet visited. */
+	ir_graph  **graphs;        /**< Graphs of marked methods not yet walked. */
+	gc_refs_t   refs;          /**< References found by the main thread. */
+} gc_env_t;
+
+/** A batch of graphs walked by several threads. */
+typedef struct gc_batch_t {
+	ir_graph **graphs;
+	size_t     n_graphs;
+	size_t     next;           /**< Next graph to walk, taken atomically. */
+} gc_batch_t;
+
+/** A thread walking graphs of a batch. */
+typedef struct gc_worker_t {
+	gc_batch_t *batch;
+	gc_refs_t   refs;
+} gc_worker_t;
+
+static void mark_entity(gc_env_t *env, ir_entity *entity)
+{
+	size_t const nr = get_entity_nr(entity);
+	assert(nr < env->n_nrs);
+	if (rbitset_is_set(env->entity_marks, nr))
+		return;
+	rbitset_set(env->entity_marks, nr);
+	ARR_APP1(ir_entity*, env->entity_queue, entity);
+}
+
+static bool entity_marked(gc_env_t const *env, ir_entity const *entity)
+{
+	return rbitset_is_set(env->entity_marks, get_entity_nr(entity));
+}
 
-static void visit_node(ir_node *node, void *env)
+static void mark_type(gc_env_t *env, ir_type *type)
 {
-	(void)env;
-	ir_entity *entity = get_irn_entity_attr(node);
+	if (env->type_marks == NULL || type == NULL)
+		return;
+	size_t const nr = get_type_nr(type);
+	assert(nr < env->n_nrs);
+	if (rbitset_is_set(env->type_marks, nr))
+		return;
+	rbitset_set(env->type_marks, nr);
+	ARR_APP1(ir_type*, env->type_queue, type);
+}
+
+/**
+ * Walker: records the entities and types referenced by a node.
+ */
+static void collect_node_refs(ir_node *node, void *ctx)
+{
+	gc_refs_t *const refs   = (gc_refs_t*)ctx;
+	ir_entity *const entity = get_irn_entity_attr(node);
 	if (entity != NULL)
-		visit_entity(entity);
+		ARR_APP1(ir_entity*, refs->entities, entity);
+
+	if (!refs->collect_types)
+		return;
+	ir_type *type;
+	if (is_Load(node))
+		type = get_Load_type(node);
+	else if (is_Store(node))
+		type = get_Store_type(node);
+	else
+		type = get_irn_type_attr(node);
+	if (type != get_unknown_type())
+		ARR_APP1(ir_type*, refs->types, type);
 }
 
-static void start_visit_node(ir_node *node)
+/**
+ * Marks and clears the references recorded in @p refs.
+ */
+static void mark_refs(gc_env_t *env, gc_refs_t *refs)
+{
+	for (size_t i = 0, n = ARR_LEN(refs->entities); i < n; ++i)
+		mark_entity(env, refs->entities[i]);
+	for (size_t i = 0, n = ARR_LEN(refs->types); i < n; ++i)
+		mark_type(env, refs->types[i]);
+	ARR_SHRINKLEN(refs->entities, 0);
+	ARR_SHRINKLEN(refs->types, 0);
+}
+
+static void start_visit_node(gc_env_t *env, ir_node *node)
 {
 	ir_graph *irg = get_irn_irg(node);
 	if (get_irg_visited(irg) < get_max_irg_visited()) {
 		set_irg_visited(irg, get_max_irg_visited());
 	}
-	irg_walk_2(node, visit_node, NULL, NULL);
+	irg_walk_2(node, collect_node_refs, NULL, &env->refs);
 }
 
-static void visit_initializer(ir_initializer_t *initializer)
+static void visit_initializer(gc_env_t *env, ir_initializer_t *initializer)
 {
 	switch (initializer->kind) {
 	case IR_INITIALIZER_CONST:
-		start_visit_node(initializer->consti.value);
+		start_visit_node(env, initializer->consti.value);
 		return;
 	case IR_INITIALIZER_TARVAL:
 	case IR_INITIALIZER_NULL:
@@ -53,7 +159,7 @@ static void visit_initializer(ir_initializer_t *initializer)
 		for (size_t i = 0; i < initializer->compound.n_initializers; ++i) {
 			ir_initializer_t *subinitializer
 				= initializer->compound.initializers[i];
-			visit_initializer(subinitializer);
+			visit_initializer(env, subinitializer);
 		}
 		return;
 	}
@@ -61,30 +167,31 @@ static void visit_initializer(ir_initializer_t *initializer)
 	panic("invalid initializer found");
 }
 
-static void visit_entity(ir_entity *entity)
+static void visit_entity(gc_env_t *env, ir_entity *entity)
 {
-	if (entity_visited(entity))
-		return;
-	mark_entity_visited(entity);
+	mark_type(env, get_entity_type(entity));
+	mark_type(env, get_entity_owner(entity));
 
 	switch (get_entity_kind(entity)) {
 	case IR_ENTITY_NORMAL: {
 		ir_initializer_t *const init = get_entity_initializer(entity);
 		if (init)
-			visit_initializer(init);
+			visit_initializer(env, init);
 		break;
 	}
 
 	case IR_ENTITY_METHOD: {
 		ir_graph *irg = get_entity_irg(entity);
-		if (irg != NULL)
-			start_visit_node(get_irg_end(irg));
+		if (irg != NULL) {
+			mark_type(env, get_irg_frame_type(irg));
+			ARR_APP1(ir_graph*, env->graphs, irg);
+		}
 		break;
 	}
 
 	case IR_ENTITY_ALIAS: {
 		ir_entity *aliased = get_entity_alias(entity);
-		visit_entity(aliased);
+		mark_entity(env, aliased);
 		break;
 	}
 
@@ -93,7 +200,156 @@ static void visit_entity(ir_entity *entity)
 	}
 }
 
-static void visit_segment(ir_type *segment)
+static void visit_type(gc_env_t *env, ir_type *type)
+{
+	mark_type(env, get_higher_type(type));
+
+	switch (get_type_opcode(type)) {
+	case tpo_class:
+		/* class hierarchies are kept as a whole */
+		for (size_t i = 0, n = get_class_n_supertypes(type); i < n; ++i)
+			mark_type(env, get_class_supertype(type, i));
+		for (size_t i = 0, n = get_class_n_subtypes(type); i < n; ++i)
+			mark_type(env, get_class_subtype(type, i));
+		/* fallthrough */
+	case tpo_struct:
+	case tpo_union:
+		/* the members live as long as their owner, segment members are
+		 * collected as entities instead */
+		for (size_t i = 0, n = get_compound_n_members(type); i < n; ++i)
+			mark_type(env, get_entity_type(get_compound_member(type, i)));
+		return;
+	case tpo_method:
+		for (size_t i = 0, n = get_method_n_params(type); i < n; ++i)
+			mark_type(env, get_method_param_type(type, i));
+		for (size_t i = 0, n = get_method_n_ress(type); i < n; ++i)
+			mark_type(env, get_method_res_type(type, i));
+		return;
+	case tpo_pointer:
+		mark_type(env, get_pointer_points_to_type(type));
+		return;
+	case tpo_array:
+		mark_type(env, get_array_element_type(type));
+		return;
+	case tpo_segment:
+	case tpo_code:
+	case tpo_primitive:
+	case tpo_unknown:
+	case tpo_uninitialized:
+		return;
+	}
+	panic("invalid type found");
+}
+
+/**
+ * Walks the graphs of a batch until none are left.
+ */
+static void walk_batch_graphs(gc_batch_t *batch, gc_refs_t *refs)
+{
+	for (;;) {
+#ifndef _WIN32
+		size_t const i = __atomic_fetch_add(&batch->next, 1, __ATOMIC_RELAXED);
+#else
+		size_t const i = batch->next++;
+#endif
+		if (i >= batch->n_graphs)
+			break;
+		irg_walk_2(get_irg_end(batch->graphs[i]), collect_node_refs, NULL,
+		           refs);
+	}
+}
+
+#ifndef _WIN32
+static void *walk_worker(void *ctx)
+{
+	gc_worker_t *const worker = (gc_worker_t*)ctx;
+	walk_batch_graphs(worker->batch, &worker->refs);
+	return NULL;
+}
+#endif
+
+/**
+ * Walks all collected graphs, in parallel if there are enough of them.
+ */
+static void walk_graphs(gc_env_t *env)
+{
+	gc_batch_t batch = {
+		.graphs   = env->graphs,
+		.n_graphs = ARR_LEN(env->graphs),
+		.next     = 0,
+	};
+
+	/* every node is visited once over all walks */
+	ir_visited_t const visited = get_max_irg_visited();
+	for (size_t i = 0; i < batch.n_graphs; ++i) {
+		ir_graph *const irg = batch.graphs[i];
+		if (get_irg_visited(irg) < visited)
+			set_irg_visited(irg, visited);
+	}
+
+#ifndef _WIN32
+	size_t n_threads = batch.n_graphs / GC_MIN_GRAPHS_PER_THREAD;
+	long   const n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n_cpus > 0)
+		n_threads = MIN(n_threads, (size_t)n_cpus);
+	n_threads = MIN(n_threads, (size_t)GC_MAX_THREADS);
+
+	if (n_threads > 1) {
+		gc_worker_t workers[GC_MAX_THREADS];
+		pthread_t   threads[GC_MAX_THREADS];
+		bool        started[GC_MAX_THREADS];
+		for (size_t t = 1; t < n_threads; ++t) {
+			workers[t].batch               = &batch;
+			workers[t].refs.entities       = NEW_ARR_F(ir_entity*, 0);
+			workers[t].refs.types          = NEW_ARR_F(ir_type*, 0);
+			workers[t].refs.collect_types  = env->refs.collect_types;
+			started[t] = pthread_create(&threads[t], NULL, walk_worker,
+			                            &workers[t]) == 0;
+		}
+		/* the main thread takes part, and covers for failed threads */
+		walk_batch_graphs(&batch, &env->refs);
+		for (size_t t = 1; t < n_threads; ++t) {
+			if (started[t])
+				pthread_join(threads[t], NULL);
+			mark_refs(env, &workers[t].refs);
+			DEL_ARR_F(workers[t].refs.types);
+			DEL_ARR_F(workers[t].refs.entities);
+		}
+		ARR_SHRINKLEN(env->graphs, 0);
+		return;
+	}
+#endif
+
+	walk_batch_graphs(&batch, &env->refs);
+	ARR_SHRINKLEN(env->graphs, 0);
+}
+
+/**
+ * Visits all marked entities and types until the marks are closed.
+ */
+static void mark_reachable(gc_env_t *env)
+{
+	for (;;) {
+		mark_refs(env, &env->refs);
+		if (ARR_LEN(env->entity_queue) > 0) {
+			size_t     const n      = ARR_LEN(env->entity_queue);
+			ir_entity *const entity = env->entity_queue[n - 1];
+			ARR_SHRINKLEN(env->entity_queue, n - 1);
+			visit_entity(env, entity);
+		} else if (ARR_LEN(env->type_queue) > 0) {
+			size_t   const n    = ARR_LEN(env->type_queue);
+			ir_type *const type = env->type_queue[n - 1];
+			ARR_SHRINKLEN(env->type_queue, n - 1);
+			visit_type(env, type);
+		} else if (ARR_LEN(env->graphs) > 0) {
+			walk_graphs(env);
+		} else {
+			break;
+		}
+	}
+}
+
+static void visit_segment(gc_env_t *env, ir_type *segment)
 {
 	for (int i = 0, n = get_compound_n_members(segment); i < n; ++i) {
 		ir_entity *entity = get_compound_member(segment, i);
@@ -101,46 +357,89 @@ static void visit_segment(ir_type *segment)
 		 && !(get_entity_linkage(entity) & IR_LINKAGE_NO_CODEGEN))
 			continue;
 
-		visit_entity(entity);
+		mark_entity(env, entity);
 	}
 }
 
-static void garbage_collect_in_segment(ir_type *segment)
+static bool is_dead_entity(ir_entity const *entity, void *ctx)
 {
-	for (int i = get_compound_n_members(segment); i-- > 0; ) {
+	return !entity_marked((gc_env_t const*)ctx, entity);
+}
+
+static void garbage_collect_in_segment(gc_env_t *env, ir_type *segment)
+{
+	ir_entity **dead = NEW_ARR_F(ir_entity*, 0);
+	for (size_t i = 0, n = get_compound_n_members(segment); i < n; ++i) {
 		ir_entity *entity = get_compound_member(segment, i);
-		if (entity_visited(entity))
+		if (entity_marked(env, entity))
 			continue;
 
 		DB((dbg, LEVEL_1, "  removing entity %+F\n", entity));
+		ARR_APP1(ir_entity*, dead, entity);
+	}
 
-		free_entity(entity);
+	/* unlink all dead members at once, so freeing them needs no search */
+	if (ARR_LEN(dead) > 0) {
+		remove_compound_members_if(segment, is_dead_entity, env);
+		for (size_t i = 0, n = ARR_LEN(dead); i < n; ++i)
+			free_entity(dead[i]);
 	}
+	DEL_ARR_F(dead);
 }
 
-void garbage_collect_entities(void)
+static void garbage_collect_types_env(gc_env_t *env)
+{
+	for (size_t i = get_irp_n_types(); i-- > 0;) {
+		ir_type *type = get_irp_type(i);
+		/* primitive types are shared through their modes */
+		if (rbitset_is_set(env->type_marks, get_type_nr(type))
+		    || is_Primitive_type(type))
+			continue;
+
+		DB((dbg, LEVEL_1, "  removing type %+F\n", type));
+		free_type(type);
+	}
+}
+
+static void garbage_collect(bool collect_types)
 {
 	FIRM_DBG_REGISTER(dbg, "firm.opt.garbagecollect");
 
-	/* start a type walk for all externally visible entities */
-	irp_reserve_resources(irp, IRP_RESOURCE_TYPE_VISITED);
-	inc_master_type_visited();
+	gc_env_t env;
+	env.n_nrs                  = irp->max_node_nr;
+	env.entity_marks           = rbitset_malloc(env.n_nrs);
+	env.type_marks             = collect_types ? rbitset_malloc(env.n_nrs) : NULL;
+	env.entity_queue           = NEW_ARR_F(ir_entity*, 0);
+	env.type_queue             = NEW_ARR_F(ir_type*, 0);
+	env.graphs                 = NEW_ARR_F(ir_graph*, 0);
+	env.refs.entities          = NEW_ARR_F(ir_entity*, 0);
+	env.refs.types             = NEW_ARR_F(ir_type*, 0);
+	env.refs.collect_types     = collect_types;
+
 	inc_max_irg_visited();
 
+	/* start with all externally visible entities */
 	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
 		ir_type *type = get_segment_type(s);
-		mark_type_visited(type);
+		mark_type(&env, type);
 
-		visit_segment(type);
+		visit_segment(&env, type);
 	}
+	mark_type(&env, irp->code_type);
+	mark_type(&env, irp->unknown_type);
+	mark_type(&env, irp->dummy_owner);
+	mark_type(&env, irp->byte_type);
+	mark_type(&env, get_irg_frame_type(get_const_code_irg()));
+
+	mark_reachable(&env);
 
 	/* remove graphs of non-visited functions
-	 * (we have to count backwards, because freeing the graph moves the last
-	 *  graph in the list to the free position) */
+	 * (removing a graph leaves a gap in the list, which is closed once
+	 *  for all removed graphs) */
 	foreach_irp_irg_r(i, irg) {
 		ir_entity *entity = get_irg_entity(irg);
 
-		if (entity_visited(entity))
+		if (entity_marked(&env, entity))
 			continue;
 
 		DB((dbg, LEVEL_1, "  freeing method %+F\n", entity));
@@ -150,7 +449,28 @@ void garbage_collect_entities(void)
 	/* we can now remove all non-visited (global) entities */
 	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
 		ir_type *type = get_segment_type(s);
-		garbage_collect_in_segment(type);
+		garbage_collect_in_segment(&env, type);
 	}
-	irp_free_resources(irp, IRP_RESOURCE_TYPE_VISITED);
+
+	/* and finally all types no longer referenced */
+	if (collect_types)
+		garbage_collect_types_env(&env);
+
+	DEL_ARR_F(env.refs.types);
+	DEL_ARR_F(env.refs.entities);
+	DEL_ARR_F(env.graphs);
+	DEL_ARR_F(env.type_queue);
+	DEL_ARR_F(env.entity_queue);
+	xfree(env.type_marks);
+	xfree(env.entity_marks);
+}
+
+void garbage_collect_entities(void)
+{
+	garbage_collect(false);
+}
+
+void garbage_collect_types(void)
+{
+	garbage_collect(true);
 }
@@ -26,6 +26,7 @@
 #include "tv_t.h"
 #include "valueset.h"
 #include "irloop.h"
+#include "statev_t.h"
 
 #include "irgraph_t.h"
 #include "irnode_t.h"
@@ -35,6 +36,12 @@
 #define MAX_ANTIC_ITER 10
 #define MAX_INSERT_ITER 3
 
+/* Budget per function: Functions with more blocks or more anticipated values
+   (summed over all blocks) only get the cheaper GVN, i.e. the elimination of
+   fully redundant values. */
+#define MAX_BLOCKS       10000
+#define MAX_ANTIC_VALUES 1000000
+
 /* Stops antic iteration from processing endless loops. */
 #define IGNORE_INF_LOOPS 1
 /* Stops antic information to flow over infinite loop backedge */
@@ -100,9 +107,12 @@ typedef struct pre_env {
 	char            changes;      /* flag for fixed point iterations - non-zero if changes occurred */
 	char            first_iter;   /* non-zero for first fixed point iteration */
 	int             iteration;    /* iteration counter */
+	unsigned        n_blocks;     /* number of blocks */
+	size_t          n_antic;      /* number of values in all antic_in sets */
+	bool            gvn_only;     /* set if the budget is exceeded */
 #if OPTIMIZE_NODES
-	pset           *value_table;   /* standard value table*/
-	pset           *gvnpre_values; /* GVN-PRE value table */
+	ir_valuetable_t *value_table;   /* standard value table*/
+	ir_valuetable_t *gvnpre_values; /* GVN-PRE value table */
 #endif
 } pre_env;
 
@@ -143,7 +153,7 @@ static void init_stats(void)
 
 static void free_stats(void)
 {
-	free(gvnpre_stats);
+	xfree(gvnpre_stats);
 	gvnpre_stats = NULL;
 }
 
@@ -227,10 +237,8 @@ static void dump_all_expgen_sets(block_info *list)
  * Compares node collisions in value table.
  * Modified identities_cmp().
  */
-static int compare_gvn_identities(const void *elt, const void *key)
+static int compare_gvn_identities(const ir_node *a, const ir_node *b)
 {
-	ir_node *a = (ir_node *)elt;
-	ir_node *b = (ir_node *)key;
 	int i, irn_arity_a;
 
 	if (a == b) return 0;
@@ -353,7 +361,7 @@ static ir_node *remember(ir_node *irn)
 	} else {
 		value = identify_remember(irn);
 	}
-	free(in);
+	xfree(in);
 
 	DB((dbg, LEVEL_4, "Remember %+F as value %+F\n", irn, value));
 	ir_nodehashmap_insert(&value_map, irn, value);
@@ -404,6 +412,7 @@ static void alloc_block_info(ir_node *block, pre_env *env)
 
 	info->next = env->list;
 	env->list  = info;
+	++env->n_blocks;
 }
 
 static void free_block_info(block_info *block_info)
@@ -411,9 +420,10 @@ static void free_block_info(block_info *block_info)
 	ir_valueset_del(block_info->exp_gen);
 	ir_valueset_del(block_info->avail_out);
 	ir_valueset_del(block_info->antic_in);
+	ir_valueset_del(block_info->antic_done);
 	if (block_info->trans) {
 		ir_nodehashmap_destroy(block_info->trans);
-		free(block_info->trans);
+		xfree(block_info->trans);
 	}
 	if (block_info->new_set)
 		ir_valueset_del(block_info->new_set);
@@ -911,7 +921,7 @@ static void compute_antic(ir_node *block, void *ctx)
 		return;
 
 	/* the end block has no successor */
-	if (block == env->end_block)
+	if (block == env->end_block || env->gvn_only)
 		return;
 
 	info = get_block_info(block);
@@ -1007,8 +1017,16 @@ static void compute_antic(ir_node *block, void *ctx)
 
 	DEBUG_ONLY(dump_value_set(info->antic_in, "Antic_in", block);)
 
-	if (size != ir_valueset_size(info->antic_in))
+	size_t const new_size = ir_valueset_size(info->antic_in);
+	if (size != new_size) {
 		env->changes |= 1;
+		env->n_antic += new_size - size;
+		if (env->n_antic > MAX_ANTIC_VALUES) {
+			DB((dbg, LEVEL_1, "Budget of antic values exceeded, doing GVN only\n"));
+			stat_ev_int("gvn_pre_degraded_antic_values", env->n_antic);
+			env->gvn_only = true;
+		}
+	}
 }
 
 /* --------------------------------------------------------
@@ -1440,7 +1458,7 @@ static void insert_nodes_walker(ir_node *block, void *ctx)
 				   They have anti leaders as predecessors, not leaders!
 				   So we have to create a new node using leaders. */
 				trans = new_similar_node(expr, target_block, in);
-				free(in);
+				xfree(in);
 
 				/* value is now available in target block through trans
 				   insert (not replace) because it has not been available */
@@ -1474,7 +1492,7 @@ static void insert_nodes_walker(ir_node *block, void *ctx)
 			ir_valueset_replace(info->avail_out, value, phi);
 			ir_valueset_insert(info->new_set, value, phi);
 		}
-		free(phi_in);
+		xfree(phi_in);
 
 		/* already optimized this value in this block */
 		ir_valueset_insert(info->antic_done, value, expr);
@@ -1660,7 +1678,7 @@ static void hoist_high(ir_node *block, void *ctx)
 					in[i] = avail_pred;
 				}
 				ir_node *const nn = new_similar_node(avail, new_target, in);
-				free(in);
+				xfree(in);
 
 				identify_or_remember(nn);
 				/* TODO Nodes are inserted into a dominating block and should
@@ -1790,6 +1808,17 @@ static void gvn_pre(ir_graph *irg, pre_env *env)
 
 	/* compute the avail_out sets for all blocks */
 	dom_tree_walk_irg(irg, compute_avail_top_down, NULL, env);
+	ir_nodeset_init(env->keeps);
+
+	/* the antic sets hold up to all values in every block */
+	if (env->n_blocks > MAX_BLOCKS
+	    || !ir_complexity_allows(irg, "gvn_pre",
+	                             get_irg_complexity(irg, IR_COMPLEXITY_NODES_BLOCKS))) {
+		DB((dbg, LEVEL_1, "Budget of blocks exceeded, doing GVN only\n"));
+		stat_ev_int("gvn_pre_degraded_blocks", env->n_blocks);
+		env->gvn_only = true;
+		goto elimination;
+	}
 
 	/* compute the anticipated value sets for all blocks */
 	antic_iter      = 0;
@@ -1805,11 +1834,16 @@ static void gvn_pre(ir_graph *irg, pre_env *env)
 		env->first_iter = 0;
 		DB((dbg, LEVEL_2, "----------------------------------------------\n"));
 		env->iteration ++;
-	} while (env->changes != 0 && antic_iter < MAX_ANTIC_ITER);
+	} while (env->changes != 0 && antic_iter < MAX_ANTIC_ITER
+	         && !env->gvn_only);
 
 	DEBUG_ONLY(set_stats(gvnpre_stats->antic_iterations, antic_iter);)
+	stat_ev_int("gvn_pre_antic_iterations", antic_iter);
+	if (env->changes != 0 && !env->gvn_only)
+		stat_ev_int("gvn_pre_antic_iterations_exceeded", antic_iter);
+	if (env->gvn_only)
+		goto elimination;
 
-	ir_nodeset_init(env->keeps);
 	insert_iter       = 0;
 	env->first_iter   = 1;
 	/* compute redundant expressions */
@@ -1832,6 +1866,7 @@ static void gvn_pre(ir_graph *irg, pre_env *env)
 	dom_tree_walk_irg(irg, update_new_set_walker, NULL, env);
 #endif
 
+elimination:
 	/* Deactivate edges to prevent intelligent removal of nodes,
 	   or else we will get deleted nodes which we try to exchange. */
 	edges_deactivate(environment->graph);
@@ -1887,6 +1922,9 @@ void do_gvn_pre(ir_graph *irg)
 	env.pairs        = NULL;
 	env.keeps        = &keeps;
 	env.last_idx     = get_irg_last_idx(irg);
+	env.n_blocks     = 0;
+	env.n_antic      = 0;
+	env.gvn_only     = false;
 	obstack_init(&env.obst);
 
 	/* Detect and set links of infinite loops to non-zero. */
@@ -1904,9 +1942,9 @@ void do_gvn_pre(ir_graph *irg)
 	set_opt_global_cse(1);
 	/* new_identities() */
 	if (irg->value_table != NULL)
-		del_pset(irg->value_table);
-	/* initially assumed nodes in pset are 512 */
-	irg->value_table = new_pset(compare_gvn_identities, 512);
+		ir_valuetable_del(irg->value_table);
+	/* initially assumed nodes in value table are 512 */
+	irg->value_table = ir_valuetable_new(compare_gvn_identities, 512);
 #if OPTIMIZE_NODES
 	env.gvnpre_values = irg->value_table;
 #endif
@@ -1933,7 +1971,7 @@ void do_gvn_pre(ir_graph *irg)
 
 #if OPTIMIZE_NODES
 	irg->value_table = env.value_table;
-	del_pset(irg->value_table);
+	ir_valuetable_del(irg->value_table);
 	irg->value_table = env.gvnpre_values;
 #endif
 
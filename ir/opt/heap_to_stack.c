@@ -0,0 +1,368 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Promotion of non-escaping heap allocations to the stack frame.
+ *
+ * A malloc call with a small constant size whose result is only used as the
+ * address of Loads and Stores, compared, or passed to free is replaced by a
+ * frame entity and its free calls are removed.  The pointer cannot survive
+ * the function, and since it does not flow through a Phi, the objects of
+ * different executions of the call are never live at the same time, so a
+ * single entity suffices even in loops.
+ *
+ * If all accesses use constant, non-overlapping offsets, the entity gets a
+ * struct type with one member per accessed location and the accesses are
+ * rewritten to select these members, so scalar replacement can turn the
+ * allocation into plain values.
+ */
+#include "iroptimize.h"
+
+#include "array.h"
+#include "debug.h"
+#include "ircons.h"
+#include "iredges_t.h"
+#include "irgmod.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "tv.h"
+#include "type_t.h"
+#include "util.h"
+#include "xmalloc.h"
+
+/** Maximal size of a promoted allocation in bytes. */
+#define MAX_ALLOC_SIZE   1024
+/** Maximal number of bytes promoted allocations may add to a frame. */
+#define MAX_FRAME_GROWTH 4096
+/** Alignment guaranteed by malloc. */
+#define MALLOC_ALIGNMENT 16
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** A Load or Store of an allocated object. */
+typedef struct access_t {
+	ir_node   *node;   /**< the Load or Store */
+	ir_mode   *mode;   /**< the mode of the accessed value */
+	long       offset; /**< offset from the start of the object */
+	bool       known;  /**< whether the offset is a constant */
+	ir_entity *member; /**< the struct member of the accessed location */
+} access_t;
+
+/** A promotion candidate. */
+typedef struct alloc_info_t {
+	ir_node   *call;     /**< the malloc Call */
+	ir_node   *result;   /**< the returned pointer */
+	long       size;     /**< the allocation size */
+	access_t  *accesses; /**< the Loads and Stores of the object */
+	ir_node  **frees;    /**< the free Calls of the object */
+} alloc_info_t;
+
+/**
+ * Returns whether @p call calls the external function @p name with
+ * @p n_params parameters.
+ */
+static bool is_call_to(const ir_node *call, const char *name, int n_params)
+{
+	ir_entity *const callee = get_Call_callee(call);
+	if (callee == NULL || get_Call_n_params(call) != n_params)
+		return false;
+	ir_type *const mtp = get_entity_type(callee);
+	return get_method_n_params(mtp) == (size_t)n_params
+	    && streq(get_entity_ld_name(callee), name);
+}
+
+/** Returns the projection @p pn of the tuple @p node or NULL. */
+static ir_node *find_proj(const ir_node *node, unsigned pn)
+{
+	foreach_out_edge(node, edge) {
+		ir_node *const proj = get_edge_src_irn(edge);
+		if (is_Proj(proj) && get_Proj_num(proj) == pn)
+			return proj;
+	}
+	return NULL;
+}
+
+static void collect_mallocs(ir_node *node, void *data)
+{
+	if (!is_Call(node) || !is_call_to(node, "malloc", 1))
+		return;
+	ir_node *const size = get_Call_param(node, 0);
+	if (!is_Const(size) || !tarval_is_long(get_Const_tarval(size)))
+		return;
+	long const bytes = get_Const_long(size);
+	if (bytes <= 0 || bytes > MAX_ALLOC_SIZE)
+		return;
+	ir_node *const ress = find_proj(node, pn_Call_T_result);
+	if (ress == NULL)
+		return;
+	ir_node *const result = find_proj(ress, 0);
+	if (result == NULL || !mode_is_reference(get_irn_mode(result)))
+		return;
+
+	alloc_info_t ***const allocs = (alloc_info_t***)data;
+	alloc_info_t   *const info   = XMALLOCZ(alloc_info_t);
+	info->call   = node;
+	info->result = result;
+	info->size   = bytes;
+	ARR_APP1(alloc_info_t*, *allocs, info);
+}
+
+static void add_access(alloc_info_t *info, ir_node *node, ir_mode *mode,
+                       long offset, bool known)
+{
+	access_t const access = {
+		.node   = node,
+		.mode   = mode,
+		.offset = offset,
+		.known  = known,
+	};
+	ARR_APP1(access_t, info->accesses, access);
+}
+
+/**
+ * Collects the uses of the pointer @p ptr into the object of @p info, which
+ * is @p offset bytes from its start if @p known.
+ *
+ * @return false if the pointer escapes
+ */
+static bool collect_uses(alloc_info_t *info, ir_node *ptr, long offset,
+                         bool known)
+{
+	foreach_out_edge(ptr, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		int      const pos  = get_edge_src_pos(edge);
+		switch (get_irn_opcode(user)) {
+		case iro_Load:
+			if (get_Load_volatility(user) == volatility_is_volatile)
+				return false;
+			add_access(info, user, get_Load_mode(user), offset, known);
+			break;
+
+		case iro_Store:
+			/* storing the pointer itself lets it escape */
+			if (pos != n_Store_ptr
+			    || get_Store_volatility(user) == volatility_is_volatile)
+				return false;
+			add_access(info, user, get_irn_mode(get_Store_value(user)),
+			           offset, known);
+			break;
+
+		case iro_Cmp:
+			break;
+
+		case iro_Confirm:
+			if (pos != n_Confirm_value
+			    || !collect_uses(info, user, offset, known))
+				return false;
+			break;
+
+		case iro_Add:
+		case iro_Sub: {
+			if (!mode_is_reference(get_irn_mode(user))
+			    || (is_Sub(user) && pos != n_Sub_left))
+				return false;
+			ir_node *const other = get_irn_n(user, 1 - pos);
+			bool     const is_const
+				= is_Const(other) && tarval_is_long(get_Const_tarval(other));
+			long     const delta = is_const ? get_Const_long(other) : 0;
+			long     const sum   = is_Add(user) ? offset + delta : offset - delta;
+			if (!collect_uses(info, user, sum, known && is_const))
+				return false;
+			break;
+		}
+
+		case iro_Member: {
+			ir_entity *const entity = get_Member_entity(user);
+			if (!collect_uses(info, user, offset + get_entity_offset(entity),
+			                  known))
+				return false;
+			break;
+		}
+
+		case iro_Sel: {
+			ir_node *const index    = get_Sel_index(user);
+			bool     const is_const
+				= is_Const(index) && tarval_is_long(get_Const_tarval(index));
+			ir_type *const elem     = get_array_element_type(get_Sel_type(user));
+			long     const elem_off = is_const
+				? get_Const_long(index) * (long)get_type_size(elem) : 0;
+			if (pos != n_Sel_ptr
+			    || !collect_uses(info, user, offset + elem_off,
+			                     known && is_const))
+				return false;
+			break;
+		}
+
+		case iro_Call:
+			if (!known || offset != 0 || pos == n_Call_ptr
+			    || !is_call_to(user, "free", 1))
+				return false;
+			ARR_APP1(ir_node*, info->frees, user);
+			break;
+
+		default:
+			/* Phi, Return, Call argument, ... */
+			return false;
+		}
+	}
+	return true;
+}
+
+static int cmp_access(const void *a, const void *b)
+{
+	access_t const *const aa = (access_t const*)a;
+	access_t const *const ab = (access_t const*)b;
+	if (aa->offset != ab->offset)
+		return QSORT_CMP(aa->offset, ab->offset);
+	return QSORT_CMP(get_mode_size_bytes(aa->mode),
+	                 get_mode_size_bytes(ab->mode));
+}
+
+/**
+ * Creates a struct type with a member for each location accessed in
+ * @p info, or returns NULL if the accesses use unknown or overlapping
+ * offsets.
+ */
+static ir_type *create_struct_type(alloc_info_t *info)
+{
+	size_t const n_accesses = ARR_LEN(info->accesses);
+	for (size_t i = 0; i < n_accesses; ++i) {
+		access_t const *const access = &info->accesses[i];
+		if (!access->known || access->offset < 0
+		    || access->offset + (long)get_mode_size_bytes(access->mode)
+		       > info->size)
+			return NULL;
+	}
+	QSORT_ARR(info->accesses, cmp_access);
+
+	for (size_t i = 1; i < n_accesses; ++i) {
+		access_t const *const prev = &info->accesses[i - 1];
+		access_t const *const curr = &info->accesses[i];
+		if (curr->offset == prev->offset && curr->mode == prev->mode)
+			continue;
+		if (curr->offset < prev->offset + (long)get_mode_size_bytes(prev->mode))
+			return NULL;
+	}
+
+	ir_type *const type = new_type_struct(id_unique("heap_object.%u"));
+	for (size_t i = 0; i < n_accesses; ++i) {
+		access_t       *const access = &info->accesses[i];
+		access_t const *const prev   = i > 0 ? &info->accesses[i - 1] : NULL;
+		if (prev != NULL && access->offset == prev->offset
+		    && access->mode == prev->mode) {
+			access->member = prev->member;
+			continue;
+		}
+		ir_type *const member_type = get_type_for_mode(access->mode);
+		access->member = new_entity(type, id_unique("m.%u"), member_type);
+		set_entity_offset(access->member, access->offset);
+	}
+	return type;
+}
+
+static ir_type *create_byte_array_type(long size)
+{
+	ir_type *const type = new_type_array(get_type_for_mode(mode_Bu));
+	set_array_size_int(type, size);
+	return type;
+}
+
+/** Replaces the Call @p call by the memory before it. */
+static void remove_call(ir_node *call, ir_node *result)
+{
+	ir_graph *const irg   = get_irn_irg(call);
+	ir_node  *const block = get_nodes_block(call);
+	ir_node  *const ress  = result != NULL
+		? new_r_Tuple(block, 1, &result) : new_r_Tuple(block, 0, NULL);
+	ir_node *in[pn_Call_max + 1] = {
+		[pn_Call_M]        = get_Call_mem(call),
+		[pn_Call_T_result] = ress,
+	};
+	int n_in = 2;
+	if (ir_throws_exception(call)) {
+		in[pn_Call_X_regular] = new_r_Jmp(block);
+		in[pn_Call_X_except]  = new_r_Bad(irg, mode_X);
+		n_in = 4;
+	}
+	turn_into_tuple(call, n_in, in);
+}
+
+static void promote(alloc_info_t *info)
+{
+	ir_graph *const irg   = get_irn_irg(info->call);
+	ir_node  *const start = get_irg_start_block(irg);
+	ir_type  *const frame = get_irg_frame_type(irg);
+
+	ir_type *type = create_struct_type(info);
+	if (type == NULL)
+		type = create_byte_array_type(info->size);
+	set_type_size(type, info->size);
+	set_type_alignment(type, MALLOC_ALIGNMENT);
+	set_type_state(type, layout_fixed);
+
+	ir_entity *const entity = new_entity(frame, id_unique("heap_object.%u"),
+	                                     type);
+	ir_node   *const object = new_r_Member(start, get_irg_frame(irg), entity);
+	DB((dbg, LEVEL_1, "promoting %+F in %+F to %+F\n", info->call, irg,
+	    entity));
+
+	if (is_Struct_type(type)) {
+		for (size_t i = 0, n = ARR_LEN(info->accesses); i < n; ++i) {
+			access_t const *const access = &info->accesses[i];
+			ir_node *const addr
+				= new_r_Member(start, object, access->member);
+			if (is_Load(access->node)) {
+				set_Load_ptr(access->node, addr);
+			} else {
+				set_Store_ptr(access->node, addr);
+			}
+		}
+	}
+
+	exchange(info->result, object);
+	remove_call(info->call, object);
+	for (size_t i = 0, n = ARR_LEN(info->frees); i < n; ++i) {
+		remove_call(info->frees[i], NULL);
+	}
+}
+
+void opt_heap_to_stack(ir_graph *irg)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.heap_to_stack");
+
+	ir_type *const frame = get_irg_frame_type(irg);
+	if (get_type_state(frame) == layout_fixed)
+		return;
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
+
+	alloc_info_t **allocs = NEW_ARR_F(alloc_info_t*, 0);
+	irg_walk_graph(irg, NULL, collect_mallocs, &allocs);
+
+	long grown   = 0;
+	bool changed = false;
+	for (size_t i = 0, n = ARR_LEN(allocs); i < n; ++i) {
+		alloc_info_t *const info = allocs[i];
+		info->accesses = NEW_ARR_F(access_t, 0);
+		info->frees    = NEW_ARR_F(ir_node*, 0);
+		if (grown + info->size <= MAX_FRAME_GROWTH
+		    && collect_uses(info, info->result, 0, true)) {
+			promote(info);
+			grown  += info->size;
+			changed = true;
+		}
+		DEL_ARR_F(info->frees);
+		DEL_ARR_F(info->accesses);
+		xfree(info);
+	}
+	DEL_ARR_F(allocs);
+
+	confirm_irg_properties(irg, changed ? IR_GRAPH_PROPERTIES_NONE
+	                                    : IR_GRAPH_PROPERTIES_ALL);
+	if (changed)
+		scalar_replacement_opt(irg);
+}
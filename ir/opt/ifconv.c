@@ -16,18 +16,28 @@
 #include "cdep_t.h"
 #include "debug.h"
 #include "ircons.h"
+#include "iredges_t.h"
 #include "irgmod.h"
 #include "irgopt.h"
 #include "irgwalk.h"
 #include "irnode_t.h"
+#include "iropt_t.h"
 #include "iroptimize.h"
+#include "irprofile.h"
 #include "irtools.h"
+#include "util.h"
+
+/** Probability of the predicted successor of a Cond with a jump prediction. */
+#define PREDICTED_PROBABILITY 0.9
 
 /**
  * Environment for if-conversion.
  */
 typedef struct walker_env {
 	arch_allow_ifconv_func allow_ifconv;
+	unsigned               mispredict_penalty; /**< Cycles lost by a
+	                                                mispredicted branch. */
+	unsigned               mux_latency;        /**< Latency of a Mux. */
 	bool                   changed; /**< Set if the graph was changed. */
 } walker_env;
 
@@ -86,6 +96,98 @@ static ir_node *walk_to_projx(ir_node *start, const ir_node *dependency)
 }
 
 
+/**
+ * Returns the number of operations in a block, which are executed
+ * unconditionally after if-conversion.
+ */
+static unsigned get_block_size(const ir_node *block)
+{
+	unsigned size = 0;
+	foreach_out_edge(block, edge) {
+		const ir_node *node = get_edge_src_irn(edge);
+		if (!is_Phi(node) && !is_Proj(node) && !is_cfop(node))
+			++size;
+	}
+	return size;
+}
+
+/**
+ * Returns the number of operations on the path from @p dependency to
+ * @p start, which walk_to_projx() found.
+ */
+static unsigned get_path_size(ir_node *start, const ir_node *dependency)
+{
+	unsigned size = get_block_size(start);
+	foreach_irn_in(start, i, pred) {
+		ir_node *pred_block = get_nodes_block(skip_Proj(pred));
+		if (pred_block == dependency)
+			break;
+		if (is_cdep_on(pred_block, dependency))
+			return size + get_path_size(pred_block, dependency);
+	}
+	return size;
+}
+
+/**
+ * Determines the probability that the control flow reaches @p block from
+ * predecessor @p i rather than from predecessor @p j, using the profile or
+ * the jump prediction of @p cond.
+ *
+ * @return false if the probability is unknown
+ */
+static bool get_path_probability(ir_node *block, int i, int j,
+                                 const ir_node *cond, bool negated,
+                                 double *probability)
+{
+	uint32_t count_i;
+	uint32_t count_j;
+	if (ir_profile_find_edge_execcount(block, i, &count_i)
+	    && ir_profile_find_edge_execcount(block, j, &count_j)) {
+		if (count_i == 0 && count_j == 0)
+			return false;
+		*probability = count_i / ((double)count_i + count_j);
+		return true;
+	}
+
+	cond_jmp_predicate const pred = get_Cond_jmp_pred(cond);
+	if (pred == COND_JMP_PRED_NONE)
+		return false;
+	bool predicted_i = (pred == COND_JMP_PRED_TRUE) != negated;
+	*probability = predicted_i ? PREDICTED_PROBABILITY
+	                           : 1.0 - PREDICTED_PROBABILITY;
+	return true;
+}
+
+/**
+ * Weighs the cost of executing both paths into @p block and @p n_muxes Muxes
+ * against the expected cost of the branch: a mispredicted branch costs the
+ * backend penalty, and the less likely path is mispredicted as often as it is
+ * taken. So highly biased branches stay branches.
+ */
+static bool is_ifconv_profitable(const walker_env *env, ir_node *block,
+                                 int i, int j, const ir_node *cond,
+                                 const ir_node *dependency, bool negated,
+                                 unsigned n_muxes)
+{
+	if (env->mispredict_penalty == 0)
+		return true;
+	double p_i;
+	if (!get_path_probability(block, i, j, cond, negated, &p_i))
+		return true;
+
+	double size_i    = get_path_size(get_Block_cfgpred_block(block, i),
+	                                 dependency);
+	double size_j    = get_path_size(get_Block_cfgpred_block(block, j),
+	                                 dependency);
+	double p_miss    = MIN(p_i, 1.0 - p_i);
+	double branch    = p_miss * env->mispredict_penalty
+	                 + p_i * size_i + (1.0 - p_i) * size_j;
+	double converted = size_i + size_j + n_muxes * env->mux_latency;
+	DB((dbg, LEVEL_2, "Cond %+F: probability %.2f, branch cost %.2f, Mux cost %.2f\n",
+	    cond, p_i, branch, converted));
+	return converted <= branch;
+}
+
 /**
  * Recursively copies the DAG starting at node to the i-th predecessor
  * block of src_block
@@ -294,6 +396,7 @@ restart:;
 				ir_node *phi       = get_Block_phis(block);
 				bool     supported = true;
 				bool     negated   = get_Proj_num(projx0) == pn_Cond_false;
+				unsigned n_muxes   = 0;
 				for (ir_node *p = phi; p != NULL; p = get_Phi_next(p)) {
 					ir_node *mux_false;
 					ir_node *mux_true;
@@ -312,8 +415,12 @@ restart:;
 						supported = false;
 						break;
 					}
+					if (!ir_is_optimizable_mux(sel, mux_false, mux_true))
+						++n_muxes;
 				}
-				if (!supported)
+				if (!supported
+				    || !is_ifconv_profitable(env, block, i, j, cond,
+				                             dependency, negated, n_muxes))
 					continue;
 
 				DB((dbg, LEVEL_1, "Found Cond %+F with proj %+F and %+F\n",
@@ -433,14 +540,21 @@ static void fill_waitq(ir_node *node, void *env) {
 
 void opt_if_conv_cb(ir_graph *irg, arch_allow_ifconv_func callback)
 {
-	walker_env  env   = { .allow_ifconv = callback, .changed = false };
-	pdeq       *waitq = new_pdeq();
+	const backend_params *be_params = be_get_backend_param();
+	walker_env env = {
+		.allow_ifconv       = callback,
+		.mispredict_penalty = be_params->branch_mispredict_penalty,
+		.mux_latency        = be_params->mux_latency,
+		.changed            = false,
+	};
+	pdeq *waitq = new_pdeq();
 
 	assure_irg_properties(irg,
 		IR_GRAPH_PROPERTY_NO_CRITICAL_EDGES
 		| IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE
 		| IR_GRAPH_PROPERTY_NO_BADS
-		| IR_GRAPH_PROPERTY_ONE_RETURN);
+		| IR_GRAPH_PROPERTY_ONE_RETURN
+		| IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
 
 	FIRM_DBG_REGISTER(dbg, "firm.opt.ifconv");
 
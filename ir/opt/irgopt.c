@@ -10,6 +10,7 @@
  *           Michael Beck
  */
 #include <assert.h>
+#include <string.h>
 
 #include "irnode_t.h"
 #include "irgraph_t.h"
@@ -22,7 +23,11 @@
 #include "irgwalk.h"
 #include "ircons.h"
 
-#include "adt/pdeq.h"
+#include "array.h"
+#include "pqueue.h"
+#include "raw_bitset.h"
+#include "statev_t.h"
+#include "util.h"
 
 #include "irflag_t.h"
 #include "iredges_t.h"
@@ -57,25 +62,89 @@ void local_optimize_node(ir_node *n)
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
 }
 
+/**
+ * Worklist of optimize_graph_df().  Every node is queued at most once and the
+ * queued nodes are processed in the postorder of a walk along the operand
+ * edges, so operands are optimized before their users.  The pqueue returns
+ * the highest priority first, so nodes are queued with their negated
+ * postorder number.
+ */
+typedef struct worklist_t {
+	pqueue_t *queue;
+	unsigned *order;      /**< ARR_F: postorder number by node index */
+	unsigned *queued;     /**< ARR_F raw bitset: queued nodes by node index */
+	unsigned  n_order;    /**< number of nodes with a postorder number */
+	unsigned  n_processed;
+	unsigned  n_changed;
+} worklist_t;
+
+/** Makes room for the node indices of nodes created since the last call. */
+static void worklist_grow(worklist_t *wl, unsigned idx)
+{
+	size_t const old_len = ARR_LEN(wl->order);
+	if (idx < old_len)
+		return;
+	size_t const new_len = MAX(idx + 1, old_len * 2);
+	ARR_RESIZE(unsigned, wl->order, new_len);
+	memset(&wl->order[old_len], 0, (new_len - old_len) * sizeof(unsigned));
+
+	size_t const old_elems = ARR_LEN(wl->queued);
+	size_t const new_elems = BITSET_SIZE_ELEMS(new_len);
+	ARR_RESIZE(unsigned, wl->queued, new_elems);
+	memset(&wl->queued[old_elems], 0, (new_elems - old_elems) * sizeof(unsigned));
+}
+
+static void worklist_init(worklist_t *wl, ir_graph *irg)
+{
+	unsigned const n = get_irg_last_idx(irg);
+	wl->queue       = new_pqueue();
+	wl->order       = NEW_ARR_FZ(unsigned, n);
+	wl->queued      = NEW_ARR_FZ(unsigned, BITSET_SIZE_ELEMS(n));
+	wl->n_order     = 0;
+	wl->n_processed = 0;
+	wl->n_changed   = 0;
+}
+
+static void worklist_free(worklist_t *wl)
+{
+	del_pqueue(wl->queue);
+	DEL_ARR_F(wl->order);
+	DEL_ARR_F(wl->queued);
+}
+
 static void enqueue_node(ir_node *node, void *env)
 {
-	pdeq *waitq = (pdeq *)env;
-	if (get_irn_link(node) == waitq)
+	worklist_t    *wl  = (worklist_t*)env;
+	unsigned const idx = get_irn_idx(node);
+	worklist_grow(wl, idx);
+	if (rbitset_is_set(wl->queued, idx))
 		return;
-	pdeq_putr(waitq, node);
-	set_irn_link(node, waitq);
+	rbitset_set(wl->queued, idx);
+
+	/* nodes created during the optimization are numbered when they are first
+	 * queued, i.e. after all nodes of the initial graph */
+	if (wl->order[idx] == 0)
+		wl->order[idx] = ++wl->n_order;
+	pqueue_put(wl->queue, node, -(int)wl->order[idx]);
+}
+
+static ir_node *dequeue_node(worklist_t *wl)
+{
+	ir_node *node = (ir_node*)pqueue_pop_front(wl->queue);
+	rbitset_clear(wl->queued, get_irn_idx(node));
+	return node;
 }
 
 /**
  * Enqueue all users of a node to a wait queue.
  * Handles mode_T nodes.
  */
-static void enqueue_users(ir_node *n, pdeq *waitq)
+static void enqueue_users(ir_node *n, worklist_t *wl)
 {
 	foreach_out_edge(n, edge) {
 		ir_node *succ  = get_edge_src_irn(edge);
 
-		enqueue_node(succ, waitq);
+		enqueue_node(succ, wl);
 
 		/* Also enqueue Phis to prevent inconsistencies. */
 		if (is_Block(succ)) {
@@ -83,13 +152,13 @@ static void enqueue_users(ir_node *n, pdeq *waitq)
 				ir_node *succ2 = get_edge_src_irn(edge2);
 
 				if (is_Phi(succ2)) {
-					enqueue_node(succ2, waitq);
+					enqueue_node(succ2, wl);
 				}
 			}
 		} else if (get_irn_mode(succ) == mode_T) {
 		/* A mode_T node has Proj's. Because most optimizations
 			run on the Proj's we have to enqueue them also. */
-			enqueue_users(succ, waitq);
+			enqueue_users(succ, wl);
 		}
 	}
 }
@@ -99,7 +168,7 @@ static void enqueue_users(ir_node *n, pdeq *waitq)
  */
 static void find_unreachable_blocks(ir_node *block, void *env)
 {
-	pdeq *waitq = (pdeq*) env;
+	worklist_t *wl = (worklist_t*)env;
 
 	if (get_Block_dom_depth(block) < 0) {
 		ir_graph *irg = get_irn_irg(block);
@@ -107,14 +176,14 @@ static void find_unreachable_blocks(ir_node *block, void *env)
 
 		foreach_block_succ(block, edge) {
 			ir_node *succ_block = get_edge_src_irn(edge);
-			enqueue_node(succ_block, waitq);
+			enqueue_node(succ_block, wl);
 			foreach_out_edge(succ_block, edge2) {
 				ir_node *succ = get_edge_src_irn(edge2);
 				if (is_Phi(succ))
-					enqueue_node(succ, waitq);
+					enqueue_node(succ, wl);
 			}
 		}
-		enqueue_node(end, waitq);
+		enqueue_node(end, wl);
 	}
 }
 
@@ -128,10 +197,9 @@ void local_optimize_graph(ir_graph *irg)
  * Optimizes all nodes and enqueue its users
  * if done.
  */
-static void opt_walker(ir_node *n, void *env)
+static void opt_walker(ir_node *n, worklist_t *wl)
 {
-	pdeq *waitq = (pdeq *)env;
-	set_irn_link(n, NULL);
+	++wl->n_processed;
 
 	/* If CSE occurs during the optimization,
 	 * our operands have fewer users than before.
@@ -145,16 +213,16 @@ static void opt_walker(ir_node *n, void *env)
 		optimized = optimize_in_place_2(last);
 
 		if (optimized != last) {
-			enqueue_users(last, waitq);
+			enqueue_users(last, wl);
 			exchange(last, optimized);
 		}
 	} while (optimized != last);
+	if (optimized != n)
+		++wl->n_changed;
 }
 
 void optimize_graph_df(ir_graph *irg)
 {
-	pdeq *waitq = new_pdeq();
-
 	if (get_opt_global_cse())
 		set_irg_pinned(irg, op_pin_state_floats);
 
@@ -170,29 +238,31 @@ void optimize_graph_df(ir_graph *irg)
 	new_identities(irg);
 	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
 
-	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
-
 	constbits_analyze(irg);
 
-	irg_walk_graph(irg, NULL, enqueue_node, waitq);
+	/* the post walker numbers the nodes in postorder */
+	worklist_t wl;
+	worklist_init(&wl, irg);
+	irg_walk_graph(irg, NULL, enqueue_node, &wl);
 
 	/* any optimized nodes are stored in the wait queue,
 	 * so if it's not empty, the graph has been changed */
-	while (!pdeq_empty(waitq)) {
+	while (!pqueue_empty(wl.queue)) {
 		/* finish the wait queue */
-		while (! pdeq_empty(waitq)) {
-			ir_node *n = (ir_node*)pdeq_getl(waitq);
-			opt_walker(n, waitq);
+		while (!pqueue_empty(wl.queue)) {
+			ir_node *n = dequeue_node(&wl);
+			opt_walker(n, &wl);
 		}
 		/* Calculate dominance so we can kill unreachable code
 		 * We want this intertwined with localopts for better optimization
 		 * (phase coupling) */
 		compute_doms(irg);
 		assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
-		irg_block_walk_graph(irg, NULL, find_unreachable_blocks, waitq);
+		irg_block_walk_graph(irg, NULL, find_unreachable_blocks, &wl);
 	}
-	del_pdeq(waitq);
-	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	stat_ev_int("optimize_graph_df_nodes_processed", wl.n_processed);
+	stat_ev_int("optimize_graph_df_nodes_changed", wl.n_changed);
+	worklist_free(&wl);
 
 	constbits_clear(irg);
 
@@ -70,6 +70,15 @@ static bool is_Or_Eor_Add(const ir_node *node)
 	return false;
 }
 
+/**
+ * Returns the mode of the lanes of vector mode @p mode or @p mode itself for
+ * scalar modes.
+ */
+static ir_mode *get_lane_mode(ir_mode *mode)
+{
+	return mode_is_vector(mode) ? get_mode_vector_element_mode(mode) : mode;
+}
+
 /** Returns true if using an Add or Eor instead of @p node would produce the
  * same result. */
 static bool is_Eor_Add(const ir_node *node)
@@ -310,11 +319,11 @@ static ir_tarval *computed_value_Add(const ir_node *n)
 		return tarval_add(ta, tb);
 
 	/* x+~x => -1 */
-	if (complement_values(a, b))
-		return get_mode_all_one(get_irn_mode(n));
+	ir_mode *const mode = get_irn_mode(n);
+	if (complement_values(a, b) && !mode_is_float(get_lane_mode(mode)))
+		return get_mode_all_one(mode);
 	/* x + -x => 0 */
 	if (ir_is_negated_value(a, b)) {
-		ir_mode *mode = get_irn_mode(n);
 		if (get_mode_arithmetic(mode) == irma_twos_complement)
 			return get_mode_null(mode);
 	}
@@ -373,7 +382,7 @@ static ir_tarval *computed_value_Mul(const ir_node *n)
 		return tarval_mul(ta, tb);
 
 	/* a * 0 != 0 if a == NaN or a == Inf */
-	if (!mode_is_float(mode)) {
+	if (!mode_is_float(get_lane_mode(mode))) {
 		/* a*0 = 0 or 0*b = 0 */
 		if (tarval_is_null(ta))
 			return ta;
@@ -908,6 +917,19 @@ static ir_tarval *computed_value_Proj_Mod(const ir_node *n)
 	return tarval_unknown;
 }
 
+/**
+ * Switch case for the direct dispatch of a frequent opcode to its default
+ * handler, so the compiler can inline it instead of calling it through
+ * ir_op_ops.  A handler registered with the set_op_*() functions still takes
+ * precedence, because the direct call is only done if the function pointer
+ * is the default handler.
+ */
+#define DISPATCH_DEFAULT(handler, func, name, node) \
+	case iro_##name:                              \
+		if ((func) == handler##_##name)           \
+			return handler##_##name(node);        \
+		break;
+
 /**
  * Return the value of a Proj.
  */
@@ -932,8 +954,30 @@ ir_tarval *computed_value(const ir_node *n)
 	if (vrp != NULL && vrp->bits_set == vrp->bits_not_set)
 		return vrp->bits_set;
 
-	if (n->op->ops.computed_value)
-		return n->op->ops.computed_value(n);
+	computed_value_func const func = n->op->ops.computed_value;
+	switch (get_irn_opcode_(n)) {
+	DISPATCH_DEFAULT(computed_value, func, Add,   n)
+	DISPATCH_DEFAULT(computed_value, func, And,   n)
+	DISPATCH_DEFAULT(computed_value, func, Cmp,   n)
+	DISPATCH_DEFAULT(computed_value, func, Const, n)
+	DISPATCH_DEFAULT(computed_value, func, Conv,  n)
+	DISPATCH_DEFAULT(computed_value, func, Eor,   n)
+	DISPATCH_DEFAULT(computed_value, func, Minus, n)
+	DISPATCH_DEFAULT(computed_value, func, Mul,   n)
+	DISPATCH_DEFAULT(computed_value, func, Mux,   n)
+	DISPATCH_DEFAULT(computed_value, func, Not,   n)
+	DISPATCH_DEFAULT(computed_value, func, Or,    n)
+	DISPATCH_DEFAULT(computed_value, func, Proj,  n)
+	DISPATCH_DEFAULT(computed_value, func, Shl,   n)
+	DISPATCH_DEFAULT(computed_value, func, Shr,   n)
+	DISPATCH_DEFAULT(computed_value, func, Shrs,  n)
+	DISPATCH_DEFAULT(computed_value, func, Sub,   n)
+	default:
+		break;
+	}
+
+	if (func)
+		return func(n);
 	return tarval_unknown;
 }
 
@@ -1016,7 +1060,7 @@ static ir_node *equivalent_node_Add(ir_node *n)
 	ir_mode   *right_mode = get_irn_mode(right);
 	ir_tarval *neutral    = get_mode_null(right_mode);
 	ir_mode   *mode       = get_irn_mode(n);
-	if (mode_is_float(mode)) {
+	if (mode_is_float(get_lane_mode(mode))) {
 		neutral = tarval_neg(neutral);
 		/* X + -0.0 -> X */
 		n = equivalent_node_neutral_element(n, neutral);
@@ -1096,7 +1140,8 @@ static ir_node *equivalent_node_Sub(ir_node *n)
 		return n;
 	}
 
-	if (is_Const(a) && is_Or(b)) {
+	if (is_Const(a) && is_Or(b)
+	    && get_mode_arithmetic(mode) == irma_twos_complement) {
 		ir_tarval *ta        = get_Const_tarval(a);
 		ir_tarval *all_one   = get_mode_all_one(mode);
 		ir_tarval *expect_a  = tarval_shl_unsigned(all_one, 1);
@@ -1671,8 +1716,29 @@ static ir_node *equivalent_node_Confirm(ir_node *n)
  */
 ir_node *equivalent_node(ir_node *n)
 {
-	if (n->op->ops.equivalent_node)
-		return n->op->ops.equivalent_node(n);
+	equivalent_node_func const func = n->op->ops.equivalent_node;
+	switch (get_irn_opcode_(n)) {
+	DISPATCH_DEFAULT(equivalent_node, func, Add,     n)
+	DISPATCH_DEFAULT(equivalent_node, func, And,     n)
+	DISPATCH_DEFAULT(equivalent_node, func, Confirm, n)
+	DISPATCH_DEFAULT(equivalent_node, func, Conv,    n)
+	DISPATCH_DEFAULT(equivalent_node, func, Eor,     n)
+	DISPATCH_DEFAULT(equivalent_node, func, Id,      n)
+	DISPATCH_DEFAULT(equivalent_node, func, Minus,   n)
+	DISPATCH_DEFAULT(equivalent_node, func, Mul,     n)
+	DISPATCH_DEFAULT(equivalent_node, func, Mux,     n)
+	DISPATCH_DEFAULT(equivalent_node, func, Not,     n)
+	DISPATCH_DEFAULT(equivalent_node, func, Or,      n)
+	DISPATCH_DEFAULT(equivalent_node, func, Phi,     n)
+	DISPATCH_DEFAULT(equivalent_node, func, Proj,    n)
+	DISPATCH_DEFAULT(equivalent_node, func, Sub,     n)
+	DISPATCH_DEFAULT(equivalent_node, func, Sync,    n)
+	default:
+		break;
+	}
+
+	if (func)
+		return func(n);
 	return n;
 }
 
@@ -2482,6 +2548,9 @@ static ir_node *transform_node_Or_(ir_node *n)
 		return n;
 
 	ir_mode *mode = get_irn_mode(n);
+	/* the remaining rules assume scalar values */
+	if (mode_is_vector(mode))
+		return n;
 	if (is_Not(a) && is_Not(b) && (only_one_user(a) || only_one_user(b))) {
 		/* ~a | ~b = ~(a&b) */
 		ir_node *block = get_nodes_block(n);
@@ -2663,6 +2732,9 @@ static ir_node *transform_node_Eor_(ir_node *n)
 	n = fold_constant_associativity(n, tarval_eor);
 	if (n != oldn)
 		return n;
+	/* the remaining rules assume scalar values */
+	if (mode_is_vector(mode))
+		return n;
 
 	/* we can combine the relations of two compares with the same operands */
 	if (is_Cmp(a) && is_Cmp(b)) {
@@ -2957,6 +3029,9 @@ static ir_node *transform_node_Add(ir_node *n)
 	ir_node *a    = get_Add_left(n);
 	ir_node *b    = get_Add_right(n);
 	ir_mode *mode = get_irn_mode(n);
+	/* the remaining rules assume scalar values */
+	if (mode_is_vector(mode))
+		return n;
 
 	if (mode_is_reference(mode)) {
 		const ir_mode *lmode = get_irn_mode(a);
@@ -3191,6 +3266,9 @@ static ir_node *transform_node_Sub(ir_node *n)
 	ir_node *a    = get_Sub_left(n);
 	ir_node *b    = get_Sub_right(n);
 	ir_mode *mode = get_irn_mode(n);
+	/* the remaining rules assume scalar values */
+	if (mode_is_vector(mode))
+		return n;
 
 	if (mode_is_int(mode)) {
 		const ir_mode *lmode = get_irn_mode(a);
@@ -3645,6 +3723,9 @@ static ir_node *transform_node_Mul(ir_node *n)
 	ir_node *b    = get_Mul_right(n);
 	ir_node *c;
 	HANDLE_BINOP_CHOICE(tarval_mul, a, b, c, mode);
+	/* the remaining rules assume scalar values */
+	if (mode_is_vector(mode))
+		return n;
 
 	ir_mode_arithmetic arith = get_mode_arithmetic(mode);
 	if (is_Const(b)) {
@@ -4239,6 +4320,9 @@ static ir_node *transform_node_And(ir_node *n)
 	n = fold_constant_associativity(n, tarval_and);
 	if (n != oldn)
 		return n;
+	/* the remaining rules assume scalar values */
+	if (mode_is_vector(get_irn_mode(n)))
+		return n;
 
 	ir_node *a = get_And_left(n);
 	ir_node *b = get_And_right(n);
@@ -4474,6 +4558,9 @@ static ir_node *transform_node_Not(ir_node *n)
 
 	ir_node *c;
 	HANDLE_UNOP_CHOICE(tarval_not,a,c);
+	/* the remaining rules assume scalar values */
+	if (mode_is_vector(get_irn_mode(n)))
+		return n;
 
 	/* check for a boolean Not */
 	if (is_Cmp(a)) {
@@ -4603,6 +4690,9 @@ static ir_node *transform_node_Minus(ir_node *n)
 
 	ir_node *c;
 	HANDLE_UNOP_CHOICE(tarval_neg, op, c);
+	/* the remaining rules assume scalar values */
+	if (mode_is_vector(get_irn_mode(n)))
+		return n;
 
 	dbg_info *const dbgi       = get_irn_dbg_info(n);
 	ir_node  *const negated_op = can_negate_cheaply(dbgi, op);
@@ -7508,6 +7598,44 @@ static bool always_optimize(unsigned const iro)
 		iro == iro_Proj;
 }
 
+/**
+ * Calls the transform_node handler of a node, frequent opcodes are
+ * dispatched directly.
+ */
+static ir_node *call_transform_node(ir_node *n)
+{
+	transform_node_func const func = n->op->ops.transform_node;
+	switch (get_irn_opcode_(n)) {
+	DISPATCH_DEFAULT(transform_node, func, Add,   n)
+	DISPATCH_DEFAULT(transform_node, func, And,   n)
+	DISPATCH_DEFAULT(transform_node, func, Block, n)
+	DISPATCH_DEFAULT(transform_node, func, Cmp,   n)
+	DISPATCH_DEFAULT(transform_node, func, Cond,  n)
+	DISPATCH_DEFAULT(transform_node, func, Conv,  n)
+	DISPATCH_DEFAULT(transform_node, func, Eor,   n)
+	DISPATCH_DEFAULT(transform_node, func, Load,  n)
+	DISPATCH_DEFAULT(transform_node, func, Minus, n)
+	DISPATCH_DEFAULT(transform_node, func, Mul,   n)
+	DISPATCH_DEFAULT(transform_node, func, Mux,   n)
+	DISPATCH_DEFAULT(transform_node, func, Not,   n)
+	DISPATCH_DEFAULT(transform_node, func, Or,    n)
+	DISPATCH_DEFAULT(transform_node, func, Phi,   n)
+	DISPATCH_DEFAULT(transform_node, func, Proj,  n)
+	DISPATCH_DEFAULT(transform_node, func, Shl,   n)
+	DISPATCH_DEFAULT(transform_node, func, Shr,   n)
+	DISPATCH_DEFAULT(transform_node, func, Shrs,  n)
+	DISPATCH_DEFAULT(transform_node, func, Store, n)
+	DISPATCH_DEFAULT(transform_node, func, Sub,   n)
+	DISPATCH_DEFAULT(transform_node, func, Sync,  n)
+	default:
+		break;
+	}
+
+	if (func != NULL)
+		return func(n);
+	return n;
+}
+
 /**
  * Tries several [inplace] [optimizing] transformations and returns an
  * equivalent node.  The difference to equivalent_node() is that these
@@ -7564,11 +7692,9 @@ restart:;
 	if (get_opt_algebraic_simplification() ||
 		(iro == iro_Cond) ||
 		(iro == iro_Proj)) {    /* Flags tested local. */
-		if (n->op->ops.transform_node != NULL) {
-			n = n->op->ops.transform_node(n);
-			if (n != old_n)
-				goto restart;
-		}
+		n = call_transform_node(n);
+		if (n != old_n)
+			goto restart;
 	}
 
 	return n;
@@ -7663,11 +7789,8 @@ void ir_register_opt_node_ops(void)
  * in a graph. */
 #define N_IR_NODES 512
 
-static int identities_cmp(const void *elt, const void *key)
+static int identities_cmp(const ir_node *a, const ir_node *b)
 {
-	ir_node *a = (ir_node *)elt;
-	ir_node *b = (ir_node *)key;
-
 	if (a == b)
 		return 0;
 
@@ -7728,13 +7851,13 @@ unsigned ir_node_hash(const ir_node *node)
 void new_identities(ir_graph *irg)
 {
 	del_identities(irg);
-	irg->value_table = new_pset(identities_cmp, N_IR_NODES);
+	irg->value_table = ir_valuetable_new(identities_cmp, N_IR_NODES);
 }
 
 void del_identities(ir_graph *irg)
 {
 	if (irg->value_table != NULL)
-		del_pset(irg->value_table);
+		ir_valuetable_del(irg->value_table);
 }
 
 static int cmp_node_nr(const void *a, const void *b)
@@ -7781,7 +7904,7 @@ void ir_normalize_node(ir_node *n)
 			MEMCPY(new_ins, ins, arity);
 			QSORT(new_ins, arity, cmp_node_nr);
 			set_irn_in(n, arity, new_ins);
-			free(new_ins);
+			xfree(new_ins);
 		}
 	}
 }
@@ -7789,14 +7912,14 @@ void ir_normalize_node(ir_node *n)
 ir_node *identify_remember(ir_node *n)
 {
 	ir_graph *irg         = get_irn_irg(n);
-	pset     *value_table = irg->value_table;
+	ir_valuetable_t *value_table = irg->value_table;
 
 	if (value_table == NULL)
 		return n;
 
 	ir_normalize_node(n);
 	/* lookup or insert in hash table with given hash key. */
-	ir_node *nn = (ir_node *)pset_insert(value_table, n, ir_node_hash(n));
+	ir_node *nn = ir_valuetable_insert(value_table, n);
 
 	/* nn is reachable again */
 	if (nn != n)
@@ -7836,7 +7959,7 @@ void add_identities(ir_node *node)
 
 void visit_all_identities(ir_graph *irg, irg_walk_func visit, void *env)
 {
-	foreach_pset(irg->value_table, ir_node, node) {
+	foreach_ir_valuetable(irg->value_table, node, iter) {
 		visit(node, env);
 	}
 }
@@ -127,6 +127,13 @@ bool may_leave_out_middle_conv(ir_mode *m0, ir_mode *m1, ir_mode *m2);
  */
 ir_node *predict_load(ir_node *ptr, ir_mode *mode);
 
+/**
+ * Returns true if an optimization can make use of a Confirm node placed
+ * in front of input @p pos of @p user.
+ * This is the demand query for budgeted Confirm construction.
+ */
+bool is_Confirm_consumer(const ir_node *user, int pos);
+
 void ir_register_opt_node_ops(void);
 
 #endif
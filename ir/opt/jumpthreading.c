@@ -15,6 +15,7 @@
 #include <stdbool.h>
 #include "array.h"
 #include "debug.h"
+#include "execfreq_t.h"
 #include "ircons.h"
 #include "irgmod.h"
 #include "irgopt.h"
@@ -22,13 +23,24 @@
 #include "irnode_t.h"
 #include "iredges_t.h"
 #include "irtools.h"
-#include "tv.h"
+#include "tv_t.h"
+#include "util.h"
 #include "iroptimize.h"
 #include "iropt_dbg.h"
 #include "vrp.h"
 
 #undef AVOID_PHIB
 
+/** Number of nodes which may always be copied to thread a jump. */
+#define JUMPTHREADING_MIN_COPIES       8
+/** Additional number of nodes which may be copied per execution of the
+ * threaded path relative to an execution of the function. */
+#define JUMPTHREADING_COPIES_PER_EXEC 16
+/** Growth of a graph by jump threading in percent of its size. */
+#define JUMPTHREADING_GROWTH          50
+/** Minimal growth budget of a graph in nodes. */
+#define JUMPTHREADING_MIN_BUDGET      64
+
 DEBUG_ONLY(static firm_dbg_module_t *dbg;)
 
 /**
@@ -198,21 +210,35 @@ static void split_critical_edge(ir_node *block, int pos)
 	ir_node  *new_block = new_r_Block(irg, ARRAY_SIZE(in), in);
 	ir_node  *new_jmp   = new_r_Jmp(new_block);
 	set_Block_cfgpred(block, pos, new_jmp);
+	set_block_execfreq(new_block,
+	                   get_block_execfreq(get_nodes_block(skip_Proj(in[0]))));
 }
 
 typedef struct jumpthreading_env_t {
-	ir_node      *true_block;  /**< Block we try to thread into */
-	ir_node      *cmp;         /**< The Compare node that might be partial
+	ir_node       *true_block; /**< Block we try to thread into */
+	ir_node       *cmp;        /**< The Compare node that might be partial
 	                                evaluated */
-	ir_relation   relation;    /**< The Compare mode of the Compare node. */
-	ir_node      *cnst;
-	ir_tarval    *tv;
-	ir_visited_t  visited_nr;
-	ir_node      *cnst_pred;   /**< the block before the constant */
-	int           cnst_pos;    /**< the pos to the constant block (needed to
+	ir_relation    relation;   /**< The Compare mode of the Compare node. */
+	ir_node       *cnst;
+	ir_tarval     *tv;
+	ir_visited_t   visited_nr;
+	ir_node       *cnst_pred;  /**< the block before the constant */
+	int            cnst_pos;   /**< the pos to the constant block (needed to
 	                                kill that edge later) */
+	const ir_node *switchn;    /**< the Switch we thread into or NULL */
+	unsigned       switch_pn;  /**< the Proj number of the Switch successor */
+	bool           analyze;    /**< only determine the cost, do not change
+	                                the graph */
+	unsigned       n_copies;   /**< number of nodes copied by the threading */
+	double         freq;       /**< execution frequency of the threaded path */
 } jumpthreading_env_t;
 
+/** Environment of the block walker. */
+typedef struct thread_walk_env_t {
+	unsigned budget;  /**< number of nodes which may still be copied */
+	bool     changed; /**< set if the graph was changed */
+} thread_walk_env_t;
+
 static ir_node *copy_and_fix_node(const jumpthreading_env_t *env,
                                   ir_node *block, ir_node *copy_block, int j,
                                   ir_node *node)
@@ -330,6 +356,22 @@ static void copy_and_fix(const jumpthreading_env_t *env, ir_node *block,
 	}
 }
 
+/**
+ * Returns the number of nodes copy_and_fix() copies out of @p block.
+ */
+static unsigned get_n_copies(const ir_node *block)
+{
+	unsigned n_copies = 0;
+	foreach_out_edge(block, edge) {
+		const ir_node *node = get_edge_src_irn(edge);
+		if (is_End(node) || is_Phi(node) || get_irn_mode(node) == mode_X
+		    || is_Cond(node) || is_Switch(node))
+			continue;
+		++n_copies;
+	}
+	return n_copies;
+}
+
 /**
  * Returns whether the cmp evaluates to true or false, or can't be evaluated!
  *
@@ -394,6 +436,43 @@ static ir_tarval *get_Const_or_Confirm_tarval(const ir_node *node)
 	return get_Const_tarval(node);
 }
 
+/**
+ * Returns the Proj number of the successor the Switch @p switchn takes for
+ * the selector value @p tv.
+ */
+static unsigned get_switch_pn(const ir_node *switchn, const ir_tarval *tv)
+{
+	const ir_switch_table *table = get_Switch_table(switchn);
+	for (size_t i = 0, n = ir_switch_table_get_n_entries(table); i < n; ++i) {
+		const ir_switch_table_entry *entry
+			= ir_switch_table_get_entry_const(table, i);
+		if (entry->pn != pn_Switch_default
+		    && tarval_in_range(entry->min, tv, entry->max))
+			return entry->pn;
+	}
+	return pn_Switch_default;
+}
+
+/**
+ * Duplicates @p block into its predecessor @p copy_block on the threaded
+ * path, or only accounts for the copied nodes when analyzing.
+ */
+static void copy_path_block(jumpthreading_env_t *env, ir_node *block,
+                            ir_node *copy_block, int pos, ir_node *cfgpred)
+{
+	if (env->analyze) {
+		env->n_copies += get_n_copies(block);
+		return;
+	}
+
+	/* copy duplicated nodes in copy_block and fix SSA */
+	copy_and_fix(env, block, copy_block, pos);
+	if (copy_block == get_nodes_block(cfgpred)) {
+		env->cnst_pred = block;
+		env->cnst_pos  = pos;
+	}
+}
+
 static ir_node *find_const_or_confirm(jumpthreading_env_t *env, ir_node *jump,
                                       ir_node *value)
 {
@@ -408,6 +487,13 @@ static ir_node *find_const_or_confirm(jumpthreading_env_t *env, ir_node *jump,
 		/* maybe we could evaluate the condition completely without any
 		 * partial tracking along paths. */
 		assert(get_Block_n_cfgpreds(env->true_block) == 1);
+		if (env->analyze) {
+			if (block != get_Block_cfgpred_block(env->true_block, 0)
+			    && evaluated <= 0)
+				return NULL;
+			env->freq = get_block_execfreq(block);
+			return block;
+		}
 		if (block == get_Block_cfgpred_block(env->true_block, 0)) {
 			if (evaluated == 0) {
 				ir_graph *irg = get_irn_irg(block);
@@ -449,12 +535,7 @@ static ir_node *find_const_or_confirm(jumpthreading_env_t *env, ir_node *jump,
 			if (copy_block == NULL)
 				continue;
 
-			/* copy duplicated nodes in copy_block and fix SSA */
-			copy_and_fix(env, block, copy_block, i);
-			if (copy_block == get_nodes_block(cfgpred)) {
-				env->cnst_pred = block;
-				env->cnst_pos  = i;
-			}
+			copy_path_block(env, block, copy_block, i, cfgpred);
 
 			/* return now as we can't process more possibilities in 1 run */
 			return copy_block;
@@ -471,10 +552,18 @@ static ir_node *find_candidate(jumpthreading_env_t *env, ir_node *jump,
 		return NULL;
 
 	ir_node *block = get_nodes_block(jump);
-	if (is_Const_or_Confirm(value)) {
+	if (env->switchn != NULL ? is_Const(value) : is_Const_or_Confirm(value)) {
 		ir_tarval *tv = get_Const_or_Confirm_tarval(value);
-		if (tv != env->tv)
+		if (env->switchn != NULL) {
+			if (get_switch_pn(env->switchn, tv) != env->switch_pn)
+				return NULL;
+		} else if (tv != env->tv) {
 			return NULL;
+		}
+		if (env->analyze) {
+			env->freq = get_block_execfreq(block);
+			return block;
+		}
 
 		DB((dbg, LEVEL_1, "> Found jump threading candidate %+F->%+F\n",
 			block, env->true_block));
@@ -499,12 +588,7 @@ static ir_node *find_candidate(jumpthreading_env_t *env, ir_node *jump,
 			if (copy_block == NULL)
 				continue;
 
-			/* copy duplicated nodes in copy_block and fix SSA */
-			copy_and_fix(env, block, copy_block, i);
-			if (copy_block == get_nodes_block(cfgpred)) {
-				env->cnst_pred = block;
-				env->cnst_pos  = i;
-			}
+			copy_path_block(env, block, copy_block, i, cfgpred);
 
 			/* return now as we can't process more possibilities in 1 run */
 			return copy_block;
@@ -559,7 +643,7 @@ static ir_node *find_candidate(jumpthreading_env_t *env, ir_node *jump,
  */
 static void thread_jumps(ir_node* block, void* data)
 {
-	bool *changed = (bool*)data;
+	thread_walk_env_t *walk_env = (thread_walk_env_t*)data;
 
 	/* we do not deal with Phis, so restrict this to exactly one cfgpred */
 	if (get_Block_n_cfgpreds(block) != 1)
@@ -570,13 +654,21 @@ static void thread_jumps(ir_node* block, void* data)
 		return;
 
 	ir_node *cond = get_Proj_pred(projx);
-	/* TODO handle switch Conds */
-	if (!is_Cond(cond))
+	ir_node *selector;
+	if (is_Cond(cond)) {
+		selector = get_Cond_selector(cond);
+	} else if (is_Switch(cond)) {
+		selector = get_Switch_selector(cond);
+		/* Switches with a constant selector are folded by the local
+		 * optimizations. */
+		if (is_Const(selector))
+			return;
+	} else {
 		return;
+	}
 
 	/* (recursively) look if a pred of a Phi is a constant or a Confirm */
-	ir_node  *selector = get_Cond_selector(cond);
-	ir_graph *irg      = get_irn_irg(block);
+	ir_graph *irg = get_irn_irg(block);
 	if (is_Const(selector)) {
 		const ir_tarval *tv = get_Const_tarval(selector);
 		assert(tv == tarval_b_false || tv == tarval_b_true);
@@ -589,20 +681,46 @@ static void thread_jumps(ir_node* block, void* data)
 			[pn_Cond_true]  = is_true ? jmp : bad,
 		};
 		turn_into_tuple(cond, ARRAY_SIZE(in), in);
-		*changed = true;
+		walk_env->changed = true;
 		return;
 	}
-	inc_irg_visited(irg);
 	jumpthreading_env_t env;
 	env.cnst_pred  = NULL;
-	env.tv         = get_Proj_num(projx) == pn_Cond_false
-	                 ? tarval_b_false : tarval_b_true;
 	env.true_block = block;
+	if (is_Switch(cond)) {
+		env.tv        = NULL;
+		env.switchn   = cond;
+		env.switch_pn = get_Proj_num(projx);
+	} else {
+		env.tv        = get_Proj_num(projx) == pn_Cond_false
+		                ? tarval_b_false : tarval_b_true;
+		env.switchn   = NULL;
+		env.switch_pn = 0;
+	}
+
+	/* Determine the number of copied nodes first and only thread the jump if
+	 * the threaded path is executed often enough to pay for them. */
+	inc_irg_visited(irg);
 	env.visited_nr = get_irg_visited(irg);
+	env.analyze    = true;
+	env.n_copies   = 0;
+	env.freq       = 0.0;
+	if (find_candidate(&env, projx, selector) == NULL)
+		return;
+	if (env.n_copies > walk_env->budget
+	    || env.n_copies > JUMPTHREADING_MIN_COPIES
+	                      + env.freq * JUMPTHREADING_COPIES_PER_EXEC) {
+		DB((dbg, LEVEL_2, "> Not threading into %+F: %u copies at freq %f\n",
+		    block, env.n_copies, env.freq));
+		return;
+	}
+	walk_env->budget -= env.n_copies;
 
+	inc_irg_visited(irg);
+	env.visited_nr = get_irg_visited(irg);
+	env.analyze    = false;
 	ir_node *copy_block = find_candidate(&env, projx, selector);
-	if (copy_block == NULL)
-		return;
+	assert(copy_block != NULL);
 
 	if (copy_block != get_nodes_block(cond)) {
 		/* We might thread the condition block of an infinite loop,
@@ -629,11 +747,13 @@ static void thread_jumps(ir_node* block, void* data)
 	}
 
 	/* the graph is changed now */
-	*changed = true;
+	walk_env->changed = true;
 }
 
 void opt_jumpthreading(ir_graph* irg)
 {
+	/* the execution frequencies guide the duplication of nodes */
+	ir_estimate_execfreq(irg);
 	assure_irg_properties(irg,
 		IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE
 		| IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
@@ -645,13 +765,17 @@ void opt_jumpthreading(ir_graph* irg)
 
 	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_IRN_VISITED);
 
+	/* limit the growth of the graph by duplicated nodes */
+	unsigned const growth = get_irg_last_idx(irg) * JUMPTHREADING_GROWTH / 100;
+	thread_walk_env_t walk_env = {
+		.budget = MAX(growth, JUMPTHREADING_MIN_BUDGET),
+	};
 	bool changed = false;
-	bool rerun;
 	do {
-		rerun = false;
-		irg_block_walk_graph(irg, thread_jumps, NULL, &rerun);
-		changed |= rerun;
-	} while (rerun);
+		walk_env.changed = false;
+		irg_block_walk_graph(irg, thread_jumps, NULL, &walk_env);
+		changed |= walk_env.changed;
+	} while (walk_env.changed);
 
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_IRN_VISITED);
 
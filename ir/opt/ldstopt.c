@@ -25,6 +25,7 @@
 #include "irgwalk.h"
 #include "irhooks.h"
 #include "irmemory.h"
+#include "irmemory_t.h"
 #include "irmode_t.h"
 #include "irnode_t.h"
 #include "irnodehashmap.h"
@@ -40,6 +41,9 @@
 /** The debug handle. */
 DEBUG_ONLY(static firm_dbg_module_t *dbg;)
 
+/** Maximum depth of the expressions packed for a combined Store. */
+#define MAX_PACK_DEPTH 8
+
 #define MAX_PROJ MAX(MAX((unsigned)pn_Load_max, (unsigned)pn_Store_max), (unsigned)pn_Call_max)
 
 typedef enum changes_t {
@@ -73,10 +77,11 @@ typedef struct base_offset_t {
 } base_offset_t;
 
 typedef struct track_load_env_t {
-	ir_node      *load;
-	base_offset_t base_offset;
-	ir_node      *ptr; /* deprecated: alternative representation of
-	                      base_offset */
+	ir_node         *load;
+	base_offset_t    base_offset;
+	ir_node         *ptr; /* deprecated: alternative representation of
+	                         base_offset */
+	const ir_entity *cls; /**< the alias class of ptr */
 } track_load_env_t;
 
 /**
@@ -611,6 +616,7 @@ static bool try_update_ptr_CopyB(track_load_env_t *env, ir_node *copyb)
 	                                          src_base_offset.offset + delta);
 	ir_node  *new_load_ptr = new_r_Add(block, src_base_offset.base, cnst, mode_P);
 	env->ptr = new_load_ptr;
+	env->cls = get_unaliased_entity(new_load_ptr);
 	return true;
 }
 
@@ -641,6 +647,8 @@ static changes_t follow_load_mem_chain(track_load_env_t *env, ir_node *start)
 	ir_node   *node = start;
 	changes_t  res  = NO_CHANGES;
 	for (;;) {
+		/* skip accesses to other alias classes */
+		node = ir_memssa_skip(node, env->cls);
 		ldst_info_t *node_info = (ldst_info_t *)get_irn_link(node);
 
 		if (is_Store(node)) {
@@ -776,7 +784,7 @@ static changes_t optimize_load(ir_node *load)
 		return res | DF_CHANGED;
 	}
 
-	track_load_env_t env = { .ptr = ptr };
+	track_load_env_t env = { .ptr = ptr, .cls = get_unaliased_entity(ptr) };
 	get_base_and_offset(ptr, &env.base_offset);
 
 	/* Check, if the base address of this load is used more than once.
@@ -829,8 +837,10 @@ static changes_t follow_store_mem_chain(ir_node *store, ir_node *start,
 	ir_type     *type  = get_Store_type(store);
 	unsigned     size  = get_mode_size_bytes(get_irn_mode(value));
 	ir_node     *block = get_nodes_block(store);
+	ir_entity   *cls   = get_unaliased_entity(ptr);
 
-	ir_node *node = start;
+	/* skip accesses to other alias classes */
+	ir_node *node = ir_memssa_skip(start, cls);
 	while (node != store) {
 		ldst_info_t *node_info = (ldst_info_t *)get_irn_link(node);
 
@@ -958,6 +968,7 @@ static changes_t follow_store_mem_chain(ir_node *store, ir_node *start,
 		if (NODE_VISITED(node_info))
 			break;
 		MARK_NODE(node_info);
+		node = ir_memssa_skip(node, cls);
 	}
 
 	if (is_Sync(node)) {
@@ -2089,6 +2100,234 @@ static int cmp_ptrs(const void *p0, const void *p1)
 	return (bo0.offset > bo1.offset) - (bo0.offset < bo1.offset);
 }
 
+/**
+ * Returns the type of a memory operation combining two accesses of types
+ * @p type0 and @p type1.
+ */
+static ir_type *combine_types(ir_type *type0, ir_type *type1,
+                              const char *struct_name, const char *part_name)
+{
+	if (type0 == type1)
+		return type0;
+
+	/* Construct an anonymous struct type for the combined operation. */
+	ir_type *type = new_type_struct(id_unique(struct_name));
+	new_entity(type, id_unique(part_name), type0);
+	new_entity(type, id_unique(part_name), type1);
+	return type;
+}
+
+/**
+ * Returns the Load producing the value @p node if it is a "simple" Load whose
+ * value is used by nothing else, NULL otherwise.
+ */
+static ir_node *get_load_of_value(const ir_node *node)
+{
+	if (!is_Proj(node) || get_Proj_num(node) != pn_Load_res
+	 || get_irn_n_edges(node) != 1)
+		return NULL;
+	ir_node *load = get_Proj_pred(node);
+	if (!is_Load(load) || get_Load_volatility(load) == volatility_is_volatile
+	 || ir_throws_exception(load))
+		return NULL;
+	return load;
+}
+
+/**
+ * Checks whether the Loads @p first and @p second read adjacent memory
+ * (@p second directly behind @p first) and can be replaced by one Load.
+ */
+static bool loads_adjacent(const ir_node *first, const ir_node *second)
+{
+	if (get_nodes_block(first) != get_nodes_block(second))
+		return false;
+
+	/* both Loads must see the same memory, loads do not change it so we may
+	 * look through one of them */
+	ir_node *mem0 = get_Load_mem(first);
+	ir_node *mem1 = get_Load_mem(second);
+	if (mem0 != mem1
+	 && !(is_Proj(mem1) && get_Proj_pred(mem1) == first)
+	 && !(is_Proj(mem0) && get_Proj_pred(mem0) == second))
+		return false;
+
+	base_offset_t base0;
+	base_offset_t base1;
+	get_base_and_offset(get_Load_ptr(first), &base0);
+	get_base_and_offset(get_Load_ptr(second), &base1);
+	unsigned size = get_mode_size_bytes(get_Load_mode(first));
+	return base0.base == base1.base
+	    && base1.offset == base0.offset + (long)size;
+}
+
+/**
+ * Checks whether @p load can be replaced while the predecessors of @p sync
+ * are rearranged.
+ */
+static bool is_load_replaceable(const ir_node *load, const ir_node *sync)
+{
+	foreach_out_edge(load, edge) {
+		ir_node *proj = get_edge_src_irn(edge);
+		foreach_out_edge(proj, proj_edge) {
+			if (get_edge_src_irn(proj_edge) == sync)
+				return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Checks whether the values @p low and @p high of a mode with @p size bits can
+ * be computed as the low and high halves of a single value with twice the
+ * size without additional code.  Packing Loads and bitwise operations only
+ * pays off if the small nodes become dead, so each must have a single user.
+ */
+static bool can_pack(const ir_node *low, const ir_node *high, unsigned size,
+                     const ir_node *sync, unsigned depth)
+{
+	if (depth > MAX_PACK_DEPTH)
+		return false;
+	if (is_Const(low) && is_Const(high))
+		return true;
+
+	/* the halves of a bigger value */
+	ir_node *value = is_Conv(low) ? get_Conv_op(low) : NULL;
+	if (value != NULL && mode_is_int(get_irn_mode(value))
+	 && get_mode_size_bits(get_irn_mode(value)) == 2 * size) {
+		const ir_node *shr = is_Conv(high) ? get_Conv_op(high) : high;
+		if (is_Shr(shr) && get_Shr_left(shr) == value) {
+			ir_node *shiftval = get_Shr_right(shr);
+			if (is_Const(shiftval)) {
+				ir_tarval *tv = get_Const_tarval(shiftval);
+				if (tarval_is_long(tv) && get_tarval_long(tv) == (long)size)
+					return true;
+			}
+		}
+	}
+
+	if (get_irn_n_edges(low) != 1 || get_irn_n_edges(high) != 1)
+		return false;
+
+	ir_node *load_low  = get_load_of_value(low);
+	ir_node *load_high = get_load_of_value(high);
+	if (load_low != NULL && load_high != NULL) {
+		ir_mode *mode_low  = get_Load_mode(load_low);
+		ir_mode *mode_high = get_Load_mode(load_high);
+		if (get_mode_arithmetic(mode_low) != irma_twos_complement
+		 || get_mode_arithmetic(mode_high) != irma_twos_complement
+		 || get_mode_size_bits(mode_low) != size
+		 || get_mode_size_bits(mode_high) != size
+		 || !is_load_replaceable(load_low, sync)
+		 || !is_load_replaceable(load_high, sync))
+			return false;
+		if (be_is_big_endian())
+			return loads_adjacent(load_high, load_low);
+		return loads_adjacent(load_low, load_high);
+	}
+
+	/* bitwise operations work on the halves independently */
+	if (get_irn_opcode(low) != get_irn_opcode(high)
+	 || get_nodes_block(low) != get_nodes_block(high))
+		return false;
+	if (is_And(low) || is_Or(low) || is_Eor(low)) {
+		return can_pack(get_binop_left(low), get_binop_left(high), size, sync,
+		                depth + 1)
+		    && can_pack(get_binop_right(low), get_binop_right(high), size,
+		                sync, depth + 1);
+	}
+	if (is_Not(low))
+		return can_pack(get_Not_op(low), get_Not_op(high), size, sync,
+		                depth + 1);
+	return false;
+}
+
+/**
+ * Replaces the Loads @p first and @p second, which read adjacent memory, by a
+ * single Load in mode @p mode and returns its value.
+ */
+static ir_node *pack_loads(ir_node *first, ir_node *second, ir_mode *mode)
+{
+	/* the combined Load must see the memory before both Loads */
+	ir_node *mem = get_Load_mem(first);
+	if (is_Proj(mem) && get_Proj_pred(mem) == second)
+		mem = get_Load_mem(second);
+
+	DB((dbg, LEVEL_1, "  combining %+F and %+F\n", first, second));
+	ir_type *type = combine_types(get_Load_type(first), get_Load_type(second),
+	                              "__combined_Load_%u", "__Load_part_%u");
+
+	dbg_info     *dbgi  = get_irn_dbg_info(first);
+	ir_node      *block = get_nodes_block(first);
+	ir_node      *ptr   = get_Load_ptr(first);
+	ir_cons_flags flags = cons_unaligned;
+	if (!get_irn_pinned(first) && !get_irn_pinned(second))
+		flags |= cons_floats;
+	ir_node *load    = new_rd_Load(dbgi, block, mem, ptr, mode, type, flags);
+	ir_node *new_mem = new_r_Proj(load, mode_M, pn_Load_M);
+
+	/* the values of the small Loads die with the combined Store, only their
+	 * memory is still used */
+	ir_node *old_loads[] = { first, second };
+	for (size_t i = 0; i < ARRAY_SIZE(old_loads); ++i) {
+		foreach_out_edge_safe(old_loads[i], edge) {
+			ir_node *proj = get_edge_src_irn(edge);
+			if (is_Proj(proj) && get_Proj_num(proj) == pn_Load_M)
+				exchange(proj, new_mem);
+		}
+	}
+	return new_r_Proj(load, mode, pn_Load_res);
+}
+
+/**
+ * Computes the value with the low half @p low and the high half @p high in
+ * mode @p mode.  can_pack() must have succeeded for the values.
+ */
+static ir_node *pack(ir_node *low, ir_node *high, ir_mode *mode)
+{
+	ir_node *block = get_nodes_block(low);
+	if (is_Const(low)) {
+		ir_graph  *irg   = get_irn_irg(low);
+		ir_mode   *mode0 = find_unsigned_mode(get_irn_mode(low));
+		ir_tarval *tv0   = tarval_convert_to(get_Const_tarval(low), mode0);
+		ir_tarval *tv1   = tarval_convert_to(get_Const_tarval(high), mode0);
+		ir_tarval *shift = new_tarval_from_long(get_mode_size_bits(mode0),
+		                                        mode_Iu);
+		ir_tarval *tv    = tarval_or(tarval_convert_to(tv0, mode),
+		                             tarval_shl(tarval_convert_to(tv1, mode),
+		                                        shift));
+		return new_r_Const(irg, tv);
+	}
+
+	if (is_Conv(low)) {
+		ir_node *value = get_Conv_op(low);
+		if (get_irn_mode(value) != mode)
+			value = new_r_Conv(block, value, mode);
+		return value;
+	}
+
+	ir_node *load_low = get_load_of_value(low);
+	if (load_low != NULL) {
+		ir_node *load_high = get_load_of_value(high);
+		if (be_is_big_endian())
+			return pack_loads(load_high, load_low, mode);
+		return pack_loads(load_low, load_high, mode);
+	}
+
+	dbg_info *dbgi = get_irn_dbg_info(low);
+	if (is_Not(low))
+		return new_rd_Not(dbgi, block, pack(get_Not_op(low), get_Not_op(high),
+		                                    mode), mode);
+
+	ir_node *left  = pack(get_binop_left(low), get_binop_left(high), mode);
+	ir_node *right = pack(get_binop_right(low), get_binop_right(high), mode);
+	switch (get_irn_opcode(low)) {
+	case iro_And: return new_rd_And(dbgi, block, left, right, mode);
+	case iro_Or:  return new_rd_Or(dbgi, block, left, right, mode);
+	case iro_Eor: return new_rd_Eor(dbgi, block, left, right, mode);
+	default:      panic("unexpected node %+F", low);
+	}
+}
+
 static void combine_memop(ir_node *sync, void *data)
 {
 	(void)data;
@@ -2173,7 +2412,9 @@ again:;
 
 			/* Abort optimisation if we can't guarantee that the extra
 			 * arithmetic code below will disappear. */
-			if (!is_Const(store_val1)) {
+			bool packable = can_pack(store_val, store_val1, store_size, sync,
+			                         0);
+			if (!packable && !is_Const(store_val1)) {
 				if (!is_Shr(store_val1))
 					continue;
 				ir_node *shiftval = get_Shr_right(store_val1);
@@ -2186,34 +2427,29 @@ again:;
 			}
 
 			/* Combine types if necessary */
-			ir_type *type0 = get_Store_type(store0);
-			ir_type *type1 = get_Store_type(store1);
-			ir_type *type;
-			if (type0 != type1) {
-				/* Construct an anonymous struct type
-				 * for the combined Store.
-				 */
-				ident *struct_id = id_unique("__combined_Store_%u");
-				type = new_type_struct(struct_id);
-				ident *member0_id = id_unique("__Store_part_%u");
-				new_entity(type, member0_id, type0);
-				ident *member1_id = id_unique("__Store_part_%u");
-				new_entity(type, member1_id, type1);
-			} else {
-				type = type0;
-			}
+			ir_type *type = combine_types(get_Store_type(store0),
+			                              get_Store_type(store1),
+			                              "__combined_Store_%u",
+			                              "__Store_part_%u");
 
 			/* combine values */
-			dbg_info *dbgi   = get_irn_dbg_info(store0);
-			ir_node  *block  = get_nodes_block(store0);
-			ir_graph *irg    = get_irn_irg(store0);
-			ir_node  *convu0 = new_r_Conv(block, store_val, mode_unsigned);
-			ir_node  *conv0  = new_r_Conv(block, convu0, double_mode);
-			ir_node  *convu1 = new_r_Conv(block, store_val1, mode_unsigned);
-			ir_node  *conv1  = new_r_Conv(block, convu1, double_mode);
-			ir_node  *cnst   = new_r_Const_long(irg, mode_Iu, store_size);
-			ir_node  *shl    = new_r_Shl(block, conv1, cnst, double_mode);
-			ir_node  *or     = new_r_Or(block, conv0, shl, double_mode);
+			dbg_info *dbgi  = get_irn_dbg_info(store0);
+			ir_node  *block = get_nodes_block(store0);
+			ir_node  *or;
+			if (packable) {
+				or = pack(store_val, store_val1, double_mode);
+				/* packing Loads may have replaced the memory */
+				mem = get_Store_mem(store0);
+			} else {
+				ir_graph *irg    = get_irn_irg(store0);
+				ir_node  *convu0 = new_r_Conv(block, store_val, mode_unsigned);
+				ir_node  *conv0  = new_r_Conv(block, convu0, double_mode);
+				ir_node  *convu1 = new_r_Conv(block, store_val1, mode_unsigned);
+				ir_node  *conv1  = new_r_Conv(block, convu1, double_mode);
+				ir_node  *cnst   = new_r_Const_long(irg, mode_Iu, store_size);
+				ir_node  *shl    = new_r_Shl(block, conv1, cnst, double_mode);
+				or = new_r_Or(block, conv0, shl, double_mode);
+			}
 
 			/* create a new store and replace the two small stores */
 			ir_cons_flags flags = cons_unaligned;
@@ -2256,7 +2492,11 @@ void combine_memops(ir_graph *irg)
 	if (!be_get_backend_param()->unaligned_memaccess_supported)
 		return;
 
+	FIRM_DBG_REGISTER(dbg, "firm.opt.ldstopt");
+
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
 	irg_walk_graph(irg, combine_memop, NULL, NULL);
+	confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_NONE);
 }
 
 void optimize_load_store(ir_graph *irg)
@@ -2277,6 +2517,7 @@ void optimize_load_store(ir_graph *irg)
 	if ((opts & aa_opt_always_alias) == 0) {
 		assure_irp_globals_entity_usage_computed();
 	}
+	ir_init_alias_cache(irg);
 
 	walk_env_t env = { .changes = NO_CHANGES };
 	obstack_init(&env.obst);
@@ -2287,7 +2528,9 @@ void optimize_load_store(ir_graph *irg)
 	irg_walk_graph(irg, firm_clear_link, collect_nodes, &env);
 
 	/* now we have collected enough information, optimize */
+	ir_init_memssa(irg);
 	irg_walk_graph(irg, NULL, do_load_store_optimize, &env);
+	ir_free_memssa(irg);
 
 	/* optimize_load can introduce dead stores. They are
 	 * eliminated now. */
@@ -2297,6 +2540,7 @@ void optimize_load_store(ir_graph *irg)
 
 	env.changes |= optimize_loops(irg);
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	ir_free_alias_cache(irg);
 
 	obstack_free(&env.obst, NULL);
 
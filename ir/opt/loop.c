@@ -10,11 +10,13 @@
  *
  */
 
+#include <limits.h>
 #include <math.h>
 #include <stdbool.h>
 
 #include "util.h"
 #include "array.h"
+#include "be.h"
 #include "debug.h"
 #include "panic.h"
 #include "irbackedge_t.h"
@@ -25,10 +27,12 @@
 #include "irgopt.h"
 #include "irgwalk.h"
 #include "irloop_t.h"
+#include "irmemory.h"
 #include "irnode_t.h"
 #include "irnodemap.h"
 #include "iroptimize.h"
 #include "irouts.h"
+#include "irprofile.h"
 #include "irtools.h"
 #include "opt_init.h"
 
@@ -84,12 +88,15 @@ typedef struct loop_stats_t {
 	unsigned inverted;
 	unsigned too_large;
 	unsigned too_large_adapted;
+	unsigned too_much_pressure;
+	unsigned too_few_passes;
 	unsigned cc_limit_reached;
 	unsigned calls_limit;
 
 	unsigned u_simple_counting_loop;
 	unsigned constant_unroll;
 	unsigned invariant_unroll;
+	unsigned vector_unroll;
 
 	unsigned unhandled;
 } loop_stats_t;
@@ -110,11 +117,14 @@ static void print_stats(void)
 	DB((dbg, LEVEL_2, "inverted          :   %d\n", stats.inverted));
 	DB((dbg, LEVEL_2, "too_large         :   %d\n", stats.too_large));
 	DB((dbg, LEVEL_2, "too_large_adapted :   %d\n", stats.too_large_adapted));
+	DB((dbg, LEVEL_2, "too_much_pressure :   %d\n", stats.too_much_pressure));
+	DB((dbg, LEVEL_2, "too_few_passes    :   %d\n", stats.too_few_passes));
 	DB((dbg, LEVEL_2, "cc_limit_reached  :   %d\n", stats.cc_limit_reached));
 	DB((dbg, LEVEL_2, "calls_limit       :   %d\n", stats.calls_limit));
 	DB((dbg, LEVEL_2, "u_simple_counting :   %d\n", stats.u_simple_counting_loop));
 	DB((dbg, LEVEL_2, "constant_unroll   :   %d\n", stats.constant_unroll));
 	DB((dbg, LEVEL_2, "invariant_unroll  :   %d\n", stats.invariant_unroll));
+	DB((dbg, LEVEL_2, "vector_unroll     :   %d\n", stats.vector_unroll));
 	DB((dbg, LEVEL_2, "=======================================\n"));
 }
 
@@ -132,6 +142,7 @@ typedef struct loop_opt_params_t {
 	bool     allow_const_unrolling;
 	bool     allow_invar_unrolling;
 	unsigned invar_unrolling_min_size;  /* [nodes] */
+	unsigned vector_bytes;              /* Width of a vector register [bytes] */
 } loop_opt_params_t;
 
 static loop_opt_params_t opt_params;
@@ -150,6 +161,7 @@ typedef struct loop_info_t {
 
 	/* for unrolling */
 	unsigned max_unroll;       /* Number of unrolls satisfying max_loop_size */
+	unsigned vector_lanes;     /* Preferred unroll factor for vector lanes, 0 if none */
 	unsigned exit_cond;        /* 1 if condition==true exits the loop.  */
 	unsigned latest_value:1;   /* 1 if condition is checked against latest counter value */
 	unsigned decreasing:1;     /* Step operation is_Sub, or step is<0 */
@@ -161,7 +173,6 @@ typedef struct loop_info_t {
 	ir_node *iteration_phi;
 	ir_node *add;
 
-	ir_node            *duff_cond;   /* Duff mod */
 	unrolling_kind_flag unroll_kind; /* constant or invariant unrolling */
 } loop_info_t;
 
@@ -442,7 +453,7 @@ static void set_unroll_copy(ir_node *const n, int const nr, ir_node *const cp)
 	unrolling_node_info *info = ir_nodemap_get(unrolling_node_info, &map, n);
 	if (!info) {
 		info = OALLOCZ(&obst, unrolling_node_info);
-		info->copies = NEW_ARR_DZ(ir_node*, &obst, unroll_nr);
+		info->copies = NEW_ARR_DZ(ir_node*, &obst, unroll_nr + 1);
 		ir_nodemap_insert(&map, n, info);
 	}
 	/* Original node */
@@ -526,8 +537,8 @@ static void extend_irn(ir_node *const n, ir_node *const newnode, bool const new_
 				set_backedge(n, i);
 		}
 	}
-	free(ins);
-	free(bes);
+	xfree(ins);
+	xfree(bes);
 }
 
 /* Extends a block by a copy of its pred at pos,
@@ -1210,29 +1221,185 @@ static void loop_inversion(ir_graph *const irg)
 	ir_free_resources(irg, IR_RESOURCE_BLOCK_MARK);
 }
 
-/* Fix the original loop_heads ins for invariant unrolling case. */
-static void unrolling_fix_loop_head_inv(void)
+/* Creates a new phi from the given phi node omitting own bes,
+ * using be_block as supplier of backedge informations. */
+static ir_node *clone_phis_sans_bes(ir_node *const phi, ir_node *const be_block, ir_node *const dest_block)
 {
+	int const arity = get_Phi_n_preds(phi);
+	assert(arity == get_Block_n_cfgpreds(be_block));
 
-	/* Original loop_heads ins are:
-	 * duff block and the own backedge */
+	int             c   = 0;
+	ir_node **const ins = ALLOCAN(ir_node*, arity);
+	foreach_irn_in(phi, i, pred) {
+		if (!is_own_backedge(be_block, i))
+			ins[c++] = pred;
+	}
 
-	ir_node *const proj            = new_r_Proj(loop_info.duff_cond, mode_X, 0);
-	ir_node *const head_pred       = get_Block_cfgpred(loop_head, loop_info.be_src_pos);
-	ir_node *const loop_condition  = get_unroll_copy(head_pred, unroll_nr - 1);
-	ir_node *const loop_head_ins[] = { loop_condition, proj };
-	set_irn_in(loop_head, ARRAY_SIZE(loop_head_ins), loop_head_ins);
-	DB((dbg, LEVEL_4, "Rewire ins of block loophead %N to pred %N and duffs entry %N \n" , loop_head, loop_head_ins[0], loop_head_ins[1]));
+	ir_mode *const mode   = get_irn_mode(phi);
+	ir_node *const newphi = new_r_Phi(dest_block, c, ins, mode);
 
-	for_each_phi(loop_head, phi) {
-		ir_node *const pred      = get_Phi_pred(phi, loop_info.be_src_pos);
-		/* TODO we think it is a phi, but for Mergesort it is not the case.*/
-		ir_node *const last_pred = get_unroll_copy(pred, unroll_nr - 1);
+	set_irn_link(phi, newphi);
+	DB((dbg, LEVEL_4, "Linking for preheader %N to %N\n", phi, newphi));
+
+	return newphi;
+}
+
+/* Creates a new block from the given block node omitting own bes,
+ * using be_block as supplier of backedge informations. */
+static ir_node *clone_block_sans_bes(ir_graph *const irg, ir_node *const node, ir_node *const be_block)
+{
+	int const arity = get_Block_n_cfgpreds(node);
+	assert(arity == get_irn_arity(be_block));
+
+	int             c   = 0;
+	ir_node **const ins = ALLOCAN(ir_node*, arity);
+	foreach_irn_in(node, i, pred) {
+		if (!is_own_backedge(be_block, i))
+			ins[c++] = pred;
+	}
+
+	return new_r_Block(irg, c, ins);
+}
+
+/* Returns the value of the loop invariant node in the preheader. */
+static ir_node *get_preheader_value(ir_node *const node)
+{
+	if (is_Phi(node) && get_nodes_block(node) == loop_head)
+		return (ir_node*)get_irn_link(node);
+	return node;
+}
+
+/* Creates the computation of the number of passes the unrolled loop makes
+ * through all its copies in block, which is only entered if the iv starts
+ * within the bound.  With count >= 2 passes of the original loop this is
+ * (count - 1) / unroll_nr, so the remainder loop runs 1 to unroll_nr passes.
+ * Computed in the unsigned mode of the iv, where the distance between start
+ * and end value always fits. */
+static ir_node *new_unrolled_passes(ir_graph *const irg, ir_node *const block)
+{
+	ir_node *const start = get_preheader_value(loop_info.start_val);
+	ir_node *const end   = get_preheader_value(loop_info.end_val);
+	ir_mode *const mode  = get_irn_mode(end);
+	ir_mode *const umode = find_unsigned_mode(mode);
+	ir_node *const dist  = loop_info.decreasing
+		? new_r_Sub(block, start, end, mode)
+		: new_r_Sub(block, end, start, mode);
+	ir_node *const udist = new_r_Conv(block, dist, umode);
+
+	ir_tarval *step_tar = get_Const_tarval(loop_info.step);
+	if (tarval_is_negative(step_tar))
+		step_tar = tarval_neg(step_tar);
+	ir_node *const step  = new_r_Const(irg, tarval_convert_to(step_tar, umode));
+	ir_node *const one   = new_r_Const_one(irg, umode);
+	ir_node *const nomem = get_irg_no_mem(irg);
+
+	/* count - 1 == (dist - 1) / step, plus 1 if the condition checks the iv
+	 * before the step. */
+	ir_node *const dist_m1 = new_r_Sub(block, udist, one, umode);
+	ir_node *const div     = new_r_Div(block, nomem, dist_m1, step, umode, false);
+	ir_node       *passes  = new_r_Proj(div, umode, pn_Div_res);
+	if (!loop_info.latest_value)
+		passes = new_r_Add(block, passes, one, umode);
+
+	ir_node *const factor = new_r_Const_long(irg, umode, unroll_nr);
+	ir_node *const groups = new_r_Div(block, nomem, passes, factor, umode, false);
+	return new_r_Proj(groups, umode, pn_Div_res);
+}
+
+/* Invariant unrolling: Enters the unrolled loop from new preheaders and
+ * appends the remainder loop, which is the copy with index unroll_nr.
+ * The unrolled loop passes through all its copies a computed number of
+ * times, counted by a new iv, so the exit tests of its copies are gone and
+ * they form a straight sequence.  The remainder loop keeps the original
+ * exit test and makes the remaining 1 to unroll_nr passes.
+ *
+ *      Preheader
+ *        |     \
+ *      Passes   |
+ *        |   \  |
+ *     Unrolled  |
+ *     loop --.  |
+ *            Remainder
+ *            loop
+ *             |
+ *            Exit
+ */
+static void create_remainder_loop(ir_graph *const irg)
+{
+	int const be_src_pos = loop_info.be_src_pos;
+	int const last       = unroll_nr - 1;
+	int const rest       = unroll_nr;
 
-		ir_node *const phi_ins[] = { last_pred, (ir_node*)get_irn_link(phi) };
+	/* The preheader takes over the entries of the loop head.  The loop makes
+	 * only 1 pass, if the iv does not start within the bound. */
+	ir_node *const preheader = clone_block_sans_bes(irg, loop_head, loop_head);
+	for_each_phi(loop_head, phi) {
+		clone_phis_sans_bes(phi, loop_head, preheader);
+	}
+	DB((dbg, LEVEL_4, "Preheader %N\n", preheader));
+
+	ir_node    *const start       = get_preheader_value(loop_info.start_val);
+	ir_node    *const end         = get_preheader_value(loop_info.end_val);
+	ir_relation const within      = loop_info.decreasing ? ir_relation_greater : ir_relation_less;
+	ir_node    *const within_cmp  = new_r_Cmp(preheader, start, end, within);
+	ir_node    *const within_cond = new_r_Cond(preheader, within_cmp);
+	ir_node    *const enter_count = new_r_Proj(within_cond, mode_X, pn_Cond_true);
+	ir_node    *const skip_count  = new_r_Proj(within_cond, mode_X, pn_Cond_false);
+
+	ir_node *const count_ins[]     = { enter_count };
+	ir_node *const count_block     = new_r_Block(irg, ARRAY_SIZE(count_ins), count_ins);
+	ir_node *const groups          = new_unrolled_passes(irg, count_block);
+	ir_mode *const mode            = get_irn_mode(groups);
+	ir_node *const zero            = new_r_Const_null(irg, mode);
+	ir_node *const enter_cmp       = new_r_Cmp(count_block, groups, zero, ir_relation_greater);
+	ir_node *const enter_cond      = new_r_Cond(count_block, enter_cmp);
+	ir_node *const enter_unrolled  = new_r_Proj(enter_cond, mode_X, pn_Cond_true);
+	ir_node *const skip_unrolled   = new_r_Proj(enter_cond, mode_X, pn_Cond_false);
+
+	/* The remainder loop is entered from the preheaders or after the
+	 * unrolled loop. */
+	ir_node *const unrolled_exit = get_unroll_copy(loop_info.cf_out, last);
+	ir_node *const rest_head     = get_unroll_copy(loop_head, rest);
+	ir_node *const rest_be       = get_Block_cfgpred(rest_head, be_src_pos);
+	ir_node *const rest_ins[]    = { skip_count, skip_unrolled, unrolled_exit, rest_be };
+	for_each_phi(loop_head, phi) {
+		ir_node *const rest_phi  = get_unroll_copy(phi, rest);
+		ir_node *const entry     = (ir_node*)get_irn_link(phi);
+		ir_node *const pred      = get_Phi_pred(phi, be_src_pos);
+		ir_node *const last_pred = is_in_loop(pred) ? get_unroll_copy(pred, last) : pred;
+		ir_node *const phi_ins[] = {
+			entry, entry, last_pred, get_Phi_pred(rest_phi, be_src_pos)
+		};
+		set_irn_in(rest_phi, ARRAY_SIZE(phi_ins), phi_ins);
+	}
+	set_irn_in(rest_head, ARRAY_SIZE(rest_ins), rest_ins);
+	DB((dbg, LEVEL_4, "Remainder loop head %N\n", rest_head));
+
+	/* The unrolled loop is entered after counting its passes. */
+	ir_node *const head_pred       = get_Block_cfgpred(loop_head, be_src_pos);
+	ir_node *const loop_condition  = get_unroll_copy(head_pred, last);
+	ir_node *const loop_head_ins[] = { enter_unrolled, loop_condition };
+	for_each_phi(loop_head, phi) {
+		ir_node *const pred      = get_Phi_pred(phi, be_src_pos);
+		ir_node *const last_pred = is_in_loop(pred) ? get_unroll_copy(pred, last) : pred;
+		ir_node *const phi_ins[] = { (ir_node*)get_irn_link(phi), last_pred };
 		set_irn_in(phi, ARRAY_SIZE(phi_ins), phi_ins);
-		DB((dbg, LEVEL_4, "Rewire ins of loophead phi %N to pred %N and duffs entry %N \n" , phi, phi_ins[0], phi_ins[1]));
 	}
+	set_irn_in(loop_head, ARRAY_SIZE(loop_head_ins), loop_head_ins);
+
+	/* It leaves after groups passes through all copies, only the exit test
+	 * of the last copy remains. */
+	ir_node *const last_cond  = get_unroll_copy(get_Proj_pred(loop_info.cf_out), last);
+	ir_node *const last_block = get_nodes_block(last_cond);
+	ir_node *const one        = new_r_Const_one(irg, mode);
+	ir_node *const pass_ins[] = { zero, new_r_Dummy(irg, mode) };
+	ir_node *const pass       = new_r_Phi(loop_head, ARRAY_SIZE(pass_ins), pass_ins, mode);
+	ir_node *const next_pass  = new_r_Add(last_block, pass, one, mode);
+	set_Phi_pred(pass, 1, next_pass);
+
+	ir_relation const stay = loop_info.exit_cond ? ir_relation_greater_equal : ir_relation_less;
+	set_Cond_selector(last_cond, new_r_Cmp(last_block, next_pass, groups, stay));
+	DB((dbg, LEVEL_4, "Unrolled loop leaves by %N\n", last_cond));
 }
 
 /* Removes previously created phis with only 1 in. */
@@ -1246,6 +1413,11 @@ static void correct_phis(ir_node *const node, void *const env)
 		ir_node  *const in[]  = { get_Phi_pred(node, 0) };
 		ir_mode  *const mode  = get_irn_mode(node);
 		ir_node  *const exch  = new_rd_Phi(dbgi, block, ARRAY_SIZE(in), in, mode);
+		/* the copy of a kept memory Phi is not a loop anymore */
+		if (get_Phi_loop(node)) {
+			remove_keep_alive(node);
+			set_Phi_loop(node, false);
+		}
 		exchange(node, exch);
 	}
 }
@@ -1273,58 +1445,32 @@ static void place_copies(int const copies)
 
 		DB((dbg, LEVEL_5, "topmost be block %N \n", topmost_be_block));
 
-		if (loop_info.unroll_kind == constant) {
-			ir_node *ins[] = { new_jmp };
-			set_irn_in(lower, ARRAY_SIZE(ins), ins);
+		ir_node *ins[] = { new_jmp };
+		set_irn_in(lower, ARRAY_SIZE(ins), ins);
 
-			for_each_phi(loophead, phi) {
-				ir_node *const topmost_def = get_Phi_pred(phi, be_src_pos);
-				ir_node *const upper_def   = get_unroll_copy(topmost_def, c);
-				ir_node *const lower_phi   = get_unroll_copy(phi, c + 1);
+		for_each_phi(loophead, phi) {
+			ir_node *const topmost_def = get_Phi_pred(phi, be_src_pos);
+			ir_node *const upper_def   = get_unroll_copy(topmost_def, c);
+			ir_node *const lower_phi   = get_unroll_copy(phi, c + 1);
 
-				/* It is possible, that the value used
-				 * in the OWN backedge path is NOT defined in this loop. */
-				if (is_in_loop(topmost_def))
-					ins[0] = upper_def;
-				else
-					ins[0] = topmost_def;
-
-				set_irn_in(lower_phi, ARRAY_SIZE(ins), ins);
-				/* Need to replace phis with 1 in later. */
-			}
-		} else {
-			/* Calculate corresponding projection of mod result for this copy c */
-			ir_node *proj = new_r_Proj(loop_info.duff_cond, mode_X, unroll_nr - c - 1);
-			DB((dbg, LEVEL_4, "New duff proj %N\n" , proj));
-
-			/* Invariant case */
-			/* Every node has 2 ins. One from the duff blocks
-			 * and one from the previously unrolled loop. */
-			ir_node *ins[] = { new_jmp, proj };
-			set_irn_in(lower, ARRAY_SIZE(ins), ins);
-			DB((dbg, LEVEL_4, "Rewire ins of Block %N to pred %N and duffs entry %N \n" , lower, ins[0], ins[1]));
-
-			for_each_phi(loophead, phi) {
-				ir_node *const lower_phi = get_unroll_copy(phi, c + 1);
-				ir_node *const duff_phi  = (ir_node*)get_irn_link(phi);
-				DB((dbg, LEVEL_4, "DD Link of %N is %N\n" , phi, duff_phi));
-
-				ir_node *const topmost_phi_pred = get_Phi_pred(phi, be_src_pos);
-				ir_node *const upper_phi_pred   = is_in_loop(topmost_phi_pred) ?
-					get_unroll_copy(topmost_phi_pred, c) : topmost_phi_pred;
-
-				ir_node *phi_ins[] = { upper_phi_pred, duff_phi };
-				set_irn_in(lower_phi, ARRAY_SIZE(phi_ins), phi_ins);
-				DB((dbg, LEVEL_4, "Rewire ins of %N to pred %N and duffs entry %N \n" , lower_phi, phi_ins[0], phi_ins[1]));
-			}
+			/* It is possible, that the value used
+			 * in the OWN backedge path is NOT defined in this loop. */
+			if (is_in_loop(topmost_def))
+				ins[0] = upper_def;
+			else
+				ins[0] = topmost_def;
+
+			set_irn_in(lower_phi, ARRAY_SIZE(ins), ins);
+			/* Need to replace phis with 1 in later. */
 		}
 	}
 
-	/* Reconnect last copy. */
+	/* Reconnect last copy, or the remainder loop in the invariant case. */
+	int const bottom = loop_info.unroll_kind == constant ? copies : unroll_nr;
 	for (size_t i = 0; i < ARR_LEN(loop_entries); ++i) {
 		entry_edge const edge     = loop_entries[i];
 		/* Last copy is at the bottom */
-		ir_node   *const new_pred = get_unroll_copy(edge.pred, copies);
+		ir_node   *const new_pred = get_unroll_copy(edge.pred, bottom);
 		set_irn_n(edge.node, edge.pos, new_pred);
 	}
 
@@ -1346,7 +1492,7 @@ static void place_copies(int const copies)
 			set_irn_n(phi, be_src_pos, last_pred);
 		}
 	} else {
-		unrolling_fix_loop_head_inv();
+		create_remainder_loop(get_irn_irg(loophead));
 	}
 }
 
@@ -1370,175 +1516,6 @@ static void copy_loop(ir_graph *const irg, entry_edge *const cur_loop_outs, int
 }
 
 
-/* Creates a new phi from the given phi node omitting own bes,
- * using be_block as supplier of backedge informations. */
-static ir_node *clone_phis_sans_bes(ir_node *const phi, ir_node *const be_block, ir_node *const dest_block)
-{
-	int const arity = get_Phi_n_preds(phi);
-	assert(arity == get_Block_n_cfgpreds(be_block));
-
-	int             c   = 0;
-	ir_node **const ins = ALLOCAN(ir_node*, arity);
-	foreach_irn_in(phi, i, pred) {
-		if (!is_own_backedge(be_block, i))
-			ins[c++] = pred;
-	}
-
-	ir_mode *const mode   = get_irn_mode(phi);
-	ir_node *const newphi = new_r_Phi(dest_block, c, ins, mode);
-
-	set_irn_link(phi, newphi);
-	DB((dbg, LEVEL_4, "Linking for duffs device %N to %N\n", phi, newphi));
-
-	return newphi;
-}
-
-/* Creates a new block from the given block node omitting own bes,
- * using be_block as supplier of backedge informations. */
-static ir_node *clone_block_sans_bes(ir_graph *const irg, ir_node *const node, ir_node *const be_block)
-{
-	int const arity = get_Block_n_cfgpreds(node);
-	assert(arity == get_irn_arity(be_block));
-
-	int             c   = 0;
-	ir_node **const ins = ALLOCAN(ir_node*, arity);
-	foreach_irn_in(node, i, pred) {
-		if (!is_own_backedge(be_block, i))
-			ins[c++] = pred;
-	}
-
-	return new_r_Block(irg, c, ins);
-}
-
-/* Creates a structure to calculate absolute value of node op.
- * Returns mux node with absolute value. */
-static ir_node *new_Abs(ir_node *const op, ir_mode *const mode)
-{
-	ir_node  *const block    = get_nodes_block(op);
-	ir_graph *const irg      = get_irn_irg(op);
-	ir_node  *const zero     = new_r_Const_null(irg, mode);
-	ir_node  *const cmp      = new_r_Cmp(block, op, zero, ir_relation_less);
-	ir_node  *const minus_op = new_r_Minus(block, op, mode);
-	ir_node  *const mux      = new_r_Mux(block, cmp, op, minus_op, mode);
-	return mux;
-}
-
-
-/* Creates blocks for duffs device, using previously obtained
- * informations about the iv.
- * TODO split */
-static void create_duffs_block(ir_graph *const irg)
-{
-	/* TODO naming
-	 * 1. Calculate first approach to count.
-	 *    Condition: (end - start) % step == 0 */
-	ir_node *const block1 = clone_block_sans_bes(irg, loop_head, loop_head);
-	DB((dbg, LEVEL_4, "Duff block 1 %N\n", block1));
-
-	/* Create loop entry phis in first duff block
-	 * as it becomes the loops preheader */
-	for_each_phi(loop_head, phi) {
-		/* Returns phis pred if phi would have arity 1*/
-		ir_node *const new_phi = clone_phis_sans_bes(phi, loop_head, block1);
-
-		(void)new_phi;
-		DB((dbg, LEVEL_4, "HEAD %N phi %N\n", loop_head, phi));
-		DB((dbg, LEVEL_4, "BLOCK1 %N phi %N\n", block1, new_phi));
-	}
-
-	ir_mode *const mode = get_irn_mode(loop_info.end_val);
-	ir_node *const ems  = new_r_Sub(block1, loop_info.end_val, loop_info.start_val, mode);
-	DB((dbg, LEVEL_4, "BLOCK1 sub %N\n", ems));
-
-	DB((dbg, LEVEL_4, "mod ins %N %N\n", ems, loop_info.step));
-	ir_node *const nomem   = get_irg_no_mem(irg);
-	ir_node *const ems_mod = new_r_Mod(block1, nomem, ems, loop_info.step, mode, true);
-	ir_node *const mod_res = new_r_Proj(ems_mod, mode_Iu, pn_Mod_res);
-
-	ir_node *const ems_div = new_r_Div(block1, nomem, ems, loop_info.step, mode, true);
-	ir_node *const div_res = new_r_Proj(ems_div, mode, pn_Div_res);
-
-	DB((dbg, LEVEL_4, "New modulus node %N\n", ems_mod));
-
-	ir_node *const null          = new_r_Const_null(irg, mode);
-	ir_node *const cmp_null      = new_r_Cmp(block1, mod_res, null, ir_relation_less);
-	ir_node *const ems_mode_cond = new_r_Cond(block1, cmp_null);
-
-	/* ems % step == 0 */
-	ir_node *const x_true  = new_r_Proj(ems_mode_cond, mode_X, pn_Cond_true);
-	/* ems % step != 0 */
-	ir_node *const x_false = new_r_Proj(ems_mode_cond, mode_X, pn_Cond_false);
-
-	/* 2. Second block.
-	 * Assures, duffs device receives a valid count.
-	 * Condition:
-	 *     decreasing: count < 0
-	 *     increasing: count > 0
-	 */
-	ir_node *const count_block_ins[] = { x_true, x_false };
-	ir_node *const count_block       = new_r_Block(irg, ARRAY_SIZE(count_block_ins), count_block_ins);
-	DB((dbg, LEVEL_4, "Duff block 2 %N\n", count_block));
-
-
-	/* Increase loop-taken-count depending on the loop condition
-	 * uses the latest iv to compare to. */
-	ir_node       *true_val;
-	ir_node       *false_val;
-	ir_node *const one = new_r_Const_one(irg, mode);
-	if (loop_info.latest_value == 1) {
-		/* ems % step == 0 :  +0 */
-		true_val  = null;
-		/* ems % step != 0 :  +1 */
-		false_val = one;
-	} else {
-		/* ems % step == 0 :  +1 */
-		true_val  = one;
-		/* ems % step != 0 :  +2 */
-		false_val = new_r_Const_long(irg, mode, 2);
-	}
-
-	ir_node *const correction_ins[] = { true_val, false_val };
-	ir_node *const correction       = new_r_Phi(count_block, ARRAY_SIZE(correction_ins), correction_ins, mode);
-
-	/* (end - start) / step  +  correction */
-	ir_node *const count = new_r_Add(count_block ,div_res, correction, mode);
-
-	/* We preconditioned the loop to be tail-controlled.
-	 * So, if count is something 'wrong' like 0,
-	 * negative/positive (depending on step direction),
-	 * we may take the loop once (tail-contr.) and leave it
-	 * to the existing condition, to break; */
-
-	/* Depending on step direction, we have to check for > or < 0 */
-	ir_relation const rel           = loop_info.decreasing == 1 ? ir_relation_less : ir_relation_greater;
-	ir_node    *const cmp_bad_count = new_r_Cmp(count_block, count, null, rel);
-	ir_node    *const bad_count_neg = new_r_Cond(count_block, cmp_bad_count);
-	ir_node    *const good_count    = new_r_Proj(bad_count_neg, mode_X, pn_Cond_true);
-	ir_node    *const bad_count     = new_r_Proj(ems_mode_cond, mode_X, pn_Cond_false);
-
-	/* 3. Duff Block
-	 *    Contains module to decide which loop to start from. */
-
-	ir_node *const duff_block_ins[] = { good_count, bad_count };
-	ir_node *const duff_block       = new_r_Block(irg, ARRAY_SIZE(duff_block_ins), duff_block_ins);
-	DB((dbg, LEVEL_4, "Duff block 3 %N\n", duff_block));
-
-	/* Get absolute value */
-	ir_node *const abs = new_Abs(count, mode);
-	/* Manually feed the aforementioned count = 1 (bad case)*/
-	ir_node *const count_phi_ins[] = { abs, one };
-	ir_node *const count_phi       = new_r_Phi(duff_block, ARRAY_SIZE(count_phi_ins), count_phi_ins, mode);
-
-	/* count % unroll_nr */
-	ir_node *const unroll_c = new_r_Const_long(irg, mode, (long)unroll_nr);
-	ir_node *const duff_mod = new_r_Mod(duff_block, nomem, count_phi, unroll_c, mode, true);
-	ir_node *const proj     = new_r_Proj(duff_mod, mode, pn_Mod_res);
-	/* condition does NOT create itself in the block of the proj! */
-	ir_node *const cond     = new_r_Cond(duff_block, proj);
-
-	loop_info.duff_cond = cond;
-}
-
 /* Returns 1 if given node is not in loop,
  * or if it is a phi of the loop head with only loop invariant defs.
  */
@@ -1747,6 +1724,47 @@ static unsigned simulate_next(ir_tarval **const count_tar, ir_tarval *const step
 		return 0;
 }
 
+/* Returns the maximum unroll factor keeping the estimated register pressure
+ * of values of one class below the number of registers.  Every copy of the
+ * loop body adds the values defined in the loop, the loop invariant values
+ * are shared by all copies. */
+static unsigned get_max_pressure_unroll(int const float_values,
+                                        unsigned const n_registers)
+{
+	if (n_registers == 0)
+		return UINT_MAX;
+
+	unsigned       invariant;
+	unsigned const pressure = get_loop_register_pressure(cur_loop, float_values, &invariant);
+	unsigned const variant  = pressure - invariant;
+	DB((dbg, LEVEL_4, "%s pressure %u, %u invariant, %u registers\n",
+	    float_values ? "float" : "int", pressure, invariant, n_registers));
+	if (variant == 0)
+		return UINT_MAX;
+	if (pressure > n_registers)
+		return 1;
+	return (n_registers - invariant) / variant;
+}
+
+/* Returns the average number of passes through the loop head per entry of
+ * the loop according to the profile, or UINT_MAX if there is no profile. */
+static unsigned get_profiled_passes(void)
+{
+	uint64_t entries = 0;
+	uint64_t passes  = 0;
+	for (int i = 0, n = get_irn_arity(loop_head); i < n; ++i) {
+		uint32_t count;
+		if (!ir_profile_find_edge_execcount(loop_head, i, &count))
+			return UINT_MAX;
+		passes += count;
+		if (!is_own_backedge(loop_head, i))
+			entries += count;
+	}
+	if (entries == 0)
+		return UINT_MAX;
+	return (unsigned)MIN(passes / entries, UINT_MAX);
+}
+
 /* Check if loop meets requirements for a 'simple loop':
  * - Exactly one cf out
  * - Allowed calls
@@ -1772,6 +1790,21 @@ static ir_node *is_simple_loop(void)
 
 	DB((dbg, LEVEL_4, "maximum unroll factor %u, to not exceed node limit \n", opt_params.max_unrolled_loop_size));
 
+	/* Do not unroll the loop into spilling. */
+	backend_params const *const be_params = be_get_backend_param();
+	unsigned const int_unroll   = get_max_pressure_unroll(false, be_params->n_int_registers);
+	unsigned const float_unroll = get_max_pressure_unroll(true, be_params->n_float_registers);
+	unsigned const max_unroll   = MIN(int_unroll, float_unroll);
+	if (max_unroll < loop_info.max_unroll) {
+		loop_info.max_unroll = max_unroll;
+		if (max_unroll < 2) {
+			++stats.too_much_pressure;
+			return NULL;
+		}
+	}
+
+	DB((dbg, LEVEL_4, "maximum unroll factor %u, to not exceed registers\n", loop_info.max_unroll));
+
 	/* RETURN if we have more than 1 be. */
 	/* Get my backedges without alien bes. */
 	ir_node *loop_block = NULL;
@@ -1831,7 +1864,7 @@ static unsigned are_mode_I(ir_node *const n1, ir_node *const n2, ir_node *const
 
 /* Checks if cur_loop is a simple tail-controlled counting loop
  * with start and end value loop invariant, step constant. */
-static unsigned get_unroll_decision_invariant(ir_graph *const irg)
+static unsigned get_unroll_decision_invariant(void)
 {
 	/* RETURN if loop is not 'simple' */
 	ir_node *const loop_condition = is_simple_loop();
@@ -1839,7 +1872,7 @@ static unsigned get_unroll_decision_invariant(ir_graph *const irg)
 		return 0;
 
 	/* Use a minimal size for the invariant unrolled loop,
-	 * as duffs device produces overhead */
+	 * as the preheader and the remainder loop produce overhead */
 	if (loop_info.nodes < opt_params.invar_unrolling_min_size)
 		return 0;
 
@@ -1875,6 +1908,7 @@ static unsigned get_unroll_decision_invariant(ir_graph *const irg)
 
 		DB((dbg, LEVEL_4, "Got start A  %N\n", loop_info.start_val));
 
+		loop_info.latest_value = 1;
 	} else if (is_Phi(iteration_path)) {
 		loop_info.iteration_phi = iteration_path;
 		DB((dbg, LEVEL_4, "Case 2: Got phi %N\n", loop_info.iteration_phi));
@@ -1920,7 +1954,46 @@ static unsigned get_unroll_decision_invariant(ir_graph *const irg)
 
 	DB((dbg, LEVEL_4, "step is not 0\n"));
 
-	create_duffs_block(irg);
+	/* The iv has to be the minuend. */
+	if (is_Sub(loop_info.add) && get_Sub_right(loop_info.add) != loop_info.step)
+		return 0;
+
+	if (!tarval_is_negative(step_tar) ^ !is_Sub(loop_info.add))
+		loop_info.decreasing = 1;
+
+	/* The number of passes is only computed for loops staying in while the
+	 * iv is below an increasing, or above a decreasing bound. */
+	ir_relation relation = get_Cmp_relation(loop_condition);
+	if (get_Cmp_left(loop_condition) == loop_info.end_val)
+		relation = get_inversed_relation(relation);
+	if (loop_info.exit_cond)
+		relation = get_negated_relation(relation);
+	relation &= ~ir_relation_unordered;
+	DB((dbg, LEVEL_4, "normalized projection %s\n", get_relation_string(relation)));
+	if (relation != (loop_info.decreasing ? ir_relation_greater : ir_relation_less))
+		return 0;
+
+	/* The remainder loop is one more copy of the loop. */
+	if (--loop_info.max_unroll < 2)
+		return 0;
+
+	/* Copies beyond the usual number of passes only run in the remainder
+	 * loop. */
+	unsigned const passes = get_profiled_passes();
+	DB((dbg, LEVEL_4, "profiled passes %u\n", passes));
+	if (passes < loop_info.max_unroll) {
+		if (passes < 2) {
+			++stats.too_few_passes;
+			return 0;
+		}
+		loop_info.max_unroll = passes;
+	}
+
+	/* one copy per vector lane, the remainder loop makes the remaining
+	 * passes */
+	unsigned const lanes = loop_info.vector_lanes;
+	if (lanes > 1 && lanes <= loop_info.max_unroll)
+		loop_info.max_unroll = lanes;
 
 	return loop_info.max_unroll;
 }
@@ -1944,8 +2017,19 @@ static unsigned get_preferred_factor_constant(ir_tarval *const count_tar)
 	 *           Loop2   /      / Loop1   /
 	 *           |   `--'      |      `--'
 	 */
-	/* loop passes % {6, 5, 4, 3, 2} == 0  */
 	ir_mode *const mode = get_irn_mode(loop_info.end_val);
+
+	/* one copy per vector lane */
+	unsigned const lanes = loop_info.vector_lanes;
+	if (lanes > 1 && lanes <= loop_info.max_unroll) {
+		ir_tarval *const lanes_tv = new_tarval_from_long(lanes, mode);
+		if (tarval_is_null(tarval_mod(count_tar, lanes_tv))) {
+			DB((dbg, LEVEL_4, "preferred unroll factor %d for vector lanes\n", lanes));
+			return lanes;
+		}
+	}
+
+	/* loop passes % {6, 5, 4, 3, 2} == 0  */
 	for (unsigned prefer = MIN(loop_info.max_unroll, 6); prefer != 1; --prefer) {
 		ir_tarval *const prefer_tv = new_tarval_from_long(prefer, mode);
 		if (tarval_is_null(tarval_mod(count_tar, prefer_tv))) {
@@ -2150,6 +2234,99 @@ static unsigned get_unroll_decision_constant(void)
 /**
  * Loop unrolling
  */
+/* Walker: collects the Loads and Stores of cur_loop. */
+static void collect_mem_ops(ir_node *const node, void *const env)
+{
+	ir_node ***const mem_ops = (ir_node***)env;
+	if ((is_Load(node) || is_Store(node)) && is_in_loop(node))
+		ARR_APP1(ir_node*, *mem_ops, node);
+}
+
+/* Returns the accessed address of a Load or Store. */
+static ir_node *get_mem_op_ptr(ir_node const *const node)
+{
+	return is_Load(node) ? get_Load_ptr(node) : get_Store_ptr(node);
+}
+
+/* Returns the type of the value of a Load or Store. */
+static ir_type *get_mem_op_type(ir_node const *const node)
+{
+	return is_Load(node) ? get_Load_type(node) : get_Store_type(node);
+}
+
+/* Returns the volatility of a Load or Store. */
+static ir_volatility get_mem_op_volatility(ir_node const *const node)
+{
+	return is_Load(node) ? get_Load_volatility(node)
+	                     : get_Store_volatility(node);
+}
+
+/* Returns the mode of the value of a Load or Store. */
+static ir_mode *get_mem_op_mode(ir_node const *const node)
+{
+	return is_Load(node) ? get_Load_mode(node)
+	                     : get_irn_mode(get_Store_value(node));
+}
+
+/* Returns the number of vector lanes, if cur_loop only moves scalars of one
+ * size through memory and its stores do not alias other memory accesses.
+ * Unrolling such a loop once per lane lines up independent operations for
+ * the lanes of a vector register.  Returns 0 otherwise. */
+static unsigned get_vector_lanes(ir_graph *const irg)
+{
+	if (loop_info.branches > 0 || loop_info.calls > 0)
+		return 0;
+
+	ir_node **mem_ops = NEW_ARR_F(ir_node*, 0);
+	irg_walk_graph(irg, collect_mem_ops, NULL, &mem_ops);
+
+	unsigned lanes     = 0;
+	unsigned size      = 0;
+	bool     has_store = false;
+	for (size_t i = 0, n = ARR_LEN(mem_ops); i < n; ++i) {
+		ir_node *const node = mem_ops[i];
+		ir_mode *const mode = get_mem_op_mode(node);
+		if (get_mem_op_volatility(node) == volatility_is_volatile
+		    || mode_is_reference(mode))
+			goto end;
+		unsigned const op_size = get_mode_size_bytes(mode);
+		if (size != 0 && size != op_size)
+			goto end;
+		size       = op_size;
+		has_store |= is_Store(node);
+	}
+	if (!has_store || size == 0 || size >= opt_params.vector_bytes)
+		goto end;
+
+	/* Stores may only touch memory accessed by the same address in each
+	 * iteration. */
+	for (size_t i = 0, n = ARR_LEN(mem_ops); i < n; ++i) {
+		ir_node *const store = mem_ops[i];
+		if (!is_Store(store))
+			continue;
+		ir_node *const ptr  = get_mem_op_ptr(store);
+		ir_type *const type = get_mem_op_type(store);
+		for (size_t j = 0; j < n; ++j) {
+			ir_node *const other     = mem_ops[j];
+			ir_node *const other_ptr = get_mem_op_ptr(other);
+			if (other == store || other_ptr == ptr)
+				continue;
+			ir_alias_relation const rel = get_alias_relation(ptr, type, size,
+				other_ptr, get_mem_op_type(other), size);
+			if (rel != ir_no_alias)
+				goto end;
+		}
+	}
+
+	lanes = opt_params.vector_bytes / size;
+	DB((dbg, LEVEL_3, "loop %ld streams %u byte values, %u vector lanes\n",
+	    get_loop_loop_nr(cur_loop), size, lanes));
+
+end:
+	DEL_ARR_F(mem_ops);
+	return lanes;
+}
+
 static void unroll_loop(ir_graph *const irg)
 {
 	if (loop_info.nodes <= 0)
@@ -2169,6 +2346,7 @@ static void unroll_loop(ir_graph *const irg)
 	}
 
 	unroll_nr = 0;
+	loop_info.vector_lanes = get_vector_lanes(irg);
 
 	/* get_unroll_decision_constant and invariant are completely
 	 * independent for flexibility.
@@ -2182,7 +2360,7 @@ static void unroll_loop(ir_graph *const irg)
 	} else {
 		/* invariant case? */
 		if (opt_params.allow_invar_unrolling)
-			unroll_nr = get_unroll_decision_invariant(irg);
+			unroll_nr = get_unroll_decision_invariant();
 		if (unroll_nr > 1)
 			loop_info.unroll_kind = invariant;
 	}
@@ -2199,8 +2377,9 @@ static void unroll_loop(ir_graph *const irg)
 		ir_nodemap_init(&map, irg);
 		obstack_init(&obst);
 
-		/* Copies the loop */
-		copy_loop(irg, loop_entries, unroll_nr - 1);
+		/* Copies the loop, the invariant case needs a remainder loop */
+		int const copies = loop_info.unroll_kind == constant ? unroll_nr - 1 : unroll_nr;
+		copy_loop(irg, loop_entries, copies);
 
 		/* Line up the floating copies. */
 		place_copies(unroll_nr - 1);
@@ -2215,6 +2394,8 @@ static void unroll_loop(ir_graph *const irg)
 			++stats.constant_unroll;
 		else
 			++stats.invariant_unroll;
+		if ((unsigned)unroll_nr == loop_info.vector_lanes)
+			++stats.vector_unroll;
 
 		clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
 
@@ -2291,6 +2472,7 @@ static void set_loop_params(void)
 	opt_params.invar_unrolling_min_size =   20;
 	opt_params.max_unrolled_loop_size   =  400;
 	opt_params.max_branches             = 9999;
+	opt_params.vector_bytes             =   16;
 }
 
 /**
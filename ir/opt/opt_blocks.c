@@ -12,6 +12,9 @@
  * Two block are congruent, if they contains only equal calculations.
  */
 #include "iroptimize.h"
+#include <stdbool.h>
+#include <string.h>
+#include "execfreq_t.h"
 #include "ircons.h"
 #include "irgmod.h"
 #include "irgraph_t.h"
@@ -19,6 +22,8 @@
 #include "iropt_t.h"
 #include "array.h"
 #include "irgwalk.h"
+#include "iredges_t.h"
+#include "irtools.h"
 #include "set.h"
 #include "debug.h"
 #include "util.h"
@@ -33,7 +38,6 @@ typedef struct node_t          node_t;
 typedef struct pair_t          pair_t;
 typedef struct phi_t           phi_t;
 typedef struct opcode_key_t    opcode_key_t;
-typedef struct listmap_entry_t listmap_entry_t;
 typedef struct environment_t   environment_t;
 typedef struct pred_t          pred_t;
 
@@ -50,6 +54,7 @@ struct opcode_key_t {
 		void            *addr;  /**< Alias all addresses. */
 		int             intVal; /**< For Conv/Div nodes: strict/remainderless. */
 	} u;
+	unsigned    id;     /**< Dense id of this key, not part of the key itself. */
 };
 
 /** A partition contains all congruent blocks. */
@@ -91,6 +96,9 @@ struct environment_t {
 	set             *opcode2id_map; /**< The opcodeMode->id map. */
 	ir_node         **live_outs;    /**< Live out only nodes. */
 	block_t         *all_blocks;    /**< List of all created blocks. */
+	block_t         **bucket_lists; /**< Block lists indexed by a dense key. */
+	unsigned        *bucket_sizes;  /**< Number of blocks in each bucket. */
+	unsigned        *bucket_keys;   /**< The keys of all non-empty buckets. */
 	struct obstack  obst;           /** obstack for temporary data */
 };
 
@@ -115,21 +123,6 @@ struct pred_t {
 	int     index;  /**< Its input index. */
 };
 
-/**
- * An entry in the list_map.
- */
-struct listmap_entry_t {
-	void            *id;    /**< The id. */
-	block_t         *list;  /**< The associated list for this id. */
-	listmap_entry_t *next;  /**< Link to the next entry in the map. */
-};
-
-/** We must map id's to lists. */
-typedef struct listmap_t {
-	set             *map;    /**< Map id's to listmap_entry_t's */
-	listmap_entry_t *values; /**< List of all values in the map. */
-} listmap_t;
-
 #define get_Block_entry(block)  ((block_t *)get_irn_link(block))
 
 /** The debug module handle. */
@@ -174,63 +167,6 @@ static void dump_list(const char *msg, const block_t *block)
 #define dump_list(msg, list) (void)(msg), (void)(list)
 #endif
 
-/**
- * Compare two pointer values of a listmap.
- */
-static int listmap_cmp_ptr(const void *elt, const void *key, size_t size)
-{
-	(void)size;
-	const listmap_entry_t *e1 = (const listmap_entry_t*)elt;
-	const listmap_entry_t *e2 = (const listmap_entry_t*)key;
-	return e1->id != e2->id;
-}
-
-/**
- * Initializes a listmap.
- *
- * @param map  the listmap
- */
-static void listmap_init(listmap_t *map)
-{
-	map->map    = new_set(listmap_cmp_ptr, 16);
-	map->values = NULL;
-}
-
-/**
- * Terminates a listmap.
- *
- * @param map  the listmap
- */
-static void listmap_term(listmap_t *map)
-{
-	del_set(map->map);
-}
-
-/**
- * Return the associated listmap entry for a given id.
- *
- * @param map  the listmap
- * @param id   the id to search for
- *
- * @return the associated listmap entry for the given id
- */
-static listmap_entry_t *listmap_find(listmap_t *map, void *id)
-{
-	listmap_entry_t key, *entry;
-
-	key.id   = id;
-	key.list = NULL;
-	key.next = NULL;
-	entry    = set_insert(listmap_entry_t, map->map, &key, sizeof(key), hash_ptr(id));
-
-	if (entry->list == NULL) {
-		/* a new entry, put into the list */
-		entry->next = map->values;
-		map->values = entry;
-	}
-	return entry;
-}
-
 /**
  * Calculate the hash value for an opcode map entry.
  *
@@ -387,6 +323,8 @@ static opcode_key_t *opcode(const node_t *node, environment_t *env)
 	key.mode   = get_irn_mode(node->node);
 	key.u.proj = 0;
 	key.u.addr = NULL;
+	/* only used if the key is new */
+	key.id     = set_count(env->opcode2id_map);
 
 	switch (key.code) {
 	case iro_Address:
@@ -470,6 +408,62 @@ static partition_t *split(partition_t *Z, block_t *g, environment_t *env)
 	return Z_prime;
 }
 
+/**
+ * Add a block to the bucket of a dense key.
+ *
+ * @param key  the dense key
+ * @param bl   the block
+ * @param env  the environment
+ */
+static void add_to_bucket(unsigned key, block_t *bl, environment_t *env)
+{
+	size_t n = ARR_LEN(env->bucket_lists);
+	if (key >= n) {
+		size_t new_n = MAX(2 * n, (size_t)key + 1);
+		ARR_RESIZE(block_t*, env->bucket_lists, new_n);
+		ARR_RESIZE(unsigned, env->bucket_sizes, new_n);
+		memset(&env->bucket_lists[n], 0, (new_n - n) * sizeof(*env->bucket_lists));
+		memset(&env->bucket_sizes[n], 0, (new_n - n) * sizeof(*env->bucket_sizes));
+	}
+
+	if (env->bucket_sizes[key]++ == 0)
+		ARR_APP1(unsigned, env->bucket_keys, key);
+	bl->next                = env->bucket_lists[key];
+	env->bucket_lists[key] = bl;
+}
+
+/**
+ * Split a partition by all non-empty buckets and clear them.
+ *
+ * The biggest bucket stays in the partition, so a block is only moved
+ * into a partition of at most half the size of its old one (Hopcroft).
+ *
+ * @param part  the partition to split
+ * @param env   the environment
+ */
+static void split_by_buckets(partition_t *part, environment_t *env)
+{
+	unsigned *keys    = env->bucket_keys;
+	size_t   n_keys   = ARR_LEN(keys);
+	size_t   largest  = 0;
+
+	for (size_t i = 1; i < n_keys; ++i) {
+		if (env->bucket_sizes[keys[i]] > env->bucket_sizes[keys[largest]])
+			largest = i;
+	}
+
+	for (size_t i = 0; i < n_keys; ++i) {
+		unsigned key = keys[i];
+
+		/* Add SPLIT( X, S ) to P. */
+		if (i != largest)
+			split(part, env->bucket_lists[key], env);
+		env->bucket_lists[key] = NULL;
+		env->bucket_sizes[key] = 0;
+	}
+	ARR_SHRINKLEN(keys, 0);
+}
+
 /**
  * Return non-zero if pred should be treated as a input node.
  */
@@ -493,19 +487,14 @@ static int is_input_node(ir_node *pred, ir_node *irn, int index)
  */
 static void propagate_blocks(partition_t *part, environment_t *env)
 {
-	block_t         *ready_blocks = NULL;
-	unsigned        n_ready       = 0;
-	listmap_t       map;
-	listmap_entry_t *iter;
+	block_t *ready_blocks = NULL;
+	unsigned n_ready      = 0;
 
 	DB((dbg, LEVEL_2, " Propagate blocks on part%u\n", part->nr));
 
-	/* Let map be an empty mapping from the range of Opcodes to (local) list of blocks. */
-	listmap_init(&map);
+	/* Map the range of Opcodes to (local) lists of blocks using the buckets. */
 	list_for_each_entry_safe(block_t, bl, next, &part->blocks, block_list) {
-		opcode_key_t    *id;
-		listmap_entry_t *entry;
-		node_t          *node;
+		node_t *node;
 
 		if (list_empty(&bl->nodes)) {
 			bl->next     = ready_blocks;
@@ -554,10 +543,7 @@ static void propagate_blocks(partition_t *part, environment_t *env)
 		}
 
 		/* Add bl to map[opcode(n)]. */
-		id          = opcode(node, env);
-		entry       = listmap_find(&map, id);
-		bl->next    = entry->list;
-		entry->list = bl;
+		add_to_bucket(opcode(node, env)->id, bl, env);
 	}
 
 	/* split out ready blocks */
@@ -578,20 +564,8 @@ static void propagate_blocks(partition_t *part, environment_t *env)
 		}
 	}
 
-	/* for all sets S except one in the range of map do */
-	for (iter = map.values; iter != NULL; iter = iter->next) {
-		block_t *S;
-
-		if (iter->next == NULL) {
-			/* this is the last entry, ignore */
-			break;
-		}
-		S = iter->list;
-
-		/* Add SPLIT( X, S ) to P. */
-		split(part, S, env);
-	}
-	listmap_term(&map);
+	/* for all sets S except the biggest one in the range of map do */
+	split_by_buckets(part, env);
 }
 
 /**
@@ -613,18 +587,20 @@ static void propagate(environment_t *env)
 
 /**
  * Map a block to the phi[block->input] live-trough.
+ *
+ * @return the index of the live-trough plus one
  */
-static void *live_throughs(const block_t *bl, const ir_node *phi)
+static unsigned live_throughs(const block_t *bl, const ir_node *phi)
 {
 	ir_node *input = get_Phi_pred(phi, bl->meet_input);
 
 	/* If this input is inside our block, this
 	   is a live-out and not a live trough.
 	   Live-outs are tested inside propagate, so map all of
-	   them to the "general" value NULL */
+	   them to the "general" value 0 */
 	if (get_nodes_block(input) == bl->block)
-		return NULL;
-	return input;
+		return 0;
+	return get_irn_idx(input) + 1;
 }
 
 /**
@@ -635,10 +611,8 @@ static void *live_throughs(const block_t *bl, const ir_node *phi)
  */
 static void propagate_blocks_live_troughs(partition_t *part, environment_t *env)
 {
-	const ir_node   *meet_block = part->meet_block;
-	listmap_t       map;
-	listmap_entry_t *iter;
-	const ir_node   *phi;
+	const ir_node *meet_block = part->meet_block;
+	const ir_node *phi;
 
 	DB((dbg, LEVEL_2, " Propagate live-troughs on part%u\n", part->nr));
 
@@ -652,33 +626,14 @@ static void propagate_blocks_live_troughs(partition_t *part, environment_t *env)
 			return;
 		}
 
-		/* Let map be an empty mapping from the range of live-troughs to (local) list of blocks. */
-		listmap_init(&map);
-		list_for_each_entry_safe(block_t, bl, next, &part->blocks, block_list) {
-			opcode_key_t    *id;
-			listmap_entry_t *entry;
-
+		/* Map the range of live-troughs to (local) lists of blocks. */
+		list_for_each_entry(block_t, bl, &part->blocks, block_list) {
 			/* Add bl to map[live_trough(bl)]. */
-			id          = (opcode_key_t*)live_throughs(bl, phi);
-			entry       = listmap_find(&map, id);
-			bl->next    = entry->list;
-			entry->list = bl;
+			add_to_bucket(live_throughs(bl, phi), bl, env);
 		}
 
-		/* for all sets S except one in the range of map do */
-		for (iter = map.values; iter != NULL; iter = iter->next) {
-			block_t *S;
-
-			if (iter->next == NULL) {
-				/* this is the last entry, ignore */
-				break;
-			}
-			S = iter->list;
-
-			/* Add SPLIT( X, S ) to P. */
-			split(part, S, env);
-		}
-		listmap_term(&map);
+		/* for all sets S except the biggest one in the range of map do */
+		split_by_buckets(part, env);
 	}
 }
 
@@ -1160,6 +1115,573 @@ static void add_roots(ir_graph *irg, environment_t *env)
 }
 #endif /* GENERAL_SHAPE */
 
+/** Maximum number of node pairs matched in one tail merge attempt. */
+#define TAIL_MERGE_MAX_NODES    256
+/** Minimum number of saved nodes for merging cold tails. */
+#define TAIL_MERGE_MIN_SAVING   2
+/** Minimum number of saved nodes for merging hot tails. */
+#define TAIL_MERGE_HOT_SAVING   16
+/** Execution frequency above which merged tails count as hot. */
+#define TAIL_MERGE_HOT_FREQ     1.0
+
+/** A pair of nodes from two block tails. */
+typedef struct tail_pair_t {
+	ir_node *a;    /**< The node in the first block. */
+	ir_node *b;    /**< The node in the second block. */
+	ir_node *phi;  /**< For inputs: the Phi merging a and b. */
+} tail_pair_t;
+
+/** A tail merge candidate: an input of a meet block. */
+typedef struct tail_cand_t {
+	int      pos;  /**< The input number in the meet block. */
+	unsigned sig;  /**< Signature of the roots of the tail. */
+} tail_cand_t;
+
+/** The tail merging environment. */
+typedef struct tail_env_t {
+	ir_node     *meet;      /**< The current meet block. */
+	ir_node     **phis;     /**< The Phis of the meet block. */
+	ir_node     *b1;        /**< The first block whose tail is matched. */
+	ir_node     *b2;        /**< The second block whose tail is matched. */
+	int         pos1;       /**< Input number of b1 in the meet block. */
+	int         pos2;       /**< Input number of b2 in the meet block. */
+	tail_pair_t *pairs;     /**< The matched node pairs. */
+	tail_pair_t *worklist;  /**< Node pairs waiting to be matched. */
+	tail_pair_t *inputs;    /**< Differing inputs of the tail. */
+} tail_env_t;
+
+/**
+ * Return true if irn may be moved into a merged tail block.
+ */
+static bool is_tail_movable(const ir_node *irn)
+{
+	if (is_Phi(irn) || is_Block(irn) || is_Bad(irn))
+		return false;
+	/* a merged tail ends in a Jmp or Return */
+	if (is_cfop(irn))
+		return is_Return(irn);
+	/* exception flow cannot leave the tail */
+	if (is_fragile_op(irn) && ir_throws_exception(irn))
+		return false;
+	return true;
+}
+
+/**
+ * Return the partner of a node of the tail of block or NULL.
+ */
+static ir_node *get_tail_partner(const ir_node *irn, const ir_node *block)
+{
+	if (is_Block(irn) || get_nodes_block(irn) != block)
+		return NULL;
+	return (ir_node*)get_irn_link(irn);
+}
+
+/**
+ * Match the tails of env->b1 and env->b2 starting at the pair (a, b).
+ */
+static void match_tails(tail_env_t *env, ir_node *a, ir_node *b)
+{
+	tail_pair_t root = { a, b, NULL };
+	ARR_APP1(tail_pair_t, env->worklist, root);
+
+	while (ARR_LEN(env->worklist) > 0) {
+		size_t      len  = ARR_LEN(env->worklist);
+		tail_pair_t pair = env->worklist[len - 1];
+		ARR_SHRINKLEN(env->worklist, len - 1);
+
+		a = pair.a;
+		b = pair.b;
+		if (ARR_LEN(env->pairs) >= TAIL_MERGE_MAX_NODES)
+			continue;
+		if (a == b || is_Block(a) || is_Block(b))
+			continue;
+		if (get_nodes_block(a) != env->b1 || get_nodes_block(b) != env->b2)
+			continue;
+		if (get_irn_link(a) != NULL || get_irn_link(b) != NULL)
+			continue;
+		if (!is_tail_movable(a) || !is_tail_movable(b))
+			continue;
+		if (get_irn_op(a) != get_irn_op(b) ||
+		    get_irn_mode(a) != get_irn_mode(b) ||
+		    get_irn_arity(a) != get_irn_arity(b) ||
+		    !a->op->ops.attrs_equal(a, b))
+			continue;
+
+		set_irn_link(a, b);
+		set_irn_link(b, a);
+		ARR_APP1(tail_pair_t, env->pairs, pair);
+
+		foreach_irn_in(a, i, pred) {
+			tail_pair_t next = { pred, get_irn_n(b, i), NULL };
+			ARR_APP1(tail_pair_t, env->worklist, next);
+		}
+	}
+}
+
+/**
+ * Check that all users of a tail node are inside the tail or use it
+ * as the value leaving the block.
+ *
+ * @param env      the tail environment
+ * @param irn      the tail node
+ * @param partner  the node irn is matched with
+ * @param pos      the input number of the block of irn in the meet block
+ * @param other    the input number of the block of partner in the meet block
+ */
+static bool has_tail_users(const tail_env_t *env, const ir_node *irn,
+                           const ir_node *partner, int pos, int other)
+{
+	const ir_node *block = get_nodes_block(irn);
+
+	foreach_out_edge(irn, edge) {
+		ir_node *user = get_edge_src_irn(edge);
+
+		if (is_End(user))
+			continue;
+		if (is_Block(user)) {
+			if (user != env->meet)
+				return false;
+			continue;
+		}
+		if (get_nodes_block(user) == block) {
+			if (get_irn_link(user) == NULL)
+				return false;
+			continue;
+		}
+		if (!is_Phi(user) || get_nodes_block(user) != env->meet ||
+		    get_edge_src_pos(edge) != pos || get_Phi_pred(user, other) != partner)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Check if the pair (a, b) can be moved into a merged tail.
+ */
+static bool is_valid_tail_pair(const tail_env_t *env, const ir_node *a, const ir_node *b)
+{
+	foreach_irn_in(a, i, pred_a) {
+		ir_node *pred_b    = get_irn_n(b, i);
+		ir_node *partner_a = get_tail_partner(pred_a, env->b1);
+		ir_node *partner_b = get_tail_partner(pred_b, env->b2);
+
+		if (partner_a != NULL || partner_b != NULL) {
+			/* both operands must be merged as well */
+			if (partner_a != pred_b)
+				return false;
+		} else if (pred_a != pred_b) {
+			/* needs a Phi in the tail */
+			ir_mode *mode = get_irn_mode(pred_a);
+			if (!mode_is_data(mode) && mode != mode_M)
+				return false;
+			if (!is_input_node(pred_a, (ir_node*)a, i))
+				return false;
+		}
+	}
+	return has_tail_users(env, a, b, env->pos1, env->pos2)
+	    && has_tail_users(env, b, a, env->pos2, env->pos1);
+}
+
+/**
+ * Remove all pairs from the matched tails that cannot be moved until
+ * the tails are closed under their users and operands.
+ */
+static void restrict_tails(tail_env_t *env)
+{
+	bool changed;
+
+	do {
+		size_t n = ARR_LEN(env->pairs);
+		size_t j = 0;
+
+		changed = false;
+		for (size_t i = 0; i < n; ++i) {
+			tail_pair_t pair = env->pairs[i];
+
+			if (is_valid_tail_pair(env, pair.a, pair.b)) {
+				env->pairs[j++] = pair;
+			} else {
+				set_irn_link(pair.a, NULL);
+				set_irn_link(pair.b, NULL);
+				changed = true;
+			}
+		}
+		ARR_SHRINKLEN(env->pairs, j);
+	} while (changed);
+}
+
+/**
+ * Return the value of the differing inputs (a, b) inside the tail block,
+ * creating a Phi if needed.
+ *
+ * @param env    the tail environment
+ * @param block  the tail block or NULL if only the inputs are counted
+ */
+static ir_node *get_tail_input(tail_env_t *env, ir_node *block, ir_node *a, ir_node *b)
+{
+	if (a == b)
+		return a;
+
+	for (size_t i = 0, n = ARR_LEN(env->inputs); i < n; ++i) {
+		tail_pair_t *input = &env->inputs[i];
+		if (input->a == a && input->b == b)
+			return input->phi;
+	}
+
+	tail_pair_t input = { a, b, NULL };
+	if (block != NULL) {
+		ir_node *in[] = { a, b };
+		input.phi = new_r_Phi(block, ARRAY_SIZE(in), in, get_irn_mode(a));
+	}
+	ARR_APP1(tail_pair_t, env->inputs, input);
+	return input.phi;
+}
+
+/**
+ * Collect the differing inputs of the matched tails.
+ *
+ * @param env    the tail environment
+ * @param block  the tail block or NULL if only the inputs are counted
+ */
+static void collect_tail_inputs(tail_env_t *env, ir_node *block)
+{
+	ARR_SHRINKLEN(env->inputs, 0);
+
+	for (size_t i = 0, n = ARR_LEN(env->phis); i < n; ++i) {
+		ir_node *phi = env->phis[i];
+		ir_node *a   = get_Phi_pred(phi, env->pos1);
+
+		if (get_tail_partner(a, env->b1) == NULL) {
+			ir_node *in = get_tail_input(env, block, a, get_Phi_pred(phi, env->pos2));
+			if (block != NULL)
+				set_Phi_pred(phi, env->pos1, in);
+		}
+	}
+
+	for (size_t i = 0, n = ARR_LEN(env->pairs); i < n; ++i) {
+		ir_node *a = env->pairs[i].a;
+		ir_node *b = env->pairs[i].b;
+
+		foreach_irn_in(a, k, pred_a) {
+			if (get_tail_partner(pred_a, env->b1) != NULL)
+				continue;
+
+			ir_node *in = get_tail_input(env, block, pred_a, get_irn_n(b, k));
+			if (block != NULL && in != pred_a)
+				set_irn_n(a, k, in);
+		}
+	}
+}
+
+/**
+ * Check if merging the matched tails pays off: the merged nodes must
+ * outweigh the new Phis and the additional jump, more so in hot code.
+ */
+static bool is_tail_merge_profitable(tail_env_t *env)
+{
+	unsigned n_nodes = 0;
+	for (size_t i = 0, n = ARR_LEN(env->pairs); i < n; ++i) {
+		/* Projs do not produce code */
+		if (!is_Proj(env->pairs[i].a))
+			++n_nodes;
+	}
+
+	collect_tail_inputs(env, NULL);
+	unsigned n_phis = ARR_LEN(env->inputs);
+
+	double   freq       = get_block_execfreq(env->b1) + get_block_execfreq(env->b2);
+	unsigned min_saving = freq > TAIL_MERGE_HOT_FREQ
+	                    ? TAIL_MERGE_HOT_SAVING : TAIL_MERGE_MIN_SAVING;
+
+	DB((dbg, LEVEL_3, "  tails of %+F and %+F: %u nodes, %u Phis, freq %f\n",
+	    env->b1, env->b2, n_nodes, n_phis, freq));
+	return n_nodes >= n_phis + 1 + min_saving;
+}
+
+/**
+ * Move the matched tails into a new block.
+ */
+static void apply_tail_merge(tail_env_t *env)
+{
+	ir_node  *meet  = env->meet;
+	ir_graph *irg   = get_irn_irg(meet);
+	ir_node  *pred1 = get_Block_cfgpred(meet, env->pos1);
+	ir_node  *pred2 = get_Block_cfgpred(meet, env->pos2);
+	ir_node  *in[2];
+
+	DB((dbg, LEVEL_1, "Merging %zu tail nodes of %+F and %+F\n",
+	    ARR_LEN(env->pairs), env->b1, env->b2));
+
+	if (is_Return(pred1)) {
+		/* the Returns are moved into the tail */
+		in[0] = new_r_Jmp(env->b1);
+		in[1] = new_r_Jmp(env->b2);
+	} else {
+		in[0] = pred1;
+		in[1] = pred2;
+	}
+	ir_node *tail = new_r_Block(irg, ARRAY_SIZE(in), in);
+	set_block_execfreq(tail, get_block_execfreq(env->b1) + get_block_execfreq(env->b2));
+
+	/* route the differing inputs through Phis */
+	collect_tail_inputs(env, tail);
+
+	/* rewire control flow, the second input is removed later */
+	if (!is_Return(pred1))
+		set_Block_cfgpred(meet, env->pos1, new_r_Jmp(tail));
+	set_Block_cfgpred(meet, env->pos2, new_r_Bad(irg, mode_X));
+
+	for (size_t i = 0, n = ARR_LEN(env->pairs); i < n; ++i)
+		set_nodes_block(env->pairs[i].a, tail);
+
+	for (size_t i = 0, n = ARR_LEN(env->pairs); i < n; ++i) {
+		tail_pair_t *pair = &env->pairs[i];
+
+		set_irn_link(pair->a, NULL);
+		set_irn_link(pair->b, NULL);
+		exchange(pair->b, pair->a);
+	}
+}
+
+/**
+ * Try to merge the tails of the blocks at the inputs pos1 and pos2 of
+ * the meet block.
+ *
+ * @return true if the tails were merged
+ */
+static bool try_merge_tails(tail_env_t *env, int pos1, int pos2)
+{
+	ir_node *pred1 = get_Block_cfgpred(env->meet, pos1);
+	ir_node *pred2 = get_Block_cfgpred(env->meet, pos2);
+
+	env->pos1 = pos1;
+	env->pos2 = pos2;
+	env->b1   = get_nodes_block(pred1);
+	env->b2   = get_nodes_block(pred2);
+	if (env->b1 == env->b2)
+		return false;
+
+	ARR_SHRINKLEN(env->pairs, 0);
+	if (is_Return(pred1)) {
+		match_tails(env, pred1, pred2);
+	} else {
+		for (size_t i = 0, n = ARR_LEN(env->phis); i < n; ++i) {
+			ir_node *phi = env->phis[i];
+			match_tails(env, get_Phi_pred(phi, pos1), get_Phi_pred(phi, pos2));
+		}
+	}
+	restrict_tails(env);
+
+	/* merged Returns must be part of the tail */
+	if ((is_Return(pred1) && get_irn_link(pred1) == NULL)
+	    || !is_tail_merge_profitable(env)) {
+		for (size_t i = 0, n = ARR_LEN(env->pairs); i < n; ++i) {
+			set_irn_link(env->pairs[i].a, NULL);
+			set_irn_link(env->pairs[i].b, NULL);
+		}
+		return false;
+	}
+
+	apply_tail_merge(env);
+	return true;
+}
+
+/**
+ * Calculate a signature of the roots of a tail, blocks with different
+ * signatures are not matched.
+ */
+static unsigned tail_signature(const tail_env_t *env, const ir_node *block, int pos)
+{
+	ir_node  *pred = get_Block_cfgpred(env->meet, pos);
+	unsigned sig   = 0;
+
+	if (is_Return(pred)) {
+		foreach_irn_in(pred, i, ret_pred) {
+			if (get_nodes_block(ret_pred) == block)
+				sig = sig * 31 + get_irn_opcode(ret_pred) + 1;
+		}
+		return sig * 31 + iro_Return;
+	}
+
+	for (size_t i = 0, n = ARR_LEN(env->phis); i < n; ++i) {
+		ir_node *root = get_Phi_pred(env->phis[i], pos);
+
+		sig *= 31;
+		if (!is_Block(root) && get_nodes_block(root) == block)
+			sig += get_irn_opcode(root) + 1;
+	}
+	return sig;
+}
+
+/**
+ * Compare two tail candidates by signature and input number.
+ */
+static int cmp_tail_cand(const void *a, const void *b)
+{
+	const tail_cand_t *ca = (const tail_cand_t*)a;
+	const tail_cand_t *cb = (const tail_cand_t*)b;
+
+	if (ca->sig != cb->sig)
+		return ca->sig < cb->sig ? -1 : +1;
+	return ca->pos - cb->pos;
+}
+
+/**
+ * Return true if pred is a control flow input whose tail may be merged.
+ */
+static bool is_tail_candidate(const ir_node *meet, const ir_node *pred)
+{
+	ir_graph *irg = get_irn_irg(meet);
+
+	if (meet == get_irg_end_block(irg) ? !is_Return(pred) : !is_Jmp(pred))
+		return false;
+
+	ir_node *block = get_nodes_block(pred);
+	return block != meet && block != get_irg_start_block(irg);
+}
+
+/**
+ * Merge the tails of the predecessors of a meet block.
+ *
+ * Candidates are sorted by their signature and merged greedily: each
+ * merged tail block is matched against the next candidate.
+ *
+ * @return true if the graph was changed
+ */
+static bool merge_tails_of_block(tail_env_t *env, ir_node *meet)
+{
+	int         n     = get_Block_n_cfgpreds(meet);
+	tail_cand_t *cand = NEW_ARR_F(tail_cand_t, 0);
+	bool        res   = false;
+
+	env->meet = meet;
+	ARR_SHRINKLEN(env->phis, 0);
+	foreach_out_edge(meet, edge) {
+		ir_node *phi = get_edge_src_irn(edge);
+		if (is_Phi(phi))
+			ARR_APP1(ir_node*, env->phis, phi);
+	}
+
+	for (int i = 0; i < n; ++i) {
+		ir_node *pred = get_Block_cfgpred(meet, i);
+
+		if (is_tail_candidate(meet, pred)) {
+			tail_cand_t c = { i, tail_signature(env, get_nodes_block(pred), i) };
+			/* nothing to merge if all roots are live-troughs */
+			if (c.sig != 0)
+				ARR_APP1(tail_cand_t, cand, c);
+		}
+	}
+	QSORT_ARR(cand, cmp_tail_cand);
+
+	bool *dead = XMALLOCNZ(bool, n);
+	for (size_t i = 0, n_cand = ARR_LEN(cand); i < n_cand;) {
+		int    cur = cand[i].pos;
+		size_t k;
+
+		for (k = i + 1; k < n_cand && cand[k].sig == cand[i].sig; ++k) {
+			if (try_merge_tails(env, cur, cand[k].pos)) {
+				dead[cand[k].pos] = true;
+				res               = true;
+			} else {
+				cur = cand[k].pos;
+			}
+		}
+		i = k;
+	}
+
+	if (res) {
+		/* remove the merged inputs of the meet block and its Phis */
+		size_t  n_phis = ARR_LEN(env->phis);
+		ir_node **ins  = XMALLOCN(ir_node*, n);
+		int     j      = 0;
+
+		for (int i = 0; i < n; ++i) {
+			if (!dead[i])
+				ins[j++] = get_Block_cfgpred(meet, i);
+		}
+		set_irn_in(meet, j, ins);
+
+		for (size_t p = 0; p < n_phis; ++p) {
+			ir_node *phi = env->phis[p];
+
+			j = 0;
+			for (int i = 0; i < n; ++i) {
+				if (!dead[i])
+					ins[j++] = get_Phi_pred(phi, i);
+			}
+			if (j == 1)
+				exchange(phi, ins[0]);
+			else
+				set_irn_in(phi, j, ins);
+		}
+		xfree(ins);
+	}
+	xfree(dead);
+	DEL_ARR_F(cand);
+	return res;
+}
+
+/**
+ * Block walker: collect the blocks with at least two tail candidates.
+ */
+static void collect_tail_meets(ir_node *block, void *ctx)
+{
+	ir_node ***meets = (ir_node***)ctx;
+	int        n_cand = 0;
+
+	for (int i = get_Block_n_cfgpreds(block) - 1; i >= 0; --i) {
+		if (is_tail_candidate(block, get_Block_cfgpred(block, i)))
+			++n_cand;
+	}
+	if (n_cand > 1)
+		ARR_APP1(ir_node*, *meets, block);
+}
+
+/**
+ * Merge identical instruction sequences at the end of the predecessors
+ * of control flow meets (tail merging).
+ *
+ * @return true if the graph was changed
+ */
+static bool merge_tails(ir_graph *irg)
+{
+	ir_node **meets = NEW_ARR_F(ir_node*, 0);
+	bool    res     = false;
+
+	irg_block_walk_graph(irg, NULL, collect_tail_meets, &meets);
+	if (ARR_LEN(meets) == 0) {
+		DEL_ARR_F(meets);
+		return false;
+	}
+
+	/* the frequencies decide which tails are hot */
+	ir_estimate_execfreq(irg);
+
+	tail_env_t env;
+	env.phis     = NEW_ARR_F(ir_node*, 0);
+	env.pairs    = NEW_ARR_F(tail_pair_t, 0);
+	env.worklist = NEW_ARR_F(tail_pair_t, 0);
+	env.inputs   = NEW_ARR_F(tail_pair_t, 0);
+
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	irg_walk_graph(irg, firm_clear_link, NULL, NULL);
+
+	for (size_t i = 0, n = ARR_LEN(meets); i < n; ++i) {
+		if (merge_tails_of_block(&env, meets[i]))
+			res = true;
+	}
+
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+
+	DEL_ARR_F(env.inputs);
+	DEL_ARR_F(env.worklist);
+	DEL_ARR_F(env.pairs);
+	DEL_ARR_F(env.phis);
+	DEL_ARR_F(meets);
+	return res;
+}
+
 /* Combines congruent end blocks into one. */
 void shape_blocks(ir_graph *irg)
 {
@@ -1184,7 +1706,10 @@ void shape_blocks(ir_graph *irg)
 	n             = get_irg_last_idx(irg);
 	env.live_outs = NEW_ARR_FZ(ir_node*, n);
 
-	env.all_blocks = NULL;
+	env.all_blocks   = NULL;
+	env.bucket_lists = NEW_ARR_FZ(block_t*, n + 1);
+	env.bucket_sizes = NEW_ARR_FZ(unsigned, n + 1);
+	env.bucket_keys  = NEW_ARR_F(unsigned, 0);
 
 	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_PHI_LIST);
 
@@ -1225,15 +1750,24 @@ void shape_blocks(ir_graph *irg)
 	}
 	ir_free_resources(irg, IR_RESOURCE_IRN_VISITED | IR_RESOURCE_IRN_LINK | IR_RESOURCE_PHI_LIST);
 
+	/* merge the tails of blocks that are not congruent as a whole */
+	if (merge_tails(irg))
+		res = true;
+
 	if (res) {
 		/* control flow changed */
 		clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
 	}
 
 	for (bl = env.all_blocks; bl != NULL; bl = bl->all_next) {
-		DEL_ARR_F(bl->roots);
+		/* already freed by add_roots() */
+		if (bl->roots != NULL)
+			DEL_ARR_F(bl->roots);
 	}
 
+	DEL_ARR_F(env.bucket_keys);
+	DEL_ARR_F(env.bucket_sizes);
+	DEL_ARR_F(env.bucket_lists);
 	DEL_ARR_F(env.live_outs);
 	del_set(env.opcode2id_map);
 	obstack_free(&env.obst, NULL);
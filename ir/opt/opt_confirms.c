@@ -457,3 +457,25 @@ ir_tarval *computed_value_Cmp_Confirm(ir_node *left, ir_node *right,
 
 	return tv;
 }
+
+bool is_Confirm_consumer(const ir_node *user, int pos)
+{
+	switch (get_irn_opcode(user)) {
+	case iro_Cmp:
+		/* see computed_value_Cmp_Confirm() */
+		return true;
+	case iro_Sel:
+		/* bounds check of the array index */
+		return pos == n_Sel_index;
+	case iro_Add:
+	case iro_Sub:
+		/* offsets in address arithmetic */
+		return mode_is_reference(get_irn_mode(user));
+	case iro_Div:
+		return pos == n_Div_right && !value_not_null(get_Div_right(user), NULL);
+	case iro_Mod:
+		return pos == n_Mod_right && !value_not_null(get_Mod_right(user), NULL);
+	default:
+		return false;
+	}
+}
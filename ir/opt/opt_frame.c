@@ -9,17 +9,397 @@
  * @date    15.03.2006
  * @author  Michael Beck
  * @brief
- *   Optimize the frame type by removing unused type members.
+ *   Optimize the frame type by removing unused type members and by sharing
+ *   the slots of address taken locals with disjoint lifetimes.
+ *
+ * The contents of a local are live in the blocks which lie on a path from
+ * one of its accesses to another one.  Two locals whose live blocks are
+ * disjoint are placed as members of a union, so they occupy the same stack
+ * slot.  The union keeps the alias analysis aware of the overlap, except for
+ * the type based one, so slots are not shared if it is enabled.
  */
 #include "iroptimize.h"
+
+#include "analyze_irg_args.h"
+#include "array.h"
+#include "irgmod.h"
 #include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irmemory.h"
+#include "irnode_t.h"
+#include "irtools.h"
+#include "obst.h"
+#include "raw_bitset.h"
 #include "type_t.h"
 #include "irouts_t.h"
 #include "iredges_t.h"
+#include "util.h"
+
+/** An address taken local, which may share its slot. */
+typedef struct slot_t {
+	ir_entity  *entity;
+	ir_node   **members; /**< the Members of the frame selecting the entity */
+	unsigned   *live;    /**< the blocks in which the contents are live */
+	unsigned    size;
+} slot_t;
+
+/** Locals sharing a slot. */
+typedef struct slot_group_t {
+	slot_t  **slots;
+	unsigned *live;  /**< union of the live blocks of the slots */
+} slot_group_t;
+
+typedef struct frame_env_t {
+	struct obstack obst;
+	ir_node      **blocks;       /**< the blocks, numbered from 1 by links */
+	unsigned      *accesses;     /**< blocks accessing the current local */
+	bool           needs_memory; /**< not replaceable by scalars */
+} frame_env_t;
+
+static void number_block(ir_node *block, void *data)
+{
+	frame_env_t *const env = (frame_env_t*)data;
+	ARR_APP1(ir_node*, env->blocks, block);
+	set_irn_link(block, INT_TO_PTR(ARR_LEN(env->blocks)));
+}
+
+static unsigned get_block_number(const ir_node *block)
+{
+	return (unsigned)PTR_TO_INT(get_irn_link(block));
+}
+
+static unsigned n_block_bits(const frame_env_t *env)
+{
+	return ARR_LEN(env->blocks) + 1;
+}
+
+/** Records an access of the current local by @p node. */
+static bool add_access(frame_env_t *env, const ir_node *node)
+{
+	unsigned const nr = get_block_number(get_nodes_block(node));
+	if (nr == 0)
+		return false;
+	rbitset_set(env->accesses, nr);
+	return true;
+}
+
+/**
+ * Returns whether the call @p call neither stores nor returns its pointer
+ * argument @p ptr.
+ */
+static bool is_harmless_call_arg(const ir_node *call, const ir_node *ptr)
+{
+	ir_entity *const callee = get_Call_callee(call);
+	if (callee == NULL || get_Call_ptr(call) == ptr)
+		return false;
+	ir_type *const mtp = get_entity_type(callee);
+	for (size_t i = get_method_n_ress(mtp); i-- > 0;) {
+		ir_mode *const mode = get_type_mode(get_method_res_type(mtp, i));
+		if (mode == NULL || mode_is_reference(mode))
+			return false;
+	}
+	for (size_t i = get_Call_n_params(call); i-- > 0;) {
+		if (get_Call_param(call, i) == ptr
+		    && (get_method_param_access(callee, i) & ptr_access_store))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Collects the blocks accessing memory through the pointer @p ptr, which is
+ * derived from the address of the current local.
+ *
+ * @return false if the address may escape
+ */
+static bool collect_accesses(frame_env_t *env, ir_node *ptr)
+{
+	if (irn_visited_else_mark(ptr))
+		return true;
+
+	foreach_irn_out_r(ptr, i, user) {
+		switch (get_irn_opcode(user)) {
+		case iro_Store:
+			if (get_Store_value(user) == ptr)
+				return false;
+			/* FALLTHROUGH */
+		case iro_Load:
+			if (!add_access(env, user))
+				return false;
+			break;
+
+		case iro_CopyB:
+		case iro_Cmp:
+			env->needs_memory = true;
+			if (!add_access(env, user))
+				return false;
+			break;
+
+		case iro_Call:
+			env->needs_memory = true;
+			if (!is_harmless_call_arg(user, ptr) || !add_access(env, user))
+				return false;
+			break;
+
+		case iro_Member:
+			if (!collect_accesses(env, user))
+				return false;
+			break;
+
+		case iro_Sel:
+			if (!is_Const(get_Sel_index(user)))
+				env->needs_memory = true;
+			if (!collect_accesses(env, user))
+				return false;
+			break;
+
+		case iro_Add:
+		case iro_Sub:
+			env->needs_memory = true;
+			if (!mode_is_reference(get_irn_mode(user))) {
+				/* a pointer difference only observes the address */
+				if (!add_access(env, user))
+					return false;
+			} else if (!collect_accesses(env, user)) {
+				return false;
+			}
+			break;
+
+		case iro_Confirm:
+			env->needs_memory = true;
+			if (get_Confirm_value(user) != ptr) {
+				if (!add_access(env, user))
+					return false;
+			} else if (!collect_accesses(env, user)) {
+				return false;
+			}
+			break;
+
+		case iro_Mux:
+		case iro_Phi:
+			env->needs_memory = true;
+			if (!collect_accesses(env, user))
+				return false;
+			break;
+
+		default:
+			/* Return, Conv, Builtin, ...: the address escapes */
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Marks the blocks reachable from the blocks in @p set in @p set, following
+ * the control flow forwards or backwards.
+ */
+static void close_blocks(const frame_env_t *env, unsigned *set, bool forward)
+{
+	unsigned const n_bits = n_block_bits(env);
+	unsigned      *stack  = NEW_ARR_F(unsigned, 0);
+	rbitset_foreach(set, n_bits, nr) {
+		ARR_APP1(unsigned, stack, (unsigned)nr);
+	}
+	while (ARR_LEN(stack) > 0) {
+		size_t   const top   = ARR_LEN(stack) - 1;
+		ir_node *const block = env->blocks[stack[top] - 1];
+		ARR_SHRINKLEN(stack, top);
+		unsigned const n     = forward ? get_Block_n_cfg_outs(block)
+		                               : (unsigned)get_Block_n_cfgpreds(block);
+		for (unsigned i = 0; i < n; ++i) {
+			ir_node *const next = forward ? get_Block_cfg_out(block, i)
+			                              : get_Block_cfgpred_block(block, i);
+			if (next == NULL)
+				continue;
+			unsigned const nr = get_block_number(next);
+			if (nr != 0 && !rbitset_is_set(set, nr)) {
+				rbitset_set(set, nr);
+				ARR_APP1(unsigned, stack, nr);
+			}
+		}
+	}
+	DEL_ARR_F(stack);
+}
+
+/**
+ * Computes the live blocks of the local @p slot, or returns false if it is
+ * not address taken or its address escapes.
+ */
+static bool compute_live_blocks(frame_env_t *env, slot_t *slot)
+{
+	ir_graph *const irg    = get_irn_irg(slot->members[0]);
+	unsigned  const n_bits = n_block_bits(env);
+	rbitset_clear_all(env->accesses, n_bits);
+	env->needs_memory = false;
+
+	inc_irg_visited(irg);
+	for (size_t i = 0, n = ARR_LEN(slot->members); i < n; ++i) {
+		if (!collect_accesses(env, slot->members[i]))
+			return false;
+	}
+	if (!env->needs_memory || rbitset_is_empty(env->accesses, n_bits))
+		return false;
+
+	unsigned *const backward = rbitset_alloca(n_bits);
+	rbitset_copy(backward, env->accesses, n_bits);
+	close_blocks(env, backward, false);
+
+	slot->live = rbitset_obstack_alloc(&env->obst, n_bits);
+	rbitset_copy(slot->live, env->accesses, n_bits);
+	close_blocks(env, slot->live, true);
+	rbitset_and(slot->live, backward, n_bits);
+	return true;
+}
+
+static int cmp_slot_size(const void *a, const void *b)
+{
+	slot_t const *const sa = *(slot_t const *const*)a;
+	slot_t const *const sb = *(slot_t const *const*)b;
+	return QSORT_CMP(sb->size, sa->size);
+}
+
+/** Places the locals of @p group as members of a union in one frame slot. */
+static void merge_slots(ir_graph *irg, const slot_group_t *group)
+{
+	ir_type  *const frame_tp = get_irg_frame_type(irg);
+	ir_type  *const union_tp = new_type_union(id_unique("frame_slot.%u"));
+	unsigned        size     = 0;
+	unsigned        align    = 1;
+	for (size_t i = 0, n = ARR_LEN(group->slots); i < n; ++i) {
+		ir_entity *const entity = group->slots[i]->entity;
+		ir_type   *const type   = get_entity_type(entity);
+		ir_entity *const member
+			= new_entity(union_tp, get_entity_ident(entity), type);
+		set_entity_offset(member, 0);
+		set_entity_volatility(member, get_entity_volatility(entity));
+		set_entity_link(entity, member);
+		size  = MAX(size, get_type_size(type));
+		align = MAX(align, get_type_alignment(type));
+	}
+	set_type_size(union_tp, size);
+	set_type_alignment(union_tp, align);
+	set_type_state(union_tp, layout_fixed);
+
+	ir_entity *const shared = new_entity(frame_tp, id_unique("slot.%u"),
+	                                     union_tp);
+	ir_node   *const frame  = get_irg_frame(irg);
+	ir_node   *const start  = get_irg_start_block(irg);
+	ir_node   *const base   = new_r_Member(start, frame, shared);
+	for (size_t i = 0, n = ARR_LEN(group->slots); i < n; ++i) {
+		slot_t    *const slot   = group->slots[i];
+		ir_entity *const member = (ir_entity*)get_entity_link(slot->entity);
+		for (size_t m = 0, n_members = ARR_LEN(slot->members); m < n_members;
+		     ++m) {
+			ir_node *const old   = slot->members[m];
+			ir_node *const block = get_nodes_block(old);
+			exchange(old, new_rd_Member(get_irn_dbg_info(old), block, base,
+			                            member));
+		}
+		free_entity(slot->entity);
+	}
+}
+
+/**
+ * Shares the slots of address taken locals whose contents are never live
+ * at the same time.
+ *
+ * @return true if slots were shared
+ */
+static bool share_slots(ir_graph *irg)
+{
+	ir_type *const frame_tp = get_irg_frame_type(irg);
+	if (get_type_state(frame_tp) == layout_fixed
+	    || (get_irg_memory_disambiguator_options(irg) & aa_opt_type_based))
+		return false;
+
+	frame_env_t env;
+	obstack_init(&env.obst);
+	env.blocks = NEW_ARR_F(ir_node*, 0);
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	irg_walk_graph(irg, firm_clear_link, NULL, NULL);
+	irg_block_walk_graph(irg, number_block, NULL, &env);
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_VISITED);
+	unsigned const n_bits = n_block_bits(&env);
+	env.accesses = rbitset_obstack_alloc(&env.obst, n_bits);
+
+	/* collect the Members selecting each local */
+	for (size_t i = get_compound_n_members(frame_tp); i-- > 0;) {
+		ir_entity *const entity = get_compound_member(frame_tp, i);
+		set_entity_link(entity, NULL);
+	}
+	slot_t **slots = NEW_ARR_F(slot_t*, 0);
+	ir_node *const frame = get_irg_frame(irg);
+	foreach_irn_out_r(frame, i, member) {
+		if (!is_Member(member))
+			continue;
+		ir_entity *const entity = get_Member_entity(member);
+		ir_type   *const type   = get_entity_type(entity);
+		if (get_entity_owner(entity) != frame_tp
+		    || is_parameter_entity(entity) || get_type_size(type) == 0
+		    || get_type_state(type) != layout_fixed)
+			continue;
+		slot_t *slot = (slot_t*)get_entity_link(entity);
+		if (slot == NULL) {
+			slot = OALLOCZ(&env.obst, slot_t);
+			slot->entity  = entity;
+			slot->members = NEW_ARR_F(ir_node*, 0);
+			slot->size    = get_type_size(type);
+			set_entity_link(entity, slot);
+			ARR_APP1(slot_t*, slots, slot);
+		}
+		ARR_APP1(ir_node*, slot->members, member);
+	}
+
+	/* greedily assign the largest locals first */
+	slot_group_t *groups = NEW_ARR_F(slot_group_t, 0);
+	QSORT_ARR(slots, cmp_slot_size);
+	for (size_t i = 0, n = ARR_LEN(slots); i < n; ++i) {
+		slot_t *const slot = slots[i];
+		if (!compute_live_blocks(&env, slot))
+			continue;
+		slot_group_t *group = NULL;
+		for (size_t g = 0, n_groups = ARR_LEN(groups); g < n_groups; ++g) {
+			if (!rbitsets_have_common(groups[g].live, slot->live, n_bits)) {
+				group = &groups[g];
+				break;
+			}
+		}
+		if (group == NULL) {
+			slot_group_t const new_group = {
+				.slots = NEW_ARR_F(slot_t*, 0),
+				.live  = rbitset_obstack_alloc(&env.obst, n_bits),
+			};
+			ARR_APP1(slot_group_t, groups, new_group);
+			group = &groups[ARR_LEN(groups) - 1];
+		}
+		ARR_APP1(slot_t*, group->slots, slot);
+		rbitset_or(group->live, slot->live, n_bits);
+	}
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_IRN_VISITED);
+
+	bool changed = false;
+	for (size_t g = 0, n_groups = ARR_LEN(groups); g < n_groups; ++g) {
+		if (ARR_LEN(groups[g].slots) > 1) {
+			merge_slots(irg, &groups[g]);
+			changed = true;
+		}
+		DEL_ARR_F(groups[g].slots);
+	}
+	DEL_ARR_F(groups);
+
+	for (size_t i = 0, n = ARR_LEN(slots); i < n; ++i) {
+		DEL_ARR_F(slots[i]->members);
+	}
+	DEL_ARR_F(slots);
+	DEL_ARR_F(env.blocks);
+	obstack_free(&env.obst, NULL);
+	return changed;
+}
 
 /*
  * Optimize the frame type of an irg by removing
- * never touched entities.
+ * never touched entities and sharing slots of disjoint locals.
  */
 void opt_frame_irg(ir_graph *irg)
 {
@@ -67,11 +447,23 @@ void opt_frame_irg(ir_graph *irg)
 		/* we changed the frame type, its layout should be redefined */
 		set_type_state(frame_tp, layout_undefined);
 	}
+	bool const shared = share_slots(irg);
+	if (shared)
+		set_type_state(frame_tp, layout_undefined);
 	irp_free_resources(irp, IRP_RESOURCE_ENTITY_LINK);
 
 	/* we changed the type, this affects none of the currently known graph
 	 * properties, but I don't use ALL because I don't know if someone adds
-	 * type-based properties at some point */
+	 * type-based properties at some point.  Sharing slots replaces Members,
+	 * which invalidates the outs and the entity usage. */
+	if (shared) {
+		confirm_irg_properties(irg,
+			IR_GRAPH_PROPERTIES_CONTROL_FLOW
+			| IR_GRAPH_PROPERTY_NO_BADS
+			| IR_GRAPH_PROPERTY_NO_TUPLES
+			| IR_GRAPH_PROPERTY_MANY_RETURNS);
+		return;
+	}
 	confirm_irg_properties(irg,
 		IR_GRAPH_PROPERTIES_CONTROL_FLOW
 		| IR_GRAPH_PROPERTY_NO_BADS
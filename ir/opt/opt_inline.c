@@ -45,41 +45,24 @@
 #include "irtools.h"
 #include "iropt_dbg.h"
 #include "irnodemap.h"
+#include "irclone.h"
+#include "irprofile.h"
 
 DEBUG_ONLY(static firm_dbg_module_t *dbg;)
 
-/**
- * Remember the new node in the old node by using a field all nodes have.
- */
-static void set_new_node(ir_node *node, ir_node *new_node)
-{
-	set_irn_link(node, new_node);
-}
-
-/**
- * Get this new node, before the old node is forgotten.
- */
-static inline ir_node *get_new_node(ir_node *old_node)
-{
-	assert(irn_visited(old_node));
-	return (ir_node*) get_irn_link(old_node);
-}
-
 /**
  * Copy node for inlining.  Updates attributes that change when
  * inlining but not for dead node elimination.
  *
- * Copies the node by calling copy_node() and then updates the entity if
- * it's a local one.  env must be a pointer of the frame type of the
- * inlined procedure. The new entities must be in the link field of
+ * Copies the node by calling ir_cloner_copy() and then updates the entity if
+ * it's a local one.  The new entities must be in the link field of
  * the entities.
  */
 static void copy_node_inline(ir_node *node, void *env)
 {
-	ir_graph *new_irg  = (ir_graph*) env;
-	ir_node  *new_node = irn_copy_into_irg(node, new_irg);
+	ir_cloner_t *cloner   = (ir_cloner_t*)env;
+	ir_node     *new_node = ir_cloner_copy(cloner, node);
 
-	set_new_node(node, new_node);
 	if (is_Member(node)) {
 		ir_graph  *old_irg        = get_irn_irg(node);
 		ir_type   *old_frame_type = get_irg_frame_type(old_irg);
@@ -94,16 +77,19 @@ static void copy_node_inline(ir_node *node, void *env)
 	}
 }
 
-static void set_preds_inline(ir_node *node, void *env)
+/**
+ * Sets the predecessors of the copied nodes and moves constants into the
+ * start block.
+ */
+static void set_preds_inline(ir_cloner_t *cloner)
 {
-	irn_rewire_inputs(node);
-
-	/* move constants into start block */
-	ir_node *new_node = get_new_node(node);
-	if (is_irn_start_block_placed(new_node)) {
-		ir_graph *new_irg     = (ir_graph *) env;
-		ir_node  *start_block = get_irg_start_block(new_irg);
-		set_nodes_block(new_node, start_block);
+	ir_cloner_rewire(cloner);
+
+	ir_node *start_block = get_irg_start_block(cloner->irg);
+	for (size_t i = 0, n = ARR_LEN(cloner->cloned); i < n; ++i) {
+		ir_node *new_node = ir_cloner_get(cloner, cloner->cloned[i]);
+		if (is_irn_start_block_placed(new_node))
+			set_nodes_block(new_node, start_block);
 	}
 }
 
@@ -314,8 +300,14 @@ static void copy_parameter_entities(ir_node *call, ir_graph *called_graph)
 	}
 }
 
-/* Inlines a method at the given call site. */
-static bool inline_method(ir_node *const call, ir_graph *called_graph)
+/**
+ * Inlines a method at the given call site.
+ *
+ * @param cloner  a cloner for called_graph, maps the nodes of called_graph
+ *                to their copies afterwards
+ */
+static bool inline_method(ir_node *const call, ir_graph *called_graph,
+                          ir_cloner_t *cloner)
 {
 	/* we cannot inline some types of calls */
 	if (!can_inline(call, called_graph))
@@ -414,22 +406,22 @@ static bool inline_method(ir_node *const call, ir_graph *called_graph)
 	 * Note: this will prohibit predecessors to be copied - only do it for
 	 *       nodes without predecessors */
 	ir_node *start_block = get_irg_start_block(called_graph);
-	set_new_node(start_block, get_nodes_block(pre_call));
+	ir_cloner_map(cloner, start_block, get_nodes_block(pre_call));
 	mark_irn_visited(start_block);
 
 	ir_node *start = get_irg_start(called_graph);
-	set_new_node(start, pre_call);
+	ir_cloner_map(cloner, start, pre_call);
 	mark_irn_visited(start);
 
 	ir_node *nomem = get_irg_no_mem(called_graph);
-	set_new_node(nomem, get_irg_no_mem(irg));
+	ir_cloner_map(cloner, nomem, get_irg_no_mem(irg));
 	mark_irn_visited(nomem);
 
 	/* copy entities and nodes */
 	assert(!irn_visited(get_irg_end(called_graph)));
 	copy_frame_entities(called_graph, irg);
-	irg_walk_core(get_irg_end(called_graph), copy_node_inline, set_preds_inline,
-	              irg);
+	irg_walk_core(get_irg_end(called_graph), copy_node_inline, NULL, cloner);
+	set_preds_inline(cloner);
 
 	irp_free_resources(irp, IRP_RESOURCE_ENTITY_LINK);
 
@@ -448,8 +440,8 @@ static bool inline_method(ir_node *const call, ir_graph *called_graph)
 	*/
 
 	/* Precompute some values */
-	ir_node *end_bl = get_new_node(get_irg_end_block(called_graph));
-	ir_node *end    = get_new_node(get_irg_end(called_graph));
+	ir_node *end_bl = ir_cloner_get(cloner, get_irg_end_block(called_graph));
+	ir_node *end    = ir_cloner_get(cloner, get_irg_end(called_graph));
 	int      arity  = get_Block_n_cfgpreds(end_bl); /* arity = n_exc + n_ret  */
 	int      n_res  = get_method_n_ress(get_Call_type(call));
 
@@ -631,10 +623,10 @@ static bool inline_method(ir_node *const call, ir_graph *called_graph)
 			end_preds[main_end_bl_arity + i] = cf_pred[i];
 		set_irn_in(main_end_bl, n_exc + main_end_bl_arity, end_preds);
 		call_x_exc = new_r_Bad(irg, mode_X);
-		free(end_preds);
+		xfree(end_preds);
 	}
-	free(res_pred);
-	free(cf_pred);
+	xfree(res_pred);
+	xfree(cf_pred);
 
 	ir_node *call_in[pn_Call_max+1] = {
 		[pn_Call_M]         = call_mem,
@@ -658,7 +650,23 @@ static bool inline_method(ir_node *const call, ir_graph *called_graph)
 	return true;
 }
 
+/**
+ * With a profile loaded, a call site is cold if it runs less than
+ * 1/PROFILE_COLD_RATIO times as often as the hottest block of the program and
+ * hot if it runs at least 1/PROFILE_HOT_RATIO times as often.
+ */
+#define PROFILE_COLD_RATIO       1000
+#define PROFILE_HOT_RATIO        10
+/** Hot call sites may grow their caller up to this multiple of maxsize. */
+#define PROFILE_HOT_SIZE_FACTOR  2
+/** With a profile loaded, inlining may grow the module by at most this
+ * percentage of its initial size. */
+#define PROFILE_MODULE_GROWTH    100
+
 static struct obstack  temp_obst;
+static uint32_t        max_execcount;   /**< highest profiled execution count */
+static unsigned long   module_nodes;    /**< current number of nodes of the module */
+static unsigned long   module_limit;    /**< limit for module_nodes */
 
 /** Represents a possible inlinable call in a graph. */
 typedef struct call_entry {
@@ -667,6 +675,8 @@ typedef struct call_entry {
 	list_head  list;        /**< List head for linking the next one. */
 	int        loop_depth;  /**< The loop depth of this call. */
 	int        benefice;    /**< The calculated benefice of this call. */
+	size_t     queued;      /**< Handle in the priority queue of calls. */
+	int64_t    count;       /**< Profiled execution count, -1 if unknown. */
 	bool       all_const:1; /**< Set if this call has only constant parameters. */
 } call_entry;
 
@@ -683,6 +693,7 @@ typedef struct {
 	unsigned  n_call_nodes_orig; /**< for statistics */
 	unsigned  n_callers;         /**< Number of known graphs that call this graphs. */
 	unsigned  n_callers_orig;    /**< for statistics */
+	int64_t   entry_count;       /**< Profiled execution count of the start block, -1 if unknown. */
 	unsigned  got_inline:1;      /**< Set, if at least one call inside this graph was inlined. */
 	unsigned  recursive:1;       /**< Set, if this function is self recursive. */
 } inline_irg_env;
@@ -702,6 +713,7 @@ static inline_irg_env *alloc_inline_irg_env(void)
 	env->n_call_nodes_orig = 0;
 	env->n_callers         = 0;
 	env->n_callers_orig    = 0;
+	env->entry_count       = -1;
 	env->got_inline        = 0;
 	env->recursive         = 0;
 	return env;
@@ -712,6 +724,35 @@ typedef struct walker_env {
 	bool            ignore_callers; /**< if set, do change callers data */
 } wenv_t;
 
+/**
+ * Returns the profiled execution count of a block, -1 if unknown.
+ */
+static int64_t get_block_count(const ir_node *block)
+{
+	uint32_t count;
+	if (max_execcount > 0 && ir_profile_find_block_execcount(block, &count))
+		return count;
+	return -1;
+}
+
+/**
+ * Returns true if the profile shows that a call is rarely executed.
+ */
+static bool is_cold_call(const call_entry *entry)
+{
+	return entry->count >= 0
+	    && (uint64_t)entry->count * PROFILE_COLD_RATIO < max_execcount;
+}
+
+/**
+ * Returns true if the profile shows that a call is frequently executed.
+ */
+static bool is_hot_call(const call_entry *entry)
+{
+	return entry->count >= 0
+	    && (uint64_t)entry->count * PROFILE_HOT_RATIO >= max_execcount;
+}
+
 static bool is_nop(const ir_node *node)
 {
 	unsigned code = get_irn_opcode(node);
@@ -784,6 +825,8 @@ static void collect_calls2(ir_node *node, void *ctx)
 		entry->callee     = callee;
 		entry->loop_depth = get_irn_loop(get_nodes_block(node))->depth;
 		entry->benefice   = 0;
+		entry->queued     = PQUEUE_NO_HANDLE;
+		entry->count      = get_block_count(get_nodes_block(node));
 		entry->all_const  = false;
 
 		list_add_tail(&entry->list, &x->calls);
@@ -797,17 +840,31 @@ static void collect_calls2(ir_node *node, void *ctx)
  * @param new_call  the new call node
  * @param loop_depth_delta
  *                  delta value for the loop depth
+ * @param site      the entry of the inlined call containing entry
+ * @param entry_count
+ *                  the profiled execution count of the inlined graph
  */
 static call_entry *duplicate_call_entry(const call_entry *entry,
-                                        ir_node *new_call, int loop_depth_delta)
+                                        ir_node *new_call, int loop_depth_delta,
+                                        const call_entry *site,
+                                        int64_t entry_count)
 {
 	call_entry *nentry = OALLOC(&temp_obst, call_entry);
 	nentry->call       = new_call;
 	nentry->callee     = entry->callee;
 	nentry->benefice   = entry->benefice;
+	nentry->queued     = PQUEUE_NO_HANDLE;
 	nentry->loop_depth = entry->loop_depth + loop_depth_delta;
 	nentry->all_const  = entry->all_const;
 
+	/* the inlined call now runs for this call site only: scale its count */
+	nentry->count = -1;
+	if (entry->count >= 0 && site->count >= 0 && entry_count > 0) {
+		uint64_t const count
+			= (uint64_t)entry->count * (uint64_t)site->count / (uint64_t)entry_count;
+		nentry->count = MIN(count, UINT32_MAX);
+	}
+
 	return nentry;
 }
 
@@ -992,6 +1049,10 @@ static int calc_inline_benefice(call_entry *entry, ir_graph *callee)
 	if (callee_env->n_call_nodes == 0)
 		weight += 400;
 
+	/* profiled hot call sites are more important than the static estimate */
+	if (is_hot_call(entry))
+		weight += 2048;
+
 	/** it's important to inline inner loops first */
 	if (entry->loop_depth > 30)
 		weight += 30 * 1024;
@@ -1023,15 +1084,19 @@ static void callgraph_walker(ir_graph *irg, void *data)
 }
 
 /**
- * Creates an inline order for all graphs.
+ * Creates an inline order for all graphs.  The graphs are sorted by their
+ * level in the callgraph: A graph only calls graphs of lower levels, except
+ * for recursion.  So the graphs of one level are independent of each other.
+ *
+ * @param level_ends  returns an array with the end index of every level
  *
  * @return the list of graphs.
  */
-static ir_graph **create_irg_list(void)
+static ir_graph **create_irg_list(size_t **level_ends)
 {
 	ir_entity **free_methods;
 	cgana(&free_methods);
-	free(free_methods);
+	xfree(free_methods);
 
 	compute_callgraph();
 
@@ -1043,9 +1108,48 @@ static ir_graph **create_irg_list(void)
 	callgraph_walk(NULL, callgraph_walker, &env);
 	assert(n_irgs == env.last_irg);
 
+	/* the walker visits callees before their callers, except for recursion */
+	size_t  last_idx = get_irp_last_idx();
+	size_t *level    = XMALLOCNZ(size_t, last_idx);
+	bool   *assigned = XMALLOCNZ(bool, last_idx);
+	size_t  n_levels = 0;
+	for (size_t i = 0; i < n_irgs; ++i) {
+		ir_graph *irg = env.irgs[i];
+		size_t    l   = 0;
+		for (size_t j = 0, n = get_irg_n_callees(irg); j < n; ++j) {
+			size_t const callee_idx = get_irg_idx(get_irg_callee(irg, j));
+			if (assigned[callee_idx])
+				l = MAX(l, level[callee_idx] + 1);
+		}
+		size_t const idx = get_irg_idx(irg);
+		level[idx]    = l;
+		assigned[idx] = true;
+		n_levels      = MAX(n_levels, l + 1);
+	}
 	free_callgraph();
 
-	return env.irgs;
+	/* stable counting sort by level */
+	size_t *ends = NEW_ARR_FZ(size_t, n_levels);
+	for (size_t i = 0; i < n_irgs; ++i)
+		++ends[level[get_irg_idx(env.irgs[i])]];
+	for (size_t l = 1; l < n_levels; ++l)
+		ends[l] += ends[l - 1];
+	ir_graph **irgs = XMALLOCN(ir_graph*, n_irgs);
+	for (size_t i = n_irgs; i-- > 0;) {
+		ir_graph *irg = env.irgs[i];
+		irgs[--ends[level[get_irg_idx(irg)]]] = irg;
+	}
+	/* ends now contains the begin of every level */
+	for (size_t l = 0; l + 1 < n_levels; ++l)
+		ends[l] = ends[l + 1];
+	if (n_levels > 0)
+		ends[n_levels - 1] = n_irgs;
+
+	xfree(assigned);
+	xfree(level);
+	xfree(env.irgs);
+	*level_ends = ends;
+	return irgs;
 }
 
 /**
@@ -1059,6 +1163,8 @@ static ir_graph **create_irg_list(void)
 static void maybe_push_call(pqueue_t *pqueue, call_entry *call,
                             int inline_threshold)
 {
+	call->queued = PQUEUE_NO_HANDLE;
+
 	ir_graph                  *caller       = get_irn_irg(call->call);
 	ir_entity                 *caller_ent   = get_irg_entity(caller);
 	mtp_additional_properties  caller_props = get_entity_additional_properties(caller_ent);
@@ -1078,6 +1184,12 @@ static void maybe_push_call(pqueue_t *pqueue, call_entry *call,
 		return;
 	}
 
+	if (!(callee_props & mtp_property_always_inline) && is_cold_call(call)) {
+		DB((dbg, LEVEL_2, "Do not inline cold %+F into %+F\n",
+		    call->call, caller));
+		return;
+	}
+
 	int benefice = calc_inline_benefice(call, callee);
 	DB((dbg, LEVEL_2, "In %+F Call %+F to %+F has benefice %d\n",
 	    get_irn_irg(call->call), call->call, callee, benefice));
@@ -1086,7 +1198,22 @@ static void maybe_push_call(pqueue_t *pqueue, call_entry *call,
 		return;
 	}
 
-	pqueue_put(pqueue, call, benefice);
+	call->queued = pqueue_insert(pqueue, call, benefice);
+}
+
+/**
+ * The benefice of a call depends on the number of callers of its callee.
+ * Update the queued calls to @p callee after that number changed.
+ */
+static void update_queued_calls(pqueue_t *pqueue, inline_irg_env *env,
+                                ir_graph *callee)
+{
+	list_for_each_entry(call_entry, entry, &env->calls, list) {
+		if (entry->callee != callee || !pqueue_contains(pqueue, entry->queued))
+			continue;
+		int const benefice = calc_inline_benefice(entry, callee);
+		pqueue_change_priority(pqueue, entry->queued, benefice);
+	}
 }
 
 
@@ -1108,7 +1235,10 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 	if (env->n_call_nodes == 0)
 		return;
 
-	if (env->n_nodes > maxsize) {
+	/* hot call sites get a bigger budget */
+	unsigned const hot_maxsize
+		= max_execcount > 0 ? maxsize * PROFILE_HOT_SIZE_FACTOR : maxsize;
+	if (env->n_nodes > hot_maxsize) {
 		DB((dbg, LEVEL_2, "%+F: too big (%d)\n", irg, env->n_nodes));
 		return;
 	}
@@ -1133,12 +1263,22 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 		ir_entity      *ent        = get_irg_entity(callee);
 		mtp_additional_properties props
 			= get_entity_additional_properties(ent);
+		unsigned const budget = is_hot_call(curr_call) ? hot_maxsize : maxsize;
+
+		curr_call->queued = PQUEUE_NO_HANDLE;
+
 		if (!(props & mtp_property_always_inline)
-		    && env->n_nodes + callee_env->n_nodes > maxsize) {
+		    && env->n_nodes + callee_env->n_nodes > budget) {
 			DB((dbg, LEVEL_2, "%+F: too big (%d) + %+F (%d)\n", irg,
 			    env->n_nodes, callee, callee_env->n_nodes));
 			continue;
 		}
+		if (!(props & mtp_property_always_inline) && max_execcount > 0
+		    && module_nodes + callee_env->n_nodes > module_limit) {
+			DB((dbg, LEVEL_2, "%+F: module too big (%lu) + %+F (%d)\n", irg,
+			    module_nodes, callee, callee_env->n_nodes));
+			continue;
+		}
 
 		ir_graph *calleee = pmap_get(ir_graph, copied_graphs, callee);
 		if (calleee != NULL) {
@@ -1191,7 +1331,9 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 			ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK|IR_RESOURCE_PHI_LIST);
 
 			/* allocate a new environment */
+			int64_t const entry_count = callee_env->entry_count;
 			callee_env = alloc_inline_irg_env();
+			callee_env->entry_count = entry_count;
 			set_irg_link(copy, callee_env);
 
 			assure_irg_properties(copy, IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
@@ -1216,10 +1358,11 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 			phiproj_computed = true;
 			collect_phiprojs_and_start_block_nodes(current_ir_graph);
 		}
-		ir_reserve_resources(callee, IR_RESOURCE_IRN_LINK);
-		bool did_inline = inline_method(curr_call->call, callee);
+		ir_cloner_t cloner;
+		ir_cloner_init(&cloner, callee, irg);
+		bool did_inline = inline_method(curr_call->call, callee, &cloner);
 		if (!did_inline) {
-			ir_free_resources(callee, IR_RESOURCE_IRN_LINK);
+			ir_cloner_destroy(&cloner);
 			continue;
 		}
 
@@ -1243,10 +1386,10 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 			++penv->n_callers;
 
 			/* Note that the src list points to Call nodes in the inlined graph,
-			 * but we need Call nodes in our graph. Luckily the inliner leaves
-			 * this information in the link field. */
-			ir_node *new_call = (ir_node*)get_irn_link(centry->call);
-			if (get_irn_irg(new_call) != irg) {
+			 * but we need Call nodes in our graph. Luckily the cloner maps
+			 * them to their copies. */
+			ir_node *new_call = ir_cloner_get(&cloner, centry->call);
+			if (new_call == NULL) {
 				/* centry->call has not been copied, which means it is dead.
 				 * This might happen during inlining, if a const function,
 				 * which cannot be inlined is only used as an unused argument
@@ -1256,20 +1399,48 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 			assert(is_Call(new_call));
 
 			call_entry *new_entry
-				= duplicate_call_entry(centry, new_call, loop_depth);
+				= duplicate_call_entry(centry, new_call, loop_depth, curr_call,
+				                       callee_env->entry_count);
 			list_add_tail(&new_entry->list, &env->calls);
 			maybe_push_call(pqueue, new_entry, inline_threshold);
 		}
-		ir_free_resources(callee, IR_RESOURCE_IRN_LINK);
+		ir_cloner_destroy(&cloner);
 
 		env->n_call_nodes += callee_env->n_call_nodes;
 		env->n_nodes += callee_env->n_nodes;
+		module_nodes += callee_env->n_nodes;
 		--callee_env->n_callers;
+		/* a remaining call may now be to a function with a single caller */
+		if (callee == curr_call->callee && callee_env->n_callers == 1)
+			update_queued_calls(pqueue, env, callee);
 	}
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK|IR_RESOURCE_PHI_LIST);
 	del_pqueue(pqueue);
 }
 
+/**
+ * Collects the calls of a graph again after it has been optimized.
+ */
+static void recollect_calls(ir_graph *irg)
+{
+	inline_irg_env *env               = (inline_irg_env*)get_irg_link(irg);
+	unsigned const  n_nodes_orig      = env->n_nodes_orig;
+	unsigned const  n_call_nodes_orig = env->n_call_nodes_orig;
+
+	INIT_LIST_HEAD(&env->calls);
+	env->local_weights = NULL;
+	env->n_nodes       = 0;
+	env->n_blocks      = -1; /* do not count count End Block */
+	env->n_call_nodes  = 0;
+
+	assure_loopinfo(irg);
+	wenv_t wenv = { .x = env, .ignore_callers = true };
+	irg_walk_graph(irg, NULL, collect_calls2, &wenv);
+
+	env->n_nodes_orig      = n_nodes_orig;
+	env->n_call_nodes_orig = n_call_nodes_orig;
+}
+
 /*
  * Heuristic inliner. Calculates a benefice value for every call and inlines
  * those calls with a value higher than the threshold.
@@ -1280,7 +1451,8 @@ void inline_functions(unsigned maxsize, int inline_threshold,
 	ir_graph *rem = current_ir_graph;
 	obstack_init(&temp_obst);
 
-	ir_graph **irgs = create_irg_list();
+	size_t    *level_ends;
+	ir_graph **irgs = create_irg_list(&level_ends);
 
 	/* a map for the copied graphs, used to inline recursive calls */
 	pmap *copied_graphs = pmap_create();
@@ -1291,6 +1463,8 @@ void inline_functions(unsigned maxsize, int inline_threshold,
 		set_irg_link(irgs[i], alloc_inline_irg_env());
 
 	/* Precompute information in temporary data structure. */
+	max_execcount = ir_profile_get_max_execcount();
+	module_nodes  = 0;
 	wenv_t wenv;
 	wenv.ignore_callers = false;
 	for (size_t i = 0; i < n_irgs; ++i) {
@@ -1299,24 +1473,44 @@ void inline_functions(unsigned maxsize, int inline_threshold,
 		free_callee_info(irg);
 
 		wenv.x = (inline_irg_env*)get_irg_link(irg);
+		wenv.x->entry_count = get_block_count(get_irg_start_block(irg));
 		assure_loopinfo(irg);
 		irg_walk_graph(irg, NULL, collect_calls2, &wenv);
+		module_nodes += wenv.x->n_nodes;
 	}
+	module_limit = module_nodes + module_nodes * PROFILE_MODULE_GROWTH / 100;
+
+	/* -- and now inline, level by level. -- */
+	for (size_t l = 0, begin = 0, n_levels = ARR_LEN(level_ends); l < n_levels;
+	     begin = level_ends[l++]) {
+		size_t const end = level_ends[l];
+		for (size_t i = begin; i < end; ++i) {
+			ir_graph *irg = irgs[i];
+			inline_into(irg, maxsize, inline_threshold, copied_graphs);
+		}
 
-	/* -- and now inline. -- */
-	for (size_t i = 0; i < n_irgs; ++i) {
-		ir_graph *irg = irgs[i];
-		inline_into(irg, maxsize, inline_threshold, copied_graphs);
+		if (after_inline_opt == NULL)
+			continue;
+		/* optimize the graphs of this level before they are inlined into
+		 * the graphs of the next levels */
+		for (size_t i = begin; i < end; ++i) {
+			ir_graph       *irg = irgs[i];
+			inline_irg_env *env = (inline_irg_env*)get_irg_link(irg);
+			if (env->got_inline) {
+				/* this irg got calls inlined: optimize it */
+				after_inline_opt(irg);
+				module_nodes -= env->n_nodes;
+				recollect_calls(irg);
+				module_nodes += env->n_nodes;
+			}
+		}
 	}
+	DEL_ARR_F(level_ends);
 
 	for (size_t i = 0; i < n_irgs; ++i) {
 		ir_graph *irg = irgs[i];
 
 		inline_irg_env *env = (inline_irg_env*)get_irg_link(irg);
-		if (env->got_inline && after_inline_opt != NULL) {
-			/* this irg got calls inlined: optimize it */
-			after_inline_opt(irg);
-		}
 		if (env->got_inline || (env->n_callers_orig != env->n_callers)) {
 			DB((dbg, LEVEL_1, "Nodes:%3d ->%3d, calls:%3d ->%3d, callers:%3d ->%3d, -- %s\n",
 			env->n_nodes_orig, env->n_nodes, env->n_call_nodes_orig, env->n_call_nodes,
@@ -1335,7 +1529,7 @@ void inline_functions(unsigned maxsize, int inline_threshold,
 	}
 	pmap_destroy(copied_graphs);
 
-	free(irgs);
+	xfree(irgs);
 
 	obstack_free(&temp_obst, NULL);
 	current_ir_graph = rem;
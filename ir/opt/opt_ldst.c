@@ -24,6 +24,7 @@
 #include "iroptimize.h"
 #include "irnodehashmap.h"
 #include "irmemory.h"
+#include "irmemory_t.h"
 #include "raw_bitset.h"
 #include "debug.h"
 #include "panic.h"
@@ -103,6 +104,7 @@ struct block_t {
 typedef struct ldst_env_t {
 	struct obstack   obst;             /**< obstack for temporary data */
 	ir_nodehashmap_t adr_map;          /**< Map addresses to */
+	ir_nodehashmap_t mem_users;        /**< Map rerouted memory to its users */
 	block_t         *forward;          /**< Inverse post-order list of all blocks Start->End */
 	block_t         *backward;         /**< Inverse post-order list of all blocks End->Start */
 	ir_node         *end_bl;           /**< end block of the current graph */
@@ -1240,9 +1242,8 @@ static int backward_antic(block_t *bl)
 	}
 
 	MEMCPY(bl->id_2_memop_antic, env.curr_id_2_memop, env.rbs_size);
-	if (! rbitsets_equal(bl->anticL_in, env.curr_set, env.rbs_size)) {
+	if (rbitset_copy_changed(bl->anticL_in, env.curr_set, env.rbs_size)) {
 		/* changed */
-		rbitset_copy(bl->anticL_in, env.curr_set, env.rbs_size);
 		dump_curr(bl, "AnticL_in*");
 		return 1;
 	}
@@ -1415,6 +1416,29 @@ static ir_node *find_last_memory(block_t *bl)
 	}
 }
 
+/**
+ * The users of a memory IR-node, which were rerouted to it after the out
+ * edges were computed.
+ */
+typedef struct mem_users_t {
+	unsigned        n_users;
+	ir_def_use_edge users[];
+} mem_users_t;
+
+/**
+ * Returns the users of a memory IR-node and stores their number in n_users.
+ */
+static const ir_def_use_edge *get_mem_users(const ir_node *mem,
+                                            unsigned *n_users)
+{
+	const mem_users_t *users = ir_nodehashmap_get(mem_users_t, &env.mem_users, mem);
+	if (users != NULL) {
+		*n_users = users->n_users;
+		return users->users;
+	}
+	return get_irn_out_edges(mem, n_users);
+}
+
 /**
  * Reroute all memory users of old memory
  * to a new memory IR-node.
@@ -1424,15 +1448,18 @@ static ir_node *find_last_memory(block_t *bl)
  */
 static void reroute_all_mem_users(ir_node *omem, ir_node *nmem)
 {
-	for (unsigned i = get_irn_n_outs(omem); i-- > 0; ) {
-		int     n_pos;
-		ir_node *user = get_irn_out_ex(omem, i, &n_pos);
+	unsigned                     n;
+	const ir_def_use_edge *const users     = get_mem_users(omem, &n);
+	mem_users_t           *const new_users = OALLOCF(&env.obst, mem_users_t, users, n);
 
-		set_irn_n(user, n_pos, nmem);
+	for (unsigned i = n; i-- > 0; ) {
+		new_users->users[i] = users[i];
+		set_irn_n(users[i].use, users[i].pos, nmem);
 	}
 
 	/* all edges previously point to omem now point to nmem */
-	nmem->o.out = omem->o.out;
+	new_users->n_users = n;
+	ir_nodehashmap_insert(&env.mem_users, nmem, new_users);
 }
 
 /**
@@ -1445,13 +1472,14 @@ static void reroute_all_mem_users(ir_node *omem, ir_node *nmem)
  */
 static void reroute_mem_through(ir_node *omem, ir_node *nmem, ir_node *pass_bl)
 {
-	unsigned n = get_irn_n_outs(omem);
-	ir_def_use_edges *new_out = OALLOCF(&env.obst, ir_def_use_edges, edges, n);
+	unsigned                     n;
+	const ir_def_use_edge *const users     = get_mem_users(omem, &n);
+	mem_users_t           *const new_users = OALLOCF(&env.obst, mem_users_t, users, n);
 
 	unsigned j = 0;
 	for (unsigned i = 0; i < n; ++i) {
-		int     n_pos;
-		ir_node *user   = get_irn_out_ex(omem, i, &n_pos);
+		int      n_pos  = users[i].pos;
+		ir_node *user   = users[i].use;
 		ir_node *use_bl = get_nodes_block(user);
 
 
@@ -1460,20 +1488,19 @@ static void reroute_mem_through(ir_node *omem, ir_node *nmem, ir_node *pass_bl)
 		}
 		if (block_dominates(pass_bl, use_bl)) {
 			/* found an user that is dominated */
-			new_out->edges[j].pos = n_pos;
-			new_out->edges[j].use = user;
+			new_users->users[j].pos = n_pos;
+			new_users->users[j].use = user;
 			++j;
 
 			set_irn_n(user, n_pos, nmem);
 		}
 	}
-	new_out->n_edges = j;
+	new_users->n_users = j;
 
-	/* Modify the out structure: we create a new out edge array on our
+	/* Remember the rerouted users: we create a new user array on our
 	   temporary obstack here. This should be no problem, as we invalidate the
 	   edges at the end either. */
-	/* first entry is used for the length */
-	nmem->o.out = new_out;
+	ir_nodehashmap_insert(&env.mem_users, nmem, new_users);
 }
 
 /**
@@ -1714,9 +1741,8 @@ static int insert_Load(block_t *bl)
 	/* always update the map after gen/kill, as values might have been changed due to RAR/WAR/WAW */
 	MEMCPY(bl->id_2_memop_avail, env.curr_id_2_memop, env.rbs_size);
 
-	if (!rbitsets_equal(bl->avail_out, env.curr_set, env.rbs_size)) {
+	if (rbitset_copy_changed(bl->avail_out, env.curr_set, env.rbs_size)) {
 		/* the avail set has changed */
-		rbitset_copy(bl->avail_out, env.curr_set, env.rbs_size);
 		dump_curr(bl, "Avail_out*");
 		return 1;
 	}
@@ -1771,9 +1797,11 @@ void opt_ldst(ir_graph *irg)
 	if ((opts & aa_opt_always_alias) == 0) {
 		assure_irp_globals_entity_usage_computed();
 	}
+	ir_init_alias_cache(irg);
 
 	obstack_init(&env.obst);
 	ir_nodehashmap_init(&env.adr_map);
+	ir_nodehashmap_init(&env.mem_users);
 
 	env.forward       = NULL;
 	env.backward      = NULL;
@@ -1822,6 +1850,14 @@ void opt_ldst(ir_graph *irg)
 		goto no_changes;
 	}
 
+	/* the sets of every block have an entry per address */
+	size_t n_blocks = 0;
+	for (bl = env.forward; bl != NULL; bl = bl->forward_next)
+		++n_blocks;
+	if (!ir_complexity_allows(irg, "opt_ldst",
+	                          (double)n_blocks * (env.curr_adr_id + 1)))
+		goto no_changes;
+
 	/* create the backward links. */
 	env.backward = NULL;
 	irg_block_walk_graph(irg, NULL, collect_backward, NULL);
@@ -1879,7 +1915,9 @@ no_changes:
 	}
 
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_BLOCK_MARK);
+	ir_free_alias_cache(irg);
 	ir_nodehashmap_destroy(&env.adr_map);
+	ir_nodehashmap_destroy(&env.mem_users);
 	obstack_free(&env.obst, NULL);
 
 #ifdef DEBUG_libfirm
@@ -73,6 +73,8 @@ typedef struct iv_env {
 	unsigned   replaced;      /**< number of replaced ops */
 	unsigned   lftr_replaced; /**< number of applied linear function test
 	                               replacements */
+	unsigned   ivs_removed;   /**< number of removed redundant induction
+	                               variables */
 	unsigned   osr_flags;     /**< additional flags steering the transformation */
 	bool       need_postpass; /**< set, if a post pass is needed to fix Add and
 	                               Sub nodes */
@@ -94,10 +96,11 @@ typedef struct quadruple_t {
  * A LFTR edge.
  */
 typedef struct ldtr_edge_t {
-	ir_node  *src;  /**< the source node */
-	ir_node  *dst;  /**< the destination node */
-	unsigned  code; /**< the opcode that must be applied */
-	ir_node  *rc;   /**< the region const that must be applied */
+	ir_node            *src;  /**< the source node */
+	ir_node            *dst;  /**< the destination node */
+	unsigned            code; /**< the opcode that must be applied */
+	ir_node            *rc;   /**< the region const that must be applied */
+	struct ldtr_edge_t *next; /**< the next edge with the same source */
 } ldtr_edge_t;
 
 /* forward */
@@ -115,9 +118,11 @@ static int lftr_cmp(const void *e1, const void *e2, size_t size)
 }
 
 /**
- * Find a LFTR edge.
+ * Find the LFTR edges starting at a node.
  *
  * @param src  the source node of the transition
+ *
+ * @return the first edge, the others are linked by their next field
  */
 static ldtr_edge_t *lftr_find(ir_node *src, iv_env *env)
 {
@@ -138,14 +143,22 @@ static ldtr_edge_t *lftr_find(ir_node *src, iv_env *env)
 static void lftr_add(ir_node *src, ir_node *dst, unsigned code, ir_node *rc,
                      iv_env *env)
 {
-	ldtr_edge_t key = { .src = src, .dst = dst, .code = code, .rc = rc };
+	ldtr_edge_t  key   = { .src = src, .dst = dst, .code = code, .rc = rc };
+	ldtr_edge_t *first = set_insert(ldtr_edge_t, env->lftr_edges, &key,
+	                                sizeof(key), hash_ptr(src));
+	if (first->dst == dst)
+		return;
 
-	/*
-	 * There might be more than one edge here. This is rather bad
-	 * because we currently store only one.
-	 */
-	(void)set_insert(ldtr_edge_t, env->lftr_edges, &key, sizeof(key),
-	                 hash_ptr(src));
+	/* The source was reduced more than once, remember all edges: if the
+	 * test cannot be moved along one of them, it might along another. */
+	for (ldtr_edge_t *e = first->next; e != NULL; e = e->next) {
+		if (e->dst == dst)
+			return;
+	}
+	ldtr_edge_t *e = OALLOC(&env->obst, ldtr_edge_t);
+	*e          = key;
+	e->next     = first->next;
+	first->next = e;
 }
 
 /**
@@ -969,14 +982,17 @@ static void assign_po(ir_node *block, void *ctx)
  *
  * @return the translated region constant or NULL
  *         if the translation was not possible
- *
- * @note
- * In the current implementation only the last edge is stored, so
- * only one chain exists. That's why we might miss some opportunities.
  */
 static ir_node *apply_one_edge(ir_node *iv, ir_node *rc, ldtr_edge_t *e,
                                iv_env *env)
 {
+	/* a negative factor would invert the relation of the test */
+	if (e->code == iro_Mul && is_Const(e->rc)
+	    && tarval_is_negative(get_Const_tarval(e->rc))) {
+		DB((dbg, LEVEL_4, " * NEGATIVE"));
+		return NULL;
+	}
+
 	if (env->osr_flags & osr_flag_lftr_with_ov_check) {
 		if (!is_counter_iv(iv, env)) {
 			DB((dbg, LEVEL_4, " not counter IV"));
@@ -1065,6 +1081,39 @@ static ir_node *apply_one_edge(ir_node *iv, ir_node *rc, ldtr_edge_t *e,
 	return do_apply(e->code, NULL, rc, e->rc, get_irn_mode(e->dst));
 }
 
+/**
+ * Follows the LFTR edges starting at an induction variable and applies
+ * their operations to a region constant. If the test cannot be moved along
+ * an edge, the other edges with the same source are tried.
+ *
+ * @param pIV  points to the IV node that starts the LFTR edge chain
+ *             after translation points to the new IV
+ * @param rc   the region constant that should be translated
+ * @param env  the IV environment
+ *
+ * @return the translated region constant or NULL
+ *         if no chain could be applied completely
+ */
+static ir_node *apply_edge_chain(ir_node **pIV, ir_node *rc, iv_env *env)
+{
+	ldtr_edge_t *e = lftr_find(*pIV, env);
+	if (e == NULL)
+		return rc;
+
+	for (; e != NULL; e = e->next) {
+		ir_node *nrc = apply_one_edge(*pIV, rc, e, env);
+		if (nrc == NULL)
+			continue;
+		ir_node *iv = e->dst;
+		nrc = apply_edge_chain(&iv, nrc, env);
+		if (nrc != NULL) {
+			*pIV = iv;
+			return nrc;
+		}
+	}
+	return NULL;
+}
+
 /**
  * Applies the operations represented by the LFTR edges to a
  * region constant and returns the value.
@@ -1095,19 +1144,47 @@ static ir_node *apply_edges(ir_node **pIV, ir_node *rc, iv_env *env)
 		DB((dbg, LEVEL_4, "%+F", get_Const_tarval(rc)));
 	}
 
-	while (rc != NULL) {
-		ldtr_edge_t *e = lftr_find(iv, env);
-		if (e != NULL) {
-			rc = apply_one_edge(iv, rc, e, env);
-			iv = e->dst;
-		} else
-			break;
-	}
+	rc = apply_edge_chain(pIV, rc, env);
 	DB((dbg, LEVEL_3, "\n"));
-	*pIV = iv;
 	return rc;
 }
 
+/**
+ * Checks whether the induction variable of a test iv relation rc moves
+ * towards the bound. Otherwise it must overflow before the test fails, which
+ * the replaced induction variable would do at another point.
+ *
+ * @param iv        the induction variable of the test
+ * @param relation  the relation of the test with iv on the left side
+ * @param env       the IV environment
+ */
+static bool moves_towards_bound(ir_node *iv, ir_relation relation,
+                                iv_env *env)
+{
+	if (!is_counter_iv(iv, env))
+		return true;
+
+	scc         *pscc          = get_iv_scc(iv, env);
+	ir_tarval   *tv_incr       = pscc->incr;
+	ir_tarval   *zero          = get_mode_null(get_tarval_mode(tv_incr));
+	ir_relation  incr_relation = tarval_cmp(tv_incr, zero);
+	if (pscc->code == iro_Sub)
+		incr_relation = get_inversed_relation(incr_relation);
+
+	switch (relation) {
+	case ir_relation_less:
+	case ir_relation_less_equal:
+		/* Prevent: for (i = 42; i <= 42; i--) -> for (i = 43; i <= 43; i--) */
+		return incr_relation != ir_relation_less;
+	case ir_relation_greater:
+	case ir_relation_greater_equal:
+		/* Prevent: for (i = 42; i >= 42; i++) -> for (i = 41; i >= 41; i++) */
+		return incr_relation != ir_relation_greater;
+	default:
+		return true;
+	}
+}
+
 /**
  * Walker, finds Cmp(iv, rc) or Cmp(rc, iv)
  * and tries to optimize them.
@@ -1129,42 +1206,22 @@ static void do_lftr(ir_node *cmp, void *ctx)
 		iv = left;
 		ir_node *rc = right;
 
+		if (!moves_towards_bound(iv, get_Cmp_relation(cmp), env))
+			return;
 		nright = apply_edges(&iv, rc, env);
 		nleft  = iv;
 	} else if (riv != NULL && is_rc(left, riv)) {
 		iv = right;
 		ir_node *rc = left;
 
+		ir_relation relation = get_inversed_relation(get_Cmp_relation(cmp));
+		if (!moves_towards_bound(iv, relation, env))
+			return;
 		nleft  = apply_edges(&iv, rc, env);
 		nright = iv;
 	}
 
 	if (nleft && nright) {
-		if (is_counter_iv(iv, env)) {
-			scc         *pscc          = get_iv_scc(iv, env);
-			ir_tarval   *tv_incr       = pscc->incr;
-			ir_mode     *mode          = get_tarval_mode(tv_incr);
-			ir_tarval   *zero          = get_mode_null(mode);
-			ir_relation  incr_relation = tarval_cmp(tv_incr, zero);
-			ir_relation  relation      = get_Cmp_relation(cmp);
-			switch (relation) {
-				case ir_relation_less:
-				case ir_relation_less_equal:
-					if (incr_relation == ir_relation_less)
-						/* Prevent: for (i = 42; i <= 42; i--) -> for (i = 43; i >= 43; i--) */
-						return;
-
-				case ir_relation_greater:
-				case ir_relation_greater_equal:
-					if (incr_relation == ir_relation_greater)
-						/* Prevent: for (i = 42; i >= 42; i++) -> for (i = 41; i >= 41; i++) */
-						return;
-
-				default:
-					break;
-			}
-		}
-
 		DB((dbg, LEVEL_2, "  LFTR for %+F\n", cmp));
 		set_Cmp_left(cmp, nleft);
 		set_Cmp_right(cmp, nright);
@@ -1183,6 +1240,187 @@ static void lftr(ir_graph *irg, iv_env *env)
 	irg_walk_graph(irg, NULL, do_lftr, env);
 }
 
+/** A simple induction variable: a Phi which is incremented by a constant
+ * along all back edges. */
+typedef struct simple_iv_t {
+	ir_node   *block; /**< the loop header */
+	ir_node   *phi;   /**< the Phi of the induction variable, NULL if removed */
+	ir_node   *init;  /**< the value on loop entry */
+	ir_tarval *step;  /**< the increment per iteration */
+} simple_iv_t;
+
+/**
+ * Returns the increment of the Phi @p phi, if @p pred is its value along a
+ * back edge, NULL else.
+ */
+static ir_tarval *get_back_edge_step(ir_node *phi, ir_node *pred)
+{
+	if (is_Add(pred) && get_Add_left(pred) == phi) {
+		ir_node *right = get_Add_right(pred);
+		if (is_Const(right))
+			return get_Const_tarval(right);
+	} else if (is_Sub(pred) && get_Sub_left(pred) == phi) {
+		ir_node *right = get_Sub_right(pred);
+		if (is_Const(right))
+			return tarval_neg(get_Const_tarval(right));
+	}
+	return NULL;
+}
+
+/**
+ * Walker: collects the simple induction variables of a graph.
+ */
+static void collect_simple_ivs(ir_node *phi, void *ctx)
+{
+	if (!is_Phi(phi))
+		return;
+	ir_mode *mode = get_irn_mode(phi);
+	if (!mode_is_int(mode) && !mode_is_reference(mode))
+		return;
+
+	simple_iv_t iv = { .block = get_nodes_block(phi), .phi = phi };
+	foreach_irn_in(phi, i, pred) {
+		ir_tarval *step = get_back_edge_step(phi, pred);
+		if (step != NULL) {
+			if (iv.step != NULL && iv.step != step)
+				return;
+			iv.step = step;
+		} else {
+			if (pred == phi || (iv.init != NULL && iv.init != pred))
+				return;
+			iv.init = pred;
+		}
+	}
+	if (iv.init == NULL || iv.step == NULL)
+		return;
+
+	simple_iv_t **ivs = (simple_iv_t**)ctx;
+	ARR_APP1(simple_iv_t, *ivs, iv);
+}
+
+/**
+ * Compares simple induction variables by their block first, so the
+ * induction variables of a loop are adjacent.
+ */
+static int cmp_simple_iv(const void *a, const void *b)
+{
+	const simple_iv_t *iv_a    = (const simple_iv_t*)a;
+	const simple_iv_t *iv_b    = (const simple_iv_t*)b;
+	unsigned           block_a = get_irn_idx(iv_a->block);
+	unsigned           block_b = get_irn_idx(iv_b->block);
+	if (block_a != block_b)
+		return QSORT_CMP(block_a, block_b);
+	return QSORT_CMP(get_irn_idx(iv_a->phi), get_irn_idx(iv_b->phi));
+}
+
+/**
+ * Splits the value @p value into a base and a constant offset.
+ *
+ * @param value        the value to split
+ * @param offset_mode  the mode of the offset
+ * @param offset       the constant offset, set on return
+ *
+ * @return the base or NULL if the value is a constant
+ */
+static ir_node *split_offset(ir_node *value, ir_mode *offset_mode,
+                             ir_tarval **offset)
+{
+	if (is_Add(value) || is_Sub(value)) {
+		ir_node *right = get_binop_right(value);
+		if (is_Const(right)) {
+			ir_tarval *tv = get_Const_tarval(right);
+			*offset = is_Add(value) ? tv : tarval_neg(tv);
+			return get_binop_left(value);
+		}
+	} else if (is_Const(value) && get_irn_mode(value) == offset_mode) {
+		*offset = get_Const_tarval(value);
+		return NULL;
+	}
+	*offset = get_mode_null(offset_mode);
+	return value;
+}
+
+/**
+ * Returns the constant distance between two simple induction variables of
+ * the same loop, so that @p other is always @p iv + distance, or NULL if
+ * there is none.
+ */
+static ir_tarval *get_iv_distance(const simple_iv_t *iv,
+                                  const simple_iv_t *other)
+{
+	ir_mode *mode = get_irn_mode(iv->phi);
+	if (get_irn_mode(other->phi) != mode || iv->step != other->step)
+		return NULL;
+
+	/* both must be initialized along the same edges */
+	foreach_irn_in(iv->phi, i, pred) {
+		ir_node *other_pred = get_Phi_pred(other->phi, i);
+		if ((pred == iv->init) != (other_pred == other->init))
+			return NULL;
+	}
+
+	ir_mode   *offset_mode = mode_is_reference(mode)
+	                       ? get_reference_offset_mode(mode) : mode;
+	ir_tarval *offset;
+	ir_tarval *other_offset;
+	ir_node   *base       = split_offset(iv->init, offset_mode, &offset);
+	ir_node   *other_base = split_offset(other->init, offset_mode,
+	                                     &other_offset);
+	if (base != other_base || get_tarval_mode(offset) != offset_mode
+	    || get_tarval_mode(other_offset) != offset_mode)
+		return NULL;
+
+	ir_tarval *distance = tarval_sub(other_offset, offset);
+	if (distance == tarval_bad)
+		return NULL;
+	return distance;
+}
+
+/**
+ * Removes induction variables that differ from another induction variable
+ * of the same loop only by a constant, leaving only one loop carried value.
+ *
+ * @param irg   the graph that should be optimized
+ * @param env   the IV environment
+ */
+static void remove_redundant_ivs(ir_graph *irg, iv_env *env)
+{
+	simple_iv_t *ivs = NEW_ARR_F(simple_iv_t, 0);
+	irg_walk_graph(irg, NULL, collect_simple_ivs, &ivs);
+	QSORT_ARR(ivs, cmp_simple_iv);
+
+	for (size_t i = 0, n = ARR_LEN(ivs); i < n; ++i) {
+		simple_iv_t *iv = &ivs[i];
+		if (iv->phi == NULL)
+			continue;
+		ir_node *block = iv->block;
+
+		for (size_t j = i + 1; j < n; ++j) {
+			simple_iv_t *other = &ivs[j];
+			if (other->block != block)
+				break;
+			if (other->phi == NULL)
+				continue;
+			ir_tarval *distance = get_iv_distance(iv, other);
+			if (distance == NULL)
+				continue;
+
+			DB((dbg, LEVEL_2, "  %+F is %+F + %+F\n", other->phi, iv->phi,
+			    distance));
+			ir_node *value = iv->phi;
+			if (!tarval_is_null(distance)) {
+				dbg_info *dbgi  = get_irn_dbg_info(other->phi);
+				ir_node  *c     = new_r_Const(irg, distance);
+				value = new_rd_Add(dbgi, block, iv->phi, c, get_irn_mode(value));
+			}
+			exchange(other->phi, value);
+			other->phi = NULL;
+			++env->ivs_removed;
+		}
+	}
+	DEL_ARR_F(ivs);
+}
+
 /* Remove any Phi cycles with only one real input. */
 void remove_phi_cycles(ir_graph *irg)
 {
@@ -1205,6 +1443,7 @@ void remove_phi_cycles(ir_graph *irg)
 	env.lftr_edges    = NULL;
 	env.replaced      = 0;
 	env.lftr_replaced = 0;
+	env.ivs_removed   = 0;
 	env.osr_flags     = 0;
 	env.need_postpass = false;
 	env.process_scc   = process_phi_only_scc;
@@ -1322,6 +1561,7 @@ void opt_osr(ir_graph *irg, unsigned flags)
 	env.lftr_edges    = new_set(lftr_cmp, 64);
 	env.replaced      = 0;
 	env.lftr_replaced = 0;
+	env.ivs_removed   = 0;
 	env.osr_flags     = flags;
 	env.need_postpass = false;
 	env.process_scc   = process_scc;
@@ -1344,11 +1584,18 @@ void opt_osr(ir_graph *irg, unsigned flags)
 
 		/* try linear function test replacements */
 		lftr(irg, &env);
-		(void)lftr;
 
 		DB((dbg, LEVEL_1, "Replacements: %u + %u (lftr)\n\n", env.replaced,
 		    env.lftr_replaced));
 	}
+
+	/* the tests do not keep the original induction variables alive anymore,
+	 * which leaves the reduced ones that are only offsets of each other */
+	remove_redundant_ivs(irg, &env);
+	if (env.ivs_removed) {
+		DB((dbg, LEVEL_1, "Removed induction variables: %u\n\n",
+		    env.ivs_removed));
+	}
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
 
 	del_set(env.lftr_edges);
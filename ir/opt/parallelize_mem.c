@@ -17,489 +17,392 @@
 #include "irgopt.h"
 #include "irgwalk.h"
 #include "irmemory.h"
+#include "irmemory_t.h"
 #include "irnode_t.h"
-#include "irnodeset.h"
 #include "obst.h"
-#include "irdump.h"
-#include "irflag_t.h"
 #include "iredges_t.h"
+#include "panic.h"
 #include "type_t.h"
 
-typedef struct parallelize_info
+/** Maximal number of memory operations a block state tracks individually. */
+#define MAX_FRONTIER 16
+
+/** A memory access of a Load, Store or CopyB. */
+typedef struct mem_access_t {
+	ir_node         *ptr;
+	ir_type         *type;
+	unsigned         size;
+	const ir_entity *cls;      /**< alias class, NULL for escaped memory */
+	bool             is_write;
+} mem_access_t;
+
+/** A non-volatile Load, Store or CopyB, referenced by the node link. */
+typedef struct memop_info_t {
+	ir_node      *node;
+	ir_node      *mem_out;  /**< memory result or NULL if it has no users */
+	mem_access_t  access[2];
+	unsigned      n_access;
+	unsigned      epoch;    /**< epoch of the block state it was added to */
+	bool          done;
+} memop_info_t;
+
+/**
+ * The memory state of a block during the forward pass.
+ *
+ * All memory operations of an epoch start from the same memory @c base.
+ * The frontier holds the operations added since, each operation is attached
+ * to the frontier entries of its alias class it conflicts with.  An epoch
+ * ends when an operation does not continue the memory of the epoch, e.g.
+ * after a Call.
+ */
+typedef struct block_state_t {
+	ir_node       *block;
+	ir_node       *base;
+	unsigned       epoch;
+	unsigned       n_frontier;
+	memop_info_t  *frontier[MAX_FRONTIER];
+	unsigned       ancestors[MAX_FRONTIER]; /**< frontier entries it depends on */
+	unsigned       covered;   /**< frontier entries with a dependent entry */
+	memop_info_t **epoch_ops; /**< operations of the epoch with a result */
+} block_state_t;
+
+typedef struct parallelize_env_t {
+	struct obstack   obst;
+	block_state_t  **states;
+	unsigned         n_epochs;
+} parallelize_env_t;
+
+/** Link of the Syncs visited by the forward pass. */
+static char sync_done;
+
+static bool is_parallelizable(const ir_node *node)
 {
-	ir_node      *origin_block;
-	ir_node      *origin_ptr;
-	ir_type      *origin_type;  /**< Type if ptr destination. */
-	unsigned      origin_size;  /**< size of memory access. */
-	ir_nodeset_t  this_mem;
-	ir_nodeset_t  user_mem;
-	ir_nodeset_t  all_visited;
-} parallelize_info;
-
-static void parallelize_load(parallelize_info *pi, ir_node *irn)
+	switch (get_irn_opcode(node)) {
+	case iro_Load:
+		return get_Load_volatility(node) == volatility_non_volatile;
+	case iro_Store:
+		return get_Store_volatility(node) == volatility_non_volatile;
+	case iro_CopyB:
+		return get_CopyB_volatility(node) == volatility_non_volatile;
+	default:
+		return false;
+	}
+}
+
+static memop_info_t *get_memop_info(const ir_node *node)
 {
-	/* There is no point in investigating the same subgraph twice */
-	if (ir_nodeset_contains(&pi->all_visited, irn))
-		return;
+	return is_parallelizable(node) ? (memop_info_t*)get_irn_link(node) : NULL;
+}
 
-	ir_nodeset_insert(&pi->all_visited, irn);
-
-	if (get_nodes_block(irn) == pi->origin_block) {
-		if (is_Proj(irn)) {
-			ir_node *pred = get_Proj_pred(irn);
-			if (is_Load(pred) &&
-					get_Load_volatility(pred) == volatility_non_volatile) {
-				ir_node *mem = get_Load_mem(pred);
-				ir_nodeset_insert(&pi->user_mem, irn);
-				parallelize_load(pi, mem);
-				return;
-			} else if (is_Store(pred) &&
-					get_Store_volatility(pred) == volatility_non_volatile) {
-				ir_type *org_type   = pi->origin_type;
-				unsigned org_size   = pi->origin_size;
-				ir_node *org_ptr    = pi->origin_ptr;
-				ir_type *store_type = get_Store_type(pred);
-				unsigned store_size = get_mode_size_bytes(get_irn_mode(get_Store_value(pred)));
-				ir_node *store_ptr  = get_Store_ptr(pred);
-				if (get_alias_relation(org_ptr, org_type, org_size,
-				                       store_ptr, store_type, store_size) == ir_no_alias) {
-					ir_node *mem = get_Store_mem(pred);
-					ir_nodeset_insert(&pi->user_mem, irn);
-					parallelize_load(pi, mem);
-					return;
-				}
-			}
-		} else if (is_Sync(irn)) {
-			for (int i = 0, n = get_Sync_n_preds(irn); i < n; ++i) {
-				ir_node *sync_pred = get_Sync_pred(irn, i);
-				parallelize_load(pi, sync_pred);
-			}
-			return;
-		} else if (is_CopyB(irn) &&
-		           get_CopyB_volatility(irn) == volatility_non_volatile) {
-			ir_type *org_type   = pi->origin_type;
-			unsigned org_size   = pi->origin_size;
-			ir_node *org_ptr    = pi->origin_ptr;
-			ir_type *copyB_type = get_CopyB_type(irn);
-			ir_node *copyB_dst  = get_CopyB_dst(irn);
-			unsigned copyB_size = get_type_size(copyB_type);
-			if (get_alias_relation(org_ptr, org_type, org_size,
-			                       copyB_dst, copyB_type, copyB_size) == ir_no_alias) {
-				ir_node *mem = get_CopyB_mem(irn);
-				ir_nodeset_insert(&pi->user_mem, irn);
-				parallelize_load(pi, mem);
-				return;
-			}
-		}
-	}
-	ir_nodeset_insert(&pi->this_mem, irn);
+/** Returns the memory operation whose memory result is @p mem or NULL. */
+static memop_info_t *get_mem_producer(const ir_node *mem)
+{
+	if (is_Proj(mem))
+		mem = get_Proj_pred(mem);
+	memop_info_t *const info = get_memop_info(mem);
+	return info != NULL && info->mem_out != NULL ? info : NULL;
+}
+
+static void add_access(memop_info_t *info, ir_node *ptr, ir_type *type,
+                       unsigned size, bool is_write)
+{
+	mem_access_t *const access = &info->access[info->n_access++];
+	access->ptr      = ptr;
+	access->type     = type;
+	access->size     = size;
+	access->cls      = get_unaliased_entity(ptr);
+	access->is_write = is_write;
 }
 
-static void parallelize_store(parallelize_info *pi, ir_node *irn)
+static void init_memop(ir_node *node, void *env)
 {
-	/* There is no point in investigating the same subgraph twice */
-	if (ir_nodeset_contains(&pi->all_visited, irn))
+	parallelize_env_t *const penv = (parallelize_env_t*)env;
+	set_irn_link(node, NULL);
+	if (!is_parallelizable(node))
 		return;
 
-	ir_nodeset_insert(&pi->all_visited, irn);
-
-	if (get_nodes_block(irn) == pi->origin_block) {
-		if (is_Proj(irn)) {
-			ir_node *pred = get_Proj_pred(irn);
-			if (is_Load(pred)
-			    && get_Load_volatility(pred) == volatility_non_volatile) {
-				ir_node *org_ptr   = pi->origin_ptr;
-				ir_type *org_type  = pi->origin_type;
-				unsigned org_size  = pi->origin_size;
-				ir_node *load_ptr  = get_Load_ptr(pred);
-				ir_type *load_type = get_Load_type(pred);
-				unsigned load_size = get_mode_size_bytes(get_Load_mode(pred));
-				if (get_alias_relation(org_ptr, org_type, org_size,
-				                       load_ptr, load_type, load_size) == ir_no_alias) {
-					ir_node *mem = get_Load_mem(pred);
-					ir_nodeset_insert(&pi->user_mem, irn);
-					parallelize_store(pi, mem);
-					return;
-				}
-			} else if (is_Store(pred)
-			           && get_Store_volatility(pred) == volatility_non_volatile) {
-				ir_node *org_ptr    = pi->origin_ptr;
-				ir_type *org_type   = pi->origin_type;
-				unsigned org_size   = pi->origin_size;
-				ir_node *store_ptr  = get_Store_ptr(pred);
-				ir_type *store_type = get_Store_type(pred);
-				unsigned store_size = get_mode_size_bytes(get_irn_mode(get_Store_value(pred)));
-				if (get_alias_relation(org_ptr, org_type, org_size,
-				                       store_ptr, store_type, store_size) == ir_no_alias) {
-					ir_node *mem = get_Store_mem(pred);
-					ir_nodeset_insert(&pi->user_mem, irn);
-					parallelize_store(pi, mem);
-					return;
-				}
-			}
-		} else if (is_Sync(irn)) {
-			for (int i = 0, n = get_Sync_n_preds(irn); i < n; ++i) {
-				ir_node *sync_pred = get_Sync_pred(irn, i);
-				parallelize_store(pi, sync_pred);
-			}
-			return;
-		} else if (is_CopyB(irn)
-		           && get_CopyB_volatility(irn) == volatility_non_volatile) {
-			ir_node *org_ptr    = pi->origin_ptr;
-			ir_type *org_type   = pi->origin_type;
-			unsigned org_size   = pi->origin_size;
-			ir_node *copyB_src  = get_CopyB_src(irn);
-			ir_node *copyB_dst  = get_CopyB_dst(irn);
-			ir_type *copyB_type = get_CopyB_type(irn);
-			unsigned copyB_size = get_type_size(copyB_type);
-			if (get_alias_relation(org_ptr, org_type, org_size,
-			                       copyB_src, copyB_type, copyB_size) == ir_no_alias &&
-			    get_alias_relation(org_ptr, org_type, org_size,
-			                       copyB_dst, copyB_type, copyB_size) == ir_no_alias) {
-				ir_node *mem = get_CopyB_mem(irn);
-				ir_nodeset_insert(&pi->user_mem, irn);
-				parallelize_store(pi, mem);
-				return;
+	memop_info_t *const info = OALLOCZ(&penv->obst, memop_info_t);
+	info->node = node;
+	switch (get_irn_opcode(node)) {
+	case iro_Load:
+		add_access(info, get_Load_ptr(node), get_Load_type(node),
+		           get_mode_size_bytes(get_Load_mode(node)), false);
+		break;
+	case iro_Store: {
+		ir_node *const value = get_Store_value(node);
+		add_access(info, get_Store_ptr(node), get_Store_type(node),
+		           get_mode_size_bytes(get_irn_mode(value)), true);
+		break;
+	}
+	case iro_CopyB: {
+		ir_type *const type = get_CopyB_type(node);
+		unsigned const size = get_type_size(type);
+		add_access(info, get_CopyB_src(node), type, size, false);
+		add_access(info, get_CopyB_dst(node), type, size, true);
+		info->mem_out = node;
+		break;
+	}
+	default:
+		panic("unexpected memory operation %+F", node);
+	}
+	if (info->mem_out == NULL) {
+		foreach_out_edge(node, edge) {
+			ir_node *const proj = get_edge_src_irn(edge);
+			if (get_irn_mode(proj) == mode_M) {
+				info->mem_out = proj;
+				break;
 			}
 		}
 	}
-	ir_nodeset_insert(&pi->this_mem, irn);
+	set_irn_link(node, info);
 }
 
-static void parallelize_copyB(parallelize_info *pi, ir_node *origin, ir_node *irn)
+static bool accesses_conflict(const mem_access_t *a1, const mem_access_t *a2)
 {
-	/* There is no point in investigating the same subgraph twice */
-	if (ir_nodeset_contains(&pi->all_visited, irn))
-		return;
+	if (!a1->is_write && !a2->is_write)
+		return false;
+	/* different alias classes never alias, no need to ask */
+	if (a1->cls != a2->cls)
+		return false;
+	return get_alias_relation(a1->ptr, a1->type, a1->size,
+	                          a2->ptr, a2->type, a2->size) != ir_no_alias;
+}
 
-	ir_nodeset_insert(&pi->all_visited, irn);
-
-	if (get_nodes_block(irn) == pi->origin_block) {
-		if (is_Proj(irn)) {
-			ir_node *pred = get_Proj_pred(irn);
-			if (is_Load(pred)
-			    && get_Load_volatility(pred) == volatility_non_volatile) {
-				ir_node *org_ptr   = get_CopyB_dst(origin);
-				ir_type *org_type  = pi->origin_type;
-				unsigned org_size  = pi->origin_size;
-				ir_node *load_ptr  = get_Load_ptr(pred);
-				ir_type *load_type = get_Load_type(pred);
-				unsigned load_size = get_mode_size_bytes(get_Load_mode(pred));
-				if (get_alias_relation(org_ptr, org_type, org_size,
-				                       load_ptr, load_type, load_size) == ir_no_alias) {
-					ir_node *mem = get_Load_mem(pred);
-					ir_nodeset_insert(&pi->user_mem, irn);
-					parallelize_copyB(pi, origin, mem);
-					return;
-				}
-			} else if (is_Store(pred)
-			           && get_Store_volatility(pred) == volatility_non_volatile) {
-				ir_node *org_src    = get_CopyB_src(origin);
-				ir_node *org_dst    = get_CopyB_dst(origin);
-				ir_type *org_type   = pi->origin_type;
-				unsigned org_size   = pi->origin_size;
-				ir_node *store_ptr  = get_Store_ptr(pred);
-				ir_type *store_type = get_Store_type(pred);
-				unsigned store_size = get_mode_size_bytes(get_irn_mode(get_Store_value(pred)));
-				if (get_alias_relation(org_src, org_type, org_size,
-				                       store_ptr, store_type, store_size) == ir_no_alias &&
-				    get_alias_relation(org_dst, org_type, org_size,
-				                       store_ptr, store_type, store_size) == ir_no_alias) {
-					ir_node *mem = get_Store_mem(pred);
-					ir_nodeset_insert(&pi->user_mem, irn);
-					parallelize_copyB(pi, origin, mem);
-					return;
-				}
-			}
-		} else if (is_Sync(irn)) {
-			for (int i = 0, n = get_Sync_n_preds(irn); i < n; ++i) {
-				ir_node *sync_pred = get_Sync_pred(irn, i);
-				parallelize_copyB(pi, origin, sync_pred);
-			}
-			return;
-		} else if (is_CopyB(irn)
-		           && get_CopyB_volatility(irn) == volatility_non_volatile) {
-			ir_node *org_src    = get_CopyB_src(origin);
-			ir_node *org_dst    = get_CopyB_dst(origin);
-			ir_type *org_type   = pi->origin_type;
-			unsigned org_size   = pi->origin_size;
-			ir_node *copyB_src  = get_CopyB_src(irn);
-			ir_node *copyB_dst  = get_CopyB_dst(irn);
-			ir_type *copyB_type = get_CopyB_type(irn);
-			unsigned copyB_size = get_type_size(copyB_type);
-			if (get_alias_relation(org_src, org_type, org_size,
-			                       copyB_dst, copyB_type, copyB_size) == ir_no_alias &&
-			    get_alias_relation(org_dst, org_type, org_size,
-			                       copyB_src, copyB_type, copyB_size) == ir_no_alias &&
-			    get_alias_relation(org_dst, org_type, org_size,
-			                       copyB_dst, copyB_type, copyB_size) == ir_no_alias) {
-				ir_node *mem = get_CopyB_mem(irn);
-				ir_nodeset_insert(&pi->user_mem, irn);
-				parallelize_copyB(pi, origin, mem);
-				return;
-			}
+static bool memops_conflict(const memop_info_t *op1, const memop_info_t *op2)
+{
+	for (unsigned i = 0; i < op1->n_access; ++i) {
+		for (unsigned j = 0; j < op2->n_access; ++j) {
+			if (accesses_conflict(&op1->access[i], &op2->access[j]))
+				return true;
 		}
 	}
-	ir_nodeset_insert(&pi->this_mem, irn);
+	return false;
 }
 
-static void walker(ir_node *proj, void *env)
+static block_state_t *get_block_state(parallelize_env_t *env, ir_node *block)
 {
-	(void)env;
-
-	ir_node *mem_op;
-	if (is_Proj(proj) && get_irn_mode(proj) == mode_M) {
-		mem_op = get_Proj_pred(proj);
-	} else if (get_irn_mode(proj) == mode_M) {
-		mem_op = proj;
-	} else {
-		return;
+	block_state_t *state = (block_state_t*)get_irn_link(block);
+	if (state == NULL) {
+		state            = OALLOCZ(&env->obst, block_state_t);
+		state->block     = block;
+		state->epoch_ops = NEW_ARR_F(memop_info_t*, 0);
+		set_irn_link(block, state);
+		ARR_APP1(block_state_t*, env->states, state);
 	}
+	return state;
+}
 
-	ir_node          *pred;
-	ir_node          *block;
-	parallelize_info  pi;
-	if (is_Load(mem_op)) {
-		if (get_Load_volatility(mem_op) != volatility_non_volatile) return;
-
-		block = get_nodes_block(mem_op);
-		pred  = get_Load_mem(mem_op);
-
-		pi.origin_block = block,
-		pi.origin_ptr   = get_Load_ptr(mem_op);
-		pi.origin_size  = get_mode_size_bytes(get_Load_mode(mem_op));
-		pi.origin_type  = get_Load_type(mem_op);
-		ir_nodeset_init(&pi.this_mem);
-		ir_nodeset_init(&pi.user_mem);
-		ir_nodeset_init(&pi.all_visited);
-
-		parallelize_load(&pi, pred);
-	} else if (is_Store(mem_op)) {
-		if (get_Store_volatility(mem_op) != volatility_non_volatile) return;
-
-		block = get_nodes_block(mem_op);
-		pred  = get_Store_mem(mem_op);
-
-		pi.origin_block = block,
-		pi.origin_ptr   = get_Store_ptr(mem_op);
-		pi.origin_size  = get_mode_size_bytes(get_irn_mode(get_Store_value(mem_op)));
-		pi.origin_type  = get_Store_type(mem_op);
-		ir_nodeset_init(&pi.this_mem);
-		ir_nodeset_init(&pi.user_mem);
-		ir_nodeset_init(&pi.all_visited);
-
-		parallelize_store(&pi, pred);
-	} else if (is_CopyB(mem_op)) {
-		if (get_CopyB_volatility(mem_op) != volatility_non_volatile) return;
-
-		block = get_nodes_block(mem_op);
-		pred  = get_CopyB_mem(mem_op);
-
-		pi.origin_block = block;
-		pi.origin_type  = get_CopyB_type(mem_op);
-		pi.origin_size  = get_type_size(pi.origin_type);
-		/* parallelize_copyB uses the node itself, because the
-		 * information does not fit in a parallelize_info. */
-		ir_nodeset_init(&pi.this_mem);
-		ir_nodeset_init(&pi.user_mem);
-		ir_nodeset_init(&pi.all_visited);
-
-		parallelize_copyB(&pi, mem_op, pred);
-	} else {
-		return;
+/** Creates a Sync of the frontier entries selected by @p mask. */
+static ir_node *sync_entries(block_state_t *state, unsigned mask)
+{
+	ir_node *in[MAX_FRONTIER];
+	int      n = 0;
+	for (unsigned i = 0; i < state->n_frontier; ++i) {
+		if (mask & (1U << i))
+			in[n++] = state->frontier[i]->mem_out;
 	}
+	if (n == 0)
+		return state->base;
+	if (n == 1)
+		return in[0];
+	ir_node *const sync = new_r_Sync(state->block, n, in);
+	if (is_Sync(sync))
+		set_irn_link(sync, &sync_done);
+	return sync;
+}
 
-	size_t n = ir_nodeset_size(&pi.user_mem);
-	if (n > 0) { /* nothing happened otherwise */
-		ir_node **in = XMALLOCN(ir_node*, n+1);
+/** Returns the memory after all operations of the epoch so far. */
+static ir_node *join_state(block_state_t *state)
+{
+	unsigned const all = (1U << state->n_frontier) - 1;
+	return sync_entries(state, all & ~state->covered);
+}
 
-		size_t i = 0;
-		in[i++] = proj;
-		foreach_ir_nodeset(&pi.user_mem, node, iter) {
-			in[i++] = node;
-		}
-		assert(i == n + 1);
-		ir_node *sync = new_r_Sync(block, i, in);
-		free(in);
-		edges_reroute_except(proj, sync, sync);
-
-		n = ir_nodeset_size(&pi.this_mem);
-		if (n == 1) {
-			sync = ir_nodeset_first(&pi.this_mem);
-		} else {
-			in = XMALLOCN(ir_node*, n);
-			i = 0;
-			foreach_ir_nodeset(&pi.this_mem, node, iter) {
-				in[i++] = node;
-			}
-			assert(i == n);
-			sync = new_r_Sync(block, i, in);
-			free(in);
+static bool in_epoch(const block_state_t *state, ir_node *mem)
+{
+	if (mem == state->base)
+		return true;
+	memop_info_t const *const info = get_mem_producer(mem);
+	if (info != NULL)
+		return info->done && info->epoch == state->epoch;
+	if (is_Sync(mem) && get_irn_link(mem) == &sync_done
+	    && get_nodes_block(mem) == state->block) {
+		foreach_irn_in(mem, i, pred) {
+			if (!in_epoch(state, pred))
+				return false;
 		}
-		set_memop_mem(mem_op, sync);
+		return true;
 	}
-
-	ir_nodeset_destroy(&pi.this_mem);
-	ir_nodeset_destroy(&pi.user_mem);
-	ir_nodeset_destroy(&pi.all_visited);
+	return false;
 }
 
-/*
- * Elimination of unnecessary Sync edges
- *
- * This code removes Sync inputs, where the immediate predecessor is
- * reachable by another one of the Sync's inputs.
+/**
+ * Returns whether @p user of a memory result in the block of @p state is
+ * still to be visited by the forward pass, which then takes care of it.
  */
+static bool is_pending_user(const block_state_t *state, const ir_node *user)
+{
+	if (get_nodes_block(user) != state->block)
+		return false;
+	if (is_Sync(user))
+		return get_irn_link(user) != &sync_done;
+	memop_info_t const *const info = get_memop_info(user);
+	return info != NULL && !info->done;
+}
 
-typedef struct {
-	irg_walk_func *pre;
-	irg_walk_func *post;
-	irg_walk_func *again;
-	ir_nodeset_t *visited;
-	void *inner_env;
-} dfs_env_t;
-
-/* WARNING: Stops at Phi nodes for now */
-static void dfs_step(ir_node *irn, dfs_env_t *env) {
-	if (ir_nodeset_contains(env->visited, irn)) {
-		if (env->again) env->again(irn, env->inner_env);
+/** Redirects the users of @p mem for which @p pending holds to @p join. */
+static void reroute_users(block_state_t *state, ir_node *mem, ir_node *join,
+                          bool pending)
+{
+	if (mem == join)
 		return;
-	} else {
-		if (env->pre) env->pre(irn, env->inner_env);
-		ir_nodeset_insert(env->visited, irn);
-	}
-
-	if (is_Proj(irn)) {
-		dfs_step(get_Proj_pred(irn), env);
-	} else {
-		foreach_irn_in(irn, i, pred) {
-			if (get_irn_mode(pred) == mode_M && !is_Phi(pred)) {
-				dfs_step(pred, env);
-			}
-		}
+	foreach_out_edge_safe(mem, edge) {
+		ir_node *const user = get_edge_src_irn(edge);
+		if (user == join || is_pending_user(state, user) != pending)
+			continue;
+		set_irn_n(user, get_edge_src_pos(edge), join);
 	}
-
-	if (env->post) env->post(irn, env->inner_env);
 }
 
 /**
- * Performs a DFS beginning at @c irn, but traversing each edge once
- * rather than visiting each node once.
- *
- * When a node is visited again through another edge, the @c again
- * callback is called.
- *
- * WARNING: Because this particular use of DFS needs it, the search
- * stops at Phi nodes.
+ * Ends the current epoch of @p state and starts a new one with the memory
+ * of @p node.  The operations not visited yet, which continue the memory of
+ * an operation of the ending epoch, start from the memory after all its
+ * operations.
  */
-static void dfs_by_edges_from(ir_node *irn,
-			      irg_walk_func *pre, irg_walk_func *post, irg_walk_func *again,
-			      void *env)
+static void start_epoch(parallelize_env_t *env, block_state_t *state,
+                        ir_node *node)
 {
-	ir_nodeset_t visited;
-	ir_nodeset_init(&visited);
-
-	dfs_env_t dfs_env = {
-		pre,
-		post,
-		again,
-		&visited,
-		env
-	};
-
-	dfs_step(irn, &dfs_env);
+	ir_node *join = NULL;
+	for (size_t i = 0, n = ARR_LEN(state->epoch_ops); i < n; ++i) {
+		ir_node *const mem = state->epoch_ops[i]->mem_out;
+		foreach_out_edge(mem, edge) {
+			if (!is_pending_user(state, get_edge_src_irn(edge)))
+				continue;
+			if (join == NULL)
+				join = join_state(state);
+			reroute_users(state, mem, join, true);
+			break;
+		}
+	}
 
-	ir_nodeset_destroy(&visited);
+	state->base       = get_memop_mem(node);
+	state->epoch      = ++env->n_epochs;
+	state->n_frontier = 0;
+	state->covered    = 0;
+	ARR_SHRINKLEN(state->epoch_ops, 0);
 }
 
-typedef struct {
-	bool is_Sync_pred;
-	int  sync_pred_count;
-} sync_pred_info_t;
-
-static void prepare_links_Sync(ir_node *irn, void *e)
+static void add_memop(parallelize_env_t *env, memop_info_t *info)
 {
-	struct obstack *obst = (struct obstack*) e;
-
-	sync_pred_info_t *info = obstack_alloc(obst, sizeof(*info));
-	info->is_Sync_pred = false;
-	info->sync_pred_count = 0;
-
-	set_irn_link(irn, info);
-}
+	ir_node       *const node  = info->node;
+	block_state_t *const state = get_block_state(env, get_nodes_block(node));
+	if (state->epoch == 0 || !in_epoch(state, get_memop_mem(node)))
+		start_epoch(env, state, node);
+
+	/* Keep the state bounded: all entries start from the new base. */
+	if (state->n_frontier == MAX_FRONTIER) {
+		state->base       = join_state(state);
+		state->n_frontier = 0;
+		state->covered    = 0;
+	}
 
-static void visit_Sync_pred(ir_node *irn, void *e)
-{
-	(void)e;
+	unsigned deps = 0;
+	for (unsigned i = 0; i < state->n_frontier; ++i) {
+		if (memops_conflict(info, state->frontier[i]))
+			deps |= 1U << i;
+	}
+	unsigned ancestors = 0;
+	for (unsigned i = 0; i < state->n_frontier; ++i) {
+		if (deps & (1U << i))
+			ancestors |= state->ancestors[i];
+	}
+	ir_node *const new_mem = sync_entries(state, deps & ~ancestors);
+	if (new_mem != get_memop_mem(node))
+		set_memop_mem(node, new_mem);
 
-	sync_pred_info_t *info = (sync_pred_info_t*) get_irn_link(irn);
+	info->epoch = state->epoch;
+	info->done  = true;
+	if (info->mem_out == NULL)
+		return;
 
-	if (info->is_Sync_pred) {
-		info->sync_pred_count++;
+	unsigned const n = state->n_frontier++;
+	state->frontier[n]  = info;
+	state->ancestors[n] = deps | ancestors;
+	state->covered     |= deps;
+	ARR_APP1(memop_info_t*, state->epoch_ops, info);
+
+	/* Users outside of the forward pass must see all operations so far. */
+	foreach_out_edge(info->mem_out, edge) {
+		if (is_pending_user(state, get_edge_src_irn(edge)))
+			continue;
+		reroute_users(state, info->mem_out, join_state(state), false);
+		break;
 	}
 }
 
-static void simplify_Sync(ir_node *irn, void *e)
+/**
+ * Redirects the inputs of a Sync from operations of the current epoch to the
+ * memory after all of them, the Sync is replaced if nothing else remains.
+ */
+static void visit_Sync(parallelize_env_t *env, ir_node *sync)
 {
-	struct obstack *obst = (struct obstack*) e;
-
-	if (!is_Sync(irn))
+	set_irn_link(sync, &sync_done);
+	block_state_t *const state = get_block_state(env, get_nodes_block(sync));
+	if (state->epoch == 0)
 		return;
 
-	ir_node **preds   = get_Sync_pred_arr(irn);
-	int       n_preds = get_Sync_n_preds(irn);
-
-	/* Mark all direct predecessors */
-	for (int i = 0; i < n_preds; i++) {
-		sync_pred_info_t *info = (sync_pred_info_t*) get_irn_link(preds[i]);
-		info->is_Sync_pred = true;
-		info->sync_pred_count--;
-	}
-
-	/* Do a DFS from the Sync, stopping at Phi nodes */
-	dfs_by_edges_from(irn, visit_Sync_pred, NULL, visit_Sync_pred, NULL);
-
-	/* Find unnecessary preds, reset sync_pred_infos. */
-	ir_node **necessary = NEW_ARR_F(ir_node*, 0);
-	for (int i = 0; i < n_preds; i++) {
-		sync_pred_info_t *info = (sync_pred_info_t*) get_irn_link(preds[i]);
-
-		if (info->sync_pred_count <= 0) {
-			ARR_APP1(ir_node*, necessary, preds[i]);
+	ir_node *join      = NULL;
+	bool     all_joined = true;
+	foreach_irn_in(sync, i, pred) {
+		if (!in_epoch(state, pred)) {
+			all_joined = false;
+			continue;
 		}
-
-		info->is_Sync_pred = false;
-		info->sync_pred_count = 0;
+		if (join == NULL)
+			join = join_state(state);
+		if (pred != join)
+			set_Sync_pred(sync, i, join);
 	}
-
-	ir_node *block = get_nodes_block(irn);
-	ir_node *new_Sync = new_r_Sync(block, ARR_LEN(necessary), necessary);
-	prepare_links_Sync(new_Sync, obst);
-
-	if (irn != new_Sync)
-		exchange(irn, new_Sync);
-
-	DEL_ARR_F(necessary);
+	if (all_joined && join != sync)
+		exchange(sync, join);
 }
 
-static void eliminate_sync_edges(ir_graph *irg)
+static void parallelize_walker(ir_node *node, void *env)
 {
-	struct obstack obst;
-	obstack_init(&obst);
-
-	irg_walk_graph(irg, prepare_links_Sync, NULL, &obst);
-	irg_walk_graph(irg, simplify_Sync, NULL, &obst);
-
-	obstack_free(&obst, NULL);
+	parallelize_env_t *const penv = (parallelize_env_t*)env;
+	if (is_Sync(node)) {
+		if (get_irn_link(node) != &sync_done)
+			visit_Sync(penv, node);
+	} else {
+		memop_info_t *const info = get_memop_info(node);
+		if (info != NULL)
+			add_memop(penv, info);
+	}
 }
 
 void opt_parallelize_mem(ir_graph *irg)
 {
-	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
-	                           | IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
-	irg_walk_blkwise_dom_top_down(irg, NULL, walker, NULL);
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
+	ir_init_alias_cache(irg);
 	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
-	eliminate_sync_edges(irg);
+
+	parallelize_env_t env;
+	obstack_init(&env.obst);
+	env.states   = NEW_ARR_F(block_state_t*, 0);
+	env.n_epochs = 0;
+
+	irg_walk_graph(irg, init_memop, NULL, &env);
+	/* The post order visits the operands of a node first, so new memory
+	 * edges to operations visited earlier never form a cycle. */
+	irg_walk_graph(irg, NULL, parallelize_walker, &env);
+
+	for (size_t i = 0, n = ARR_LEN(env.states); i < n; ++i)
+		DEL_ARR_F(env.states[i]->epoch_ops);
+	DEL_ARR_F(env.states);
+	obstack_free(&env.obst, NULL);
+
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	ir_free_alias_cache(irg);
 	confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_CONTROL_FLOW);
 }
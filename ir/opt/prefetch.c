@@ -0,0 +1,188 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Insertion of software prefetches for strided Loads in loops.
+ *
+ * A Load in an innermost loop whose address is an induction variable (plus a
+ * constant offset) touches memory with a constant stride.  We prefetch the
+ * address the Load will access a backend defined distance ahead.  The
+ * induction variables are recognized in the form opt_osr() produces them.
+ */
+#include "iroptimize.h"
+
+#include "array.h"
+#include "be.h"
+#include "debug.h"
+#include "ircons.h"
+#include "iredges_t.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irloop_t.h"
+#include "irnode_t.h"
+#include "irnodeset.h"
+#include "irtools.h"
+#include "tv_t.h"
+#include "type_t.h"
+#include "util.h"
+
+/** Prefetch locality passed to the Builtin, 3 keeps data in all caches. */
+#define PREFETCH_LOCALITY 3
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+typedef struct prefetch_env_t {
+	ir_node    **loads;      /**< candidate Loads */
+	ir_nodeset_t prefetched; /**< induction variables already prefetched */
+	ir_type     *type;       /**< method type of the prefetch Builtin */
+	unsigned     distance;   /**< prefetch distance in bytes */
+} prefetch_env_t;
+
+/**
+ * Checks whether @p loop contains no other loops.
+ */
+static bool is_innermost_loop(const ir_loop *loop)
+{
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		loop_element element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_loop)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Returns the constant stride of the induction variable @p phi of @p loop,
+ * 0 if it is none.
+ */
+static long get_iv_stride(const ir_node *phi, const ir_loop *loop)
+{
+	if (!is_Phi(phi) || get_irn_loop(get_nodes_block(phi)) != loop)
+		return 0;
+
+	ir_node *block  = get_nodes_block(phi);
+	long     stride = 0;
+	foreach_irn_in(phi, i, pred) {
+		ir_node *pred_block = get_Block_cfgpred_block(block, i);
+		if (pred_block == NULL || get_irn_loop(pred_block) != loop)
+			continue;
+
+		/* the value along a back edge must be the Phi plus a constant */
+		if (!is_Add(pred) || get_Add_left(pred) != phi)
+			return 0;
+		ir_node *right = get_Add_right(pred);
+		if (!is_Const(right))
+			return 0;
+		ir_tarval *tv = get_Const_tarval(right);
+		if (!tarval_is_long(tv))
+			return 0;
+		long value = get_tarval_long(tv);
+		if (value == 0 || (stride != 0 && value != stride))
+			return 0;
+		stride = value;
+	}
+	return stride;
+}
+
+static void collect_loads(ir_node *node, void *data)
+{
+	prefetch_env_t *env = (prefetch_env_t*)data;
+	if (!is_Load(node) || get_Load_volatility(node) == volatility_is_volatile)
+		return;
+
+	ir_loop *loop = get_irn_loop(get_nodes_block(node));
+	if (loop == NULL || get_loop_depth(loop) == 0 || !is_innermost_loop(loop))
+		return;
+	ARR_APP1(ir_node*, env->loads, node);
+}
+
+/**
+ * Inserts a prefetch in front of @p load if it accesses memory with a
+ * constant stride.
+ */
+static bool insert_prefetch(prefetch_env_t *env, ir_node *load)
+{
+	ir_node *ptr    = get_Load_ptr(load);
+	long     offset = 0;
+	if (is_Add(ptr) && is_Const(get_Add_right(ptr))) {
+		ir_tarval *tv = get_Const_tarval(get_Add_right(ptr));
+		if (!tarval_is_long(tv))
+			return false;
+		offset = get_tarval_long(tv);
+		ptr    = get_Add_left(ptr);
+	}
+
+	ir_node *block  = get_nodes_block(load);
+	ir_loop *loop   = get_irn_loop(block);
+	long     stride = get_iv_stride(ptr, loop);
+	if (stride == 0)
+		return false;
+
+	/* one prefetch per induction variable is enough, accesses relative to it
+	 * are usually close together */
+	if (!ir_nodeset_insert(&env->prefetched, ptr))
+		return false;
+
+	/* prefetch whole iterations ahead, at least the next one */
+	unsigned long abs_stride
+		= stride < 0 ? -(unsigned long)stride : (unsigned long)stride;
+	long iterations = env->distance / abs_stride;
+	if (iterations == 0)
+		iterations = 1;
+	long delta = offset + iterations * stride;
+	DB((dbg, LEVEL_2, "prefetching %+F %ld bytes ahead\n", load, delta));
+
+	ir_graph *irg         = get_irn_irg(load);
+	dbg_info *dbgi        = get_irn_dbg_info(load);
+	ir_mode  *mode        = get_irn_mode(ptr);
+	ir_mode  *offset_mode = get_reference_offset_mode(mode);
+	ir_node  *cnst        = new_r_Const_long(irg, offset_mode, delta);
+	ir_node  *addr        = new_rd_Add(dbgi, block, ptr, cnst, mode);
+	ir_node  *in[]        = {
+		addr,
+		new_r_Const_long(irg, mode_Is, 0),
+		new_r_Const_long(irg, mode_Is, PREFETCH_LOCALITY),
+	};
+	ir_node *mem      = get_Load_mem(load);
+	ir_node *prefetch = new_rd_Builtin(dbgi, block, mem, ARRAY_SIZE(in), in,
+	                                   ir_bk_prefetch, env->type);
+	set_Load_mem(load, new_r_Proj(prefetch, mode_M, pn_Builtin_M));
+	return true;
+}
+
+void insert_prefetches(ir_graph *irg)
+{
+	unsigned const distance = be_get_backend_param()->prefetch_distance;
+	if (distance == 0)
+		return;
+
+	FIRM_DBG_REGISTER(dbg, "firm.opt.prefetch");
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+
+	ir_type *const int_type = get_type_for_mode(mode_Is);
+	ir_type *const type     = new_type_method(3, 0);
+	set_method_param_type(type, 0, new_type_pointer(get_type_for_mode(mode_Bu)));
+	set_method_param_type(type, 1, int_type);
+	set_method_param_type(type, 2, int_type);
+
+	prefetch_env_t env = {
+		.loads    = NEW_ARR_F(ir_node*, 0),
+		.type     = type,
+		.distance = distance,
+	};
+	ir_nodeset_init(&env.prefetched);
+	irg_walk_graph(irg, NULL, collect_loads, &env);
+
+	bool changed = false;
+	for (size_t i = 0, n = ARR_LEN(env.loads); i < n; ++i) {
+		changed |= insert_prefetch(&env, env.loads[i]);
+	}
+
+	ir_nodeset_destroy(&env.prefetched);
+	DEL_ARR_F(env.loads);
+	confirm_irg_properties(irg, changed ? IR_GRAPH_PROPERTIES_CONTROL_FLOW
+	                                    : IR_GRAPH_PROPERTIES_ALL);
+}
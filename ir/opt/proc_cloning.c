@@ -17,6 +17,7 @@
  * in the function graph. They aren't be passed as parameters.
  */
 #include "debug.h"
+#include "execfreq.h"
 #include "iroptimize.h"
 #include "tv.h"
 #include "set.h"
@@ -29,6 +30,7 @@
 #include "irouts_t.h"
 #include "irnode_t.h"
 #include "irtools.h"
+#include "irclone.h"
 #include "irgmod.h"
 #include "array.h"
 #include "panic.h"
@@ -53,10 +55,22 @@ typedef struct entry {
 	struct entry *next;   /**< link to the next one */
 } entry_t;
 
+/**
+ * A clone made for a quadruple.  Clones are remembered for the whole run, so
+ * calls with the same quadruple found later reuse them.
+ */
+typedef struct clone {
+	ir_entity *ent;   /**< The cloned entity. */
+	size_t     pos;   /**< Position of the replaced argument. */
+	ir_tarval *tv;    /**< The tarval of the replaced argument. */
+	ir_entity *clone; /**< The clone. */
+} clone_t;
+
 typedef struct q_set {
 	struct obstack  obst;       /**< an obstack containing all entries */
 	pset           *map;        /**< a hash map containing the quadruples */
 	entry_t        *heavy_uses; /**< the ordered list of heavy uses */
+	set            *clones;     /**< the clones made so far */
 } q_set;
 
 /**
@@ -72,6 +86,14 @@ static int entry_cmp(const void *elt, const void *key)
 	return (e1->q.ent != e2->q.ent) || (e1->q.pos != e2->q.pos) || (e1->q.tv != e2->q.tv);
 }
 
+/**
+ * Hash a quadruple.
+ */
+static unsigned hash_quadruple(const ir_entity *ent, size_t pos, const ir_tarval *tv)
+{
+	return hash_ptr(ent) ^ hash_ptr(tv) ^ (unsigned)(pos * 9);
+}
+
 /**
  * Hash an element of type entry_t.
  *
@@ -79,7 +101,44 @@ static int entry_cmp(const void *elt, const void *key)
  */
 static unsigned hash_entry(const entry_t *entry)
 {
-	return hash_ptr(entry->q.ent) ^ hash_ptr(entry->q.tv) ^ (unsigned)(entry->q.pos * 9);
+	return hash_quadruple(entry->q.ent, entry->q.pos, entry->q.tv);
+}
+
+/**
+ * Compare two clones.
+ *
+ * @return zero if they are made for the same quadruple, non-zero else
+ */
+static int clone_cmp(const void *elt, const void *key, size_t size)
+{
+	(void)size;
+	const clone_t *c1 = (const clone_t*)elt;
+	const clone_t *c2 = (const clone_t*)key;
+
+	return (c1->ent != c2->ent) || (c1->pos != c2->pos) || (c1->tv != c2->tv);
+}
+
+/**
+ * Returns the clone made for the quadruple @p q so far, NULL if there is none.
+ */
+static ir_entity *find_clone(q_set *hmap, const quadruple_t *q)
+{
+	clone_t const key = { .ent = q->ent, .pos = q->pos, .tv = q->tv };
+	clone_t *const clone = set_find(clone_t, hmap->clones, &key, sizeof(key),
+	                                hash_quadruple(q->ent, q->pos, q->tv));
+	return clone != NULL ? clone->clone : NULL;
+}
+
+/**
+ * Remembers @p clone as the clone for the quadruple @p q.
+ */
+static void remember_clone(q_set *hmap, const quadruple_t *q, ir_entity *clone)
+{
+	clone_t const key = {
+		.ent = q->ent, .pos = q->pos, .tv = q->tv, .clone = clone
+	};
+	(void)set_insert(clone_t, hmap->clones, &key, sizeof(key),
+	                 hash_quadruple(q->ent, q->pos, q->tv));
 }
 
 /**
@@ -95,19 +154,19 @@ static void kill_entry(entry_t *entry)
 
 /**
  * Copies a node to a new irg. The Ins of the new node point to
- * the predecessors on the old irg.  n->link points to the new node.
+ * the predecessors on the old irg until ir_cloner_rewire() is called.
  *
- * @param n    The node to be copied
- * @param irg  the new irg
+ * @param cloner  the cloner into the new irg
+ * @param n       The node to be copied
  *
  * Does NOT copy standard nodes like Start, End etc that are fixed
- * in an irg. Instead, the corresponding nodes of the new irg are returned.
- * Note further, that the new nodes have no block.
+ * in an irg. Instead, the corresponding nodes of the new irg are used.
  */
-static void copy_irn_to_irg(ir_node *n, ir_graph *irg)
+static ir_node *copy_irn_to_irg(ir_cloner_t *cloner, ir_node *n)
 {
 	/* do not copy standard nodes */
-	ir_node *nn = NULL;
+	ir_graph *irg = cloner->irg;
+	ir_node  *nn  = NULL;
 	switch (get_irn_opcode(n)) {
 	case iro_NoMem:
 		nn = get_irg_no_mem(irg);
@@ -143,24 +202,11 @@ static void copy_irn_to_irg(ir_node *n, ir_graph *irg)
 	}
 
 	if (nn) {
-		set_irn_link(n, nn);
-		return;
+		ir_cloner_map(cloner, n, nn);
+		return nn;
 	}
 
-	nn = new_ir_node(get_irn_dbg_info(n),
-	                 irg,
-	                 NULL,            /* no block yet, will be set later */
-	                 get_irn_op(n),
-	                 get_irn_mode(n),
-	                 get_irn_arity(n),
-	                 get_irn_in(n));
-
-
-	/* Copy the attributes.  These might point to additional data.  If this
-	   was allocated on the old obstack the pointers now are dangling.  This
-	   frees e.g. the memory of the graph_arr allocated in new_immBlock. */
-	copy_node_attr(irg, n, nn);
-	set_irn_link(n, nn);
+	return ir_cloner_copy(cloner, n);
 }
 
 /**
@@ -249,31 +295,26 @@ static ident *get_clone_ident(ident *id, size_t pos, size_t nr)
 	return new_id_fmt("%s_cl_%zu_%zu", id, pos, nr);
 }
 
-static inline ir_node *get_irn_copy(ir_node *const irn)
-{
-	return (ir_node*)get_irn_link(irn);
-}
-
 /**
  * Pre-Walker: Copies blocks and nodes from the original method graph
  * to the cloned graph. Fixes the argument projection numbers for
  * all arguments behind the removed one.
  *
  * @param irn  A node from the original method graph.
- * @param env  The clone graph.
+ * @param env  The cloner into the clone graph.
  */
 static void copy_nodes(ir_node *irn, void *env)
 {
-	ir_graph *const clone_irg = (ir_graph*)env;
-	ir_node  *const arg       = (ir_node*)get_irg_link(clone_irg);
-	ir_node  *const irg_args  = get_Proj_pred(arg);
+	ir_cloner_t *const cloner   = (ir_cloner_t*)env;
+	ir_node     *const arg      = (ir_node*)get_irg_link(cloner->irg);
+	ir_node     *const irg_args = get_Proj_pred(arg);
 
 	/* Copy all nodes except the arg. */
-	if (irn != arg)
-		copy_irn_to_irg(irn, clone_irg);
+	if (irn == arg)
+		return;
+	ir_node *const irn_copy = copy_irn_to_irg(cloner, irn);
 
 	/* Fix argument numbers */
-	ir_node *const irn_copy = get_irn_copy(irn);
 	if (is_Proj(irn) && get_Proj_pred(irn) == irg_args) {
 		unsigned const proj_nr = get_Proj_num(irn);
 		if (get_Proj_num(arg) < proj_nr)
@@ -282,46 +323,28 @@ static void copy_nodes(ir_node *irn, void *env)
 }
 
 /**
- * Post-walker: Set the predecessors of the copied nodes.
- * The copied nodes are set as link of their original nodes. The links of
- * "irn" predecessors are the predecessors of copied node.
+ * Set the predecessors of the copied nodes.  The End block and the End
+ * node were not copied, their predecessors are added to the ones of the
+ * clone graph.
  */
-static void set_preds(ir_node *irn, void *env)
+static void set_preds(ir_cloner_t *cloner, ir_graph *irg)
 {
-	ir_graph *const clone_irg = (ir_graph*)env;
-
-	/* Arg is the method argument, that we have replaced by a constant.*/
-	ir_node *const arg = (ir_node*)get_irg_link(clone_irg);
-	if (arg == irn)
-		return;
-
-	ir_node  *const irn_copy = get_irn_copy(irn);
-
-	if (is_Block(irn)) {
-		ir_graph *const irg       = get_irn_irg(irn);
-		ir_node  *const end_block = get_irg_end_block(irg);
-		for (int i = get_Block_n_cfgpreds(irn); i-- > 0;) {
-			ir_node *const pred = get_Block_cfgpred(irn, i);
-			/* "End" block must be handled extra, because it is not matured. */
-			if (end_block == irn)
-				add_immBlock_pred(get_irg_end_block(clone_irg), get_irn_copy(pred));
-			else
-				set_Block_cfgpred(irn_copy, i, get_irn_copy(pred));
-		}
-	} else {
-		/* First we set the block our copy if it is not a block.*/
-		set_nodes_block(irn_copy, get_irn_copy(get_nodes_block(irn)));
-		if (is_End(irn)) {
-			/* Handle the keep-alives. This must be done separately, because
-			 * the End node was NOT copied */
-			for (int i = 0, n = get_End_n_keepalives(irn); i < n; ++i)
-				add_End_keepalive(irn_copy, get_irn_copy(get_End_keepalive(irn, i)));
-		} else {
-			foreach_irn_in_r(irn, i, pred) {
-				set_irn_n(irn_copy, i, get_irn_copy(pred));
-			}
-		}
+	ir_cloner_rewire(cloner);
+
+	/* "End" block must be handled extra, because it is not matured. */
+	ir_graph *const clone_irg = cloner->irg;
+	ir_node  *const end_block = get_irg_end_block(irg);
+	for (int i = 0, n = get_Block_n_cfgpreds(end_block); i < n; ++i) {
+		ir_node *const pred = get_Block_cfgpred(end_block, i);
+		add_immBlock_pred(get_irg_end_block(clone_irg), ir_cloner_get(cloner, pred));
 	}
+
+	/* Handle the keep-alives. This must be done separately, because
+	 * the End node was NOT copied */
+	ir_node *const end       = get_irg_end(irg);
+	ir_node *const clone_end = get_irg_end(clone_irg);
+	for (int i = 0, n = get_End_n_keepalives(end); i < n; ++i)
+		add_End_keepalive(clone_end, ir_cloner_get(cloner, get_End_keepalive(end, i)));
 }
 
 /**
@@ -369,14 +392,18 @@ static void create_clone_proc_irg(ir_entity *ent, const quadruple_t *q)
 	ir_node *const const_arg  = new_r_Const(clone_irg, q->tv);
 
 	/* args copy in the cloned graph will be the const. */
-	set_irn_link(arg, const_arg);
+	ir_cloner_t cloner;
+	ir_cloner_init(&cloner, method_irg, clone_irg);
+	ir_cloner_map(&cloner, arg, const_arg);
 
 	/* Store the arg that will be replaced here, so we can easily detect it. */
 	set_irg_link(clone_irg, arg);
 
 	/* We copy the blocks and nodes, that must be in
 	the clone graph and set their predecessors. */
-	irg_walk_graph(method_irg, copy_nodes, set_preds, clone_irg);
+	irg_walk_graph(method_irg, copy_nodes, NULL, &cloner);
+	set_preds(&cloner, method_irg);
+	ir_cloner_destroy(&cloner);
 
 	/* The "cloned" graph must be matured. */
 	irg_finalize_cons(clone_irg);
@@ -427,7 +454,7 @@ static ir_entity *clone_method(const quadruple_t *q)
 	static size_t nr = 0;
 
 	/* We get a new ident for our clone method.*/
-	ident     *const clone_ident = get_clone_ident(get_entity_ident(q->ent), q->pos, nr);
+	ident     *const clone_ident = get_clone_ident(get_entity_ident(q->ent), q->pos, nr++);
 	/* We get our entity for the clone method. */
 	ir_type   *const owner       = get_entity_owner(q->ent);
 	ir_entity *const new_entity  = clone_entity(q->ent, clone_ident, owner);
@@ -502,12 +529,51 @@ static void exchange_calls(quadruple_t *q, ir_entity *cloned_ent)
 /**
  * The weight formula:
  * We save one instruction in every caller and param_weight instructions
- * in the callee.
+ * in the callee, each time a call is executed.  So every call counts with
+ * the execution frequency of its block.
  */
 static float calculate_weight(const entry_t *entry)
 {
-	return ARR_LEN(entry->q.calls) *
-		(float)(get_method_param_weight(entry->q.ent, entry->q.pos) + 1);
+	double freq = 0.0;
+	for (size_t i = 0, n = ARR_LEN(entry->q.calls); i < n; ++i) {
+		ir_node *const call = skip_Id(entry->q.calls[i]);
+		freq += get_block_execfreq(get_nodes_block(call));
+	}
+	return (float)(freq * (get_method_param_weight(entry->q.ent, entry->q.pos) + 1));
+}
+
+/**
+ * Check whether an entry is worth cloning.  Reusing an existing clone does
+ * not grow the program, so it is always done.
+ */
+static bool is_heavy_use(q_set *hmap, const entry_t *entry, float threshold)
+{
+	return entry->weight >= threshold || find_clone(hmap, &entry->q) != NULL;
+}
+
+/**
+ * Removes the entry with the same quadruple as @p key from the list of heavy
+ * uses and returns it, NULL if there is none.
+ */
+static entry_t *unlink_heavy_use(q_set *hmap, const entry_t *key)
+{
+	for (entry_t **anchor = &hmap->heavy_uses; *anchor; anchor = &(*anchor)->next) {
+		entry_t *const entry = *anchor;
+		if (entry_cmp(entry, key) == 0) {
+			*anchor = entry->next;
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Estimates the execution frequencies of @p irg and collects its calls.
+ */
+static void collect_calls(ir_graph *irg, q_set *hmap)
+{
+	ir_estimate_execfreq(irg);
+	irg_walk_graph(irg, collect_irg_calls, NULL, hmap);
 }
 
 /**
@@ -549,7 +615,7 @@ restart:
 	/* recalculate the weight and resort the heavy uses map */
 	entry->weight = calculate_weight(entry);
 
-	if (len <= 0 || entry->weight < threshold) {
+	if (len <= 0 || !is_heavy_use(hmap, entry, threshold)) {
 		hmap->heavy_uses = entry->next;
 		kill_entry(entry);
 
@@ -583,10 +649,12 @@ void proc_cloning(float threshold)
 	obstack_init(&hmap.obst);
 	hmap.map        = NULL;
 	hmap.heavy_uses = NULL;
+	hmap.clones     = new_set(clone_cmp, 8);
 
-	/* initially fill our map by visiting all irgs */
+	/* initially fill our map by visiting all irgs, later only the clones
+	 * are visited */
 	foreach_irp_irg(i, irg) {
-		irg_walk_graph(irg, collect_irg_calls, NULL, &hmap);
+		collect_calls(irg, &hmap);
 	}
 
 	/* We have the "Call" nodes to optimize in set "set_entries". Our algorithm
@@ -598,12 +666,22 @@ void proc_cloning(float threshold)
 		   The elements are arranged dependent of their value descending.*/
 		if (hmap.map) {
 			foreach_pset(hmap.map, entry_t, entry) {
+				/* Calls found in a clone may have a quadruple, which is
+				 * already in the list. */
+				entry_t *const old = unlink_heavy_use(&hmap, entry);
+				if (old) {
+					for (size_t i = 0, n = ARR_LEN(old->q.calls); i < n; ++i)
+						ARR_APP1(ir_node*, entry->q.calls, old->q.calls[i]);
+					kill_entry(old);
+				}
+
 				entry->weight = calculate_weight(entry);
 
 				/*
-				 * Do not put entry with a weight < threshold in the list
+				 * Do not put entry with a weight < threshold in the list,
+				 * unless it can reuse a clone
 				 */
-				if (entry->weight < threshold) {
+				if (!is_heavy_use(&hmap, entry, threshold)) {
 					kill_entry(entry);
 					continue;
 				}
@@ -634,15 +712,26 @@ void proc_cloning(float threshold)
 		entry_t *const entry = hmap.heavy_uses;
 		if (entry) {
 			quadruple_t *const qp  = &entry->q;
-			ir_entity   *const ent = clone_method(qp);
-			DB((dbg, LEVEL_1, "Cloned <%+F, %zu, %T> info %+F\n", qp->ent, qp->pos, qp->tv, ent));
+			ir_entity         *ent = find_clone(&hmap, qp);
+			bool         const new_clone = ent == NULL;
+			if (new_clone) {
+				ent = clone_method(qp);
+				remember_clone(&hmap, qp, ent);
+				DB((dbg, LEVEL_1, "Cloned <%+F, %zu, %T> info %+F\n", qp->ent, qp->pos, qp->tv, ent));
+			} else {
+				DB((dbg, LEVEL_1, "Reused %+F for <%+F, %zu, %T>\n", ent, qp->ent, qp->pos, qp->tv));
+			}
 
 			hmap.heavy_uses = entry->next;
 
-			/* We must exchange the copies of this call in all clones too.*/
 			exchange_calls(&entry->q, ent);
 			kill_entry(entry);
 
+			/* The calls in the clone are copies of the calls in the
+			 * original, which may be specialized, too. */
+			if (new_clone)
+				collect_calls(get_entity_irg(ent), &hmap);
+
 			/*
 			 * after we exchanged all calls, some entries on the list for
 			 * the next cloned entity may get invalid, so we have to check
@@ -651,5 +740,11 @@ void proc_cloning(float threshold)
 			reorder_weights(&hmap, threshold);
 		}
 	}
+	del_set(hmap.clones);
 	obstack_free(&hmap.obst, NULL);
+
+	/* Calls were exchanged, the control flow was not changed. */
+	foreach_irp_irg(i, irg) {
+		confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_CONTROL_FLOW);
+	}
 }
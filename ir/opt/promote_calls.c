@@ -0,0 +1,188 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Promotion of indirect calls to guarded direct calls.
+ *
+ * Indirect calls whose profiled targets are dominated by a single function
+ * are rewritten into
+ *
+ *     if (callee == target) target(...); else callee(...);
+ *
+ * so the direct call can be inlined or optimized otherwise.
+ */
+#include <assert.h>
+
+#include "array.h"
+#include "debug.h"
+#include "irgmod.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "iroptimize.h"
+#include "irprofile.h"
+#include "irtools.h"
+#include "util.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+typedef struct promote_env_t {
+	double      min_probability; /**< minimal share of the target */
+	ir_node   **calls;           /**< the calls to promote */
+	ir_entity **targets;         /**< the targets of the calls */
+} promote_env_t;
+
+static void find_promotable_call(ir_node *node, void *data)
+{
+	if (!is_Call(node) || is_Address(get_Call_ptr(node)))
+		return;
+	/* the exception control flow would have to be merged, too */
+	if (ir_throws_exception(node))
+		return;
+
+	ir_entity *targets[IR_PROFILE_N_CALL_TARGETS];
+	uint32_t   counts[IR_PROFILE_N_CALL_TARGETS];
+	uint32_t   total;
+	if (ir_profile_get_call_targets(node, targets, counts, &total) == 0)
+		return;
+
+	promote_env_t *const env = (promote_env_t*)data;
+	if (counts[0] < env->min_probability * total)
+		return;
+
+	DB((dbg, LEVEL_2, "promoting %+F to %+F (%u of %u calls)\n", node,
+	    targets[0], counts[0], total));
+	ARR_APP1(ir_node*, env->calls, node);
+	ARR_APP1(ir_entity*, env->targets, targets[0]);
+}
+
+/**
+ * Creates a copy of @p call calling @p callee in @p block.
+ */
+static ir_node *copy_call(ir_node *const call, ir_node *const block,
+                          ir_node *const callee)
+{
+	ir_node *const copy = exact_copy(call);
+	set_nodes_block(copy, block);
+	set_Call_ptr(copy, callee);
+	set_irn_link(copy, NULL);
+	return copy;
+}
+
+static void promote_call(ir_node *const call, ir_entity *const target)
+{
+	/* Split the block in two halfs, with the call in the upper block. */
+	ir_node *const lower_block = get_nodes_block(call);
+	part_block(call);
+	ir_node *const upper_block = get_nodes_block(call);
+
+	/* Compare the callee with the target and call both in separate blocks,
+	 * which are merged in the lower block. */
+	ir_graph *const irg            = get_irn_irg(call);
+	ir_node  *const callee         = get_Call_ptr(call);
+	ir_node  *const address        = new_r_Address(irg, target);
+	ir_node  *const cmp            = new_r_Cmp(upper_block, callee, address, ir_relation_equal);
+	ir_node  *const cond           = new_r_Cond(upper_block, cmp);
+	ir_node  *const true_proj      = new_r_Proj(cond, mode_X, pn_Cond_true);
+	ir_node  *const false_proj     = new_r_Proj(cond, mode_X, pn_Cond_false);
+	ir_node  *const direct_block   = new_r_Block(irg, 1, &true_proj);
+	ir_node  *const indirect_block = new_r_Block(irg, 1, &false_proj);
+	ir_node  *const jmps[]         = {
+		new_r_Jmp(direct_block), new_r_Jmp(indirect_block)
+	};
+	set_Cond_jmp_pred(cond, COND_JMP_PRED_TRUE);
+	collect_new_start_block_node(address);
+
+	/* Kill the jump from upper to lower block and replace the in array. */
+	assert(get_Block_n_cfgpreds(lower_block) == 1);
+	kill_node(get_Block_cfgpred(lower_block, 0));
+	set_irn_in(lower_block, ARRAY_SIZE(jmps), jmps);
+
+	ir_node *const calls[] = {
+		copy_call(call, direct_block, address),
+		copy_call(call, indirect_block, callee),
+	};
+	ir_node *const ress[] = {
+		new_r_Proj(calls[0], mode_T, pn_Call_T_result),
+		new_r_Proj(calls[1], mode_T, pn_Call_T_result),
+	};
+
+	/* Replace the results of the call with Phis of both calls. Nested result
+	 * Projs are linked with the call, too. */
+	for (ir_node *proj = (ir_node*)get_irn_link(call), *next; proj != NULL;
+	     proj = next) {
+		next = (ir_node*)get_irn_link(proj);
+
+		ir_mode  *const mode = get_irn_mode(proj);
+		unsigned  const num  = get_Proj_num(proj);
+		ir_node        *ins[2];
+		if (get_Proj_pred(proj) != call) {
+			assert(get_Proj_num(get_Proj_pred(proj)) == pn_Call_T_result);
+			for (size_t i = 0; i < ARRAY_SIZE(ins); ++i) {
+				ins[i] = new_r_Proj(ress[i], mode, num);
+			}
+		} else if (num == pn_Call_M) {
+			for (size_t i = 0; i < ARRAY_SIZE(ins); ++i) {
+				ins[i] = new_r_Proj(calls[i], mode_M, pn_Call_M);
+			}
+		} else {
+			assert(num == pn_Call_T_result);
+			continue;
+		}
+		ir_node *const phi = new_r_Phi(lower_block, ARRAY_SIZE(ins), ins, mode);
+		collect_new_phi_node(phi);
+		exchange(proj, phi);
+	}
+
+	/* calls which do not return are kept alive */
+	ir_node *const end = get_irg_end(irg);
+	for (int i = get_End_n_keepalives(end); i-- > 0;) {
+		if (get_End_keepalive(end, i) == call) {
+			remove_End_keepalive(end, call);
+			add_End_keepalive(end, calls[0]);
+			add_End_keepalive(end, calls[1]);
+			break;
+		}
+	}
+
+	/* Add links for the next part_block() call, like lower_mux does. */
+	set_irn_link(true_proj,  get_irn_link(cond));
+	set_irn_link(false_proj, true_proj);
+	set_irn_link(cond,       false_proj);
+}
+
+void promote_indirect_calls(ir_graph *irg, double min_probability)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.promote_calls");
+
+	promote_env_t env = {
+		.min_probability = min_probability,
+		.calls           = NEW_ARR_F(ir_node*, 0),
+		.targets         = NEW_ARR_F(ir_entity*, 0),
+	};
+	irg_walk_graph(irg, NULL, find_promotable_call, &env);
+
+	size_t const n_calls = ARR_LEN(env.calls);
+	if (n_calls > 0) {
+		ir_resources_t const resources
+			= IR_RESOURCE_IRN_LINK | IR_RESOURCE_PHI_LIST;
+
+		/* This is required by part_block() later. */
+		ir_reserve_resources(irg, resources);
+		collect_phiprojs_and_start_block_nodes(irg);
+
+		for (size_t i = 0; i < n_calls; ++i) {
+			promote_call(env.calls[i], env.targets[i]);
+		}
+
+		ir_free_resources(irg, resources);
+	}
+	DEL_ARR_F(env.targets);
+	DEL_ARR_F(env.calls);
+
+	confirm_irg_properties(irg, n_calls > 0 ? IR_GRAPH_PROPERTIES_NONE
+	                                        : IR_GRAPH_PROPERTIES_ALL);
+}
@@ -26,6 +26,8 @@
 #include "irhooks.h"
 #include "irloop.h"
 #include "pdeq.h"
+#include "array.h"
+#include "util.h"
 #include "debug.h"
 #include "panic.h"
 
@@ -66,42 +68,6 @@ static const_class_t get_const_class(const ir_node *n, const ir_node *block)
 	return NO_CONSTANT;
 }
 
-/**
- * returns the operands of a commutative bin-op, if one operand is
- * a region constant, it is returned as the second one.
- *
- * Beware: Real constants must be returned with higher priority than
- * region constants, because they might be folded.
- */
-static void get_comm_Binop_ops(ir_node *binop, ir_node **a, ir_node **c)
-{
-	assert(is_op_commutative(get_irn_op(binop)));
-	ir_node       *op_a    = get_binop_left(binop);
-	ir_node       *op_b    = get_binop_right(binop);
-	ir_node       *block   = get_nodes_block(binop);
-	const_class_t  class_a = get_const_class(op_a, block);
-	const_class_t  class_b = get_const_class(op_b, block);
-
-	if (class_a == REAL_CONSTANT && class_b == REAL_CONSTANT) {
-		/* if both are constants, one might be a
-		 * pointer constant like NULL, return the other */
-		if (mode_is_reference(get_irn_mode(op_a))) {
-			*a = op_a;
-			*c = op_b;
-		} else {
-			*a = op_b;
-			*c = op_a;
-		}
-	} else if (class_a == REAL_CONSTANT
-	           || (class_a == REGION_CONST && class_b == NO_CONSTANT)) {
-		*a = op_b;
-		*c = op_a;
-	} else {
-		*a = op_a;
-		*c = op_b;
-	}
-}
-
 /**
  * Retrieve a mode from the operands. We need this, because
  * Add and Sub are allowed to operate on (P, Is)
@@ -130,132 +96,21 @@ static ir_node *create_node(dbg_info *dbgi, ir_node *block, ir_op *op,
 }
 
 /**
- * reassociate a commutative Binop
+ * Returns the earliest were a,b are available.
+ * Note that we know that a, b both dominate
+ * the block of the previous operation, so one must dominate the other.
  *
- * BEWARE: this rule leads to a potential loop, if
- * two operands are region constants and the third is a
- * constant, so avoid this situation.
+ * If the earliest block is the start block, return curr_blk instead
  */
-static int reassoc_commutative(ir_node **node)
+static ir_node *earliest_block(ir_node *a, ir_node *b, ir_node *curr_blk)
 {
-	ir_node *n     = *node;
-	ir_op   *op    = get_irn_op(n);
-	ir_node *block = get_nodes_block(n);
-	ir_node *t1;
-	ir_node *c1;
-
-	get_comm_Binop_ops(n, &t1, &c1);
-
-	if (get_irn_op(t1) == op) {
-		ir_node *t2;
-		ir_node *c2;
-		get_comm_Binop_ops(t1, &t2, &c2);
-		const_class_t c_c1 = get_const_class(c1, block);
-		const_class_t c_c2 = get_const_class(c2, block);
-		const_class_t c_t2 = get_const_class(t2, block);
-		if (c_c1 != NO_CONSTANT) {
-			if (((c_c1 ^ c_c2 ^ c_t2) & REGION_CONST) == 0
-			    || (c_c1 & c_c2 & c_t2) == REGION_CONST) {
-				/* All three are constant and either all are constant expressions
-				 * or two of them are:
-				 * then applying this rule would lead into a cycle
-				 *
-				 * Note that if t2 is a constant so is c2 hence we save one test.
-				 */
-				return 0;
-			}
-
-			/* handles rules R7, R8, R9, R10:
-			 * convert c1 .OP. (c2 .OP. x) => x .OP. (c1 .OP. c2)
-			 */
-			ir_mode *mode_c1 = get_irn_mode(c1);
-			ir_mode *mode_c2 = get_irn_mode(c2);
-
-			/* It might happen, that c1 and c2 have different modes, for
-			 * instance Is and Iu.
-			 * Handle this here.
-			 */
-			if (mode_c1 != mode_c2 && mode_is_int(mode_c1) && mode_is_int(mode_c2)) {
-				unsigned bits_c1 = get_mode_size_bits(mode_c1);
-				unsigned bits_c2 = get_mode_size_bits(mode_c2);
-				/* get the bigger one */
-				if (bits_c1 > bits_c2) {
-					c2 = new_r_Conv(block, c2, mode_c1);
-				} else if (bits_c1 < bits_c2) {
-					c1 = new_r_Conv(block, c1, mode_c2);
-				} else {
-					/* Try to cast the real const */
-					if (c_c1 == REAL_CONSTANT)
-						c1 = new_r_Conv(block, c1, mode_c2);
-					else
-						c2 = new_r_Conv(block, c2, mode_c1);
-				}
-			}
-
-			dbg_info *dbgi  = get_irn_dbg_info(n);
-			ir_node  *in0[] = { c1, c2};
-			ir_mode  *mode0 = get_mode_from_ops(c1, c2);
-			ir_node  *irn0  = create_node(dbgi, block, op, mode0, ARRAY_SIZE(in0), in0);
-
-			ir_node *in1[] = { t2, irn0 };
-			ir_mode *mode1 = get_mode_from_ops(t2, irn0);
-			ir_node *irn1  = create_node(dbgi, block, op, mode1, ARRAY_SIZE(in1), in1);
-
-			DBG((dbg, LEVEL_5, "Applied: %n .%s. (%n .%s. %n) => %n .%s. (%n .%s. %n)\n",
-			     c1, get_irn_opname(n), c2, get_irn_opname(n), t2,
-			     t2, get_irn_opname(n), c1, get_irn_opname(n), c2));
-
-			exchange(n, irn1);
-			*node = irn1;
-			return 1;
-		}
-	}
-	if (get_irn_op(c1) == op) {
-		ir_node *t = c1;
-		c1 = t1;
-		t1 = t;
-	}
-	if (get_irn_op(t1) == op) {
-		ir_node *l = get_binop_left(t1);
-		ir_node *r = get_binop_right(t1);
-		if (r == c1) {
-			ir_node *t = r;
-			r = l;
-			l = t;
-		}
-
-		const_class_t c_r = get_const_class(r, block);
-		if (c_r != NO_CONSTANT) {
-			/*
-			 * Beware: don't do the following op if a constant was
-			 * placed below, else we will fall into a loop.
-			 */
-			return 0;
-		}
-
-		if (l == c1 && r != c1) {
-			/* convert x .OP. (x .OP. y) => y .OP. (x .OP. x) */
-			dbg_info *dbgi     = get_irn_dbg_info(n);
-			ir_mode  *mode_res = get_irn_mode(n);
-			ir_mode  *mode_c1  = get_irn_mode(c1);
-			ir_node  *in[]     = { c1, c1 };
-			ir_node  *irn0     = create_node(dbgi, block, op, mode_c1,
-			                                 ARRAY_SIZE(in), in);
-
-			ir_node *in1[] = { r, irn0 };
-			ir_node *irn1  = create_node(dbgi, block, op, mode_res,
-			                             ARRAY_SIZE(in1), in1);
-
-			DBG((dbg, LEVEL_5, "Applied: %n .%s. (%n .%s. %n) => %n .%s. (%n .%s. %n)\n",
-			     c1, get_irn_opname(n), l, get_irn_opname(n), r,
-			     r, get_irn_opname(n), c1, get_irn_opname(n), c1));
-
-			exchange(n, irn1);
-			*node = irn1;
-			return 1;
-		}
-	}
-	return 0;
+	/* if blk_a != blk_b, one must dominate the other */
+	ir_node *blk_a = get_nodes_block(a);
+	ir_node *blk_b = get_nodes_block(b);
+	ir_node *res   = block_dominates(blk_a, blk_b) ? blk_b : blk_a;
+	if (res == get_irg_start_block(get_irn_irg(curr_blk)))
+		return curr_blk;
+	return res;
 }
 
 /**
@@ -272,63 +127,240 @@ static void wq_walker(ir_node *n, void *env)
 	}
 }
 
-/**
- * The walker for the reassociation.
- */
-static void do_reassociation(pdeq *const wq)
+/** An operand of a flattened expression tree. */
+typedef struct tree_operand_t {
+	ir_node  *node;
+	unsigned  rank; /**< 0 for constants, 1 for region constants, else 2 */
+} tree_operand_t;
+
+static unsigned get_rank(const ir_node *n, const ir_node *block)
 {
-	while (!pdeq_empty(wq)) {
-		ir_node *n = (ir_node *)pdeq_getl(wq);
-		set_irn_link(n, NULL);
+	switch (get_const_class(n, block)) {
+	case REAL_CONSTANT: return 0;
+	case REGION_CONST:  return 1;
+	case NO_CONSTANT:   return 2;
+	}
+	panic("invalid const class");
+}
 
-		/* reassociation must run until a fixpoint is reached. */
-		bool changed = false;
-		bool res;
-		do {
-			res = false;
-			ir_op   *op   = get_irn_op(n);
-			ir_mode *mode = get_irn_mode(n);
+static int cmp_tree_operand(const void *a, const void *b)
+{
+	const tree_operand_t *op_a = (const tree_operand_t*)a;
+	const tree_operand_t *op_b = (const tree_operand_t*)b;
+	if (op_a->rank != op_b->rank)
+		return op_a->rank < op_b->rank ? -1 : 1;
+	unsigned idx_a = get_irn_idx(op_a->node);
+	unsigned idx_b = get_irn_idx(op_b->node);
+	return (idx_a > idx_b) - (idx_a < idx_b);
+}
 
-			/* reassociating floatingpoint ops is imprecise */
-			if (mode_is_float(mode) && !ir_imprecise_float_transforms_allowed())
-				break;
+/**
+ * Checks whether @p n is an inner node of the expression tree of @p root,
+ * that is an operation of the same kind in the same block, which is used
+ * only once.
+ */
+static bool is_tree_inner(const ir_node *n, const ir_node *root)
+{
+	if (get_irn_op(n) != get_irn_op(root)
+	    || get_nodes_block(n) != get_nodes_block(root)
+	    || get_irn_n_edges(n) != 1)
+		return false;
+	/* the offsets added to a pointer are part of its tree */
+	ir_mode *mode = get_irn_mode(n);
+	return mode == get_irn_mode(root)
+	    || (is_Add(n) && mode_is_reference(get_irn_mode(root)));
+}
 
-			if (op->ops.reassociate) {
-				res = op->ops.reassociate(&n);
+/**
+ * Checks whether @p n is the root of an expression tree, i.e. not an inner
+ * node of the tree of its only user.
+ */
+static bool is_tree_root(const ir_node *n)
+{
+	if (get_irn_n_edges(n) != 1)
+		return true;
+	const ir_node *user = get_edge_src_irn(get_irn_out_edge_first(n));
+	return !is_tree_inner(n, user);
+}
 
-				changed |= res;
+/**
+ * Collects the operands of the expression tree of @p root.
+ *
+ * @return false if the operands cannot be combined in any order
+ */
+static bool flatten_tree(ir_node *root, tree_operand_t **operands)
+{
+	ir_node  *block    = get_nodes_block(root);
+	ir_node **stack    = NEW_ARR_F(ir_node*, 0);
+	ir_mode  *mode     = NULL;
+	unsigned  n_refs   = 0;
+	bool      mergable = true;
+	ARR_APP1(ir_node*, stack, root);
+	while (ARR_LEN(stack) > 0) {
+		ir_node *n = stack[ARR_LEN(stack) - 1];
+		ARR_SHRINKLEN(stack, ARR_LEN(stack) - 1);
+		ir_node *ins[] = { get_binop_left(n), get_binop_right(n) };
+		for (size_t i = 0; i < ARRAY_SIZE(ins); ++i) {
+			ir_node *op = ins[i];
+			if (is_tree_inner(op, root)) {
+				ARR_APP1(ir_node*, stack, op);
+				continue;
 			}
-		} while (res);
 
-		if (changed) {
-			foreach_irn_in_r(n, i, pred) {
-				if (get_irn_link(pred) != wq) {
-					pdeq_putr(wq, pred);
-					set_irn_link(pred, wq);
-				}
+			/* all operands but a single pointer must have the same mode */
+			ir_mode *op_mode = get_irn_mode(op);
+			if (mode_is_reference(op_mode)) {
+				++n_refs;
+			} else if (mode == NULL) {
+				mode = op_mode;
+			} else if (mode != op_mode) {
+				mergable = false;
 			}
+			tree_operand_t operand = { op, get_rank(op, block) };
+			ARR_APP1(tree_operand_t, *operands, operand);
 		}
 	}
+	DEL_ARR_F(stack);
+	return mergable && n_refs <= (is_Add(root) ? 1 : 0);
 }
 
 /**
- * Returns the earliest were a,b are available.
- * Note that we know that a, b both dominate
- * the block of the previous operation, so one must dominate the other.
- *
- * If the earliest block is the start block, return curr_blk instead
+ * Combines two operands of an expression tree.  Region constants are
+ * combined in the latest block of their operands, which is outside the loop
+ * of @p block.
  */
-static ir_node *earliest_block(ir_node *a, ir_node *b, ir_node *curr_blk)
+static ir_node *combine_operands(dbg_info *dbgi, ir_node *block, ir_op *op,
+                                 ir_node *a, ir_node *b, bool hoist)
 {
-	/* if blk_a != blk_b, one must dominate the other */
-	ir_node *blk_a = get_nodes_block(a);
-	ir_node *blk_b = get_nodes_block(b);
-	ir_node *res   = block_dominates(blk_a, blk_b) ? blk_b : blk_a;
-	if (res == get_irg_start_block(get_irn_irg(curr_blk)))
-		return curr_blk;
+	ir_node *blk  = hoist ? earliest_block(a, b, block) : block;
+	ir_node *in[] = { a, b };
+	ir_mode *mode = get_mode_from_ops(a, b);
+	return create_node(dbgi, blk, op, mode, ARRAY_SIZE(in), in);
+}
+
+/**
+ * Builds a balanced tree of the operands @p ops, so independent operations
+ * may execute in parallel.
+ */
+static ir_node *build_balanced_tree(dbg_info *dbgi, ir_node *block, ir_op *op,
+                                    tree_operand_t *ops, size_t n_ops,
+                                    bool hoist)
+{
+	if (n_ops == 0)
+		return NULL;
+
+	ir_node **nodes = NEW_ARR_F(ir_node*, n_ops);
+	for (size_t i = 0; i < n_ops; ++i)
+		nodes[i] = ops[i].node;
+	for (size_t n = n_ops; n > 1;) {
+		size_t k = 0;
+		for (size_t i = 0; i + 1 < n; i += 2)
+			nodes[k++] = combine_operands(dbgi, block, op, nodes[i], nodes[i + 1], hoist);
+		if (n % 2 != 0)
+			nodes[k++] = nodes[n - 1];
+		n = k;
+	}
+	ir_node *res = nodes[0];
+	DEL_ARR_F(nodes);
 	return res;
 }
 
+/**
+ * Rank based reassociation of a commutative and associative Binop.
+ *
+ * The expression tree with the root @p *node is flattened into the list of
+ * its operands, which is sorted by rank: constants, region constants and
+ * variant values.  The tree is rebuilt in one step as
+ *
+ *   variants .OP. region constants .OP. constants
+ *
+ * where the constants are folded, the region constants are combined outside
+ * of the loop and the variants form a balanced tree.
+ */
+static int reassoc_commutative(ir_node **node)
+{
+	ir_node        *n        = *node;
+	tree_operand_t *operands = NEW_ARR_F(tree_operand_t, 0);
+	int             changed  = 0;
+	if (!flatten_tree(n, &operands) || ARR_LEN(operands) < 3)
+		goto finish;
+
+	size_t n_ops = ARR_LEN(operands);
+	QSORT_ARR(operands, cmp_tree_operand);
+
+	size_t n_consts = 0;
+	while (n_consts < n_ops && operands[n_consts].rank == 0)
+		++n_consts;
+	size_t n_invariants = 0;
+	while (n_consts + n_invariants < n_ops
+	       && operands[n_consts + n_invariants].rank == 1)
+		++n_invariants;
+	size_t n_variants = n_ops - n_consts - n_invariants;
+
+	dbg_info *dbgi       = get_irn_dbg_info(n);
+	ir_node  *block      = get_nodes_block(n);
+	ir_op    *op         = get_irn_op(n);
+	ir_node  *consts     = build_balanced_tree(dbgi, block, op, operands,
+	                                           n_consts, false);
+	ir_node  *invariants = build_balanced_tree(dbgi, block, op,
+	                                           operands + n_consts,
+	                                           n_invariants, true);
+	ir_node  *res        = build_balanced_tree(dbgi, block, op,
+	                                           operands + n_consts + n_invariants,
+	                                           n_variants, false);
+	if (invariants != NULL)
+		res = res != NULL ? combine_operands(dbgi, block, op, res, invariants, false) : invariants;
+	if (consts != NULL)
+		res = res != NULL ? combine_operands(dbgi, block, op, res, consts, false) : consts;
+
+	if (res != n) {
+		DBG((dbg, LEVEL_5, "Reassociated %+F with %zu operands into %+F\n",
+		     n, n_ops, res));
+		exchange(n, res);
+		*node   = res;
+		changed = 1;
+	}
+
+finish:
+	DEL_ARR_F(operands);
+	return changed;
+}
+
+/**
+ * Walker: collects the roots of expression trees.
+ */
+static void collect_tree_roots(ir_node *n, void *env)
+{
+	ir_node ***roots = (ir_node***)env;
+	if (get_irn_op(n)->ops.reassociate && is_tree_root(n))
+		ARR_APP1(ir_node*, *roots, n);
+}
+
+/**
+ * Reassociates every expression tree once.  The roots are visited operands
+ * first, so the operands of a tree are final when it is rebuilt.
+ */
+static void do_reassociation(ir_graph *irg)
+{
+	ir_node **roots = NEW_ARR_F(ir_node*, 0);
+	irg_walk_graph(irg, NULL, collect_tree_roots, &roots);
+
+	for (size_t i = 0, n_roots = ARR_LEN(roots); i < n_roots; ++i) {
+		ir_node *n = roots[i];
+		/* exchanged nodes were already rebuilt */
+		if (is_Id(n) || is_Bad(n))
+			continue;
+
+		/* reassociating floatingpoint ops is imprecise */
+		ir_mode *mode = get_irn_mode(n);
+		if (mode_is_float(mode) && !ir_imprecise_float_transforms_allowed())
+			continue;
+
+		get_irn_op(n)->ops.reassociate(&n);
+	}
+	DEL_ARR_F(roots);
+}
+
 static bool is_const(ir_node *const node)
 {
 	switch (get_irn_opcode(node)) {
@@ -844,7 +876,7 @@ static void do_shannon(ir_graph *irg)
 		replace_node(top_node, base_node, other_node, replacement);
 		DBG((dbg, LEVEL_4, "replaced\n"));
 
-		free(optimization);
+		xfree(optimization);
 	}
 
 	pmap_destroy(walk_counter);
@@ -1073,7 +1105,7 @@ static void destroy_multi_op(multi_op *o)
 	pmap_destroy(o->multiplier);
 	pmap_destroy(o->edge_value);
 
-	free(o);
+	xfree(o);
 }
 
 /**
@@ -1948,7 +1980,7 @@ static void do_Setsort(ir_graph *irg)
 	}
 	del_pset(multi_env->sets);
 	del_pset(multi_env->walkhistory);
-	free(multi_env);
+	xfree(multi_env);
 }
 
 /**
@@ -2105,11 +2137,11 @@ void optimize_reassociation(ir_graph *irg)
 	DBG((dbg, LEVEL_5, "setsort start...\n"));
 	do_Setsort(irg);
 
-	/* now we have collected enough information, optimize */
-	irg_walk_graph(irg, NULL, wq_walker, wq);
-	do_reassociation(wq);
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
 
+	/* now we have collected enough information, optimize */
+	do_reassociation(irg);
+
 	/* reverse those rules that do not result in collapsed constants */
 	irg_walk_graph(irg, NULL, reverse_rules, NULL);
 
@@ -23,6 +23,7 @@
 #include "irnode_t.h"
 #include "iroptimize.h"
 #include "irouts_t.h"
+#include "obst.h"
 #include "opt_init.h"
 #include "pset.h"
 #include "scalar_replace.h"
@@ -56,9 +57,11 @@ typedef union {
  * to variables that will be scalar replaced.
  */
 typedef struct path_t {
-	unsigned    vnum;     /**< The value number. */
-	size_t      path_len; /**< The length of the access path. */
-	path_elem_t path[];   /**< The path. */
+	unsigned    vnum;       /**< The value number. */
+	unsigned    n_accesses; /**< The number of Loads and Stores. */
+	ir_mode    *mode;       /**< The mode of the value. */
+	size_t      path_len;   /**< The length of the access path. */
+	path_elem_t path[];     /**< The path. */
 } path_t;
 
 /** The size of a path in bytes. */
@@ -71,6 +74,15 @@ typedef struct scalars_t {
 	ir_entity *ent;              /**< A entity for scalar replacement. */
 } scalars_t;
 
+/** The accesses of an entity, which is a candidate for scalar replacement. */
+typedef struct entity_info_t {
+	ir_node *leaves; /**< leaf Members and Sels, linked by their links */
+	set     *taints; /**< access paths of the parts whose address is taken */
+} entity_info_t;
+
+/** Maximum number of values a single entity is replaced with. */
+#define MAX_VALUES_PER_ENTITY 64
+
 DEBUG_ONLY(static firm_dbg_module_t *dbg;)
 
 /**
@@ -85,7 +97,8 @@ static int path_cmp(const void *elt, const void *key, size_t size)
 	const path_t *p2 = (const path_t*)key;
 	/* we can use memcmp here, because identical tarvals should have identical
 	 * addresses */
-	return memcmp(p1->path, p2->path, p1->path_len * sizeof(p1->path[0]));
+	return p1->path_len != p2->path_len
+	    || memcmp(p1->path, p2->path, p1->path_len * sizeof(p1->path[0]));
 }
 
 /**
@@ -140,10 +153,39 @@ static ir_type *get_addr_type(const ir_node *addr)
 		return get_entity_type(entity);
 	} else {
 		assert(is_Sel(addr));
-		return get_Sel_type(addr);
+		return get_array_element_type(get_Sel_type(addr));
 	}
 }
 
+/**
+ * Returns true if the Load or Store @p access of the value at @p addr could
+ * be replaced by a scalar, i.e. it is neither volatile nor a hidden
+ * conversion and does not store the address itself.
+ */
+static bool is_replaceable_access(const ir_node *addr, const ir_node *access)
+{
+	ir_mode *const emode = get_type_mode(get_addr_type(addr));
+	if (emode == NULL)
+		return false;
+	if (is_Load(access)) {
+		/* do not remove volatile variables */
+		if (get_Load_volatility(access) == volatility_is_volatile)
+			return false;
+		/* check if this load is not a hidden conversion */
+		return conv_is_bitcast(emode, get_Load_mode(access));
+	}
+
+	/* check that Sel is not the Store's value */
+	ir_node *const value = get_Store_value(access);
+	if (value == addr)
+		return false;
+	/* do not remove volatile variables */
+	if (get_Store_volatility(access) == volatility_is_volatile)
+		return false;
+	/* check if this Store is not a hidden conversion */
+	return conv_is_bitcast(get_irn_mode(value), emode);
+}
+
 /*
  * Returns non-zero, if the value represented by @p node "escapes", i.e. is used
  * by anything else than a load/store.
@@ -154,35 +196,11 @@ bool is_address_taken(ir_node *node)
 
 	foreach_irn_out_r(node, i, succ) {
 		switch (get_irn_opcode(succ)) {
-		case iro_Load: {
-			/* do not remove volatile variables */
-			if (get_Load_volatility(succ) == volatility_is_volatile)
-				return true;
-			/* check if this load is not a hidden conversion */
-			ir_mode *mode  = get_Load_mode(succ);
-			ir_type *type  = get_addr_type(node);
-			ir_mode *emode = get_type_mode(type);
-			if (emode == NULL || !conv_is_bitcast(emode, mode))
-				return true;
-			break;
-		}
-
-		case iro_Store: {
-			/* check that Sel is not the Store's value */
-			ir_node *value = get_Store_value(succ);
-			if (value == node)
-				return true;
-			/* do not remove volatile variables */
-			if (get_Store_volatility(succ) == volatility_is_volatile)
-				return true;
-			/* check if this Store is not a hidden conversion */
-			ir_mode *mode  = get_irn_mode(value);
-			ir_type *type  = get_addr_type(node);
-			ir_mode *emode = get_type_mode(type);
-			if (emode == NULL || !conv_is_bitcast(mode, emode))
+		case iro_Load:
+		case iro_Store:
+			if (!is_replaceable_access(node, succ))
 				return true;
 			break;
-		}
 
 		case iro_Member: {
 			ir_entity *entity = get_Member_entity(succ);
@@ -208,79 +226,141 @@ bool is_address_taken(ir_node *node)
 	return false;
 }
 
-/* we need a special address that serves as an address taken marker */
-static char _x;
-static void *ADDRESS_TAKEN = &_x;
-
-typedef enum leaf_state_t {
-	POSSIBLE_LEAF        = 0,
-	HAS_CHILD_LOAD_STORE = (1u << 0),
-	HAS_CHILD_SELS       = (1u << 1),
-} leaf_state_t;
-
 /**
- * Link all leaf Members with the entity.
+ * Return a path from the Sel node "sel" to its root.
  *
- * @param ent  the entity that will be scalar replaced
- * @param sel  a Sel node that selects some fields of this entity
+ * @param sel  the Sel node
+ * @param len  the length of the path so far
  */
-static leaf_state_t link_all_leaf_members(ir_entity *ent, ir_node *sel)
+static path_t *find_path(ir_node *node, size_t len)
 {
-	/** A leaf Sel is a Sel that is used directly by a Load or Store. */
-	leaf_state_t state = POSSIBLE_LEAF;
-	foreach_irn_out_r(sel, i, succ) {
-		if (is_Load(succ) || is_Store(succ)) {
-			state |= HAS_CHILD_LOAD_STORE;
-			continue;
-		}
-		if (is_Member(succ)) {
-			link_all_leaf_members(ent, succ);
-			state |= HAS_CHILD_SELS;
-		} else if (is_Id(succ)) {
-			state |= link_all_leaf_members(ent, succ);
-		} else {
-			assert(is_End(succ));
-		}
+	/* the current Sel/Member node will add some path elements */
+	path_t *res;
+	if (is_Sel(node)) {
+		ir_node *index = get_Sel_index(node);
+		if (!is_Const(index))
+			goto found_root;
+		ir_node *pred = get_Sel_ptr(node);
+		res = find_path(pred, len+1);
+		size_t pos   = res->path_len - len - 1;
+		/* the same index may be given in different modes */
+		ir_mode *mode = get_reference_offset_mode(get_irn_mode(node));
+		res->path[pos].tv = tarval_convert_to(get_Const_tarval(index), mode);
+	} else if (is_Member(node)) {
+		ir_node *pred = get_Member_ptr(node);
+		res = find_path(pred, len+1);
+		size_t pos = res->path_len - len - 1;
+		res->path[pos].ent = get_Member_entity(node);
+	} else {
+		/* we found the root */
+found_root:
+		res = XMALLOCF(path_t, path, len);
+		res->path_len = len;
 	}
-	if (state & HAS_CHILD_SELS) {
-		/* Sel is not a leaf, if it has load/stores bail out */
-		if (state & HAS_CHILD_LOAD_STORE) {
-			set_entity_link(ent, ADDRESS_TAKEN);
-		}
-		return state;
+	return res;
+}
+
+/**
+ * Marks the part of the entity of @p info at @p node and all parts inside
+ * of it as address taken.
+ */
+static void taint(entity_info_t *info, ir_node *node)
+{
+	path_t *key = find_path(node, 0);
+	(void)set_insert(path_t, info->taints, key, path_size(key),
+	                 path_hash(key));
+	xfree(key);
+}
+
+/**
+ * Returns true if the part at @p path or a part containing it is address
+ * taken.
+ */
+static bool is_tainted(const entity_info_t *info, path_t *path)
+{
+	size_t const len = path->path_len;
+	bool         res = false;
+	for (size_t i = 1; i <= len && !res; ++i) {
+		path->path_len = i;
+		res = set_find(path_t, info->taints, path, path_size(path),
+		               path_hash(path)) != NULL;
 	}
+	path->path_len = len;
+	return res;
+}
+
+/**
+ * Collects the leaf Members and Sels below @p node, i.e. the ones only used
+ * by replaceable Loads and Stores, and the parts whose address is taken.
+ *
+ * An address is only tainted along with the parts inside of it, so the other
+ * fields of a struct can be replaced even if one of them escapes.
+ */
+static void collect_accesses(entity_info_t *info, ir_node *node)
+{
+	bool taken        = false;
+	bool has_access   = false;
+	bool has_children = false;
+	foreach_irn_out_r(node, i, succ) {
+		switch (get_irn_opcode(succ)) {
+		case iro_Load:
+		case iro_Store:
+			has_access = true;
+			if (!is_replaceable_access(node, succ))
+				taken = true;
+			break;
 
-	/* if we are here, then we have found a leaf Sel */
+		case iro_Member:
+			/* we can't handle unions correctly yet -> address taken */
+			if (is_Union_type(get_entity_owner(get_Member_entity(succ)))) {
+				taken = true;
+				break;
+			}
+			has_children = true;
+			collect_accesses(info, succ);
+			break;
 
-	/* beware of Id's */
-	sel = skip_Id(sel);
+		case iro_Sel:
+			/* a variable index may access any element */
+			if (!is_Const(get_Sel_index(succ))) {
+				taken = true;
+				break;
+			}
+			has_children = true;
+			collect_accesses(info, succ);
+			break;
 
-	void *link = get_entity_link(ent);
-	if (link == ADDRESS_TAKEN)
-		return HAS_CHILD_LOAD_STORE | HAS_CHILD_SELS;
+		default:
+			/* another op, the address is taken */
+			taken = true;
+			break;
+		}
+	}
 
-	/* we know we are at a leaf, because this function is only called if
-	 * the address is NOT taken, so sel's successor(s) must be Loads or
-	 * Stores */
-	set_irn_link(sel, link);
-	set_entity_link(ent, sel);
-	return state;
+	/* accesses of a part overlap with the ones of its members */
+	if (taken || (has_access && has_children)) {
+		taint(info, node);
+	} else if (has_access) {
+		set_irn_link(node, info->leaves);
+		info->leaves = node;
+	}
 }
 
 /**
  * Find possible scalar replacements.
  *
- * @param irg  an IR graph
+ * @param irg   an IR graph
+ * @param obst  the obstack for the entity infos
  *
  * This function finds variables on the (members of the) frame type
- * that can be scalar replaced, because their address is never taken.
- * If such a variable is found, its entity link will hold a list of all
- * Sel nodes, that selects the atomic fields of this entity.
- * Otherwise, the link will be ADDRESS_TAKEN or NULL.
+ * that can be scalar replaced, at least partially.  If such a variable is
+ * found, its entity link will hold an entity_info_t with a list of all
+ * Members and Sels, that select the atomic fields of this entity.
+ * Otherwise, the link will be NULL.
  *
  * @return  true if at least one entity could be replaced potentially
  */
-static bool find_possible_replacements(ir_graph *irg)
+static bool find_possible_replacements(ir_graph *irg, struct obstack *obst)
 {
 	/* First, clear the link field of all interesting entities. */
 	ir_type *frame_tp = get_irg_frame_type(irg);
@@ -289,10 +369,10 @@ static bool find_possible_replacements(ir_graph *irg)
 		set_entity_link(ent, NULL);
 	}
 
-	/* Check the ir_graph for Member nodes. If the entity of Member isn't a
-	 * scalar replacement set the link of this entity to ADDRESS_TAKEN. */
+	/* Collect the accesses of the entities of all Member nodes of the frame.
+	 * Parts of the entities which are address taken cannot be replaced. */
 	ir_node *irg_frame = get_irg_frame(irg);
-	int      res       = 0;
+	bool     res       = false;
 	foreach_irn_out_r(irg_frame, i, succ) {
 		if (!is_Member(succ))
 			continue;
@@ -302,126 +382,149 @@ static bool find_possible_replacements(ir_graph *irg)
 		ir_entity *ent = get_Member_entity(succ);
 		if (get_entity_owner(ent) != frame_tp)
 			continue;
-		if (get_entity_link(ent) == ADDRESS_TAKEN)
-			continue;
 
 		/* we can handle arrays, structs and atomic types yet */
 		ir_type *ent_type = get_entity_type(ent);
-		if (is_aggregate_type(ent_type) || is_atomic_type(ent_type)) {
-			if (is_address_taken(succ)) {
-				 /* killing one */
-				if (get_entity_link(ent))
-					--res;
-				set_entity_link(ent, ADDRESS_TAKEN);
-			} else {
-				/* possible found one */
-				if (get_entity_link(ent) == NULL)
-					++res;
-				link_all_leaf_members(ent, succ);
-			}
+		if (!is_aggregate_type(ent_type) && !is_atomic_type(ent_type))
+			continue;
+
+		entity_info_t *info = (entity_info_t*)get_entity_link(ent);
+		if (info == NULL) {
+			info = OALLOCZ(obst, entity_info_t);
+			info->taints = new_set(path_cmp, 8);
+			set_entity_link(ent, info);
 		}
+		collect_accesses(info, succ);
+		res |= info->leaves != NULL;
 	}
 
-	return res != 0;
+	return res;
 }
 
 /**
- * Return a path from the Sel node "sel" to its root.
- *
- * @param sel  the Sel node
- * @param len  the length of the path so far
+ * Frees the entity infos of the frame entities of @p irg, which were not
+ * processed.
  */
-static path_t *find_path(ir_node *node, size_t len)
+static void free_entity_infos(ir_graph *irg)
 {
-	/* the current Sel/Member node will add some path elements */
-	path_t *res;
-	if (is_Sel(node)) {
-		ir_node *index = get_Sel_index(node);
-		if (!is_Const(index))
-			goto found_root;
-		ir_node *pred = get_Sel_ptr(node);
-		res = find_path(pred, len+1);
-		size_t pos   = res->path_len - len - 1;
-		res->path[pos].tv = get_Const_tarval(index);
-	} else if (is_Member(node)) {
-		ir_node *pred = get_Member_ptr(node);
-		res = find_path(pred, len+1);
-		size_t pos = res->path_len - len - 1;
-		res->path[pos].ent = get_Member_entity(node);
-	} else {
-		/* we found the root */
-found_root:
-		res = XMALLOCF(path_t, path, len);
-		res->path_len = len;
+	ir_type *frame_tp = get_irg_frame_type(irg);
+	for (size_t i = get_compound_n_members(frame_tp); i-- > 0;) {
+		ir_entity     *ent  = get_compound_member(frame_tp, i);
+		entity_info_t *info = (entity_info_t*)get_entity_link(ent);
+		if (info != NULL) {
+			del_set(info->taints);
+			set_entity_link(ent, NULL);
+		}
 	}
-	return res;
+}
+
+/**
+ * Compares two paths by their number of accesses, descending.
+ */
+static int cmp_path_accesses(const void *a, const void *b)
+{
+	const path_t *const p1 = *(const path_t**)a;
+	const path_t *const p2 = *(const path_t**)b;
+	return QSORT_CMP(p2->n_accesses, p1->n_accesses);
 }
 
 /**
  * Allocate value numbers for the leafs in our found entities.
  *
- * @param sels  a set that will contain all Sels that have a value number
- * @param ent   the entity that will be scalar replaced
- * @param vnum  the first value number we can assign
- * @param modes a flexible array, containing all the modes of
- *              the value numbers.
+ * @param members   a set that will contain all Members and Sels that have a
+ *                  value number
+ * @param ent       the entity that will be scalar replaced
+ * @param vnum      the first value number we can assign
+ * @param modes     a flexible array, containing all the modes of
+ *                  the value numbers.
+ * @param complete  set to false if some accesses of the entity remain
  *
  * @return the next free value number
  */
 static unsigned allocate_value_numbers(pset *members, ir_entity *ent,
-                                       unsigned vnum, ir_mode ***modes)
+                                       unsigned vnum, ir_mode ***modes,
+                                       bool *complete)
 {
-	set *pathes = new_set(path_cmp, 8);
+	entity_info_t *info   = (entity_info_t*)get_entity_link(ent);
+	set           *pathes = new_set(path_cmp, 8);
 
-	DB((dbg, SET_LEVEL_3, "  Visiting Sel nodes of entity %+F\n", ent));
-	/* visit all Member nodes in the chain of the entity */
-	for (ir_node *member = (ir_node*)get_entity_link(ent), *next;
-	     member != NULL; member = next) {
-		next = (ir_node*)get_irn_link(member);
+	*complete = set_count(info->taints) == 0;
 
-		/* we must mark this member for later */
-		pset_insert_ptr(members, member);
-
-		path_t *key  = find_path(member, 0);
-		path_t *path = set_find(path_t, pathes, key, path_size(key), path_hash(key));
-
-		if (path != NULL) {
-			set_vnum(member, path->vnum);
-			DB((dbg, SET_LEVEL_3, "  %+F represents value %u\n", member,
-			    path->vnum));
-		} else {
-			key->vnum = vnum++;
-
-			(void)set_insert(path_t, pathes, key, path_size(key), path_hash(key));
-
-			set_vnum(member, key->vnum);
-			DB((dbg, SET_LEVEL_3, "  %+F represents value %u\n", member,
-			    key->vnum));
-
-			ARR_EXTO(ir_mode *, *modes, (key->vnum + 15) & ~15);
+	/* collect the paths of the leafs, which are not address taken */
+	DB((dbg, SET_LEVEL_3, "  Visiting Sel nodes of entity %+F\n", ent));
+	for (ir_node *member = info->leaves; member != NULL;
+	     member = (ir_node*)get_irn_link(member)) {
+		path_t *key = find_path(member, 0);
+		if (!is_tainted(info, key)) {
+			key->vnum       = ~0u;
+			key->n_accesses = 0;
+			key->mode       = get_type_mode(get_addr_type(member));
+			path_t *path = set_insert(path_t, pathes, key, path_size(key),
+			                          path_hash(key));
+			path->n_accesses += get_irn_n_outs(member);
+		}
+		xfree(key);
+	}
 
-			ir_entity *entity = get_Member_entity(member);
-			(*modes)[key->vnum] = get_type_mode(get_entity_type(entity));
+	/* only replace the most frequently accessed parts of large entities */
+	size_t   n_pathes = set_count(pathes);
+	path_t **sorted   = XMALLOCN(path_t*, n_pathes);
+	size_t   n        = 0;
+	foreach_set(pathes, path_t, path) {
+		sorted[n++] = path;
+	}
+	if (n_pathes > MAX_VALUES_PER_ENTITY) {
+		QSORT(sorted, n_pathes, cmp_path_accesses);
+		n_pathes  = MAX_VALUES_PER_ENTITY;
+		*complete = false;
+	}
+	for (size_t i = 0; i < n_pathes; ++i) {
+		path_t *const path = sorted[i];
+		path->vnum = vnum++;
 
-			assert((*modes)[key->vnum] && "Value is not atomic");
+		ARR_EXTO(ir_mode *, *modes, (path->vnum + 15) & ~15);
+		(*modes)[path->vnum] = path->mode;
+		assert(path->mode != NULL && "Value is not atomic");
 
 #ifdef DEBUG_libfirm
-			/* Debug output */
-			DB((dbg, SET_LEVEL_2, "  %F", key->path[0].ent));
-			for (unsigned i = 1; i < key->path_len; ++i) {
-				if (is_entity(key->path[i].ent))
-					DB((dbg, SET_LEVEL_2, ".%F", key->path[i].ent));
-				else
-					DB((dbg, SET_LEVEL_2, "[%ld]", get_tarval_long(key->path[i].tv)));
-			}
-			DB((dbg, SET_LEVEL_2, " = %u (%s)\n", PTR_TO_INT(get_irn_link(member)), get_mode_name((*modes)[key->vnum])));
+		/* Debug output */
+		DB((dbg, SET_LEVEL_2, "  %F", path->path[0].ent));
+		for (size_t j = 1; j < path->path_len; ++j) {
+			if (is_entity(path->path[j].ent))
+				DB((dbg, SET_LEVEL_2, ".%F", path->path[j].ent));
+			else
+				DB((dbg, SET_LEVEL_2, "[%ld]", get_tarval_long(path->path[j].tv)));
+		}
+		DB((dbg, SET_LEVEL_2, " = %u (%s)\n", path->vnum,
+		    get_mode_name(path->mode)));
 #endif /* DEBUG_libfirm */
+	}
+	xfree(sorted);
+
+	/* mark the leafs with a value number for later, the links are
+	 * overwritten with the value numbers now */
+	for (ir_node *member = info->leaves, *next; member != NULL;
+	     member = next) {
+		next = (ir_node*)get_irn_link(member);
+
+		path_t *key  = find_path(member, 0);
+		path_t *path = set_find(path_t, pathes, key, path_size(key),
+		                        path_hash(key));
+		xfree(key);
+		if (path == NULL || path->vnum == ~0u) {
+			*complete = false;
+			set_irn_link(member, NULL);
+			continue;
 		}
-		free(key);
+		pset_insert_ptr(members, member);
+		set_vnum(member, path->vnum);
+		DB((dbg, SET_LEVEL_3, "  %+F represents value %u\n", member,
+		    path->vnum));
 	}
 
-	del_set(pathes);
+	del_set(info->taints);
 	set_entity_link(ent, NULL);
+	del_set(pathes);
 	return vnum;
 }
 
@@ -444,8 +547,6 @@ static void walker(ir_node *node, void *ctx)
 	if (is_Load(node)) {
 		/* a load, check if we can resolve it */
 		ir_node *addr = get_Load_ptr(node);
-		if (!is_Member(addr))
-			return;
 		if (!pset_find_ptr(env->members, addr))
 			return;
 
@@ -490,8 +591,6 @@ static void walker(ir_node *node, void *ctx)
 	} else if (is_Store(node)) {
 		/* a Store always can be replaced */
 		ir_node *addr = get_Store_ptr(node);
-		if (!is_Member(addr))
-			return;
 		if (!pset_find_ptr(env->members, addr))
 			return;
 
@@ -571,8 +670,10 @@ void scalar_replacement_opt(ir_graph *irg)
 	irp_reserve_resources(irp, IRP_RESOURCE_ENTITY_LINK);
 
 	/* Find possible scalar replacements */
+	struct obstack obst;
+	obstack_init(&obst);
 	bool changed = false;
-	if (find_possible_replacements(irg)) {
+	if (find_possible_replacements(irg, &obst)) {
 		DB((dbg, SET_LEVEL_1, "Scalar Replacement: %+F\n", irg));
 
 		/* Insert in set the scalar replacements. */
@@ -593,14 +694,11 @@ void scalar_replacement_opt(ir_graph *irg)
 			if (get_entity_owner(ent) != frame_tp || is_parameter_entity(ent))
 				continue;
 
-			if (get_entity_link(ent) == NULL
-				|| get_entity_link(ent) == ADDRESS_TAKEN)
+			/* the link is cleared once the entity is processed */
+			entity_info_t *info = (entity_info_t*)get_entity_link(ent);
+			if (info == NULL || info->leaves == NULL)
 				continue;
 
-			scalars_t key;
-			key.ent = ent;
-			(void)set_insert(scalars_t, set_ent, &key, sizeof(key), hash_ptr(key.ent));
-
 #ifdef DEBUG_libfirm
 			ir_type *ent_type = get_entity_type(ent);
 
@@ -615,7 +713,15 @@ void scalar_replacement_opt(ir_graph *irg)
 			}
 #endif
 
-			nvals = allocate_value_numbers(sels, ent, nvals, &modes);
+			bool complete;
+			nvals = allocate_value_numbers(sels, ent, nvals, &modes, &complete);
+
+			/* the entity is only removed if all of its accesses are */
+			if (complete) {
+				scalars_t key;
+				key.ent = ent;
+				(void)set_insert(scalars_t, set_ent, &key, sizeof(key), hash_ptr(key.ent));
+			}
 		}
 
 		DB((dbg, SET_LEVEL_1, "  %u values will be needed\n", nvals));
@@ -634,6 +740,8 @@ void scalar_replacement_opt(ir_graph *irg)
 		del_set(set_ent);
 		DEL_ARR_F(modes);
 	}
+	free_entity_infos(irg);
+	obstack_free(&obst, NULL);
 
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
 	irp_free_resources(irp, IRP_RESOURCE_ENTITY_LINK);
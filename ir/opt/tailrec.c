@@ -607,7 +607,7 @@ void opt_tail_rec_irg(ir_graph *irg)
 	} else {
 		confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_ALL);
 	}
-	free(env.variants);
-	free(env.parameter_projs);
+	xfree(env.variants);
+	xfree(env.parameter_projs);
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
 }
@@ -89,7 +89,7 @@ static bool remove_unreachable_keeps(ir_graph *irg)
 		set_End_keepalives(end, new_arity, new_in);
 		changed = true;
 	}
-	free(new_in);
+	xfree(new_in);
 
 	return changed;
 }
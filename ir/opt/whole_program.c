@@ -0,0 +1,116 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief    Whole program optimization of programs merged from several units.
+ */
+#include "iroptimize.h"
+
+#include "array.h"
+#include "cgana.h"
+#include "debug.h"
+#include "entity_t.h"
+#include "ircgopt.h"
+#include "irnode_t.h"
+#include "irprog_t.h"
+#include "util.h"
+#include "xmalloc.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** Makes the definitions in @p segment local unless they are kept. */
+static void internalize_segment(ir_type *segment)
+{
+	for (size_t i = 0, n = get_compound_n_members(segment); i < n; ++i) {
+		ir_entity *const entity = get_compound_member(segment, i);
+		if (entity_visited(entity) || !entity_has_definition(entity)
+		    || get_entity_visibility(entity) == ir_visibility_local
+		    || get_entity_visibility(entity) == ir_visibility_private
+		    || (get_entity_linkage(entity) & IR_LINKAGE_HIDDEN_USER))
+			continue;
+
+		DB((dbg, LEVEL_1, "  making %+F local\n", entity));
+		set_entity_visibility(entity, ir_visibility_local);
+	}
+}
+
+static void collect_node_methods(ir_node *node, ir_entity ***methods)
+{
+	if (is_Address(node)) {
+		ir_entity *const entity = get_Address_entity(node);
+		if (is_method_entity(entity) && get_entity_irg(entity) != NULL)
+			ARR_APP1(ir_entity*, *methods, entity);
+		return;
+	}
+	foreach_irn_in(node, i, pred) {
+		collect_node_methods(pred, methods);
+	}
+}
+
+static void collect_initializer_methods(ir_initializer_t const *initializer,
+                                        ir_entity ***methods)
+{
+	switch (get_initializer_kind(initializer)) {
+	case IR_INITIALIZER_CONST:
+		collect_node_methods(get_initializer_const_value(initializer),
+		                     methods);
+		return;
+	case IR_INITIALIZER_TARVAL:
+	case IR_INITIALIZER_NULL:
+		return;
+	case IR_INITIALIZER_COMPOUND:
+		for (size_t i = 0, n = get_initializer_compound_n_entries(initializer);
+		     i < n; ++i) {
+			collect_initializer_methods(
+				get_initializer_compound_value(initializer, i), methods);
+		}
+		return;
+	}
+	panic("invalid initializer found");
+}
+
+/**
+ * Collects the methods referenced by the constructor and destructor tables,
+ * cgana() only considers the global and thread local segments.
+ */
+static void collect_segment_methods(ir_segment_t segment, ir_entity ***methods)
+{
+	ir_type *const type = get_segment_type(segment);
+	for (size_t i = 0, n = get_compound_n_members(type); i < n; ++i) {
+		ir_entity        *const entity = get_compound_member(type, i);
+		ir_initializer_t *const init   = is_method_entity(entity)
+			? NULL : get_entity_initializer(entity);
+		if (init != NULL)
+			collect_initializer_methods(init, methods);
+	}
+}
+
+void optimize_whole_program(size_t n_keep, ir_entity **keep,
+                            unsigned inline_maxsize, int inline_threshold)
+{
+	FIRM_DBG_REGISTER(dbg, "firm.opt.wholeprogram");
+
+	irp_reserve_resources(irp, IRP_RESOURCE_TYPE_VISITED);
+	inc_master_type_visited();
+	for (size_t i = 0; i < n_keep; ++i)
+		mark_entity_visited(keep[i]);
+	internalize_segment(get_glob_type());
+	internalize_segment(get_tls_type());
+	irp_free_resources(irp, IRP_RESOURCE_TYPE_VISITED);
+
+	ir_entity **free_methods;
+	size_t const n_free  = cgana(&free_methods);
+	ir_entity  **methods = NEW_ARR_F(ir_entity*, n_free);
+	MEMCPY(methods, free_methods, n_free);
+	xfree(free_methods);
+	collect_segment_methods(IR_SEGMENT_CONSTRUCTORS, &methods);
+	collect_segment_methods(IR_SEGMENT_DESTRUCTORS, &methods);
+	gc_irgs(ARR_LEN(methods), methods);
+	DEL_ARR_F(methods);
+
+	inline_functions(inline_maxsize, inline_threshold, NULL);
+	garbage_collect_types();
+}
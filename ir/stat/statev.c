@@ -15,17 +15,51 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "stat_timing.h"
+#include "hashptr.h"
 #include "irprintf.h"
+#include "set.h"
 #include "statev_t.h"
 #include "util.h"
+#include "xmalloc.h"
 
 #define MAX_TIMER 256
 
+/** Size of the output buffer of the binary format. */
+#define STAT_EV_BUFFER_SIZE (64 * 1024)
+
+/** Magic number starting a binary event stream, followed by the version. */
+#define STAT_EV_MAGIC   "FIRMSTEV"
+#define STAT_EV_VERSION 1
+
+/**
+ * Record tags of the binary format.  Every record but a key definition is
+ * followed by the id of its key and the ticks elapsed since the previous
+ * event, both as unsigned LEB128 varints.
+ */
+typedef enum stat_ev_tag {
+	STAT_EV_TAG_KEY  = 'K', /**< key definition: id, length, characters */
+	STAT_EV_TAG_PUSH = 'P', /**< context push: length, characters */
+	STAT_EV_TAG_POP  = 'O', /**< context pop: no payload */
+	STAT_EV_TAG_INT  = 'i', /**< signed value: zigzag varint */
+	STAT_EV_TAG_ULL  = 'u', /**< unsigned value: varint */
+	STAT_EV_TAG_DBL  = 'd', /**< double value: 8 bytes, little endian */
+	STAT_EV_TAG_NONE = 'e', /**< event without a value */
+} stat_ev_tag;
+
+/** A key seen in an event, the filter only runs once per key. */
+typedef struct stat_ev_key {
+	unsigned id;      /**< id in the binary stream, 0 if not written yet */
+	bool     matches; /**< whether the key passes the filter */
+	char     name[];
+} stat_ev_key;
+
 int (stat_ev_enabled) = 0;
 
 static FILE          *stat_ev_file;
+static bool           stat_ev_binary;
 static int            stat_ev_timer_sp;
 static timing_ticks_t stat_ev_timer_elapsed[MAX_TIMER];
 static timing_ticks_t stat_ev_timer_start[MAX_TIMER];
@@ -33,17 +67,102 @@ static timing_ticks_t stat_ev_timer_start[MAX_TIMER];
 static regex_t  regex;
 static regex_t *filter;
 
-static bool key_matches(const char *key)
+static set           *keys;
+static unsigned       n_written_keys;
+static timing_ticks_t last_ticks;
+static unsigned char  buffer[STAT_EV_BUFFER_SIZE];
+static size_t         buffer_fill;
+
+static int cmp_key(const void *p1, const void *p2, size_t size)
+{
+	(void)size;
+	const stat_ev_key *const k1 = (const stat_ev_key*)p1;
+	const stat_ev_key *const k2 = (const stat_ev_key*)p2;
+	return strcmp(k1->name, k2->name);
+}
+
+/** Returns the entry of @p key, running the filter if it is new. */
+static stat_ev_key *get_key(const char *key)
 {
-	if (filter == NULL)
-		return true;
+	size_t       const len  = strlen(key);
+	size_t       const size = sizeof(stat_ev_key) + len + 1;
+	stat_ev_key *const temp = (stat_ev_key*)alloca(size);
+	memcpy(temp->name, key, len + 1);
+	unsigned     const hash = hash_data((const unsigned char*)key, len);
+	stat_ev_key *entry = set_find(stat_ev_key, keys, temp, size, hash);
+	if (entry == NULL) {
+		temp->id      = 0;
+		temp->matches = filter == NULL
+		             || regexec(filter, key, 0, NULL, 0) == 0;
+		entry = set_insert(stat_ev_key, keys, temp, size, hash);
+	}
+	return entry;
+}
+
+static void flush_buffer(void)
+{
+	fwrite(buffer, 1, buffer_fill, stat_ev_file);
+	buffer_fill = 0;
+}
+
+/** Makes sure there is room for @p size more bytes in the buffer. */
+static void reserve(size_t size)
+{
+	assert(size <= sizeof(buffer));
+	if (buffer_fill + size > sizeof(buffer))
+		flush_buffer();
+}
+
+static void put_byte(unsigned char c)
+{
+	reserve(1);
+	buffer[buffer_fill++] = c;
+}
+
+static void put_varint(unsigned long long value)
+{
+	reserve(10);
+	do {
+		unsigned char c = value & 0x7F;
+		value >>= 7;
+		if (value != 0)
+			c |= 0x80;
+		buffer[buffer_fill++] = c;
+	} while (value != 0);
+}
+
+static void put_bytes(const char *data, size_t size)
+{
+	put_varint(size);
+	while (size > 0) {
+		reserve(1);
+		size_t const n = MIN(size, sizeof(buffer) - buffer_fill);
+		memcpy(&buffer[buffer_fill], data, n);
+		buffer_fill += n;
+		data        += n;
+		size        -= n;
+	}
+}
 
-	return regexec(filter, key, 0, NULL, 0) == 0;
+/** Writes the header of a binary record, defining its key if needed. */
+static void put_record(stat_ev_tag tag, stat_ev_key *key)
+{
+	if (key->id == 0) {
+		key->id = ++n_written_keys;
+		put_byte(STAT_EV_TAG_KEY);
+		put_varint(key->id);
+		put_bytes(key->name, strlen(key->name));
+	}
+	timing_ticks_t const now = timing_ticks();
+	put_byte(tag);
+	put_varint(key->id);
+	put_varint(now - last_ticks);
+	last_ticks = now;
 }
 
 static void stat_ev_vprintf(char ev, const char *key, const char *fmt, va_list ap)
 {
-	if (!key_matches(key))
+	if (!get_key(key)->matches)
 		return;
 
 	putc(ev, stat_ev_file);
@@ -64,6 +183,34 @@ static void stat_ev_printf(char ev, const char *key, const char *fmt, ...)
 	va_end(ap);
 }
 
+/**
+ * Emits a value event, @p fmt and the variadic value are used for the text
+ * format, @p tag and @p bits for the binary one.
+ */
+static void emit_value(const char *name, stat_ev_tag tag,
+                       unsigned long long bits, const char *fmt, ...)
+{
+	if (!stat_ev_binary) {
+		va_list ap;
+		va_start(ap, fmt);
+		stat_ev_vprintf('E', name, fmt, ap);
+		va_end(ap);
+		return;
+	}
+
+	stat_ev_key *const key = get_key(name);
+	if (!key->matches)
+		return;
+	put_record(tag, key);
+	if (tag == STAT_EV_TAG_DBL) {
+		reserve(8);
+		for (unsigned i = 0; i < 8; ++i)
+			buffer[buffer_fill++] = (unsigned char)(bits >> (8 * i));
+	} else if (tag != STAT_EV_TAG_NONE) {
+		put_varint(bits);
+	}
+}
+
 void stat_ev_tim_push(void)
 {
 	int            sp   = stat_ev_timer_sp++;
@@ -99,7 +246,17 @@ void stat_ev_tim_pop(const char *name)
 void do_stat_ev_ctx_push_vfmt(const char *key, const char *fmt, va_list ap)
 {
 	stat_ev_tim_push();
-	stat_ev_vprintf('P', key, fmt, ap);
+	if (stat_ev_binary) {
+		stat_ev_key *const entry = get_key(key);
+		if (entry->matches) {
+			char value[256];
+			ir_vsnprintf(value, sizeof(value), fmt, ap);
+			put_record(STAT_EV_TAG_PUSH, entry);
+			put_bytes(value, strlen(value));
+		}
+	} else {
+		stat_ev_vprintf('P', key, fmt, ap);
+	}
 	stat_ev_tim_pop(NULL);
 }
 
@@ -122,7 +279,13 @@ void (stat_ev_ctx_push_str)(const char *key, const char *str)
 void do_stat_ev_ctx_pop(const char *key)
 {
 	stat_ev_tim_push();
-	stat_ev_printf('O', key, NULL);
+	if (stat_ev_binary) {
+		stat_ev_key *const entry = get_key(key);
+		if (entry->matches)
+			put_record(STAT_EV_TAG_POP, entry);
+	} else {
+		stat_ev_printf('O', key, NULL);
+	}
 	stat_ev_tim_pop(NULL);
 }
 
@@ -134,7 +297,8 @@ void (stat_ev_ctx_pop)(const char *key)
 void do_stat_ev_dbl(const char *name, double value)
 {
 	stat_ev_tim_push();
-	stat_ev_printf('E', name, "%g", value);
+	union { double d; unsigned long long u; } bits = { .d = value };
+	emit_value(name, STAT_EV_TAG_DBL, bits.u, "%g", value);
 	stat_ev_tim_pop(NULL);
 }
 
@@ -146,7 +310,11 @@ void (stat_ev_dbl)(const char *name, double value)
 void do_stat_ev_int(const char *name, int value)
 {
 	stat_ev_tim_push();
-	stat_ev_printf('E', name, "%d", value);
+	/* zigzag encoding keeps small negative values short */
+	unsigned long long const zigzag = value < 0
+		? 2 * (unsigned long long)-(long long)value - 1
+		: 2 * (unsigned long long)value;
+	emit_value(name, STAT_EV_TAG_INT, zigzag, "%d", value);
 	stat_ev_tim_pop(NULL);
 }
 
@@ -158,7 +326,7 @@ void (stat_ev_int)(const char *name, int value)
 void do_stat_ev_ull(const char *name, unsigned long long value)
 {
 	stat_ev_tim_push();
-	stat_ev_printf('E', name, "%llu", value);
+	emit_value(name, STAT_EV_TAG_ULL, value, "%llu", value);
 	stat_ev_tim_pop(NULL);
 }
 
@@ -170,7 +338,7 @@ void (stat_ev_ull)(const char *name, unsigned long long value)
 void do_stat_ev(const char *name)
 {
 	stat_ev_tim_push();
-	stat_ev_printf('E', name, "0.0");
+	emit_value(name, STAT_EV_TAG_NONE, 0, "0.0");
 	stat_ev_tim_pop(NULL);
 }
 
@@ -179,14 +347,19 @@ void (stat_ev)(const char *name)
 	stat_ev_(name);
 }
 
-void stat_ev_begin(const char *prefix, const char *filt)
+static void begin(const char *prefix, const char *filt, bool binary)
 {
 	char buf[512];
 
-	snprintf(buf, sizeof(buf), "%s.ev", prefix);
-	stat_ev_file = fopen(buf, "wt");
+	snprintf(buf, sizeof(buf), "%s.%s", prefix, binary ? "evb" : "ev");
+	stat_ev_file = fopen(buf, binary ? "wb" : "wt");
 	if (stat_ev_file == NULL) {
 		fprintf(stderr, "Warning: Couldn't create statev output '%s'\n", buf);
+	} else if (binary) {
+		fputs(STAT_EV_MAGIC, stat_ev_file);
+		putc(STAT_EV_VERSION, stat_ev_file);
+	} else {
+		setvbuf(stat_ev_file, NULL, _IOFBF, STAT_EV_BUFFER_SIZE);
 	}
 
 	if (filt != NULL && filt[0] != '\0') {
@@ -200,12 +373,29 @@ void stat_ev_begin(const char *prefix, const char *filt)
 		}
 	}
 
+	keys            = new_set(cmp_key, 64);
+	n_written_keys  = 0;
+	last_ticks      = timing_ticks();
+	buffer_fill     = 0;
+	stat_ev_binary  = binary;
 	stat_ev_enabled = stat_ev_file != NULL;
 }
 
+void stat_ev_begin(const char *prefix, const char *filt)
+{
+	begin(prefix, filt, false);
+}
+
+void stat_ev_begin_binary(const char *prefix, const char *filt)
+{
+	begin(prefix, filt, true);
+}
+
 void stat_ev_end(void)
 {
 	if (stat_ev_file != NULL) {
+		if (stat_ev_binary)
+			flush_buffer();
 		fclose(stat_ev_file);
 		stat_ev_file    = NULL;
 		stat_ev_enabled = 0;
@@ -214,4 +404,8 @@ void stat_ev_end(void)
 		regfree(filter);
 		filter = NULL;
 	}
+	if (keys != NULL) {
+		del_set(keys);
+		keys = NULL;
+	}
 }
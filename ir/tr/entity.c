@@ -70,6 +70,7 @@ static ir_entity *new_entity_vis(ir_type *owner, ident *name, ir_type *type,
 		res->attr.mtd_attr.param_access  = NULL;
 		res->attr.mtd_attr.param_weight  = NULL;
 		res->attr.mtd_attr.irg           = NULL;
+		res->attr.mtd_attr.lazy_irg      = NULL;
 	} else if (is_compound_type(owner) && !is_segment_type(owner)) {
 		res = intern_new_entity(owner, IR_ENTITY_COMPOUND_MEMBER, name, type,
 		                        vis);
@@ -180,15 +181,17 @@ ir_entity *clone_entity(ir_entity const *const old, ident *const name,
 		/* do NOT copy them, reanalyze. This might be the best solution */
 		res->attr.mtd_attr.param_access = NULL;
 		res->attr.mtd_attr.param_weight = NULL;
+		res->attr.mtd_attr.lazy_irg     = NULL;
 	}
 	res->overwrites    = NULL;
 	res->overwrittenby = NULL;
 
-	res->nr    = get_irp_new_node_nr();
-	res->name  = name;
-	res->visit = 0;
-	res->usage = ir_usage_unknown;
-	res->owner = owner;
+	res->nr      = get_irp_new_node_nr();
+	res->name    = name;
+	res->ld_name = name;
+	res->visit   = 0;
+	res->usage   = ir_usage_unknown;
+	res->owner   = owner;
 	add_compound_member(owner, res);
 	hook_new_entity(res);
 	return res;
@@ -203,7 +206,7 @@ void free_entity(ir_entity *ent)
 #ifdef DEBUG_libfirm
 	ent->firm_tag = k_BAD;
 #endif
-	free(ent);
+	xfree(ent);
 }
 
 long get_entity_nr(const ir_entity *ent)
@@ -114,6 +114,8 @@ typedef struct method_ent_attr {
 	global_ent_attr           base;
 	ir_graph *irg;                 /**< The corresponding irg if known.
 	                                    The ir_graph constructor automatically sets this field. */
+	struct ir_lazy_irg *lazy_irg;  /**< The graph imported by ir_import_mmap()
+	                                    if it is not constructed yet. */
 
 	unsigned vtable_number;        /**< For a dynamically called method, the number assigned
 	                                    in the virtual function table. */
@@ -183,6 +185,7 @@ struct ir_entity {
 	ENUMBF(ir_entity_usage) usage:4;       /**< Usage type of entity */
 	ENUMBF(ir_visibility)   visibility:3;  /**< Visibility of entity. */
 	ENUMBF(unsigned)        alignment:12;  /**< entity alignment in bytes */
+	unsigned member_index;   /**< Position in the member list of the owner. */
 	ir_visited_t visit;      /**< visited counter for walks of the type
 	                              information. */
 	dbg_info *dbi;           /**< A pointer to information for debug support. */
@@ -391,10 +394,15 @@ static inline void _set_entity_link(ir_entity *ent, void *l)
 	ent->link = l;
 }
 
+/** Constructs the pending graph of @p ent, see ir_import_mmap(). */
+ir_graph *ir_load_lazy_irg(ir_entity *ent);
+
 static inline ir_graph *_get_entity_irg(const ir_entity *ent)
 {
 	assert(ent->firm_tag == k_entity);
 	assert(ent->kind == IR_ENTITY_METHOD);
+	if (UNLIKELY(ent->attr.mtd_attr.lazy_irg != NULL))
+		return ir_load_lazy_irg((ir_entity*)ent);
 	return ent->attr.mtd_attr.irg;
 }
 
@@ -27,6 +27,7 @@
  *  on the level of the programming language, modes at the level of
  *  the target processor.
  */
+#include <limits.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stddef.h>
@@ -185,7 +186,7 @@ void free_type(ir_type *tp)
 #ifdef DEBUG_libfirm
 	tp->kind = k_BAD;
 #endif
-	free(tp);
+	xfree(tp);
 }
 
 void *(get_type_link)(const ir_type *tp)
@@ -198,11 +199,6 @@ void (set_type_link)(ir_type *tp, void *l)
 	set_type_link_(tp, l);
 }
 
-static inline bool is_type(const void *thing)
-{
-	return get_kind(thing) == k_type;
-}
-
 tp_opcode (get_type_opcode)(ir_type const *const type)
 {
 	return get_type_opcode_(type);
@@ -605,8 +601,8 @@ ir_type *clone_type_method(ir_type *tp)
 void free_method_attrs(ir_type *method)
 {
 	assert(is_Method_type(method));
-	free(method->attr.method.params);
-	free(method->attr.method.res_type);
+	xfree(method->attr.method.params);
+	xfree(method->attr.method.res_type);
 }
 
 size_t (get_method_n_params)(const ir_type *method)
@@ -929,10 +925,9 @@ size_t get_compound_member_index(ir_type const *const type,
                                  ir_entity const *const entity)
 {
 	assert(is_compound_type(type));
-	for (size_t i = 0, n = get_compound_n_members(type); i < n; ++i) {
-		if (get_compound_member(type, i) == entity)
-			return i;
-	}
+	size_t const i = entity->member_index;
+	if (i < get_compound_n_members(type) && get_compound_member(type, i) == entity)
+		return i;
 	return INVALID_MEMBER_INDEX;
 }
 
@@ -970,21 +965,44 @@ const char *get_compound_name(const ir_type *tp)
 
 void remove_compound_member(ir_type *type, ir_entity *member)
 {
-	assert(is_compound_type(type));
-	for (size_t i = 0, n = ARR_LEN(type->attr.compound.members); i < n; ++i) {
-		if (get_compound_member(type, i) != member)
+	size_t i = get_compound_member_index(type, member);
+	if (i == INVALID_MEMBER_INDEX)
+		return;
+	ir_entity **const members = type->attr.compound.members;
+	size_t      const n       = ARR_LEN(members);
+	for (; i < n - 1; ++i) {
+		members[i] = members[i+1];
+		members[i]->member_index = i;
+	}
+	ARR_SETLEN(ir_entity*, type->attr.compound.members, n-1);
+	/* members of global type must also be removed from map */
+	if (is_segment_type(type) && !(type->flags & tf_info)
+	 && get_entity_visibility(member) != ir_visibility_private) {
+		pmap *globals = irp->globals;
+		pmap_insert(globals, get_entity_ld_ident(member), NULL);
+	}
+}
+
+void remove_compound_members_if(ir_type *type, compound_member_pred *remove,
+                                void *env)
+{
+	ir_entity **const members   = type->attr.compound.members;
+	bool        const is_global = is_segment_type(type) && !(type->flags & tf_info);
+	size_t            n         = 0;
+	for (size_t i = 0, l = ARR_LEN(members); i < l; ++i) {
+		ir_entity *const member = members[i];
+		if (!remove(member, env)) {
+			member->member_index = n;
+			members[n++]         = member;
 			continue;
-		for (; i < n - 1; ++i)
-			type->attr.compound.members[i] = type->attr.compound.members[i+1];
-		ARR_SETLEN(ir_entity*, type->attr.compound.members, n-1);
-		/* members of global type must also be removed from map */
-		if (is_segment_type(type) && !(type->flags & tf_info)
-		 && get_entity_visibility(member) != ir_visibility_private) {
-			pmap *globals = irp->globals;
-			pmap_insert(globals, get_entity_ld_ident(member), NULL);
 		}
-		break;
+		/* not found by get_compound_member_index() anymore */
+		member->member_index = UINT_MAX;
+		/* members of global type must also be removed from map */
+		if (is_global && get_entity_visibility(member) != ir_visibility_private)
+			pmap_insert(irp->globals, get_entity_ld_ident(member), NULL);
 	}
+	ARR_SHRINKLEN(type->attr.compound.members, n);
 }
 
 void add_compound_member(ir_type *type, ir_entity *entity)
@@ -992,6 +1010,7 @@ void add_compound_member(ir_type *type, ir_entity *entity)
 	assert(is_compound_type(type));
 	/* try to detect double-add */
 	assert(get_entity_type(entity) != type);
+	entity->member_index = ARR_LEN(type->attr.compound.members);
 	ARR_APP1(ir_entity *, type->attr.compound.members, entity);
 	/* Add segment members to globals map. */
 	if (is_segment_type(type) && !(type->flags & tf_info)
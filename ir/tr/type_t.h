@@ -133,6 +133,7 @@ struct ir_type {
 	ir_visited_t visit;      /**< visited counter for walks of the type information */
 	void *link;              /**< holds temporary data - like in irnode_t.h */
 	type_dbg_info *dbi;      /**< A pointer to information for debug support. */
+	size_t irp_pos;          /**< position in the type list of irp */
 	ir_type *higher_type;    /**< link to highlevel type in case of lowered
 	                              types */
 	long nr;                 /**< An unique number for each type. */
@@ -154,6 +155,16 @@ void free_method_attrs(ir_type *method);
 
 void add_compound_member(ir_type *compound, ir_entity *entity);
 
+/** Predicate deciding whether a compound member is removed. */
+typedef bool compound_member_pred(ir_entity const *member, void *env);
+
+/**
+ * Removes all members of @p compound for which @p remove returns true in a
+ * single pass.  The removed members are not freed.
+ */
+void remove_compound_members_if(ir_type *compound,
+                                compound_member_pred *remove, void *env);
+
 /** Initialize the type module. */
 void ir_init_type(ir_prog *irp);
 
@@ -371,6 +382,11 @@ static inline void set_method_calling_convention_(ir_type *method, unsigned cc_m
 	method->attr.method.irg_calling_conv = cc_mask;
 }
 
+static inline bool is_type(const void *thing)
+{
+	return get_kind(thing) == k_type;
+}
+
 /**
  * Check if type is a compound or array type.
  * This function returns true iff a value of this type cannot be represented by
@@ -285,6 +285,190 @@ static void fc_get_qnan(const float_descriptor_t *desc, fp_value *result)
 	fc_get_nan(desc, result, false, NULL);
 }
 
+/*
+ * Host FPU fast path: binary32/binary64 values with normal operands and
+ * results are computed with native double arithmetic when rounding to
+ * nearest. Rounding a double result of +, -, *, / on float operands to float
+ * gives the correctly rounded float result, as 53 >= 2*24+2. Everything else
+ * (NaN, Inf, zero, subnormals, other rounding modes and formats) is emulated.
+ */
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0 && FLT_RADIX == 2 \
+    && FLT_MANT_DIG == 24 && DBL_MANT_DIG == 53
+#define HAVE_NATIVE_FP
+#endif
+
+#ifdef HAVE_NATIVE_FP
+typedef enum native_op_t {
+	NATIVE_ADD,
+	NATIVE_SUB,
+	NATIVE_MUL,
+	NATIVE_DIV,
+} native_op_t;
+
+/** Returns the precision (including the implicit one) of an IEEE binary32
+ * or binary64 descriptor, 0 for other formats. */
+static unsigned native_precision(const float_descriptor_t *desc)
+{
+	if (desc->explicit_one)
+		return 0;
+	if (desc->exponent_size == 8 && desc->mantissa_size == 23)
+		return FLT_MANT_DIG;
+	if (desc->exponent_size == 11 && desc->mantissa_size == 52)
+		return DBL_MANT_DIG;
+	return 0;
+}
+
+/**
+ * Values in the lowest binade are left to the emulation, so that products and
+ * quotients of native values stay clear of the subnormal range and the
+ * exactness checks below hold.
+ */
+static bool is_native(const fp_value *value)
+{
+	return value->clss == FC_NORMAL && native_precision(&value->desc) != 0
+	    && sc_val_to_uint64(_exp(value)) > 1;
+}
+
+static uint64_t get_double_bits(double d)
+{
+	uint64_t bits;
+	memcpy(&bits, &d, sizeof(bits));
+	return bits;
+}
+
+/** Converts a normal binary32/binary64 value to double. */
+static double native_get(const fp_value *value)
+{
+	const float_descriptor_t *desc = &value->desc;
+	uint64_t const mant_mask = ((uint64_t)1 << desc->mantissa_size) - 1;
+	uint64_t const exp  = sc_val_to_uint64(_exp(value));
+	uint64_t const mant = (sc_val_to_uint64(_mant(value)) >> ROUNDING_BITS)
+	                    & mant_mask;
+	if (desc->mantissa_size == 23) {
+		uint32_t const bits = (uint32_t)value->sign << 31
+		                    | (uint32_t)exp << 23 | (uint32_t)mant;
+		float f;
+		memcpy(&f, &bits, sizeof(f));
+		return f;
+	}
+	uint64_t const bits = (uint64_t)value->sign << 63 | exp << 52 | mant;
+	double d;
+	memcpy(&d, &bits, sizeof(d));
+	return d;
+}
+
+/** Rounds @p d to @p desc. Returns false without touching @p result if the
+ * rounded value is not a native value, normalize() handles those cases. */
+static bool native_set(double d, const float_descriptor_t *desc,
+                       fp_value *result)
+{
+	uint64_t exp;
+	uint64_t mant;
+	if (desc->mantissa_size == 23) {
+		float const f = (float)d;
+		uint32_t    bits;
+		memcpy(&bits, &f, sizeof(bits));
+		exp  = (bits >> 23) & 0xFF;
+		mant = bits & 0x7FFFFF;
+	} else {
+		uint64_t const bits = get_double_bits(d);
+		exp  = (bits >> 52) & 0x7FF;
+		mant = bits & 0xFFFFFFFFFFFFFull;
+	}
+	if (exp <= 1 || exp == ((uint64_t)1 << desc->exponent_size) - 1)
+		return false;
+	result->desc = *desc;
+	result->clss = FC_NORMAL;
+	result->sign = signbit(d) != 0;
+	sc_val_from_uint64(exp, _exp(result));
+	mant |= (uint64_t)1 << desc->mantissa_size;
+	sc_val_from_uint64(mant << ROUNDING_BITS, _mant(result));
+	return true;
+}
+
+/** Returns the odd integer significand of a normal double. */
+static uint64_t odd_significand(double d, unsigned *n_bits)
+{
+	uint64_t m = (get_double_bits(d) & 0xFFFFFFFFFFFFFull)
+	           | ((uint64_t)1 << 52);
+	while ((m & 1) == 0)
+		m >>= 1;
+	unsigned bits = 0;
+	for (uint64_t t = m; t != 0; t >>= 1)
+		++bits;
+	*n_bits = bits;
+	return m;
+}
+
+/** Checks whether x*y is representable with @p precision bits, assuming the
+ * product is in the normal range. */
+static bool native_mul_is_exact(double x, double y, unsigned precision)
+{
+	unsigned bits_x;
+	unsigned bits_y;
+	uint64_t const mx = odd_significand(x, &bits_x);
+	uint64_t const my = odd_significand(y, &bits_y);
+	if (bits_x + bits_y <= precision)
+		return true;
+	if (bits_x + bits_y > precision + 1)
+		return false;
+	/* the product has fewer than 64 bits here */
+	return (mx * my) >> precision == 0;
+}
+
+/**
+ * Tries to compute a @p op b with the host FPU.
+ *
+ * @return true if the result (and fc_exact) was set
+ */
+static bool native_binop(const fp_value *a, const fp_value *b, native_op_t op,
+                         fp_value *result)
+{
+	if (rounding_mode != FC_TONEAREST || !is_native(a) || !is_native(b))
+		return false;
+	const float_descriptor_t *desc = &a->desc;
+	if (desc->mantissa_size != b->desc.mantissa_size)
+		return false;
+
+	unsigned const precision = native_precision(desc);
+	double   const x         = native_get(a);
+	double   const y         = native_get(b);
+	double         res;
+	bool           exact;
+	switch (op) {
+	case NATIVE_ADD:
+	case NATIVE_SUB: {
+		double const y_op = op == NATIVE_ADD ? y : -y;
+		res = x + y_op;
+		/* TwoSum: the rounding error of the addition is error exactly */
+		double const y_virt = res - x;
+		double const x_virt = res - y_virt;
+		double const error  = (x - x_virt) + (y_op - y_virt);
+		exact = error == 0 && (precision == DBL_MANT_DIG || (float)res == res);
+		break;
+	}
+	case NATIVE_MUL:
+		res   = x * y;
+		exact = native_mul_is_exact(x, y, precision);
+		break;
+	case NATIVE_DIV:
+		res = x / y;
+		if (precision == FLT_MANT_DIG)
+			res = (float)res;
+		/* the quotient is exact iff it multiplies back to the dividend */
+		exact = isnormal(res) && native_mul_is_exact(res, y, precision)
+		     && res * y == x;
+		break;
+	default:
+		panic("invalid native operation");
+	}
+	if (!native_set(res, desc, result))
+		return false;
+	fc_exact = exact;
+	return true;
+}
+#endif
+
 /**
  * calculate a + b, where a is the value with the bigger exponent
  */
@@ -395,6 +579,10 @@ void fc_mul(const fp_value *a, const fp_value *b, fp_value *result)
 	fc_exact = true;
 	if (handle_NAN(a, b, result))
 		return;
+#ifdef HAVE_NATIVE_FP
+	if (native_binop(a, b, NATIVE_MUL, result))
+		return;
+#endif
 
 	if (result != a && result != b)
 		result->desc = a->desc;
@@ -472,6 +660,10 @@ void fc_div(const fp_value *a, const fp_value *b, fp_value *result)
 	fc_exact = true;
 	if (handle_NAN(a, b, result))
 		return;
+#ifdef HAVE_NATIVE_FP
+	if (native_binop(a, b, NATIVE_DIV, result))
+		return;
+#endif
 
 	if (result != a && result != b)
 		result->desc = a->desc;
@@ -723,6 +915,12 @@ void fc_cast(const fp_value *value, const float_descriptor_t *dest,
 		return;
 	}
 	/* Possible: value == result */
+#ifdef HAVE_NATIVE_FP
+	if (rounding_mode == FC_TONEAREST && is_native(value)
+	 && native_precision(dest) != 0
+	 && native_set(native_get(value), dest, result))
+		return;
+#endif
 
 	switch ((value_class_t)value->clss) {
 	case FC_NAN: {
@@ -1086,6 +1284,10 @@ void fc_add(const fp_value *a, const fp_value *b, fp_value *result)
 	fc_exact = true;
 	if (handle_NAN(a, b, result))
 		return;
+#ifdef HAVE_NATIVE_FP
+	if (native_binop(a, b, NATIVE_ADD, result))
+		return;
+#endif
 
 	/* make the value with the bigger exponent the first one */
 	if (sc_comp(_exp(a), _exp(b)) == ir_relation_less)
@@ -1099,6 +1301,10 @@ void fc_sub(const fp_value *a, const fp_value *b, fp_value *result)
 	fc_exact = true;
 	if (handle_NAN(a, b, result))
 		return;
+#ifdef HAVE_NATIVE_FP
+	if (native_binop(a, b, NATIVE_SUB, result))
+		return;
+#endif
 
 	fp_value *temp = (fp_value*) alloca(fp_value_size);
 	memcpy(temp, b, fp_value_size);
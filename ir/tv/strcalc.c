@@ -424,10 +424,21 @@ long sc_val_to_long(const sc_word *val)
 	return l;
 }
 
+void sc_val_from_uint64(uint64_t value, sc_word *buffer)
+{
+	unsigned n_words = MIN(calc_buffer_size, (unsigned)(64 / SC_BITS));
+	for (unsigned i = 0; i < n_words; ++i) {
+		buffer[i] = value & SC_MASK;
+		value >>= SC_BITS;
+	}
+	memset(&buffer[n_words], 0, (calc_buffer_size - n_words) * sizeof(sc_word));
+}
+
 uint64_t sc_val_to_uint64(const sc_word *val)
 {
+	/* higher words would be shifted out anyway */
 	uint64_t res = 0;
-	for (unsigned i = calc_buffer_size; i-- > 0; ) {
+	for (unsigned i = MIN(calc_buffer_size, (unsigned)(64 / SC_BITS)); i-- > 0; ) {
 		res = (res << SC_BITS) + val[i];
 	}
 	return res;
@@ -603,7 +614,7 @@ void sc_val_from_bytes(unsigned char const *const bytes, size_t n_bytes,
 	sc_word *p = buffer;
 	assert(SC_BITS == CHAR_BIT);
 	memcpy(p, bytes, n_bytes);
-	memset(p+n_bytes, 0, buffer+calc_buffer_size-p);
+	memset(p+n_bytes, 0, calc_buffer_size-n_bytes);
 }
 
 void sc_val_to_bytes(const sc_word *buffer, unsigned char *const dest,
@@ -782,7 +793,7 @@ void init_strcalc(unsigned precision)
 
 void finish_strcalc(void)
 {
-	free(output_buffer);
+	xfree(output_buffer);
 	output_buffer = NULL;
 }
 
@@ -165,6 +165,9 @@ void sc_val_from_long(long l, sc_word *buffer);
 /** create a value form an unsigned long */
 void sc_val_from_ulong(unsigned long l, sc_word *buffer);
 
+/** create a value from the lower 64 bits of @p value, upper words are zero */
+void sc_val_from_uint64(uint64_t value, sc_word *buffer);
+
 /**
  * Construct a strcalc value form a sequence of bytes in two complement little
  * endian format.
@@ -219,6 +222,8 @@ unsigned char sc_sub_bits(const sc_word *value, unsigned len,
 
 /**
  * Converts a tarval into a string.
+ * The result is stored in a buffer shared by all callers, code that may run
+ * concurrently must use sc_print_buf() instead.
  *
  * @param val1        the value pointer
  * @param bits        number of valid bits in this value
@@ -20,12 +20,13 @@
 #include <limits.h>
 #include <stdlib.h>
 #include <string.h>
-#include <stdlib.h>
+#include <math.h>
 
 #include "bitfiddle.h"
 #include "hashptr.h"
+#include "lock.h"
 #include "tv_t.h"
-#include "set.h"
+#include "obst.h"
 #include "entity_t.h"
 #include "hashptr.h"
 #include "irmode_t.h"
@@ -42,8 +43,37 @@
  * constant target values */
 #define N_CONSTANTS 2048
 
+/** Range of the integral values preallocated for each arithmetic mode. */
+#define SMALL_VALUE_MIN (-8)
+#define SMALL_VALUE_MAX 31
+#define N_SMALL_VALUES  (SMALL_VALUE_MAX - SMALL_VALUE_MIN + 1)
+
+/** Size of the per thread cache in front of the tarval set. */
+#define TV_CACHE_SIZE 64
+
+#define HashSet          tarval_set_t
+#define HashSetEntry     tarval_set_entry_t
+#define ValueType        ir_tarval*
+#define ADDITIONAL_DATA  struct obstack obst; /**< holds the tarvals */
+#include "hashset.h"
+#undef ADDITIONAL_DATA
+#undef ValueType
+#undef HashSetEntry
+#undef HashSet
+
+typedef struct tarval_set_t tarval_set_t;
+
 /** A set containing all existing tarvals. */
-static struct set *tarvals = NULL;
+static tarval_set_t tarvals;
+/** Protects tarvals, so constants may be created from several threads. */
+static ir_lock_t tarvals_lock;
+/** Incremented by each initialization to invalidate the thread caches. */
+static unsigned  tarvals_epoch;
+
+/** Recently identified tarvals of this thread, indexed by hash. */
+static IR_THREAD_LOCAL ir_tarval *tv_cache[TV_CACHE_SIZE];
+/** The tarvals_epoch the entries of tv_cache belong to. */
+static IR_THREAD_LOCAL unsigned   tv_cache_epoch;
 
 static unsigned sc_value_length;
 static unsigned fp_value_size;
@@ -51,60 +81,145 @@ static unsigned fp_value_size;
 /** The integer overflow mode. */
 static bool wrap_on_overflow = true;
 
+/**
+ * Returns the size of a value payload of @p size bytes. Payloads are
+ * padded with zeros to whole 64-bit words, so they can be hashed word-wise.
+ */
+static unsigned get_payload_size(unsigned size)
+{
+	return round_up2(size, sizeof(uint64_t));
+}
+
 /** Hash a tarval. */
 static unsigned hash_tv(ir_tarval const *const tv)
 {
-	return hash_combine(hash_ptr(tv->mode), hash_data(tv->value, tv->length));
+	unsigned hash = hash_ptr(tv->mode);
+	for (unsigned i = 0; i < tv->length; i += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, tv->value + i, sizeof(word));
+		hash = hash_combine(hash, (unsigned)(word ^ (word >> 32)));
+	}
+	return hash;
 }
 
-static int cmp_tv(const void *p1, const void *p2, size_t n)
+static bool tarvals_equal(ir_tarval const *const tv1,
+                          ir_tarval const *const tv2)
 {
-	(void)n;
-	ir_tarval const *const tv1 = (ir_tarval const*)p1;
-	ir_tarval const *const tv2 = (ir_tarval const*)p2;
 	if (tv1->mode != tv2->mode)
-		return 1;
+		return false;
 	assert(tv1->length == tv2->length);
-	return memcmp(tv1->value, tv2->value, tv1->length);
+	return memcmp(tv1->value, tv2->value, tv1->length) == 0;
+}
+
+#define HashSet                   tarval_set_t
+#define HashSetEntry              tarval_set_entry_t
+#define ValueType                 ir_tarval*
+#define KeyType                   ir_tarval*
+#define GetKey(value)             (value)
+#define InitData(self,value,key)  ((value) = (ir_tarval*)obstack_copy(&(self)->obst, (key), sizeof(ir_tarval) + (key)->length))
+#define NullValue                 NULL
+#define DeletedValue              ((ir_tarval*)-1)
+#define SCALAR_RETURN
+#define Hash(self,key)            hash_tv(key)
+#define KeysEqual(self,key1,key2) tarvals_equal((key1), (key2))
+#define SetRangeEmpty(ptr,size)   memset(ptr, 0, (size) * sizeof((ptr)[0]))
+
+void tarval_set_init_size(tarval_set_t *self, size_t expected_elements);
+void tarval_set_destroy(tarval_set_t *self);
+ir_tarval *tarval_set_insert(tarval_set_t *self, ir_tarval *tv);
+#define hashset_init_size  tarval_set_init_size
+#define hashset_destroy    tarval_set_destroy
+#define hashset_insert     tarval_set_insert
+
+#include "hashset.c.h"
+
+/**
+ * Returns the unique tarval equal to @p tv, which is copied into the set if
+ * it is new, so it may live on the stack.
+ */
+static ir_tarval *identify_tarval(ir_tarval *const tv)
+{
+	if (tv_cache_epoch != tarvals_epoch) {
+		memset(tv_cache, 0, sizeof(tv_cache));
+		tv_cache_epoch = tarvals_epoch;
+	}
+
+	/* hits in the thread cache need no locking */
+	ir_tarval **const slot   = &tv_cache[hash_tv(tv) % TV_CACHE_SIZE];
+	ir_tarval  *const cached = *slot;
+	if (cached != NULL && tarvals_equal(cached, tv))
+		return cached;
+
+	ir_lock(&tarvals_lock);
+	ir_tarval *const res = tarval_set_insert(&tarvals, tv);
+	ir_unlock(&tarvals_lock);
+	*slot = res;
+	return res;
 }
 
-static ir_tarval *identify_tarval(ir_tarval const *const tv)
+/**
+ * Returns the preallocated tarval for @p value in @p mode or NULL if there
+ * is none.
+ */
+static ir_tarval *get_small_tarval(ir_mode const *mode, int64_t value)
 {
-	unsigned hash = hash_tv(tv);
-	return set_insert(ir_tarval, tarvals, tv, sizeof(ir_tarval) + tv->length,
-	                  hash);
+	ir_tarval *const *const small = mode->small_values;
+	if (small == NULL || value < SMALL_VALUE_MIN || value > SMALL_VALUE_MAX)
+		return NULL;
+	return small[value - SMALL_VALUE_MIN];
 }
 
 static ir_tarval *get_fp_tarval(const fp_value *value, ir_mode *mode)
 {
-	ir_tarval *const tv = ALLOCAF(ir_tarval, value, fp_value_size);
+	unsigned   const payload = get_payload_size(fp_value_size);
+	ir_tarval *const tv      = ALLOCAF(ir_tarval, value, payload);
 	tv->kind   = k_tarval;
 	tv->mode   = mode;
-	tv->length = fp_value_size;
+	tv->length = payload;
 	memcpy(tv->value, value, fp_value_size);
+	memset(tv->value + fp_value_size, 0, payload - fp_value_size);
 	return identify_tarval(tv);
 }
 
+/**
+ * Values of two's complement modes and vector modes are stored as strcalc
+ * bit patterns. Vector values hold the first lane in the least significant
+ * bits.
+ */
+static bool is_sc_mode(ir_mode const *mode)
+{
+	return get_mode_arithmetic(mode) == irma_twos_complement
+	    || mode_is_vector(mode);
+}
+
 static ir_tarval *get_int_tarval(const sc_word *value, ir_mode *mode)
 {
-	unsigned size = sc_value_length * sizeof(sc_word);
-	ir_tarval *const tv = ALLOCAF(ir_tarval, value, size);
+	unsigned   const size    = sc_value_length * sizeof(sc_word);
+	unsigned   const payload = get_payload_size(size);
+	ir_tarval *const tv      = ALLOCAF(ir_tarval, value, payload);
 	tv->kind   = k_tarval;
 	tv->mode   = mode;
-	tv->length = size;
+	tv->length = payload;
 	memcpy(tv->value, value, size);
-	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	memset(tv->value + size, 0, payload - size);
+	assert(is_sc_mode(mode));
 	if (mode_is_signed(mode)) {
 		sc_sign_extend((sc_word*)tv->value, get_mode_size_bits(mode));
 	} else {
 		sc_zero_extend((sc_word*)tv->value, get_mode_size_bits(mode));
 	}
+	if (mode->small_values != NULL) {
+		int64_t    const v     = (int64_t)sc_val_to_uint64((sc_word const*)tv->value);
+		ir_tarval *const small = get_small_tarval(mode, v);
+		if (small != NULL)
+			return small;
+	}
 	return identify_tarval(tv);
 }
 
 static bool is_overflow(const sc_word *value, ir_mode *mode)
 {
-	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	assert(is_sc_mode(mode));
 	unsigned bits      = get_mode_size_bits(mode);
 	bool     is_signed = mode_is_signed(mode);
 	/* some of the uppper bits are not zero? */
@@ -121,12 +236,59 @@ static bool is_overflow(const sc_word *value, ir_mode *mode)
 static ir_tarval *get_int_tarval_overflow(const sc_word *value, ir_mode *mode)
 {
 	// We can only detect overflows for two complements here.
-	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	assert(is_sc_mode(mode));
 	if (!wrap_on_overflow && is_overflow(value, mode))
 		return tarval_bad;
 	return get_int_tarval(value, mode);
 }
 
+/**
+ * Integer modes up to 64 bits are folded with native host arithmetic instead
+ * of going through strcalc. Values of such modes are stored sign/zero-extended
+ * so the lower 64 bits of the buffer hold the host representation.
+ */
+static bool is_native_int_mode(ir_mode const *mode)
+{
+	return get_mode_arithmetic(mode) == irma_twos_complement
+	    && get_mode_size_bits(mode) <= 64;
+}
+
+static uint64_t get_native_value(ir_tarval const *tv)
+{
+	return sc_val_to_uint64((sc_word const*)tv->value);
+}
+
+/** Creates a tarval from a native result, truncating it to the mode size. */
+static ir_tarval *get_native_tarval(uint64_t value, ir_mode *mode)
+{
+	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
+	sc_val_from_uint64(value, buffer);
+	return get_int_tarval(buffer, mode);
+}
+
+/**
+ * Native division/remainder for integer modes up to 64 bits. Rounds towards
+ * zero and gives the remainder the sign of the dividend like sc_divmod().
+ */
+static void native_divmod(ir_tarval const *a, ir_tarval const *b,
+                          uint64_t *quot, uint64_t *rem)
+{
+	uint64_t const va = get_native_value(a);
+	uint64_t const vb = get_native_value(b);
+	assert(vb != 0);
+	if (!mode_is_signed(a->mode)) {
+		*quot = va / vb;
+		*rem  = va % vb;
+	} else if ((int64_t)vb == -1) {
+		/* avoid INT64_MIN / -1, the result wraps around */
+		*quot = -va;
+		*rem  = 0;
+	} else {
+		*quot = (uint64_t)((int64_t)va / (int64_t)vb);
+		*rem  = (uint64_t)((int64_t)va % (int64_t)vb);
+	}
+}
+
 static ir_tarval tarval_bad_obj;
 static ir_tarval tarval_unknown_obj;
 
@@ -143,6 +305,57 @@ static const float_descriptor_t *get_descriptor(const ir_mode *mode)
 	return &mode->float_desc;
 }
 
+/** Returns lane @p lane of the vector bytes @p bytes of vector mode @p mode. */
+static ir_tarval *get_vector_lane(unsigned char const *bytes, ir_mode *mode,
+                                  unsigned lane)
+{
+	ir_mode *const elem_mode  = get_mode_vector_element_mode(mode);
+	unsigned const elem_bytes = get_mode_size_bytes(elem_mode);
+	return new_tarval_from_bytes(bytes + lane*elem_bytes, elem_mode);
+}
+
+/** Applies @p op to the lanes of the vector tarval @p a. */
+static ir_tarval *vector_unop(ir_tarval const *a,
+                              ir_tarval *(*op)(ir_tarval const*))
+{
+	ir_mode       *const mode       = a->mode;
+	unsigned       const elem_bytes
+		= get_mode_size_bytes(get_mode_vector_element_mode(mode));
+	unsigned char *const bytes      = ALLOCAN(unsigned char, get_mode_size_bytes(mode));
+	tarval_to_bytes(bytes, a);
+	for (unsigned i = 0, n = get_mode_vector_n_lanes(mode); i < n; ++i) {
+		ir_tarval *const res = op(get_vector_lane(bytes, mode, i));
+		if (res == tarval_bad)
+			return tarval_bad;
+		tarval_to_bytes(bytes + i*elem_bytes, res);
+	}
+	return new_tarval_from_bytes(bytes, mode);
+}
+
+/** Applies @p op to each pair of lanes of the vector tarvals @p a and @p b. */
+static ir_tarval *vector_binop(ir_tarval const *a, ir_tarval const *b,
+                               ir_tarval *(*op)(ir_tarval const*,
+                                                ir_tarval const*))
+{
+	ir_mode       *const mode       = a->mode;
+	unsigned       const elem_bytes
+		= get_mode_size_bytes(get_mode_vector_element_mode(mode));
+	unsigned       const n_bytes    = get_mode_size_bytes(mode);
+	unsigned char *const bytes_a    = ALLOCAN(unsigned char, n_bytes);
+	unsigned char *const bytes_b    = ALLOCAN(unsigned char, n_bytes);
+	assert(b->mode == mode);
+	tarval_to_bytes(bytes_a, a);
+	tarval_to_bytes(bytes_b, b);
+	for (unsigned i = 0, n = get_mode_vector_n_lanes(mode); i < n; ++i) {
+		ir_tarval *const res = op(get_vector_lane(bytes_a, mode, i),
+		                          get_vector_lane(bytes_b, mode, i));
+		if (res == tarval_bad)
+			return tarval_bad;
+		tarval_to_bytes(bytes_a + i*elem_bytes, res);
+	}
+	return new_tarval_from_bytes(bytes_a, mode);
+}
+
 ir_tarval *new_integer_tarval_from_str(const char *str, size_t len,
                                        int negative, unsigned char base,
                                        ir_mode *mode)
@@ -218,6 +431,7 @@ ir_tarval *new_tarval_from_str(const char *str, size_t len, ir_mode *mode)
 	case irms_auxiliary:
 	case irms_data:
 	case irms_internal_boolean:
+	case irms_vector:
 		break;
 	}
 	panic("unsupported tarval creation with mode %F", mode);
@@ -226,6 +440,9 @@ ir_tarval *new_tarval_from_str(const char *str, size_t len, ir_mode *mode)
 ir_tarval *new_tarval_from_long(long l, ir_mode *mode)
 {
 	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	ir_tarval *const small = get_small_tarval(mode, l);
+	if (small != NULL)
+		return small;
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 	sc_val_from_long(l, buffer);
 	return get_int_tarval(buffer, mode);
@@ -249,6 +466,10 @@ ir_tarval *new_tarval_from_bytes(unsigned char const *buf,
                                  ir_mode *mode)
 {
 	switch (get_mode_arithmetic(mode)) {
+	case irma_none:
+		if (!mode_is_vector(mode))
+			break;
+		/* FALLTHROUGH */
 	case irma_twos_complement: {
 		unsigned bits    = get_mode_size_bits(mode);
 		unsigned n_bytes = bits/CHAR_BIT + (bits%CHAR_BIT != 0);
@@ -262,8 +483,6 @@ ir_tarval *new_tarval_from_bytes(unsigned char const *buf,
 		fc_val_from_bytes(buffer, buf, get_descriptor(mode));
 		return get_fp_tarval(buffer, mode);
 	}
-	case irma_none:
-		break;
 	}
 	panic("tarval from byte requested for non storable mode");
 }
@@ -275,6 +494,10 @@ void tarval_to_bytes(unsigned char *buffer, ir_tarval const *tv)
 	case irma_x86_extended_float:
 		fc_val_to_bytes((const fp_value*)tv->value, buffer);
 		return;
+	case irma_none:
+		if (!mode_is_vector(get_tarval_mode(tv)))
+			break;
+		/* FALLTHROUGH */
 	case irma_twos_complement: {
 		ir_mode *mode       = get_tarval_mode(tv);
 		unsigned bits       = get_mode_size_bits(mode);
@@ -282,8 +505,6 @@ void tarval_to_bytes(unsigned char *buffer, ir_tarval const *tv)
 		sc_val_to_bytes((const sc_word*)tv->value, buffer, buffer_len);
 		return;
 	}
-	case irma_none:
-		break;
 	}
 	panic("unexpected arithmetic mode");
 }
@@ -341,6 +562,12 @@ uint64_t get_tarval_uint64(ir_tarval const *tv)
 ir_tarval *new_tarval_from_long_double(long double d, ir_mode *mode)
 {
 	assert(mode_is_float(mode));
+	if (d >= SMALL_VALUE_MIN && d <= SMALL_VALUE_MAX && d == (int)d
+	    && (d != 0 || !signbit(d))) {
+		ir_tarval *const small = get_small_tarval(mode, (int)d);
+		if (small != NULL)
+			return small;
+	}
 	fp_value *const buffer = (fp_value*)ALLOCAN(char, fp_value_size);
 	fc_val_from_ieee754(d, buffer);
 	fc_cast(buffer, get_descriptor(mode), buffer);
@@ -426,6 +653,31 @@ ir_tarval *get_tarval_epsilon(ir_mode *mode)
 	return get_fp_tarval(buffer, mode);
 }
 
+/**
+ * Preallocates the tarvals of the small integral values of @p mode. Values
+ * which are not representable in the mode get no entry.
+ */
+static void init_small_values(ir_mode *mode)
+{
+	ir_lock(&tarvals_lock);
+	ir_tarval **const small = OALLOCNZ(&tarvals.obst, ir_tarval*, N_SMALL_VALUES);
+	ir_unlock(&tarvals_lock);
+
+	bool const is_float = mode_is_float(mode);
+	for (int v = SMALL_VALUE_MIN; v <= SMALL_VALUE_MAX; ++v) {
+		ir_tarval *tv;
+		if (is_float) {
+			tv = new_tarval_from_double(v, mode);
+		} else {
+			tv = new_tarval_from_long(v, mode);
+			if ((int64_t)get_native_value(tv) != v)
+				continue;
+		}
+		small[v - SMALL_VALUE_MIN] = tv;
+	}
+	mode->small_values = small;
+}
+
 void init_mode_values(ir_mode* mode)
 {
 	switch (get_mode_sort(mode)) {
@@ -442,6 +694,7 @@ void init_mode_values(ir_mode* mode)
 		fc_get_zero(desc, buf, false);
 		mode->null        = get_fp_tarval(buf, mode);
 		mode->one         = new_tarval_from_double(1.0, mode);
+		init_small_values(mode);
 		break;
 	}
 
@@ -470,6 +723,28 @@ void init_mode_values(ir_mode* mode)
 		mode->null      = get_int_tarval(buf, mode);
 		sc_set_bit_at(buf, 0);
 		mode->one       = get_int_tarval(buf, mode);
+		if (is_native_int_mode(mode))
+			init_small_values(mode);
+		break;
+	}
+
+	case irms_vector: {
+		/* the neutral elements of the lane-wise operations */
+		ir_mode       *elem_mode  = get_mode_vector_element_mode(mode);
+		unsigned       elem_bytes = get_mode_size_bytes(elem_mode);
+		unsigned       n_lanes    = get_mode_vector_n_lanes(mode);
+		unsigned char *bytes      = ALLOCAN(unsigned char, elem_bytes*n_lanes);
+		for (unsigned i = 0; i < n_lanes; ++i)
+			tarval_to_bytes(bytes + i*elem_bytes, get_mode_one(elem_mode));
+		mode->one       = new_tarval_from_bytes(bytes, mode);
+		sc_word *buf  = ALLOCAN(sc_word, sc_value_length);
+		sc_max_from_bits(get_mode_size_bits(mode), false, buf);
+		mode->all_one   = get_int_tarval(buf, mode);
+		sc_zero(buf);
+		mode->null      = get_int_tarval(buf, mode);
+		mode->min       = tarval_bad;
+		mode->max       = tarval_bad;
+		mode->infinity  = tarval_bad;
 		break;
 	}
 
@@ -502,6 +777,7 @@ int tarval_is_negative(ir_tarval const *const a)
 	case irms_auxiliary:
 	case irms_internal_boolean:
 	case irms_data:
+	case irms_vector:
 		break;
 	}
 	panic("invalid mode sort");
@@ -557,6 +833,10 @@ ir_relation tarval_cmp(ir_tarval const *const a, ir_tarval const *const b)
 			return ir_relation_equal;
 		return a == tarval_b_true ? ir_relation_greater : ir_relation_less;
 
+	case irms_vector:
+		/* vectors are not ordered */
+		return a == b ? ir_relation_equal : ir_relation_less_greater;
+
 	case irms_auxiliary:
 	case irms_data:
 		break;
@@ -610,6 +890,7 @@ ir_tarval *tarval_convert_to(ir_tarval const *const src,
 		case irms_internal_boolean:
 		case irms_auxiliary:
 		case irms_data:
+		case irms_vector:
 			break;
 		}
 		/* the rest can't be converted */
@@ -630,20 +911,25 @@ ir_tarval *tarval_convert_to(ir_tarval const *const src,
 			/* XXX floating point unit does not understand internal integer
 			 * representation, convert to string first, then create float from
 			 * string */
-			char *buffer = ALLOCAN(char, 100);
+			size_t const buf_len = sc_get_precision() + 1;
+			char  *const buffer  = ALLOCAN(char, buf_len);
 			/* decimal string representation because hexadecimal output is
 			 * interpreted unsigned by fc_val_from_str, so this is a HACK */
-			int len = snprintf(buffer, 100, "%s",
-				sc_print(src->value, get_mode_size_bits(src->mode), SC_DEC, mode_is_signed(src->mode)));
+			char const *const str
+				= sc_print_buf(buffer, buf_len, src->value,
+				               get_mode_size_bits(src->mode), SC_DEC,
+				               mode_is_signed(src->mode));
+			size_t const len = strlen(str);
 
 			fp_value *fpval = (fp_value*)ALLOCAN(char, fp_value_size);
-			fc_val_from_str(buffer, len, fpval);
+			fc_val_from_str(str, len, fpval);
 			fc_cast(fpval, get_descriptor(dst_mode), fpval);
 			return get_fp_tarval(fpval, dst_mode);
 		}
 		case irms_auxiliary:
 		case irms_data:
 		case irms_internal_boolean:
+		case irms_vector:
 			break;
 		}
 		break;
@@ -665,6 +951,7 @@ ir_tarval *tarval_convert_to(ir_tarval const *const src,
 	case irms_auxiliary:
 	case irms_data:
 	case irms_internal_boolean:
+	case irms_vector:
 		return tarval_bad;
 	}
 
@@ -691,7 +978,7 @@ ir_tarval *tarval_not(ir_tarval const *const a)
 	if (get_mode_sort(mode) == irms_internal_boolean)
 		return a == tarval_b_true ? tarval_b_false : tarval_b_true;
 
-	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	assert(is_sc_mode(mode));
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 	sc_not(a->value, buffer);
 	return get_int_tarval(buffer, mode);
@@ -714,6 +1001,9 @@ ir_tarval *tarval_neg(ir_tarval const *const a)
 		return get_fp_tarval(buffer, mode);
 	}
 
+	case irms_vector:
+		return vector_unop(a, tarval_neg);
+
 	case irms_auxiliary:
 	case irms_data:
 	case irms_internal_boolean:
@@ -738,6 +1028,9 @@ ir_tarval *tarval_add(ir_tarval const *a, ir_tarval const *b)
 	case irms_int_number: {
 		/* modes of a,b are equal, so result has mode of a as this might be the
 		 * character */
+		if (wrap_on_overflow && is_native_int_mode(mode))
+			return get_native_tarval(get_native_value(a) + get_native_value(b),
+			                         mode);
 		sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 		sc_add(a->value, b->value, buffer);
 		return get_int_tarval_overflow(buffer, mode);
@@ -749,6 +1042,9 @@ ir_tarval *tarval_add(ir_tarval const *a, ir_tarval const *b)
 		return get_fp_tarval(buffer, mode);
 	}
 
+	case irms_vector:
+		return vector_binop(a, b, tarval_add);
+
 	case irms_auxiliary:
 	case irms_data:
 	case irms_internal_boolean:
@@ -779,6 +1075,9 @@ ir_tarval *tarval_sub(ir_tarval const *a, ir_tarval const *b)
 	case irms_int_number: {
 		/* modes of a,b are equal, so result has mode of a as this might be the
 		 * character */
+		if (wrap_on_overflow && is_native_int_mode(dst_mode))
+			return get_native_tarval(get_native_value(a) - get_native_value(b),
+			                         dst_mode);
 		sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 		sc_sub(a->value, b->value, buffer);
 		return get_int_tarval_overflow(buffer, dst_mode);
@@ -790,6 +1089,9 @@ ir_tarval *tarval_sub(ir_tarval const *a, ir_tarval const *b)
 		return get_fp_tarval(buffer, dst_mode);
 	}
 
+	case irms_vector:
+		return vector_binop(a, b, tarval_sub);
+
 	case irms_auxiliary:
 	case irms_data:
 	case irms_internal_boolean:
@@ -807,6 +1109,9 @@ ir_tarval *tarval_mul(ir_tarval const *const a, ir_tarval const *const b)
 	case irms_int_number:
 	case irms_reference: {
 		/* modes of a,b are equal */
+		if (wrap_on_overflow && is_native_int_mode(mode))
+			return get_native_tarval(get_native_value(a) * get_native_value(b),
+			                         mode);
 		sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 		sc_mul(a->value, b->value, buffer);
 		return get_int_tarval_overflow(buffer, mode);
@@ -818,6 +1123,9 @@ ir_tarval *tarval_mul(ir_tarval const *const a, ir_tarval const *const b)
 		return get_fp_tarval(buffer, mode);
 	}
 
+	case irms_vector:
+		return vector_binop(a, b, tarval_mul);
+
 	case irms_auxiliary:
 	case irms_data:
 	case irms_internal_boolean:
@@ -838,6 +1146,11 @@ ir_tarval *tarval_div(ir_tarval const *const a, ir_tarval const *const b)
 		if (b == get_mode_null(mode))
 			return tarval_bad;
 
+		if (is_native_int_mode(mode)) {
+			uint64_t quot, rem;
+			native_divmod(a, b, &quot, &rem);
+			return get_native_tarval(quot, mode);
+		}
 		sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 		sc_div(a->value, b->value, buffer);
 		return get_int_tarval(buffer, mode);
@@ -852,6 +1165,7 @@ ir_tarval *tarval_div(ir_tarval const *const a, ir_tarval const *const b)
 	case irms_auxiliary:
 	case irms_data:
 	case irms_internal_boolean:
+	case irms_vector:
 		panic("operation not defined on mode");
 	}
 	panic("invalid mode sort");
@@ -866,6 +1180,11 @@ ir_tarval *tarval_mod(ir_tarval const *const a, ir_tarval const *const b)
 	/* x/0 error */
 	if (b == get_mode_null(mode))
 		return tarval_bad;
+	if (is_native_int_mode(mode)) {
+		uint64_t quot, rem;
+		native_divmod(a, b, &quot, &rem);
+		return get_native_tarval(rem, mode);
+	}
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 	sc_mod(a->value, b->value, buffer);
 	return get_int_tarval(buffer, mode);
@@ -878,12 +1197,18 @@ ir_tarval *tarval_divmod(ir_tarval const *const a, ir_tarval const *const b,
 	assert(b->mode == mode);
 	assert(get_mode_arithmetic(mode) == irma_twos_complement);
 
-	sc_word *const div_res = ALLOCAN(sc_word, sc_value_length);
-	sc_word *const mod_res = ALLOCAN(sc_word, sc_value_length);
-
 	/* x/0 error */
 	if (b == get_mode_null(mode))
 		return tarval_bad;
+	if (is_native_int_mode(mode)) {
+		uint64_t quot, rem;
+		native_divmod(a, b, &quot, &rem);
+		*mod = get_native_tarval(rem, mode);
+		return get_native_tarval(quot, mode);
+	}
+
+	sc_word *const div_res = ALLOCAN(sc_word, sc_value_length);
+	sc_word *const mod_res = ALLOCAN(sc_word, sc_value_length);
 	sc_divmod(a->value, b->value, div_res, mod_res);
 	*mod = get_int_tarval(mod_res, mode);
 	return get_int_tarval(div_res, mode);
@@ -903,7 +1228,7 @@ ir_tarval *tarval_and(ir_tarval const *const a, ir_tarval const *const b)
 	if (get_mode_sort(mode) == irms_internal_boolean)
 		return a == tarval_b_false ? (ir_tarval*)a : (ir_tarval*)b;
 
-	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	assert(is_sc_mode(mode));
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 	sc_and(a->value, b->value, buffer);
 	return get_int_tarval(buffer, mode);
@@ -916,7 +1241,7 @@ ir_tarval *tarval_andnot(ir_tarval const *const a, ir_tarval const *const b)
 	if (get_mode_sort(mode) == irms_internal_boolean)
 		return a == tarval_b_true && b == tarval_b_false ? tarval_b_true
 		                                                 : tarval_b_false;
-	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	assert(is_sc_mode(mode));
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 	sc_andnot(a->value, b->value, buffer);
 	return get_int_tarval(buffer, mode);
@@ -929,7 +1254,7 @@ ir_tarval *tarval_or(ir_tarval const *const a, ir_tarval const *const b)
 	if (get_mode_sort(mode) == irms_internal_boolean)
 		return a == tarval_b_true ? (ir_tarval*)a : (ir_tarval*)b;
 
-	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	assert(is_sc_mode(mode));
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 	sc_or(a->value, b->value, buffer);
 	return get_int_tarval(buffer, mode);
@@ -942,7 +1267,7 @@ ir_tarval *tarval_ornot(ir_tarval const *const a, ir_tarval const *const b)
 	if (get_mode_sort(mode) == irms_internal_boolean)
 		return a == tarval_b_true || b == tarval_b_false ? tarval_b_true
 		                                                 : tarval_b_false;
-	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	assert(is_sc_mode(mode));
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 	sc_ornot(a->value, b->value, buffer);
 	return get_int_tarval(buffer, mode);
@@ -955,7 +1280,7 @@ ir_tarval *tarval_eor(ir_tarval const *const a, ir_tarval const *const b)
 	if (get_mode_sort(mode) == irms_internal_boolean)
 		return a == b ? tarval_b_false : tarval_b_true;
 
-	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	assert(is_sc_mode(mode));
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 	sc_xor(a->value, b->value, buffer);
 	return get_int_tarval(buffer, mode);
@@ -1082,9 +1407,13 @@ int tarval_snprintf(char *buf, size_t len, ir_tarval const *tv)
 		if (tv == tv->mode->null)
 			return snprintf(buf, len, "NULL");
 		/* FALLTHROUGH */
-	case irms_int_number: {
-		unsigned    bits = get_mode_size_bits(tv->mode);
-		const char *str  = sc_print(tv->value, bits, SC_HEX, 0);
+	case irms_int_number:
+	case irms_vector: {
+		unsigned     bits    = get_mode_size_bits(tv->mode);
+		size_t const str_len = sc_get_precision() + 1;
+		char  *const str_buf = ALLOCAN(char, str_len);
+		char  *const str     = sc_print_buf(str_buf, str_len, tv->value, bits,
+		                                    SC_HEX, false);
 		return snprintf(buf, len, "0x%s", str);
 	}
 
@@ -1124,6 +1453,7 @@ const char *ir_tarval_to_ascii(char *buf, size_t len, ir_tarval const *tv)
 	case irms_internal_boolean:
 	case irms_reference:
 	case irms_int_number:
+	case irms_vector:
 		return sc_print_buf(buf, len, tv->value, get_mode_size_bits(mode),
 		                    SC_HEX, 0);
 	case irms_float_number: {
@@ -1158,6 +1488,7 @@ ir_tarval *ir_tarval_from_ascii(const char *buf, ir_mode *mode)
 	case irms_reference:
 	case irms_internal_boolean:
 	case irms_int_number:
+	case irms_vector:
 		return new_integer_tarval_from_str(buf, len, false, 16, mode);
 	case irms_float_number: {
 		unsigned       size = get_mode_size_bytes(mode);
@@ -1184,14 +1515,17 @@ ir_tarval *ir_tarval_from_ascii(const char *buf, ir_mode *mode)
 unsigned char get_tarval_sub_bits(ir_tarval const *tv, unsigned byte_ofs)
 {
 	switch (get_mode_arithmetic(tv->mode)) {
+	case irma_none:
+		if (!mode_is_vector(tv->mode))
+			break;
+		/* FALLTHROUGH */
 	case irma_twos_complement:
 		return sc_sub_bits(tv->value, get_mode_size_bits(tv->mode), byte_ofs);
 	case irma_ieee754:
 	case irma_x86_extended_float:
 		return fc_sub_bits((const fp_value*) tv->value, get_mode_size_bits(tv->mode), byte_ofs);
-	default:
-		panic("arithmetic mode not supported");
 	}
+	panic("arithmetic mode not supported");
 }
 
 int get_tarval_popcount(ir_tarval const *tv)
@@ -1312,9 +1646,10 @@ int tarval_get_wrap_on_overflow(void)
 
 static ir_tarval *make_b_tarval(unsigned char const val)
 {
-	ir_tarval *const tv = XMALLOCFZ(ir_tarval, value, sc_value_length);
+	unsigned   const payload = get_payload_size(sc_value_length);
+	ir_tarval *const tv      = XMALLOCFZ(ir_tarval, value, payload);
 	tv->kind     = k_tarval;
-	tv->length   = sc_value_length;
+	tv->length   = payload;
 	tv->value[0] = val;
 	/* mode will be set later */
 	return tv;
@@ -1324,7 +1659,10 @@ void init_tarval_1(void)
 {
 	/* initialize the sets holding the tarvals with a comparison function and
 	 * an initial size, which is the expected number of constants */
-	tarvals = new_set(cmp_tv, N_CONSTANTS);
+	tarval_set_init_size(&tarvals, N_CONSTANTS);
+	obstack_init(&tarvals.obst);
+	ir_lock_init(&tarvals_lock);
+	++tarvals_epoch;
 	/* calls init_strcalc() with needed size */
 	init_fltcalc(128);
 
@@ -1352,7 +1690,9 @@ void init_tarval_2(void)
 void finish_tarval(void)
 {
 	finish_strcalc();
-	del_set(tarvals); tarvals = NULL;
+	tarval_set_destroy(&tarvals);
+	obstack_free(&tarvals.obst, NULL);
+	ir_lock_destroy(&tarvals_lock);
 }
 
 bool tarval_in_range(ir_tarval const *const min, ir_tarval const *const val, ir_tarval const *const max)
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+#
+# This file is part of libFirm.
+# Copyright (C) 2017 University of Karlsruhe.
+#
+"""Converts a binary statev stream (.evb) written by stat_ev_begin_binary()
+into the text format of stat_ev_begin() or into CSV."""
+import argparse
+import csv
+import struct
+import sys
+
+MAGIC = b"FIRMSTEV"
+VERSION = 1
+
+
+class Reader:
+	def __init__(self, data):
+		self.data = data
+		self.pos = 0
+
+	def at_end(self):
+		return self.pos >= len(self.data)
+
+	def byte(self):
+		b = self.data[self.pos]
+		self.pos += 1
+		return b
+
+	def varint(self):
+		result = 0
+		shift = 0
+		while True:
+			b = self.byte()
+			result |= (b & 0x7F) << shift
+			shift += 7
+			if not b & 0x80:
+				return result
+
+	def bytes(self):
+		size = self.varint()
+		res = self.data[self.pos:self.pos + size]
+		self.pos += size
+		return res.decode("utf-8", "replace")
+
+
+def decode(data):
+	"""Yields (kind, key, value, ticks) tuples, kind is 'P', 'O' or 'E'."""
+	if data[:len(MAGIC)] != MAGIC or data[len(MAGIC)] != VERSION:
+		raise ValueError("not a statev stream of version %d" % VERSION)
+	reader = Reader(data)
+	reader.pos = len(MAGIC) + 1
+	keys = {}
+	ticks = 0
+	while not reader.at_end():
+		tag = chr(reader.byte())
+		if tag == 'K':
+			key_id = reader.varint()
+			keys[key_id] = reader.bytes()
+			continue
+		key = keys[reader.varint()]
+		ticks += reader.varint()
+		if tag == 'P':
+			yield 'P', key, reader.bytes(), ticks
+		elif tag == 'O':
+			yield 'O', key, None, ticks
+		elif tag == 'i':
+			value = reader.varint()
+			yield 'E', key, "%d" % ((value >> 1) ^ -(value & 1)), ticks
+		elif tag == 'u':
+			yield 'E', key, "%d" % reader.varint(), ticks
+		elif tag == 'd':
+			value, = struct.unpack_from("<d", reader.data, reader.pos)
+			reader.pos += 8
+			yield 'E', key, "%g" % value, ticks
+		elif tag == 'e':
+			yield 'E', key, "0.0", ticks
+		else:
+			raise ValueError("unknown record tag '%s'" % tag)
+
+
+def main():
+	parser = argparse.ArgumentParser(description=__doc__)
+	parser.add_argument("input", help="binary statev stream")
+	parser.add_argument("--csv", action="store_true",
+						help="write CSV with the context stack per event")
+	args = parser.parse_args()
+
+	with open(args.input, "rb") as f:
+		events = decode(f.read())
+
+	if not args.csv:
+		for kind, key, value, _ in events:
+			if value is None:
+				print("%s;%s" % (kind, key))
+			else:
+				print("%s;%s;%s" % (kind, key, value))
+		return
+
+	writer = csv.writer(sys.stdout)
+	writer.writerow(["ticks", "context", "key", "value"])
+	context = []
+	for kind, key, value, ticks in events:
+		if kind == 'P':
+			context.append("%s=%s" % (key, value))
+		elif kind == 'O':
+			context.pop()
+		else:
+			writer.writerow([ticks, ";".join(context), key, value])
+
+
+if __name__ == "__main__":
+	main()
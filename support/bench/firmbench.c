@@ -0,0 +1,356 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Compile-time benchmark driver.
+ *
+ * Imports a program exported with ir_export(), runs a pass pipeline and a
+ * backend on it and writes a tab separated record per phase to stdout:
+ *
+ *     program  phase  msec  nodes  rss_kb
+ *
+ * with the wall clock time of the phase, the number of nodes of all graphs
+ * after the phase and the peak resident set size so far.  Given a baseline
+ * written by an earlier run, the baseline values of each record are
+ * appended and phases which got slower than the tolerances are reported.
+ */
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "firm.h"
+
+#define ARRAY_SIZE(a) (sizeof(a)/sizeof((a)[0]))
+
+typedef struct pass_t {
+	char const *name;
+	void      (*irg_func)(ir_graph *irg);  /**< runs on every graph */
+	void      (*prog_func)(void);          /**< runs on the program */
+} pass_t;
+
+static void inline_default(void)
+{
+	inline_functions(750, 0, NULL);
+}
+
+static void scalar_replacement_all(void)
+{
+	for (size_t i = 0, n = get_irp_n_irgs(); i < n; ++i) {
+		scalar_replacement_opt(get_irp_irg(i));
+	}
+}
+
+static pass_t const passes[] = {
+	{ "lower-highlevel", lower_highlevel_graph,   NULL                   },
+	{ "target",          NULL,                    be_lower_for_target    },
+	{ "scalar-replace",  NULL,                    scalar_replacement_all },
+	{ "local",           optimize_graph_df,       NULL                   },
+	{ "control-flow",    optimize_cf,             NULL                   },
+	{ "jumpthreading",   opt_jumpthreading,       NULL                   },
+	{ "bool",            opt_bool,                NULL                   },
+	{ "conv",            conv_opt,                NULL                   },
+	{ "ldst",            optimize_load_store,     NULL                   },
+	{ "opt-ldst",        opt_ldst,                NULL                   },
+	{ "combo",           combo,                   NULL                   },
+	{ "gvn-pre",         do_gvn_pre,              NULL                   },
+	{ "reassociation",   optimize_reassociation,  NULL                   },
+	{ "if-conversion",   opt_if_conv,             NULL                   },
+	{ "tail-recursion",  opt_tail_rec_irg,        NULL                   },
+	{ "loop-inversion",  do_loop_inversion,       NULL                   },
+	{ "loop-unrolling",  do_loop_unrolling,       NULL                   },
+	{ "occult-consts",   occult_consts,           NULL                   },
+	{ "frame",           opt_frame_irg,           NULL                   },
+	{ "place",           place_code,              NULL                   },
+	{ "remove-phi-cycles", remove_phi_cycles,     NULL                   },
+	{ "inline",          NULL,                    inline_default         },
+	{ "funccalls",       NULL,                    optimize_funccalls     },
+	{ "gc-entities",     NULL,                    garbage_collect_entities },
+};
+
+static char const default_pipeline[]
+	= "lower-highlevel,target,scalar-replace,local,control-flow,"
+	  "jumpthreading,inline,local,combo,ldst,control-flow,place";
+
+/** A record of an earlier run. */
+typedef struct record_t {
+	char   *program;
+	char   *phase;
+	double  msec;
+	long    nodes;
+	long    rss_kb;
+} record_t;
+
+static char const *program;
+static record_t   *baseline;
+static size_t      n_baseline;
+static double      tolerance = 10.0;
+static double      tolerance_msec = 1.0;
+static bool        regressed;
+
+static void usage(char const *const argv0)
+{
+	fprintf(stderr,
+		"usage: %s [options] program.ir\n"
+		"  -p pass,...    the pass pipeline (default: %s)\n"
+		"  -B option      a backend option like isa=amd64, may be repeated\n"
+		"  -b file        compare with the baseline records in file\n"
+		"  -r percent     tolerated slowdown against the baseline (default: %.0f)\n"
+		"  -a msec        tolerated absolute slowdown (default: %.0f)\n"
+		"  -t file        write the pass profile as Chrome trace to file\n"
+		"  -l             list the passes\n",
+		argv0, default_pipeline, tolerance, tolerance_msec);
+}
+
+static pass_t const *find_pass(char const *const name, size_t const len)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(passes); ++i) {
+		if (strlen(passes[i].name) == len
+		    && strncmp(passes[i].name, name, len) == 0)
+			return &passes[i];
+	}
+	return NULL;
+}
+
+static void count_node(ir_node *node, void *data)
+{
+	(void)node;
+	++*(long*)data;
+}
+
+static long count_nodes(void)
+{
+	long n_nodes = 0;
+	for (size_t i = 0, n = get_irp_n_irgs(); i < n; ++i) {
+		irg_walk_graph(get_irp_irg(i), NULL, count_node, &n_nodes);
+	}
+	return n_nodes;
+}
+
+static long get_peak_rss_kb(void)
+{
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return -1;
+	return usage.ru_maxrss;
+}
+
+static char *duplicate_string(char const *const string)
+{
+	size_t const size = strlen(string) + 1;
+	char  *const copy = (char*)malloc(size);
+	if (copy == NULL) {
+		perror("malloc");
+		exit(EXIT_FAILURE);
+	}
+	return (char*)memcpy(copy, string, size);
+}
+
+static void load_baseline(char const *const filename)
+{
+	FILE *const f = fopen(filename, "r");
+	if (f == NULL) {
+		fprintf(stderr, "cannot open baseline '%s': %s\n", filename,
+		        strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	char line[1024];
+	while (fgets(line, sizeof(line), f) != NULL) {
+		char   prog[256];
+		char   phase[256];
+		double msec;
+		long   nodes;
+		long   rss_kb;
+		if (sscanf(line, "%255s %255s %lf %ld %ld", prog, phase, &msec,
+		           &nodes, &rss_kb) != 5)
+			continue;
+
+		baseline = (record_t*)realloc(baseline,
+		                              (n_baseline + 1) * sizeof(*baseline));
+		if (baseline == NULL) {
+			perror("realloc");
+			exit(EXIT_FAILURE);
+		}
+		record_t *const record = &baseline[n_baseline++];
+		record->program = duplicate_string(prog);
+		record->phase   = duplicate_string(phase);
+		record->msec    = msec;
+		record->nodes   = nodes;
+		record->rss_kb  = rss_kb;
+	}
+	fclose(f);
+}
+
+/**
+ * Returns the baseline record of the @p occurrence th run of @p phase, as
+ * pipelines may run a pass several times.
+ */
+static record_t const *find_baseline(char const *const phase,
+                                     unsigned const occurrence)
+{
+	unsigned n = 0;
+	for (size_t i = 0; i < n_baseline; ++i) {
+		record_t const *const record = &baseline[i];
+		if (strcmp(record->program, program) == 0
+		    && strcmp(record->phase, phase) == 0 && n++ == occurrence)
+			return record;
+	}
+	return NULL;
+}
+
+static void report(char const *const phase, unsigned const occurrence,
+                   double const msec)
+{
+	long const nodes  = count_nodes();
+	long const rss_kb = get_peak_rss_kb();
+	printf("%s\t%s\t%.3f\t%ld\t%ld", program, phase, msec, nodes, rss_kb);
+	if (baseline != NULL) {
+		record_t const *const record = find_baseline(phase, occurrence);
+		if (record == NULL) {
+			printf("\t-\t-\t-");
+		} else {
+			printf("\t%.3f\t%ld\t%ld", record->msec, record->nodes,
+			       record->rss_kb);
+			if (msec > record->msec * (1.0 + tolerance / 100.0)
+			    && msec > record->msec + tolerance_msec) {
+				fprintf(stderr, "%s: %s took %.3f instead of %.3f msec\n",
+				        program, phase, msec, record->msec);
+				regressed = true;
+			}
+		}
+	}
+	putchar('\n');
+}
+
+static void run_pass(pass_t const *const pass, unsigned const occurrence)
+{
+	ir_timer_t *const timer = ir_timer_new();
+	ir_timing_scope_push(pass->name, NULL);
+	ir_timer_reset_and_start(timer);
+	if (pass->prog_func != NULL) {
+		pass->prog_func();
+	} else {
+		for (size_t i = 0, n = get_irp_n_irgs(); i < n; ++i) {
+			pass->irg_func(get_irp_irg(i));
+		}
+	}
+	ir_timer_stop(timer);
+	ir_timing_scope_pop(pass->name);
+	report(pass->name, occurrence, ir_timer_elapsed_usec(timer) / 1000.0);
+	ir_timer_free(timer);
+}
+
+int main(int argc, char **argv)
+{
+	char const  *pipeline = default_pipeline;
+	char const  *trace    = NULL;
+	char const **be_args  = (char const**)calloc(argc, sizeof(*be_args));
+	size_t       n_be_args = 0;
+	int          i;
+	for (i = 1; i < argc && argv[i][0] == '-'; ++i) {
+		char const *const arg = argv[i];
+		if (strcmp(arg, "-l") == 0) {
+			for (size_t p = 0; p < ARRAY_SIZE(passes); ++p) {
+				puts(passes[p].name);
+			}
+			return EXIT_SUCCESS;
+		}
+		if (arg[1] == '\0' || arg[2] != '\0' || i + 1 == argc) {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+		char const *const value = argv[++i];
+		switch (arg[1]) {
+		case 'p': pipeline = value;                   break;
+		case 'B': be_args[n_be_args++] = value;       break;
+		case 'b': load_baseline(value);               break;
+		case 'r': tolerance = strtod(value, NULL);    break;
+		case 'a': tolerance_msec = strtod(value, NULL); break;
+		case 't': trace = value;                      break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (i + 1 != argc) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	char const *const filename = argv[i];
+	char const *const slash    = strrchr(filename, '/');
+	program = slash != NULL ? slash + 1 : filename;
+
+	ir_init();
+	for (size_t a = 0; a < n_be_args; ++a) {
+		if (!be_parse_arg(be_args[a])) {
+			fprintf(stderr, "invalid backend option '%s'\n", be_args[a]);
+			return EXIT_FAILURE;
+		}
+	}
+	ir_timing_enable(trace != NULL);
+
+	ir_timer_t *const total = ir_timer_new();
+	ir_timer_t *const timer = ir_timer_new();
+	ir_timer_reset_and_start(total);
+	ir_timer_reset_and_start(timer);
+	if (ir_import(filename) != 0) {
+		fprintf(stderr, "cannot import '%s'\n", filename);
+		return EXIT_FAILURE;
+	}
+	ir_timer_stop(timer);
+	report("import", 0, ir_timer_elapsed_usec(timer) / 1000.0);
+
+	/* the number of runs of each pass so far */
+	unsigned *const runs = (unsigned*)calloc(ARRAY_SIZE(passes), sizeof(*runs));
+	for (char const *name = pipeline; *name != '\0';) {
+		size_t const len = strcspn(name, ",");
+		if (len > 0) {
+			pass_t const *const pass = find_pass(name, len);
+			if (pass == NULL) {
+				fprintf(stderr, "unknown pass '%.*s'\n", (int)len, name);
+				return EXIT_FAILURE;
+			}
+			run_pass(pass, runs[pass - passes]++);
+		}
+		name += len;
+		if (*name == ',')
+			++name;
+	}
+
+	FILE *const out = fopen("/dev/null", "w");
+	if (out == NULL) {
+		perror("/dev/null");
+		return EXIT_FAILURE;
+	}
+	ir_timer_reset_and_start(timer);
+	be_main(out, program);
+	ir_timer_stop(timer);
+	fclose(out);
+	report("backend", 0, ir_timer_elapsed_usec(timer) / 1000.0);
+
+	ir_timer_stop(total);
+	report("total", 0, ir_timer_elapsed_usec(total) / 1000.0);
+
+	if (trace != NULL) {
+		FILE *const trace_out = fopen(trace, "w");
+		if (trace_out == NULL) {
+			fprintf(stderr, "cannot open '%s': %s\n", trace, strerror(errno));
+			return EXIT_FAILURE;
+		}
+		ir_timing_write_chrome_trace(trace_out);
+		fclose(trace_out);
+	}
+
+	ir_timer_free(timer);
+	ir_timer_free(total);
+	free(runs);
+	free(be_args);
+	ir_finish();
+	return regressed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
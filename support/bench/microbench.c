@@ -0,0 +1,602 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2017 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Microbenchmarks of the ADT containers and the tarval arithmetic.
+ *
+ * The keys are the nodes, entity names and constants of a program exported
+ * with ir_export(), so hash functions and containers see the pointer and
+ * string distributions of real compilations.  Without a program a synthetic
+ * graph and generated identifiers are used.  A tab separated record is
+ * written to stdout per benchmark:
+ *
+ *     benchmark  ops  nsec_per_op
+ *
+ * with the best time per operation of several runs.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "array.h"
+#include "bitset.h"
+#include "firm.h"
+#include "fltcalc.h"
+#include "hashptr.h"
+#include "irnodeset.h"
+#include "irprog_t.h"
+#include "obst.h"
+#include "pdeq.h"
+#include "pqueue.h"
+#include "pset.h"
+#include "pset_new.h"
+#include "set.h"
+#include "strcalc.h"
+#include "tv_t.h"
+#include "util.h"
+#include "xmalloc.h"
+
+/** The minimal duration of a run. */
+#define MIN_RUN_SEC 0.01
+
+/** The keys of the benchmarks. */
+static ir_node   **nodes;
+static char const **names;
+static ir_tarval **int_values;
+static ir_tarval **float_values;
+static unsigned    max_idx;
+static struct obstack name_obst;
+
+/** Keeps the results of the benchmarks alive. */
+static volatile size_t sink;
+
+typedef struct benchmark_t {
+	char const *name;
+	size_t    (*func)(void);  /**< runs once, returns the number of ops */
+} benchmark_t;
+
+static int cmp_node(void const *const a, void const *const b)
+{
+	return a != b;
+}
+
+static size_t bench_pset_new_insert(void)
+{
+	pset_new_t set;
+	pset_new_init(&set);
+	for (size_t i = 0, n = ARR_LEN(nodes); i < n; ++i) {
+		pset_new_insert(&set, nodes[i]);
+	}
+	sink += pset_new_size(&set);
+	pset_new_destroy(&set);
+	return ARR_LEN(nodes);
+}
+
+/** Looks up every node in a set of every second node. */
+static size_t bench_pset_new_lookup(void)
+{
+	size_t const n = ARR_LEN(nodes);
+	pset_new_t   set;
+	pset_new_init(&set);
+	for (size_t i = 0; i < n; i += 2) {
+		pset_new_insert(&set, nodes[i]);
+	}
+	size_t found = 0;
+	for (unsigned r = 0; r < 4; ++r) {
+		for (size_t i = 0; i < n; ++i) {
+			found += pset_new_contains(&set, nodes[i]);
+		}
+	}
+	sink += found;
+	pset_new_destroy(&set);
+	return 4 * n;
+}
+
+static size_t bench_nodeset_insert(void)
+{
+	ir_nodeset_t set;
+	ir_nodeset_init(&set);
+	for (size_t i = 0, n = ARR_LEN(nodes); i < n; ++i) {
+		ir_nodeset_insert(&set, nodes[i]);
+	}
+	sink += ir_nodeset_size(&set);
+	ir_nodeset_destroy(&set);
+	return ARR_LEN(nodes);
+}
+
+static size_t bench_nodeset_lookup(void)
+{
+	size_t const n = ARR_LEN(nodes);
+	ir_nodeset_t set;
+	ir_nodeset_init(&set);
+	for (size_t i = 0; i < n; i += 2) {
+		ir_nodeset_insert(&set, nodes[i]);
+	}
+	size_t found = 0;
+	for (unsigned r = 0; r < 4; ++r) {
+		for (size_t i = 0; i < n; ++i) {
+			found += ir_nodeset_contains(&set, nodes[i]);
+		}
+	}
+	sink += found;
+	ir_nodeset_destroy(&set);
+	return 4 * n;
+}
+
+static size_t bench_pset_insert(void)
+{
+	pset *const set = new_pset(cmp_node, 16);
+	for (size_t i = 0, n = ARR_LEN(nodes); i < n; ++i) {
+		pset_insert_ptr(set, nodes[i]);
+	}
+	sink += pset_count(set);
+	del_pset(set);
+	return ARR_LEN(nodes);
+}
+
+static size_t bench_pset_lookup(void)
+{
+	size_t const n   = ARR_LEN(nodes);
+	pset  *const set = new_pset(cmp_node, 16);
+	for (size_t i = 0; i < n; i += 2) {
+		pset_insert_ptr(set, nodes[i]);
+	}
+	size_t found = 0;
+	for (unsigned r = 0; r < 4; ++r) {
+		for (size_t i = 0; i < n; ++i) {
+			found += pset_find_ptr(set, nodes[i]) != NULL;
+		}
+	}
+	sink += found;
+	del_pset(set);
+	return 4 * n;
+}
+
+static int cmp_string(void const *const a, void const *const b,
+                      size_t const size)
+{
+	return memcmp(a, b, size);
+}
+
+static size_t bench_set_insert(void)
+{
+	set *const set = new_set(cmp_string, 16);
+	for (size_t i = 0, n = ARR_LEN(names); i < n; ++i) {
+		char const *const name = names[i];
+		set_insert(char, set, name, strlen(name) + 1, hash_str(name));
+	}
+	sink += set_count(set);
+	del_set(set);
+	return ARR_LEN(names);
+}
+
+static size_t bench_set_lookup(void)
+{
+	size_t const n   = ARR_LEN(names);
+	set   *const set = new_set(cmp_string, 16);
+	for (size_t i = 0; i < n; i += 2) {
+		char const *const name = names[i];
+		set_insert(char, set, name, strlen(name) + 1, hash_str(name));
+	}
+	size_t found = 0;
+	for (unsigned r = 0; r < 4; ++r) {
+		for (size_t i = 0; i < n; ++i) {
+			char const *const name = names[i];
+			found += set_find(char, set, name, strlen(name) + 1,
+			                  hash_str(name)) != NULL;
+		}
+	}
+	sink += found;
+	del_set(set);
+	return 4 * n;
+}
+
+/** Sets the bits of all node indices, as liveness and dataflow sets do. */
+static size_t bench_bitset_set(void)
+{
+	size_t    const n  = ARR_LEN(nodes);
+	bitset_t *const bs = bitset_malloc(max_idx);
+	for (unsigned r = 0; r < 4; ++r) {
+		for (size_t i = 0; i < n; ++i) {
+			bitset_set(bs, get_irn_idx(nodes[i]));
+		}
+	}
+	sink += bitset_popcount(bs);
+	free(bs);
+	return 4 * n;
+}
+
+/** Combines sets of node indices, counting one op per set operation. */
+static size_t bench_bitset_ops(void)
+{
+	size_t    const n   = ARR_LEN(nodes);
+	bitset_t *const a   = bitset_malloc(max_idx);
+	bitset_t *const b   = bitset_malloc(max_idx);
+	for (size_t i = 0; i < n; i += 3) {
+		bitset_set(a, get_irn_idx(nodes[i]));
+	}
+	for (size_t i = 0; i < n; i += 5) {
+		bitset_set(b, get_irn_idx(nodes[i]));
+	}
+	size_t const rounds = 256;
+	size_t       count  = 0;
+	for (size_t r = 0; r < rounds; ++r) {
+		bitset_or(a, b);
+		bitset_andnot(a, b);
+		count += bitset_popcount(a);
+		count += bitset_intersect(a, b);
+	}
+	sink += count;
+	free(b);
+	free(a);
+	return 4 * rounds;
+}
+
+/** Runs the nodes through a worklist in FIFO order. */
+static size_t bench_pdeq_fifo(void)
+{
+	size_t const n  = ARR_LEN(nodes);
+	pdeq  *const dq = new_pdeq();
+	for (size_t i = 0; i < n; ++i) {
+		pdeq_putr(dq, nodes[i]);
+		if (i % 4 == 3) {
+			sink += (size_t)pdeq_getl(dq);
+		}
+	}
+	while (!pdeq_empty(dq)) {
+		sink += (size_t)pdeq_getl(dq);
+	}
+	del_pdeq(dq);
+	return 2 * n;
+}
+
+/** Uses the deque as stack from both ends. */
+static size_t bench_pdeq_lifo(void)
+{
+	size_t const n  = ARR_LEN(nodes);
+	pdeq  *const dq = new_pdeq();
+	for (size_t i = 0; i < n; ++i) {
+		if (i % 2 == 0) {
+			pdeq_putl(dq, nodes[i]);
+		} else {
+			pdeq_putr(dq, nodes[i]);
+		}
+	}
+	for (size_t i = 0; i < n; ++i) {
+		sink += (size_t)(i % 2 == 0 ? pdeq_getl(dq) : pdeq_getr(dq));
+	}
+	del_pdeq(dq);
+	return 2 * n;
+}
+
+/** Orders the nodes by their index and opcode, like list schedulers. */
+static size_t bench_pqueue(void)
+{
+	size_t    const n = ARR_LEN(nodes);
+	pqueue_t *const q = new_pqueue();
+	for (size_t i = 0; i < n; ++i) {
+		ir_node *const node = nodes[i];
+		pqueue_put(q, node, (int)(get_irn_opcode(node) * 31 + get_irn_idx(node) % 64));
+	}
+	while (!pqueue_empty(q)) {
+		sink += (size_t)pqueue_pop_front(q);
+	}
+	del_pqueue(q);
+	return 2 * n;
+}
+
+/** Allocates objects of the sizes of the nodes with their in arrays. */
+static size_t bench_obstack(void)
+{
+	size_t const   n = ARR_LEN(nodes);
+	struct obstack obst;
+	obstack_init(&obst);
+	for (unsigned r = 0; r < 4; ++r) {
+		for (size_t i = 0; i < n; ++i) {
+			size_t const arity = (size_t)get_irn_arity(nodes[i]) + 1;
+			void  *const data  = obstack_alloc(&obst, 64 + arity * sizeof(ir_node*));
+			sink += (size_t)data;
+		}
+	}
+	obstack_free(&obst, NULL);
+	return 4 * n;
+}
+
+static size_t bench_ident_lookup(void)
+{
+	size_t const n = ARR_LEN(names);
+	for (unsigned r = 0; r < 4; ++r) {
+		for (size_t i = 0; i < n; ++i) {
+			sink += (size_t)new_id_from_str(names[i]);
+		}
+	}
+	return 4 * n;
+}
+
+/** Interns fresh identifiers derived from the names, like id_unique(). */
+static size_t bench_ident_insert(void)
+{
+	static unsigned round;
+	++round;
+	size_t const n = ARR_LEN(names);
+	for (size_t i = 0; i < n; ++i) {
+		char   buf[256];
+		size_t len = strlen(names[i]);
+		if (len > sizeof(buf) - 16)
+			len = sizeof(buf) - 16;
+		memcpy(buf, names[i], len);
+		len += snprintf(buf + len, sizeof(buf) - len, ".%u", round);
+		sink += (size_t)new_id_from_chars(buf, len);
+	}
+	return n;
+}
+
+static size_t bench_tarval_int(void)
+{
+	size_t const n = ARR_LEN(int_values);
+	for (size_t i = 0; i < n; ++i) {
+		ir_tarval *const a = int_values[i];
+		ir_tarval *const b = int_values[(i * 7 + 1) % n];
+		sink += (size_t)tarval_add(a, b);
+		sink += (size_t)tarval_mul(a, b);
+		sink += (size_t)tarval_and(a, b);
+		if (!tarval_is_null(b))
+			sink += (size_t)tarval_div(a, b);
+	}
+	return 4 * n;
+}
+
+static size_t bench_tarval_float(void)
+{
+	size_t const n = ARR_LEN(float_values);
+	for (size_t i = 0; i < n; ++i) {
+		ir_tarval *const a = float_values[i];
+		ir_tarval *const b = float_values[(i * 7 + 1) % n];
+		sink += (size_t)tarval_add(a, b);
+		sink += (size_t)tarval_mul(a, b);
+		sink += (size_t)tarval_div(a, b);
+	}
+	return 3 * n;
+}
+
+static size_t bench_strcalc(void)
+{
+	size_t  const n      = ARR_LEN(int_values);
+	unsigned const len   = sc_get_value_length();
+	sc_word *const result = XMALLOCN(sc_word, len);
+	for (size_t i = 0; i < n; ++i) {
+		sc_word const *const a = (sc_word const*)int_values[i]->value;
+		sc_word const *const b = (sc_word const*)int_values[(i * 7 + 1) % n]->value;
+		sc_add(a, b, result);
+		sc_mul(a, b, result);
+		if (!sc_is_zero(b, len * SC_BITS))
+			sc_div(a, b, result);
+		sink += result[0];
+	}
+	free(result);
+	return 3 * n;
+}
+
+static size_t bench_fltcalc(void)
+{
+	size_t    const n      = ARR_LEN(float_values);
+	fp_value *const result = (fp_value*)xmalloc(fc_get_value_size());
+	for (size_t i = 0; i < n; ++i) {
+		fp_value const *const a = (fp_value const*)float_values[i]->value;
+		fp_value const *const b = (fp_value const*)float_values[(i * 7 + 1) % n]->value;
+		fc_add(a, b, result);
+		fc_mul(a, b, result);
+		fc_div(a, b, result);
+		sink += fc_is_zero(result);
+	}
+	free(result);
+	return 3 * n;
+}
+
+static benchmark_t const benchmarks[] = {
+	{ "pset_new/insert",  bench_pset_new_insert },
+	{ "pset_new/lookup",  bench_pset_new_lookup },
+	{ "ir_nodeset/insert", bench_nodeset_insert },
+	{ "ir_nodeset/lookup", bench_nodeset_lookup },
+	{ "pset/insert",      bench_pset_insert     },
+	{ "pset/lookup",      bench_pset_lookup     },
+	{ "set/insert",       bench_set_insert      },
+	{ "set/lookup",       bench_set_lookup      },
+	{ "bitset/set",       bench_bitset_set      },
+	{ "bitset/ops",       bench_bitset_ops      },
+	{ "pdeq/fifo",        bench_pdeq_fifo       },
+	{ "pdeq/lifo",        bench_pdeq_lifo       },
+	{ "pqueue",           bench_pqueue          },
+	{ "obstack",          bench_obstack         },
+	{ "ident/lookup",     bench_ident_lookup    },
+	{ "ident/insert",     bench_ident_insert    },
+	{ "tarval/int",       bench_tarval_int      },
+	{ "tarval/float",     bench_tarval_float    },
+	{ "strcalc",          bench_strcalc         },
+	{ "fltcalc",          bench_fltcalc         },
+};
+
+static void collect_node(ir_node *node, void *data)
+{
+	(void)data;
+	ARR_APP1(ir_node*, nodes, node);
+	if (is_Const(node)) {
+		ir_tarval *const tv   = get_Const_tarval(node);
+		ir_mode   *const mode = get_tarval_mode(tv);
+		if (mode_is_int(mode)) {
+			ARR_APP1(ir_tarval*, int_values, tarval_convert_to(tv, mode_Ls));
+		} else if (mode_is_float(mode)) {
+			ARR_APP1(ir_tarval*, float_values, tarval_convert_to(tv, mode_D));
+		}
+	}
+}
+
+static void collect_program(void)
+{
+	foreach_irp_irg(i, irg) {
+		irg_walk_graph(irg, NULL, collect_node, NULL);
+		unsigned const last_idx = get_irg_last_idx(irg);
+		if (last_idx > max_idx)
+			max_idx = last_idx;
+	}
+	ir_type *const glob = get_glob_type();
+	for (size_t i = 0, n = get_compound_n_members(glob); i < n; ++i) {
+		ARR_APP1(char const*, names, get_entity_ld_name(get_compound_member(glob, i)));
+	}
+	foreach_irp_irg(i, irg) {
+		ir_type *const frame = get_irg_frame_type(irg);
+		for (size_t m = 0, n = get_compound_n_members(frame); m < n; ++m) {
+			ARR_APP1(char const*, names, get_entity_name(get_compound_member(frame, m)));
+		}
+	}
+}
+
+/**
+ * Creates the keys the program lacks: a graph with @p n_keys nodes,
+ * identifiers shaped like those of C programs and constants, which mostly are
+ * small numbers and powers of two.
+ */
+static void create_synthetic(size_t const n_keys)
+{
+	if (ARR_LEN(nodes) == 0) {
+		ir_type   *const type  = new_type_method(0, 0);
+		ir_entity *const ent   = new_entity(get_glob_type(), new_id_from_str("synthetic"), type);
+		ir_graph  *const irg   = new_ir_graph(ent, 0);
+		ir_node   *const block = get_irg_start_block(irg);
+		int        const opt   = get_optimize();
+		set_optimize(0);
+		ir_node *prev = new_r_Const_long(irg, mode_Is, 0);
+		for (size_t i = 0; i < n_keys; ++i) {
+			ir_node *const cnst = new_r_Const_long(irg, mode_Is, (long)(i % 17));
+			prev = i % 3 == 0 ? cnst : new_r_Add(block, prev, cnst, mode_Is);
+			ARR_APP1(ir_node*, nodes, prev);
+		}
+		set_optimize(opt);
+		max_idx = get_irg_last_idx(irg);
+	}
+
+	if (ARR_LEN(names) == 0) {
+		static char const *const prefixes[] = {
+			"get_", "set_", "is_", "new_r_", "__builtin_", "tmp", "", "init_",
+		};
+		static char const *const stems[] = {
+			"node", "block", "mode", "entity", "type", "value", "buffer", "count",
+		};
+		for (size_t i = 0; i < n_keys; ++i) {
+			obstack_printf(&name_obst, "%s%s%zu", prefixes[i % 8],
+			               stems[(i / 8) % 8], i / 64);
+			obstack_1grow(&name_obst, '\0');
+			ARR_APP1(char const*, names, (char const*)obstack_finish(&name_obst));
+		}
+	}
+
+	bool const need_ints   = ARR_LEN(int_values) == 0;
+	bool const need_floats = ARR_LEN(float_values) == 0;
+	for (size_t i = 0; i < 1024; ++i) {
+		long const value = i % 4 == 0 ? 1L << (i % 63) : (long)(i % 33) - 8;
+		if (need_ints)
+			ARR_APP1(ir_tarval*, int_values, new_tarval_from_long(value, mode_Ls));
+		if (need_floats)
+			ARR_APP1(ir_tarval*, float_values,
+			         new_tarval_from_double((double)value / 3.0, mode_D));
+	}
+}
+
+static void usage(char const *const argv0)
+{
+	fprintf(stderr,
+		"usage: %s [options] [program.ir]\n"
+		"  -n runs        runs per benchmark, the best is reported (default: 5)\n"
+		"  -k keys        number of synthetic keys (default: 100000)\n"
+		"  -f pattern     only run the benchmarks containing pattern\n"
+		"  -l             list the benchmarks\n",
+		argv0);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned    runs   = 5;
+	size_t      n_keys = 100000;
+	char const *filter = NULL;
+	int         i;
+	for (i = 1; i < argc && argv[i][0] == '-'; ++i) {
+		char const *const arg = argv[i];
+		if (strcmp(arg, "-l") == 0) {
+			for (size_t b = 0; b < ARRAY_SIZE(benchmarks); ++b) {
+				puts(benchmarks[b].name);
+			}
+			return EXIT_SUCCESS;
+		}
+		if (arg[1] == '\0' || arg[2] != '\0' || i + 1 == argc) {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+		char const *const value = argv[++i];
+		switch (arg[1]) {
+		case 'n': runs   = (unsigned)strtoul(value, NULL, 10); break;
+		case 'k': n_keys = (size_t)strtoul(value, NULL, 10);   break;
+		case 'f': filter = value;                              break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (i + 1 < argc || runs == 0 || n_keys == 0) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	ir_init();
+	obstack_init(&name_obst);
+	nodes        = NEW_ARR_F(ir_node*, 0);
+	names        = NEW_ARR_F(char const*, 0);
+	int_values   = NEW_ARR_F(ir_tarval*, 0);
+	float_values = NEW_ARR_F(ir_tarval*, 0);
+	if (i < argc) {
+		if (ir_import(argv[i]) != 0) {
+			fprintf(stderr, "cannot import '%s'\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+		collect_program();
+	}
+	create_synthetic(n_keys);
+
+	ir_timer_t *const timer = ir_timer_new();
+	for (size_t b = 0; b < ARRAY_SIZE(benchmarks); ++b) {
+		benchmark_t const *const benchmark = &benchmarks[b];
+		if (filter != NULL && strstr(benchmark->name, filter) == NULL)
+			continue;
+
+		/* small key sets are repeated until the timer resolution is no
+		 * concern */
+		double best = 0.0;
+		size_t ops  = 0;
+		for (unsigned r = 0; r < runs; ++r) {
+			size_t run_ops = 0;
+			ir_timer_reset_and_start(timer);
+			do {
+				run_ops += benchmark->func();
+			} while (ir_timer_elapsed_sec(timer) < MIN_RUN_SEC);
+			ir_timer_stop(timer);
+			double const nsec = ir_timer_elapsed_sec(timer) * 1e9 / run_ops;
+			if (r == 0 || nsec < best) {
+				best = nsec;
+				ops  = run_ops;
+			}
+		}
+		printf("%s\t%zu\t%.2f\n", benchmark->name, ops, best);
+	}
+	ir_timer_free(timer);
+
+	DEL_ARR_F(float_values);
+	DEL_ARR_F(int_values);
+	DEL_ARR_F(names);
+	DEL_ARR_F(nodes);
+	obstack_free(&name_obst, NULL);
+	ir_finish();
+	return EXIT_SUCCESS;
+}
@@ -3,22 +3,75 @@
  * This file is a supplement to libFirm. It is public domain.
  *  @author Matthias Braun, Steven Schaefer
  */
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-/* Prevent the compiler from mangling the name of this function. */
+/* Prevent the compiler from mangling the name of these functions. */
 void __init_firmprof(const char*, unsigned int*, size_t)
      asm("__init_firmprof");
+void __init_firmprof_threads(const char*, unsigned int*, size_t)
+     asm("__init_firmprof_threads");
+void __firmprof_increment(unsigned int*)
+     asm("__firmprof_increment");
+unsigned int *__firmprof_thread_counters(unsigned int*)
+     asm("__firmprof_thread_counters");
+
+/* The number of most frequent targets recorded per indirect call. */
+#define CALL_TARGETS 4
+
+/* Marks an unknown target in the profile file. */
+#define UNKNOWN_TARGET 0xFFFFFFFFu
+
+/**
+ * The targets of an indirect call site, the layout must match the call site
+ * words of libFirm.
+ */
+typedef struct _call_site_t {
+	void   *targets[CALL_TARGETS];
+	size_t  counts[CALL_TARGETS];
+	size_t  other;                /* calls of other targets */
+} call_site_t;
+
+void __init_firmprof_calls(unsigned int*, call_site_t*, unsigned int,
+                           void**, unsigned int)
+     asm("__init_firmprof_calls");
+void __firmprof_call_target(call_site_t*, void*)
+     asm("__firmprof_call_target");
 
 typedef struct _profile_counter_t {
-	const char *filename;
-	unsigned   *counters;
-	unsigned    len;
+	const char  *filename;
+	unsigned    *counters;
+	unsigned     len;
+	call_site_t *sites;     /* the indirect call sites, if recorded */
+	unsigned     n_sites;
+	void       **targets;   /* the functions identified in the profile */
+	unsigned     n_targets;
 	struct _profile_counter_t *next;
 } profile_counter_t;
 
 static profile_counter_t *counters = NULL;
 
+/**
+ * The counters of a translation unit instrumented with thread local
+ * counters, as used by one thread.
+ */
+typedef struct _thread_counter_t {
+	profile_counter_t        *shared;   /* the counters they are merged into */
+	unsigned                 *counters;
+	struct _thread_counter_t *next;     /* next of the same thread */
+	struct _thread_counter_t *next_all; /* next of all threads */
+} thread_counter_t;
+
+/* The thread local counters of the current thread. */
+static __thread thread_counter_t *thread_counters = NULL;
+
+/* The thread local counters of all threads, which are not merged yet. */
+static thread_counter_t *all_thread_counters = NULL;
+static pthread_mutex_t   thread_counters_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t     thread_exit_key;
+static int               threads_initialized = 0;
+
 /**
  * Write counter values to profiling output file.
  * We define our output format to be a sequence of 32-bit unsigned integer
@@ -41,9 +94,92 @@ void write_little_endian(unsigned *counter, unsigned len, FILE *f)
 	}
 }
 
+/**
+ * Write the targets of the call sites to the profiling output file: the
+ * number of sites followed by the index and count of each target and the
+ * count of other targets per site.
+ */
+static void write_call_sites(profile_counter_t *counter, FILE *f)
+{
+	unsigned i;
+
+	write_little_endian(&counter->n_sites, 1, f);
+	for (i = 0; i < counter->n_sites; ++i) {
+		call_site_t *site = &counter->sites[i];
+		size_t       other = site->other;
+		unsigned     words[2 * CALL_TARGETS + 1];
+		unsigned     t;
+
+		for (t = 0; t < CALL_TARGETS; ++t) {
+			void     *target = site->targets[t];
+			size_t    count  = site->counts[t];
+			unsigned  index  = 0;
+
+			while (index < counter->n_targets
+			       && counter->targets[index] != target)
+				++index;
+			if (target == NULL || index == counter->n_targets) {
+				other += count;
+				index  = UNKNOWN_TARGET;
+				count  = 0;
+			}
+			words[2 * t]     = index;
+			words[2 * t + 1] = count > 0xFFFFFFFFu ? 0xFFFFFFFFu : count;
+		}
+		words[2 * CALL_TARGETS] = other > 0xFFFFFFFFu ? 0xFFFFFFFFu : other;
+		write_little_endian(words, 2 * CALL_TARGETS + 1, f);
+	}
+}
+
+/**
+ * Adds the thread local counters to the shared ones and resets them.
+ */
+static void merge_thread_counters(thread_counter_t *local)
+{
+	unsigned i;
+
+	for (i = 0; i < local->shared->len; ++i) {
+		__sync_fetch_and_add(&local->shared->counters[i], local->counters[i]);
+		local->counters[i] = 0;
+	}
+}
+
+/**
+ * Merges and frees the thread local counters of an exiting thread.
+ */
+static void exit_thread(void *data)
+{
+	thread_counter_t *local = (thread_counter_t*) data;
+
+	pthread_mutex_lock(&thread_counters_lock);
+	while (local != NULL) {
+		thread_counter_t  *next = local->next;
+		thread_counter_t **anchor;
+
+		merge_thread_counters(local);
+		for (anchor = &all_thread_counters; *anchor != local;
+		     anchor = &(*anchor)->next_all) {
+		}
+		*anchor = local->next_all;
+		free(local->counters);
+		free(local);
+		local = next;
+	}
+	pthread_mutex_unlock(&thread_counters_lock);
+}
+
 static void write_profiles(void)
 {
 	profile_counter_t *counter = counters;
+	thread_counter_t  *local;
+
+	/* threads which are still running (and the main thread) did not merge
+	 * their counters yet */
+	pthread_mutex_lock(&thread_counters_lock);
+	for (local = all_thread_counters; local != NULL; local = local->next_all)
+		merge_thread_counters(local);
+	pthread_mutex_unlock(&thread_counters_lock);
+
 	while (counter != NULL) {
 		profile_counter_t *next = counter->next;
 		FILE *f = fopen(counter->filename, "wb");
@@ -52,6 +188,8 @@ static void write_profiles(void)
 		} else {
 			fputs("firmprof", f);
 			write_little_endian(counter->counters, counter->len, f);
+			if (counter->sites != NULL)
+				write_call_sites(counter, f);
 			fclose(f);
 		}
 		free(counter);
@@ -79,10 +217,141 @@ void __init_firmprof(const char *filename,
 	if (counter == NULL)
 		return;
 
-	counter->filename = filename;
-	counter->counters = counts;
-	counter->next     = counters;
-	counter->len      = len;
+	counter->filename  = filename;
+	counter->counters  = counts;
+	counter->next      = counters;
+	counter->len       = len;
+	counter->sites     = NULL;
+	counter->n_sites   = 0;
+	counter->targets   = NULL;
+	counter->n_targets = 0;
 
 	counters = counter;
 }
+
+/**
+ * Registers a new profile counter array, which is used by thread local
+ * counters.
+ */
+void __init_firmprof_threads(const char *filename,
+                             unsigned int *counts, size_t len)
+{
+	if (!threads_initialized) {
+		threads_initialized = 1;
+		pthread_key_create(&thread_exit_key, exit_thread);
+	}
+	__init_firmprof(filename, counts, len);
+}
+
+/**
+ * Increments a counter. The increment is atomic, but does not order other
+ * memory accesses.
+ */
+void __firmprof_increment(unsigned int *counter)
+{
+#ifdef __ATOMIC_RELAXED
+	__atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+#else
+	__sync_fetch_and_add(counter, 1);
+#endif
+}
+
+/**
+ * Returns the copy of the counter array @p shared for the current thread,
+ * which is called on every entry of an instrumented function.
+ */
+unsigned int *__firmprof_thread_counters(unsigned int *shared)
+{
+	thread_counter_t  *local = thread_counters;
+	thread_counter_t **anchor;
+	profile_counter_t *counter;
+
+	if (local != NULL && local->shared->counters == shared)
+		return local->counters;
+
+	/* move the counters to the front, calls tend to stay in a translation
+	 * unit */
+	for (anchor = &thread_counters; *anchor != NULL;
+	     anchor = &(*anchor)->next) {
+		local = *anchor;
+		if (local->shared->counters == shared) {
+			*anchor         = local->next;
+			local->next     = thread_counters;
+			thread_counters = local;
+			pthread_setspecific(thread_exit_key, local);
+			return local->counters;
+		}
+	}
+
+	for (counter = counters; counter != NULL; counter = counter->next) {
+		if (counter->counters == shared)
+			break;
+	}
+	if (counter == NULL)
+		return shared;
+
+	local = (thread_counter_t*) malloc(sizeof(*local));
+	if (local == NULL)
+		return shared;
+	local->counters = (unsigned*) calloc(counter->len, sizeof(unsigned));
+	if (local->counters == NULL) {
+		free(local);
+		return shared;
+	}
+	local->shared   = counter;
+	local->next     = thread_counters;
+	thread_counters = local;
+
+	pthread_mutex_lock(&thread_counters_lock);
+	local->next_all     = all_thread_counters;
+	all_thread_counters = local;
+	pthread_mutex_unlock(&thread_counters_lock);
+
+	pthread_setspecific(thread_exit_key, local);
+	return local->counters;
+}
+
+/**
+ * Registers the indirect call sites of the translation unit with the
+ * counters @p counts, which must be registered already.
+ */
+void __init_firmprof_calls(unsigned int *counts, call_site_t *sites,
+                           unsigned int n_sites, void **targets,
+                           unsigned int n_targets)
+{
+	profile_counter_t *counter;
+
+	for (counter = counters; counter != NULL; counter = counter->next) {
+		if (counter->counters == counts) {
+			counter->sites     = sites;
+			counter->n_sites   = n_sites;
+			counter->targets   = targets;
+			counter->n_targets = n_targets;
+			return;
+		}
+	}
+}
+
+/**
+ * Records a call of @p callee at @p site. The first targets get a slot of
+ * the site, calls of later ones are only counted.
+ */
+void __firmprof_call_target(call_site_t *site, void *callee)
+{
+	unsigned i;
+
+	for (i = 0; i < CALL_TARGETS; ++i) {
+		void *target = site->targets[i];
+		if (target == NULL) {
+			target = __sync_val_compare_and_swap(&site->targets[i], NULL,
+			                                     callee);
+			if (target == NULL)
+				target = callee;
+		}
+		if (target == callee) {
+			__sync_fetch_and_add(&site->counts[i], 1);
+			return;
+		}
+	}
+	__sync_fetch_and_add(&site->other, 1);
+}
@@ -0,0 +1,106 @@
+#include <assert.h>
+#include "array.h"
+#include "obst.h"
+
+static void test_stack_buffer(void)
+{
+	ir_arr_reset_statistics();
+
+	int *arr = NEW_ARR_A(int, 8);
+	int *const buffer = arr;
+	assert(ARR_LEN(arr) == 0);
+	for (int i = 0; i < 8; ++i)
+		ARR_APP1(int, arr, i);
+	/* appends within the capacity stay in the stack buffer */
+	assert(arr == buffer);
+	assert(ARR_LEN(arr) == 8);
+
+	ir_arr_statistics_t stats;
+	ir_arr_get_statistics(&stats);
+	assert(stats.resizes == 0);
+
+	/* the ninth element moves the array to the heap */
+	ARR_APP1(int, arr, 8);
+	assert(arr != buffer);
+	ir_arr_get_statistics(&stats);
+	assert(stats.resizes == 1);
+	assert(stats.bytes_copied == 8 * sizeof(int));
+	for (int i = 9; i < 100; ++i)
+		ARR_APP1(int, arr, i);
+	assert(ARR_LEN(arr) == 100);
+	for (int i = 0; i < 100; ++i)
+		assert(arr[i] == i);
+	DEL_ARR_F(arr);
+
+	/* an array that never leaves its buffer can be deleted as well */
+	double *small = NEW_ARR_A(double, 4);
+	ARR_APP1(double, small, 1.5);
+	ARR_SHRINKLEN(small, 0);
+	assert(ARR_LEN(small) == 0);
+	DEL_ARR_F(small);
+}
+
+static void test_geometric_growth(void)
+{
+	ir_arr_reset_statistics();
+	unsigned *arr = NEW_ARR_F(unsigned, 0);
+	for (unsigned i = 0; i < 100000; ++i)
+		ARR_APP1(unsigned, arr, i);
+	for (unsigned i = 0; i < 100000; ++i)
+		assert(arr[i] == i);
+
+	/* doubling needs a logarithmic number of reallocations */
+	ir_arr_statistics_t stats;
+	ir_arr_get_statistics(&stats);
+	assert(stats.resizes <= 20);
+	assert(stats.bytes_copied < 2 * 100000 * sizeof(unsigned));
+
+	/* shrinking a little and growing again does not reallocate */
+	ir_arr_reset_statistics();
+	for (unsigned i = 0; i < 1000; ++i) {
+		ARR_RESIZE(unsigned, arr, 99000);
+		ARR_APP1(unsigned, arr, i);
+	}
+	ir_arr_get_statistics(&stats);
+	assert(stats.resizes == 0);
+	assert(arr[99000] == 999);
+	DEL_ARR_F(arr);
+}
+
+static void test_obstack_arrays(void)
+{
+	struct obstack obst;
+	obstack_init(&obst);
+	ir_arr_reset_statistics();
+
+	/* the empty array is shared, appending must not modify it */
+	int *arr = NEW_ARR_D(int, &obst, 0);
+	int *other = NEW_ARR_D(int, &obst, 0);
+	assert(ARR_LEN(arr) == 0);
+	for (int i = 0; i < 1000; ++i)
+		ARR_APP1_D(int, &obst, arr, i);
+	assert(ARR_LEN(arr) == 1000);
+	assert(ARR_LEN(other) == 0);
+	for (int i = 0; i < 1000; ++i)
+		assert(arr[i] == i);
+
+	ir_arr_statistics_t stats;
+	ir_arr_get_statistics(&stats);
+	assert(stats.resizes <= 10);
+
+	int *dup = DUP_ARR_D(int, &obst, arr);
+	assert(ARR_LEN(dup) == 1000 && dup[999] == 999);
+	ARR_APP1_D(int, &obst, dup, 1000);
+	assert(ARR_LEN(dup) == 1001 && dup[1000] == 1000);
+	assert(ARR_LEN(arr) == 1000);
+
+	obstack_free(&obst, NULL);
+}
+
+int main(void)
+{
+	test_stack_buffer();
+	test_geometric_growth();
+	test_obstack_arrays();
+	return 0;
+}
@@ -0,0 +1,122 @@
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include "gaussseidel.h"
+
+static bool near(double a, double b, double eps)
+{
+	return fabs(a - b) <= eps * fabs(b);
+}
+
+/*
+ * Flow equations of a loop: 0->1, 1->2 (0.3), 1->3 (0.7), 2->4, 3->4,
+ * 4->1 (p), 4->5 (1-p), 5->0. Row j holds -x_j + sum_i P(i->j) x_i.
+ */
+static gs_matrix_t *new_loop_matrix(double p)
+{
+	gs_matrix_t *m = gs_new_matrix(6, 2);
+	for (unsigned i = 0; i < 6; ++i)
+		gs_matrix_set(m, i, i, -1.0);
+	gs_matrix_set(m, 0, 5, 1.0);
+	gs_matrix_set(m, 1, 0, 1.0);
+	gs_matrix_set(m, 1, 4, p);
+	gs_matrix_set(m, 2, 1, 0.3);
+	gs_matrix_set(m, 3, 1, 0.7);
+	gs_matrix_set(m, 4, 2, 1.0);
+	gs_matrix_set(m, 4, 3, 1.0);
+	gs_matrix_set(m, 5, 4, 1.0 - p);
+	return m;
+}
+
+static void test_loop(void)
+{
+	gs_matrix_t *m = new_loop_matrix(0.99);
+	assert(gs_matrix_get_n_entries(m) == 14);
+	assert(gs_matrix_get(m, 1, 4) == 0.99);
+	assert(gs_matrix_get(m, 2, 2) == -1.0);
+	assert(gs_matrix_get(m, 2, 4) == 0.0);
+
+	/* the loop body runs 1/(1-p) times per entry */
+	static const double expected[]    = { 1.0, 100.0, 30.0, 70.0, 100.0, 1.0 };
+	static const double expected_09[] = { 1.0,  10.0,  3.0,  7.0,  10.0, 1.0 };
+	double x[6] = { 1.0, 1.0, 1.0, 1.0, 1.0, 1.0 };
+	unsigned const n_iter = gs_matrix_solve(m, x, 1e-12, 1000);
+	assert(n_iter < 1000);
+	for (unsigned i = 0; i < 6; ++i)
+		assert(near(x[i] / x[0], expected[i], 1e-9));
+
+	/* changing an entry drops the frozen form */
+	gs_matrix_set(m, 1, 4, 0.9);
+	gs_matrix_set(m, 5, 4, 0.1);
+	assert(gs_matrix_get(m, 1, 4) == 0.9);
+	double y[6] = { 1.0, 1.0, 1.0, 1.0, 1.0, 1.0 };
+	for (unsigned i = 0; i < 1000; ++i) {
+		if (gs_matrix_gauss_seidel(m, y) <= 1e-12)
+			break;
+	}
+	for (unsigned i = 0; i < 6; ++i)
+		assert(near(y[i] / y[0], expected_09[i], 1e-9));
+
+	/* one step on the frozen form equals one step on the builder form */
+	double a[6] = { 1.0, 2.0, 3.0, 4.0, 5.0, 6.0 };
+	double b[6] = { 1.0, 2.0, 3.0, 4.0, 5.0, 6.0 };
+	double const res_a = gs_matrix_gauss_seidel(m, a);
+	gs_matrix_freeze(m);
+	double const res_b = gs_matrix_gauss_seidel(m, b);
+	assert(near(res_a, res_b, 1e-12));
+	for (unsigned i = 0; i < 6; ++i)
+		assert(near(a[i], b[i], 1e-12));
+
+	gs_delete_matrix(m);
+}
+
+/*
+ * Random walk on a path with reflecting ends. Its stationary distribution
+ * is uniform on the inner nodes and half as large on the two ends, but plain
+ * Gauss-Seidel converges slowly.
+ */
+static void test_random_walk(void)
+{
+	unsigned const n = 100;
+	gs_matrix_t   *m = gs_new_matrix(n, 2);
+	for (unsigned j = 0; j < n; ++j) {
+		gs_matrix_set(m, j, j, -1.0);
+		if (j > 0)
+			gs_matrix_set(m, j, j - 1, j - 1 == 0 ? 1.0 : 0.5);
+		if (j + 1 < n)
+			gs_matrix_set(m, j, j + 1, j + 1 == n - 1 ? 1.0 : 0.5);
+	}
+
+	double x[100];
+	double y[100];
+	for (unsigned i = 0; i < n; ++i)
+		x[i] = y[i] = 1.0 + i % 3;
+
+	unsigned const n_iter = gs_matrix_solve(m, x, 1e-10, 1000000);
+	unsigned       n_gs   = 1;
+	while (gs_matrix_gauss_seidel(m, y) > 1e-10)
+		++n_gs;
+	/* over-relaxation needs far fewer steps */
+	assert(n_iter * 4 < n_gs);
+
+	assert(near(x[0] / x[1], 0.5, 1e-8));
+	assert(near(x[n - 1] / x[1], 0.5, 1e-8));
+	for (unsigned i = 1; i < n - 1; ++i) {
+		assert(near(x[i] / x[1], 1.0, 1e-8));
+		assert(near(x[i] / x[1], y[i] / y[1], 1e-7));
+	}
+
+	/* the iteration budget is respected */
+	for (unsigned i = 0; i < n; ++i)
+		x[i] = 1.0 + i % 3;
+	assert(gs_matrix_solve(m, x, 0.0, 10) == 10);
+
+	gs_delete_matrix(m);
+}
+
+int main(void)
+{
+	test_loop();
+	test_random_walk();
+	return 0;
+}
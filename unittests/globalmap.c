@@ -20,12 +20,26 @@ int main(void)
 	ir_type   *cls    = new_type_class(id2);
 	set_entity_owner(x, cls);
 	assert(get_entity_owner(x) == cls);
+	assert(get_class_member_index(cls, x) == 0);
+	assert(get_compound_member_index(glob, x) == INVALID_MEMBER_INDEX);
 
 	ir_entity *gx = ir_get_global(id1);
 	assert (NULL == gx);
 
 	set_entity_owner(x, glob);
 	assert(get_entity_owner(x) == glob);
+	assert(get_class_member_index(cls, x) == INVALID_MEMBER_INDEX);
+
+	/* member indices stay consistent when members are removed */
+	ir_type   *strct = new_type_struct(new_id_from_str("s"));
+	ir_entity *m[4];
+	for (size_t i = 0; i < 4; ++i)
+		m[i] = new_entity(strct, id_unique("m"), type);
+	remove_compound_member(strct, m[1]);
+	assert(get_struct_member_index(strct, m[1]) == INVALID_MEMBER_INDEX);
+	assert(get_struct_member_index(strct, m[0]) == 0);
+	assert(get_struct_member_index(strct, m[2]) == 1);
+	assert(get_struct_member_index(strct, m[3]) == 2);
 
 	return 0;
 }
@@ -0,0 +1,119 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define GROUP_PROBING
+#define HashSet          int_set_t
+#define HashSetIterator  int_set_iterator_t
+#define ValueType        int
+#include "hashset.h"
+
+typedef struct int_set_t          int_set_t;
+typedef struct int_set_iterator_t int_set_iterator_t;
+
+#define NullValue                 0
+#define DeletedValue              -1
+#define SCALAR_RETURN
+#define Hash(self,key)            ((unsigned)(key))
+#define KeysEqual(self,key1,key2) ((key1) == (key2))
+#define SetRangeEmpty(ptr,size)   memset(ptr, 0, (size) * sizeof((ptr)[0]))
+
+#define hashset_init            int_set_init
+#define hashset_destroy         int_set_destroy
+#define hashset_insert          int_set_insert
+#define hashset_remove          int_set_remove
+#define hashset_find            int_set_find
+#define hashset_size            int_set_size
+#define hashset_iterator_init   int_set_iterator_init
+#define hashset_iterator_next   int_set_iterator_next
+#define hashset_remove_iterator int_set_remove_iterator
+
+void int_set_init(int_set_t *self);
+void int_set_destroy(int_set_t *self);
+int int_set_insert(int_set_t *self, int key);
+void int_set_remove(int_set_t *self, const int key);
+int int_set_find(const int_set_t *self, const int key);
+size_t int_set_size(const int_set_t *self);
+void int_set_iterator_init(int_set_iterator_t *self, const int_set_t *set);
+int int_set_iterator_next(int_set_iterator_t *self);
+void int_set_remove_iterator(int_set_t *self, const int_set_iterator_t *iter);
+
+#include "hashset.c.h"
+
+#define N 5000
+
+static bool in_set[N * 64];
+
+static void check(const int_set_t *set)
+{
+	size_t n = 0;
+	for (int i = 1; i < N * 64; ++i) {
+		if (in_set[i]) {
+			assert(int_set_find(set, i) == i);
+			++n;
+		} else {
+			assert(int_set_find(set, i) == NullValue);
+		}
+	}
+	assert(int_set_size(set) == n);
+
+	size_t             iterated = 0;
+	int_set_iterator_t iter;
+	int_set_iterator_init(&iter, set);
+	for (int v; (v = int_set_iterator_next(&iter)) != NullValue;) {
+		assert(in_set[v]);
+		++iterated;
+	}
+	assert(iterated == n);
+}
+
+int main(void)
+{
+	int_set_t set;
+	int_set_init(&set);
+
+	/* dense keys fill whole groups, strided keys collide on the home group */
+	for (int i = 1; i < N; ++i) {
+		assert(int_set_insert(&set, i) == i);
+		in_set[i] = true;
+		assert(int_set_insert(&set, i * 64) == i * 64);
+		in_set[i * 64] = true;
+	}
+	check(&set);
+
+	/* insert again, the existing keys must be found */
+	for (int i = 1; i < N; ++i)
+		assert(int_set_insert(&set, i) == i);
+	check(&set);
+
+	/* delete every third key, then reuse the deleted buckets */
+	for (int i = 1; i < N; i += 3) {
+		int_set_remove(&set, i);
+		in_set[i] = false;
+	}
+	int_set_remove(&set, N * 64 - 1);
+	check(&set);
+	for (int i = 1; i < N; i += 6) {
+		assert(int_set_insert(&set, i) == i);
+		in_set[i] = true;
+	}
+	check(&set);
+
+	/* remove almost everything through the iterator, the set shrinks */
+	int_set_iterator_t iter;
+	int_set_iterator_init(&iter, &set);
+	for (int v; (v = int_set_iterator_next(&iter)) != NullValue;) {
+		if (v == 7)
+			continue;
+		int_set_remove_iterator(&set, &iter);
+		in_set[v] = false;
+	}
+	check(&set);
+	assert(int_set_insert(&set, 64) == 64);
+	in_set[64] = true;
+	check(&set);
+
+	int_set_destroy(&set);
+	return 0;
+}
@@ -0,0 +1,153 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+#include "hungarian.h"
+
+#define MAX_N 7
+
+static unsigned const example[4][MAX_N] = {
+	{ 9, 2, 7, 8 },
+	{ 6, 4, 3, 7 },
+	{ 5, 8, 1, 8 },
+	{ 7, 6, 9, 4 },
+};
+
+static hungarian_problem_t *new_problem(unsigned n,
+                                        unsigned const cost[][MAX_N])
+{
+	hungarian_problem_t *p = hungarian_new(n, n, HUNGARIAN_MATCH_PERFECT);
+	for (unsigned r = 0; r < n; ++r) {
+		for (unsigned c = 0; c < n; ++c)
+			hungarian_add(p, r, c, cost[r][c]);
+	}
+	return p;
+}
+
+/** Returns the cheapest assignment by trying all permutations. */
+static unsigned brute_force(unsigned n, unsigned const cost[][MAX_N],
+                            unsigned row, bool *used)
+{
+	if (row == n)
+		return 0;
+	unsigned best = ~0u;
+	for (unsigned c = 0; c < n; ++c) {
+		if (used[c])
+			continue;
+		used[c] = true;
+		unsigned const sum = cost[row][c] + brute_force(n, cost, row + 1, used);
+		used[c] = false;
+		if (sum < best)
+			best = sum;
+	}
+	return best;
+}
+
+static void check_assignment(unsigned n, unsigned const cost[][MAX_N],
+                             unsigned const *assignment, unsigned final_cost)
+{
+	bool     used[MAX_N] = { false };
+	unsigned sum         = 0;
+	for (unsigned r = 0; r < n; ++r) {
+		unsigned const c = assignment[r];
+		assert(c < n && !used[c]);
+		used[c] = true;
+		sum += cost[r][c];
+	}
+	assert(sum == final_cost);
+}
+
+static void test_example(void)
+{
+	hungarian_problem_t *p = new_problem(4, example);
+	unsigned assignment[4];
+	unsigned final_cost;
+	assert(hungarian_solve_jv(p, assignment, &final_cost, 0) == 0);
+	assert(final_cost == 13);
+	assert(assignment[0] == 1);
+	assert(assignment[1] == 0);
+	assert(assignment[2] == 2);
+	assert(assignment[3] == 3);
+
+	/* the cost matrix is not modified, so solving again gives the same */
+	unsigned again[4];
+	assert(hungarian_solve_jv(p, again, NULL, 0) == 0);
+	assert(memcmp(assignment, again, sizeof(again)) == 0);
+
+	/* matchings at or above the threshold are removed */
+	assert(hungarian_solve_jv(p, again, &final_cost, 4) == 0);
+	assert(final_cost == 13);
+	assert(again[0] == 1);
+	assert(again[1] == (unsigned)-1);
+	assert(again[2] == 2);
+	assert(again[3] == (unsigned)-1);
+	hungarian_free(p);
+
+	/* maximizing picks 9 + 7 + 8 + 9 */
+	p = new_problem(4, example);
+	hungarian_prepare_cost_matrix(p, HUNGARIAN_MODE_MAXIMIZE_UTIL);
+	assert(hungarian_solve_jv(p, assignment, &final_cost, 0) == 0);
+	assert(final_cost == 4 * 9 - (9 + 7 + 8 + 9));
+	hungarian_free(p);
+}
+
+static void test_normal_matching(void)
+{
+	/* 3 rows, 2 columns: the matrix is padded with zero costs, so row 1
+	 * takes column 0 and row 2 the padding column, and both matches are
+	 * removed from the assignment */
+	hungarian_problem_t *p = hungarian_new(3, 2, HUNGARIAN_MATCH_NORMAL);
+	hungarian_add(p, 0, 0, 5);
+	hungarian_add(p, 0, 1, 1);
+	hungarian_add(p, 2, 0, 2);
+	hungarian_add(p, 2, 1, 3);
+	unsigned assignment[3];
+	unsigned final_cost;
+	assert(hungarian_solve_jv(p, assignment, &final_cost, 0) == 0);
+	assert(final_cost == 1);
+	assert(assignment[0] == 1);
+	assert(assignment[1] == (unsigned)-1);
+	assert(assignment[2] == (unsigned)-1);
+	hungarian_free(p);
+}
+
+static void test_random(void)
+{
+	unsigned state = 4711;
+	for (unsigned round = 0; round < 200; ++round) {
+		unsigned const n = 1 + round % MAX_N;
+		unsigned cost[MAX_N][MAX_N];
+		for (unsigned r = 0; r < n; ++r) {
+			for (unsigned c = 0; c < n; ++c) {
+				state = state * 1103515245 + 12345;
+				/* few distinct values give many ties */
+				cost[r][c] = (state >> 16) % (round % 2 ? 5 : 1000);
+			}
+		}
+
+		bool           used[MAX_N] = { false };
+		unsigned const best        = brute_force(n, cost, 0, used);
+
+		hungarian_problem_t *p = new_problem(n, cost);
+		unsigned assignment[MAX_N];
+		unsigned final_cost;
+		assert(hungarian_solve_jv(p, assignment, &final_cost, 0) == 0);
+		assert(final_cost == best);
+		check_assignment(n, cost, assignment, final_cost);
+		hungarian_free(p);
+
+		/* the classic solver finds an assignment of the same cost */
+		p = new_problem(n, cost);
+		unsigned classic_cost;
+		assert(hungarian_solve(p, assignment, &classic_cost, 0) == 0);
+		assert(classic_cost == best);
+		hungarian_free(p);
+	}
+}
+
+int main(void)
+{
+	test_example();
+	test_normal_matching();
+	test_random();
+	return 0;
+}
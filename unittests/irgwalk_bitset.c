@@ -0,0 +1,143 @@
+#include <assert.h>
+#include <stdbool.h>
+#include "firm.h"
+#include "irgwalk_t.h"
+#include "irnode_t.h"
+
+#define MAX_EVENTS 256
+
+typedef struct walk_log_t {
+	unsigned n;
+	unsigned events[MAX_EVENTS];
+} walk_log_t;
+
+static void log_pre(ir_node *node, void *env)
+{
+	walk_log_t *const log = (walk_log_t*)env;
+	assert(log->n < MAX_EVENTS);
+	log->events[log->n++] = get_irn_idx(node) << 1;
+}
+
+static void log_post(ir_node *node, void *env)
+{
+	walk_log_t *const log = (walk_log_t*)env;
+	assert(log->n < MAX_EVENTS);
+	log->events[log->n++] = get_irn_idx(node) << 1 | 1;
+}
+
+static void count_node(ir_node *node, void *env)
+{
+	(void)node;
+	++*(unsigned*)env;
+}
+
+typedef struct nested_env_t {
+	bitset_t *visited;
+	unsigned  n_outer;
+	unsigned  n_inner;
+} nested_env_t;
+
+/* starts a complete inner walk for every node of the outer walk */
+static void nested_walk(ir_node *node, void *env)
+{
+	nested_env_t *const nested = (nested_env_t*)env;
+	++nested->n_outer;
+	bitset_clear_all(nested->visited);
+	unsigned n = 0;
+	irg_walk_graph_bitset(get_irn_irg(node), nested->visited, count_node,
+	                      NULL, &n);
+	if (nested->n_inner == 0)
+		nested->n_inner = n;
+	assert(n == nested->n_inner);
+}
+
+/* int f(int n) { int s = 0; for (int i = 0; i < n; ++i) s += i; return s; } */
+static ir_graph *new_loop_graph(void)
+{
+	ir_type   *const int_type = get_type_for_mode(mode_Is);
+	ir_type   *const mtp      = new_type_method(1, 1);
+	set_method_param_type(mtp, 0, int_type);
+	set_method_res_type(mtp, 0, int_type);
+	ir_entity *const ent = new_entity(get_glob_type(), new_id_from_str("f"),
+	                                  mtp);
+	ir_graph  *const irg = new_ir_graph(ent, 2);
+	set_current_ir_graph(irg);
+
+	ir_node *const n = new_Proj(get_irg_args(irg), mode_Is, 0);
+	set_value(0, new_Const_long(mode_Is, 0));
+	set_value(1, new_Const_long(mode_Is, 0));
+	ir_node *const enter = new_Jmp();
+
+	ir_node *const head = new_immBlock();
+	add_immBlock_pred(head, enter);
+	set_cur_block(head);
+	ir_node *const i    = get_value(1, mode_Is);
+	ir_node *const cmp  = new_Cmp(i, n, ir_relation_less);
+	ir_node *const cond = new_Cond(cmp);
+
+	ir_node *const body = new_immBlock();
+	add_immBlock_pred(body, new_Proj(cond, mode_X, pn_Cond_true));
+	mature_immBlock(body);
+	set_cur_block(body);
+	set_value(0, new_Add(get_value(0, mode_Is), i, mode_Is));
+	set_value(1, new_Add(i, new_Const_long(mode_Is, 1), mode_Is));
+	add_immBlock_pred(head, new_Jmp());
+	mature_immBlock(head);
+
+	ir_node *const exit = new_immBlock();
+	add_immBlock_pred(exit, new_Proj(cond, mode_X, pn_Cond_false));
+	mature_immBlock(exit);
+	set_cur_block(exit);
+	ir_node *const res[] = { get_value(0, mode_Is) };
+	ir_node *const ret   = new_Return(get_store(), 1, res);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+
+	irg_finalize_cons(irg);
+	return irg;
+}
+
+int main(void)
+{
+	ir_init();
+	ir_graph *const irg = new_loop_graph();
+
+	/* the bitset walk visits the nodes in the same order as irg_walk_graph */
+	walk_log_t expected = { .n = 0 };
+	irg_walk_graph(irg, log_pre, log_post, &expected);
+	assert(expected.n > 0);
+
+	ir_visited_t const irg_visited = get_irg_visited(irg);
+	ir_node     *const end         = get_irg_end(irg);
+	ir_visited_t const end_visited = get_irn_visited(end);
+
+	unsigned  const n_nodes = get_irg_last_idx(irg);
+	bitset_t *const visited = bitset_malloc(n_nodes);
+	walk_log_t      log     = { .n = 0 };
+	irg_walk_graph_bitset(irg, visited, log_pre, log_post, &log);
+	assert(log.n == expected.n);
+	for (unsigned e = 0; e < log.n; ++e)
+		assert(log.events[e] == expected.events[e]);
+	assert(bitset_popcount(visited) == expected.n / 2);
+
+	/* neither the graph nor the nodes are touched */
+	assert(get_irg_visited(irg) == irg_visited);
+	assert(get_irn_visited(end) == end_visited);
+
+	/* nodes already in the bitset are skipped */
+	log.n = 0;
+	irg_walk_graph_bitset(irg, visited, log_pre, log_post, &log);
+	assert(log.n == 0);
+
+	/* walks can be nested, also while the visited counters are in use */
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_VISITED);
+	nested_env_t nested = { .visited = bitset_malloc(n_nodes) };
+	bitset_clear_all(visited);
+	irg_walk_graph_bitset(irg, visited, nested_walk, NULL, &nested);
+	assert(nested.n_outer == expected.n / 2);
+	assert(nested.n_inner == expected.n / 2);
+	ir_free_resources(irg, IR_RESOURCE_IRN_VISITED);
+
+	xfree(nested.visited);
+	xfree(visited);
+	return 0;
+}
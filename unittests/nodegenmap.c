@@ -0,0 +1,98 @@
+#include <assert.h>
+#include <limits.h>
+#include "firm.h"
+#include "irnodemap.h"
+
+#define N_NODES 64
+
+typedef struct pair_t {
+	int    a;
+	double b;
+} pair_t;
+
+static ir_node *nodes[2 * N_NODES];
+
+static void create_nodes(ir_graph *irg, unsigned begin, unsigned end)
+{
+	for (unsigned i = begin; i < end; ++i)
+		nodes[i] = new_r_Const_long(irg, mode_Iu, i);
+}
+
+int main(void)
+{
+	ir_init();
+	ir_type   *const mtp = new_type_method(0, 0);
+	ir_entity *const ent = new_entity(get_glob_type(), new_id_from_str("f"),
+	                                  mtp);
+	ir_graph  *const irg = new_ir_graph(ent, 0);
+	create_nodes(irg, 0, N_NODES);
+
+	ir_nodegenmap map;
+	ir_nodegenmap_init(&map, irg, sizeof(unsigned));
+	for (unsigned i = 0; i < N_NODES; ++i)
+		assert(ir_nodegenmap_get_unsigned(&map, nodes[i]) == 0);
+	for (unsigned i = 0; i < N_NODES; i += 2)
+		ir_nodegenmap_set_unsigned(&map, nodes[i], i + 100);
+	for (unsigned i = 0; i < N_NODES; ++i) {
+		unsigned const expected = i % 2 == 0 ? i + 100 : 0;
+		assert(ir_nodegenmap_get_unsigned(&map, nodes[i]) == expected);
+		assert((ir_nodegenmap_find(&map, nodes[i]) != NULL) == (i % 2 == 0));
+	}
+
+	ir_nodegenmap_remove(&map, nodes[2]);
+	assert(ir_nodegenmap_find(&map, nodes[2]) == NULL);
+	assert(ir_nodegenmap_get_unsigned(&map, nodes[4]) == 104);
+
+	/* clearing makes all entries stale, re-inserting zeroes them */
+	ir_nodegenmap_clear(&map, irg);
+	for (unsigned i = 0; i < N_NODES; ++i)
+		assert(ir_nodegenmap_find(&map, nodes[i]) == NULL);
+	unsigned *const entry = (unsigned*)ir_nodegenmap_insert(&map, nodes[4]);
+	assert(*entry == 0);
+	*entry = 7;
+	assert(ir_nodegenmap_get_unsigned(&map, nodes[4]) == 7);
+
+	/* nodes created after the map are found after a clear or an insert */
+	create_nodes(irg, N_NODES, 2 * N_NODES);
+	assert(ir_nodegenmap_find(&map, nodes[2 * N_NODES - 1]) == NULL);
+	ir_nodegenmap_set_unsigned(&map, nodes[2 * N_NODES - 1], 42);
+	assert(ir_nodegenmap_get_unsigned(&map, nodes[2 * N_NODES - 1]) == 42);
+	assert(ir_nodegenmap_get_unsigned(&map, nodes[4]) == 7);
+	ir_nodegenmap_clear(&map, irg);
+	for (unsigned i = 0; i < 2 * N_NODES; ++i)
+		assert(ir_nodegenmap_find(&map, nodes[i]) == NULL);
+
+	/* stale entries do not come back when the generation wraps around */
+	ir_nodegenmap_set_unsigned(&map, nodes[1], 1);
+	map.generation = UINT_MAX;
+	ir_nodegenmap_set_unsigned(&map, nodes[3], 3);
+	ir_nodegenmap_clear(&map, irg);
+	assert(map.generation != UINT_MAX);
+	for (unsigned i = 0; i < 2 * N_NODES; ++i)
+		assert(ir_nodegenmap_find(&map, nodes[i]) == NULL);
+	ir_nodegenmap_destroy(&map);
+
+	/* entries of other types */
+	ir_nodegenmap_init(&map, irg, sizeof(ir_node*));
+	ir_nodegenmap_set_node(&map, nodes[5], nodes[6]);
+	assert(ir_nodegenmap_get_node(&map, nodes[5]) == nodes[6]);
+	assert(ir_nodegenmap_get_node(&map, nodes[6]) == NULL);
+	ir_nodegenmap_destroy(&map);
+
+	ir_nodegenmap_init(&map, irg, sizeof(double));
+	ir_nodegenmap_set_double(&map, nodes[7], 0.5);
+	assert(ir_nodegenmap_get_double(&map, nodes[7]) == 0.5);
+	assert(ir_nodegenmap_get_double(&map, nodes[8]) == 0.0);
+	ir_nodegenmap_destroy(&map);
+
+	ir_nodegenmap_init(&map, irg, sizeof(pair_t));
+	pair_t *const pair = (pair_t*)ir_nodegenmap_insert(&map, nodes[9]);
+	assert(pair->a == 0 && pair->b == 0.0);
+	pair->a = 3;
+	pair->b = 1.5;
+	pair_t const *const found = (pair_t const*)ir_nodegenmap_find(&map, nodes[9]);
+	assert(found == pair && found->a == 3 && found->b == 1.5);
+	ir_nodegenmap_destroy(&map);
+
+	return 0;
+}
@@ -0,0 +1,122 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "pdeq.h"
+
+/* reference model: model[lo..hi-1] holds the queue from left to right */
+#define MODEL_SIZE 4096
+static intptr_t model[MODEL_SIZE];
+static size_t   lo = MODEL_SIZE / 2;
+static size_t   hi = MODEL_SIZE / 2;
+
+static void const *to_ptr(intptr_t i)
+{
+	return (void const*)i;
+}
+
+static void check(pdeq const *dq)
+{
+	void const *buf[MODEL_SIZE];
+	size_t const n = hi - lo;
+	assert(pdeq_len(dq) == n);
+	assert(!pdeq_empty(dq) == (n > 0));
+
+	pdeq_copyl(dq, buf);
+	for (size_t i = 0; i < n; ++i)
+		assert(buf[i] == to_ptr(model[lo + i]));
+
+	pdeq_copyr(dq, buf);
+	for (size_t i = 0; i < n; ++i)
+		assert(buf[i] == to_ptr(model[hi - 1 - i]));
+}
+
+static void putl(pdeq *dq, intptr_t i)
+{
+	pdeq_putl(dq, to_ptr(i));
+	model[--lo] = i;
+}
+
+static void putr(pdeq *dq, intptr_t i)
+{
+	pdeq_putr(dq, to_ptr(i));
+	model[hi++] = i;
+}
+
+static void getl(pdeq *dq)
+{
+	void *const x = pdeq_getl(dq);
+	assert(x == to_ptr(model[lo++]));
+}
+
+static void getr(pdeq *dq)
+{
+	void *const x = pdeq_getr(dq);
+	assert(x == to_ptr(model[--hi]));
+}
+
+int main(void)
+{
+	pdeq *dq = new_pdeq();
+	check(dq);
+
+	/* putl on an empty queue wraps the head to the end of the buffer */
+	intptr_t next = 1;
+	for (int i = 0; i < 5; ++i)
+		putl(dq, next++);
+	for (int i = 0; i < 5; ++i)
+		putr(dq, next++);
+	check(dq);
+	assert(pdeq_contains(dq, to_ptr(3)));
+	assert(!pdeq_contains(dq, to_ptr(next)));
+
+	/* move the elements through the buffer until the head has wrapped */
+	for (int i = 0; i < 40; ++i) {
+		getl(dq);
+		putr(dq, next++);
+		check(dq);
+	}
+	for (int i = 0; i < 40; ++i) {
+		getr(dq);
+		putl(dq, next++);
+		check(dq);
+	}
+
+	/* grow while wrapped, from both sides */
+	for (int i = 0; i < 100; ++i) {
+		if (i % 3 == 0)
+			putr(dq, next++);
+		else
+			putl(dq, next++);
+	}
+	check(dq);
+
+	/* mixed operations in a pseudo random order */
+	unsigned state = 12345;
+	for (int i = 0; i < 10000; ++i) {
+		state = state * 1103515245 + 12345;
+		unsigned const op = (state >> 16) % 4;
+		bool const empty = hi == lo;
+		if (op == 0 && lo > 0) {
+			putl(dq, next++);
+		} else if (op == 1 && hi < MODEL_SIZE) {
+			putr(dq, next++);
+		} else if (op == 2 && !empty) {
+			getl(dq);
+		} else if (op == 3 && !empty) {
+			getr(dq);
+		}
+		if (i % 97 == 0)
+			check(dq);
+	}
+	check(dq);
+
+	while (hi != lo) {
+		getr(dq);
+		if (hi != lo)
+			getl(dq);
+	}
+	check(dq);
+
+	del_pdeq(dq);
+	return 0;
+}
@@ -0,0 +1,85 @@
+#include <assert.h>
+#include <stdint.h>
+#include "pqueue.h"
+
+#define N 200
+
+static void *to_data(int i)
+{
+	return (void*)(intptr_t)i;
+}
+
+static int from_data(void *data)
+{
+	return (int)(intptr_t)data;
+}
+
+int main(void)
+{
+	pqueue_t *q = new_pqueue();
+	assert(pqueue_empty(q));
+
+	/* elements come out in descending priority, whatever the insertion order */
+	for (int i = 0; i < N; ++i) {
+		int const prio = (i * 37) % N;
+		pqueue_put(q, to_data(prio), prio);
+	}
+	assert(pqueue_length(q) == N);
+	for (int i = N; i-- > 0;) {
+		assert(from_data(pqueue_pop_front(q)) == i);
+	}
+	assert(pqueue_empty(q));
+
+	/* handles are valid while the element is in the queue */
+	size_t handles[N];
+	for (int i = 0; i < N; ++i) {
+		handles[i] = pqueue_insert(q, to_data(i), i);
+	}
+	for (int i = 0; i < N; ++i) {
+		assert(pqueue_contains(q, handles[i]));
+	}
+	assert(!pqueue_contains(q, PQUEUE_NO_HANDLE));
+	assert(from_data(pqueue_pop_front(q)) == N - 1);
+	assert(!pqueue_contains(q, handles[N - 1]));
+	for (int i = 0; i < N - 1; ++i) {
+		assert(pqueue_contains(q, handles[i]));
+	}
+
+	/* priority changes in both directions */
+	pqueue_change_priority(q, handles[0], 1000);
+	pqueue_change_priority(q, handles[N - 2], -1);
+	pqueue_change_priority(q, handles[50], 500);
+	assert(from_data(pqueue_pop_front(q)) == 0);
+	assert(from_data(pqueue_pop_front(q)) == 50);
+	assert(!pqueue_contains(q, handles[0]));
+	for (int i = N - 3; i > 50; --i) {
+		assert(from_data(pqueue_pop_front(q)) == i);
+		assert(!pqueue_contains(q, handles[i]));
+	}
+	for (int i = 49; i > 0; --i) {
+		assert(from_data(pqueue_pop_front(q)) == i);
+	}
+	assert(from_data(pqueue_pop_front(q)) == N - 2);
+	assert(pqueue_empty(q));
+
+	/* handles of removed elements are reused, so the table does not grow */
+	size_t const h = pqueue_insert(q, to_data(1), 1);
+	assert(h < N);
+	for (int i = 0; i < 10 * N; ++i) {
+		size_t const h2 = pqueue_insert(q, to_data(2), 2);
+		assert(h2 < N && h2 != h);
+		pqueue_put(q, to_data(0), 0);
+		assert(from_data(pqueue_pop_front(q)) == 2);
+		assert(!pqueue_contains(q, h2));
+		assert(pqueue_contains(q, h));
+	}
+	pqueue_change_priority(q, h, -1);
+	for (int i = 0; i < 10 * N; ++i) {
+		assert(from_data(pqueue_pop_front(q)) == 0);
+	}
+	assert(from_data(pqueue_pop_front(q)) == 1);
+	assert(pqueue_empty(q));
+
+	del_pqueue(q);
+	return 0;
+}
@@ -54,6 +54,23 @@ int main(void)
 	assert(rbitset_prev(field1, 3, false) == 2);
 	assert(rbitset_prev(field1, 1, false) == 0);
 
+	rbitset_clear_all(field0, 66);
+	rbitset_set(field0, 3);
+	assert(!rbitset_or_changed(field0, field0, 66));
+	assert(rbitset_or_changed(field0, field1, 66));
+	assert(rbitsets_equal(field0, field1, 66));
+	assert(!rbitset_or_changed(field0, field1, 66));
+	rbitset_clear(field1, 59);
+	assert(!rbitset_and_changed(field1, field0, 66));
+	assert(rbitset_and_changed(field0, field1, 66));
+	assert(rbitsets_equal(field0, field1, 66));
+	assert(!rbitset_andnot_changed(field0, field2, 66));
+	assert(rbitset_andnot_changed(field0, field1, 66));
+	assert(rbitset_is_empty(field0, 66));
+	assert(rbitset_copy_changed(field0, field1, 66));
+	assert(!rbitset_copy_changed(field0, field1, 66));
+	assert(rbitsets_equal(field0, field1, 66));
+
 	unsigned *null = (unsigned*)0;
 	rbitset_flip_all(null, 0);
 	rbitset_set_all(null, 0);
@@ -64,6 +81,10 @@ int main(void)
 	rbitset_and(null, 0, 0);
 	rbitset_or(null, 0, 0);
 	rbitset_andnot(null, 0, 0);
+	assert(!rbitset_or_changed(null, NULL, 0));
+	assert(!rbitset_and_changed(null, NULL, 0));
+	assert(!rbitset_andnot_changed(null, NULL, 0));
+	assert(!rbitset_copy_changed(null, NULL, 0));
 	assert(rbitsets_equal(null, NULL, 0));
 	assert(rbitset_contains(null, NULL, 0));
 	assert(!rbitsets_have_common(null, NULL, 0));
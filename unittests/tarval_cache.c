@@ -0,0 +1,163 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include "firm.h"
+#include "irmode_t.h"
+#include "tv_t.h"
+
+#define N_THREADS 4
+
+static long const values[] = {
+	-100, -9, -8, -7, -1, 0, 1, 2, 7, 30, 31, 32, 33, 255, 1000, 123456789,
+};
+#define N_VALUES (sizeof(values) / sizeof(values[0]))
+
+static ir_tarval *from_str(long value, ir_mode *mode)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%ld", value);
+	return new_tarval_from_str(buf, strlen(buf), mode);
+}
+
+/* all ways to build a value give the same tarval */
+static void check_int_mode(ir_mode *mode)
+{
+	ir_tarval *const one = get_mode_one(mode);
+	assert(new_tarval_from_long(0, mode) == get_mode_null(mode));
+	assert(new_tarval_from_long(1, mode) == one);
+	if (mode_is_signed(mode))
+		assert(new_tarval_from_long(-1, mode) == get_mode_all_one(mode));
+
+	for (size_t i = 0; i < N_VALUES; ++i) {
+		long       const v  = values[i];
+		ir_tarval *const tv = new_tarval_from_long(v, mode);
+		/* skip values which are not representable in the mode */
+		if (!tarval_is_long(tv) || get_tarval_long(tv) != v)
+			continue;
+		assert(new_tarval_from_long(v, mode) == tv);
+		assert(from_str(v, mode) == tv);
+		assert(tarval_add(new_tarval_from_long(v - 1, mode), one) == tv);
+		assert(tarval_sub(new_tarval_from_long(v + 1, mode), one) == tv);
+		if (mode_is_signed(mode))
+			assert(tarval_neg(new_tarval_from_long(-v, mode)) == tv);
+	}
+}
+
+static void test_int_modes(void)
+{
+	check_int_mode(mode_Bs);
+	check_int_mode(mode_Bu);
+	check_int_mode(mode_Hs);
+	check_int_mode(mode_Hu);
+	check_int_mode(mode_Is);
+	check_int_mode(mode_Iu);
+	check_int_mode(mode_Ls);
+	check_int_mode(mode_Lu);
+
+	/* values outside of the mode wrap to the same tarval */
+	assert(new_tarval_from_long(-8, mode_Bu) == new_tarval_from_long(248, mode_Bu));
+	assert(get_tarval_long(new_tarval_from_long(-8, mode_Bu)) == 248);
+	assert(new_tarval_from_long(-1, mode_Bu) == get_mode_all_one(mode_Bu));
+	assert(new_tarval_from_long(-1, mode_Lu) == get_mode_all_one(mode_Lu));
+	assert(new_tarval_from_long(255, mode_Bs) == get_mode_all_one(mode_Bs));
+	assert(new_tarval_from_long(256 + 5, mode_Bs) == new_tarval_from_long(5, mode_Bs));
+	assert(new_tarval_from_long(-1, mode_Bs) != new_tarval_from_long(-1, mode_Hs));
+
+	/* conversions land on the tarvals of the target mode */
+	ir_tarval *const five_bs = new_tarval_from_long(5, mode_Bs);
+	assert(tarval_convert_to(five_bs, mode_Ls) == new_tarval_from_long(5, mode_Ls));
+	ir_tarval *const m3_bs = new_tarval_from_long(-3, mode_Bs);
+	assert(tarval_convert_to(m3_bs, mode_Is) == new_tarval_from_long(-3, mode_Is));
+	assert(tarval_convert_to(m3_bs, mode_Bu) == new_tarval_from_long(253, mode_Bu));
+
+	/* large values are found again through the set */
+	ir_tarval *const big = new_tarval_from_long(1L << 40, mode_Ls);
+	assert(tarval_mul(new_tarval_from_long(1L << 20, mode_Ls),
+	                  new_tarval_from_long(1L << 20, mode_Ls)) == big);
+	assert(get_tarval_long(big) == 1L << 40);
+}
+
+static void check_float_mode(ir_mode *mode)
+{
+	ir_tarval *const one = get_mode_one(mode);
+	assert(new_tarval_from_double(0.0, mode) == get_mode_null(mode));
+	assert(new_tarval_from_double(1.0, mode) == one);
+
+	for (size_t i = 0; i < N_VALUES; ++i) {
+		long const v = values[i];
+		/* skip values which are not exact in single precision */
+		if (mode == mode_F && (long)(float)v != v)
+			continue;
+		ir_tarval *const tv = new_tarval_from_double(v, mode);
+		assert(get_tarval_double(tv) == (double)v);
+		assert(new_tarval_from_long_double(v, mode) == tv);
+		assert(tarval_add(new_tarval_from_double(v - 1, mode), one) == tv);
+		if (v != 0)
+			assert(tarval_neg(new_tarval_from_double(-v, mode)) == tv);
+	}
+
+	/* -0.0 is not the preallocated 0.0 */
+	ir_tarval *const minus_zero = new_tarval_from_double(-0.0, mode);
+	assert(minus_zero != get_mode_null(mode));
+	assert(tarval_is_negative(minus_zero));
+	assert(tarval_neg(get_mode_null(mode)) == minus_zero);
+
+	/* non-integral values are found again through the set */
+	ir_tarval *const half = new_tarval_from_double(0.5, mode);
+	assert(new_tarval_from_double(0.5, mode) == half);
+	assert(tarval_add(half, half) == one);
+	assert(new_tarval_from_double(2.5, mode) != new_tarval_from_double(2.0, mode));
+}
+
+static void test_float_modes(void)
+{
+	check_float_mode(mode_F);
+	check_float_mode(mode_D);
+}
+
+static ir_tarval *thread_results[N_THREADS][2 * N_VALUES];
+
+static void *create_tarvals(void *arg)
+{
+	ir_tarval **const res = (ir_tarval**)arg;
+	for (unsigned round = 0; round < 100; ++round) {
+		for (size_t i = 0; i < N_VALUES; ++i) {
+			ir_tarval *const tv = new_tarval_from_long(values[i], mode_Ls);
+			ir_tarval *const sum
+				= tarval_add(tv, new_tarval_from_long(1000000 + round, mode_Ls));
+			assert(round == 0 || res[i] == tv);
+			res[i]            = tv;
+			res[N_VALUES + i] = sum;
+		}
+	}
+	return NULL;
+}
+
+/* tarvals created in other threads are the same as those of this thread */
+static void test_threads(void)
+{
+	pthread_t threads[N_THREADS];
+	for (unsigned t = 0; t < N_THREADS; ++t)
+		pthread_create(&threads[t], NULL, create_tarvals, thread_results[t]);
+	for (unsigned t = 0; t < N_THREADS; ++t)
+		pthread_join(threads[t], NULL);
+
+	for (size_t i = 0; i < N_VALUES; ++i) {
+		long const v = values[i];
+		for (unsigned t = 0; t < N_THREADS; ++t) {
+			assert(thread_results[t][i] == new_tarval_from_long(v, mode_Ls));
+			assert(thread_results[t][N_VALUES + i]
+			       == new_tarval_from_long(v + 1000099, mode_Ls));
+		}
+	}
+}
+
+int main(void)
+{
+	ir_init();
+	test_int_modes();
+	test_float_modes();
+	test_threads();
+	return 0;
+}